@@ -69,6 +69,7 @@ option(USE_ASCEND_HETEROGENEOUS "option for transferring between ascend npu and
 option(USE_MNNVL "option for using Multi-Node NVLink transport" OFF)
 option(USE_CXL "option for using CXL protocol" OFF)
 option(USE_EFA "option for using AWS EFA transport" OFF)
+option(USE_IBGDA "option for exporting GPU-initiated RDMA queue pairs (IBGDA)" OFF)
 
 if (USE_EFA)
   # Find libfabric headers and library; default to AWS EFA installer path
@@ -133,6 +134,12 @@ if (USE_MNNVL)
   message(STATUS "Multi-Node NVLink support is enabled")
 endif()
 
+if (USE_IBGDA)
+  set(USE_CUDA ON)
+  add_compile_definitions(USE_IBGDA)
+  message(STATUS "GPU-initiated RDMA (IBGDA) support is enabled")
+endif()
+
 if (USE_CUDA)
   add_compile_definitions(USE_CUDA)
   message(STATUS "CUDA support is enabled")
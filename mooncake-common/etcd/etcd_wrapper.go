@@ -72,6 +72,9 @@ var (
 	// watch contexts for prefix watch
 	storePrefixWatchCtx   = make(map[string]prefixWatchInfo)
 	storePrefixWatchMutex sync.Mutex
+	// watch contexts for prefix watch of transfer engine
+	globalPrefixWatchCtx   = make(map[string]prefixWatchInfo)
+	globalPrefixWatchMutex sync.Mutex
 )
 
 const (
@@ -165,6 +168,142 @@ func EtcdGetWrapper(key *C.char, value **C.char, errMsg **C.char) int {
 	return 0
 }
 
+// etcd rejects transactions with more operations than --max-txn-ops,
+// which defaults to 128
+const batchGetOpsPerTxn = 128
+
+//export EtcdGetBatchWrapper
+func EtcdGetBatchWrapper(keys **C.char, count C.int, values **C.char, errMsg **C.char) int {
+	if globalClient == nil {
+		*errMsg = C.CString("etcd client not initialized")
+		return -1
+	}
+	n := int(count)
+	if n == 0 {
+		return 0
+	}
+
+	keyPtrs := (*[1 << 28]*C.char)(unsafe.Pointer(keys))[:n:n]
+	valPtrs := (*[1 << 28]*C.char)(unsafe.Pointer(values))[:n:n]
+	for i := 0; i < n; i++ {
+		valPtrs[i] = nil
+	}
+
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+	for start := 0; start < n; start += batchGetOpsPerTxn {
+		end := start + batchGetOpsPerTxn
+		if end > n {
+			end = n
+		}
+		ops := make([]clientv3.Op, 0, end-start)
+		for i := start; i < end; i++ {
+			ops = append(ops, clientv3.OpGet(C.GoString(keyPtrs[i])))
+		}
+		resp, err := globalClient.Txn(ctx).Then(ops...).Commit()
+		if err != nil {
+			for i := 0; i < start; i++ {
+				if valPtrs[i] != nil {
+					C.free(unsafe.Pointer(valPtrs[i]))
+					valPtrs[i] = nil
+				}
+			}
+			*errMsg = C.CString(err.Error())
+			return -1
+		}
+		for j, op := range resp.Responses {
+			kvs := op.GetResponseRange().GetKvs()
+			if len(kvs) > 0 {
+				valPtrs[start+j] = C.CString(string(kvs[0].Value))
+			}
+		}
+	}
+	return 0
+}
+
+//export EtcdWatchPrefixWrapper
+func EtcdWatchPrefixWrapper(prefix *C.char, callbackContext unsafe.Pointer, callbackFunc unsafe.Pointer, errMsg **C.char) int {
+	if globalClient == nil {
+		*errMsg = C.CString("etcd client not initialized")
+		return -1
+	}
+	if callbackFunc == nil {
+		*errMsg = C.CString("callback function is nil")
+		return -1
+	}
+	p := C.GoString(prefix)
+
+	ctx, cancel := context.WithCancel(context.Background())
+
+	globalPrefixWatchMutex.Lock()
+	if _, exists := globalPrefixWatchCtx[p]; exists {
+		globalPrefixWatchMutex.Unlock()
+		*errMsg = C.CString("This prefix is already being watched")
+		cancel()
+		return -1
+	}
+	doneCh := make(chan struct{})
+	globalPrefixWatchCtx[p] = prefixWatchInfo{
+		cancel:          cancel,
+		callbackContext: callbackContext,
+		done:            doneCh,
+	}
+	globalPrefixWatchMutex.Unlock()
+
+	go func(doneCh chan struct{}) {
+		defer close(doneCh)
+		// Re-established until cancelled. Events may be lost while the
+		// watch is broken, which is reported as WATCH_BROKEN (2).
+		for {
+			watchChan := globalClient.Watch(ctx, p, clientv3.WithPrefix())
+			for watchResp := range watchChan {
+				if watchResp.Err() != nil {
+					break
+				}
+				for _, event := range watchResp.Events {
+					keyStr := string(event.Kv.Key)
+					keyPtr := C.CString(keyStr)
+					eventType := C.int(0)
+					if event.Type == clientv3.EventTypeDelete {
+						eventType = C.int(1)
+					}
+					C.call_watch_cb(callbackFunc, callbackContext, keyPtr, C.size_t(len(keyStr)), nil, 0, eventType, C.longlong(event.Kv.ModRevision))
+					C.free(unsafe.Pointer(keyPtr))
+				}
+			}
+			select {
+			case <-ctx.Done():
+				return
+			case <-time.After(time.Second):
+			}
+			C.call_watch_cb(callbackFunc, callbackContext, nil, 0, nil, 0, C.int(2) /*WATCH_BROKEN*/, C.longlong(0))
+		}
+	}(doneCh)
+
+	return 0
+}
+
+//export EtcdCancelWatchPrefixWrapper
+func EtcdCancelWatchPrefixWrapper(prefix *C.char, errMsg **C.char) int {
+	p := C.GoString(prefix)
+	globalPrefixWatchMutex.Lock()
+	watchInfo, exists := globalPrefixWatchCtx[p]
+	delete(globalPrefixWatchCtx, p)
+	globalPrefixWatchMutex.Unlock()
+	if !exists {
+		return 0
+	}
+	watchInfo.cancel()
+	// Once this returns, the callback is never invoked again
+	select {
+	case <-watchInfo.done:
+		return 0
+	case <-time.After(5 * time.Second):
+		*errMsg = C.CString("timeout waiting for prefix watch to stop")
+		return -1
+	}
+}
+
 //export EtcdDeleteWrapper
 func EtcdDeleteWrapper(key *C.char, errMsg **C.char) int {
 	if globalClient == nil {
@@ -12,11 +12,13 @@ void dispatch(void* packed_recv_x, float* packed_recv_x_scales,
               void* cuda_counter_buffer, void* cuda_data_buffer, void* raddrs,
               void* rkeys, void* qp_devctxs, const int32_t* nvlink_available,
               void* const* ipc_peer_ptrs, const void* x,
-              const int64_t* topk_idx, int* next_clean_buffer, int num_tokens,
-              int hidden, int num_max_dispatch_tokens_per_rank, int num_topk,
+              const int64_t* topk_idx, int* next_clean_buffer,
+              int* recv_free_signal_buffer, int* send_free_signal_buffer,
+              int recv_epoch, int num_tokens, int hidden,
+              int num_max_dispatch_tokens_per_rank, int num_topk,
               int num_experts, int rank, int num_ranks, bool use_fp8,
               void* workspace, cudaStream_t stream, int64_t timeout_ticks,
-              int phases);
+              int phases, bool packed);
 
 void combine(void* combined_x, int32_t* active_ranks, void* mxa_buffer,
              int* rdma_send_signal_buffer, int* rdma_recv_signal_buffer,
@@ -26,10 +28,11 @@ void combine(void* combined_x, int32_t* active_ranks, void* mxa_buffer,
              void* const* ipc_peer_ptrs, const void* x, const int64_t* topk_idx,
              const float* topk_weights, const int* src_info,
              const int64_t* layout_range, int* next_clean_buffer,
-             int num_combined_tokens, int hidden,
+             int* recv_free_signal_buffer, int* send_free_signal_buffer,
+             int recv_epoch, int num_combined_tokens, int hidden,
              int num_max_dispatch_tokens_per_rank, int num_topk,
-             int num_experts, int rank, int num_ranks, void* workspace,
-             cudaStream_t stream, int64_t timeout_ticks, int phases,
-             bool zero_copy);
+             int num_experts, int rank, int num_ranks, bool use_fp8,
+             void* workspace, cudaStream_t stream, int64_t timeout_ticks,
+             int phases, bool zero_copy, bool packed);
 
 }  // namespace mooncake
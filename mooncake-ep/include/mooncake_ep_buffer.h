@@ -25,6 +25,11 @@ struct BufferLayout {
 struct BufferPair {
     size_t total_bytes = 0;
     BufferLayout buffers[2];
+    // Shared receive region only: the count of operations whose data each
+    // rank consumed, incremented by that rank, and the landing slots of the
+    // atomics this rank increments them with at its peers
+    int* recv_free_signal_buffer = nullptr;
+    int* send_free_signal_buffer = nullptr;
 
     template <typename out_ptr_t = void*, typename count_ptr_t = uint8_t*,
               typename in_ptr_t = void*>
@@ -33,12 +38,45 @@ struct BufferPair {
                                            count);
     }
 
+    // Bytes of the free signals at the start of a shared receive layout
+    static size_t get_free_signal_bytes(int num_ranks) {
+        size_t bytes = 2 * num_ranks * sizeof(int);
+        return (bytes + sizeof(int4) - 1) / sizeof(int4) * sizeof(int4);
+    }
+
+    // With `shared_recv`, dispatch and combine receive into the same region:
+    // a sender only overwrites it once the receiver consumed the data of the
+    // previous operation, see `recv_free_signal_buffer`.
     BufferPair(void* rdma_buffer, int num_max_dispatch_tokens_per_rank,
-               int hidden, int num_ranks, int num_experts) {
+               int hidden, int num_ranks, int num_experts,
+               bool shared_recv = false) {
         size_t signaling_buffer_bytes = num_experts * sizeof(int);
         size_t send_recv_buffer_bytes =
             num_experts * num_max_dispatch_tokens_per_rank *
             (2 * sizeof(int4) + hidden * sizeof(nv_bfloat16));
+        if (shared_recv) {
+            recv_free_signal_buffer = advance<int*>(rdma_buffer, 0);
+            send_free_signal_buffer =
+                advance<int*>(rdma_buffer, num_ranks * sizeof(int));
+            total_bytes = get_free_signal_bytes(num_ranks);
+            size_t half_bytes =
+                2 * signaling_buffer_bytes + send_recv_buffer_bytes;
+            void* recv_data_buffer =
+                advance(rdma_buffer, total_bytes + 2 * half_bytes);
+            for (int i = 0; i < 2; ++i) {
+                size_t rdma_base_offset = total_bytes + i * half_bytes;
+                buffers[i] = {
+                    advance<int*>(rdma_buffer, rdma_base_offset),
+                    advance<int*>(rdma_buffer,
+                                  rdma_base_offset + signaling_buffer_bytes),
+                    advance<int*>(rdma_buffer, rdma_base_offset +
+                                                   2 * signaling_buffer_bytes),
+                    recv_data_buffer,
+                };
+            }
+            total_bytes += 2 * half_bytes + send_recv_buffer_bytes;
+            return;
+        }
         for (int i = 0; i < 2; ++i) {
             size_t rdma_base_offset = total_bytes +
                                       2 * i * signaling_buffer_bytes +
@@ -68,23 +106,42 @@ struct MooncakeEpBuffer {
     // MXA Buffer
     int buffer_idx{};
     int64_t num_ep_buffer_bytes;
+    // Dispatch and combine share one receive region
+    bool shared_recv_ = false;
+    // Operations issued so far, which peers wait for this rank to consume
+    // before writing into a shared receive region
+    uint32_t recv_epoch_ = 0;
     void* gdr_buffer = nullptr;
 
     // IBGDA
     static constexpr size_t CTRL_BUF_SIZE = 1024 * 1024 * 1024;  // 1024 MiB
     void* ctrl_buf = nullptr;
-    // RDMA memory region for `gdr_buffer`. Must be nullptr when IBGDA init
-    // fails.
+    // A NIC the QPs are striped over, with `gdr_buffer` registered on it
+    struct IbgdaNic {
+        std::string name;
+        ibv_context* ctx = nullptr;
+        ibv_pd* pd = nullptr;
+        mlx5dv_pd mpd{};
+        ibv_mr* mr = nullptr;
+        mlx5dv_devx_umem* ctrl_buf_umem = nullptr;
+        ibv_gid gid{};
+        int gid_index = -1;  // Dynamically discovered GID index
+    };
+    // RDMA memory region for `gdr_buffer` on the first NIC. Must be nullptr
+    // when IBGDA init fails.
     ibv_mr* mr = nullptr;
+    std::vector<IbgdaNic> nics;
     std::vector<mlx5gda_qp*> qps;
-    ibv_gid gid;
+    // Index in `nics` of the NIC of each QP
+    std::vector<int> qp_nics;
     void* raddrs = nullptr;
+    // Local and remote key of each QP, interleaved
     void* rkeys = nullptr;
     void* qp_devctxs = nullptr;
+    // Comma separated NICs, the first one is required
     std::string device_name;
     bool is_roce_ = false;
     bool ibgda_disabled_ = false;
-    int gid_index_ = -1;  // Dynamically discovered GID index
 
     // NVLink P2P
     int32_t* nvlink_available = nullptr;
@@ -98,9 +155,16 @@ struct MooncakeEpBuffer {
     // Workspace
     void* workspace = nullptr;
 
+    int open_nic(const std::string& name, IbgdaNic& nic);
+
+    // Copies the buffer address of each rank and the keys of each QP to the
+    // device
+    void sync_keys(const std::vector<int64_t>& remote_addrs,
+                   const std::vector<int32_t>& remote_keys);
+
    public:
     MooncakeEpBuffer(int rank, int num_ranks, int64_t num_ep_buffer_bytes,
-                     std::string device_name);
+                     std::string device_name, bool shared_recv = false);
 
     ~MooncakeEpBuffer() noexcept(false);
 
@@ -119,7 +183,7 @@ struct MooncakeEpBuffer {
             const torch::Tensor& layout_range, torch::Tensor& active_ranks,
             int num_max_dispatch_tokens_per_rank, int num_experts,
             int timeout_us, bool zero_copy, bool async, bool return_recv_hook,
-            const std::optional<torch::Tensor>& out);
+            const std::optional<torch::Tensor>& out, bool use_fp8);
 
     torch::Tensor get_next_combine_buffer(int num_max_dispatch_tokens_per_rank,
                                           int hidden, int num_experts);
@@ -156,6 +220,7 @@ struct MooncakeEpBuffer {
         return p2p_ipc_all_enabled_;
     }
 
+    // `remote_keys` and the GIDs are per QP, see `get_local_rkeys()`
     void sync_ib(const std::vector<int64_t>& remote_addrs,
                  const std::vector<int32_t>& remote_keys,
                  const std::vector<int32_t>& remote_qpns,
@@ -172,10 +237,32 @@ struct MooncakeEpBuffer {
     }
 
     std::tuple<int64_t, int64_t> get_gid() {
-        return {(int64_t)gid.global.subnet_prefix,
-                (int64_t)gid.global.interface_id};
+        return {(int64_t)nics[0].gid.global.subnet_prefix,
+                (int64_t)nics[0].gid.global.interface_id};
+    }
+
+    // The rkey of `gdr_buffer` on the NIC of each QP
+    std::vector<int32_t> get_local_rkeys() {
+        std::vector<int32_t> local_rkeys;
+        for (int i = 0; i < MAX_QP_COUNT; ++i) {
+            local_rkeys.push_back((int32_t)nics[qp_nics[i]].mr->rkey);
+        }
+        return local_rkeys;
+    }
+
+    // The GID of the NIC of each QP
+    std::tuple<std::vector<int64_t>, std::vector<int64_t>> get_local_gids() {
+        std::vector<int64_t> subnet_prefixes, interface_ids;
+        for (int i = 0; i < MAX_QP_COUNT; ++i) {
+            const ibv_gid& gid = nics[qp_nics[i]].gid;
+            subnet_prefixes.push_back((int64_t)gid.global.subnet_prefix);
+            interface_ids.push_back((int64_t)gid.global.interface_id);
+        }
+        return {subnet_prefixes, interface_ids};
     }
 
+    int num_nics() { return (int)nics.size(); }
+
     std::vector<int32_t> get_local_qpns() {
         std::vector<int32_t> local_qpns;
         for (int i = 0; i < MAX_QP_COUNT; ++i) {
@@ -197,11 +284,22 @@ struct MooncakeEpBuffer {
         const std::vector<std::vector<int32_t>>& remote_handles);
 };
 
+// Whether the low-latency kernels pack the tokens of each expert. The combine
+// finds the tokens where the dispatch packed them, so this only depends on
+// arguments both of them get.
+inline bool use_packed_low_latency(int num_max_dispatch_tokens_per_rank,
+                                   int num_experts) {
+    return num_max_dispatch_tokens_per_rank <=
+               NUM_MAX_PACKED_DISPATCH_TOKENS and
+           num_experts > 1;
+}
+
 inline size_t get_ep_buffer_size_hint(int num_max_dispatch_tokens_per_rank,
                                       int hidden, int num_ranks,
-                                      int num_experts) {
+                                      int num_experts,
+                                      bool shared_recv = false) {
     return BufferPair(nullptr, num_max_dispatch_tokens_per_rank, hidden,
-                      num_ranks, num_experts)
+                      num_ranks, num_experts, shared_recv)
         .total_bytes;
 }
 
@@ -15,6 +15,10 @@
 #define LOW_LATENCY_SEND_PHASE 1
 #define LOW_LATENCY_RECV_PHASE 2
 
+// Up to this many tokens per rank, low-latency kernels pack the tokens of
+// each expert and move them with one RDMA write per expert
+#define NUM_MAX_PACKED_DISPATCH_TOKENS 128
+
 // Make CLion CUDA indexing work
 #ifdef __CLION_IDE__
 #define __CUDA_ARCH__ 900  // NOLINT(*-reserved-identifier)
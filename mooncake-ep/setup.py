@@ -27,7 +27,7 @@ setup(
                 "../mooncake-integration/ep/ep_py.cpp",
                 "src/mooncake_ep_buffer.cpp",
                 "src/mooncake_ep_kernel.cu",
-                "src/mooncake_ibgda/mlx5gda.cpp",
+                "../mooncake-transfer-engine/src/transport/ibgda/mlx5gda.cpp",
             ],
             extra_compile_args={
                 "cxx": [f"-D_GLIBCXX_USE_CXX11_ABI={abi_flag}", "-std=c++20", "-O3", "-g0"],
@@ -1,5 +1,10 @@
 #include <mooncake_ep_buffer.h>
 #include <arpa/inet.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
+#include <sstream>
 
 namespace mooncake {
 
@@ -34,10 +39,11 @@ static int findBestGidIndex(ibv_context* ctx, uint8_t port,
 
 MooncakeEpBuffer::MooncakeEpBuffer(int rank, int num_ranks,
                                    int64_t num_ep_buffer_bytes,
-                                   std::string device_name)
+                                   std::string device_name, bool shared_recv)
     : rank(rank),
       num_ranks(num_ranks),
       num_ep_buffer_bytes(num_ep_buffer_bytes),
+      shared_recv_(shared_recv),
       device_name(std::move(device_name)),
       comm_stream(at::cuda::getStreamFromPool(true)) {
     // Get ranks
@@ -45,8 +51,15 @@ MooncakeEpBuffer::MooncakeEpBuffer(int rank, int num_ranks,
     CUDA_CHECK(cudaDeviceGetAttribute(&clock_rate_khz, cudaDevAttrClockRate,
                                       device_id));
     CUDA_CHECK(cudaMalloc(&gdr_buffer, num_ep_buffer_bytes));
+    if (shared_recv_) {
+        // Every rank starts with no operation consumed
+        EP_HOST_ASSERT(BufferPair::get_free_signal_bytes(num_ranks) <=
+                       (size_t)num_ep_buffer_bytes);
+        CUDA_CHECK(cudaMemset(gdr_buffer, 0,
+                              BufferPair::get_free_signal_bytes(num_ranks)));
+    }
     CUDA_CHECK(cudaMalloc(&raddrs, num_ranks * sizeof(uint64_t)));
-    CUDA_CHECK(cudaMalloc(&rkeys, num_ranks * sizeof(uint32_t)));
+    CUDA_CHECK(cudaMalloc(&rkeys, 2 * MAX_QP_COUNT * sizeof(uint32_t)));
     CUDA_CHECK(
         cudaMalloc(&qp_devctxs, MAX_QP_COUNT * sizeof(mlx5gda_qp_devctx)));
 
@@ -118,10 +131,11 @@ MooncakeEpBuffer::dispatch(const torch::Tensor& x,
 
     // Buffer control
     BufferPair layout(gdr_buffer, num_max_dispatch_tokens_per_rank, hidden,
-                      num_ranks, num_experts);
+                      num_ranks, num_experts, shared_recv_);
     EP_HOST_ASSERT(layout.total_bytes <= num_ep_buffer_bytes);
     auto buffer = layout.buffers[buffer_idx];
     auto next_buffer = layout.buffers[buffer_idx ^= 1];
+    const int recv_epoch = static_cast<int>(recv_epoch_++);
 
     // Wait previous tasks to be finished
     // NOTES: the hook mode will always use the default stream
@@ -164,6 +178,17 @@ MooncakeEpBuffer::dispatch(const torch::Tensor& x,
         timeout_us == -1 ? -1
                          : (int64_t)clock_rate_khz * (int64_t)timeout_us / 1000;
 
+    // Packed FP8 tokens are cast behind the per-expert staging area
+    bool packed =
+        use_packed_low_latency(num_max_dispatch_tokens_per_rank, num_experts);
+    size_t num_bytes_per_msg =
+        sizeof(int4) + (use_fp8 ? hidden + num_scales * sizeof(float)
+                                : hidden * sizeof(nv_bfloat16));
+    EP_HOST_ASSERT(not(packed and use_fp8) or
+                   (num_experts + 1) * num_bytes_per_msg <=
+                       num_experts * (2 * sizeof(int4) +
+                                      hidden * sizeof(nv_bfloat16)));
+
     auto launcher = [=](int phases) {
         mooncake::dispatch(
             packed_recv_x.data_ptr(), packed_recv_x_scales_ptr,
@@ -175,9 +200,10 @@ MooncakeEpBuffer::dispatch(const torch::Tensor& x,
             buffer.rdma_recv_data_buffer, nullptr, nullptr, raddrs, rkeys,
             qp_devctxs, nvlink_available, ipc_peer_ptrs, x.data_ptr(),
             topk_idx.data_ptr<int64_t>(), next_buffer.rdma_recv_signal_buffer,
-            num_tokens, hidden, num_max_dispatch_tokens_per_rank, num_topk,
-            num_experts, rank, num_ranks, use_fp8, workspace, launch_stream,
-            timeout_ticks, phases);
+            layout.recv_free_signal_buffer, layout.send_free_signal_buffer,
+            recv_epoch, num_tokens, hidden, num_max_dispatch_tokens_per_rank,
+            num_topk, num_experts, rank, num_ranks, use_fp8, workspace,
+            launch_stream, timeout_ticks, phases, packed);
     };
     launcher(return_recv_hook
                  ? LOW_LATENCY_SEND_PHASE
@@ -219,7 +245,8 @@ MooncakeEpBuffer::combine(const torch::Tensor& x, const torch::Tensor& topk_idx,
                           int num_max_dispatch_tokens_per_rank, int num_experts,
                           int timeout_us, bool zero_copy, bool async,
                           bool return_recv_hook,
-                          const std::optional<torch::Tensor>& out) {
+                          const std::optional<torch::Tensor>& out,
+                          bool use_fp8) {
     // Tensor checks
     EP_HOST_ASSERT(x.dim() == 3 and x.is_contiguous() and
                    x.scalar_type() == torch::kBFloat16);
@@ -247,17 +274,22 @@ MooncakeEpBuffer::combine(const torch::Tensor& x, const torch::Tensor& topk_idx,
 
     // Buffer control
     BufferPair layout(gdr_buffer, num_max_dispatch_tokens_per_rank, hidden,
-                      num_ranks, num_experts);
+                      num_ranks, num_experts, shared_recv_);
     EP_HOST_ASSERT(layout.total_bytes <= num_ep_buffer_bytes);
     auto buffer = layout.buffers[buffer_idx];
     auto next_buffer = layout.buffers[buffer_idx ^= 1];
+    const int recv_epoch = static_cast<int>(recv_epoch_++);
 
     // Wait previous tasks to be finished
-    // NOTES: the hook mode will always use the default stream
+    // NOTES: the hook mode uses the default stream, unless it is async: then
+    // both phases run on the communication stream, the returned event marks
+    // the sends as issued and the hook makes the calling stream wait for the
+    // receiving phase, so that the expert computation of the next
+    // micro-batch overlaps with the transfer
     auto compute_stream = at::cuda::getCurrentCUDAStream();
-    auto launch_stream = return_recv_hook ? compute_stream : comm_stream;
-    EP_HOST_ASSERT(not(async and return_recv_hook));
-    if (not return_recv_hook) stream_wait(launch_stream, compute_stream);
+    bool use_comm_stream = async or not return_recv_hook;
+    auto launch_stream = use_comm_stream ? comm_stream : compute_stream;
+    if (use_comm_stream) stream_wait(launch_stream, compute_stream);
 
     // Allocate output tensor
     torch::Tensor combined_x;
@@ -276,6 +308,8 @@ MooncakeEpBuffer::combine(const torch::Tensor& x, const torch::Tensor& topk_idx,
                          : (int64_t)clock_rate_khz * (int64_t)timeout_us / 1000;
 
     // Kernel launch
+    bool packed =
+        use_packed_low_latency(num_max_dispatch_tokens_per_rank, num_experts);
     auto launcher = [=](int phases) {
         mooncake::combine(
             combined_x.data_ptr(), active_ranks.data_ptr<int32_t>(), gdr_buffer,
@@ -285,10 +319,12 @@ MooncakeEpBuffer::combine(const torch::Tensor& x, const torch::Tensor& topk_idx,
             x.data_ptr(), topk_idx.data_ptr<int64_t>(),
             topk_weights.data_ptr<float>(), src_info.data_ptr<int>(),
             layout_range.data_ptr<int64_t>(),
-            next_buffer.rdma_recv_signal_buffer, num_combined_tokens, hidden,
+            next_buffer.rdma_recv_signal_buffer,
+            layout.recv_free_signal_buffer, layout.send_free_signal_buffer,
+            recv_epoch, num_combined_tokens, hidden,
             num_max_dispatch_tokens_per_rank, num_topk, num_experts, rank,
-            num_ranks, workspace, launch_stream, timeout_ticks, phases,
-            zero_copy);
+            num_ranks, use_fp8, workspace, launch_stream, timeout_ticks,
+            phases, zero_copy, packed);
     };
     launcher(return_recv_hook
                  ? LOW_LATENCY_SEND_PHASE
@@ -307,8 +343,13 @@ MooncakeEpBuffer::combine(const torch::Tensor& x, const torch::Tensor& topk_idx,
 
     // Receiver callback
     std::optional<std::function<void()>> recv_hook = std::nullopt;
-    if (return_recv_hook)
-        recv_hook = [=]() { launcher(LOW_LATENCY_RECV_PHASE); };
+    if (return_recv_hook) {
+        recv_hook = [=]() {
+            launcher(LOW_LATENCY_RECV_PHASE);
+            if (async)
+                stream_wait(at::cuda::getCurrentCUDAStream(), launch_stream);
+        };
+    }
 
     // Return values
     return {combined_x, event, recv_hook};
@@ -317,7 +358,7 @@ MooncakeEpBuffer::combine(const torch::Tensor& x, const torch::Tensor& topk_idx,
 torch::Tensor MooncakeEpBuffer::get_next_combine_buffer(
     int num_max_dispatch_tokens_per_rank, int hidden, int num_experts) {
     BufferPair layout(gdr_buffer, num_max_dispatch_tokens_per_rank, hidden,
-                      num_ranks, num_experts);
+                      num_ranks, num_experts, shared_recv_);
 
     auto buffer = layout.buffers[buffer_idx];
     auto dtype = torch::kBFloat16;
@@ -336,25 +377,28 @@ torch::Tensor MooncakeEpBuffer::get_next_combine_buffer(
         torch::TensorOptions().dtype(dtype).device(torch::kCUDA));
 }
 
-int MooncakeEpBuffer::init_ibgda() {
+int MooncakeEpBuffer::open_nic(const std::string& name, IbgdaNic& nic) {
     int num_devices;
     ibv_device** dev_list = ibv_get_device_list(&num_devices);
     int nic_id = -1;
     for (int i = 0; i < num_devices; ++i) {
-        const char* name = ibv_get_device_name(dev_list[i]);
-        if (name && device_name == name) {
+        const char* dev_name = ibv_get_device_name(dev_list[i]);
+        if (dev_name && name == dev_name) {
             nic_id = i;
             break;
         }
     }
     if (nic_id == -1) {
-        throw std::runtime_error("Device matching name '" + device_name +
+        ibv_free_device_list(dev_list);
+        throw std::runtime_error("Device matching name '" + name +
                                  "' not found.");
     }
     LOG(INFO) << "[EP] GPU " << device_id << " uses NIC " << nic_id
               << " out of " << num_devices << " NIC(s)";
-    ibv_context* ctx = ibv_open_device(dev_list[nic_id]);
-    if (!ctx) {
+    nic.name = name;
+    nic.ctx = ibv_open_device(dev_list[nic_id]);
+    ibv_free_device_list(dev_list);
+    if (!nic.ctx) {
         perror("Failed to open device");
         return -1;
     }
@@ -362,81 +406,127 @@ int MooncakeEpBuffer::init_ibgda() {
     // Query port attributes to get GID table length
     ibv_port_attr port_attr;
     const uint8_t port_num = 1;
-    if (ibv_query_port(ctx, port_num, &port_attr)) {
+    if (ibv_query_port(nic.ctx, port_num, &port_attr)) {
         perror("Failed to query port");
         return -1;
     }
 
     // Dynamically find the best GID index (replaces hardcoded index 3)
-    gid_index_ = findBestGidIndex(ctx, port_num, port_attr);
-    if (gid_index_ < 0) {
-        LOG(ERROR) << "[EP] Failed to find a suitable GID index on "
-                   << device_name;
+    nic.gid_index = findBestGidIndex(nic.ctx, port_num, port_attr);
+    if (nic.gid_index < 0) {
+        LOG(ERROR) << "[EP] Failed to find a suitable GID index on " << name;
         return -1;
     }
 
-    if (ibv_query_gid(ctx, port_num, gid_index_, &gid)) {
+    if (ibv_query_gid(nic.ctx, port_num, nic.gid_index, &nic.gid)) {
         perror("Failed to query gid");
         return -1;
     }
-    ibv_free_device_list(dev_list);
 
-    ibv_pd* pd = ibv_alloc_pd(ctx);
-    if (!pd) {
+    nic.pd = ibv_alloc_pd(nic.ctx);
+    if (!nic.pd) {
         perror("Failed to allocate protection domain");
         return -1;
     }
-    mlx5dv_pd mpd;
     mlx5dv_obj dv_obj = {};
-    dv_obj.pd.in = pd;
-    dv_obj.pd.out = &mpd;
+    dv_obj.pd.in = nic.pd;
+    dv_obj.pd.out = &nic.mpd;
     if (mlx5dv_init_obj(&dv_obj, MLX5DV_OBJ_PD)) {
         perror("Failed to initialize mlx5dv object");
     }
-    mr = ibv_reg_mr(pd, gdr_buffer, num_ep_buffer_bytes,
-                    IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ |
-                        IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_REMOTE_ATOMIC);
-    if (!mr) {
+    nic.mr = ibv_reg_mr(nic.pd, gdr_buffer, num_ep_buffer_bytes,
+                        IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ |
+                            IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_REMOTE_ATOMIC);
+    if (!nic.mr) {
         perror("Failed to reg mr");
+        return -1;
     }
 
-    // Allocate ctrl_buf without zero-initialization. Individual regions will be
-    // initialized as needed: CQ needs -1 (hardware requirement), DBR needs 0.
-    // WQ doesn't need initialization as it's zeroed before each use.
-    CUDA_CHECK(cudaMalloc(&ctrl_buf, CTRL_BUF_SIZE));
-    mlx5dv_devx_umem* ctrl_buf_umem = mlx5dv_devx_umem_reg(
-        ctx, ctrl_buf, CTRL_BUF_SIZE, IBV_ACCESS_LOCAL_WRITE);
-    if (!ctrl_buf_umem) {
+    // Every NIC maps the same control buffer, the heap keeps the regions of
+    // their QPs apart
+    nic.ctrl_buf_umem = mlx5dv_devx_umem_reg(nic.ctx, ctrl_buf, CTRL_BUF_SIZE,
+                                             IBV_ACCESS_LOCAL_WRITE);
+    if (!nic.ctrl_buf_umem) {
         perror("Failed to register control buffer as umem");
         fprintf(stderr,
                 "If the error is `Bad address`, probably because your GPU "
                 "does not support GPUDirect RDMA.\n");
-        // Keep internal state consistent: IBGDA init failed, so `mr` must not
-        // be treated as valid.
-        if (mr) {
-            ibv_dereg_mr(mr);
-            mr = nullptr;
+        ibv_dereg_mr(nic.mr);
+        nic.mr = nullptr;
+        return -1;
+    }
+    return 0;
+}
+
+int MooncakeEpBuffer::init_ibgda() {
+    // Allocate ctrl_buf without zero-initialization. Individual regions will be
+    // initialized as needed: CQ needs -1 (hardware requirement), DBR needs 0.
+    // WQ doesn't need initialization as it's zeroed before each use.
+    CUDA_CHECK(cudaMalloc(&ctrl_buf, CTRL_BUF_SIZE));
+
+    // The first NIC is required, the others only add bandwidth
+    std::stringstream names(device_name);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        if (name.empty()) {
+            continue;
         }
+        IbgdaNic nic;
+        int ret;
+        try {
+            ret = open_nic(name, nic);
+        } catch (const std::runtime_error& e) {
+            if (nics.empty()) {
+                throw;
+            }
+            LOG(WARNING) << "[EP] " << e.what();
+            ret = -1;
+        }
+        if (ret == 0) {
+            nics.push_back(nic);
+        } else if (nics.empty()) {
+            return -1;
+        } else {
+            LOG(WARNING) << "[EP] Not striping over NIC " << name;
+        }
+    }
+    if (nics.empty()) {
+        LOG(ERROR) << "[EP] No NIC given for GPU " << device_id;
         return -1;
     }
+    mr = nics[0].mr;
+
     memheap* ctrl_buf_heap = memheap_create(CTRL_BUF_SIZE);
     if (!ctrl_buf_heap) {
         perror("Failed to create memory heap");
+        mr = nullptr;
         return -1;
     }
+    // QP `i` is the `i % num_qp_per_rank`th QP to rank `i / num_qp_per_rank`,
+    // and its peer is the QP of the same slot on that rank. The NIC only
+    // depends on the pair of ranks and the slot, so both ends of a QP use the
+    // NIC of the same index and stay on one rail, while the destination ranks
+    // of a GPU and the QPs to each of them rotate over its NICs.
+    const int num_qp_per_rank = std::max(1, MAX_QP_COUNT / num_ranks);
     // Individual regions (CQ, DBR) will be initialized as needed via async
     // memset.
     for (int i = 0; i < MAX_QP_COUNT; ++i) {
-        mlx5gda_qp* qp =
-            mlx5gda_create_rc_qp(mpd, ctrl_buf, ctrl_buf_umem, ctrl_buf_heap,
-                                 pd, 16384, 1, comm_stream.stream());
+        const int dst_rank = i / num_qp_per_rank;
+        const int nic_idx =
+            (rank + dst_rank + i % num_qp_per_rank) % (int)nics.size();
+        IbgdaNic& nic = nics[nic_idx];
+        mlx5gda_qp* qp = mlx5gda_create_rc_qp(
+            nic.mpd, ctrl_buf, nic.ctrl_buf_umem, ctrl_buf_heap, nic.pd, 16384,
+            1, comm_stream.stream());
         if (!qp) {
             perror("Failed to create QP");
+            mr = nullptr;
             return -1;
         }
         is_roce_ = qp->port_attr.link_layer == IBV_LINK_LAYER_ETHERNET;
         if (mlx5gda_modify_rc_qp_rst2init(qp, 0)) {
             perror("Failed to mlx5gda_modify_rc_qp_rst2init");
+            mr = nullptr;
             return -1;
         }
         // Ensure all async memset operations are complete before accessing QP
@@ -454,10 +544,36 @@ int MooncakeEpBuffer::init_ibgda() {
         cudaMemcpy(qp_devctxs + i * sizeof(mlx5gda_qp_devctx), &qp_devctx,
                    sizeof(mlx5gda_qp_devctx), cudaMemcpyHostToDevice);
         qps.push_back(qp);
+        qp_nics.push_back(nic_idx);
     }
+    LOG(INFO) << "[EP] GPU " << device_id << " stripes " << MAX_QP_COUNT
+              << " QPs over " << nics.size() << " NIC(s)";
     return 0;
 }
 
+void MooncakeEpBuffer::sync_keys(const std::vector<int64_t>& remote_addrs,
+                                 const std::vector<int32_t>& remote_keys) {
+    for (int i = 0; i < num_ranks; ++i) {
+        uint64_t raddr =
+            i == rank ? (uint64_t)mr->addr : (uint64_t)remote_addrs[i];
+        cudaMemcpy(raddrs + i * sizeof(uint64_t), &raddr, sizeof(uint64_t),
+                   cudaMemcpyHostToDevice);
+    }
+    // Every NIC registers `gdr_buffer` at the same address, but with keys of
+    // its own
+    const int num_qp_per_rank = std::max(1, MAX_QP_COUNT / num_ranks);
+    std::vector<uint32_t> keys(2 * MAX_QP_COUNT);
+    for (int i = 0; i < MAX_QP_COUNT; ++i) {
+        const ibv_mr* local_mr = nics[qp_nics[i]].mr;
+        keys[2 * i] = local_mr->lkey;
+        keys[2 * i + 1] = i / num_qp_per_rank == rank
+                              ? local_mr->lkey
+                              : (uint32_t)remote_keys[i];
+    }
+    cudaMemcpy(rkeys, keys.data(), keys.size() * sizeof(uint32_t),
+               cudaMemcpyHostToDevice);
+}
+
 void MooncakeEpBuffer::sync_ib(const std::vector<int64_t>& remote_addrs,
                                const std::vector<int32_t>& remote_keys,
                                const std::vector<int32_t>& remote_qpns,
@@ -477,15 +593,7 @@ void MooncakeEpBuffer::sync_ib(const std::vector<int64_t>& remote_addrs,
             exit(1);
         }
     }
-    for (int i = 0; i < num_ranks; ++i) {
-        uint64_t raddr =
-            i == rank ? (uint64_t)mr->addr : (uint64_t)remote_addrs[i];
-        cudaMemcpy(raddrs + i * sizeof(uint64_t), &raddr, sizeof(uint64_t),
-                   cudaMemcpyHostToDevice);
-        uint32_t rkey = i == rank ? mr->lkey : (uint32_t)remote_keys[i];
-        cudaMemcpy(rkeys + i * sizeof(uint32_t), &rkey, sizeof(uint32_t),
-                   cudaMemcpyHostToDevice);
-    }
+    sync_keys(remote_addrs, remote_keys);
 }
 
 void MooncakeEpBuffer::sync_roce(const std::vector<int64_t>& remote_addrs,
@@ -495,15 +603,12 @@ void MooncakeEpBuffer::sync_roce(const std::vector<int64_t>& remote_addrs,
                                  const std::vector<int64_t>& interface_ids) {
     for (int i = 0; i < MAX_QP_COUNT; ++i) {
         ibv_gid remote_gid{};
-        remote_gid.global.subnet_prefix =
-            subnet_prefixes[i * num_ranks / MAX_QP_COUNT];
-        remote_gid.global.interface_id =
-            interface_ids[i * num_ranks / MAX_QP_COUNT];
+        remote_gid.global.subnet_prefix = subnet_prefixes[i];
+        remote_gid.global.interface_id = interface_ids[i];
         ibv_ah_attr ah_attr = {};
         ah_attr.is_global = 1;
         ah_attr.grh.dgid = remote_gid;
-        ah_attr.grh.sgid_index =
-            gid_index_;  // Use dynamically discovered GID index
+        ah_attr.grh.sgid_index = nics[qp_nics[i]].gid_index;
         ah_attr.grh.hop_limit = 1;
         ah_attr.port_num = 1;
         ah_attr.dlid = qps[i]->port_attr.lid | 0xC000;
@@ -517,107 +622,125 @@ void MooncakeEpBuffer::sync_roce(const std::vector<int64_t>& remote_addrs,
             exit(1);
         }
     }
-    for (int i = 0; i < num_ranks; ++i) {
-        uint64_t raddr =
-            i == rank ? (uint64_t)mr->addr : (uint64_t)remote_addrs[i];
-        cudaMemcpy(raddrs + i * sizeof(uint64_t), &raddr, sizeof(uint64_t),
-                   cudaMemcpyHostToDevice);
-        uint32_t rkey = i == rank ? mr->lkey : (uint32_t)remote_keys[i];
-        cudaMemcpy(rkeys + i * sizeof(uint32_t), &rkey, sizeof(uint32_t),
-                   cudaMemcpyHostToDevice);
+    sync_keys(remote_addrs, remote_keys);
+}
+
+// Identifies the machine the process runs on. The boot id is shared by all
+// containers of a host, unlike the hostname.
+static uint64_t localHostId() {
+    std::string id;
+    std::ifstream boot_id("/proc/sys/kernel/random/boot_id");
+    if (!std::getline(boot_id, id) || id.empty()) {
+        char hostname[256] = {};
+        gethostname(hostname, sizeof(hostname) - 1);
+        id = hostname;
     }
+    return std::hash<std::string>{}(id);
 }
 
+// Layout of the ints exchanged by get_ipc_handle(): the IPC handle of the
+// buffer, then the host id and the PCI domain, bus and device of the GPU
+static constexpr size_t kNumIpcHandleInts =
+    (sizeof(cudaIpcMemHandle_t) + sizeof(int32_t) - 1) / sizeof(int32_t);
+static constexpr size_t kNumIpcInfoInts = kNumIpcHandleInts + 5;
+
 std::vector<int32_t> MooncakeEpBuffer::get_ipc_handle() {
     cudaIpcMemHandle_t handle;
     CUDA_CHECK(cudaIpcGetMemHandle(&handle, gdr_buffer));
     // Convert handle bytes to int32_t array
-    const size_t handle_size = sizeof(cudaIpcMemHandle_t);
-    const size_t num_int32s =
-        (handle_size + sizeof(int32_t) - 1) / sizeof(int32_t);
-    std::vector<int32_t> handle_ints(num_int32s);
-    memcpy(handle_ints.data(), &handle, handle_size);
+    std::vector<int32_t> handle_ints(kNumIpcInfoInts);
+    memcpy(handle_ints.data(), &handle, sizeof(cudaIpcMemHandle_t));
+    uint64_t host_id = localHostId();
+    handle_ints[kNumIpcHandleInts] = (int32_t)(host_id >> 32);
+    handle_ints[kNumIpcHandleInts + 1] = (int32_t)host_id;
+    CUDA_CHECK(cudaDeviceGetAttribute(&handle_ints[kNumIpcHandleInts + 2],
+                                      cudaDevAttrPciDomainId, device_id));
+    CUDA_CHECK(cudaDeviceGetAttribute(&handle_ints[kNumIpcHandleInts + 3],
+                                      cudaDevAttrPciBusId, device_id));
+    CUDA_CHECK(cudaDeviceGetAttribute(&handle_ints[kNumIpcHandleInts + 4],
+                                      cudaDevAttrPciDeviceId, device_id));
     return handle_ints;
 }
 
 void MooncakeEpBuffer::sync_nvlink_ipc_handles(
     const std::vector<std::vector<int32_t>>& remote_handles) {
-    // We assume ranks are grouped by device_count (same node)
-    int device_count = 0;
-    CUDA_CHECK(cudaGetDeviceCount(&device_count));
-
+    // The path is chosen per destination rank: the ranks on this host whose
+    // GPU is visible and peer-accessible get their buffer mapped and are
+    // written with NVLink stores, all others go through IBGDA
     std::vector<int32_t> nvlink_array(num_ranks, 0);
     nvlink_array[rank] = 1;
+    ipc_peer_ptrs_host[rank] = gdr_buffer;
+    uint64_t host_id = localHostId();
 
-    int node_id = rank / device_count;
-    int group_start = node_id * device_count;
-    int group_end = std::min(group_start + device_count, num_ranks);
-
-    // Check peer access and enable it within the same node group
-    for (int dst_rank = group_start; dst_rank < group_end; ++dst_rank) {
+    for (int dst_rank = 0; dst_rank < num_ranks; ++dst_rank) {
         if (dst_rank == rank) {
-            // Local rank - use local pointer
-            ipc_peer_ptrs_host[dst_rank] = gdr_buffer;
+            continue;
+        }
+        if (dst_rank >= static_cast<int>(remote_handles.size()) ||
+            remote_handles[dst_rank].size() < kNumIpcInfoInts) {
+            LOG(WARNING) << "[EP] Rank " << rank
+                         << " missing IPC handle for rank " << dst_rank;
+            continue;
+        }
+        const auto& handle_ints = remote_handles[dst_rank];
+        uint64_t dst_host_id =
+            ((uint64_t)(uint32_t)handle_ints[kNumIpcHandleInts] << 32) |
+            (uint32_t)handle_ints[kNumIpcHandleInts + 1];
+        if (dst_host_id != host_id) {
+            continue;
+        }
+
+        char pci_bus_id[32];
+        snprintf(pci_bus_id, sizeof(pci_bus_id), "%04x:%02x:%02x.0",
+                 handle_ints[kNumIpcHandleInts + 2],
+                 handle_ints[kNumIpcHandleInts + 3],
+                 handle_ints[kNumIpcHandleInts + 4]);
+        int dst_device = -1;
+        if (cudaDeviceGetByPCIBusId(&dst_device, pci_bus_id) != cudaSuccess) {
+            // The GPU of the peer is not visible to this process
+            cudaGetLastError();
             continue;
         }
 
-        int dst_device = dst_rank % device_count;
         int can_access_peer = 0;
         cudaError_t err =
             cudaDeviceCanAccessPeer(&can_access_peer, device_id, dst_device);
-        if (err == cudaSuccess && can_access_peer) {
-            cudaError_t peer_err = cudaDeviceEnablePeerAccess(dst_device, 0);
-            if (peer_err == cudaSuccess ||
-                peer_err == cudaErrorPeerAccessAlreadyEnabled) {
-                // Clear sticky error on re-init so CUDA graph capture /
-                // dispatch later does not see
-                // cudaErrorPeerAccessAlreadyEnabled.
-                if (peer_err == cudaErrorPeerAccessAlreadyEnabled) {
-                    cudaGetLastError();
-                }
-                nvlink_array[dst_rank] = 1;
-
-                // Open IPC handle for this peer
-                if (dst_rank >= static_cast<int>(remote_handles.size())) {
-                    LOG(WARNING) << "[EP] Rank " << rank
-                                 << " missing IPC handle for rank " << dst_rank;
-                    continue;
-                }
-
-                const size_t handle_size = sizeof(cudaIpcMemHandle_t);
-                const size_t num_int32s =
-                    (handle_size + sizeof(int32_t) - 1) / sizeof(int32_t);
-                const auto& handle_ints = remote_handles[dst_rank];
-                if (handle_ints.size() < num_int32s) {
-                    LOG(WARNING)
-                        << "[EP] Rank " << rank
-                        << " invalid IPC handle size for rank " << dst_rank;
-                    continue;
-                }
-
-                cudaIpcMemHandle_t remote_handle;
-                memcpy(&remote_handle, handle_ints.data(), handle_size);
-
-                void* peer_ptr = nullptr;
-                cudaError_t ipc_err = cudaIpcOpenMemHandle(
-                    &peer_ptr, remote_handle, cudaIpcMemLazyEnablePeerAccess);
-                if (ipc_err != cudaSuccess) {
-                    LOG(WARNING)
-                        << "[EP] Rank " << rank
-                        << " failed to open IPC handle for rank " << dst_rank
-                        << ": " << cudaGetErrorString(ipc_err);
-                    nvlink_array[dst_rank] = 0;
-                } else {
-                    ipc_peer_ptrs_host[dst_rank] = peer_ptr;
-                }
-            }
+        if (err != cudaSuccess || !can_access_peer) {
+            continue;
+        }
+        cudaError_t peer_err = cudaDeviceEnablePeerAccess(dst_device, 0);
+        if (peer_err != cudaSuccess &&
+            peer_err != cudaErrorPeerAccessAlreadyEnabled) {
+            continue;
+        }
+        // Clear sticky error on re-init so CUDA graph capture /
+        // dispatch later does not see
+        // cudaErrorPeerAccessAlreadyEnabled.
+        if (peer_err == cudaErrorPeerAccessAlreadyEnabled) {
+            cudaGetLastError();
+        }
+
+        cudaIpcMemHandle_t remote_handle;
+        memcpy(&remote_handle, handle_ints.data(), sizeof(remote_handle));
+
+        void* peer_ptr = nullptr;
+        cudaError_t ipc_err = cudaIpcOpenMemHandle(
+            &peer_ptr, remote_handle, cudaIpcMemLazyEnablePeerAccess);
+        if (ipc_err != cudaSuccess) {
+            LOG(WARNING) << "[EP] Rank " << rank
+                         << " failed to open IPC handle for rank " << dst_rank
+                         << ": " << cudaGetErrorString(ipc_err);
+            cudaGetLastError();
+            continue;
         }
+        ipc_peer_ptrs_host[dst_rank] = peer_ptr;
+        nvlink_array[dst_rank] = 1;
     }
 
     // Check if P2P+IPC is available for ALL rank pairs.
     // For P2P+IPC to be fully usable without IBGDA, every rank must be able to
-    // access every other rank via P2P+IPC. Since we only check within the same
-    // node group, all ranks must be in the same node group.
+    // access every other rank via P2P+IPC, which only holds when all ranks
+    // run on this host.
     p2p_ipc_all_enabled_ = true;
     for (int i = 0; i < num_ranks; ++i) {
         // Must have P2P enabled and a valid peer pointer for every rank.
@@ -627,15 +750,6 @@ void MooncakeEpBuffer::sync_nvlink_ipc_handles(
             break;
         }
     }
-    // Verify all ranks are in the same node group (cross-node requires IBGDA)
-    if (p2p_ipc_all_enabled_ && num_ranks > 1) {
-        int first_node_id = 0 / device_count;
-        int last_node_id = (num_ranks - 1) / device_count;
-        if (first_node_id != last_node_id) {
-            // Ranks span multiple nodes, P2P only works within nodes
-            p2p_ipc_all_enabled_ = false;
-        }
-    }
 
     // Copy NVLink availability to device memory
     CUDA_CHECK(cudaMemcpy(nvlink_available, nvlink_array.data(),
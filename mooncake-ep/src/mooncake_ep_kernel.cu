@@ -7,147 +7,63 @@
 #include <mooncake_ep_configs.cuh>
 #include <mooncake_ep_exception.cuh>
 #include <mooncake_ep_launch.cuh>
-#include <mooncake_ibgda/mlx5gda.h>
+#include <mooncake_ibgda/mlx5gda_device.cuh>
 #include <mooncake_ep_utils.cuh>
 
 namespace mooncake {
 
-static __device__ void device_mutex_lock_system(uint32_t *mutex) {
-    cuda::atomic_ref<uint32_t, cuda::thread_scope_system> lock(*mutex);
-    // Spin until the mutex is acquired
-    while (lock.exchange(1, cuda::memory_order_acquire) != 0);
-}
-
-static __device__ void device_mutex_unlock_system(uint32_t *mutex) {
-    cuda::atomic_ref<uint32_t, cuda::thread_scope_system> lock(*mutex);
-    // Release the mutex
-    lock.store(0, cuda::memory_order_release);
-}
-
-static __device__ uint16_t device_byteswap(uint16_t x) {
-    return __byte_perm(x, x, 0x2301);
-}
-
-static __device__ uint32_t device_byteswap(uint32_t x) {
-    return __byte_perm(x, x, 0x0123);
-}
-
-static __device__ uint64_t device_byteswap(uint64_t x) {
-    uint32_t hi = (uint32_t)(x >> 32);
-    uint32_t lo = (uint32_t)(x);
-
-    hi = __byte_perm(hi, hi, 0x0123);
-    lo = __byte_perm(lo, lo, 0x0123);
-
-    return ((uint64_t)lo << 32) | hi;
-}
-
-__device__ static inline uint16_t ptx_ld16_acq_sys_na(uint16_t *ptr) {
-    uint16_t val;
-    asm volatile("ld.acquire.sys.global.L1::no_allocate.b16 %0, [%1];" : "=h"(val) : "l"(ptr));
-    return val;
-}
-
-// must be called with mutex locked
-static __device__ void __mlx5gda_device_poll_cq(struct mlx5gda_qp_devctx *ctx, uint16_t expect) {
-    uint16_t wq_tail = ctx->wq_tail;
-    while ((int16_t)(wq_tail - expect) <= 0) {
-        uint16_t cq_wqe_counter_be = ptx_ld16_acq_sys_na(&ctx->cq->wqe_counter);
-        // printf("cq_wqe_counter_be=0x%x, expect=0x%x\n", cq_wqe_counter_be, expect);
-        uint8_t opcode = ctx->cq->op_own >> 4;
-        if (opcode == 0xD) {
-            printf("Requester_Error: syndrome = 0x%lx\n", ctx->cq->timestamp >> 56);
+// Shared receive region: waits until `dst_rank` consumed the data of the
+// `recv_epoch` operations before this one, which this one overwrites. The
+// counters wrap around, so only their difference is compared.
+__device__ __forceinline__ void wait_recv_free(const int* recv_free_signal_buffer, int dst_rank, int recv_epoch,
+                                               int32_t* active_ranks, int64_t timeout_ticks) {
+    if (recv_free_signal_buffer == nullptr)
+        return;
+    unsigned long long start_time = clock64();
+    while (static_cast<int>(static_cast<unsigned>(ld_acquire_sys_global(recv_free_signal_buffer + dst_rank)) -
+                            static_cast<unsigned>(recv_epoch)) < 0) {
+        unsigned long long end_time = clock64();
+        if (timeout_ticks != -1 && end_time - start_time > timeout_ticks) {
+            active_ranks[dst_rank] = 0;
+        }
+        if (!active_ranks[dst_rank]) {
+            break;
         }
-        EP_DEVICE_ASSERT(opcode == 0x0 || opcode == 0xF);
-        wq_tail = device_byteswap(cq_wqe_counter_be) + 1;
-    }
-    if (wq_tail != ctx->wq_tail) {
-        ctx->wq_tail = wq_tail;
     }
 }
 
-__device__ static inline void ptx_st32_rel_sys_na(uint32_t *ptr, uint32_t val) {
-    asm volatile("st.release.sys.global.L1::no_allocate.b32 [%0], %1;" : : "l"(ptr), "r"(val));
-}
-
-__device__ static inline void ptx_st64_rel_sys_na(uint64_t *ptr, uint64_t val) {
-    asm volatile("st.release.sys.global.L1::no_allocate.b64 [%0], %1;" : : "l"(ptr), "l"(val));
-}
-
-/**
- * Ring DB to post WQs up to last_posted_wqe.
- *
- * Must be called with mutex locked.
- */
-static __device__ void __mlx5gda_device_post_send_db(struct mlx5gda_qp_devctx *ctx) {
-    // 1. update dbr
-    uint32_t num_posted_wqe = (uint32_t)(ctx->wq_head);
-    ptx_st32_rel_sys_na(&ctx->dbr->send_counter, device_byteswap((uint32_t)ctx->wq_head));
-    // 2. ring db
-    struct mlx5gda_wqebb *last_wqe = ctx->wq + ((num_posted_wqe - 1) & ctx->wqeid_mask);
-    // printf("Last wqe=%lx -> bf=%p\n", *(uint64_t*)last_wqe, ctx->bf + ctx->bf_offset);
-    ptx_st64_rel_sys_na((uint64_t*)(ctx->bf + ctx->bf_offset), *(uint64_t*)last_wqe);
-    // 3. toggle bf
-    ctx->bf_offset ^= MLX5GDA_BF_SIZE;
-}
-
-static __device__ void __mlx5gda_device_write_rdma_write_wqe(
-    struct mlx5gda_qp_devctx *ctx, uint64_t laddr, __be32 lkey,
-    uint64_t raddr, __be32 rkey, uint32_t bytes) {
-    struct mlx5gda_rdma_write_wqe *wqe = (mlx5gda_rdma_write_wqe *)(ctx->wq + (ctx->wq_head & ctx->wqeid_mask));
-    struct mlx5_wqe_ctrl_seg &ctrl_seg = wqe->ctrl;
-    struct mlx5_wqe_raddr_seg &raddr_seg = wqe->raddr;
-    struct mlx5_wqe_data_seg &data_seg = wqe->data;
-
-    ctrl_seg = {};
-    ctrl_seg.qpn_ds = device_byteswap((ctx->qpn << 8) | 3);
-    ctrl_seg.fm_ce_se = MLX5_WQE_CTRL_CQ_UPDATE;
-    ctrl_seg.opmod_idx_opcode = device_byteswap(((uint32_t)ctx->wq_head << 8) | MLX5_OPCODE_RDMA_WRITE);
-
-    raddr_seg.raddr = device_byteswap(raddr);
-    raddr_seg.rkey = rkey;
-    raddr_seg.reserved = 0;
-
-    data_seg.byte_count = device_byteswap(bytes);
-    data_seg.lkey = lkey;
-    data_seg.addr = device_byteswap(laddr);
-
-    ++ctx->wq_head;
-}
-
-struct mlx5_wqe_atomic_add_32_seg {
-    __be32		add_data;
-    __be32		field_boundary;
-    __be64		compare;
-};
-
-static __device__ void __mlx5gda_device_write_rdma_atomic_add_wqe(
-    struct mlx5gda_qp_devctx *ctx, const int& value, uint64_t laddr,
-    __be32 lkey, uint64_t raddr, __be32 rkey) {
-    struct mlx5gda_rdma_atomic_wqe *wqe = (mlx5gda_rdma_atomic_wqe *)(ctx->wq + (ctx->wq_head & ctx->wqeid_mask));
-    struct mlx5_wqe_ctrl_seg &ctrl_seg = wqe->ctrl;
-    struct mlx5_wqe_raddr_seg &raddr_seg = wqe->raddr;
-    struct mlx5_wqe_data_seg &data_seg = wqe->data;
-
-    ctrl_seg = {};
-    ctrl_seg.qpn_ds = device_byteswap((ctx->qpn << 8) | 4);
-    ctrl_seg.fm_ce_se = MLX5_WQE_CTRL_CQ_UPDATE;
-    ctrl_seg.opmod_idx_opcode = device_byteswap(MLX5_OPCODE_ATOMIC_MASKED_FA | ((uint32_t)ctx->wq_head << 8) | 0x08000000);
-
-    raddr_seg.raddr = device_byteswap(raddr);
-    raddr_seg.rkey = rkey;
-    raddr_seg.reserved = 0;
-
-    auto atomic_add_32_seg = reinterpret_cast<mlx5_wqe_atomic_add_32_seg *>(&wqe->atomic);
-    atomic_add_32_seg->add_data = device_byteswap((uint32_t)value);
-    atomic_add_32_seg->field_boundary = 0;
-    atomic_add_32_seg->compare = 0;
-
-    data_seg.byte_count = device_byteswap((uint32_t)4);
-    data_seg.lkey = lkey;
-    data_seg.addr = device_byteswap(laddr);
-
-    ++ctx->wq_head;
+// Shared receive region: tells every peer that this rank consumed the data of
+// the current operation. Must be called by the whole grid once it has read it.
+__device__ __forceinline__ void signal_recv_free(void* mxa_buffer, int* recv_free_signal_buffer, int* send_free_signal_buffer,
+                                                 const uint64_t* raddr_array, const uint32_t* rkey_array,
+                                                 mlx5gda_qp_devctx* ctx_array, size_t num_qp_per_rank,
+                                                 const int32_t* nvlink_available, void* const* ipc_peer_ptrs,
+                                                 int rank, int num_ranks) {
+    if (recv_free_signal_buffer == nullptr)
+        return;
+    cooperative_groups::this_grid().sync();
+    if (blockIdx.x != 0)
+        return;
+    // Inactive peers are signalled too, the senders decide whom to wait for
+    for (int dst_rank = threadIdx.x; dst_rank < num_ranks; dst_rank += blockDim.x) {
+        if (dst_rank == rank)
+            continue;
+        const auto signal_ptr = recv_free_signal_buffer + rank;
+        const size_t offset = (char *)signal_ptr - (char *)(mxa_buffer);
+        if (nvlink_available[dst_rank] != 0) {
+            atomic_add_release_sys_global(reinterpret_cast<int*>((char *)ipc_peer_ptrs[dst_rank] + offset), 1);
+        } else {
+            const auto laddr = raddr_array[rank] + ((char *)(send_free_signal_buffer + dst_rank) - (char *)(mxa_buffer));
+            const auto qp_idx = dst_rank * num_qp_per_rank;
+            auto ctx = ctx_array + qp_idx;
+            const auto lkey = device_byteswap(rkey_array[2 * qp_idx]);
+            const auto rkey = device_byteswap(rkey_array[2 * qp_idx + 1]);
+            device_mutex_lock_system(&ctx->mutex);
+            __mlx5gda_device_write_rdma_atomic_add_wqe(ctx, 1, laddr, lkey, raddr_array[dst_rank] + offset, rkey);
+            __mlx5gda_device_post_send_db(ctx);
+            device_mutex_unlock_system(&ctx->mutex);
+        }
+    }
 }
 
 template <bool kUseFP8, int kNumWarpGroups, int kNumWarpsPerGroup, int kHidden>
@@ -164,10 +80,11 @@ dispatch(void* packed_recv_x, float* packed_recv_x_scales,
          const void* x, const int64_t* topk_idx,
          int* atomic_counter_per_expert, int* atomic_finish_counter_per_expert,
          int* next_clean_buffer,
+         int* recv_free_signal_buffer, int* send_free_signal_buffer, int recv_epoch,
          int num_tokens, int num_max_dispatch_tokens_per_rank,
          int num_topk, int num_experts, int rank, int num_ranks,
          int64_t timeout_ticks,
-         int phases) {
+         int phases, bool packed) {
     const auto sm_id = static_cast<int>(blockIdx.x);
     const auto thread_id = static_cast<int>(threadIdx.x);
     const auto warp_id = thread_id / 32, lane_id = get_lane_id();
@@ -194,10 +111,19 @@ dispatch(void* packed_recv_x, float* packed_recv_x_scales,
 
     // IBGDA
     auto raddr_array = reinterpret_cast<uint64_t*>(raddrs);
+    // Local and remote key of each QP, as QPs are striped over NICs
     auto rkey_array = reinterpret_cast<uint32_t*>(rkeys);
     auto ctx_array = reinterpret_cast<mlx5gda_qp_devctx*>(qp_devctxs);
     const size_t num_qp_per_rank = MAX_QP_COUNT / num_ranks;
 
+    // Packed mode: the messages of every remote expert reached through IBGDA
+    // are staged by slot at `rdma_send_data_buffer` and written at once after
+    // the last one, ahead of the count. FP8 tokens are cast behind the
+    // staging area, BF16 ones are copied from `x` directly.
+    const bool stage_token = kUseFP8 or not packed;
+    const auto rdma_x_msg_buffer = reinterpret_cast<uint8_t*>(rdma_send_data_buffer) +
+                                   (packed ? num_experts * num_max_dispatch_tokens_per_rank * num_bytes_per_msg : 0);
+
     // Sending phase
     if ((phases & LOW_LATENCY_SEND_PHASE) == 0)
         goto LOW_LATENCY_DISPATCH_RECV;
@@ -217,17 +143,17 @@ dispatch(void* packed_recv_x, float* packed_recv_x_scales,
 
         for (int token_idx = sm_id; token_idx < num_tokens; token_idx += num_sms) {
             const auto x_int4 = reinterpret_cast<const int4*>(x) + token_idx * hidden_bf16_int4;
-            const auto rdma_x_src_idx = reinterpret_cast<int*>(reinterpret_cast<uint8_t*>(rdma_send_data_buffer) + token_idx * num_bytes_per_msg);
+            const auto rdma_x_src_idx = reinterpret_cast<int*>(rdma_x_msg_buffer + token_idx * num_bytes_per_msg);
             const auto rdma_x_vec = reinterpret_cast<vec_t*>(reinterpret_cast<uint8_t*>(rdma_x_src_idx) + sizeof(int4));
             const auto rdma_x_scales = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(rdma_x_vec) + hidden_bytes);
 
             // Overlap top-k index read and source token index write
             auto dst_expert_idx = warp_id < num_topk ? static_cast<int>(__ldg(topk_idx + token_idx * num_topk + warp_id)) : -1;
-            thread_id == 0 ? (*rdma_x_src_idx = token_idx) : 0;
+            thread_id == 0 and stage_token ? (*rdma_x_src_idx = token_idx) : 0;
 
             // FP8 cast
             #pragma unroll
-            for (int i = thread_id; i < hidden_bf16_int4; i += num_threads) {
+            for (int i = thread_id; stage_token and i < hidden_bf16_int4; i += num_threads) {
                     // Read
                     auto int4_value = __ldg(x_int4 + i);
 
@@ -266,8 +192,18 @@ dispatch(void* packed_recv_x, float* packed_recv_x_scales,
 
             // Issue IBGDA sends
             if (dst_expert_idx >= 0) {
-                int slot_idx = lane_id == 0 ? atomicAdd(atomic_counter_per_expert + dst_expert_idx, 1) : 0;
-                slot_idx = __shfl_sync(0xffffffff, slot_idx, 0);
+                int slot_idx;
+                if (packed) {
+                    // Slots follow the routing order, so that the combine
+                    // finds them again from `topk_idx` alone
+                    int num_prior = 0;
+                    for (int i = lane_id; i < token_idx * num_topk + warp_id; i += 32)
+                        num_prior += static_cast<int>(__ldg(topk_idx + i)) == dst_expert_idx;
+                    slot_idx = warp_reduce_sum(num_prior);
+                } else {
+                    slot_idx = lane_id == 0 ? atomicAdd(atomic_counter_per_expert + dst_expert_idx, 1) : 0;
+                    slot_idx = __shfl_sync(0xffffffff, slot_idx, 0);
+                }
                 const auto dst_rank = dst_expert_idx / num_local_experts;
                 const auto dst_expert_local_idx = dst_expert_idx % num_local_experts;
                 const auto src_ptr = reinterpret_cast<uint64_t>(rdma_x_src_idx);
@@ -275,30 +211,45 @@ dispatch(void* packed_recv_x, float* packed_recv_x_scales,
                                      dst_expert_local_idx * num_ranks * num_max_dispatch_tokens_per_rank * num_bytes_per_msg +
                                      rank * num_max_dispatch_tokens_per_rank * num_bytes_per_msg +
                                      slot_idx * num_bytes_per_msg;
+                const auto copy_msg = [&](int4* dst_int4_ptr) {
+                    // NOTES: only 2 load iterations for 7K hidden with 8 unrolls
+                    if (stage_token) {
+                        const auto* src_int4_ptr = reinterpret_cast<const int4*>(src_ptr);
+                        UNROLLED_WARP_COPY(8, lane_id, num_int4_per_msg, dst_int4_ptr, src_int4_ptr, ld_nc_global, st_na_global);
+                    } else {
+                        if (lane_id == 0)
+                            st_na_global(dst_int4_ptr, make_int4(token_idx, 0, 0, 0));
+                        UNROLLED_WARP_COPY(8, lane_id, hidden_int4, dst_int4_ptr + 1, x_int4, ld_nc_global, st_na_global);
+                    }
+                };
                 if (dst_rank != rank) {
                     bool use_nvlink = nvlink_available[dst_rank] != 0;
+                    // Packed messages are only staged here, they are written at the count send
+                    if (lane_id == 0 and (use_nvlink or not packed))
+                        wait_recv_free(recv_free_signal_buffer, dst_rank, recv_epoch, active_ranks, timeout_ticks);
+                    __syncwarp();
                     if (use_nvlink) {
                         size_t offset = (char *)dst_ptr - (char *)(mxa_buffer);
                         void* peer_dst_ptr = (char *)ipc_peer_ptrs[dst_rank] + offset;
-                        // NOTES: only 2 load iterations for 7K hidden with 8 unrolls
-                        const auto* src_int4_ptr = reinterpret_cast<const int4*>(src_ptr);
-                        const auto* dst_int4_ptr = reinterpret_cast<int4*>(peer_dst_ptr);
-                        UNROLLED_WARP_COPY(8, lane_id, num_int4_per_msg, dst_int4_ptr, src_int4_ptr, ld_nc_global, st_na_global);
+                        copy_msg(reinterpret_cast<int4*>(peer_dst_ptr));
+                    } else if (packed) {
+                        copy_msg(reinterpret_cast<int4*>(reinterpret_cast<uint8_t*>(rdma_send_data_buffer) +
+                                                         (dst_expert_idx * num_max_dispatch_tokens_per_rank + slot_idx) * num_bytes_per_msg));
                     } else {
                         if (lane_id == 0) {
                             uint64_t req_rptr_actual = raddr_array[dst_rank] + ((char *)dst_ptr - (char *)(mxa_buffer));
-                            auto ctx = ctx_array + dst_rank * num_qp_per_rank + dst_expert_local_idx % num_qp_per_rank;
+                            const auto qp_idx = dst_rank * num_qp_per_rank + dst_expert_local_idx % num_qp_per_rank;
+                            auto ctx = ctx_array + qp_idx;
+                            const auto lkey = device_byteswap(rkey_array[2 * qp_idx]);
+                            const auto rkey = device_byteswap(rkey_array[2 * qp_idx + 1]);
                             device_mutex_lock_system(&ctx->mutex);
-                            __mlx5gda_device_write_rdma_write_wqe(ctx, src_ptr, device_byteswap(rkey_array[rank]), req_rptr_actual, device_byteswap(rkey_array[dst_rank]), num_bytes_per_msg);
+                            __mlx5gda_device_write_rdma_write_wqe(ctx, src_ptr, lkey, req_rptr_actual, rkey, num_bytes_per_msg);
                             __mlx5gda_device_post_send_db(ctx);
                             device_mutex_unlock_system(&ctx->mutex);
                         }
                     }
                 } else {
-                    // NOTES: only 2 load iterations for 7K hidden with 8 unrolls
-                    const auto* src_int4_ptr = reinterpret_cast<const int4*>(src_ptr);
-                    const auto* dst_int4_ptr = reinterpret_cast<int4*>(dst_ptr);
-                    UNROLLED_WARP_COPY(8, lane_id, num_int4_per_msg, dst_int4_ptr, src_int4_ptr, ld_nc_global, st_na_global);
+                    copy_msg(reinterpret_cast<int4*>(dst_ptr));
                 }
 
                 // Increase counter after finishing
@@ -355,6 +306,7 @@ dispatch(void* packed_recv_x, float* packed_recv_x_scales,
         // Wait local sends issued and send expert counts
         while (ld_acquire_global(atomic_finish_counter_per_expert + responsible_expert_idx) != FINISHED_SUM_TAG * 2);
         if (dst_rank != rank) {
+            wait_recv_free(recv_free_signal_buffer, dst_rank, recv_epoch, active_ranks, timeout_ticks);
             bool use_nvlink = nvlink_available[dst_rank] != 0;
             if (use_nvlink) {
                 int* signal_ptr = rdma_recv_signal_buffer + dst_expert_local_idx * num_ranks + rank;
@@ -364,9 +316,22 @@ dispatch(void* packed_recv_x, float* packed_recv_x_scales,
             } else {
                 uint64_t laddr = (uint64_t)((char *)(raddr_array[rank]) + ((char *)(rdma_send_signal_buffer + dst_expert_local_idx * num_ranks + rank) - (char *)(mxa_buffer)));
                 uint64_t rptr_actual = (uint64_t)((char *)(raddr_array[dst_rank]) + ((char *)(rdma_recv_signal_buffer + dst_expert_local_idx * num_ranks + rank) - (char *)(mxa_buffer)));
-                auto ctx = ctx_array + dst_rank * num_qp_per_rank + dst_expert_local_idx % num_qp_per_rank;
+                const auto qp_idx = dst_rank * num_qp_per_rank + dst_expert_local_idx % num_qp_per_rank;
+                auto ctx = ctx_array + qp_idx;
+                const auto lkey = device_byteswap(rkey_array[2 * qp_idx]);
+                const auto rkey = device_byteswap(rkey_array[2 * qp_idx + 1]);
                 device_mutex_lock_system(&ctx->mutex);
-                __mlx5gda_device_write_rdma_atomic_add_wqe(ctx, -num_tokens_sent - 1, laddr, device_byteswap(rkey_array[rank]), rptr_actual, device_byteswap(rkey_array[dst_rank]));
+                if (packed and num_tokens_sent > 0) {
+                    // The staged messages go first on the same QP, so the count lands after them
+                    const auto staged_ptr = reinterpret_cast<uint8_t*>(rdma_send_data_buffer) +
+                                            responsible_expert_idx * num_max_dispatch_tokens_per_rank * num_bytes_per_msg;
+                    const auto recv_ptr = reinterpret_cast<uint8_t*>(rdma_recv_data_buffer) +
+                                          (dst_expert_local_idx * num_ranks + rank) * num_max_dispatch_tokens_per_rank * num_bytes_per_msg;
+                    __mlx5gda_device_write_rdma_write_wqe(ctx, reinterpret_cast<uint64_t>(staged_ptr), lkey,
+                                                          raddr_array[dst_rank] + (recv_ptr - reinterpret_cast<uint8_t*>(mxa_buffer)),
+                                                          rkey, num_tokens_sent * num_bytes_per_msg);
+                }
+                __mlx5gda_device_write_rdma_atomic_add_wqe(ctx, -num_tokens_sent - 1, laddr, lkey, rptr_actual, rkey);
                 __mlx5gda_device_post_send_db(ctx);
                 device_mutex_unlock_system(&ctx->mutex);
             }
@@ -462,6 +427,9 @@ dispatch(void* packed_recv_x, float* packed_recv_x_scales,
             }
         }
     }
+
+    signal_recv_free(mxa_buffer, recv_free_signal_buffer, send_free_signal_buffer, raddr_array, rkey_array, ctx_array,
+                     num_qp_per_rank, nvlink_available, ipc_peer_ptrs, rank, num_ranks);
 }
 
 void dispatch(void* packed_recv_x, float* packed_recv_x_scales,
@@ -475,9 +443,11 @@ void dispatch(void* packed_recv_x, float* packed_recv_x_scales,
               const int32_t* nvlink_available, void* const* ipc_peer_ptrs,
               const void* x, const int64_t* topk_idx,
               int* next_clean_buffer,
+              int* recv_free_signal_buffer, int* send_free_signal_buffer, int recv_epoch,
               int num_tokens, int hidden, int num_max_dispatch_tokens_per_rank,
               int num_topk, int num_experts, int rank, int num_ranks, bool use_fp8,
-              void* workspace, cudaStream_t stream, int64_t timeout_ticks, int phases) {
+              void* workspace, cudaStream_t stream, int64_t timeout_ticks, int phases,
+              bool packed) {
     constexpr int kNumMaxTopK = 11;
     constexpr int kNumWarpsPerGroup = 4;
     constexpr int kNumWarpGroups = 8;
@@ -508,15 +478,65 @@ LAUNCH_KERNEL(&cfg, dispatch_func, \
               x, topk_idx, \
               atomic_counter_per_expert, atomic_finish_counter_per_expert, \
               next_clean_buffer, \
+              recv_free_signal_buffer, send_free_signal_buffer, recv_epoch, \
               num_tokens, num_max_dispatch_tokens_per_rank, \
-              num_topk, num_experts, rank, num_ranks, timeout_ticks, phases); } break
+              num_topk, num_experts, rank, num_ranks, timeout_ticks, phases, packed); } break
 
     SETUP_LAUNCH_CONFIG(num_sms, num_warps * 32, stream);
     SWITCH_HIDDEN(DISPATCH_LAUNCH_CASE);
 #undef DISPATCH_LAUNCH_CASE
 }
 
-template <int kNumWarpGroups, int kNumWarpsPerGroup, int kHidden, int kNumMaxTopk>
+// Cast a BF16 row into FP8 with one scale per 128 channels, stored behind the
+// FP8 values. `dst` may alias `src`: every iteration writes below what the
+// next one reads, and the scales are only stored once the row was read.
+template <int kHidden>
+__device__ __forceinline__ void warp_cast_row_to_fp8(uint8_t* dst, const int4* src, int lane_id) {
+    constexpr int kNumElemsPerRead = sizeof(int4) / sizeof(nv_bfloat16);
+    constexpr int kNumIters = kHidden / (32 * kNumElemsPerRead);
+    constexpr float kFP8Margin = 1e-4, kFP8Amax = 448, kFP8AmaxInv = 1.0f / 448.0f;
+    EP_STATIC_ASSERT(kHidden % (32 * kNumElemsPerRead) == 0, "Invalid vectorization");
+    EP_STATIC_ASSERT(kNumElemsPerRead * 32 / 128 == 2, "Invalid vectorization");
+
+    float scales_inv[kNumIters];
+    #pragma unroll
+    for (int k = 0; k < kNumIters; ++ k) {
+        const int i = k * 32 + lane_id;
+        auto int4_value = src[i];
+        auto bf16_values = reinterpret_cast<nv_bfloat16*>(&int4_value);
+        float fp32_values[kNumElemsPerRead];
+        float amax = kFP8Margin;
+        #pragma unroll
+        for (int j = 0; j < kNumElemsPerRead; ++ j) {
+            fp32_values[j] = __bfloat162float(bf16_values[j]);
+            amax = fmaxf(amax, fabsf(fp32_values[j]));
+        }
+        amax = half_warp_reduce_max(amax);
+        const float scale = kFP8Amax / amax;
+        scales_inv[k] = amax * kFP8AmaxInv;
+
+        int2 int2_value;
+        auto fp8x2_values = reinterpret_cast<__nv_fp8x2_storage_t*>(&int2_value);
+        #pragma unroll
+        for (int j = 0; j < kNumElemsPerRead; j += 2) {
+            float2 fp32x2 = {fp32_values[j] * scale, fp32_values[j + 1] * scale};
+            fp8x2_values[j / 2] = __nv_cvt_float2_to_fp8x2(fp32x2, __NV_SATFINITE, __NV_E4M3);
+        }
+        __syncwarp();
+        reinterpret_cast<int2*>(dst)[i] = int2_value;
+    }
+
+    // Lanes 0 and 16 hold the scales of the two channel blocks of every iteration
+    const auto dst_scales = reinterpret_cast<float*>(dst + kHidden);
+    if (lane_id == 0 or lane_id == 16) {
+        #pragma unroll
+        for (int k = 0; k < kNumIters; ++ k)
+            dst_scales[k * 2 + lane_id / 16] = scales_inv[k];
+    }
+    __syncwarp();
+}
+
+template <bool kUseFP8, int kNumWarpGroups, int kNumWarpsPerGroup, int kHidden, int kNumMaxTopk>
 __global__ __launch_bounds__(kNumWarpGroups * kNumWarpsPerGroup * 32, 1) void
 combine(void* combined_x, int32_t* active_ranks,
         void* mxa_buffer,
@@ -529,11 +549,12 @@ combine(void* combined_x, int32_t* active_ranks,
         const int* src_info, const int64_t* layout_range,
         int* next_clean_buffer,
         int* atomic_clean_flag,
+        int* recv_free_signal_buffer, int* send_free_signal_buffer, int recv_epoch,
         int num_combined_tokens, int hidden, int num_topk,
         int num_max_dispatch_tokens_per_rank,
         int num_experts, int rank, int num_ranks,
         int64_t timeout_ticks,
-        int phases, bool zero_copy) {
+        int phases, bool zero_copy, bool packed) {
     const auto sm_id = static_cast<int>(blockIdx.x);
     const auto num_sms = static_cast<int>(gridDim.x);
     const auto thread_id = static_cast<int>(threadIdx.x);
@@ -548,12 +569,19 @@ combine(void* combined_x, int32_t* active_ranks,
     constexpr int kNumElemsPerInt4 = sizeof(int4) / sizeof(nv_bfloat16);
     const size_t hidden_bf16_int4 = kHidden / kNumElemsPerInt4;
 
-    // Message package
+    // Message package: slots keep the BF16 size, FP8 messages only send the
+    // values and their scales
     constexpr size_t num_bytes_per_slot = kHidden * sizeof(nv_bfloat16);
+    constexpr size_t num_bytes_per_msg = kUseFP8 ? kHidden + kHidden / 128 * sizeof(float) : num_bytes_per_slot;
     EP_STATIC_ASSERT(num_bytes_per_slot % sizeof(int4) == 0, "Invalid vectorization");
 
+    // Packed BF16 rows leave as one write per expert, FP8 ones are sent one
+    // by one since their slots are not filled
+    const bool post_per_token = kUseFP8 or not packed;
+
     // IBGDA
     auto raddr_array = reinterpret_cast<uint64_t*>(raddrs);
+    // Local and remote key of each QP, as QPs are striped over NICs
     auto rkey_array = reinterpret_cast<uint32_t*>(rkeys);
     auto ctx_array = reinterpret_cast<mlx5gda_qp_devctx*>(qp_devctxs);
     const size_t num_qp_per_rank = MAX_QP_COUNT / num_ranks;
@@ -590,6 +618,13 @@ combine(void* combined_x, int32_t* active_ranks,
         int offset, num_tokens_to_send;
         unpack2(layout, num_tokens_to_send, offset);
 
+        // Every sub-warp writes into the receive region of `dst_rank`
+        if (dst_rank != rank) {
+            if (lane_id == 0)
+                wait_recv_free(recv_free_signal_buffer, dst_rank, recv_epoch, active_ranks, timeout_ticks);
+            __syncwarp();
+        }
+
         // Issue IBGDA send
         for (int token_idx = offset + sub_warp_id; token_idx < offset + num_tokens_to_send; token_idx += kNumWarpsPerGroup) {
             const auto x_int4 = local_x + token_idx * hidden_bf16_int4;
@@ -597,30 +632,42 @@ combine(void* combined_x, int32_t* active_ranks,
             const auto rdma_send_x_vec_row = reinterpret_cast<uint8_t*>(rdma_send_type_row);
 
             // Copy directly to local rank, or copy to buffer and issue RDMA
-            auto src_idx = __ldg(local_src_info + token_idx);
+            // NOTES: packed tokens go back to their dispatch slots
+            auto src_idx = packed ? token_idx - offset : __ldg(local_src_info + token_idx);
             const auto buf_ptr = reinterpret_cast<int64_t>(rdma_send_x_vec_row);
             const auto dst_ptr = reinterpret_cast<uint64_t>(rdma_recv_data_buffer) + (global_expert_idx * num_max_dispatch_tokens_per_rank + src_idx) * num_bytes_per_slot;
+            const auto copy_row = [&](void* dst, const int4* src) {
+                if (kUseFP8) {
+                    warp_cast_row_to_fp8<kHidden>(reinterpret_cast<uint8_t*>(dst), src, lane_id);
+                } else {
+                    const auto dst_int4_ptr = reinterpret_cast<int4*>(dst);
+                    UNROLLED_WARP_COPY(7, lane_id, hidden_bf16_int4, dst_int4_ptr, src, ld_nc_global, st_na_global);
+                }
+            };
             if (dst_rank == rank) {
-                const auto dst_int4_ptr = reinterpret_cast<int4*>(dst_ptr);
-                UNROLLED_WARP_COPY(7, lane_id, hidden_bf16_int4, dst_int4_ptr, x_int4, ld_nc_global, st_na_global);
+                copy_row(reinterpret_cast<void*>(dst_ptr), x_int4);
             } else {
                 bool use_nvlink = nvlink_available[dst_rank] != 0;
                 if (use_nvlink) {
                     size_t offset = (char *)dst_ptr - (char *)(mxa_buffer);
                     void* peer_dst_ptr = (char *)ipc_peer_ptrs[dst_rank] + offset;
-                    const auto dst_int4_ptr = reinterpret_cast<int4*>(peer_dst_ptr);
-                    UNROLLED_WARP_COPY(7, lane_id, hidden_bf16_int4, dst_int4_ptr, x_int4, ld_nc_global, st_na_global);
+                    copy_row(peer_dst_ptr, x_int4);
                 } else {
                     const auto buf_int4_ptr = reinterpret_cast<int4*>(buf_ptr);
-                    if (not zero_copy)
-                        UNROLLED_WARP_COPY(7, lane_id, hidden_bf16_int4, buf_int4_ptr, x_int4, ld_nc_global, st_na_global);
+                    if (kUseFP8)
+                        copy_row(buf_int4_ptr, zero_copy ? buf_int4_ptr : x_int4);
+                    else if (not zero_copy)
+                        copy_row(buf_int4_ptr, x_int4);
                     __syncwarp();
 
-                    if (lane_id == 0) {
+                    if (lane_id == 0 and post_per_token) {
                         uint64_t req_rptr_actual = raddr_array[dst_rank] + ((char *)dst_ptr - (char *)(mxa_buffer));
-                        auto ctx = ctx_array + dst_rank * num_qp_per_rank + local_expert_idx % num_qp_per_rank;
+                        const auto qp_idx = dst_rank * num_qp_per_rank + local_expert_idx % num_qp_per_rank;
+                        auto ctx = ctx_array + qp_idx;
+                        const auto lkey = device_byteswap(rkey_array[2 * qp_idx]);
+                        const auto rkey = device_byteswap(rkey_array[2 * qp_idx + 1]);
                         device_mutex_lock_system(&ctx->mutex);
-                        __mlx5gda_device_write_rdma_write_wqe(ctx, (uint64_t) buf_ptr, device_byteswap(rkey_array[rank]), req_rptr_actual, device_byteswap(rkey_array[dst_rank]), num_bytes_per_slot);
+                        __mlx5gda_device_write_rdma_write_wqe(ctx, (uint64_t) buf_ptr, lkey, req_rptr_actual, rkey, num_bytes_per_msg);
                         __mlx5gda_device_post_send_db(ctx);
                         device_mutex_unlock_system(&ctx->mutex);
                     }
@@ -643,9 +690,20 @@ combine(void* combined_x, int32_t* active_ranks,
                 } else {
                     uint64_t laddr = (uint64_t)((char *)(raddr_array[rank]) + ((char *)(rdma_send_signal_buffer + global_expert_idx) - (char *)(mxa_buffer)));
                     uint64_t req_rptr_actual = (uint64_t)((char *)(raddr_array[dst_rank]) + ((char *)(rdma_recv_signal_buffer + global_expert_idx) - (char *)(mxa_buffer)));
-                    auto ctx = ctx_array + dst_rank * num_qp_per_rank + local_expert_idx % num_qp_per_rank;
+                    const auto qp_idx = dst_rank * num_qp_per_rank + local_expert_idx % num_qp_per_rank;
+                    auto ctx = ctx_array + qp_idx;
+                    const auto lkey = device_byteswap(rkey_array[2 * qp_idx]);
+                    const auto rkey = device_byteswap(rkey_array[2 * qp_idx + 1]);
                     device_mutex_lock_system(&ctx->mutex);
-                    __mlx5gda_device_write_rdma_atomic_add_wqe(ctx, 1, laddr, device_byteswap(rkey_array[rank]), req_rptr_actual, device_byteswap(rkey_array[dst_rank]));
+                    if (not post_per_token and num_tokens_to_send > 0) {
+                        const auto buf_ptr = rdma_send_x_vec + offset * num_bytes_per_slot;
+                        const auto dst_ptr = reinterpret_cast<uint8_t*>(rdma_recv_data_buffer) +
+                                             global_expert_idx * num_max_dispatch_tokens_per_rank * num_bytes_per_slot;
+                        __mlx5gda_device_write_rdma_write_wqe(ctx, reinterpret_cast<uint64_t>(buf_ptr), lkey,
+                                                              raddr_array[dst_rank] + (dst_ptr - reinterpret_cast<uint8_t*>(mxa_buffer)),
+                                                              rkey, num_tokens_to_send * num_bytes_per_slot);
+                    }
+                    __mlx5gda_device_write_rdma_atomic_add_wqe(ctx, 1, laddr, lkey, req_rptr_actual, rkey);
                     __mlx5gda_device_post_send_db(ctx);
                     device_mutex_unlock_system(&ctx->mutex);
                 }
@@ -681,6 +739,25 @@ combine(void* combined_x, int32_t* active_ranks,
     }
     cooperative_groups::this_grid().sync();
 
+    // Find the dispatch slots of packed tokens, counting the earlier
+    // selections of the same expert
+    __shared__ int shared_packed_slots[NUM_MAX_PACKED_DISPATCH_TOKENS * kNumMaxTopk];
+    if (packed) {
+        const auto num_sm_tokens = num_combined_tokens > sm_id ? cell_div(num_combined_tokens - sm_id, num_sms) : 0;
+        EP_DEVICE_ASSERT(num_combined_tokens <= NUM_MAX_PACKED_DISPATCH_TOKENS);
+        for (int i = warp_id; i < num_sm_tokens * num_topk; i += num_threads / 32) {
+            const auto flat_idx = (sm_id + (i / num_topk) * num_sms) * num_topk + i % num_topk;
+            const auto expert_idx = static_cast<int>(__ldg(topk_idx + flat_idx));
+            int num_prior = 0;
+            for (int j = lane_id; expert_idx >= 0 and j < flat_idx; j += 32)
+                num_prior += static_cast<int>(__ldg(topk_idx + j)) == expert_idx;
+            num_prior = warp_reduce_sum(num_prior);
+            if (lane_id == 0)
+                shared_packed_slots[i] = num_prior;
+        }
+        __syncthreads();
+    }
+
     // Reduce tokens with FP8 cast
     EP_DEVICE_ASSERT(num_topk <= 32 and hidden_bf16_int4 <= num_threads);
     EP_STATIC_ASSERT(kHidden % (32 * kNumElemsPerInt4) == 0, "Invalid vectorization");
@@ -699,15 +776,29 @@ combine(void* combined_x, int32_t* active_ranks,
             #pragma unroll
             for (int i = 0; i < num_topk; ++ i) if (reg_topk_idx[i] >= 0) {
                 // Read from sources
-                auto rdma_buffer_type = reinterpret_cast<const int*>(reinterpret_cast<uint8_t*>(rdma_recv_data_buffer) + (reg_topk_idx[i] * num_max_dispatch_tokens_per_rank + token_idx) * num_bytes_per_slot);
+                const auto slot_idx = packed ? shared_packed_slots[(token_idx - sm_id) / num_sms * num_topk + i] : token_idx;
+                auto rdma_buffer_type = reinterpret_cast<const int*>(reinterpret_cast<uint8_t*>(rdma_recv_data_buffer) + (reg_topk_idx[i] * num_max_dispatch_tokens_per_rank + slot_idx) * num_bytes_per_slot);
                 auto rdma_buffer_row = reinterpret_cast<const uint8_t*>(rdma_buffer_type);
 
                 // Reduce
-                auto x_vec = ld_nc_global(reinterpret_cast<const int4*>(rdma_buffer_row) + thread_id);
-                const auto x_bf16 = reinterpret_cast<nv_bfloat16*>(&x_vec);
-                #pragma unroll
-                for (int j = 0; j < kNumElemsPerInt4; ++ j)
-                    combined_values[j] += __bfloat162float(x_bf16[j]) * reg_topk_weights[i];
+                if (kUseFP8) {
+                    auto x_vec = ld_nc_global(reinterpret_cast<const int2*>(rdma_buffer_row) + thread_id);
+                    const auto x_fp8x2 = reinterpret_cast<__nv_fp8x2_storage_t*>(&x_vec);
+                    const auto scale = ld_nc_global(reinterpret_cast<const float*>(rdma_buffer_row + kHidden) + thread_id * kNumElemsPerInt4 / 128);
+                    const auto weight = scale * reg_topk_weights[i];
+                    #pragma unroll
+                    for (int j = 0; j < kNumElemsPerInt4; j += 2) {
+                        const auto fp32x2 = __half22float2(__half2(__nv_cvt_fp8x2_to_halfraw2(x_fp8x2[j / 2], __NV_E4M3)));
+                        combined_values[j] += fp32x2.x * weight;
+                        combined_values[j + 1] += fp32x2.y * weight;
+                    }
+                } else {
+                    auto x_vec = ld_nc_global(reinterpret_cast<const int4*>(rdma_buffer_row) + thread_id);
+                    const auto x_bf16 = reinterpret_cast<nv_bfloat16*>(&x_vec);
+                    #pragma unroll
+                    for (int j = 0; j < kNumElemsPerInt4; ++ j)
+                        combined_values[j] += __bfloat162float(x_bf16[j]) * reg_topk_weights[i];
+                }
             }
 
             // Write results
@@ -719,6 +810,9 @@ combine(void* combined_x, int32_t* active_ranks,
             (reinterpret_cast<int4*>(combined_x) + token_idx * hidden_bf16_int4)[thread_id] = combined_int4;
         }
     }
+
+    signal_recv_free(mxa_buffer, recv_free_signal_buffer, send_free_signal_buffer, raddr_array, rkey_array, ctx_array,
+                     num_qp_per_rank, nvlink_available, ipc_peer_ptrs, rank, num_ranks);
 }
 
 void combine(void* combined_x, int32_t* active_ranks,
@@ -731,10 +825,11 @@ void combine(void* combined_x, int32_t* active_ranks,
              const void* x, const int64_t* topk_idx, const float* topk_weights,
              const int* src_info, const int64_t* layout_range,
              int* next_clean_buffer,
+             int* recv_free_signal_buffer, int* send_free_signal_buffer, int recv_epoch,
              int num_combined_tokens, int hidden, int num_max_dispatch_tokens_per_rank,
-             int num_topk, int num_experts, int rank, int num_ranks,
+             int num_topk, int num_experts, int rank, int num_ranks, bool use_fp8,
              void* workspace, cudaStream_t stream,
-             int64_t timeout_ticks, int phases, bool zero_copy) {
+             int64_t timeout_ticks, int phases, bool zero_copy, bool packed) {
     constexpr int kNumWarpsPerGroup = 4;
     constexpr int kNumWarpGroups = 8;
     constexpr int kNumMaxTopk = 11;
@@ -748,7 +843,8 @@ void combine(void* combined_x, int32_t* active_ranks,
     EP_HOST_ASSERT(num_topk <= kNumMaxTopk);
 
 #define COMBINE_LAUNCH_CASE(hidden) { \
-auto combine_func = combine<kNumWarpGroups, kNumWarpsPerGroup, hidden, kNumMaxTopk>; \
+auto combine_func = use_fp8 ? combine<true, kNumWarpGroups, kNumWarpsPerGroup, hidden, kNumMaxTopk> : \
+                             combine<false, kNumWarpGroups, kNumWarpsPerGroup, hidden, kNumMaxTopk>; \
 LAUNCH_KERNEL(&cfg, combine_func, \
               combined_x, active_ranks, \
               mxa_buffer, \
@@ -760,10 +856,11 @@ LAUNCH_KERNEL(&cfg, combine_func, \
               x, topk_idx, topk_weights, src_info, layout_range, \
               next_clean_buffer, \
               atomic_clean_flag, \
+              recv_free_signal_buffer, send_free_signal_buffer, recv_epoch, \
               num_combined_tokens, hidden, num_topk, \
               num_max_dispatch_tokens_per_rank, \
               num_experts, rank, num_ranks, \
-              timeout_ticks, phases, zero_copy); } break
+              timeout_ticks, phases, zero_copy, packed); } break
 
     SETUP_LAUNCH_CONFIG(num_sms, num_warps * 32, stream);
     SWITCH_HIDDEN(COMBINE_LAUNCH_CASE);
@@ -21,7 +21,7 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
     m.attr("MAX_QP_COUNT") = pybind11::int_(MAX_QP_COUNT);
 
     py::class_<MooncakeEpBuffer>(m, "Buffer")
-        .def(py::init<int, int, int64_t, std::string>())
+        .def(py::init<int, int, int64_t, std::string, bool>())
         .def("ibgda_disabled", &MooncakeEpBuffer::ibgda_disabled)
         .def("use_fast_path", &MooncakeEpBuffer::use_fast_path)
         .def("is_roce", &MooncakeEpBuffer::is_roce)
@@ -31,6 +31,9 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
         .def("get_gid", &MooncakeEpBuffer::get_gid)
         .def("get_local_qpns", &MooncakeEpBuffer::get_local_qpns)
         .def("get_local_lids", &MooncakeEpBuffer::get_local_lids)
+        .def("get_local_rkeys", &MooncakeEpBuffer::get_local_rkeys)
+        .def("get_local_gids", &MooncakeEpBuffer::get_local_gids)
+        .def("num_nics", &MooncakeEpBuffer::num_nics)
         .def("get_ipc_handle", &MooncakeEpBuffer::get_ipc_handle)
         .def("sync_nvlink_ipc_handles",
              &MooncakeEpBuffer::sync_nvlink_ipc_handles)
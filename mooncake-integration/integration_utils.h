@@ -34,21 +34,17 @@ enum class TensorDtype : int32_t {
     UNKNOWN = -1
 };
 
+// Wrap total_length bytes at exported_data + offset without copying them.
+// The array keeps `base` alive as long as it refers to the memory.
 template <typename T>
 py::array create_typed_array(char *exported_data, size_t offset,
-                             size_t total_length, bool take_ownership) {
-    if (take_ownership) {
-        py::capsule free_when_done(
-            exported_data, [](void *p) { delete[] static_cast<char *>(p); });
-        return py::array_t<T>({static_cast<ssize_t>(total_length / sizeof(T))},
-                              (T *)(exported_data + offset), free_when_done);
-    }
-
+                             size_t total_length, py::object base) {
     return py::array_t<T>({static_cast<ssize_t>(total_length / sizeof(T))},
-                          (T *)(exported_data + offset), py::none());
+                          (T *)(exported_data + offset), base);
 }
 
-using ArrayCreatorFunc = std::function<py::array(char *, size_t, size_t, bool)>;
+using ArrayCreatorFunc =
+    std::function<py::array(char *, size_t, size_t, py::object)>;
 
 static const std::array<ArrayCreatorFunc, 15> array_creators = {{
     create_typed_array<float>,     // FLOAT32 = 0
@@ -68,6 +64,13 @@ static const std::array<ArrayCreatorFunc, 15> array_creators = {{
     create_typed_array<uint8_t>,  // FLOAT8_E5M2 = 14 (using uint8_t as storage)
 }};
 
+// Bytes per element of a dtype below NR_DTYPES
+inline size_t get_element_size(TensorDtype dtype) {
+    static constexpr std::array<size_t, 15> kElementSizes = {
+        4, 8, 1, 1, 2, 2, 4, 4, 8, 8, 1, 2, 2, 1, 1};
+    return kElementSizes[static_cast<int32_t>(dtype)];
+}
+
 inline TensorDtype get_tensor_dtype(py::object dtype_obj) {
     if (dtype_obj.is_none()) {
         return TensorDtype::UNKNOWN;
@@ -3,6 +3,16 @@ import functools
 from mooncake.store import MooncakeDistributedStore
 
 class MooncakeDistributedStoreAsync(MooncakeDistributedStore):
+    # Methods the client runs itself and reports through its completion
+    # eventfd, with whether they return a single value or one per key. The
+    # others run the blocking call in the default executor.
+    _NATIVE_ASYNC_METHODS = {
+        "get_into": ("submit_get_into", True),
+        "batch_get_into": ("submit_batch_get_into", False),
+        "put_from": ("submit_put_from", True),
+        "batch_put_from": ("submit_batch_put_from", False),
+    }
+
     def __getattr__(self, name: str):
         if not name.startswith("async_"):
             raise AttributeError(f"'{type(self).__name__}' object has no attribute '{name}'")
@@ -17,7 +27,11 @@ class MooncakeDistributedStoreAsync(MooncakeDistributedStore):
         if not callable(sync_method):
             raise AttributeError(f"'{sync_method_name}' is not callable")
 
-        async_method = self._make_async_wrapper(sync_method)
+        native = self._NATIVE_ASYNC_METHODS.get(sync_method_name)
+        if native is not None:
+            async_method = self._make_native_async_wrapper(sync_method, *native)
+        else:
+            async_method = self._make_async_wrapper(sync_method)
         setattr(self, name, async_method)
         return async_method
 
@@ -29,4 +43,47 @@ class MooncakeDistributedStoreAsync(MooncakeDistributedStore):
             func = functools.partial(sync_method, *args, **kwargs)
             return await loop.run_in_executor(None, func)
 
-        return wrapper
\ No newline at end of file
+        return wrapper
+
+    def _make_native_async_wrapper(self, sync_method, submit_name, single):
+        submit = getattr(self, submit_name)
+
+        @functools.wraps(sync_method)
+        async def wrapper(*args, **kwargs):
+            loop = asyncio.get_running_loop()
+            if not self._attach_loop(loop):
+                # The eventfd is watched by another running loop
+                func = functools.partial(sync_method, *args, **kwargs)
+                return await loop.run_in_executor(None, func)
+
+            request_id = submit(*args, **kwargs)
+            if request_id == 0:
+                raise RuntimeError(f"failed to submit {sync_method.__name__}")
+            # Completions are only drained on this loop, so the future is
+            # registered before its result can be seen. Cancelling it does
+            # not stop the transfer into or out of the caller's buffers.
+            future = loop.create_future()
+            self._async_pending[request_id] = (future, single)
+            return await future
+
+        return wrapper
+
+    def _attach_loop(self, loop):
+        current = getattr(self, "_async_loop", None)
+        if current is loop:
+            return True
+        if current is not None and not current.is_closed():
+            return False
+        loop.add_reader(self.async_completion_fd(), self._drain_completions)
+        self._async_loop = loop
+        self._async_pending = {}
+        return True
+
+    def _drain_completions(self):
+        for request_id, results in self.poll_async_completions():
+            entry = self._async_pending.pop(request_id, None)
+            if entry is None:
+                continue
+            future, single = entry
+            if not future.done():
+                future.set_result(results[0] if single else list(results))
@@ -119,27 +119,29 @@ PyTensorInfo extract_tensor_info(const py::object &tensor,
     return info;
 }
 
-pybind11::object buffer_to_tensor(BufferHandle *buffer_handle, char *usr_buffer,
-                                  int64_t data_length) {
+// Builds the tensor over the payload in place. For a buffer handle, the
+// tensor owns a reference to it, so the client buffer is released back to the
+// allocator only once the tensor is freed.
+pybind11::object buffer_to_tensor(
+    const std::shared_ptr<BufferHandle> &buffer_handle, char *usr_buffer,
+    int64_t data_length) {
     if (!buffer_handle && !usr_buffer) return pybind11::none();
     if (buffer_handle && usr_buffer) return pybind11::none();
 
-    bool take_ownership = !!buffer_handle;
     size_t total_length;
     char *exported_data;
-    if (take_ownership) {
+    py::object base = py::none();
+    if (buffer_handle) {
         total_length = buffer_handle->size();
         if (total_length <= sizeof(TensorMetadata)) {
             LOG(ERROR) << "Invalid data format: insufficient data for metadata";
             return pybind11::none();
         }
-
-        // Allocate memory to copy data out (array_creators usually take
-        // ownership or we need a clean buffer)
-        exported_data = new char[total_length];
-        if (!exported_data) return pybind11::none();
-
-        memcpy(exported_data, buffer_handle->ptr(), total_length);
+        exported_data = static_cast<char *>(buffer_handle->ptr());
+        base = py::capsule(
+            new std::shared_ptr<BufferHandle>(buffer_handle), [](void *p) {
+                delete static_cast<std::shared_ptr<BufferHandle> *>(p);
+            });
     } else {
         exported_data = usr_buffer;
         if (data_length < 0) {
@@ -157,9 +159,6 @@ pybind11::object buffer_to_tensor(BufferHandle *buffer_handle, char *usr_buffer,
     memcpy(&metadata, exported_data, sizeof(TensorMetadata));
 
     if (metadata.ndim < 0 || metadata.ndim > 4) {
-        if (take_ownership) {
-            delete[] exported_data;
-        }
         LOG(ERROR) << "Invalid tensor metadata: ndim=" << metadata.ndim;
         return pybind11::none();
     }
@@ -168,9 +167,6 @@ pybind11::object buffer_to_tensor(BufferHandle *buffer_handle, char *usr_buffer,
     size_t tensor_size = total_length - sizeof(TensorMetadata);
 
     if (tensor_size == 0 || dtype_enum == TensorDtype::UNKNOWN) {
-        if (take_ownership) {
-            delete[] exported_data;
-        }
         LOG(ERROR) << "Invalid tensor data or unknown dtype";
         return pybind11::none();
     }
@@ -178,18 +174,14 @@ pybind11::object buffer_to_tensor(BufferHandle *buffer_handle, char *usr_buffer,
     int dtype_index = static_cast<int>(dtype_enum);
     if (dtype_index < 0 ||
         dtype_index >= static_cast<int>(array_creators.size())) {
-        if (take_ownership) {
-            delete[] exported_data;
-        }
         LOG(ERROR) << "Unsupported dtype enum: " << dtype_index;
         return pybind11::none();
     }
 
     try {
         // Construct numpy array
-        bool take_ownership = !!buffer_handle;
         py::object np_array = array_creators[dtype_index](
-            exported_data, sizeof(TensorMetadata), tensor_size, take_ownership);
+            exported_data, sizeof(TensorMetadata), tensor_size, base);
 
         // Reshape
         if (metadata.ndim > 0) {
@@ -218,9 +210,6 @@ pybind11::object buffer_to_tensor(BufferHandle *buffer_handle, char *usr_buffer,
 
     } catch (const std::exception &e) {
         LOG(ERROR) << "Failed to convert buffer to tensor: " << e.what();
-        if (take_ownership) {
-            delete[] exported_data;
-        }
         return pybind11::none();
     }
 }
@@ -270,41 +259,78 @@ class MooncakeStorePyWrapper {
         return (store_ && (use_dummy_client_ || store_->client_));
     }
 
+    // For the calls only implemented by the real client
+    std::shared_ptr<RealClient> real_client() const {
+        auto real_client = std::dynamic_pointer_cast<RealClient>(store_);
+        if (use_dummy_client_ || !real_client) {
+            throw std::runtime_error(
+                "operation is not supported for dummy client now");
+        }
+        return real_client;
+    }
+
     std::string get_tp_key_name(const std::string &base_key, int rank) {
         return base_key + "_tp_" + std::to_string(rank);
     }
 
+    // Copy the values into new bytes objects. The objects are allocated
+    // with the GIL held but filled without it, so that large values do not
+    // block the other Python threads while they are copied. A null data
+    // pointer gives an empty bytes object.
+    static std::vector<pybind11::bytes> copy_to_bytes(
+        const std::vector<std::pair<const char *, size_t>> &values) {
+        std::vector<pybind11::bytes> results;
+        results.reserve(values.size());
+        std::vector<std::pair<char *, size_t>> copies;
+        for (const auto &[data, size] : values) {
+            auto raw = py::reinterpret_steal<pybind11::bytes>(
+                PyBytes_FromStringAndSize(nullptr, data ? size : 0));
+            if (!raw) throw py::error_already_set();
+            if (data && size > 0) {
+                copies.emplace_back(PyBytes_AS_STRING(raw.ptr()), size);
+            }
+            results.push_back(std::move(raw));
+        }
+        py::gil_scoped_release release_gil;
+        for (size_t i = 0, j = 0; i < values.size(); ++i) {
+            if (values[i].first && values[i].second > 0) {
+                memcpy(copies[j].first, values[i].first, copies[j].second);
+                ++j;
+            }
+        }
+        return results;
+    }
+
     pybind11::bytes get(const std::string &key) {
+        const auto kNullString = pybind11::bytes("\\0", 0);
         if (!is_client_initialized()) {
             LOG(ERROR) << "Client is not initialized";
-            return pybind11::bytes("\\0", 0);
+            return kNullString;
         }
 
-        const auto kNullString = pybind11::bytes("\\0", 0);
+        if (use_dummy_client_) {
+            std::tuple<uint64_t, size_t> buffer_info;
+            {
+                py::gil_scoped_release release_gil;
+                buffer_info = store_->get_buffer_info(key);
+            }
+            auto [buffer_base, buffer_size] = buffer_info;
+            if (buffer_size == 0) return kNullString;
+            auto results = copy_to_bytes(
+                {{reinterpret_cast<const char *>(buffer_base), buffer_size}});
+            return results[0];
+        }
 
+        std::shared_ptr<BufferHandle> buffer_handle;
         {
             py::gil_scoped_release release_gil;
-            if (use_dummy_client_) {
-                auto [buffer_base, buffer_size] = store_->get_buffer_info(key);
-                if (buffer_size == 0) {
-                    py::gil_scoped_acquire acquire_gil;
-                    return kNullString;
-                }
-                py::gil_scoped_acquire acquire_gil;
-                return pybind11::bytes(reinterpret_cast<char *>(buffer_base),
-                                       buffer_size);
-            } else {
-                auto buffer_handle = store_->get_buffer(key);
-                if (!buffer_handle) {
-                    py::gil_scoped_acquire acquire_gil;
-                    return kNullString;
-                }
-
-                py::gil_scoped_acquire acquire_gil;
-                return pybind11::bytes((char *)buffer_handle->ptr(),
-                                       buffer_handle->size());
-            }
+            buffer_handle = store_->get_buffer(key);
         }
+        if (!buffer_handle) return kNullString;
+        auto results =
+            copy_to_bytes({{static_cast<const char *>(buffer_handle->ptr()),
+                            buffer_handle->size()}});
+        return results[0];
     }
 
     std::vector<pybind11::bytes> get_batch(
@@ -312,29 +338,72 @@ class MooncakeStorePyWrapper {
         const auto kNullString = pybind11::bytes("\\0", 0);
         if (!is_client_initialized()) {
             LOG(ERROR) << "Client is not initialized";
-            py::gil_scoped_acquire acquire_gil;
             return {kNullString};
         }
 
+        std::vector<std::shared_ptr<BufferHandle>> batch_data;
         {
             py::gil_scoped_release release_gil;
-            auto batch_data = store_->batch_get_buffer(keys);
-            if (batch_data.empty()) {
-                py::gil_scoped_acquire acquire_gil;
-                return {kNullString};
-            }
+            batch_data = store_->batch_get_buffer(keys);
+        }
+        if (batch_data.empty()) return {kNullString};
+
+        std::vector<std::pair<const char *, size_t>> values;
+        values.reserve(batch_data.size());
+        for (const auto &data : batch_data) {
+            values.emplace_back(
+                data ? static_cast<const char *>(data->ptr()) : nullptr,
+                data ? data->size() : 0);
+        }
+        return copy_to_bytes(values);
+    }
 
-            py::gil_scoped_acquire acquire_gil;
-            std::vector<pybind11::bytes> results;
-            results.reserve(batch_data.size());
+    // memoryview over the buffer of a fetched value, which keeps the buffer
+    // alive until the view is released
+    static pybind11::object buffer_view(
+        const std::shared_ptr<BufferHandle> &buffer_handle) {
+        if (!buffer_handle) return pybind11::none();
+        auto handle = py::cast(buffer_handle);
+        auto view = py::reinterpret_steal<pybind11::object>(
+            PyMemoryView_FromObject(handle.ptr()));
+        if (!view) throw py::error_already_set();
+        return view;
+    }
+
+    pybind11::object get_view(const std::string &key) {
+        if (!is_client_initialized() || use_dummy_client_) {
+            LOG(ERROR) << "Client not initialized or Dummy client not "
+                          "supported for get_view";
+            return pybind11::none();
+        }
+        std::shared_ptr<BufferHandle> buffer_handle;
+        {
+            py::gil_scoped_release release_gil;
+            buffer_handle = store_->get_buffer(key);
+        }
+        return buffer_view(buffer_handle);
+    }
 
-            for (const auto &data : batch_data) {
-                results.emplace_back(
-                    data ? pybind11::bytes((char *)data->ptr(), data->size())
-                         : kNullString);
+    pybind11::list get_batch_view(const std::vector<std::string> &keys) {
+        pybind11::list results;
+        if (!is_client_initialized() || use_dummy_client_) {
+            LOG(ERROR) << "Client not initialized or Dummy client not "
+                          "supported for get_batch_view";
+            for (size_t i = 0; i < keys.size(); ++i) {
+                results.append(pybind11::none());
             }
             return results;
         }
+        std::vector<std::shared_ptr<BufferHandle>> batch_data;
+        {
+            py::gil_scoped_release release_gil;
+            batch_data = store_->batch_get_buffer(keys);
+        }
+        for (size_t i = 0; i < keys.size(); ++i) {
+            results.append(buffer_view(i < batch_data.size() ? batch_data[i]
+                                                             : nullptr));
+        }
+        return results;
     }
 
     pybind11::object get_tensor_with_tp(const std::string &key, int tp_rank = 0,
@@ -343,6 +412,96 @@ class MooncakeStorePyWrapper {
         return get_tensor(get_tp_key_name(key, tp_rank));
     }
 
+    // Reads the header of the tensor, then its shard into a buffer headed by
+    // the header of the shard; nullptr on error
+    std::shared_ptr<BufferHandle> get_tensor_shard_buffer(
+        const std::string &key, int tp_rank, int tp_size, int split_dim) {
+        auto header_handle =
+            store_->get_ranges_buffer(key, {{0, sizeof(TensorMetadata)}});
+        if (!header_handle) return nullptr;
+        TensorMetadata metadata;
+        memcpy(&metadata, header_handle->ptr(), sizeof(TensorMetadata));
+        const auto kDtypes = static_cast<int32_t>(TensorDtype::NR_DTYPES);
+        if (metadata.ndim < 1 || metadata.ndim > 4 || split_dim < 0 ||
+            split_dim >= metadata.ndim || metadata.dtype < 0 ||
+            metadata.dtype >= kDtypes) {
+            LOG(ERROR) << "Cannot split dim " << split_dim
+                       << " of tensor " << key << " with ndim "
+                       << metadata.ndim;
+            return nullptr;
+        }
+        const int64_t dim_size = metadata.shape[split_dim];
+        const int64_t chunk = (dim_size + tp_size - 1) / tp_size;
+        const int64_t begin = chunk * tp_rank;
+        const int64_t end = std::min(dim_size, begin + chunk);
+        if (begin >= end) {
+            LOG(ERROR) << "Tensor " << key << " has no shard for tp_rank "
+                       << tp_rank << " of " << tp_size;
+            return nullptr;
+        }
+
+        // Bytes of one index of the split dim, and rows before it
+        uint64_t inner = get_element_size(
+            static_cast<TensorDtype>(metadata.dtype));
+        for (int i = split_dim + 1; i < metadata.ndim; ++i) {
+            inner *= metadata.shape[i];
+        }
+        uint64_t outer = 1;
+        for (int i = 0; i < split_dim; ++i) {
+            outer *= metadata.shape[i];
+        }
+        const uint64_t row = inner * dim_size;
+        const uint64_t run = inner * (end - begin);
+        std::vector<std::pair<uint64_t, uint64_t>> ranges;
+        ranges.reserve(outer + 1);
+        ranges.emplace_back(0, sizeof(TensorMetadata));
+        for (uint64_t i = 0; i < outer; ++i) {
+            const uint64_t offset =
+                sizeof(TensorMetadata) + i * row + inner * begin;
+            auto &last = ranges.back();
+            if (last.first + last.second == offset) {
+                last.second += run;
+            } else {
+                ranges.emplace_back(offset, run);
+            }
+        }
+        auto buffer_handle = store_->get_ranges_buffer(key, ranges);
+        if (!buffer_handle) return nullptr;
+        // The header now describes the shard
+        metadata.shape[split_dim] = end - begin;
+        memcpy(buffer_handle->ptr(), &metadata, sizeof(TensorMetadata));
+        return buffer_handle;
+    }
+
+    // Reads the part of a tensor put whole that TP rank tp_rank of tp_size
+    // holds, and no other bytes: the shape and dtype come from the header of
+    // the object, so readers of any TP size share one copy of it. The split
+    // follows torch.chunk. Along dim 0 the shard is one range of the object,
+    // along another dim one range per row of the dims before it, all read
+    // in one batch.
+    pybind11::object get_tensor_shard(const std::string &key, int tp_rank = 0,
+                                      int tp_size = 1, int split_dim = 0) {
+        if (!is_client_initialized() || use_dummy_client_) {
+            LOG(ERROR) << "Client not initialized or Dummy client not "
+                          "supported for tensors";
+            return pybind11::none();
+        }
+        if (tp_size <= 1) return get_tensor(key);
+        if (tp_rank < 0 || tp_rank >= tp_size) {
+            LOG(ERROR) << "Invalid tp_rank " << tp_rank << " for tp_size "
+                       << tp_size;
+            return pybind11::none();
+        }
+
+        std::shared_ptr<BufferHandle> buffer_handle;
+        {
+            py::gil_scoped_release release_gil;
+            buffer_handle =
+                get_tensor_shard_buffer(key, tp_rank, tp_size, split_dim);
+        }
+        return buffer_to_tensor(buffer_handle, NULL, 0);
+    }
+
     pybind11::list batch_get_tensor_with_tp(
         const std::vector<std::string> &base_keys, int tp_rank = 0,
         int tp_size = 1) {
@@ -369,7 +528,7 @@ class MooncakeStorePyWrapper {
             buffer_handle = store_->get_buffer(key);
         }
         // Metadata parsing must happen with GIL held
-        return buffer_to_tensor(buffer_handle.get(), NULL, 0);
+        return buffer_to_tensor(buffer_handle, NULL, 0);
     }
 
     pybind11::list batch_get_tensor(const std::vector<std::string> &keys) {
@@ -389,7 +548,7 @@ class MooncakeStorePyWrapper {
 
         py::list results_list;
         for (const auto &handle : buffer_handles) {
-            results_list.append(buffer_to_tensor(handle.get(), NULL, 0));
+            results_list.append(buffer_to_tensor(handle, NULL, 0));
         }
         return results_list;
     }
@@ -413,7 +572,7 @@ class MooncakeStorePyWrapper {
             total_length = store_->get_into(key, buffer, size);
         }
 
-        return buffer_to_tensor(NULL, buffer, total_length);
+        return buffer_to_tensor(nullptr, buffer, total_length);
     }
 
     pybind11::list batch_get_tensor_into(
@@ -468,7 +627,7 @@ class MooncakeStorePyWrapper {
             const auto &buffer = buffers[i];
             const auto total_length = total_lengths[i];
             results_list.append(buffer_to_tensor(
-                NULL, static_cast<char *>(buffer), total_length));
+                nullptr, static_cast<char *>(buffer), total_length));
         }
         return results_list;
     }
@@ -626,56 +785,29 @@ class MooncakeStorePyWrapper {
                 results[i] = to_py_ret(ErrorCode::INVALID_PARAMS);
         }
 
-        // 2. Prepare Buffers and Execute (GIL Released)
+        // 2. Put header and storage of every tensor as two parts, all keys
+        // in one batch (GIL Released). Storage in registered memory is
+        // transferred from the tensor itself.
         {
             py::gil_scoped_release release_gil;
 
-            // Temporary containers for the batch operation
             std::vector<std::string> valid_keys;
-            std::vector<void *> buffer_ptrs;
-            std::vector<size_t> buffer_sizes;
+            std::vector<std::vector<std::span<const char>>> all_parts;
             std::vector<size_t> original_indices;  // Map back to results
-
-            // Note: In batch mode, we need contiguous memory for Metadata +
-            // Data.
-            std::vector<std::unique_ptr<BufferHandle>> temp_allocations;
-
             for (size_t i = 0; i < infos.size(); ++i) {
                 if (!infos[i].valid()) continue;
-
-                size_t total_size =
-                    sizeof(TensorMetadata) + infos[i].tensor_size;
-                auto alloc_result =
-                    store_->client_buffer_allocator_->allocate(total_size);
-
-                if (!alloc_result) {
-                    LOG(ERROR)
-                        << "Failed to allocate buffer for key: " << keys[i];
-                    results[i] = to_py_ret(ErrorCode::INVALID_PARAMS);
-                    continue;
-                }
-
-                // Copy Metadata & Data
-                char *dst = static_cast<char *>(alloc_result->ptr());
-                memcpy(dst, &infos[i].metadata, sizeof(TensorMetadata));
-                memcpy(dst + sizeof(TensorMetadata),
-                       reinterpret_cast<void *>(infos[i].data_ptr),
-                       infos[i].tensor_size);
-
                 valid_keys.push_back(keys[i]);
-                buffer_ptrs.push_back(alloc_result->ptr());
-                buffer_sizes.push_back(total_size);
+                all_parts.push_back(
+                    {{reinterpret_cast<const char *>(&infos[i].metadata),
+                      sizeof(TensorMetadata)},
+                     {reinterpret_cast<const char *>(infos[i].data_ptr),
+                      infos[i].tensor_size}});
                 original_indices.push_back(i);
-
-                // Transfer ownership to temp_allocations so it survives until
-                // batch_put_from returns
-                temp_allocations.push_back(
-                    std::make_unique<BufferHandle>(std::move(*alloc_result)));
             }
 
             if (!valid_keys.empty()) {
-                std::vector<int> op_results = store_->batch_put_from(
-                    valid_keys, buffer_ptrs, buffer_sizes, config);
+                std::vector<int> op_results =
+                    store_->batch_put_parts(valid_keys, all_parts, config);
                 for (size_t i = 0; i < op_results.size(); ++i) {
                     results[original_indices[i]] = op_results[i];
                 }
@@ -900,6 +1032,11 @@ PYBIND11_MODULE(store, m) {
         .def_readwrite("preferred_segment", &ReplicateConfig::preferred_segment)
         .def_readwrite("prefer_alloc_in_same_node",
                        &ReplicateConfig::prefer_alloc_in_same_node)
+        .def_readwrite("stripe_num", &ReplicateConfig::stripe_num)
+        .def_readwrite("parity_num", &ReplicateConfig::parity_num)
+        .def_readwrite("content_hash", &ReplicateConfig::content_hash)
+        .def_readwrite("ttl_ms", &ReplicateConfig::ttl_ms)
+        .def_readwrite("cost_hint", &ReplicateConfig::cost_hint)
         .def("__str__", [](const ReplicateConfig &config) {
             std::ostringstream oss;
             oss << config;
@@ -917,7 +1054,9 @@ PYBIND11_MODULE(store, m) {
 
     py::class_<MemoryDescriptor>(m, "MemoryDescriptor")
         .def_readwrite("buffer_descriptor",
-                       &MemoryDescriptor::buffer_descriptor);
+                       &MemoryDescriptor::buffer_descriptor)
+        .def_readwrite("extra_stripes", &MemoryDescriptor::extra_stripes)
+        .def_readwrite("parity_stripes", &MemoryDescriptor::parity_stripes);
 
     py::class_<DiskDescriptor>(m, "DiskDescriptor")
         .def_readwrite("file_path", &DiskDescriptor::file_path)
@@ -1133,6 +1272,15 @@ PYBIND11_MODULE(store, m) {
              })
         .def("get", &mooncake::MooncakeStorePyWrapper::get)
         .def("get_batch", &mooncake::MooncakeStorePyWrapper::get_batch)
+        .def("get_view", &mooncake::MooncakeStorePyWrapper::get_view,
+             py::arg("key"),
+             "Get an object as a memoryview over the client buffer holding "
+             "it, without copying it into bytes")
+        .def("get_batch_view",
+             &mooncake::MooncakeStorePyWrapper::get_batch_view,
+             py::arg("keys"),
+             "Get objects as memoryviews over the client buffers holding "
+             "them, None for missing keys")
         .def(
             "get_buffer",
             [](MooncakeStorePyWrapper &self, const std::string &key) {
@@ -1198,6 +1346,17 @@ PYBIND11_MODULE(store, m) {
             py::arg("keys"),
             "Check if multiple objects exist. Returns list of results: 1 if "
             "exists, 0 if not exists, -1 if error")
+        .def(
+            "batch_is_exist_prefix",
+            [](MooncakeStorePyWrapper &self,
+               const std::vector<std::string> &keys) {
+                py::gil_scoped_release release;
+                return self.store_->batchIsExistPrefix(keys);
+            },
+            py::arg("keys"),
+            "Count how many of the keys, from the first on, all exist. "
+            "Returns the index of the first missing key, or a negative "
+            "error code")
         .def("close",
              [](MooncakeStorePyWrapper &self) {
                  if (!self.store_) return 0;
@@ -1227,6 +1386,11 @@ PYBIND11_MODULE(store, m) {
              py::arg("tp_size") = 1,
              "Get a batch of PyTorch tensor shards from the store for a given "
              "Tensor Parallel rank.")
+        .def("get_tensor_shard", &MooncakeStorePyWrapper::get_tensor_shard,
+             py::arg("key"), py::arg("tp_rank") = 0, py::arg("tp_size") = 1,
+             py::arg("split_dim") = 0,
+             "Get the shard of a tensor put whole with put_tensor that a TP "
+             "rank holds, transferring only its bytes")
         .def("get_tensor", &MooncakeStorePyWrapper::get_tensor, py::arg("key"),
              "Get a PyTorch tensor from the store")
         .def("put_tensor_with_tp", &MooncakeStorePyWrapper::put_tensor_with_tp,
@@ -1379,6 +1543,69 @@ PYBIND11_MODULE(store, m) {
             py::arg("key"), py::arg("buffer_ptr"), py::arg("size"),
             py::arg("config") = ReplicateConfig{},
             "Put object data directly from a pre-allocated buffer")
+        .def(
+            "stream_put_start",
+            [](MooncakeStorePyWrapper &self, const std::string &key,
+               const std::vector<uint64_t> &chunk_sizes,
+               const ReplicateConfig &config = ReplicateConfig{}) {
+                py::gil_scoped_release release;
+                if (self.use_dummy_client_) {
+                    LOG(ERROR) << "stream_put_start is not supported for "
+                                  "dummy client now";
+                    return -1;
+                }
+                return self.store_->stream_put_start(key, chunk_sizes, config);
+            },
+            py::arg("key"), py::arg("chunk_sizes"),
+            py::arg("config") = ReplicateConfig{},
+            "Start a streaming put whose chunks can be read before it ends")
+        .def(
+            "stream_put_from",
+            [](MooncakeStorePyWrapper &self, const std::string &key,
+               uint64_t chunk_index, uintptr_t buffer_ptr, size_t size) {
+                void *buffer = reinterpret_cast<void *>(buffer_ptr);
+                py::gil_scoped_release release;
+                if (self.use_dummy_client_) {
+                    LOG(ERROR) << "stream_put_from is not supported for "
+                                  "dummy client now";
+                    return -1;
+                }
+                return self.store_->stream_put_from(key, chunk_index, buffer,
+                                                    size);
+            },
+            py::arg("key"), py::arg("chunk_index"), py::arg("buffer_ptr"),
+            py::arg("size"),
+            "Write and commit one chunk of a streaming put from a "
+            "pre-allocated buffer")
+        .def(
+            "stream_put_end",
+            [](MooncakeStorePyWrapper &self, const std::string &key) {
+                py::gil_scoped_release release;
+                if (self.use_dummy_client_) {
+                    LOG(ERROR) << "stream_put_end is not supported for "
+                                  "dummy client now";
+                    return -1;
+                }
+                return self.store_->stream_put_end(key);
+            },
+            py::arg("key"), "Complete a streaming put")
+        .def(
+            "get_range_into",
+            [](MooncakeStorePyWrapper &self, const std::string &key,
+               uint64_t offset, uintptr_t buffer_ptr, size_t size) {
+                void *buffer = reinterpret_cast<void *>(buffer_ptr);
+                py::gil_scoped_release release;
+                if (self.use_dummy_client_) {
+                    LOG(ERROR) << "get_range_into is not supported for "
+                                  "dummy client now";
+                    return (int64_t)-1;
+                }
+                return self.store_->get_range_into(key, offset, buffer, size);
+            },
+            py::arg("key"), py::arg("offset"), py::arg("buffer_ptr"),
+            py::arg("size"),
+            "Read a committed byte range of an object, which may still be "
+            "streamed, into a pre-allocated buffer")
         .def(
             "put_from_with_metadata",
             [](MooncakeStorePyWrapper &self, const std::string &key,
@@ -1426,6 +1653,94 @@ PYBIND11_MODULE(store, m) {
             "Put object data directly from pre-allocated buffers for "
             "multiple "
             "keys")
+        .def(
+            "async_completion_fd",
+            [](MooncakeStorePyWrapper &self) {
+                return self.real_client()->async_completion_fd();
+            },
+            "Eventfd that becomes readable when submitted async operations "
+            "complete")
+        .def(
+            "submit_get_into",
+            [](MooncakeStorePyWrapper &self, const std::string &key,
+               uintptr_t buffer_ptr, size_t size) {
+                auto client = self.real_client();
+                void *buffer = reinterpret_cast<void *>(buffer_ptr);
+                py::gil_scoped_release release;
+                return client->submit_get_into(key, buffer, size);
+            },
+            py::arg("key"), py::arg("buffer_ptr"), py::arg("size"),
+            "Start get_into without waiting, returns the request id")
+        .def(
+            "submit_batch_get_into",
+            [](MooncakeStorePyWrapper &self,
+               const std::vector<std::string> &keys,
+               const std::vector<uintptr_t> &buffer_ptrs,
+               const std::vector<size_t> &sizes) {
+                auto client = self.real_client();
+                std::vector<void *> buffers;
+                buffers.reserve(buffer_ptrs.size());
+                for (uintptr_t ptr : buffer_ptrs) {
+                    buffers.push_back(reinterpret_cast<void *>(ptr));
+                }
+                py::gil_scoped_release release;
+                return client->submit_batch_get_into(keys, buffers, sizes);
+            },
+            py::arg("keys"), py::arg("buffer_ptrs"), py::arg("sizes"),
+            "Start batch_get_into without waiting, returns the request id")
+        .def(
+            "submit_put_from",
+            [](MooncakeStorePyWrapper &self, const std::string &key,
+               uintptr_t buffer_ptr, size_t size,
+               const ReplicateConfig &config = ReplicateConfig{}) {
+                auto client = self.real_client();
+                void *buffer = reinterpret_cast<void *>(buffer_ptr);
+                py::gil_scoped_release release;
+                return client->submit_put_from(key, buffer, size, config);
+            },
+            py::arg("key"), py::arg("buffer_ptr"), py::arg("size"),
+            py::arg("config") = ReplicateConfig{},
+            "Start put_from without waiting, returns the request id")
+        .def(
+            "submit_batch_put_from",
+            [](MooncakeStorePyWrapper &self,
+               const std::vector<std::string> &keys,
+               const std::vector<uintptr_t> &buffer_ptrs,
+               const std::vector<size_t> &sizes,
+               const ReplicateConfig &config = ReplicateConfig{}) {
+                auto client = self.real_client();
+                std::vector<void *> buffers;
+                buffers.reserve(buffer_ptrs.size());
+                for (uintptr_t ptr : buffer_ptrs) {
+                    buffers.push_back(reinterpret_cast<void *>(ptr));
+                }
+                py::gil_scoped_release release;
+                return client->submit_batch_put_from(keys, buffers, sizes,
+                                                     config);
+            },
+            py::arg("keys"), py::arg("buffer_ptrs"), py::arg("sizes"),
+            py::arg("config") = ReplicateConfig{},
+            "Start batch_put_from without waiting, returns the request id")
+        .def(
+            "prefetch",
+            [](MooncakeStorePyWrapper &self,
+               const std::vector<std::string> &keys) {
+                auto client = self.real_client();
+                py::gil_scoped_release release;
+                return client->prefetch(keys);
+            },
+            py::arg("keys"),
+            "Warm the replica and local hot caches for keys that will be "
+            "read soon, without waiting for it")
+        .def(
+            "poll_async_completions",
+            [](MooncakeStorePyWrapper &self) {
+                auto client = self.real_client();
+                py::gil_scoped_release release;
+                return client->poll_async_completions();
+            },
+            "Take the (request id, results) pairs of the async operations "
+            "completed since the last call")
         .def(
             "put",
             [](MooncakeStorePyWrapper &self, const std::string &key,
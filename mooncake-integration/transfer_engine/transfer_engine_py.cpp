@@ -15,6 +15,7 @@
 #include "transfer_engine_py.h"
 
 #include <cassert>
+#include <cstring>
 #include <numeric>
 #include <fstream>
 
@@ -89,6 +90,12 @@ TransferEnginePy::TransferEnginePy() {
 }
 
 TransferEnginePy::~TransferEnginePy() {
+    {
+        std::lock_guard<std::mutex> lock(layer_mutex_);
+        layer_stop_ = true;
+    }
+    layer_cond_.notify_all();
+    if (layer_thread_.joinable()) layer_thread_.join();
     for (auto &handle : handle_map_) engine_->closeSegment(handle.second);
     handle_map_.clear();
     engine_.reset();
@@ -660,6 +667,161 @@ int TransferEnginePy::getBatchTransferStatus(
     return failed_or_timeout ? -1 : 0;
 }
 
+int TransferEnginePy::submitLayerWrite(
+    const std::string &request_id, const char *target_hostname,
+    std::vector<uintptr_t> buffers,
+    std::vector<uintptr_t> peer_buffer_addresses,
+    std::vector<size_t> lengths) {
+    if (buffers.size() != peer_buffer_addresses.size() ||
+        buffers.size() != lengths.size()) {
+        LOG(ERROR)
+            << "buffers, peer_buffer_addresses and lengths have different size";
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(layer_mutex_);
+        if (layer_stop_) return -1;
+        if (!layer_thread_.joinable())
+            layer_thread_ = std::thread([this] { layerWriteLoop(); });
+        layer_requests_[request_id].pending++;
+        layer_queue_.push_back({request_id, target_hostname,
+                                std::move(buffers),
+                                std::move(peer_buffer_addresses),
+                                std::move(lengths)});
+    }
+    layer_cond_.notify_all();
+    return 0;
+}
+
+int TransferEnginePy::getLayerWriteStatus(const std::string &request_id) {
+    std::lock_guard<std::mutex> lock(layer_mutex_);
+    return takeLayerWriteResult(request_id);
+}
+
+int TransferEnginePy::waitLayerWrites(const std::string &request_id) {
+    pybind11::gil_scoped_release release;
+    std::unique_lock<std::mutex> lock(layer_mutex_);
+    layer_cond_.wait(lock, [&] {
+        auto it = layer_requests_.find(request_id);
+        return it == layer_requests_.end() || it->second.pending == 0;
+    });
+    return takeLayerWriteResult(request_id);
+}
+
+int TransferEnginePy::takeLayerWriteResult(const std::string &request_id) {
+    auto it = layer_requests_.find(request_id);
+    if (it == layer_requests_.end()) return 0;
+    if (it->second.pending) return 1;
+    int ret = it->second.failed ? -1 : 0;
+    layer_requests_.erase(it);
+    return ret;
+}
+
+void TransferEnginePy::finishLayerWrite(const std::string &request_id,
+                                        bool ok) {
+    {
+        std::lock_guard<std::mutex> lock(layer_mutex_);
+        auto &request = layer_requests_[request_id];
+        request.pending--;
+        if (!ok) request.failed = true;
+    }
+    layer_cond_.notify_all();
+}
+
+batch_id_t TransferEnginePy::submitLayerWriteBatch(const LayerWrite &write) {
+    Transport::SegmentHandle handle;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = handle_map_.find(write.target_hostname);
+        if (it != handle_map_.end()) {
+            handle = it->second;
+        } else {
+            handle = engine_->openSegment(write.target_hostname);
+            if (handle == (Transport::SegmentHandle)-1) return 0;
+            handle_map_[write.target_hostname] = handle;
+        }
+    }
+
+    std::vector<TransferRequest> entries;
+    entries.reserve(write.buffers.size());
+    for (size_t i = 0; i < write.buffers.size(); ++i) {
+        TransferRequest entry;
+        entry.opcode = TransferRequest::WRITE;
+        entry.length = write.lengths[i];
+        entry.source = (void *)write.buffers[i];
+        entry.target_id = handle;
+        entry.target_offset = write.peer_buffer_addresses[i];
+        entry.advise_retry_cnt = 0;
+        entries.push_back(entry);
+    }
+
+    auto batch_id = engine_->allocateBatchID(entries.size());
+    Status s = engine_->submitTransfer(batch_id, entries);
+    if (!s.ok()) {
+        LOG(ERROR) << "Failed to submit layer write of request "
+                   << write.request_id << " to " << write.target_hostname
+                   << ": " << s.ToString();
+        engine_->freeBatchID(batch_id);
+        return 0;
+    }
+    return batch_id;
+}
+
+void TransferEnginePy::layerWriteLoop() {
+    std::vector<LayerWriteBatch> inflight;
+    while (true) {
+        std::deque<LayerWrite> queued;
+        {
+            std::unique_lock<std::mutex> lock(layer_mutex_);
+            // Poll the batches in flight, sleep only when there are none
+            if (inflight.empty())
+                layer_cond_.wait(lock, [&] {
+                    return layer_stop_ || !layer_queue_.empty();
+                });
+            if (layer_stop_) break;
+            queued.swap(layer_queue_);
+        }
+
+        for (auto &write : queued) {
+            if (write.buffers.empty()) {
+                finishLayerWrite(write.request_id, true);
+                continue;
+            }
+            auto batch_id = submitLayerWriteBatch(write);
+            if (!batch_id) {
+                finishLayerWrite(write.request_id, false);
+                continue;
+            }
+            auto total_length = std::accumulate(write.lengths.begin(),
+                                                write.lengths.end(), 0ull);
+            // Like the sync batch APIs: the timeout plus 1GiB per second
+            inflight.push_back({write.request_id, batch_id,
+                                getCurrentTimeInNano() +
+                                    transfer_timeout_nsec_ + total_length});
+        }
+
+        for (auto it = inflight.begin(); it != inflight.end();) {
+            TransferStatus status;
+            Status s = engine_->getBatchTransferStatus(it->batch_id, status);
+            bool completed =
+                s.ok() && status.s == TransferStatusEnum::COMPLETED;
+            if (!completed && s.ok() &&
+                status.s != TransferStatusEnum::FAILED &&
+                getCurrentTimeInNano() < it->deadline) {
+                ++it;
+                continue;
+            }
+            if (!completed)
+                LOG(WARNING) << "Layer write of request " << it->request_id
+                             << " failed or timed out";
+            engine_->freeBatchID(it->batch_id);
+            finishLayerWrite(it->request_id, completed);
+            it = inflight.erase(it);
+        }
+    }
+    for (auto &batch : inflight) engine_->freeBatchID(batch.batch_id);
+}
+
 batch_id_t TransferEnginePy::transferSubmitWrite(const char *target_hostname,
                                                  uintptr_t buffer,
                                                  uintptr_t peer_buffer_address,
@@ -742,6 +904,11 @@ int TransferEnginePy::unregisterMemory(uintptr_t buffer_addr) {
     return engine_->unregisterLocalMemory(buffer);
 }
 
+int TransferEnginePy::notifyMemoryFreed(uintptr_t buffer_addr) {
+    char *buffer = reinterpret_cast<char *>(buffer_addr);
+    return engine_->notifyMemoryFreed(buffer);
+}
+
 #ifdef USE_CUDA
 
 /**
@@ -974,6 +1141,59 @@ std::vector<TransferEnginePy::TransferNotify> TransferEnginePy::getNotifies() {
 
 namespace py = pybind11;
 
+namespace {
+
+// The addresses or lengths of a batch. Contiguous 1-D arrays of 8-byte
+// integers, i.e. int64 or uint64 numpy arrays and CPU tensors, are copied at
+// once instead of converting their elements one by one. Other sequences
+// convert as before.
+std::vector<uintptr_t> ToDescriptorVector(const py::object &obj) {
+    static_assert(sizeof(uintptr_t) == sizeof(int64_t));
+    auto copy = [](const void *data, size_t count) {
+        std::vector<uintptr_t> result(count);
+        if (count) std::memcpy(result.data(), data, count * sizeof(uintptr_t));
+        return result;
+    };
+    if (PyObject_CheckBuffer(obj.ptr())) {
+        py::buffer_info info =
+            py::reinterpret_borrow<py::buffer>(obj).request();
+        const std::string &format = info.format;
+        if (info.ndim == 1 && info.itemsize == sizeof(uintptr_t) &&
+            (info.shape[0] <= 1 || info.strides[0] == info.itemsize) &&
+            (format == "q" || format == "Q" || format == "l" ||
+             format == "L")) {
+            return copy(info.ptr, info.shape[0]);
+        }
+    } else if (py::hasattr(obj, "data_ptr") && py::hasattr(obj, "dtype")) {
+        const std::string dtype = py::str(obj.attr("dtype"));
+        const std::string device = py::str(obj.attr("device").attr("type"));
+        if ((dtype == "torch.int64" || dtype == "torch.uint64") &&
+            device == "cpu" && obj.attr("dim")().cast<int>() == 1 &&
+            obj.attr("is_contiguous")().cast<bool>()) {
+            return copy(reinterpret_cast<const void *>(
+                            obj.attr("data_ptr")().cast<uintptr_t>()),
+                        obj.attr("numel")().cast<size_t>());
+        }
+    }
+    return obj.cast<std::vector<uintptr_t>>();
+}
+
+// Binds a batch API to take descriptor arrays, see ToDescriptorVector.
+// The API releases the GIL for the submit and, if sync, the wait.
+template <typename Method>
+auto WithDescriptorArrays(Method method) {
+    return [method](TransferEnginePy &self, const char *target_hostname,
+                    const py::object &buffers,
+                    const py::object &peer_buffer_addresses,
+                    const py::object &lengths) {
+        return (self.*method)(target_hostname, ToDescriptorVector(buffers),
+                              ToDescriptorVector(peer_buffer_addresses),
+                              ToDescriptorVector(lengths));
+    };
+}
+
+}  // namespace
+
 // Implementation of coro_rpc_interface binding function
 void bind_coro_rpc_interface(py::module_ &m) {
     // Note: RpcInterface, ReceivedData and ReceivedTensor are already
@@ -1012,13 +1232,16 @@ PYBIND11_MODULE(engine, m) {
             .def("transfer_sync_write", &TransferEnginePy::transferSyncWrite)
             .def("transfer_sync_read", &TransferEnginePy::transferSyncRead)
             .def("batch_transfer_sync_write",
-                 &TransferEnginePy::batchTransferSyncWrite)
+                 WithDescriptorArrays(
+                     &TransferEnginePy::batchTransferSyncWrite))
             .def("batch_transfer_sync_read",
-                 &TransferEnginePy::batchTransferSyncRead)
+                 WithDescriptorArrays(&TransferEnginePy::batchTransferSyncRead))
             .def("batch_transfer_async_write",
-                 &TransferEnginePy::batchTransferAsyncWrite)
+                 WithDescriptorArrays(
+                     &TransferEnginePy::batchTransferAsyncWrite))
             .def("batch_transfer_async_read",
-                 &TransferEnginePy::batchTransferAsyncRead)
+                 WithDescriptorArrays(
+                     &TransferEnginePy::batchTransferAsyncRead))
             .def("transfer_sync", &TransferEnginePy::transferSync,
                  py::arg("target_hostname"), py::arg("buffer"),
                  py::arg("peer_buffer_address"), py::arg("length"),
@@ -1046,6 +1269,20 @@ PYBIND11_MODULE(engine, m) {
                  py::arg("peer_buffer_addresses"), py::arg("lengths"),
                  py::arg("stream_ptr") = 0)
 #endif
+            .def("submit_layer_write",
+                 [](TransferEnginePy &self, const std::string &request_id,
+                    const char *target_hostname, const py::object &buffers,
+                    const py::object &peer_buffer_addresses,
+                    const py::object &lengths) {
+                     return self.submitLayerWrite(
+                         request_id, target_hostname,
+                         ToDescriptorVector(buffers),
+                         ToDescriptorVector(peer_buffer_addresses),
+                         ToDescriptorVector(lengths));
+                 })
+            .def("get_layer_write_status",
+                 &TransferEnginePy::getLayerWriteStatus)
+            .def("wait_layer_writes", &TransferEnginePy::waitLayerWrites)
             .def("get_batch_transfer_status",
                  &TransferEnginePy::getBatchTransferStatus)
             .def("transfer_submit_write",
@@ -1057,6 +1294,7 @@ PYBIND11_MODULE(engine, m) {
                  &TransferEnginePy::readBytesFromBuffer)
             .def("register_memory", &TransferEnginePy::registerMemory)
             .def("unregister_memory", &TransferEnginePy::unregisterMemory)
+            .def("notify_memory_freed", &TransferEnginePy::notifyMemoryFreed)
             .def("batch_register_memory",
                  &TransferEnginePy::batchRegisterMemory)
             .def("batch_unregister_memory",
@@ -17,11 +17,14 @@
 #include <pybind11/pybind11.h>
 #include <sys/time.h>
 
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <memory>
 #include <stack>
+#include <thread>
 #include <vector>
 
 #include "common/base/status.h"
@@ -122,6 +125,24 @@ class TransferEnginePy {
 
     int getBatchTransferStatus(const std::vector<batch_id_t> &batch_ids);
 
+    // Queues a batch of writes under request_id, e.g. the blocks of one
+    // layer, and returns at once. A dedicated thread submits the queued
+    // batches in order and tracks their completion per request_id.
+    int submitLayerWrite(const std::string &request_id,
+                         const char *target_hostname,
+                         std::vector<uintptr_t> buffers,
+                         std::vector<uintptr_t> peer_buffer_addresses,
+                         std::vector<size_t> lengths);
+
+    // 0 once every batch queued under request_id has completed, 1 while
+    // some are pending, -1 if one failed or timed out. The request is
+    // forgotten when 0 or -1 is returned.
+    int getLayerWriteStatus(const std::string &request_id);
+
+    // Waits until no batch of request_id is pending, then returns as
+    // getLayerWriteStatus()
+    int waitLayerWrites(const std::string &request_id);
+
 #ifdef USE_CUDA
     void batchTransferOnCuda(
         const char *target_hostname, const std::vector<uintptr_t> &buffers,
@@ -169,6 +190,10 @@ class TransferEnginePy {
     // must be called before TransferEnginePy::~TransferEnginePy()
     int unregisterMemory(uintptr_t buffer_addr);
 
+    // Drops the registration MC_GPU_MR_CACHE keeps for a freed device
+    // allocation; meant for the free hook of the caching allocator
+    int notifyMemoryFreed(uintptr_t buffer_addr);
+
     int batchRegisterMemory(std::vector<uintptr_t> buffer_addresses,
                             std::vector<size_t> capacities);
 
@@ -189,6 +214,33 @@ class TransferEnginePy {
 
     int doBuddyAllocate(int class_id);
 
+    struct LayerWrite {
+        std::string request_id;
+        std::string target_hostname;
+        std::vector<uintptr_t> buffers;
+        std::vector<uintptr_t> peer_buffer_addresses;
+        std::vector<size_t> lengths;
+    };
+
+    struct LayerWriteBatch {
+        std::string request_id;
+        batch_id_t batch_id;
+        int64_t deadline;
+    };
+
+    struct LayerWriteRequest {
+        size_t pending = 0;
+        bool failed = false;
+    };
+
+    void layerWriteLoop();
+
+    batch_id_t submitLayerWriteBatch(const LayerWrite &write);
+
+    void finishLayerWrite(const std::string &request_id, bool ok);
+
+    int takeLayerWriteResult(const std::string &request_id);
+
    private:
     std::shared_ptr<TransferEngine> engine_;
     Transport *xport_;
@@ -201,4 +253,11 @@ class TransferEnginePy {
     bool auto_discovery_;
 
     uint64_t transfer_timeout_nsec_;
+
+    std::mutex layer_mutex_;
+    std::condition_variable layer_cond_;
+    std::deque<LayerWrite> layer_queue_;
+    std::unordered_map<std::string, LayerWriteRequest> layer_requests_;
+    std::thread layer_thread_;
+    bool layer_stop_ = false;
 };
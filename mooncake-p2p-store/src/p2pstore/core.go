@@ -37,6 +37,7 @@ type P2PStore struct {
 	memory             *RegisteredMemory
 	metadata           *Metadata
 	transfer           *TransferEngine
+	limiter            *peerLimiter
 }
 
 const DEFAULT_PORT int = 12345
@@ -84,6 +85,7 @@ func NewP2PStore(metadataConnString string, localServerName string, nicPriorityM
 		memory:             NewRegisteredMemory(transfer, MAX_CHUNK_SIZE),
 		metadata:           metadata,
 		transfer:           transfer,
+		limiter:            newPeerLimiter(MAX_INFLIGHT_BYTES_PER_PEER),
 	}
 	return store, nil
 }
@@ -247,10 +249,7 @@ func (store *P2PStore) List(ctx context.Context, namePrefix string) ([]PayloadIn
 }
 
 func (store *P2PStore) doGetReplica(ctx context.Context, payload *Payload, addrList []uintptr, sizeList []uint64) error {
-	var wg sync.WaitGroup
-	errChan := make(chan error, 1)
-
-	var offset uint64 = 0
+	var tasks []shardTask
 	taskID := 0
 	maxShardSize := payload.MaxShardSize
 
@@ -260,34 +259,20 @@ func (store *P2PStore) doGetReplica(ctx context.Context, payload *Payload, addrL
 		if err != nil {
 			return err
 		}
+		var offset uint64 = 0
 		for ; offset < size; offset += maxShardSize {
-			source := addr + uintptr(offset)
-			shard := payload.Shards[taskID]
+			if taskID >= len(payload.Shards) {
+				return ErrInvalidArgument
+			}
+			tasks = append(tasks, shardTask{
+				source: addr + uintptr(offset),
+				shard:  payload.Shards[taskID],
+			})
 			taskID++
-			wg.Add(1)
-			go func() {
-				defer wg.Done()
-				err = store.performTransfer(ctx, source, shard)
-				if err != nil {
-					select {
-					case errChan <- err:
-					default:
-					}
-				}
-			}()
 		}
 	}
 
-	wg.Wait()
-	close(errChan)
-	select {
-	case err := <-errChan:
-		if err != nil {
-			return err
-		}
-	default:
-	}
-	return nil
+	return store.fetchShards(ctx, tasks)
 }
 
 func contains(slice []Location, value Location) bool {
@@ -361,6 +346,8 @@ func (store *P2PStore) performTransfer(ctx context.Context, source uintptr, shar
 		if err != nil {
 			return err
 		}
+		// Best effort, the wait polls the batch otherwise
+		store.transfer.enableBatchCompletionNotify(batchID)
 
 		location := shard.GetLocation(retryCount)
 		if location == nil {
@@ -385,17 +372,9 @@ func (store *P2PStore) performTransfer(ctx context.Context, source uintptr, shar
 			return err
 		}
 
-		var status int
-		for status == STATUS_WAITING || status == STATUS_PENDING {
-			select {
-			case <-ctx.Done():
-				return ctx.Err()
-			default:
-				status, _, err = store.transfer.getTransferStatus(batchID, 0)
-				if err != nil {
-					return err
-				}
-			}
+		status, err := store.transfer.waitBatch(ctx, batchID)
+		if err != nil {
+			return err
 		}
 
 		err = store.transfer.freeBatchID(batchID)
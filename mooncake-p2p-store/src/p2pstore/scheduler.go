@@ -0,0 +1,256 @@
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package p2pstore
+
+import (
+	"context"
+	"sync"
+)
+
+// Bytes read from a single peer at most at any time, over all the replicas
+// being fetched by this store. A batch larger than this still goes out
+// alone once nothing else is in flight to the peer.
+const MAX_INFLIGHT_BYTES_PER_PEER uint64 = 1024 * 1024 * 1024
+
+// Shards submitted to the transfer engine as one batch at most.
+const MAX_SHARDS_PER_BATCH int = 64
+
+// peerLimiter bounds the bytes in flight to every peer segment.
+type peerLimiter struct {
+	mu       sync.Mutex
+	cond     *sync.Cond
+	inflight map[string]uint64
+	limit    uint64
+}
+
+func newPeerLimiter(limit uint64) *peerLimiter {
+	limiter := &peerLimiter{
+		inflight: make(map[string]uint64),
+		limit:    limit,
+	}
+	limiter.cond = sync.NewCond(&limiter.mu)
+	return limiter
+}
+
+func (l *peerLimiter) acquire(peer string, length uint64) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	for l.inflight[peer] > 0 && l.inflight[peer]+length > l.limit {
+		l.cond.Wait()
+	}
+	l.inflight[peer] += length
+}
+
+func (l *peerLimiter) release(peer string, length uint64) {
+	l.mu.Lock()
+	l.inflight[peer] -= length
+	if l.inflight[peer] == 0 {
+		delete(l.inflight, peer)
+	}
+	l.mu.Unlock()
+	l.cond.Broadcast()
+}
+
+// load returns the bytes in flight to the peer.
+func (l *peerLimiter) load(peer string) uint64 {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	return l.inflight[peer]
+}
+
+type shardTask struct {
+	source uintptr
+	shard  Shard
+}
+
+type peerBatch struct {
+	location []Location
+	tasks    []shardTask
+	length   uint64
+}
+
+// planTransfers picks the location of every shard from the peer with the
+// fewest bytes assigned so far, counting what is already in flight to it,
+// and groups the shards of every peer into batches of at most
+// MAX_SHARDS_PER_BATCH shards and MAX_INFLIGHT_BYTES_PER_PEER bytes. Shards
+// without any location are returned apart.
+func (store *P2PStore) planTransfers(tasks []shardTask) (map[string][]*peerBatch, []shardTask) {
+	assigned := make(map[string]uint64)
+	batches := make(map[string][]*peerBatch)
+	var unplaced []shardTask
+	for _, task := range tasks {
+		var best *Location
+		var bestLoad uint64
+		candidates := append(append([]Location{}, task.shard.ReplicaList...), task.shard.Gold...)
+		for i := range candidates {
+			peer := candidates[i].SegmentName
+			if _, ok := assigned[peer]; !ok {
+				assigned[peer] = store.limiter.load(peer)
+			}
+			if best == nil || assigned[peer] < bestLoad {
+				best = &candidates[i]
+				bestLoad = assigned[peer]
+			}
+		}
+		if best == nil {
+			unplaced = append(unplaced, task)
+			continue
+		}
+		peer := best.SegmentName
+		assigned[peer] += task.shard.Length
+
+		list := batches[peer]
+		if len(list) == 0 ||
+			len(list[len(list)-1].tasks) >= MAX_SHARDS_PER_BATCH ||
+			list[len(list)-1].length+task.shard.Length > MAX_INFLIGHT_BYTES_PER_PEER {
+			list = append(list, &peerBatch{})
+			batches[peer] = list
+		}
+		batch := list[len(list)-1]
+		batch.location = append(batch.location, *best)
+		batch.tasks = append(batch.tasks, task)
+		batch.length += task.shard.Length
+	}
+	return batches, unplaced
+}
+
+// runPeerBatch reads the shards of the batch from peer with one
+// submitTransfer and returns the tasks that did not complete.
+func (store *P2PStore) runPeerBatch(ctx context.Context, peer string, batch *peerBatch) ([]shardTask, error) {
+	store.limiter.acquire(peer, batch.length)
+	defer store.limiter.release(peer, batch.length)
+
+	targetID, err := store.transfer.openSegment(peer, true)
+	if err != nil {
+		return batch.tasks, nil
+	}
+
+	batchID, err := store.transfer.allocateBatchID(len(batch.tasks))
+	if err != nil {
+		return nil, err
+	}
+	store.transfer.enableBatchCompletionNotify(batchID)
+
+	requests := make([]TransferRequest, len(batch.tasks))
+	for i, task := range batch.tasks {
+		requests[i] = TransferRequest{
+			Opcode:       OPCODE_READ,
+			Source:       uint64(task.source),
+			TargetID:     targetID,
+			TargetOffset: batch.location[i].Offset,
+			Length:       task.shard.Length,
+		}
+	}
+
+	err = store.transfer.submitTransfer(batchID, requests)
+	if err != nil {
+		store.transfer.freeBatchID(batchID)
+		return batch.tasks, nil
+	}
+
+	status, err := store.transfer.waitBatch(ctx, batchID)
+	if err != nil {
+		return nil, err
+	}
+	var statusList []int
+	for {
+		// A failed task ends the wait early, the others must settle
+		// before the batch is freed
+		statusList, err = store.transfer.getTransferStatusList(batchID, len(batch.tasks))
+		if err != nil {
+			return nil, err
+		}
+		if status == STATUS_COMPLETED || !hasRunningTask(statusList) {
+			break
+		}
+		select {
+		case <-ctx.Done():
+			return nil, ctx.Err()
+		default:
+		}
+	}
+
+	var failed []shardTask
+	for i, task := range batch.tasks {
+		if statusList[i] != STATUS_COMPLETED {
+			failed = append(failed, task)
+		}
+	}
+
+	err = store.transfer.freeBatchID(batchID)
+	if err != nil {
+		return nil, err
+	}
+	return failed, nil
+}
+
+func hasRunningTask(statusList []int) bool {
+	for _, status := range statusList {
+		if status == STATUS_WAITING || status == STATUS_PENDING {
+			return true
+		}
+	}
+	return false
+}
+
+// fetchShards reads all the shards, the batches of every peer one after
+// the other and the peers in parallel. Shards whose batch failed are
+// retried one by one over their other locations.
+func (store *P2PStore) fetchShards(ctx context.Context, tasks []shardTask) error {
+	var wg sync.WaitGroup
+	var mu sync.Mutex
+	var firstErr error
+	batches, failed := store.planTransfers(tasks)
+
+	for peer, list := range batches {
+		wg.Add(1)
+		go func(peer string, list []*peerBatch) {
+			defer wg.Done()
+			for _, batch := range list {
+				retry, err := store.runPeerBatch(ctx, peer, batch)
+				mu.Lock()
+				if err != nil && firstErr == nil {
+					firstErr = err
+				}
+				failed = append(failed, retry...)
+				mu.Unlock()
+				if err != nil {
+					return
+				}
+			}
+		}(peer, list)
+	}
+	wg.Wait()
+	if firstErr != nil {
+		return firstErr
+	}
+
+	for _, task := range failed {
+		wg.Add(1)
+		go func(task shardTask) {
+			defer wg.Done()
+			err := store.performTransfer(ctx, task.source, task.shard)
+			if err != nil {
+				mu.Lock()
+				if firstErr == nil {
+					firstErr = err
+				}
+				mu.Unlock()
+			}
+		}(task)
+	}
+	wg.Wait()
+	return firstErr
+}
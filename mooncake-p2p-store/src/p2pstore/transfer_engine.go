@@ -25,7 +25,10 @@ package p2pstore
 //#include "../../../mooncake-transfer-engine/include/transfer_engine_c.h"
 //#include <stdlib.h>
 import "C"
-import "unsafe"
+import (
+	"context"
+	"unsafe"
+)
 
 type BatchID int64
 
@@ -159,6 +162,55 @@ func (engine *TransferEngine) getTransferStatus(batchID BatchID, taskID int) (in
 	return int(status.status), uint64(status.transferred_bytes), nil
 }
 
+// enableBatchCompletionNotify lets waitBatch sleep on the completion of a
+// batch that has no transfer submitted yet, instead of polling it
+func (engine *TransferEngine) enableBatchCompletionNotify(batchID BatchID) error {
+	ret := C.enableBatchCompletionNotify(engine.engine, C.batch_id_t(batchID))
+	if ret != 0 {
+		return ErrTransferEngine
+	}
+	return nil
+}
+
+const (
+	batchBusyCode = 4
+	waitSliceMs   = 100
+)
+
+// waitBatch blocks in the engine until the batch completes or a task
+// fails, and returns the overall status
+func (engine *TransferEngine) waitBatch(ctx context.Context, batchID BatchID) (int, error) {
+	var status C.transfer_status_t
+	for {
+		ret := C.waitBatchTransfer(engine.engine, C.batch_id_t(batchID), C.int64_t(waitSliceMs), &status)
+		if ret == 0 {
+			return int(status.status), nil
+		}
+		if ret != batchBusyCode {
+			return -1, ErrTransferEngine
+		}
+		select {
+		case <-ctx.Done():
+			return -1, ctx.Err()
+		default:
+		}
+	}
+}
+
+// getTransferStatusList returns the status of the first count tasks
+func (engine *TransferEngine) getTransferStatusList(batchID BatchID, count int) ([]int, error) {
+	statusSlice := make([]C.transfer_status_t, count)
+	ret := C.getTransferStatusList(engine.engine, C.batch_id_t(batchID), &statusSlice[0], C.size_t(count))
+	if ret != 0 {
+		return nil, ErrTransferEngine
+	}
+	statusList := make([]int, count)
+	for i, status := range statusSlice {
+		statusList[i] = int(status.status)
+	}
+	return statusList, nil
+}
+
 func (engine *TransferEngine) freeBatchID(batchID BatchID) error {
 	ret := C.freeBatchID(engine.engine, C.batch_id_t(batchID))
 	if ret != 0 {
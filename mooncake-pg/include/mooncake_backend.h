@@ -5,6 +5,7 @@
 #include <torch/torch.h>
 #include <torch/csrc/distributed/c10d/Backend.hpp>
 #include <transfer_engine.h>
+#include <map>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
@@ -27,6 +28,10 @@ class MooncakeBackend final : public ::c10d::Backend {
 
         at::Tensor activeRanks_;
         bool isExtension_ = false;
+        // Allow the collectives of the CUDA backend to be captured in CUDA
+        // graphs, at the cost of staging every tensor through a fixed
+        // buffer. Uneven alltoalls are not supported.
+        bool graphSafe_ = false;
     };
 
     MooncakeBackend(c10::intrusive_ptr<::c10d::Store> store, int rank, int size,
@@ -71,6 +76,13 @@ class MooncakeBackend final : public ::c10d::Backend {
         std::vector<at::Tensor>& inputTensors,
         const c10d::AllToAllOptions& opts) override;
 
+    // Splits along the first dimension, even ones when the sizes are empty
+    c10::intrusive_ptr<c10d::Work> alltoall_base(
+        at::Tensor& outputBuffer, at::Tensor& inputBuffer,
+        std::vector<int64_t>& outputSplitSizes,
+        std::vector<int64_t>& inputSplitSizes,
+        const c10d::AllToAllOptions& opts) override;
+
     c10::intrusive_ptr<c10d::Work> barrier(
         const c10d::BarrierOptions& opts) override;
 
@@ -110,6 +122,17 @@ class MooncakeBackend final : public ::c10d::Backend {
         return it->second.preferred_hca[0];
     }
 
+    // All the HCAs closest to location, as the topology orders them
+    std::vector<std::string> getPreferredHcas(std::string location) {
+        auto matrix = engine_.getLocalTopology()->getMatrix();
+        auto it = matrix.find(location);
+        if (it == matrix.end()) {
+            LOG(ERROR) << "Topology entry not found for location: " << location;
+            return {};
+        }
+        return it->second.preferred_hca;
+    }
+
     at::Tensor getActiveRanksTensor() { return meta_.activeRanksTensor; }
 
     int getNumSyncedRanks();
@@ -132,26 +155,63 @@ class MooncakeBackend final : public ::c10d::Backend {
         int peerRank;
         int tag;
         int64_t seq;  // Sequence number assigned at enqueue time for ordering
+        // Tensors larger than the transfer buffer are moved as several ops
+        // with consecutive seqs, each covering [offset, offset + length)
+        size_t offset;
+        size_t length;
+        std::shared_ptr<std::atomic<size_t>> pendingChunks;
         std::shared_ptr<std::atomic<bool>> completed;
         std::shared_ptr<std::string> errorMsg;
     };
 
+    // Large allreduces on groups of more than two ranks run as a
+    // reduce-scatter followed by an allgather, so that the traffic per rank
+    // stays about twice the tensor size whatever the group size.
+    bool useTwoShotAllreduce(size_t tensorSize) const;
+    c10::intrusive_ptr<c10d::Work> allreduceTwoShot(
+        at::Tensor tensor, const c10d::AllreduceOptions& opts);
+
+    // When the ranks span several hosts with the same number of ranks each,
+    // large allreduces reduce-scatter within each host, allreduce every
+    // shard across the hosts and allgather within each host again, so that
+    // a rank only sends its shard to the other hosts.
+    bool useHierarchicalAllreduce(size_t tensorSize);
+    c10::intrusive_ptr<c10d::Work> allreduceHierarchical(
+        at::Tensor tensor, const c10d::AllreduceOptions& opts);
+    // Build the peer masks for the current group size, false if the ranks
+    // are not spread evenly over several hosts
+    bool buildTopology();
+    bool allRanksActive() const;
+
+    // Address to write [ptr, ptr + length) of device memory from without
+    // staging it through the send buffer, or 0. The CUDA caching allocator
+    // segment holding it is registered with the engine on first use and
+    // kept registered.
+    uint64_t registeredSendAddr(const void* ptr, size_t length);
+
     void startP2PWorker();
     void stopP2PWorker();
     void p2PSendWorkerThread();
     void p2PRecvWorkerThread();
     void processSendOp(const P2POp& op);
     void processRecvOp(const P2POp& op);
+    // Queue one op per chunk of at most kBufferSize bytes of the tensor
+    void enqueueP2POps(P2POp op, size_t numBytes);
 
     static TransferEngine engine_;
     static bool engineInitialized_;
     static int backendIndex_;
     bool isCpu_{false};
     static std::string hostIp_;
+    // Base address to size of the user segments registered with engine_
+    static std::map<uintptr_t, size_t> registeredSegments_;
+    static std::mutex registeredSegmentsMutex_;
     void* send_buffer_[2];
     void* recv_buffer_[2];
     int32_t* cpu_sync_send_region_[2];
     int32_t* cpu_sync_recv_region_[2];
+    uint64_t* alltoallv_send_region_[2];
+    uint64_t* alltoallv_recv_region_[2];
     int32_t* warmup_send_region_;
     int32_t* warmup_recv_region_;
     static MooncakeWorker worker_;
@@ -160,6 +220,17 @@ class MooncakeBackend final : public ::c10d::Backend {
     bool isShutdown_{false};
     int nextRankForConnection_ = 0;
 
+    // Host of every connected rank, from its server name
+    std::string peerHosts_[kMaxNumRanks];
+    // Group size the topology was built for, and whether it fits
+    int topologySize_ = 0;
+    bool topologyFits_ = false;
+    std::vector<int> localRanks_;  // Ranks on this host by local index
+    bool* localPeers_ = nullptr;   // Ranks on this host
+    bool* nodePeers_ = nullptr;    // Ranks of this local index on any host
+    bool* localPeersDevice_ = nullptr;
+    bool* nodePeersDevice_ = nullptr;
+
     void connectionPoller(c10::intrusive_ptr<::c10d::Store> store,
                           int backendIndex);
 
@@ -21,6 +21,9 @@ static constexpr size_t kP2PSlotSize = kBufferSize / kP2PNumSlots;
 struct SegmentInfo {
     uint64_t send_buffer[2], recv_buffer[2], send_sync[2], recv_sync[2],
         warmup_buffer[2];
+    // Host regions of kMaxNumRanks output addresses exchanged by uneven
+    // alltoalls, see AlltoallvPlan
+    uint64_t alltoallv_send[2], alltoallv_recv[2];
 };
 
 struct TransferGroupMeta {
@@ -42,6 +45,27 @@ struct TransferGroupMeta {
     int64_t p2pSendLowestInFlight[kMaxNumRanks]{};
     int64_t p2pRecvLowestInFlight[kMaxNumRanks]{};
     int64_t p2pRecvNextExpected[kMaxNumRanks]{};
+    // Graph safe groups pick the transfer buffer of each CUDA task on the
+    // device, from the count of their tasks there, and stage the tensors
+    // through fixed buffers. The kernels captured in a CUDA graph then
+    // stay valid whenever it is replayed.
+    bool graphSafe = false;
+    int* bufferSeqDevice = nullptr;
+    void* graphSendStage = nullptr;
+    void* graphRecvStage = nullptr;
+};
+
+// The uneven alltoall of one rank. Its data for peer j is sendLengths[j]
+// bytes at sendAddr + sendOffsets[j], written straight to the address peer j
+// published for this rank. recvAddrs[j] is the address this rank publishes
+// to peer j: where the data of j lands in its registered output. Addresses
+// are published once the stream of the rank reached the op, so that a peer
+// never writes into an output still in use, and are never 0.
+struct AlltoallvPlan {
+    uint64_t sendAddr;
+    uint64_t sendOffsets[kMaxNumRanks];
+    uint64_t sendLengths[kMaxNumRanks];
+    uint64_t recvAddrs[kMaxNumRanks];
 };
 
 __global__ struct Task {
@@ -50,10 +74,40 @@ __global__ struct Task {
     size_t tensorSize;  // In bytes
     int64_t broadcastRoot;
     int bufferOffset;
+    // Registered user memory the chunk is written from instead of the send
+    // buffer when non-zero, the data of peer j starting j * sendStride later
+    uint64_t sendAddr;
+    size_t sendStride;
+    // Ranks the task exchanges with, all the active ones when null
+    const bool* peers;
+    // Uneven alltoall moving the data of plan instead of tensorSize bytes
+    bool alltoallv;
+    AlltoallvPlan plan;
     BatchID batchID;
     void* transferGroupMeta;
 };
 
+// One phase of a collective op. The per-rank tensorSize is moved through the
+// transfer buffers in chunks, each chunk written to the peers as opType does.
+struct TaskPhase {
+    c10d::OpType opType;
+    size_t tensorSize;  // In bytes
+    std::function<void(void* dst, size_t pos, size_t realSize)> tensorToBuffer;
+    std::function<void(void* src, size_t pos, size_t realSize)> bufferToTensor;
+    // When set, chunks are written straight from sendAddr + pos and
+    // tensorToBuffer is not called
+    uint64_t sendAddr = 0;
+    size_t sendStride = 0;
+    // Host mask of the ranks the phase exchanges with, all when null
+    const bool* peers = nullptr;
+};
+
+// Bytes of each rank a task moves at most, the data of rank j sitting at
+// j times the chunk size in the transfer buffers
+inline size_t transferChunkSize(int numRanks) {
+    return ((kBufferSize - 1) / numRanks) & ~(size_t)7;
+}
+
 void launchReduceKernel(at::Tensor dst, size_t pos, size_t realSize, void* src,
                         size_t numRanks, c10d::ReduceOp op, bool* activeRanks,
                         cudaStream_t stream);
@@ -79,7 +133,29 @@ class MooncakeWorker {
         const std::function<void(void* dst, size_t pos, size_t realSize)>&
             tensorToBuffer,
         const std::function<void(void* src, size_t pos, size_t realSize)>&
-            bufferToTensor);
+            bufferToTensor,
+        uint64_t sendAddr = 0, size_t sendStride = 0);
+
+    // Uneven alltoall of the CUDA backend, written from and into registered
+    // tensors without staging. It only moves the data between the ranks:
+    // the caller copies the chunk of this rank itself. afterTransfer is
+    // called once the transfer is enqueued on the stream.
+    c10::intrusive_ptr<c10d::Work> putAlltoallvCuda(
+        TransferGroupMeta* meta, const at::cuda::CUDAStream& stream,
+        const AlltoallvPlan& plan,
+        const std::function<void()>& afterTransfer);
+
+    // Run the phases as a single op, each phase starting once the previous
+    // one completed on all ranks.
+    c10::intrusive_ptr<c10d::Work> putTasksCpu(c10d::OpType opType,
+                                               int64_t broadcastRoot,
+                                               TransferGroupMeta* meta,
+                                               std::vector<TaskPhase> phases);
+
+    c10::intrusive_ptr<c10d::Work> putTasksCuda(
+        c10d::OpType opType, int64_t broadcastRoot, TransferGroupMeta* meta,
+        const at::cuda::CUDAStream& stream,
+        const std::vector<TaskPhase>& phases);
 
     void startWorker();
 
@@ -95,9 +171,14 @@ class MooncakeWorker {
     Task *tasks_, *tasks_device_;
     bool hasCallback_[kNumTasks_]{};
     std::function<void()> callbacks_[kNumTasks_]{};
+    // Run by the worker right after the transfer of the task is posted, so
+    // that draining the previous chunk overlaps with the RDMA writes. The
+    // task only signals its peers once this returned.
+    std::function<void()> afterSubmit_[kNumTasks_]{};
 
     int cpuTaskCount = 0;
-    int cudaTaskCount = 0;
+    // Count of the CUDA tasks in device memory, which picks their slots
+    int* taskSeqDevice_ = nullptr;
 };
 
 }  // namespace mooncake
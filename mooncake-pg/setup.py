@@ -27,6 +27,7 @@ setup(
                 "src/pg_py.cpp",
                 "src/mooncake_backend.cpp",
                 "src/mooncake_worker.cu",
+                "src/mooncake_reduce_cpu.cpp",
                 "src/mooncake_worker_thread.cpp",
             ],
             extra_compile_args={
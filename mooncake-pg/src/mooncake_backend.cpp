@@ -1,4 +1,5 @@
 #include <ATen/cuda/CUDAContext.h>
+#include <c10/cuda/CUDACachingAllocator.h>
 #include <cuda_runtime.h>
 #include <torch/torch.h>
 #include <torch/csrc/distributed/c10d/Backend.hpp>
@@ -7,6 +8,8 @@
 #include <chrono>
 #include <atomic>
 #include <memory>
+#include <algorithm>
+#include <future>
 
 namespace mooncake {
 
@@ -19,12 +22,16 @@ constexpr const char* REDUCE_OP_ERROR_MSG = "Only support SUM.";
 constexpr const char* SPARSE_ERROR_MSG = "Sparse op not supported.";
 constexpr const char* REDUCE_DTYPE_ERROR_MSG = "Unsupported reduce dtype: ";
 constexpr int kBarrierDummyTensorSize = 1;
+// Per-rank traffic an allreduce must save to take a second round
+constexpr size_t kTwoShotAllreduceMinSavedBytes = 1u << 20;
 
 std::string MooncakeBackend::hostIp_ = "127.0.0.1";
 TransferEngine MooncakeBackend::engine_ = TransferEngine(true);
 bool MooncakeBackend::engineInitialized_ = false;
 int MooncakeBackend::backendIndex_ = 0;
 MooncakeWorker MooncakeBackend::worker_;
+std::map<uintptr_t, size_t> MooncakeBackend::registeredSegments_;
+std::mutex MooncakeBackend::registeredSegmentsMutex_;
 
 namespace {
 
@@ -146,6 +153,19 @@ MooncakeBackend::MooncakeBackend(
         TORCH_CHECK(!rc, REGISTER_BUFFER_ERROR_MSG);
     }
 
+    for (size_t i = 0; i < 2; i++) {
+        alltoallv_send_region_[i] = new uint64_t[kMaxNumRanks]{};
+        alltoallv_recv_region_[i] = new uint64_t[kMaxNumRanks]{};
+        int rc = engine_.registerLocalMemory(alltoallv_send_region_[i],
+                                             kMaxNumRanks * sizeof(uint64_t),
+                                             kWildcardLocation);
+        TORCH_CHECK(!rc, REGISTER_BUFFER_ERROR_MSG);
+        rc = engine_.registerLocalMemory(alltoallv_recv_region_[i],
+                                         kMaxNumRanks * sizeof(uint64_t),
+                                         kWildcardLocation);
+        TORCH_CHECK(!rc, REGISTER_BUFFER_ERROR_MSG);
+    }
+
     warmup_send_region_ = new int32_t[kMaxNumRanks];
     warmup_send_region_[0] = 1;
     int rc = engine_.registerLocalMemory(
@@ -167,6 +187,10 @@ MooncakeBackend::MooncakeBackend(
     rank_info.recv_sync[1] = (uint64_t)cpu_sync_recv_region_[1];
     rank_info.warmup_buffer[0] = (uint64_t)warmup_send_region_;
     rank_info.warmup_buffer[1] = (uint64_t)warmup_recv_region_;
+    for (size_t i = 0; i < 2; i++) {
+        rank_info.alltoallv_send[i] = (uint64_t)alltoallv_send_region_[i];
+        rank_info.alltoallv_recv[i] = (uint64_t)alltoallv_recv_region_[i];
+    }
 
     std::vector<uint8_t> rank_info_bytes(sizeof(SegmentInfo));
     memcpy(rank_info_bytes.data(), &rank_info, sizeof(SegmentInfo));
@@ -181,12 +205,12 @@ MooncakeBackend::MooncakeBackend(
 
     int backendIndex = backendIndex_;
 
+    meta_.rank = rank;
+    meta_.size = size;
     std::thread([this, store, backendIndex] {
         connectionPoller(store, backendIndex);
     }).detach();
 
-    meta_.rank = rank;
-    meta_.size = size;
     meta_.taskCount = 0;
     if (isCpu) {
         meta_.activeRanks = new bool[kMaxNumRanks];
@@ -199,6 +223,17 @@ MooncakeBackend::MooncakeBackend(
     for (size_t i = 0; i < kMaxNumRanks; ++i) {
         meta_.activeRanks[i] = true;
     }
+    if (isCpu) {
+        localPeers_ = new bool[kMaxNumRanks]{};
+        nodePeers_ = new bool[kMaxNumRanks]{};
+    } else {
+        cudaHostAlloc(&localPeers_, kMaxNumRanks * sizeof(bool),
+                      cudaHostAllocMapped);
+        cudaHostAlloc(&nodePeers_, kMaxNumRanks * sizeof(bool),
+                      cudaHostAllocMapped);
+        cudaHostGetDevicePointer(&localPeersDevice_, localPeers_, 0);
+        cudaHostGetDevicePointer(&nodePeersDevice_, nodePeers_, 0);
+    }
     if (options) {
         TORCH_CHECK(options->activeRanks_.dtype() == at::kInt,
                     "activeRanks must be int.");
@@ -236,6 +271,18 @@ MooncakeBackend::MooncakeBackend(
         }
     }
 
+    if (options && options->graphSafe_ && !isCpu) {
+        meta_.graphSafe = true;
+        cudaError err = cudaMalloc(&meta_.bufferSeqDevice, sizeof(int));
+        TORCH_CHECK(!err, c10::str("Failed to allocate CUDA task count"));
+        cudaMemcpy(meta_.bufferSeqDevice, &meta_.taskCount, sizeof(int),
+                   cudaMemcpyHostToDevice);
+        err = cudaMalloc(&meta_.graphSendStage, kBufferSize);
+        TORCH_CHECK(!err, c10::str("Failed to allocate CUDA stage buffer"));
+        err = cudaMalloc(&meta_.graphRecvStage, kBufferSize);
+        TORCH_CHECK(!err, c10::str("Failed to allocate CUDA stage buffer"));
+    }
+
     // Increment backend index
     ++backendIndex_;
 
@@ -254,6 +301,13 @@ MooncakeBackend::~MooncakeBackend() {
         }
         meta_.activeRanks = nullptr;
     }
+    if (isCpu_) {
+        delete[] localPeers_;
+        delete[] nodePeers_;
+    } else {
+        cudaFreeHost(localPeers_);
+        cudaFreeHost(nodePeers_);
+    }
 }
 
 const std::string MooncakeBackend::getBackendName() const { return "mooncake"; }
@@ -291,31 +345,18 @@ c10::intrusive_ptr<c10d::Work> MooncakeBackend::send(
     auto contiguous = tensor.contiguous();
     const auto numBytes =
         contiguous.numel() * static_cast<size_t>(contiguous.element_size());
-    TORCH_CHECK(numBytes <= kBufferSize, "P2P send: tensor size ", numBytes,
-                " exceeds total buffer capacity ", kBufferSize, " bytes.");
-
-    const int numSlotsNeeded =
-        static_cast<int>((numBytes + kP2PSlotSize - 1) / kP2PSlotSize);
-    TORCH_CHECK(numSlotsNeeded <= static_cast<int>(kP2PNumSlots),
-                "P2P send: tensor requires ", numSlotsNeeded,
-                " slots, but only ", kP2PNumSlots, " slots available.");
 
     auto completed = std::make_shared<std::atomic<bool>>(false);
     auto errorMsg = std::make_shared<std::string>();
 
-    {
-        std::lock_guard<std::mutex> lock(p2pSendQueueMutex_);
-        const int64_t seq = meta_.p2pSendSeq[dstRank]++;
-        p2pSendQueue_.push(P2POp{.opType = P2POpType::SEND,
-                                 .tensor = contiguous,
-                                 .originalTensor = at::Tensor(),
-                                 .peerRank = dstRank,
-                                 .tag = tag,
-                                 .seq = seq,
-                                 .completed = completed,
-                                 .errorMsg = errorMsg});
-    }
-    p2pSendQueueCv_.notify_one();
+    enqueueP2POps(P2POp{.opType = P2POpType::SEND,
+                        .tensor = contiguous,
+                        .originalTensor = at::Tensor(),
+                        .peerRank = dstRank,
+                        .tag = tag,
+                        .completed = completed,
+                        .errorMsg = errorMsg},
+                  numBytes);
 
     return c10::make_intrusive<MooncakeP2PWork>(completed, errorMsg);
 }
@@ -336,23 +377,88 @@ c10::intrusive_ptr<c10d::Work> MooncakeBackend::recv(
     auto completed = std::make_shared<std::atomic<bool>>(false);
     auto errorMsg = std::make_shared<std::string>();
 
-    {
-        std::lock_guard<std::mutex> lock(p2pRecvQueueMutex_);
-        const int64_t seq = meta_.p2pRecvSeq[srcRank]++;
-        p2pRecvQueue_.push(P2POp{.opType = P2POpType::RECV,
-                                 .tensor = target,
-                                 .originalTensor = tensor,
-                                 .peerRank = srcRank,
-                                 .tag = tag,
-                                 .seq = seq,
-                                 .completed = completed,
-                                 .errorMsg = errorMsg});
-    }
-    p2pRecvQueueCv_.notify_one();
+    enqueueP2POps(P2POp{.opType = P2POpType::RECV,
+                        .tensor = target,
+                        .originalTensor = tensor,
+                        .peerRank = srcRank,
+                        .tag = tag,
+                        .completed = completed,
+                        .errorMsg = errorMsg},
+                  expectedBytes);
 
     return c10::make_intrusive<MooncakeP2PWork>(completed, errorMsg);
 }
 
+void MooncakeBackend::enqueueP2POps(P2POp op, size_t numBytes) {
+    // Both peers split the tensor the same way, so that the chunks pair up
+    // by seq. An empty tensor is still exchanged as a single op.
+    const size_t numChunks =
+        std::max<size_t>(1, (numBytes + kBufferSize - 1) / kBufferSize);
+    op.pendingChunks = std::make_shared<std::atomic<size_t>>(numChunks);
+
+    const bool isSend = op.opType == P2POpType::SEND;
+    auto& mutex = isSend ? p2pSendQueueMutex_ : p2pRecvQueueMutex_;
+    auto& queue = isSend ? p2pSendQueue_ : p2pRecvQueue_;
+    auto& nextSeq =
+        isSend ? meta_.p2pSendSeq[op.peerRank] : meta_.p2pRecvSeq[op.peerRank];
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < numChunks; ++i) {
+            op.seq = nextSeq++;
+            op.offset = i * kBufferSize;
+            op.length = std::min(kBufferSize, numBytes - op.offset);
+            queue.push(op);
+        }
+    }
+    (isSend ? p2pSendQueueCv_ : p2pRecvQueueCv_).notify_one();
+}
+
+uint64_t MooncakeBackend::registeredSendAddr(const void* ptr, size_t length) {
+    // Registering while a graph is captured is not allowed
+    if (isCpu_ || length == 0 || meta_.graphSafe) {
+        return 0;
+    }
+    size_t size = 0;
+    void* base = nullptr;
+    try {
+        base = c10::cuda::CUDACachingAllocator::getBaseAllocation(
+            const_cast<void*>(ptr), &size);
+    } catch (const c10::Error&) {
+        // Not from the caching allocator, or from an expandable segment
+        return 0;
+    }
+    const auto begin = reinterpret_cast<uintptr_t>(base);
+    if (reinterpret_cast<uintptr_t>(ptr) + length > begin + size) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(registeredSegmentsMutex_);
+    auto it = registeredSegments_.find(begin);
+    if (it != registeredSegments_.end() && it->second == size) {
+        return reinterpret_cast<uint64_t>(ptr);
+    }
+    // Registered segments overlapping this one have been freed since
+    it = registeredSegments_.lower_bound(begin);
+    if (it != registeredSegments_.begin()) {
+        --it;
+    }
+    while (it != registeredSegments_.end() && it->first < begin + size) {
+        if (it->first + it->second > begin) {
+            engine_.unregisterLocalMemory(reinterpret_cast<void*>(it->first));
+            it = registeredSegments_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (engine_.registerLocalMemory(base, size, kWildcardLocation)) {
+        LOG_FIRST_N(WARNING, 1) << "Failed to register a user segment of "
+                                << size << " bytes, staging tensors instead";
+        return 0;
+    }
+    registeredSegments_[begin] = size;
+    return reinterpret_cast<uint64_t>(ptr);
+}
+
 c10::intrusive_ptr<c10d::Work> MooncakeBackend::broadcast(
     std::vector<at::Tensor>& tensors, const c10d::BroadcastOptions& opts) {
     TORCH_CHECK(tensors.size() == 1, MULTI_DEVICE_ERROR_MSG);
@@ -385,16 +491,314 @@ c10::intrusive_ptr<c10d::Work> MooncakeBackend::broadcast(
             [=](void* src, size_t pos, size_t realSize) {
                 cudaMemcpyAsync((char*)tensor.data_ptr() + pos, src, realSize,
                                 cudaMemcpyDeviceToDevice, stream);
-            });
+            },
+            isRoot ? registeredSendAddr(tensor.data_ptr(), tensorSize) : 0);
     }
 }
 
+bool MooncakeBackend::useTwoShotAllreduce(size_t tensorSize) const {
+    // Sending every rank the whole tensor costs (n - 1) S per rank, a
+    // reduce-scatter followed by an allgather 2 (n - 1) S / n.
+    const size_t numRanks = meta_.size;
+    if (numRanks <= 2 || (numRanks - 1) * (numRanks - 2) * tensorSize <
+                             numRanks * kTwoShotAllreduceMinSavedBytes) {
+        return false;
+    }
+    // The shard of a broken rank would be lost, so fall back to the one-shot
+    // allreduce which reduces the tensors of the active ranks only
+    return allRanksActive();
+}
+
+bool MooncakeBackend::allRanksActive() const {
+    for (int i = 0; i < meta_.size; ++i) {
+        if (!meta_.activeRanks[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+c10::intrusive_ptr<c10d::Work> MooncakeBackend::allreduceTwoShot(
+    at::Tensor tensor, const c10d::AllreduceOptions& opts) {
+    const size_t numRanks = meta_.size;
+    const size_t tensorSize = tensor.numel() * tensor.element_size();
+    // Rank i reduces bytes [i * shardSize, (i + 1) * shardSize) of the
+    // tensor, the last shards are padded
+    const int64_t shardNumel = (tensor.numel() + numRanks - 1) / numRanks;
+    const size_t shardSize = shardNumel * tensor.element_size();
+    auto shard = at::empty({shardNumel}, tensor.options());
+    // Bytes of shard j at pos inside the tensor
+    auto clip = [=](size_t j, size_t pos, size_t realSize) -> size_t {
+        const size_t begin = j * shardSize + pos;
+        return begin >= tensorSize ? 0
+                                   : std::min(realSize, tensorSize - begin);
+    };
+    auto tensorPtr = [=](size_t j, size_t pos) {
+        return (char*)tensor.data_ptr() + j * shardSize + pos;
+    };
+
+    if (isCpu_) {
+        TaskPhase reduceScatter{
+            c10d::OpType::_REDUCE_SCATTER_BASE, shardSize,
+            [=](void* dst, size_t pos, size_t realSize) {
+                for (const auto j : c10::irange(numRanks)) {
+                    memcpy((char*)dst + j * realSize, tensorPtr(j, pos),
+                           clip(j, pos, realSize));
+                }
+            },
+            [=](void* src, size_t pos, size_t realSize) {
+                launchReduceCpu(shard, pos, realSize, src, numRanks,
+                                opts.reduceOp, meta_.activeRanks);
+            }};
+        TaskPhase allgather{
+            c10d::OpType::_ALLGATHER_BASE, shardSize,
+            [=](void* dst, size_t pos, size_t realSize) {
+                memcpy(dst, (char*)shard.data_ptr() + pos, realSize);
+            },
+            [=](void* src, size_t pos, size_t realSize) {
+                for (const auto j : c10::irange(numRanks)) {
+                    memcpy(tensorPtr(j, pos), (char*)src + j * realSize,
+                           clip(j, pos, realSize));
+                }
+            }};
+        return worker_.putTasksCpu(c10d::OpType::ALLREDUCE, 0, &meta_,
+                                   {reduceScatter, allgather});
+    }
+
+    auto stream = at::cuda::getCurrentCUDAStream(tensor.device().index());
+    TaskPhase reduceScatter{
+        c10d::OpType::_REDUCE_SCATTER_BASE, shardSize,
+        [=](void* dst, size_t pos, size_t realSize) {
+            for (const auto j : c10::irange(numRanks)) {
+                cudaMemcpyAsync((char*)dst + j * realSize, tensorPtr(j, pos),
+                                clip(j, pos, realSize),
+                                cudaMemcpyDeviceToDevice, stream);
+            }
+        },
+        [=](void* src, size_t pos, size_t realSize) {
+            launchReduceKernel(shard, pos, realSize, src, numRanks,
+                               opts.reduceOp, meta_.activeRanksDevice, stream);
+        }};
+    TaskPhase allgather{
+        c10d::OpType::_ALLGATHER_BASE, shardSize,
+        [=](void* dst, size_t pos, size_t realSize) {
+            cudaMemcpyAsync(dst, (char*)shard.data_ptr() + pos, realSize,
+                            cudaMemcpyDeviceToDevice, stream);
+        },
+        [=](void* src, size_t pos, size_t realSize) {
+            for (const auto j : c10::irange(numRanks)) {
+                cudaMemcpyAsync(tensorPtr(j, pos), (char*)src + j * realSize,
+                                clip(j, pos, realSize),
+                                cudaMemcpyDeviceToDevice, stream);
+            }
+        }};
+    return worker_.putTasksCuda(c10d::OpType::ALLREDUCE, 0, &meta_, stream,
+                                {reduceScatter, allgather});
+}
+
+bool MooncakeBackend::buildTopology() {
+    if (topologySize_ == meta_.size) {
+        return topologyFits_;
+    }
+    std::vector<std::string> hosts;
+    std::vector<std::vector<int>> hostRanks;
+    for (int j = 0; j < meta_.size; ++j) {
+        if (peerHosts_[j].empty()) {
+            return false;
+        }
+        auto it = std::find(hosts.begin(), hosts.end(), peerHosts_[j]);
+        if (it == hosts.end()) {
+            hosts.push_back(peerHosts_[j]);
+            hostRanks.emplace_back();
+            it = hosts.end() - 1;
+        }
+        hostRanks[it - hosts.begin()].push_back(j);
+    }
+    topologySize_ = meta_.size;
+    topologyFits_ = false;
+
+    const size_t numLocalRanks = hostRanks[0].size();
+    if (hosts.size() < 2 || numLocalRanks < 2) {
+        return false;
+    }
+    for (const auto& ranks : hostRanks) {
+        if (ranks.size() != numLocalRanks) {
+            return false;
+        }
+    }
+    const auto host =
+        std::find(hosts.begin(), hosts.end(), peerHosts_[rank_]) -
+        hosts.begin();
+    localRanks_ = hostRanks[host];
+    const auto localIndex =
+        std::find(localRanks_.begin(), localRanks_.end(), rank_) -
+        localRanks_.begin();
+    std::fill(localPeers_, localPeers_ + kMaxNumRanks, false);
+    std::fill(nodePeers_, nodePeers_ + kMaxNumRanks, false);
+    for (const int j : localRanks_) {
+        localPeers_[j] = true;
+    }
+    for (const auto& ranks : hostRanks) {
+        nodePeers_[ranks[localIndex]] = true;
+    }
+    topologyFits_ = true;
+    return true;
+}
+
+bool MooncakeBackend::useHierarchicalAllreduce(size_t tensorSize) {
+    if (!buildTopology()) {
+        return false;
+    }
+    // The one-shot allreduce sends the whole tensor to every rank on the
+    // other hosts, the hierarchical one sends a shard to one rank per host
+    const size_t numRanks = meta_.size;
+    const size_t numLocalRanks = localRanks_.size();
+    const size_t numHosts = numRanks / numLocalRanks;
+    if ((numRanks - numLocalRanks) * tensorSize <
+        (numHosts - 1) * tensorSize / numLocalRanks +
+            kTwoShotAllreduceMinSavedBytes) {
+        return false;
+    }
+    // The shards of a broken rank would be lost
+    return allRanksActive();
+}
+
+c10::intrusive_ptr<c10d::Work> MooncakeBackend::allreduceHierarchical(
+    at::Tensor tensor, const c10d::AllreduceOptions& opts) {
+    const size_t numRanks = meta_.size;
+    const size_t numLocalRanks = localRanks_.size();
+    const size_t tensorSize = tensor.numel() * tensor.element_size();
+    // Local rank i reduces bytes [i * shardSize, (i + 1) * shardSize) of
+    // the tensor. A rank only waits for the peers of its current phase, so
+    // it may already write the next phase while its peers in that phase
+    // still drain the current one. Shards larger than a chunk are padded to
+    // whole chunks, so that every chunk of the op has the same size and
+    // lands at the same offsets in the recv buffers.
+    const size_t chunkSize = transferChunkSize(numRanks);
+    size_t shardSize = (tensor.numel() + numLocalRanks - 1) / numLocalRanks *
+                       tensor.element_size();
+    if (shardSize > chunkSize) {
+        shardSize = (shardSize + chunkSize - 1) / chunkSize * chunkSize;
+    }
+    auto shard = at::empty(
+        {static_cast<int64_t>(shardSize / tensor.element_size())},
+        tensor.options());
+    const auto localRanks = localRanks_;
+    auto clip = [=](size_t i, size_t pos, size_t realSize) -> size_t {
+        const size_t begin = i * shardSize + pos;
+        return begin >= tensorSize ? 0
+                                   : std::min(realSize, tensorSize - begin);
+    };
+    auto tensorPtr = [=](size_t i, size_t pos) {
+        return (char*)tensor.data_ptr() + i * shardSize + pos;
+    };
+    // The barriers keep the ranks of other hosts from writing this op into
+    // buffers still drained for the previous one, and the next op into
+    // buffers still drained for this one
+    TaskPhase barrier{c10d::OpType::BARRIER, kBarrierDummyTensorSize,
+                      [](void*, size_t, size_t) {},
+                      [](void*, size_t, size_t) {}};
+
+    if (isCpu_) {
+        TaskPhase reduceScatter{
+            c10d::OpType::_REDUCE_SCATTER_BASE, shardSize,
+            [=](void* dst, size_t pos, size_t realSize) {
+                for (const auto i : c10::irange(numLocalRanks)) {
+                    memcpy((char*)dst + localRanks[i] * realSize,
+                           tensorPtr(i, pos), clip(i, pos, realSize));
+                }
+            },
+            [=](void* src, size_t pos, size_t realSize) {
+                launchReduceCpu(shard, pos, realSize, src, numRanks,
+                                opts.reduceOp, localPeers_);
+            }};
+        reduceScatter.peers = localPeers_;
+        TaskPhase crossHost{
+            c10d::OpType::ALLREDUCE, shardSize,
+            [=](void* dst, size_t pos, size_t realSize) {
+                memcpy(dst, (char*)shard.data_ptr() + pos, realSize);
+            },
+            [=](void* src, size_t pos, size_t realSize) {
+                launchReduceCpu(shard, pos, realSize, src, numRanks,
+                                opts.reduceOp, nodePeers_);
+            }};
+        crossHost.peers = nodePeers_;
+        TaskPhase allgather{
+            c10d::OpType::_ALLGATHER_BASE, shardSize,
+            [=](void* dst, size_t pos, size_t realSize) {
+                memcpy(dst, (char*)shard.data_ptr() + pos, realSize);
+            },
+            [=](void* src, size_t pos, size_t realSize) {
+                for (const auto i : c10::irange(numLocalRanks)) {
+                    memcpy(tensorPtr(i, pos),
+                           (char*)src + localRanks[i] * realSize,
+                           clip(i, pos, realSize));
+                }
+            }};
+        allgather.peers = localPeers_;
+        return worker_.putTasksCpu(
+            c10d::OpType::ALLREDUCE, 0, &meta_,
+            {barrier, reduceScatter, crossHost, allgather, barrier});
+    }
+
+    auto stream = at::cuda::getCurrentCUDAStream(tensor.device().index());
+    TaskPhase reduceScatter{
+        c10d::OpType::_REDUCE_SCATTER_BASE, shardSize,
+        [=](void* dst, size_t pos, size_t realSize) {
+            for (const auto i : c10::irange(numLocalRanks)) {
+                cudaMemcpyAsync((char*)dst + localRanks[i] * realSize,
+                                tensorPtr(i, pos), clip(i, pos, realSize),
+                                cudaMemcpyDeviceToDevice, stream);
+            }
+        },
+        [=](void* src, size_t pos, size_t realSize) {
+            launchReduceKernel(shard, pos, realSize, src, numRanks,
+                               opts.reduceOp, localPeersDevice_, stream);
+        }};
+    reduceScatter.peers = localPeers_;
+    TaskPhase crossHost{
+        c10d::OpType::ALLREDUCE, shardSize,
+        [=](void* dst, size_t pos, size_t realSize) {
+            cudaMemcpyAsync(dst, (char*)shard.data_ptr() + pos, realSize,
+                            cudaMemcpyDeviceToDevice, stream);
+        },
+        [=](void* src, size_t pos, size_t realSize) {
+            launchReduceKernel(shard, pos, realSize, src, numRanks,
+                               opts.reduceOp, nodePeersDevice_, stream);
+        }};
+    crossHost.peers = nodePeers_;
+    TaskPhase allgather{
+        c10d::OpType::_ALLGATHER_BASE, shardSize,
+        [=](void* dst, size_t pos, size_t realSize) {
+            cudaMemcpyAsync(dst, (char*)shard.data_ptr() + pos, realSize,
+                            cudaMemcpyDeviceToDevice, stream);
+        },
+        [=](void* src, size_t pos, size_t realSize) {
+            for (const auto i : c10::irange(numLocalRanks)) {
+                cudaMemcpyAsync(tensorPtr(i, pos),
+                                (char*)src + localRanks[i] * realSize,
+                                clip(i, pos, realSize),
+                                cudaMemcpyDeviceToDevice, stream);
+            }
+        }};
+    allgather.peers = localPeers_;
+    return worker_.putTasksCuda(
+        c10d::OpType::ALLREDUCE, 0, &meta_, stream,
+        {barrier, reduceScatter, crossHost, allgather, barrier});
+}
+
 c10::intrusive_ptr<c10d::Work> MooncakeBackend::allreduce(
     std::vector<at::Tensor>& tensors, const c10d::AllreduceOptions& opts) {
     TORCH_CHECK(tensors.size() == 1, MULTI_DEVICE_ERROR_MSG);
     TORCH_CHECK(opts.sparseIndices == std::nullopt, SPARSE_ERROR_MSG);
     auto tensor = tensors.back();
     size_t tensorSize = tensor.numel() * tensor.element_size();
+    if (useHierarchicalAllreduce(tensorSize)) {
+        return allreduceHierarchical(tensor, opts);
+    }
+    if (useTwoShotAllreduce(tensorSize)) {
+        return allreduceTwoShot(tensor, opts);
+    }
     if (isCpu_) {
         auto numRanks = meta_.size;
         return worker_.putTaskCpu(
@@ -460,7 +864,8 @@ c10::intrusive_ptr<c10d::Work> MooncakeBackend::allgather(
                                     (char*)src + j * realSize, realSize,
                                     cudaMemcpyDeviceToDevice, stream);
                 }
-            });
+            },
+            registeredSendAddr(inputTensor.data_ptr(), tensorSize));
     }
 }
 
@@ -498,7 +903,8 @@ c10::intrusive_ptr<c10d::Work> MooncakeBackend::_allgather_base(
                         (char*)src + j * realSize, realSize,
                         cudaMemcpyDeviceToDevice, stream);
                 }
-            });
+            },
+            registeredSendAddr(inputBuffer.data_ptr(), tensorSize));
     }
 }
 
@@ -568,6 +974,17 @@ c10::intrusive_ptr<c10d::Work> MooncakeBackend::alltoall(
     } else {
         auto stream =
             at::cuda::getCurrentCUDAStream(inputTensors[0].device().index());
+        // The inputs can be written straight from a split of one tensor
+        const char* inputBase = (const char*)inputTensors[0].data_ptr();
+        bool adjacent = true;
+        for (const auto j : c10::irange(inputTensors.size())) {
+            adjacent &= (const char*)inputTensors[j].data_ptr() ==
+                        inputBase + j * tensorSize;
+        }
+        uint64_t sendAddr =
+            adjacent ? registeredSendAddr(inputBase,
+                                          inputTensors.size() * tensorSize)
+                     : 0;
         return worker_.putTaskCuda(
             c10d::OpType::ALLTOALL, tensorSize, 0, &meta_, stream,
             [=](void* dst, size_t pos, size_t realSize) {
@@ -583,9 +1000,133 @@ c10::intrusive_ptr<c10d::Work> MooncakeBackend::alltoall(
                                     (char*)src + j * realSize, realSize,
                                     cudaMemcpyDeviceToDevice, stream);
                 }
+            },
+            sendAddr, tensorSize);
+    }
+}
+
+c10::intrusive_ptr<c10d::Work> MooncakeBackend::alltoall_base(
+    at::Tensor& outputBuffer, at::Tensor& inputBuffer,
+    std::vector<int64_t>& outputSplitSizes,
+    std::vector<int64_t>& inputSplitSizes,
+    const c10d::AllToAllOptions& opts) {
+    const int numRanks = meta_.size;
+    TORCH_CHECK(inputBuffer.is_contiguous() && outputBuffer.is_contiguous(),
+                "alltoall_base expects contiguous tensors.");
+    // Byte offset and length of the split of every rank
+    auto splitBytes = [numRanks](const at::Tensor& tensor,
+                                 const std::vector<int64_t>& splitSizes,
+                                 std::vector<size_t>& offsets,
+                                 std::vector<size_t>& lengths) {
+        const size_t numBytes = tensor.numel() * tensor.element_size();
+        const size_t numRows = tensor.size(0);
+        const size_t rowBytes = numRows ? numBytes / numRows : 0;
+        TORCH_CHECK(splitSizes.empty() || (int)splitSizes.size() == numRanks,
+                    "Expecting one split size per rank.");
+        TORCH_CHECK(!splitSizes.empty() || numRows % numRanks == 0,
+                    "Tensor's dim 0 does not divide equally across group "
+                    "size.");
+        offsets.resize(numRanks);
+        lengths.resize(numRanks);
+        size_t offset = 0;
+        for (int j = 0; j < numRanks; ++j) {
+            size_t numSplitRows =
+                splitSizes.empty() ? numRows / numRanks : splitSizes[j];
+            offsets[j] = offset;
+            lengths[j] = numSplitRows * rowBytes;
+            offset += lengths[j];
+        }
+        TORCH_CHECK(offset <= numBytes, "Split sizes exceed the tensor.");
+    };
+    std::vector<size_t> inputOffsets, inputLengths, outputOffsets,
+        outputLengths;
+    splitBytes(inputBuffer, inputSplitSizes, inputOffsets, inputLengths);
+    splitBytes(outputBuffer, outputSplitSizes, outputOffsets, outputLengths);
+
+    if (isCpu_) {
+        // Staged like alltoall, each rank padded to the largest split of
+        // the group, which takes one more round trip to learn
+        size_t maxBytes =
+            std::max(*std::max_element(inputLengths.begin(),
+                                       inputLengths.end()),
+                     *std::max_element(outputLengths.begin(),
+                                       outputLengths.end()));
+        std::vector<at::Tensor> maxTensor{
+            at::tensor({(int64_t)maxBytes}, at::kLong)};
+        c10d::AllreduceOptions maxOpts;
+        maxOpts.reduceOp = c10d::ReduceOp::MAX;
+        allreduce(maxTensor, maxOpts)->wait();
+        maxBytes = maxTensor[0].item<int64_t>();
+
+        auto clip = [](size_t length, size_t pos, size_t realSize) {
+            return pos < length ? std::min(realSize, length - pos) : 0;
+        };
+        return worker_.putTaskCpu(
+            c10d::OpType::ALLTOALL_BASE, maxBytes, 0, &meta_,
+            [=](void* dst, size_t pos, size_t realSize) {
+                for (const auto j : c10::irange(numRanks)) {
+                    memcpy((char*)dst + j * realSize,
+                           (char*)inputBuffer.data_ptr() + inputOffsets[j] +
+                               pos,
+                           clip(inputLengths[j], pos, realSize));
+                }
+            },
+            [=](void* src, size_t pos, size_t realSize) {
+                for (const auto j : c10::irange(numRanks)) {
+                    memcpy((char*)outputBuffer.data_ptr() + outputOffsets[j] +
+                               pos,
+                           (char*)src + j * realSize,
+                           clip(outputLengths[j], pos, realSize));
+                }
             });
     }
+
+    TORCH_CHECK(!meta_.graphSafe,
+                "alltoall_base is not supported in graph safe mode.");
+    // Every split is written straight from the input into the output of
+    // its rank, so both must be registered. Tensors outside the caching
+    // allocator are replaced by registered copies.
+    auto stream = at::cuda::getCurrentCUDAStream(inputBuffer.device().index());
+    const size_t inputBytes = inputBuffer.numel() * inputBuffer.element_size();
+    const size_t outputBytes =
+        outputBuffer.numel() * outputBuffer.element_size();
+    at::Tensor input = inputBuffer;
+    uint64_t sendAddr = registeredSendAddr(input.data_ptr(), inputBytes);
+    if (!sendAddr && inputBytes) {
+        input = inputBuffer.clone();
+        sendAddr = registeredSendAddr(input.data_ptr(), inputBytes);
+        TORCH_CHECK(sendAddr, REGISTER_BUFFER_ERROR_MSG);
+    }
+    at::Tensor output = outputBuffer;
+    uint64_t recvAddr = registeredSendAddr(output.data_ptr(), outputBytes);
+    if (!recvAddr && outputBytes) {
+        output = at::empty_like(outputBuffer);
+        recvAddr = registeredSendAddr(output.data_ptr(), outputBytes);
+        TORCH_CHECK(recvAddr, REGISTER_BUFFER_ERROR_MSG);
+    }
+
+    AlltoallvPlan plan{};
+    plan.sendAddr = sendAddr;
+    for (const auto j : c10::irange(numRanks)) {
+        plan.sendOffsets[j] = inputOffsets[j];
+        plan.sendLengths[j] = j == rank_ ? 0 : inputLengths[j];
+        // Nothing is written to an empty split, any non-zero address does
+        plan.recvAddrs[j] = outputLengths[j]
+                                ? recvAddr + outputOffsets[j]
+                                : rank_info.recv_buffer[0];
+    }
+    cudaMemcpyAsync((char*)output.data_ptr() + outputOffsets[rank_],
+                    (char*)input.data_ptr() + inputOffsets[rank_],
+                    std::min(inputLengths[rank_], outputLengths[rank_]),
+                    cudaMemcpyDeviceToDevice, stream);
+    return worker_.putAlltoallvCuda(&meta_, stream, plan, [=]() {
+        if (!output.is_same(outputBuffer)) {
+            cudaMemcpyAsync(outputBuffer.data_ptr(), output.data_ptr(),
+                            outputBytes, cudaMemcpyDeviceToDevice, stream);
+        }
+    });
 }
+
 c10::intrusive_ptr<c10d::Work> MooncakeBackend::barrier(
     const c10d::BarrierOptions& opts) {
     TORCH_CHECK(isCpu_, "Barrier is available only for CPU.")
@@ -750,6 +1291,10 @@ void MooncakeBackend::shutdown() {
         engine_.unregisterLocalMemory(recv_buffer_[i]);
         delete[] cpu_sync_send_region_[i];
         delete[] cpu_sync_recv_region_[i];
+        engine_.unregisterLocalMemory(alltoallv_send_region_[i]);
+        engine_.unregisterLocalMemory(alltoallv_recv_region_[i]);
+        delete[] alltoallv_send_region_[i];
+        delete[] alltoallv_recv_region_[i];
         if (isCpu_) {
             free(send_buffer_[i]);
             free(recv_buffer_[i]);
@@ -758,6 +1303,11 @@ void MooncakeBackend::shutdown() {
             cudaFree(recv_buffer_[i]);
         }
     }
+    if (meta_.graphSafe) {
+        cudaFree(meta_.bufferSeqDevice);
+        cudaFree(meta_.graphSendStage);
+        cudaFree(meta_.graphRecvStage);
+    }
 }
 
 int MooncakeBackend::getNumSyncedRanks() {
@@ -844,74 +1394,147 @@ void MooncakeBackend::recoverRanks(const std::vector<int>& ranks) {
 
 void MooncakeBackend::connectionPoller(c10::intrusive_ptr<::c10d::Store> store,
                                        int backendIndex) {
+    auto serverNameKey = [backendIndex](int rank) {
+        return "server_name_" + std::to_string(backendIndex) + "_" +
+               std::to_string(rank);
+    };
+    auto bufferKey = [backendIndex](int rank) {
+        return "buffer_" + std::to_string(backendIndex) + "_" +
+               std::to_string(rank);
+    };
     while (!isShutdown_) {
-        for (int pollingRank = 0; pollingRank <= nextRankForConnection_;
-             ++pollingRank) {
-            if (meta_.peerConnected[pollingRank]) {
-                continue;
+        // Besides the ranks of the group, probe the rank past the connected
+        // ones for ranks joining an extended group
+        const int limit = std::min<int>(
+            kMaxNumRanks,
+            std::max({size_, meta_.size, nextRankForConnection_ + 1}));
+        std::vector<int> pending;
+        std::vector<std::string> pendingKeys;
+        for (int rank = 0; rank < limit; ++rank) {
+            if (!meta_.peerConnected[rank]) {
+                pending.push_back(rank);
+                pendingKeys.push_back(serverNameKey(rank));
             }
-            std::string serverNameKey = "server_name_" +
-                                        std::to_string(backendIndex) + "_" +
-                                        std::to_string(pollingRank);
-            try {
-                if (!store->check({serverNameKey})) {
-                    continue;
+        }
+        if (pending.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+
+        // Once every pending rank has published its metadata, which is the
+        // usual case at startup and recovery, a single check does
+        std::vector<int> ready;
+        try {
+            if (store->check(pendingKeys)) {
+                ready = pending;
+            } else {
+                for (size_t i = 0; i < pending.size(); ++i) {
+                    if (store->check({pendingKeys[i]})) {
+                        ready.push_back(pending[i]);
+                    }
                 }
-            } catch (const std::exception& e) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                continue;
-            }
-            if (isShutdown_) {
-                break;
             }
-            auto peerServerName = store->get_to_str(serverNameKey);
-            auto segment_id = engine_.openSegment(peerServerName);
-            meta_.segmentIDs[pollingRank] = segment_id;
-            std::string buffer_key = "buffer_" + std::to_string(backendIndex) +
-                                     "_" + std::to_string(pollingRank);
-            auto buffer_data = store->get(buffer_key);
-            memcpy(&meta_.segmentInfos[pollingRank], buffer_data.data(),
-                   sizeof(SegmentInfo));
+        } catch (const std::exception& e) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+        if (isShutdown_) {
+            break;
+        }
+        if (ready.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+
+        // Fetch the metadata of all of them in one round trip
+        std::vector<std::string> keys;
+        for (const int rank : ready) {
+            keys.push_back(serverNameKey(rank));
+            keys.push_back(bufferKey(rank));
+        }
+        std::vector<std::vector<uint8_t>> values;
+        try {
+            values = store->multiGet(keys);
+        } catch (const std::exception& e) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
 
-            if (pollingRank <= rank_) {
-                // Send a pre-flight request to establish connections
-                std::vector<TransferRequest> entries;
-                auto batchID = engine_.allocateBatchID(1);
-                engine_.submitTransfer(
-                    batchID,
-                    {TransferRequest{
-                        .opcode = TransferRequest::WRITE,
-                        .source = warmup_send_region_,
-                        .target_id = meta_.segmentIDs[pollingRank],
-                        .target_offset =
-                            meta_.segmentInfos[pollingRank].warmup_buffer[1] +
-                            rank_ * sizeof(int32_t),
-                        .length = sizeof(int32_t),
-                    }});
+        // Handshake with all of them in parallel
+        std::vector<std::future<void>> handshakes;
+        for (size_t i = 0; i < ready.size(); ++i) {
+            const int rank = ready[i];
+            std::string peerServerName(values[2 * i].begin(),
+                                       values[2 * i].end());
+            peerHosts_[rank] =
+                peerServerName.substr(0, peerServerName.rfind(':'));
+            memcpy(&meta_.segmentInfos[rank], values[2 * i + 1].data(),
+                   sizeof(SegmentInfo));
+            handshakes.push_back(std::async(
+                std::launch::async, [this, rank, peerServerName] {
+                    meta_.segmentIDs[rank] =
+                        engine_.openSegment(peerServerName);
+                }));
+        }
+        for (auto& handshake : handshakes) {
+            handshake.wait();
+        }
 
+        // Send the pre-flight requests establishing the connections to the
+        // lower ranks as one batch, and wait for those of the higher ones
+        std::vector<TransferRequest> entries;
+        std::vector<int> warmupRanks;
+        std::vector<int> waitingRanks;
+        for (const int rank : ready) {
+            if (rank > rank_) {
+                waitingRanks.push_back(rank);
+                continue;
+            }
+            warmupRanks.push_back(rank);
+            entries.push_back(TransferRequest{
+                .opcode = TransferRequest::WRITE,
+                .source = warmup_send_region_,
+                .target_id = meta_.segmentIDs[rank],
+                .target_offset = meta_.segmentInfos[rank].warmup_buffer[1] +
+                                 rank_ * sizeof(int32_t),
+                .length = sizeof(int32_t),
+            });
+        }
+        if (!entries.empty()) {
+            auto batchID = engine_.allocateBatchID(entries.size());
+            engine_.submitTransfer(batchID, entries);
+            for (size_t i = 0; i < entries.size(); ++i) {
                 while (true) {
                     TransferStatus status;
-                    engine_.getTransferStatus(batchID, 0, status);
+                    engine_.getTransferStatus(batchID, i, status);
                     if (status.s == TransferStatusEnum::COMPLETED) {
                         break;
                     } else if (status.s == TransferStatusEnum::FAILED) {
                         LOG(WARNING) << "Warmup request " << rank_ << " -> "
-                                     << pollingRank << " failed.";
+                                     << warmupRanks[i] << " failed.";
                         break;
                     }
                 }
-            } else {
-                // Wait for the warmup signals
-                while (!warmup_recv_region_[pollingRank]) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                }
-            }
-            meta_.peerConnected[pollingRank] = true;
-            if (pollingRank == nextRankForConnection_) {
-                ++nextRankForConnection_;
             }
+            engine_.freeBatchID(batchID);
+        }
+        for (const int rank : warmupRanks) {
+            meta_.peerConnected[rank] = true;
+        }
+        while (!waitingRanks.empty() && !isShutdown_) {
+            std::erase_if(waitingRanks, [this](int rank) {
+                if (!warmup_recv_region_[rank]) {
+                    return false;
+                }
+                meta_.peerConnected[rank] = true;
+                return true;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        while (nextRankForConnection_ < kMaxNumRanks &&
+               meta_.peerConnected[nextRankForConnection_]) {
+            ++nextRankForConnection_;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
 }
 
@@ -963,9 +1586,15 @@ void MooncakeBackend::p2PSendWorkerThread() {
             p2pSendQueue_.pop();
         }
 
+        // The remaining chunks of a failed op are dropped
+        if (!op.errorMsg->empty()) {
+            continue;
+        }
         try {
             processSendOp(op);
-            op.completed->store(true, std::memory_order_release);
+            if (op.pendingChunks->fetch_sub(1) == 1) {
+                op.completed->store(true, std::memory_order_release);
+            }
         } catch (const std::exception& e) {
             *op.errorMsg = e.what();
             op.completed->store(true, std::memory_order_release);
@@ -1017,7 +1646,9 @@ void MooncakeBackend::p2PRecvWorkerThread() {
             try {
                 processRecvOp(op);
                 meta_.p2pRecvNextExpected[op.peerRank] = op.seq + 1;
-                op.completed->store(true, std::memory_order_release);
+                if (op.pendingChunks->fetch_sub(1) == 1) {
+                    op.completed->store(true, std::memory_order_release);
+                }
             } catch (const std::exception& e) {
                 *op.errorMsg = e.what();
                 op.completed->store(true, std::memory_order_release);
@@ -1035,8 +1666,7 @@ void MooncakeBackend::processSendOp(const P2POp& op) {
     int tag = op.tag;
     int64_t seq = op.seq;
 
-    const auto numBytes =
-        tensor.numel() * static_cast<size_t>(tensor.element_size());
+    const size_t numBytes = op.length;
 
     const int numSlotsNeeded =
         static_cast<int>((numBytes + kP2PSlotSize - 1) / kP2PSlotSize);
@@ -1082,11 +1712,12 @@ void MooncakeBackend::processSendOp(const P2POp& op) {
     void* sendBuf = reinterpret_cast<void*>(sendAddr);
 
     if (isCpu_) {
-        std::memcpy(sendBuf, tensor.data_ptr(), numBytes);
+        std::memcpy(sendBuf, (char*)tensor.data_ptr() + op.offset, numBytes);
     } else {
         auto stream = at::cuda::getCurrentCUDAStream(tensor.device().index());
-        auto err = cudaMemcpyAsync(sendBuf, tensor.data_ptr(), numBytes,
-                                   cudaMemcpyDeviceToDevice, stream);
+        auto err =
+            cudaMemcpyAsync(sendBuf, (char*)tensor.data_ptr() + op.offset,
+                            numBytes, cudaMemcpyDeviceToDevice, stream);
         TORCH_CHECK(
             !err, "P2P send cudaMemcpyAsync failed: ", cudaGetErrorString(err));
         cudaStreamSynchronize(stream);
@@ -1125,8 +1756,7 @@ void MooncakeBackend::processRecvOp(const P2POp& op) {
     int tag = op.tag;
     int64_t seq = op.seq;
 
-    const auto expectedBytes =
-        tensor.numel() * static_cast<size_t>(tensor.element_size());
+    const size_t expectedBytes = op.length;
 
     int baseSlot = static_cast<int>(seq % kP2PNumSlots);
 
@@ -1222,17 +1852,21 @@ void MooncakeBackend::processRecvOp(const P2POp& op) {
     void* recvBuf = reinterpret_cast<void*>(recvAddr);
 
     if (isCpu_) {
-        std::memcpy(tensor.data_ptr(), recvBuf, numBytes);
+        std::memcpy((char*)tensor.data_ptr() + op.offset, recvBuf, numBytes);
     } else {
         auto stream = at::cuda::getCurrentCUDAStream(tensor.device().index());
-        auto err = cudaMemcpyAsync(tensor.data_ptr(), recvBuf, numBytes,
-                                   cudaMemcpyDeviceToDevice, stream);
+        auto err = cudaMemcpyAsync((char*)tensor.data_ptr() + op.offset,
+                                   recvBuf, numBytes, cudaMemcpyDeviceToDevice,
+                                   stream);
         TORCH_CHECK(
             !err, "P2P recv cudaMemcpyAsync failed: ", cudaGetErrorString(err));
         cudaStreamSynchronize(stream);
     }
 
-    if (!op.originalTensor.is_contiguous()) {
+    const bool lastChunk = op.offset + numBytes ==
+                           tensor.numel() * static_cast<size_t>(
+                                                tensor.element_size());
+    if (lastChunk && !op.originalTensor.is_contiguous()) {
         op.originalTensor.copy_(tensor);
     }
 
@@ -0,0 +1,193 @@
+#include <mooncake_worker.cuh>
+#include <ATen/Parallel.h>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace mooncake {
+
+namespace {
+
+// Elements per block, the accumulated block and the block of the rank being
+// combined into it stay in L1
+constexpr int64_t kReduceBlockSize = 2048;
+
+// Wheels are built for the baseline ISA, so the combine loops are compiled
+// once per vector extension and picked at load time. aarch64 always has NEON.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MOONCAKE_REDUCE_TARGETS \
+    __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define MOONCAKE_REDUCE_TARGETS
+#endif
+
+template <typename T>
+struct SumOp {
+    T operator()(T a, T b) const { return a + b; }
+};
+
+template <typename T>
+struct ProductOp {
+    T operator()(T a, T b) const { return a * b; }
+};
+
+template <>
+struct ProductOp<bool> {
+    bool operator()(bool a, bool b) const { return a && b; }
+};
+
+template <typename T>
+struct MinOp {
+    T operator()(T a, T b) const { return b < a ? b : a; }
+};
+
+template <typename T>
+struct MaxOp {
+    T operator()(T a, T b) const { return a < b ? b : a; }
+};
+
+// bf16 and fp16 are accumulated in float and rounded once
+template <typename T>
+using AccType = std::conditional_t<std::is_same_v<T, at::BFloat16> ||
+                                       std::is_same_v<T, at::Half>,
+                                   float, T>;
+
+template <typename T, template <typename> class Op>
+MOONCAKE_REDUCE_TARGETS void combineBlock(T* __restrict acc,
+                                          const T* __restrict src,
+                                          int64_t n) {
+    const Op<T> op;
+    for (int64_t i = 0; i < n; ++i) {
+        acc[i] = op(acc[i], src[i]);
+    }
+}
+
+template <typename From, typename To>
+MOONCAKE_REDUCE_TARGETS void convertBlock(To* __restrict dst,
+                                          const From* __restrict src,
+                                          int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+        dst[i] = static_cast<To>(src[i]);
+    }
+}
+
+// src holds numElements elements of every rank one after the other. Each
+// block is reduced rank after rank, so that every pass streams contiguous
+// memory instead of striding over the ranks for every element.
+template <typename T, template <typename> class Op>
+void reduceBlocks(T* dst, const T* src, size_t numElements, size_t numRanks,
+                  bool* activeRanks) {
+    using Acc = AccType<T>;
+    at::parallel_for(
+        0, numElements, kReduceBlockSize, [&](int64_t begin, int64_t end) {
+            Acc acc[kReduceBlockSize];
+            Acc converted[kReduceBlockSize];
+            for (int64_t block = begin; block < end;
+                 block += kReduceBlockSize) {
+                const int64_t n = std::min(kReduceBlockSize, end - block);
+                bool valid = false;
+                for (size_t rank = 0; rank < numRanks; ++rank) {
+                    if (!activeRanks[rank]) {
+                        continue;
+                    }
+                    const T* rankBlock = src + rank * numElements + block;
+                    if constexpr (std::is_same_v<Acc, T>) {
+                        if (!valid) {
+                            memcpy(dst + block, rankBlock, n * sizeof(T));
+                        } else {
+                            combineBlock<T, Op>(dst + block, rankBlock, n);
+                        }
+                    } else if (!valid) {
+                        convertBlock(acc, rankBlock, n);
+                    } else {
+                        convertBlock(converted, rankBlock, n);
+                        combineBlock<Acc, Op>(acc, converted, n);
+                    }
+                    valid = true;
+                }
+                if (!valid) {
+                    std::fill(dst + block, dst + block + n, T{});
+                } else if constexpr (!std::is_same_v<Acc, T>) {
+                    convertBlock(dst + block, acc, n);
+                }
+            }
+        });
+}
+
+template <typename T>
+void reduceCpu(T* dst, const T* src, size_t numElements, size_t numRanks,
+               c10d::ReduceOp op, bool* activeRanks) {
+    switch (op) {
+        case c10d::ReduceOp::SUM:
+            reduceBlocks<T, SumOp>(dst, src, numElements, numRanks,
+                                   activeRanks);
+            break;
+        case c10d::ReduceOp::PRODUCT:
+            reduceBlocks<T, ProductOp>(dst, src, numElements, numRanks,
+                                       activeRanks);
+            break;
+        case c10d::ReduceOp::MIN:
+            reduceBlocks<T, MinOp>(dst, src, numElements, numRanks,
+                                   activeRanks);
+            break;
+        case c10d::ReduceOp::MAX:
+            reduceBlocks<T, MaxOp>(dst, src, numElements, numRanks,
+                                   activeRanks);
+            break;
+        default:
+            TORCH_CHECK(false, c10::str("Unsupported reduce op: ", op));
+    }
+}
+
+}  // namespace
+
+void launchReduceCpu(at::Tensor dst, size_t pos, size_t realSize, void* src,
+                     size_t numRanks, c10d::ReduceOp op, bool* activeRanks) {
+    auto ptr = (char*)dst.data_ptr() + pos;
+    size_t num = realSize / dst.element_size();
+
+    switch (dst.scalar_type()) {
+        case c10::kByte:
+            reduceCpu((uint8_t*)ptr, (uint8_t*)src, num, numRanks, op,
+                      activeRanks);
+            break;
+        case c10::kChar:
+            reduceCpu((int8_t*)ptr, (int8_t*)src, num, numRanks, op,
+                      activeRanks);
+            break;
+        case c10::kShort:
+            reduceCpu((int16_t*)ptr, (int16_t*)src, num, numRanks, op,
+                      activeRanks);
+            break;
+        case c10::kInt:
+            reduceCpu((int*)ptr, (int*)src, num, numRanks, op, activeRanks);
+            break;
+        case c10::kLong:
+            reduceCpu((int64_t*)ptr, (int64_t*)src, num, numRanks, op,
+                      activeRanks);
+            break;
+        case c10::kFloat:
+            reduceCpu((float*)ptr, (float*)src, num, numRanks, op, activeRanks);
+            break;
+        case c10::kDouble:
+            reduceCpu((double*)ptr, (double*)src, num, numRanks, op,
+                      activeRanks);
+            break;
+        case c10::kBool:
+            reduceCpu((bool*)ptr, (bool*)src, num, numRanks, op, activeRanks);
+            break;
+        case c10::kBFloat16:
+            reduceCpu((at::BFloat16*)ptr, (at::BFloat16*)src, num, numRanks,
+                      op, activeRanks);
+            break;
+        case c10::kHalf:
+            reduceCpu((at::Half*)ptr, (at::Half*)src, num, numRanks, op,
+                      activeRanks);
+            break;
+        default:
+            TORCH_CHECK(false, c10::str("Unsupported reduce dtype: ",
+                                        dst.scalar_type()));
+    }
+}
+
+}  // namespace mooncake
@@ -25,7 +25,8 @@ class MooncakeWorkCuda : public ::c10d::Work {
     MooncakeWorkCuda(c10d::OpType opType, std::shared_ptr<torch::Event> event)
         : Work(-1, opType), event_(event) {}
 
-    bool isCompleted() override { return event_->query(); }
+    // Captured ops have no event: they complete at each replay of the graph
+    bool isCompleted() override { return !event_ || event_->query(); }
 
     bool wait(std::chrono::milliseconds timeout) override {
         return true;  // This should be a no-op
@@ -35,29 +36,110 @@ class MooncakeWorkCuda : public ::c10d::Work {
     std::shared_ptr<torch::Event> event_;
 };
 
+// The slot of a task and, in graph safe groups, its transfer buffer are
+// picked once the stream reaches it, so that captured tasks replay on
+// whichever ones are next
+__device__ size_t nextTask(int* taskSeq, int* bufferSeq, int& bufferOffset) {
+    if (bufferSeq) {
+        bufferOffset = atomicAdd(bufferSeq, 1) % 2;
+    }
+    return atomicAdd(taskSeq, 1) % 2 + 2;
+}
+
+__device__ void runTask(Task* tasks, size_t taskId, int numRanks,
+                        const bool* activeRanks, int* activeRanksTensor) {
+    // Mark active
+    __threadfence();  // Ensure writes visible to host
+    tasks[taskId].active = true;
+
+    // Spin-wait until CPU proxy sets DONE
+    while (tasks[taskId].active) {
+        __threadfence();
+    }
+    for (int i = 0; i < numRanks; ++i) {
+        activeRanksTensor[i] = activeRanks[i] ? 1 : 0;
+    }
+}
+
 __global__ void enqueueTaskKernel(c10d::OpType opType, size_t tensorSize,
                                   int64_t broadcastRoot, int bufferOffset,
-                                  void* meta, Task* tasks, int numRanks,
+                                  uint64_t sendAddr, size_t sendStride,
+                                  const bool* peers, void* meta, Task* tasks, int numRanks,
                                   const bool* activeRanks,
-                                  int* activeRanksTensor, size_t taskId) {
+                                  int* activeRanksTensor, int* taskSeq,
+                                  int* bufferSeq) {
+    size_t taskId = nextTask(taskSeq, bufferSeq, bufferOffset);
     // Copy task into slot
     tasks[taskId].opType = opType;
     tasks[taskId].tensorSize = tensorSize;
     tasks[taskId].broadcastRoot = broadcastRoot;
     tasks[taskId].bufferOffset = bufferOffset;
+    tasks[taskId].sendAddr = sendAddr;
+    tasks[taskId].sendStride = sendStride;
+    tasks[taskId].peers = peers;
+    tasks[taskId].alltoallv = false;
     tasks[taskId].transferGroupMeta = meta;
+    runTask(tasks, taskId, numRanks, activeRanks, activeRanksTensor);
+}
 
-    // Mark active
-    __threadfence();  // Ensure writes visible to host
-    tasks[taskId].active = true;
+// The plan is passed by value, so that the host may reuse its copy as soon
+// as the kernel is launched
+__global__ void enqueueAlltoallvTaskKernel(AlltoallvPlan plan,
+                                           int bufferOffset, void* meta,
+                                           Task* tasks, int numRanks,
+                                           const bool* activeRanks,
+                                           int* activeRanksTensor,
+                                           int* taskSeq) {
+    size_t taskId = nextTask(taskSeq, nullptr, bufferOffset);
+    tasks[taskId].opType = c10d::OpType::ALLTOALL_BASE;
+    tasks[taskId].tensorSize = 0;
+    tasks[taskId].broadcastRoot = 0;
+    tasks[taskId].bufferOffset = bufferOffset;
+    tasks[taskId].sendAddr = 0;
+    tasks[taskId].sendStride = 0;
+    tasks[taskId].peers = nullptr;
+    tasks[taskId].alltoallv = true;
+    tasks[taskId].plan = plan;
+    tasks[taskId].transferGroupMeta = meta;
+    runTask(tasks, taskId, numRanks, activeRanks, activeRanksTensor);
+}
 
-    // Spin-wait until CPU proxy sets DONE
-    while (tasks[taskId].active) {
-        __threadfence();
+// Copies size bytes between a staging buffer of a graph safe group and the
+// transfer buffer of its next task, or of its last one with !toBuffer
+__global__ void graphStageKernel(char* stage, char* buffer0, char* buffer1,
+                                 size_t size, const int* bufferSeq,
+                                 bool toBuffer) {
+    char* buffer = (*bufferSeq + (toBuffer ? 0 : 1)) % 2 ? buffer1 : buffer0;
+    // Both are transfer-buffer sized, so whole words may be copied
+    auto src = (const uint64_t*)(toBuffer ? stage : buffer);
+    auto dst = (uint64_t*)(toBuffer ? buffer : stage);
+    size_t numWords = (size + 7) / 8;
+    for (size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < numWords;
+         i += blockDim.x * gridDim.x) {
+        dst[i] = src[i];
     }
-    for (int i = 0; i < numRanks; ++i) {
-        activeRanksTensor[i] = activeRanks[i] ? 1 : 0;
+}
+
+void launchGraphStage(TransferGroupMeta* meta, bool toBuffer, size_t size,
+                      cudaStream_t stream) {
+    auto& info = meta->segmentInfos[meta->rank];
+    auto buffers = toBuffer ? info.send_buffer : info.recv_buffer;
+    graphStageKernel<<<64, 256, 0, stream>>>(
+        (char*)(toBuffer ? meta->graphSendStage : meta->graphRecvStage),
+        (char*)buffers[0], (char*)buffers[1], size, meta->bufferSeqDevice,
+        toBuffer);
+}
+
+c10::intrusive_ptr<c10d::Work> makeWorkCuda(
+    c10d::OpType opType, const at::cuda::CUDAStream& stream) {
+    cudaStreamCaptureStatus captureStatus;
+    cudaStreamIsCapturing(stream, &captureStatus);
+    if (captureStatus != cudaStreamCaptureStatusNone) {
+        return c10::make_intrusive<MooncakeWorkCuda>(opType, nullptr);
     }
+    auto event = std::make_shared<torch::Event>(torch::kCUDA);
+    event->record(stream);
+    return c10::make_intrusive<MooncakeWorkCuda>(opType, event);
 }
 
 template <typename scalar_t>
@@ -157,86 +239,6 @@ void launchReduceKernel(at::Tensor dst, size_t pos, size_t realSize, void* src,
     }
 }
 
-template <typename T>
-T applyReduceOp(const T& a, const T& b, c10d::ReduceOp op) {
-    switch (op) {
-        case c10d::ReduceOp::SUM:
-            return a + b;
-        case c10d::ReduceOp::PRODUCT:
-            return a * b;
-        case c10d::ReduceOp::MIN:
-            return std::min(a, b);
-        case c10d::ReduceOp::MAX:
-            return std::max(a, b);
-        default:
-            TORCH_CHECK(false, c10::str("Unsupported reduce op: ", op));
-    }
-}
-
-template <typename T>
-void reduceCpu(T* dst, const T* src, size_t numElements, size_t numRanks,
-               c10d::ReduceOp op, bool* activeRanks) {
-    at::parallel_for(0, numElements, 1024, [&](int64_t begin, int64_t end) {
-        for (int64_t i = begin; i < end; ++i) {
-            bool valid = false;
-            T acc{};
-            for (int64_t rank = 0; rank < numRanks; ++rank) {
-                if (activeRanks[rank]) {
-                    if (!valid) {
-                        acc = src[i + rank * numElements];
-                        valid = true;
-                    } else {
-                        acc =
-                            applyReduceOp(acc, src[i + rank * numElements], op);
-                    }
-                }
-            }
-            dst[i] = acc;
-        }
-    });
-}
-
-void launchReduceCpu(at::Tensor dst, size_t pos, size_t realSize, void* src,
-                     size_t numRanks, c10d::ReduceOp op, bool* activeRanks) {
-    auto ptr = (char*)dst.data_ptr() + pos;
-    size_t num = realSize / dst.element_size();
-
-    switch (dst.scalar_type()) {
-        case c10::kByte:
-            reduceCpu((uint8_t*)ptr, (uint8_t*)src, num, numRanks, op,
-                      activeRanks);
-            break;
-        case c10::kChar:
-            reduceCpu((int8_t*)ptr, (int8_t*)src, num, numRanks, op,
-                      activeRanks);
-            break;
-        case c10::kShort:
-            reduceCpu((int16_t*)ptr, (int16_t*)src, num, numRanks, op,
-                      activeRanks);
-            break;
-        case c10::kInt:
-            reduceCpu((int*)ptr, (int*)src, num, numRanks, op, activeRanks);
-            break;
-        case c10::kLong:
-            reduceCpu((int64_t*)ptr, (int64_t*)src, num, numRanks, op,
-                      activeRanks);
-            break;
-        case c10::kFloat:
-            reduceCpu((float*)ptr, (float*)src, num, numRanks, op, activeRanks);
-            break;
-        case c10::kDouble:
-            reduceCpu((double*)ptr, (double*)src, num, numRanks, op,
-                      activeRanks);
-            break;
-        case c10::kBool:
-            reduceCpu((bool*)ptr, (bool*)src, num, numRanks, op, activeRanks);
-            break;
-        default:
-            TORCH_CHECK(false, c10::str("Unsupported reduce dtype: ",
-                                        dst.scalar_type()));
-    }
-}
-
 MooncakeWorker::MooncakeWorker() {
     int deviceCount = 0;
     cudaError err = cudaGetDeviceCount(&deviceCount);
@@ -244,6 +246,8 @@ MooncakeWorker::MooncakeWorker() {
         // Pin memory for task array
         cudaHostAlloc(&tasks_, kNumTasks_ * sizeof(Task), cudaHostAllocMapped);
         cudaHostGetDevicePointer(&tasks_device_, tasks_, 0);
+        cudaMalloc(&taskSeqDevice_, sizeof(int));
+        cudaMemset(taskSeqDevice_, 0, sizeof(int));
     } else {
         LOG(WARNING) << "No CUDA device found. Only the `mooncake-cpu` backend "
                         "can be used.";
@@ -264,55 +268,100 @@ c10::intrusive_ptr<c10d::Work> MooncakeWorker::putTaskCpu(
         tensorToBuffer,
     const std::function<void(void* src, size_t pos, size_t realSize)>&
         bufferToTensor) {
-    size_t chunkSize = ((kBufferSize - 1) / meta->size) & ~(size_t)7;
+    return putTasksCpu(opType, broadcastRoot, meta,
+                       {{opType, tensorSize, tensorToBuffer, bufferToTensor}});
+}
+
+c10::intrusive_ptr<c10d::Work> MooncakeWorker::putTasksCpu(
+    c10d::OpType opType, int64_t broadcastRoot, TransferGroupMeta* meta,
+    std::vector<TaskPhase> phases) {
+    size_t chunkSize = transferChunkSize(meta->size);
     auto future = c10::make_intrusive<c10::ivalue::Future>(
         c10::ListType::create(c10::TensorType::get()));
 
     struct IterState {
+        size_t currentPhase = 0;
         size_t currentPos = 0;
     };
     auto state = std::make_shared<IterState>();
-
-    auto processNextChunk = std::make_shared<std::function<void()>>();
-
-    *processNextChunk = [this, processNextChunk, state, opType, tensorSize,
-                         chunkSize, broadcastRoot, meta, tensorToBuffer,
-                         bufferToTensor, future]() {
-        if (state->currentPos >= tensorSize) {
+    auto sharedPhases =
+        std::make_shared<std::vector<TaskPhase>>(std::move(phases));
+
+    // drainPrevious empties the recv buffer of the previous chunk of the
+    // phase, which does not overlap the range of this one
+    auto processNextChunk =
+        std::make_shared<std::function<void(std::function<void()>)>>();
+
+    *processNextChunk = [this, processNextChunk, state, sharedPhases,
+                         chunkSize, broadcastRoot, meta,
+                         future](std::function<void()> drainPrevious) {
+        while (state->currentPhase < sharedPhases->size() &&
+               state->currentPos >=
+                   (*sharedPhases)[state->currentPhase].tensorSize) {
+            ++state->currentPhase;
+            state->currentPos = 0;
+        }
+        if (state->currentPhase == sharedPhases->size()) {
             future->markCompleted(c10::IValue());
             return;
         }
+        const TaskPhase& phase = (*sharedPhases)[state->currentPhase];
 
         int taskId = cpuTaskCount % 2;
         TORCH_CHECK(!tasks_[taskId].active);
 
-        size_t realSize = std::min(chunkSize, tensorSize - state->currentPos);
+        size_t pos = state->currentPos;
+        size_t realSize = std::min(chunkSize, phase.tensorSize - pos);
         int bufferOffset = meta->taskCount % 2;
 
-        tasks_[taskId].opType = opType;
+        tasks_[taskId].opType = phase.opType;
         tasks_[taskId].tensorSize = realSize;
         tasks_[taskId].broadcastRoot = broadcastRoot;
         tasks_[taskId].bufferOffset = bufferOffset;
+        tasks_[taskId].sendAddr = phase.sendAddr ? phase.sendAddr + pos : 0;
+        tasks_[taskId].sendStride = phase.sendStride;
+        tasks_[taskId].peers = phase.peers;
+        tasks_[taskId].alltoallv = false;
         tasks_[taskId].transferGroupMeta = meta;
-        tensorToBuffer(
-            (void*)meta->segmentInfos[meta->rank].send_buffer[bufferOffset],
-            state->currentPos, realSize);
+        if (!phase.sendAddr) {
+            phase.tensorToBuffer(
+                (void*)meta->segmentInfos[meta->rank].send_buffer[bufferOffset],
+                pos, realSize);
+        }
 
         hasCallback_[taskId] = true;
+        afterSubmit_[taskId] = std::move(drainPrevious);
 
-        callbacks_[taskId] = [this, processNextChunk, state, meta,
-                              bufferToTensor, bufferOffset, realSize,
-                              future]() {
-            for (int i = 0; i < meta->size; ++i) {
-                meta->activeRanksTensor[i] = meta->activeRanks[i] ? 1 : 0;
-            }
-            bufferToTensor(
-                (void*)meta->segmentInfos[meta->rank].recv_buffer[bufferOffset],
-                state->currentPos, realSize);
+        callbacks_[taskId] = [this, processNextChunk, state, meta, &phase,
+                              bufferOffset, pos, realSize]() {
+            auto drain = [meta, &phase, bufferOffset, pos, realSize]() {
+                for (int i = 0; i < meta->size; ++i) {
+                    meta->activeRanksTensor[i] = meta->activeRanks[i] ? 1 : 0;
+                }
+                phase.bufferToTensor(
+                    (void*)meta->segmentInfos[meta->rank]
+                        .recv_buffer[bufferOffset],
+                    pos, realSize);
+            };
 
             state->currentPos += realSize;
+            if (state->currentPos < phase.tensorSize) {
+                // Drained once the next chunk was posted, so that the copy
+                // or reduce of this chunk overlaps with its RDMA writes
+                (*processNextChunk)(std::move(drain));
+                return;
+            }
+            // The next phase reads what this one wrote
+            drain();
+            (*processNextChunk)(nullptr);
+        };
 
-            (*processNextChunk)();
+        tasks_[taskId].active = true;
+        ++cpuTaskCount;
+        ++meta->taskCount;
+    };
+
+    (*processNextChunk)(nullptr);
         };
 
         tasks_[taskId].active = true;
@@ -320,7 +369,7 @@ c10::intrusive_ptr<c10d::Work> MooncakeWorker::putTaskCpu(
         ++meta->taskCount;
     };
 
-    (*processNextChunk)();
+    (*processNextChunk)(nullptr);
 
     return c10::make_intrusive<MooncakeWorkCpu>(opType, future);
 }
@@ -331,35 +380,72 @@ c10::intrusive_ptr<c10d::Work> MooncakeWorker::putTaskCuda(
     const std::function<void(void* dst, size_t pos, size_t realSize)>&
         tensorToBuffer,
     const std::function<void(void* src, size_t pos, size_t realSize)>&
-        bufferToTensor) {
+        bufferToTensor,
+    uint64_t sendAddr, size_t sendStride) {
+    return putTasksCuda(opType, broadcastRoot, meta, stream,
+                        {{opType, tensorSize, tensorToBuffer, bufferToTensor,
+                          sendAddr, sendStride}});
+}
+
+c10::intrusive_ptr<c10d::Work> MooncakeWorker::putAlltoallvCuda(
+    TransferGroupMeta* meta, const at::cuda::CUDAStream& stream,
+    const AlltoallvPlan& plan,
+    const std::function<void()>& afterTransfer) {
+    int bufferOffset = meta->taskCount % 2;
+    enqueueAlltoallvTaskKernel<<<1, 1, 0, stream>>>(
+        plan, bufferOffset, meta, tasks_device_, meta->size,
+        meta->activeRanksDevice, meta->activeRanksTensor.data_ptr<int>(),
+        taskSeqDevice_);
+    afterTransfer();
+    ++meta->taskCount;
+    return makeWorkCuda(c10d::OpType::ALLTOALL_BASE, stream);
+}
+
+c10::intrusive_ptr<c10d::Work> MooncakeWorker::putTasksCuda(
+    c10d::OpType opType, int64_t broadcastRoot, TransferGroupMeta* meta,
+    const at::cuda::CUDAStream& stream, const std::vector<TaskPhase>& phases) {
     // TORCH_CHECK(tensorSize * meta->size < kBufferSize, "Too large!");
     //  Alternately use even-odd items to maintain tasks
-    size_t chunkSize = ((kBufferSize - 1) / meta->size) & ~(size_t)7;
+    size_t chunkSize = transferChunkSize(meta->size);
+
+    // The stream orders the phases, and the chunks within each of them
+    for (const TaskPhase& phase : phases) {
+        for (size_t pos = 0; pos < phase.tensorSize; pos += chunkSize) {
+            size_t realSize = min(phase.tensorSize, pos + chunkSize) - pos;
+            int bufferOffset = meta->taskCount % 2;
+            // The data of every rank is staged, whatever the op
+            size_t stageSize = realSize * meta->size;
+            void* sendBuffer =
+                meta->graphSafe ? meta->graphSendStage
+                                : (void*)meta->segmentInfos[meta->rank]
+                                      .send_buffer[bufferOffset];
+            void* recvBuffer =
+                meta->graphSafe ? meta->graphRecvStage
+                                : (void*)meta->segmentInfos[meta->rank]
+                                      .recv_buffer[bufferOffset];
+            if (!phase.sendAddr) {
+                phase.tensorToBuffer(sendBuffer, pos, realSize);
+                if (meta->graphSafe) {
+                    launchGraphStage(meta, true, stageSize, stream);
+                }
+            }
 
-    for (size_t pos = 0; pos < tensorSize; pos += chunkSize) {
-        size_t realSize = min(tensorSize, pos + chunkSize) - pos;
-        int taskId = cudaTaskCount % 2 + 2;
-        int bufferOffset = meta->taskCount % 2;
-        tensorToBuffer(
-            (void*)meta->segmentInfos[meta->rank].send_buffer[bufferOffset],
-            pos, realSize);
-
-        hasCallback_[taskId] = false;
-        enqueueTaskKernel<<<1, 1, 0, stream>>>(
-            opType, realSize, broadcastRoot, bufferOffset, meta, tasks_device_,
-            meta->size, meta->activeRanksDevice,
-            meta->activeRanksTensor.data_ptr<int>(), taskId);
-        bufferToTensor(
-            (void*)meta->segmentInfos[meta->rank].recv_buffer[bufferOffset],
-            pos, realSize);
-
-        ++cudaTaskCount;
-        ++meta->taskCount;
+            enqueueTaskKernel<<<1, 1, 0, stream>>>(
+                phase.opType, realSize, broadcastRoot, bufferOffset,
+                phase.sendAddr ? phase.sendAddr + pos : 0, phase.sendStride,
+                phase.peers, meta, tasks_device_, meta->size, meta->activeRanksDevice,
+                meta->activeRanksTensor.data_ptr<int>(), taskSeqDevice_,
+                meta->graphSafe ? meta->bufferSeqDevice : nullptr);
+            if (meta->graphSafe) {
+                launchGraphStage(meta, false, stageSize, stream);
+            }
+            phase.bufferToTensor(recvBuffer, pos, realSize);
+
+            ++meta->taskCount;
+        }
     }
 
-    auto event = std::make_shared<torch::Event>(torch::kCUDA);
-    event->record(stream);
-    return c10::make_intrusive<MooncakeWorkCuda>(opType, event);
+    return makeWorkCuda(opType, stream);
 }
 
 }  // namespace mooncake
\ No newline at end of file
@@ -9,6 +9,8 @@ enum WorkerTaskStatus {
     TRANSFERRED_1 = 1,
     SIGNALED_1 = 2,
     DONE = 3,
+    // Uneven alltoall: the output addresses were sent to the peers
+    PUBLISHED = 4,
 };
 
 void MooncakeWorker::startWorker() {
@@ -19,6 +21,37 @@ void MooncakeWorker::startWorker() {
         clock::time_point activeTime[kNumTasks_];
         size_t rankToTaskId[kNumTasks_][kMaxNumRanks];
         TransferMetadata::NotifyDesc msg{"ping", "ping"};
+        auto isPeer = [](const Task& task, int j) {
+            return !task.peers || task.peers[j];
+        };
+        // Whether the task writes any data to peer j
+        auto sendsTo = [](const Task& task, int j) {
+            return !task.alltoallv || task.plan.sendLengths[j] > 0;
+        };
+        auto markPeerBroken = [](TransferGroupMeta* group, int j,
+                                 const Task& task, const char* stage) {
+            LOG(ERROR) << "Rank " << group->rank << " marking peer " << j
+                       << " as broken during " << stage << " op "
+                       << (int)task.opType;
+            group->store->deleteKey("buffer_" +
+                                    std::to_string(group->backendIndex) +
+                                    "_" + std::to_string(j));
+            group->store->deleteKey("server_name_" +
+                                    std::to_string(group->backendIndex) +
+                                    "_" + std::to_string(j));
+            group->store->deleteKey("extension_task_count_" +
+                                    std::to_string(group->backendIndex) +
+                                    "_" + std::to_string(j));
+            group->activeRanks[j] = false;
+            group->peerConnected[j] = false;
+        };
+        auto runAfterSubmit = [this](size_t i) {
+            if (afterSubmit_[i]) {
+                auto fn = std::move(afterSubmit_[i]);
+                afterSubmit_[i] = nullptr;
+                fn();
+            }
+        };
         while (running_) {
             PAUSE();
             for (size_t i = 0; i < kNumTasks_; ++i) {
@@ -36,13 +69,45 @@ void MooncakeWorker::startWorker() {
                                     task.opType == c10d::OpType::BARRIER;
                 if (task_status[i].load(std::memory_order_acquire) == IDLE) {
                     if (skipTransfer) {
+                        runAfterSubmit(i);
                         task_status[i].store(TRANSFERRED_1,
                                              std::memory_order_release);
                         continue;
                     }
+                    if (task.alltoallv) {
+                        // Tell every peer where its data goes; the data
+                        // follows once all of them did the same
+                        auto source_ptr =
+                            (uint64_t*)group->segmentInfos[group->rank]
+                                .alltoallv_send[task.bufferOffset];
+                        std::vector<TransferRequest> entries;
+                        for (int j = 0; j < group->size; ++j) {
+                            if (!group->activeRanks[j]) {
+                                continue;
+                            }
+                            source_ptr[j] = task.plan.recvAddrs[j];
+                            entries.push_back(TransferRequest{
+                                .opcode = TransferRequest::WRITE,
+                                .source = (void*)(source_ptr + j),
+                                .target_id = group->segmentIDs[j],
+                                .target_offset =
+                                    group->segmentInfos[j]
+                                        .alltoallv_recv[task.bufferOffset] +
+                                    group->rank * sizeof(uint64_t),
+                                .length = sizeof(uint64_t),
+                            });
+                        }
+                        task.batchID =
+                            group->engine->allocateBatchID(entries.size());
+                        group->engine->submitTransfer(task.batchID, entries);
+                        activeTime[i] = clock::now();
+                        task_status[i].store(PUBLISHED,
+                                             std::memory_order_release);
+                        continue;
+                    }
                     std::vector<TransferRequest> entries;
                     for (int j = 0; j < group->size; ++j) {
-                        if (!group->activeRanks[j]) {
+                        if (!group->activeRanks[j] || !isPeer(task, j)) {
                             continue;
                         }
                         if ((task.opType == c10d::OpType::GATHER ||
@@ -50,8 +115,12 @@ void MooncakeWorker::startWorker() {
                             j != task.broadcastRoot) {
                             continue;
                         }
-                        uint64_t source = group->segmentInfos[group->rank]
-                                              .send_buffer[task.bufferOffset];
+                        uint64_t source =
+                            task.sendAddr ? task.sendAddr
+                                          : group->segmentInfos[group->rank]
+                                                .send_buffer[task.bufferOffset];
+                        const size_t sourceStride =
+                            task.sendAddr ? task.sendStride : task.tensorSize;
 
                         switch (task.opType) {
                             case c10d::OpType::BROADCAST:
@@ -65,7 +134,7 @@ void MooncakeWorker::startWorker() {
                             case c10d::OpType::ALLTOALL:
                             case c10d::OpType::_REDUCE_SCATTER_BASE:
                             case c10d::OpType::SCATTER:
-                                source += j * task.tensorSize;
+                                source += j * sourceStride;
                                 break;
                             default:
                                 break;
@@ -104,6 +173,61 @@ void MooncakeWorker::startWorker() {
                     task.batchID =
                         group->engine->allocateBatchID(entries.size());
                     group->engine->submitTransfer(task.batchID, entries);
+                    runAfterSubmit(i);
+                    activeTime[i] = clock::now();
+                    task_status[i].store(TRANSFERRED_1,
+                                         std::memory_order_release);
+                } else if (task_status[i].load(std::memory_order_acquire) ==
+                           PUBLISHED) {
+                    auto addrs = (uint64_t*)group->segmentInfos[group->rank]
+                                     .alltoallv_recv[task.bufferOffset];
+                    bool all_published = true;
+                    auto now = clock::now();
+                    auto diff =
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            now - activeTime[i]);
+                    for (int j = 0; j < group->size; ++j) {
+                        if (!group->activeRanks[j] ||
+                            ((volatile uint64_t*)addrs)[j] != 0) {
+                            continue;
+                        }
+                        if (diff.count() > kPingTimeoutMicroseconds_ &&
+                            group->engine->sendNotifyByID(
+                                group->segmentIDs[j], msg)) {
+                            markPeerBroken(group, j, task, "publishing");
+                        } else {
+                            all_published = false;
+                            break;
+                        }
+                    }
+                    if (diff.count() > kPingTimeoutMicroseconds_) {
+                        activeTime[i] = clock::now();
+                    }
+                    if (!all_published) {
+                        continue;
+                    }
+                    // Written straight into the outputs of the peers, all
+                    // of them in one batch
+                    std::vector<TransferRequest> entries;
+                    for (int j = 0; j < group->size; ++j) {
+                        if (group->activeRanks[j] && sendsTo(task, j)) {
+                            rankToTaskId[i][j] = entries.size();
+                            entries.push_back(TransferRequest{
+                                .opcode = TransferRequest::WRITE,
+                                .source = (void*)(task.plan.sendAddr +
+                                                  task.plan.sendOffsets[j]),
+                                .target_id = group->segmentIDs[j],
+                                .target_offset = addrs[j],
+                                .length = task.plan.sendLengths[j],
+                            });
+                        }
+                        addrs[j] = 0;
+                    }
+                    if (!entries.empty()) {
+                        task.batchID =
+                            group->engine->allocateBatchID(entries.size());
+                        group->engine->submitTransfer(task.batchID, entries);
+                    }
                     activeTime[i] = clock::now();
                     task_status[i].store(TRANSFERRED_1,
                                          std::memory_order_release);
@@ -117,7 +241,8 @@ void MooncakeWorker::startWorker() {
                         auto diff = std::chrono::duration_cast<
                             std::chrono::microseconds>(now - activeTime[i]);
                         for (int j = 0; j < group->size; ++j) {
-                            if (!group->activeRanks[j]) {
+                            if (!group->activeRanks[j] || !isPeer(task, j) ||
+                                !sendsTo(task, j)) {
                                 continue;
                             }
                             group->engine->getTransferStatus(
@@ -128,25 +253,8 @@ void MooncakeWorker::startWorker() {
                                     (diff.count() > kPingTimeoutMicroseconds_ &&
                                      group->engine->sendNotifyByID(
                                          group->segmentIDs[j], msg))) {
-                                    LOG(ERROR)
-                                        << "Rank " << group->rank
-                                        << " marking peer " << j
-                                        << " as broken during transferring op "
-                                        << (int)task.opType;
-                                    group->store->deleteKey(
-                                        "buffer_" +
-                                        std::to_string(group->backendIndex) +
-                                        "_" + std::to_string(j));
-                                    group->store->deleteKey(
-                                        "server_name_" +
-                                        std::to_string(group->backendIndex) +
-                                        "_" + std::to_string(j));
-                                    group->store->deleteKey(
-                                        "extension_task_count_" +
-                                        std::to_string(group->backendIndex) +
-                                        "_" + std::to_string(j));
-                                    group->activeRanks[j] = false;
-                                    group->peerConnected[j] = false;
+                                    markPeerBroken(group, j, task,
+                                                   "transferring");
                                 } else {
                                     batch_done = false;
                                     break;
@@ -162,7 +270,7 @@ void MooncakeWorker::startWorker() {
 
                     std::vector<TransferRequest> entries;
                     for (int j = 0; j < group->size; ++j) {
-                        if (!group->activeRanks[j]) {
+                        if (!group->activeRanks[j] || !isPeer(task, j)) {
                             continue;
                         }
                         *source_ptr = 1;
@@ -192,28 +300,12 @@ void MooncakeWorker::startWorker() {
                         std::chrono::duration_cast<std::chrono::microseconds>(
                             now - activeTime[i]);
                     for (int j = 0; j < group->size; ++j) {
-                        if (group->activeRanks[j] && signal_ptr[j] != 1) {
+                        if (group->activeRanks[j] && isPeer(task, j) &&
+                            signal_ptr[j] != 1) {
                             if (diff.count() > kPingTimeoutMicroseconds_ &&
                                 group->engine->sendNotifyByID(
                                     group->segmentIDs[j], msg)) {
-                                LOG(ERROR) << "Rank " << group->rank
-                                           << " marking peer " << j
-                                           << " as broken during syncing op "
-                                           << (int)task.opType;
-                                group->store->deleteKey(
-                                    "buffer_" +
-                                    std::to_string(group->backendIndex) + "_" +
-                                    std::to_string(j));
-                                group->store->deleteKey(
-                                    "server_name_" +
-                                    std::to_string(group->backendIndex) + "_" +
-                                    std::to_string(j));
-                                group->store->deleteKey(
-                                    "extension_task_count_" +
-                                    std::to_string(group->backendIndex) + "_" +
-                                    std::to_string(j));
-                                group->activeRanks[j] = false;
-                                group->peerConnected[j] = false;
+                                markPeerBroken(group, j, task, "syncing");
                             } else {
                                 all_received = false;
                                 break;
@@ -225,8 +317,12 @@ void MooncakeWorker::startWorker() {
                         activeTime[i] = clock::now();
                     }
                     if (all_received) {
+                        // Ranks outside the peers may already have
+                        // signalled their next task in this slot
                         for (int j = 0; j < group->size; ++j) {
-                            signal_ptr[j] = 0;
+                            if (isPeer(task, j)) {
+                                signal_ptr[j] = 0;
+                            }
                         }
                         task_status[i].store(DONE, std::memory_order_release);
                         task.active = false;
@@ -48,6 +48,13 @@ std::string getPreferredHca(c10::intrusive_ptr<c10d::Backend> backend,
     return mooncakeBackend->getPreferredHca(location);
 }
 
+std::vector<std::string> getPreferredHcas(
+    c10::intrusive_ptr<c10d::Backend> backend, std::string location) {
+    auto mooncakeBackend =
+        c10::static_intrusive_pointer_cast<MooncakeBackend>(backend);
+    return mooncakeBackend->getPreferredHcas(location);
+}
+
 at::Tensor getActiveRanks(c10::intrusive_ptr<c10d::Backend> backend) {
     auto mooncakeBackend =
         c10::static_intrusive_pointer_cast<MooncakeBackend>(backend);
@@ -86,6 +93,7 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
     m.def("set_host_ip", &MooncakeBackend::setHostIp);
     m.def("set_device_filter", &MooncakeBackend::setDeviceFilter);
     m.def("get_preferred_hca", &getPreferredHca);
+    m.def("get_preferred_hcas", &getPreferredHcas);
     m.def("get_active_ranks", &getActiveRanks);
     m.def("get_num_synced_ranks", &getNumSyncedRanks);
     m.def("extend_group_size_to", &extendGroupSizeTo);
@@ -97,7 +105,10 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
         m, "MooncakeBackendOptions")
         .def(py::init<at::Tensor>(), py::arg("active_ranks"))
         .def(py::init<at::Tensor, bool>(), py::arg("active_ranks"),
-             py::arg("is_extension"));
+             py::arg("is_extension"))
+        .def_readwrite(
+            "graph_safe",
+            &MooncakeBackend::MooncakeBackendOptions::graphSafe_);
 }
 
 }  // namespace mooncake
@@ -4,7 +4,19 @@ import os
 import random
 import torch
 from typing import List
+from mooncake.engine import TransferEngine
 from mooncake.store import MooncakeDistributedStore
+from mooncake.weight_sync import WeightReceiver, WeightSender
+
+
+def create_weight_engine(device_name):
+    """
+    Create a transfer engine for weight synchronization, and the session id
+    its peers reach it by.
+    """
+    engine = TransferEngine()
+    engine.initialize("localhost", "P2PHANDSHAKE", "rdma", device_name)
+    return engine, f"localhost:{engine.get_rpc_port()}"
 
 
 class TrainActor:
@@ -119,15 +131,35 @@ class TrainGroup:
     def init_weight_update_connections(self, rollout_manager):
         """
         Establish connection with rollout manager for weight synchronization.
+        The trainer pushes its parameters in buckets to a tree of rollout
+        engines, each forwarding them to the next ones.
         """
+        engine, session_id = create_weight_engine("erdma_1")
+        state_dict = self.actor_handlers[0].model.state_dict()
+        specs = [(name, tuple(t.shape), t.dtype)
+                 for name, t in state_dict.items()]
+        rollout_engines = rollout_manager.rollout_engines
+        self.weight_sender = WeightSender(engine, session_id, specs,
+                                          num_receivers=len(rollout_engines),
+                                          device="cpu")
+        infos = [e.init_weight_receiver(specs, i, len(rollout_engines))
+                 for i, e in enumerate(rollout_engines)]
+        self.weight_sender.connect(infos)
+        for e in rollout_engines:
+            e.weight_receiver.connect(self.weight_sender.info(), infos)
+        self.rollout_engines = rollout_engines
         print("[TrainGroup] Connected to rollout manager")
 
     def update_weights(self):
         """
-        Update model weights.
-        In real training, this would sync parameters from trainer to rollout engines.
+        Update model weights: push a new version of the parameters and let
+        every rollout engine switch to it once it received all of it.
         """
-        print("[TrainGroup] Weights updated")
+        state_dict = self.actor_handlers[0].model.state_dict()
+        version = self.weight_sender.push(state_dict)
+        for engine in self.rollout_engines:
+            engine.update_weights(version)
+        print(f"[TrainGroup] Weights updated to version {version}")
 
     def train(self, rollout_id: int, rollout_key: str):
         """
@@ -180,7 +212,26 @@ class RolloutEngine:
     Here, everything is mocked. We just produce random data.
     """
     def __init__(self, args):
-        pass
+        self.weight_receiver = None
+        self.weights = {}
+
+    def init_weight_receiver(self, specs, index: int, num_engines: int):
+        """
+        Allocate the weight buffers this engine receives into, and return
+        what the trainer and the other engines need to reach them.
+        """
+        engine, session_id = create_weight_engine("erdma_0")
+        self.weight_receiver = WeightReceiver(engine, session_id, specs, index,
+                                              num_engines, device="cpu")
+        return self.weight_receiver.info()
+
+    def update_weights(self, version: int):
+        """
+        Switch to the given weight version between two rollouts.
+        """
+        self.weight_receiver.wait(version)
+        self.weight_receiver.update()
+        self.weights = self.weight_receiver.tensors()
 
     def generate(self, rollout_id: int):
         """
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <numeric>
 #include <iomanip>
+#include <thread>
 
 #include "offset_allocator/offset_allocator.hpp"
 
@@ -178,8 +179,63 @@ void random_size_allocation_benchmark() {
     std::cout << "avg alloc time: " << avg_time_ns << " ns/op" << std::endl;
 }
 
+// Every thread keeps a window of small live allocations and replaces the
+// oldest one on each iteration, like concurrent puts and evictions of small
+// objects. Runs without and with the per-thread allocation caches.
+void multi_thread_allocation_benchmark() {
+    std::cout << std::endl
+              << "=== Multi-thread Small Allocation Benchmark ===" << std::endl;
+    const size_t pool_size = 2ull * 1024 * 1024 * 1024;
+    const size_t window = 256;
+    const int ops_per_thread = 1000000;
+    const std::vector<uint32_t> sizes{4096, 8192, 16384, 65536};
+
+    for (bool cached : {false, true}) {
+        for (int num_threads : {1, 2, 4, 8, 16}) {
+            auto allocator = OffsetAllocator::create(0x1000, pool_size,
+                                                     128 * 1024, 1 << 22);
+            if (cached) {
+                allocator->enableCache(1 << 20);
+            }
+
+            auto start_time = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> threads;
+            for (int t = 0; t < num_threads; t++) {
+                threads.emplace_back([&, t]() {
+                    std::mt19937 gen(t);
+                    std::uniform_int_distribution<size_t> dist(
+                        0, sizes.size() - 1);
+                    std::vector<std::optional<OffsetAllocationHandle>> live(
+                        window);
+                    for (int i = 0; i < ops_per_thread; i++) {
+                        live[i % window].reset();
+                        live[i % window] =
+                            allocator->allocate(sizes[dist(gen)]);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            auto end_time = std::chrono::high_resolution_clock::now();
+
+            const double seconds =
+                std::chrono::duration<double>(end_time - start_time).count();
+            const double mops =
+                num_threads * static_cast<double>(ops_per_thread) / seconds /
+                1e6;
+            std::cout << "cache: " << (cached ? "on " : "off")
+                      << ", threads: " << std::setw(2) << num_threads
+                      << ", alloc+free: " << std::fixed << std::setprecision(2)
+                      << mops << " Mops/s, "
+                      << allocator->get_metrics() << std::endl;
+        }
+    }
+}
+
 int main() {
     std::cout << "=== OffsetAllocator Benchmark ===" << std::endl;
     uniform_size_allocation_benchmark<OffsetAllocatorBenchHelper>();
     random_size_allocation_benchmark<OffsetAllocatorBenchHelper>();
+    multi_thread_allocation_benchmark();
 }
\ No newline at end of file
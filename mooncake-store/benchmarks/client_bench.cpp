@@ -0,0 +1,477 @@
+// Copyright 2025 Alibaba Cloud and its affiliates
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the full client path against a running master: every thread of
+// every process writes its own keys with Client::BatchPut, then reads them
+// back with Client::BatchGet over the transfer engine, and the throughput
+// and batch latencies of both phases are reported.
+//
+// Each process is a client of its own, listening on --local_hostname with
+// the port offset by its index. With --placement=local it mounts a segment
+// and puts to it, with --placement=any the master places the replicas, and
+// with --placement=remote it mounts nothing, so that all transfers go to the
+// segments of other clients, e.g. a client_bench with --get_rounds=0 left
+// running on another node.
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "client_service.h"
+#include "types.h"
+#include "utils.h"
+
+static constexpr size_t KiB = 1024;
+static constexpr size_t MiB = 1024 * KiB;
+static constexpr size_t GiB = 1024 * MiB;
+
+DEFINE_string(master_server, "127.0.0.1:50051", "Master server address");
+DEFINE_string(metadata_server, "P2PHANDSHAKE", "Metadata connection string");
+DEFINE_string(local_hostname, "localhost:17813",
+              "Local hostname of the first process, the others add their "
+              "index to the port");
+DEFINE_string(protocol, "tcp", "Transfer protocol: rdma|tcp");
+DEFINE_string(device_names, "", "RDMA device names, empty to auto-discover");
+DEFINE_uint64(value_size, 1 * MiB, "Size of each value");
+DEFINE_uint64(batch_size, 16, "Keys per BatchPut and BatchGet");
+DEFINE_uint64(num_batches, 64, "Batches put by each thread");
+DEFINE_uint64(num_threads, 4, "Threads of each process");
+DEFINE_uint64(num_processes, 1, "Client processes");
+DEFINE_uint64(get_rounds, 1, "Times each thread reads all of its keys");
+DEFINE_uint64(replica_num, 1, "Number of replicas of each value");
+DEFINE_uint64(segment_size, 4 * GiB, "Size of the segment each process "
+                                     "mounts, unless --placement=remote");
+DEFINE_string(placement, "local",
+              "Where the values go: local|any|remote, see above");
+DEFINE_uint64(hot_cache_size, 0,
+              "Bytes of local hot cache of each client, 0 to disable");
+DEFINE_string(key_prefix, "client_bench", "Prefix of the keys");
+DEFINE_bool(cleanup, true, "Remove the keys of each process at the end");
+DEFINE_string(label, "default", "Name of the run in the report");
+
+namespace {
+
+struct OpStats {
+    uint64_t bytes = 0;
+    uint64_t failures = 0;
+    std::vector<uint64_t> latency_us;
+
+    void Merge(const OpStats& other) {
+        bytes += other.bytes;
+        failures += other.failures;
+        latency_us.insert(latency_us.end(), other.latency_us.begin(),
+                          other.latency_us.end());
+    }
+};
+
+struct ProcessStats {
+    OpStats put;
+    OpStats get;
+    uint64_t corrupt_values = 0;
+    double put_seconds = 0;
+    double get_seconds = 0;
+};
+
+uint64_t ElapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// Slices of the value at buffer, none larger than kMaxSliceSize
+std::vector<mooncake::Slice> ValueSlices(char* buffer, size_t size) {
+    std::vector<mooncake::Slice> slices;
+    for (size_t offset = 0; offset < size;
+         offset += mooncake::kMaxSliceSize) {
+        slices.push_back(
+            {buffer + offset,
+             std::min<size_t>(mooncake::kMaxSliceSize, size - offset)});
+    }
+    return slices;
+}
+
+std::string KeyPrefix(size_t process_index) {
+    return FLAGS_key_prefix + "_p" + std::to_string(process_index) + "_";
+}
+
+// Puts and then reads back the keys of one thread. Every value starts with
+// the index of its key, which the reads check.
+void RunThread(mooncake::Client& client, size_t process_index,
+               size_t thread_index,
+               std::chrono::steady_clock::time_point& put_end,
+               ProcessStats& stats) {
+    const size_t buffer_size = FLAGS_batch_size * FLAGS_value_size;
+    char* buffer = static_cast<char*>(
+        mooncake::allocate_buffer_allocator_memory(buffer_size));
+    CHECK(buffer) << "Failed to allocate " << buffer_size << " bytes";
+    auto registered = client.RegisterLocalMemory(buffer, buffer_size,
+                                                 "cpu:0", false, false);
+    CHECK(registered.has_value()) << "Failed to register local memory: "
+                                  << toString(registered.error());
+
+    mooncake::ReplicateConfig config;
+    config.replica_num = FLAGS_replica_num;
+    if (FLAGS_placement == "local") {
+        // Segments are named after the hostname of their client
+        config.preferred_segment = FLAGS_local_hostname;
+    }
+    const std::string prefix =
+        KeyPrefix(process_index) + "t" + std::to_string(thread_index) + "_";
+    auto batch_keys = [&](uint64_t batch) {
+        std::vector<std::string> keys;
+        keys.reserve(FLAGS_batch_size);
+        for (uint64_t i = 0; i < FLAGS_batch_size; ++i) {
+            keys.push_back(prefix +
+                           std::to_string(batch * FLAGS_batch_size + i));
+        }
+        return keys;
+    };
+
+    for (uint64_t batch = 0; batch < FLAGS_num_batches; ++batch) {
+        const auto keys = batch_keys(batch);
+        std::vector<std::vector<mooncake::Slice>> slices;
+        slices.reserve(keys.size());
+        for (uint64_t i = 0; i < keys.size(); ++i) {
+            char* value = buffer + i * FLAGS_value_size;
+            const uint64_t index = batch * FLAGS_batch_size + i;
+            std::memcpy(value, &index, sizeof(index));
+            slices.push_back(ValueSlices(value, FLAGS_value_size));
+        }
+        const auto begin = std::chrono::steady_clock::now();
+        auto results = client.BatchPut(keys, slices, config);
+        stats.put.latency_us.push_back(ElapsedUs(begin));
+        for (const auto& result : results) {
+            if (result.has_value()) {
+                stats.put.bytes += FLAGS_value_size;
+            } else {
+                ++stats.put.failures;
+            }
+        }
+    }
+    put_end = std::chrono::steady_clock::now();
+
+    for (uint64_t round = 0; round < FLAGS_get_rounds; ++round) {
+        for (uint64_t batch = 0; batch < FLAGS_num_batches; ++batch) {
+            const auto keys = batch_keys(batch);
+            std::unordered_map<std::string, std::vector<mooncake::Slice>>
+                slices;
+            for (uint64_t i = 0; i < keys.size(); ++i) {
+                char* value = buffer + i * FLAGS_value_size;
+                std::memset(value, 0xff, sizeof(uint64_t));
+                slices.emplace(keys[i], ValueSlices(value, FLAGS_value_size));
+            }
+            const auto begin = std::chrono::steady_clock::now();
+            auto results = client.BatchGet(keys, slices);
+            stats.get.latency_us.push_back(ElapsedUs(begin));
+            for (uint64_t i = 0; i < keys.size(); ++i) {
+                if (!results[i].has_value()) {
+                    ++stats.get.failures;
+                    continue;
+                }
+                uint64_t index;
+                std::memcpy(&index, buffer + i * FLAGS_value_size,
+                            sizeof(index));
+                if (index != batch * FLAGS_batch_size + i) {
+                    ++stats.corrupt_values;
+                    continue;
+                }
+                stats.get.bytes += FLAGS_value_size;
+            }
+        }
+    }
+
+    client.unregisterLocalMemory(buffer, false);
+    free(buffer);
+}
+
+std::string ProcessHostname(size_t process_index) {
+    const auto colon = FLAGS_local_hostname.rfind(':');
+    if (colon == std::string::npos) {
+        return FLAGS_local_hostname;
+    }
+    const int port = std::atoi(FLAGS_local_hostname.c_str() + colon + 1);
+    return FLAGS_local_hostname.substr(0, colon + 1) +
+           std::to_string(port + process_index);
+}
+
+bool RunProcess(size_t process_index, ProcessStats& stats) {
+    // Each process is its own client, and its segment is named after it
+    FLAGS_local_hostname = ProcessHostname(process_index);
+    if (FLAGS_hot_cache_size > 0) {
+        setenv("LOCAL_HOT_CACHE_SIZE",
+               std::to_string(FLAGS_hot_cache_size).c_str(), 1);
+    }
+    std::optional<std::string> device_names;
+    if (!FLAGS_device_names.empty()) {
+        device_names = FLAGS_device_names;
+    }
+    auto client_opt = mooncake::Client::Create(
+        FLAGS_local_hostname, FLAGS_metadata_server, FLAGS_protocol,
+        device_names, FLAGS_master_server);
+    if (!client_opt.has_value()) {
+        LOG(ERROR) << "Failed to create client " << FLAGS_local_hostname;
+        return false;
+    }
+    auto client = client_opt.value();
+
+    void* segment = nullptr;
+    if (FLAGS_placement != "remote") {
+        segment =
+            mooncake::allocate_buffer_allocator_memory(FLAGS_segment_size);
+        CHECK(segment) << "Failed to allocate the segment";
+        auto mounted =
+            client->MountSegment(segment, FLAGS_segment_size, FLAGS_protocol);
+        if (!mounted.has_value()) {
+            LOG(ERROR) << "Failed to mount segment: "
+                       << toString(mounted.error());
+            return false;
+        }
+    }
+
+    std::vector<ProcessStats> thread_stats(FLAGS_num_threads);
+    std::vector<std::chrono::steady_clock::time_point> put_ends(
+        FLAGS_num_threads);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < FLAGS_num_threads; ++i) {
+        threads.emplace_back([&, i] {
+            RunThread(*client, process_index, i, put_ends[i],
+                      thread_stats[i]);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    // The phases overlap a little, as threads move on as soon as their own
+    // puts are done
+    const auto put_end = *std::max_element(put_ends.begin(), put_ends.end());
+    stats.put_seconds =
+        std::chrono::duration<double>(put_end - start).count();
+    stats.get_seconds = std::chrono::duration<double>(end - put_end).count();
+    for (const auto& other : thread_stats) {
+        stats.put.Merge(other.put);
+        stats.get.Merge(other.get);
+        stats.corrupt_values += other.corrupt_values;
+    }
+
+    if (FLAGS_cleanup) {
+        auto removed =
+            client->RemoveByRegex("^" + KeyPrefix(process_index), true);
+        if (!removed.has_value()) {
+            LOG(WARNING) << "Failed to remove the keys: "
+                         << toString(removed.error());
+        }
+    }
+    if (segment != nullptr) {
+        client->UnmountSegment(segment, FLAGS_segment_size);
+    }
+    client.reset();
+    free(segment);
+    return true;
+}
+
+bool WriteAll(int fd, const void* data, size_t size) {
+    const char* ptr = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t written = write(fd, ptr, size);
+        if (written <= 0) {
+            return false;
+        }
+        ptr += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool ReadAll(int fd, void* data, size_t size) {
+    char* ptr = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t got = read(fd, ptr, size);
+        if (got <= 0) {
+            return false;
+        }
+        ptr += got;
+        size -= got;
+    }
+    return true;
+}
+
+// The stats of a child process are sent to the parent over a pipe
+bool WriteOpStats(int fd, const OpStats& stats) {
+    const uint64_t header[] = {stats.bytes, stats.failures,
+                               stats.latency_us.size()};
+    return WriteAll(fd, header, sizeof(header)) &&
+           WriteAll(fd, stats.latency_us.data(),
+                    stats.latency_us.size() * sizeof(uint64_t));
+}
+
+bool ReadOpStats(int fd, OpStats& stats) {
+    uint64_t header[3];
+    if (!ReadAll(fd, header, sizeof(header))) {
+        return false;
+    }
+    stats.bytes = header[0];
+    stats.failures = header[1];
+    stats.latency_us.resize(header[2]);
+    return ReadAll(fd, stats.latency_us.data(),
+                   stats.latency_us.size() * sizeof(uint64_t));
+}
+
+bool WriteProcessStats(int fd, const ProcessStats& stats) {
+    const double seconds[] = {stats.put_seconds, stats.get_seconds};
+    return WriteOpStats(fd, stats.put) && WriteOpStats(fd, stats.get) &&
+           WriteAll(fd, &stats.corrupt_values, sizeof(uint64_t)) &&
+           WriteAll(fd, seconds, sizeof(seconds));
+}
+
+bool ReadProcessStats(int fd, ProcessStats& stats) {
+    double seconds[2];
+    if (!ReadOpStats(fd, stats.put) || !ReadOpStats(fd, stats.get) ||
+        !ReadAll(fd, &stats.corrupt_values, sizeof(uint64_t)) ||
+        !ReadAll(fd, seconds, sizeof(seconds))) {
+        return false;
+    }
+    stats.put_seconds = seconds[0];
+    stats.get_seconds = seconds[1];
+    return true;
+}
+
+double GBPerSec(uint64_t bytes, double seconds) {
+    return seconds > 0 ? bytes / seconds / 1e9 : 0;
+}
+
+void PrintOp(const std::string& name, OpStats& stats, double gb_per_sec) {
+    std::cout << std::left << std::setw(6) << name << gb_per_sec
+              << " GB/s, " << stats.failures << " failed";
+    auto& values = stats.latency_us;
+    if (values.empty()) {
+        std::cout << ", no samples" << std::endl;
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    auto at = [&](double p) {
+        return values[std::min(values.size() - 1,
+                               static_cast<size_t>(p * values.size()))];
+    };
+    std::cout << ", p50 " << at(0.50) << " us, p99 " << at(0.99)
+              << " us, p999 " << at(0.999) << " us, max " << values.back()
+              << " us (" << values.size() << " batches)" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+
+    if (FLAGS_value_size < sizeof(uint64_t) || FLAGS_batch_size == 0 ||
+        FLAGS_num_threads == 0 || FLAGS_num_processes == 0) {
+        std::cerr << "value_size must hold a key index, and batch_size, "
+                     "num_threads and num_processes must be positive"
+                  << std::endl;
+        return 1;
+    }
+    if (FLAGS_placement != "local" && FLAGS_placement != "any" &&
+        FLAGS_placement != "remote") {
+        std::cerr << "Unknown placement " << FLAGS_placement << std::endl;
+        return 1;
+    }
+
+    // Fork before any thread or client exists
+    std::vector<pid_t> children;
+    std::vector<int> pipes;
+    size_t process_index = 0;
+    for (size_t i = 1; i < FLAGS_num_processes; ++i) {
+        int fds[2];
+        PCHECK(pipe(fds) == 0) << "Failed to create a pipe";
+        const pid_t pid = fork();
+        PCHECK(pid >= 0) << "Failed to fork";
+        if (pid == 0) {
+            close(fds[0]);
+            for (int fd : pipes) close(fd);
+            pipes = {fds[1]};
+            children.clear();
+            process_index = i;
+            break;
+        }
+        close(fds[1]);
+        children.push_back(pid);
+        pipes.push_back(fds[0]);
+    }
+
+    google::InitGoogleLogging("ClientBench");
+    FLAGS_logtostderr = 1;
+    ProcessStats stats;
+    const bool ok = RunProcess(process_index, stats);
+    if (process_index != 0) {
+        const bool sent = ok && WriteProcessStats(pipes[0], stats);
+        close(pipes[0]);
+        return sent ? 0 : 1;
+    }
+
+    // Throughputs add up over the processes, each over its own phases
+    double put_gb_per_sec = GBPerSec(stats.put.bytes, stats.put_seconds);
+    double get_gb_per_sec = GBPerSec(stats.get.bytes, stats.get_seconds);
+    size_t failed_processes = ok ? 0 : 1;
+    for (size_t i = 0; i < children.size(); ++i) {
+        ProcessStats child;
+        int status = 0;
+        const bool received = ReadProcessStats(pipes[i], child);
+        close(pipes[i]);
+        waitpid(children[i], &status, 0);
+        if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ++failed_processes;
+            continue;
+        }
+        put_gb_per_sec += GBPerSec(child.put.bytes, child.put_seconds);
+        get_gb_per_sec += GBPerSec(child.get.bytes, child.get_seconds);
+        stats.put.Merge(child.put);
+        stats.get.Merge(child.get);
+        stats.corrupt_values += child.corrupt_values;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "=== Client bench [" << FLAGS_label << "] ===" << std::endl;
+    std::cout << FLAGS_num_processes << " processes x " << FLAGS_num_threads
+              << " threads, " << FLAGS_value_size << " B values, batches of "
+              << FLAGS_batch_size << ", " << FLAGS_replica_num
+              << " replicas, placement " << FLAGS_placement << ", hot cache "
+              << (FLAGS_hot_cache_size > 0 ? "on" : "off") << std::endl;
+    PrintOp("Put:", stats.put, put_gb_per_sec);
+    PrintOp("Get:", stats.get, get_gb_per_sec);
+    if (stats.corrupt_values > 0) {
+        std::cout << "Corrupt: " << stats.corrupt_values << " values"
+                  << std::endl;
+    }
+    if (failed_processes > 0) {
+        std::cout << "Failed:  " << failed_processes << " processes"
+                  << std::endl;
+        return 1;
+    }
+    return 0;
+}
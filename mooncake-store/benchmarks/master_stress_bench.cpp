@@ -0,0 +1,607 @@
+// Copyright 2025 Alibaba Cloud and its affiliates
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Master stress benchmark.
+//
+// Simulates thousands of lightweight virtual clients of one master. Each
+// virtual client has its own client id, optionally mounts a segment and
+// heartbeats like a real client, but all of them share a small pool of RPC
+// connections, so a single process can stand in for a whole cluster. Worker
+// threads issue a mix of batch puts, gets, exists and removes on behalf of
+// random virtual clients while a churn thread keeps unmounting and
+// remounting segments. Throughput and tail latency of each operation are
+// reported for each virtual client count of the sweep.
+//
+// The put volume against the mounted capacity sets the eviction pressure:
+// lower --segment_size or raise --value_size to keep the master evicting.
+
+#include <async_simple/coro/Lazy.h>
+#include <async_simple/coro/SyncAwait.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <ylt/coro_io/client_pool.hpp>
+#include <ylt/coro_rpc/coro_rpc_client.hpp>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "rpc_service.h"
+#include "types.h"
+
+// Size units for better readability
+static constexpr size_t KiB = 1024;
+static constexpr size_t MiB = 1024 * KiB;
+static constexpr size_t GiB = 1024 * MiB;
+static constexpr uintptr_t kSegmentBase = 0x100000000ULL;
+
+DEFINE_string(master_server, "127.0.0.1:50051", "Master server address");
+DEFINE_string(num_virtual_clients, "500,1000,2000",
+              "Comma-separated virtual client counts to sweep");
+DEFINE_uint64(num_connections, 32,
+              "RPC connections shared by all virtual clients");
+DEFINE_uint64(num_threads, 32, "Worker threads issuing operations");
+DEFINE_uint64(num_ping_threads, 4, "Threads sending the heartbeats");
+DEFINE_uint64(ping_interval_ms, 1000,
+              "Heartbeat interval of each virtual client");
+DEFINE_double(mount_ratio, 1.0,
+              "Fraction of the virtual clients that mount a segment");
+DEFINE_uint64(segment_size, 16 * GiB, "Size of each segment");
+DEFINE_string(op_mix, "put:20,get:60,exist:15,remove:5",
+              "Comma-separated op:weight pairs of put, get, exist and remove");
+DEFINE_uint64(batch_size, 16, "Keys per put, get and exist");
+DEFINE_uint64(value_size, 1 * MiB, "Size of object values");
+DEFINE_uint64(key_window, 1024,
+              "Number of the most recent keys of a client that gets, exists "
+              "and removes draw from");
+DEFINE_uint64(churn_interval_ms, 1000,
+              "Interval between unmounting and remounting the segment of a "
+              "random virtual client, 0 to disable segment churn");
+DEFINE_uint64(duration, 30, "Test duration in seconds per client count");
+
+namespace {
+
+using mooncake::ErrorCode;
+using mooncake::WrappedMasterService;
+
+static inline void unset_cpu_affinity() {
+    // Ensure that the worker threads are not bound to any CPU cores.
+    cpu_set_t cpuset;
+    memset(&cpuset, -1, sizeof(cpuset));
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+}
+
+// RPC connections to the master shared by all virtual clients. Unlike
+// MasterClient, the client id is an argument of every call.
+class SharedMasterConnection {
+   public:
+    SharedMasterConnection(const std::string& master_server,
+                           size_t num_connections) {
+        coro_io::client_pool<coro_rpc::coro_rpc_client>::pool_config
+            pool_conf{};
+        pool_conf.max_connection = num_connections;
+        pool_ = coro_io::client_pool<coro_rpc::coro_rpc_client>::create(
+            master_server, pool_conf);
+    }
+
+    // Result of the RPC, nullopt if it could not be delivered
+    template <auto ServiceMethod, typename... Args>
+    auto Call(Args&&... args) {
+        using Result = std::invoke_result_t<decltype(ServiceMethod),
+                                            WrappedMasterService&, Args...>;
+        return async_simple::coro::syncAwait(
+            [&]() -> async_simple::coro::Lazy<std::optional<Result>> {
+                auto ret = co_await pool_->send_request(
+                    [&](coro_io::client_reuse_hint,
+                        coro_rpc::coro_rpc_client& client) {
+                        return client.send_request<ServiceMethod>(
+                            std::forward<Args>(args)...);
+                    });
+                if (!ret.has_value()) {
+                    co_return std::nullopt;
+                }
+                auto result = co_await std::move(ret.value());
+                if (!result) {
+                    co_return std::nullopt;
+                }
+                co_return result->result();
+            }());
+    }
+
+   private:
+    std::shared_ptr<coro_io::client_pool<coro_rpc::coro_rpc_client>> pool_;
+};
+
+struct VirtualClient {
+    mooncake::UUID id = mooncake::generate_uuid();
+    // Keys of the client are "vc<index>_<n>" for n below next_key
+    size_t index = 0;
+    std::atomic<uint64_t> next_key{0};
+
+    // Segment mounted by the client, if any
+    std::mutex segment_mutex;
+    std::optional<mooncake::Segment> segment;
+};
+
+enum StressOp {
+    kPut,
+    kGet,
+    kExist,
+    kRemove,
+    kPing,
+    kMount,
+    kUnmount,
+    kNumStressOps,
+};
+
+static const char* kStressOpNames[kNumStressOps] = {
+    "Put", "Get", "Exist", "Remove", "Ping", "Mount", "Unmount"};
+
+struct OpStats {
+    std::vector<uint32_t> latency_us;
+    uint64_t keys = 0;
+    // RPCs that failed or returned an error other than a miss
+    uint64_t errors = 0;
+};
+
+using StressStats = std::array<OpStats, kNumStressOps>;
+
+class StressRound {
+   public:
+    StressRound(SharedMasterConnection& master, size_t num_clients)
+        : master_(master), clients_(num_clients) {
+        for (size_t i = 0; i < num_clients; ++i) {
+            clients_[i] = std::make_unique<VirtualClient>();
+            clients_[i]->index = i;
+        }
+        ParseOpMix();
+    }
+
+    void Run() {
+        MountAll();
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < FLAGS_num_ping_threads; ++i) {
+            threads.emplace_back(&StressRound::PingFn, this, i);
+        }
+        if (FLAGS_churn_interval_ms > 0) {
+            threads.emplace_back(&StressRound::ChurnFn, this);
+        }
+        for (size_t i = 0; i < FLAGS_num_threads; ++i) {
+            threads.emplace_back(&StressRound::WorkerFn, this);
+        }
+
+        const auto start_time = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(FLAGS_duration));
+        running_.store(false);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        elapsed_s_ = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start_time)
+                         .count();
+
+        UnmountAll();
+        auto removed = master_.Call<&WrappedMasterService::RemoveAll>(true);
+        if (!removed) {
+            LOG(WARNING) << "Failed to remove the objects of the round";
+        }
+    }
+
+    void Report() {
+        for (size_t op = 0; op < kNumStressOps; ++op) {
+            auto& stats = stats_[op];
+            if (stats.latency_us.empty()) {
+                continue;
+            }
+            auto& latency = stats.latency_us;
+            std::sort(latency.begin(), latency.end());
+            auto percentile = [&](double p) {
+                size_t rank = static_cast<size_t>(p / 100.0 * latency.size());
+                return latency[std::min(rank, latency.size() - 1)];
+            };
+            // clang-format off
+            std::cout << std::left << std::fixed << std::setprecision(1)
+                      << std::setw(10) << clients_.size()
+                      << std::setw(10) << kStressOpNames[op]
+                      << std::setw(14) << latency.size() / elapsed_s_
+                      << std::setw(14) << stats.keys / elapsed_s_
+                      << std::setw(10) << stats.errors
+                      << std::setw(10) << percentile(50)
+                      << std::setw(10) << percentile(99)
+                      << std::setw(10) << percentile(99.9)
+                      << std::setw(10) << latency.back()
+                      << "\n";
+            // clang-format on
+        }
+        std::cout << std::flush;
+    }
+
+   private:
+    void ParseOpMix() {
+        std::array<double, kNumStressOps> weights{};
+        std::stringstream ss(FLAGS_op_mix);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            auto pos = item.find(':');
+            std::string name = item.substr(0, pos);
+            double weight = pos == std::string::npos
+                                ? 1.0
+                                : std::stod(item.substr(pos + 1));
+            if (name == "put") {
+                weights[kPut] = weight;
+            } else if (name == "get") {
+                weights[kGet] = weight;
+            } else if (name == "exist") {
+                weights[kExist] = weight;
+            } else if (name == "remove") {
+                weights[kRemove] = weight;
+            } else {
+                throw std::invalid_argument("Invalid op_mix entry " + item);
+            }
+        }
+        op_weights_.assign(weights.begin(), weights.begin() + kPing);
+    }
+
+    mooncake::Segment NewSegment(size_t client_index) {
+        const uint64_t n = next_segment_.fetch_add(1);
+        mooncake::Segment segment;
+        segment.id = mooncake::generate_uuid();
+        segment.name = "vc_segment_" + std::to_string(client_index) + "_" +
+                       std::to_string(n);
+        segment.base = kSegmentBase + n * FLAGS_segment_size;
+        segment.size = FLAGS_segment_size;
+        segment.te_endpoint = segment.name;
+        return segment;
+    }
+
+    bool Mount(VirtualClient& client, OpStats& stats) {
+        auto segment = NewSegment(client.index);
+        auto start = std::chrono::steady_clock::now();
+        auto result = master_.Call<&WrappedMasterService::MountSegment>(
+            segment, client.id);
+        Record(stats, start, 1, result && result->has_value());
+        if (!result || !result->has_value()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(client.segment_mutex);
+        client.segment = std::move(segment);
+        return true;
+    }
+
+    bool Unmount(VirtualClient& client, OpStats& stats) {
+        std::optional<mooncake::Segment> segment;
+        {
+            std::lock_guard<std::mutex> lock(client.segment_mutex);
+            segment.swap(client.segment);
+        }
+        if (!segment) {
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto result = master_.Call<&WrappedMasterService::UnmountSegment>(
+            segment->id, client.id);
+        Record(stats, start, 1, result && result->has_value());
+        return result && result->has_value();
+    }
+
+    void MountAll() {
+        LOG(INFO) << "Mounting segments of " << clients_.size()
+                  << " virtual clients...";
+        StressStats stats;
+        const auto num_mounted =
+            static_cast<size_t>(clients_.size() * FLAGS_mount_ratio);
+        for (size_t i = 0; i < num_mounted; ++i) {
+            if (!Mount(*clients_[i], stats[kMount])) {
+                LOG(ERROR) << "Failed to mount the segment of virtual client "
+                           << i;
+            }
+        }
+        LOG(INFO) << num_mounted << " segments mounted";
+    }
+
+    void UnmountAll() {
+        StressStats stats;
+        for (auto& client : clients_) {
+            Unmount(*client, stats[kUnmount]);
+        }
+    }
+
+    static void Record(OpStats& stats,
+                       std::chrono::steady_clock::time_point start,
+                       uint64_t keys, bool ok) {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+        stats.latency_us.push_back(static_cast<uint32_t>(latency));
+        stats.keys += keys;
+        if (!ok) {
+            stats.errors++;
+        }
+    }
+
+    void Merge(StressStats& stats) {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        for (size_t op = 0; op < kNumStressOps; ++op) {
+            auto& from = stats[op];
+            auto& to = stats_[op];
+            to.latency_us.insert(to.latency_us.end(), from.latency_us.begin(),
+                                 from.latency_us.end());
+            to.keys += from.keys;
+            to.errors += from.errors;
+        }
+    }
+
+    // Heartbeats of the virtual clients i with i % num_ping_threads == shard
+    void PingFn(size_t shard) {
+        unset_cpu_affinity();
+        StressStats stats;
+        const auto interval =
+            std::chrono::milliseconds(FLAGS_ping_interval_ms);
+        const mooncake::ClientLoadReport load_report;
+        while (running_.load()) {
+            auto round_start = std::chrono::steady_clock::now();
+            for (size_t i = shard; i < clients_.size() && running_.load();
+                 i += FLAGS_num_ping_threads) {
+                auto& client = *clients_[i];
+                auto start = std::chrono::steady_clock::now();
+                auto result = master_.Call<&WrappedMasterService::Ping>(
+                    client.id, load_report);
+                const bool ok = result && result->has_value();
+                Record(stats[kPing], start, 1, ok);
+                if (ok && result->value().client_status ==
+                              mooncake::ClientStatus::NEED_REMOUNT) {
+                    Remount(client);
+                }
+            }
+            auto elapsed = std::chrono::steady_clock::now() - round_start;
+            if (elapsed < interval) {
+                std::this_thread::sleep_for(interval - elapsed);
+            }
+        }
+        Merge(stats);
+    }
+
+    // The master lost the client, give it back its segment like a real
+    // client does
+    void Remount(VirtualClient& client) {
+        std::vector<mooncake::Segment> segments;
+        {
+            std::lock_guard<std::mutex> lock(client.segment_mutex);
+            if (client.segment) {
+                segments.push_back(*client.segment);
+            }
+        }
+        auto result = master_.Call<&WrappedMasterService::ReMountSegment>(
+            segments, client.id);
+        if (!result || !result->has_value()) {
+            LOG(WARNING) << "Failed to remount virtual client "
+                         << client.index;
+        }
+    }
+
+    void ChurnFn() {
+        unset_cpu_affinity();
+        StressStats stats;
+        std::mt19937_64 rng(std::random_device{}());
+        std::uniform_int_distribution<size_t> client_dist(
+            0, clients_.size() - 1);
+        while (running_.load()) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(FLAGS_churn_interval_ms));
+            auto& client = *clients_[client_dist(rng)];
+            if (Unmount(client, stats[kUnmount])) {
+                Mount(client, stats[kMount]);
+            }
+        }
+        Merge(stats);
+    }
+
+    std::vector<std::string> RecentKeys(VirtualClient& client, size_t count,
+                                        std::mt19937_64& rng) {
+        std::vector<std::string> keys;
+        const uint64_t next_key = client.next_key.load();
+        if (next_key == 0) {
+            return keys;
+        }
+        const uint64_t first_key =
+            next_key > FLAGS_key_window ? next_key - FLAGS_key_window : 0;
+        std::uniform_int_distribution<uint64_t> key_dist(first_key,
+                                                         next_key - 1);
+        keys.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            keys.push_back("vc" + std::to_string(client.index) + "_" +
+                           std::to_string(key_dist(rng)));
+        }
+        return keys;
+    }
+
+    void WorkerFn() {
+        unset_cpu_affinity();
+        StressStats stats;
+        std::mt19937_64 rng(std::random_device{}());
+        std::uniform_int_distribution<size_t> client_dist(
+            0, clients_.size() - 1);
+        std::discrete_distribution<int> op_dist(op_weights_.begin(),
+                                                op_weights_.end());
+        const mooncake::ReplicateConfig config;
+        const std::vector<uint64_t> slice_lengths(FLAGS_batch_size,
+                                                  FLAGS_value_size);
+        const auto ok_code = static_cast<int32_t>(ErrorCode::OK);
+        const auto not_found =
+            static_cast<int32_t>(ErrorCode::OBJECT_NOT_FOUND);
+
+        while (running_.load()) {
+            auto& client = *clients_[client_dist(rng)];
+            const auto op = static_cast<StressOp>(op_dist(rng));
+            auto start = std::chrono::steady_clock::now();
+            switch (op) {
+                case kPut: {
+                    const uint64_t first_key =
+                        client.next_key.fetch_add(FLAGS_batch_size);
+                    std::vector<std::string> keys;
+                    keys.reserve(FLAGS_batch_size);
+                    for (size_t i = 0; i < FLAGS_batch_size; ++i) {
+                        keys.push_back("vc" + std::to_string(client.index) +
+                                       "_" + std::to_string(first_key + i));
+                    }
+                    auto started =
+                        master_.Call<&WrappedMasterService::BatchPutStart>(
+                            client.id, keys, slice_lengths, config);
+                    if (!started) {
+                        Record(stats[kPut], start, keys.size(), false);
+                        break;
+                    }
+                    std::vector<std::string> started_keys;
+                    for (size_t i = 0; i < keys.size(); ++i) {
+                        if ((*started)[i].has_value()) {
+                            started_keys.push_back(keys[i]);
+                        }
+                    }
+                    // Keys the master found no space for count as errors,
+                    // they measure the eviction pressure
+                    bool ok = started_keys.size() == keys.size();
+                    if (!started_keys.empty()) {
+                        auto ended =
+                            master_.Call<&WrappedMasterService::BatchPutEnd>(
+                                client.id, started_keys);
+                        ok = ok && ended.has_value();
+                    }
+                    Record(stats[kPut], start, keys.size(), ok);
+                    break;
+                }
+                case kGet: {
+                    auto keys = RecentKeys(*clients_[client_dist(rng)],
+                                           FLAGS_batch_size, rng);
+                    if (keys.empty()) continue;
+                    auto result = master_.Call<
+                        &WrappedMasterService::BatchGetReplicaListFlat>(keys);
+                    bool ok = result.has_value();
+                    if (ok) {
+                        for (auto error : result->key_error) {
+                            ok = ok && (error == ok_code || error == not_found);
+                        }
+                    }
+                    Record(stats[kGet], start, keys.size(), ok);
+                    break;
+                }
+                case kExist: {
+                    auto keys = RecentKeys(*clients_[client_dist(rng)],
+                                           FLAGS_batch_size, rng);
+                    if (keys.empty()) continue;
+                    auto result =
+                        master_.Call<&WrappedMasterService::BatchExistKey>(
+                            keys);
+                    Record(stats[kExist], start, keys.size(),
+                           result.has_value());
+                    break;
+                }
+                case kRemove: {
+                    auto keys = RecentKeys(client, 1, rng);
+                    if (keys.empty()) continue;
+                    auto result = master_.Call<&WrappedMasterService::Remove>(
+                        keys[0], false);
+                    bool ok = result && (result->has_value() ||
+                                         result->error() ==
+                                             ErrorCode::OBJECT_NOT_FOUND);
+                    Record(stats[kRemove], start, 1, ok);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        Merge(stats);
+    }
+
+    SharedMasterConnection& master_;
+    std::vector<std::unique_ptr<VirtualClient>> clients_;
+    std::vector<double> op_weights_;
+    std::atomic<uint64_t> next_segment_{0};
+    std::atomic<bool> running_{true};
+
+    std::mutex stats_mutex_;
+    StressStats stats_;
+    double elapsed_s_ = 0;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    google::InitGoogleLogging("MasterStressBench");
+    FLAGS_logtostderr = true;
+
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+
+    std::vector<size_t> client_counts;
+    std::stringstream ss(FLAGS_num_virtual_clients);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            client_counts.push_back(std::stoull(item));
+        }
+    }
+
+    SharedMasterConnection master(FLAGS_master_server, FLAGS_num_connections);
+    auto ready = master.Call<&WrappedMasterService::ServiceReady>();
+    if (!ready || !ready->has_value()) {
+        LOG(ERROR) << "Cannot connect to master server at "
+                   << FLAGS_master_server;
+        return 1;
+    }
+
+    // clang-format off
+    std::cout << std::left
+              << std::setw(10) << "Clients"
+              << std::setw(10) << "Op"
+              << std::setw(14) << "Ops/s"
+              << std::setw(14) << "Keys/s"
+              << std::setw(10) << "Errors"
+              << std::setw(10) << "P50 (us)"
+              << std::setw(10) << "P99 (us)"
+              << std::setw(10) << "P999 (us)"
+              << std::setw(10) << "Max (us)"
+              << "\n" << std::string(98, '-') << std::endl;
+    // clang-format on
+
+    for (auto num_clients : client_counts) {
+        if (num_clients == 0) {
+            continue;
+        }
+        LOG(INFO) << "Running " << num_clients << " virtual clients over "
+                  << FLAGS_num_connections << " connections for "
+                  << FLAGS_duration << "s...";
+        StressRound round(master, num_clients);
+        round.Run();
+        round.Report();
+    }
+
+    google::ShutdownGoogleLogging();
+
+    return 0;
+}
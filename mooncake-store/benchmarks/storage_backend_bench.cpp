@@ -15,7 +15,7 @@
 /**
  * @file storage_backend_bench.cpp
  * @brief Comprehensive benchmark for storage backends (OffsetAllocator, Bucket,
- * FilePerKey)
+ * FilePerKey, FilePerKey on 3FS)
  *
  * TESTS AVAILABLE:
  *   - init: Backend initialization time
@@ -26,6 +26,9 @@
  *   - mixed_rw: Concurrent readers + writers (realistic contention)
  *   - churn: Near-capacity steady-state with overwrites
  *   - restart: Recovery time (Init + ScanMeta)
+ *   - pipeline: Offload pipeline model - concurrent BatchOffload writers with
+ *     a value size mix, Zipfian BatchLoad readers, background ScanMeta and
+ *     disk-full eviction, swept over reader:writer counts
  *
  * MEASUREMENT METHODOLOGY:
  *   - Thread-local stats (no mutex in hot path)
@@ -61,15 +64,26 @@
  *
  *   # Zipf access pattern (hot keys)
  *   ./storage_backend_bench --pattern=zipf --zipf_skew=1.2
+ *
+ *   # Offload pipeline on all backends side by side, 2 GB disk so that
+ *   # writers run into eviction, three concurrency levels
+ *   ./storage_backend_bench --test=pipeline --backend=all --capacity_gb=2
+ * --pipeline_threads=4:1,8:2,16:4 --value_size_mix=32K:1,128K:6,512K:2
+ *
+ *   # Batched USRBIO reads and writes, storage_path must be a 3FS mount point
+ *   # and the benchmark built with USE_3FS
+ *   ./storage_backend_bench --backend=hf3fs --storage_path=/3fs/stage
  */
 
 #include <algorithm>
 #include <atomic>
+#include <cctype>
 #include <cerrno>
 #include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <fcntl.h>
 #include <filesystem>
 #include <fstream>
@@ -79,8 +93,12 @@
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <optional>
 #include <random>
+#include <sstream>
 #include <string>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <thread>
 #include <unistd.h>
 #include <unordered_map>
@@ -102,7 +120,8 @@ namespace fs = std::filesystem;
 
 // === Core Parameters ===
 DEFINE_string(backend, "offset_allocator",
-              "Backend type: offset_allocator, bucket, file_per_key, or all");
+              "Backend type: offset_allocator, bucket, file_per_key, hf3fs or "
+              "all");
 DEFINE_uint64(value_size, 128 * 1024, "Value size in bytes (default: 128KB)");
 DEFINE_uint64(batch_size, 32, "Batch size for operations (default: 32)");
 DEFINE_uint64(num_operations, 1000,
@@ -120,7 +139,7 @@ DEFINE_bool(skip_cleanup, false,
             "Skip cleanup after benchmark (for debugging)");
 DEFINE_string(test, "all",
               "Test to run: init, offload, load, concurrent_load, exist, "
-              "mixed_rw, churn, restart, all");
+              "mixed_rw, churn, restart, pipeline, all");
 
 // === PR1: Verification & Correctness ===
 DEFINE_bool(verify, true, "Enable data integrity verification (default: true)");
@@ -154,6 +173,21 @@ DEFINE_uint64(report_interval, 100,
               "Report stats every N operations in time-series mode");
 DEFINE_bool(time_series, false, "Enable periodic stats reporting during test");
 
+// === Pipeline Test Parameters ===
+DEFINE_string(value_size_mix, "",
+              "Value sizes of the pipeline test as size:weight pairs, e.g. "
+              "32K:1,128K:6,2M:1 (default: --value_size only)");
+DEFINE_string(pipeline_threads, "8:2",
+              "Comma-separated reader:writer thread counts swept by the "
+              "pipeline test");
+DEFINE_uint64(duration_sec, 30, "Duration of each pipeline run in seconds");
+DEFINE_uint64(scan_interval_ms, 1000,
+              "Interval between background ScanMeta calls of the pipeline "
+              "test, 0 to disable");
+DEFINE_double(evict_watermark, 0.9,
+              "Fraction of capacity above which pipeline writers evict the "
+              "oldest batches first (bucket backend)");
+
 // ============================================================================
 // Constants
 // ============================================================================
@@ -163,6 +197,9 @@ constexpr size_t KB = 1024;
 constexpr size_t MB = 1024 * KB;
 constexpr size_t GB = 1024 * MB;
 
+// Subdirectory of the 3FS mount used by the hf3fs backend
+constexpr const char* kHf3fsBenchDir = "hf3fs_bench";
+
 // Alignment for potential future O_DIRECT support (not currently used)
 constexpr size_t kAlignment = 4096;  // 4KB page alignment
 
@@ -242,7 +279,16 @@ AccessPattern StringToAccessPattern(const std::string& str) {
 // Backend Types
 // ============================================================================
 
-enum class BackendType { OFFSET_ALLOCATOR, BUCKET, FILE_PER_KEY };
+enum class BackendType { OFFSET_ALLOCATOR, BUCKET, FILE_PER_KEY, HF3FS };
+
+// hf3fs runs the FilePerKey backend on a 3FS mount
+inline bool IsFilePerKey(BackendType type) {
+    return type == BackendType::FILE_PER_KEY || type == BackendType::HF3FS;
+}
+
+inline bool Is3FSMount(const std::string& path) {
+    return fs::is_directory(fs::path(path) / "3fs-virt");
+}
 
 std::string BackendTypeToString(BackendType type) {
     switch (type) {
@@ -252,6 +298,8 @@ std::string BackendTypeToString(BackendType type) {
             return "bucket";
         case BackendType::FILE_PER_KEY:
             return "file_per_key";
+        case BackendType::HF3FS:
+            return "hf3fs";
     }
     return "unknown";
 }
@@ -260,6 +308,7 @@ BackendType StringToBackendType(const std::string& str) {
     if (str == "offset_allocator") return BackendType::OFFSET_ALLOCATOR;
     if (str == "bucket") return BackendType::BUCKET;
     if (str == "file_per_key") return BackendType::FILE_PER_KEY;
+    if (str == "hf3fs") return BackendType::HF3FS;
     LOG(FATAL) << "Unknown backend type: " << str;
     return BackendType::OFFSET_ALLOCATOR;
 }
@@ -491,6 +540,16 @@ class BenchmarkStats {
         return GetPercentile(99);
     }
 
+    double GetPercentileLatency(double percentile) const {
+        return GetPercentile(percentile);
+    }
+
+    size_t GetTotalBytes() const { return total_bytes_; }
+
+    size_t GetTotalOperations() const { return total_operations_; }
+
+    size_t GetTotalErrors() const { return total_errors_; }
+
    private:
     double GetPercentile(double percentile) const {
         if (merged_latencies_.empty()) return 0;
@@ -796,12 +855,195 @@ class DataGenerator {
     std::mt19937_64 rng_;
 };
 
+// ============================================================================
+// Pipeline Test Helpers
+// ============================================================================
+
+// Value sizes drawn from --value_size_mix. The size of a key is a function of
+// its index, so that readers know the size of what they load.
+class ValueSizeMix {
+   public:
+    static ValueSizeMix FromFlags() {
+        ValueSizeMix mix;
+        std::vector<double> weights;
+        std::stringstream ss(FLAGS_value_size_mix);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            auto colon = item.find(':');
+            size_t size = ParseSize(item.substr(0, colon));
+            double weight = colon == std::string::npos
+                                ? 1
+                                : std::stod(item.substr(colon + 1));
+            if (size == 0 || weight <= 0) {
+                LOG(FATAL) << "Invalid --value_size_mix entry: " << item;
+            }
+            mix.sizes_.push_back(size);
+            weights.push_back(weight);
+        }
+        if (mix.sizes_.empty()) {
+            mix.sizes_.push_back(FLAGS_value_size);
+            weights.push_back(1);
+        }
+        double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+        double cumulative = 0;
+        for (size_t i = 0; i < weights.size(); ++i) {
+            cumulative += weights[i] / total;
+            mix.cdf_.push_back(cumulative);
+            mix.mean_size_ += mix.sizes_[i] * weights[i] / total;
+        }
+        mix.cdf_.back() = 1.0;
+        return mix;
+    }
+
+    size_t SizeOf(size_t key_index) const {
+        // splitmix64 of the key index as a uniform draw
+        uint64_t h = key_index + 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        double u = (h >> 11) * 0x1.0p-53;
+        auto it = std::upper_bound(cdf_.begin(), cdf_.end(), u);
+        return sizes_[std::min<size_t>(it - cdf_.begin(), sizes_.size() - 1)];
+    }
+
+    size_t MaxSize() const {
+        return *std::max_element(sizes_.begin(), sizes_.end());
+    }
+
+    double MeanSize() const { return mean_size_; }
+
+    std::string ToString() const {
+        std::string out;
+        for (size_t i = 0; i < sizes_.size(); ++i) {
+            double weight = cdf_[i] - (i > 0 ? cdf_[i - 1] : 0.0);
+            out += (i > 0 ? ", " : "") + std::to_string(sizes_[i] / KB) +
+                   "KB:" + std::to_string(static_cast<int>(weight * 100)) +
+                   "%";
+        }
+        return out;
+    }
+
+   private:
+    // Bytes, with an optional K or M suffix
+    static size_t ParseSize(const std::string& text) {
+        size_t pos = 0;
+        size_t size = std::stoull(text, &pos);
+        if (pos < text.size()) {
+            char unit = std::toupper(text[pos]);
+            if (unit == 'K') size *= KB;
+            if (unit == 'M') size *= MB;
+        }
+        return size;
+    }
+
+    std::vector<size_t> sizes_;
+    std::vector<double> cdf_;
+    double mean_size_ = 0;
+};
+
+// Batches the pipeline writers stored, oldest first. Readers pick batches by
+// recency and writers evict the oldest ones when the disk fills up.
+class LiveBatches {
+   public:
+    struct Batch {
+        size_t first_key;
+        size_t count;
+        size_t bytes;
+    };
+
+    void Push(const Batch& batch) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batches_.push_back(batch);
+        live_bytes_ += batch.bytes;
+    }
+
+    // Remove the oldest batch if storing incoming_bytes more would exceed
+    // limit_bytes
+    std::optional<Batch> PopIfAbove(size_t incoming_bytes,
+                                    size_t limit_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (batches_.empty() || live_bytes_ + incoming_bytes <= limit_bytes) {
+            return std::nullopt;
+        }
+        Batch batch = batches_.front();
+        batches_.pop_front();
+        live_bytes_ -= batch.bytes;
+        return batch;
+    }
+
+    // The batch stored rank batches before the newest one, wrapping around
+    bool GetByRecency(size_t rank, Batch& batch) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (batches_.empty()) return false;
+        batch = batches_[batches_.size() - 1 - rank % batches_.size()];
+        return true;
+    }
+
+    size_t LiveBytes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return live_bytes_;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::deque<Batch> batches_;
+    size_t live_bytes_ = 0;
+};
+
+// I/O counters of the block device holding a path, from /sys/dev/block.
+// Unavailable on filesystems without a block device, such as tmpfs or 3FS.
+class BlockDeviceStats {
+   public:
+    struct Sample {
+        uint64_t read_sectors = 0;
+        uint64_t write_sectors = 0;
+        uint64_t io_ticks_ms = 0;  // Time the device had I/O in flight
+    };
+
+    explicit BlockDeviceStats(const std::string& path) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || major(st.st_dev) == 0) return;
+        fs::path dev = fs::path("/sys/dev/block") /
+                       (std::to_string(major(st.st_dev)) + ":" +
+                        std::to_string(minor(st.st_dev)));
+        std::error_code ec;
+        auto canonical = fs::canonical(dev, ec);
+        if (ec || !fs::exists(dev / "stat")) return;
+        name_ = canonical.filename().string();
+        stat_path_ = (dev / "stat").string();
+    }
+
+    bool Available() const { return !stat_path_.empty(); }
+
+    const std::string& Name() const { return name_; }
+
+    bool Read(Sample& sample) const {
+        if (!Available()) return false;
+        std::ifstream file(stat_path_);
+        uint64_t fields[10];
+        for (auto& field : fields) {
+            if (!(file >> field)) return false;
+        }
+        sample.read_sectors = fields[2];
+        sample.write_sectors = fields[6];
+        sample.io_ticks_ms = fields[9];
+        return true;
+    }
+
+   private:
+    std::string name_;
+    std::string stat_path_;
+};
+
 // ============================================================================
 // Backend Factory
 // ============================================================================
 
+// enable_eviction lets a FilePerKey backend evict its oldest files when the
+// capacity is reached
 std::shared_ptr<mooncake::StorageBackendInterface> CreateBackend(
-    BackendType type, const std::string& storage_path, size_t capacity_bytes) {
+    BackendType type, const std::string& storage_path, size_t capacity_bytes,
+    bool enable_eviction = false) {
     mooncake::FileStorageConfig config;
     config.storage_filepath = storage_path;
     config.total_size_limit = capacity_bytes;
@@ -827,6 +1069,24 @@ std::shared_ptr<mooncake::StorageBackendInterface> CreateBackend(
                 mooncake::StorageBackendType::kFilePerKey;
             mooncake::FilePerKeyConfig fpk_config;
             fpk_config.fsdir = "file_per_key_bench";
+            fpk_config.enable_eviction = enable_eviction;
+            return std::make_shared<mooncake::StorageBackendAdaptor>(
+                config, fpk_config);
+        }
+        case BackendType::HF3FS: {
+            if (!Is3FSMount(storage_path)) {
+                LOG(ERROR) << "Not a 3FS mount point: " << storage_path;
+                return nullptr;
+            }
+#ifndef USE_3FS
+            LOG(WARNING) << "Built without USE_3FS, 3FS files are read and "
+                            "written through FUSE one by one";
+#endif
+            config.storage_backend_type =
+                mooncake::StorageBackendType::kFilePerKey;
+            mooncake::FilePerKeyConfig fpk_config;
+            fpk_config.fsdir = kHf3fsBenchDir;
+            // Eviction is always disabled on 3FS by the backend
             fpk_config.enable_eviction = false;
             return std::make_shared<mooncake::StorageBackendAdaptor>(
                 config, fpk_config);
@@ -840,6 +1100,16 @@ std::shared_ptr<mooncake::StorageBackendInterface> CreateBackend(
 // ============================================================================
 
 void CleanupStoragePath(const std::string& path) {
+    // Never wipe a whole 3FS mount, only the files of the benchmark
+    if (Is3FSMount(path)) {
+        std::error_code ec;
+        fs::remove_all(fs::path(path) / kHf3fsBenchDir, ec);
+        if (ec) {
+            LOG(WARNING) << "Failed to cleanup " << path << "/"
+                         << kHf3fsBenchDir << ": " << ec.message();
+        }
+        return;
+    }
     if (fs::exists(path)) {
         std::error_code ec;
         fs::remove_all(path, ec);
@@ -1045,7 +1315,7 @@ void BenchBatchOffload(BackendType type, const std::string& storage_path,
     }
 
     // For FilePerKey backend, we need to call ScanMeta first
-    if (type == BackendType::FILE_PER_KEY) {
+    if (IsFilePerKey(type)) {
         backend->ScanMeta([](const std::vector<std::string>&,
                              std::vector<mooncake::StorageObjectMetadata>&) {
             return mooncake::ErrorCode::OK;
@@ -1238,7 +1508,7 @@ void BenchBatchLoad(BackendType type, const std::string& storage_path,
     }
 
     // For FilePerKey backend, call ScanMeta first
-    if (type == BackendType::FILE_PER_KEY) {
+    if (IsFilePerKey(type)) {
         backend->ScanMeta([](const std::vector<std::string>&,
                              std::vector<mooncake::StorageObjectMetadata>&) {
             return mooncake::ErrorCode::OK;
@@ -1432,7 +1702,7 @@ void BenchConcurrentLoad(BackendType type, const std::string& storage_path,
         return;
     }
 
-    if (type == BackendType::FILE_PER_KEY) {
+    if (IsFilePerKey(type)) {
         backend->ScanMeta([](const std::vector<std::string>&,
                              std::vector<mooncake::StorageObjectMetadata>&) {
             return mooncake::ErrorCode::OK;
@@ -1600,7 +1870,7 @@ void BenchIsExist(BackendType type, const std::string& storage_path,
         return;
     }
 
-    if (type == BackendType::FILE_PER_KEY) {
+    if (IsFilePerKey(type)) {
         backend->ScanMeta([](const std::vector<std::string>&,
                              std::vector<mooncake::StorageObjectMetadata>&) {
             return mooncake::ErrorCode::OK;
@@ -1746,7 +2016,7 @@ void BenchMixedRW(BackendType type, const std::string& storage_path,
         return;
     }
 
-    if (type == BackendType::FILE_PER_KEY) {
+    if (IsFilePerKey(type)) {
         backend->ScanMeta([](const std::vector<std::string>&,
                              std::vector<mooncake::StorageObjectMetadata>&) {
             return mooncake::ErrorCode::OK;
@@ -1964,7 +2234,7 @@ void BenchChurn(BackendType type, const std::string& storage_path,
         return;
     }
 
-    if (type == BackendType::FILE_PER_KEY) {
+    if (IsFilePerKey(type)) {
         backend->ScanMeta([](const std::vector<std::string>&,
                              std::vector<mooncake::StorageObjectMetadata>&) {
             return mooncake::ErrorCode::OK;
@@ -2160,7 +2430,7 @@ void BenchRestart(BackendType type, const std::string& storage_path,
         }
         backend->Init();
 
-        if (type == BackendType::FILE_PER_KEY) {
+        if (IsFilePerKey(type)) {
             backend->ScanMeta(
                 [](const std::vector<std::string>&,
                    std::vector<mooncake::StorageObjectMetadata>&) {
@@ -2204,7 +2474,7 @@ void BenchRestart(BackendType type, const std::string& storage_path,
 
     // For FilePerKey, ScanMeta is the expensive part
     double scanmeta_ms = 0;
-    if (type == BackendType::FILE_PER_KEY) {
+    if (IsFilePerKey(type)) {
         auto scan_start = std::chrono::steady_clock::now();
         backend->ScanMeta([](const std::vector<std::string>&,
                              std::vector<mooncake::StorageObjectMetadata>&) {
@@ -2252,7 +2522,7 @@ void BenchRestart(BackendType type, const std::string& storage_path,
     std::cout << std::fixed << std::setprecision(2);
     std::cout << "  Total restart:    " << total_restart_ms << " ms\n";
     std::cout << "  Init() time:      " << init_ms << " ms\n";
-    if (type == BackendType::FILE_PER_KEY) {
+    if (IsFilePerKey(type)) {
         std::cout << "  ScanMeta() time:  " << scanmeta_ms << " ms\n";
     }
 
@@ -2265,6 +2535,349 @@ void BenchRestart(BackendType type, const std::string& storage_path,
     std::cout << "  First:            " << first_load_latencies[0] << " ms\n";
 }
 
+// ============================================================================
+// Pipeline Test (offload + load + scan + eviction)
+// ============================================================================
+
+struct PipelineResult {
+    BackendType backend;
+    size_t read_threads;
+    size_t write_threads;
+    double read_mbps;  // Wall-clock throughput
+    double read_p50_ms;
+    double read_p99_ms;
+    double read_p999_ms;
+    double write_mbps;
+    double write_p99_ms;
+    double scan_p99_ms;
+    size_t read_misses;
+    size_t evicted_keys;
+    size_t rejected_batches;
+    double device_util_pct;  // Negative if the device is unknown
+};
+
+// Models the offload pipeline of a store client: writers offload batches
+// of new keys, readers load whole batches chosen by Zipfian recency, a
+// background thread runs ScanMeta and the disk is kept below capacity by
+// evicting the oldest batches. Bucket evicts through BatchRemove, FilePerKey
+// through its own FIFO eviction, and OffsetAllocator, which cannot remove
+// objects, rejects offloads once full like FileStorage stops offloading.
+PipelineResult BenchPipeline(BackendType type, const std::string& storage_path,
+                             size_t capacity, const ValueSizeMix& mix,
+                             size_t batch_size, size_t read_threads,
+                             size_t write_threads, size_t duration_sec) {
+    size_t total_threads = read_threads + write_threads;
+    PrintHeader("PIPELINE", type, 0, batch_size, total_threads);
+    std::cout << "  Value sizes:    " << mix.ToString() << "\n";
+    std::cout << "  Reader threads: " << read_threads << "\n";
+    std::cout << "  Writer threads: " << write_threads << "\n";
+
+    PipelineResult result{};
+    result.backend = type;
+    result.read_threads = read_threads;
+    result.write_threads = write_threads;
+    result.device_util_pct = -1;
+
+    CleanupStoragePath(storage_path);
+
+    auto backend = CreateBackend(type, storage_path, capacity, true);
+    if (!backend) {
+        LOG(ERROR) << "Failed to create backend";
+        return result;
+    }
+    if (!backend->Init()) {
+        LOG(ERROR) << "Init failed";
+        return result;
+    }
+    auto noop_handler = [](const std::vector<std::string>&,
+                           std::vector<mooncake::StorageObjectMetadata>&) {
+        return mooncake::ErrorCode::OK;
+    };
+    if (IsFilePerKey(type)) {
+        backend->ScanMeta(noop_handler);
+    }
+    auto bucket_backend =
+        std::dynamic_pointer_cast<mooncake::BucketStorageBackend>(backend);
+
+    // The bench only tracks live bytes; FilePerKey evicts at capacity itself
+    size_t evict_limit = 0;
+    if (type == BackendType::BUCKET) {
+        evict_limit = static_cast<size_t>(capacity * FLAGS_evict_watermark);
+    } else if (IsFilePerKey(type)) {
+        evict_limit = capacity;
+    }
+
+    LiveBatches live;
+    std::atomic<size_t> next_key{0};
+    std::atomic<size_t> evicted_keys{0};
+    std::atomic<size_t> rejected_batches{0};
+
+    // Offloads the next batch of keys, evicting old ones first.
+    // @return Whether the batch was stored.
+    auto offload_batch = [&](DataGenerator& gen, BufferPool& buffers,
+                             BatchContainers& batch, ThreadStats* stats) {
+        size_t first_key = next_key.fetch_add(batch_size);
+        size_t bytes = 0;
+        batch.ClearOffload();
+        for (size_t i = 0; i < batch_size; ++i) {
+            size_t size = mix.SizeOf(first_key + i);
+            gen.FillBuffer(buffers.Get(i), size, first_key + i);
+            batch.offload_batch.emplace(
+                gen.GenerateKey(first_key + i),
+                std::vector<mooncake::Slice>{{buffers.Get(i), size}});
+            bytes += size;
+        }
+
+        if (evict_limit > 0) {
+            std::vector<std::string> victims;
+            while (auto victim = live.PopIfAbove(bytes, evict_limit)) {
+                evicted_keys.fetch_add(victim->count);
+                if (!bucket_backend) continue;
+                victims.clear();
+                for (size_t i = 0; i < victim->count; ++i) {
+                    victims.push_back(gen.GenerateKey(victim->first_key + i));
+                }
+                bucket_backend->BatchRemove(victims);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto offload_result =
+            backend->BatchOffload(batch.offload_batch, noop_handler);
+        auto end = std::chrono::steady_clock::now();
+
+        if (!offload_result &&
+            offload_result.error() == mooncake::ErrorCode::KEYS_ULTRA_LIMIT) {
+            rejected_batches.fetch_add(1);
+            return false;
+        }
+        if (stats) {
+            stats->RecordLatency(
+                std::chrono::duration<double, std::milli>(end - start)
+                    .count());
+            stats->RecordOperation();
+        }
+        if (!offload_result) {
+            if (stats) stats->RecordError();
+            return false;
+        }
+        if (stats) stats->RecordBytes(bytes);
+        live.Push({first_key, batch_size, bytes});
+        return true;
+    };
+
+    // Pre-populate so that readers have data from the start
+    size_t fill_bytes = static_cast<size_t>(capacity * FLAGS_fill_ratio);
+    std::cout << "  Pre-populating " << (fill_bytes / MB) << " MB...\n";
+    {
+        DataGenerator gen;
+        BufferPool buffers;
+        buffers.Init(batch_size, mix.MaxSize());
+        BatchContainers batch;
+        batch.Reserve(batch_size);
+        while (live.LiveBytes() < fill_bytes &&
+               offload_batch(gen, buffers, batch, nullptr)) {
+        }
+    }
+    rejected_batches = 0;
+    evicted_keys = 0;
+
+    CacheMode cache_mode = StringToCacheMode(FLAGS_cache_mode);
+    if (cache_mode == CacheMode::DROP_CACHE_EXTERNAL) {
+        std::cout << "  Dropping page cache before benchmark...\n";
+        if (!DropLinuxPageCacheGlobal()) {
+            std::cout << "  ⚠️  Cache drop failed (not root?). Results may "
+                         "reflect warm cache.\n";
+        }
+    }
+
+    BenchmarkStats read_stats, write_stats, scan_stats;
+    read_stats.InitThreads(read_threads, 0);
+    write_stats.InitThreads(write_threads, 0);
+    scan_stats.InitThreads(1, 0);
+
+    // Readers draw a batch rank in the largest live set the disk can hold
+    size_t max_live_batches = std::max<size_t>(
+        1, static_cast<size_t>(capacity / (mix.MeanSize() * batch_size)));
+
+    bool run_scanner = FLAGS_scan_interval_ms > 0;
+    std::latch start_latch(total_threads + (run_scanner ? 1 : 0) + 1);
+    std::chrono::steady_clock::time_point deadline;
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < read_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            DataGenerator gen(42 + t);
+            BufferPool buffers;
+            buffers.Init(batch_size, mix.MaxSize());
+            BatchContainers batch;
+            batch.Reserve(batch_size);
+            KeyIndexGenerator rank_gen(max_live_batches, AccessPattern::ZIPF,
+                                       FLAGS_zipf_skew, 42 + t);
+            ThreadStats& my_stats = read_stats.GetThreadStats(t);
+            size_t failures = 0;
+
+            start_latch.arrive_and_wait();
+            for (size_t op = 0; std::chrono::steady_clock::now() < deadline;
+                 ++op) {
+                LiveBatches::Batch target;
+                if (!live.GetByRecency(rank_gen.Next(), target)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+                batch.ClearLoad();
+                for (size_t i = 0; i < target.count; ++i) {
+                    batch.load_batch.emplace(
+                        gen.GenerateKey(target.first_key + i),
+                        mooncake::Slice{buffers.Get(i),
+                                        mix.SizeOf(target.first_key + i)});
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                auto load_result = backend->BatchLoad(batch.load_batch);
+                auto end = std::chrono::steady_clock::now();
+
+                my_stats.RecordLatency(
+                    std::chrono::duration<double, std::milli>(end - start)
+                        .count());
+                my_stats.RecordOperation();
+                // The batch may have been evicted since it was picked
+                if (!load_result) {
+                    my_stats.RecordError();
+                    continue;
+                }
+                my_stats.RecordBytes(target.bytes);
+                if (!ShouldVerify(op, false)) continue;
+                for (size_t i = 0; i < target.count; ++i) {
+                    size_t key_index = target.first_key + i;
+                    if (!gen.VerifyBuffer(buffers.Get(i), mix.SizeOf(key_index),
+                                          key_index)) {
+                        my_stats.RecordChecksumFailure();
+                        failures++;
+                    }
+                }
+            }
+            CheckVerification(failures, "PIPELINE reader");
+        });
+    }
+
+    for (size_t t = 0; t < write_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            DataGenerator gen(1000 + t);
+            BufferPool buffers;
+            buffers.Init(batch_size, mix.MaxSize());
+            BatchContainers batch;
+            batch.Reserve(batch_size);
+            ThreadStats& my_stats = write_stats.GetThreadStats(t);
+
+            start_latch.arrive_and_wait();
+            while (std::chrono::steady_clock::now() < deadline) {
+                if (!offload_batch(gen, buffers, batch, &my_stats)) {
+                    // A full disk pauses offloading, as in FileStorage
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        });
+    }
+
+    if (run_scanner) {
+        threads.emplace_back([&]() {
+            ThreadStats& my_stats = scan_stats.GetStats();
+            start_latch.arrive_and_wait();
+            while (std::chrono::steady_clock::now() < deadline) {
+                auto start = std::chrono::steady_clock::now();
+                auto scan_result = backend->ScanMeta(noop_handler);
+                auto end = std::chrono::steady_clock::now();
+                my_stats.RecordLatency(
+                    std::chrono::duration<double, std::milli>(end - start)
+                        .count());
+                my_stats.RecordOperation();
+                if (!scan_result) my_stats.RecordError();
+                std::this_thread::sleep_until(
+                    std::min(deadline, end + std::chrono::milliseconds(
+                                                 FLAGS_scan_interval_ms)));
+            }
+        });
+    }
+
+    BlockDeviceStats device(storage_path);
+    BlockDeviceStats::Sample device_start, device_end;
+    bool has_device = device.Read(device_start);
+
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::seconds(duration_sec);
+    read_stats.StartTimer();
+    write_stats.StartTimer();
+    scan_stats.StartTimer();
+    start_latch.arrive_and_wait();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    read_stats.StopTimer();
+    write_stats.StopTimer();
+    scan_stats.StopTimer();
+    has_device = has_device && device.Read(device_end);
+
+    read_stats.Finalize();
+    write_stats.Finalize();
+    scan_stats.Finalize();
+
+    std::cout << "\n  --- LOAD Performance ---";
+    read_stats.PrintStatistics("PIPELINE_LOAD");
+    std::cout << "\n  --- OFFLOAD Performance ---";
+    write_stats.PrintStatistics("PIPELINE_OFFLOAD");
+    if (run_scanner) {
+        std::cout << "\n  --- SCAN_META Performance ---";
+        scan_stats.PrintStatistics("PIPELINE_SCAN_META");
+    }
+
+    double elapsed_sec = read_stats.GetElapsedSeconds();
+    auto wall_mbps = [&](const BenchmarkStats& stats) {
+        return elapsed_sec > 0
+                   ? static_cast<double>(stats.GetTotalBytes()) / MB /
+                         elapsed_sec
+                   : 0;
+    };
+    result.read_mbps = wall_mbps(read_stats);
+    result.read_p50_ms = read_stats.GetPercentileLatency(50);
+    result.read_p99_ms = read_stats.GetPercentileLatency(99);
+    result.read_p999_ms = read_stats.GetPercentileLatency(99.9);
+    result.write_mbps = wall_mbps(write_stats);
+    result.write_p99_ms = write_stats.GetPercentileLatency(99);
+    result.scan_p99_ms = scan_stats.GetPercentileLatency(99);
+    result.read_misses = read_stats.GetTotalErrors();
+    result.evicted_keys = evicted_keys.load();
+    result.rejected_batches = rejected_batches.load();
+
+    std::cout << std::setfill(' ') << "\n  --- Pipeline ---\n";
+    std::cout << "  Load MB/s:      " << result.read_mbps << " (wall clock)\n";
+    std::cout << "  Offload MB/s:   " << result.write_mbps
+              << " (wall clock)\n";
+    std::cout << "  Failed loads:   " << result.read_misses
+              << " (evicted or missing)\n";
+    std::cout << "  Evicted keys:   " << result.evicted_keys << "\n";
+    std::cout << "  Rejected:       " << result.rejected_batches
+              << " offload batches (disk full)\n";
+    if (has_device && elapsed_sec > 0) {
+        constexpr double kSectorSize = 512;
+        result.device_util_pct =
+            (device_end.io_ticks_ms - device_start.io_ticks_ms) /
+            (elapsed_sec * 10);
+        std::cout << "  Device:         " << device.Name() << ", "
+                  << result.device_util_pct << "% busy, read "
+                  << (device_end.read_sectors - device_start.read_sectors) *
+                         kSectorSize / MB / elapsed_sec
+                  << " MB/s, write "
+                  << (device_end.write_sectors - device_start.write_sectors) *
+                         kSectorSize / MB / elapsed_sec
+                  << " MB/s\n";
+    } else {
+        std::cout << "  Device:         unknown (no block device for "
+                  << storage_path << ")\n";
+    }
+    return result;
+}
+
 // ============================================================================
 // Run All Benchmarks
 // ============================================================================
@@ -2283,6 +2896,10 @@ void RunAllBenchmarks(const std::string& storage_path, size_t capacity) {
     std::vector<BackendType> backends = {BackendType::OFFSET_ALLOCATOR,
                                          BackendType::BUCKET,
                                          BackendType::FILE_PER_KEY};
+    if (Is3FSMount(storage_path)) {
+        // The other backends would write next to the 3FS virtual directory
+        backends = {BackendType::HF3FS};
+    }
 
     std::vector<BenchmarkResult> results;
 
@@ -2361,6 +2978,80 @@ void RunAllBenchmarks(const std::string& storage_path, size_t capacity) {
     std::cout << std::string(100, '=') << "\n";
 }
 
+// Runs the pipeline test for each backend and --pipeline_threads entry and
+// prints them side by side
+void RunPipelineBenchmarks(const std::string& storage_path, size_t capacity) {
+    std::vector<BackendType> backends;
+    if (FLAGS_backend != "all") {
+        backends = {StringToBackendType(FLAGS_backend)};
+    } else if (Is3FSMount(storage_path)) {
+        backends = {BackendType::HF3FS};
+    } else {
+        backends = {BackendType::OFFSET_ALLOCATOR, BackendType::BUCKET,
+                    BackendType::FILE_PER_KEY};
+    }
+
+    std::vector<std::pair<size_t, size_t>> sweep;
+    std::stringstream ss(FLAGS_pipeline_threads);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        auto colon = item.find(':');
+        if (colon == std::string::npos) {
+            LOG(FATAL) << "Invalid --pipeline_threads entry: " << item
+                       << ", expected readers:writers";
+        }
+        sweep.emplace_back(std::stoull(item.substr(0, colon)),
+                           std::stoull(item.substr(colon + 1)));
+    }
+
+    ValueSizeMix mix = ValueSizeMix::FromFlags();
+    std::vector<PipelineResult> results;
+    for (auto backend_type : backends) {
+        for (auto [readers, writers] : sweep) {
+            results.push_back(BenchPipeline(backend_type, storage_path,
+                                            capacity, mix, FLAGS_batch_size,
+                                            readers, writers,
+                                            FLAGS_duration_sec));
+        }
+    }
+
+    // PrintStatistics leaves the fill character at '0'
+    std::cout << std::setfill(' ');
+    std::cout << "\n" << std::string(128, '=') << "\n";
+    std::cout << "                                        PIPELINE SUMMARY"
+              << " (latencies in ms, MB/s over wall clock)\n";
+    std::cout << std::string(128, '=') << "\n";
+    std::cout << std::left << std::setw(18) << "Backend" << std::setw(8)
+              << "R:W" << std::setw(10) << "Load MB/s" << std::setw(9)
+              << "Load P50" << std::setw(9) << "Load P99" << std::setw(10)
+              << "Load P999" << std::setw(14) << "Offload MB/s"
+              << std::setw(13) << "Offload P99" << std::setw(10) << "Scan P99"
+              << std::setw(8) << "Misses" << std::setw(10) << "Evicted"
+              << std::setw(10) << "Rejected" << "Dev util" << "\n";
+    std::cout << std::string(128, '-') << "\n";
+    for (const auto& r : results) {
+        std::string threads = std::to_string(r.read_threads) + ":" +
+                              std::to_string(r.write_threads);
+        std::cout << std::left << std::setw(18)
+                  << BackendTypeToString(r.backend) << std::setw(8) << threads
+                  << std::fixed << std::setprecision(2) << std::setw(10)
+                  << r.read_mbps << std::setw(9) << r.read_p50_ms
+                  << std::setw(9) << r.read_p99_ms << std::setw(10)
+                  << r.read_p999_ms << std::setw(14) << r.write_mbps
+                  << std::setw(13) << r.write_p99_ms << std::setw(10)
+                  << r.scan_p99_ms << std::setw(8) << r.read_misses
+                  << std::setw(10) << r.evicted_keys << std::setw(10)
+                  << r.rejected_batches;
+        if (r.device_util_pct >= 0) {
+            std::cout << std::setprecision(1) << r.device_util_pct << "%";
+        } else {
+            std::cout << "n/a";
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::string(128, '=') << "\n";
+}
+
 // ============================================================================
 // Main
 // ============================================================================
@@ -2374,7 +3065,13 @@ int main(int argc, char** argv) {
     size_t capacity = FLAGS_capacity_gb * GB;
     CacheMode cache_mode = StringToCacheMode(FLAGS_cache_mode);
 
-    if (FLAGS_run_all) {
+    if (FLAGS_test == "pipeline") {
+        if (FLAGS_backend != "all") {
+            PrintBenchmarkConfig(StringToBackendType(FLAGS_backend),
+                                 cache_mode);
+        }
+        RunPipelineBenchmarks(storage_path, capacity);
+    } else if (FLAGS_run_all) {
         RunAllBenchmarks(storage_path, capacity);
     } else if (FLAGS_backend == "all") {
         RunAllBenchmarks(storage_path, capacity);
@@ -0,0 +1,425 @@
+// Copyright 2025 Alibaba Cloud and its affiliates
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays the KV cache traces of FAST25-release/traces against a store.
+// Each request of a trace lists the hash ids of its prompt blocks; every
+// block maps to one object. At the request timestamp the benchmark checks
+// which blocks exist, reads the cached prefix and writes the blocks past
+// it, like a prefix-caching inference engine would.
+//
+// Eviction is run by the master, so the policy under test is whatever the
+// master was started with (--eviction_ratio, --eviction_high_watermark_ratio,
+// ...). Pass --label to name it in the report.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "client_service.h"
+#include "types.h"
+#include "utils.h"
+
+static constexpr size_t KiB = 1024;
+static constexpr size_t MiB = 1024 * KiB;
+static constexpr size_t GiB = 1024 * MiB;
+
+DEFINE_string(master_server, "127.0.0.1:50051", "Master server address");
+DEFINE_string(metadata_server, "P2PHANDSHAKE", "Metadata connection string");
+DEFINE_string(local_hostname, "localhost:17813", "Local hostname");
+DEFINE_string(protocol, "tcp", "Transfer protocol: rdma|tcp");
+DEFINE_string(device_names, "", "RDMA device names, empty to auto-discover");
+DEFINE_string(trace_file, "FAST25-release/traces/conversation_trace.jsonl",
+              "Trace to replay, one JSON request per line");
+DEFINE_uint64(block_size, 256 * KiB, "Size of the object of a block");
+DEFINE_uint64(segment_size, 4 * GiB, "Size of the segment to mount");
+DEFINE_double(time_scale, 1.0,
+              "Replay speedup over the trace timestamps, 0 to send the "
+              "requests back to back");
+DEFINE_uint64(max_requests, 0, "Number of requests to replay, 0 for all");
+DEFINE_uint64(num_threads, 8, "Number of threads issuing requests");
+DEFINE_uint64(replica_num, 1, "Number of replicas of each block");
+DEFINE_string(key_prefix, "trace", "Prefix of the block keys");
+DEFINE_string(label, "default", "Name of the master's eviction setup");
+
+namespace {
+
+struct TraceRequest {
+    uint64_t timestamp_ms = 0;
+    std::vector<uint64_t> hash_ids;
+};
+
+// The traces are flat JSON objects, so the two fields needed are found by
+// name rather than with a full parser.
+bool ParseTraceLine(const std::string& line, TraceRequest& request) {
+    auto ts = line.find("\"timestamp\"");
+    auto ids = line.find("\"hash_ids\"");
+    if (ts == std::string::npos || ids == std::string::npos) {
+        return false;
+    }
+    ts = line.find(':', ts);
+    if (ts == std::string::npos) {
+        return false;
+    }
+    request.timestamp_ms = std::strtoull(line.c_str() + ts + 1, nullptr, 10);
+
+    auto pos = line.find('[', ids);
+    const auto end = line.find(']', ids);
+    if (pos == std::string::npos || end == std::string::npos) {
+        return false;
+    }
+    request.hash_ids.clear();
+    for (++pos; pos < end;) {
+        char* next = nullptr;
+        auto id = std::strtoull(line.c_str() + pos, &next, 10);
+        const auto consumed = next - (line.c_str() + pos);
+        if (consumed == 0) {
+            ++pos;
+            continue;
+        }
+        request.hash_ids.push_back(id);
+        pos += consumed;
+    }
+    return true;
+}
+
+std::vector<TraceRequest> LoadTrace(const std::string& path,
+                                    uint64_t max_requests) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open trace file " + path);
+    }
+    std::vector<TraceRequest> requests;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (max_requests != 0 && requests.size() >= max_requests) {
+            break;
+        }
+        TraceRequest request;
+        if (ParseTraceLine(line, request)) {
+            requests.push_back(std::move(request));
+        } else if (!line.empty()) {
+            LOG(WARNING) << "Skipping malformed trace line: " << line;
+        }
+    }
+    return requests;
+}
+
+struct ReplayStats {
+    uint64_t requests = 0;
+    uint64_t blocks = 0;
+    uint64_t hit_blocks = 0;
+    uint64_t get_bytes = 0;
+    uint64_t put_bytes = 0;
+    uint64_t get_failures = 0;
+    uint64_t put_failures = 0;
+    uint64_t corrupt_blocks = 0;
+    uint64_t max_lag_ms = 0;
+    std::vector<uint64_t> exist_latency_us;
+    std::vector<uint64_t> get_latency_us;
+    std::vector<uint64_t> put_latency_us;
+
+    void Merge(ReplayStats& other) {
+        requests += other.requests;
+        blocks += other.blocks;
+        hit_blocks += other.hit_blocks;
+        get_bytes += other.get_bytes;
+        put_bytes += other.put_bytes;
+        get_failures += other.get_failures;
+        put_failures += other.put_failures;
+        corrupt_blocks += other.corrupt_blocks;
+        max_lag_ms = std::max(max_lag_ms, other.max_lag_ms);
+        auto append = [](std::vector<uint64_t>& to,
+                         const std::vector<uint64_t>& from) {
+            to.insert(to.end(), from.begin(), from.end());
+        };
+        append(exist_latency_us, other.exist_latency_us);
+        append(get_latency_us, other.get_latency_us);
+        append(put_latency_us, other.put_latency_us);
+    }
+};
+
+uint64_t ElapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// Slices of the block at buffer, none larger than kMaxSliceSize
+std::vector<mooncake::Slice> BlockSlices(char* buffer, size_t size) {
+    std::vector<mooncake::Slice> slices;
+    for (size_t offset = 0; offset < size;
+         offset += mooncake::kMaxSliceSize) {
+        slices.push_back(
+            {buffer + offset,
+             std::min<size_t>(mooncake::kMaxSliceSize, size - offset)});
+    }
+    return slices;
+}
+
+class TraceReplayer {
+   public:
+    TraceReplayer(std::shared_ptr<mooncake::Client> client,
+                  const std::vector<TraceRequest>& requests,
+                  size_t max_blocks)
+        : client_(std::move(client)),
+          requests_(requests),
+          max_blocks_(max_blocks) {}
+
+    // Replays the requests of index thread_index modulo num_threads
+    void Run(size_t thread_index, size_t num_threads,
+             std::chrono::steady_clock::time_point start, ReplayStats& stats) {
+        const size_t buffer_size = max_blocks_ * FLAGS_block_size;
+        char* buffer = static_cast<char*>(
+            mooncake::allocate_buffer_allocator_memory(buffer_size));
+        CHECK(buffer) << "Failed to allocate " << buffer_size << " bytes";
+        auto registered = client_->RegisterLocalMemory(
+            buffer, buffer_size, "cpu:0", false, false);
+        CHECK(registered.has_value())
+            << "Failed to register local memory: "
+            << toString(registered.error());
+
+        mooncake::ReplicateConfig config;
+        config.replica_num = FLAGS_replica_num;
+        for (size_t i = thread_index; i < requests_.size();
+             i += num_threads) {
+            const auto& request = requests_[i];
+            if (FLAGS_time_scale > 0) {
+                const auto due =
+                    start + std::chrono::microseconds(static_cast<uint64_t>(
+                                request.timestamp_ms * 1000.0 /
+                                FLAGS_time_scale));
+                std::this_thread::sleep_until(due);
+                const auto lag =
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - due)
+                        .count();
+                stats.max_lag_ms =
+                    std::max<uint64_t>(stats.max_lag_ms, lag);
+            }
+            Replay(request, buffer, config, stats);
+        }
+
+        client_->unregisterLocalMemory(buffer, false);
+        free(buffer);
+    }
+
+   private:
+    void Replay(const TraceRequest& request, char* buffer,
+                const mooncake::ReplicateConfig& config, ReplayStats& stats) {
+        const size_t num_blocks =
+            std::min(request.hash_ids.size(), max_blocks_);
+        std::vector<std::string> keys;
+        keys.reserve(num_blocks);
+        for (size_t i = 0; i < num_blocks; ++i) {
+            keys.push_back(FLAGS_key_prefix + "_" +
+                           std::to_string(request.hash_ids[i]));
+        }
+        ++stats.requests;
+        stats.blocks += num_blocks;
+        if (keys.empty()) {
+            return;
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        auto exists = client_->BatchIsExist(keys);
+        stats.exist_latency_us.push_back(ElapsedUs(begin));
+
+        // Only the cached prefix is usable, as a block's KV depends on all
+        // the blocks before it.
+        size_t hits = 0;
+        while (hits < exists.size() && exists[hits].has_value() &&
+               exists[hits].value()) {
+            ++hits;
+        }
+
+        if (hits > 0) {
+            std::vector<std::string> hit_keys(keys.begin(),
+                                              keys.begin() + hits);
+            std::unordered_map<std::string, std::vector<mooncake::Slice>>
+                slices;
+            for (size_t i = 0; i < hits; ++i) {
+                slices.emplace(hit_keys[i],
+                               BlockSlices(buffer + i * FLAGS_block_size,
+                                           FLAGS_block_size));
+            }
+            begin = std::chrono::steady_clock::now();
+            auto results = client_->BatchGet(hit_keys, slices);
+            stats.get_latency_us.push_back(ElapsedUs(begin));
+            for (size_t i = 0; i < hits; ++i) {
+                if (!results[i].has_value()) {
+                    // Evicted between the existence check and the read
+                    ++stats.get_failures;
+                    continue;
+                }
+                // Every block starts with the hash id it was written for
+                uint64_t id;
+                std::memcpy(&id, buffer + i * FLAGS_block_size, sizeof(id));
+                if (id != request.hash_ids[i]) {
+                    ++stats.corrupt_blocks;
+                    continue;
+                }
+                ++stats.hit_blocks;
+                stats.get_bytes += FLAGS_block_size;
+            }
+        }
+
+        if (hits < num_blocks) {
+            std::vector<std::string> miss_keys(keys.begin() + hits,
+                                               keys.end());
+            std::vector<std::vector<mooncake::Slice>> slices;
+            slices.reserve(miss_keys.size());
+            for (size_t i = hits; i < num_blocks; ++i) {
+                char* block = buffer + i * FLAGS_block_size;
+                std::memcpy(block, &request.hash_ids[i], sizeof(uint64_t));
+                slices.push_back(BlockSlices(block, FLAGS_block_size));
+            }
+            begin = std::chrono::steady_clock::now();
+            auto results = client_->BatchPut(miss_keys, slices, config);
+            stats.put_latency_us.push_back(ElapsedUs(begin));
+            for (const auto& result : results) {
+                if (result.has_value()) {
+                    stats.put_bytes += FLAGS_block_size;
+                } else if (result.error() !=
+                           mooncake::ErrorCode::OBJECT_ALREADY_EXISTS) {
+                    // Another thread wrote a shared prefix block first
+                    ++stats.put_failures;
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<mooncake::Client> client_;
+    const std::vector<TraceRequest>& requests_;
+    const size_t max_blocks_;
+};
+
+void PrintLatency(const std::string& name, std::vector<uint64_t>& values) {
+    std::cout << std::left << std::setw(12) << name;
+    if (values.empty()) {
+        std::cout << "no samples" << std::endl;
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    auto at = [&](double p) {
+        return values[std::min(values.size() - 1,
+                               static_cast<size_t>(p * values.size()))];
+    };
+    std::cout << "p50 " << at(0.50) << " us, p90 " << at(0.90)
+              << " us, p99 " << at(0.99) << " us, max " << values.back()
+              << " us (" << values.size() << " batches)" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    google::InitGoogleLogging("TraceReplayBench");
+    FLAGS_logtostderr = 1;
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+
+    if (FLAGS_block_size < sizeof(uint64_t) || FLAGS_num_threads == 0) {
+        LOG(ERROR) << "block_size must hold a hash id and num_threads must "
+                      "be positive";
+        return 1;
+    }
+
+    const auto requests = LoadTrace(FLAGS_trace_file, FLAGS_max_requests);
+    size_t max_blocks = 0;
+    for (const auto& request : requests) {
+        max_blocks = std::max(max_blocks, request.hash_ids.size());
+    }
+    LOG(INFO) << "Loaded " << requests.size() << " requests of up to "
+              << max_blocks << " blocks from " << FLAGS_trace_file;
+    if (requests.empty() || max_blocks == 0) {
+        return 1;
+    }
+
+    std::optional<std::string> device_names;
+    if (!FLAGS_device_names.empty()) {
+        device_names = FLAGS_device_names;
+    }
+    auto client_opt = mooncake::Client::Create(
+        FLAGS_local_hostname, FLAGS_metadata_server, FLAGS_protocol,
+        device_names, FLAGS_master_server);
+    if (!client_opt.has_value()) {
+        LOG(ERROR) << "Failed to create client";
+        return 1;
+    }
+    auto client = client_opt.value();
+
+    void* segment =
+        mooncake::allocate_buffer_allocator_memory(FLAGS_segment_size);
+    CHECK(segment) << "Failed to allocate the segment";
+    auto mounted =
+        client->MountSegment(segment, FLAGS_segment_size, FLAGS_protocol);
+    if (!mounted.has_value()) {
+        LOG(ERROR) << "Failed to mount segment: "
+                   << toString(mounted.error());
+        return 1;
+    }
+
+    TraceReplayer replayer(client, requests, max_blocks);
+    std::vector<ReplayStats> thread_stats(FLAGS_num_threads);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < FLAGS_num_threads; ++i) {
+        threads.emplace_back([&, i] {
+            replayer.Run(i, FLAGS_num_threads, start, thread_stats[i]);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double seconds = ElapsedUs(start) / 1e6;
+
+    ReplayStats stats;
+    for (auto& other : thread_stats) {
+        stats.Merge(other);
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "=== Trace replay [" << FLAGS_label << "] ===" << std::endl;
+    std::cout << "Trace:       " << FLAGS_trace_file << " ("
+              << stats.requests << " requests, " << stats.blocks
+              << " blocks) in " << seconds << " s" << std::endl;
+    std::cout << "Hit ratio:   "
+              << (stats.blocks ? 100.0 * stats.hit_blocks / stats.blocks : 0)
+              << "% (" << stats.hit_blocks << " blocks)" << std::endl;
+    std::cout << "Get:         " << stats.get_bytes / seconds / MiB
+              << " MiB/s, " << stats.get_failures << " failed, "
+              << stats.corrupt_blocks << " corrupt" << std::endl;
+    std::cout << "Put:         " << stats.put_bytes / seconds / MiB
+              << " MiB/s, " << stats.put_failures << " failed" << std::endl;
+    if (FLAGS_time_scale > 0) {
+        std::cout << "Max lag:     " << stats.max_lag_ms << " ms"
+                  << std::endl;
+    }
+    PrintLatency("IsExist:", stats.exist_latency_us);
+    PrintLatency("Get:", stats.get_latency_us);
+    PrintLatency("Put:", stats.put_latency_us);
+
+    client->UnmountSegment(segment, FLAGS_segment_size);
+    client.reset();
+    free(segment);
+    return 0;
+}
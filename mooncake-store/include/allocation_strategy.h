@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <random>
 #include <string>
 #include <set>
@@ -12,6 +13,7 @@
 
 #include "allocator.h"  // Contains BufferAllocator declaration
 #include "replica.h"
+#include "segment_load_tracker.h"
 #include "types.h"
 
 namespace mooncake {
@@ -40,13 +42,19 @@ class AllocatorManager {
      * @brief Add an allocator of segment `name` into the manager.
      * @param name the name of the segment
      * @param allocator the buffer allocator to add for the segment
+     * @param failure_domain the rack or other failure domain of the segment,
+     *        empty if unknown
      */
     void addAllocator(const std::string& name,
-                      const std::shared_ptr<BufferAllocatorBase>& allocator) {
+                      const std::shared_ptr<BufferAllocatorBase>& allocator,
+                      const std::string& failure_domain = "") {
         if (!allocators_.contains(name)) {
             names_.push_back(name);
         }
         allocators_[name].push_back(allocator);
+        if (!failure_domain.empty()) {
+            failure_domains_[name] = failure_domain;
+        }
     }
 
     /**
@@ -78,6 +86,7 @@ class AllocatorManager {
         if (it->second.empty()) {
             // If there is no allocator left, remove the name too.
             allocators_.erase(name);
+            failure_domains_.erase(name);
             auto name_it = std::find(names_.begin(), names_.end(), name);
             if (name_it != names_.end()) {
                 std::swap(*name_it, names_.back());
@@ -109,6 +118,29 @@ class AllocatorManager {
         }
     }
 
+    /**
+     * @brief Get the failure domain of the segment `name`.
+     * @return the failure domain, empty if unknown
+     */
+    const std::string& getFailureDomain(const std::string& name) const {
+        static const std::string kUnknown;
+        auto it = failure_domains_.find(name);
+        return it != failure_domains_.end() ? it->second : kUnknown;
+    }
+
+    /**
+     * @brief Get the host of the transport endpoint of segment `name`.
+     * @return the host, empty if the segment does not exist
+     */
+    std::string getHost(const std::string& name) const {
+        auto allocators = getAllocators(name);
+        if (!allocators || allocators->empty() || !allocators->front()) {
+            return "";
+        }
+        return SegmentLoadTracker::HostOf(
+            allocators->front()->getTransportEndpoint());
+    }
+
    private:
     // Name array for randomly picking allocators.
     std::vector<std::string> names_;
@@ -116,6 +148,8 @@ class AllocatorManager {
     std::unordered_map<std::string,
                        std::vector<std::shared_ptr<BufferAllocatorBase>>>
         allocators_;
+    // Segment name to failure domain, for the segments with one.
+    std::unordered_map<std::string, std::string> failure_domains_;
 };
 
 /**
@@ -181,6 +215,206 @@ class AllocationStrategy {
     virtual tl::expected<Replica, ErrorCode> AllocateFrom(
         const AllocatorManager& allocator_manager, const size_t slice_length,
         const std::string& segment_name) = 0;
+
+    /**
+     * @brief Allocates replicas that are each striped across stripe_num
+     *        segments using best-effort semantics, so that the transfer of a
+     *        large slice uses the NICs of several segments in parallel.
+     *
+     * The stripes of a replica are placed on different segments and are
+     * allocated with Allocate. Replicas do not share segments, so fewer
+     * replicas than requested may be returned. The stripe count is capped by
+     * the slice length, and stripe_num <= 1 without parity is a plain
+     * Allocate.
+     *
+     * With parity_num > 0, every replica also gets parity_num Reed-Solomon
+     * parity stripes as long as its longest data stripe, each on a segment
+     * of its own, so the replica survives the loss of parity_num segments.
+     *
+     * @return Same as Allocate. NO_AVAILABLE_HANDLE if not even one replica
+     *         can be placed on stripe_num + parity_num segments.
+     */
+    tl::expected<std::vector<Replica>, ErrorCode> AllocateStriped(
+        const AllocatorManager& allocator_manager, const size_t slice_length,
+        const size_t replica_num, const size_t stripe_num,
+        const size_t parity_num = 0) {
+        const size_t num_stripes = std::min(stripe_num, slice_length);
+        if (num_stripes <= 1 && parity_num == 0) {
+            return Allocate(allocator_manager, slice_length, replica_num);
+        }
+        if (replica_num == 0 || num_stripes == 0 ||
+            num_stripes + parity_num > kMaxStripes) {
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+
+        // The first slice_length % num_stripes stripes hold one extra byte.
+        const size_t stripe_length = slice_length / num_stripes;
+        const size_t num_long = slice_length % num_stripes;
+        const size_t parity_length = stripe_length + (num_long > 0 ? 1 : 0);
+
+        std::vector<Replica> replicas;
+        std::set<std::string> used_segments;
+        for (size_t i = 0; i < replica_num; i++) {
+            std::vector<Replica> stripes;
+            if (!allocateStripes(allocator_manager, stripe_length + 1,
+                                 num_long, used_segments, stripes) ||
+                !allocateStripes(allocator_manager, stripe_length,
+                                 num_stripes - num_long, used_segments,
+                                 stripes) ||
+                !allocateStripes(allocator_manager, parity_length, parity_num,
+                                 used_segments, stripes)) {
+                break;
+            }
+            replicas.push_back(Replica::merge_stripes(
+                std::move(stripes), ReplicaStatus::PROCESSING, parity_num));
+        }
+
+        if (replicas.empty()) {
+            return tl::make_unexpected(ErrorCode::NO_AVAILABLE_HANDLE);
+        }
+        return replicas;
+    }
+
+    // Largest number of data and parity stripes of a replica, limited by the
+    // GF(2^8) Reed-Solomon code
+    static constexpr size_t kMaxStripes = 256;
+
+    /**
+     * @brief Allocates like Allocate, with the replicas spread over hosts
+     *        and failure domains using best-effort semantics.
+     *
+     * Replicas are allocated one by one with Allocate. Each replica after
+     * the first avoids the hosts and failure domains of the replicas before
+     * it; if no segment outside them has space, it avoids their hosts only,
+     * and then only their segments as Allocate does. So one host or rack
+     * failure loses as few replicas as the free space allows, and never
+     * fewer replicas are placed than by Allocate.
+     *
+     * The first replica is tried on the preferred segments, then on the
+     * segments in requester_domain, the failure domain of the requester, so
+     * that reads from the requester stay in its rack.
+     */
+    tl::expected<std::vector<Replica>, ErrorCode> AllocateSpread(
+        const AllocatorManager& allocator_manager, const size_t slice_length,
+        const size_t replica_num,
+        const std::vector<std::string>& preferred_segments =
+            std::vector<std::string>(),
+        const std::string& requester_domain = "") {
+        if (replica_num <= 1 && requester_domain.empty()) {
+            return Allocate(allocator_manager, slice_length, replica_num,
+                            preferred_segments);
+        }
+        if (slice_length == 0 || replica_num == 0) {
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+
+        std::vector<std::string> first_preferred = preferred_segments;
+        if (!requester_domain.empty()) {
+            const auto& names = allocator_manager.getNames();
+            // Rotated by a random offset, so that the segments of the rack
+            // fill up evenly
+            static thread_local std::mt19937 generator(std::random_device{}());
+            const size_t offset =
+                names.empty() ? 0
+                              : std::uniform_int_distribution<size_t>(
+                                    0, names.size() - 1)(generator);
+            for (size_t i = 0; i < names.size(); i++) {
+                const auto& name = names[(i + offset) % names.size()];
+                if (allocator_manager.getFailureDomain(name) ==
+                    requester_domain) {
+                    first_preferred.push_back(name);
+                }
+            }
+        }
+
+        std::vector<Replica> replicas;
+        std::set<std::string> used_segments;
+        std::set<std::string> used_hosts;
+        std::set<std::string> used_domains;
+        while (replicas.size() < replica_num) {
+            std::optional<Replica> replica;
+            if (replicas.empty()) {
+                auto result = Allocate(allocator_manager, slice_length, 1,
+                                       first_preferred);
+                if (!result) {
+                    return tl::make_unexpected(result.error());
+                }
+                replica = std::move(result->front());
+            } else {
+                // Segments sharing a host, or a failure domain, with the
+                // replicas so far
+                std::set<std::string> same_host = used_segments;
+                std::set<std::string> same_domain = used_segments;
+                for (const auto& name : allocator_manager.getNames()) {
+                    if (used_hosts.contains(allocator_manager.getHost(name))) {
+                        same_host.insert(name);
+                        same_domain.insert(name);
+                    } else if (used_domains.contains(
+                                   allocator_manager.getFailureDomain(name))) {
+                        same_domain.insert(name);
+                    }
+                }
+                size_t tried_size = 0;
+                for (const auto* excluded :
+                     {&same_domain, &same_host, &used_segments}) {
+                    // Each set holds the next, so sets of the same size are
+                    // the same
+                    if (excluded->size() == tried_size) continue;
+                    tried_size = excluded->size();
+                    auto result = Allocate(allocator_manager, slice_length, 1,
+                                           {}, *excluded);
+                    if (result) {
+                        replica = std::move(result->front());
+                        break;
+                    }
+                }
+                if (!replica) {
+                    break;
+                }
+            }
+
+            for (const auto& name : replica->get_segment_names()) {
+                if (!name.has_value()) continue;
+                used_segments.insert(*name);
+                auto host = allocator_manager.getHost(*name);
+                if (!host.empty()) {
+                    used_hosts.insert(std::move(host));
+                }
+                const auto& domain = allocator_manager.getFailureDomain(*name);
+                if (!domain.empty()) {
+                    used_domains.insert(domain);
+                }
+            }
+            replicas.push_back(std::move(*replica));
+        }
+        return replicas;
+    }
+
+   private:
+    // Appends count stripes on segments not in used_segments, and adds their
+    // segments to it. Returns false if fewer stripes can be allocated.
+    bool allocateStripes(const AllocatorManager& allocator_manager,
+                         const size_t stripe_length, const size_t count,
+                         std::set<std::string>& used_segments,
+                         std::vector<Replica>& stripes) {
+        if (count == 0) {
+            return true;
+        }
+        auto result = Allocate(allocator_manager, stripe_length, count, {},
+                               used_segments);
+        if (!result || result->size() < count) {
+            return false;
+        }
+        for (auto& stripe : *result) {
+            for (const auto& name : stripe.get_segment_names()) {
+                if (name.has_value()) {
+                    used_segments.insert(*name);
+                }
+            }
+            stripes.push_back(std::move(stripe));
+        }
+        return true;
+    }
 };
 
 /**
@@ -355,6 +589,26 @@ class RandomAllocationStrategy : public AllocationStrategy {
         return nullptr;
     }
 
+   protected:
+    double getSegmentFreeRatio(const AllocatorManager& allocator_manager,
+                               const std::string& name) {
+        auto allocators = allocator_manager.getAllocators(name);
+        if (!allocators || allocators->empty()) return 0.0;
+
+        uint64_t total_capacity = 0;
+        uint64_t total_free = 0;
+        for (const auto& alloc : *allocators) {
+            if (!alloc) continue;
+            auto cap = static_cast<uint64_t>(alloc->capacity());
+            total_capacity += cap;
+            total_free += cap - static_cast<uint64_t>(alloc->size());
+        }
+
+        if (total_capacity == 0) return 0.0;
+        return static_cast<double>(total_free) /
+               static_cast<double>(total_capacity);
+    }
+
    private:
     static constexpr size_t kMaxRetryLimit = 100;
 };
@@ -512,25 +766,199 @@ class FreeRatioFirstAllocationStrategy : public RandomAllocationStrategy {
    private:
     static constexpr size_t kMaxRetryLimit = 100;
     static constexpr size_t kCandidateMultiplier = 6;
+};
 
-    double getSegmentFreeRatio(const AllocatorManager& allocator_manager,
-                               const std::string& name) {
+/**
+ * @brief Load-aware allocation strategy.
+ *
+ * Preferred segments are tried first, as in Random. Every remaining replica
+ * is then placed with power-of-two-choices: two eligible segments are
+ * sampled at random and the one with the higher score is tried first. The
+ * score of a segment is
+ *
+ *   free_ratio - kLoadWeight * load - kDistanceWeight * distance / 2
+ *
+ * - load = bw / (bw + mean_bw), with bw the recent bandwidth of the endpoint
+ *   of the segment reported by the clients in their heartbeats, and mean_bw
+ *   the mean over all endpoints. An idle endpoint scores 0, an average one
+ *   0.5.
+ * - distance is the SegmentLoadTracker distance from the first preferred
+ *   segment, which is the segment of the requester, to the segment.
+ *
+ * Each decision looks at two segments only, so it stays O(1) in the number
+ * of segments. Without a load tracker it compares free ratios only. If the
+ * sampled segments keep failing, the remaining replicas fall back to Random.
+ */
+class LoadAwareAllocationStrategy : public RandomAllocationStrategy {
+   public:
+    explicit LoadAwareAllocationStrategy(
+        std::shared_ptr<const SegmentLoadTracker> load_tracker = nullptr)
+        : load_tracker_(std::move(load_tracker)) {}
+
+    tl::expected<std::vector<Replica>, ErrorCode> Allocate(
+        const AllocatorManager& allocator_manager, const size_t slice_length,
+        const size_t replica_num = 1,
+        const std::vector<std::string>& preferred_segments =
+            std::vector<std::string>(),
+        const std::set<std::string>& excluded_segments =
+            std::set<std::string>()) override {
+        if (slice_length == 0 || replica_num == 0) {
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+
+        const auto& names = allocator_manager.getNames();
+        if (names.empty()) {
+            return tl::make_unexpected(ErrorCode::NO_AVAILABLE_HANDLE);
+        }
+
+        static thread_local std::mt19937 generator(std::random_device{}());
+
+        std::vector<Replica> replicas;
+        replicas.reserve(replica_num);
+        std::set<std::string> used_segments;
+
+        for (const auto& preferred_segment : preferred_segments) {
+            if (excluded_segments.contains(preferred_segment) ||
+                used_segments.contains(preferred_segment)) {
+                continue;
+            }
+
+            auto buffer = allocateSingle(allocator_manager, preferred_segment,
+                                         slice_length, generator);
+            if (buffer) {
+                replicas.emplace_back(std::move(buffer),
+                                      ReplicaStatus::PROCESSING);
+                used_segments.insert(preferred_segment);
+                if (replicas.size() == replica_num) {
+                    return replicas;
+                }
+            }
+        }
+
+        const auto is_eligible = [&](const std::string& name) {
+            return !excluded_segments.contains(name) &&
+                   !used_segments.contains(name);
+        };
+
+        // A requester without a mounted segment is identified by its
+        // endpoint, which is the name of its preferred segment.
+        std::string requester;
+        if (!preferred_segments.empty()) {
+            requester = getEndpoint(allocator_manager, preferred_segments[0]);
+            if (requester.empty()) {
+                requester = preferred_segments[0];
+            }
+        }
+        const auto now = SegmentLoadTracker::Clock::now();
+        const double mean_bandwidth =
+            load_tracker_ ? load_tracker_->GetMeanBandwidth(now) : 0;
+
+        // --- Power-of-two-choices ---
+        std::uniform_int_distribution<size_t> distribution(0, names.size() - 1);
+        const size_t max_retry = std::min(kMaxRetryLimit, names.size());
+        size_t try_count = 0;
+        while (replicas.size() < replica_num && try_count < max_retry) {
+            try_count++;
+            const std::string* first = &names[distribution(generator)];
+            const std::string* second = &names[distribution(generator)];
+            if (!is_eligible(*first)) {
+                std::swap(first, second);
+            }
+            if (!is_eligible(*first)) {
+                continue;
+            }
+            if (*second == *first || !is_eligible(*second)) {
+                second = nullptr;
+            } else if (getScore(allocator_manager, *second, requester,
+                                mean_bandwidth, now) >
+                       getScore(allocator_manager, *first, requester,
+                                mean_bandwidth, now)) {
+                std::swap(first, second);
+            }
+
+            for (const std::string* name : {first, second}) {
+                if (name == nullptr) {
+                    continue;
+                }
+                auto buffer = allocateSingle(allocator_manager, *name,
+                                             slice_length, generator);
+                if (buffer) {
+                    replicas.emplace_back(std::move(buffer),
+                                          ReplicaStatus::PROCESSING);
+                    used_segments.insert(*name);
+                    break;
+                }
+            }
+        }
+
+        if (replicas.size() >= replica_num) {
+            return replicas;
+        }
+
+        // --- Fallback: Random allocation for any remaining replicas ---
+        size_t fallback_idx = distribution(generator);
+        try_count = 0;
+        while (replicas.size() < replica_num && try_count < max_retry) {
+            auto index = fallback_idx % names.size();
+            fallback_idx++;
+            try_count++;
+
+            if (!is_eligible(names[index])) {
+                continue;
+            }
+
+            auto buffer = allocateSingle(allocator_manager, names[index],
+                                         slice_length, generator);
+            if (buffer) {
+                replicas.emplace_back(std::move(buffer),
+                                      ReplicaStatus::PROCESSING);
+                used_segments.insert(names[index]);
+            }
+        }
+
+        if (replicas.empty()) {
+            return tl::make_unexpected(ErrorCode::NO_AVAILABLE_HANDLE);
+        }
+        return replicas;
+    }
+
+   private:
+    static constexpr size_t kMaxRetryLimit = 100;
+    static constexpr double kLoadWeight = 1.0;
+    static constexpr double kDistanceWeight = 0.5;
+
+    std::string getEndpoint(const AllocatorManager& allocator_manager,
+                            const std::string& name) const {
         auto allocators = allocator_manager.getAllocators(name);
-        if (!allocators || allocators->empty()) return 0.0;
+        if (!allocators || allocators->empty() || !allocators->front()) {
+            return "";
+        }
+        return allocators->front()->getTransportEndpoint();
+    }
 
-        uint64_t total_capacity = 0;
-        uint64_t total_free = 0;
-        for (const auto& alloc : *allocators) {
-            if (!alloc) continue;
-            auto cap = static_cast<uint64_t>(alloc->capacity());
-            total_capacity += cap;
-            total_free += cap - static_cast<uint64_t>(alloc->size());
+    double getScore(const AllocatorManager& allocator_manager,
+                    const std::string& name, const std::string& requester,
+                    double mean_bandwidth,
+                    SegmentLoadTracker::Clock::time_point now) {
+        double score = getSegmentFreeRatio(allocator_manager, name);
+        if (!load_tracker_) {
+            return score;
         }
 
-        if (total_capacity == 0) return 0.0;
-        return static_cast<double>(total_free) /
-               static_cast<double>(total_capacity);
+        const std::string endpoint = getEndpoint(allocator_manager, name);
+        if (mean_bandwidth > 0) {
+            const double bandwidth = load_tracker_->GetBandwidth(endpoint, now);
+            score -= kLoadWeight * bandwidth / (bandwidth + mean_bandwidth);
+        }
+        if (!requester.empty()) {
+            score -= kDistanceWeight *
+                     load_tracker_->GetDistance(requester, endpoint) /
+                     SegmentLoadTracker::kRemote;
+        }
+        return score;
     }
+
+    const std::shared_ptr<const SegmentLoadTracker> load_tracker_;
 };
 
 class CxlAllocationStrategy : public AllocationStrategy {
@@ -585,18 +1013,29 @@ class CxlAllocationStrategy : public AllocationStrategy {
         return replicas;
     }
 
+    /**
+     * Allocates from a DRAM segment, used to promote hot objects out of the
+     * CXL memory. CXL segments share one allocator and are only allocated
+     * through Allocate.
+     */
     tl::expected<Replica, ErrorCode> AllocateFrom(
         const AllocatorManager& allocator_manager, const size_t slice_length,
         const std::string& segment_name) {
-        return tl::make_unexpected(ErrorCode::NO_AVAILABLE_HANDLE);
+        return dram_strategy_.AllocateFrom(allocator_manager, slice_length,
+                                           segment_name);
     }
+
+   private:
+    RandomAllocationStrategy dram_strategy_;
 };
 
 /**
- * @brief Factory function to create allocation strategy based on type
+ * @brief Factory function to create allocation strategy based on type. The
+ *        load tracker is only used by the load-aware strategy.
  */
 inline std::shared_ptr<AllocationStrategy> CreateAllocationStrategy(
-    AllocationStrategyType type) {
+    AllocationStrategyType type,
+    std::shared_ptr<const SegmentLoadTracker> load_tracker = nullptr) {
     switch (type) {
         case AllocationStrategyType::RANDOM:
             return std::make_shared<RandomAllocationStrategy>();
@@ -604,6 +1043,9 @@ inline std::shared_ptr<AllocationStrategy> CreateAllocationStrategy(
             return std::make_shared<FreeRatioFirstAllocationStrategy>();
         case AllocationStrategyType::CXL:
             return std::make_shared<CxlAllocationStrategy>();
+        case AllocationStrategyType::LOAD_AWARE:
+            return std::make_shared<LoadAwareAllocationStrategy>(
+                std::move(load_tracker));
         default:
             return std::make_shared<RandomAllocationStrategy>();
     }
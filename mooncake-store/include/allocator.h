@@ -1,13 +1,19 @@
 #ifndef BUFFER_ALLOCATOR_H
 #define BUFFER_ALLOCATOR_H
 
+#include <array>
 #include <atomic>
 #include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "cachelib_memory_allocator/MemoryAllocator.h"
 #include "offset_allocator/offset_allocator.hpp"
+#include "serializer.h"
 #include "types.h"
 
 using facebook::cachelib::MemoryAllocator;
@@ -21,11 +27,18 @@ static constexpr size_t kAllocatorUnknownFreeSpace =
 
 // Forward declarations
 class BufferAllocatorBase;
+class OffsetBufferAllocator;
+
+// Maps the allocators referenced by a snapshot to dense ids. Serialized
+// buffers refer to their allocator by this id.
+using AllocatorIndex =
+    std::unordered_map<const BufferAllocatorBase*, uint32_t>;
 
 class AllocatedBuffer {
    public:
     friend class CachelibBufferAllocator;
     friend class OffsetBufferAllocator;
+    friend class SlabBufferAllocator;
     // Forward declaration of the descriptor struct
     struct Descriptor;
 
@@ -53,11 +66,27 @@ class AllocatedBuffer {
         return !allocator_.expired();
     }
 
+    [[nodiscard]] std::shared_ptr<BufferAllocatorBase> getAllocator() const {
+        return allocator_.lock();
+    }
+
     // Serialize the buffer into a descriptor for transfer
     [[nodiscard]] Descriptor get_descriptor() const;
 
     [[nodiscard]] std::string getSegmentName() const noexcept;
 
+    // Whether the buffer is on the CXL memory shared by all clients
+    [[nodiscard]] bool isCxl() const noexcept {
+        return cxl_segment_name_ != nullptr;
+    }
+
+    // Whether the buffer is in the segment, without copying its name
+    [[nodiscard]] bool isInSegment(const std::string& segment_name) const;
+
+    // Free bytes adjacent to the buffer in its segment, 0 if unknown. Only
+    // tracked for buffers of OffsetBufferAllocator.
+    [[nodiscard]] uint64_t getFreeNeighborSize() const;
+
     // Friend declaration for operator<<
     friend std::ostream& operator<<(std::ostream& os,
                                     const AllocatedBuffer& buffer);
@@ -75,12 +104,36 @@ class AllocatedBuffer {
     void change_to_cxl(std::string client_segment_name);
     void* get_vaddr_from_cxl();
 
+    // Check if the buffer's allocator is alive and has an id in
+    // allocator_index, i.e. the buffer can be serialized.
+    [[nodiscard]] bool isIndexed(const AllocatorIndex& allocator_index) const {
+        auto alloc = allocator_.lock();
+        return alloc && offset_handle_.has_value() &&
+               allocator_index.contains(alloc.get());
+    }
+
+    // Serialize the buffer together with the id of its allocator in
+    // allocator_index. Only buffers of OffsetBufferAllocator are supported.
+    template <typename T>
+    void serialize_to(T& serializer,
+                      const AllocatorIndex& allocator_index) const;
+
+    // Restore a buffer written by serialize_to(). allocators must be the
+    // restored allocators, ordered by their ids in the AllocatorIndex.
+    template <typename T>
+    static std::unique_ptr<AllocatedBuffer> deserialize_from(
+        T& serializer,
+        const std::vector<std::shared_ptr<OffsetBufferAllocator>>& allocators);
+
    private:
+    // The master holds one buffer per memory replica stripe, so the segment
+    // is only known through the allocator and the protocol is implied
     std::weak_ptr<BufferAllocatorBase> allocator_;
-    std::string segment_name_;
     void* buffer_ptr_{nullptr};
     std::size_t size_{0};
-    std::string protocol{"tcp"};
+    // Set by change_to_cxl: the segment of the client whose CXL memory the
+    // buffer is read through
+    std::unique_ptr<std::string> cxl_segment_name_;
     // RAII handle for buffer allocated by offset allocator
     std::optional<offset_allocator::OffsetAllocationHandle> offset_handle_{
         std::nullopt};
@@ -98,8 +151,9 @@ class BufferAllocatorBase {
     virtual void deallocate(AllocatedBuffer* handle) = 0;
     virtual size_t capacity() const = 0;
     virtual size_t size() const = 0;
-    virtual std::string getSegmentName() const = 0;
-    virtual std::string getTransportEndpoint() const = 0;
+    // Fixed for the lifetime of the allocator
+    virtual const std::string& getSegmentName() const = 0;
+    virtual const std::string& getTransportEndpoint() const = 0;
 
     /**
      * Returns the largest free region available in this allocator.
@@ -150,8 +204,10 @@ class CachelibBufferAllocator
 
     size_t capacity() const override { return total_size_; }
     size_t size() const override { return cur_size_.load(); }
-    std::string getSegmentName() const override { return segment_name_; }
-    std::string getTransportEndpoint() const override {
+    const std::string& getSegmentName() const override {
+        return segment_name_;
+    }
+    const std::string& getTransportEndpoint() const override {
         return transport_endpoint_;
     }
 
@@ -201,8 +257,10 @@ class OffsetBufferAllocator
 
     size_t capacity() const override { return total_size_; }
     size_t size() const override { return cur_size_.load(); }
-    std::string getSegmentName() const override { return segment_name_; }
-    std::string getTransportEndpoint() const override {
+    const std::string& getSegmentName() const override {
+        return segment_name_;
+    }
+    const std::string& getTransportEndpoint() const override {
         return transport_endpoint_;
     }
 
@@ -211,7 +269,53 @@ class OffsetBufferAllocator
      */
     size_t getLargestFreeRegion() const override;
 
+    // Serialize the allocator state, including all live allocations.
+    template <typename T>
+    void serialize_to(T& serializer) const;
+
+    template <typename T>
+    static std::shared_ptr<OffsetBufferAllocator> deserialize_from(
+        T& serializer);
+
+    // Re-attach a buffer written by AllocatedBuffer::serialize_to() to this
+    // restored allocator. The allocation is already accounted for in the
+    // restored state, so this does not allocate again.
+    template <typename T>
+    std::unique_ptr<AllocatedBuffer> deserialize_buffer_from(T& serializer);
+
+    // Serve allocations of at most max_cached_size bytes from per-thread
+    // caches, see OffsetAllocator::enableCache(). Must be called before the
+    // allocator is shared.
+    void enableAllocationCache(uint64_t max_cached_size) {
+        offset_allocator_->enableCache(max_cached_size);
+    }
+
+    // Check if [buffer_ptr, buffer_ptr + size) is inside this segment
+    bool contains(const void* buffer_ptr, size_t size) const;
+
+    // Track a buffer that was allocated by another master, e.g. when a
+    // standby master replays the operation log of the leader. The buffer is
+    // accounted in size() but does not own an allocation of the offset
+    // allocator until rebuildAllocations() is called. Returns nullptr if the
+    // buffer is not inside this segment.
+    std::unique_ptr<AllocatedBuffer> adoptBuffer(void* buffer_ptr,
+                                                 size_t size);
+
+    // Rebuild the offset allocator so that exactly the given buffers are
+    // allocated and re-attach their allocations. buffers must contain every
+    // live buffer of this allocator and allocate() must not be called
+    // concurrently. Buffers that cannot be placed, e.g. because they overlap,
+    // are detached from this allocator and become invalid handles.
+    // @return the number of detached buffers
+    size_t rebuildAllocations(const std::vector<AllocatedBuffer*>& buffers);
+
    private:
+    // Initialize from a deserialized offset allocator
+    OffsetBufferAllocator(
+        std::string segment_name, size_t base, size_t size,
+        std::string transport_endpoint, size_t cur_size,
+        std::shared_ptr<offset_allocator::OffsetAllocator> offset_allocator);
+
     // metadata
     const std::string segment_name_;
     const size_t base_;
@@ -223,6 +327,203 @@ class OffsetBufferAllocator
     std::shared_ptr<offset_allocator::OffsetAllocator> offset_allocator_;
 };
 
+/**
+ * SizeClassRegistry learns the size classes of SlabBufferAllocator from the
+ * sizes of the allocation requests. A size becomes a size class once it has
+ * been requested min_count times and at least kMinSlotsPerSlab objects of it
+ * fit into one slab. Learned classes are never dropped, and the registry is
+ * shared by all slab allocators of a master so that every segment serves the
+ * same classes.
+ */
+class SizeClassRegistry {
+   public:
+    static constexpr size_t kMaxSizeClasses = 32;
+    static constexpr uint64_t kMinSlotsPerSlab = 8;
+    // Bounds the histogram of sizes that are not size classes yet
+    static constexpr size_t kMaxTrackedSizes = 4096;
+
+    SizeClassRegistry(uint64_t slab_size, uint32_t min_count);
+
+    /**
+     * Record an allocation request of size bytes.
+     * @return size if it is a size class, 0 if it must be allocated from
+     * the free space of the segment
+     */
+    uint64_t observe(uint64_t size);
+
+    uint64_t slabSize() const { return slab_size_; }
+
+    std::vector<uint64_t> classes() const;
+
+   private:
+    const uint64_t slab_size_;
+    const uint32_t min_count_;
+    // classes_[0, num_classes_) are published and read without the lock
+    std::atomic_size_t num_classes_{0};
+    std::array<std::atomic_uint64_t, kMaxSizeClasses> classes_{};
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, uint32_t> counts_;
+};
+
+/**
+ * SlabBufferAllocator serves the learned size classes of a SizeClassRegistry
+ * from slabs that are split into slots of exactly the class size, so those
+ * allocations take a slot from a free list in O(1), leave no external
+ * fragmentation and need no offset allocation per object. Slabs are carved
+ * from an OffsetAllocator over the segment and go back to it once they are
+ * empty. Other sizes are allocated from the same OffsetAllocator directly.
+ */
+class SlabBufferAllocator
+    : public BufferAllocatorBase,
+      public std::enable_shared_from_this<SlabBufferAllocator> {
+   public:
+    SlabBufferAllocator(std::string segment_name, size_t base, size_t size,
+                        std::string transport_endpoint,
+                        std::shared_ptr<SizeClassRegistry> size_classes);
+
+    ~SlabBufferAllocator() override;
+
+    std::unique_ptr<AllocatedBuffer> allocate(size_t size) override;
+
+    void deallocate(AllocatedBuffer* handle) override;
+
+    size_t capacity() const override { return total_size_; }
+    size_t size() const override { return cur_size_.load(); }
+    const std::string& getSegmentName() const override {
+        return segment_name_;
+    }
+    const std::string& getTransportEndpoint() const override {
+        return transport_endpoint_;
+    }
+
+    /**
+     * Returns the larger of the largest free region of the offset allocator
+     * and the largest size class that has a free slot.
+     */
+    size_t getLargestFreeRegion() const override;
+
+    // Number of slabs currently carved from the segment
+    size_t slabCount() const;
+
+   private:
+    struct Slab {
+        offset_allocator::OffsetAllocationHandle handle;
+        uint64_t class_size;
+        std::vector<uint32_t> free_slots;
+        uint32_t used{0};
+        // Position in the partial slab list of its class, kNotPartial if full
+        size_t partial_index;
+    };
+    static constexpr size_t kNotPartial = std::numeric_limits<size_t>::max();
+
+    void addPartial(std::vector<Slab*>& partial, Slab* slab);
+    void removePartial(std::vector<Slab*>& partial, Slab* slab);
+
+    // metadata
+    const std::string segment_name_;
+    const size_t base_;
+    const size_t total_size_;
+    std::atomic_size_t cur_size_;
+    const std::string transport_endpoint_;
+
+    std::shared_ptr<offset_allocator::OffsetAllocator> offset_allocator_;
+    const std::shared_ptr<SizeClassRegistry> size_classes_;
+
+    mutable std::mutex slab_mutex_;
+    // Slabs by start address, used to find the slab of a freed slot
+    std::map<uintptr_t, std::unique_ptr<Slab>> slabs_;
+    // Slabs with at least one free slot, by class size
+    std::unordered_map<uint64_t, std::vector<Slab*>> partial_slabs_;
+};
+
+template <typename T>
+void AllocatedBuffer::serialize_to(
+    T& serializer, const AllocatorIndex& allocator_index) const {
+    auto alloc = allocator_.lock();
+    if (!alloc || !offset_handle_.has_value() || isCxl()) {
+        serializer.set_error("buffer_not_serializable");
+        return;
+    }
+    auto it = allocator_index.find(alloc.get());
+    if (it == allocator_index.end()) {
+        serializer.set_error("allocator_not_indexed");
+        return;
+    }
+    uint32_t allocator_id = it->second;
+    uint64_t buffer_address = reinterpret_cast<uintptr_t>(buffer_ptr_);
+    uint64_t size = size_;
+    serializer.write(&allocator_id, sizeof(allocator_id));
+    serializer.write(&buffer_address, sizeof(buffer_address));
+    serializer.write(&size, sizeof(size));
+    offset_handle_->serialize_to(serializer);
+}
+
+template <typename T>
+std::unique_ptr<AllocatedBuffer> AllocatedBuffer::deserialize_from(
+    T& serializer,
+    const std::vector<std::shared_ptr<OffsetBufferAllocator>>& allocators) {
+    uint32_t allocator_id = 0;
+    serializer.read(&allocator_id, sizeof(allocator_id));
+    if (allocator_id >= allocators.size() || !allocators[allocator_id]) {
+        throw std::runtime_error("invalid_allocator_id");
+    }
+    return allocators[allocator_id]->deserialize_buffer_from(serializer);
+}
+
+template <typename T>
+void OffsetBufferAllocator::serialize_to(T& serializer) const {
+    if (!offset_allocator_) {
+        serializer.set_error("Allocator is not initialized");
+        return;
+    }
+    uint64_t base = base_;
+    uint64_t total_size = total_size_;
+    uint64_t cur_size = cur_size_.load();
+    serialize_string(serializer, segment_name_);
+    serializer.write(&base, sizeof(base));
+    serializer.write(&total_size, sizeof(total_size));
+    serializer.write(&cur_size, sizeof(cur_size));
+    serialize_string(serializer, transport_endpoint_);
+    offset_allocator_->serialize_to(serializer);
+}
+
+template <typename T>
+std::shared_ptr<OffsetBufferAllocator> OffsetBufferAllocator::deserialize_from(
+    T& serializer) {
+    // serializer.read() will throw an exception if the buffer is corrupted.
+    uint64_t base = 0;
+    uint64_t total_size = 0;
+    uint64_t cur_size = 0;
+    std::string segment_name = deserialize_string(serializer);
+    serializer.read(&base, sizeof(base));
+    serializer.read(&total_size, sizeof(total_size));
+    serializer.read(&cur_size, sizeof(cur_size));
+    std::string transport_endpoint = deserialize_string(serializer);
+    auto offset_allocator =
+        offset_allocator::OffsetAllocator::deserialize_from(serializer);
+    return std::shared_ptr<OffsetBufferAllocator>(new OffsetBufferAllocator(
+        std::move(segment_name), base, total_size,
+        std::move(transport_endpoint), cur_size, std::move(offset_allocator)));
+}
+
+template <typename T>
+std::unique_ptr<AllocatedBuffer> OffsetBufferAllocator::deserialize_buffer_from(
+    T& serializer) {
+    uint64_t buffer_address = 0;
+    uint64_t size = 0;
+    serializer.read(&buffer_address, sizeof(buffer_address));
+    serializer.read(&size, sizeof(size));
+    if (buffer_address < base_ || size > total_size_ ||
+        buffer_address - base_ > total_size_ - size) {
+        throw std::runtime_error("buffer_out_of_segment");
+    }
+    auto handle = offset_allocator::OffsetAllocationHandle::deserialize_from(
+        serializer, offset_allocator_);
+    return std::make_unique<AllocatedBuffer>(
+        shared_from_this(), reinterpret_cast<void*>(buffer_address), size,
+        std::move(handle));
+}
+
 // The main difference is that it allocates real memory and returns it, while
 // BufferAllocator allocates an address
 class SimpleAllocator {
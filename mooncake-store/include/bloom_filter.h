@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace mooncake {
+
+/**
+ * @brief Split block Bloom filter answering key membership without locks.
+ *
+ * Every key sets one bit in each of the eight 32-bit words of a single
+ * 256-bit block, so a lookup touches one cache line. Keys cannot be removed;
+ * removed keys keep answering "maybe" until the filter is rebuilt. Insert
+ * and MayContain may be called concurrently from any thread.
+ */
+class BloomFilter {
+   public:
+    /**
+     * @brief Size the filter for expected_keys keys at bits_per_key bits
+     * each. bits_per_key == 0 disables the filter, which then answers
+     * "maybe" for every key.
+     */
+    BloomFilter(uint64_t expected_keys, uint32_t bits_per_key);
+
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+
+    bool enabled() const { return num_blocks_ > 0; }
+
+    void Insert(std::string_view key);
+
+    // false means the key was never inserted
+    bool MayContain(std::string_view key) const;
+
+    // Forget every key. Not safe against concurrent MayContain callers that
+    // rely on keys inserted before.
+    void Clear();
+
+   private:
+    static constexpr size_t kWordsPerBlock = 8;
+
+    struct alignas(32) Block {
+        std::atomic<uint32_t> words[kWordsPerBlock];
+    };
+
+    uint64_t BlockIndex(uint64_t hash) const;
+
+    uint64_t num_blocks_{0};
+    std::unique_ptr<Block[]> blocks_;
+};
+
+}  // namespace mooncake
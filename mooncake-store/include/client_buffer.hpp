@@ -26,10 +26,13 @@ class BufferHandle;
 class ClientBufferAllocator
     : public std::enable_shared_from_this<ClientBufferAllocator> {
    public:
-    // Create for heap-allocated memory
+    // Create for heap-allocated memory. With use_hugepage, or numa_node >= 0,
+    // or prefault_threads > 0, the buffer is mapped by
+    // allocate_buffer_mmap_memory().
     static std::shared_ptr<ClientBufferAllocator> create(
         size_t size, const std::string& protocol = "",
-        bool use_hugepage = false);
+        bool use_hugepage = false, int numa_node = -1,
+        size_t prefault_threads = 0);
 
     // Create for shared memory
     static std::shared_ptr<ClientBufferAllocator> create(
@@ -54,7 +57,8 @@ class ClientBufferAllocator
    private:
     // Private constructors for different memory types
     ClientBufferAllocator(size_t size, const std::string& protocol,
-                          bool use_hugepage);
+                          bool use_hugepage, int numa_node,
+                          size_t prefault_threads);
     ClientBufferAllocator(void* addr, size_t size, const std::string& protocol);
 
     std::shared_ptr<offset_allocator::OffsetAllocator> allocator_;
@@ -63,7 +67,7 @@ class ClientBufferAllocator
     void* buffer_;
     size_t buffer_size_;
     bool is_external_memory_ = false;
-    bool use_hugepage_ = false;
+    bool use_mmap_ = false;
 };
 
 /**
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <iomanip>
 #include <sstream>
 #include <thread>
 #include <vector>
@@ -8,6 +9,7 @@
 #include <ylt/metric/histogram.hpp>
 #include <ylt/metric/summary.hpp>
 #include "utils.h"
+#include "client_phase_profiler.h"
 #include "hybrid_metric.h"
 
 namespace mooncake {
@@ -272,9 +274,183 @@ struct MasterClientMetric {
     }
 };
 
+struct ReplicaCacheMetric {
+    ReplicaCacheMetric(std::map<std::string, std::string> labels = {})
+        : hits("mooncake_client_replica_cache_hits",
+               "Queries served from the client replica cache", labels),
+          misses("mooncake_client_replica_cache_misses",
+                 "Queries sent to the master on a replica cache miss",
+                 labels) {}
+
+    ylt::metric::counter_t hits;
+    ylt::metric::counter_t misses;
+
+    void serialize(std::string& str) {
+        hits.serialize(str);
+        misses.serialize(str);
+    }
+
+    std::string summary_metrics() {
+        std::stringstream ss;
+        ss << "=== Replica Cache Summary ===\n";
+        auto hit_count = hits.value();
+        auto miss_count = misses.value();
+        ss << "Hits: " << hit_count << ", Misses: " << miss_count;
+        if (hit_count + miss_count > 0) {
+            ss << ", Hit Rate: " << std::fixed << std::setprecision(2)
+               << 100.0 * hit_count / (hit_count + miss_count) << "%";
+        }
+        ss << "\n";
+        return ss.str();
+    }
+};
+
+struct HotCacheMetric {
+    HotCacheMetric(std::map<std::string, std::string> labels = {})
+        : cached_bytes("mooncake_client_hot_cache_cached_bytes",
+                       "Bytes of object data held by the local hot cache",
+                       labels),
+          reserved_bytes(
+              "mooncake_client_hot_cache_reserved_bytes",
+              "Bytes of the local hot cache arena reserved by its blocks",
+              labels) {}
+
+    ylt::metric::gauge_t cached_bytes;
+    ylt::metric::gauge_t reserved_bytes;
+
+    void serialize(std::string& str) {
+        cached_bytes.serialize(str);
+        reserved_bytes.serialize(str);
+    }
+
+    std::string summary_metrics() {
+        std::stringstream ss;
+        ss << "=== Hot Cache Summary ===\n";
+        ss << "Cached: " << byte_size_to_string(cached_bytes.value())
+           << ", Reserved: " << byte_size_to_string(reserved_bytes.value())
+           << "\n";
+        return ss.str();
+    }
+};
+
+// Cost of the CRC32C checksums of MC_STORE_CHECKSUM: computed on put,
+// verified on get
+struct ChecksumMetric {
+    ChecksumMetric(std::map<std::string, std::string> labels = {})
+        : computed_bytes("mooncake_client_checksum_computed_bytes",
+                         "Bytes checksummed when putting objects", labels),
+          compute_time_us("mooncake_client_checksum_compute_time_us",
+                          "Time spent checksumming put objects (us)", labels),
+          verified_bytes("mooncake_client_checksum_verified_bytes",
+                         "Bytes checksummed to verify objects read", labels),
+          verify_time_us("mooncake_client_checksum_verify_time_us",
+                         "Time spent verifying objects read (us)", labels),
+          mismatches("mooncake_client_checksum_mismatches",
+                     "Reads whose data did not match the object checksum",
+                     labels) {}
+
+    ylt::metric::counter_t computed_bytes;
+    ylt::metric::counter_t compute_time_us;
+    ylt::metric::counter_t verified_bytes;
+    ylt::metric::counter_t verify_time_us;
+    ylt::metric::counter_t mismatches;
+
+    void serialize(std::string& str) {
+        computed_bytes.serialize(str);
+        compute_time_us.serialize(str);
+        verified_bytes.serialize(str);
+        verify_time_us.serialize(str);
+        mismatches.serialize(str);
+    }
+
+    std::string summary_metrics() {
+        std::stringstream ss;
+        ss << "=== Checksum Summary ===\n";
+        auto rate = [](int64_t bytes, int64_t us) {
+            // Bytes per microsecond are MB/s
+            return us > 0 ? static_cast<double>(bytes) / us : 0.0;
+        };
+        ss << std::fixed << std::setprecision(1)
+           << "Computed: " << byte_size_to_string(computed_bytes.value())
+           << " in " << compute_time_us.value() << "us ("
+           << rate(computed_bytes.value(), compute_time_us.value())
+           << " MB/s), Verified: "
+           << byte_size_to_string(verified_bytes.value()) << " in "
+           << verify_time_us.value() << "us ("
+           << rate(verified_bytes.value(), verify_time_us.value())
+           << " MB/s), Mismatches: " << mismatches.value() << "\n";
+        return ss.str();
+    }
+};
+
+// Cumulative time of the phases of the client read path, see
+// ClientPhaseProfiler. Exported as counters labeled by phase.
+struct ClientPhaseMetric {
+    ClientPhaseMetric(std::map<std::string, std::string> labels = {})
+        : labels_(std::move(labels)) {}
+
+    ClientPhaseProfiler profiler;
+
+    void serialize(std::string& str) {
+        const auto stats = profiler.Snapshot();
+        str += "# HELP mooncake_client_phase_time_us Cumulative time spent "
+               "in each client read phase (us)\n";
+        str += "# TYPE mooncake_client_phase_time_us counter\n";
+        for (size_t i = 0; i < stats.size(); ++i) {
+            str += "mooncake_client_phase_time_us" + format_labels(i) + " " +
+                   std::to_string(static_cast<uint64_t>(stats[i].total_us)) +
+                   "\n";
+        }
+        str += "# HELP mooncake_client_phase_count Number of times each "
+               "client read phase ran\n";
+        str += "# TYPE mooncake_client_phase_count counter\n";
+        for (size_t i = 0; i < stats.size(); ++i) {
+            str += "mooncake_client_phase_count" + format_labels(i) + " " +
+                   std::to_string(stats[i].count) + "\n";
+        }
+    }
+
+    std::string summary_metrics() {
+        std::stringstream ss;
+        ss << "=== Client Phase Summary ===\n";
+        const auto stats = profiler.Snapshot();
+        bool found_any = false;
+        for (size_t i = 0; i < stats.size(); ++i) {
+            if (stats[i].count == 0) continue;
+            found_any = true;
+            ss << ClientPhaseName(static_cast<ClientPhase>(i))
+               << ": count=" << stats[i].count << std::fixed
+               << std::setprecision(1) << ", total=" << stats[i].total_us
+               << "μs, avg=" << stats[i].total_us / stats[i].count << "μs\n";
+        }
+        if (!found_any) {
+            ss << "No phases recorded\n";
+        }
+        return ss.str();
+    }
+
+   private:
+    std::string format_labels(size_t phase) const {
+        std::string str = "{";
+        for (const auto& [key, value] : labels_) {
+            str += key + "=\"" + value + "\",";
+        }
+        str += "phase=\"";
+        str += ClientPhaseName(static_cast<ClientPhase>(phase));
+        str += "\"}";
+        return str;
+    }
+
+    std::map<std::string, std::string> labels_;
+};
+
 struct ClientMetric {
     TransferMetric transfer_metric;
     MasterClientMetric master_client_metric;
+    ReplicaCacheMetric replica_cache_metric;
+    HotCacheMetric hot_cache_metric;
+    ChecksumMetric checksum_metric;
+    ClientPhaseMetric phase_metric;
 
     /**
      * @brief Creates a ClientMetric instance based on environment variables
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace mooncake {
+
+// Phases of the client read path that ClientPhaseProfiler times
+enum class ClientPhase : uint8_t {
+    kMasterQuery = 0,        // replica list RPCs to the master
+    kFindReplica,            // FindFirstCompleteReplica
+    kPreferredReplica,       // GetPreferredReplica
+    kHotCacheLookup,         // local hot cache redirection
+    kSubmit,                 // transfer submission
+    kWait,                   // waiting for transfers to complete
+    kNumPhases,
+};
+
+inline const char* ClientPhaseName(ClientPhase phase) {
+    switch (phase) {
+        case ClientPhase::kMasterQuery:
+            return "master_query";
+        case ClientPhase::kFindReplica:
+            return "find_replica";
+        case ClientPhase::kPreferredReplica:
+            return "preferred_replica";
+        case ClientPhase::kHotCacheLookup:
+            return "hot_cache_lookup";
+        case ClientPhase::kSubmit:
+            return "submit";
+        case ClientPhase::kWait:
+            return "wait";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief Cumulative time and call count of each ClientPhase.
+ *
+ * A phase is timed with the CPU timestamp counter and added to counters of
+ * the calling thread, so recording takes two counter reads and two
+ * uncontended stores. Readers sum the counters of all threads and convert
+ * ticks to microseconds with the tick rate measured since construction,
+ * which assumes an invariant TSC as on all current server CPUs.
+ */
+class ClientPhaseProfiler {
+   public:
+    static constexpr size_t kNumPhases =
+        static_cast<size_t>(ClientPhase::kNumPhases);
+
+    struct PhaseStats {
+        uint64_t count = 0;
+        double total_us = 0;
+    };
+
+    ClientPhaseProfiler()
+        : id_(next_id_.fetch_add(1, std::memory_order_relaxed)),
+          start_ticks_(ReadTicks()),
+          start_time_(std::chrono::steady_clock::now()) {}
+
+    ClientPhaseProfiler(const ClientPhaseProfiler&) = delete;
+    ClientPhaseProfiler& operator=(const ClientPhaseProfiler&) = delete;
+
+    static uint64_t ReadTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    void Record(ClientPhase phase, uint64_t ticks) {
+        auto& slot = LocalSlot().phases[static_cast<size_t>(phase)];
+        // Only this thread writes its slot, so plain stores are enough
+        slot.ticks.store(slot.ticks.load(std::memory_order_relaxed) + ticks,
+                         std::memory_order_relaxed);
+        slot.count.store(slot.count.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    }
+
+    // Totals of each phase over all threads, indexed by ClientPhase
+    std::array<PhaseStats, kNumPhases> Snapshot() const {
+        std::array<uint64_t, kNumPhases> ticks{};
+        std::array<PhaseStats, kNumPhases> stats{};
+        {
+            std::lock_guard<std::mutex> lock(slots_mutex_);
+            for (const auto& slot : slots_) {
+                for (size_t i = 0; i < kNumPhases; ++i) {
+                    ticks[i] +=
+                        slot->phases[i].ticks.load(std::memory_order_relaxed);
+                    stats[i].count +=
+                        slot->phases[i].count.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        const double ticks_per_us = TicksPerUs();
+        for (size_t i = 0; i < kNumPhases; ++i) {
+            stats[i].total_us = ticks_per_us > 0 ? ticks[i] / ticks_per_us : 0;
+        }
+        return stats;
+    }
+
+   private:
+    struct PhaseCounters {
+        std::atomic<uint64_t> ticks{0};
+        std::atomic<uint64_t> count{0};
+    };
+
+    struct ThreadSlot {
+        std::array<PhaseCounters, kNumPhases> phases;
+    };
+
+    // Slot of the calling thread, registered on its first call. The
+    // thread caches the slot of the last profiler it used, which keeps a
+    // single lookup per call as a thread normally serves one client.
+    ThreadSlot& LocalSlot() {
+        thread_local uint64_t cached_id = 0;
+        thread_local ThreadSlot* cached_slot = nullptr;
+        if (cached_id == id_) {
+            return *cached_slot;
+        }
+        auto slot = std::make_unique<ThreadSlot>();
+        cached_slot = slot.get();
+        cached_id = id_;
+        std::lock_guard<std::mutex> lock(slots_mutex_);
+        slots_.push_back(std::move(slot));
+        return *cached_slot;
+    }
+
+    double TicksPerUs() const {
+        const auto elapsed_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start_time_)
+                .count();
+        if (elapsed_us <= 0) {
+            return 0;
+        }
+        return static_cast<double>(ReadTicks() - start_ticks_) / elapsed_us;
+    }
+
+    // Ids start at 1 so that no profiler matches a thread's empty cache
+    static inline std::atomic<uint64_t> next_id_{1};
+
+    const uint64_t id_;
+    const uint64_t start_ticks_;
+    const std::chrono::steady_clock::time_point start_time_;
+    mutable std::mutex slots_mutex_;
+    std::vector<std::unique_ptr<ThreadSlot>> slots_;
+};
+
+/**
+ * @brief Adds the time between its construction and destruction to a
+ * phase. Does nothing if profiler is null.
+ */
+class ScopedPhaseTimer {
+   public:
+    ScopedPhaseTimer(ClientPhaseProfiler* profiler, ClientPhase phase)
+        : profiler_(profiler),
+          phase_(phase),
+          start_(profiler ? ClientPhaseProfiler::ReadTicks() : 0) {}
+
+    ~ScopedPhaseTimer() {
+        if (profiler_) {
+            profiler_->Record(phase_,
+                              ClientPhaseProfiler::ReadTicks() - start_);
+        }
+    }
+
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+    ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+   private:
+    ClientPhaseProfiler* profiler_;
+    ClientPhase phase_;
+    uint64_t start_;
+};
+
+}  // namespace mooncake
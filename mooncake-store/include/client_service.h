@@ -5,6 +5,7 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <string>
 #include <thread>
 #include <vector>
@@ -22,7 +23,12 @@
 #include "types.h"
 #include "replica.h"
 #include "master_metric_manager.h"
+#include "device_hot_cache.h"
 #include "local_hot_cache.h"
+#include "negative_exist_cache.h"
+#include "replica_cache.h"
+#include "replica_load_tracker.h"
+#include "replica_task_executor.h"
 
 namespace mooncake {
 
@@ -38,11 +44,19 @@ class QueryResult {
     const std::vector<Replica::Descriptor> replicas;
     /** @brief Time point when the lease for this key expires */
     const std::chrono::steady_clock::time_point lease_timeout;
+    /** @brief Whether the reader should copy the object back to memory */
+    const bool promote;
+    /** @brief CRC32C of the object, if its writer reported one */
+    const std::optional<uint32_t> checksum;
 
     QueryResult(std::vector<Replica::Descriptor>&& replicas_param,
-                std::chrono::steady_clock::time_point lease_timeout_param)
+                std::chrono::steady_clock::time_point lease_timeout_param,
+                bool promote_param = false,
+                std::optional<uint32_t> checksum_param = std::nullopt)
         : replicas(std::move(replicas_param)),
-          lease_timeout(lease_timeout_param) {}
+          lease_timeout(lease_timeout_param),
+          promote(promote_param),
+          checksum(checksum_param) {}
 
     bool IsLeaseExpired() const {
         return std::chrono::steady_clock::now() >= lease_timeout;
@@ -86,19 +100,25 @@ class Client {
      * @brief Retrieves data for a given key
      * @param object_key Key to retrieve
      * @param slices Vector of slices to store the retrieved data
+     * @param deadline Transfers still pending at the deadline are canceled
+     * and the get fails with TRANSFER_TIMEOUT
      * @return ErrorCode indicating success/failure
      */
     tl::expected<void, ErrorCode> Get(const std::string& object_key,
-                                      std::vector<Slice>& slices);
+                                      std::vector<Slice>& slices,
+                                      Deadline deadline = kNoDeadline);
 
     /**
      * @brief Batch retrieve data for multiple keys
      * @param object_keys Keys to query
      * @param slices Map of object keys to their data slices
+     * @param deadline Keys whose transfers are still pending at the
+     * deadline fail with TRANSFER_TIMEOUT
      */
     std::vector<tl::expected<void, ErrorCode>> BatchGet(
         const std::vector<std::string>& object_keys,
-        std::unordered_map<std::string, std::vector<Slice>>& slices);
+        std::unordered_map<std::string, std::vector<Slice>>& slices,
+        Deadline deadline = kNoDeadline);
 
     /**
      * @brief Batch query IP addresses for multiple client IDs.
@@ -139,6 +159,17 @@ class Client {
     std::vector<tl::expected<QueryResult, ErrorCode>> BatchQuery(
         const std::vector<std::string>& object_keys);
 
+    /**
+     * @brief Warms the caches for keys that will be read soon and returns at
+     * once. In the background the replicas of the keys are resolved, which
+     * fills the replica cache if it is enabled, and with a local hot cache
+     * the objects held in the memory of other clients are read straight
+     * into it. Prefetches run one batch after the other on their own thread.
+     * @param object_keys Keys to prefetch
+     * @return false if too many prefetches are already queued
+     */
+    bool Prefetch(const std::vector<std::string>& object_keys);
+
     /**
      * @brief Batch clear KV cache for specified object keys on a specific
      * segment for a given client.
@@ -159,34 +190,105 @@ class Client {
      * @param query_result Previously queried object metadata containing
      * replicas and lease timeout
      * @param slices Vector of slices to store the data
+     * @param deadline See Get(object_key, slices, deadline)
      * @return ErrorCode indicating success/failure
      */
     tl::expected<void, ErrorCode> Get(const std::string& object_key,
                                       const QueryResult& query_result,
-                                      std::vector<Slice>& slices);
+                                      std::vector<Slice>& slices,
+                                      Deadline deadline = kNoDeadline);
     /**
      * @brief Transfers data using pre-queried object information
      * @param object_keys Keys of the objects
      * @param query_results Previously queried object metadata for each key
      * @param slices Map of object keys to their data slices
+     * @param deadline See BatchGet(object_keys, slices, deadline)
      * @return Vector of ErrorCode results for each object
      */
     std::vector<tl::expected<void, ErrorCode>> BatchGet(
         const std::vector<std::string>& object_keys,
         const std::vector<QueryResult>& query_results,
         std::unordered_map<std::string, std::vector<Slice>>& slices,
-        bool prefer_same_node = false);
+        bool prefer_same_node = false, Deadline deadline = kNoDeadline);
+
+    /**
+     * @brief Copies an object that was just read from disk back to memory,
+     * as asked by the master through QueryResult::promote. The memory
+     * replica is preferably placed in the segments of this client.
+     * @param key Object key
+     * @param slices Data of the object
+     * @return ErrorCode indicating success/failure
+     */
+    tl::expected<void, ErrorCode> Promote(const std::string& key,
+                                          const std::vector<Slice>& slices);
 
     /**
      * @brief Stores data with replication
      * @param key Object key
      * @param slices Vector of data slices to store
      * @param config Replication configuration
+     * @param deadline Transfers still pending at the deadline are canceled,
+     * and the put is revoked and fails with TRANSFER_TIMEOUT
      * @return ErrorCode indicating success/failure
      */
     tl::expected<void, ErrorCode> Put(const ObjectKey& key,
                                       std::vector<Slice>& slices,
-                                      const ReplicateConfig& config);
+                                      const ReplicateConfig& config,
+                                      Deadline deadline = kNoDeadline);
+
+    /**
+     * @brief Starts a streaming put. The object is allocated up front and
+     * written chunk by chunk with StreamPutChunk; readers can fetch the
+     * committed chunks with GetRange before StreamPutEnd. Only unstriped
+     * memory replicas are streamed.
+     * @param key Object key
+     * @param chunk_lengths Lengths of the chunks, in object order
+     * @param config Replication configuration
+     */
+    tl::expected<void, ErrorCode> StreamPutStart(
+        const ObjectKey& key, const std::vector<uint64_t>& chunk_lengths,
+        const ReplicateConfig& config);
+
+    /**
+     * @brief Writes one chunk of a streaming put to every replica and
+     * commits it. The put is revoked if the write fails.
+     * @param key Object key
+     * @param chunk_index Index of the chunk
+     * @param slices Data of the chunk, as long as the chunk
+     */
+    tl::expected<void, ErrorCode> StreamPutChunk(const ObjectKey& key,
+                                                 uint64_t chunk_index,
+                                                 std::vector<Slice>& slices);
+
+    /**
+     * @brief Completes a streaming put, which must have committed all its
+     * chunks
+     * @param key Object key
+     */
+    tl::expected<void, ErrorCode> StreamPutEnd(const ObjectKey& key);
+
+    /**
+     * @brief Reads a byte range of an object, which may still be streamed.
+     * Fails with REPLICA_IS_NOT_READY until the chunks covering the range
+     * are committed.
+     * @param key Object key
+     * @param offset Offset of the range in the object
+     * @param slices Buffers to read into; the range is as long as they are
+     */
+    tl::expected<void, ErrorCode> GetRange(const ObjectKey& key,
+                                           uint64_t offset,
+                                           std::vector<Slice>& slices);
+
+    /**
+     * @brief Reads several byte ranges of an object with one replica lookup
+     * and one batch of transfers, e.g. the strided rows of a tensor shard
+     * @param key Object key
+     * @param offsets Offsets of the ranges in the object
+     * @param slices Buffers of each range; a range is as long as its buffers
+     */
+    tl::expected<void, ErrorCode> GetRanges(
+        const ObjectKey& key, const std::vector<uint64_t>& offsets,
+        std::vector<std::vector<Slice>>& slices);
 
     /**
      * @brief Batch put data with replication
@@ -282,6 +384,16 @@ class Client {
     std::vector<tl::expected<bool, ErrorCode>> BatchIsExist(
         const std::vector<std::string>& keys);
 
+    /**
+     * @brief Counts how many of the keys, from the first on, all exist,
+     * e.g. the cached blocks of a prefix
+     * @param keys Keys to check, in order
+     * @return The index of the first missing key, or keys.size() if every
+     * key exists
+     */
+    tl::expected<size_t, ErrorCode> BatchIsExistPrefix(
+        const std::vector<std::string>& keys);
+
     /**
      * @brief Create a copy task to copy an object's replicas to target segments
      * @param key Object key
@@ -410,6 +522,11 @@ class Client {
         return transfer_engine_->getLocalIpAndPort();
     }
 
+    // NIC topology of the local transfer engine
+    [[nodiscard]] std::shared_ptr<Topology> GetLocalTopology() {
+        return transfer_engine_->getLocalTopology();
+    }
+
     tl::expected<Replica::Descriptor, ErrorCode> GetPreferredReplica(
         const std::vector<Replica::Descriptor>& replica_list);
     /**
@@ -448,11 +565,39 @@ class Client {
     void InitTransferSubmitter();
     ErrorCode TransferData(const Replica::Descriptor& replica_descriptor,
                            std::vector<Slice>& slices,
-                           TransferRequest::OpCode op_code);
+                           TransferRequest::OpCode op_code,
+                           Deadline deadline = kNoDeadline);
     ErrorCode TransferWrite(const Replica::Descriptor& replica_descriptor,
-                            std::vector<Slice>& slices);
+                            std::vector<Slice>& slices,
+                            Deadline deadline = kNoDeadline);
     ErrorCode TransferRead(const Replica::Descriptor& replica_descriptor,
-                           std::vector<Slice>& slices);
+                           std::vector<Slice>& slices,
+                           Deadline deadline = kNoDeadline);
+
+    // Puts through a put lease, nullopt if the put must take PutStart
+    std::optional<tl::expected<void, ErrorCode>> PutWithLease(
+        const ObjectKey& key, std::vector<Slice>& slices,
+        const ReplicateConfig& config, Deadline deadline);
+    void InitPutLeases();
+    void ReleasePutLeases();
+
+    /**
+     * @brief CRC32C of the object held by slices if MC_STORE_CHECKSUM is
+     * set, std::nullopt otherwise or if the slices are in device memory.
+     */
+    std::optional<uint32_t> ComputeChecksum(const std::vector<Slice>& slices);
+
+    /**
+     * @brief Check the object read from replica into slices against the
+     * checksum its writer reported. Reads from disk are checked whenever
+     * there is a checksum, reads from memory only with
+     * MC_STORE_CHECKSUM_VERIFY_MEMORY set.
+     * @return ErrorCode::CHECKSUM_MISMATCH if the data does not match
+     */
+    ErrorCode VerifyChecksum(const std::string& key,
+                             const std::optional<uint32_t>& checksum,
+                             const Replica::Descriptor& replica,
+                             const std::vector<Slice>& slices);
 
     /**
      * @brief Prepare and use the storage backend for persisting data
@@ -478,6 +623,29 @@ class Client {
      */
     size_t GetLocalHotCacheSizeFromEnv();
 
+    /**
+     * @brief Initialize the GPU memory tier of the hot cache if
+     * MC_STORE_DEVICE_HOT_CACHE_SIZE is set to a positive number of bytes
+     * per device
+     */
+    void InitDeviceHotCache();
+
+    /**
+     * @brief Initialize the replica cache if MC_STORE_REPLICA_CACHE_SIZE is
+     * set to a positive number of keys
+     */
+    void InitReplicaCache();
+
+    /**
+     * @brief Initialize the negative exist cache if
+     * MC_STORE_NEGATIVE_CACHE_SIZE is set to a positive number of keys
+     */
+    void InitNegativeExistCache();
+
+    // BatchIsExist without the negative exist cache
+    std::vector<tl::expected<bool, ErrorCode>> BatchIsExistUncached(
+        const std::vector<std::string>& keys);
+
     /**
      * @brief Read LOCAL_HOT_BLOCK_SIZE from environment variable
      * @param default_value Default block size to use if env var is not set or
@@ -487,6 +655,14 @@ class Client {
      */
     size_t GetLocalHotBlockSizeFromEnv(size_t default_value);
 
+    /**
+     * @brief Fill slices from the GPU memory tier of the hot cache
+     * @return true if the object was copied from the tier into slices
+     */
+    bool ReadFromDeviceHotCache(const std::string& key,
+                                const Replica::Descriptor& replica,
+                                const std::vector<Slice>& slices);
+
     /**
      * @brief Redirect replica descriptor to local hot cache if cache hit
      * @param key Object key
@@ -525,11 +701,18 @@ class Client {
     std::vector<PutOperation> CreatePutOperations(
         const std::vector<ObjectKey>& keys,
         const std::vector<std::vector<Slice>>& batched_slices);
-    void StartBatchPut(std::vector<PutOperation>& ops,
+    void StartBatchPut(std::span<PutOperation> ops,
                        const ReplicateConfig& config);
-    void SubmitTransfers(std::vector<PutOperation>& ops);
-    void WaitForTransfers(std::vector<PutOperation>& ops);
-    void FinalizeBatchPut(std::vector<PutOperation>& ops);
+    void SubmitTransfers(std::span<PutOperation> ops);
+    void WaitForTransfers(std::span<PutOperation> ops);
+    void FinalizeBatchPut(std::span<PutOperation> ops);
+
+    /**
+     * @brief Run the put stages over sub-batches of ops, so that the master
+     * RPCs of some sub-batches overlap with the transfers of another one.
+     */
+    void PipelinedBatchPut(std::vector<PutOperation>& ops,
+                           const ReplicateConfig& config);
     std::vector<tl::expected<void, ErrorCode>> CollectResults(
         const std::vector<PutOperation>& ops);
 
@@ -538,7 +721,8 @@ class Client {
     std::vector<tl::expected<void, ErrorCode>> BatchGetWhenPreferSameNode(
         const std::vector<std::string>& object_keys,
         const std::vector<QueryResult>& query_results,
-        std::unordered_map<std::string, std::vector<Slice>>& slices);
+        std::unordered_map<std::string, std::vector<Slice>>& slices,
+        Deadline deadline);
 
     // Client identification
     const UUID client_id_;
@@ -546,15 +730,34 @@ class Client {
     // Client-side metrics
     std::unique_ptr<ClientMetric> metrics_;
 
+    // Profiler of the read path phases, null if metrics are disabled
+    ClientPhaseProfiler* phase_profiler() const {
+        return metrics_ ? &metrics_->phase_metric.profiler : nullptr;
+    }
+
     // Core components
     std::shared_ptr<TransferEngine> transfer_engine_;
     MasterClient master_client_;
     std::unique_ptr<TransferSubmitter> transfer_submitter_;
+    // Traffic of transfer_submitter_, sent to the master by the ping thread
+    SegmentTrafficCounter segment_traffic_;
 
     // Mutex to protect mounted_segments_
     std::mutex mounted_segments_mutex_;
     std::unordered_map<UUID, Segment, boost::hash<UUID>> mounted_segments_;
 
+    // Streaming puts started by this client
+    struct StreamPut {
+        std::vector<Replica::Descriptor> replicas;
+        // Offset of each chunk in the object, plus the object size
+        std::vector<uint64_t> chunk_offsets;
+        std::vector<bool> written;
+        // Of each written chunk, combined into the object's one at the end
+        std::vector<std::optional<uint32_t>> chunk_checksums;
+    };
+    std::mutex stream_puts_mutex_;
+    std::unordered_map<ObjectKey, StreamPut> stream_puts_;
+
     // Configuration
     const std::string local_hostname_;
     const std::string metadata_connstring_;
@@ -566,67 +769,135 @@ class Client {
 
     // For high availability
     MasterViewHelper master_view_helper_;
+    // For partitioned masters
+    PartitionRingHelper partition_ring_helper_;
     std::thread ping_thread_;
     std::atomic<bool> ping_running_{false};
     void PingThreadMain(bool is_ha_mode, std::string current_master_address);
+    // Reconnects to the partitioned masters if their ring changed
+    void RefreshPartitionRing();
     void PollAndDispatchTasks();
+    // Long-polls the master for tasks until period has passed, dispatching
+    // them as they come
+    void WaitAndDispatchTasks(std::chrono::milliseconds period);
     void SubmitTask(const TaskAssignment& assignment);
 
     // For task management
-    // Client-side task representation
-    struct ClientTask {
-        TaskAssignment assignment;
-        uint32_t retry_count = 0;
-
-        void increment_retry() { retry_count++; }
+    // The replica transfer of a started copy or move task
+    struct ReplicaTransfer {
+        TaskType type;
+        std::string key;
+        Replica::Descriptor source;
+        std::vector<Replica::Descriptor> targets;
     };
 
-    void ExecuteTask(const ClientTask& client_task);
+    // Runs a batch of tasks of task_executor_, their transfers together
+    void ExecuteTaskBatch(std::vector<ReplicaTask>& tasks);
 
-    tl::expected<void, ErrorCode> ExecuteReplicaTransfer(
-        const std::string& key, const std::string& action_name,
-        std::function<tl::expected<void, ErrorCode>()> end_fn,
-        std::function<tl::expected<void, ErrorCode>()> revoke_fn,
-        const Replica::Descriptor& source,
-        const std::vector<Replica::Descriptor>& targets);
+    // Reports the result of a task to the master, or queues a retry
+    void CompleteTask(const ReplicaTask& task, ErrorCode result);
 
     /**
-     * @brief Copy an object's replica to target segments
-     * @param key Object key
-     * @param source Source segment
-     * @param targets Target segments
-     * @return tl::expected<void, ErrorCode> indicating success/failure
+     * @brief Starts the copy or move of a task: the master allocates the
+     * target replicas of the object.
+     * @return The transfer to do, or nullopt if the targets already exist
+     * and the task is done
      */
-    tl::expected<void, ErrorCode> Copy(const std::string& key,
-                                       const std::string& source,
-                                       const std::vector<std::string>& targets);
+    tl::expected<std::optional<ReplicaTransfer>, ErrorCode> StartReplicaTask(
+        const TaskAssignment& assignment);
 
     /**
-     * @brief Move an object's replica from source segment to target segment
-     * @param key Object key
-     * @param source Source segment
-     * @param target Target segment
-     * @return tl::expected<void, ErrorCode> indicating success/failure
+     * @brief Writes the source replicas of the transfers to their targets at
+     * NORMAL priority, as one transfer batch unless it fails, within the
+     * bandwidth budget of task_executor_.
+     * @return The result of each transfer
      */
-    tl::expected<void, ErrorCode> Move(const std::string& key,
-                                       const std::string& source,
-                                       const std::string& target);
+    std::vector<ErrorCode> TransferReplicas(
+        const std::vector<ReplicaTransfer>& transfers);
+
+    // CopyEnd/MoveEnd if success, else CopyRevoke/MoveRevoke
+    tl::expected<void, ErrorCode> EndReplicaTransfer(
+        const ReplicaTransfer& transfer, bool success);
 
     bool IsReplicaOnLocalMemory(const Replica::Descriptor& replica);
 
-    // Task thread pool for async task execution
-    ThreadPool task_thread_pool_;
+    // Among the complete unstriped memory replicas from replica_list[first]
+    // on that are in its tier and not excluded, a local one, or else the
+    // less loaded of two random ones. Otherwise replica_list[first].
+    const Replica::Descriptor& SelectReplica(
+        const std::vector<Replica::Descriptor>& replica_list, size_t first,
+        const Replica::Descriptor* excluded = nullptr);
+
+    // Runs the replica tasks fetched from the master
+    ReplicaTaskExecutor task_executor_;
     std::atomic<bool> task_running_{true};
 
     // Task polling configuration
     static constexpr size_t kTaskBatchSize =
-        16;  // Number of tasks to fetch per poll
+        64;  // Number of tasks to fetch per poll
 
     bool te_initialized_{false};
 
     // Local hot cache and async handler
     std::shared_ptr<LocalHotCache> hot_cache_;
     std::unique_ptr<LocalHotCacheHandler> hot_cache_handler_;
+    // Hot cache tier in GPU memory for reads into GPU memory, nullptr if
+    // disabled
+    std::unique_ptr<DeviceHotCache> device_hot_cache_;
+
+    // Replica descriptors of recently queried keys, nullptr if disabled
+    std::unique_ptr<ReplicaCache> replica_cache_;
+
+    // Keys recently found missing, nullptr if disabled
+    std::unique_ptr<NegativeExistCache> negative_exist_cache_;
+
+    // Latency and reads in flight of the endpoints read from, used to
+    // choose among replicas; nullptr if MC_STORE_LOAD_AWARE_REPLICA=0
+    std::unique_ptr<ReplicaLoadTracker> replica_load_tracker_;
+
+    // Whether BatchGet reads the keys on one peer as one transfer batch,
+    // unless MC_STORE_BATCH_GET_GROUP_BY_PEER=0
+    bool group_batch_get_by_peer_{true};
+
+    // Prefetches queued by Prefetch(), run by a single worker so that they
+    // stay behind the foreground traffic. The hot cache arena is registered
+    // with the transfer engine by the first prefetch that reads into it.
+    void PrefetchKeys(const std::vector<std::string>& object_keys);
+    static constexpr size_t kMaxPendingPrefetches = 64;
+    std::atomic<size_t> pending_prefetches_{0};
+    bool hot_cache_registered_{false};
+    ThreadPool prefetch_thread_pool_;
+
+    // BatchPut pipelining, read from MC_STORE_BATCH_PUT_PIPELINE_SIZE and
+    // MC_STORE_BATCH_PUT_PIPELINE_DEPTH. A size of 0 disables pipelining.
+    size_t batch_put_pipeline_size_{0};   // keys per sub-batch
+    size_t batch_put_pipeline_depth_{2};  // sub-batches started ahead
+
+    // CRC32C checksums of objects, from MC_STORE_CHECKSUM and
+    // MC_STORE_CHECKSUM_VERIFY_MEMORY
+    bool compute_checksums_{false};
+    bool verify_memory_checksums_{false};
+
+    // Put leases, so that small puts take one master call, see
+    // MasterService::GrantPutLease. A lease has up to
+    // MC_STORE_PUT_LEASE_SLOTS slots; 0 disables leases, as does a master
+    // that grants none.
+    struct PutLeaseCache {
+        uint64_t lease_id{0};
+        std::vector<std::vector<Replica::Descriptor>> slots;
+        size_t next_slot{0};
+        // Slots are not taken after this, so that their writes end before
+        // the master drops the lease
+        std::chrono::steady_clock::time_point use_until;
+        // Doubles while leases are used up in time, halves otherwise
+        uint64_t grant_slots{1};
+    };
+    static constexpr uint64_t kMaxLeasedPutSize = 1024 * 1024;
+    static constexpr size_t kMaxPutLeaseSizes = 16;
+    std::atomic<uint64_t> put_lease_slots_{0};
+    std::mutex put_leases_mutex_;
+    // By value size and replica count
+    std::map<std::pair<uint64_t, size_t>, PutLeaseCache> put_leases_;
 };
 
 }  // namespace mooncake
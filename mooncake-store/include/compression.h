@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace mooncake {
+
+/**
+ * @brief Codec of a compressed value. The values are stored on disk, do not
+ * renumber them.
+ */
+enum class CompressionCodec : uint8_t {
+    kNone = 0,
+    kLz4 = 1,
+    kZstd = 2,
+};
+
+/**
+ * @brief Codec named "none", "lz4" or "zstd", or nullopt for other names.
+ */
+std::optional<CompressionCodec> ParseCompressionCodec(const std::string& name);
+
+const char* CompressionCodecName(CompressionCodec codec);
+
+/**
+ * @brief Whether the store was built with the library of the codec. kNone
+ * is always available.
+ */
+bool IsCompressionCodecAvailable(CompressionCodec codec);
+
+/**
+ * @brief Compresses src_size bytes into dst.
+ *
+ * A dst_capacity below src_size makes values that would not shrink enough
+ * fail early instead of being compressed in full.
+ *
+ * @param level Compression level of zstd, ignored by lz4.
+ * @return The compressed size, or 0 if the codec is unavailable or failed,
+ * or if the result does not fit in dst_capacity bytes.
+ */
+size_t Compress(CompressionCodec codec, int level, const void* src,
+                size_t src_size, void* dst, size_t dst_capacity);
+
+/**
+ * @brief Decompresses src_size bytes into exactly dst_size bytes at dst.
+ * @return false if the codec is unavailable, the data is corrupt or it does
+ * not decompress to dst_size bytes.
+ */
+bool Decompress(CompressionCodec codec, const void* src, size_t src_size,
+                void* dst, size_t dst_size);
+
+}  // namespace mooncake
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mooncake {
+
+/**
+ * @brief CRC32C (Castagnoli) of len bytes, continuing the CRC of the bytes
+ * before them: Crc32c(b, len_b, Crc32c(a, len_a)) is the CRC of a followed
+ * by b.
+ *
+ * Uses the SSE4.2 or ARMv8 CRC instructions when the CPU has them, running
+ * three independent streams over consecutive chunks of long buffers so
+ * that the latency of the instruction is hidden, and combining their CRCs.
+ * Falls back to a slicing-by-8 table otherwise.
+ */
+uint32_t Crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+/**
+ * @brief CRC32C of a followed by b, from the CRCs of a and b and the length
+ * of b. Lets pieces of a buffer be checksummed independently.
+ */
+uint32_t Crc32cCombine(uint32_t crc_a, uint32_t crc_b, size_t len_b);
+
+/**
+ * @brief Whether Crc32c() uses CRC instructions of the CPU.
+ */
+bool Crc32cHardwareAccelerated();
+
+}  // namespace mooncake
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mooncake {
+
+/**
+ * @brief Copies GPU data through the client's host buffer, for tensors in
+ * device memory that was not registered, e.g. as GPUDirect RDMA is
+ * unavailable.
+ *
+ * The host buffer is page-locked for CUDA at construction, so copies run on
+ * the copy engines asynchronously to the caller. They are queued on the
+ * per-thread default stream of the calling thread: Mark() and Wait() order
+ * the copies one thread queued, and with unified addressing a thread may
+ * copy to and from any device. Without USE_CUDA, no memory is device memory
+ * and every copy is a memcpy.
+ */
+class CudaStaging {
+   public:
+    // Copies queued before a Mark()
+    using Fence = void*;
+
+    // Batches stage about this many bytes per wave, so that the copies of a
+    // wave overlap the transfers of the one before
+    static constexpr size_t kWaveSize = 64 * 1024 * 1024;
+
+    // Page-locks [host_buffer, host_buffer + size) for CUDA, if possible
+    CudaStaging(void* host_buffer, size_t size);
+    ~CudaStaging();
+
+    CudaStaging(const CudaStaging&) = delete;
+    CudaStaging& operator=(const CudaStaging&) = delete;
+
+    static bool IsDeviceMemory(const void* ptr);
+
+    // CUDA device ptr is in the memory of, -1 if it is not device memory
+    static int DeviceOf(const void* ptr);
+
+    // cudaMalloc'ed memory on the device, whose CUDA IPC handle the transfer
+    // engine exports to processes on this host; nullptr on failure and
+    // without USE_CUDA
+    static void* AllocateDeviceMemory(int device, size_t size);
+    static void FreeDeviceMemory(void* ptr);
+
+    // Queue a copy; false if it could not be queued
+    bool CopyToHost(void* dst, const void* src, size_t size);
+    bool CopyToDevice(void* dst, const void* src, size_t size);
+
+    // Fence of the copies queued so far by the calling thread. Each fence
+    // must be waited for once.
+    Fence Mark();
+
+    // Wait for the copies before the fence; false if any failed
+    bool Wait(Fence fence);
+
+    // Wait for all the copies queued by the calling thread
+    bool Synchronize();
+
+   private:
+    void* host_buffer_;
+    bool host_registered_ = false;
+};
+
+}  // namespace mooncake
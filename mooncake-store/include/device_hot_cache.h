@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cuda_staging.h"
+#include "local_hot_cache.h"
+#include "types.h"
+
+namespace mooncake {
+
+/**
+ * @brief Hot cache tier in GPU memory, for objects read into GPU memory.
+ *
+ * Keeps a LocalHotCache per CUDA device, with its arena in the memory of the
+ * device, created when the first key is admitted for the device. A key read
+ * into the memory of a device min_reads times, as counted by a
+ * FrequencySketch, is copied into the cache of that device. Its next reads
+ * into the device are device copies, without a transfer or the host to
+ * device copy of a hit in the host hot cache. Once a cache is full, a key
+ * only evicts blocks of less frequent keys.
+ *
+ * Copies are queued on the per-thread default stream of the caller, which
+ * waits for them. Without USE_CUDA no memory is device memory and no key is
+ * ever cached.
+ *
+ * @note Thread safety: all methods are thread safe.
+ */
+class DeviceHotCache {
+   public:
+    /**
+     * @param size_per_device Bytes of the cache of each device.
+     * @param block_size Block size of the caches, see LocalHotCache.
+     * @param min_reads Reads into a device before a key is cached on it.
+     */
+    DeviceHotCache(size_t size_per_device, size_t block_size,
+                   uint32_t min_reads);
+
+    DeviceHotCache(const DeviceHotCache&) = delete;
+    DeviceHotCache& operator=(const DeviceHotCache&) = delete;
+
+    /**
+     * @brief Copy the size bytes of key into slices if they all are in the
+     * memory of one device that holds key.
+     * @return true if slices were filled from the cache.
+     */
+    bool Read(const std::string& key, size_t size,
+              const std::vector<Slice>& slices);
+
+    /**
+     * @brief Count a read of key into slices, and cache the data read once
+     * the key was read into their device often enough.
+     */
+    void Admit(const std::string& key, const std::vector<Slice>& slices);
+
+    /**
+     * @brief Bytes of object data cached over all devices.
+     */
+    size_t GetCachedBytes() const;
+
+   private:
+    // Device all slices are in the memory of, -1 if none
+    static int SlicesDevice(const std::vector<Slice>& slices);
+
+    // Cache of device, created if create is set
+    std::shared_ptr<LocalHotCache> CacheOf(int device, bool create);
+
+    const size_t size_per_device_;
+    const size_t block_size_;
+    const uint32_t min_reads_;
+    FrequencySketch sketch_;
+    // Only its copying methods are used, it has no host buffer
+    CudaStaging staging_{nullptr, 0};
+
+    mutable std::shared_mutex caches_mutex_;
+    // Failed allocations are kept to not retry them on every read
+    std::unordered_map<int, std::shared_ptr<LocalHotCache>> caches_;
+};
+
+}  // namespace mooncake
@@ -5,6 +5,7 @@
 
 #include "pyclient.h"
 #include "real_client.h"
+#include "shm_request_ring.h"
 #include <memory>
 
 namespace mooncake {
@@ -117,8 +118,24 @@ class DummyClient : public PyClient {
         const std::vector<std::vector<size_t>> &all_sizes,
         const ReplicateConfig &config = ReplicateConfig{});
 
+    int stream_put_start(const std::string &key,
+                         const std::vector<uint64_t> &chunk_sizes,
+                         const ReplicateConfig &config = ReplicateConfig{});
+
+    int stream_put_from(const std::string &key, uint64_t chunk_index,
+                        void *buffer, size_t size);
+
+    int stream_put_end(const std::string &key);
+
+    int64_t get_range_into(const std::string &key, uint64_t offset,
+                           void *buffer, size_t size);
+
     std::shared_ptr<BufferHandle> get_buffer(const std::string &key);
 
+    std::shared_ptr<BufferHandle> get_ranges_buffer(
+        const std::string &key,
+        const std::vector<std::pair<uint64_t, uint64_t>> &ranges);
+
     std::tuple<uint64_t, size_t> get_buffer_info(const std::string &key);
 
     std::vector<std::shared_ptr<BufferHandle>> batch_get_buffer(
@@ -132,6 +149,11 @@ class DummyClient : public PyClient {
                   const std::vector<std::span<const char>> &values,
                   const ReplicateConfig &config = ReplicateConfig{});
 
+    std::vector<int> batch_put_parts(
+        const std::vector<std::string> &keys,
+        const std::vector<std::vector<std::span<const char>>> &all_parts,
+        const ReplicateConfig &config = ReplicateConfig{});
+
     [[nodiscard]] std::string get_hostname() const;
 
     int remove(const std::string &key, bool force = false);
@@ -144,6 +166,8 @@ class DummyClient : public PyClient {
 
     std::vector<int> batchIsExist(const std::vector<std::string> &keys);
 
+    int64_t batchIsExistPrefix(const std::vector<std::string> &keys);
+
     int64_t getSize(const std::string &key);
 
     std::map<std::string, std::vector<Replica::Descriptor>>
@@ -167,6 +191,22 @@ class DummyClient : public PyClient {
     int register_shm_via_ipc(const ShmHelper::ShmSegment *shm,
                              bool is_local = false);
 
+    // Sends fd and req to the RealClient's IPC socket; 0 once it mapped fd
+    int send_fd_via_ipc(int fd, ShmRegisterRequest &req);
+
+    // Creates a request ring and hands it to the RealClient, which serves
+    // batch_get_into and batch_put_from through it from then on. Disabled
+    // with MC_STORE_SHM_RING=0.
+    int setup_request_ring();
+    std::shared_ptr<ShmRequestRing> get_request_ring();
+    void reset_request_ring();
+    // Runs the request through the ring; BUFFER_OVERFLOW if it should take
+    // the RPC path
+    tl::expected<std::vector<int64_t>, ErrorCode> submit_to_request_ring(
+        ShmRequestRing::Op op, const std::vector<std::string> &keys,
+        const std::vector<uint64_t> &buffers, const std::vector<size_t> &sizes,
+        const ReplicateConfig &config = ReplicateConfig{});
+
     /**
      * @brief Generic RPC invocation helper for single-result operations
      * @tparam ServiceMethod Pointer to WrappedMasterService member function
@@ -234,6 +274,10 @@ class DummyClient : public PyClient {
     ShmHelper *shm_helper_ = nullptr;
     std::string ipc_socket_path_;
 
+    // Null while the RealClient is not serving a ring for this client
+    std::shared_mutex request_ring_mutex_;
+    std::shared_ptr<ShmRequestRing> request_ring_;
+
     // For high availability
     std::thread ping_thread_;
     std::atomic<bool> ping_running_{false};
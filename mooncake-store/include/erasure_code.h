@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mooncake {
+
+/**
+ * @brief dst[i] ^= c * src[i] over GF(2^8) for i in [0, len).
+ *
+ * Uses AVX-512BW, AVX2 or NEON table lookups when the CPU supports them, and
+ * a scalar loop otherwise.
+ */
+void GfMulAdd(uint8_t c, const uint8_t* src, uint8_t* dst, size_t len);
+
+/**
+ * @brief Multiply two elements of GF(2^8) with the polynomial 0x11d.
+ */
+uint8_t GfMul(uint8_t a, uint8_t b);
+
+/**
+ * @brief Systematic Reed-Solomon code over GF(2^8) with data_shards data
+ * shards and parity_shards parity shards of equal length.
+ *
+ * The parity rows form a Cauchy matrix, so any data_shards of the
+ * data_shards + parity_shards shards recover the data.
+ */
+class ReedSolomonCode {
+   public:
+    // Largest data_shards + parity_shards supported by GF(2^8)
+    static constexpr size_t kMaxShards = 256;
+
+    /**
+     * @brief Construct the code. data_shards must be positive and the total
+     * number of shards at most kMaxShards.
+     */
+    ReedSolomonCode(size_t data_shards, size_t parity_shards);
+
+    size_t data_shards() const { return data_shards_; }
+    size_t parity_shards() const { return parity_shards_; }
+
+    /**
+     * @brief Accumulate the parity of len bytes of every data shard into the
+     * parity shards, i.e. parity[j] ^= sum_i coef(j, i) * data[i]. The parity
+     * shards must be zeroed before the first call, and a long shard may be
+     * encoded in several calls over consecutive ranges. A null data pointer
+     * stands for zeros.
+     */
+    void Encode(const std::vector<const uint8_t*>& data,
+                const std::vector<uint8_t*>& parity, size_t len) const;
+
+    /**
+     * @brief Reconstruct the missing data shards in place.
+     * @param shards The data_shards + parity_shards shards, data first. The
+     * buffers of missing data shards are overwritten.
+     * @param present Whether each shard holds valid data.
+     * @return false if fewer than data_shards shards are present.
+     */
+    bool Decode(const std::vector<uint8_t*>& shards,
+                const std::vector<bool>& present, size_t len) const;
+
+   private:
+    // Row r of the generator matrix: the identity for data rows, the Cauchy
+    // matrix for parity rows.
+    uint8_t Coefficient(size_t row, size_t col) const;
+
+    const size_t data_shards_;
+    const size_t parity_shards_;
+    std::vector<uint8_t> parity_matrix_;  // parity_shards x data_shards
+};
+
+}  // namespace mooncake
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+
 #include "client_service.h"
 #include "client_buffer.hpp"
 #include "storage_backend.h"
@@ -19,12 +21,23 @@ class FileStorage {
      * forwards them to a remote node.
      * @param keys                 List of keys to read from the local KV store
      * @param sizes                Expected size in bytes for each value
+     * @param batch_id             Set to the id the reader passes to
+     * ReleaseBatch once it has read the buffers
      * @return tl::expected<std::vector<uint64_t>, ErrorCode> indicating
      * operation status.
      */
     tl::expected<std::vector<uint64_t>, ErrorCode> BatchGet(
-        const std::vector<std::string>& keys,
-        const std::vector<int64_t>& sizes);
+        const std::vector<std::string>& keys, const std::vector<int64_t>& sizes,
+        uint64_t& batch_id);
+
+    /**
+     * @brief Frees the buffers of a batch returned by BatchGet. Batches never
+     * released, e.g. as their reader died, are freed once their lease of
+     * client_buffer_gc_ttl_ms runs out.
+     * @param batch_id             Id set by BatchGet
+     * @return tl::expected<void, ErrorCode> indicating operation status.
+     */
+    tl::expected<void, ErrorCode> ReleaseBatch(uint64_t batch_id);
 
     FileStorageConfig config_;
 
@@ -79,22 +92,26 @@ class FileStorage {
         const std::vector<std::string>& keys,
         const std::vector<int64_t>& sizes);
 
-    void ClientBufferGCThreadFunc();
+    // Frees the batches whose lease ran out
+    void ReleaseExpiredBatches() REQUIRES(client_buffer_mutex_);
 
     std::shared_ptr<Client> client_;
     std::string local_rpc_addr_;
     std::shared_ptr<StorageBackendInterface> storage_backend_;
     std::shared_ptr<ClientBufferAllocator> client_buffer_allocator_;
     mutable Mutex client_buffer_mutex_;
-    std::vector<std::shared_ptr<AllocatedBatch>> GUARDED_BY(
+    std::unordered_map<uint64_t, std::shared_ptr<AllocatedBatch>> GUARDED_BY(
         client_buffer_mutex_) client_buffer_allocated_batches_;
+    // Ids of the batches above by lease timeout, which all leases share the
+    // TTL of
+    std::deque<std::pair<std::chrono::steady_clock::time_point, uint64_t>>
+        GUARDED_BY(client_buffer_mutex_) client_buffer_leases_;
+    uint64_t GUARDED_BY(client_buffer_mutex_) next_batch_id_{1};
 
     mutable Mutex offloading_mutex_;
     bool GUARDED_BY(offloading_mutex_) enable_offloading_;
     std::atomic<bool> heartbeat_running_;
     std::thread heartbeat_thread_;
-    std::atomic<bool> client_buffer_gc_running_;
-    std::thread client_buffer_gc_thread_;
 };
 
 }  // namespace mooncake
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "replica.h"
+#include "rpc_types.h"
+#include "types.h"
+
+namespace mooncake {
+
+/**
+ * @brief The replica lists of a batch query laid out as a few flat arrays.
+ *
+ * struct_pack reads and writes every array of integers with a single copy,
+ * so decoding a response costs one allocation per array instead of one per
+ * key, replica, stripe and string. The protocols, transport endpoints and
+ * file paths are stored once in a string table, which is small since a
+ * batch usually spans a handful of segments.
+ *
+ * Key i owns replicas [replica_end[i - 1], replica_end[i]), and memory
+ * replica r owns stripes [stripe_end[r - 1], stripe_end[r]).
+ */
+struct FlatReplicaLists {
+    // String j is strings[string_offsets[j], string_offsets[j + 1])
+    std::string strings;
+    std::vector<uint32_t> string_offsets;
+
+    // Per key; the other key fields are unset if error is not OK
+    std::vector<int32_t> key_error;
+    std::vector<uint64_t> key_lease_ttl_ms;
+    std::vector<uint8_t> key_promote;
+    // key_checksum is meaningful if key_has_checksum is set
+    std::vector<uint8_t> key_has_checksum;
+    std::vector<uint32_t> key_checksum;
+    std::vector<uint32_t> replica_end;
+
+    // Per replica. kind is the index of the descriptor variant. object_size
+    // and string (file path or transport endpoint) are those of disk and
+    // local disk replicas, and client_id that of local disk ones.
+    std::vector<uint64_t> replica_id;
+    std::vector<uint8_t> replica_status;
+    std::vector<uint8_t> replica_kind;
+    std::vector<uint32_t> replica_parity_stripes;
+    std::vector<uint64_t> replica_object_size;
+    std::vector<uint32_t> replica_string;
+    std::vector<uint64_t> replica_client_id_first;
+    std::vector<uint64_t> replica_client_id_second;
+    std::vector<uint32_t> stripe_end;
+
+    // Per stripe of a memory replica
+    std::vector<uint64_t> stripe_size;
+    std::vector<uint64_t> stripe_address;
+    std::vector<uint32_t> stripe_protocol;
+    std::vector<uint32_t> stripe_endpoint;
+
+    YLT_REFL(FlatReplicaLists, strings, string_offsets, key_error,
+             key_lease_ttl_ms, key_promote, key_has_checksum, key_checksum,
+             replica_end, replica_id, replica_status, replica_kind,
+             replica_parity_stripes, replica_object_size, replica_string,
+             replica_client_id_first, replica_client_id_second, stripe_end,
+             stripe_size, stripe_address, stripe_protocol, stripe_endpoint);
+
+    size_t num_keys() const { return key_error.size(); }
+
+    std::string_view string(uint32_t index) const {
+        return std::string_view(strings).substr(
+            string_offsets[index],
+            string_offsets[index + 1] - string_offsets[index]);
+    }
+};
+
+/**
+ * @brief Encode the results of a batch replica list query.
+ */
+FlatReplicaLists EncodeReplicaLists(
+    const std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>&
+        results);
+
+/**
+ * @brief Rebuild the results of a batch replica list query, or as many
+ * INVALID_PARAMS errors as keys if the arrays are inconsistent.
+ */
+std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>
+DecodeReplicaLists(const FlatReplicaLists& flat);
+
+}  // namespace mooncake
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace mooncake {
+
+class CUFileDescPool;
+
+/**
+ * @brief Reads disk replicas straight into GPU buffers with GPUDirect
+ * Storage.
+ *
+ * Reads are submitted as cuFile batches through the CUFileDescPool of the
+ * NVMe-oF transport, which reuses the costly cuFileBatchIOSetUp handles, so
+ * the data is DMAed from the drive to device memory without a bounce
+ * through host DRAM. A single completion thread starts everything queued
+ * since its last pass and polls all batches in flight, so the reads of a
+ * BatchGet reach the drives together.
+ */
+class GdsFileReader {
+   public:
+    using Callback = std::function<void(ErrorCode)>;
+
+    /**
+     * @brief Create a reader submitting batches of up to max_batch_size
+     * slices.
+     * @return nullptr if the build has no NVMe-oF support or the cuFile
+     * driver cannot be opened.
+     */
+    static std::unique_ptr<GdsFileReader> Create(size_t max_batch_size);
+
+    ~GdsFileReader();
+
+    GdsFileReader(const GdsFileReader&) = delete;
+    GdsFileReader& operator=(const GdsFileReader&) = delete;
+
+    /**
+     * @brief Whether every slice with a non-null ptr is in device memory,
+     * and there is at least one, so the reads can bypass host memory.
+     */
+    static bool IsDeviceMemory(const std::vector<Slice>& slices);
+
+    /**
+     * @brief Read length bytes of the file at path into slices.
+     *
+     * Slices with a null ptr skip their size in the file, as in
+     * StorageBackend::LoadObject. done is called from the completion thread.
+     */
+    void Read(const std::string& path, std::vector<Slice> slices,
+              size_t length, Callback done);
+
+   private:
+    struct FileRequest;
+
+    GdsFileReader(CUFileDescPool* desc_pool, size_t max_batch_size);
+
+    void CompletionThread();
+    // Open and register the file of a request; false if it failed
+    bool StartRequest(FileRequest& request);
+    // Submit the next batch of a request's reads; false if it failed
+    bool SubmitBatch(FileRequest& request);
+    // Reap completed reads; true once the batch in flight is done
+    bool PollBatch(FileRequest& request);
+    void FinishRequest(FileRequest& request);
+
+    CUFileDescPool* desc_pool_;
+    const size_t max_batch_size_;
+
+    // Requests submitted but not yet seen by the completion thread
+    std::mutex pending_mutex_;
+    std::condition_variable pending_cv_;
+    std::vector<std::shared_ptr<FileRequest>> pending_;
+    std::atomic<bool> shutdown_{false};
+
+    // Owned by the completion thread
+    std::list<std::shared_ptr<FileRequest>> active_;
+
+    std::thread thread_;
+};
+
+}  // namespace mooncake
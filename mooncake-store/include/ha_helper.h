@@ -4,8 +4,10 @@
 #include <csignal>
 #include <glog/logging.h>
 
+#include <atomic>
 #include <string>
 #include <thread>
+#include <vector>
 #include <ylt/coro_rpc/coro_rpc_server.hpp>
 
 #include "types.h"
@@ -13,6 +15,8 @@
 
 namespace mooncake {
 
+class MasterService;
+
 /*
  * @brief A helper class for maintain and monitor the master view change.
  *        The cluster is assumed to have multiple master servers, but only
@@ -64,12 +68,130 @@ class MasterViewHelper {
     std::string master_view_key_;
 };
 
+/*
+ * @brief A helper class for the ring of a partitioned cluster, where every
+ *        master is active and owns the keys hashed to it. Each master
+ *        registers its address under a lease, and the ring is made of the
+ *        registered addresses. It changes when a master joins or the lease
+ *        of a master expires.
+ */
+class PartitionRingHelper {
+   public:
+    PartitionRingHelper(const PartitionRingHelper&) = delete;
+    PartitionRingHelper& operator=(const PartitionRingHelper&) = delete;
+    PartitionRingHelper();
+
+    /*
+     * @brief Connect to the etcd cluster. This function should be called at
+     * first
+     * @param etcd_endpoints: The endpoints of the etcd store client.
+     *        Multiple endpoints are separated by semicolons.
+     * @return: Error code.
+     */
+    ErrorCode ConnectToEtcd(const std::string& etcd_endpoints);
+
+    /*
+     * @brief Register the master in the ring.
+     * @param master_address: The ip:port address of the master.
+     * @param lease_id: Output param, the lease id of the registration.
+     * @return: Error code.
+     */
+    ErrorCode Join(const std::string& master_address, EtcdLeaseId& lease_id);
+
+    /*
+     * @brief Keep the registration alive. This function blocks until the
+     * lease is lost or the keep alive is cancelled.
+     * @param lease_id: The lease id of the registration.
+     */
+    void KeepMembership(EtcdLeaseId lease_id);
+
+    /*
+     * @brief Get the addresses of the masters in the ring.
+     * @param members: Output param, the sorted addresses.
+     * @return: Error code.
+     */
+    ErrorCode GetMembers(std::vector<std::string>& members);
+
+   private:
+    std::string ring_prefix_;
+};
+
+/*
+ * @brief Keeps a master in the ring of a partitioned cluster, and removes
+ *        the objects it no longer owns when the ring changes. Only used in
+ *        partitioned mode.
+ */
+class PartitionMember {
+   public:
+    PartitionMember(const PartitionMember&) = delete;
+    PartitionMember& operator=(const PartitionMember&) = delete;
+    PartitionMember(MasterService& master_service,
+                    const std::string& etcd_endpoints,
+                    const std::string& local_address);
+    ~PartitionMember();
+
+    ErrorCode Start();
+    void Stop();
+
+   private:
+    void MembershipThreadFunc();
+    void RingThreadFunc();
+
+    static constexpr uint64_t kRingPollMs = 1000;
+    static constexpr uint64_t kRetrySleepMs = 1000;
+
+    MasterService& master_service_;
+    const std::string etcd_endpoints_;
+    const std::string local_address_;
+    PartitionRingHelper ring_helper_;
+    std::thread membership_thread_;
+    std::thread ring_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<EtcdLeaseId> lease_id_{0};
+};
+
+/*
+ * @brief Replicates the metadata of the leader to a local master service in
+ *        standby mode. It bootstraps from a snapshot of the leader, then keeps
+ *        polling the operation log of the leader. It bootstraps again if the
+ *        leader changes or the log is truncated before it is read.
+ */
+class StandbyReplicator {
+   public:
+    StandbyReplicator(const StandbyReplicator&) = delete;
+    StandbyReplicator& operator=(const StandbyReplicator&) = delete;
+    StandbyReplicator(MasterService& master_service,
+                      const std::string& etcd_endpoints,
+                      const std::string& local_address);
+    ~StandbyReplicator();
+
+    void Start();
+    void Stop();
+
+   private:
+    void ReplicateThreadFunc();
+    // Replicate from the given leader until an error occurs or it is stopped
+    void ReplicateFrom(const std::string& leader_address);
+
+    static constexpr uint64_t kFetchBatchSize = 4096;
+    static constexpr uint64_t kIdleSleepMs = 10;
+    static constexpr uint64_t kRetrySleepMs = 1000;
+
+    MasterService& master_service_;
+    const std::string etcd_endpoints_;
+    const std::string local_address_;
+    std::thread replicate_thread_;
+    std::atomic<bool> running_{false};
+};
+
 /*
  * @brief A supervisor class for the master service, only used in HA mode.
  *        This class will continuously do the following procedures after start:
  *        1. Elect local master to be the leader.
  *        2. Start the master service when it is elected as leader.
  *        3. Stop the master service when it is no longer the leader.
+ *        If the operation log is enabled, the master replicates the leader
+ *        as a warm standby while waiting to be elected.
  */
 class MasterServiceSupervisor {
    public:
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace mooncake {
+
+/**
+ * @brief Consistent-hash ring assigning keys to the masters of a
+ * partitioned cluster.
+ *
+ * Every member is placed at several points of a 64-bit ring and a key
+ * belongs to the member of the first point at or after its hash. Adding or
+ * removing a member only moves the keys of the arcs it gains or loses. The
+ * hash is stable across processes and builds, since clients and masters
+ * must agree on the owners.
+ */
+class HashRing {
+   public:
+    static constexpr size_t kDefaultVirtualNodes = 128;
+
+    HashRing() = default;
+
+    /**
+     * @param members Member names, e.g. master addresses. Their order and
+     * duplicates do not matter.
+     */
+    explicit HashRing(std::vector<std::string> members,
+                      size_t virtual_nodes = kDefaultVirtualNodes);
+
+    /**
+     * @brief Index in members() of the owner of the key. The ring must not
+     * be empty.
+     */
+    size_t OwnerOf(std::string_view key) const;
+
+    /**
+     * @brief The members, sorted.
+     */
+    const std::vector<std::string>& members() const { return members_; }
+
+    bool empty() const { return members_.empty(); }
+
+    static uint64_t Hash(std::string_view data);
+
+   private:
+    std::vector<std::string> members_;
+    // Points of the ring and the index of their member, sorted by point
+    std::vector<std::pair<uint64_t, uint32_t>> points_;
+};
+
+/**
+ * @brief Splits a segment into at most max_slices contiguous slices whose
+ * sizes are multiples of alignment, the last one taking the rest. Slices
+ * keep the name, endpoint and protocol of the segment and get ids derived
+ * from its id, so that the same slices are computed every time.
+ *
+ * Partitioned masters each allocate from their own slices of a segment.
+ */
+std::vector<Segment> SliceSegment(const Segment& segment, size_t max_slices,
+                                  size_t alignment);
+
+/**
+ * @brief Key placing slice `index` of a segment on a HashRing.
+ */
+std::string SegmentSliceKey(const Segment& segment, size_t index);
+
+}  // namespace mooncake
@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <mutex>
 #include <thread>
+#include <vector>
 #include <hf3fs_usrbio.h>
 #include "types.h"
 
@@ -82,6 +83,16 @@ struct ThreadUSRBIOResource {
     ~ThreadUSRBIOResource() { Cleanup(); }
 };
 
+class ThreeFSFile;
+
+// A whole file read or written by ThreeFSFile::batch_io
+struct Hf3fsBatchEntry {
+    ThreeFSFile *file;
+    char *buffer;  // Only read from for writes
+    size_t length;
+    ErrorCode result = ErrorCode::OK;
+};
+
 class ThreeFSFile : public StorageFile {
    public:
     ThreeFSFile(const std::string &filename, int fd,
@@ -99,6 +110,17 @@ class ThreeFSFile : public StorageFile {
     tl::expected<size_t, ErrorCode> vector_read(const iovec *iov, int iovcnt,
                                                 off_t offset) override;
 
+    /**
+     * @brief Reads or writes the files of several entries together
+     *
+     * The registered iov of the calling thread is shared by the pieces of all
+     * entries, so that one USRBIO submission carries as many pieces as the
+     * iov and the IO ring hold, instead of one submission per chunk of each
+     * file. Sets the result of every entry.
+     */
+    static void batch_io(USRBIOResourceManager *resource_manager,
+                         std::vector<Hf3fsBatchEntry> &entries, bool read);
+
    private:
     USRBIOResourceManager *resource_manager_;
 };
@@ -3,9 +3,11 @@
 #include <atomic>
 #include <condition_variable>
 #include <cstring>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <shared_mutex>
 #include <string>
@@ -14,6 +16,7 @@
 #include <vector>
 
 #include "mutex.h"
+#include "offset_allocator/offset_allocator.hpp"
 #include "types.h"
 
 namespace mooncake {
@@ -26,11 +29,26 @@ struct HotMemBlock {
     size_t size;
     std::atomic<int> ref_count;
     std::string key_;
-    HotMemBlock() : addr(nullptr), size(0), ref_count(0) {}
+    // CLOCK reference bit, set on every hit
+    std::atomic<bool> referenced;
+    // Shard holding the block, internal to LocalHotCache
+    size_t shard;
+    // Space of the block in the cache arena, freed with the block
+    std::optional<offset_allocator::OffsetAllocationHandle> allocation;
+    HotMemBlock()
+        : addr(nullptr), size(0), ref_count(0), referenced(false), shard(0) {}
 };
 
 /**
  * @brief Local hot cache used for hot kv cache in the distributed store.
+ *
+ * Keys are sharded by hash. Each shard keeps its blocks on a CLOCK ring, so a
+ * hit only takes the shard lock shared and sets the block's reference bit;
+ * the exclusive lock is needed to insert and evict.
+ *
+ * Blocks are carved out of one arena by an offset allocator and sized to the
+ * object they hold, so small and large objects share the cache. A block that
+ * does not fit evicts with CLOCK until it does.
  */
 class LocalHotCache {
    public:
@@ -38,8 +56,16 @@ class LocalHotCache {
      * @brief Construct a LocalHotCache.
      * @param total_size_bytes Desired total local hot cache size in bytes.
      * @param block_size_bytes Block size in bytes. If 0, uses default 16MB.
+     * The arena is a whole number of blocks, and the keyless GetFreeBlock()
+     * returns blocks of this size.
+     * @param shard_num Number of shards. If 0, one shard per 16 blocks, at
+     * most 32.
+     * @param device If non-negative, the arena is allocated in the memory of
+     * this CUDA device, and blocks are only written and read by device
+     * copies.
      */
-    LocalHotCache(size_t total_size_bytes, size_t block_size_bytes = 0);
+    LocalHotCache(size_t total_size_bytes, size_t block_size_bytes = 0,
+                  size_t shard_num = 0, int device = -1);
 
     /**
      * @brief Destructor.
@@ -48,10 +74,10 @@ class LocalHotCache {
 
     /**
      * @brief Insert a populated block into the cache.
-     * Takes ownership of the block and inserts it into the LRU.
-     * The block must have been obtained from GetFreeBlock() and have key_ set.
-     * If the key already exists (race condition) or is empty, the block is
-     * cleared and returned to the pool as a free block.
+     * Takes ownership of the block and inserts it into the CLOCK ring of the
+     * key's shard. The block must have been obtained from GetFreeBlock() and
+     * have key_ set. If the key already exists (race condition) or is empty,
+     * the block is freed.
      * @param block The block containing the data and key.
      * @return true if inserted successfully, false if race condition or error.
      */
@@ -64,7 +90,7 @@ class LocalHotCache {
     bool HasHotKey(const std::string& key) const;
 
     /**
-     * @brief Get the underlying HotMemBlock pointer and touch LRU.
+     * @brief Get the underlying HotMemBlock pointer and mark it referenced.
      * The block will be marked as in_use to prevent it from being reused
      * until ReleaseHotKey is called.
      * @param key : {request key}
@@ -81,52 +107,149 @@ class LocalHotCache {
 
     /**
      * @brief Touch a key if it exists in the hot cache.
-     * Only touches the LRU, does not modify data or allocation.
+     * Only sets the reference bit, does not modify data or allocation.
      * @param key Cache key.
      * @return true if key exists and was touched, false otherwise.
      */
     bool TouchHotKey(const std::string& key);
 
     /**
-     * @brief Get a free block for writing.
-     * Detaches a block from the LRU tail (evicting if necessary) and returns
-     * it. The returned block is owned by the caller and must be returned via
-     * PutHotKey.
+     * @brief Get a free block of GetBlockSize() bytes for writing.
+     * Allocates from the arena, evicting with CLOCK while it is full. The
+     * returned block is owned by the caller and must be returned via
+     * PutHotKey, before the cache is destroyed.
      * @return Pointer to a HotMemBlock, or nullptr if no block is available.
      */
     HotMemBlock* GetFreeBlock();
 
     /**
-     * @brief Get the number of cache blocks available.
-     * @return Number of blocks in LRU queue (cache size).
+     * @brief Get a free block of size bytes for writing key.
+     * Like GetFreeBlock(), but evicts from the key's shard first. If admit is
+     * set, it is asked before evicting each victim and the allocation stops
+     * if it returns false.
+     * @param key The key the block will be written for.
+     * @param size Block size in bytes, at most the arena size.
+     * @param admit Admission check called with the key of the victim.
+     * @return Pointer to a HotMemBlock, or nullptr if no block is available
+     * or a victim was kept.
+     */
+    HotMemBlock* GetFreeBlock(
+        const std::string& key, size_t size,
+        const std::function<bool(const std::string&)>& admit);
+
+    /**
+     * @brief Get the capacity of the cache in blocks of GetBlockSize().
+     * @return Arena size divided by the block size, 0 if allocation failed.
      */
     size_t GetCacheSize() const;
 
+    /**
+     * @brief Bytes of object data held by cached blocks.
+     */
+    size_t GetCachedBytes() const {
+        return cached_bytes_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Bytes of the arena reserved by cached blocks and blocks being
+     * written, including allocator rounding. The gap to GetCachedBytes() is
+     * the internal fragmentation.
+     */
+    size_t GetReservedBytes() const;
+
+    /**
+     * @brief Number of cached keys.
+     */
+    size_t GetCachedCount() const;
+
     /**
      * @brief Get the block size used by this cache.
      * @return Block size in bytes.
      */
     size_t GetBlockSize() const { return block_size_; }
 
+    size_t GetShardCount() const { return shards_.size(); }
+
+    /**
+     * @brief Memory the blocks are carved out of, so that it can be
+     * registered for transfers straight into the blocks.
+     */
+    void* GetArenaBase() const { return bulk_memory_standard_; }
+    size_t GetArenaSize() const { return capacity_; }
+
+    /**
+     * @brief CUDA device holding the arena, -1 for host memory.
+     */
+    int GetDevice() const { return device_; }
+
    private:
-    // Touch LRU using iterator (avoids duplicate lookup)
-    void touchLRU(std::unordered_map<
-                  std::string, std::list<HotMemBlock*>::iterator>::iterator it);
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        // Cached blocks; new blocks are inserted just behind the hand
+        std::list<HotMemBlock*> clock GUARDED_BY(mutex);
+        std::list<HotMemBlock*>::iterator hand GUARDED_BY(mutex);
+        // key -> iterator of clock
+        std::unordered_map<std::string, std::list<HotMemBlock*>::iterator>
+            index GUARDED_BY(mutex);
 
-    size_t block_size_;  // Actual block size used by this cache
+        Shard() : hand(clock.end()) {}
+    };
 
-    // All blocks owned by this cache (auto-cleaned on destruction)
-    std::vector<std::unique_ptr<HotMemBlock>> blocks_;
+    size_t shardIndex(const std::string& key) const;
 
-    // Bulk allocated memory pointer (nullptr if bulk allocation failed)
-    // Must save the original malloc pointer for correct free()
+    // Allocate a block of size bytes, evicting starting with shard start
+    HotMemBlock* takeBlock(
+        size_t start, size_t size,
+        const std::function<bool(const std::string&)>& admit);
+
+    // Evict the first unpinned block without reference bit, clearing the
+    // bits passed on the way. Sets *rejected if admit kept the victim.
+    HotMemBlock* evict(Shard& shard,
+                       const std::function<bool(const std::string&)>& admit,
+                       bool* rejected);
+
+    size_t block_size_;  // Actual block size used by this cache
+    size_t capacity_;    // Arena size in bytes, 0 if allocation failed
+    int device_;         // CUDA device of the arena, -1 for host memory
+
+    // Bulk allocated arena (nullptr if allocation failed)
     void* bulk_memory_standard_;
+    std::shared_ptr<offset_allocator::OffsetAllocator> allocator_;
+    std::atomic<size_t> cached_bytes_{0};
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    // Shard the keyless GetFreeBlock() starts with
+    std::atomic<size_t> next_shard_{0};
+};
+
+/**
+ * @brief Approximate recent access counts for TinyLFU admission.
+ *
+ * A count-min sketch of saturating counters that are halved every
+ * sample_size increments, so that old popularity fades. Updates are lock-free
+ * and may drop an increment under contention.
+ */
+class FrequencySketch {
+   public:
+    /**
+     * @param capacity Number of entries of the cache being admitted to.
+     */
+    explicit FrequencySketch(size_t capacity);
+
+    void Increment(const std::string& key);
+
+    uint32_t Estimate(const std::string& key) const;
+
+   private:
+    static constexpr size_t kDepth = 4;
+    static constexpr uint8_t kMaxCount = 15;
+
+    size_t counterIndex(uint64_t hash, size_t row) const;
 
-    mutable std::shared_mutex lru_mutex_;
-    std::list<HotMemBlock*> lru_queue_ GUARDED_BY(lru_mutex_);  // prefilled LRU
-    // key -> iterator of lru_queue_
-    std::unordered_map<std::string, std::list<HotMemBlock*>::iterator>
-        key_to_lru_it_ GUARDED_BY(lru_mutex_);
+    std::vector<std::atomic<uint8_t>> counters_;  // kDepth rows of width
+    size_t width_mask_;
+    size_t sample_size_;
+    std::atomic<size_t> additions_{0};
 };
 
 /**
@@ -179,15 +302,24 @@ class LocalHotCacheHandler {
      * safely freed after this function returns.
      * @param key Cache key: {object key}
      * @param slice Source slice to cache.
-     * @return true if task was successfully submitted, false otherwise (e.g.,
-     * hot_cache_ is null or handler is shutdown).
+     * @return true if task was successfully submitted or the key was not
+     * admitted, false otherwise (e.g., hot_cache_ is null or handler is
+     * shutdown).
      */
     bool SubmitPutTask(const std::string& key, const Slice& slice);
 
+    /**
+     * @brief Count a hot cache hit of key for admission.
+     */
+    void RecordHit(const std::string& key);
+
    private:
     void workerThread();
 
     std::shared_ptr<LocalHotCache> hot_cache_;
+    // Once the cache is full, a key is only admitted if it is accessed more
+    // often than the block it would evict
+    FrequencySketch admission_sketch_;
     std::vector<std::thread> workers_;
     std::queue<HotCachePutTask> task_queue_;
     size_t max_queue_capacity_;
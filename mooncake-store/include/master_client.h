@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <csignal>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <cstdlib>
 #include <boost/functional/hash.hpp>
@@ -10,14 +14,19 @@
 #include <ylt/coro_io/client_pool.hpp>
 
 #include "client_metric.h"
+#include "hash_ring.h"
 #include "replica.h"
 #include "types.h"
 #include "rpc_types.h"
+#include "segment_load_tracker.h"
 #include "master_metric_manager.h"
+#include "rpc_coalescer.h"
 #include "task_manager.h"
 
 namespace mooncake {
 
+class PingAggregator;
+
 static const std::string kDefaultMasterAddress = "localhost:50051";
 
 /**
@@ -37,6 +46,7 @@ class MasterClient {
         client_pools_ =
             std::make_shared<coro_io::client_pools<coro_rpc::coro_rpc_client>>(
                 pool_conf);
+        InitCoalescers();
     }
     ~MasterClient();
 
@@ -51,6 +61,28 @@ class MasterClient {
     [[nodiscard]] ErrorCode Connect(
         const std::string& master_addr = kDefaultMasterAddress);
 
+    /**
+     * @brief Connects to the masters of a partitioned cluster, where each
+     * master owns the keys hashed to it on a HashRing. Calls on a key go to
+     * its owner and batch calls are split per owner. Mounted segments are
+     * split into slices spread over the masters by the same ring, so that
+     * the masters never allocate the same memory.
+     *
+     * Calling it again with other masters rebalances online: the slices
+     * that changed owner are unmounted from the old owner and mounted on
+     * the new one. On failure the previous masters are kept.
+     * @param master_addrs Addresses (IP:Port) of all the masters
+     * @return ErrorCode indicating success/failure
+     */
+    [[nodiscard]] ErrorCode ConnectPartitioned(
+        const std::vector<std::string>& master_addrs);
+
+    /**
+     * @brief Addresses of the masters of the partitioned cluster, sorted, or
+     * empty if not connected by ConnectPartitioned()
+     */
+    std::vector<std::string> GetPartitionMasters() const;
+
     /**
      * @brief Checks if an object exists
      * @param object_key Key to query
@@ -67,6 +99,27 @@ class MasterClient {
     [[nodiscard]] std::vector<tl::expected<bool, ErrorCode>> BatchExistKey(
         const std::vector<std::string>& object_keys);
 
+    /**
+     * @brief Checks how many of the keys, from the first on, all exist
+     * @param object_keys Keys to query, in order
+     * @return The index of the first missing key, or the number of keys if
+     * every key exists
+     */
+    [[nodiscard]] tl::expected<uint64_t, ErrorCode> BatchExistKeyPrefix(
+        const std::vector<std::string>& object_keys);
+
+    /**
+     * @brief Fetches the next page of keys of a scan, to be called with the
+     * returned cursor until the response is done
+     * @param cursor Default constructed to start the scan
+     * @param limit Most keys to return, pages may be shorter
+     * @param prefix Only return keys starting with it
+     * @param with_metadata Also return the size and replicas of every key
+     */
+    [[nodiscard]] tl::expected<ScanKeysResponse, ErrorCode> ScanKeys(
+        const ScanKeysCursor& cursor, uint64_t limit,
+        const std::string& prefix = "", bool with_metadata = false);
+
     /**
      * @brief Calculate cache hit rate metrics
      * @param object_keys None
@@ -161,18 +214,22 @@ class MasterClient {
      * @brief Ends a put operation
      * @param key Object key
      * @param replica_type Type of replica (memory or disk)
+     * @param checksum CRC32C of the object, returned to its readers
      * @return tl::expected<void, ErrorCode> indicating success/failure
      */
     [[nodiscard]] tl::expected<void, ErrorCode> PutEnd(
-        const std::string& key, ReplicaType replica_type);
+        const std::string& key, ReplicaType replica_type,
+        std::optional<uint32_t> checksum = std::nullopt);
 
     /**
      * @brief Ends a put operation for a batch of objects
      * @param keys Vector of object keys
+     * @param checksums Empty, or the CRC32C of each object
      * @return ErrorCode indicating success/failure
      */
     [[nodiscard]] std::vector<tl::expected<void, ErrorCode>> BatchPutEnd(
-        const std::vector<std::string>& keys);
+        const std::vector<std::string>& keys,
+        const std::vector<uint32_t>& checksums = {});
 
     /**
      * @brief Revokes a put operation
@@ -183,6 +240,34 @@ class MasterClient {
     [[nodiscard]] tl::expected<void, ErrorCode> PutRevoke(
         const std::string& key, ReplicaType replica_type);
 
+    /**
+     * @brief Starts a put whose chunks are readable once committed
+     * @param key Object key
+     * @param chunk_lengths Lengths of the chunks, in object order
+     * @param config Replication configuration
+     */
+    [[nodiscard]] tl::expected<std::vector<Replica::Descriptor>, ErrorCode>
+    StreamPutStart(const std::string& key,
+                   const std::vector<uint64_t>& chunk_lengths,
+                   const ReplicateConfig& config);
+
+    /**
+     * @brief Marks chunks of a streamed put as written
+     * @param key Object key
+     * @param first_chunk Index of the first chunk
+     * @param num_chunks Number of consecutive chunks
+     */
+    [[nodiscard]] tl::expected<void, ErrorCode> StreamPutCommit(
+        const std::string& key, uint64_t first_chunk, uint64_t num_chunks);
+
+    /**
+     * @brief Gets the replicas of an object that may still be streamed,
+     * with its committed chunks
+     * @param object_key Key to query
+     */
+    [[nodiscard]] tl::expected<GetStreamReplicaListResponse, ErrorCode>
+    GetStreamReplicaList(const std::string& object_key);
+
     /**
      * @brief Revokes a put operation for a batch of objects
      * @param keys Vector of object keys
@@ -191,6 +276,30 @@ class MasterClient {
     [[nodiscard]] std::vector<tl::expected<void, ErrorCode>> BatchPutRevoke(
         const std::vector<std::string>& keys);
 
+    /**
+     * @brief Gets the replicas of puts of slice_length bytes ahead of their
+     * keys, see MasterService::GrantPutLease
+     * @param slot_count Number of puts asked for
+     * @return UNAVAILABLE_IN_CURRENT_MODE if the master grants no leases, or
+     * with several masters
+     */
+    [[nodiscard]] tl::expected<PutLease, ErrorCode> GrantPutLease(
+        uint64_t slice_length, uint64_t slot_count,
+        const ReplicateConfig& config);
+
+    /**
+     * @brief Completes puts written to the slots of put leases
+     * @return One result per put
+     */
+    [[nodiscard]] std::vector<tl::expected<void, ErrorCode>>
+    BatchLeasedPutEnd(const std::vector<LeasedPut>& puts);
+
+    /**
+     * @brief Gives back the unused slots of a put lease
+     */
+    [[nodiscard]] tl::expected<void, ErrorCode> ReleasePutLease(
+        uint64_t lease_id);
+
     /**
      * @brief Removes an object and all its replicas
      * @param key Key to remove
@@ -256,10 +365,39 @@ class MasterClient {
 
     /**
      * @brief Pings master to check its availability
+     * @param load_report Traffic and rack of this client for the load-aware
+     * allocation strategy of the master
      * @return tl::expected<PingResponse, ErrorCode>
-     * containing view version and client status
+     * containing view version and client status, and the keys put since the
+     * last ping when watching puts
+     */
+    [[nodiscard]] tl::expected<PingResponse, ErrorCode> Ping(
+        const ClientLoadReport& load_report = ClientLoadReport());
+
+    /**
+     * @brief Pings master through the aggregator shared by the clients of
+     * this process, which sends their heartbeats with one BatchPing per
+     * round, and fetches tasks along with the ping. Blocks until the round
+     * is answered. Not for partitioned masters.
+     * @param task_batch_size Most tasks to fetch, 0 for none
      */
-    [[nodiscard]] tl::expected<PingResponse, ErrorCode> Ping();
+    [[nodiscard]] tl::expected<BatchPingResponse, ErrorCode> AggregatedPing(
+        PingAggregator& aggregator, const ClientLoadReport& load_report,
+        size_t task_batch_size);
+
+    /**
+     * @brief Heartbeats of several clients in one RPC
+     * @return One result per request, in order
+     */
+    [[nodiscard]] std::vector<tl::expected<BatchPingResponse, ErrorCode>>
+    BatchPing(const std::vector<BatchPingRequest>& requests);
+
+    /**
+     * @brief Asks the masters for the keys put since the last ping in every
+     * ping response. The first ping after this or after a reconnect reports
+     * truncated.
+     */
+    void WatchPuts(bool watch);
 
     /**
      * @brief Mounts a local disk segment into the master.
@@ -384,6 +522,13 @@ class MasterClient {
     [[nodiscard]] tl::expected<std::vector<TaskAssignment>, ErrorCode>
     FetchTasks(size_t batch_size);
 
+    /**
+     * @brief Like FetchTasks, but the master holds the request for up to
+     * wait_ms until a task is assigned. Not for partitioned masters.
+     */
+    [[nodiscard]] tl::expected<std::vector<TaskAssignment>, ErrorCode>
+    WaitTasks(size_t batch_size, uint64_t wait_ms);
+
     /**
      * @brief Mark the task as complete
      * @param task_complete Task complete request
@@ -393,6 +538,59 @@ class MasterClient {
         const TaskCompleteRequest& task_complete);
 
    private:
+    // Masters of a partitioned cluster
+    struct Partitions {
+        HashRing ring;
+        // Clients of the members of the ring, in the same order
+        std::vector<std::shared_ptr<MasterClient>> masters;
+
+        MasterClient& OwnerOf(const std::string& key) const {
+            return *masters[ring.OwnerOf(key)];
+        }
+    };
+
+    // Null unless connected by ConnectPartitioned()
+    std::shared_ptr<const Partitions> GetPartitions() const {
+        std::shared_lock<std::shared_mutex> lock(partitions_mutex_);
+        return partitions_;
+    }
+
+    /**
+     * @brief Runs fn(master, indices) with the indices of the keys owned by
+     * each master, concurrently, and returns the results in key order.
+     */
+    template <typename ResultType, typename Fn>
+    std::vector<tl::expected<ResultType, ErrorCode>> PartitionBatch(
+        const Partitions& partitions, const std::vector<std::string>& keys,
+        Fn&& fn);
+
+    /**
+     * @brief Runs fn(master) on every master concurrently, and returns the
+     * results in the order of the masters.
+     */
+    template <typename Fn>
+    auto ForEachMaster(const Partitions& partitions, Fn&& fn);
+
+    /**
+     * @brief Slices of a segment owned by each master, in the order of the
+     * masters
+     */
+    static std::vector<std::vector<Segment>> SlicesPerMaster(
+        const Partitions& partitions, const Segment& segment);
+
+    /**
+     * @brief Moves the slices of the mounted segments whose owner differs
+     * between two rings.
+     */
+    void MoveSegmentSlices(const Partitions& from, const Partitions& to);
+
+    /**
+     * @brief Set up the coalescing of concurrent ExistKey, GetReplicaList and
+     * memory PutEnd calls into their batch RPCs, when
+     * MC_STORE_MASTER_COALESCE_US is positive.
+     */
+    void InitCoalescers();
+
     /**
      * @brief Generic RPC invocation helper for single-result operations
      * @tparam ServiceMethod Pointer to WrappedMasterService member function
@@ -453,10 +651,33 @@ class MasterClient {
     std::shared_ptr<coro_io::client_pools<coro_rpc::coro_rpc_client>>
         client_pools_;
 
+    // Null when coalescing is disabled
+    std::unique_ptr<RpcCoalescer<bool>> exist_key_coalescer_;
+    std::unique_ptr<RpcCoalescer<GetReplicaListResponse>>
+        get_replica_list_coalescer_;
+    std::unique_ptr<RpcCoalescer<void>> put_end_coalescer_;
+
+    std::atomic<bool> watch_puts_{false};
+    // Put sequence id to ask the master from, 0 until the first ping
+    std::atomic<uint64_t> put_sequence_id_{0};
+
     // Mutex to insure the Connect function is atomic.
     mutable Mutex connect_mutex_;
     // The address which is passed to the coro_rpc_client
     std::string client_addr_param_ GUARDED_BY(connect_mutex_);
+
+    mutable std::shared_mutex partitions_mutex_;
+    std::shared_ptr<const Partitions> partitions_;
+    // Segments mounted on a partitioned cluster, sliced again when the
+    // ring changes. The mutex also serializes (un)mounting with ring
+    // changes.
+    std::mutex partition_segments_mutex_;
+    std::unordered_map<UUID, Segment, boost::hash<UUID>> partition_segments_;
+    // Master of each task fetched from a partitioned cluster, until it is
+    // marked as complete
+    std::mutex partition_tasks_mutex_;
+    std::unordered_map<UUID, std::shared_ptr<MasterClient>, boost::hash<UUID>>
+        partition_tasks_;
 };
 
 }  // namespace mooncake
@@ -25,15 +25,43 @@ struct MasterConfig {
     bool allow_evict_soft_pinned_objects;
     double eviction_ratio;
     double eviction_high_watermark_ratio;
+    uint32_t eviction_sample_size;
+    uint32_t eviction_shards_per_tick;
+    bool enable_cost_aware_eviction;
+    std::string tenant_quotas;
+    uint64_t put_lease_ttl_ms;
+    bool enable_segment_pressure_eviction;
+    uint32_t rebalance_bandwidth_mb;
+    uint32_t tiering_demote_access_count;
+    uint32_t tiering_promote_disk_reads;
     int64_t client_live_ttl_sec;
 
     bool enable_ha;
+    bool enable_partition;
+    // Partition masters run by the process, see RunPartitionWorkers
+    uint32_t partition_workers;
     bool enable_offload;
     std::string etcd_endpoints;
 
     std::string cluster_id;
     std::string root_fs_dir;
     int64_t global_file_segment_size;
+    std::string snapshot_path;
+    uint64_t snapshot_interval_sec;
+    uint64_t oplog_capacity;
+    bool enable_prefix_index;
+    uint64_t allocator_cache_max_size;
+    uint64_t defrag_interval_sec;
+    double defrag_threshold;
+    uint32_t defrag_max_moves;
+    uint64_t defrag_max_request_rate;
+    uint64_t slab_size;
+    uint32_t slab_class_min_count;
+    uint32_t cxl_promote_access_count;
+    uint32_t hot_replica_read_rate;
+    uint32_t hot_replica_max_replicas;
+    uint64_t hot_replica_cooldown_sec;
+    bool enable_dedup;
     std::string memory_allocator;
     std::string allocation_strategy;
 
@@ -88,6 +116,22 @@ class MasterServiceSupervisorConfig {
     std::string cluster_id = DEFAULT_CLUSTER_ID;
     std::string root_fs_dir = DEFAULT_ROOT_FS_DIR;
     int64_t global_file_segment_size = DEFAULT_GLOBAL_FILE_SEGMENT_SIZE;
+    std::string snapshot_path = DEFAULT_SNAPSHOT_PATH;
+    uint64_t snapshot_interval_sec = DEFAULT_SNAPSHOT_INTERVAL_SEC;
+    uint64_t oplog_capacity = DEFAULT_OPLOG_CAPACITY;
+    bool enable_prefix_index = false;
+    uint64_t allocator_cache_max_size = 0;
+    uint64_t defrag_interval_sec = 0;
+    double defrag_threshold = 0.5;
+    uint32_t defrag_max_moves = 16;
+    uint64_t defrag_max_request_rate = 0;
+    uint64_t slab_size = DEFAULT_SLAB_SIZE;
+    uint32_t slab_class_min_count = DEFAULT_SLAB_CLASS_MIN_COUNT;
+    uint32_t cxl_promote_access_count = 0;
+    uint32_t hot_replica_read_rate = 0;
+    uint32_t hot_replica_max_replicas = 3;
+    uint64_t hot_replica_cooldown_sec = 60;
+    bool enable_dedup = false;
     BufferAllocatorType memory_allocator = BufferAllocatorType::OFFSET;
     uint64_t put_start_discard_timeout_sec = DEFAULT_PUT_START_DISCARD_TIMEOUT;
     uint64_t put_start_release_timeout_sec = DEFAULT_PUT_START_RELEASE_TIMEOUT;
@@ -102,6 +146,17 @@ class MasterServiceSupervisorConfig {
         DEFAULT_PROCESSING_TASK_TIMEOUT_SEC;  // 0 = no timeout(infinite)
     uint32_t max_retry_attempts = DEFAULT_MAX_RETRY_ATTEMPTS;
 
+    uint32_t eviction_sample_size = DEFAULT_EVICTION_SAMPLE_SIZE;
+    uint32_t eviction_shards_per_tick = DEFAULT_EVICTION_SHARDS_PER_TICK;
+    bool enable_cost_aware_eviction = false;
+    std::string tenant_quotas;
+    uint64_t put_lease_ttl_ms = 0;
+    bool enable_segment_pressure_eviction = false;
+    uint32_t rebalance_bandwidth_mb = 0;
+    uint32_t tiering_demote_access_count =
+        DEFAULT_TIERING_DEMOTE_ACCESS_COUNT;
+    uint32_t tiering_promote_disk_reads = DEFAULT_TIERING_PROMOTE_DISK_READS;
+
     std::string cxl_path = DEFAULT_CXL_PATH;
     size_t cxl_size = DEFAULT_CXL_SIZE;
     bool enable_cxl = false;
@@ -133,10 +188,28 @@ class MasterServiceSupervisorConfig {
         cluster_id = config.cluster_id;
         root_fs_dir = config.root_fs_dir;
         global_file_segment_size = config.global_file_segment_size;
+        snapshot_path = config.snapshot_path;
+        snapshot_interval_sec = config.snapshot_interval_sec;
+        oplog_capacity = config.oplog_capacity;
+        enable_prefix_index = config.enable_prefix_index;
+        allocator_cache_max_size = config.allocator_cache_max_size;
+        defrag_interval_sec = config.defrag_interval_sec;
+        defrag_threshold = config.defrag_threshold;
+        defrag_max_moves = config.defrag_max_moves;
+        defrag_max_request_rate = config.defrag_max_request_rate;
+        slab_size = config.slab_size;
+        slab_class_min_count = config.slab_class_min_count;
+        cxl_promote_access_count = config.cxl_promote_access_count;
+        hot_replica_read_rate = config.hot_replica_read_rate;
+        hot_replica_max_replicas = config.hot_replica_max_replicas;
+        hot_replica_cooldown_sec = config.hot_replica_cooldown_sec;
+        enable_dedup = config.enable_dedup;
 
         // Convert string memory_allocator to BufferAllocatorType enum
         if (config.memory_allocator == "cachelib") {
             memory_allocator = BufferAllocatorType::CACHELIB;
+        } else if (config.memory_allocator == "slab") {
+            memory_allocator = BufferAllocatorType::SLAB;
         } else {
             memory_allocator = BufferAllocatorType::OFFSET;
         }
@@ -152,6 +225,16 @@ class MasterServiceSupervisorConfig {
         pending_task_timeout_sec = config.pending_task_timeout_sec;
         processing_task_timeout_sec = config.processing_task_timeout_sec;
         max_retry_attempts = config.max_retry_attempts;
+        eviction_sample_size = config.eviction_sample_size;
+        eviction_shards_per_tick = config.eviction_shards_per_tick;
+        enable_cost_aware_eviction = config.enable_cost_aware_eviction;
+        tenant_quotas = config.tenant_quotas;
+        put_lease_ttl_ms = config.put_lease_ttl_ms;
+        enable_segment_pressure_eviction =
+            config.enable_segment_pressure_eviction;
+        rebalance_bandwidth_mb = config.rebalance_bandwidth_mb;
+        tiering_demote_access_count = config.tiering_demote_access_count;
+        tiering_promote_disk_reads = config.tiering_promote_disk_reads;
 
         cxl_path = config.cxl_path;
         cxl_size = config.cxl_size;
@@ -210,9 +293,21 @@ class WrappedMasterServiceConfig {
         DEFAULT_ALLOW_EVICT_SOFT_PINNED_OBJECTS;
     bool enable_metric_reporting = true;
     uint16_t http_port = 9003;
+    // Serve the metrics on http_port, off for all but one master of a process
+    bool enable_http_server = true;
     double eviction_ratio = DEFAULT_EVICTION_RATIO;
     double eviction_high_watermark_ratio =
         DEFAULT_EVICTION_HIGH_WATERMARK_RATIO;
+    uint32_t eviction_sample_size = DEFAULT_EVICTION_SAMPLE_SIZE;
+    uint32_t eviction_shards_per_tick = DEFAULT_EVICTION_SHARDS_PER_TICK;
+    bool enable_cost_aware_eviction = false;
+    std::string tenant_quotas;
+    uint64_t put_lease_ttl_ms = 0;
+    bool enable_segment_pressure_eviction = false;
+    uint32_t rebalance_bandwidth_mb = 0;
+    uint32_t tiering_demote_access_count =
+        DEFAULT_TIERING_DEMOTE_ACCESS_COUNT;
+    uint32_t tiering_promote_disk_reads = DEFAULT_TIERING_PROMOTE_DISK_READS;
     ViewVersionId view_version = 0;
     int64_t client_live_ttl_sec = DEFAULT_CLIENT_LIVE_TTL_SEC;
     bool enable_ha = false;
@@ -220,6 +315,22 @@ class WrappedMasterServiceConfig {
     std::string cluster_id = DEFAULT_CLUSTER_ID;
     std::string root_fs_dir = DEFAULT_ROOT_FS_DIR;
     int64_t global_file_segment_size = DEFAULT_GLOBAL_FILE_SEGMENT_SIZE;
+    std::string snapshot_path = DEFAULT_SNAPSHOT_PATH;
+    uint64_t snapshot_interval_sec = DEFAULT_SNAPSHOT_INTERVAL_SEC;
+    uint64_t oplog_capacity = DEFAULT_OPLOG_CAPACITY;
+    bool enable_prefix_index = false;
+    uint64_t allocator_cache_max_size = 0;
+    uint64_t defrag_interval_sec = 0;
+    double defrag_threshold = 0.5;
+    uint32_t defrag_max_moves = 16;
+    uint64_t defrag_max_request_rate = 0;
+    uint64_t slab_size = DEFAULT_SLAB_SIZE;
+    uint32_t slab_class_min_count = DEFAULT_SLAB_CLASS_MIN_COUNT;
+    uint32_t cxl_promote_access_count = 0;
+    uint32_t hot_replica_read_rate = 0;
+    uint32_t hot_replica_max_replicas = 3;
+    uint64_t hot_replica_cooldown_sec = 60;
+    bool enable_dedup = false;
     BufferAllocatorType memory_allocator = BufferAllocatorType::OFFSET;
     AllocationStrategyType allocation_strategy_type =
         AllocationStrategyType::RANDOM;
@@ -256,6 +367,16 @@ class WrappedMasterServiceConfig {
         http_port = static_cast<uint16_t>(config.metrics_port);
         eviction_ratio = config.eviction_ratio;
         eviction_high_watermark_ratio = config.eviction_high_watermark_ratio;
+        eviction_sample_size = config.eviction_sample_size;
+        eviction_shards_per_tick = config.eviction_shards_per_tick;
+        enable_cost_aware_eviction = config.enable_cost_aware_eviction;
+        tenant_quotas = config.tenant_quotas;
+        put_lease_ttl_ms = config.put_lease_ttl_ms;
+        enable_segment_pressure_eviction =
+            config.enable_segment_pressure_eviction;
+        rebalance_bandwidth_mb = config.rebalance_bandwidth_mb;
+        tiering_demote_access_count = config.tiering_demote_access_count;
+        tiering_promote_disk_reads = config.tiering_promote_disk_reads;
         view_version = view_version_param;
         client_live_ttl_sec = config.client_live_ttl_sec;
         enable_ha = config.enable_ha;
@@ -263,12 +384,30 @@ class WrappedMasterServiceConfig {
         cluster_id = config.cluster_id;
         root_fs_dir = config.root_fs_dir;
         global_file_segment_size = config.global_file_segment_size;
+        snapshot_path = config.snapshot_path;
+        snapshot_interval_sec = config.snapshot_interval_sec;
+        oplog_capacity = config.oplog_capacity;
+        enable_prefix_index = config.enable_prefix_index;
+        allocator_cache_max_size = config.allocator_cache_max_size;
+        defrag_interval_sec = config.defrag_interval_sec;
+        defrag_threshold = config.defrag_threshold;
+        defrag_max_moves = config.defrag_max_moves;
+        defrag_max_request_rate = config.defrag_max_request_rate;
+        slab_size = config.slab_size;
+        slab_class_min_count = config.slab_class_min_count;
+        cxl_promote_access_count = config.cxl_promote_access_count;
+        hot_replica_read_rate = config.hot_replica_read_rate;
+        hot_replica_max_replicas = config.hot_replica_max_replicas;
+        hot_replica_cooldown_sec = config.hot_replica_cooldown_sec;
+        enable_dedup = config.enable_dedup;
         enable_disk_eviction = config.enable_disk_eviction;
         quota_bytes = config.quota_bytes;
 
         // Convert string memory_allocator to BufferAllocatorType enum
         if (config.memory_allocator == "cachelib") {
             memory_allocator = mooncake::BufferAllocatorType::CACHELIB;
+        } else if (config.memory_allocator == "slab") {
+            memory_allocator = mooncake::BufferAllocatorType::SLAB;
         } else {
             memory_allocator = mooncake::BufferAllocatorType::OFFSET;
         }
@@ -278,14 +417,16 @@ class WrappedMasterServiceConfig {
             allocation_strategy_type = AllocationStrategyType::FREE_RATIO_FIRST;
         } else if (config.allocation_strategy == "cxl") {
             allocation_strategy_type = AllocationStrategyType::CXL;
+        } else if (config.allocation_strategy == "load_aware") {
+            allocation_strategy_type = AllocationStrategyType::LOAD_AWARE;
         } else if (config.allocation_strategy == "random") {
             allocation_strategy_type = AllocationStrategyType::RANDOM;
         } else {
             LOG(WARNING) << "Unrecognized allocation_strategy value: '"
                          << config.allocation_strategy
                          << "'. Defaulting to 'random'. "
-                         << "Valid options are: random, free_ratio_first, cxl "
-                            "(case-sensitive)";
+                         << "Valid options are: random, free_ratio_first, cxl, "
+                            "load_aware (case-sensitive)";
             allocation_strategy_type = AllocationStrategyType::RANDOM;
         }
 
@@ -318,6 +459,16 @@ class WrappedMasterServiceConfig {
         http_port = static_cast<uint16_t>(config.metrics_port);
         eviction_ratio = config.eviction_ratio;
         eviction_high_watermark_ratio = config.eviction_high_watermark_ratio;
+        eviction_sample_size = config.eviction_sample_size;
+        eviction_shards_per_tick = config.eviction_shards_per_tick;
+        enable_cost_aware_eviction = config.enable_cost_aware_eviction;
+        tenant_quotas = config.tenant_quotas;
+        put_lease_ttl_ms = config.put_lease_ttl_ms;
+        enable_segment_pressure_eviction =
+            config.enable_segment_pressure_eviction;
+        rebalance_bandwidth_mb = config.rebalance_bandwidth_mb;
+        tiering_demote_access_count = config.tiering_demote_access_count;
+        tiering_promote_disk_reads = config.tiering_promote_disk_reads;
         view_version = view_version_param;
         client_live_ttl_sec = config.client_live_ttl_sec;
         enable_ha =
@@ -326,6 +477,22 @@ class WrappedMasterServiceConfig {
         cluster_id = config.cluster_id;
         root_fs_dir = config.root_fs_dir;
         global_file_segment_size = config.global_file_segment_size;
+        snapshot_path = config.snapshot_path;
+        snapshot_interval_sec = config.snapshot_interval_sec;
+        oplog_capacity = config.oplog_capacity;
+        enable_prefix_index = config.enable_prefix_index;
+        allocator_cache_max_size = config.allocator_cache_max_size;
+        defrag_interval_sec = config.defrag_interval_sec;
+        defrag_threshold = config.defrag_threshold;
+        defrag_max_moves = config.defrag_max_moves;
+        defrag_max_request_rate = config.defrag_max_request_rate;
+        slab_size = config.slab_size;
+        slab_class_min_count = config.slab_class_min_count;
+        cxl_promote_access_count = config.cxl_promote_access_count;
+        hot_replica_read_rate = config.hot_replica_read_rate;
+        hot_replica_max_replicas = config.hot_replica_max_replicas;
+        hot_replica_cooldown_sec = config.hot_replica_cooldown_sec;
+        enable_dedup = config.enable_dedup;
         memory_allocator = config.memory_allocator;
         enable_disk_eviction = config.enable_disk_eviction;
         quota_bytes = config.quota_bytes;
@@ -357,6 +524,17 @@ class MasterServiceConfigBuilder {
     double eviction_ratio_ = DEFAULT_EVICTION_RATIO;
     double eviction_high_watermark_ratio_ =
         DEFAULT_EVICTION_HIGH_WATERMARK_RATIO;
+    uint32_t eviction_sample_size_ = DEFAULT_EVICTION_SAMPLE_SIZE;
+    uint32_t eviction_shards_per_tick_ = DEFAULT_EVICTION_SHARDS_PER_TICK;
+    bool enable_cost_aware_eviction_ = false;
+    std::string tenant_quotas_;
+    uint64_t put_lease_ttl_ms_ = 0;
+    bool enable_segment_pressure_eviction_ = false;
+    uint32_t rebalance_bandwidth_mb_ = 0;
+    uint32_t tiering_demote_access_count_ =
+        DEFAULT_TIERING_DEMOTE_ACCESS_COUNT;
+    uint32_t tiering_promote_disk_reads_ =
+        DEFAULT_TIERING_PROMOTE_DISK_READS;
     ViewVersionId view_version_ = 0;
     int64_t client_live_ttl_sec_ = DEFAULT_CLIENT_LIVE_TTL_SEC;
     bool enable_ha_ = false;
@@ -364,6 +542,22 @@ class MasterServiceConfigBuilder {
     std::string cluster_id_ = DEFAULT_CLUSTER_ID;
     std::string root_fs_dir_ = DEFAULT_ROOT_FS_DIR;
     int64_t global_file_segment_size_ = DEFAULT_GLOBAL_FILE_SEGMENT_SIZE;
+    std::string snapshot_path_ = DEFAULT_SNAPSHOT_PATH;
+    uint64_t snapshot_interval_sec_ = DEFAULT_SNAPSHOT_INTERVAL_SEC;
+    uint64_t oplog_capacity_ = DEFAULT_OPLOG_CAPACITY;
+    bool enable_prefix_index_ = false;
+    uint64_t allocator_cache_max_size_ = 0;
+    uint64_t defrag_interval_sec_ = 0;
+    double defrag_threshold_ = 0.5;
+    uint32_t defrag_max_moves_ = 16;
+    uint64_t defrag_max_request_rate_ = 0;
+    uint64_t slab_size_ = DEFAULT_SLAB_SIZE;
+    uint32_t slab_class_min_count_ = DEFAULT_SLAB_CLASS_MIN_COUNT;
+    uint32_t cxl_promote_access_count_ = 0;
+    uint32_t hot_replica_read_rate_ = 0;
+    uint32_t hot_replica_max_replicas_ = 3;
+    uint64_t hot_replica_cooldown_sec_ = 60;
+    bool enable_dedup_ = false;
     BufferAllocatorType memory_allocator_ = BufferAllocatorType::OFFSET;
     AllocationStrategyType allocation_strategy_type_ =
         AllocationStrategyType::RANDOM;
@@ -412,6 +606,54 @@ class MasterServiceConfigBuilder {
         return *this;
     }
 
+    MasterServiceConfigBuilder& set_eviction_sample_size(uint32_t size) {
+        eviction_sample_size_ = size;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_eviction_shards_per_tick(uint32_t num) {
+        eviction_shards_per_tick_ = num;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_enable_cost_aware_eviction(bool enable) {
+        enable_cost_aware_eviction_ = enable;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_tenant_quotas(const std::string& quotas) {
+        tenant_quotas_ = quotas;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_put_lease_ttl_ms(uint64_t ttl_ms) {
+        put_lease_ttl_ms_ = ttl_ms;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_enable_segment_pressure_eviction(
+        bool enable) {
+        enable_segment_pressure_eviction_ = enable;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_rebalance_bandwidth_mb(uint32_t mb) {
+        rebalance_bandwidth_mb_ = mb;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_tiering_demote_access_count(
+        uint32_t count) {
+        tiering_demote_access_count_ = count;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_tiering_promote_disk_reads(
+        uint32_t count) {
+        tiering_promote_disk_reads_ = count;
+        return *this;
+    }
+
     MasterServiceConfigBuilder& set_view_version(ViewVersionId version) {
         view_version_ = version;
         return *this;
@@ -442,6 +684,86 @@ class MasterServiceConfigBuilder {
         return *this;
     }
 
+    MasterServiceConfigBuilder& set_snapshot_path(const std::string& path) {
+        snapshot_path_ = path;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_snapshot_interval_sec(uint64_t sec) {
+        snapshot_interval_sec_ = sec;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_oplog_capacity(uint64_t capacity) {
+        oplog_capacity_ = capacity;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_enable_prefix_index(bool enable) {
+        enable_prefix_index_ = enable;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_allocator_cache_max_size(uint64_t size) {
+        allocator_cache_max_size_ = size;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_defrag_interval_sec(uint64_t interval_sec) {
+        defrag_interval_sec_ = interval_sec;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_defrag_threshold(double threshold) {
+        defrag_threshold_ = threshold;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_defrag_max_moves(uint32_t max_moves) {
+        defrag_max_moves_ = max_moves;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_defrag_max_request_rate(uint64_t rate) {
+        defrag_max_request_rate_ = rate;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_slab_size(uint64_t size) {
+        slab_size_ = size;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_slab_class_min_count(uint32_t count) {
+        slab_class_min_count_ = count;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_cxl_promote_access_count(uint32_t count) {
+        cxl_promote_access_count_ = count;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_hot_replica_read_rate(uint32_t rate) {
+        hot_replica_read_rate_ = rate;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_hot_replica_max_replicas(uint32_t count) {
+        hot_replica_max_replicas_ = count;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_hot_replica_cooldown_sec(uint64_t sec) {
+        hot_replica_cooldown_sec_ = sec;
+        return *this;
+    }
+
+    MasterServiceConfigBuilder& set_enable_dedup(bool enable) {
+        enable_dedup_ = enable;
+        return *this;
+    }
+
     MasterServiceConfigBuilder& set_global_file_segment_size(
         int64_t segment_size) {
         global_file_segment_size_ = segment_size;
@@ -543,6 +865,16 @@ class MasterServiceConfig {
     double eviction_ratio = DEFAULT_EVICTION_RATIO;
     double eviction_high_watermark_ratio =
         DEFAULT_EVICTION_HIGH_WATERMARK_RATIO;
+    uint32_t eviction_sample_size = DEFAULT_EVICTION_SAMPLE_SIZE;
+    uint32_t eviction_shards_per_tick = DEFAULT_EVICTION_SHARDS_PER_TICK;
+    bool enable_cost_aware_eviction = false;
+    std::string tenant_quotas;
+    uint64_t put_lease_ttl_ms = 0;
+    bool enable_segment_pressure_eviction = false;
+    uint32_t rebalance_bandwidth_mb = 0;
+    uint32_t tiering_demote_access_count =
+        DEFAULT_TIERING_DEMOTE_ACCESS_COUNT;
+    uint32_t tiering_promote_disk_reads = DEFAULT_TIERING_PROMOTE_DISK_READS;
     ViewVersionId view_version = 0;
     int64_t client_live_ttl_sec = DEFAULT_CLIENT_LIVE_TTL_SEC;
     bool enable_ha = false;
@@ -550,6 +882,22 @@ class MasterServiceConfig {
     std::string cluster_id = DEFAULT_CLUSTER_ID;
     std::string root_fs_dir = DEFAULT_ROOT_FS_DIR;
     int64_t global_file_segment_size = DEFAULT_GLOBAL_FILE_SEGMENT_SIZE;
+    std::string snapshot_path = DEFAULT_SNAPSHOT_PATH;
+    uint64_t snapshot_interval_sec = DEFAULT_SNAPSHOT_INTERVAL_SEC;
+    uint64_t oplog_capacity = DEFAULT_OPLOG_CAPACITY;
+    bool enable_prefix_index = false;
+    uint64_t allocator_cache_max_size = 0;
+    uint64_t defrag_interval_sec = 0;
+    double defrag_threshold = 0.5;
+    uint32_t defrag_max_moves = 16;
+    uint64_t defrag_max_request_rate = 0;
+    uint64_t slab_size = DEFAULT_SLAB_SIZE;
+    uint32_t slab_class_min_count = DEFAULT_SLAB_CLASS_MIN_COUNT;
+    uint32_t cxl_promote_access_count = 0;
+    uint32_t hot_replica_read_rate = 0;
+    uint32_t hot_replica_max_replicas = 3;
+    uint64_t hot_replica_cooldown_sec = 60;
+    bool enable_dedup = false;
     BufferAllocatorType memory_allocator = BufferAllocatorType::OFFSET;
     AllocationStrategyType allocation_strategy_type =
         AllocationStrategyType::RANDOM;
@@ -582,6 +930,16 @@ class MasterServiceConfig {
             config.allow_evict_soft_pinned_objects;
         eviction_ratio = config.eviction_ratio;
         eviction_high_watermark_ratio = config.eviction_high_watermark_ratio;
+        eviction_sample_size = config.eviction_sample_size;
+        eviction_shards_per_tick = config.eviction_shards_per_tick;
+        enable_cost_aware_eviction = config.enable_cost_aware_eviction;
+        tenant_quotas = config.tenant_quotas;
+        put_lease_ttl_ms = config.put_lease_ttl_ms;
+        enable_segment_pressure_eviction =
+            config.enable_segment_pressure_eviction;
+        rebalance_bandwidth_mb = config.rebalance_bandwidth_mb;
+        tiering_demote_access_count = config.tiering_demote_access_count;
+        tiering_promote_disk_reads = config.tiering_promote_disk_reads;
         view_version = config.view_version;
         client_live_ttl_sec = config.client_live_ttl_sec;
         enable_ha = config.enable_ha;
@@ -589,6 +947,22 @@ class MasterServiceConfig {
         cluster_id = config.cluster_id;
         root_fs_dir = config.root_fs_dir;
         global_file_segment_size = config.global_file_segment_size;
+        snapshot_path = config.snapshot_path;
+        snapshot_interval_sec = config.snapshot_interval_sec;
+        oplog_capacity = config.oplog_capacity;
+        enable_prefix_index = config.enable_prefix_index;
+        allocator_cache_max_size = config.allocator_cache_max_size;
+        defrag_interval_sec = config.defrag_interval_sec;
+        defrag_threshold = config.defrag_threshold;
+        defrag_max_moves = config.defrag_max_moves;
+        defrag_max_request_rate = config.defrag_max_request_rate;
+        slab_size = config.slab_size;
+        slab_class_min_count = config.slab_class_min_count;
+        cxl_promote_access_count = config.cxl_promote_access_count;
+        hot_replica_read_rate = config.hot_replica_read_rate;
+        hot_replica_max_replicas = config.hot_replica_max_replicas;
+        hot_replica_cooldown_sec = config.hot_replica_cooldown_sec;
+        enable_dedup = config.enable_dedup;
         memory_allocator =
             config.enable_cxl ? cxl_allocator_type : config.memory_allocator;
         allocation_strategy_type = config.allocation_strategy_type;
@@ -624,6 +998,15 @@ inline MasterServiceConfig MasterServiceConfigBuilder::build() const {
     config.allow_evict_soft_pinned_objects = allow_evict_soft_pinned_objects_;
     config.eviction_ratio = eviction_ratio_;
     config.eviction_high_watermark_ratio = eviction_high_watermark_ratio_;
+    config.eviction_sample_size = eviction_sample_size_;
+    config.eviction_shards_per_tick = eviction_shards_per_tick_;
+    config.enable_cost_aware_eviction = enable_cost_aware_eviction_;
+    config.tenant_quotas = tenant_quotas_;
+    config.put_lease_ttl_ms = put_lease_ttl_ms_;
+    config.enable_segment_pressure_eviction = enable_segment_pressure_eviction_;
+    config.rebalance_bandwidth_mb = rebalance_bandwidth_mb_;
+    config.tiering_demote_access_count = tiering_demote_access_count_;
+    config.tiering_promote_disk_reads = tiering_promote_disk_reads_;
     config.view_version = view_version_;
     config.client_live_ttl_sec = client_live_ttl_sec_;
     config.enable_ha = enable_ha_;
@@ -631,6 +1014,22 @@ inline MasterServiceConfig MasterServiceConfigBuilder::build() const {
     config.cluster_id = cluster_id_;
     config.root_fs_dir = root_fs_dir_;
     config.global_file_segment_size = global_file_segment_size_;
+    config.snapshot_path = snapshot_path_;
+    config.snapshot_interval_sec = snapshot_interval_sec_;
+    config.oplog_capacity = oplog_capacity_;
+    config.enable_prefix_index = enable_prefix_index_;
+    config.allocator_cache_max_size = allocator_cache_max_size_;
+    config.defrag_interval_sec = defrag_interval_sec_;
+    config.defrag_threshold = defrag_threshold_;
+    config.defrag_max_moves = defrag_max_moves_;
+    config.defrag_max_request_rate = defrag_max_request_rate_;
+    config.slab_size = slab_size_;
+    config.slab_class_min_count = slab_class_min_count_;
+    config.cxl_promote_access_count = cxl_promote_access_count_;
+    config.hot_replica_read_rate = hot_replica_read_rate_;
+    config.hot_replica_max_replicas = hot_replica_max_replicas_;
+    config.hot_replica_cooldown_sec = hot_replica_cooldown_sec_;
+    config.enable_dedup = enable_dedup_;
     config.memory_allocator = memory_allocator_;
     config.allocation_strategy_type = allocation_strategy_type_;
     config.put_start_discard_timeout_sec = put_start_discard_timeout_sec_;
@@ -7,8 +7,15 @@
 #include "ylt/metric/gauge.hpp"
 #include "ylt/metric/histogram.hpp"
 
+#include "striped_metric.h"
+
 namespace mooncake {
 
+// Request and key counters are updated by every RPC thread, see
+// StripedMetric
+using striped_counter_t = StripedMetric<ylt::metric::counter_t>;
+using striped_gauge_t = StripedMetric<ylt::metric::gauge_t>;
+
 class MasterMetricManager {
    public:
     // --- Singleton Access ---
@@ -30,6 +37,7 @@ class MasterMetricManager {
 
     void inc_mem_cache_hit_nums(int64_t val = 1);
     void inc_file_cache_hit_nums(int64_t val = 1);
+    void inc_local_disk_cache_hit_nums(int64_t val = 1);
     void inc_mem_cache_nums(int64_t val = 1);
     void inc_file_cache_nums(int64_t val = 1);
     void dec_mem_cache_nums(int64_t val = 1);
@@ -205,12 +213,43 @@ class MasterMetricManager {
     // Eviction Metrics
     void inc_eviction_success(int64_t key_count, int64_t size);
     void inc_eviction_fail();  // not a single object is evicted
+    // Records one finished eviction pass, full-scan or incremental
+    void observe_eviction_pass(int64_t latency_us, int64_t evicted_keys);
+    // Records one object removed when its TTL ran out
+    void inc_ttl_expired(int64_t size);
+
+    // RPC Latency Metrics
+    void observe_rpc_latency(const std::string& rpc, int64_t latency_us);
+    // Records one contended acquisition of a metadata shard lock
+    void observe_shard_lock_wait(int64_t wait_us);
+
+    // Tenant Metrics, see TenantRegistry
+    void set_tenant_quota(const std::string& tenant, int64_t bytes);
+    void inc_tenant_mem_size(const std::string& tenant, int64_t val);
+    void dec_tenant_mem_size(const std::string& tenant, int64_t val);
+    void inc_tenant_get_hits(const std::string& tenant);
+    void inc_tenant_get_misses(const std::string& tenant);
+    int64_t get_tenant_get_hits(const std::string& tenant);
+    int64_t get_tenant_get_misses(const std::string& tenant);
+
+    // Tiering Metrics
+    void inc_tiering_demotions(int64_t val = 1);
+    void inc_tiering_promotions(int64_t val = 1);
+    int64_t get_tiering_demotions();
+    int64_t get_tiering_promotions();
+
+    // Deduplication Metrics
+    // Records a put that shares the replicas of stored content
+    void inc_dedup_hits(int64_t saved_bytes);
+    int64_t get_dedup_hits();
+    int64_t get_dedup_saved_bytes();
 
     // Eviction Metrics Getters
     int64_t get_eviction_success();
     int64_t get_eviction_attempts();
     int64_t get_evicted_key_count();
     int64_t get_evicted_size();
+    int64_t get_ttl_expired_keys();
 
     // PutStart Discard Metrics
     void inc_put_start_discard_cnt(int64_t count, int64_t size);
@@ -314,86 +353,87 @@ class MasterMetricManager {
     ylt::metric::gauge_t file_total_capacity_;
 
     // Key/Value Metrics
-    ylt::metric::gauge_t key_count_;
-    ylt::metric::gauge_t soft_pin_key_count_;
+    striped_gauge_t key_count_;
+    striped_gauge_t soft_pin_key_count_;
     ylt::metric::histogram_t value_size_distribution_;
 
     // Cluster Metrics
     ylt::metric::gauge_t active_clients_;
 
     // Operation Statistics
-    ylt::metric::counter_t put_start_requests_;
-    ylt::metric::counter_t put_start_failures_;
-    ylt::metric::counter_t put_end_requests_;
-    ylt::metric::counter_t put_end_failures_;
-    ylt::metric::counter_t put_revoke_requests_;
-    ylt::metric::counter_t put_revoke_failures_;
-    ylt::metric::counter_t get_replica_list_requests_;
-    ylt::metric::counter_t get_replica_list_failures_;
-    ylt::metric::counter_t get_replica_list_by_regex_requests_;
-    ylt::metric::counter_t get_replica_list_by_regex_failures_;
-    ylt::metric::counter_t exist_key_requests_;
-    ylt::metric::counter_t exist_key_failures_;
-    ylt::metric::counter_t remove_requests_;
-    ylt::metric::counter_t remove_failures_;
-    ylt::metric::counter_t remove_by_regex_requests_;
-    ylt::metric::counter_t remove_by_regex_failures_;
-    ylt::metric::counter_t remove_all_requests_;
-    ylt::metric::counter_t remove_all_failures_;
-    ylt::metric::counter_t mount_segment_requests_;
-    ylt::metric::counter_t mount_segment_failures_;
-    ylt::metric::counter_t unmount_segment_requests_;
-    ylt::metric::counter_t unmount_segment_failures_;
-    ylt::metric::counter_t remount_segment_requests_;
-    ylt::metric::counter_t remount_segment_failures_;
-    ylt::metric::counter_t ping_requests_;
-    ylt::metric::counter_t ping_failures_;
+    striped_counter_t put_start_requests_;
+    striped_counter_t put_start_failures_;
+    striped_counter_t put_end_requests_;
+    striped_counter_t put_end_failures_;
+    striped_counter_t put_revoke_requests_;
+    striped_counter_t put_revoke_failures_;
+    striped_counter_t get_replica_list_requests_;
+    striped_counter_t get_replica_list_failures_;
+    striped_counter_t get_replica_list_by_regex_requests_;
+    striped_counter_t get_replica_list_by_regex_failures_;
+    striped_counter_t exist_key_requests_;
+    striped_counter_t exist_key_failures_;
+    striped_counter_t remove_requests_;
+    striped_counter_t remove_failures_;
+    striped_counter_t remove_by_regex_requests_;
+    striped_counter_t remove_by_regex_failures_;
+    striped_counter_t remove_all_requests_;
+    striped_counter_t remove_all_failures_;
+    striped_counter_t mount_segment_requests_;
+    striped_counter_t mount_segment_failures_;
+    striped_counter_t unmount_segment_requests_;
+    striped_counter_t unmount_segment_failures_;
+    striped_counter_t remount_segment_requests_;
+    striped_counter_t remount_segment_failures_;
+    striped_counter_t ping_requests_;
+    striped_counter_t ping_failures_;
 
     // Batch Operation Statistics
-    ylt::metric::counter_t batch_exist_key_requests_;
-    ylt::metric::counter_t batch_exist_key_failures_;
-    ylt::metric::counter_t batch_exist_key_partial_successes_;
-    ylt::metric::counter_t batch_exist_key_items_;
-    ylt::metric::counter_t batch_exist_key_failed_items_;
-    ylt::metric::counter_t batch_query_ip_requests_;
-    ylt::metric::counter_t batch_query_ip_failures_;
-    ylt::metric::counter_t batch_query_ip_partial_successes_;
-    ylt::metric::counter_t batch_query_ip_items_;
-    ylt::metric::counter_t batch_query_ip_failed_items_;
-    ylt::metric::counter_t batch_replica_clear_requests_;
-    ylt::metric::counter_t batch_replica_clear_failures_;
-    ylt::metric::counter_t batch_replica_clear_partial_successes_;
-    ylt::metric::counter_t batch_replica_clear_items_;
-    ylt::metric::counter_t batch_replica_clear_failed_items_;
-    ylt::metric::counter_t batch_get_replica_list_requests_;
-    ylt::metric::counter_t batch_get_replica_list_failures_;
-    ylt::metric::counter_t batch_get_replica_list_partial_successes_;
-    ylt::metric::counter_t batch_get_replica_list_items_;
-    ylt::metric::counter_t batch_get_replica_list_failed_items_;
-    ylt::metric::counter_t batch_put_start_requests_;
-    ylt::metric::counter_t batch_put_start_failures_;
-    ylt::metric::counter_t batch_put_start_partial_successes_;
-    ylt::metric::counter_t batch_put_start_items_;
-    ylt::metric::counter_t batch_put_start_failed_items_;
-    ylt::metric::counter_t batch_put_end_requests_;
-    ylt::metric::counter_t batch_put_end_failures_;
-    ylt::metric::counter_t batch_put_end_partial_successes_;
-    ylt::metric::counter_t batch_put_end_items_;
-    ylt::metric::counter_t batch_put_end_failed_items_;
-    ylt::metric::counter_t batch_put_revoke_requests_;
-    ylt::metric::counter_t batch_put_revoke_failures_;
-    ylt::metric::counter_t batch_put_revoke_partial_successes_;
-    ylt::metric::counter_t batch_put_revoke_items_;
-    ylt::metric::counter_t batch_put_revoke_failed_items_;
+    striped_counter_t batch_exist_key_requests_;
+    striped_counter_t batch_exist_key_failures_;
+    striped_counter_t batch_exist_key_partial_successes_;
+    striped_counter_t batch_exist_key_items_;
+    striped_counter_t batch_exist_key_failed_items_;
+    striped_counter_t batch_query_ip_requests_;
+    striped_counter_t batch_query_ip_failures_;
+    striped_counter_t batch_query_ip_partial_successes_;
+    striped_counter_t batch_query_ip_items_;
+    striped_counter_t batch_query_ip_failed_items_;
+    striped_counter_t batch_replica_clear_requests_;
+    striped_counter_t batch_replica_clear_failures_;
+    striped_counter_t batch_replica_clear_partial_successes_;
+    striped_counter_t batch_replica_clear_items_;
+    striped_counter_t batch_replica_clear_failed_items_;
+    striped_counter_t batch_get_replica_list_requests_;
+    striped_counter_t batch_get_replica_list_failures_;
+    striped_counter_t batch_get_replica_list_partial_successes_;
+    striped_counter_t batch_get_replica_list_items_;
+    striped_counter_t batch_get_replica_list_failed_items_;
+    striped_counter_t batch_put_start_requests_;
+    striped_counter_t batch_put_start_failures_;
+    striped_counter_t batch_put_start_partial_successes_;
+    striped_counter_t batch_put_start_items_;
+    striped_counter_t batch_put_start_failed_items_;
+    striped_counter_t batch_put_end_requests_;
+    striped_counter_t batch_put_end_failures_;
+    striped_counter_t batch_put_end_partial_successes_;
+    striped_counter_t batch_put_end_items_;
+    striped_counter_t batch_put_end_failed_items_;
+    striped_counter_t batch_put_revoke_requests_;
+    striped_counter_t batch_put_revoke_failures_;
+    striped_counter_t batch_put_revoke_partial_successes_;
+    striped_counter_t batch_put_revoke_items_;
+    striped_counter_t batch_put_revoke_failed_items_;
 
     // cache hit Statistics
-    ylt::metric::counter_t mem_cache_hit_nums_;
-    ylt::metric::counter_t file_cache_hit_nums_;
-    ylt::metric::gauge_t mem_cache_nums_;
-    ylt::metric::gauge_t file_cache_nums_;
+    striped_counter_t mem_cache_hit_nums_;
+    striped_counter_t file_cache_hit_nums_;
+    striped_counter_t local_disk_cache_hit_nums_;
+    striped_gauge_t mem_cache_nums_;
+    striped_gauge_t file_cache_nums_;
 
-    ylt::metric::counter_t valid_get_nums_;
-    ylt::metric::counter_t total_get_nums_;
+    striped_counter_t valid_get_nums_;
+    striped_counter_t total_get_nums_;
 
     static const inline std::unordered_map<CacheHitStat, std::string>
         stat_names_ = {{CacheHitStat::MEMORY_HITS, "memory_hits"},
@@ -406,41 +446,63 @@ class MasterMetricManager {
                        {CacheHitStat::VALID_GET_RATE, "valid_get_rate"}};
 
     // Eviction Metrics
-    ylt::metric::counter_t eviction_success_;
-    ylt::metric::counter_t eviction_attempts_;
-    ylt::metric::counter_t evicted_key_count_;
-    ylt::metric::counter_t evicted_size_;
+    striped_counter_t eviction_success_;
+    striped_counter_t eviction_attempts_;
+    striped_counter_t evicted_key_count_;
+    striped_counter_t evicted_size_;
+    ylt::metric::histogram_t eviction_pass_latency_us_;
+    ylt::metric::histogram_t eviction_pass_size_;
+    striped_counter_t ttl_expired_keys_;
+    striped_counter_t ttl_expired_size_;
+
+    // RPC Latency Metrics
+    ylt::metric::dynamic_histogram_1t rpc_latency_us_;
+    ylt::metric::histogram_t shard_lock_wait_us_;
+
+    // Tenant Metrics
+    ylt::metric::dynamic_gauge_1t tenant_quota_;
+    ylt::metric::dynamic_gauge_1t tenant_mem_size_;
+    ylt::metric::dynamic_counter_1t tenant_get_hits_;
+    ylt::metric::dynamic_counter_1t tenant_get_misses_;
+
+    // Tiering Metrics
+    striped_counter_t tiering_demotions_;
+    striped_counter_t tiering_promotions_;
+
+    // Deduplication Metrics
+    striped_counter_t dedup_hits_;
+    striped_counter_t dedup_saved_bytes_;
 
     // PutStart Discard Metrics
-    ylt::metric::counter_t put_start_discard_cnt_;
-    ylt::metric::counter_t put_start_release_cnt_;
+    striped_counter_t put_start_discard_cnt_;
+    striped_counter_t put_start_release_cnt_;
     ylt::metric::gauge_t put_start_discarded_staging_size_;
 
     // CopyStart, CopyEnd, CopyRevoke, MoveStart, MoveEnd, MoveRevoke Metrics
-    ylt::metric::counter_t copy_start_requests_;
-    ylt::metric::counter_t copy_start_failures_;
-    ylt::metric::counter_t copy_end_requests_;
-    ylt::metric::counter_t copy_end_failures_;
-    ylt::metric::counter_t copy_revoke_requests_;
-    ylt::metric::counter_t copy_revoke_failures_;
-    ylt::metric::counter_t move_start_requests_;
-    ylt::metric::counter_t move_start_failures_;
-    ylt::metric::counter_t move_end_requests_;
-    ylt::metric::counter_t move_end_failures_;
-    ylt::metric::counter_t move_revoke_requests_;
-    ylt::metric::counter_t move_revoke_failures_;
+    striped_counter_t copy_start_requests_;
+    striped_counter_t copy_start_failures_;
+    striped_counter_t copy_end_requests_;
+    striped_counter_t copy_end_failures_;
+    striped_counter_t copy_revoke_requests_;
+    striped_counter_t copy_revoke_failures_;
+    striped_counter_t move_start_requests_;
+    striped_counter_t move_start_failures_;
+    striped_counter_t move_end_requests_;
+    striped_counter_t move_end_failures_;
+    striped_counter_t move_revoke_requests_;
+    striped_counter_t move_revoke_failures_;
 
     // Copy and Move, FetchTasks, MarkTaskToComplete Metrics
-    ylt::metric::counter_t create_copy_task_requests_;
-    ylt::metric::counter_t create_copy_task_failures_;
-    ylt::metric::counter_t create_move_task_requests_;
-    ylt::metric::counter_t create_move_task_failures_;
-    ylt::metric::counter_t query_task_requests_;
-    ylt::metric::counter_t query_task_failures_;
-    ylt::metric::counter_t fetch_tasks_requests_;
-    ylt::metric::counter_t fetch_tasks_failures_;
-    ylt::metric::counter_t mark_task_to_complete_requests_;
-    ylt::metric::counter_t mark_task_to_complete_failures_;
+    striped_counter_t create_copy_task_requests_;
+    striped_counter_t create_copy_task_failures_;
+    striped_counter_t create_move_task_requests_;
+    striped_counter_t create_move_task_failures_;
+    striped_counter_t query_task_requests_;
+    striped_counter_t query_task_failures_;
+    striped_counter_t fetch_tasks_requests_;
+    striped_counter_t fetch_tasks_failures_;
+    striped_counter_t mark_task_to_complete_requests_;
+    striped_counter_t mark_task_to_complete_failures_;
 };
 
 }  // namespace mooncake
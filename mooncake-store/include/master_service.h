@@ -6,6 +6,8 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <list>
 #include <memory>
 #include <optional>
@@ -21,12 +23,16 @@
 #include "allocation_strategy.h"
 #include "master_metric_manager.h"
 #include "mutex.h"
+#include "object_map.h"
+#include "op_log.h"
 #include "segment.h"
 #include "types.h"
 #include "master_config.h"
 #include "rpc_types.h"
 #include "replica.h"
 #include "task_manager.h"
+#include "tenant_registry.h"
+#include "timing_wheel.h"
 
 namespace mooncake {
 // Forward declarations
@@ -90,12 +96,34 @@ class MasterService {
     std::vector<tl::expected<bool, ErrorCode>> BatchExistKey(
         const std::vector<std::string>& keys);
 
+    /**
+     * @brief Check a chain of keys, e.g. the prefixes of a sequence, in
+     * order and stop at the first one that does not exist.
+     * @return The index of the first missing key, keys.size() if all exist
+     */
+    auto BatchExistKeyPrefix(const std::vector<std::string>& keys)
+        -> tl::expected<uint64_t, ErrorCode>;
+
     /**
      * @brief Fetch all keys
      * @return ErrorCode::OK if exists
      */
     auto GetAllKeys() -> tl::expected<std::vector<std::string>, ErrorCode>;
 
+    /**
+     * @brief Fetch the next page of at most limit keys from the cursor on,
+     * locking one metadata shard at a time
+     * @param prefix Only return keys starting with it
+     * @param with_metadata Fill in the size and replicas of every key
+     * @return ErrorCode::INVALID_PARAMS if limit is 0 or above kMaxScanKeys
+     * or the cursor is past the last shard
+     */
+    auto ScanKeys(const ScanKeysCursor& cursor, uint64_t limit,
+                  const std::string& prefix, bool with_metadata)
+        -> tl::expected<ScanKeysResponse, ErrorCode>;
+
+    static constexpr uint64_t kMaxScanKeys = 10000;
+
     /**
      * @brief Fetch all segments, each node has a unique real client with fixed
      * segment name : segment name, preferred format : {ip}:{port}, bad format :
@@ -171,8 +199,21 @@ class MasterService {
     auto GetReplicaList(const std::string& key)
         -> tl::expected<GetReplicaListResponse, ErrorCode>;
 
+    /**
+     * @brief Get the replica lists of a batch of objects. Each metadata shard
+     * is locked once and the leases of the batch share one timestamp.
+     * @return One result per key, in the order of keys
+     */
+    std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>
+    BatchGetReplicaList(const std::vector<std::string>& keys);
+
     /**
      * @brief Start a put operation for an object
+     *
+     * With enable_dedup, a put whose config carries a content hash that
+     * matches stored content of the same size makes key refer to the stored
+     * replicas, and returns an empty replica list: there is nothing to
+     * write and no PutEnd to call.
      * @param[out] replica_list Vector to store replica information for the
      * slice
      * @return ErrorCode::OK on success, ErrorCode::OBJECT_NOT_FOUND if exists,
@@ -185,12 +226,52 @@ class MasterService {
 
     /**
      * @brief Complete a put operation, replica_type indicates the type of
-     * replica to complete (memory or disk)
+     * replica to complete (memory or disk). A checksum, the CRC32C of the
+     * object computed by the writer, is kept with the object and returned
+     * to its readers.
      * @return ErrorCode::OK on success, ErrorCode::OBJECT_NOT_FOUND if not
      * found, ErrorCode::INVALID_WRITE if replica status is invalid
      */
     auto PutEnd(const UUID& client_id, const std::string& key,
-                ReplicaType replica_type) -> tl::expected<void, ErrorCode>;
+                ReplicaType replica_type,
+                std::optional<uint32_t> checksum = std::nullopt)
+        -> tl::expected<void, ErrorCode>;
+
+    /**
+     * @brief Start a streamed put: like PutStart, but the object is written
+     * in chunks of the given lengths, e.g. one per layer of a KV cache, and
+     * each chunk can be read with GetStreamReplicaList as soon as
+     * StreamPutCommit reports it written, before PutEnd.
+     * @return ErrorCode::INVALID_PARAMS for more than kMaxStreamChunks
+     * chunks, an empty chunk, or striped or erasure coded replicas, otherwise
+     * as PutStart
+     */
+    auto StreamPutStart(const UUID& client_id, const std::string& key,
+                        const std::vector<uint64_t>& chunk_lengths,
+                        const ReplicateConfig& config)
+        -> tl::expected<std::vector<Replica::Descriptor>, ErrorCode>;
+
+    /**
+     * @brief Mark chunks [first_chunk, first_chunk + num_chunks) of a
+     * streamed put as written to all its memory replicas
+     * @return ErrorCode::OBJECT_NOT_FOUND if not found,
+     * ErrorCode::INVALID_WRITE if the object is not being streamed,
+     * ErrorCode::INVALID_PARAMS if the chunks do not exist
+     */
+    auto StreamPutCommit(const UUID& client_id, const std::string& key,
+                         uint64_t first_chunk, uint64_t num_chunks)
+        -> tl::expected<void, ErrorCode>;
+
+    /**
+     * @brief Get the replicas of an object, which may still be streamed.
+     * For a streamed put in progress, its memory replicas are returned with
+     * the chunk lengths and the committed chunk bitmap; only committed chunks
+     * may be read. A complete object is returned as by GetReplicaList.
+     */
+    auto GetStreamReplicaList(const std::string& key)
+        -> tl::expected<GetStreamReplicaListResponse, ErrorCode>;
+
+    static constexpr size_t kMaxStreamChunks = 4096;
 
     /**
      * @brief Adds a replica instance associated with the given client and key.
@@ -209,11 +290,13 @@ class MasterService {
 
     /**
      * @brief Complete a batch of put operations
+     * @param checksums Empty, or the checksum of each key as for PutEnd
      * @return ErrorCode::OK on success, ErrorCode::OBJECT_NOT_FOUND if not
      * found, ErrorCode::INVALID_WRITE if replica status is invalid
      */
     std::vector<tl::expected<void, ErrorCode>> BatchPutEnd(
-        const UUID& client_id, const std::vector<std::string>& keys);
+        const UUID& client_id, const std::vector<std::string>& keys,
+        const std::vector<uint32_t>& checksums = {});
 
     /**
      * @brief Revoke a batch of put operations
@@ -223,6 +306,42 @@ class MasterService {
     std::vector<tl::expected<void, ErrorCode>> BatchPutRevoke(
         const UUID& client_id, const std::vector<std::string>& keys);
 
+    /**
+     * @brief Grant a client the replicas of slot_count puts of slice_length
+     * bytes, allocated as by PutStart but for keys it does not know yet. The
+     * client writes a slot and reports its key with BatchLeasedPutEnd, so
+     * that small puts take one master call instead of two. Slots not used
+     * within put_lease_ttl_ms, or when the client expires, are released
+     * like discarded PutStarts.
+     * @return ErrorCode::UNAVAILABLE_IN_CURRENT_MODE if the master grants no
+     * leases: without put_lease_ttl_ms, with disk replicas or with the
+     * operation log, which does not carry leases to the standby masters;
+     * ErrorCode::INVALID_PARAMS for striped, erasure coded or deduplicated
+     * puts; otherwise as PutStart. Fewer slots than asked for may be
+     * granted, at least one.
+     */
+    auto GrantPutLease(const UUID& client_id, uint64_t slice_length,
+                       uint64_t slot_count, const ReplicateConfig& config)
+        -> tl::expected<PutLease, ErrorCode>;
+
+    /**
+     * @brief Complete puts written to the slots of put leases, as PutStart
+     * and PutEnd of their keys would
+     * @return One result per put: ErrorCode::LEASE_EXPIRED if the lease is
+     * gone, ErrorCode::INVALID_PARAMS if the slot does not exist or was used
+     * already, otherwise as PutStart and PutEnd. The slot of a failed put is
+     * released.
+     */
+    std::vector<tl::expected<void, ErrorCode>> BatchLeasedPutEnd(
+        const UUID& client_id, const std::vector<LeasedPut>& puts);
+
+    /**
+     * @brief Give back the slots of a put lease that were not used
+     * @return ErrorCode::LEASE_EXPIRED if the lease is gone
+     */
+    auto ReleasePutLease(const UUID& client_id, uint64_t lease_id)
+        -> tl::expected<void, ErrorCode>;
+
     /**
      * @brief Start a copy operation
      *
@@ -230,7 +349,9 @@ class MasterService {
      *
      * @param client_id the client that submit the CopyStart request
      * @param key key of the object
-     * @param src_segment source segment name of the replica to copy from
+     * @param src_segment source segment name of the replica to copy from.
+     * If empty, the object is promoted from a disk replica to one memory
+     * replica, preferably placed in tgt_segments.
      * @param tgt_segments target segment names of the replicas to copy to
      *
      * @return allocated replicas on success, or ErrorCode indicating the
@@ -271,7 +392,8 @@ class MasterService {
                                              const std::string& key);
 
     /**
-     * @brief Remove an object and its replicas
+     * @brief Remove an object and its replicas. A deduplicated key only drops
+     * its reference, and the replicas are removed with the last one.
      * @param key The key to remove.
      * @param force If true, skip lease and replication task checks.
      * @return ErrorCode::OK on success, ErrorCode::OBJECT_NOT_FOUND if not
@@ -297,20 +419,135 @@ class MasterService {
      */
     long RemoveAll(bool force = false);
 
+    /**
+     * @brief Removes the objects whose keys this master no longer owns,
+     * after the ring of a partitioned cluster changed. Objects that are
+     * leased, being written or replicated are kept, the caller retries.
+     * @param owned Whether this master owns a key
+     * @param kept Output param, the number of unowned objects kept
+     * @return the number of objects removed
+     */
+    long RemoveUnownedObjects(
+        const std::function<bool(const std::string& key)>& owned,
+        long& kept);
+
     /**
      * @brief Get the count of keys
      * @return The count of keys
      */
     size_t GetKeyCount() const;
 
+    /**
+     * @brief Write a point-in-time snapshot of the metadata to path, i.e. the
+     * mounted segments including the state of their allocators and all the
+     * objects with their replicas. Mutations are only blocked while the
+     * shards are copied into memory. The file is written afterwards and
+     * atomically renamed to path.
+     * @return ErrorCode::UNAVAILABLE_IN_CURRENT_MODE if the allocators do not
+     * support snapshots (CacheLib or CXL), ErrorCode::FILE_WRITE_FAIL on IO
+     * errors.
+     */
+    auto SaveSnapshot(const std::string& path) -> tl::expected<void, ErrorCode>;
+
+    /**
+     * @brief Restore the metadata from a snapshot written by SaveSnapshot().
+     * Only valid on a master without any object. Shards are restored in
+     * parallel. Replicas that were not complete when the snapshot was taken
+     * are dropped.
+     * @return The number of restored objects,
+     *         ErrorCode::FILE_NOT_FOUND / FILE_READ_FAIL on IO errors,
+     *         ErrorCode::INVALID_VERSION if the file is not a compatible
+     *         snapshot, ErrorCode::INVALID_PARAMS if it is corrupted.
+     */
+    auto LoadSnapshot(const std::string& path)
+        -> tl::expected<size_t, ErrorCode>;
+
+    /**
+     * @brief Read the operation log of the leader, used by standby masters.
+     * @return Up to max_entries entries starting from start_sequence_id,
+     *         ErrorCode::OPLOG_TRUNCATED if the entries are already discarded
+     *         and the standby must bootstrap again,
+     *         ErrorCode::UNAVAILABLE_IN_CURRENT_MODE if the operation log is
+     *         disabled.
+     */
+    auto FetchOpLog(uint64_t start_sequence_id, uint64_t max_entries)
+        -> tl::expected<FetchOpLogResponse, ErrorCode>;
+
+    /**
+     * @brief Take an in-memory snapshot for bootstrapping a standby master.
+     * The snapshot reflects all operation log entries before the returned
+     * sequence id.
+     */
+    auto GetStandbySnapshot()
+        -> tl::expected<StandbySnapshotResponse, ErrorCode>;
+
+    /**
+     * @brief Turn this master into a warm standby. A standby does not evict,
+     * expire clients or write snapshots, it only replays the leader through
+     * LoadStandbySnapshot() and ApplyOpLog() until Promote() is called.
+     * @return ErrorCode::UNAVAILABLE_IN_CURRENT_MODE if the allocators do not
+     * support replication (CacheLib or CXL).
+     */
+    auto EnterStandby() -> tl::expected<void, ErrorCode>;
+
+    bool IsStandby() const { return standby_; }
+
+    /**
+     * @brief Replace the metadata of a standby master with a snapshot from
+     * GetStandbySnapshot() of the leader.
+     */
+    auto LoadStandbySnapshot(const StandbySnapshotResponse& snapshot)
+        -> tl::expected<void, ErrorCode>;
+
+    /**
+     * @brief Apply a batch of operation log entries of the leader on a
+     * standby master. Object entries between two segment entries are applied
+     * shard-parallel, segment entries are applied in order.
+     */
+    auto ApplyOpLog(const std::vector<OpLogEntry>& entries)
+        -> tl::expected<void, ErrorCode>;
+
+    /**
+     * @brief Promote a standby master to the leader of view_version. The
+     * offset allocators are rebuilt from the replicated buffers, so the
+     * replicated objects keep their addresses and new allocations never
+     * overlap them. The timing of all clients is restarted.
+     */
+    auto Promote(ViewVersionId view_version) -> tl::expected<void, ErrorCode>;
+
+    /**
+     * @brief Set the view version returned by Ping. Must be called before
+     * the master starts to serve requests.
+     */
+    void SetViewVersion(ViewVersionId view_version) {
+        view_version_ = view_version;
+    }
+
     /**
      * @brief Heartbeat from client
      * @param client_id The uuid of the client
+     * @param load_report Traffic and rack of the client, used by the
+     *        load-aware allocation strategy
+     * @param put_sequence_id If set, the response lists the keys put since
+     *        this put notification, see PingResponse. 0 only returns the
+     *        sequence id to start from.
      * @return PingResponse containing view version and client status
      * @return ErrorCode::OK on success, ErrorCode::INTERNAL_ERROR if the client
      *         ping queue is full
      */
-    auto Ping(const UUID& client_id) -> tl::expected<PingResponse, ErrorCode>;
+    auto Ping(const UUID& client_id,
+              const ClientLoadReport& load_report = ClientLoadReport(),
+              std::optional<uint64_t> put_sequence_id = std::nullopt)
+        -> tl::expected<PingResponse, ErrorCode>;
+
+    /**
+     * @brief Heartbeats of the clients of one process, sent together by its
+     * PingAggregator. Each request is a Ping, followed by a FetchTasks of
+     * task_batch_size tasks if the ping succeeded.
+     * @return One result per request, in order
+     */
+    std::vector<tl::expected<BatchPingResponse, ErrorCode>> BatchPing(
+        const std::vector<BatchPingRequest>& requests);
 
     /**
      * @brief Get the master service cluster ID to use as subdirectory name
@@ -371,6 +608,51 @@ class MasterService {
                                                  const std::string& source,
                                                  const std::string& target);
 
+    /**
+     * @brief Run one defragmentation round. Memory segments whose largest
+     * free region is below defrag_threshold of their free space are
+     * fragmented. Up to defrag_max_moves cold objects separating free
+     * regions of fragmented segments are moved to segments that are not
+     * fragmented, by submitting move tasks to the clients owning the source
+     * segments. Run periodically if defrag_interval_sec is set.
+     * @return Number of submitted move tasks
+     */
+    size_t DefragmentSegments();
+
+    /**
+     * @brief Promote the hot objects queued by GetReplicaList from CXL
+     * memory to DRAM. An object only on CXL memory is queued whenever it has
+     * been read another cxl_promote_access_count times, and is copied to the
+     * DRAM segment with the most free space by a copy task submitted to the
+     * client owning that segment. Run by the eviction thread.
+     * @return Number of submitted copy tasks
+     */
+    size_t PromoteCxlObjects();
+
+    /**
+     * @brief Spread the objects queued by GetReplicaList as hot over more
+     * segments, and shrink the ones that cooled down. An object read
+     * hot_replica_read_rate times within a second is queued, and gets a copy
+     * task adding a memory replica on the DRAM segment with the most free
+     * space that does not hold it yet, until it has hot_replica_max_replicas
+     * of them. Once it has not been hot for hot_replica_cooldown_sec, the
+     * replicas added this way are dropped again as soon as no reader holds
+     * its lease. Run by the eviction thread.
+     * @return Number of submitted copy tasks
+     */
+    size_t ReplicateHotObjects();
+
+    /**
+     * @brief Move objects from the most loaded segments to the ones mounted
+     * since the master started, at up to rebalance_bandwidth_mb per second.
+     * A move task is submitted per object, hottest first, to the client
+     * owning its source segment. A mounted segment stops receiving moves
+     * once it is within kRebalanceSlack of the global usage ratio. Run by
+     * the eviction thread.
+     * @return Number of submitted move tasks
+     */
+    size_t RebalanceSegments();
+
     /**
      * @brief Query the status of a task
      * @return Task basic info
@@ -384,6 +666,18 @@ class MasterService {
     tl::expected<std::vector<TaskAssignment>, ErrorCode> FetchTasks(
         const UUID& client_id, size_t batch_size);
 
+    using FetchTasksCallback = std::function<void(
+        tl::expected<std::vector<TaskAssignment>, ErrorCode>)>;
+
+    /**
+     * @brief Long-polling FetchTasks: calls done with the pending tasks of
+     * the client, or once some are submitted for it, or with none after
+     * wait_ms, capped to kMaxTaskWaitMs. done may run on the calling
+     * thread, the thread submitting the tasks or a timer thread.
+     */
+    void WaitTasks(const UUID& client_id, size_t batch_size, uint64_t wait_ms,
+                   FetchTasksCallback done);
+
     /**
      * @brief Mark the task as complete
      * @param client_id Client ID
@@ -407,19 +701,81 @@ class MasterService {
     // fulfill evict ratio lowerbound.
     void BatchEvict(double evict_ratio_target, double evict_ratio_lowerbound);
 
-    // Clear invalid handles in all shards
+    // SampledEvict is the incremental alternative to BatchEvict, used when
+    // eviction_sample_size_ > 0. Each call visits at most
+    // eviction_shards_per_tick_ shards and, in each of them, only samples
+    // eviction_sample_size_ objects and evicts the ones with the smallest
+    // lease timeout (approximate LRU). An eviction pass spans multiple calls
+    // until the target is reached or a whole sweep over all shards makes no
+    // progress. Soft pinned objects are only considered after a sweep fails
+    // to reach evict_ratio_lowerbound.
+    void SampledEvict(double evict_ratio_target,
+                      double evict_ratio_lowerbound);
+
+    // Bytes to free in each pressured segment: the ones above the high
+    // watermark or, when allocation_failed, above the global usage ratio.
+    // Both are asked to free the same ratio of their capacity the global
+    // eviction would free of the cluster.
+    std::unordered_map<std::string, uint64_t> GetSegmentEvictionTargets(
+        bool allocation_failed);
+
+    struct SegmentUsage {
+        uint64_t capacity = 0;
+        uint64_t used = 0;
+    };
+    // Usage of every mounted memory segment, by name
+    std::unordered_map<std::string, SegmentUsage> GetSegmentUsages();
+
+    // Evicts the memory replicas on the segments of targets until their
+    // bytes are freed, in order of the eviction rank within each shard.
+    // Replicas of an object on other segments are kept.
+    void SegmentPressureEvict(
+        std::unordered_map<std::string, uint64_t> targets);
+
+    // Clear invalid handles in all shards that have not been swept since
+    // the last segment generation, visiting the shards in parallel
     void ClearInvalidHandles();
 
+    // Start a new segment generation after segments have been unmounted or
+    // buffers detached, so that accesses clean up the objects of shards
+    // that have not been swept yet
+    void BumpSegmentGeneration() {
+        segment_generation_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    // Wake the sweep thread to clear invalid handles in the background
+    void RequestInvalidHandleSweep();
+    void SweepThreadFunc();
+
     // We need to clean up finished tasks periodically to avoid memory leak
     // And also we can add some task ttl mechanism in the future
     void TaskCleanupThreadFunc();
 
+    // Hands the tasks just submitted for client_id to its parked WaitTasks
+    void WakeTaskWaiters(const UUID& client_id);
+    // Completes parked WaitTasks at their deadline
+    void TaskWaiterThreadFunc();
+
     // Internal data structures
+    struct ReplicationTask {
+        UUID client_id;
+        std::chrono::steady_clock::time_point start_time;
+        enum class Type {
+            COPY,
+            MOVE,
+        } type;
+        ReplicaID source_id;
+        std::vector<ReplicaID> replica_ids;
+    };
+
     struct ObjectMetadata {
         // RAII-style metric management
         ~ObjectMetadata() {
+            if (tenant) {
+                tenant->Charge(-static_cast<int64_t>(charged_bytes_));
+            }
             MasterMetricManager::instance().dec_key_count(1);
-            if (soft_pin_timeout) {
+            if (has_soft_pin) {
                 MasterMetricManager::instance().dec_soft_pin_key_count(1);
             }
         }
@@ -430,16 +786,18 @@ class MasterService {
             const UUID& client_id_,
             const std::chrono::steady_clock::time_point put_start_time_,
             size_t value_length, std::vector<Replica>&& reps,
-            bool enable_soft_pin)
+            bool enable_soft_pin, TenantRegistry::Tenant* tenant_ = nullptr)
             : client_id(client_id_),
               put_start_time(put_start_time_),
               size(value_length),
-              lease_timeout(),
-              soft_pin_timeout(std::nullopt),
+              has_soft_pin(enable_soft_pin),
+              tenant(tenant_),
+              lease_timeout(std::chrono::steady_clock::time_point()),
+              soft_pin_timeout(std::chrono::steady_clock::time_point()),
               replicas_(std::move(reps)) {
+            Recharge();
             MasterMetricManager::instance().inc_key_count(1);
             if (enable_soft_pin) {
-                soft_pin_timeout.emplace();
                 MasterMetricManager::instance().inc_soft_pin_key_count(1);
             }
             MasterMetricManager::instance().observe_value_size(value_length);
@@ -453,20 +811,60 @@ class MasterService {
         const UUID client_id;
         const std::chrono::steady_clock::time_point put_start_time;
         const size_t size;
-
-        mutable SpinLock lock;
-        // Default constructor, creates a time_point representing
-        // the Clock's epoch (i.e., time_since_epoch() is zero).
-        mutable std::chrono::steady_clock::time_point lease_timeout
-            GUARDED_BY(lock);  // hard lease
-        mutable std::optional<std::chrono::steady_clock::time_point>
-            soft_pin_timeout GUARDED_BY(lock);  // optional soft pin, only
-                                                // set for vip objects
+        const bool has_soft_pin;  // only set for vip objects
+        // Charged the bytes of the memory replicas, nullptr if none
+        TenantRegistry::Tenant* const tenant;
+
+        // Leases are renewed by every reader of the object under the shared
+        // shard lock, so they are atomics that only ever move forward. Both
+        // start at the clock's epoch, i.e. expired.
+        mutable std::atomic<std::chrono::steady_clock::time_point>
+            lease_timeout;  // hard lease
+        mutable std::atomic<std::chrono::steady_clock::time_point>
+            soft_pin_timeout;  // only used if has_soft_pin
+        // Heat of the object: accesses halved every eviction pass (heat
+        // epoch). Reset when the memory replicas are evicted, so that it then
+        // counts the reads served by disk. Packs the epoch of the last access
+        // in the high and the count in the low 32 bits.
+        mutable std::atomic<uint64_t> heat{0};
+        // Reads within the current second, for hot replication. Packs the
+        // second in the high and the count in the low 32 bits.
+        mutable std::atomic<uint64_t> reads_per_second{0};
+
+        // In-flight operations of the object, guarded by the shard mutex.
+        // Objects with any of them are tracked by the shard map, so that
+        // expired operations are found without scanning the shard.
+        bool in_processing{false};  // PutStart not ended on all replicas
+        std::optional<ReplicationTask> replication_task;  // Copy or Move
+        // Set while the memory replicas of an eviction victim are kept until
+        // its demotion to the local disk of its owner completes. Guarded by
+        // the shard mutex.
+        std::optional<std::chrono::steady_clock::time_point> demotion_start;
+        // Set from StreamPutStart until the memory replicas are PutEnd-ed:
+        // the chunks of the object and which of them are written, one bit
+        // each. Guarded by the shard mutex.
+        struct StreamState {
+            std::vector<uint64_t> chunk_lengths;
+            std::vector<uint64_t> committed;
+        };
+        std::unique_ptr<StreamState> stream;
+        // CRC32C of the object, reported by its writer at PutEnd. Guarded by
+        // the shard mutex.
+        std::optional<uint32_t> checksum;
+        // When the object is removed, if put with a TTL. Guarded by the
+        // shard mutex.
+        std::optional<std::chrono::steady_clock::time_point> expire_time;
+        // ReplicateConfig::cost_hint of the put, guarded by the shard mutex
+        uint64_t cost_hint{0};
+        // With cost aware eviction, see EvictionRank. Updated by readers
+        // under the shared shard lock.
+        mutable std::atomic<double> eviction_priority{0};
 
         void AddReplicas(std::vector<Replica>&& replicas) {
             replicas_.insert(replicas_.end(),
                              std::move_iterator(replicas.begin()),
                              std::move_iterator(replicas.end()));
+            Recharge();
         }
 
         std::vector<Replica> PopReplicas(
@@ -484,12 +882,18 @@ class MasterService {
                 std::move(partition_point, replicas_.end(),
                           std::back_inserter(popped_replicas));
                 replicas_.erase(partition_point, replicas_.end());
+                Recharge();
             }
 
             return popped_replicas;
         }
 
-        std::vector<Replica> PopReplicas() { return std::move(replicas_); }
+        std::vector<Replica> PopReplicas() {
+            std::vector<Replica> popped_replicas;
+            popped_replicas.swap(replicas_);
+            Recharge();
+            return popped_replicas;
+        }
 
         size_t EraseReplicas(
             const std::function<bool(const Replica&)>& pred_fn) {
@@ -555,6 +959,13 @@ class MasterService {
             return it != replicas_.end() ? &(*it) : nullptr;
         }
 
+        const Replica* GetFirstReplica(
+            const std::function<bool(const Replica&)>& pred_fn) const {
+            const auto it =
+                std::find_if(replicas_.begin(), replicas_.end(), pred_fn);
+            return it != replicas_.end() ? &(*it) : nullptr;
+        }
+
         Replica* GetReplicaByID(const ReplicaID& id) {
             return GetFirstReplica(
                 [&id](const Replica& replica) { return replica.id() == id; });
@@ -568,54 +979,83 @@ class MasterService {
 
         Replica* GetReplicaBySegmentName(const std::string& segment_name) {
             return GetFirstReplica([&segment_name](const Replica& replica) {
-                auto names = replica.get_segment_names();
-                for (auto& name_opt : names) {
-                    if (name_opt == segment_name) {
-                        return true;
-                    }
-                }
-                return false;
+                return replica.is_in_segment(segment_name);
             });
         }
 
-        // Grant a lease with timeout as now() + ttl, only update if the new
-        // timeout is larger
-        void GrantLease(const uint64_t ttl, const uint64_t soft_ttl) const {
-            SpinLocker locker(&lock);
-            std::chrono::steady_clock::time_point now =
-                std::chrono::steady_clock::now();
-            lease_timeout =
-                std::max(lease_timeout, now + std::chrono::milliseconds(ttl));
-            if (soft_pin_timeout) {
-                soft_pin_timeout =
-                    std::max(*soft_pin_timeout,
-                             now + std::chrono::milliseconds(soft_ttl));
+        // Grant a lease with timeout as now + ttl, only update if the new
+        // timeout is larger. Batches pass a single now for all their keys.
+        void GrantLease(const uint64_t ttl, const uint64_t soft_ttl,
+                        const std::chrono::steady_clock::time_point now =
+                            std::chrono::steady_clock::now()) const {
+            ExtendTimeout(lease_timeout, now + std::chrono::milliseconds(ttl));
+            if (has_soft_pin) {
+                ExtendTimeout(soft_pin_timeout,
+                              now + std::chrono::milliseconds(soft_ttl));
             }
         }
 
+        // Record an access in the given heat epoch and return the heat
+        uint32_t RecordAccess(uint32_t epoch) const {
+            uint64_t packed = heat.load(std::memory_order_relaxed);
+            uint32_t count;
+            do {
+                count = DecayedAccessCount(packed, epoch);
+                if (count < std::numeric_limits<uint32_t>::max()) {
+                    ++count;
+                }
+            } while (!heat.compare_exchange_weak(
+                packed, PackHeat(epoch, count), std::memory_order_relaxed));
+            return count;
+        }
+
+        uint32_t GetAccessCount(uint32_t epoch) const {
+            return DecayedAccessCount(heat.load(std::memory_order_relaxed),
+                                      epoch);
+        }
+
+        void ResetAccessCount() const {
+            heat.store(0, std::memory_order_relaxed);
+        }
+
+        // Record a read in the given second and return the reads within it
+        uint32_t RecordRead(uint32_t second) const {
+            uint64_t packed = reads_per_second.load(std::memory_order_relaxed);
+            uint32_t count;
+            do {
+                count = static_cast<uint32_t>(packed >> 32) == second
+                            ? static_cast<uint32_t>(packed)
+                            : 0;
+                if (count < std::numeric_limits<uint32_t>::max()) {
+                    ++count;
+                }
+            } while (!reads_per_second.compare_exchange_weak(
+                packed, PackHeat(second, count), std::memory_order_relaxed));
+            return count;
+        }
+
         // Check if the lease has expired
         bool IsLeaseExpired() const {
-            SpinLocker locker(&lock);
-            return std::chrono::steady_clock::now() >= lease_timeout;
+            return std::chrono::steady_clock::now() >=
+                   lease_timeout.load(std::memory_order_relaxed);
         }
 
         // Check if the lease has expired
         bool IsLeaseExpired(std::chrono::steady_clock::time_point& now) const {
-            SpinLocker locker(&lock);
-            return now >= lease_timeout;
+            return now >= lease_timeout.load(std::memory_order_relaxed);
         }
 
         // Check if is in soft pin status
         bool IsSoftPinned() const {
-            SpinLocker locker(&lock);
-            return soft_pin_timeout &&
-                   std::chrono::steady_clock::now() < *soft_pin_timeout;
+            return has_soft_pin &&
+                   std::chrono::steady_clock::now() <
+                       soft_pin_timeout.load(std::memory_order_relaxed);
         }
 
         // Check if is in soft pin status
         bool IsSoftPinned(std::chrono::steady_clock::time_point& now) const {
-            SpinLocker locker(&lock);
-            return soft_pin_timeout && now < *soft_pin_timeout;
+            return has_soft_pin &&
+                   now < soft_pin_timeout.load(std::memory_order_relaxed);
         }
 
         // Check if the metadata is valid
@@ -642,41 +1082,90 @@ class MasterService {
         }
 
        private:
+        // Charge the tenant for the memory replicas held now
+        void Recharge() {
+            if (!tenant) {
+                return;
+            }
+            const uint64_t bytes =
+                size * CountReplicas([](const Replica& replica) {
+                    return replica.is_memory_replica();
+                });
+            tenant->Charge(static_cast<int64_t>(bytes) -
+                           static_cast<int64_t>(charged_bytes_));
+            charged_bytes_ = bytes;
+        }
+
+        // Max-CAS, the shard mutex orders it with the eviction of the object
+        static void ExtendTimeout(
+            std::atomic<std::chrono::steady_clock::time_point>& timeout,
+            const std::chrono::steady_clock::time_point deadline) {
+            auto current = timeout.load(std::memory_order_relaxed);
+            while (current < deadline &&
+                   !timeout.compare_exchange_weak(current, deadline,
+                                                  std::memory_order_relaxed)) {
+            }
+        }
+
+        static uint64_t PackHeat(uint32_t epoch, uint32_t count) {
+            return (static_cast<uint64_t>(epoch) << 32) | count;
+        }
+
+        // Halve the heat once for every epoch since its last update
+        static uint32_t DecayedAccessCount(uint64_t packed, uint32_t epoch) {
+            const uint32_t last_epoch = static_cast<uint32_t>(packed >> 32);
+            const uint32_t count = static_cast<uint32_t>(packed);
+            const uint32_t passed = epoch - last_epoch;
+            return passed >= 32 ? 0 : count >> passed;
+        }
+
         // Use the accessors to visit and modify the replicas.
         std::vector<Replica> replicas_;
-    };
-
-    struct ReplicationTask {
-        UUID client_id;
-        std::chrono::steady_clock::time_point start_time;
-        enum class Type {
-            COPY,
-            MOVE,
-        } type;
-        ReplicaID source_id;
-        std::vector<ReplicaID> replica_ids;
+        uint64_t charged_bytes_{0};  // Guarded by the shard mutex
     };
 
     static constexpr size_t kNumShards = 1024;  // Number of metadata shards
 
+    using ObjectMetadataMap = ObjectMap<ObjectMetadata>;
+
     // Sharded metadata maps and their mutexes
     struct MetadataShard {
         mutable SharedMutex mutex;
-        std::unordered_map<std::string, ObjectMetadata> metadata
-            GUARDED_BY(mutex);
-        std::unordered_set<std::string> processing_keys GUARDED_BY(mutex);
-        std::unordered_map<std::string, const ReplicationTask> replication_tasks
+        ObjectMetadataMap metadata GUARDED_BY(mutex);
+        // Segment generation up to which the shard has been swept, i.e. it
+        // holds no replicas on segments unmounted before this generation
+        uint64_t swept_generation GUARDED_BY(mutex){0};
+        // Deduplicated keys of the shard and the content key holding their
+        // replicas. They have no metadata of their own.
+        std::unordered_map<std::string, std::string> dedup_aliases
             GUARDED_BY(mutex);
     };
+
+    // Track the object while it has an in-flight operation
+    static void UpdateTracking(ObjectMetadataMap& metadata,
+                               ObjectMetadataMap::iterator it) {
+        if (it->second.in_processing || it->second.replication_task) {
+            metadata.Track(it);
+        } else {
+            metadata.Untrack(it);
+        }
+    }
+    // Declared before the metadata, which is charged to the tenants until
+    // it is destroyed
+    TenantRegistry tenants_;
     std::array<MetadataShard, kNumShards> metadata_shards_;
 
+    static void ObserveShardLockWait(int64_t wait_us) {
+        MasterMetricManager::instance().observe_shard_lock_wait(wait_us);
+    }
+
     // For accessing a metadata shard with read-write permission
     class MetadataShardAccessorRW {
        public:
         MetadataShardAccessorRW(MasterService* master_service,
                                 size_t shard_index)
             : shard_(master_service->metadata_shards_[shard_index]),
-              lock_(&shard_.mutex) {}
+              lock_(&shard_.mutex, &ObserveShardLockWait) {}
 
         MetadataShard* operator->() { return &shard_; }
 
@@ -693,7 +1182,7 @@ class MasterService {
         MetadataShardAccessorRO(const MasterService* master_service,
                                 size_t shard_index)
             : shard_(master_service->metadata_shards_[shard_index]),
-              lock_(&shard_.mutex, shared_lock) {}
+              lock_(&shard_.mutex, shared_lock, &ObserveShardLockWait) {}
 
         const MetadataShard* operator->() const { return &shard_; }
 
@@ -707,9 +1196,108 @@ class MasterService {
         return std::hash<std::string>{}(key) % kNumShards;
     }
 
+    // Visit the keys grouped by metadata shard, holding each shard lock
+    // once. Missing or invalid objects are visited with a null metadata.
+    void VisitKeysByShard(
+        const std::vector<std::string>& keys,
+        const std::function<void(size_t key_idx, size_t shard_idx,
+                                 const ObjectMetadata* metadata)>& visit_fn)
+        const;
+
+    // ExistKey of a valid object, the caller holds its shard lock
+    bool IsCompletedObject(const ObjectMetadata& metadata,
+                           std::chrono::steady_clock::time_point now) const;
+
+    // GetReplicaList of a valid object, the caller holds its shard lock
+    auto GetReplicaList(const std::string& key, const ObjectMetadata& metadata,
+                        size_t shard_idx,
+                        std::chrono::steady_clock::time_point now)
+        -> tl::expected<GetReplicaListResponse, ErrorCode>;
+
+    // Count reads as hits or misses of the tenants of the keys
+    void RecordTenantRead(
+        const std::string& key,
+        const tl::expected<GetReplicaListResponse, ErrorCode>& result) const;
+    void RecordTenantReads(
+        const std::vector<std::string>& keys,
+        const std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>&
+            results) const;
+
+    // Allocate the replicas of a new object, memory replicas per config
+    // plus a disk replica if enabled. Memory replicas are spread over
+    // failure domains, the first in the one of the client if possible.
+    auto AllocateReplicas(const UUID& client_id, const std::string& key,
+                          uint64_t slice_length, const ReplicateConfig& config)
+        -> tl::expected<std::vector<Replica>, ErrorCode>;
+
+    // Deduplicated puts store their content under an internal key derived
+    // from the content hash, and their own keys become aliases of it in
+    // the dedup_aliases of their shards. dedup_refs_ counts the aliases of
+    // each content key, which is removed with its last alias. A shard lock
+    // may be held while taking dedup_mutex_, but no other shard is locked
+    // while holding one, so alias and content are updated one after the
+    // other.
+    static bool IsDedupContentKey(const std::string& key) {
+        return key.starts_with(kDedupKeyPrefix);
+    }
+
+    // With the shard of key locked, make way for a new put of key: drop a
+    // PutStart of it that expired before completing any replica, or fail
+    // with OBJECT_ALREADY_EXISTS
+    auto PrepareNewPut(MetadataShardAccessorRW& shard, const std::string& key,
+                       std::chrono::steady_clock::time_point now)
+        -> tl::expected<void, ErrorCode>;
+
+    // With the shard of key locked, add the metadata of a put of key whose
+    // replicas are being written
+    void InsertNewPut(MetadataShardAccessorRW& shard, const UUID& client_id,
+                      const std::string& key, uint64_t size,
+                      std::vector<Replica>&& replicas,
+                      const ReplicateConfig& config,
+                      std::chrono::steady_clock::time_point now);
+
+    // PutStart of a put carrying a content hash. Returns nullopt if the put
+    // has to be stored by itself: its key is taken, or content with the hash
+    // is being written or has another size. Returns an empty replica list
+    // if the content is already stored.
+    auto DedupPutStart(const UUID& client_id, const std::string& key,
+                       uint64_t slice_length, const ReplicateConfig& config)
+        -> std::optional<
+            tl::expected<std::vector<Replica::Descriptor>, ErrorCode>>;
+
+    // The content key key is an alias of, or an empty string
+    std::string ResolveDedupAlias(const std::string& key) const;
+
+    // Remove the alias key, only if it refers to content_key unless that is
+    // empty. Returns the content key of the removed alias, or an empty
+    // string. The caller then releases the reference of the alias.
+    std::string RemoveDedupAlias(const std::string& key,
+                                 const std::string& content_key = "");
+
+    // Remove the aliases of a shard whose keys satisfy pred, appending their
+    // content keys. The caller then releases their references.
+    static void TakeDedupAliases(
+        MetadataShardAccessorRW& shard,
+        const std::function<bool(const std::string& key)>& pred,
+        std::vector<std::string>& content_keys);
+
+    // Drop the alias key if its content is gone, so that it can be put again
+    void DropStaleDedupAlias(const std::string& key);
+
+    // Drop a reference to content_key, and remove the content with the last
+    // one unless it is being read or written, then eviction frees it.
+    void ReleaseDedupReference(const std::string& content_key, bool force);
+
     // Helper to clean up stale handles pointing to unmounted segments
     bool CleanupStaleHandles(ObjectMetadata& metadata);
 
+    // Whether the objects of a shard may still hold replicas on unmounted
+    // segments, checked in O(1). The caller must hold the shard lock.
+    bool MayHaveStaleHandles(size_t shard_idx) const NO_THREAD_SAFETY_ANALYSIS {
+        return metadata_shards_[shard_idx].swept_generation !=
+               segment_generation_.load(std::memory_order_acquire);
+    }
+
     /**
      * @brief Helper to discard expired processing keys.
      */
@@ -717,6 +1305,79 @@ class MasterService {
         MetadataShardAccessorRW& shard,
         const std::chrono::steady_clock::time_point& now);
 
+    // Sample objects from one shard and evict up to max_evict_num of them.
+    // Returns the number of evicted objects and adds the freed memory size
+    // to freed_size.
+    long EvictSampledFromShard(MetadataShardAccessorRW& shard,
+                               std::chrono::steady_clock::time_point& now,
+                               bool allow_soft_pinned, long max_evict_num,
+                               uint64_t& freed_size);
+
+    // Serialize the objects of a shard into a snapshot section. Lease
+    // timeouts are stored relative to now. The caller must hold the shard
+    // lock.
+    template <typename T>
+    void SerializeShardTo(T& serializer, const MetadataShard& shard,
+                          const AllocatorIndex& allocator_index,
+                          const std::chrono::steady_clock::time_point& now)
+        const NO_THREAD_SAFETY_ANALYSIS;
+
+    // Restore the objects of a snapshot section into shard and return the
+    // number of restored objects. Throws on corrupted data.
+    size_t DeserializeShard(
+        SerializerReader& reader, MetadataShardAccessorRW& shard,
+        const std::vector<std::shared_ptr<OffsetBufferAllocator>>& allocators);
+
+    // Periodically writes snapshots to snapshot_path_
+    void SnapshotThreadFunc();
+
+    // Periodically runs DefragmentSegments() while the request rate is low
+    void DefragThreadFunc();
+
+    // Take a consistent cut of the metadata into the sections of a snapshot.
+    // next_sequence_id is the first operation log entry not reflected in it.
+    auto CaptureSnapshot(std::vector<std::vector<SerializedByte>>& sections,
+                         size_t& num_objects, uint64_t& next_sequence_id)
+        -> tl::expected<void, ErrorCode>;
+
+    // Restore the metadata from a snapshot image in memory. source is only
+    // used for logging.
+    auto RestoreSnapshot(const uint8_t* base, size_t size,
+                         const std::string& source)
+        -> tl::expected<size_t, ErrorCode>;
+
+    // Drop all objects and unmount the segments of client_ids.
+    void ResetMetadata(const std::vector<UUID>& client_ids);
+
+    // Expire the clients and unmount their segments
+    void ExpireClients(const std::vector<UUID>& expired_clients);
+
+    // Release the unused slots of the put leases that expired, or of all the
+    // leases of the given clients
+    void SweepPutLeases(std::chrono::steady_clock::time_point now);
+    void ReleaseClientPutLeases(const std::vector<UUID>& client_ids);
+
+    bool IsOpLogEnabled() const { return oplog_ != nullptr && !standby_; }
+
+    // Record the completed replicas of an object in the operation log.
+    // metadata is nullptr, or has no completed replica, if the object is
+    // gone. In that case remove_type is recorded.
+    void LogObject(const std::string& key, const ObjectMetadata* metadata,
+                   OpLogType remove_type = OpLogType::REMOVE_OBJECT);
+
+    // Memory allocators of a standby master by segment name
+    using StandbyAllocatorMap = std::unordered_map<
+        std::string, std::vector<std::shared_ptr<OffsetBufferAllocator>>>;
+
+    // Apply an object entry of the operation log. The caller must hold the
+    // lock of the object's shard.
+    void ApplyObjectEntry(MetadataShardAccessorRW& shard,
+                          const OpLogEntry& entry,
+                          const StandbyAllocatorMap& allocators);
+
+    // Apply object entries shard-parallel
+    void ApplyObjectEntries(const std::vector<const OpLogEntry*>& entries);
+
     /**
      * @brief Helper to release space of expired discarded replicas.
      * @return Number of released objects that have memory replicas
@@ -727,19 +1388,138 @@ class MasterService {
     // Eviction thread function
     void EvictionThreadFunc();
 
+    // Order of eviction candidates, lowest first: the lease timeout, or the
+    // priority with cost aware eviction
+    double EvictionRank(const ObjectMetadata& metadata) const;
+    void UpdateEvictionPriority(const ObjectMetadata& metadata,
+                                uint32_t frequency) const;
+    // Called for every evicted object
+    void AdvanceEvictionClock(const ObjectMetadata& metadata);
+
+    // Adds the key to the wheel of its shard group, called with the shard
+    // locked
+    void ScheduleExpiry(const std::string& key,
+                        std::chrono::steady_clock::time_point expire_time);
+    // Removes the objects whose TTL ran out, rescheduling those that are
+    // read or replicated
+    void ExpireObjects(const std::vector<std::string>& keys);
+    void TtlThreadFunc();
+
     tl::expected<void, ErrorCode> PushOffloadingQueue(const std::string& key,
                                                       const Replica& replica);
 
+    // Heat driven demotion of an eviction victim. A victim at least
+    // tiering_demote_access_count_ hot and without disk replica is queued
+    // for offloading to the local disk of its owner. Returns true if its
+    // memory replicas must be kept until the offload completes or times out.
+    bool DemoteBeforeEvict(const std::string& key, ObjectMetadata& metadata,
+                           const std::chrono::steady_clock::time_point& now);
+
     // Lease related members
     const uint64_t default_kv_lease_ttl_;     // in milliseconds
     const uint64_t default_kv_soft_pin_ttl_;  // in milliseconds
     const bool allow_evict_soft_pinned_objects_;
 
+    // Keep the keys of every shard sorted, so that regex queries with a
+    // literal prefix only visit the keys starting with it
+    const bool enable_prefix_index_;
+
     // Eviction related members
     std::atomic<bool> need_eviction_{
         false};  // Set to trigger eviction when not enough space left
     const double eviction_ratio_;                 // in range [0.0, 1.0]
     const double eviction_high_watermark_ratio_;  // in range [0.0, 1.0]
+    const uint32_t eviction_sample_size_;  // 0 means full-scan BatchEvict
+    const uint32_t eviction_shards_per_tick_;
+    // GreedyDual-Size-Frequency eviction: objects go in order of their
+    // priority, the clock when last put or read plus their accesses times
+    // their cost per byte. The clock is the highest priority evicted yet.
+    const bool enable_cost_aware_eviction_;
+    std::atomic<double> eviction_clock_{0};
+    // Evict from the pressured segments instead of by the global ratio
+    const bool enable_segment_pressure_eviction_;
+
+    // Heat driven tiering between memory and disk, 0 disables each of
+    // them. The heat epoch is advanced by every finished eviction pass.
+    const uint32_t tiering_demote_access_count_;
+    const uint32_t tiering_promote_disk_reads_;
+    std::atomic<uint32_t> heat_epoch_{0};
+    // Demotions not completed in time are given up and the victim evicted
+    static constexpr auto kDemotionTimeout = std::chrono::seconds(60);
+
+    // Heat driven promotion from CXL memory to DRAM, 0 disables it
+    const uint32_t cxl_promote_access_count_;
+    static constexpr size_t kMaxCxlPromotionQueueSize = 4096;
+    std::mutex cxl_promotion_mutex_;
+    std::unordered_set<std::string> cxl_promotion_queue_
+        GUARDED_BY(cxl_promotion_mutex_);
+
+    // Read rate driven replication of hot objects, 0 disables it
+    const uint32_t hot_replica_read_rate_;
+    const uint32_t hot_replica_max_replicas_;
+    const std::chrono::seconds hot_replica_cooldown_;
+    static constexpr size_t kMaxHotReplicaQueueSize = 4096;
+    std::mutex hot_replica_mutex_;
+    std::unordered_set<std::string> hot_replica_queue_
+        GUARDED_BY(hot_replica_mutex_);
+    // Objects given replicas for being hot
+    struct HotObject {
+        // Tells apart a later object under the same key
+        std::chrono::steady_clock::time_point put_start_time;
+        std::chrono::steady_clock::time_point last_hot;
+        // Segments the added replicas were copied to
+        std::vector<std::string> targets;
+    };
+    std::mutex hot_objects_mutex_;  // Serializes ReplicateHotObjects()
+    std::unordered_map<std::string, HotObject> hot_objects_
+        GUARDED_BY(hot_objects_mutex_);
+
+    // Rebalancing towards newly mounted segments, 0 disables it
+    const uint32_t rebalance_bandwidth_mb_;
+    static constexpr double kRebalanceSlack = 0.05;
+    static constexpr size_t kRebalanceShardsPerTick = 64;
+    static constexpr size_t kMaxRebalanceMovesPerTick = 256;
+    std::mutex rebalance_mutex_;
+    std::unordered_set<std::string> rebalance_targets_
+        GUARDED_BY(rebalance_mutex_);
+    // Only used by the eviction thread: a token bucket of bytes to move,
+    // and the moves submitted but not done, counted as done when weighing
+    // the segments until they time out
+    struct RebalanceMove {
+        std::chrono::steady_clock::time_point submit_time;
+        std::string source;
+        std::string target;
+        uint64_t size;
+    };
+    static constexpr auto kRebalanceMoveTimeout = std::chrono::seconds(60);
+    double rebalance_budget_{0};
+    std::chrono::steady_clock::time_point rebalance_refill_time_;
+    size_t rebalance_shard_cursor_{0};
+    std::unordered_map<std::string, RebalanceMove> rebalance_moves_;
+
+    // Content-addressed deduplication of puts carrying a content hash
+    static constexpr std::string_view kDedupKeyPrefix = "__mooncake_dedup__/";
+    const bool enable_dedup_;
+    std::mutex dedup_mutex_;
+    // Number of aliases of each content key
+    std::unordered_map<std::string, size_t> dedup_refs_
+        GUARDED_BY(dedup_mutex_);
+
+    // State of the ongoing incremental eviction pass. Only accessed by the
+    // eviction thread.
+    struct SampledEvictionPass {
+        bool active{false};
+        bool allow_soft_pinned{false};
+        long target_evict_num{0};
+        long lowerbound_evict_num{0};
+        long evicted_count{0};
+        long sweep_evicted_count{0};  // evicted in the current sweep
+        uint64_t freed_size{0};
+        size_t visited_shards{0};  // visited in the current sweep
+        std::chrono::steady_clock::time_point start_time;
+    };
+    SampledEvictionPass sampled_eviction_pass_;
+    size_t eviction_shard_cursor_{0};
 
     // Eviction thread related members
     std::thread eviction_thread_;
@@ -747,6 +1527,29 @@ class MasterService {
     static constexpr uint64_t kEvictionThreadSleepMs =
         10;  // 10 ms sleep between eviction checks
 
+    // TTL expiry, one timing wheel per group of shards so that puts to
+    // different groups do not contend. Ticks are steady clock milliseconds
+    // divided by kTtlTickMs.
+    static constexpr uint64_t kTtlTickMs = 100;
+    static constexpr size_t kTtlWheelGroups = 16;
+    // Delay before retrying the expiry of an object still being written
+    static constexpr uint64_t kTtlRetryMs = 1000;
+    struct TtlWheel {
+        std::mutex mutex;
+        TimingWheel wheel GUARDED_BY(mutex);
+    };
+    std::array<TtlWheel, kTtlWheelGroups> ttl_wheels_;
+    std::thread ttl_thread_;
+    std::atomic<bool> ttl_running_{false};
+    std::mutex ttl_thread_mutex_;
+    std::condition_variable ttl_cv_;
+    static uint64_t TtlTick(std::chrono::steady_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   time.time_since_epoch())
+                   .count() /
+               kTtlTickMs;
+    }
+
     // Task cleanup thread related members
     std::thread task_cleanup_thread_;
     std::atomic<bool> task_cleanup_running_{false};
@@ -757,6 +1560,51 @@ class MasterService {
     std::mutex task_cleanup_mutex_;
     std::condition_variable task_cleanup_cv_;
 
+    // WaitTasks requests waiting for a task, stopped with the cleanup thread
+    struct TaskWaiter {
+        size_t batch_size;
+        std::chrono::steady_clock::time_point deadline;
+        FetchTasksCallback done;
+    };
+    static constexpr uint64_t kMaxTaskWaitMs = 5000;
+    std::thread task_waiter_thread_;
+    std::mutex task_waiters_mutex_;
+    std::condition_variable task_waiters_cv_;
+    std::unordered_map<UUID, std::vector<TaskWaiter>, boost::hash<UUID>>
+        task_waiters_;
+
+    // Bumped whenever segments are unmounted, see MetadataShard
+    std::atomic<uint64_t> segment_generation_{0};
+    // Sweep thread related members, the sweep thread clears the objects of
+    // expired clients without blocking the client monitor
+    std::thread sweep_thread_;
+    std::atomic<bool> sweep_running_{false};
+    std::mutex sweep_mutex_;
+    std::condition_variable sweep_cv_;
+    bool sweep_requested_ GUARDED_BY(sweep_mutex_){false};
+
+    // Snapshot thread related members
+    std::thread snapshot_thread_;
+    std::atomic<bool> snapshot_running_{false};
+    std::mutex snapshot_thread_mutex_;
+    std::condition_variable snapshot_cv_;
+    // Serializes concurrent SaveSnapshot calls
+    std::mutex snapshot_mutex_;
+
+    // Defragmentation related members, an interval of 0 disables the thread
+    const uint64_t defrag_interval_sec_;
+    const double defrag_threshold_;  // in range [0.0, 1.0]
+    const uint32_t defrag_max_moves_;
+    const uint64_t defrag_max_request_rate_;  // 0 means no load check
+    // Shards are scanned until this many candidates per move are found
+    static constexpr size_t kDefragCandidatesPerMove = 4;
+    std::mutex defrag_mutex_;  // serializes DefragmentSegments calls
+    size_t defrag_shard_cursor_ GUARDED_BY(defrag_mutex_){0};
+    std::thread defrag_thread_;
+    std::atomic<bool> defrag_running_{false};
+    std::mutex defrag_thread_mutex_;
+    std::condition_variable defrag_cv_;
+
     // Helper class for accessing metadata with automatic locking and cleanup
     class MetadataAccessorRW {
        public:
@@ -765,17 +1613,12 @@ class MasterService {
               key_(key),
               shard_idx_(service_->getShardIndex(key)),
               shard_guard_(service_, shard_idx_),
-              it_(shard_guard_->metadata.find(key)),
-              processing_it_(shard_guard_->processing_keys.find(key)),
-              replication_task_it_(shard_guard_->replication_tasks.find(key)) {
+              it_(shard_guard_->metadata.find(key)) {
             // Automatically clean up invalid handles
-            if (it_ != shard_guard_->metadata.end()) {
+            if (it_ != shard_guard_->metadata.end() &&
+                service_->MayHaveStaleHandles(shard_idx_)) {
                 if (service_->CleanupStaleHandles(it_->second)) {
                     this->Erase();
-
-                    if (processing_it_ != shard_guard_->processing_keys.end()) {
-                        this->EraseFromProcessing();
-                    }
                 }
             }
         }
@@ -786,12 +1629,13 @@ class MasterService {
         }
 
         bool InProcessing() const NO_THREAD_SAFETY_ANALYSIS {
-            return processing_it_ != shard_guard_->processing_keys.end();
+            return it_ != shard_guard_->metadata.end() &&
+                   it_->second.in_processing;
         }
 
         bool HasReplicationTask() const NO_THREAD_SAFETY_ANALYSIS {
-            return replication_task_it_ !=
-                   shard_guard_->replication_tasks.end();
+            return it_ != shard_guard_->metadata.end() &&
+                   it_->second.replication_task.has_value();
         }
 
         MetadataShardAccessorRW& GetShard() NO_THREAD_SAFETY_ANALYSIS {
@@ -802,7 +1646,7 @@ class MasterService {
         ObjectMetadata& Get() NO_THREAD_SAFETY_ANALYSIS { return it_->second; }
 
         const ReplicationTask& GetReplicationTask() NO_THREAD_SAFETY_ANALYSIS {
-            return replication_task_it_->second;
+            return *it_->second.replication_task;
         }
 
         // Delete current metadata (for PutRevoke or Remove operations)
@@ -812,13 +1656,20 @@ class MasterService {
         }
 
         void EraseFromProcessing() NO_THREAD_SAFETY_ANALYSIS {
-            shard_guard_->processing_keys.erase(processing_it_);
-            processing_it_ = shard_guard_->processing_keys.end();
+            it_->second.in_processing = false;
+            UpdateTracking(shard_guard_->metadata, it_);
+        }
+
+        // Only call when Exists() is true and HasReplicationTask() is false
+        void SetReplicationTask(ReplicationTask&& task)
+            NO_THREAD_SAFETY_ANALYSIS {
+            it_->second.replication_task.emplace(std::move(task));
+            UpdateTracking(shard_guard_->metadata, it_);
         }
 
         void EraseReplicationTask() NO_THREAD_SAFETY_ANALYSIS {
-            shard_guard_->replication_tasks.erase(replication_task_it_);
-            replication_task_it_ = shard_guard_->replication_tasks.end();
+            it_->second.replication_task.reset();
+            UpdateTracking(shard_guard_->metadata, it_);
         }
 
         void Create(const UUID& client_id, uint64_t total_length,
@@ -839,10 +1690,7 @@ class MasterService {
         std::string key_;
         size_t shard_idx_;
         MetadataShardAccessorRW shard_guard_;
-        std::unordered_map<std::string, ObjectMetadata>::iterator it_;
-        std::unordered_set<std::string>::iterator processing_it_;
-        std::unordered_map<std::string, const ReplicationTask>::iterator
-            replication_task_it_;
+        ObjectMetadataMap::iterator it_;
     };
 
     class MetadataAccessorRO {
@@ -852,8 +1700,7 @@ class MasterService {
               key_(key),
               shard_idx_(service_->getShardIndex(key)),
               shard_guard_(service_, shard_idx_),
-              it_(shard_guard_->metadata.find(key)),
-              processing_it_(shard_guard_->processing_keys.find(key)) {}
+              it_(shard_guard_->metadata.find(key)) {}
 
         // Check if metadata exists
         bool Exists() const NO_THREAD_SAFETY_ANALYSIS {
@@ -861,7 +1708,8 @@ class MasterService {
         }
 
         bool InProcessing() const NO_THREAD_SAFETY_ANALYSIS {
-            return processing_it_ != shard_guard_->processing_keys.end();
+            return it_ != shard_guard_->metadata.end() &&
+                   it_->second.in_processing;
         }
 
         // Get metadata (only call when Exists() is true)
@@ -878,8 +1726,7 @@ class MasterService {
         const std::string key_;
         const size_t shard_idx_;
         MetadataShardAccessorRO shard_guard_;
-        std::unordered_map<std::string, ObjectMetadata>::const_iterator it_;
-        std::unordered_set<std::string>::const_iterator processing_it_;
+        ObjectMetadataMap::const_iterator it_;
     };
 
     friend class MetadataAccessorRW;
@@ -906,6 +1753,20 @@ class MasterService {
     boost::lockfree::queue<PodUUID> client_ping_queue_{kClientPingQueueSize};
     const int64_t client_live_ttl_sec_;
 
+    // Hashes of the keys of the last kPutNotificationCapacity puts, by
+    // sequence id, read by the pings of clients caching missing keys. Only
+    // kept once a client asked for them.
+    static constexpr size_t kPutNotificationCapacity = 64 * 1024;
+    // More puts since the previous ping of a client are reported truncated
+    static constexpr size_t kMaxPutNotificationsPerPing = 8 * 1024;
+    std::atomic<bool> put_notifications_watched_{false};
+    std::mutex put_notification_mutex_;
+    std::vector<uint64_t> put_notification_hashes_;
+    uint64_t next_put_notification_{1};
+
+    void NotifyPut(const std::string& key);
+    void FillPutNotifications(uint64_t put_sequence_id, PingResponse& response);
+
     // if high availability features enabled
     const bool enable_ha_;
 
@@ -926,11 +1787,15 @@ class MasterService {
     // Segment management
     SegmentManager segment_manager_;
     BufferAllocatorType memory_allocator_type_;
+    // Load reported by client heartbeats, only kept for the load-aware
+    // allocation strategy
+    std::shared_ptr<SegmentLoadTracker> segment_load_tracker_;
     std::shared_ptr<AllocationStrategy> allocation_strategy_;
 
     // Discarded replicas management
     const std::chrono::seconds put_start_discard_timeout_sec_;
     const std::chrono::seconds put_start_release_timeout_sec_;
+    const std::chrono::milliseconds put_lease_ttl_;
     const std::string cxl_path_;
     const size_t cxl_size_;
     bool enable_cxl_;
@@ -960,6 +1825,8 @@ class MasterService {
             return ttl_ <= now;
         }
 
+        const std::vector<Replica>& replicas() const { return replicas_; }
+
        private:
         std::vector<Replica> replicas_;
         std::chrono::steady_clock::time_point ttl_;
@@ -968,10 +1835,39 @@ class MasterService {
     std::mutex discarded_replicas_mutex_;
     std::list<DiscardedReplicas> discarded_replicas_
         GUARDED_BY(discarded_replicas_mutex_);
+
+    // Slots granted by GrantPutLease, each the replicas of one put until
+    // it is reported or the lease released. Released slots are discarded
+    // like expired PutStarts, as the client may still be writing them. No
+    // shard lock is taken while holding put_leases_mutex_.
+    struct PutLeaseState {
+        UUID client_id;
+        uint64_t slice_length;
+        std::chrono::steady_clock::time_point expire_time;
+        std::vector<std::optional<std::vector<Replica>>> slots;
+    };
+    static constexpr uint64_t kMaxPutLeaseSlots = 1024;
+    std::mutex put_leases_mutex_;
+    std::unordered_map<uint64_t, PutLeaseState> put_leases_
+        GUARDED_BY(put_leases_mutex_);
+    uint64_t next_put_lease_id_ GUARDED_BY(put_leases_mutex_) = 1;
+    // Move the unused slots of a lease to discarded_replicas_
+    void DiscardPutLease(PutLeaseState&& lease);
+
     size_t offloading_queue_limit_ = 50000;
 
     // Task manager
     ClientTaskManager task_manager_;
+
+    // Metadata snapshot related members
+    const std::string snapshot_path_;  // empty means snapshot disabled
+    const uint64_t snapshot_interval_sec_;
+
+    // Warm standby related members. oplog_ is only created in HA mode.
+    std::unique_ptr<OpLog> oplog_;
+    std::atomic<bool> standby_{false};
+    // Apply small batches of the operation log without spawning threads.
+    static constexpr size_t kOpLogParallelApplyThreshold = 1024;
 };
 
 }  // namespace mooncake
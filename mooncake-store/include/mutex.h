@@ -2,6 +2,8 @@
 #define THREAD_SAFETY_ANALYSIS_MUTEX_H
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <mutex>
 #include <shared_mutex>
 
@@ -183,6 +185,9 @@ class SCOPED_CAPABILITY MutexLocker {
 struct shared_lock_t {
 } inline constexpr shared_lock = {};
 
+// Called with the time in microseconds a contended lock acquisition waited.
+using LockWaitObserver = void (*)(int64_t wait_us);
+
 // SharedMutexLocker is an RAII class that acquires a shared mutex in its
 // constructor, and releases it in its destructor.
 class SCOPED_CAPABILITY SharedMutexLocker {
@@ -208,6 +213,27 @@ class SCOPED_CAPABILITY SharedMutexLocker {
         }
     }
 
+    // Constructors timing the acquisition. An uncontended acquisition costs
+    // one try_lock and is not reported to on_wait.
+    SharedMutexLocker(SharedMutex* mu, LockWaitObserver on_wait) ACQUIRE(mu)
+        : mut(mu), is_exclusive(true), locked(true) {
+        if (mut && !mut->try_lock()) {
+            const auto start = std::chrono::steady_clock::now();
+            mut->lock();
+            on_wait(ElapsedUs(start));
+        }
+    }
+
+    SharedMutexLocker(SharedMutex* mu, const shared_lock_t&,
+                      LockWaitObserver on_wait) ACQUIRE_SHARED(mu)
+        : mut(mu), is_exclusive(false), locked(true) {
+        if (mut && !mut->try_lock_shared()) {
+            const auto start = std::chrono::steady_clock::now();
+            mut->lock_shared();
+            on_wait(ElapsedUs(start));
+        }
+    }
+
     // Destructor: Automatically release the mutex
     ~SharedMutexLocker() RELEASE() {
         if (locked && mut) {
@@ -265,6 +291,13 @@ class SCOPED_CAPABILITY SharedMutexLocker {
         }
         locked = false;
     }
+
+   private:
+    static int64_t ElapsedUs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+    }
 };
 
 class SCOPED_CAPABILITY SpinLocker {
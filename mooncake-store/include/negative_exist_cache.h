@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mutex.h"
+
+namespace mooncake {
+
+/**
+ * @brief Client-side cache of keys the master reported missing, so that
+ * repeated existence checks of a key that is not there yet, e.g. the next
+ * blocks of a prefix lookup, do not each go to the master.
+ *
+ * Entries are indexed by HashRing::Hash of the key, the form in which the
+ * master reports puts in ping responses. A put of the key through this
+ * client, a put notification or the TTL drops the entry, whichever comes
+ * first; the TTL bounds how long a put missed by all of them is hidden.
+ * When full, the oldest entry is evicted.
+ */
+class NegativeExistCache {
+   public:
+    /**
+     * @brief Construct a NegativeExistCache.
+     * @param capacity Maximum number of cached keys, must be positive.
+     * @param ttl How long a key is reported missing after Add().
+     */
+    NegativeExistCache(size_t capacity, std::chrono::milliseconds ttl);
+
+    /**
+     * @brief Whether the key is cached as missing. An expired entry is
+     * dropped.
+     */
+    bool Contains(const std::string& key);
+
+    /**
+     * @brief Cache the key as missing, renewing its TTL if already cached.
+     */
+    void Add(const std::string& key);
+
+    /**
+     * @brief Drop the entry of a key, if any.
+     */
+    void Invalidate(const std::string& key);
+
+    /**
+     * @brief Drop the entries of the keys with these hashes.
+     */
+    void InvalidateHashes(const std::vector<uint64_t>& hashes);
+
+    /**
+     * @brief Drop all entries.
+     */
+    void Clear();
+
+    size_t Size() const;
+
+   private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+    struct Entry {
+        uint64_t hash;
+        std::string key;
+        TimePoint expires_at;
+    };
+    using EntryList = std::list<Entry>;
+    using Index = std::unordered_map<uint64_t, EntryList::iterator>;
+
+    void EraseLocked(Index::iterator it) REQUIRES(mutex_);
+
+    const size_t capacity_;
+    const std::chrono::milliseconds ttl_;
+
+    mutable Mutex mutex_;
+    EntryList entries_ GUARDED_BY(mutex_);  // most recently added first
+    Index index_ GUARDED_BY(mutex_);
+};
+
+}  // namespace mooncake
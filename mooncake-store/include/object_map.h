@@ -0,0 +1,531 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mooncake {
+
+/**
+ * @brief An open-addressing hash map from string keys to pinned values, used
+ * for the object metadata of the master shards.
+ *
+ * The table follows the SwissTable layout. Every slot has one control byte,
+ * which is either kEmpty, kDeleted or the low 7 bits of the key hash, and a
+ * lookup compares a group of 16 control bytes at once (with SSE2 when
+ * available), so most probes touch a single cache line and at most one key.
+ * The slots point to heap nodes holding the key and the value: values never
+ * move and need not be movable, references stay valid until the entry is
+ * erased, and every key is stored exactly once.
+ *
+ * Entries can also be tracked, i.e. linked into an intrusive list, to visit a
+ * small subset of the map without scanning the whole table. Erasing an entry
+ * untracks it.
+ *
+ * An optional ordered index of the keys can be enabled to look up all the
+ * keys with a given prefix. It costs one tree node per entry and a tree
+ * update on every insertion and erasure.
+ *
+ * Insertions invalidate all iterators, erasures only invalidate iterators to
+ * the erased entry. Not thread-safe.
+ */
+template <typename V>
+class ObjectMap {
+   public:
+    struct value_type {
+        const std::string first;
+        V second;
+
+       protected:
+        template <typename Tuple, size_t... I>
+        value_type(std::string key, Tuple&& args, std::index_sequence<I...>)
+            : first(std::move(key)),
+              second(std::get<I>(std::forward<Tuple>(args))...) {}
+    };
+
+   private:
+    // The hash is not cached in the entry, it is only needed again when the
+    // table is resized.
+    struct Entry : value_type {
+        template <typename... Args>
+        Entry(std::string key, std::tuple<Args...>&& args)
+            : value_type(std::move(key), std::move(args),
+                         std::index_sequence_for<Args...>{}) {}
+
+        Entry* tracked_prev{nullptr};
+        Entry* tracked_next{nullptr};
+    };
+
+    template <bool kConst>
+    class Iterator {
+       public:
+        using map_type =
+            std::conditional_t<kConst, const ObjectMap, ObjectMap>;
+        using reference =
+            std::conditional_t<kConst, const value_type&, value_type&>;
+        using pointer =
+            std::conditional_t<kConst, const value_type*, value_type*>;
+
+        Iterator() = default;
+        Iterator(map_type* map, size_t index) : map_(map), index_(index) {
+            SkipEmpty();
+        }
+        // Allow iterator to const_iterator conversions
+        template <bool kOtherConst,
+                  typename = std::enable_if_t<kConst && !kOtherConst>>
+        Iterator(const Iterator<kOtherConst>& other)
+            : map_(other.map_), index_(other.index_) {}
+
+        reference operator*() const { return *map_->slots_[index_]; }
+        pointer operator->() const { return map_->slots_[index_]; }
+
+        Iterator& operator++() {
+            ++index_;
+            SkipEmpty();
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return index_ == other.index_;
+        }
+        bool operator!=(const Iterator& other) const {
+            return index_ != other.index_;
+        }
+
+       private:
+        friend class ObjectMap;
+        template <bool>
+        friend class Iterator;
+
+        void SkipEmpty() {
+            while (index_ < map_->capacity_ && !IsFull(map_->ctrl_[index_])) {
+                ++index_;
+            }
+        }
+
+        map_type* map_{nullptr};
+        size_t index_{0};
+    };
+
+   public:
+    using key_type = std::string;
+    using mapped_type = V;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    ObjectMap() = default;
+    ~ObjectMap() { DestroyEntries(); }
+
+    ObjectMap(const ObjectMap&) = delete;
+    ObjectMap& operator=(const ObjectMap&) = delete;
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, capacity_); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, capacity_); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    /**
+     * @brief Iterator to the first entry stored at or after the given slot,
+     * for sampling the map from a random position.
+     * @param slot A slot index smaller than capacity().
+     */
+    iterator begin_from(size_t slot) { return iterator(this, slot); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // Number of slots of the table
+    size_t capacity() const { return capacity_; }
+
+    iterator find(const std::string& key) {
+        return iterator(this, FindIndex(key, Hash(key)));
+    }
+    const_iterator find(const std::string& key) const {
+        return const_iterator(this, FindIndex(key, Hash(key)));
+    }
+    bool contains(const std::string& key) const {
+        return FindIndex(key, Hash(key)) != capacity_;
+    }
+
+    /**
+     * @brief Keep the keys sorted from now on, so that FindPrefix does not
+     * scan the table. No-op if already enabled.
+     */
+    void EnableOrderedKeys() {
+        if (ordered_keys_) {
+            return;
+        }
+        ordered_keys_ = std::make_unique<OrderedKeys>();
+        for (const auto& [key, value] : *this) {
+            ordered_keys_->insert(key);
+        }
+    }
+
+    bool HasOrderedKeys() const { return ordered_keys_ != nullptr; }
+
+    /**
+     * @brief Entries whose key starts with the prefix, in key order if the
+     * ordered index is enabled and in table order otherwise.
+     */
+    std::vector<iterator> FindPrefix(std::string_view prefix) {
+        return FindPrefix<iterator>(this, prefix);
+    }
+    std::vector<const_iterator> FindPrefix(std::string_view prefix) const {
+        return FindPrefix<const_iterator>(this, prefix);
+    }
+
+    /**
+     * @brief Construct an entry in place if the key does not exist, with the
+     * same interface as std::unordered_map::emplace.
+     * @return The entry of the key and whether it was inserted.
+     */
+    template <typename... KeyArgs, typename... Args>
+    std::pair<iterator, bool> emplace(std::piecewise_construct_t,
+                                      std::tuple<KeyArgs...> key_args,
+                                      std::tuple<Args...> args) {
+        std::string key = std::make_from_tuple<std::string>(key_args);
+        const size_t hash = Hash(key);
+        const size_t found = FindIndex(key, hash);
+        if (found != capacity_) {
+            return {iterator(this, found), false};
+        }
+        // The entry is constructed before the slot is claimed, so the map is
+        // left untouched if the constructor throws.
+        auto entry = std::make_unique<Entry>(std::move(key), std::move(args));
+        if (ordered_keys_) {
+            ordered_keys_->insert(entry->first);
+        }
+        const size_t index = PrepareInsert(hash);
+        slots_[index] = entry.release();
+        return {iterator(this, index), true};
+    }
+
+    /**
+     * @brief Erase the entry the iterator points to.
+     * @return Iterator to the entry after the erased one.
+     */
+    iterator erase(iterator it) {
+        EraseIndex(it.index_);
+        ++it;
+        return it;
+    }
+
+    size_t erase(const std::string& key) {
+        const size_t index = FindIndex(key, Hash(key));
+        if (index == capacity_) {
+            return 0;
+        }
+        EraseIndex(index);
+        return 1;
+    }
+
+    void clear() {
+        DestroyEntries();
+        ctrl_.reset();
+        slots_.reset();
+        capacity_ = 0;
+        size_ = 0;
+        growth_left_ = 0;
+        tracked_head_ = nullptr;
+        tracked_size_ = 0;
+        if (ordered_keys_) {
+            ordered_keys_->clear();
+        }
+    }
+
+    /**
+     * @brief Link the entry into the tracked list. No-op if already tracked.
+     */
+    void Track(iterator it) {
+        Entry* entry = slots_[it.index_];
+        if (IsTracked(entry)) {
+            return;
+        }
+        entry->tracked_prev = nullptr;
+        entry->tracked_next = tracked_head_;
+        if (tracked_head_ != nullptr) {
+            tracked_head_->tracked_prev = entry;
+        }
+        tracked_head_ = entry;
+        tracked_size_++;
+    }
+
+    /**
+     * @brief Unlink the entry from the tracked list. No-op if not tracked.
+     */
+    void Untrack(iterator it) { Untrack(slots_[it.index_]); }
+
+    bool IsTracked(const_iterator it) const {
+        return IsTracked(slots_[it.index_]);
+    }
+
+    size_t tracked_size() const { return tracked_size_; }
+
+    /**
+     * @brief Keys of the tracked entries. The pointers stay valid until the
+     * corresponding entries are erased.
+     */
+    std::vector<const std::string*> TrackedKeys() const {
+        std::vector<const std::string*> keys;
+        keys.reserve(tracked_size_);
+        for (const Entry* entry = tracked_head_; entry != nullptr;
+             entry = entry->tracked_next) {
+            keys.push_back(&entry->first);
+        }
+        return keys;
+    }
+
+   private:
+    static constexpr size_t kGroupWidth = 16;
+    static constexpr int8_t kEmpty = -128;   // 0b10000000
+    static constexpr int8_t kDeleted = -2;   // 0b11111110
+    // Full slots store the low 7 bits of the hash, so they are non-negative.
+    static bool IsFull(int8_t ctrl) { return ctrl >= 0; }
+
+    // Views into the keys of the entries
+    using OrderedKeys = std::set<std::string_view, std::less<>>;
+
+    static size_t Hash(std::string_view key) {
+        // The shard index takes the low bits of std::hash, so the hash is
+        // remixed to spread the keys of one shard over the whole table. The
+        // hash of a string_view equals the hash of the same std::string.
+        uint64_t hash = std::hash<std::string_view>{}(key);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return static_cast<size_t>(hash);
+    }
+    static int8_t H2(size_t hash) { return static_cast<int8_t>(hash & 0x7f); }
+    static size_t H1(size_t hash) { return hash >> 7; }
+
+    // Bitmask of the matching control bytes in a group
+    class Group {
+       public:
+        explicit Group(const int8_t* ctrl) {
+#if defined(__SSE2__)
+            ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+            std::memcpy(ctrl_, ctrl, kGroupWidth);
+#endif
+        }
+
+        uint32_t Match(int8_t h2) const {
+#if defined(__SSE2__)
+            return static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kGroupWidth; ++i) {
+                mask |= static_cast<uint32_t>(ctrl_[i] == h2) << i;
+            }
+            return mask;
+#endif
+        }
+
+        uint32_t MatchEmpty() const { return Match(kEmpty); }
+
+        uint32_t MatchEmptyOrDeleted() const {
+#if defined(__SSE2__)
+            // Only kEmpty and kDeleted have the sign bit set.
+            return static_cast<uint32_t>(_mm_movemask_epi8(ctrl_));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kGroupWidth; ++i) {
+                mask |= static_cast<uint32_t>(ctrl_[i] < 0) << i;
+            }
+            return mask;
+#endif
+        }
+
+       private:
+#if defined(__SSE2__)
+        __m128i ctrl_;
+#else
+        int8_t ctrl_[kGroupWidth];
+#endif
+    };
+
+    static int LowestBit(uint32_t mask) { return __builtin_ctz(mask); }
+
+    template <typename It, typename Map>
+    static std::vector<It> FindPrefix(Map* map, std::string_view prefix) {
+        std::vector<It> result;
+        if (!map->ordered_keys_) {
+            for (auto it = map->begin(); it != map->end(); ++it) {
+                if (std::string_view(it->first).starts_with(prefix)) {
+                    result.push_back(it);
+                }
+            }
+            return result;
+        }
+        for (auto key = map->ordered_keys_->lower_bound(prefix);
+             key != map->ordered_keys_->end() && key->starts_with(prefix);
+             ++key) {
+            result.emplace_back(map, map->FindIndex(*key, Hash(*key)));
+        }
+        return result;
+    }
+
+    bool IsTracked(const Entry* entry) const {
+        return entry->tracked_prev != nullptr || tracked_head_ == entry;
+    }
+
+    // Groups are probed quadratically, which visits every group since the
+    // number of groups is a power of two.
+    size_t FindIndex(std::string_view key, size_t hash) const {
+        if (capacity_ == 0) {
+            return capacity_;
+        }
+        const int8_t h2 = H2(hash);
+        const size_t group_mask = capacity_ / kGroupWidth - 1;
+        size_t group = H1(hash) & group_mask;
+        for (size_t probe = 0; probe <= group_mask; ++probe) {
+            const size_t base = group * kGroupWidth;
+            Group g(ctrl_.get() + base);
+            for (uint32_t mask = g.Match(h2); mask != 0; mask &= mask - 1) {
+                const size_t index = base + LowestBit(mask);
+                if (slots_[index]->first == key) {
+                    return index;
+                }
+            }
+            if (g.MatchEmpty() != 0) {
+                return capacity_;
+            }
+            group = (group + probe + 1) & group_mask;
+        }
+        return capacity_;
+    }
+
+    size_t FindFirstNonFull(size_t hash) const {
+        const size_t group_mask = capacity_ / kGroupWidth - 1;
+        size_t group = H1(hash) & group_mask;
+        for (size_t probe = 0;; ++probe) {
+            const size_t base = group * kGroupWidth;
+            const uint32_t mask =
+                Group(ctrl_.get() + base).MatchEmptyOrDeleted();
+            if (mask != 0) {
+                return base + LowestBit(mask);
+            }
+            group = (group + probe + 1) & group_mask;
+        }
+    }
+
+    // Claim a slot for a new entry of the hash, growing the table if needed.
+    size_t PrepareInsert(size_t hash) {
+        if (capacity_ == 0) {
+            Resize(kGroupWidth);
+        }
+        size_t index = FindFirstNonFull(hash);
+        if (growth_left_ == 0 && ctrl_[index] != kDeleted) {
+            // Drop the tombstones in place if they take most of the room.
+            Resize(size_ * 16 <= capacity_ * 7 ? capacity_ : capacity_ * 2);
+            index = FindFirstNonFull(hash);
+        }
+        if (ctrl_[index] == kEmpty) {
+            growth_left_--;
+        }
+        ctrl_[index] = H2(hash);
+        size_++;
+        return index;
+    }
+
+    void Resize(size_t new_capacity) {
+        auto old_ctrl = std::move(ctrl_);
+        auto old_slots = std::move(slots_);
+        const size_t old_capacity = capacity_;
+
+        ctrl_ = std::make_unique<int8_t[]>(new_capacity);
+        std::memset(ctrl_.get(), kEmpty, new_capacity);
+        slots_ = std::make_unique<Entry*[]>(new_capacity);
+        capacity_ = new_capacity;
+        growth_left_ = new_capacity - new_capacity / 8 - size_;
+
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (IsFull(old_ctrl[i])) {
+                Entry* entry = old_slots[i];
+                const size_t hash = Hash(entry->first);
+                const size_t index = FindFirstNonFull(hash);
+                ctrl_[index] = H2(hash);
+                slots_[index] = entry;
+            }
+        }
+    }
+
+    void EraseIndex(size_t index) {
+        Entry* entry = slots_[index];
+        Untrack(entry);
+        if (ordered_keys_) {
+            ordered_keys_->erase(entry->first);
+        }
+        delete entry;
+        slots_[index] = nullptr;
+        size_--;
+        // A lookup only stops at a group with an empty slot, so the slot can
+        // become empty again if its group already has one. Otherwise it must
+        // stay a tombstone to keep the probe sequences through it intact.
+        const size_t base = index / kGroupWidth * kGroupWidth;
+        if (Group(ctrl_.get() + base).MatchEmpty() != 0) {
+            ctrl_[index] = kEmpty;
+            growth_left_++;
+        } else {
+            ctrl_[index] = kDeleted;
+        }
+    }
+
+    void Untrack(Entry* entry) {
+        if (!IsTracked(entry)) {
+            return;
+        }
+        if (entry->tracked_prev != nullptr) {
+            entry->tracked_prev->tracked_next = entry->tracked_next;
+        } else {
+            tracked_head_ = entry->tracked_next;
+        }
+        if (entry->tracked_next != nullptr) {
+            entry->tracked_next->tracked_prev = entry->tracked_prev;
+        }
+        entry->tracked_prev = nullptr;
+        entry->tracked_next = nullptr;
+        tracked_size_--;
+    }
+
+    void DestroyEntries() {
+        for (size_t i = 0; i < capacity_; ++i) {
+            if (IsFull(ctrl_[i])) {
+                delete slots_[i];
+            }
+        }
+    }
+
+    std::unique_ptr<int8_t[]> ctrl_;
+    std::unique_ptr<Entry*[]> slots_;
+    size_t capacity_{0};  // zero or a power of two, at least kGroupWidth
+    size_t size_{0};
+    // Number of empty slots that can be filled before the table grows, it
+    // keeps the load factor including tombstones below 7/8.
+    size_t growth_left_{0};
+    Entry* tracked_head_{nullptr};
+    size_t tracked_size_{0};
+    std::unique_ptr<OrderedKeys> ordered_keys_;
+};
+
+}  // namespace mooncake
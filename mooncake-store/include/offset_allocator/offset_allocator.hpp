@@ -41,6 +41,7 @@ struct OffsetAllocation {
     bool isNoSpace() const { return offset == NO_SPACE; }
 
     friend class __Allocator;
+    friend class OffsetAllocationHandle;
 };
 
 struct OffsetAllocStorageReport {
@@ -89,6 +90,19 @@ class OffsetAllocationHandle {
     // Get size
     uint64_t size() const { return requested_size; }
 
+    // Free bytes directly before and after the allocation, i.e. the size of
+    // the free region that would form if it was released.
+    uint64_t freeNeighborSize() const;
+
+    // Serialize the handle so that it can be re-attached to an allocator
+    // restored by OffsetAllocator::deserialize_from().
+    template <typename T>
+    void serialize_to(T& serializer) const;
+
+    template <typename T>
+    static OffsetAllocationHandle deserialize_from(
+        T& serializer, std::shared_ptr<OffsetAllocator> allocator);
+
    private:
     std::weak_ptr<OffsetAllocator> m_allocator;
     // The offset in m_allocation may not be equal to the real offset.
@@ -106,6 +120,7 @@ struct OffsetAllocatorMetrics {
     uint64_t largest_free_region_;  // Size of largest contiguous free region
     uint64_t total_free_space_;     // Total free space available
     const uint64_t capacity;        // Total capacity of the allocator
+    uint64_t cached_size_ = 0;  // Bytes carved into allocation caches, unused
 };
 
 // Stream output operator for OffsetAllocatorMetrics
@@ -143,6 +158,14 @@ class OffsetAllocator : public std::enable_shared_from_this<OffsetAllocator> {
     // Destructor
     ~OffsetAllocator() = default;
 
+    // Serve allocations of at most max_cached_size bytes from per-thread
+    // caches of pre-carved allocations, holding up to magazine_size of them
+    // per size class. The caches are refilled from and drained to the shared
+    // allocator in batches, so most small allocations and frees do not take
+    // the allocator lock. Must be called before the allocator is used by
+    // other threads. Cached allocations are reported as cached_size_.
+    void enableCache(uint64_t max_cached_size, uint32 magazine_size = 32);
+
     // Allocate memory and return a Handle (thread-safe)
     [[nodiscard]]
     std::optional<OffsetAllocationHandle> allocate(size_t size);
@@ -159,6 +182,21 @@ class OffsetAllocator : public std::enable_shared_from_this<OffsetAllocator> {
     [[nodiscard]]
     OffsetAllocatorMetrics get_metrics() const;
 
+    // Free bytes adjacent to the allocation (thread-safe). Allocations held
+    // by the allocation caches count as used.
+    [[nodiscard]]
+    uint64_t freeNeighborSize(const OffsetAllocation& allocation) const;
+
+    // Reset the allocator so that exactly the given (address, size) buffers
+    // are allocated, and return a handle for each of them in the same order
+    // (thread-safe). Buffers that are out of range, misaligned, overlap a
+    // buffer at a lower address or exceed the node capacity are not allocated
+    // and get std::nullopt. All the handles of this allocator must have been
+    // released before calling this function.
+    [[nodiscard]]
+    std::vector<std::optional<OffsetAllocationHandle>> rebuild(
+        const std::vector<std::pair<uint64_t, uint64_t>>& buffers);
+
     // Serialize the allocator with serializer.
     template <typename T>
     void serialize_to(T& serializer) const;
@@ -172,6 +210,45 @@ class OffsetAllocator : public std::enable_shared_from_this<OffsetAllocator> {
     // Internal method for Handle to free allocation (thread-safe)
     void freeAllocation(const OffsetAllocation& allocation, uint64_t size);
 
+    // A cache of pre-carved allocations, one magazine per size class. Each
+    // thread always uses the same shard, and the shards are spread over
+    // threads round robin.
+    static constexpr uint32 kCacheShards = 16;
+    struct alignas(64) CacheShard {
+        SpinLock lock;
+        std::vector<std::vector<OffsetAllocation>> magazines GUARDED_BY(lock);
+        uint64_t cached_units GUARDED_BY(lock) = 0;
+        // Allocations served or freed through this shard, added to
+        // m_allocated_size and m_allocated_num in metrics
+        int64_t allocated_size GUARDED_BY(lock) = 0;
+        int64_t allocated_num GUARDED_BY(lock) = 0;
+    };
+
+    // Units once the size is scaled down by m_multiplier_bits
+    uint64_t toUnits(uint64_t size) const;
+
+    CacheShard& localCacheShard() const;
+
+    std::optional<OffsetAllocationHandle> allocateCached(size_t size,
+                                                         uint32 units);
+
+    void freeCached(const OffsetAllocation& allocation, uint64_t size,
+                    uint32 units);
+
+    // Carve a batch of allocations of the size class into its magazine
+    bool refillMagazine(CacheShard& shard, uint32 size_class)
+        REQUIRES(shard.lock);
+
+    // Return the cached allocations of every shard to the shared allocator
+    void flushCaches() const;
+
+    struct CacheTotals {
+        int64_t allocated_size = 0;
+        int64_t allocated_num = 0;
+        uint64_t cached_units = 0;
+    };
+    CacheTotals cacheTotals() const;
+
     // Internal method to get metrics without locking (caller must hold m_mutex)
     [[nodiscard]]
     OffsetAllocatorMetrics get_metrics_internal() const REQUIRES(m_mutex);
@@ -185,8 +262,14 @@ class OffsetAllocator : public std::enable_shared_from_this<OffsetAllocator> {
     mutable Mutex m_mutex;
 
     // Lightweight metrics maintained during allocation/deallocation
-    uint64_t m_allocated_size GUARDED_BY(m_mutex) = 0;
-    uint64_t m_allocated_num GUARDED_BY(m_mutex) = 0;
+    // Mutable so that flushCaches() can fold the shard counters in
+    mutable uint64_t m_allocated_size GUARDED_BY(m_mutex) = 0;
+    mutable uint64_t m_allocated_num GUARDED_BY(m_mutex) = 0;
+
+    // Allocation caches, null unless enableCache() was called
+    std::unique_ptr<CacheShard[]> m_cache_shards;
+    uint32 m_cache_max_units = 0;
+    uint32 m_magazine_size = 0;
 
     // Private constructor - use create() factory method instead
     OffsetAllocator(uint64_t base, size_t size, uint32 init_capacity,
@@ -211,7 +294,25 @@ class __Allocator {
     OffsetAllocation allocate(uint32 size);
     void free(OffsetAllocation allocation);
 
+    // Number of units a used node of an allocation of size units occupies.
+    static uint32 allocationUnits(uint32 size);
+
+    // Bin index of the used node of an allocation of size units. All the
+    // allocations of a size class occupy allocationUnits() of it.
+    static uint32 sizeClass(uint32 size);
+
+    // Reset the allocator so that exactly the given (offset, size) nodes are
+    // used. The nodes must be sorted by offset, must not overlap and their
+    // sizes must be allocationUnits() of the allocated sizes. The index of
+    // each used node is returned in node_indices.
+    void rebuild(const std::vector<std::pair<uint32, uint32>>& used_nodes,
+                 std::vector<NodeIndex>& node_indices);
+
+    uint32 maxCapacity() const { return m_max_capacity; }
+
     uint32 allocationSize(OffsetAllocation allocation) const;
+    // Units of the free nodes next to the node of the allocation
+    uint32 freeNeighborSize(OffsetAllocation allocation) const;
     OffsetAllocStorageReport storageReport() const;
     OffsetAllocStorageReportFull storageReportFull() const;
 
@@ -254,6 +355,10 @@ class __Allocator {
 // Template method implementations
 template <typename T>
 void OffsetAllocator::serialize_to(T& serializer) const {
+    // Cached allocations must not be restored as used nodes
+    flushCaches();
+    const CacheTotals totals = cacheTotals();
+
     MutexLocker guard(&m_mutex);
 
     if (!m_allocator) {
@@ -261,12 +366,15 @@ void OffsetAllocator::serialize_to(T& serializer) const {
         return;
     }
 
+    const uint64_t allocated_size = m_allocated_size + totals.allocated_size;
+    const uint64_t allocated_num = m_allocated_num + totals.allocated_num;
+
     // Basic member variables
     serializer.write(&m_base, sizeof(m_base));
     serializer.write(&m_multiplier_bits, sizeof(m_multiplier_bits));
     serializer.write(&m_capacity, sizeof(m_capacity));
-    serializer.write(&m_allocated_size, sizeof(m_allocated_size));
-    serializer.write(&m_allocated_num, sizeof(m_allocated_num));
+    serializer.write(&allocated_size, sizeof(allocated_size));
+    serializer.write(&allocated_num, sizeof(allocated_num));
     // Serialize the allocator
     m_allocator->serialize_to(serializer);
 }
@@ -294,6 +402,34 @@ OffsetAllocator::OffsetAllocator(T& serializer) {
     }
 }
 
+template <typename T>
+void OffsetAllocationHandle::serialize_to(T& serializer) const {
+    serializer.write(&m_allocation.offset, sizeof(m_allocation.offset));
+    serializer.write(&m_allocation.metadata, sizeof(m_allocation.metadata));
+    serializer.write(&real_base, sizeof(real_base));
+    serializer.write(&requested_size, sizeof(requested_size));
+}
+
+template <typename T>
+OffsetAllocationHandle OffsetAllocationHandle::deserialize_from(
+    T& serializer, std::shared_ptr<OffsetAllocator> allocator) {
+    // serializer.read() will throw an exception if the buffer is corrupted.
+    uint32 offset = OffsetAllocation::NO_SPACE;
+    NodeIndex metadata = OffsetAllocation::NO_SPACE;
+    uint64_t base = 0;
+    uint64_t size = 0;
+    serializer.read(&offset, sizeof(offset));
+    serializer.read(&metadata, sizeof(metadata));
+    serializer.read(&base, sizeof(base));
+    serializer.read(&size, sizeof(size));
+    if (offset == OffsetAllocation::NO_SPACE) {
+        throw std::runtime_error("Deserializing invalid OffsetAllocationHandle");
+    }
+    return OffsetAllocationHandle(std::move(allocator),
+                                  OffsetAllocation(offset, metadata), base,
+                                  size);
+}
+
 template <typename T>
 void __Allocator::serialize_to(T& serializer) const {
     if (m_nodes.empty() || m_freeNodes.empty()) {
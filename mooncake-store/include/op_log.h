@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mutex.h"
+#include "replica.h"
+#include "types.h"
+
+namespace mooncake {
+
+/**
+ * @brief Types of the metadata mutations recorded in the operation log
+ */
+enum class OpLogType : uint8_t {
+    UPSERT_OBJECT = 0,  // object created or its completed replicas changed
+    REMOVE_OBJECT,      // object removed by the user
+    EVICT_OBJECT,       // object evicted by the master
+    MOUNT_SEGMENT,
+    REMOUNT_SEGMENTS,
+    UNMOUNT_SEGMENT,
+    MOUNT_LOCAL_DISK_SEGMENT,
+    EXPIRE_CLIENT,  // client ping ttl expired, its segments are unmounted
+};
+
+/**
+ * @brief Location of a completed replica in the operation log. Memory
+ * replicas refer to their buffer by segment name and address, so that a
+ * standby master can attach them to its own allocators.
+ */
+struct OpLogStripe {
+    std::string segment_name;
+    uint64_t address{0};
+    uint64_t size{0};
+};
+YLT_REFL(OpLogStripe, segment_name, address, size);
+
+struct OpLogReplica {
+    ReplicaType type{ReplicaType::MEMORY};
+    std::string segment_name;  // MEMORY
+    uint64_t address{0};       // MEMORY
+    uint64_t size{0};          // buffer size or object size
+    std::string file_path;     // DISK
+    UUID client_id{0, 0};      // LOCAL_DISK
+    std::string transport_endpoint;  // LOCAL_DISK
+    // MEMORY, the stripes after the first one of a striped replica
+    std::vector<OpLogStripe> extra_stripes;
+    uint32_t parity_stripes{0};  // MEMORY
+};
+YLT_REFL(OpLogReplica, type, segment_name, address, size, file_path,
+         client_id, transport_endpoint, extra_stripes, parity_stripes);
+
+/**
+ * @brief One entry of the operation log. Only the fields used by the entry
+ * type are filled.
+ */
+struct OpLogEntry {
+    uint64_t sequence_id{0};
+    OpLogType type{OpLogType::UPSERT_OBJECT};
+    UUID client_id{0, 0};  // object owner or segment owner
+    // Object fields
+    std::string key;
+    uint64_t size{0};
+    bool soft_pin{false};
+    std::vector<OpLogReplica> replicas;
+    std::optional<uint32_t> checksum;
+    // Segment fields
+    std::vector<Segment> segments;
+    UUID segment_id{0, 0};
+    bool enable_offloading{false};
+};
+YLT_REFL(OpLogEntry, sequence_id, type, client_id, key, size, soft_pin,
+         replicas, checksum, segments, segment_id, enable_offloading);
+
+/**
+ * @brief A bounded in-memory log of metadata mutations, read by standby
+ * masters. Entries get consecutive sequence ids starting from 1. When the log
+ * is full the oldest entries are discarded, and a standby that falls behind
+ * them has to bootstrap from a snapshot again.
+ */
+class OpLog {
+   public:
+    explicit OpLog(size_t capacity);
+
+    /**
+     * @brief Append an entry and assign its sequence id.
+     * @return the sequence id of the entry
+     */
+    uint64_t Append(OpLogEntry&& entry);
+
+    /**
+     * @brief Read up to max_entries entries starting from start_sequence_id.
+     * @return ErrorCode::OK on success, even if no entry is available yet,
+     *         ErrorCode::OPLOG_TRUNCATED if start_sequence_id is discarded,
+     *         ErrorCode::INVALID_PARAMS if start_sequence_id is in the future.
+     */
+    ErrorCode Read(uint64_t start_sequence_id, size_t max_entries,
+                   std::vector<OpLogEntry>& entries) const;
+
+    /**
+     * @brief The sequence id that will be assigned to the next entry
+     */
+    uint64_t NextSequenceId() const;
+
+   private:
+    const size_t capacity_;
+    mutable Mutex mutex_;
+    std::deque<OpLogEntry> entries_ GUARDED_BY(mutex_);
+    // Sequence id of entries_.front(), or of the next entry if empty
+    uint64_t first_sequence_id_ GUARDED_BY(mutex_) = 1;
+};
+
+}  // namespace mooncake
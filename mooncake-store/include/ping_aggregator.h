@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ylt/util/tl/expected.hpp>
+
+#include "rpc_types.h"
+#include "types.h"
+
+namespace mooncake {
+
+class MasterClient;
+
+/**
+ * @brief Sends the heartbeats of all the clients of a process pinging the
+ * same master with one BatchPing per round.
+ *
+ * A round is sent every interval with the pings queued since the previous
+ * one, so many clients on a host cost the master one RPC per interval, and
+ * their heartbeats, and the task fetches riding on them, no longer drift
+ * against each other. A caller waits for the round it joined.
+ */
+class PingAggregator {
+   public:
+    using Results = std::vector<tl::expected<BatchPingResponse, ErrorCode>>;
+    using BatchFn =
+        std::function<Results(const std::vector<BatchPingRequest>&)>;
+
+    static constexpr std::chrono::milliseconds kDefaultInterval{1000};
+    static constexpr size_t kDefaultMaxBatch = 1024;
+
+    /**
+     * @brief The aggregator shared by the clients of this process pinging
+     * master_address, created on first use and destroyed with its last user.
+     * Its BatchPing calls use a connection of its own.
+     */
+    static std::shared_ptr<PingAggregator> Get(
+        const std::string& master_address);
+
+    /**
+     * @brief Construct a PingAggregator and start its round thread.
+     * @param batch_fn Batch call returning one result per request, in order.
+     * @param interval Time between the starts of two rounds.
+     * @param max_batch Most requests of one batch call, a round with more is
+     * sent with several calls. Must be positive.
+     */
+    PingAggregator(BatchFn batch_fn, std::chrono::milliseconds interval,
+                   size_t max_batch);
+    ~PingAggregator();
+
+    PingAggregator(const PingAggregator&) = delete;
+    PingAggregator& operator=(const PingAggregator&) = delete;
+
+    /**
+     * @brief Queue a ping for the next round and wait for its answer.
+     * @return ErrorCode::RPC_FAIL if the aggregator stops first
+     */
+    tl::expected<BatchPingResponse, ErrorCode> Ping(BatchPingRequest request);
+
+   private:
+    struct Round {
+        std::vector<BatchPingRequest> requests;
+        Results results;
+        bool done = false;
+    };
+
+    void RoundThreadMain();
+
+    Results Send(const std::vector<BatchPingRequest>& requests);
+
+    const BatchFn batch_fn_;
+    const std::chrono::milliseconds interval_;
+    const size_t max_batch_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    // Round collecting pings, if any
+    std::shared_ptr<Round> open_;
+    bool stopping_ = false;
+    std::thread round_thread_;
+};
+
+}  // namespace mooncake
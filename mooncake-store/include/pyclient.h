@@ -23,6 +23,8 @@ struct ShmRegisterRequest {
     uint64_t dummy_base_addr;
     uint64_t shm_size;
     bool is_local_buffer;
+    // The segment is a ShmRequestRing rather than data
+    bool is_request_ring;
 };
 
 class ClientRequester {
@@ -40,6 +42,15 @@ class ClientRequester {
                              const std::vector<std::string> &keys,
                              const std::vector<int64_t> sizes);
 
+    /**
+     * @brief Releases the buffers of a batch_get_offload_object response on
+     * the remote client once they have been read.
+     * @param client_addr Network address of the remote client.
+     * @param batch_id Id of the batch, from the response.
+     */
+    tl::expected<void, ErrorCode> release_offload_object(
+        const std::string &client_addr, uint64_t batch_id);
+
    private:
     /**
      * @brief A batch of allocated memory buffers, tracking both handles and
@@ -146,9 +157,25 @@ class PyClient {
         const std::vector<std::vector<size_t>> &all_sizes,
         const ReplicateConfig &config = ReplicateConfig{}) = 0;
 
+    virtual int stream_put_start(
+        const std::string &key, const std::vector<uint64_t> &chunk_sizes,
+        const ReplicateConfig &config = ReplicateConfig{}) = 0;
+
+    virtual int stream_put_from(const std::string &key, uint64_t chunk_index,
+                                void *buffer, size_t size) = 0;
+
+    virtual int stream_put_end(const std::string &key) = 0;
+
+    virtual int64_t get_range_into(const std::string &key, uint64_t offset,
+                                   void *buffer, size_t size) = 0;
+
     virtual std::shared_ptr<BufferHandle> get_buffer(
         const std::string &key) = 0;
 
+    virtual std::shared_ptr<BufferHandle> get_ranges_buffer(
+        const std::string &key,
+        const std::vector<std::pair<uint64_t, uint64_t>> &ranges) = 0;
+
     virtual std::tuple<uint64_t, size_t> get_buffer_info(
         const std::string &key) = 0;
 
@@ -164,6 +191,11 @@ class PyClient {
         const std::vector<std::span<const char>> &values,
         const ReplicateConfig &config = ReplicateConfig{}) = 0;
 
+    virtual std::vector<int> batch_put_parts(
+        const std::vector<std::string> &keys,
+        const std::vector<std::vector<std::span<const char>>> &all_parts,
+        const ReplicateConfig &config = ReplicateConfig{}) = 0;
+
     [[nodiscard]] virtual std::string get_hostname() const = 0;
 
     virtual int remove(const std::string &key, bool force = false) = 0;
@@ -177,6 +209,9 @@ class PyClient {
     virtual std::vector<int> batchIsExist(
         const std::vector<std::string> &keys) = 0;
 
+    virtual int64_t batchIsExistPrefix(
+        const std::vector<std::string> &keys) = 0;
+
     virtual int64_t getSize(const std::string &key) = 0;
 
     virtual std::map<std::string, std::vector<Replica::Descriptor>>
@@ -3,6 +3,8 @@
 #include <atomic>
 #include <boost/lockfree/queue.hpp>
 #include <csignal>
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <thread>
@@ -12,9 +14,12 @@
 #include "pyclient.h"
 #include "client_service.h"
 #include "client_buffer.hpp"
+#include "cuda_staging.h"
 #include "mutex.h"
 #include "utils.h"
 #include "rpc_types.h"
+#include "shm_request_ring.h"
+#include "thread_pool.h"
 
 namespace mooncake {
 
@@ -210,6 +215,56 @@ class RealClient : public PyClient {
         const std::vector<std::vector<size_t>> &all_sizes,
         const ReplicateConfig &config = ReplicateConfig{});
 
+    /**
+     * @brief Starts a streaming put, whose chunks become readable with
+     * get_range_into() as they are written, before stream_put_end()
+     * @param key Key of the object
+     * @param chunk_sizes Sizes of the chunks, e.g. one per layer
+     * @param config Replication configuration; striping and erasure coding
+     * are not supported
+     * @return 0 on success, negative value on error
+     */
+    int stream_put_start(const std::string &key,
+                         const std::vector<uint64_t> &chunk_sizes,
+                         const ReplicateConfig &config = ReplicateConfig{});
+
+    /**
+     * @brief Writes and commits one chunk of a streaming put
+     * @param key Key of the object
+     * @param chunk_index Index of the chunk
+     * @param buffer Registered buffer holding the chunk
+     * @param size Size of the chunk
+     * @return 0 on success, negative value on error
+     */
+    int stream_put_from(const std::string &key, uint64_t chunk_index,
+                        void *buffer, size_t size);
+
+    /**
+     * @brief Completes a streaming put once all its chunks are written
+     * @return 0 on success, negative value on error
+     */
+    int stream_put_end(const std::string &key);
+
+    /**
+     * @brief Reads [offset, offset + size) of an object into a registered
+     * buffer. The object may still be streamed, as long as the chunks
+     * covering the range are committed.
+     * @return Number of bytes read, or REPLICA_IS_NOT_READY while the range
+     * is not committed yet
+     */
+    int64_t get_range_into(const std::string &key, uint64_t offset,
+                           void *buffer, size_t size);
+
+    /**
+     * @brief Reads byte ranges of an object into one client buffer, back to
+     * back in the order given, with one replica lookup
+     * @param ranges (offset, length) of each range in the object
+     * @return The buffer, or nullptr on error
+     */
+    std::shared_ptr<BufferHandle> get_ranges_buffer(
+        const std::string &key,
+        const std::vector<std::pair<uint64_t, uint64_t>> &ranges);
+
     int put_parts(const std::string &key,
                   std::vector<std::span<const char>> values,
                   const ReplicateConfig &config = ReplicateConfig{});
@@ -218,6 +273,23 @@ class RealClient : public PyClient {
                   const std::vector<std::span<const char>> &values,
                   const ReplicateConfig &config = ReplicateConfig{});
 
+    /**
+     * @brief Put several objects made of several parts each, with a single
+     * batch request to the master
+     * @param keys Keys of the objects to put
+     * @param all_parts Parts of each object, stored one after the other
+     * @param config Replication configuration
+     * @return Vector of integers, where each element is 0 on success, or a
+     * negative value on error
+     * @note Parts lying in a buffer registered with register_buffer() or in
+     * the client buffer are transferred from where they are. The other parts
+     * of an object are copied into one client buffer allocation first.
+     */
+    std::vector<int> batch_put_parts(
+        const std::vector<std::string> &keys,
+        const std::vector<std::vector<std::span<const char>>> &all_parts,
+        const ReplicateConfig &config = ReplicateConfig{});
+
     [[nodiscard]] std::string get_hostname() const;
 
     /**
@@ -244,6 +316,47 @@ class RealClient : public PyClient {
     std::vector<std::shared_ptr<BufferHandle>> batch_get_buffer(
         const std::vector<std::string> &keys);
 
+    /**
+     * @brief Completion-based variants of the buffer operations. Each
+     * submit_* call queues the operation on the async workers and returns
+     * its request id at once. When it finishes, its results are queued and
+     * the eventfd returned by async_completion_fd() becomes readable, so an
+     * event loop can wait for many operations without a thread per call.
+     * @note Results use the same values as the blocking calls, one per key
+     */
+    int async_completion_fd();
+
+    uint64_t submit_get_into(const std::string &key, void *buffer,
+                             size_t size);
+
+    uint64_t submit_batch_get_into(const std::vector<std::string> &keys,
+                                   const std::vector<void *> &buffers,
+                                   const std::vector<size_t> &sizes);
+
+    uint64_t submit_put_from(const std::string &key, void *buffer, size_t size,
+                             const ReplicateConfig &config = ReplicateConfig{});
+
+    uint64_t submit_batch_put_from(
+        const std::vector<std::string> &keys,
+        const std::vector<void *> &buffers, const std::vector<size_t> &sizes,
+        const ReplicateConfig &config = ReplicateConfig{});
+
+    /**
+     * @brief Take the results of the operations completed since the last
+     * call and reset the eventfd
+     * @return Pairs of request id and per-key results
+     */
+    std::vector<std::pair<uint64_t, std::vector<int64_t>>>
+    poll_async_completions();
+
+    /**
+     * @brief Warm the replica cache and the local hot cache for keys that
+     * will be read soon, without waiting for it
+     * @param keys Keys to prefetch
+     * @return 0 if the prefetch was queued, negative value on error
+     */
+    int prefetch(const std::vector<std::string> &keys);
+
     int remove(const std::string &key, bool force = false);
 
     long removeByRegex(const std::string &str, bool force = false);
@@ -267,6 +380,14 @@ class RealClient : public PyClient {
      */
     std::vector<int> batchIsExist(const std::vector<std::string> &keys);
 
+    /**
+     * @brief Count how many of the keys, from the first on, all exist
+     * @param keys Keys to check, in order
+     * @return Index of the first missing key, or the number of keys if all
+     * exist; a negative error code on error
+     */
+    int64_t batchIsExistPrefix(const std::vector<std::string> &keys);
+
     /**
      * @brief Get the size of an object
      * @param key Key of the object
@@ -345,6 +466,11 @@ class RealClient : public PyClient {
 
     tl::expected<void, ErrorCode> unmap_shm_internal(const UUID &client_id);
 
+    // Starts serving the request ring a dummy client sent over IPC,
+    // replacing the one it had
+    tl::expected<void, ErrorCode> map_request_ring_internal(
+        int fd, size_t ring_size, const UUID &client_id);
+
     tl::expected<void, ErrorCode> unregister_shm_buffer_internal(
         uint64_t dummy_base_addr, const UUID &client_id);
 
@@ -424,6 +550,11 @@ class RealClient : public PyClient {
         std::shared_ptr<ClientBufferAllocator> client_buffer_allocator =
             nullptr);
 
+    std::vector<tl::expected<void, ErrorCode>> batch_put_parts_internal(
+        const std::vector<std::string> &keys,
+        const std::vector<std::vector<std::span<const char>>> &all_parts,
+        const ReplicateConfig &config = ReplicateConfig{});
+
     tl::expected<void, ErrorCode> remove_internal(const std::string &key,
                                                   bool force = false);
 
@@ -439,6 +570,9 @@ class RealClient : public PyClient {
     std::vector<tl::expected<bool, ErrorCode>> batchIsExist_internal(
         const std::vector<std::string> &keys);
 
+    tl::expected<int64_t, ErrorCode> batchIsExistPrefix_internal(
+        const std::vector<std::string> &keys);
+
     tl::expected<int64_t, ErrorCode> getSize_internal(const std::string &key);
 
     std::shared_ptr<BufferHandle> get_buffer_internal(
@@ -459,6 +593,14 @@ class RealClient : public PyClient {
     batch_get_offload_object(const std::vector<std::string> &keys,
                              const std::vector<int64_t> &sizes);
 
+    /**
+     * @brief Frees the buffers batch_get_offload_object loaded objects into,
+     * once the reader has read them.
+     * @param batch_id Id of the batch, from the batch_get_offload_object
+     * response.
+     */
+    tl::expected<void, ErrorCode> release_offload_object(uint64_t batch_id);
+
     /**
      * @brief Retrieves multiple stored objects from a remote service.
      * @param target_rpc_service_addr Address of the remote RPC service (e.g.,
@@ -488,6 +630,10 @@ class RealClient : public PyClient {
         }
     };
 
+    struct CudaSegmentDeleter {
+        void operator()(void *ptr) { CudaStaging::FreeDeviceMemory(ptr); }
+    };
+
     struct AscendSegmentDeleter {
         void operator()(void *ptr) {
             if (ptr) {
@@ -496,11 +642,15 @@ class RealClient : public PyClient {
         }
     };
 
+    // Segments mapped by allocate_buffer_mmap_memory(), i.e. backed by huge
+    // pages, bound to a NUMA node or faulted in by the prefault threads
     std::vector<std::unique_ptr<void, HugepageSegmentDeleter>>
         hugepage_segment_ptrs_;
     std::vector<std::unique_ptr<void, SegmentDeleter>> segment_ptrs_;
     std::vector<std::unique_ptr<void, AscendSegmentDeleter>>
         ascend_segment_ptrs_;
+    // Segments on the GPU picked by MC_STORE_SEGMENT_CUDA_DEVICE
+    std::vector<std::unique_ptr<void, CudaSegmentDeleter>> cuda_segment_ptrs_;
     std::string protocol;
     std::string device_name;
     std::string local_hostname;
@@ -525,9 +675,42 @@ class RealClient : public PyClient {
     mutable std::shared_mutex dummy_client_mutex_;
     std::unordered_map<UUID, ShmContext, boost::hash<UUID>> shm_contexts_;
 
+    // Whether [ptr, ptr + size) lies in a single buffer registered with
+    // register_buffer() or in the client buffer
+    bool is_registered_memory(const void *ptr, size_t size);
+    Mutex registered_buffers_mutex_;
+    // Base address to size of the buffers registered with register_buffer()
+    std::map<uintptr_t, size_t> registered_buffers_
+        GUARDED_BY(registered_buffers_mutex_);
+
+    // Set with USE_CUDA: GPU memory outside registered memory is copied
+    // through the client buffer rather than read or written by RDMA
+    std::unique_ptr<CudaStaging> cuda_staging_;
+    bool needs_cuda_staging(const void *ptr, size_t size);
+
+    // batch_get_into_internal() for buffers some of which need staging. Keys
+    // are read in waves, each copied to the GPU while the next is read.
+    std::vector<tl::expected<int64_t, ErrorCode>> batch_get_into_staged(
+        const std::vector<std::string> &keys,
+        const std::vector<void *> &buffers, const std::vector<size_t> &sizes);
+
     // Ensure cleanup executes at most once across multiple entry points
     std::atomic<bool> closed_{false};
 
+    // Async operations, see submit_get_into(). The workers are started on
+    // first use, MC_STORE_ASYNC_WORKERS of them (default 8).
+    uint64_t submit_async(size_t num_results,
+                          std::function<std::vector<int64_t>()> op);
+    Mutex async_mutex_;
+    int async_event_fd_ GUARDED_BY(async_mutex_) = -1;
+    std::unique_ptr<ThreadPool> async_workers_ GUARDED_BY(async_mutex_);
+    bool async_stopped_ GUARDED_BY(async_mutex_) = false;
+    uint64_t next_async_id_ GUARDED_BY(async_mutex_) = 1;
+    std::vector<std::pair<uint64_t, std::vector<int64_t>>> async_completions_
+        GUARDED_BY(async_mutex_);
+    static constexpr size_t kDefaultAsyncWorkers = 8;
+    void stop_async_workers();
+
     // Dummy Client manage related members
     void dummy_client_monitor_func();
     int start_dummy_client_monitor();
@@ -547,6 +730,21 @@ class RealClient : public PyClient {
     const int64_t dummy_client_live_ttl_sec_ = DEFAULT_CLIENT_LIVE_TTL_SEC;
     int64_t view_version_ = 0;
 
+    // Request rings of the dummy clients, each served by
+    // MC_STORE_SHM_RING_THREADS threads (default 2). Stopped without holding
+    // dummy_client_mutex_, which the serving threads take.
+    struct RequestRingServer {
+        std::shared_ptr<ShmRequestRing> ring;
+        std::vector<std::thread> threads;
+    };
+    void serve_request_ring(ShmRequestRing *ring, const UUID &client_id);
+    void stop_request_ring(const UUID &client_id);
+    void stop_request_rings();
+    Mutex request_rings_mutex_;
+    std::unordered_map<UUID, RequestRingServer, boost::hash<UUID>>
+        request_rings_ GUARDED_BY(request_rings_mutex_);
+    static constexpr size_t kDefaultRequestRingThreads = 2;
+
     // IPC Server members for receiving FD from Dummy Clients
     std::string ipc_socket_path_;
     std::jthread ipc_thread_;
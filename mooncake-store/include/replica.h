@@ -2,6 +2,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -88,6 +89,27 @@ struct ReplicateConfig {
     std::string preferred_segment{};  // Deprecated: Single preferred segment
                                       // for backward compatibility
     bool prefer_alloc_in_same_node{false};
+    // Number of segments each memory replica is striped across, so that the
+    // transfer of one large object uses several NICs. 1 disables striping.
+    size_t stripe_num{1};
+    // Number of Reed-Solomon parity stripes added to each memory replica, so
+    // that it survives the loss of that many stripes. 0 disables erasure
+    // coding.
+    size_t parity_num{0};
+    // Caller supplied hash of the value, e.g. a digest of the KV block. On a
+    // master with dedup enabled, a put whose hash matches stored content of
+    // the same size shares its replicas instead of writing a copy. Empty
+    // disables deduplication of the put.
+    std::string content_hash{};
+    // Milliseconds from PutStart after which the master removes the
+    // object, unless it is removed or evicted earlier. 0 keeps it until
+    // then.
+    uint64_t ttl_ms{0};
+    // Cost of computing the value again, e.g. the number of prefix tokens
+    // of a KV block, in a unit of the caller's choice shared by all puts.
+    // With cost aware eviction, the master keeps the objects of most cost
+    // per byte. 0 counts as one per byte.
+    uint64_t cost_hint{0};
 
     friend std::ostream& operator<<(std::ostream& os,
                                     const ReplicateConfig& config) noexcept {
@@ -104,13 +126,30 @@ struct ReplicateConfig {
                << config.preferred_segment;
         }
         os << ", prefer_alloc_in_same_node: "
-           << config.prefer_alloc_in_same_node << " }";
+           << config.prefer_alloc_in_same_node
+           << ", stripe_num: " << config.stripe_num
+           << ", parity_num: " << config.parity_num;
+        if (!config.content_hash.empty()) {
+            os << ", content_hash: " << config.content_hash;
+        }
+        if (config.ttl_ms > 0) {
+            os << ", ttl_ms: " << config.ttl_ms;
+        }
+        if (config.cost_hint > 0) {
+            os << ", cost_hint: " << config.cost_hint;
+        }
+        os << " }";
         return os;
     }
 };
 
 struct MemoryReplicaData {
+    // The whole object, or the first stripe of a striped replica
     std::unique_ptr<AllocatedBuffer> buffer;
+    // The remaining stripes of a striped replica, in object order
+    std::vector<std::unique_ptr<AllocatedBuffer>> extra_stripes;
+    // Number of trailing stripes holding Reed-Solomon parity
+    uint32_t parity_stripes{0};
 };
 
 struct DiskReplicaData {
@@ -125,8 +164,37 @@ struct LocalDiskReplicaData {
 };
 
 struct MemoryDescriptor {
+    // The whole object, or the first stripe of a striped replica
     AllocatedBuffer::Descriptor buffer_descriptor;
-    YLT_REFL(MemoryDescriptor, buffer_descriptor);
+    // The remaining stripes of a striped replica, in object order
+    std::vector<AllocatedBuffer::Descriptor> extra_stripes;
+    // Number of trailing stripes holding Reed-Solomon parity. The parity
+    // stripes are as long as the longest data stripe, and a lost stripe has
+    // an empty transport endpoint.
+    uint32_t parity_stripes{0};
+    YLT_REFL(MemoryDescriptor, buffer_descriptor, extra_stripes,
+             parity_stripes);
+
+    bool is_striped() const { return !extra_stripes.empty(); }
+
+    bool is_erasure_coded() const { return parity_stripes > 0; }
+
+    size_t data_stripes() const {
+        return 1 + extra_stripes.size() - parity_stripes;
+    }
+
+    const AllocatedBuffer::Descriptor& stripe(size_t i) const {
+        return i == 0 ? buffer_descriptor : extra_stripes[i - 1];
+    }
+
+    // Size of the object over all data stripes
+    uint64_t total_size() const {
+        uint64_t size = 0;
+        for (size_t i = 0; i < data_stripes(); ++i) {
+            size += stripe(i).size_;
+        }
+        return size;
+    }
 };
 
 struct DiskDescriptor {
@@ -149,7 +217,19 @@ class Replica {
     // memory replica constructor
     Replica(std::unique_ptr<AllocatedBuffer> buffer, ReplicaStatus status)
         : id_(next_id_.fetch_add(1)),
-          data_(MemoryReplicaData{std::move(buffer)}),
+          data_(MemoryReplicaData{std::move(buffer), {}, 0}),
+          status_(status),
+          refcnt_(0) {}
+
+    // striped memory replica constructor, the stripes are in object order
+    // and the last parity_stripes of them hold Reed-Solomon parity
+    Replica(std::vector<std::unique_ptr<AllocatedBuffer>> stripes,
+            ReplicaStatus status, uint32_t parity_stripes = 0)
+        : id_(next_id_.fetch_add(1)),
+          data_(MemoryReplicaData{std::move(stripes.front()),
+                                  {std::make_move_iterator(stripes.begin() + 1),
+                                   std::make_move_iterator(stripes.end())},
+                                  parity_stripes}),
           status_(status),
           refcnt_(0) {}
 
@@ -265,27 +345,83 @@ class Replica {
         return replica.is_local_disk_replica();
     }
 
+    // An erasure coded replica is only invalid once it lost more stripes
+    // than it has parity stripes.
     [[nodiscard]] bool has_invalid_mem_handle() const {
         if (is_memory_replica()) {
             const auto& mem_data = std::get<MemoryReplicaData>(data_);
-            return !mem_data.buffer->isAllocatorValid();
+            uint32_t invalid = 0;
+            for (const auto* buffer : get_memory_buffers()) {
+                if (!buffer->isAllocatorValid()) {
+                    invalid++;
+                }
+            }
+            return invalid > mem_data.parity_stripes;
         }
         return false;  // DiskReplicaData does not have handles
     }
 
     [[nodiscard]] size_t get_memory_buffer_size() const {
         if (is_memory_replica()) {
-            const auto& mem_data = std::get<MemoryReplicaData>(data_);
-            return mem_data.buffer->size();
+            size_t size = 0;
+            for (const auto* buffer : get_memory_buffers()) {
+                size += buffer->size();
+            }
+            return size;
         } else {
             LOG(ERROR) << "Invalid replica type: " << type();
             return 0;
         }
     }
 
+    // Combine single buffer memory replicas, given in object order, into one
+    // striped memory replica whose last parity_stripes hold parity.
+    static Replica merge_stripes(std::vector<Replica> stripes,
+                                 ReplicaStatus status,
+                                 uint32_t parity_stripes = 0) {
+        std::vector<std::unique_ptr<AllocatedBuffer>> buffers;
+        buffers.reserve(stripes.size());
+        for (auto& stripe : stripes) {
+            buffers.push_back(
+                std::move(std::get<MemoryReplicaData>(stripe.data_).buffer));
+        }
+        return Replica(std::move(buffers), status, parity_stripes);
+    }
+
+    // Only call for memory replicas. Striped replicas return one buffer per
+    // stripe, in object order.
+    [[nodiscard]] std::vector<AllocatedBuffer*> get_memory_buffers() const {
+        const auto& mem_data = std::get<MemoryReplicaData>(data_);
+        std::vector<AllocatedBuffer*> buffers;
+        buffers.reserve(1 + mem_data.extra_stripes.size());
+        buffers.push_back(mem_data.buffer.get());
+        for (const auto& stripe : mem_data.extra_stripes) {
+            buffers.push_back(stripe.get());
+        }
+        return buffers;
+    }
+
+    [[nodiscard]] bool is_striped() const {
+        return is_memory_replica() &&
+               !std::get<MemoryReplicaData>(data_).extra_stripes.empty();
+    }
+
+    [[nodiscard]] bool is_erasure_coded() const {
+        return is_memory_replica() &&
+               std::get<MemoryReplicaData>(data_).parity_stripes > 0;
+    }
+
+    [[nodiscard]] uint32_t get_parity_stripes() const {
+        return std::get<MemoryReplicaData>(data_).parity_stripes;
+    }
+
     [[nodiscard]] std::vector<std::optional<std::string>> get_segment_names()
         const;
 
+    // Whether a stripe of a memory replica is in the segment. Unlike
+    // get_segment_names, copies no names.
+    [[nodiscard]] bool is_in_segment(const std::string& segment_name) const;
+
     void mark_complete() {
         if (status_ == ReplicaStatus::PROCESSING) {
             status_ = ReplicaStatus::COMPLETE;
@@ -304,6 +440,38 @@ class Replica {
 
     friend std::ostream& operator<<(std::ostream& os, const Replica& replica);
 
+    // A memory replica can only be serialized if its allocator is part of
+    // the snapshot.
+    [[nodiscard]] bool is_serializable(
+        const AllocatorIndex& allocator_index) const {
+        if (is_memory_replica()) {
+            const auto& mem_data = std::get<MemoryReplicaData>(data_);
+            if (!mem_data.buffer ||
+                !mem_data.buffer->isIndexed(allocator_index)) {
+                return false;
+            }
+            for (const auto& stripe : mem_data.extra_stripes) {
+                if (!stripe->isIndexed(allocator_index)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Serialize the replica into a master snapshot. Memory buffers refer to
+    // their allocator through allocator_index.
+    template <typename T>
+    void serialize_to(T& serializer,
+                      const AllocatorIndex& allocator_index) const;
+
+    // Restore a replica written by serialize_to(). The restored replica gets
+    // a new id and a zero refcnt.
+    template <typename T>
+    static Replica deserialize_from(
+        T& serializer,
+        const std::vector<std::shared_ptr<OffsetBufferAllocator>>& allocators);
+
     struct ReplicaTypeVisitor {
         ReplicaType operator()(const MemoryReplicaData&) const {
             return ReplicaType::MEMORY;
@@ -415,8 +583,21 @@ inline Replica::Descriptor Replica::get_descriptor() const {
     if (is_memory_replica()) {
         const auto& mem_data = std::get<MemoryReplicaData>(data_);
         MemoryDescriptor mem_desc;
+        // A lost stripe of an erasure coded replica is described by its size
+        // alone, the client then decodes it from the parity.
+        const auto stripe_descriptor = [&mem_data](const AllocatedBuffer& buf) {
+            if (mem_data.parity_stripes > 0 && !buf.isAllocatorValid()) {
+                return AllocatedBuffer::Descriptor{buf.size(), 0, "", ""};
+            }
+            return buf.get_descriptor();
+        };
         if (mem_data.buffer) {
-            mem_desc.buffer_descriptor = mem_data.buffer->get_descriptor();
+            mem_desc.buffer_descriptor = stripe_descriptor(*mem_data.buffer);
+            mem_desc.extra_stripes.reserve(mem_data.extra_stripes.size());
+            for (const auto& stripe : mem_data.extra_stripes) {
+                mem_desc.extra_stripes.push_back(stripe_descriptor(*stripe));
+            }
+            mem_desc.parity_stripes = mem_data.parity_stripes;
         } else {
             mem_desc.buffer_descriptor.size_ = 0;
             mem_desc.buffer_descriptor.buffer_address_ = 0;
@@ -442,6 +623,110 @@ inline Replica::Descriptor Replica::get_descriptor() const {
     return desc;
 }
 
+template <typename T>
+void Replica::serialize_to(T& serializer,
+                           const AllocatorIndex& allocator_index) const {
+    uint8_t type_value = static_cast<uint8_t>(type());
+    uint8_t status_value = static_cast<uint8_t>(status_);
+    serializer.write(&type_value, sizeof(type_value));
+    serializer.write(&status_value, sizeof(status_value));
+
+    if (is_memory_replica()) {
+        const auto& mem_data = std::get<MemoryReplicaData>(data_);
+        if (!mem_data.buffer) {
+            serializer.set_error("memory_replica_without_buffer");
+            return;
+        }
+        mem_data.buffer->serialize_to(serializer, allocator_index);
+        uint32_t extra_stripes = mem_data.extra_stripes.size();
+        serializer.write(&extra_stripes, sizeof(extra_stripes));
+        for (const auto& stripe : mem_data.extra_stripes) {
+            stripe->serialize_to(serializer, allocator_index);
+        }
+        serializer.write(&mem_data.parity_stripes,
+                         sizeof(mem_data.parity_stripes));
+    } else if (is_disk_replica()) {
+        const auto& disk_data = std::get<DiskReplicaData>(data_);
+        serialize_string(serializer, disk_data.file_path);
+        serializer.write(&disk_data.object_size,
+                         sizeof(disk_data.object_size));
+    } else {
+        const auto& disk_data = std::get<LocalDiskReplicaData>(data_);
+        serializer.write(&disk_data.client_id.first,
+                         sizeof(disk_data.client_id.first));
+        serializer.write(&disk_data.client_id.second,
+                         sizeof(disk_data.client_id.second));
+        serializer.write(&disk_data.object_size,
+                         sizeof(disk_data.object_size));
+        serialize_string(serializer, disk_data.transport_endpoint);
+    }
+}
+
+template <typename T>
+Replica Replica::deserialize_from(
+    T& serializer,
+    const std::vector<std::shared_ptr<OffsetBufferAllocator>>& allocators) {
+    // serializer.read() will throw an exception if the buffer is corrupted.
+    uint8_t type_value = 0;
+    uint8_t status_value = 0;
+    serializer.read(&type_value, sizeof(type_value));
+    serializer.read(&status_value, sizeof(status_value));
+    if (status_value > static_cast<uint8_t>(ReplicaStatus::FAILED)) {
+        throw std::runtime_error("invalid_replica_status");
+    }
+    auto status = static_cast<ReplicaStatus>(status_value);
+
+    switch (static_cast<ReplicaType>(type_value)) {
+        case ReplicaType::MEMORY: {
+            std::vector<std::unique_ptr<AllocatedBuffer>> stripes;
+            stripes.push_back(
+                AllocatedBuffer::deserialize_from(serializer, allocators));
+            uint32_t extra_stripes = 0;
+            serializer.read(&extra_stripes, sizeof(extra_stripes));
+            for (uint32_t i = 0; i < extra_stripes; ++i) {
+                stripes.push_back(
+                    AllocatedBuffer::deserialize_from(serializer, allocators));
+            }
+            uint32_t parity_stripes = 0;
+            serializer.read(&parity_stripes, sizeof(parity_stripes));
+            return Replica(std::move(stripes), status, parity_stripes);
+        }
+        case ReplicaType::DISK: {
+            std::string file_path = deserialize_string(serializer);
+            uint64_t object_size = 0;
+            serializer.read(&object_size, sizeof(object_size));
+            return Replica(std::move(file_path), object_size, status);
+        }
+        case ReplicaType::LOCAL_DISK: {
+            UUID client_id;
+            uint64_t object_size = 0;
+            serializer.read(&client_id.first, sizeof(client_id.first));
+            serializer.read(&client_id.second, sizeof(client_id.second));
+            serializer.read(&object_size, sizeof(object_size));
+            std::string transport_endpoint = deserialize_string(serializer);
+            return Replica(client_id, object_size,
+                           std::move(transport_endpoint), status);
+        }
+        default:
+            throw std::runtime_error("invalid_replica_type");
+    }
+}
+
+inline bool Replica::is_in_segment(const std::string& segment_name) const {
+    if (!is_memory_replica()) {
+        return false;
+    }
+    const auto& mem_data = std::get<MemoryReplicaData>(data_);
+    if (mem_data.buffer && mem_data.buffer->isInSegment(segment_name)) {
+        return true;
+    }
+    return std::any_of(mem_data.extra_stripes.begin(),
+                       mem_data.extra_stripes.end(),
+                       [&segment_name](const auto& stripe) {
+                           return stripe->isInSegment(segment_name);
+                       });
+}
+
 inline std::vector<std::optional<std::string>> Replica::get_segment_names()
     const {
     if (is_memory_replica()) {
@@ -452,6 +737,13 @@ inline std::vector<std::optional<std::string>> Replica::get_segment_names()
         } else {
             segment_names.push_back(std::nullopt);
         }
+        for (const auto& stripe : mem_data.extra_stripes) {
+            if (stripe->isAllocatorValid()) {
+                segment_names.push_back(stripe->getSegmentName());
+            } else {
+                segment_names.push_back(std::nullopt);
+            }
+        }
         return segment_names;
     }
     return std::vector<std::optional<std::string>>();
@@ -467,6 +759,9 @@ inline std::ostream& operator<<(std::ostream& os, const Replica& replica) {
         if (mem_data.buffer) {
             os << *mem_data.buffer;
         }
+        for (const auto& stripe : mem_data.extra_stripes) {
+            os << ", " << *stripe;
+        }
         os << "]";
     } else if (replica.is_disk_replica()) {
         const auto& disk_data = std::get<DiskReplicaData>(replica.data_);
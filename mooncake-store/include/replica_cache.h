@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mutex.h"
+#include "replica.h"
+
+namespace mooncake {
+
+/**
+ * @brief Client-side LRU cache of the replica descriptors returned by the
+ * master, keyed by object key.
+ *
+ * The master does not evict or remove an object (except for forced removals)
+ * while its lease is valid, so a cached descriptor can be used without asking
+ * the master again until the lease expires. Entries whose lease expires within
+ * the minimum remaining lease are not served, so that the transfer issued
+ * from a hit can still complete before the lease expires.
+ */
+class ReplicaCache {
+   public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /**
+     * @brief Construct a ReplicaCache.
+     * @param capacity Maximum number of cached keys, must be positive.
+     * @param min_remaining_lease Minimum remaining lease for a hit.
+     */
+    ReplicaCache(size_t capacity,
+                 std::chrono::milliseconds min_remaining_lease);
+
+    /**
+     * @brief Look up the replicas of a key and touch the LRU.
+     * @param key Object key.
+     * @param replicas Set to the cached replicas on hit.
+     * @param lease_timeout Set to the cached lease timeout on hit.
+     * @param checksum If not null, set to the cached checksum on hit.
+     * @return true on hit; false if the key is not cached or its lease is
+     * about to expire, in which case the entry is dropped.
+     */
+    bool Get(const std::string& key, std::vector<Replica::Descriptor>& replicas,
+             TimePoint& lease_timeout,
+             std::optional<uint32_t>* checksum = nullptr);
+
+    /**
+     * @brief Cache the replicas of a key, replacing the previous entry and
+     * evicting the least recently used key if the cache is full. Nothing is
+     * cached if the lease is already too short to be served.
+     */
+    void Put(const std::string& key,
+             const std::vector<Replica::Descriptor>& replicas,
+             TimePoint lease_timeout,
+             std::optional<uint32_t> checksum = std::nullopt);
+
+    /**
+     * @brief Drop the entry of a key, if any.
+     */
+    void Invalidate(const std::string& key);
+
+    /**
+     * @brief Drop all entries.
+     */
+    void Clear();
+
+    size_t Size() const;
+
+   private:
+    struct Entry {
+        std::string key;
+        std::vector<Replica::Descriptor> replicas;
+        TimePoint lease_timeout;
+        std::optional<uint32_t> checksum;
+    };
+    using EntryList = std::list<Entry>;
+
+    const size_t capacity_;
+    const std::chrono::milliseconds min_remaining_lease_;
+
+    mutable Mutex mutex_;
+    EntryList lru_ GUARDED_BY(mutex_);  // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> index_
+        GUARDED_BY(mutex_);
+};
+
+}  // namespace mooncake
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mooncake {
+
+/**
+ * @brief Load of the replica endpoints a client reads from, used to choose
+ *        among the replicas of an object.
+ *
+ * For every transport endpoint the tracker counts the reads in flight and
+ * keeps a moving average of the latency of the finished ones. The expected
+ * cost of a new read is that latency times the number of reads ahead of it,
+ * so a replica behind a busy or slow NIC looks expensive. Failed reads
+ * count as kFailurePenalty. Statistics older than kStatsTtl are dropped, so
+ * an endpoint avoided for being slow is tried again later.
+ *
+ * Choose() samples two candidates at random and takes the cheaper one
+ * (power of two choices): clients spread their reads without all rushing
+ * to the replica that looked best to everyone.
+ *
+ * @note Thread safety: all methods are thread safe.
+ */
+class ReplicaLoadTracker {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr auto kStatsTtl = std::chrono::seconds(5);
+    static constexpr auto kFailurePenalty = std::chrono::milliseconds(100);
+    // Weight of a new latency sample in the moving average
+    static constexpr double kLatencyWeight = 0.2;
+
+    void OnStart(const std::string& endpoint);
+
+    void OnFinish(const std::string& endpoint, Clock::duration latency,
+                  bool success, Clock::time_point now = Clock::now());
+
+    // Expected microseconds until a read from the endpoint started now
+    // completes. Endpoints without recent samples count 1us per read, so
+    // they are tried before the ones known to take longer.
+    double Cost(const std::string& endpoint,
+                Clock::time_point now = Clock::now()) const;
+
+    // Index of the endpoint to read from
+    size_t Choose(const std::vector<const std::string*>& endpoints,
+                  Clock::time_point now = Clock::now()) const;
+
+   private:
+    struct EndpointLoad {
+        uint32_t in_flight{0};
+        double latency_us{0};
+        Clock::time_point updated{};
+    };
+
+    double CostLocked(const EndpointLoad& load, Clock::time_point now) const;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, EndpointLoad> loads_;
+};
+
+}  // namespace mooncake
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rpc_types.h"
+
+namespace mooncake {
+
+// A copy or move task assigned to the client by the master
+struct ReplicaTask {
+    TaskAssignment assignment;
+    uint32_t retry_count = 0;
+
+    void increment_retry() { retry_count++; }
+};
+
+/**
+ * @brief Runs the replica tasks of a client in the background.
+ *
+ * Tasks are handed to the handler in batches of up to batch_size, so that
+ * the transfers of several tasks go out as one transfer batch. Workers are
+ * added while tasks are waiting and no worker is idle, up to max_workers,
+ * and leave again after idle_timeout without work, down to min_workers.
+ * Retries are queued with a delay instead of sleeping in a worker.
+ *
+ * All workers share one bandwidth budget: Throttle() delays the caller
+ * until its bytes fit in bandwidth_bytes_per_sec, so that a burst of tasks,
+ * e.g. after a node is lost, leaves room for foreground traffic.
+ *
+ * @note Thread safety: all methods are thread safe.
+ */
+class ReplicaTaskExecutor {
+   public:
+    using Clock = std::chrono::steady_clock;
+    using BatchHandler = std::function<void(std::vector<ReplicaTask>&)>;
+
+    // After an idle period, Throttle() lets through this much worth of the
+    // budget at once
+    static constexpr auto kMaxBurst = std::chrono::milliseconds(100);
+
+    struct Config {
+        size_t min_workers = 1;
+        size_t max_workers = 8;
+        size_t batch_size = 8;
+        // 0: unlimited
+        uint64_t bandwidth_bytes_per_sec = 0;
+        Clock::duration idle_timeout = std::chrono::seconds(5);
+
+        // MC_STORE_TASK_MAX_WORKERS, MC_STORE_TASK_BATCH_SIZE and
+        // MC_STORE_TASK_BANDWIDTH_MBPS
+        static Config FromEnv();
+    };
+
+    ReplicaTaskExecutor(const Config& config, BatchHandler handler);
+
+    // Stops the executor
+    ~ReplicaTaskExecutor();
+
+    ReplicaTaskExecutor(const ReplicaTaskExecutor&) = delete;
+    ReplicaTaskExecutor& operator=(const ReplicaTaskExecutor&) = delete;
+
+    /**
+     * @brief Queues a task, to run after delay.
+     * @return false if the executor is stopped.
+     */
+    bool Submit(ReplicaTask task, Clock::duration delay = Clock::duration{});
+
+    /**
+     * @brief Waits for the running batches and drops the queued tasks. The
+     * master fails them once they time out.
+     */
+    void Stop();
+
+    /**
+     * @brief Blocks until `bytes` fit in the bandwidth budget.
+     */
+    void Throttle(uint64_t bytes);
+
+    size_t num_workers() const;
+
+    // Tasks queued, including delayed ones
+    size_t num_pending() const;
+
+   private:
+    struct Worker {
+        std::thread thread;
+        bool exited = false;
+    };
+
+    void WorkerMain(Worker* worker);
+
+    // Moves the delayed tasks that are due to ready_
+    void PromoteDueLocked(Clock::time_point now);
+
+    void SpawnWorkerLocked();
+
+    const Config config_;
+    const BatchHandler handler_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+    std::deque<ReplicaTask> ready_;
+    std::multimap<Clock::time_point, ReplicaTask> delayed_;
+    std::list<Worker> workers_;
+    size_t num_workers_ = 0;
+    size_t idle_workers_ = 0;
+
+    std::mutex throttle_mutex_;
+    // When the bytes let through so far have been sent at the budget
+    Clock::time_point throttle_until_{};
+};
+
+}  // namespace mooncake
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace mooncake {
+
+/**
+ * @brief Sampled tracing of store requests.
+ *
+ * With MC_STORE_TRACE_SAMPLE_EVERY=N, one in N client requests starts a
+ * trace. Every TraceSpan opened on the thread of a traced request, such as
+ * the master RPCs and transfer submissions it makes, is recorded with the
+ * same trace id, and the id is passed to the master with each RPC so that
+ * the master records its side of the request as well.
+ *
+ * Spans are written to MC_STORE_TRACE_FILE, one file per process, in the
+ * Chrome trace event format that chrome://tracing and Perfetto load.
+ * Without tracing, or outside a traced request, a span costs one
+ * thread-local read.
+ */
+
+// Whether MC_STORE_TRACE_SAMPLE_EVERY enables tracing in this process
+bool TracingEnabled();
+
+// Trace of the request running on this thread, 0 if none
+uint64_t CurrentTraceId();
+
+/**
+ * @brief Trace id for a new request: that of the enclosing traced request
+ * if any, otherwise a new id for one in MC_STORE_TRACE_SAMPLE_EVERY calls
+ * of the thread, otherwise 0.
+ */
+uint64_t SampleTraceId();
+
+// Trace id as sent along RPCs, empty for 0
+std::string FormatTraceId(uint64_t trace_id);
+// Parses a formatted trace id, 0 if it is empty or malformed
+uint64_t ParseTraceId(std::string_view text);
+
+// Write the spans recorded so far to the trace file
+void FlushTraces();
+
+/**
+ * @brief Records the time between its construction and destruction as a
+ * span of a trace. name must be a string literal.
+ */
+class TraceSpan {
+   public:
+    // Span of the trace of this thread, if any
+    explicit TraceSpan(const char* name) : TraceSpan(name, CurrentTraceId()) {}
+
+    // Span of trace_id, which is the trace of this thread while the span is
+    // open. No span is recorded for 0.
+    TraceSpan(const char* name, uint64_t trace_id)
+        : name_(name), trace_id_(trace_id) {
+        if (trace_id_ != 0) {
+            Begin();
+        }
+    }
+
+    ~TraceSpan() {
+        if (trace_id_ != 0) {
+            End();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+   private:
+    void Begin();
+    void End();
+
+    const char* name_;
+    uint64_t trace_id_;
+    uint64_t parent_trace_id_ = 0;
+    uint64_t start_us_ = 0;
+};
+
+}  // namespace mooncake
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ylt/util/tl/expected.hpp>
+
+#include "types.h"
+
+namespace mooncake {
+
+/**
+ * @brief Coalesces concurrent single-key calls into calls of a batch RPC.
+ *
+ * The first caller of a batch is its leader. If no batch is in flight it
+ * sends its key at once, so a lone caller pays no extra latency. Otherwise
+ * it waits up to the window, or until max_batch keys joined, to collect the
+ * keys of the other callers, then sends them all with one batch call and
+ * hands every caller its own result.
+ */
+template <typename Result>
+class RpcCoalescer {
+   public:
+    using Results = std::vector<tl::expected<Result, ErrorCode>>;
+    using BatchFn = std::function<Results(const std::vector<std::string>&)>;
+
+    /**
+     * @brief Construct an RpcCoalescer.
+     * @param batch_fn Batch call returning one result per key, in order.
+     * @param window Time a leader waits for other keys while a batch of the
+     * coalescer is in flight.
+     * @param max_batch Maximum number of keys of a batch, must be positive.
+     */
+    RpcCoalescer(BatchFn batch_fn, std::chrono::microseconds window,
+                 size_t max_batch)
+        : batch_fn_(std::move(batch_fn)),
+          window_(window),
+          max_batch_(max_batch) {}
+
+    RpcCoalescer(const RpcCoalescer&) = delete;
+    RpcCoalescer& operator=(const RpcCoalescer&) = delete;
+
+    /**
+     * @brief Run the batch call for a single key, sharing it with the
+     * concurrent callers.
+     */
+    tl::expected<Result, ErrorCode> Call(const std::string& key) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::shared_ptr<Batch> batch = open_;
+        const bool leader = batch == nullptr;
+        if (leader) {
+            batch = std::make_shared<Batch>();
+            open_ = batch;
+        }
+        const size_t index = batch->keys.size();
+        batch->keys.push_back(key);
+
+        if (!leader) {
+            if (batch->keys.size() >= max_batch_) {
+                cv_.notify_all();
+            }
+            cv_.wait(lock, [&] { return batch->done; });
+            return std::move(batch->results[index]);
+        }
+
+        if (in_flight_ > 0) {
+            cv_.wait_for(lock, window_, [&] {
+                return batch->keys.size() >= max_batch_;
+            });
+        }
+        // Later callers start the next batch
+        open_ = nullptr;
+        ++in_flight_;
+        lock.unlock();
+
+        Results results = batch_fn_(batch->keys);
+        if (results.size() != batch->keys.size()) {
+            results.assign(batch->keys.size(),
+                           tl::make_unexpected(ErrorCode::RPC_FAIL));
+        }
+
+        lock.lock();
+        --in_flight_;
+        batch->results = std::move(results);
+        batch->done = true;
+        cv_.notify_all();
+        return std::move(batch->results[index]);
+    }
+
+   private:
+    struct Batch {
+        std::vector<std::string> keys;
+        Results results;
+        bool done = false;
+    };
+
+    const BatchFn batch_fn_;
+    const std::chrono::microseconds window_;
+    const size_t max_batch_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    // Batch still collecting keys, if any
+    std::shared_ptr<Batch> open_;
+    // Batches sent and not answered yet
+    size_t in_flight_ = 0;
+};
+
+}  // namespace mooncake
@@ -9,7 +9,9 @@
 #include <ylt/coro_rpc/coro_rpc_server.hpp>
 #include <ylt/util/tl/expected.hpp>
 
+#include "flat_replica_list.h"
 #include "master_service.h"
+#include "slow_rpc_sampler.h"
 #include "types.h"
 #include "rpc_types.h"
 #include "master_config.h"
@@ -34,6 +36,13 @@ class WrappedMasterService {
     std::vector<tl::expected<bool, ErrorCode>> BatchExistKey(
         const std::vector<std::string>& keys);
 
+    tl::expected<uint64_t, ErrorCode> BatchExistKeyPrefix(
+        const std::vector<std::string>& keys);
+
+    tl::expected<ScanKeysResponse, ErrorCode> ScanKeys(
+        const ScanKeysCursor& cursor, uint64_t limit,
+        const std::string& prefix, bool with_metadata);
+
     tl::expected<
         std::unordered_map<UUID, std::vector<std::string>, boost::hash<UUID>>,
         ErrorCode>
@@ -54,29 +63,57 @@ class WrappedMasterService {
     std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>
     BatchGetReplicaList(const std::vector<std::string>& keys);
 
+    // BatchGetReplicaList with the results encoded as flat arrays
+    FlatReplicaLists BatchGetReplicaListFlat(
+        const std::vector<std::string>& keys);
+
     tl::expected<std::vector<Replica::Descriptor>, ErrorCode> PutStart(
         const UUID& client_id, const std::string& key,
         const uint64_t slice_length, const ReplicateConfig& config);
 
-    tl::expected<void, ErrorCode> PutEnd(const UUID& client_id,
-                                         const std::string& key,
-                                         ReplicaType replica_type);
+    tl::expected<void, ErrorCode> PutEnd(
+        const UUID& client_id, const std::string& key, ReplicaType replica_type,
+        std::optional<uint32_t> checksum = std::nullopt);
 
     tl::expected<void, ErrorCode> PutRevoke(const UUID& client_id,
                                             const std::string& key,
                                             ReplicaType replica_type);
 
+    tl::expected<std::vector<Replica::Descriptor>, ErrorCode> StreamPutStart(
+        const UUID& client_id, const std::string& key,
+        const std::vector<uint64_t>& chunk_lengths,
+        const ReplicateConfig& config);
+
+    tl::expected<void, ErrorCode> StreamPutCommit(const UUID& client_id,
+                                                  const std::string& key,
+                                                  uint64_t first_chunk,
+                                                  uint64_t num_chunks);
+
+    tl::expected<GetStreamReplicaListResponse, ErrorCode>
+    GetStreamReplicaList(const std::string& key);
+
     std::vector<tl::expected<std::vector<Replica::Descriptor>, ErrorCode>>
     BatchPutStart(const UUID& client_id, const std::vector<std::string>& keys,
                   const std::vector<uint64_t>& slice_lengths,
                   const ReplicateConfig& config);
 
     std::vector<tl::expected<void, ErrorCode>> BatchPutEnd(
-        const UUID& client_id, const std::vector<std::string>& keys);
+        const UUID& client_id, const std::vector<std::string>& keys,
+        const std::vector<uint32_t>& checksums = {});
 
     std::vector<tl::expected<void, ErrorCode>> BatchPutRevoke(
         const UUID& client_id, const std::vector<std::string>& keys);
 
+    tl::expected<PutLease, ErrorCode> GrantPutLease(
+        const UUID& client_id, uint64_t slice_length, uint64_t slot_count,
+        const ReplicateConfig& config);
+
+    std::vector<tl::expected<void, ErrorCode>> BatchLeasedPutEnd(
+        const UUID& client_id, const std::vector<LeasedPut>& puts);
+
+    tl::expected<void, ErrorCode> ReleasePutLease(const UUID& client_id,
+                                                  uint64_t lease_id);
+
     tl::expected<void, ErrorCode> Remove(const std::string& key,
                                          bool force = false);
 
@@ -98,7 +135,12 @@ class WrappedMasterService {
 
     tl::expected<GetStorageConfigResponse, ErrorCode> GetStorageConfig();
 
-    tl::expected<PingResponse, ErrorCode> Ping(const UUID& client_id);
+    tl::expected<PingResponse, ErrorCode> Ping(
+        const UUID& client_id, const ClientLoadReport& load_report,
+        std::optional<uint64_t> put_sequence_id);
+
+    std::vector<tl::expected<BatchPingResponse, ErrorCode>> BatchPing(
+        const std::vector<BatchPingRequest>& requests);
 
     tl::expected<std::string, ErrorCode> ServiceReady();
 
@@ -123,6 +165,13 @@ class WrappedMasterService {
     tl::expected<std::vector<TaskAssignment>, ErrorCode> FetchTasks(
         const UUID& client_id, size_t batch_size);
 
+    // FetchTasks held open for up to wait_ms until a task arrives, answered
+    // asynchronously so that waiting does not take up an RPC thread
+    void WaitTasks(
+        coro_rpc::context<tl::expected<std::vector<TaskAssignment>, ErrorCode>>
+            context,
+        UUID client_id, size_t batch_size, uint64_t wait_ms);
+
     tl::expected<void, ErrorCode> MarkTaskToComplete(
         const UUID& client_id, const TaskCompleteRequest& request);
 
@@ -147,8 +196,19 @@ class WrappedMasterService {
     tl::expected<void, ErrorCode> MoveRevoke(const UUID& client_id,
                                              const std::string& key);
 
+    tl::expected<FetchOpLogResponse, ErrorCode> FetchOpLog(
+        uint64_t start_sequence_id, uint64_t max_entries);
+
+    tl::expected<StandbySnapshotResponse, ErrorCode> GetStandbySnapshot();
+
+    // Used by the master supervisor to replicate the leader and to take over
+    // when this master becomes the leader. Not exposed by rpc.
+    MasterService& GetMasterService() { return master_service_; }
+
    private:
     MasterService master_service_;
+    // Slowest RPCs of each metric report interval, logged with the report
+    SlowRpcSampler slow_rpc_sampler_;
     std::thread metric_report_thread_;
     coro_http::coro_http_server http_server_;
     std::atomic<bool> metric_report_running_;
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "types.h"
+#include "op_log.h"
 #include "replica.h"
+#include "segment_load_tracker.h"
 #include "task_manager.h"
 
 namespace mooncake {
@@ -12,6 +14,12 @@ namespace mooncake {
 struct PingResponse {
     ViewVersionId view_version_id;
     ClientStatus client_status;
+    // Put notifications, for clients caching missing keys: the sequence id
+    // to ask from in the next ping, and HashRing::Hash of the keys put since
+    // the one asked for. If truncated, some puts are not listed.
+    uint64_t put_sequence_id{0};
+    std::vector<uint64_t> put_key_hashes;
+    bool put_keys_truncated{false};
 
     PingResponse() = default;
     PingResponse(ViewVersionId view_version, ClientStatus status)
@@ -24,7 +32,8 @@ struct PingResponse {
                   << ", client_status: " << response.client_status << " }";
     }
 };
-YLT_REFL(PingResponse, view_version_id, client_status);
+YLT_REFL(PingResponse, view_version_id, client_status, put_sequence_id,
+         put_key_hashes, put_keys_truncated);
 
 /**
  * @brief Response structure for GetReplicaList operation
@@ -32,6 +41,11 @@ YLT_REFL(PingResponse, view_version_id, client_status);
 struct GetReplicaListResponse {
     std::vector<Replica::Descriptor> replicas;
     uint64_t lease_ttl_ms;
+    // The object is read from disk often enough that the reader should copy
+    // it back to memory
+    bool promote{false};
+    // CRC32C of the object, if its writer computed one
+    std::optional<uint32_t> checksum;
 
     GetReplicaListResponse() : lease_ttl_ms(0) {}
     GetReplicaListResponse(std::vector<Replica::Descriptor>&& replicas_param,
@@ -39,7 +53,66 @@ struct GetReplicaListResponse {
         : replicas(std::move(replicas_param)),
           lease_ttl_ms(lease_ttl_ms_param) {}
 };
-YLT_REFL(GetReplicaListResponse, replicas, lease_ttl_ms);
+YLT_REFL(GetReplicaListResponse, replicas, lease_ttl_ms, promote, checksum);
+
+/**
+ * @brief Response structure for GetStreamReplicaList operation
+ */
+struct GetStreamReplicaListResponse {
+    std::vector<Replica::Descriptor> replicas;
+    uint64_t lease_ttl_ms{0};
+    // Chunks of a streamed put still in progress, and which of them are
+    // written, bit i % 64 of word i / 64 for chunk i. Both are empty once
+    // the object is complete.
+    std::vector<uint64_t> chunk_lengths;
+    std::vector<uint64_t> committed;
+
+    bool is_streaming() const { return !chunk_lengths.empty(); }
+
+    // Whether [offset, offset + length) of the object may be read
+    bool IsReadable(uint64_t offset, uint64_t length) const {
+        if (!is_streaming()) return true;
+        uint64_t chunk_start = 0;
+        for (size_t i = 0; i < chunk_lengths.size(); ++i) {
+            const uint64_t chunk_end = chunk_start + chunk_lengths[i];
+            if (chunk_end > offset && chunk_start < offset + length &&
+                (i / 64 >= committed.size() ||
+                 !(committed[i / 64] & (1ULL << (i % 64))))) {
+                return false;
+            }
+            chunk_start = chunk_end;
+        }
+        return offset + length <= chunk_start;
+    }
+};
+YLT_REFL(GetStreamReplicaListResponse, replicas, lease_ttl_ms, chunk_lengths,
+         committed);
+
+/**
+ * @brief Response structure for GrantPutLease operation: the replicas of
+ * slots for puts of slice_length bytes, which the client may write until the
+ * lease expires and then report with BatchLeasedPutEnd, without PutStart
+ */
+struct PutLease {
+    uint64_t lease_id{0};
+    uint64_t slice_length{0};
+    uint64_t ttl_ms{0};
+    std::vector<std::vector<Replica::Descriptor>> slots;
+};
+YLT_REFL(PutLease, lease_id, slice_length, ttl_ms, slots);
+
+/**
+ * @brief A put written to a slot of a PutLease. Of the config, only what
+ * does not affect placement is used: with_soft_pin, ttl_ms and cost_hint.
+ */
+struct LeasedPut {
+    std::string key;
+    uint64_t lease_id{0};
+    uint64_t slot{0};
+    ReplicateConfig config;
+    std::optional<uint32_t> checksum;
+};
+YLT_REFL(LeasedPut, key, lease_id, slot, config, checksum);
 
 /**
  * @brief Response structure for GetStorageConfig operation
@@ -113,7 +186,7 @@ YLT_REFL(QueryTaskResponse, id, type, status, created_at_ms_epoch,
 struct TaskAssignment {
     UUID id;
     TaskType type;
-    std::string payload;
+    TaskPayload payload;
     int64_t created_at_ms_epoch;
     uint32_t max_retry_attempts;
 
@@ -143,20 +216,107 @@ struct TaskCompleteRequest {
 };
 YLT_REFL(TaskCompleteRequest, id, status, message);
 
+/**
+ * @brief Heartbeat of one client in a BatchPing, sent on its behalf by the
+ * PingAggregator of its process. The fields are the arguments of Ping.
+ */
+struct BatchPingRequest {
+    UUID client_id;
+    ClientLoadReport load_report;
+    std::optional<uint64_t> put_sequence_id;
+    // Most tasks to fetch for the client along with the ping, 0 for none
+    uint64_t task_batch_size{0};
+};
+YLT_REFL(BatchPingRequest, client_id, load_report, put_sequence_id,
+         task_batch_size);
+
+/**
+ * @brief Answer to one BatchPingRequest: the ping response of the client and
+ * the tasks fetched for it
+ */
+struct BatchPingResponse {
+    PingResponse ping;
+    std::vector<TaskAssignment> tasks;
+};
+YLT_REFL(BatchPingResponse, ping, tasks);
+
 struct BatchGetOffloadObjectResponse {
     std::vector<uint64_t> pointers;
     std::string transfer_engine_addr;
     uint64_t gc_ttl_ms;
+    // Released by the reader through release_offload_object once read
+    uint64_t batch_id{0};
 
     BatchGetOffloadObjectResponse() = default;
     BatchGetOffloadObjectResponse(std::vector<uint64_t>&& pointers_param,
                                   std::string transfer_engine_addr_param,
-                                  uint64_t gc_ttl_ms_param)
+                                  uint64_t gc_ttl_ms_param,
+                                  uint64_t batch_id_param)
         : pointers(std::move(pointers_param)),
           transfer_engine_addr(std::move(transfer_engine_addr_param)),
-          gc_ttl_ms(gc_ttl_ms_param) {}
+          gc_ttl_ms(gc_ttl_ms_param),
+          batch_id(batch_id_param) {}
 };
 YLT_REFL(BatchGetOffloadObjectResponse, pointers, transfer_engine_addr,
-         gc_ttl_ms);
+         gc_ttl_ms, batch_id);
+
+/**
+ * @brief Response structure for FetchOpLog operation, used by standby masters
+ */
+struct FetchOpLogResponse {
+    std::vector<OpLogEntry> entries;
+    uint64_t next_sequence_id{0};  // the leader's next sequence id
+
+    FetchOpLogResponse() = default;
+};
+YLT_REFL(FetchOpLogResponse, entries, next_sequence_id);
+
+/**
+ * @brief Response structure for GetStandbySnapshot operation. The snapshot
+ * reflects every operation log entry before sequence_id.
+ */
+struct StandbySnapshotResponse {
+    uint64_t sequence_id{0};
+    std::vector<SerializedByte> data;
+
+    StandbySnapshotResponse() = default;
+};
+YLT_REFL(StandbySnapshotResponse, sequence_id, data);
+
+/**
+ * @brief Position of a key scan: the metadata shard it is in and the last
+ * key returned from it. Keys of a shard are returned in order, so keys
+ * added or removed while scanning do not make others repeat or go missing.
+ */
+struct ScanKeysCursor {
+    uint64_t shard{0};
+    std::string after;  // empty at the start of a shard
+    // Master the scan is in, only used by partitioned clients
+    uint32_t partition{0};
+};
+YLT_REFL(ScanKeysCursor, shard, after, partition);
+
+/**
+ * @brief A scanned key, with its metadata if requested
+ */
+struct ScanKeysEntry {
+    std::string key;
+    uint64_t size{0};
+    uint32_t num_replicas{0};
+    bool soft_pinned{false};
+};
+YLT_REFL(ScanKeysEntry, key, size, num_replicas, soft_pinned);
+
+/**
+ * @brief Response structure for ScanKeys operation
+ */
+struct ScanKeysResponse {
+    std::vector<ScanKeysEntry> entries;
+    ScanKeysCursor next;  // where to continue unless done
+    bool done{false};
+
+    ScanKeysResponse() = default;
+};
+YLT_REFL(ScanKeysResponse, entries, next, done);
 
 }  // namespace mooncake
@@ -10,6 +10,7 @@
 
 #include "allocation_strategy.h"
 #include "allocator.h"
+#include "mutex.h"
 #include "types.h"
 
 namespace mooncake {
@@ -74,6 +75,15 @@ class ScopedSegmentAccess {
                                  std::shared_mutex& mutex)
         : segment_manager_(segment_manager), lock_(mutex) {}
 
+    /**
+     * @brief Acquires a shared lock on the segment mutex. Only the const
+     * query methods may be used, which then run concurrently with each
+     * other and with allocations.
+     */
+    ScopedSegmentAccess(SegmentManager* segment_manager,
+                        std::shared_mutex& mutex, const shared_lock_t&)
+        : segment_manager_(segment_manager), shared_lock_(mutex) {}
+
     /**
      * @brief Mount a segment
      */
@@ -110,17 +120,22 @@ class ScopedSegmentAccess {
     ErrorCode GetClientSegments(const UUID& client_id,
                                 std::vector<Segment>& segments) const;
 
+    /**
+     * @brief Get the ids of all the clients that have mounted segments
+     */
+    void GetAllClients(std::vector<UUID>& client_ids) const;
+
     /**
      * @brief Get the names of all the segments
      */
-    ErrorCode GetAllSegments(std::vector<std::string>& all_segments);
+    ErrorCode GetAllSegments(std::vector<std::string>& all_segments) const;
 
     /**
      * @brief Get the segment by name. If there are multiple segments with the
      * same name, return the first one.
      */
     ErrorCode QuerySegments(const std::string& segment, size_t& used,
-                            size_t& capacity);
+                            size_t& capacity) const;
 
     /**
      * @brief Get the client id by segment name.
@@ -133,9 +148,45 @@ class ScopedSegmentAccess {
      */
     bool ExistsSegmentName(const std::string& segment_name) const;
 
+    /**
+     * @brief Select the segment with the most free space among those that
+     * are not on CXL memory and have a free region of at least size bytes,
+     * skipping the excluded ones
+     * @return ErrorCode::NO_AVAILABLE_HANDLE if no segment has room
+     */
+    ErrorCode SelectDramSegment(
+        size_t size, std::string& segment_name,
+        const std::vector<std::string>& excluded = {}) const;
+
+    /**
+     * @brief Serialize the mounted segments, including the state of their
+     * allocators, and the local disk segments for a master snapshot. Every
+     * serialized allocator is assigned an id in allocator_index.
+     * @return ErrorCode::UNAVAILABLE_IN_CURRENT_MODE if the allocators cannot
+     * be serialized, i.e. they are not OffsetBufferAllocator.
+     */
+    ErrorCode SerializeSegments(std::vector<SerializedByte>& buffer,
+                                AllocatorIndex& allocator_index) const;
+
+    /**
+     * @brief Mount the segments serialized by SerializeSegments(). The
+     * restored allocators are returned ordered by their ids, together with
+     * the owners of the restored segments.
+     */
+    ErrorCode DeserializeSegments(
+        SerializerReader& reader,
+        std::vector<std::shared_ptr<OffsetBufferAllocator>>& allocators,
+        std::vector<UUID>& client_ids);
+
    private:
+    template <typename T>
+    void SerializeSegmentsTo(T& serializer,
+                             AllocatorIndex& allocator_index) const;
+
     SegmentManager* segment_manager_;
+    // Exactly one of the two locks is held
     std::unique_lock<std::shared_mutex> lock_;
+    std::shared_lock<std::shared_mutex> shared_lock_;
 };
 
 /**
@@ -143,14 +194,43 @@ class ScopedSegmentAccess {
  */
 class ScopedAllocatorAccess {
    public:
-    explicit ScopedAllocatorAccess(const AllocatorManager& allocator_manager,
-                                   std::shared_mutex& mutex)
-        : allocator_manager_(allocator_manager), lock_(mutex) {}
+    explicit ScopedAllocatorAccess(
+        const AllocatorManager& allocator_manager,
+        const std::unordered_map<UUID, MountedSegment, boost::hash<UUID>>&
+            mounted_segments,
+        const std::unordered_map<UUID, std::vector<UUID>, boost::hash<UUID>>&
+            client_segments,
+        std::shared_mutex& mutex)
+        : allocator_manager_(allocator_manager),
+          mounted_segments_(mounted_segments),
+          client_segments_(client_segments),
+          lock_(mutex) {}
 
     const AllocatorManager& getAllocatorManager() { return allocator_manager_; }
 
+    // Failure domain of the segments the client mounted, empty if unknown
+    const std::string& getClientFailureDomain(const UUID& client_id) const {
+        static const std::string kUnknown;
+        auto it = client_segments_.find(client_id);
+        if (it == client_segments_.end()) {
+            return kUnknown;
+        }
+        for (const auto& segment_id : it->second) {
+            auto segment_it = mounted_segments_.find(segment_id);
+            if (segment_it != mounted_segments_.end() &&
+                !segment_it->second.segment.failure_domain.empty()) {
+                return segment_it->second.segment.failure_domain;
+            }
+        }
+        return kUnknown;
+    }
+
    private:
     const AllocatorManager& allocator_manager_;
+    const std::unordered_map<UUID, MountedSegment, boost::hash<UUID>>&
+        mounted_segments_;
+    const std::unordered_map<UUID, std::vector<UUID>, boost::hash<UUID>>&
+        client_segments_;
     std::shared_lock<std::shared_mutex> lock_;
 };
 
@@ -192,11 +272,25 @@ class SegmentManager {
     /**
      * @brief Constructor for SegmentManager
      * @param memory_allocator Type of buffer allocator to use for new segments
+     * @param allocator_cache_max_size Largest allocation served from the
+     * per-thread caches of offset allocators, 0 disables the caches
+     * @param slab_size Size of the slabs of slab allocators
+     * @param slab_class_min_count Allocations of one size needed before slab
+     * allocators serve that size from slabs
      */
     explicit SegmentManager(
         BufferAllocatorType memory_allocator = BufferAllocatorType::CACHELIB,
-        bool enable_cxl = false)
-        : memory_allocator_(memory_allocator), enable_cxl_(enable_cxl) {}
+        bool enable_cxl = false, uint64_t allocator_cache_max_size = 0,
+        uint64_t slab_size = DEFAULT_SLAB_SIZE,
+        uint32_t slab_class_min_count = DEFAULT_SLAB_CLASS_MIN_COUNT)
+        : memory_allocator_(memory_allocator),
+          enable_cxl_(enable_cxl),
+          allocator_cache_max_size_(allocator_cache_max_size) {
+        if (memory_allocator_ == BufferAllocatorType::SLAB) {
+            size_classes_ = std::make_shared<SizeClassRegistry>(
+                slab_size, slab_class_min_count);
+        }
+    }
 
     /**
      * @brief Get RAII-style access to segment management operations
@@ -206,12 +300,22 @@ class SegmentManager {
         return ScopedSegmentAccess(this, segment_mutex_);
     }
 
+    /**
+     * @brief Get RAII-style read-only access to the mounted segments
+     * @return const ScopedSegmentAccess object sharing the lock with
+     * allocations and other readers, so mount/unmount is the only writer
+     */
+    const ScopedSegmentAccess getSegmentReadAccess() {
+        return ScopedSegmentAccess(this, segment_mutex_, shared_lock);
+    }
+
     /**
      * @brief Get RAII-style access to use allocators
      * @return ScopedAllocatorAccess object that holds the lock
      */
     ScopedAllocatorAccess getAllocatorAccess() {
-        return ScopedAllocatorAccess(allocator_manager_, segment_mutex_);
+        return ScopedAllocatorAccess(allocator_manager_, mounted_segments_,
+                                     client_segments_, segment_mutex_);
     }
 
     ScopedLocalDiskSegmentAccess getLocalDiskSegmentAccess() {
@@ -230,6 +334,10 @@ class SegmentManager {
     // This singleton allocator is managed by the master
     // Used for unified allocation and recycling of CXL shared memory.
     const bool enable_cxl_;
+    const uint64_t allocator_cache_max_size_;
+    // Size classes shared by the allocators of all segments, only set for
+    // BufferAllocatorType::SLAB
+    std::shared_ptr<SizeClassRegistry> size_classes_;
     std::shared_ptr<BufferAllocatorBase> cxl_global_allocator_;
     // allocator_manager_ only contains allocators whose segment status is OK.
     AllocatorManager allocator_manager_;
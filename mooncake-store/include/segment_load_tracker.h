@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+namespace mooncake {
+
+/**
+ * @brief Bytes a client transferred from and to the segments of one
+ *        transport endpoint since its previous heartbeat.
+ */
+struct SegmentTraffic {
+    std::string endpoint;
+    uint64_t read_bytes{0};
+    uint64_t write_bytes{0};
+};
+YLT_REFL(SegmentTraffic, endpoint, read_bytes, write_bytes);
+
+/**
+ * @brief Load report carried by client heartbeats.
+ */
+struct ClientLoadReport {
+    // Transport endpoint of the reporting client and the rack it runs in.
+    // Empty if unknown.
+    std::string endpoint;
+    std::string rack;
+    std::vector<SegmentTraffic> traffic;
+};
+YLT_REFL(ClientLoadReport, endpoint, rack, traffic);
+
+/**
+ * @brief Recent bandwidth and topology of the segment endpoints, built from
+ *        the load reports of the clients.
+ *
+ * The traffic reported for an endpoint is summed over all clients and
+ * decays exponentially, so the bandwidth follows the last few decay
+ * periods. Endpoints on the same host are at distance 0, endpoints whose
+ * clients reported the same rack at distance 1, and all others at
+ * distance 2.
+ *
+ * @note Thread safety: all methods are thread safe. Reports take the lock
+ * exclusively, queries share it.
+ */
+class SegmentLoadTracker {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int kSameHost = 0;
+    static constexpr int kSameRack = 1;
+    static constexpr int kRemote = 2;
+
+    explicit SegmentLoadTracker(
+        std::chrono::milliseconds decay_period = std::chrono::seconds(10));
+
+    void Report(const ClientLoadReport& report,
+                Clock::time_point now = Clock::now());
+
+    // Bytes per second recently read from and written to the endpoint
+    double GetBandwidth(const std::string& endpoint,
+                        Clock::time_point now = Clock::now()) const;
+
+    // Mean bandwidth over the endpoints with reported traffic
+    double GetMeanBandwidth(Clock::time_point now = Clock::now()) const;
+
+    int GetDistance(const std::string& endpoint_a,
+                    const std::string& endpoint_b) const;
+
+    // Host part of an endpoint of the form host:port or [ipv6]:port
+    static std::string HostOf(const std::string& endpoint);
+
+   private:
+    struct DecayedBytes {
+        double bytes{0};
+        Clock::time_point updated{};
+    };
+
+    double Decayed(const DecayedBytes& value, Clock::time_point now) const;
+    void Add(DecayedBytes& value, double bytes, Clock::time_point now);
+
+    const double decay_period_sec_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, DecayedBytes> endpoints_;
+    DecayedBytes total_;
+    // Host to rack
+    std::unordered_map<std::string, std::string> racks_;
+};
+
+}  // namespace mooncake
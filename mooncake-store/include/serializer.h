@@ -283,6 +283,11 @@ class SerializerReader {
      */
     bool finish_read() const { return offset_ == size_; }
 
+    /**
+     * @brief Returns the number of bytes that have not been read yet
+     */
+    size_t remaining() const { return size_ - offset_; }
+
    private:
     const void*
         buffer_;   ///< Pointer to the source buffer containing serialized data
@@ -290,6 +295,36 @@ class SerializerReader {
     size_t offset_;  ///< Current read position within the buffer
 };
 
+/**
+ * @brief Serializes a string as its length followed by its bytes.
+ * @tparam T SerializeSizeCounter or SerializeWriter
+ */
+template <typename T>
+void serialize_string(T& serializer, const std::string& str) {
+    uint64_t length = str.size();
+    serializer.write(&length, sizeof(length));
+    if (length > 0) {
+        serializer.write(str.data(), length);
+    }
+}
+
+/**
+ * @brief Deserializes a string written by serialize_string().
+ * @throws std::runtime_error if the buffer is corrupted
+ */
+inline std::string deserialize_string(SerializerReader& reader) {
+    uint64_t length = 0;
+    reader.read(&length, sizeof(length));
+    if (length > reader.remaining()) {
+        throw std::runtime_error("buffer_overflow");
+    }
+    std::string str(length, '\0');
+    if (length > 0) {
+        reader.read(str.data(), length);
+    }
+    return str;
+}
+
 /**
  * @brief Serializes an object to a byte buffer using two-pass approach.
  * @tparam T Type that implements serialize_to(SerializeSizeCounter&) and
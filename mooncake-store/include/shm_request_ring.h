@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ylt/util/tl/expected.hpp>
+
+#include "replica.h"
+#include "types.h"
+
+namespace mooncake {
+
+/**
+ * @brief Request ring shared by a DummyClient and its co-located RealClient.
+ *
+ * The ring lives in a memfd segment the dummy client creates and hands to
+ * the real client over the IPC socket, next to its data segments. It holds
+ * num_slots request slots and a bounded lock-free submission queue of slot
+ * indexes (Vyukov's MPMC queue), so any number of dummy client threads
+ * submit and several real client threads serve. A submitter encodes its
+ * request in a free slot, enqueues the slot and rings the doorbell, a futex
+ * the servers sleep on once they find the queue empty. The server writes the
+ * results back into the slot and flips its state word, another futex on
+ * which the submitter waits. Neither side serializes through coro_rpc nor
+ * goes through a socket on this path.
+ *
+ * Only batch_get_into and batch_put_from travel through the ring; requests
+ * that do not fit a slot, or find no free slot, are left to the caller's
+ * RPC path.
+ */
+class ShmRequestRing {
+   public:
+    static constexpr uint32_t kDefaultSlots = 32;
+    static constexpr size_t kDefaultSlotSize = 128 * 1024;
+
+    enum class Op : uint32_t {
+        BATCH_GET_INTO = 1,
+        BATCH_PUT_FROM = 2,
+    };
+
+    struct Request {
+        Op op = Op::BATCH_GET_INTO;
+        std::vector<std::string> keys;
+        // Addresses in the dummy client's address space
+        std::vector<uint64_t> buffers;
+        std::vector<size_t> sizes;
+        // BATCH_PUT_FROM only; preferred segments are not carried
+        ReplicateConfig config;
+    };
+
+    // Fills one result per key, as to_py_ret() would return it
+    using Handler =
+        std::function<void(const Request &, std::vector<int64_t> &)>;
+
+    // Creates a ring in a new memfd segment, for the dummy client
+    static tl::expected<std::shared_ptr<ShmRequestRing>, ErrorCode> Create(
+        uint32_t num_slots = kDefaultSlots,
+        size_t slot_size = kDefaultSlotSize);
+
+    // Maps the ring a dummy client sent, for the real client. Takes over fd.
+    static tl::expected<std::shared_ptr<ShmRequestRing>, ErrorCode> Attach(
+        int fd, size_t size);
+
+    ~ShmRequestRing();
+
+    ShmRequestRing(const ShmRequestRing &) = delete;
+    ShmRequestRing &operator=(const ShmRequestRing &) = delete;
+
+    int fd() const { return fd_; }
+    size_t size() const { return size_; }
+
+    // Whether the request can be carried by a slot at all
+    bool Fits(const Request &request) const;
+
+    /**
+     * @brief Runs the request through the ring and waits for its results.
+     * Returns BUFFER_OVERFLOW without submitting if the request does not fit
+     * or no slot is free. While waiting, alive() is polled every
+     * kWaitTimeoutMs; once it is false RPC_FAIL is returned and the slot is
+     * never reused, since the server may still write to it.
+     */
+    tl::expected<std::vector<int64_t>, ErrorCode> Submit(
+        const Request &request, const std::function<bool()> &alive);
+
+    // Serves requests until Stop(); one call per serving thread
+    void Serve(const Handler &handler);
+
+    // Makes every Serve() call return
+    void Stop();
+
+   private:
+    static constexpr uint32_t kMagic = 0x4d435252;  // "MCRR"
+    static constexpr int kWaitTimeoutMs = 100;
+    static constexpr int kServerSpinUs = 50;
+
+    struct Header;
+    struct Cell;
+    struct Slot;
+
+    ShmRequestRing(int fd, void *base, size_t size, uint32_t num_slots,
+                   size_t slot_size);
+
+    static size_t SegmentSize(uint32_t num_slots, size_t slot_size);
+
+    Header *header() const;
+    Cell *cells() const;
+    Slot *slot(uint32_t index) const;
+    size_t PayloadCapacity() const;
+
+    bool Enqueue(uint32_t index);
+    bool Dequeue(uint32_t &index);
+    void RingDoorbell();
+
+    void Encode(const Request &request, Slot *slot) const;
+    // false if the slot does not hold a well-formed request
+    bool Decode(const Slot *slot, Request &request) const;
+    void Complete(Slot *slot, const std::vector<int64_t> &results);
+
+    int fd_ = -1;
+    void *base_ = nullptr;
+    size_t size_ = 0;
+    // Validated copies, so that the peer cannot change the geometry later
+    uint32_t num_slots_ = 0;
+    size_t slot_size_ = 0;
+
+    // Process local: free slots of the submitting side, stop flag of the
+    // serving side
+    std::mutex free_mutex_;
+    std::vector<uint32_t> free_slots_;
+    std::atomic<bool> stopped_{false};
+};
+
+}  // namespace mooncake
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mooncake {
+
+struct SlowRpcSample {
+    std::string rpc;
+    // The key of a single-key RPC, or the first key of a batch
+    std::string key;
+    size_t batch_size = 0;
+    uint64_t latency_us = 0;
+};
+
+/**
+ * @brief Keeps the slowest RPCs seen since the last Drain.
+ *
+ * Once capacity samples are held, an RPC no slower than the fastest of them
+ * is dropped after a single atomic load, so offering every RPC is cheap.
+ */
+class SlowRpcSampler {
+   public:
+    /**
+     * @param capacity Number of samples kept per interval, 0 to disable.
+     */
+    explicit SlowRpcSampler(size_t capacity) : capacity_(capacity) {
+        samples_.reserve(capacity_);
+    }
+
+    SlowRpcSampler(const SlowRpcSampler&) = delete;
+    SlowRpcSampler& operator=(const SlowRpcSampler&) = delete;
+
+    bool enabled() const { return capacity_ > 0; }
+
+    void Offer(std::string_view rpc, std::string_view key, size_t batch_size,
+               uint64_t latency_us) {
+        if (!enabled() ||
+            latency_us <= threshold_us_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (samples_.size() == capacity_) {
+            if (latency_us <= samples_.front().latency_us) {
+                return;
+            }
+            std::pop_heap(samples_.begin(), samples_.end(), Slower);
+            samples_.pop_back();
+        }
+        samples_.push_back(SlowRpcSample{std::string(rpc), std::string(key),
+                                         batch_size, latency_us});
+        std::push_heap(samples_.begin(), samples_.end(), Slower);
+        if (samples_.size() == capacity_) {
+            threshold_us_.store(samples_.front().latency_us,
+                                std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Take the samples of the interval, slowest first, and start the
+     * next interval.
+     */
+    std::vector<SlowRpcSample> Drain() {
+        std::vector<SlowRpcSample> samples;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            samples.swap(samples_);
+            samples_.reserve(capacity_);
+            threshold_us_.store(0, std::memory_order_relaxed);
+        }
+        std::sort_heap(samples.begin(), samples.end(), Slower);
+        return samples;
+    }
+
+   private:
+    // Orders samples_ as a min-heap on latency, fastest sample at the front
+    static bool Slower(const SlowRpcSample& a, const SlowRpcSample& b) {
+        return a.latency_us > b.latency_us;
+    }
+
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::vector<SlowRpcSample> samples_;
+    // Latency an RPC must exceed to be kept, once samples_ is full
+    std::atomic<uint64_t> threshold_us_{0};
+};
+
+}  // namespace mooncake
@@ -3,12 +3,19 @@
 #include <glog/logging.h>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "bloom_filter.h"
+#include "client_buffer.hpp"
+#include "compression.h"
 #include "file_interface.h"
 #include "mutex.h"
 #include "offset_allocator/offset_allocator.hpp"
@@ -23,9 +30,15 @@ struct FileRecord {
 struct BucketObjectMetadata {
     int64_t offset;
     int64_t key_size;
+    // Size of the value as offloaded and loaded
     int64_t data_size;
+    // Bytes of the value in the bucket file and their CompressionCodec when
+    // it is compressed; 0 when the value is stored raw, as data_size bytes
+    int64_t stored_size = 0;
+    uint32_t codec = 0;
 };
-YLT_REFL(BucketObjectMetadata, offset, key_size, data_size);
+YLT_REFL(BucketObjectMetadata, offset, key_size, data_size, stored_size,
+         codec);
 
 struct BucketMetadata {
     int64_t meta_size;
@@ -158,6 +171,17 @@ struct FilePerKeyConfig {
 
     bool enable_eviction = true;  // Enable eviction for storage
 
+    // Values of at most this many bytes are coalesced by an in-memory log
+    // into pack files instead of getting a file each; 0 disables aggregation
+    int64_t aggregate_value_size_limit = 0;
+
+    // Capacity of the aggregation log, flushed as one pack file when full
+    int64_t aggregate_buffer_size = 16 * kMB;
+
+    // Longest time a value waits in the aggregation log (in milliseconds);
+    // 0 only writes the log when it is full or the adaptor is destroyed
+    uint32_t aggregate_flush_interval_ms = 100;
+
     bool Validate() const;
 
     static FilePerKeyConfig FromEnvironment();
@@ -169,11 +193,96 @@ struct BucketBackendConfig {
 
     int64_t bucket_keys_limit = 500;  // Max number of keys allowed in a single
                                       // bucket, required by bucket backend only
+
+    // Buckets whose live bytes fall below this percentage of their data size
+    // are rewritten by compaction; 0 disables compaction
+    int64_t compaction_live_percent = 50;
+
+    // Interval between background compaction passes (in seconds); 0 only
+    // compacts on explicit CompactBuckets() calls
+    uint32_t compaction_interval_seconds = 60;
+
+    // Bytes per second compaction may rewrite; 0 is unlimited
+    int64_t compaction_bytes_per_sec = 64 * kMB;
+
+    // Codec compressing values before they are written to buckets; kNone
+    // stores them raw
+    CompressionCodec compression_codec = CompressionCodec::kNone;
+
+    // Compression level of zstd, ignored by lz4
+    int32_t compression_level = 1;
+
+    // Values smaller than this many bytes are stored raw
+    int64_t compression_min_size = 16 * kKB;
+
+    // Values are stored raw unless compression saves at least this
+    // percentage of their size
+    int64_t compression_min_saving_percent = 10;
+
+    // Threads compressing the values of a batch on BatchOffload and
+    // decompressing them on BatchLoad
+    uint32_t compression_threads = 4;
+
+    // Threads reading the bucket files of a BatchLoad concurrently; 1 reads
+    // them one after the other
+    uint32_t load_threads = 4;
+
     bool Validate() const;
 
     static BucketBackendConfig FromEnvironment();
 };
 
+struct OffsetAllocatorBackendConfig {
+    // Keep the object index in an append-only log and checkpoints next to
+    // the data file, so that Init recovers the stored objects in time
+    // proportional to the index instead of truncating the data file
+    bool persist_index = false;
+
+    // The index log is folded into a new checkpoint once it grows past this
+    // many bytes
+    int64_t index_log_checkpoint_bytes = 64 * kMB;
+
+    // Records take a multiple of this many bytes and start on a multiple of
+    // it, e.g. the flash page or erase block size of the device, so that the
+    // extents written and freed line up with what the device erases; a power
+    // of two, 0 packs them. Keep it across restarts with persist_index: the
+    // records recovered are padded to it again.
+    uint64_t allocation_alignment = 0;
+
+    // Extents freed by overwritten records are punched out of the data file
+    // (FALLOC_FL_PUNCH_HOLE), which lets the device reclaim them with TRIM
+    // through the discard mount option or fstrim, once this many bytes are
+    // pending; 0 keeps them allocated
+    int64_t discard_batch_bytes = 0;
+
+    bool Validate() const;
+
+    static OffsetAllocatorBackendConfig FromEnvironment();
+};
+
+/**
+ * @brief Writes and discards of an OffsetAllocatorStorageBackend since
+ * Init().
+ */
+struct OffsetAllocatorDiskStats {
+    // Bytes of the records written, and of the extents allocated for them
+    int64_t record_bytes = 0;
+    int64_t allocated_bytes = 0;
+    // Bytes punched out of the data file, in that many fallocate calls
+    int64_t discarded_bytes = 0;
+    int64_t discard_calls = 0;
+    // Bytes the block device of the data file reports written, by every
+    // writer of the device; -1 if it is not known
+    int64_t device_written_bytes = -1;
+
+    // device_written_bytes per record byte, 0 if either is not known
+    double WriteAmplification() const {
+        return record_bytes > 0 && device_written_bytes >= 0
+                   ? static_cast<double>(device_written_bytes) / record_bytes
+                   : 0.0;
+    }
+};
+
 struct FileStorageConfig {
     // type of the storage backend
     StorageBackendType storage_backend_type = StorageBackendType::kBucket;
@@ -188,6 +297,12 @@ struct FileStorageConfig {
     int64_t scanmeta_iterator_keys_limit =
         20000;  // Max number of keys returned per Scan call, required by bucket
                 // backend only
+    // Threads loading bucket metadata at Init and running ScanMeta handlers
+    // concurrently; 1 keeps both serial
+    uint32_t scanmeta_threads = 4;
+    // Bits per key of the Bloom filter answering IsExist misses without
+    // locks or I/O, sized for total_keys_limit keys; 0 disables it
+    uint32_t key_filter_bits_per_key = 10;
     // Global limits across all buckets
     int64_t total_keys_limit = 10'000'000;  // Maximum total number of keys
     int64_t total_size_limit =
@@ -196,8 +311,8 @@ struct FileStorageConfig {
     // Interval between heartbeats sent to the control plane (in seconds)
     uint32_t heartbeat_interval_seconds = 10;
 
-    // Interval between client_buffer_gc (in seconds)
-    uint32_t client_buffer_gc_interval_seconds = 1;
+    // Lease of the client buffers a BatchGet loads objects into: they are
+    // freed when the reader releases them, or when the lease runs out
     uint64_t client_buffer_gc_ttl_ms = 5000;
 
     // Validates the configuration for correctness and consistency
@@ -251,6 +366,11 @@ class StorageBackendInterface {
     }
 
     FileStorageConfig file_storage_config_;
+
+   protected:
+    // Holds every key the backend stored since Init, and removed keys until
+    // the next Init. Insert a key before it becomes visible to IsExist.
+    BloomFilter key_filter_;
 };
 
 /**
@@ -410,6 +530,28 @@ class StorageBackend {
     tl::expected<void, ErrorCode> LoadObject(const std::string& path,
                                              std::string& str, int64_t length);
 
+    /**
+     * @brief Stores several objects, each from a span of data
+     * @param paths paths for the objects
+     * @param data Data of every object, in the order of paths
+     * @return Result of every object, in the order of paths
+     * @note On 3FS the writes share USRBIO submissions
+     */
+    std::vector<tl::expected<void, ErrorCode>> BatchStoreObjects(
+        const std::vector<std::string>& paths,
+        const std::vector<std::span<const char>>& data);
+
+    /**
+     * @brief Loads several objects as strings
+     * @param paths paths for the objects
+     * @param strs Output strings, each already sized to the expected length
+     * of its object
+     * @return Result of every object, in the order of paths
+     * @note On 3FS the reads share USRBIO submissions
+     */
+    std::vector<tl::expected<void, ErrorCode>> BatchLoadObjects(
+        const std::vector<std::string>& paths, std::vector<std::string>& strs);
+
     /**
      * @brief Deletes the physical file associated with the given object key
      * @param path Path to the file to remove
@@ -581,6 +723,18 @@ class StorageBackend {
     tl::expected<size_t, ErrorCode> WriteDataToFile(
         std::unique_ptr<StorageFile>& file, const std::string& path,
         std::span<const char> data, uint64_t reserved_size = 0);
+
+#ifdef USE_3FS
+    /**
+     * @brief Helper: Opens the files in paths and reads or writes all of them
+     * with ThreeFSFile::batch_io
+     * @param buffers Buffer of every file, in the order of paths
+     * @return Result of every file, in the order of paths
+     */
+    std::vector<tl::expected<void, ErrorCode>> Batch3FSIO(
+        const std::vector<std::string>& paths,
+        const std::vector<std::span<char>>& buffers, FileMode mode);
+#endif
 };
 
 class BucketIdGenerator {
@@ -605,8 +759,17 @@ class StorageBackendAdaptor : public StorageBackendInterface {
     StorageBackendAdaptor(const FileStorageConfig& file_storage_config,
                           const FilePerKeyConfig& file_per_key_config);
 
+    ~StorageBackendAdaptor();
+
     tl::expected<void, ErrorCode> Init() override;
 
+    /**
+     * @brief Stores every object as its own file, except objects of at most
+     * aggregate_value_size_limit bytes, which are copied into the aggregation
+     * log. complete_handler is called for those once the log holding them has
+     * been written as a pack file, possibly by a later call or by the flush
+     * thread.
+     */
     tl::expected<int64_t, ErrorCode> BatchOffload(
         const std::unordered_map<std::string, std::vector<Slice>>& batch_object,
         std::function<ErrorCode(const std::vector<std::string>& keys,
@@ -648,6 +811,80 @@ class StorageBackendAdaptor : public StorageBackendInterface {
 
     std::string ResolvePath(const std::string& key) const;
 
+    std::string PackPath(int64_t pack_id) const;
+
+    using CompleteHandler =
+        std::function<ErrorCode(const std::vector<std::string>& keys,
+                                std::vector<StorageObjectMetadata>& metadatas)>;
+
+    // Keys of one BatchOffload call waiting in the aggregation log
+    struct PendingBatch {
+        uint64_t batch_id;
+        CompleteHandler complete_handler;
+        std::vector<std::string> keys;
+        std::vector<StorageObjectMetadata> metadatas;
+    };
+
+    // Copy an encoded entry into the aggregation log. A log that cannot hold
+    // it is flushed first, and its batches are added to flushed.
+    void AppendToAggregateLog(const std::string& key,
+                              const std::string& kv_buf, int64_t value_size,
+                              uint64_t batch_id,
+                              const CompleteHandler& complete_handler,
+                              std::vector<PendingBatch>& flushed)
+        REQUIRES(aggregate_mutex_);
+
+    // Write the aggregation log as one pack file
+    // @return The batches of the written keys, empty if the write failed
+    std::vector<PendingBatch> FlushAggregateLog() REQUIRES(aggregate_mutex_);
+
+    // Call the complete handlers of flushed batches, without holding locks
+    static void NotifyPackedBatches(std::vector<PendingBatch>& batches);
+
+    void AggregateFlushThread();
+
+    // Index the pack files written before the last restart and report each
+    // of their keys once
+    tl::expected<void, ErrorCode> ScanPacks(
+        const std::function<tl::expected<void, ErrorCode>(
+            std::string&& key, int64_t value_size)>& add_key)
+        REQUIRES(mutex_);
+
+    // Location of the encoded KVEntry of a key in a pack file
+    struct PackedEntry {
+        int64_t pack_id;
+        int64_t offset;
+        int64_t size;
+    };
+
+    // Keys whose latest copy is in a pack file
+    std::unordered_map<std::string, PackedEntry> GUARDED_BY(mutex_)
+        packed_entries_;
+
+    // Write aggregation log, laid out like a pack file: records of a 64-bit
+    // length followed by an encoded KVEntry
+    Mutex aggregate_mutex_;
+    std::shared_ptr<ClientBufferAllocator> aggregate_allocator_;
+    std::optional<BufferHandle> aggregate_log_;
+    int64_t GUARDED_BY(aggregate_mutex_) aggregate_log_used_ = 0;
+    std::chrono::steady_clock::time_point GUARDED_BY(aggregate_mutex_)
+        aggregate_log_start_;
+    // Keys of the log are added to packed_entries_ once it is written
+    struct PendingRecord {
+        std::string key;
+        int64_t offset;
+        int64_t size;
+    };
+    std::vector<PendingRecord> GUARDED_BY(aggregate_mutex_) pending_records_;
+    std::vector<PendingBatch> GUARDED_BY(aggregate_mutex_) pending_batches_;
+    uint64_t GUARDED_BY(aggregate_mutex_) next_batch_id_ = 0;
+    BucketIdGenerator pack_id_generator_{BucketIdGenerator::INIT_NEW_START_ID};
+
+    std::thread aggregate_flush_thread_;
+    std::mutex aggregate_flush_mutex_;
+    std::condition_variable aggregate_flush_cv_;
+    bool aggregate_flush_stop_ = false;
+
     static std::string ConcatSlicesToString(const std::vector<Slice>& slices);
 
     mutable Mutex mutex_;
@@ -669,11 +906,35 @@ class StorageBackendAdaptor : public StorageBackendInterface {
     };
 };
 
+/**
+ * @brief Compression of the values offloaded to a BucketStorageBackend since
+ * Init(). Values rewritten by compaction are not counted again.
+ */
+struct CompressionStats {
+    // Values offloaded, and the compressed ones among them
+    int64_t values = 0;
+    int64_t compressed_values = 0;
+    // Size of the values offloaded, and the bytes they take in buckets
+    int64_t data_bytes = 0;
+    int64_t stored_bytes = 0;
+    // Time spent compressing and decompressing, summed over the threads
+    int64_t compress_time_us = 0;
+    int64_t decompress_time_us = 0;
+
+    // data_bytes per stored byte, 1 if nothing was offloaded
+    double Ratio() const {
+        return stored_bytes > 0 ? static_cast<double>(data_bytes) / stored_bytes
+                                : 1.0;
+    }
+};
+
 class BucketStorageBackend : public StorageBackendInterface {
    public:
     BucketStorageBackend(const FileStorageConfig& file_storage_config_,
                          const BucketBackendConfig& bucket_backend_config_);
 
+    ~BucketStorageBackend();
+
     /**
      * @brief Offload objects in batches
      * @param batch_object  A map from object key to a list of data slices to be
@@ -812,11 +1073,62 @@ class BucketStorageBackend : public StorageBackendInterface {
      */
     tl::expected<void, ErrorCode> DeleteBucket(int64_t bucket_id);
 
+    /**
+     * @brief Remove objects from their buckets.
+     *
+     * The space of removed objects stays in the bucket data files until
+     * compaction rewrites the bucket. The bucket metadata files are updated,
+     * so removed objects stay removed across restarts, and a bucket left
+     * without live objects is deleted.
+     *
+     * @param keys Keys of the objects to remove. Unknown keys are skipped.
+     * @return On success: the number of objects removed.
+     */
+    tl::expected<int64_t, ErrorCode> BatchRemove(
+        const std::vector<std::string>& keys);
+
+    /**
+     * @brief Run one compaction pass.
+     *
+     * Rewrites the live objects of every bucket whose live ratio is below
+     * compaction_live_percent into new buckets, packing several sparse
+     * buckets together within the bucket limits. Object metadata is switched
+     * to a new bucket under the metadata lock once it is written, and the old
+     * buckets are deleted after their in-flight reads. Writes are throttled
+     * to compaction_bytes_per_sec.
+     *
+     * @return On success: the number of bytes reclaimed on disk.
+     */
+    tl::expected<int64_t, ErrorCode> CompactBuckets();
+
+    /**
+     * @brief Total bytes reclaimed by compaction since Init().
+     */
+    int64_t GetCompactionReclaimedBytes() const {
+        return compaction_reclaimed_bytes_.load(std::memory_order_relaxed);
+    }
+
+    CompressionStats GetCompressionStats() const;
+
    private:
-    tl::expected<std::shared_ptr<BucketMetadata>, ErrorCode> BuildBucket(
-        int64_t bucket_id,
+    // Bytes of a value as written to a bucket
+    struct StoredValue {
+        std::vector<Slice> slices;
+        // Size of the value before compression
+        int64_t data_size;
+        CompressionCodec codec;
+    };
+    using StoredBatch = std::unordered_map<std::string, StoredValue>;
+
+    // Compress the values of batch_object that the config selects, on up to
+    // compression_threads threads. The compressed values are kept in
+    // buffers, the others refer to the slices of batch_object.
+    StoredBatch CompressBatch(
         const std::unordered_map<std::string, std::vector<Slice>>& batch_object,
-        std::vector<iovec>& iovs,
+        std::vector<std::unique_ptr<char[]>>& buffers);
+
+    tl::expected<std::shared_ptr<BucketMetadata>, ErrorCode> BuildBucket(
+        int64_t bucket_id, const StoredBatch& batch, std::vector<iovec>& iovs,
         std::vector<StorageObjectMetadata>& metadatas);
 
     tl::expected<void, ErrorCode> WriteBucket(
@@ -843,13 +1155,6 @@ class BucketStorageBackend : public StorageBackendInterface {
         const std::unordered_map<std::string, int64_t>& offloading_objects,
         std::vector<std::vector<std::string>>& buckets_keys);
 
-    tl::expected<void, ErrorCode> HandleNext(
-        const std::function<
-            ErrorCode(const std::vector<std::string>& keys,
-                      std::vector<StorageObjectMetadata>& metadatas)>& handler);
-
-    tl::expected<bool, ErrorCode> HasNext();
-
     /**
      * @brief Cleanup orphaned bucket files (data + metadata) for a given bucket
      * ID. Called when BatchOffload fails due to duplicate keys after files were
@@ -858,6 +1163,24 @@ class BucketStorageBackend : public StorageBackendInterface {
      */
     void CleanupOrphanedBucket(int64_t bucket_id);
 
+    /**
+     * @brief Wait until no read guards the bucket, at most 10 seconds.
+     */
+    tl::expected<void, ErrorCode> WaitForInflightReads(
+        int64_t bucket_id, const std::shared_ptr<BucketMetadata>& bucket);
+
+    // Delete the data and metadata files of a bucket no longer in buckets_
+    void RemoveBucketFiles(int64_t bucket_id);
+
+    struct CompactionSource;
+
+    // Rewrite the live objects of group into one new bucket and delete the
+    // group. Adds the bytes written to written, returns the bytes reclaimed.
+    tl::expected<int64_t, ErrorCode> CompactGroup(
+        std::vector<CompactionSource>& group, int64_t& written);
+
+    void CompactionThread();
+
    private:
     std::atomic<bool> initialized_{false};
     std::optional<BucketIdGenerator> bucket_id_generator_;
@@ -886,16 +1209,40 @@ class BucketStorageBackend : public StorageBackendInterface {
     mutable Mutex offloading_mutex_;
     std::unordered_map<std::string, int64_t> GUARDED_BY(offloading_mutex_)
         ungrouped_offloading_objects_;
+
+    // Serializes BatchRemove and compaction, which both rewrite bucket
+    // metadata files
+    Mutex maintenance_mutex_;
+    std::atomic<int64_t> compaction_reclaimed_bytes_{0};
+    std::thread compaction_thread_;
+    std::mutex compaction_mutex_;
+    std::condition_variable compaction_cv_;
+    bool compaction_stop_ = false;
+
+    // Totals of GetCompressionStats()
+    std::atomic<int64_t> offloaded_values_{0};
+    std::atomic<int64_t> compressed_values_{0};
+    std::atomic<int64_t> offloaded_data_bytes_{0};
+    std::atomic<int64_t> offloaded_stored_bytes_{0};
+    std::atomic<int64_t> compress_time_us_{0};
+    std::atomic<int64_t> decompress_time_us_{0};
 };
 
 class OffsetAllocatorStorageBackend : public StorageBackendInterface {
    public:
     OffsetAllocatorStorageBackend(
-        const FileStorageConfig& file_storage_config_);
+        const FileStorageConfig& file_storage_config_,
+        const OffsetAllocatorBackendConfig& backend_config =
+            OffsetAllocatorBackendConfig());
+
+    // Writes a final index checkpoint when the index is persisted
+    ~OffsetAllocatorStorageBackend();
 
     /**
      * @brief Initializes the offset allocator storage backend.
-     * Creates/truncates the data file and initializes the allocator.
+     * Creates/truncates the data file and initializes the allocator. With
+     * persist_index, the data file is kept and the objects of the index
+     * checkpoint and log are recovered instead.
      * @return tl::expected<void, ErrorCode> indicating operation status.
      */
     tl::expected<void, ErrorCode> Init() override;
@@ -951,6 +1298,16 @@ class OffsetAllocatorStorageBackend : public StorageBackendInterface {
             const std::vector<std::string>& keys,
             std::vector<StorageObjectMetadata>& metadatas)>& handler) override;
 
+    /**
+     * @brief Write the current index to a new checkpoint and start a new
+     * index log. Called automatically when the log outgrows
+     * index_log_checkpoint_bytes; a no-op unless persist_index is set.
+     * @return tl::expected<void, ErrorCode> indicating operation status.
+     */
+    tl::expected<void, ErrorCode> CheckpointIndex();
+
+    OffsetAllocatorDiskStats GetDiskStats() const;
+
     // Test-only: Set predicate to force failures for specific keys in
     // BatchOffload. Returns true if the key should fail, false otherwise. This
     // allows deterministic testing of partial success behavior.
@@ -960,6 +1317,28 @@ class OffsetAllocatorStorageBackend : public StorageBackendInterface {
     }
 
    private:
+    // Location of an object in the data file, as persisted in the index
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t total_size;
+        uint32_t value_size;
+    };
+
+    // Paths of the index checkpoint and log, next to the data file
+    std::string GetIndexCheckpointPath() const;
+    std::string GetIndexLogPath() const;
+
+    // Rebuild the shards and the allocator from the checkpoint and the logs
+    tl::expected<void, ErrorCode> RecoverIndex();
+
+    // Append a put of key to the index log. Returns true once the log is due
+    // for a checkpoint. Called with the shard lock of key held, so that the
+    // puts of a key are logged in the order they are applied.
+    bool LogIndexEntry(const std::string& key, const IndexEntry& entry);
+
+    // (Re)create an empty index log; logs must be closed
+    tl::expected<void, ErrorCode> OpenIndexLog() REQUIRES(index_mutex_);
+
     // On-disk record header: [u32 key_len][u32 value_len] (8 bytes total)
     struct RecordHeader {
         // Length of key in bytes
@@ -996,14 +1375,50 @@ class OffsetAllocatorStorageBackend : public StorageBackendInterface {
         }
     };
 
+    // Freed extents waiting to be punched out of the data file. They return
+    // to the allocator only once punched, so that a hole never lands on a
+    // record written after them.
+    class DiscardQueue {
+       public:
+        DiscardQueue(int fd, int64_t batch_bytes)
+            : fd_(fd), batch_bytes_(batch_bytes) {}
+
+        // Punches the pending extents once batch_bytes are
+        void Add(offset_allocator::OffsetAllocationHandle&& handle);
+
+        void Flush();
+
+        std::atomic<int64_t> discarded_bytes{0};
+        std::atomic<int64_t> discard_calls{0};
+
+       private:
+        void FlushLocked() REQUIRES(mutex_);
+
+        const int fd_;
+        const int64_t batch_bytes_;
+        Mutex mutex_;
+        std::vector<offset_allocator::OffsetAllocationHandle> GUARDED_BY(
+            mutex_) pending_;
+        int64_t GUARDED_BY(mutex_) pending_bytes_ = 0;
+        // Cleared when the file system cannot punch holes
+        bool GUARDED_BY(mutex_) supported_ = true;
+    };
+
     // Refcounted wrapper for move-only OffsetAllocationHandle. Physical extent
-    // freed when last shared_ptr reference drops.
+    // freed when last shared_ptr reference drops, through the discard queue
+    // if there is one.
     struct RefCountedAllocationHandle {
         // RAII handle that frees allocation on destruction
         offset_allocator::OffsetAllocationHandle handle;
+        std::shared_ptr<DiscardQueue> discard_queue;
         explicit RefCountedAllocationHandle(
-            offset_allocator::OffsetAllocationHandle&& h)
-            : handle(std::move(h)) {}
+            offset_allocator::OffsetAllocationHandle&& h,
+            std::shared_ptr<DiscardQueue> queue = nullptr)
+            : handle(std::move(h)), discard_queue(std::move(queue)) {}
+        ~RefCountedAllocationHandle() {
+            if (discard_queue && handle.isValid())
+                discard_queue->Add(std::move(handle));
+        }
         RefCountedAllocationHandle(const RefCountedAllocationHandle&) = delete;
         RefCountedAllocationHandle& operator=(
             const RefCountedAllocationHandle&) = delete;
@@ -1012,6 +1427,12 @@ class OffsetAllocatorStorageBackend : public StorageBackendInterface {
             default;
     };
 
+    // Size of the extent a record of record_size bytes takes
+    uint64_t AllocationSize(uint64_t record_size) const;
+
+    // Bytes the block device of the data file has written, -1 if unknown
+    int64_t ReadDeviceWrittenBytes() const;
+
     // Refcounted allocation handle: shared_ptr ensures physical extent remains
     // alive until all readers release their references
     using AllocationPtr = std::shared_ptr<RefCountedAllocationHandle>;
@@ -1086,6 +1507,17 @@ class OffsetAllocatorStorageBackend : public StorageBackendInterface {
     // File handle wrapper for I/O operations using preadv/pwritev
     std::unique_ptr<StorageFile> data_file_;
 
+    // Set when discard_batch_bytes is, outlives the extents it frees
+    std::shared_ptr<DiscardQueue> discard_queue_;
+
+    // Totals of GetDiskStats()
+    std::atomic<int64_t> record_bytes_{0};
+    std::atomic<int64_t> allocated_bytes_{0};
+    // /sys/dev/block/<major>:<minor>/stat of the data file, and the bytes
+    // written it reported at Init()
+    std::string device_stat_path_;
+    int64_t device_written_base_ = 0;
+
     // Sharded metadata maps: one map per shard with its own lock (prevents data
     // races)
     std::array<MetadataShard, kNumShards> shards_;
@@ -1101,6 +1533,15 @@ class OffsetAllocatorStorageBackend : public StorageBackendInterface {
     // Test-only: Predicate to determine which keys should fail in BatchOffload.
     // Used for deterministic testing of partial success behavior.
     std::function<bool(const std::string& key)> test_failure_predicate_;
+
+    const OffsetAllocatorBackendConfig backend_config_;
+
+    // Index log, lock order: shard locks before index_mutex_
+    Mutex index_mutex_;
+    int GUARDED_BY(index_mutex_) index_log_fd_ = -1;
+    int64_t GUARDED_BY(index_mutex_) index_log_bytes_ = 0;
+    // Set while a checkpoint is written, so that only one runs at a time
+    std::atomic<bool> checkpoint_running_{false};
 };
 
 tl::expected<std::shared_ptr<StorageBackendInterface>, ErrorCode>
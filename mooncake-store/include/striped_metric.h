@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mooncake {
+
+static constexpr size_t kMetricStripes = 64;
+
+// Stripe of the calling thread. Threads are numbered as they first touch
+// a striped metric, so up to kMetricStripes threads never share one.
+inline size_t metric_stripe_index() {
+    static std::atomic<size_t> next_index{0};
+    thread_local size_t index =
+        next_index.fetch_add(1, std::memory_order_relaxed) % kMetricStripes;
+    return index;
+}
+
+// A ylt counter or gauge whose updates go to a per-thread, cacheline
+// aligned stripe instead of the shared metric, so that RPC threads
+// counting requests do not bounce the same line between cores. The
+// stripes are folded into the underlying metric whenever it is read or
+// serialized, which only happens on scrapes and in tests.
+template <typename Metric>
+class StripedMetric : public Metric {
+   public:
+    using Metric::Metric;
+
+    void inc(int64_t val = 1) {
+        // Kept on the metric itself: ylt only serializes metrics that
+        // have been touched, which an increment by zero is used for
+        if (val == 0) {
+            Metric::inc(0);
+            return;
+        }
+        stripes_[metric_stripe_index()].delta.fetch_add(
+            val, std::memory_order_relaxed);
+    }
+
+    void dec(int64_t val = 1) { inc(-val); }
+
+    void update(int64_t val) {
+        fold();
+        Metric::update(val);
+    }
+
+    void reset() {
+        for (auto& stripe : stripes_)
+            stripe.delta.store(0, std::memory_order_relaxed);
+        Metric::reset();
+    }
+
+    int64_t value() {
+        fold();
+        return Metric::value();
+    }
+
+    void serialize(std::string& str) {
+        fold();
+        Metric::serialize(str);
+    }
+
+   private:
+    void fold() {
+        int64_t delta = 0;
+        for (auto& stripe : stripes_)
+            delta += stripe.delta.exchange(0, std::memory_order_relaxed);
+        if (delta == 0) return;
+        if constexpr (requires(Metric& m) { m.dec(delta); }) {
+            if (delta < 0) {
+                Metric::dec(-delta);
+                return;
+            }
+        }
+        Metric::inc(delta);
+    }
+
+    struct alignas(64) Stripe {
+        std::atomic<int64_t> delta{0};
+    };
+    std::array<Stripe, kMetricStripes> stripes_;
+};
+
+}  // namespace mooncake
@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <ostream>
+#include <variant>
 #include "types.h"
 #include "mutex.h"
 #include "master_config.h"
@@ -65,11 +66,28 @@ inline std::ostream& operator<<(std::ostream& os, const TaskStatus& status) {
     return os;
 }
 
+struct ReplicaCopyPayload {
+    std::string key;
+    std::string source;
+    std::vector<std::string> targets;
+};
+YLT_REFL(ReplicaCopyPayload, key, source, targets);
+
+struct ReplicaMovePayload {
+    std::string key;
+    std::string source;
+    std::string target;
+};
+YLT_REFL(ReplicaMovePayload, key, source, target);
+
+// Kept and sent in binary form, the alternative matches the task type
+using TaskPayload = std::variant<ReplicaCopyPayload, ReplicaMovePayload>;
+
 struct Task {
     UUID id;
     TaskType type;
     TaskStatus status;
-    std::string payload;  // JSON or other serialized data
+    TaskPayload payload;
     std::chrono::system_clock::time_point created_at;
     std::chrono::system_clock::time_point last_updated_at;
 
@@ -91,20 +109,6 @@ struct Task {
     }
 };
 
-struct ReplicaCopyPayload {
-    std::string key;
-    std::string source;
-    std::vector<std::string> targets;
-};
-YLT_REFL(ReplicaCopyPayload, key, source, targets);
-
-struct ReplicaMovePayload {
-    std::string key;
-    std::string source;
-    std::string target;
-};
-YLT_REFL(ReplicaMovePayload, key, source, target);
-
 template <TaskType T>
 struct TaskPayloadTraits;
 
@@ -120,13 +124,6 @@ struct TaskPayloadTraits<TaskType::REPLICA_MOVE> {
     static constexpr const char* name = "ReplicaMovePayload";
 };
 
-template <typename T>
-std::string serialize_payload(const T& payload) {
-    std::string json;
-    struct_json::to_json(payload, json);
-    return json;
-};
-
 class ClientTaskManager;
 
 // RAII Accessor: Holds a shared lock and provides read-only access
@@ -155,9 +152,8 @@ class ScopedTaskWriteAccess {
     template <TaskType Type>
     tl::expected<UUID, ErrorCode> submit_task_typed(
         const UUID& client_id,
-        const typename TaskPayloadTraits<Type>::type& payload) {
-        std::string json = serialize_payload(payload);
-        return submit_task(client_id, Type, json);
+        typename TaskPayloadTraits<Type>::type payload) {
+        return submit_task(client_id, Type, TaskPayload(std::move(payload)));
     }
 
     std::vector<Task> pop_tasks(const UUID& client_id, size_t batch_size);
@@ -172,7 +168,7 @@ class ScopedTaskWriteAccess {
    private:
     tl::expected<UUID, ErrorCode> submit_task(const UUID& client_id,
                                               TaskType type,
-                                              const std::string& payload);
+                                              TaskPayload payload);
 
     ClientTaskManager* manager_;
     SharedMutexLocker lock_;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ylt/util/tl/expected.hpp>
+
+#include "types.h"
+
+namespace mooncake {
+
+/**
+ * @brief Tenants sharing the store, with the memory quota of each.
+ *
+ * A key belongs to the tenant named by its prefix up to the first '/', e.g.
+ * "llama/layer0/..." to the tenant "llama", if such a tenant is configured.
+ * Other keys belong to no tenant and are not accounted.
+ *
+ * Quotas are soft: a tenant may hold more than its quota while memory is
+ * free, but the objects of tenants over their quota are evicted before those
+ * of all other tenants.
+ *
+ * @note Thread safety: tenants are only added by Configure, before the
+ * registry is shared. Afterwards they stay at the same address until the
+ * registry is destroyed, and their usage is atomic.
+ */
+class TenantRegistry {
+   public:
+    struct Tenant {
+        Tenant(std::string tenant_name, uint64_t quota)
+            : name(std::move(tenant_name)), quota_bytes(quota) {}
+
+        const std::string name;
+        const uint64_t quota_bytes;
+        // Bytes of the memory replicas of the objects of the tenant
+        std::atomic<uint64_t> memory_bytes{0};
+
+        void Charge(int64_t bytes);
+
+        bool IsOverQuota() const {
+            return memory_bytes.load(std::memory_order_relaxed) > quota_bytes;
+        }
+    };
+
+    /**
+     * @brief Adds the tenants of a comma separated list of name=quota, e.g.
+     * "llama=64GB,qwen=32GB". Quotas are parsed by string_to_byte_size.
+     * @return INVALID_PARAMS if an entry is malformed or a name repeated
+     */
+    tl::expected<void, ErrorCode> Configure(const std::string& quotas);
+
+    // The tenant of the key, or nullptr
+    Tenant* Find(const std::string& key) const;
+
+    bool empty() const { return tenants_.empty(); }
+
+   private:
+    std::vector<std::unique_ptr<Tenant>> tenants_;
+    std::unordered_map<std::string, Tenant*> by_name_;
+};
+
+}  // namespace mooncake
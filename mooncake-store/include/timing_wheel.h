@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mooncake {
+
+/**
+ * @brief Hierarchical timing wheel of keys, used to expire objects when
+ * their TTL runs out.
+ *
+ * Time is counted in ticks. Each of the kLevels wheels has kSlots slots,
+ * and a slot of level l spans kSlots^l ticks. A key is scheduled in the
+ * lowest level whose range holds its deadline, and moved down a level
+ * whenever the wheel above turns to its slot, so scheduling and expiring a
+ * key are O(1) no matter how many keys wait. Deadlines beyond the range of
+ * the top level are moved down when it comes around, then rescheduled.
+ *
+ * Not thread safe. Keys are not deduplicated nor cancelled: the caller
+ * checks an expired key is still due, e.g. against the deadline stored in
+ * its metadata.
+ */
+class TimingWheel {
+   public:
+    static constexpr size_t kLevels = 4;
+    static constexpr size_t kSlotBits = 6;
+    static constexpr size_t kSlots = size_t{1} << kSlotBits;
+
+    /**
+     * @param now_tick Tick the wheel starts at
+     */
+    explicit TimingWheel(uint64_t now_tick = 0) : current_tick_(now_tick) {}
+
+    /**
+     * @brief Schedules the key to expire at the tick, or on the next one if
+     * it is not in the future
+     */
+    void Schedule(std::string key, uint64_t expire_tick);
+
+    /**
+     * @brief Turns the wheel up to now_tick and appends the keys which
+     * expired on the way to expired
+     */
+    void Advance(uint64_t now_tick, std::vector<std::string>& expired);
+
+    size_t size() const { return size_; }
+    uint64_t current_tick() const { return current_tick_; }
+
+   private:
+    struct Entry {
+        std::string key;
+        uint64_t expire_tick;
+    };
+
+    // Entries due before min_tick go to its slot
+    void Insert(Entry&& entry, uint64_t min_tick);
+
+    std::array<std::array<std::vector<Entry>, kSlots>, kLevels> slots_;
+    uint64_t current_tick_;
+    size_t size_{0};
+};
+
+}  // namespace mooncake
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -11,6 +13,7 @@
 #include <queue>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "transfer_engine.h"
@@ -18,6 +21,10 @@
 #include "replica.h"
 #include "storage_backend.h"
 #include "client_metric.h"
+#include "client_buffer.hpp"
+#include "segment_load_tracker.h"
+#include "gds_file_reader.h"
+#include "uring_file_reader.h"
 
 namespace mooncake {
 
@@ -28,7 +35,11 @@ enum class TransferStrategy {
     LOCAL_MEMCPY = 0,     // Local memory copy using memcpy
     TRANSFER_ENGINE = 1,  // Remote transfer using transfer engine
     FILE_READ = 2,        // File read operation
-    EMPTY = 3
+    EMPTY = 3,
+    // Same-host copy involving GPU memory, which memcpy cannot touch. Goes
+    // through the transfer engine, which copies over NVLink (MC_MULTI_PATH)
+    // when the replica's buffer exports a CUDA IPC handle.
+    INTRA_NODE_COPY = 4
 };
 
 /**
@@ -43,11 +54,17 @@ inline std::ostream& operator<<(std::ostream& os,
             return os << "TRANSFER_ENGINE";
         case TransferStrategy::FILE_READ:
             return os << "FILE_READ";
+        case TransferStrategy::INTRA_NODE_COPY:
+            return os << "INTRA_NODE_COPY";
         default:
             return os << "UNKNOWN";
     }
 }
 
+// Time by which an operation should complete, kNoDeadline for none
+using Deadline = std::chrono::steady_clock::time_point;
+inline constexpr Deadline kNoDeadline = Deadline::max();
+
 /**
  * @brief Abstract base class for operation state management
  *
@@ -92,6 +109,15 @@ class OperationState {
      */
     virtual void wait_for_completion() = 0;
 
+    /**
+     * @brief Wait for the operation to complete, canceling what is still
+     * pending at the deadline. Local operations cannot be canceled and are
+     * waited for.
+     */
+    virtual void wait_for_completion_until(Deadline deadline) {
+        wait_for_completion();
+    }
+
    protected:
     std::optional<ErrorCode> result_ = std::nullopt;
     mutable std::mutex mutex_;
@@ -173,8 +199,12 @@ class FilereadOperationState : public OperationState {
 class TransferEngineOperationState : public OperationState {
    public:
     TransferEngineOperationState(TransferEngine& engine, BatchID batch_id,
-                                 size_t batch_size)
-        : engine_(engine), batch_id_(batch_id), batch_size_(batch_size) {}
+                                 size_t batch_size,
+                                 bool completion_notify = false)
+        : engine_(engine),
+          batch_id_(batch_id),
+          batch_size_(batch_size),
+          completion_notify_(completion_notify) {}
 
     ~TransferEngineOperationState() { engine_.freeBatchID(batch_id_); }
 
@@ -182,6 +212,13 @@ class TransferEngineOperationState : public OperationState {
 
     void wait_for_completion() override;
 
+    /**
+     * Transfers not started by the deadline are canceled. Those started
+     * still access the buffers of the caller, so they are waited for, and
+     * the operation fails with TRANSFER_TIMEOUT unless all completed anyway.
+     */
+    void wait_for_completion_until(Deadline deadline) override;
+
     TransferStrategy get_strategy() const override {
         return TransferStrategy::TRANSFER_ENGINE;
     }
@@ -199,6 +236,9 @@ class TransferEngineOperationState : public OperationState {
     TransferEngine& engine_;
     BatchID batch_id_;
     size_t batch_size_;
+    // Whether the engine signals the completion of the batch, so that
+    // waiting blocks instead of polling the transfer status
+    bool completion_notify_;
 };
 
 /**
@@ -230,6 +270,14 @@ class TransferFuture {
      */
     ErrorCode wait();
 
+    /**
+     * @brief Wait for the operation to complete or its deadline to pass,
+     * whichever is first (blocking)
+     * @return ErrorCode::TRANSFER_TIMEOUT if transfers were canceled at the
+     * deadline
+     */
+    ErrorCode waitUntil(Deadline deadline);
+
     /**
      * @brief Get the result, waiting if necessary (blocking)
      * @return ErrorCode indicating success or failure
@@ -246,6 +294,40 @@ class TransferFuture {
     std::shared_ptr<OperationState> state_;
 };
 
+/**
+ * @brief Operation state for erasure coded transfers
+ *
+ * Wraps the transfer engine operation of an erasure coded replica. The
+ * parity buffers are released and the completion callback, which decodes
+ * a degraded read, runs once the transfer completes.
+ */
+class ErasureCodedOperationState : public OperationState {
+   public:
+    ErasureCodedOperationState(TransferFuture future,
+                               std::vector<BufferHandle> buffers,
+                               std::function<ErrorCode()> on_complete)
+        : future_(std::move(future)),
+          buffers_(std::move(buffers)),
+          on_complete_(std::move(on_complete)) {}
+
+    bool is_completed() override;
+
+    void wait_for_completion() override;
+
+    void wait_for_completion_until(Deadline deadline) override;
+
+    TransferStrategy get_strategy() const override {
+        return TransferStrategy::TRANSFER_ENGINE;
+    }
+
+   private:
+    void finish();
+
+    TransferFuture future_;
+    std::vector<BufferHandle> buffers_;
+    std::function<ErrorCode()> on_complete_;
+};
+
 /**
  * @brief Memory copy operation descriptor
  */
@@ -273,8 +355,15 @@ struct MemcpyTask {
 /**
  * @brief Thread pool for asynchronous memcpy operations
  *
- * This class manages a single worker thread that executes memcpy operations
- * asynchronously.
+ * Workers are grouped by NUMA node and bound to the CPUs of their node. A task
+ * runs on the group of the node holding its first destination page, and
+ * operations longer than the chunk size are split so that all workers of the
+ * group copy them in parallel. Operations of at least the non-temporal
+ * threshold are copied with streaming stores that bypass the cache.
+ *
+ * The sizes are read from MC_STORE_MEMCPY_WORKERS (workers per node, default
+ * 4), MC_STORE_MEMCPY_CHUNK_SIZE (default 4 MiB) and
+ * MC_STORE_MEMCPY_NT_THRESHOLD (default 8 MiB, 0 disables streaming stores).
  */
 class MemcpyWorkerPool {
    public:
@@ -293,14 +382,40 @@ class MemcpyWorkerPool {
      */
     void submitTask(MemcpyTask task);
 
-   private:
-    void workerThread();
+    size_t groupCount() const { return groups_.size(); }
 
-    std::vector<std::thread> workers_;
-    std::queue<MemcpyTask> task_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
+   private:
+    // Chunks of one task left to copy; the last worker completes the state
+    struct TaskProgress {
+        std::shared_ptr<MemcpyOperationState> state;
+        std::atomic<size_t> remaining{0};
+    };
+
+    struct Chunk {
+        void* dest;
+        const void* src;
+        size_t size;
+        bool non_temporal;
+        std::shared_ptr<TaskProgress> progress;
+    };
+
+    struct WorkerGroup {
+        int numa_node;  // -1 if the workers are not bound
+        std::vector<std::thread> workers;
+        std::queue<Chunk> chunk_queue;
+        std::mutex queue_mutex;
+        std::condition_variable queue_cv;
+    };
+
+    void workerThread(WorkerGroup* group);
+    WorkerGroup& selectGroup(const void* addr);
+
+    std::vector<std::unique_ptr<WorkerGroup>> groups_;
+    std::vector<size_t> node_to_group_;
+    std::atomic<size_t> next_group_{0};
     std::atomic<bool> shutdown_;
+    size_t chunk_size_;
+    size_t non_temporal_threshold_;
 };
 
 /**
@@ -355,6 +470,24 @@ class FilereadWorkerPool {
     std::shared_ptr<StorageBackend> backend_;
 };
 
+/**
+ * @brief Bytes transferred through the transfer engine per remote endpoint,
+ * reported to the master with the client heartbeats. Local memcpy and file
+ * reads are not counted.
+ */
+class SegmentTrafficCounter {
+   public:
+    void record(const std::string& endpoint, uint64_t bytes,
+                TransferRequest::OpCode op_code);
+
+    // Return the traffic since the previous call and reset it
+    std::vector<SegmentTraffic> take();
+
+   private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, SegmentTraffic> traffic_;
+};
+
 /**
  * @brief Submitter class for asynchronous transfer operations
  *
@@ -364,9 +497,12 @@ class FilereadWorkerPool {
  */
 class TransferSubmitter {
    public:
-    explicit TransferSubmitter(TransferEngine& engine,
-                               std::shared_ptr<StorageBackend>& backend,
-                               TransferMetric* transfer_metric = nullptr);
+    explicit TransferSubmitter(
+        TransferEngine& engine, std::shared_ptr<StorageBackend>& backend,
+        TransferMetric* transfer_metric = nullptr,
+        SegmentTrafficCounter* traffic_counter = nullptr);
+
+    ~TransferSubmitter();
 
     /**
      * @brief Submit an asynchronous transfer operation
@@ -378,17 +514,35 @@ class TransferSubmitter {
      * @param handles Buffer descriptors for the transfer
      * @param slices Memory slices for the transfer
      * @param op_code Transfer operation (READ/WRITE)
+     * @param priority Priority of the transfer engine requests. Foreground
+     * transfers are HIGH, background work such as replica tasks NORMAL, so
+     * that it yields to them in the RDMA transport.
      * @return TransferFuture representing the async operation, or nullopt on
      * failure
      */
-    std::optional<TransferFuture> submit(const Replica::Descriptor& replica,
-                                         std::vector<Slice>& slices,
-                                         TransferRequest::OpCode op_code);
+    std::optional<TransferFuture> submit(
+        const Replica::Descriptor& replica, std::vector<Slice>& slices,
+        TransferRequest::OpCode op_code,
+        TransferRequest::Priority priority = TransferRequest::HIGH);
 
+    /**
+     * @brief Submit the transfers of several memory replicas as one
+     * transfer engine batch, whose future fails if any of them fails.
+     * Requests that continue one another are merged.
+     */
     std::optional<TransferFuture> submit_batch(
         const std::vector<Replica::Descriptor>& replicas,
         std::vector<std::vector<Slice>>& all_slices,
-        TransferRequest::OpCode op_code);
+        TransferRequest::OpCode op_code,
+        TransferRequest::Priority priority = TransferRequest::HIGH);
+
+    /**
+     * @brief Whether submit() would move the replica through the transfer
+     * engine as one contiguous range, so that submit_batch can move it
+     * together with the other replicas on its segment
+     */
+    bool isBatchable(const Replica::Descriptor& replica,
+                     const std::vector<Slice>& slices) const;
 
     std::optional<TransferFuture> submit_batch_get_offload_object(
         const std::string& transfer_engine_addr,
@@ -400,9 +554,23 @@ class TransferSubmitter {
     TransferEngine& engine_;
     std::unique_ptr<MemcpyWorkerPool> memcpy_pool_;
     std::unique_ptr<FilereadWorkerPool> fileread_pool_;
+    // Reads disk replicas instead of fileread_pool_ when io_uring is usable
+    std::unique_ptr<UringFileReader> uring_reader_;
+    // Reads disk replicas into GPU memory with GPUDirect Storage
+    std::unique_ptr<GdsFileReader> gds_reader_;
     bool memcpy_enabled_;
     TransferMetric* transfer_metric_;
 
+    // Registered buffer holding the parity of erasure coded puts and the
+    // stripes of degraded reads, created on first use
+    std::mutex ec_buffer_mutex_;
+    std::shared_ptr<ClientBufferAllocator> ec_buffer_allocator_;
+
+    SegmentTrafficCounter* traffic_counter_;
+
+    void recordTraffic(const std::string& endpoint, uint64_t bytes,
+                       TransferRequest::OpCode op_code);
+
     /**
      * @brief Select the optimal transfer strategy
      */
@@ -414,10 +582,16 @@ class TransferSubmitter {
      */
     bool isLocalTransfer(const AllocatedBuffer::Descriptor& handle) const;
 
+    /**
+     * @brief Check if the replica buffer or a slice is in GPU memory
+     */
+    bool touchesDeviceMemory(const AllocatedBuffer::Descriptor& handle,
+                             const std::vector<Slice>& slices) const;
+
     /**
      * @brief Validate transfer parameters
      */
-    bool validateTransferParams(const AllocatedBuffer::Descriptor& handle,
+    bool validateTransferParams(const MemoryDescriptor& mem_desc,
                                 const std::vector<Slice>& slices) const;
 
     /**
@@ -433,8 +607,44 @@ class TransferSubmitter {
      */
     std::optional<TransferFuture> submitTransferEngineOperation(
         const AllocatedBuffer::Descriptor& handle,
-        const std::vector<Slice>& slices,
-        const TransferRequest::OpCode op_code);
+        const std::vector<Slice>& slices, const TransferRequest::OpCode op_code,
+        TransferRequest::Priority priority);
+
+    /**
+     * @brief Append the requests moving slices to or from consecutive bytes
+     * from target_offset on: one gather/scatter request if the engine takes
+     * them, else one per slice. Null slices are skipped. iov backs the
+     * request until it is submitted.
+     * @return The number of bytes moved
+     */
+    uint64_t appendContiguousRequests(const std::vector<Slice>& slices,
+                                      SegmentHandle seg,
+                                      uint64_t target_offset,
+                                      const TransferRequest::OpCode op_code,
+                                      std::vector<iovec>& iov,
+                                      std::vector<TransferRequest>& requests);
+
+    /**
+     * @brief Append the transfer engine requests of a striped replica. Slices
+     * are split at stripe boundaries, so that the stripes, which are on
+     * different segments, are transferred in parallel.
+     */
+    bool appendStripedRequests(const MemoryDescriptor& mem_desc,
+                               const std::vector<Slice>& slices,
+                               const TransferRequest::OpCode op_code,
+                               std::vector<TransferRequest>& requests);
+
+    /**
+     * @brief Submit the transfer of an erasure coded replica. Puts encode the
+     * parity stripes. Gets read the data stripes, or if some of them are
+     * lost, any data_stripes stripes and decode the lost ones.
+     */
+    std::optional<TransferFuture> submitErasureCodedOperation(
+        const MemoryDescriptor& mem_desc, const std::vector<Slice>& slices,
+        const TransferRequest::OpCode op_code,
+        TransferRequest::Priority priority);
+
+    std::optional<BufferHandle> allocateErasureCodeBuffer(size_t size);
 
     std::optional<TransferFuture> submitFileReadOperation(
         const Replica::Descriptor& replica, std::vector<Slice>& slices,
@@ -447,7 +657,8 @@ class TransferSubmitter {
                                TransferRequest::OpCode op);
 
     std::optional<TransferFuture> submitTransfer(
-        std::vector<TransferRequest>& requests);
+        std::vector<TransferRequest>& requests,
+        TransferRequest::Priority priority);
 };
 
 }  // namespace mooncake
\ No newline at end of file
@@ -29,6 +29,12 @@ static constexpr uint64_t DEFAULT_KV_SOFT_PIN_TTL_MS =
 static constexpr bool DEFAULT_ALLOW_EVICT_SOFT_PINNED_OBJECTS = true;
 static constexpr double DEFAULT_EVICTION_RATIO = 0.05;
 static constexpr double DEFAULT_EVICTION_HIGH_WATERMARK_RATIO = 0.95;
+// 0 disables sampled eviction and keeps the exact full-scan BatchEvict
+static constexpr uint32_t DEFAULT_EVICTION_SAMPLE_SIZE = 0;
+static constexpr uint32_t DEFAULT_EVICTION_SHARDS_PER_TICK = 64;
+// 0 disables heat driven demotion to local disk and promotion back to memory
+static constexpr uint32_t DEFAULT_TIERING_DEMOTE_ACCESS_COUNT = 0;
+static constexpr uint32_t DEFAULT_TIERING_PROMOTE_DISK_READS = 0;
 static constexpr int64_t ETCD_MASTER_VIEW_LEASE_TTL = 5;    // in seconds
 static constexpr int64_t DEFAULT_CLIENT_LIVE_TTL_SEC = 10;  // in seconds
 constexpr const char* DEFAULT_CLUSTER_ID = "mooncake_cluster";
@@ -46,6 +52,17 @@ constexpr const char* PUT_NO_SPACE_HELPER_STR =  // A helpful string
 static constexpr uint64_t DEFAULT_PUT_START_DISCARD_TIMEOUT = 30;  // 30 seconds
 static constexpr uint64_t DEFAULT_PUT_START_RELEASE_TIMEOUT =
     600;  // 10 minutes
+// Empty path disables metadata snapshots of the master
+constexpr const char* DEFAULT_SNAPSHOT_PATH = "";
+static constexpr uint64_t DEFAULT_SNAPSHOT_INTERVAL_SEC =
+    300;  // 0 to only restore and never write snapshots
+// Number of operation log entries kept for standby masters in HA mode
+static constexpr uint64_t DEFAULT_OPLOG_CAPACITY =
+    1000000;  // 0 to disable warm standby replication
+// Slabs of the slab memory allocator and how many allocations of one size
+// are needed before that size gets its own size class
+static constexpr uint64_t DEFAULT_SLAB_SIZE = 32 * 1024 * 1024;  // 32MB
+static constexpr uint32_t DEFAULT_SLAB_CLASS_MIN_COUNT = 64;
 
 // Task manager constants
 static constexpr uint32_t DEFAULT_MAX_TOTAL_FINISHED_TASKS = 10000;
@@ -177,6 +194,9 @@ enum class ErrorCode : int32_t {
 
     // Transfer errors (Range: -800 to -899)
     TRANSFER_FAIL = -800,  ///< Transfer operation failed.
+    CHECKSUM_MISMATCH =
+        -801,  ///< Data read does not match the checksum of the object.
+    TRANSFER_TIMEOUT = -802,  ///< Transfer did not complete by its deadline.
 
     // RPC errors (Range: -900 to -999)
     RPC_FAIL = -900,  ///< RPC operation failed.
@@ -190,6 +210,8 @@ enum class ErrorCode : int32_t {
         -1010,  ///< Request cannot be done in current status.
     UNAVAILABLE_IN_CURRENT_MODE =
         -1011,  ///< Request cannot be done in current mode.
+    OPLOG_TRUNCATED =
+        -1012,  ///< Requested operation log entries are discarded.
 
     // FILE errors (Range: -1100 to -1199)
     FILE_NOT_FOUND = -1100,       ///< File not found.
@@ -246,9 +268,12 @@ struct Segment {
     // TE p2p endpoint (ip:port) for transport-only addressing
     std::string te_endpoint{};
     std::string protocol;
+    // Rack or other failure domain of the host, empty if unknown. Replicas
+    // of an object are spread over hosts and failure domains.
+    std::string failure_domain{};
     Segment() = default;
 };
-YLT_REFL(Segment, id, name, base, size, te_endpoint, protocol);
+YLT_REFL(Segment, id, name, base, size, te_endpoint, protocol, failure_domain);
 
 /**
  * @brief Allocation strategy type for segment allocation
@@ -257,6 +282,7 @@ enum class AllocationStrategyType {
     RANDOM = 0,        // Pure random allocation
     FREE_RATIO_FIRST,  // Free-ratio-first allocation
     CXL,               // CXL-specific allocation
+    LOAD_AWARE,        // Free space, bandwidth and topology aware allocation
 };
 
 /**
@@ -287,6 +313,7 @@ inline std::ostream& operator<<(std::ostream& os,
 enum class BufferAllocatorType {
     CACHELIB = 0,  // CachelibBufferAllocator
     OFFSET = 1,    // OffsetBufferAllocator
+    SLAB = 2,      // SlabBufferAllocator
 };
 
 /**
@@ -296,7 +323,8 @@ inline std::ostream& operator<<(std::ostream& os,
                                 const BufferAllocatorType& type) noexcept {
     static const std::unordered_map<BufferAllocatorType, std::string_view>
         type_strings{{BufferAllocatorType::CACHELIB, "CACHELIB"},
-                     {BufferAllocatorType::OFFSET, "OFFSET"}};
+                     {BufferAllocatorType::OFFSET, "OFFSET"},
+                     {BufferAllocatorType::SLAB, "SLAB"}};
 
     os << (type_strings.count(type) ? type_strings.at(type) : "UNKNOWN");
     return os;
@@ -308,6 +336,10 @@ struct StorageObjectMetadata {
     int64_t key_size;
     int64_t data_size;
     std::string transport_endpoint;
+    // Local to the storage backend, not sent: bytes of the value on disk
+    // and their CompressionCodec when the backend compressed it, 0 for raw
+    int64_t stored_size = 0;
+    uint8_t codec = 0;
     YLT_REFL(StorageObjectMetadata, bucket_id, offset, key_size, data_size,
              transport_endpoint);
 };
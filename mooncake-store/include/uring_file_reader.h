@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+struct io_uring;
+
+namespace mooncake {
+
+/**
+ * @brief Reads disk replicas into client buffers with io_uring.
+ *
+ * Reads may be submitted from any thread. A single completion thread turns
+ * everything queued since its last wakeup into one batch of SQEs, so the
+ * reads of a BatchGet reach the drives together, and completes each read
+ * from its CQEs. Block aligned ranges are read with O_DIRECT, and unaligned
+ * heads and tails of a slice go through the page cache.
+ */
+class UringFileReader {
+   public:
+    using Callback = std::function<void(ErrorCode)>;
+
+    /**
+     * @brief Create a reader with up to queue_depth reads in flight.
+     * @return nullptr if io_uring is not supported by the build or kernel.
+     */
+    static std::unique_ptr<UringFileReader> Create(size_t queue_depth);
+
+    ~UringFileReader();
+
+    UringFileReader(const UringFileReader&) = delete;
+    UringFileReader& operator=(const UringFileReader&) = delete;
+
+    /**
+     * @brief Read length bytes of the file at path into slices.
+     *
+     * Slices with a null ptr skip their size in the file, as in
+     * StorageBackend::LoadObject. done is called from the completion thread.
+     */
+    void Read(const std::string& path, std::vector<Slice> slices,
+              size_t length, Callback done);
+
+   private:
+    struct FileRequest;
+    struct Piece;
+
+    UringFileReader(io_uring* ring, int event_fd, size_t queue_depth);
+
+    void CompletionThread();
+    // Open the file of a request and split it into pieces
+    void StartRequest(const std::shared_ptr<FileRequest>& request);
+    // Prepare SQEs for queued pieces while the queue depth allows
+    void PrepareReads();
+    void ArmWakeup();
+    void CompletePiece(Piece* piece, int result);
+    void FinishPiece(Piece* piece);
+
+    io_uring* ring_;
+    const int event_fd_;
+    const size_t queue_depth_;
+    uint64_t event_value_{0};
+
+    // Requests submitted but not yet seen by the completion thread
+    std::mutex pending_mutex_;
+    std::vector<std::shared_ptr<FileRequest>> pending_;
+    std::atomic<bool> shutdown_{false};
+
+    // Owned by the completion thread
+    std::deque<Piece*> queued_;
+    size_t in_flight_{0};
+    size_t active_requests_{0};
+
+    std::thread thread_;
+};
+
+}  // namespace mooncake
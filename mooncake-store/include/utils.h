@@ -4,6 +4,7 @@
 #include <cstdlib>
 #include <linux/memfd.h>
 #include <linux/mman.h>
+#include <optional>
 #include <string>
 #include <limits>
 #include <ylt/util/tl/expected.hpp>
@@ -252,6 +253,15 @@ std::vector<std::string> splitString(const std::string& str,
                                      bool trim_spaces = true,
                                      bool keep_empty = false);
 
+/**
+ * @brief Get the literal prefix that every match of an ECMAScript regex must
+ * start with, for patterns anchored with '^'
+ * @param pattern The regex pattern
+ * @return The prefix, or std::nullopt if the pattern is not anchored or has
+ *         no literal prefix
+ */
+std::optional<std::string> GetRegexLiteralPrefix(const std::string& pattern);
+
 // Buffer allocator functions
 
 constexpr size_t SZ_2MB = 2 * 1024 * 1024;
@@ -333,8 +343,13 @@ inline size_t align_up(size_t size, size_t alignment) {
     return size;
 }
 
-// Hugepage-backed allocation helpers (MAP_HUGETLB + MADV_HUGEPAGE)
-void* allocate_buffer_mmap_memory(size_t total_size, size_t alignment);
+// Hugepage-backed allocation helpers (MAP_HUGETLB + MADV_HUGEPAGE). Uses
+// regular pages if MC_STORE_USE_HUGEPAGE is not set. If numa_node >= 0 the
+// memory is placed on that node when it has free pages. If prefault_threads
+// > 0 the pages are faulted in by that many threads instead of MAP_POPULATE.
+void* allocate_buffer_mmap_memory(size_t total_size, size_t alignment,
+                                  int numa_node = -1,
+                                  size_t prefault_threads = 0);
 void free_buffer_mmap_memory(void* ptr, size_t total_size);
 
 void free_memory(const std::string& protocol, void* ptr);
@@ -17,6 +17,18 @@ std::string AllocatedBuffer::getSegmentName() const noexcept {
     return std::string();
 }
 
+bool AllocatedBuffer::isInSegment(const std::string& segment_name) const {
+    auto alloc = allocator_.lock();
+    return alloc && alloc->getSegmentName() == segment_name;
+}
+
+uint64_t AllocatedBuffer::getFreeNeighborSize() const {
+    if (!offset_handle_.has_value() || allocator_.expired()) {
+        return 0;
+    }
+    return offset_handle_->freeNeighborSize();
+}
+
 AllocatedBuffer::~AllocatedBuffer() {
     // Note: This is an edge case. If the 'weak_ptr' is released, the segment
     // has already been deallocated at this point, and its memory usage details
@@ -38,19 +50,21 @@ AllocatedBuffer::Descriptor AllocatedBuffer::get_descriptor() const {
         LOG(ERROR) << "allocator=expired_or_null in get_descriptor";
     }
 
-    if (this->protocol == "cxl") {
-        endpoint = this->segment_name_;
+    if (cxl_segment_name_) {
+        return {static_cast<uint64_t>(size()),
+                reinterpret_cast<uintptr_t>(buffer_ptr_), "cxl",
+                *cxl_segment_name_};
     }
-
     return {static_cast<uint64_t>(size()),
-            reinterpret_cast<uintptr_t>(buffer_ptr_), this->protocol, endpoint};
+            reinterpret_cast<uintptr_t>(buffer_ptr_), "tcp",
+            std::move(endpoint)};
 }
 
 void AllocatedBuffer::change_to_cxl(std::string client_segment_name) {
     uint64_t offset_raw = reinterpret_cast<uintptr_t>(buffer_ptr_);
     buffer_ptr_ = reinterpret_cast<void*>(offset_raw - DEFAULT_CXL_BASE);
-    protocol = "cxl";
-    segment_name_ = client_segment_name;
+    cxl_segment_name_ =
+        std::make_unique<std::string>(std::move(client_segment_name));
 }
 
 void* AllocatedBuffer::get_vaddr_from_cxl() {
@@ -143,9 +157,8 @@ std::unique_ptr<AllocatedBuffer> CachelibBufferAllocator::allocate(
 
 void CachelibBufferAllocator::deallocate(AllocatedBuffer* handle) {
     try {
-        void* buffer = handle->get_descriptor().protocol_ == "cxl"
-                           ? handle->get_vaddr_from_cxl()
-                           : handle->buffer_ptr_;
+        void* buffer = handle->isCxl() ? handle->get_vaddr_from_cxl()
+                                       : handle->buffer_ptr_;
         // Deallocate memory using CacheLib.
         memory_allocator_->free(buffer);
         size_t freed_size =
@@ -162,6 +175,27 @@ void CachelibBufferAllocator::deallocate(AllocatedBuffer* handle) {
     }
 }
 
+namespace {
+
+// Create an offset allocator whose node capacity scales with the segment size
+std::shared_ptr<offset_allocator::OffsetAllocator> CreateSegmentOffsetAllocator(
+    size_t base, size_t size) {
+    // 1k <= init_capacity <= 64k
+    uint64_t init_capacity = size / 4096;
+    init_capacity = std::max(init_capacity, static_cast<uint64_t>(1024));
+    init_capacity = std::min(init_capacity, static_cast<uint64_t>(64 * 1024));
+    // 1M <= max_capacity <= 64G / 1K = 64M
+    uint64_t max_capacity = size / 1024;
+    max_capacity = std::max(max_capacity, static_cast<uint64_t>(1024 * 1024));
+    max_capacity =
+        std::min(max_capacity, static_cast<uint64_t>(64 * 1024 * 1024));
+    return offset_allocator::OffsetAllocator::create(
+        base, size, static_cast<uint32_t>(init_capacity),
+        static_cast<uint32_t>(max_capacity));
+}
+
+}  // namespace
+
 // OffsetBufferAllocator implementation
 OffsetBufferAllocator::OffsetBufferAllocator(std::string segment_name,
                                              size_t base, size_t size,
@@ -176,21 +210,7 @@ OffsetBufferAllocator::OffsetBufferAllocator(std::string segment_name,
             << " size=" << size;
 
     try {
-        // 1k <= init_capacity <= 64k
-        uint64_t init_capacity = size / 4096;
-        init_capacity = std::max(init_capacity, static_cast<uint64_t>(1024));
-        init_capacity =
-            std::min(init_capacity, static_cast<uint64_t>(64 * 1024));
-        // 1M <= max_capacity <= 64G / 1K = 64M
-        uint64_t max_capacity = size / 1024;
-        max_capacity =
-            std::max(max_capacity, static_cast<uint64_t>(1024 * 1024));
-        max_capacity =
-            std::min(max_capacity, static_cast<uint64_t>(64 * 1024 * 1024));
-        // Create the offset allocator
-        offset_allocator_ = offset_allocator::OffsetAllocator::create(
-            base, size, static_cast<uint32_t>(init_capacity),
-            static_cast<uint32_t>(max_capacity));
+        offset_allocator_ = CreateSegmentOffsetAllocator(base, size);
         if (!offset_allocator_) {
             LOG(ERROR) << "status=failed_to_create_offset_allocator";
             throw std::runtime_error("Failed to create offset allocator");
@@ -204,6 +224,25 @@ OffsetBufferAllocator::OffsetBufferAllocator(std::string segment_name,
     }
 }
 
+OffsetBufferAllocator::OffsetBufferAllocator(
+    std::string segment_name, size_t base, size_t size,
+    std::string transport_endpoint, size_t cur_size,
+    std::shared_ptr<offset_allocator::OffsetAllocator> offset_allocator)
+    : segment_name_(std::move(segment_name)),
+      base_(base),
+      total_size_(size),
+      cur_size_(cur_size),
+      transport_endpoint_(std::move(transport_endpoint)),
+      offset_allocator_(std::move(offset_allocator)) {
+    VLOG(1) << "restoring_offset_buffer_allocator segment_name="
+            << segment_name_ << " base_address=" << reinterpret_cast<void*>(base)
+            << " size=" << size << " cur_size=" << cur_size;
+    // The destructor decreases the allocated size by cur_size_, so restore
+    // the metric to keep it balanced.
+    MasterMetricManager::instance().inc_allocated_mem_size(segment_name_,
+                                                           cur_size);
+}
+
 OffsetBufferAllocator::~OffsetBufferAllocator() {
     MasterMetricManager::instance().dec_allocated_mem_size(segment_name_,
                                                            cur_size_);
@@ -266,6 +305,63 @@ void OffsetBufferAllocator::deallocate(AllocatedBuffer* handle) {
     }
 }
 
+bool OffsetBufferAllocator::contains(const void* buffer_ptr,
+                                     size_t size) const {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(buffer_ptr);
+    return size > 0 && address >= base_ && address - base_ <= total_size_ &&
+           size <= total_size_ - (address - base_);
+}
+
+std::unique_ptr<AllocatedBuffer> OffsetBufferAllocator::adoptBuffer(
+    void* buffer_ptr, size_t size) {
+    if (!contains(buffer_ptr, size)) {
+        LOG(ERROR) << "adopt_buffer_out_of_range address=" << buffer_ptr
+                   << " size=" << size << " segment=" << segment_name_;
+        return nullptr;
+    }
+    cur_size_.fetch_add(size);
+    MasterMetricManager::instance().inc_allocated_mem_size(segment_name_, size);
+    return std::make_unique<AllocatedBuffer>(shared_from_this(), buffer_ptr,
+                                             size);
+}
+
+size_t OffsetBufferAllocator::rebuildAllocations(
+    const std::vector<AllocatedBuffer*>& buffers) {
+    if (!offset_allocator_) {
+        LOG(ERROR) << "allocator_status=not_initialized";
+        return buffers.size();
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    ranges.reserve(buffers.size());
+    for (auto* buffer : buffers) {
+        // Release the old allocations before the state is replaced.
+        buffer->offset_handle_.reset();
+        ranges.emplace_back(reinterpret_cast<uintptr_t>(buffer->buffer_ptr_),
+                            buffer->size_);
+    }
+
+    auto handles = offset_allocator_->rebuild(ranges);
+    size_t detached = 0;
+    for (size_t i = 0; i < buffers.size(); i++) {
+        if (handles[i]) {
+            buffers[i]->offset_handle_ = std::move(handles[i]);
+            continue;
+        }
+        LOG(ERROR) << "rebuild_allocation_failed address="
+                   << buffers[i]->buffer_ptr_ << " size=" << buffers[i]->size_
+                   << " segment=" << segment_name_;
+        cur_size_.fetch_sub(buffers[i]->size_);
+        MasterMetricManager::instance().dec_allocated_mem_size(
+            segment_name_, buffers[i]->size_);
+        buffers[i]->allocator_.reset();
+        detached++;
+    }
+    VLOG(1) << "rebuild_allocations segment=" << segment_name_
+            << " buffers=" << buffers.size() << " detached=" << detached;
+    return detached;
+}
+
 size_t OffsetBufferAllocator::getLargestFreeRegion() const {
     if (!offset_allocator_) {
         return 0;
@@ -285,6 +381,224 @@ size_t OffsetBufferAllocator::getLargestFreeRegion() const {
     }
 }
 
+// SizeClassRegistry implementation
+SizeClassRegistry::SizeClassRegistry(uint64_t slab_size, uint32_t min_count)
+    : slab_size_(slab_size), min_count_(std::max<uint32_t>(min_count, 1)) {}
+
+uint64_t SizeClassRegistry::observe(uint64_t size) {
+    const size_t num_classes = num_classes_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < num_classes; i++) {
+        if (classes_[i].load(std::memory_order_relaxed) == size) {
+            return size;
+        }
+    }
+    if (size == 0 || num_classes == kMaxSizeClasses ||
+        size > slab_size_ / kMinSlotsPerSlab) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = counts_.find(size);
+    if (it == counts_.end()) {
+        if (counts_.size() >= kMaxTrackedSizes) {
+            return 0;
+        }
+        it = counts_.emplace(size, 0).first;
+    }
+    if (++it->second < min_count_) {
+        return 0;
+    }
+    counts_.erase(it);
+
+    // Another thread may have learned the size or used up the last class
+    const size_t learned = num_classes_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < learned; i++) {
+        if (classes_[i].load(std::memory_order_relaxed) == size) {
+            return size;
+        }
+    }
+    if (learned == kMaxSizeClasses) {
+        return 0;
+    }
+    classes_[learned].store(size, std::memory_order_relaxed);
+    num_classes_.store(learned + 1, std::memory_order_release);
+    LOG(INFO) << "slab_size_class_learned size=" << size
+              << " classes=" << learned + 1;
+    return size;
+}
+
+std::vector<uint64_t> SizeClassRegistry::classes() const {
+    const size_t num_classes = num_classes_.load(std::memory_order_acquire);
+    std::vector<uint64_t> result;
+    result.reserve(num_classes);
+    for (size_t i = 0; i < num_classes; i++) {
+        result.push_back(classes_[i].load(std::memory_order_relaxed));
+    }
+    return result;
+}
+
+// SlabBufferAllocator implementation
+SlabBufferAllocator::SlabBufferAllocator(
+    std::string segment_name, size_t base, size_t size,
+    std::string transport_endpoint,
+    std::shared_ptr<SizeClassRegistry> size_classes)
+    : segment_name_(std::move(segment_name)),
+      base_(base),
+      total_size_(size),
+      cur_size_(0),
+      transport_endpoint_(std::move(transport_endpoint)),
+      size_classes_(std::move(size_classes)) {
+    VLOG(1) << "initializing_slab_buffer_allocator segment_name="
+            << segment_name_ << " base_address=" << reinterpret_cast<void*>(base)
+            << " size=" << size;
+    if (!size_classes_) {
+        throw std::invalid_argument("Slab allocator needs size classes");
+    }
+    offset_allocator_ = CreateSegmentOffsetAllocator(base, size);
+    if (!offset_allocator_) {
+        LOG(ERROR) << "status=failed_to_create_offset_allocator";
+        throw std::runtime_error("Failed to create offset allocator");
+    }
+}
+
+SlabBufferAllocator::~SlabBufferAllocator() {
+    MasterMetricManager::instance().dec_allocated_mem_size(segment_name_,
+                                                           cur_size_);
+}
+
+void SlabBufferAllocator::addPartial(std::vector<Slab*>& partial, Slab* slab) {
+    slab->partial_index = partial.size();
+    partial.push_back(slab);
+}
+
+void SlabBufferAllocator::removePartial(std::vector<Slab*>& partial,
+                                        Slab* slab) {
+    Slab* last = partial.back();
+    partial[slab->partial_index] = last;
+    last->partial_index = slab->partial_index;
+    partial.pop_back();
+    slab->partial_index = kNotPartial;
+}
+
+std::unique_ptr<AllocatedBuffer> SlabBufferAllocator::allocate(size_t size) {
+    const uint64_t class_size = size_classes_->observe(size);
+    if (class_size != 0) {
+        std::unique_lock<std::mutex> lock(slab_mutex_);
+        auto& partial = partial_slabs_[class_size];
+        if (partial.empty()) {
+            const uint64_t slots = size_classes_->slabSize() / class_size;
+            auto handle = offset_allocator_->allocate(slots * class_size);
+            if (handle) {
+                auto slab = std::make_unique<Slab>(
+                    Slab{std::move(*handle), class_size, {}, 0, kNotPartial});
+                slab->free_slots.reserve(slots);
+                for (uint64_t i = slots; i > 0; i--) {
+                    slab->free_slots.push_back(static_cast<uint32_t>(i - 1));
+                }
+                addPartial(partial, slab.get());
+                const uintptr_t slab_base = slab->handle.address();
+                slabs_.emplace(slab_base, std::move(slab));
+                VLOG(1) << "slab_created class_size=" << class_size
+                        << " slots=" << slots << " segment=" << segment_name_;
+            }
+        }
+        if (!partial.empty()) {
+            Slab* slab = partial.back();
+            const uint32_t slot = slab->free_slots.back();
+            slab->free_slots.pop_back();
+            slab->used++;
+            if (slab->free_slots.empty()) {
+                removePartial(partial, slab);
+            }
+            lock.unlock();
+
+            void* buffer_ptr = reinterpret_cast<void*>(
+                slab->handle.address() + slot * class_size);
+            cur_size_.fetch_add(size);
+            MasterMetricManager::instance().inc_allocated_mem_size(
+                segment_name_, size);
+            return std::make_unique<AllocatedBuffer>(shared_from_this(),
+                                                     buffer_ptr, size);
+        }
+        // No room for another slab, try the free space of the segment
+    }
+
+    auto allocation_handle = offset_allocator_->allocate(size);
+    if (!allocation_handle) {
+        VLOG(1) << "allocation_failed size=" << size
+                << " segment=" << segment_name_
+                << " current_size=" << cur_size_;
+        return nullptr;
+    }
+    void* buffer_ptr = allocation_handle->ptr();
+    cur_size_.fetch_add(size);
+    MasterMetricManager::instance().inc_allocated_mem_size(segment_name_, size);
+    return std::make_unique<AllocatedBuffer>(
+        shared_from_this(), buffer_ptr, size, std::move(allocation_handle));
+}
+
+void SlabBufferAllocator::deallocate(AllocatedBuffer* handle) {
+    const size_t freed_size = handle->size();
+    if (handle->offset_handle_.has_value()) {
+        handle->offset_handle_.reset();
+    } else {
+        const uintptr_t address =
+            reinterpret_cast<uintptr_t>(handle->buffer_ptr_);
+        std::lock_guard<std::mutex> lock(slab_mutex_);
+        auto it = slabs_.upper_bound(address);
+        if (it == slabs_.begin()) {
+            LOG(ERROR) << "deallocation_slab_not_found address="
+                       << handle->buffer_ptr_ << " segment=" << segment_name_;
+            return;
+        }
+        --it;
+        Slab* slab = it->second.get();
+        const uint64_t class_size = slab->class_size;
+        auto& partial = partial_slabs_[class_size];
+        slab->free_slots.push_back(
+            static_cast<uint32_t>((address - it->first) / class_size));
+        slab->used--;
+        if (slab->used == 0) {
+            // Return the empty slab to the segment
+            if (slab->partial_index != kNotPartial) {
+                removePartial(partial, slab);
+            }
+            slabs_.erase(it);
+            VLOG(1) << "slab_released class_size=" << class_size
+                    << " segment=" << segment_name_;
+        } else if (slab->partial_index == kNotPartial) {
+            addPartial(partial, slab);
+        }
+    }
+    cur_size_.fetch_sub(freed_size);
+    MasterMetricManager::instance().dec_allocated_mem_size(segment_name_,
+                                                           freed_size);
+    VLOG(1) << "deallocation_succeeded address=" << handle->data()
+            << " size=" << freed_size << " segment=" << segment_name_;
+}
+
+size_t SlabBufferAllocator::getLargestFreeRegion() const {
+    size_t largest = 0;
+    try {
+        largest = offset_allocator_->storageReport().largestFreeRegion;
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Failed to get storage report: " << e.what()
+                   << " segment=" << segment_name_;
+    }
+    std::lock_guard<std::mutex> lock(slab_mutex_);
+    for (const auto& [class_size, partial] : partial_slabs_) {
+        if (!partial.empty()) {
+            largest = std::max<size_t>(largest, class_size);
+        }
+    }
+    return largest;
+}
+
+size_t SlabBufferAllocator::slabCount() const {
+    std::lock_guard<std::mutex> lock(slab_mutex_);
+    return slabs_.size();
+}
+
 SimpleAllocator::SimpleAllocator(size_t size) {
     LOG(INFO) << "initializing_simple_allocator size=" << size;
 
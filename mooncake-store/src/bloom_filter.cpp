@@ -0,0 +1,81 @@
+#include "bloom_filter.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace mooncake {
+
+namespace {
+
+// Odd constants picking the bit of each word, from the Parquet split block
+// Bloom filter
+constexpr uint32_t kSalts[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU,
+                                0xa2b7289dU, 0x705495c7U, 0x2df1424bU,
+                                0x9efc4947U, 0x5c6bfb31U};
+
+uint64_t HashKey(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+uint32_t BitOf(uint64_t hash, size_t word) {
+    return 1U << ((static_cast<uint32_t>(hash) * kSalts[word]) >> 27);
+}
+
+}  // namespace
+
+BloomFilter::BloomFilter(uint64_t expected_keys, uint32_t bits_per_key) {
+    if (bits_per_key == 0) {
+        return;
+    }
+    constexpr uint64_t kBitsPerBlock = kWordsPerBlock * 32;
+    num_blocks_ = std::max<uint64_t>(
+        (expected_keys * bits_per_key + kBitsPerBlock - 1) / kBitsPerBlock, 1);
+    blocks_ = std::make_unique<Block[]>(num_blocks_);
+    Clear();
+}
+
+uint64_t BloomFilter::BlockIndex(uint64_t hash) const {
+    // Multiply-shift maps the high half of the hash onto [0, num_blocks_)
+    return static_cast<uint64_t>(
+        (static_cast<__uint128_t>(hash >> 32) * num_blocks_) >> 32);
+}
+
+void BloomFilter::Insert(std::string_view key) {
+    if (!enabled()) {
+        return;
+    }
+    const uint64_t hash = HashKey(key);
+    auto& block = blocks_[BlockIndex(hash)];
+    for (size_t i = 0; i < kWordsPerBlock; ++i) {
+        const uint32_t bit = BitOf(hash, i);
+        // Skip the atomic write for bits that are already set
+        if ((block.words[i].load(std::memory_order_relaxed) & bit) == 0) {
+            block.words[i].fetch_or(bit, std::memory_order_release);
+        }
+    }
+}
+
+bool BloomFilter::MayContain(std::string_view key) const {
+    if (!enabled()) {
+        return true;
+    }
+    const uint64_t hash = HashKey(key);
+    const auto& block = blocks_[BlockIndex(hash)];
+    for (size_t i = 0; i < kWordsPerBlock; ++i) {
+        if ((block.words[i].load(std::memory_order_acquire) &
+             BitOf(hash, i)) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BloomFilter::Clear() {
+    for (uint64_t b = 0; b < num_blocks_; ++b) {
+        for (auto& word : blocks_[b].words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+}  // namespace mooncake
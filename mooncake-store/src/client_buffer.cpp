@@ -13,9 +13,10 @@
 namespace mooncake {
 
 std::shared_ptr<ClientBufferAllocator> ClientBufferAllocator::create(
-    size_t size, const std::string& protocol, bool use_hugepage) {
-    return std::shared_ptr<ClientBufferAllocator>(
-        new ClientBufferAllocator(size, protocol, use_hugepage));
+    size_t size, const std::string& protocol, bool use_hugepage, int numa_node,
+    size_t prefault_threads) {
+    return std::shared_ptr<ClientBufferAllocator>(new ClientBufferAllocator(
+        size, protocol, use_hugepage, numa_node, prefault_threads));
 }
 
 std::shared_ptr<ClientBufferAllocator> ClientBufferAllocator::create(
@@ -26,8 +27,11 @@ std::shared_ptr<ClientBufferAllocator> ClientBufferAllocator::create(
 
 ClientBufferAllocator::ClientBufferAllocator(size_t size,
                                              const std::string& protocol,
-                                             bool use_hugepage)
-    : protocol(protocol), buffer_size_(size), use_hugepage_(use_hugepage) {
+                                             bool use_hugepage, int numa_node,
+                                             size_t prefault_threads)
+    : protocol(protocol),
+      buffer_size_(size),
+      use_mmap_(use_hugepage || numa_node >= 0 || prefault_threads > 0) {
     if (size == 0) {
         buffer_ = nullptr;
         allocator_ = nullptr;
@@ -35,8 +39,9 @@ ClientBufferAllocator::ClientBufferAllocator(size_t size,
     }
     // Align to 64 bytes(cache line size) for better cache performance
     constexpr size_t alignment = 64;
-    if (use_hugepage_) {
-        buffer_ = allocate_buffer_mmap_memory(size, alignment);
+    if (use_mmap_) {
+        buffer_ = allocate_buffer_mmap_memory(size, alignment, numa_node,
+                                              prefault_threads);
     } else {
         buffer_ = allocate_buffer_allocator_memory(size, protocol, alignment);
     }
@@ -60,7 +65,7 @@ ClientBufferAllocator::ClientBufferAllocator(void* addr, size_t size,
 ClientBufferAllocator::~ClientBufferAllocator() {
     // Free the aligned allocated memory or unmap shared memory
     if (!is_external_memory_ && buffer_) {
-        if (use_hugepage_) {
+        if (use_mmap_) {
             free_buffer_mmap_memory(buffer_, buffer_size_);
         } else {
             free_memory(protocol, buffer_);
@@ -123,7 +128,7 @@ uint64_t calculate_total_size(const Replica::Descriptor& replica) {
     } else if (replica.is_local_disk_replica()) {
         total_length = replica.get_local_disk_descriptor().object_size;
     } else {
-        total_length = replica.get_memory_descriptor().buffer_descriptor.size_;
+        total_length = replica.get_memory_descriptor().total_size();
     }
     return total_length;
 }
@@ -146,9 +151,9 @@ int allocateSlices(std::vector<Slice>& slices,
     } else {
         // For memory-based replica, split into slices based on buffer
         // descriptors
-        auto& handle = replica.get_memory_descriptor().buffer_descriptor;
+        auto& mem_desc = replica.get_memory_descriptor();
         void* chunk_ptr = buffer_ptr;
-        slices.emplace_back(Slice{chunk_ptr, handle.size_});
+        slices.emplace_back(Slice{chunk_ptr, mem_desc.total_size()});
     }
     return 0;
 }
@@ -58,6 +58,10 @@ ClientMetric::ClientMetric(uint64_t interval_seconds,
                            std::map<std::string, std::string> labels)
     : transfer_metric(labels),
       master_client_metric(labels),
+      replica_cache_metric(labels),
+      hot_cache_metric(labels),
+      checksum_metric(labels),
+      phase_metric(labels),
       should_stop_metrics_thread_(false),
       metrics_interval_seconds_(interval_seconds) {
     if (metrics_interval_seconds_ > 0) {
@@ -85,6 +89,10 @@ std::unique_ptr<ClientMetric> ClientMetric::Create(
 void ClientMetric::serialize(std::string& str) {
     transfer_metric.serialize(str);
     master_client_metric.serialize(str);
+    replica_cache_metric.serialize(str);
+    hot_cache_metric.serialize(str);
+    checksum_metric.serialize(str);
+    phase_metric.serialize(str);
 }
 
 std::string ClientMetric::summary_metrics() {
@@ -93,6 +101,14 @@ std::string ClientMetric::summary_metrics() {
     ss << transfer_metric.summary_metrics();
     ss << "\n";
     ss << master_client_metric.summary_metrics();
+    ss << "\n";
+    ss << replica_cache_metric.summary_metrics();
+    ss << "\n";
+    ss << hot_cache_metric.summary_metrics();
+    ss << "\n";
+    ss << checksum_metric.summary_metrics();
+    ss << "\n";
+    ss << phase_metric.summary_metrics();
     return ss.str();
 }
 
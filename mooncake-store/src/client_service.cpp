@@ -8,6 +8,8 @@
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <deque>
+#include <future>
 #include <iomanip>
 #include <optional>
 #include <ranges>
@@ -21,9 +23,13 @@
 #include "config.h"
 #include "types.h"
 #include "client_buffer.hpp"
+#include "crc32c.h"
+#include "gds_file_reader.h"
 #include "utils.h"
 #include "rpc_types.h"
 #include "local_hot_cache.h"
+#include "ping_aggregator.h"
+#include "request_trace.h"
 
 namespace mooncake {
 
@@ -55,7 +61,11 @@ Client::Client(const std::string& local_hostname,
       metadata_connstring_(metadata_connstring),
       protocol_(protocol),
       write_thread_pool_(2),
-      task_thread_pool_(4) {
+      task_executor_(ReplicaTaskExecutor::Config::FromEnv(),
+                     [this](std::vector<ReplicaTask>& tasks) {
+                         ExecuteTaskBatch(tasks);
+                     }),
+      prefetch_thread_pool_(1) {
     LOG(INFO) << "client_id=" << client_id_;
 
     if (metrics_) {
@@ -74,6 +84,10 @@ Client::Client(const std::string& local_hostname,
 }
 
 Client::~Client() {
+    // Prefetches read into the hot cache, finish them first
+    prefetch_thread_pool_.stop();
+    ReleasePutLeases();
+
     // Make a copy of mounted_segments_ to avoid modifying while iterating
     std::vector<Segment> segments_to_unmount;
     {
@@ -101,11 +115,15 @@ Client::~Client() {
 
     // Stop hot cache handler and hot cache
     hot_cache_handler_.reset();
+    if (hot_cache_registered_) {
+        transfer_engine_->unregisterLocalMemory(hot_cache_->GetArenaBase());
+    }
     hot_cache_.reset();
+    device_hot_cache_.reset();
 
-    // Stop task thread pool before stopping ping thread
+    // Stop task executor before stopping ping thread
     task_running_ = false;
-    task_thread_pool_.stop();
+    task_executor_.Stop();
 
     // Stop ping thread only after no need to contact master anymore
     if (ping_running_) {
@@ -194,7 +212,40 @@ tl::expected<void, ErrorCode> CheckRegisterMemoryParams(const void* addr,
 }
 
 ErrorCode Client::ConnectToMaster(const std::string& master_server_entry) {
-    if (master_server_entry.find("etcd://") == 0) {
+    if (master_server_entry.find("etcd-ring://") == 0) {
+        std::string etcd_entry =
+            master_server_entry.substr(strlen("etcd-ring://"));
+
+        // Get the partitioned masters from etcd
+        auto err = partition_ring_helper_.ConnectToEtcd(etcd_entry);
+        if (err != ErrorCode::OK) {
+            LOG(ERROR) << "Failed to connect to etcd";
+            return err;
+        }
+        std::vector<std::string> master_addresses;
+        err = partition_ring_helper_.GetMembers(master_addresses);
+        if (err != ErrorCode::OK) {
+            LOG(ERROR) << "Failed to get the partitioned masters";
+            return err;
+        }
+        if (master_addresses.empty()) {
+            LOG(ERROR) << "No master is available";
+            return ErrorCode::ETCD_KEY_NOT_EXIST;
+        }
+
+        err = master_client_.ConnectPartitioned(master_addresses);
+        if (err != ErrorCode::OK) {
+            LOG(ERROR) << "Failed to connect to the partitioned masters";
+            return err;
+        }
+
+        // The ping thread also follows the changes of the ring
+        ping_running_ = true;
+        ping_thread_ = std::thread([this]() {
+            this->PingThreadMain(/*is_ha_mode=*/false, std::string());
+        });
+        return ErrorCode::OK;
+    } else if (master_server_entry.find("etcd://") == 0) {
         std::string etcd_entry = master_server_entry.substr(strlen("etcd://"));
 
         // Get master address from etcd
@@ -422,7 +473,7 @@ void Client::InitTransferSubmitter() {
     // used separately where needed.
     transfer_submitter_ = std::make_unique<TransferSubmitter>(
         *transfer_engine_, storage_backend_,
-        metrics_ ? &metrics_->transfer_metric : nullptr);
+        metrics_ ? &metrics_->transfer_metric : nullptr, &segment_traffic_);
 }
 
 std::optional<std::shared_ptr<Client>> Client::Create(
@@ -519,22 +570,52 @@ std::optional<std::shared_ptr<Client>> Client::Create(
     if (err != ErrorCode::OK) {
         LOG(ERROR) << "Failed to initialize local hot cache";
     }
+    client->InitDeviceHotCache();
+    client->InitReplicaCache();
+    client->InitNegativeExistCache();
+    if (GetEnvOr<int64_t>("MC_STORE_LOAD_AWARE_REPLICA", 1) != 0) {
+        client->replica_load_tracker_ = std::make_unique<ReplicaLoadTracker>();
+    }
+    client->group_batch_get_by_peer_ =
+        GetEnvOr<int64_t>("MC_STORE_BATCH_GET_GROUP_BY_PEER", 1) != 0;
+    client->compute_checksums_ =
+        GetEnvOr<int64_t>("MC_STORE_CHECKSUM", 0) != 0;
+    client->verify_memory_checksums_ =
+        GetEnvOr<int64_t>("MC_STORE_CHECKSUM_VERIFY_MEMORY", 0) != 0;
+    if (client->compute_checksums_ || client->verify_memory_checksums_) {
+        LOG(INFO) << "Object checksums: compute=" << client->compute_checksums_
+                  << ", verify_memory=" << client->verify_memory_checksums_
+                  << ", hardware_crc32c=" << Crc32cHardwareAccelerated();
+    }
+    client->batch_put_pipeline_size_ = static_cast<size_t>(std::max<int64_t>(
+        GetEnvOr<int64_t>("MC_STORE_BATCH_PUT_PIPELINE_SIZE", 0), 0));
+    client->batch_put_pipeline_depth_ = static_cast<size_t>(std::max<int64_t>(
+        GetEnvOr<int64_t>("MC_STORE_BATCH_PUT_PIPELINE_DEPTH", 2), 1));
+    client->InitPutLeases();
 
     return client;
 }
 
 tl::expected<void, ErrorCode> Client::Get(const std::string& object_key,
-                                          std::vector<Slice>& slices) {
+                                          std::vector<Slice>& slices,
+                                          Deadline deadline) {
+    TraceSpan span("Client::Get", SampleTraceId());
     auto query_result = Query(object_key);
     if (!query_result) {
         return tl::unexpected(query_result.error());
     }
-    return Get(object_key, query_result.value(), slices);
+    auto result = Get(object_key, query_result.value(), slices, deadline);
+    if (!result && replica_cache_) {
+        replica_cache_->Invalidate(object_key);
+    }
+    return result;
 }
 
 std::vector<tl::expected<void, ErrorCode>> Client::BatchGet(
     const std::vector<std::string>& object_keys,
-    std::unordered_map<std::string, std::vector<Slice>>& slices) {
+    std::unordered_map<std::string, std::vector<Slice>>& slices,
+    Deadline deadline) {
+    TraceSpan span("Client::BatchGet", SampleTraceId());
     auto batched_query_results = BatchQuery(object_keys);
 
     // If any queries failed, return error results immediately for failed
@@ -568,12 +649,15 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGet(
             }
         }
 
-        auto valid_results =
-            BatchGet(valid_keys, valid_query_results, valid_slices);
+        auto valid_results = BatchGet(valid_keys, valid_query_results,
+                                      valid_slices, false, deadline);
 
         // Merge results back
         for (size_t i = 0; i < valid_indices.size(); ++i) {
             results[valid_indices[i]] = valid_results[i];
+            if (!valid_results[i] && replica_cache_) {
+                replica_cache_->Invalidate(valid_keys[i]);
+            }
         }
     }
 
@@ -597,27 +681,79 @@ Client::QueryByRegex(const std::string& str) {
 
 tl::expected<QueryResult, ErrorCode> Client::Query(
     const std::string& object_key) {
+    if (replica_cache_) {
+        std::vector<Replica::Descriptor> replicas;
+        std::chrono::steady_clock::time_point lease_timeout;
+        std::optional<uint32_t> checksum;
+        if (replica_cache_->Get(object_key, replicas, lease_timeout,
+                                &checksum)) {
+            if (metrics_) {
+                metrics_->replica_cache_metric.hits.inc();
+            }
+            return QueryResult(std::move(replicas), lease_timeout, false,
+                               checksum);
+        }
+        if (metrics_) {
+            metrics_->replica_cache_metric.misses.inc();
+        }
+    }
     std::chrono::steady_clock::time_point start_time =
         std::chrono::steady_clock::now();
-    auto result = master_client_.GetReplicaList(object_key);
+    auto result = [&] {
+        ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kMasterQuery);
+        return master_client_.GetReplicaList(object_key);
+    }();
     if (!result) {
         return tl::unexpected(result.error());
     }
-    return QueryResult(
-        std::move(result.value().replicas),
-        start_time + std::chrono::milliseconds(result.value().lease_ttl_ms));
+    const auto lease_timeout =
+        start_time + std::chrono::milliseconds(result.value().lease_ttl_ms);
+    if (replica_cache_) {
+        replica_cache_->Put(object_key, result.value().replicas,
+                            lease_timeout, result.value().checksum);
+    }
+    return QueryResult(std::move(result.value().replicas), lease_timeout,
+                       result.value().promote, result.value().checksum);
 }
 
 std::vector<tl::expected<QueryResult, ErrorCode>> Client::BatchQuery(
     const std::vector<std::string>& object_keys) {
+    // Serve the cached keys and only ask the master for the others
+    std::vector<std::optional<QueryResult>> cached(object_keys.size());
+    std::vector<std::string> missed_keys;
+    if (replica_cache_) {
+        for (size_t i = 0; i < object_keys.size(); ++i) {
+            std::vector<Replica::Descriptor> replicas;
+            std::chrono::steady_clock::time_point lease_timeout;
+            std::optional<uint32_t> checksum;
+            if (replica_cache_->Get(object_keys[i], replicas, lease_timeout,
+                                    &checksum)) {
+                cached[i].emplace(std::move(replicas), lease_timeout, false,
+                                  checksum);
+            } else {
+                missed_keys.push_back(object_keys[i]);
+            }
+        }
+        if (metrics_) {
+            metrics_->replica_cache_metric.hits.inc(object_keys.size() -
+                                                    missed_keys.size());
+            metrics_->replica_cache_metric.misses.inc(missed_keys.size());
+        }
+    }
+    const auto& query_keys = replica_cache_ ? missed_keys : object_keys;
+
     std::chrono::steady_clock::time_point start_time =
         std::chrono::steady_clock::now();
-    auto response = master_client_.BatchGetReplicaList(object_keys);
+    std::vector<tl::expected<GetReplicaListResponse, ErrorCode>> response;
+    if (!query_keys.empty()) {
+        ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kMasterQuery);
+        response = master_client_.BatchGetReplicaList(query_keys);
+    }
 
     // Check if we got the expected number of responses
-    if (response.size() != object_keys.size()) {
+    if (response.size() != query_keys.size()) {
         LOG(ERROR) << "BatchQuery response size mismatch. Expected: "
-                   << object_keys.size() << ", Got: " << response.size();
+                   << query_keys.size() << ", Got: " << response.size();
         // Return vector of RPC_FAIL errors
         std::vector<tl::expected<QueryResult, ErrorCode>> results;
         results.reserve(object_keys.size());
@@ -627,20 +763,123 @@ std::vector<tl::expected<QueryResult, ErrorCode>> Client::BatchQuery(
         return results;
     }
     std::vector<tl::expected<QueryResult, ErrorCode>> results;
-    results.reserve(response.size());
-    for (size_t i = 0; i < response.size(); ++i) {
-        if (response[i]) {
+    results.reserve(object_keys.size());
+    size_t response_index = 0;
+    for (size_t i = 0; i < object_keys.size(); ++i) {
+        if (cached[i]) {
+            results.emplace_back(std::move(*cached[i]));
+            continue;
+        }
+        auto& item = response[response_index++];
+        if (item) {
+            const auto lease_timeout =
+                start_time +
+                std::chrono::milliseconds(item.value().lease_ttl_ms);
+            if (replica_cache_) {
+                replica_cache_->Put(object_keys[i], item.value().replicas,
+                                    lease_timeout, item.value().checksum);
+            }
             results.emplace_back(QueryResult(
-                std::move(response[i].value().replicas),
-                start_time + std::chrono::milliseconds(
-                                 response[i].value().lease_ttl_ms)));
+                std::move(item.value().replicas), lease_timeout,
+                item.value().promote, item.value().checksum));
         } else {
-            results.emplace_back(tl::unexpected(response[i].error()));
+            results.emplace_back(tl::unexpected(item.error()));
         }
     }
     return results;
 }
 
+bool Client::Prefetch(const std::vector<std::string>& object_keys) {
+    if (object_keys.empty()) {
+        return true;
+    }
+    if (pending_prefetches_.fetch_add(1) >= kMaxPendingPrefetches) {
+        pending_prefetches_.fetch_sub(1);
+        LOG_EVERY_N(WARNING, 100) << "Prefetch queue full, dropping "
+                                  << object_keys.size() << " keys";
+        return false;
+    }
+    try {
+        prefetch_thread_pool_.enqueue([this, object_keys] {
+            PrefetchKeys(object_keys);
+            pending_prefetches_.fetch_sub(1);
+        });
+    } catch (const std::exception& e) {
+        pending_prefetches_.fetch_sub(1);
+        LOG(WARNING) << "Failed to queue prefetch: " << e.what();
+        return false;
+    }
+    return true;
+}
+
+void Client::PrefetchKeys(const std::vector<std::string>& object_keys) {
+    // Resolving the replicas is all it takes to fill the replica cache
+    auto query_results = BatchQuery(object_keys);
+    if (!hot_cache_) {
+        return;
+    }
+    if (!hot_cache_registered_) {
+        if (transfer_engine_->registerLocalMemory(
+                hot_cache_->GetArenaBase(), hot_cache_->GetArenaSize()) != 0) {
+            LOG_EVERY_N(ERROR, 100)
+                << "Failed to register the local hot cache for prefetching";
+            return;
+        }
+        hot_cache_registered_ = true;
+    }
+
+    size_t num_prefetched = 0;
+    for (size_t i = 0; i < object_keys.size(); ++i) {
+        const auto& key = object_keys[i];
+        if (!query_results[i]) {
+            continue;
+        }
+        Replica::Descriptor replica;
+        if (FindFirstCompleteReplica(query_results[i]->replicas, replica) !=
+                ErrorCode::OK ||
+            !replica.is_memory_replica()) {
+            continue;
+        }
+        // Objects already in local memory are served locally anyway
+        if (IsReplicaOnLocalMemory(replica) || hot_cache_->HasHotKey(key)) {
+            continue;
+        }
+        const size_t size = replica.get_memory_descriptor().total_size();
+        if (size == 0 || size > hot_cache_->GetArenaSize()) {
+            continue;
+        }
+
+        // The key is about to be read, so it may evict without admission
+        HotMemBlock* block = hot_cache_->GetFreeBlock(key, size, nullptr);
+        if (!block) {
+            continue;
+        }
+        std::vector<Slice> slices;
+        for (size_t offset = 0; offset < size; offset += kMaxSliceSize) {
+            slices.push_back({static_cast<char*>(block->addr) + offset,
+                              std::min<size_t>(size - offset, kMaxSliceSize)});
+        }
+        ErrorCode err = TransferRead(replica, slices);
+        block->size = size;
+        // A block without key is freed by PutHotKey
+        if (err == ErrorCode::OK && !query_results[i]->IsLeaseExpired()) {
+            block->key_ = key;
+            ++num_prefetched;
+        } else {
+            block->key_.clear();
+        }
+        hot_cache_->PutHotKey(block);
+    }
+    if (metrics_) {
+        metrics_->hot_cache_metric.cached_bytes.update(
+            hot_cache_->GetCachedBytes());
+        metrics_->hot_cache_metric.reserved_bytes.update(
+            hot_cache_->GetReservedBytes());
+    }
+    VLOG(1) << "Prefetched " << num_prefetched << " of " << object_keys.size()
+            << " keys into the local hot cache";
+}
+
 tl::expected<std::vector<std::string>, ErrorCode> Client::BatchReplicaClear(
     const std::vector<std::string>& object_keys, const UUID& client_id,
     const std::string& segment_name) {
@@ -651,7 +890,8 @@ tl::expected<std::vector<std::string>, ErrorCode> Client::BatchReplicaClear(
 
 tl::expected<void, ErrorCode> Client::Get(const std::string& object_key,
                                           const QueryResult& query_result,
-                                          std::vector<Slice>& slices) {
+                                          std::vector<Slice>& slices,
+                                          Deadline deadline) {
     // Find the first complete replica
     Replica::Descriptor replica;
     ErrorCode err = FindFirstCompleteReplica(query_result.replicas, replica);
@@ -662,6 +902,12 @@ tl::expected<void, ErrorCode> Client::Get(const std::string& object_key,
         return tl::unexpected(err);
     }
 
+    // Objects read into GPU memory before are copied on the device
+    if (device_hot_cache_ &&
+        ReadFromDeviceHotCache(object_key, replica, slices)) {
+        return {};
+    }
+
     // Check local hot cache and update replica descriptor if cache hit
     bool cache_used = false;
     if (hot_cache_ && replica.is_memory_replica()) {
@@ -669,7 +915,30 @@ tl::expected<void, ErrorCode> Client::Get(const std::string& object_key,
     }
 
     auto t0_get = std::chrono::steady_clock::now();
-    err = TransferRead(replica, slices);
+    err = TransferRead(replica, slices, deadline);
+    // The hot cache holds data that was verified when it was read
+    if (err == ErrorCode::OK && !cache_used) {
+        err = VerifyChecksum(object_key, query_result.checksum, replica,
+                             slices);
+    }
+    if (err != ErrorCode::OK && err != ErrorCode::TRANSFER_TIMEOUT &&
+        !cache_used && replica_load_tracker_ && replica.is_memory_replica()) {
+        // Fall back to another replica, the failure made this one look
+        // expensive to later reads as well
+        const auto& fallback =
+            SelectReplica(query_result.replicas, 0, &replica);
+        if (fallback.status == ReplicaStatus::COMPLETE &&
+            fallback.id != replica.id) {
+            LOG(WARNING) << "transfer_read_failed key=" << object_key
+                         << ", retrying on another replica";
+            replica = fallback;
+            err = TransferRead(replica, slices, deadline);
+            if (err == ErrorCode::OK) {
+                err = VerifyChecksum(object_key, query_result.checksum,
+                                     replica, slices);
+            }
+        }
+    }
 
     // Release the cache block after transfer completes (memcpy is done)
     if (hot_cache_ && cache_used) {
@@ -677,7 +946,7 @@ tl::expected<void, ErrorCode> Client::Get(const std::string& object_key,
     }
 
     // Asynchronously update local hot cache with TE transfer slices
-    if (hot_cache_) {
+    if (hot_cache_ && err != ErrorCode::CHECKSUM_MISMATCH) {
         ProcessSlicesAsync(object_key, slices, replica);
     }
 
@@ -698,6 +967,13 @@ tl::expected<void, ErrorCode> Client::Get(const std::string& object_key,
                      << object_key;
         return tl::unexpected(ErrorCode::LEASE_EXPIRED);
     }
+    if (device_hot_cache_) {
+        device_hot_cache_->Admit(object_key, slices);
+    }
+    if (query_result.promote && !replica.is_memory_replica()) {
+        // Best effort, the read itself succeeded
+        Promote(object_key, slices);
+    }
     // Log cache hit statistics
     if (hot_cache_ && replica.is_memory_replica()) {
         VLOG(1) << "Get completed: key=" << object_key
@@ -718,7 +994,8 @@ struct BatchGetOperation {
 std::vector<tl::expected<void, ErrorCode>> Client::BatchGetWhenPreferSameNode(
     const std::vector<std::string>& object_keys,
     const std::vector<QueryResult>& query_results,
-    std::unordered_map<std::string, std::vector<Slice>>& slices) {
+    std::unordered_map<std::string, std::vector<Slice>>& slices,
+    Deadline deadline) {
     std::vector<tl::expected<void, ErrorCode>> results;
     results.resize(object_keys.size());
 
@@ -767,6 +1044,7 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGetWhenPreferSameNode(
     }
     for (auto& seg_to_op : seg_to_op_map) {
         auto& op = seg_to_op.second;
+        ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kSubmit);
         auto future = transfer_submitter_->submit_batch(
             op.replicas, op.batched_slices, TransferRequest::READ);
         if (!future) {
@@ -784,7 +1062,10 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGetWhenPreferSameNode(
         if (op.futures.empty()) {
             continue;
         }
-        ErrorCode result = op.futures[0].get();
+        ErrorCode result = [&] {
+            ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kWait);
+            return op.futures[0].waitUntil(deadline);
+        }();
         if (result != ErrorCode::OK) {
             for (size_t idx = 0; idx < op.key_indexes.size(); ++idx) {
                 auto index = op.key_indexes[idx];
@@ -793,7 +1074,10 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGetWhenPreferSameNode(
                     op.cache_used[idx]) {
                     hot_cache_->ReleaseHotKey(object_keys[index]);
                 }
-                results[index] = tl::unexpected(ErrorCode::TRANSFER_FAIL);
+                results[index] = tl::unexpected(
+                    result == ErrorCode::TRANSFER_TIMEOUT
+                        ? result
+                        : ErrorCode::TRANSFER_FAIL);
                 LOG(ERROR) << "Failed to submit transfer operation for key: "
                            << object_keys[index];
             }
@@ -828,7 +1112,7 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGet(
     const std::vector<std::string>& object_keys,
     const std::vector<QueryResult>& query_results,
     std::unordered_map<std::string, std::vector<Slice>>& slices,
-    bool prefer_alloc_in_same_node) {
+    bool prefer_alloc_in_same_node, Deadline deadline) {
     if (!transfer_submitter_) {
         LOG(ERROR) << "TransferSubmitter not initialized";
         std::vector<tl::expected<void, ErrorCode>> results;
@@ -852,21 +1136,67 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGet(
         return results;
     }
     if (prefer_alloc_in_same_node) {
-        return BatchGetWhenPreferSameNode(object_keys, query_results, slices);
+        return BatchGetWhenPreferSameNode(object_keys, query_results, slices,
+                                          deadline);
     }
 
-    // Collect all transfer operations for parallel execution
-    // Tuple: (index, key, future, replica, cache_used)
-    std::vector<std::tuple<size_t, std::string, TransferFuture,
-                           Replica::Descriptor, bool>>
-        pending_transfers;
+    // Transfers in flight, each of one key or of the keys of one peer
+    struct PendingTransfer {
+        TransferFuture future;
+        std::vector<size_t> indexes;
+        std::chrono::steady_clock::time_point submit_time;
+    };
+    std::vector<PendingTransfer> pending_transfers;
     std::vector<tl::expected<void, ErrorCode>> results(object_keys.size());
+    std::vector<Replica::Descriptor> replicas(object_keys.size());
+    std::vector<bool> cache_used(object_keys.size(), false);
+    // Keys read through the transfer engine, by the segment they are read
+    // from, so that each peer gets one transfer batch
+    std::unordered_map<std::string, std::vector<size_t>> peer_batches;
     // Record batch get transfer latency (Submit + Wait)
     auto t0_batch_get = std::chrono::steady_clock::now();
 
     // Collect cache hit statistics for the entire batch
     size_t total_cache_hits = 0;
 
+    const auto submit_one = [&](size_t i) {
+        const auto& key = object_keys[i];
+        const auto& replica = replicas[i];
+        const auto submit_time = std::chrono::steady_clock::now();
+        if (submit_time >= deadline) {
+            if (hot_cache_ && cache_used[i]) {
+                hot_cache_->ReleaseHotKey(key);
+            }
+            results[i] = tl::unexpected(ErrorCode::TRANSFER_TIMEOUT);
+            return;
+        }
+        auto future = [&] {
+            ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kSubmit);
+            return transfer_submitter_->submit(replica, slices.at(key),
+                                               TransferRequest::READ);
+        }();
+        if (!future) {
+            // Release cache block if submit failed
+            if (hot_cache_ && cache_used[i]) {
+                hot_cache_->ReleaseHotKey(key);
+            }
+            LOG(ERROR) << "Failed to submit transfer operation for key: "
+                       << key;
+            results[i] = tl::unexpected(ErrorCode::TRANSFER_FAIL);
+            return;
+        }
+
+        VLOG(1) << "Submitted transfer for key " << key
+                << " using strategy: " << static_cast<int>(future->strategy());
+
+        if (replica_load_tracker_ && replica.is_memory_replica()) {
+            replica_load_tracker_->OnStart(replica.get_memory_descriptor()
+                                               .buffer_descriptor
+                                               .transport_endpoint_);
+        }
+        pending_transfers.push_back({std::move(*future), {i}, submit_time});
+    };
+
     // Submit all transfers in parallel
     for (size_t i = 0; i < object_keys.size(); ++i) {
         const auto& key = object_keys[i];
@@ -880,7 +1210,7 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGet(
         }
 
         // Find the first complete replica for this key
-        Replica::Descriptor replica;
+        auto& replica = replicas[i];
         ErrorCode err =
             FindFirstCompleteReplica(query_result.replicas, replica);
         if (err != ErrorCode::OK) {
@@ -891,57 +1221,138 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGet(
             continue;
         }
 
-        bool cache_used = false;
+        if (device_hot_cache_ &&
+            ReadFromDeviceHotCache(key, replica, slices_it->second)) {
+            total_cache_hits++;
+            continue;
+        }
+
         if (hot_cache_ && replica.is_memory_replica()) {
-            cache_used = RedirectToHotCache(key, replica);
-            if (cache_used) {
+            cache_used[i] = RedirectToHotCache(key, replica);
+            if (cache_used[i]) {
                 total_cache_hits++;
             }
         }
 
-        // Submit transfer operation asynchronously
-        auto future = transfer_submitter_->submit(replica, slices_it->second,
-                                                  TransferRequest::READ);
+        if (group_batch_get_by_peer_ &&
+            transfer_submitter_->isBatchable(replica, slices_it->second)) {
+            peer_batches[replica.get_memory_descriptor()
+                             .buffer_descriptor.transport_endpoint_]
+                .push_back(i);
+        } else {
+            submit_one(i);
+        }
+    }
+
+    for (auto& [endpoint, indexes] : peer_batches) {
+        if (indexes.size() == 1) {
+            submit_one(indexes[0]);
+            continue;
+        }
+        std::vector<Replica::Descriptor> batch_replicas;
+        std::vector<std::vector<Slice>> batch_slices;
+        batch_replicas.reserve(indexes.size());
+        batch_slices.reserve(indexes.size());
+        for (size_t i : indexes) {
+            batch_replicas.push_back(replicas[i]);
+            batch_slices.push_back(slices.at(object_keys[i]));
+        }
+        const auto submit_time = std::chrono::steady_clock::now();
+        auto future = [&] {
+            ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kSubmit);
+            return transfer_submitter_->submit_batch(
+                batch_replicas, batch_slices, TransferRequest::READ);
+        }();
         if (!future) {
-            // Release cache block if submit failed
-            if (hot_cache_ && cache_used) {
-                hot_cache_->ReleaseHotKey(key);
+            // Each key gets its own transfer instead
+            for (size_t i : indexes) {
+                submit_one(i);
             }
-            LOG(ERROR) << "Failed to submit transfer operation for key: "
-                       << key;
-            results[i] = tl::unexpected(ErrorCode::TRANSFER_FAIL);
             continue;
         }
-
-        VLOG(1) << "Submitted transfer for key " << key
-                << " using strategy: " << static_cast<int>(future->strategy());
-
-        pending_transfers.emplace_back(i, key, std::move(*future), replica,
-                                       cache_used);
-    }
-
-    // Wait for all transfers to complete
-    for (auto& [index, key, future, stored_replica, cache_used] :
-         pending_transfers) {
-        ErrorCode result = future.get();
-
-        // Release the cache block after transfer completes (memcpy is done)
-        if (hot_cache_ && cache_used) {
-            hot_cache_->ReleaseHotKey(key);
+        VLOG(1) << "Submitted transfer of " << indexes.size()
+                << " keys from " << endpoint;
+        if (replica_load_tracker_) {
+            for (size_t k = 0; k < indexes.size(); ++k) {
+                replica_load_tracker_->OnStart(endpoint);
+            }
+        }
+        pending_transfers.push_back(
+            {std::move(*future), std::move(indexes), submit_time});
+    }
+
+    // Wait for all transfers to complete. The transfers of the keys of a
+    // failed peer batch are retried one by one, appending to the list.
+    for (size_t p = 0; p < pending_transfers.size(); ++p) {
+        ErrorCode result = [&] {
+            ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kWait);
+            return pending_transfers[p].future.waitUntil(deadline);
+        }();
+        const auto indexes = std::move(pending_transfers[p].indexes);
+        const auto submit_time = pending_transfers[p].submit_time;
+        // Waited for in order, so the latency is an upper bound
+        if (replica_load_tracker_ && replicas[indexes[0]].is_memory_replica()) {
+            const auto latency = std::chrono::steady_clock::now() - submit_time;
+            for (size_t index : indexes) {
+                replica_load_tracker_->OnFinish(
+                    replicas[index]
+                        .get_memory_descriptor()
+                        .buffer_descriptor.transport_endpoint_,
+                    latency, result == ErrorCode::OK);
+            }
+        }
+        if (result != ErrorCode::OK && result != ErrorCode::TRANSFER_TIMEOUT &&
+            indexes.size() > 1) {
+            LOG(WARNING) << "Transfer of " << indexes.size()
+                         << " keys from one peer failed with error: "
+                         << static_cast<int>(result)
+                         << ", retrying them one by one";
+            for (size_t index : indexes) {
+                submit_one(index);
+            }
+            continue;
         }
-        if (result != ErrorCode::OK) {
-            LOG(ERROR) << "Transfer failed for key: " << key
-                       << " with error: " << static_cast<int>(result);
-            results[index] = tl::unexpected(result);
-        } else {
-            VLOG(1) << "Transfer completed successfully for key: " << key;
-            results[index] = {};
 
-            // asynchronously update local hot cache with TE transfer slices
-            if (hot_cache_) {
+        for (size_t index : indexes) {
+            const auto& key = object_keys[index];
+            const auto& stored_replica = replicas[index];
+            ErrorCode key_result = result;
+            if (key_result == ErrorCode::OK && !cache_used[index]) {
                 auto slices_it = slices.find(key);
                 if (slices_it != slices.end()) {
-                    ProcessSlicesAsync(key, slices_it->second, stored_replica);
+                    key_result =
+                        VerifyChecksum(key, query_results[index].checksum,
+                                       stored_replica, slices_it->second);
+                }
+            }
+
+            // Release the cache block after transfer completes (memcpy is
+            // done)
+            if (hot_cache_ && cache_used[index]) {
+                hot_cache_->ReleaseHotKey(key);
+            }
+            if (key_result != ErrorCode::OK) {
+                LOG(ERROR) << "Transfer failed for key: " << key
+                           << " with error: " << static_cast<int>(key_result);
+                results[index] = tl::unexpected(key_result);
+            } else {
+                VLOG(1) << "Transfer completed successfully for key: " << key;
+                results[index] = {};
+
+                // asynchronously update local hot cache with TE transfer
+                // slices
+                if (hot_cache_) {
+                    auto slices_it = slices.find(key);
+                    if (slices_it != slices.end()) {
+                        ProcessSlicesAsync(key, slices_it->second,
+                                           stored_replica);
+                    }
+                }
+                if (device_hot_cache_) {
+                    auto slices_it = slices.find(key);
+                    if (slices_it != slices.end()) {
+                        device_hot_cache_->Admit(key, slices_it->second);
+                    }
                 }
             }
         }
@@ -966,6 +1377,15 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGet(
         metrics_->transfer_metric.batch_get_latency_us.observe(us_batch_get);
     }
 
+    // Copy the objects that the master asked for back to memory
+    for (const auto& [index, key, future, stored_replica, cache_used,
+                      submit_time] : pending_transfers) {
+        if (results[index].has_value() && query_results[index].promote &&
+            !stored_replica.is_memory_replica()) {
+            Promote(key, slices.at(key));
+        }
+    }
+
     // Log overall cache hit statistics for the entire batch
     if (hot_cache_) {
         VLOG(1) << "BatchGet completed: num_keys=" << object_keys.size()
@@ -976,11 +1396,26 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchGet(
     return results;
 }
 
+bool Client::ReadFromDeviceHotCache(const std::string& key,
+                                    const Replica::Descriptor& replica,
+                                    const std::vector<Slice>& slices) {
+    const size_t size =
+        replica.is_memory_replica()
+            ? replica.get_memory_descriptor().total_size()
+            : replica.get_disk_descriptor().object_size;
+    if (!device_hot_cache_->Read(key, size, slices)) {
+        return false;
+    }
+    VLOG(1) << "Device hot cache hit: key=" << key;
+    return true;
+}
+
 bool Client::RedirectToHotCache(const std::string& key,
                                 Replica::Descriptor& replica) {
     if (!replica.is_memory_replica() || !hot_cache_) {
         return false;
     }
+    ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kHotCacheLookup);
 
     auto& mem_desc = replica.get_memory_descriptor();
     HotMemBlock* blk = hot_cache_->GetHotKey(key);
@@ -988,11 +1423,18 @@ bool Client::RedirectToHotCache(const std::string& key,
         return false;
     }
 
-    if (mem_desc.buffer_descriptor.size_ != blk->size) {
+    if (mem_desc.total_size() != blk->size) {
         LOG(ERROR) << "Cache hit but size mismatch for key: " << key;
         return false;
     }
+    if (hot_cache_handler_) {
+        hot_cache_handler_->RecordHit(key);
+    }
 
+    // The cached block holds the whole object, even if it is striped.
+    mem_desc.buffer_descriptor.size_ = blk->size;
+    mem_desc.extra_stripes.clear();
+    mem_desc.parity_stripes = 0;
     mem_desc.buffer_descriptor.transport_endpoint_ = local_hostname_;
     mem_desc.buffer_descriptor.buffer_address_ =
         reinterpret_cast<uintptr_t>(blk->addr);
@@ -1001,7 +1443,9 @@ bool Client::RedirectToHotCache(const std::string& key,
 
 tl::expected<void, ErrorCode> Client::Put(const ObjectKey& key,
                                           std::vector<Slice>& slices,
-                                          const ReplicateConfig& config) {
+                                          const ReplicateConfig& config,
+                                          Deadline deadline) {
+    TraceSpan span("Client::Put", SampleTraceId());
     // Prepare slice lengths
     std::vector<size_t> slice_lengths;
     for (size_t i = 0; i < slices.size(); ++i) {
@@ -1013,12 +1457,19 @@ tl::expected<void, ErrorCode> Client::Put(const ObjectKey& key,
         client_cfg.preferred_segment = local_hostname_;
     }
 
+    if (auto leased = PutWithLease(key, slices, client_cfg, deadline)) {
+        return *leased;
+    }
+
     // Start put operation
     auto start_result = master_client_.PutStart(key, slice_lengths, client_cfg);
     if (!start_result) {
         ErrorCode err = start_result.error();
         if (err == ErrorCode::OBJECT_ALREADY_EXISTS) {
             VLOG(1) << "object_already_exists key=" << key;
+            if (negative_exist_cache_) {
+                negative_exist_cache_->Invalidate(key);
+            }
             return {};
         }
         if (err == ErrorCode::NO_AVAILABLE_HANDLE) {
@@ -1030,6 +1481,14 @@ tl::expected<void, ErrorCode> Client::Put(const ObjectKey& key,
         }
         return tl::unexpected(err);
     }
+    if (start_result.value().empty()) {
+        // The master already holds the same content, see content_hash
+        VLOG(1) << "deduplicated key=" << key;
+        if (negative_exist_cache_) {
+            negative_exist_cache_->Invalidate(key);
+        }
+        return {};
+    }
 
     // Record Put transfer latency (all replicas)
     auto t0_put = std::chrono::steady_clock::now();
@@ -1052,7 +1511,7 @@ tl::expected<void, ErrorCode> Client::Put(const ObjectKey& key,
     for (const auto& replica : start_result.value()) {
         if (replica.is_memory_replica()) {
             // Transfer data using allocated handles from all replicas
-            ErrorCode transfer_err = TransferWrite(replica, slices);
+            ErrorCode transfer_err = TransferWrite(replica, slices, deadline);
             if (transfer_err != ErrorCode::OK) {
                 // Revoke put operation
                 auto revoke_result =
@@ -1074,91 +1533,518 @@ tl::expected<void, ErrorCode> Client::Put(const ObjectKey& key,
     }
 
     // End put operation
-    auto end_result = master_client_.PutEnd(key, ReplicaType::MEMORY);
+    auto end_result = master_client_.PutEnd(key, ReplicaType::MEMORY,
+                                            ComputeChecksum(slices));
     if (!end_result) {
         ErrorCode err = end_result.error();
         LOG(ERROR) << "Failed to end put operation: " << err;
         return tl::unexpected(err);
     }
+    if (negative_exist_cache_) {
+        negative_exist_cache_->Invalidate(key);
+    }
 
     return {};
 }
 
-// TODO: `client.cpp` is too long, consider split it into multiple files
-enum class PutOperationState {
-    PENDING,
-    MASTER_FAILED,
-    TRANSFER_FAILED,
-    FINALIZE_FAILED,
-    SUCCESS
-};
-
-class PutOperation {
-   public:
-    PutOperation(std::string_view k, const std::vector<Slice>& s)
-        : key(k), slices(s) {
-        value_length = CalculateSliceSize(slices);
-        // Initialize with a pending error state to ensure result is always set
-        result = tl::unexpected(ErrorCode::INTERNAL_ERROR);
+std::optional<tl::expected<void, ErrorCode>> Client::PutWithLease(
+    const ObjectKey& key, std::vector<Slice>& slices,
+    const ReplicateConfig& config, Deadline deadline) {
+    const uint64_t max_slots = put_lease_slots_.load(std::memory_order_relaxed);
+    uint64_t size = 0;
+    for (const auto& slice : slices) {
+        size += slice.size;
+    }
+    // Leased replicas are allocated before their key and config are known
+    if (max_slots == 0 || size == 0 || size > kMaxLeasedPutSize ||
+        config.replica_num == 0 || !config.preferred_segment.empty() ||
+        !config.preferred_segments.empty() ||
+        config.prefer_alloc_in_same_node || config.stripe_num > 1 ||
+        config.parity_num > 0 || !config.content_hash.empty()) {
+        return std::nullopt;
     }
 
-    std::string key;
-    std::vector<Slice> slices;
-    size_t value_length;
-    std::vector<std::vector<Slice>> batched_slices;
-
-    // Enhanced state tracking
-    PutOperationState state = PutOperationState::PENDING;
-    tl::expected<void, ErrorCode> result;
+    const auto lease_key = std::make_pair(size, config.replica_num);
+    const auto now = std::chrono::steady_clock::now();
+    uint64_t lease_id = 0;
+    uint64_t slot = 0;
     std::vector<Replica::Descriptor> replicas;
-    std::vector<TransferFuture> pending_transfers;
-
-    // Error context for debugging
-    std::optional<std::string> failure_context;
-
-    // Helper methods for robust state management
-    void SetSuccess() {
-        state = PutOperationState::SUCCESS;
-        result = {};
-        failure_context.reset();
-    }
-
-    void SetError(ErrorCode error, const std::string& context = "") {
-        result = tl::unexpected(error);
-        if (!context.empty()) {
-            failure_context = toString(error) + ": " + context + "; " +
-                              failure_context.value_or("");
+    uint64_t grant_slots = 0;
+    {
+        std::lock_guard<std::mutex> lock(put_leases_mutex_);
+        auto it = put_leases_.find(lease_key);
+        if (it == put_leases_.end()) {
+            if (put_leases_.size() >= kMaxPutLeaseSizes) {
+                return std::nullopt;
+            }
+            it = put_leases_.emplace(lease_key, PutLeaseCache{}).first;
         }
-
-        // Update state based on current processing stage
-        if (replicas.empty()) {
-            state = PutOperationState::MASTER_FAILED;
-        } else if (pending_transfers.empty()) {
-            state = PutOperationState::TRANSFER_FAILED;
+        auto& cache = it->second;
+        if (cache.next_slot < cache.slots.size() && now < cache.use_until) {
+            lease_id = cache.lease_id;
+            slot = cache.next_slot++;
+            replicas = std::move(cache.slots[slot]);
         } else {
-            state = PutOperationState::FINALIZE_FAILED;
+            if (cache.lease_id != 0) {
+                // Unused slots of an old lease are left to the master
+                cache.grant_slots =
+                    cache.next_slot == cache.slots.size()
+                        ? cache.grant_slots * 2
+                        : std::max<uint64_t>(cache.grant_slots / 2, 1);
+                cache.lease_id = 0;
+                cache.slots.clear();
+                cache.next_slot = 0;
+            }
+            cache.grant_slots = std::min(cache.grant_slots, max_slots);
+            grant_slots = cache.grant_slots;
         }
     }
 
-    bool IsResolved() const { return state != PutOperationState::PENDING; }
-
-    bool IsSuccessful() const {
-        return state == PutOperationState::SUCCESS && result.has_value();
+    if (grant_slots > 0) {
+        auto granted = master_client_.GrantPutLease(size, grant_slots, config);
+        if (!granted || granted->slots.empty()) {
+            if (!granted &&
+                granted.error() == ErrorCode::UNAVAILABLE_IN_CURRENT_MODE) {
+                LOG(INFO) << "The master grants no put leases, disabling them";
+                put_lease_slots_ = 0;
+            }
+            return std::nullopt;
+        }
+        lease_id = granted->lease_id;
+        replicas = std::move(granted->slots.front());
+        uint64_t replaced_lease = 0;
+        {
+            std::lock_guard<std::mutex> lock(put_leases_mutex_);
+            auto& cache = put_leases_[lease_key];
+            // Another put was granted a lease meanwhile
+            if (cache.next_slot < cache.slots.size()) {
+                replaced_lease = cache.lease_id;
+            }
+            cache.lease_id = granted->lease_id;
+            cache.slots = std::move(granted->slots);
+            cache.next_slot = 1;
+            cache.use_until =
+                now + std::chrono::milliseconds(granted->ttl_ms / 2);
+        }
+        if (replaced_lease != 0) {
+            auto released = master_client_.ReleasePutLease(replaced_lease);
+            if (!released) {
+                VLOG(1) << "lease_id=" << replaced_lease
+                        << ", error=" << toString(released.error());
+            }
+        }
     }
-};
 
-std::vector<PutOperation> Client::CreatePutOperations(
-    const std::vector<ObjectKey>& keys,
-    const std::vector<std::vector<Slice>>& batched_slices) {
-    std::vector<PutOperation> ops;
-    ops.reserve(keys.size());
-    for (size_t i = 0; i < keys.size(); ++i) {
-        ops.emplace_back(keys[i], batched_slices[i]);
+    auto t0_put = std::chrono::steady_clock::now();
+    for (const auto& replica : replicas) {
+        if (replica.is_memory_replica()) {
+            // A slot that was not written is left to expire with its lease
+            ErrorCode transfer_err = TransferWrite(replica, slices, deadline);
+            if (transfer_err != ErrorCode::OK) {
+                return tl::expected<void, ErrorCode>(
+                    tl::unexpected(transfer_err));
+            }
+        }
     }
-    return ops;
+    auto us_put = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - t0_put)
+                      .count();
+    if (metrics_) {
+        metrics_->transfer_metric.put_latency_us.observe(us_put);
+    }
+
+    LeasedPut put;
+    put.key = key;
+    put.lease_id = lease_id;
+    put.slot = slot;
+    put.config = config;
+    put.checksum = ComputeChecksum(slices);
+    auto results = master_client_.BatchLeasedPutEnd({put});
+    const ErrorCode err = results.empty() ? ErrorCode::RPC_FAIL
+                          : results.front() ? ErrorCode::OK
+                                            : results.front().error();
+    if (err == ErrorCode::OK || err == ErrorCode::OBJECT_ALREADY_EXISTS) {
+        if (negative_exist_cache_) {
+            negative_exist_cache_->Invalidate(key);
+        }
+        return tl::expected<void, ErrorCode>();
+    }
+    // E.g. the lease expired or its segment is gone, put it again
+    VLOG(1) << "key=" << key << ", lease_id=" << lease_id
+            << ", error=" << toString(err) << ", action=leased_put_retry";
+    return std::nullopt;
 }
 
-void Client::StartBatchPut(std::vector<PutOperation>& ops,
+void Client::InitPutLeases() {
+    put_lease_slots_ = static_cast<uint64_t>(std::max<int64_t>(
+        GetEnvOr<int64_t>("MC_STORE_PUT_LEASE_SLOTS", 0), 0));
+    if (put_lease_slots_ > 0) {
+        LOG(INFO) << "Put leases enabled with up to " << put_lease_slots_
+                  << " slots of at most " << kMaxLeasedPutSize << " bytes";
+    }
+}
+
+void Client::ReleasePutLeases() {
+    std::vector<uint64_t> lease_ids;
+    {
+        std::lock_guard<std::mutex> lock(put_leases_mutex_);
+        for (const auto& [lease_key, cache] : put_leases_) {
+            if (cache.next_slot < cache.slots.size()) {
+                lease_ids.push_back(cache.lease_id);
+            }
+        }
+        put_leases_.clear();
+    }
+    for (uint64_t lease_id : lease_ids) {
+        auto released = master_client_.ReleasePutLease(lease_id);
+        if (!released) {
+            VLOG(1) << "lease_id=" << lease_id
+                    << ", error=" << toString(released.error());
+        }
+    }
+}
+
+// The part of an unstriped memory replica holding [offset, offset + length)
+static Replica::Descriptor SubRangeReplica(const Replica::Descriptor& replica,
+                                           uint64_t offset, uint64_t length) {
+    Replica::Descriptor sub = replica;
+    auto& buffer = sub.get_memory_descriptor().buffer_descriptor;
+    buffer.buffer_address_ += offset;
+    buffer.size_ = length;
+    return sub;
+}
+
+tl::expected<void, ErrorCode> Client::StreamPutStart(
+    const ObjectKey& key, const std::vector<uint64_t>& chunk_lengths,
+    const ReplicateConfig& config) {
+    ReplicateConfig client_cfg = config;
+    if (protocol_ == "cxl") {
+        client_cfg.preferred_segment = local_hostname_;
+    }
+
+    auto start_result =
+        master_client_.StreamPutStart(key, chunk_lengths, client_cfg);
+    if (!start_result) {
+        LOG(ERROR) << "Failed to start streaming put for key=" << key << ": "
+                   << toString(start_result.error());
+        return tl::unexpected(start_result.error());
+    }
+
+    StreamPut stream;
+    for (auto& replica : start_result.value()) {
+        if (replica.is_memory_replica()) {
+            stream.replicas.emplace_back(std::move(replica));
+        } else if (replica.is_disk_replica()) {
+            // Chunks are only streamed to memory
+            auto revoke_result =
+                master_client_.PutRevoke(key, ReplicaType::DISK);
+            if (!revoke_result) {
+                LOG(WARNING) << "Failed to revoke disk replica of streamed key="
+                             << key;
+            }
+        }
+    }
+    stream.chunk_offsets.reserve(chunk_lengths.size() + 1);
+    stream.chunk_offsets.push_back(0);
+    for (auto length : chunk_lengths) {
+        stream.chunk_offsets.push_back(stream.chunk_offsets.back() + length);
+    }
+    stream.written.assign(chunk_lengths.size(), false);
+    stream.chunk_checksums.resize(chunk_lengths.size());
+
+    std::lock_guard<std::mutex> lock(stream_puts_mutex_);
+    stream_puts_[key] = std::move(stream);
+    return {};
+}
+
+tl::expected<void, ErrorCode> Client::StreamPutChunk(
+    const ObjectKey& key, uint64_t chunk_index, std::vector<Slice>& slices) {
+    std::vector<Replica::Descriptor> chunk_replicas;
+    {
+        std::lock_guard<std::mutex> lock(stream_puts_mutex_);
+        auto it = stream_puts_.find(key);
+        if (it == stream_puts_.end()) {
+            LOG(ERROR) << "No streaming put for key=" << key;
+            return tl::unexpected(ErrorCode::INVALID_WRITE);
+        }
+        const auto& offsets = it->second.chunk_offsets;
+        if (chunk_index + 1 >= offsets.size()) {
+            LOG(ERROR) << "Chunk " << chunk_index << " out of range for key="
+                       << key;
+            return tl::unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        uint64_t offset = offsets[chunk_index];
+        uint64_t length = offsets[chunk_index + 1] - offset;
+        if (CalculateSliceSize(slices) != length) {
+            LOG(ERROR) << "Chunk " << chunk_index << " of key=" << key
+                       << " expects " << length << " bytes";
+            return tl::unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        for (const auto& replica : it->second.replicas) {
+            chunk_replicas.push_back(SubRangeReplica(replica, offset, length));
+        }
+    }
+
+    for (const auto& replica : chunk_replicas) {
+        ErrorCode transfer_err = TransferWrite(replica, slices);
+        if (transfer_err != ErrorCode::OK) {
+            {
+                std::lock_guard<std::mutex> lock(stream_puts_mutex_);
+                stream_puts_.erase(key);
+            }
+            auto revoke_result =
+                master_client_.PutRevoke(key, ReplicaType::MEMORY);
+            if (!revoke_result) {
+                LOG(ERROR) << "Failed to revoke streaming put for key=" << key;
+                return tl::unexpected(revoke_result.error());
+            }
+            return tl::unexpected(transfer_err);
+        }
+    }
+
+    auto commit_result = master_client_.StreamPutCommit(key, chunk_index, 1);
+    if (!commit_result) {
+        LOG(ERROR) << "Failed to commit chunk " << chunk_index
+                   << " of key=" << key << ": "
+                   << toString(commit_result.error());
+        return tl::unexpected(commit_result.error());
+    }
+
+    auto checksum = ComputeChecksum(slices);
+    std::lock_guard<std::mutex> lock(stream_puts_mutex_);
+    auto it = stream_puts_.find(key);
+    if (it != stream_puts_.end()) {
+        it->second.written[chunk_index] = true;
+        it->second.chunk_checksums[chunk_index] = checksum;
+    }
+    return {};
+}
+
+tl::expected<void, ErrorCode> Client::StreamPutEnd(const ObjectKey& key) {
+    std::optional<uint32_t> checksum;
+    {
+        std::lock_guard<std::mutex> lock(stream_puts_mutex_);
+        auto it = stream_puts_.find(key);
+        if (it == stream_puts_.end()) {
+            LOG(ERROR) << "No streaming put for key=" << key;
+            return tl::unexpected(ErrorCode::INVALID_WRITE);
+        }
+        const auto& written = it->second.written;
+        if (std::find(written.begin(), written.end(), false) !=
+            written.end()) {
+            LOG(ERROR) << "Streaming put of key=" << key
+                       << " has chunks left to write";
+            return tl::unexpected(ErrorCode::INVALID_WRITE);
+        }
+        // The chunks were checksummed as they were written, in any order
+        const auto& chunk_checksums = it->second.chunk_checksums;
+        const auto& offsets = it->second.chunk_offsets;
+        if (std::all_of(chunk_checksums.begin(), chunk_checksums.end(),
+                        [](const auto& crc) { return crc.has_value(); })) {
+            checksum = 0;
+            for (size_t i = 0; i < chunk_checksums.size(); ++i) {
+                checksum = Crc32cCombine(*checksum, *chunk_checksums[i],
+                                         offsets[i + 1] - offsets[i]);
+            }
+        }
+        stream_puts_.erase(it);
+    }
+
+    auto end_result =
+        master_client_.PutEnd(key, ReplicaType::MEMORY, checksum);
+    if (!end_result) {
+        LOG(ERROR) << "Failed to end streaming put for key=" << key << ": "
+                   << toString(end_result.error());
+        return tl::unexpected(end_result.error());
+    }
+    if (negative_exist_cache_) {
+        negative_exist_cache_->Invalidate(key);
+    }
+    return {};
+}
+
+tl::expected<void, ErrorCode> Client::GetRange(const ObjectKey& key,
+                                               uint64_t offset,
+                                               std::vector<Slice>& slices) {
+    auto list_result = master_client_.GetStreamReplicaList(key);
+    if (!list_result) {
+        return tl::unexpected(list_result.error());
+    }
+    const auto& response = list_result.value();
+    uint64_t length = CalculateSliceSize(slices);
+    if (!response.IsReadable(offset, length)) {
+        VLOG(1) << "Range not committed yet, key=" << key
+                << ", offset=" << offset << ", length=" << length;
+        return tl::unexpected(ErrorCode::REPLICA_IS_NOT_READY);
+    }
+
+    for (const auto& replica : response.replicas) {
+        if (!replica.is_memory_replica() ||
+            replica.get_memory_descriptor().is_striped()) {
+            continue;
+        }
+        if (offset + length >
+            replica.get_memory_descriptor().buffer_descriptor.size_) {
+            LOG(ERROR) << "Range exceeds object, key=" << key
+                       << ", offset=" << offset << ", length=" << length;
+            return tl::unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        auto err = TransferRead(SubRangeReplica(replica, offset, length),
+                                slices);
+        if (err != ErrorCode::OK) {
+            return tl::unexpected(err);
+        }
+        return {};
+    }
+    LOG(ERROR) << "No unstriped memory replica to read a range of key="
+               << key;
+    return tl::unexpected(ErrorCode::REPLICA_IS_NOT_READY);
+}
+
+tl::expected<void, ErrorCode> Client::GetRanges(
+    const ObjectKey& key, const std::vector<uint64_t>& offsets,
+    std::vector<std::vector<Slice>>& slices) {
+    if (offsets.size() != slices.size()) {
+        LOG(ERROR) << "Every range needs its buffers, key=" << key;
+        return tl::unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    if (offsets.empty()) {
+        return {};
+    }
+    auto list_result = master_client_.GetStreamReplicaList(key);
+    if (!list_result) {
+        return tl::unexpected(list_result.error());
+    }
+    const auto& response = list_result.value();
+    std::vector<uint64_t> lengths;
+    lengths.reserve(offsets.size());
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        lengths.push_back(CalculateSliceSize(slices[i]));
+        if (!response.IsReadable(offsets[i], lengths[i])) {
+            VLOG(1) << "Range not committed yet, key=" << key
+                    << ", offset=" << offsets[i]
+                    << ", length=" << lengths[i];
+            return tl::unexpected(ErrorCode::REPLICA_IS_NOT_READY);
+        }
+    }
+
+    for (const auto& replica : response.replicas) {
+        if (!replica.is_memory_replica() ||
+            replica.get_memory_descriptor().is_striped()) {
+            continue;
+        }
+        const uint64_t object_size =
+            replica.get_memory_descriptor().buffer_descriptor.size_;
+        std::vector<Replica::Descriptor> sub_replicas;
+        std::vector<std::vector<Slice>> sub_slices;
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            if (offsets[i] + lengths[i] > object_size) {
+                LOG(ERROR) << "Range exceeds object, key=" << key
+                           << ", offset=" << offsets[i]
+                           << ", length=" << lengths[i];
+                return tl::unexpected(ErrorCode::INVALID_PARAMS);
+            }
+            if (lengths[i] == 0) continue;
+            sub_replicas.push_back(
+                SubRangeReplica(replica, offsets[i], lengths[i]));
+            sub_slices.push_back(slices[i]);
+        }
+        if (sub_replicas.empty()) {
+            return {};
+        }
+        auto future = transfer_submitter_->submit_batch(
+            sub_replicas, sub_slices, TransferRequest::READ);
+        if (!future) {
+            LOG(ERROR) << "Failed to submit the range reads of key=" << key;
+            return tl::unexpected(ErrorCode::TRANSFER_FAIL);
+        }
+        auto err = future->get();
+        if (err != ErrorCode::OK) {
+            return tl::unexpected(err);
+        }
+        return {};
+    }
+    LOG(ERROR) << "No unstriped memory replica to read ranges of key=" << key;
+    return tl::unexpected(ErrorCode::REPLICA_IS_NOT_READY);
+}
+
+// TODO: `client.cpp` is too long, consider split it into multiple files
+enum class PutOperationState {
+    PENDING,
+    MASTER_FAILED,
+    TRANSFER_FAILED,
+    FINALIZE_FAILED,
+    SUCCESS
+};
+
+class PutOperation {
+   public:
+    PutOperation(std::string_view k, const std::vector<Slice>& s)
+        : key(k), slices(s) {
+        value_length = CalculateSliceSize(slices);
+        // Initialize with a pending error state to ensure result is always set
+        result = tl::unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+
+    std::string key;
+    std::vector<Slice> slices;
+    size_t value_length;
+    std::vector<std::vector<Slice>> batched_slices;
+
+    // Enhanced state tracking
+    PutOperationState state = PutOperationState::PENDING;
+    tl::expected<void, ErrorCode> result;
+    std::vector<Replica::Descriptor> replicas;
+    std::vector<TransferFuture> pending_transfers;
+    // Computed while the transfers are in flight
+    std::optional<uint32_t> checksum;
+
+    // Error context for debugging
+    std::optional<std::string> failure_context;
+
+    // Helper methods for robust state management
+    void SetSuccess() {
+        state = PutOperationState::SUCCESS;
+        result = {};
+        failure_context.reset();
+    }
+
+    void SetError(ErrorCode error, const std::string& context = "") {
+        result = tl::unexpected(error);
+        if (!context.empty()) {
+            failure_context = toString(error) + ": " + context + "; " +
+                              failure_context.value_or("");
+        }
+
+        // Update state based on current processing stage
+        if (replicas.empty()) {
+            state = PutOperationState::MASTER_FAILED;
+        } else if (pending_transfers.empty()) {
+            state = PutOperationState::TRANSFER_FAILED;
+        } else {
+            state = PutOperationState::FINALIZE_FAILED;
+        }
+    }
+
+    bool IsResolved() const { return state != PutOperationState::PENDING; }
+
+    bool IsSuccessful() const {
+        return state == PutOperationState::SUCCESS && result.has_value();
+    }
+};
+
+std::vector<PutOperation> Client::CreatePutOperations(
+    const std::vector<ObjectKey>& keys,
+    const std::vector<std::vector<Slice>>& batched_slices) {
+    std::vector<PutOperation> ops;
+    ops.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ops.emplace_back(keys[i], batched_slices[i]);
+    }
+    return ops;
+}
+
+void Client::StartBatchPut(std::span<PutOperation> ops,
                            const ReplicateConfig& config) {
     std::vector<std::string> keys;
     std::vector<std::vector<uint64_t>> slice_lengths;
@@ -1206,7 +2092,7 @@ void Client::StartBatchPut(std::vector<PutOperation>& ops,
     }
 }
 
-void Client::SubmitTransfers(std::vector<PutOperation>& ops) {
+void Client::SubmitTransfers(std::span<PutOperation> ops) {
     if (!transfer_submitter_) {
         LOG(ERROR) << "TransferSubmitter not initialized";
         for (auto& op : ops) {
@@ -1273,11 +2159,12 @@ void Client::SubmitTransfers(std::vector<PutOperation>& ops) {
         } else {
             VLOG(1) << "Successfully submitted " << op.pending_transfers.size()
                     << " transfers for key " << op.key;
+            op.checksum = ComputeChecksum(op.slices);
         }
     }
 }
 
-void Client::WaitForTransfers(std::vector<PutOperation>& ops) {
+void Client::WaitForTransfers(std::span<PutOperation> ops) {
     for (auto& op : ops) {
         // Skip operations that already failed or completed
         if (op.IsResolved()) {
@@ -1323,7 +2210,7 @@ void Client::WaitForTransfers(std::vector<PutOperation>& ops) {
     }
 }
 
-void Client::FinalizeBatchPut(std::vector<PutOperation>& ops) {
+void Client::FinalizeBatchPut(std::span<PutOperation> ops) {
     // For each operation,
     // If transfers completed successfully, we need to call BatchPutEnd
     // If the operation failed but has allocated replicas, we need to call
@@ -1331,6 +2218,8 @@ void Client::FinalizeBatchPut(std::vector<PutOperation>& ops) {
 
     std::vector<std::string> successful_keys;
     std::vector<size_t> successful_indices;
+    std::vector<uint32_t> checksums;
+    bool all_checksummed = true;
     std::vector<std::string> failed_keys;
     std::vector<size_t> failed_indices;
 
@@ -1350,6 +2239,8 @@ void Client::FinalizeBatchPut(std::vector<PutOperation>& ops) {
             // Transfers completed, needs BatchPutEnd
             successful_keys.emplace_back(op.key);
             successful_indices.emplace_back(i);
+            all_checksummed = all_checksummed && op.checksum.has_value();
+            checksums.push_back(op.checksum.value_or(0));
         } else if (op.state != PutOperationState::PENDING &&
                    !op.replicas.empty()) {
             // Operation failed but has allocated replicas, needs BatchPutRevoke
@@ -1361,7 +2252,12 @@ void Client::FinalizeBatchPut(std::vector<PutOperation>& ops) {
 
     // Process successful operations
     if (!successful_keys.empty()) {
-        auto end_responses = master_client_.BatchPutEnd(successful_keys);
+        // The RPC takes a checksum for every key or none
+        if (!all_checksummed) {
+            checksums.clear();
+        }
+        auto end_responses =
+            master_client_.BatchPutEnd(successful_keys, checksums);
         if (end_responses.size() != successful_keys.size()) {
             LOG(ERROR) << "BatchPutEnd response size mismatch: expected "
                        << successful_keys.size() << ", got "
@@ -1383,6 +2279,9 @@ void Client::FinalizeBatchPut(std::vector<PutOperation>& ops) {
                 } else {
                     // Operation fully successful
                     ops[op_idx].SetSuccess();
+                    if (negative_exist_cache_) {
+                        negative_exist_cache_->Invalidate(successful_keys[i]);
+                    }
                     VLOG(1) << "Successfully completed put for key "
                             << successful_keys[i];
                 }
@@ -1535,6 +2434,11 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchPutWhenPreferSameNode(
                     << " transfers for key " << merged_ops.back().key;
         }
     }
+    for (auto& op : ops) {
+        if (!op.IsResolved()) {
+            op.checksum = ComputeChecksum(op.slices);
+        }
+    }
     WaitForTransfers(merged_ops);
     for (auto& op : merged_ops) {
         auto& memory_descriptor = op.replicas[0].get_memory_descriptor();
@@ -1568,6 +2472,7 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchPut(
     const std::vector<ObjectKey>& keys,
     std::vector<std::vector<Slice>>& batched_slices,
     const ReplicateConfig& config) {
+    TraceSpan span("Client::BatchPut", SampleTraceId());
     ReplicateConfig client_cfg = config;
     if (protocol_ == "cxl") {
         client_cfg.preferred_segment = local_hostname_;
@@ -1583,6 +2488,11 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchPut(
         StartBatchPut(ops, client_cfg);
         return BatchPutWhenPreferSameNode(ops);
     }
+    if (batch_put_pipeline_size_ > 0 &&
+        ops.size() > batch_put_pipeline_size_) {
+        PipelinedBatchPut(ops, client_cfg);
+        return CollectResults(ops);
+    }
     StartBatchPut(ops, client_cfg);
 
     auto t0 = std::chrono::steady_clock::now();
@@ -1599,7 +2509,67 @@ std::vector<tl::expected<void, ErrorCode>> Client::BatchPut(
     return CollectResults(ops);
 }
 
+void Client::PipelinedBatchPut(std::vector<PutOperation>& ops,
+                               const ReplicateConfig& config) {
+    std::vector<std::span<PutOperation>> batches;
+    for (size_t begin = 0; begin < ops.size();
+         begin += batch_put_pipeline_size_) {
+        batches.emplace_back(
+            ops.data() + begin,
+            std::min(batch_put_pipeline_size_, ops.size() - begin));
+    }
+
+    // The master client is thread-safe, so the BatchPutStart of the next
+    // sub-batches and the BatchPutEnd of the previous ones run on other
+    // threads while this one moves the data of the current sub-batch.
+    std::deque<std::future<void>> starting;
+    std::deque<std::future<void>> finalizing;
+    size_t next_start = 0;
+    auto start_next = [&]() {
+        auto batch = batches[next_start++];
+        starting.emplace_back(
+            std::async(std::launch::async, [this, batch, &config]() {
+                StartBatchPut(batch, config);
+            }));
+    };
+    while (next_start < batches.size() &&
+           starting.size() < batch_put_pipeline_depth_) {
+        start_next();
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto& batch : batches) {
+        starting.front().get();
+        starting.pop_front();
+        if (next_start < batches.size()) {
+            start_next();
+        }
+
+        SubmitTransfers(batch);
+        WaitForTransfers(batch);
+
+        finalizing.emplace_back(std::async(
+            std::launch::async, [this, batch]() { FinalizeBatchPut(batch); }));
+        while (finalizing.size() >= batch_put_pipeline_depth_) {
+            finalizing.front().get();
+            finalizing.pop_front();
+        }
+    }
+    for (auto& future : finalizing) {
+        future.get();
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - t0)
+                  .count();
+    if (metrics_) {
+        metrics_->transfer_metric.batch_put_latency_us.observe(us);
+    }
+}
+
 tl::expected<void, ErrorCode> Client::Remove(const ObjectKey& key, bool force) {
+    if (replica_cache_) {
+        replica_cache_->Invalidate(key);
+    }
     auto result = master_client_.Remove(key, force);
     // if (storage_backend_) {
     //     storage_backend_->RemoveFile(key);
@@ -1612,6 +2582,9 @@ tl::expected<void, ErrorCode> Client::Remove(const ObjectKey& key, bool force) {
 
 tl::expected<long, ErrorCode> Client::RemoveByRegex(const ObjectKey& str,
                                                     bool force) {
+    if (replica_cache_) {
+        replica_cache_->Clear();
+    }
     auto result = master_client_.RemoveByRegex(str, force);
     // if (storage_backend_) {
     //     storage_backend_->RemoveByRegex(str);
@@ -1623,6 +2596,9 @@ tl::expected<long, ErrorCode> Client::RemoveByRegex(const ObjectKey& str,
 }
 
 tl::expected<long, ErrorCode> Client::RemoveAll(bool force) {
+    if (replica_cache_) {
+        replica_cache_->Clear();
+    }
     // if (storage_backend_) {
     //     storage_backend_->RemoveAll();
     // }
@@ -1668,6 +2644,7 @@ tl::expected<void, ErrorCode> Client::MountSegment(
     segment.base = reinterpret_cast<uintptr_t>(buffer);
     segment.size = size;
     segment.protocol = protocol;
+    segment.failure_domain = GetEnvStringOr("MC_STORE_RACK", "");
     // For P2P handshake mode, publish the actual transport endpoint that was
     // negotiated by the transfer engine. Otherwise, keep the logical hostname
     // so metadata backends (HTTP/etcd/redis) can resolve the segment by name.
@@ -1729,6 +2706,10 @@ tl::expected<void, ErrorCode> Client::UnmountSegment(const void* buffer,
     }
 
     mounted_segments_.erase(segment);
+    // Cached replicas may refer to the unmounted segment
+    if (replica_cache_) {
+        replica_cache_->Clear();
+    }
     return {};
 }
 
@@ -1756,11 +2737,72 @@ tl::expected<void, ErrorCode> Client::unregisterLocalMemory(
 }
 
 tl::expected<bool, ErrorCode> Client::IsExist(const std::string& key) {
+    if (negative_exist_cache_ && negative_exist_cache_->Contains(key)) {
+        return false;
+    }
     auto result = master_client_.ExistKey(key);
+    if (negative_exist_cache_ && result && !result.value()) {
+        negative_exist_cache_->Add(key);
+    }
     return result;
 }
 
 std::vector<tl::expected<bool, ErrorCode>> Client::BatchIsExist(
+    const std::vector<std::string>& keys) {
+    if (negative_exist_cache_) {
+        // Only the keys not cached as missing go to the master
+        std::vector<tl::expected<bool, ErrorCode>> results(keys.size(), false);
+        std::vector<size_t> query_indices;
+        std::vector<std::string> query_keys;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!negative_exist_cache_->Contains(keys[i])) {
+                query_indices.push_back(i);
+                query_keys.push_back(keys[i]);
+            }
+        }
+        if (query_keys.empty()) {
+            return results;
+        }
+        auto response = BatchIsExistUncached(query_keys);
+        for (size_t i = 0; i < response.size(); ++i) {
+            if (response[i] && !response[i].value()) {
+                negative_exist_cache_->Add(query_keys[i]);
+            }
+            results[query_indices[i]] = std::move(response[i]);
+        }
+        return results;
+    }
+    return BatchIsExistUncached(keys);
+}
+
+tl::expected<size_t, ErrorCode> Client::BatchIsExistPrefix(
+    const std::vector<std::string>& keys) {
+    // A key cached as missing ends the prefix without asking the master
+    size_t query_count = keys.size();
+    if (negative_exist_cache_) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (negative_exist_cache_->Contains(keys[i])) {
+                query_count = i;
+                break;
+            }
+        }
+    }
+    if (query_count == 0) {
+        return 0;
+    }
+    const std::vector<std::string> query_keys(keys.begin(),
+                                              keys.begin() + query_count);
+    auto result = master_client_.BatchExistKeyPrefix(query_keys);
+    if (!result) {
+        return tl::unexpected(result.error());
+    }
+    if (negative_exist_cache_ && result.value() < query_count) {
+        negative_exist_cache_->Add(keys[result.value()]);
+    }
+    return static_cast<size_t>(result.value());
+}
+
+std::vector<tl::expected<bool, ErrorCode>> Client::BatchIsExistUncached(
     const std::vector<std::string>& keys) {
     auto response = master_client_.BatchExistKey(keys);
 
@@ -1849,153 +2891,273 @@ tl::expected<UUID, ErrorCode> Client::CreateMoveTask(
     return master_client_.CreateMoveTask(key, source, target);
 }
 
-tl::expected<void, ErrorCode> Client::ExecuteReplicaTransfer(
-    const std::string& key, const std::string& action_name,
-    std::function<tl::expected<void, ErrorCode>()> end_fn,
-    std::function<tl::expected<void, ErrorCode>()> revoke_fn,
-    const Replica::Descriptor& source,
-    const std::vector<Replica::Descriptor>& targets) {
-    auto revoke_lambda = [&]() {
-        auto revoke_result = revoke_fn();
-        if (!revoke_result.has_value()) {
-            LOG(WARNING) << "action=replica_" << action_name << "_revoke_failed"
-                         << ", key=" << key
-                         << ", error_code=" << revoke_result.error();
-        }
-    };
+namespace {
 
-    // currently only memory source replica is supported
-    if (!source.is_memory_replica()) {
-        LOG(ERROR) << "action=replica_" << action_name << "_failed"
-                   << ", key=" << key << ", error=invalid_replica_type";
-        revoke_lambda();
+const char* ReplicaTaskAction(TaskType type) {
+    return type == TaskType::REPLICA_COPY ? "copy" : "move";
+}
+
+}  // namespace
+
+tl::expected<std::optional<Client::ReplicaTransfer>, ErrorCode>
+Client::StartReplicaTask(const TaskAssignment& assignment) {
+    ReplicaTransfer transfer;
+    transfer.type = assignment.type;
+    const auto* copy_payload =
+        std::get_if<ReplicaCopyPayload>(&assignment.payload);
+    const auto* move_payload =
+        std::get_if<ReplicaMovePayload>(&assignment.payload);
+    if ((assignment.type == TaskType::REPLICA_COPY && !copy_payload) ||
+        (assignment.type == TaskType::REPLICA_MOVE && !move_payload)) {
+        LOG(ERROR) << "action=task_execution_failed"
+                   << ", task_id=" << assignment.id
+                   << ", error=payload_type_mismatch"
+                   << ", task_type=" << assignment.type;
         return tl::unexpected(ErrorCode::INVALID_PARAMS);
     }
-
-    // Validate that source replica is in local memory
-    if (!IsReplicaOnLocalMemory(source)) {
-        LOG(ERROR) << "action=replica_" << action_name << "_failed"
-                   << ", key=" << key
-                   << ", error=source_replica_not_in_local_memory";
-        revoke_lambda();
-        return tl::unexpected(ErrorCode::REPLICA_NOT_IN_LOCAL_MEMORY);
+    switch (assignment.type) {
+        case TaskType::REPLICA_COPY: {
+            const auto& payload = *copy_payload;
+            transfer.key = payload.key;
+            LOG(INFO) << "action=replica_copy_start" << ", key=" << payload.key
+                      << ", targets_count=" << payload.targets.size();
+
+            // CopyStart validates existence and allocates replicas
+            auto start_result = master_client_.CopyStart(
+                payload.key, payload.source, payload.targets);
+            if (!start_result.has_value()) {
+                ErrorCode error = start_result.error();
+                LOG(ERROR) << "action=replica_copy_failed"
+                           << ", key=" << payload.key
+                           << ", source=" << payload.source
+                           << ", error=copy_start_failed"
+                           << ", error_code=" << error;
+                return tl::unexpected(error);
+            }
+            if (start_result->targets.empty()) {
+                LOG(INFO) << "action=replica_copy_skipped"
+                          << ", key=" << payload.key
+                          << ", info=target_replicas_already_exist";
+                break;
+            }
+            transfer.source = std::move(start_result->source);
+            transfer.targets = std::move(start_result->targets);
+            break;
+        }
+        case TaskType::REPLICA_MOVE: {
+            const auto& payload = *move_payload;
+            transfer.key = payload.key;
+            LOG(INFO) << "action=replica_move_start" << ", key=" << payload.key
+                      << ", source_segment=" << payload.source
+                      << ", target_segment=" << payload.target;
+
+            // MoveStart validates existence and allocates replica if needed
+            auto start_result = master_client_.MoveStart(
+                payload.key, payload.source, payload.target);
+            if (!start_result.has_value()) {
+                ErrorCode error = start_result.error();
+                LOG(ERROR) << "action=replica_move_failed"
+                           << ", key=" << payload.key
+                           << ", error=move_start_failed"
+                           << ", error_code=" << error;
+                return tl::unexpected(error);
+            }
+            if (!start_result->target.has_value()) {
+                LOG(INFO) << "action=replica_move_skipped"
+                          << ", key=" << payload.key
+                          << ", info=target_replica_already_exists";
+                break;
+            }
+            transfer.source = std::move(start_result->source);
+            transfer.targets = {std::move(start_result->target.value())};
+            break;
+        }
+        default:
+            LOG(ERROR) << "action=task_execution_failed"
+                       << ", task_id=" << assignment.id
+                       << ", error=unknown_task_type"
+                       << ", task_type=" << assignment.type;
+            return tl::unexpected(ErrorCode::INVALID_PARAMS);
     }
 
-    // Split the source replica into slices for transfer
-    // This avoids data copy because the source replica is already in memory
-    const auto& buffer_descriptor =
-        source.get_memory_descriptor().buffer_descriptor;
-    void* buffer = reinterpret_cast<void*>(buffer_descriptor.buffer_address_);
-    auto slices = split_into_slices(buffer, buffer_descriptor.size_);
-
-    // Transfer to each target
-    for (const auto& target : targets) {
-        if (TransferWrite(target, slices) != ErrorCode::OK) {
-            revoke_lambda();
-            return tl::unexpected(ErrorCode::TRANSFER_FAIL);
+    const char* action = ReplicaTaskAction(transfer.type);
+    if (transfer.targets.empty()) {
+        // Target replicas already exist, consider it success
+        auto end_result = EndReplicaTransfer(transfer, true);
+        if (!end_result.has_value()) {
+            LOG(ERROR) << "action=replica_" << action << "_failed"
+                       << ", key=" << transfer.key << ", error=" << action
+                       << "_end_failed"
+                       << ", error_code=" << end_result.error();
+            return tl::unexpected(end_result.error());
         }
+        return std::nullopt;
     }
 
-    // Call end function to finalize
-    auto end_result = end_fn();
-    if (!end_result.has_value()) {
-        revoke_lambda();
-        return tl::unexpected(end_result.error());
+    // currently only memory source replica is supported
+    ErrorCode error = ErrorCode::OK;
+    if (!transfer.source.is_memory_replica()) {
+        LOG(ERROR) << "action=replica_" << action << "_failed"
+                   << ", key=" << transfer.key
+                   << ", error=invalid_replica_type";
+        error = ErrorCode::INVALID_PARAMS;
+    } else if (!IsReplicaOnLocalMemory(transfer.source)) {
+        LOG(ERROR) << "action=replica_" << action << "_failed"
+                   << ", key=" << transfer.key
+                   << ", error=source_replica_not_in_local_memory";
+        error = ErrorCode::REPLICA_NOT_IN_LOCAL_MEMORY;
     }
-
-    return {};
+    if (error != ErrorCode::OK) {
+        EndReplicaTransfer(transfer, false);
+        return tl::unexpected(error);
+    }
+    return transfer;
 }
 
-tl::expected<void, ErrorCode> Client::Copy(
-    const std::string& key, const std::string& source,
-    const std::vector<std::string>& targets) {
-    LOG(INFO) << "action=replica_copy_start" << ", key=" << key
-              << ", targets_count=" << targets.size();
-
-    // Call CopyStart first - it validates existence and allocates replicas
-    auto start_result = master_client_.CopyStart(key, source, targets);
-    if (!start_result.has_value()) {
-        ErrorCode error = start_result.error();
-        LOG(ERROR) << "action=replica_copy_failed" << ", key=" << key
-                   << ", source=" << source << ", error=copy_start_failed"
-                   << ", error_code=" << error;
-        return tl::unexpected(error);
+std::vector<ErrorCode> Client::TransferReplicas(
+    const std::vector<ReplicaTransfer>& transfers) {
+    std::vector<ErrorCode> results(transfers.size(), ErrorCode::OK);
+    if (!transfer_submitter_) {
+        LOG(ERROR) << "TransferSubmitter not initialized";
+        results.assign(transfers.size(), ErrorCode::TRANSFER_FAIL);
+        return results;
     }
 
-    const auto& response = start_result.value();
-    if (response.targets.empty()) {
-        LOG(INFO) << "action=replica_copy_skipped" << ", key=" << key
-                  << ", info=target_replicas_already_exist";
-        // Target replicas already exist, consider it success
-        auto copy_end_result = master_client_.CopyEnd(key);
-        if (!copy_end_result.has_value()) {
-            ErrorCode error = copy_end_result.error();
-            LOG(ERROR) << "action=replica_copy_failed" << ", key=" << key
-                       << ", error=copy_end_failed" << ", error_code=" << error;
-            return tl::unexpected(error);
+    // The source replicas are in local memory, so they are sent as they
+    // are without copying. Erasure coded targets are encoded on their own.
+    std::vector<std::vector<Slice>> sources(transfers.size());
+    std::vector<bool> batched(transfers.size(), true);
+    std::vector<Replica::Descriptor> batch_targets;
+    std::vector<std::vector<Slice>> batch_slices;
+    uint64_t total_bytes = 0;
+    for (size_t i = 0; i < transfers.size(); ++i) {
+        const auto& buffer_descriptor =
+            transfers[i].source.get_memory_descriptor().buffer_descriptor;
+        sources[i] = split_into_slices(
+            reinterpret_cast<void*>(buffer_descriptor.buffer_address_),
+            buffer_descriptor.size_);
+        total_bytes += buffer_descriptor.size_ * transfers[i].targets.size();
+        for (const auto& target : transfers[i].targets) {
+            if (!target.is_memory_replica() ||
+                target.get_memory_descriptor().is_erasure_coded()) {
+                batched[i] = false;
+            }
+        }
+        if (!batched[i]) {
+            continue;
+        }
+        for (const auto& target : transfers[i].targets) {
+            batch_targets.push_back(target);
+            batch_slices.push_back(sources[i]);
         }
-        return {};
     }
 
-    auto result = ExecuteReplicaTransfer(
-        key, "copy", [&]() { return master_client_.CopyEnd(key); },
-        [&]() { return master_client_.CopyRevoke(key); }, response.source,
-        response.targets);
+    task_executor_.Throttle(total_bytes);
 
-    if (result.has_value()) {
-        LOG(INFO) << "action=replica_copy_success" << ", key=" << key
-                  << ", target_count=" << response.targets.size();
+    if (!batch_targets.empty()) {
+        auto future = transfer_submitter_->submit_batch(
+            batch_targets, batch_slices, TransferRequest::WRITE,
+            TransferRequest::NORMAL);
+        ErrorCode result = future ? future->get() : ErrorCode::TRANSFER_FAIL;
+        if (result != ErrorCode::OK) {
+            // Retry the transfers one by one, so that one failed target does
+            // not fail the others
+            LOG(WARNING) << "action=replica_task_batch_transfer_failed"
+                         << ", target_count=" << batch_targets.size()
+                         << ", error_code=" << result;
+            batched.assign(transfers.size(), false);
+        }
     }
 
-    return result;
+    for (size_t i = 0; i < transfers.size(); ++i) {
+        if (batched[i]) {
+            continue;
+        }
+        for (const auto& target : transfers[i].targets) {
+            auto future = transfer_submitter_->submit(
+                target, sources[i], TransferRequest::WRITE,
+                TransferRequest::NORMAL);
+            if (!future || future->get() != ErrorCode::OK) {
+                results[i] = ErrorCode::TRANSFER_FAIL;
+                break;
+            }
+        }
+    }
+    return results;
 }
 
-tl::expected<void, ErrorCode> Client::Move(const std::string& key,
-                                           const std::string& source,
-                                           const std::string& target) {
-    LOG(INFO) << "action=replica_move_start" << ", key=" << key
-              << ", source_segment=" << source << ", target_segment=" << target;
-
-    // Call MoveStart first - it validates existence and allocates replica if
-    // needed
-    auto move_start_result = master_client_.MoveStart(key, source, target);
-    if (!move_start_result.has_value()) {
-        ErrorCode error = move_start_result.error();
-        LOG(ERROR) << "action=replica_move_failed" << ", key=" << key
-                   << ", error=move_start_failed" << ", error_code=" << error;
-        // MoveStart already validated existence, so we just return the error
-        return tl::unexpected(error);
+tl::expected<void, ErrorCode> Client::EndReplicaTransfer(
+    const ReplicaTransfer& transfer, bool success) {
+    if (success) {
+        return transfer.type == TaskType::REPLICA_COPY
+                   ? master_client_.CopyEnd(transfer.key)
+                   : master_client_.MoveEnd(transfer.key);
     }
+    auto revoke_result = transfer.type == TaskType::REPLICA_COPY
+                             ? master_client_.CopyRevoke(transfer.key)
+                             : master_client_.MoveRevoke(transfer.key);
+    if (!revoke_result.has_value()) {
+        LOG(WARNING) << "action=replica_" << ReplicaTaskAction(transfer.type)
+                     << "_revoke_failed" << ", key=" << transfer.key
+                     << ", error_code=" << revoke_result.error();
+    }
+    return revoke_result;
+}
 
-    const auto& response = move_start_result.value();
-    if (!response.target.has_value()) {
-        LOG(INFO) << "action=replica_move_skipped" << ", key=" << key
-                  << ", info=target_replica_already_exists";
-        // Target already exists, consider it success
-        auto move_end_result = master_client_.MoveEnd(key);
-        if (!move_end_result.has_value()) {
-            ErrorCode error = move_end_result.error();
-            LOG(ERROR) << "action=replica_move_failed" << ", key=" << key
-                       << ", error=move_end_failed" << ", error_code=" << error;
-            return tl::unexpected(error);
+tl::expected<void, ErrorCode> Client::Promote(
+    const std::string& key, const std::vector<Slice>& slices) {
+    std::vector<std::string> local_segments;
+    {
+        std::lock_guard<std::mutex> lock(mounted_segments_mutex_);
+        for (const auto& [segment_id, segment] : mounted_segments_) {
+            local_segments.push_back(segment.name);
         }
-        return {};
     }
 
-    std::vector<Replica::Descriptor> targets = {response.target.value()};
-
-    auto result = ExecuteReplicaTransfer(
-        key, "move", [&]() { return master_client_.MoveEnd(key); },
-        [&]() { return master_client_.MoveRevoke(key); }, response.source,
-        targets);
-
-    if (result.has_value()) {
-        LOG(INFO) << "action=replica_move_success" << ", key=" << key
-                  << ", source_segment=" << source
-                  << ", target_segment=" << target;
+    // An empty source segment copies from the disk replica
+    auto start_result = master_client_.CopyStart(key, "", local_segments);
+    if (!start_result.has_value()) {
+        // e.g. another reader is promoting it, or memory is full
+        VLOG(1) << "action=promote_skipped" << ", key=" << key
+                << ", error_code=" << start_result.error();
+        return tl::unexpected(start_result.error());
+    }
+
+    for (const auto& target : start_result.value().targets) {
+        // The slices of a read may be larger than the object
+        std::vector<Slice> data;
+        size_t remaining = target.get_memory_descriptor().total_size();
+        for (const auto& slice : slices) {
+            if (remaining == 0) {
+                break;
+            }
+            const size_t size = std::min(slice.size, remaining);
+            data.push_back(Slice{slice.ptr, size});
+            remaining -= size;
+        }
+        ErrorCode err = remaining == 0 ? TransferWrite(target, data)
+                                       : ErrorCode::INVALID_PARAMS;
+        if (err != ErrorCode::OK) {
+            LOG(WARNING) << "action=promote_failed" << ", key=" << key
+                         << ", error_code=" << err;
+            auto revoke_result = master_client_.CopyRevoke(key);
+            if (!revoke_result.has_value()) {
+                LOG(ERROR) << "action=promote_revoke_failed" << ", key=" << key
+                           << ", error_code=" << revoke_result.error();
+            }
+            return tl::unexpected(err);
+        }
     }
 
-    return result;
+    auto end_result = master_client_.CopyEnd(key);
+    if (!end_result.has_value()) {
+        LOG(WARNING) << "action=promote_failed" << ", key=" << key
+                     << ", error=copy_end_failed"
+                     << ", error_code=" << end_result.error();
+        return tl::unexpected(end_result.error());
+    }
+    VLOG(1) << "action=promote_success" << ", key=" << key;
+    return {};
 }
 
 tl::expected<QueryTaskResponse, ErrorCode> Client::QueryTask(
@@ -2069,8 +3231,12 @@ void Client::PutToLocalFile(const std::string& key,
             return;
         }
 
-        // If storage succeeded, end the put operation
-        auto end_result = master_client_.PutEnd(key, replica_type);
+        // If storage succeeded, end the put operation. The copy is
+        // checksummed here, off the thread of the put.
+        std::vector<Slice> value_slices{
+            {const_cast<char*>(value.data()), value.size()}};
+        auto end_result = master_client_.PutEnd(
+            key, replica_type, ComputeChecksum(value_slices));
         if (!end_result) {
             LOG(ERROR) << "Failed to end put operation for key: " << key;
         }
@@ -2079,35 +3245,125 @@ void Client::PutToLocalFile(const std::string& key,
 
 ErrorCode Client::TransferData(const Replica::Descriptor& replica_descriptor,
                                std::vector<Slice>& slices,
-                               TransferRequest::OpCode op_code) {
+                               TransferRequest::OpCode op_code,
+                               Deadline deadline) {
     if (!transfer_submitter_) {
         LOG(ERROR) << "TransferSubmitter not initialized";
         return ErrorCode::INVALID_PARAMS;
     }
-
-    auto future =
-        transfer_submitter_->submit(replica_descriptor, slices, op_code);
+    if (std::chrono::steady_clock::now() >= deadline) {
+        return ErrorCode::TRANSFER_TIMEOUT;
+    }
+
+    // Only reads are profiled, writes are not part of the read path
+    auto* profiler =
+        op_code == TransferRequest::READ ? phase_profiler() : nullptr;
+    // Reads feed the load of their replica's endpoint
+    const std::string* endpoint = nullptr;
+    if (replica_load_tracker_ && op_code == TransferRequest::READ &&
+        replica_descriptor.is_memory_replica()) {
+        endpoint = &replica_descriptor.get_memory_descriptor()
+                        .buffer_descriptor.transport_endpoint_;
+        replica_load_tracker_->OnStart(*endpoint);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    auto future = [&] {
+        ScopedPhaseTimer timer(profiler, ClientPhase::kSubmit);
+        return transfer_submitter_->submit(replica_descriptor, slices,
+                                           op_code);
+    }();
     if (!future) {
         LOG(ERROR) << "Failed to submit transfer operation";
+        if (endpoint) {
+            replica_load_tracker_->OnFinish(
+                *endpoint, std::chrono::steady_clock::now() - start, false);
+        }
         return ErrorCode::TRANSFER_FAIL;
     }
 
     VLOG(1) << "Using transfer strategy: " << future->strategy();
 
-    return future->get();
+    ScopedPhaseTimer timer(profiler, ClientPhase::kWait);
+    ErrorCode result = future->waitUntil(deadline);
+    if (endpoint) {
+        replica_load_tracker_->OnFinish(
+            *endpoint, std::chrono::steady_clock::now() - start,
+            result == ErrorCode::OK);
+    }
+    return result;
+}
+
+std::optional<uint32_t> Client::ComputeChecksum(
+    const std::vector<Slice>& slices) {
+    // The CPU cannot read device memory
+    if (!compute_checksums_ || GdsFileReader::IsDeviceMemory(slices)) {
+        return std::nullopt;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t crc = 0;
+    size_t bytes = 0;
+    for (const auto& slice : slices) {
+        crc = Crc32c(slice.ptr, slice.size, crc);
+        bytes += slice.size;
+    }
+    if (metrics_) {
+        metrics_->checksum_metric.computed_bytes.inc(bytes);
+        metrics_->checksum_metric.compute_time_us.inc(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+    }
+    return crc;
+}
+
+ErrorCode Client::VerifyChecksum(const std::string& key,
+                                 const std::optional<uint32_t>& checksum,
+                                 const Replica::Descriptor& replica,
+                                 const std::vector<Slice>& slices) {
+    if (!checksum ||
+        (replica.is_memory_replica() && !verify_memory_checksums_) ||
+        GdsFileReader::IsDeviceMemory(slices)) {
+        return ErrorCode::OK;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t crc = 0;
+    size_t bytes = 0;
+    for (const auto& slice : slices) {
+        crc = Crc32c(slice.ptr, slice.size, crc);
+        bytes += slice.size;
+    }
+    if (metrics_) {
+        metrics_->checksum_metric.verified_bytes.inc(bytes);
+        metrics_->checksum_metric.verify_time_us.inc(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+    }
+    if (crc != *checksum) {
+        LOG(ERROR) << "checksum_mismatch key=" << key
+                   << ", replica_id=" << replica.id << ", expected=" << std::hex
+                   << *checksum << ", actual=" << crc << std::dec;
+        if (metrics_) {
+            metrics_->checksum_metric.mismatches.inc();
+        }
+        return ErrorCode::CHECKSUM_MISMATCH;
+    }
+    return ErrorCode::OK;
 }
 
 ErrorCode Client::TransferWrite(const Replica::Descriptor& replica_descriptor,
-                                std::vector<Slice>& slices) {
-    return TransferData(replica_descriptor, slices, TransferRequest::WRITE);
+                                std::vector<Slice>& slices,
+                                Deadline deadline) {
+    return TransferData(replica_descriptor, slices, TransferRequest::WRITE,
+                        deadline);
 }
 
 ErrorCode Client::TransferRead(const Replica::Descriptor& replica_descriptor,
-                               std::vector<Slice>& slices) {
+                               std::vector<Slice>& slices, Deadline deadline) {
     size_t total_size = 0;
     if (replica_descriptor.is_memory_replica()) {
         auto& mem_desc = replica_descriptor.get_memory_descriptor();
-        total_size = mem_desc.buffer_descriptor.size_;
+        total_size = mem_desc.total_size();
     } else {
         auto& disk_desc = replica_descriptor.get_disk_descriptor();
         total_size = disk_desc.object_size;
@@ -2120,7 +3376,8 @@ ErrorCode Client::TransferRead(const Replica::Descriptor& replica_descriptor,
         return ErrorCode::INVALID_PARAMS;
     }
 
-    return TransferData(replica_descriptor, slices, TransferRequest::READ);
+    return TransferData(replica_descriptor, slices, TransferRequest::READ,
+                        deadline);
 }
 
 void Client::PollAndDispatchTasks() {
@@ -2147,67 +3404,93 @@ void Client::PollAndDispatchTasks() {
     }
 }
 
+void Client::WaitAndDispatchTasks(std::chrono::milliseconds period) {
+    const auto deadline = std::chrono::steady_clock::now() + period;
+    while (ping_running_ && task_running_.load()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) return;
+        auto fetch_result =
+            master_client_.WaitTasks(kTaskBatchSize, remaining.count());
+        if (!fetch_result.has_value()) {
+            // Masters without WaitTasks are polled once per period
+            PollAndDispatchTasks();
+            break;
+        }
+        const auto& tasks = fetch_result.value();
+        if (!tasks.empty()) {
+            LOG(INFO) << "action=task_poll_success"
+                      << ", task_count=" << tasks.size();
+        }
+        for (const auto& task_assignment : tasks) {
+            SubmitTask(task_assignment);
+        }
+    }
+    std::this_thread::sleep_until(deadline);
+}
+
 void Client::SubmitTask(const TaskAssignment& assignment) {
-    if (!task_running_.load()) {
+    ReplicaTask task;
+    task.assignment = assignment;
+    if (!task_running_.load() || !task_executor_.Submit(std::move(task))) {
         LOG(WARNING) << "action=task_rejected" << ", task_id=" << assignment.id
                      << ", reason=executor_stopped";
-        return;
     }
-
-    // Construct ClientTask from TaskAssignment
-    ClientTask client_task;
-    client_task.assignment = assignment;
-    client_task.retry_count = 0;
-
-    task_thread_pool_.enqueue(
-        [this, client_task]() { ExecuteTask(client_task); });
 }
 
-void Client::ExecuteTask(const ClientTask& client_task) {
-    const auto& assignment = client_task.assignment;
-    ErrorCode result = ErrorCode::OK;
-
-    try {
-        switch (assignment.type) {
-            case TaskType::REPLICA_COPY: {
-                ReplicaCopyPayload payload;
-                struct_json::from_json(payload, assignment.payload);
-                auto copy_result =
-                    Copy(payload.key, payload.source, payload.targets);
-                if (copy_result.has_value()) {
-                    result = ErrorCode::OK;
-                } else {
-                    result = copy_result.error();
-                }
-                break;
+void Client::ExecuteTaskBatch(std::vector<ReplicaTask>& tasks) {
+    std::vector<ErrorCode> results(tasks.size(), ErrorCode::OK);
+    std::vector<ReplicaTransfer> transfers;
+    // Index in tasks of each transfer
+    std::vector<size_t> transfer_tasks;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        const auto& assignment = tasks[i].assignment;
+        try {
+            auto started = StartReplicaTask(assignment);
+            if (!started.has_value()) {
+                results[i] = started.error();
+            } else if (started->has_value()) {
+                transfers.push_back(std::move(started->value()));
+                transfer_tasks.push_back(i);
             }
-            case TaskType::REPLICA_MOVE: {
-                ReplicaMovePayload payload;
-                struct_json::from_json(payload, assignment.payload);
-                auto move_result =
-                    Move(payload.key, payload.source, payload.target);
-                if (move_result.has_value()) {
-                    result = ErrorCode::OK;
+        } catch (const std::exception& e) {
+            LOG(ERROR) << "action=task_execution_failed"
+                       << ", task_id=" << assignment.id << ", error=exception"
+                       << ", exception=" << e.what();
+            results[i] = ErrorCode::INTERNAL_ERROR;
+        }
+    }
+
+    if (!transfers.empty()) {
+        auto transfer_results = TransferReplicas(transfers);
+        for (size_t j = 0; j < transfers.size(); ++j) {
+            const auto& transfer = transfers[j];
+            const char* action = ReplicaTaskAction(transfer.type);
+            ErrorCode result = transfer_results[j];
+            if (result == ErrorCode::OK) {
+                auto end_result = EndReplicaTransfer(transfer, true);
+                if (end_result.has_value()) {
+                    LOG(INFO) << "action=replica_" << action << "_success"
+                              << ", key=" << transfer.key
+                              << ", target_count=" << transfer.targets.size();
                 } else {
-                    result = move_result.error();
+                    result = end_result.error();
                 }
-                break;
             }
-            default:
-                LOG(ERROR) << "action=task_execution_failed"
-                           << ", task_id=" << assignment.id
-                           << ", error=unknown_task_type"
-                           << ", task_type=" << assignment.type;
-                result = ErrorCode::INVALID_PARAMS;
-                break;
+            if (result != ErrorCode::OK) {
+                EndReplicaTransfer(transfer, false);
+            }
+            results[transfer_tasks[j]] = result;
         }
-    } catch (const std::exception& e) {
-        LOG(ERROR) << "action=task_execution_failed"
-                   << ", task_id=" << assignment.id << ", error=exception"
-                   << ", exception=" << e.what();
-        result = ErrorCode::INTERNAL_ERROR;
     }
 
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        CompleteTask(tasks[i], results[i]);
+    }
+}
+
+void Client::CompleteTask(const ReplicaTask& task, ErrorCode result) {
+    const auto& assignment = task.assignment;
     if (result == ErrorCode::OK) {
         TaskCompleteRequest complete_request;
         complete_request.id = assignment.id;
@@ -2220,53 +3503,55 @@ void Client::ExecuteTask(const ClientTask& client_task) {
                          << ", task_id=" << assignment.id
                          << ", error_code=" << complete_result.error();
         }
-    } else {
-        uint32_t current_retry_count = client_task.retry_count;
-        // Only retry on allocation failures (NO_AVAILABLE_HANDLE)
-        // Other errors (e.g., OBJECT_NOT_FOUND, REPLICA_NOT_FOUND) should
-        // not be retried
-        bool should_retry =
-            (result == ErrorCode::NO_AVAILABLE_HANDLE) &&
-            (current_retry_count < assignment.max_retry_attempts);
-
-        if (should_retry) {
-            ClientTask retry_task = client_task;
-            retry_task.increment_retry();
-
-            const auto retry_delay =
-                std::chrono::milliseconds(50 * (current_retry_count + 1));
-            std::this_thread::sleep_for(retry_delay);
-
-            LOG(WARNING) << "action=task_execution_failed_retry"
+        return;
+    }
+
+    uint32_t current_retry_count = task.retry_count;
+    // Only retry on allocation failures (NO_AVAILABLE_HANDLE)
+    // Other errors (e.g., OBJECT_NOT_FOUND, REPLICA_NOT_FOUND) should
+    // not be retried
+    bool should_retry = (result == ErrorCode::NO_AVAILABLE_HANDLE) &&
+                        (current_retry_count < assignment.max_retry_attempts);
+
+    if (should_retry) {
+        ReplicaTask retry_task = task;
+        retry_task.increment_retry();
+
+        const auto retry_delay =
+            std::chrono::milliseconds(50 * (current_retry_count + 1));
+
+        LOG(WARNING) << "action=task_execution_failed_retry"
+                     << ", task_id=" << assignment.id
+                     << ", error_code=" << result
+                     << ", retry_count=" << current_retry_count
+                     << ", max_retry_count=" << assignment.max_retry_attempts
+                     << ", will_retry=true"
+                     << ", retry_delay=" << retry_delay.count() << "ms";
+
+        // Queued with a delay, the worker goes on with other tasks
+        if (!task_executor_.Submit(std::move(retry_task), retry_delay)) {
+            LOG(WARNING) << "action=task_rejected"
                          << ", task_id=" << assignment.id
-                         << ", error_code=" << result
-                         << ", retry_count=" << current_retry_count
-                         << ", max_retry_count="
-                         << assignment.max_retry_attempts << ", will_retry=true"
-                         << ", retry_delay=" << retry_delay.count() << "ms";
-
-            task_thread_pool_.enqueue(
-                [this, retry_task]() { ExecuteTask(retry_task); });
-        } else {
-            LOG(ERROR) << "action=task_execution_failed"
-                       << ", task_id=" << assignment.id
-                       << ", error_code=" << result
-                       << ", retry_count=" << current_retry_count
-                       << ", max_retry_count=" << assignment.max_retry_attempts;
-            TaskCompleteRequest complete_request;
-            complete_request.id = assignment.id;
-            complete_request.status = TaskStatus::FAILED;
-            complete_request.message =
-                toString(result) + " (max retries reached: " +
-                std::to_string(assignment.max_retry_attempts) + ")";
-            auto complete_result =
-                master_client_.MarkTaskToComplete(complete_request);
-            if (!complete_result.has_value()) {
-                LOG(WARNING) << "action=task_complete_failed"
-                             << ", task_id=" << assignment.id
-                             << ", error_code=" << complete_result.error();
-            }
+                         << ", reason=executor_stopped";
         }
+        return;
+    }
+
+    LOG(ERROR) << "action=task_execution_failed"
+               << ", task_id=" << assignment.id << ", error_code=" << result
+               << ", retry_count=" << current_retry_count
+               << ", max_retry_count=" << assignment.max_retry_attempts;
+    TaskCompleteRequest complete_request;
+    complete_request.id = assignment.id;
+    complete_request.status = TaskStatus::FAILED;
+    complete_request.message = toString(result) + " (max retries reached: " +
+                               std::to_string(assignment.max_retry_attempts) +
+                               ")";
+    auto complete_result = master_client_.MarkTaskToComplete(complete_request);
+    if (!complete_result.has_value()) {
+        LOG(WARNING) << "action=task_complete_failed"
+                     << ", task_id=" << assignment.id
+                     << ", error_code=" << complete_result.error();
     }
 }
 
@@ -2302,6 +3587,21 @@ void Client::PingThreadMain(bool is_ha_mode,
     // thread
     std::future<void> remount_segment_future;
 
+    // Sent with every ping for the load-aware allocation strategy. The
+    // traffic of a failed ping is dropped, the master only needs a recent
+    // estimate.
+    ClientLoadReport load_report;
+    load_report.endpoint = local_hostname_;
+    load_report.rack = GetEnvStringOr("MC_STORE_RACK", "");
+
+    const bool is_partitioned = !master_client_.GetPartitionMasters().empty();
+    // Partitioned clients ping every master and are not aggregated
+    const bool aggregate_pings =
+        !is_partitioned &&
+        GetEnvOr<int64_t>("MC_STORE_PING_AGGREGATION", 0) != 0;
+    std::shared_ptr<PingAggregator> ping_aggregator;
+    std::string ping_aggregator_address;
+
     while (ping_running_) {
         // Join the remount segment thread if it is ready
         if (remount_segment_future.valid() &&
@@ -2310,12 +3610,46 @@ void Client::PingThreadMain(bool is_ha_mode,
             remount_segment_future = std::future<void>();
         }
 
+        if (is_partitioned) {
+            RefreshPartitionRing();
+        }
+
         // Ping master
-        auto ping_result = master_client_.Ping();
+        load_report.traffic = segment_traffic_.take();
+        tl::expected<PingResponse, ErrorCode> ping_result;
+        if (aggregate_pings) {
+            // The aggregator follows the master the client is connected to
+            if (!ping_aggregator ||
+                ping_aggregator_address != current_master_address) {
+                ping_aggregator = PingAggregator::Get(current_master_address);
+                ping_aggregator_address = current_master_address;
+            }
+            auto batch_result = master_client_.AggregatedPing(
+                *ping_aggregator, load_report,
+                task_running_.load() ? kTaskBatchSize : 0);
+            if (batch_result) {
+                for (const auto& task_assignment : batch_result->tasks) {
+                    SubmitTask(task_assignment);
+                }
+                ping_result = std::move(batch_result->ping);
+            } else {
+                ping_result = tl::make_unexpected(batch_result.error());
+            }
+        } else {
+            ping_result = master_client_.Ping(load_report);
+        }
         if (ping_result) {
             // Reset ping failure count
             ping_fail_count = 0;
             auto& ping_response = ping_result.value();
+            if (negative_exist_cache_) {
+                if (ping_response.put_keys_truncated) {
+                    negative_exist_cache_->Clear();
+                } else {
+                    negative_exist_cache_->InvalidateHashes(
+                        ping_response.put_key_hashes);
+                }
+            }
             if (ping_response.client_status == ClientStatus::NEED_REMOUNT &&
                 !remount_segment_future.valid()) {
                 // Ensure at most one remount segment thread is running
@@ -2323,11 +3657,19 @@ void Client::PingThreadMain(bool is_ha_mode,
                     std::async(std::launch::async, remount_segment);
             }
 
-            // Poll for tasks and dispatch to task thread pool
-            PollAndDispatchTasks();
-
-            std::this_thread::sleep_for(
-                std::chrono::milliseconds(success_ping_interval_ms));
+            // Wait for tasks and dispatch them to the task thread pool until
+            // the next ping. Partitioned masters are polled one by one.
+            // Aggregated pings fetch the tasks and wait for the next round.
+            if (aggregate_pings) {
+                continue;
+            } else if (is_partitioned) {
+                PollAndDispatchTasks();
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(success_ping_interval_ms));
+            } else {
+                WaitAndDispatchTasks(
+                    std::chrono::milliseconds(success_ping_interval_ms));
+            }
             continue;
         }
 
@@ -2340,7 +3682,14 @@ void Client::PingThreadMain(bool is_ha_mode,
         }
 
         // Exceeded ping failure threshold. Reconnect based on mode.
-        if (is_ha_mode) {
+        if (is_partitioned) {
+            // A failed master leaves the ring when its lease expires, and
+            // the ring is refreshed before every ping
+            LOG(ERROR) << "Failed to ping the partitioned masters for "
+                       << ping_fail_count << " times";
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(fail_ping_interval_ms));
+        } else if (is_ha_mode) {
             LOG(ERROR)
                 << "Failed to ping master for " << ping_fail_count
                 << " times; fetching latest master view and reconnecting";
@@ -2367,6 +3716,14 @@ void Client::PingThreadMain(bool is_ha_mode,
 
             current_master_address = master_address;
             LOG(INFO) << "Reconnected to master " << master_address;
+            // Leases granted by the previous master are not known to the new
+            // one, so the cached replicas can no longer be trusted.
+            if (replica_cache_) {
+                replica_cache_->Clear();
+            }
+            if (negative_exist_cache_) {
+                negative_exist_cache_->Clear();
+            }
             ping_fail_count = 0;
         } else {
             LOG(ERROR) << "Failed to ping master for " << ping_fail_count
@@ -2381,6 +3738,12 @@ void Client::PingThreadMain(bool is_ha_mode,
                 continue;
             }
             LOG(INFO) << "Reconnected to master " << current_master_address;
+            if (replica_cache_) {
+                replica_cache_->Clear();
+            }
+            if (negative_exist_cache_) {
+                negative_exist_cache_->Clear();
+            }
             ping_fail_count = 0;
         }
     }
@@ -2390,13 +3753,38 @@ void Client::PingThreadMain(bool is_ha_mode,
     }
 }
 
+void Client::RefreshPartitionRing() {
+    std::vector<std::string> master_addresses;
+    if (partition_ring_helper_.GetMembers(master_addresses) != ErrorCode::OK ||
+        master_addresses.empty() ||
+        master_addresses == master_client_.GetPartitionMasters()) {
+        return;
+    }
+    LOG(INFO) << "Partition ring changed to " << master_addresses.size()
+              << " masters";
+    auto err = master_client_.ConnectPartitioned(master_addresses);
+    if (err != ErrorCode::OK) {
+        LOG(ERROR) << "Failed to connect to the partitioned masters: "
+                   << toString(err);
+        return;
+    }
+    // Leases of the keys that moved are not known to their new masters
+    if (replica_cache_) {
+        replica_cache_->Clear();
+    }
+    if (negative_exist_cache_) {
+        negative_exist_cache_->Clear();
+    }
+}
+
 ErrorCode Client::FindFirstCompleteReplica(
     const std::vector<Replica::Descriptor>& replica_list,
     Replica::Descriptor& replica) {
+    ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kFindReplica);
     // Find the first complete replica
     for (size_t i = 0; i < replica_list.size(); ++i) {
         if (replica_list[i].status == ReplicaStatus::COMPLETE) {
-            replica = replica_list[i];
+            replica = SelectReplica(replica_list, i);
             return ErrorCode::OK;
         }
     }
@@ -2405,12 +3793,51 @@ ErrorCode Client::FindFirstCompleteReplica(
     return ErrorCode::INVALID_REPLICA;
 }
 
+const Replica::Descriptor& Client::SelectReplica(
+    const std::vector<Replica::Descriptor>& replica_list, size_t first,
+    const Replica::Descriptor* excluded) {
+    const auto& first_replica = replica_list[first];
+    // Striped replicas are read from several endpoints at once
+    if (!replica_load_tracker_ || !first_replica.is_memory_replica() ||
+        first_replica.get_memory_descriptor().is_striped()) {
+        return first_replica;
+    }
+    // The master lists DRAM replicas before the slower CXL ones
+    const auto& protocol =
+        first_replica.get_memory_descriptor().buffer_descriptor.protocol_;
+    std::vector<size_t> candidates;
+    std::vector<const std::string*> endpoints;
+    for (size_t i = first; i < replica_list.size(); ++i) {
+        const auto& replica = replica_list[i];
+        if (replica.status != ReplicaStatus::COMPLETE ||
+            !replica.is_memory_replica() ||
+            replica.get_memory_descriptor().is_striped() ||
+            (excluded && replica.id == excluded->id)) {
+            continue;
+        }
+        const auto& buffer = replica.get_memory_descriptor().buffer_descriptor;
+        if (buffer.protocol_ != protocol) {
+            continue;
+        }
+        if (IsReplicaOnLocalMemory(replica)) {
+            return replica;
+        }
+        candidates.push_back(i);
+        endpoints.push_back(&buffer.transport_endpoint_);
+    }
+    if (candidates.empty()) {
+        return first_replica;
+    }
+    return replica_list[candidates[replica_load_tracker_->Choose(endpoints)]];
+}
+
 tl::expected<Replica::Descriptor, ErrorCode> Client::GetPreferredReplica(
     const std::vector<Replica::Descriptor>& replica_list) {
+    ScopedPhaseTimer timer(phase_profiler(), ClientPhase::kPreferredReplica);
     if (replica_list.empty()) {
         return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
     }
-    if (mounted_segments_.empty() || replica_list.size() == 1) {
+    if (replica_list.size() == 1) {
         return replica_list[0];
     }
 
@@ -2433,6 +3860,10 @@ tl::expected<Replica::Descriptor, ErrorCode> Client::GetPreferredReplica(
         }
     }
 
+    // No local replica, spread the reads over the remote ones
+    if (replica_list[0].status == ReplicaStatus::COMPLETE) {
+        return SelectReplica(replica_list, 0);
+    }
     return replica_list[0];
 }
 
@@ -2462,6 +3893,54 @@ size_t Client::GetLocalHotCacheSizeFromEnv() {
     return 0;
 }
 
+void Client::InitDeviceHotCache() {
+    const auto size_per_device =
+        GetEnvOr<int64_t>("MC_STORE_DEVICE_HOT_CACHE_SIZE", 0);
+    if (size_per_device <= 0) {
+        device_hot_cache_.reset();
+        return;
+    }
+    const size_t block_size = GetLocalHotBlockSizeFromEnv(16 * 1024 * 1024);
+    const auto min_reads = std::max<int64_t>(
+        GetEnvOr<int64_t>("MC_STORE_DEVICE_HOT_CACHE_MIN_READS", 2), 1);
+    device_hot_cache_ = std::make_unique<DeviceHotCache>(
+        size_per_device, block_size, static_cast<uint32_t>(min_reads));
+    LOG(INFO) << "Device hot cache enabled with size=" << size_per_device
+              << " per device, block size=" << block_size
+              << ", min_reads=" << min_reads;
+}
+
+void Client::InitReplicaCache() {
+    const auto capacity = GetEnvOr<int64_t>("MC_STORE_REPLICA_CACHE_SIZE", 0);
+    if (capacity <= 0) {
+        replica_cache_.reset();
+        return;
+    }
+    const auto min_remaining_lease_ms = std::max<int64_t>(
+        GetEnvOr<int64_t>("MC_STORE_REPLICA_CACHE_MIN_LEASE_MS", 1000), 0);
+    replica_cache_ = std::make_unique<ReplicaCache>(
+        capacity, std::chrono::milliseconds(min_remaining_lease_ms));
+    LOG(INFO) << "Replica cache enabled with capacity=" << capacity
+              << " keys, min_remaining_lease_ms=" << min_remaining_lease_ms;
+}
+
+void Client::InitNegativeExistCache() {
+    const auto capacity = GetEnvOr<int64_t>("MC_STORE_NEGATIVE_CACHE_SIZE", 0);
+    if (capacity <= 0) {
+        negative_exist_cache_.reset();
+        master_client_.WatchPuts(false);
+        return;
+    }
+    const auto ttl_ms = std::max<int64_t>(
+        GetEnvOr<int64_t>("MC_STORE_NEGATIVE_CACHE_TTL_MS", 500), 0);
+    negative_exist_cache_ = std::make_unique<NegativeExistCache>(
+        capacity, std::chrono::milliseconds(ttl_ms));
+    // Puts by other clients are learned from the ping responses
+    master_client_.WatchPuts(true);
+    LOG(INFO) << "Negative exist cache enabled with capacity=" << capacity
+              << " keys, ttl_ms=" << ttl_ms;
+}
+
 size_t Client::GetLocalHotBlockSizeFromEnv(size_t default_value) {
     if (const char* ev_block_size = std::getenv("LOCAL_HOT_BLOCK_SIZE")) {
         std::string ev_block_size_str(ev_block_size);
@@ -2549,13 +4028,21 @@ void Client::ProcessSlicesAsync(const std::string& key,
         if (!hot_cache_handler_->SubmitPutTask(key, slices[i])) {
             LOG(ERROR) << "Failed to submit hot cache put task for key=" << key
                        << " slice_idx=" << i;
-            return;
+            break;
         }
     }
+
+    if (metrics_) {
+        metrics_->hot_cache_metric.cached_bytes.update(
+            hot_cache_->GetCachedBytes());
+        metrics_->hot_cache_metric.reserved_bytes.update(
+            hot_cache_->GetReservedBytes());
+    }
 }
 
 bool Client::IsReplicaOnLocalMemory(const Replica::Descriptor& replica) {
-    if (!replica.is_memory_replica()) {
+    if (!replica.is_memory_replica() ||
+        replica.get_memory_descriptor().is_striped()) {
         return false;
     }
     const auto replica_transfer_endpoint =
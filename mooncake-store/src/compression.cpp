@@ -0,0 +1,154 @@
+#include "compression.h"
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace mooncake {
+
+namespace {
+
+#ifdef USE_ZSTD
+// Contexts keep their buffers between calls, one per thread
+struct ZstdContexts {
+    std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> compress{
+        ZSTD_createCCtx(), ZSTD_freeCCtx};
+    std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> decompress{
+        ZSTD_createDCtx(), ZSTD_freeDCtx};
+};
+
+ZstdContexts& ThreadZstdContexts() {
+    static thread_local ZstdContexts contexts;
+    return contexts;
+}
+#endif
+
+}  // namespace
+
+std::optional<CompressionCodec> ParseCompressionCodec(const std::string& name) {
+    if (name == "none") {
+        return CompressionCodec::kNone;
+    }
+    if (name == "lz4") {
+        return CompressionCodec::kLz4;
+    }
+    if (name == "zstd") {
+        return CompressionCodec::kZstd;
+    }
+    return std::nullopt;
+}
+
+const char* CompressionCodecName(CompressionCodec codec) {
+    switch (codec) {
+        case CompressionCodec::kNone:
+            return "none";
+        case CompressionCodec::kLz4:
+            return "lz4";
+        case CompressionCodec::kZstd:
+            return "zstd";
+    }
+    return "unknown";
+}
+
+bool IsCompressionCodecAvailable(CompressionCodec codec) {
+    switch (codec) {
+        case CompressionCodec::kNone:
+            return true;
+        case CompressionCodec::kLz4:
+#ifdef USE_LZ4
+            return true;
+#else
+            return false;
+#endif
+        case CompressionCodec::kZstd:
+#ifdef USE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+size_t Compress(CompressionCodec codec, [[maybe_unused]] int level,
+                [[maybe_unused]] const void* src,
+                [[maybe_unused]] size_t src_size, [[maybe_unused]] void* dst,
+                [[maybe_unused]] size_t dst_capacity) {
+    switch (codec) {
+        case CompressionCodec::kLz4: {
+#ifdef USE_LZ4
+            if (src_size > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+                return 0;
+            }
+            const int result = LZ4_compress_default(
+                static_cast<const char*>(src), static_cast<char*>(dst),
+                static_cast<int>(src_size),
+                static_cast<int>(std::min<size_t>(dst_capacity, INT_MAX)));
+            return result > 0 ? static_cast<size_t>(result) : 0;
+#else
+            return 0;
+#endif
+        }
+        case CompressionCodec::kZstd: {
+#ifdef USE_ZSTD
+            auto* ctx = ThreadZstdContexts().compress.get();
+            if (ctx == nullptr) {
+                return 0;
+            }
+            const size_t result = ZSTD_compressCCtx(ctx, dst, dst_capacity,
+                                                    src, src_size, level);
+            return ZSTD_isError(result) ? 0 : result;
+#else
+            return 0;
+#endif
+        }
+        case CompressionCodec::kNone:
+            return 0;
+    }
+    return 0;
+}
+
+bool Decompress(CompressionCodec codec, [[maybe_unused]] const void* src,
+                [[maybe_unused]] size_t src_size, [[maybe_unused]] void* dst,
+                [[maybe_unused]] size_t dst_size) {
+    switch (codec) {
+        case CompressionCodec::kLz4: {
+#ifdef USE_LZ4
+            if (src_size > INT_MAX || dst_size > INT_MAX) {
+                return false;
+            }
+            const int result = LZ4_decompress_safe(
+                static_cast<const char*>(src), static_cast<char*>(dst),
+                static_cast<int>(src_size), static_cast<int>(dst_size));
+            return result >= 0 && static_cast<size_t>(result) == dst_size;
+#else
+            return false;
+#endif
+        }
+        case CompressionCodec::kZstd: {
+#ifdef USE_ZSTD
+            auto* ctx = ThreadZstdContexts().decompress.get();
+            if (ctx == nullptr) {
+                return false;
+            }
+            const size_t result =
+                ZSTD_decompressDCtx(ctx, dst, dst_size, src, src_size);
+            return !ZSTD_isError(result) && result == dst_size;
+#else
+            return false;
+#endif
+        }
+        case CompressionCodec::kNone:
+            return false;
+    }
+    return false;
+}
+
+}  // namespace mooncake
@@ -0,0 +1,239 @@
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+namespace mooncake {
+
+namespace {
+
+// Reflected Castagnoli polynomial
+constexpr uint32_t kPoly = 0x82f63b78;
+
+// Chunk lengths of the three interleaved streams
+constexpr size_t kLongChunk = 8192;
+constexpr size_t kShortChunk = 256;
+
+// a * b modulo the polynomial, both reflected
+uint32_t MultModP(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ kPoly : b >> 1;
+    }
+    return p;
+}
+
+struct CrcTables {
+    uint32_t slice[8][256];
+    // x^(2^k) modulo the polynomial
+    uint32_t x2n[32];
+    // Appending kLongChunk or kShortChunk zero bytes to a CRC state, a byte
+    // of the state at a time
+    uint32_t long_shift[4][256];
+    uint32_t short_shift[4][256];
+
+    CrcTables() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t crc = n;
+            for (int k = 0; k < 8; ++k) {
+                crc = crc & 1 ? (crc >> 1) ^ kPoly : crc >> 1;
+            }
+            slice[0][n] = crc;
+        }
+        for (uint32_t n = 0; n < 256; ++n) {
+            for (int k = 1; k < 8; ++k) {
+                slice[k][n] = (slice[k - 1][n] >> 8) ^
+                              slice[0][slice[k - 1][n] & 0xff];
+            }
+        }
+
+        uint32_t p = 1u << 30;  // x^1
+        x2n[0] = p;
+        for (int k = 1; k < 32; ++k) {
+            x2n[k] = p = MultModP(p, p);
+        }
+
+        FillShift(long_shift, kLongChunk);
+        FillShift(short_shift, kShortChunk);
+    }
+
+    // x^(8 * len) modulo the polynomial
+    uint32_t ZerosOperator(size_t len) const {
+        uint32_t p = 1u << 31;  // x^0
+        unsigned k = 3;
+        while (len) {
+            if (len & 1) {
+                p = MultModP(x2n[k & 31], p);
+            }
+            len >>= 1;
+            k++;
+        }
+        return p;
+    }
+
+    void FillShift(uint32_t (&table)[4][256], size_t len) {
+        const uint32_t op = ZerosOperator(len);
+        for (int byte = 0; byte < 4; ++byte) {
+            for (uint32_t n = 0; n < 256; ++n) {
+                table[byte][n] = MultModP(op, n << (8 * byte));
+            }
+        }
+    }
+};
+
+const CrcTables& Tables() {
+    static const CrcTables tables;
+    return tables;
+}
+
+uint32_t Shift(const uint32_t (&table)[4][256], uint32_t crc) {
+    return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+           table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+}
+
+uint32_t Crc32cSoftware(uint32_t crc, const uint8_t* p, size_t len) {
+    const auto& t = Tables();
+    while (len >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        word ^= crc;
+        crc = t.slice[7][word & 0xff] ^ t.slice[6][(word >> 8) & 0xff] ^
+              t.slice[5][(word >> 16) & 0xff] ^
+              t.slice[4][(word >> 24) & 0xff] ^
+              t.slice[3][(word >> 32) & 0xff] ^
+              t.slice[2][(word >> 40) & 0xff] ^
+              t.slice[1][(word >> 48) & 0xff] ^ t.slice[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ t.slice[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#if defined(__x86_64__)
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+CRC32C_TARGET inline uint64_t HwCrc64(uint64_t crc, uint64_t word) {
+    return _mm_crc32_u64(crc, word);
+}
+CRC32C_TARGET inline uint32_t HwCrc8(uint32_t crc, uint8_t byte) {
+    return _mm_crc32_u8(crc, byte);
+}
+#else
+#define CRC32C_TARGET __attribute__((target("+crc")))
+CRC32C_TARGET inline uint64_t HwCrc64(uint64_t crc, uint64_t word) {
+    return __crc32cd(static_cast<uint32_t>(crc), word);
+}
+CRC32C_TARGET inline uint32_t HwCrc8(uint32_t crc, uint8_t byte) {
+    return __crc32cb(crc, byte);
+}
+#endif
+
+// Consumes groups of three consecutive chunks. The CRC instruction takes
+// several cycles but a new one can start every cycle, so three independent
+// streams keep it busy; their states are then merged by shifting the
+// earlier ones over the length of the later chunks.
+CRC32C_TARGET uint32_t HwInterleave(uint32_t crc, const uint8_t*& p,
+                                    size_t& len, size_t chunk,
+                                    const uint32_t (&shift)[4][256]) {
+    while (len >= 3 * chunk) {
+        uint64_t crc0 = crc;
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        const uint8_t* end = p + chunk;
+        do {
+            uint64_t w0, w1, w2;
+            std::memcpy(&w0, p, sizeof(w0));
+            std::memcpy(&w1, p + chunk, sizeof(w1));
+            std::memcpy(&w2, p + 2 * chunk, sizeof(w2));
+            crc0 = HwCrc64(crc0, w0);
+            crc1 = HwCrc64(crc1, w1);
+            crc2 = HwCrc64(crc2, w2);
+            p += 8;
+        } while (p < end);
+        crc = Shift(shift, static_cast<uint32_t>(crc0)) ^
+              static_cast<uint32_t>(crc1);
+        crc = Shift(shift, crc) ^ static_cast<uint32_t>(crc2);
+        p += 2 * chunk;
+        len -= 3 * chunk;
+    }
+    return crc;
+}
+
+CRC32C_TARGET uint32_t Crc32cHardware(uint32_t crc, const uint8_t* p,
+                                      size_t len) {
+    while (len && (reinterpret_cast<uintptr_t>(p) & 7)) {
+        crc = HwCrc8(crc, *p++);
+        len--;
+    }
+    const auto& t = Tables();
+    crc = HwInterleave(crc, p, len, kLongChunk, t.long_shift);
+    crc = HwInterleave(crc, p, len, kShortChunk, t.short_shift);
+    while (len >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc = static_cast<uint32_t>(HwCrc64(crc, word));
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = HwCrc8(crc, *p++);
+    }
+    return crc;
+}
+
+#undef CRC32C_TARGET
+#endif
+
+using Crc32cFn = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+Crc32cFn SelectCrc32c() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) {
+        return Crc32cHardware;
+    }
+#elif defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+        return Crc32cHardware;
+    }
+#endif
+    return Crc32cSoftware;
+}
+
+Crc32cFn Implementation() {
+    static const Crc32cFn fn = SelectCrc32c();
+    return fn;
+}
+
+}  // namespace
+
+uint32_t Crc32c(const void* data, size_t len, uint32_t crc) {
+    return ~Implementation()(~crc, static_cast<const uint8_t*>(data), len);
+}
+
+uint32_t Crc32cCombine(uint32_t crc_a, uint32_t crc_b, size_t len_b) {
+    return MultModP(Tables().ZerosOperator(len_b), crc_a) ^ crc_b;
+}
+
+bool Crc32cHardwareAccelerated() {
+    return Implementation() != Crc32cSoftware;
+}
+
+}  // namespace mooncake
@@ -0,0 +1,164 @@
+#include "cuda_staging.h"
+
+#include <glog/logging.h>
+
+#include <cstring>
+
+#ifdef USE_CUDA
+#include <cuda_runtime.h>
+#endif
+
+namespace mooncake {
+
+#ifdef USE_CUDA
+
+namespace {
+
+bool CheckCuda(cudaError_t err, const char* what) {
+    if (err == cudaSuccess) return true;
+    LOG(ERROR) << what << " failed: " << cudaGetErrorString(err);
+    return false;
+}
+
+}  // namespace
+
+CudaStaging::CudaStaging(void* host_buffer, size_t size)
+    : host_buffer_(host_buffer) {
+    int device_count = 0;
+    if (!host_buffer || size == 0 ||
+        cudaGetDeviceCount(&device_count) != cudaSuccess ||
+        device_count == 0) {
+        cudaGetLastError();
+        return;
+    }
+    // Otherwise copies from pageable memory are staged by the driver and
+    // block the caller
+    host_registered_ = CheckCuda(
+        cudaHostRegister(host_buffer, size, cudaHostRegisterDefault),
+        "cudaHostRegister of the client buffer");
+    if (!host_registered_) {
+        cudaGetLastError();
+    }
+}
+
+CudaStaging::~CudaStaging() {
+    if (host_registered_) {
+        CheckCuda(cudaHostUnregister(host_buffer_),
+                  "cudaHostUnregister of the client buffer");
+    }
+}
+
+bool CudaStaging::IsDeviceMemory(const void* ptr) {
+    cudaPointerAttributes attributes;
+    if (cudaPointerGetAttributes(&attributes, ptr) != cudaSuccess) {
+        // Memory CUDA does not know of
+        cudaGetLastError();
+        return false;
+    }
+    return attributes.type == cudaMemoryTypeDevice;
+}
+
+int CudaStaging::DeviceOf(const void* ptr) {
+    cudaPointerAttributes attributes;
+    if (cudaPointerGetAttributes(&attributes, ptr) != cudaSuccess) {
+        cudaGetLastError();
+        return -1;
+    }
+    return attributes.type == cudaMemoryTypeDevice ? attributes.device : -1;
+}
+
+void* CudaStaging::AllocateDeviceMemory(int device, size_t size) {
+    int current_device = 0;
+    if (!CheckCuda(cudaGetDevice(&current_device), "cudaGetDevice") ||
+        !CheckCuda(cudaSetDevice(device), "cudaSetDevice")) {
+        return nullptr;
+    }
+    void* ptr = nullptr;
+    if (!CheckCuda(cudaMalloc(&ptr, size), "cudaMalloc")) {
+        ptr = nullptr;
+    }
+    cudaSetDevice(current_device);
+    return ptr;
+}
+
+void CudaStaging::FreeDeviceMemory(void* ptr) {
+    if (ptr) CheckCuda(cudaFree(ptr), "cudaFree");
+}
+
+bool CudaStaging::CopyToHost(void* dst, const void* src, size_t size) {
+    return CheckCuda(cudaMemcpyAsync(dst, src, size, cudaMemcpyDefault,
+                                     cudaStreamPerThread),
+                     "cudaMemcpyAsync to host");
+}
+
+bool CudaStaging::CopyToDevice(void* dst, const void* src, size_t size) {
+    return CheckCuda(cudaMemcpyAsync(dst, src, size, cudaMemcpyDefault,
+                                     cudaStreamPerThread),
+                     "cudaMemcpyAsync to device");
+}
+
+CudaStaging::Fence CudaStaging::Mark() {
+    cudaEvent_t event = nullptr;
+    if (!CheckCuda(cudaEventCreateWithFlags(&event, cudaEventDisableTiming),
+                   "cudaEventCreate")) {
+        return nullptr;
+    }
+    if (!CheckCuda(cudaEventRecord(event, cudaStreamPerThread),
+                   "cudaEventRecord")) {
+        cudaEventDestroy(event);
+        return nullptr;
+    }
+    return event;
+}
+
+bool CudaStaging::Wait(Fence fence) {
+    // Without an event, wait for everything queued
+    if (!fence) return Synchronize();
+    auto event = static_cast<cudaEvent_t>(fence);
+    bool ok = CheckCuda(cudaEventSynchronize(event), "cudaEventSynchronize");
+    cudaEventDestroy(event);
+    return ok;
+}
+
+bool CudaStaging::Synchronize() {
+    return CheckCuda(cudaStreamSynchronize(cudaStreamPerThread),
+                     "cudaStreamSynchronize");
+}
+
+#else
+
+CudaStaging::CudaStaging(void* host_buffer, size_t size)
+    : host_buffer_(host_buffer) {}
+
+CudaStaging::~CudaStaging() = default;
+
+bool CudaStaging::IsDeviceMemory(const void* ptr) { return false; }
+
+int CudaStaging::DeviceOf(const void* ptr) { return -1; }
+
+void* CudaStaging::AllocateDeviceMemory(int device, size_t size) {
+    LOG(ERROR) << "Device memory needs a build with USE_CUDA";
+    return nullptr;
+}
+
+void CudaStaging::FreeDeviceMemory(void* ptr) {}
+
+bool CudaStaging::CopyToHost(void* dst, const void* src, size_t size) {
+    memcpy(dst, src, size);
+    return true;
+}
+
+bool CudaStaging::CopyToDevice(void* dst, const void* src, size_t size) {
+    memcpy(dst, src, size);
+    return true;
+}
+
+CudaStaging::Fence CudaStaging::Mark() { return nullptr; }
+
+bool CudaStaging::Wait(Fence fence) { return true; }
+
+bool CudaStaging::Synchronize() { return true; }
+
+#endif
+
+}  // namespace mooncake
@@ -0,0 +1,142 @@
+#include "device_hot_cache.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace mooncake {
+
+DeviceHotCache::DeviceHotCache(size_t size_per_device, size_t block_size,
+                               uint32_t min_reads)
+    : size_per_device_(size_per_device),
+      block_size_(block_size),
+      min_reads_(std::max<uint32_t>(1, min_reads)),
+      sketch_(std::max<size_t>(
+          size_per_device / std::max<size_t>(block_size, 1), 1)) {}
+
+int DeviceHotCache::SlicesDevice(const std::vector<Slice>& slices) {
+    int device = -1;
+    for (const auto& slice : slices) {
+        if (!slice.ptr || slice.size == 0) {
+            continue;
+        }
+        const int slice_device = CudaStaging::DeviceOf(slice.ptr);
+        if (slice_device < 0 || (device >= 0 && slice_device != device)) {
+            return -1;
+        }
+        device = slice_device;
+    }
+    return device;
+}
+
+std::shared_ptr<LocalHotCache> DeviceHotCache::CacheOf(int device,
+                                                       bool create) {
+    {
+        std::shared_lock<std::shared_mutex> lock(caches_mutex_);
+        auto it = caches_.find(device);
+        if (it != caches_.end() || !create) {
+            return it != caches_.end() ? it->second : nullptr;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(caches_mutex_);
+    auto& cache = caches_[device];
+    if (!cache) {
+        cache = std::make_shared<LocalHotCache>(size_per_device_, block_size_,
+                                                0, device);
+        if (cache->GetArenaSize() == 0) {
+            LOG(ERROR) << "Device hot cache disabled on device " << device;
+        } else {
+            LOG(INFO) << "Device hot cache enabled on device " << device
+                      << " with size=" << cache->GetArenaSize();
+        }
+    }
+    return cache;
+}
+
+bool DeviceHotCache::Read(const std::string& key, size_t size,
+                          const std::vector<Slice>& slices) {
+    const int device = SlicesDevice(slices);
+    if (device < 0) {
+        return false;
+    }
+    auto cache = CacheOf(device, false);
+    if (!cache) {
+        return false;
+    }
+    HotMemBlock* block = cache->GetHotKey(key);
+    if (!block) {
+        return false;
+    }
+
+    bool ok = block->size == size;
+    size_t offset = 0;
+    for (size_t i = 0; ok && i < slices.size() && offset < size; ++i) {
+        const size_t length = std::min(slices[i].size, size - offset);
+        ok = staging_.CopyToDevice(slices[i].ptr,
+                                   static_cast<char*>(block->addr) + offset,
+                                   length);
+        offset += length;
+    }
+    // The block may be evicted once released
+    ok = staging_.Synchronize() && ok && offset == size;
+    cache->ReleaseHotKey(key);
+    if (ok) {
+        sketch_.Increment(key);
+    }
+    return ok;
+}
+
+void DeviceHotCache::Admit(const std::string& key,
+                           const std::vector<Slice>& slices) {
+    const int device = SlicesDevice(slices);
+    if (device < 0) {
+        return;
+    }
+    sketch_.Increment(key);
+    if (sketch_.Estimate(key) < min_reads_) {
+        return;
+    }
+    auto cache = CacheOf(device, true);
+    size_t size = 0;
+    for (const auto& slice : slices) {
+        size += slice.size;
+    }
+    if (size == 0 || size > cache->GetArenaSize() || cache->HasHotKey(key)) {
+        return;
+    }
+
+    HotMemBlock* block = cache->GetFreeBlock(
+        key, size, [this, &key](const std::string& victim) {
+            return sketch_.Estimate(key) > sketch_.Estimate(victim);
+        });
+    if (!block) {
+        return;
+    }
+    bool ok = true;
+    size_t offset = 0;
+    for (const auto& slice : slices) {
+        ok = ok && slice.ptr &&
+             staging_.CopyToDevice(static_cast<char*>(block->addr) + offset,
+                                   slice.ptr, slice.size);
+        offset += slice.size;
+    }
+    ok = staging_.Synchronize() && ok;
+    block->size = size;
+    // A block without key is freed by PutHotKey
+    if (ok) {
+        block->key_ = key;
+    }
+    cache->PutHotKey(block);
+}
+
+size_t DeviceHotCache::GetCachedBytes() const {
+    std::shared_lock<std::shared_mutex> lock(caches_mutex_);
+    size_t bytes = 0;
+    for (const auto& [device, cache] : caches_) {
+        bytes += cache->GetCachedBytes();
+    }
+    return bytes;
+}
+
+}  // namespace mooncake
@@ -290,7 +290,24 @@ ErrorCode DummyClient::connect(const std::string& server_address) {
 
 int DummyClient::register_shm_via_ipc(const ShmHelper::ShmSegment* shm,
                                       bool is_local) {
-    if (shm->fd < 0) {
+    ShmRegisterRequest req;
+    req.client_id_first = client_id_.first;
+    req.client_id_second = client_id_.second;
+    req.dummy_base_addr = reinterpret_cast<uintptr_t>(shm->base_addr);
+    req.shm_size = shm->size;
+    req.is_local_buffer = is_local;
+    req.is_request_ring = false;
+
+    if (send_fd_via_ipc(shm->fd, req) != 0) {
+        return -1;
+    }
+    LOG(INFO) << "Successfully registered SHM via IPC, base: "
+              << shm->base_addr;
+    return 0;
+}
+
+int DummyClient::send_fd_via_ipc(int fd, ShmRegisterRequest& req) {
+    if (fd < 0) {
         LOG(ERROR) << "Invalid shm_fd during IPC registration";
         return -1;
     }
@@ -324,14 +341,7 @@ int DummyClient::register_shm_via_ipc(const ShmHelper::ShmSegment* shm,
         return -1;
     }
 
-    ShmRegisterRequest req;
-    req.client_id_first = client_id_.first;
-    req.client_id_second = client_id_.second;
-    req.dummy_base_addr = reinterpret_cast<uintptr_t>(shm->base_addr);
-    req.shm_size = shm->size;
-    req.is_local_buffer = is_local;
-
-    if (send_fd(sock_fd, shm->fd, &req, sizeof(req)) < 0) {
+    if (send_fd(sock_fd, fd, &req, sizeof(req)) < 0) {
         LOG(ERROR) << "Failed to send FD to RealClient: " << strerror(errno);
         close(sock_fd);
         return -1;
@@ -351,12 +361,65 @@ int DummyClient::register_shm_via_ipc(const ShmHelper::ShmSegment* shm,
                    << status;
         return -1;
     }
+    return 0;
+}
 
-    LOG(INFO) << "Successfully registered SHM via IPC, base: "
-              << shm->base_addr;
+int DummyClient::setup_request_ring() {
+    if (GetEnvOr<int>("MC_STORE_SHM_RING", 1) == 0) {
+        return 0;
+    }
+    auto ring = ShmRequestRing::Create();
+    if (!ring) {
+        return -1;
+    }
+
+    ShmRegisterRequest req;
+    req.client_id_first = client_id_.first;
+    req.client_id_second = client_id_.second;
+    req.dummy_base_addr = 0;
+    req.shm_size = ring.value()->size();
+    req.is_local_buffer = false;
+    req.is_request_ring = true;
+    if (send_fd_via_ipc(ring.value()->fd(), req) != 0) {
+        return -1;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(request_ring_mutex_);
+    request_ring_ = std::move(ring.value());
+    LOG(INFO) << "RealClient serves requests through shared memory";
     return 0;
 }
 
+std::shared_ptr<ShmRequestRing> DummyClient::get_request_ring() {
+    std::shared_lock<std::shared_mutex> lock(request_ring_mutex_);
+    return request_ring_;
+}
+
+void DummyClient::reset_request_ring() {
+    // Callers still waiting on the old ring keep it mapped
+    std::unique_lock<std::shared_mutex> lock(request_ring_mutex_);
+    request_ring_.reset();
+}
+
+tl::expected<std::vector<int64_t>, ErrorCode>
+DummyClient::submit_to_request_ring(ShmRequestRing::Op op,
+                                    const std::vector<std::string>& keys,
+                                    const std::vector<uint64_t>& buffers,
+                                    const std::vector<size_t>& sizes,
+                                    const ReplicateConfig& config) {
+    auto ring = get_request_ring();
+    if (!ring || !connected_) {
+        return tl::make_unexpected(ErrorCode::BUFFER_OVERFLOW);
+    }
+    ShmRequestRing::Request request;
+    request.op = op;
+    request.keys = keys;
+    request.buffers = buffers;
+    request.sizes = sizes;
+    request.config = config;
+    return ring->Submit(request, [this] { return connected_; });
+}
+
 int DummyClient::setup_dummy(size_t mem_pool_size, size_t local_buffer_size,
                              const std::string& server_address,
                              const std::string& ipc_socket_path) {
@@ -394,6 +457,11 @@ int DummyClient::setup_dummy(size_t mem_pool_size, size_t local_buffer_size,
     local_buffer_shm->registered = true;
     local_buffer_shm->is_local = true;
 
+    if (setup_request_ring() != 0) {
+        LOG(WARNING) << "Failed to set up the shared memory request ring, "
+                        "all requests go through RPC";
+    }
+
     ping_running_ = true;
     ping_thread_ = std::thread([this]() mutable { this->ping_thread_main(); });
 
@@ -402,6 +470,7 @@ int DummyClient::setup_dummy(size_t mem_pool_size, size_t local_buffer_size,
 
 int DummyClient::tearDownAll() {
     unregister_shm();
+    reset_request_ring();
 
     if (ping_running_) {
         ping_running_ = false;
@@ -506,6 +575,21 @@ int DummyClient::put_batch(const std::vector<std::string>& keys,
         keys, values, config, client_id_));
 }
 
+std::vector<int> DummyClient::batch_put_parts(
+    const std::vector<std::string>& keys,
+    const std::vector<std::vector<std::span<const char>>>& all_parts,
+    const ReplicateConfig& config) {
+    // The parts are copied into the shared memory anyway, one key at a time
+    std::vector<int> results;
+    results.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        results.push_back(i < all_parts.size()
+                              ? put_parts(keys[i], all_parts[i], config)
+                              : to_py_ret(ErrorCode::INVALID_PARAMS));
+    }
+    return results;
+}
+
 int DummyClient::put_parts(const std::string& key,
                            std::vector<std::span<const char>> values,
                            const ReplicateConfig& config) {
@@ -558,6 +642,11 @@ std::vector<int> DummyClient::batchIsExist(
     return results;
 }
 
+int64_t DummyClient::batchIsExistPrefix(const std::vector<std::string>& keys) {
+    return to_py_ret(
+        invoke_rpc<&RealClient::batchIsExistPrefix_internal, int64_t>(keys));
+}
+
 int64_t DummyClient::getSize(const std::string& key) {
     return to_py_ret(invoke_rpc<&RealClient::getSize_internal, int64_t>(key));
 }
@@ -567,6 +656,13 @@ std::shared_ptr<BufferHandle> DummyClient::get_buffer(const std::string& key) {
     return nullptr;
 }
 
+std::shared_ptr<BufferHandle> DummyClient::get_ranges_buffer(
+    const std::string& key,
+    const std::vector<std::pair<uint64_t, uint64_t>>& ranges) {
+    // Dummy client does not use BufferHandle, so we return nullptr
+    return nullptr;
+}
+
 std::tuple<uint64_t, size_t> DummyClient::get_buffer_info(
     const std::string& key) {
     auto result = invoke_rpc<&RealClient::get_buffer_info_dummy_helper,
@@ -602,6 +698,15 @@ std::vector<int> DummyClient::batch_put_from(
     for (auto ptr : buffer_ptrs) {
         buffers.push_back(reinterpret_cast<uint64_t>(ptr));
     }
+    auto ring_results = submit_to_request_ring(
+        ShmRequestRing::Op::BATCH_PUT_FROM, keys, buffers, sizes, config);
+    if (ring_results.has_value()) {
+        return std::vector<int>(ring_results->begin(), ring_results->end());
+    }
+    if (ring_results.error() != ErrorCode::BUFFER_OVERFLOW) {
+        return std::vector<int>(keys.size(), toInt(ring_results.error()));
+    }
+
     auto internal_results =
         invoke_batch_rpc<&RealClient::batch_put_from_dummy_helper, void>(
             keys.size(), keys, buffers, sizes, config, client_id_);
@@ -621,6 +726,30 @@ int DummyClient::put_from(const std::string& key, void* buffer, size_t size,
     return -1;
 }
 
+int DummyClient::stream_put_start(const std::string& key,
+                                  const std::vector<uint64_t>& chunk_sizes,
+                                  const ReplicateConfig& config) {
+    // TODO: implement this function
+    return -1;
+}
+
+int DummyClient::stream_put_from(const std::string& key, uint64_t chunk_index,
+                                 void* buffer, size_t size) {
+    // TODO: implement this function
+    return -1;
+}
+
+int DummyClient::stream_put_end(const std::string& key) {
+    // TODO: implement this function
+    return -1;
+}
+
+int64_t DummyClient::get_range_into(const std::string& key, uint64_t offset,
+                                    void* buffer, size_t size) {
+    // TODO: implement this function
+    return -1;
+}
+
 std::vector<int64_t> DummyClient::batch_get_into(
     const std::vector<std::string>& keys, const std::vector<void*>& buffer_ptrs,
     const std::vector<size_t>& sizes) {
@@ -628,6 +757,16 @@ std::vector<int64_t> DummyClient::batch_get_into(
     for (auto ptr : buffer_ptrs) {
         buffers.push_back(reinterpret_cast<uint64_t>(ptr));
     }
+    auto ring_results = submit_to_request_ring(
+        ShmRequestRing::Op::BATCH_GET_INTO, keys, buffers, sizes);
+    if (ring_results.has_value()) {
+        return std::move(ring_results.value());
+    }
+    if (ring_results.error() != ErrorCode::BUFFER_OVERFLOW) {
+        return std::vector<int64_t>(keys.size(),
+                                    toInt(ring_results.error()));
+    }
+
     auto internal_results =
         invoke_batch_rpc<&RealClient::batch_get_into_dummy_helper, int64_t>(
             keys.size(), keys, buffers, sizes, client_id_);
@@ -743,6 +882,7 @@ void DummyClient::ping_thread_main() {
 
         if (ping_fail_count >= max_ping_fail_count) {
             connected_ = false;
+            reset_request_ring();
             LOG(ERROR) << "RealClient lost, entering reconnection loop...";
 
             // Reconnection Loop
@@ -776,6 +916,10 @@ void DummyClient::ping_thread_main() {
                         LOG(INFO) << "RPC connection restored";
                         ping_fail_count = 0;
                         connected_ = true;
+                        if (setup_request_ring() != 0) {
+                            LOG(WARNING) << "Failed to set up the shared "
+                                            "memory request ring again";
+                        }
                         break;  // Exit reconnection loop
                     }
                 }
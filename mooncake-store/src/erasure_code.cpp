@@ -0,0 +1,278 @@
+#include "erasure_code.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace mooncake {
+
+namespace {
+
+struct GfTables {
+    uint8_t exp[512];
+    uint8_t log[256];
+
+    GfTables() {
+        uint32_t x = 1;
+        for (int i = 0; i < 255; ++i) {
+            exp[i] = static_cast<uint8_t>(x);
+            log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11d;
+            }
+        }
+        for (int i = 255; i < 512; ++i) {
+            exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+    }
+};
+
+const GfTables& Tables() {
+    static const GfTables tables;
+    return tables;
+}
+
+uint8_t GfInv(uint8_t a) {
+    const auto& t = Tables();
+    return t.exp[255 - t.log[a]];
+}
+
+// c * x == lo[x & 0xf] ^ hi[x >> 4]
+struct NibbleTables {
+    alignas(16) uint8_t lo[16];
+    alignas(16) uint8_t hi[16];
+
+    explicit NibbleTables(uint8_t c) {
+        for (int x = 0; x < 16; ++x) {
+            lo[x] = GfMul(c, static_cast<uint8_t>(x));
+            hi[x] = GfMul(c, static_cast<uint8_t>(x << 4));
+        }
+    }
+};
+
+void GfMulAddScalar(const NibbleTables& t, const uint8_t* src, uint8_t* dst,
+                    size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] ^= t.lo[src[i] & 0xf] ^ t.hi[src[i] >> 4];
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) void GfMulAddAvx2(const NibbleTables& t,
+                                                  const uint8_t* src,
+                                                  uint8_t* dst, size_t len) {
+    const __m256i lo = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(t.lo)));
+    const __m256i hi = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(t.hi)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i s =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i prod = _mm256_xor_si256(
+            _mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask)),
+            _mm256_shuffle_epi8(
+                hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i*>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_xor_si256(d, prod));
+    }
+    GfMulAddScalar(t, src + i, dst + i, len - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) void GfMulAddAvx512(
+    const NibbleTables& t, const uint8_t* src, uint8_t* dst, size_t len) {
+    const __m512i lo = _mm512_broadcast_i32x4(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(t.lo)));
+    const __m512i hi = _mm512_broadcast_i32x4(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(t.hi)));
+    const __m512i mask = _mm512_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i s = _mm512_loadu_si512(src + i);
+        __m512i prod = _mm512_xor_si512(
+            _mm512_shuffle_epi8(lo, _mm512_and_si512(s, mask)),
+            _mm512_shuffle_epi8(
+                hi, _mm512_and_si512(_mm512_srli_epi64(s, 4), mask)));
+        __m512i d = _mm512_loadu_si512(dst + i);
+        _mm512_storeu_si512(dst + i, _mm512_xor_si512(d, prod));
+    }
+    GfMulAddScalar(t, src + i, dst + i, len - i);
+}
+#elif defined(__aarch64__)
+void GfMulAddNeon(const NibbleTables& t, const uint8_t* src, uint8_t* dst,
+                  size_t len) {
+    const uint8x16_t lo = vld1q_u8(t.lo);
+    const uint8x16_t hi = vld1q_u8(t.hi);
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t prod = veorq_u8(vqtbl1q_u8(lo, vandq_u8(s, mask)),
+                                   vqtbl1q_u8(hi, vshrq_n_u8(s, 4)));
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), prod));
+    }
+    GfMulAddScalar(t, src + i, dst + i, len - i);
+}
+#endif
+
+using GfMulAddFn = void (*)(const NibbleTables&, const uint8_t*, uint8_t*,
+                            size_t);
+
+GfMulAddFn SelectGfMulAdd() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512bw")) {
+        return GfMulAddAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return GfMulAddAvx2;
+    }
+    return GfMulAddScalar;
+#elif defined(__aarch64__)
+    return GfMulAddNeon;
+#else
+    return GfMulAddScalar;
+#endif
+}
+
+}  // namespace
+
+uint8_t GfMul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    const auto& t = Tables();
+    return t.exp[t.log[a] + t.log[b]];
+}
+
+void GfMulAdd(uint8_t c, const uint8_t* src, uint8_t* dst, size_t len) {
+    if (c == 0 || len == 0) {
+        return;
+    }
+    if (c == 1) {
+        for (size_t i = 0; i < len; ++i) {
+            dst[i] ^= src[i];
+        }
+        return;
+    }
+    static const GfMulAddFn fn = SelectGfMulAdd();
+    fn(NibbleTables(c), src, dst, len);
+}
+
+ReedSolomonCode::ReedSolomonCode(size_t data_shards, size_t parity_shards)
+    : data_shards_(data_shards), parity_shards_(parity_shards) {
+    if (data_shards == 0 || data_shards + parity_shards > kMaxShards) {
+        throw std::invalid_argument("Invalid Reed-Solomon shard count");
+    }
+    // Cauchy matrix 1 / (x_j + y_i) with x_j = data_shards + j and y_i = i,
+    // which are distinct elements of GF(2^8).
+    parity_matrix_.resize(parity_shards * data_shards);
+    for (size_t j = 0; j < parity_shards; ++j) {
+        for (size_t i = 0; i < data_shards; ++i) {
+            parity_matrix_[j * data_shards + i] =
+                GfInv(static_cast<uint8_t>((data_shards + j) ^ i));
+        }
+    }
+}
+
+uint8_t ReedSolomonCode::Coefficient(size_t row, size_t col) const {
+    if (row < data_shards_) {
+        return row == col ? 1 : 0;
+    }
+    return parity_matrix_[(row - data_shards_) * data_shards_ + col];
+}
+
+void ReedSolomonCode::Encode(const std::vector<const uint8_t*>& data,
+                             const std::vector<uint8_t*>& parity,
+                             size_t len) const {
+    for (size_t j = 0; j < parity_shards_; ++j) {
+        for (size_t i = 0; i < data_shards_; ++i) {
+            if (data[i] != nullptr) {
+                GfMulAdd(parity_matrix_[j * data_shards_ + i], data[i],
+                         parity[j], len);
+            }
+        }
+    }
+}
+
+bool ReedSolomonCode::Decode(const std::vector<uint8_t*>& shards,
+                             const std::vector<bool>& present,
+                             size_t len) const {
+    const size_t k = data_shards_;
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < k; ++i) {
+        if (!present[i]) {
+            missing.push_back(i);
+        }
+    }
+    if (missing.empty()) {
+        return true;
+    }
+
+    std::vector<size_t> rows;
+    for (size_t r = 0; r < k + parity_shards_ && rows.size() < k; ++r) {
+        if (present[r]) {
+            rows.push_back(r);
+        }
+    }
+    if (rows.size() < k) {
+        return false;
+    }
+
+    // Invert the generator rows of the present shards by Gauss-Jordan
+    // elimination. Any k rows are independent, so a pivot always exists.
+    std::vector<uint8_t> a(k * k);
+    std::vector<uint8_t> inv(k * k, 0);
+    for (size_t t = 0; t < k; ++t) {
+        for (size_t c = 0; c < k; ++c) {
+            a[t * k + c] = Coefficient(rows[t], c);
+        }
+        inv[t * k + t] = 1;
+    }
+    for (size_t col = 0; col < k; ++col) {
+        size_t pivot = col;
+        while (a[pivot * k + col] == 0) {
+            ++pivot;
+        }
+        if (pivot != col) {
+            for (size_t c = 0; c < k; ++c) {
+                std::swap(a[pivot * k + c], a[col * k + c]);
+                std::swap(inv[pivot * k + c], inv[col * k + c]);
+            }
+        }
+        const uint8_t scale = GfInv(a[col * k + col]);
+        for (size_t c = 0; c < k; ++c) {
+            a[col * k + c] = GfMul(a[col * k + c], scale);
+            inv[col * k + c] = GfMul(inv[col * k + c], scale);
+        }
+        for (size_t r = 0; r < k; ++r) {
+            const uint8_t factor = a[r * k + col];
+            if (r == col || factor == 0) {
+                continue;
+            }
+            for (size_t c = 0; c < k; ++c) {
+                a[r * k + c] ^= GfMul(factor, a[col * k + c]);
+                inv[r * k + c] ^= GfMul(factor, inv[col * k + c]);
+            }
+        }
+    }
+
+    for (size_t i : missing) {
+        std::memset(shards[i], 0, len);
+        for (size_t t = 0; t < k; ++t) {
+            GfMulAdd(inv[i * k + t], shards[rows[t]], shards[i], len);
+        }
+    }
+    return true;
+}
+
+}  // namespace mooncake
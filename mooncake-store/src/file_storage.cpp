@@ -1,5 +1,6 @@
 #include "file_storage.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -35,6 +36,15 @@ FileStorageConfig FileStorageConfig::FromEnvironment() {
         GetEnvOr<int64_t>("MOONCAKE_SCANMETA_ITERATOR_KEYS_LIMIT",
                           config.scanmeta_iterator_keys_limit);
 
+    config.scanmeta_threads =
+        std::max<uint32_t>(GetEnvOr<uint32_t>("MOONCAKE_SCANMETA_THREADS",
+                                              config.scanmeta_threads),
+                           1);
+
+    config.key_filter_bits_per_key =
+        GetEnvOr<uint32_t>("MOONCAKE_OFFLOAD_KEY_FILTER_BITS_PER_KEY",
+                           config.key_filter_bits_per_key);
+
     config.total_keys_limit = GetEnvOr<int64_t>(
         "MOONCAKE_OFFLOAD_TOTAL_KEYS_LIMIT", config.total_keys_limit);
 
@@ -44,10 +54,6 @@ FileStorageConfig FileStorageConfig::FromEnvironment() {
     config.heartbeat_interval_seconds =
         GetEnvOr<uint32_t>("MOONCAKE_OFFLOAD_HEARTBEAT_INTERVAL_SECONDS",
                            config.heartbeat_interval_seconds);
-    config.client_buffer_gc_interval_seconds =
-        GetEnvOr<uint32_t>("MOONCAKE_OFFLOAD_CLIENT_BUFFER_GC_INTERVAL_SECONDS",
-                           config.heartbeat_interval_seconds);
-
     config.client_buffer_gc_ttl_ms =
         GetEnvOr<uint64_t>("MOONCAKE_OFFLOAD_CLIENT_BUFFER_GC_TTL_MS",
                            config.client_buffer_gc_ttl_ms);
@@ -161,10 +167,6 @@ FileStorage::~FileStorage() {
     if (heartbeat_thread_.joinable()) {
         heartbeat_thread_.join();
     }
-    client_buffer_gc_running_ = false;
-    if (client_buffer_gc_thread_.joinable()) {
-        client_buffer_gc_thread_.join();
-    }
 }
 
 tl::expected<void, ErrorCode> FileStorage::Init() {
@@ -231,14 +233,12 @@ tl::expected<void, ErrorCode> FileStorage::Init() {
                 std::chrono::seconds(config_.heartbeat_interval_seconds));
         }
     });
-    client_buffer_gc_running_.store(true);
-    client_buffer_gc_thread_ =
-        std::thread(&FileStorage::ClientBufferGCThreadFunc, this);
     return {};
 }
 
 tl::expected<std::vector<uint64_t>, ErrorCode> FileStorage::BatchGet(
-    const std::vector<std::string>& keys, const std::vector<int64_t>& sizes) {
+    const std::vector<std::string>& keys, const std::vector<int64_t>& sizes,
+    uint64_t& batch_id) {
     auto start_time = std::chrono::steady_clock::now();
     auto allocate_res = AllocateBatch(keys, sizes);
     if (!allocate_res) {
@@ -252,7 +252,12 @@ tl::expected<std::vector<uint64_t>, ErrorCode> FileStorage::BatchGet(
         return tl::make_unexpected(result.error());
     }
     MutexLocker locker(&client_buffer_mutex_);
-    client_buffer_allocated_batches_.emplace_back(std::move(allocated_batch));
+    ReleaseExpiredBatches();
+    batch_id = next_batch_id_++;
+    client_buffer_leases_.emplace_back(allocated_batch->lease_timeout,
+                                       batch_id);
+    client_buffer_allocated_batches_.emplace(batch_id,
+                                             std::move(allocated_batch));
     auto end_time = std::chrono::steady_clock::now();
     auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(
                             end_time - start_time)
@@ -401,9 +406,10 @@ tl::expected<void, ErrorCode> FileStorage::BatchQuerySegmentSlices(
                 if (descriptor.is_memory_replica()) {
                     const auto& memory_descriptor =
                         descriptor.get_memory_descriptor();
-                    if (memory_descriptor.buffer_descriptor
-                            .transport_endpoint_ ==
-                        client_->GetTransportEndpoint()) {
+                    if (!memory_descriptor.is_striped() &&
+                        memory_descriptor.buffer_descriptor
+                                .transport_endpoint_ ==
+                            client_->GetTransportEndpoint()) {
                         std::vector<Slice> slices;
                         void* slice_ptr = reinterpret_cast<void*>(
                             memory_descriptor.buffer_descriptor
@@ -456,15 +462,7 @@ FileStorage::AllocateBatch(const std::vector<std::string>& keys,
             gc_triggered = true;
             {
                 MutexLocker locker(&client_buffer_mutex_);
-                auto gc_now = std::chrono::steady_clock::now();
-                auto it = client_buffer_allocated_batches_.begin();
-                while (it != client_buffer_allocated_batches_.end()) {
-                    if (gc_now >= (*it)->lease_timeout) {
-                        it = client_buffer_allocated_batches_.erase(it);
-                    } else {
-                        ++it;
-                    }
-                }
+                ReleaseExpiredBatches();
             }
             alloc_result = client_buffer_allocator_->allocate(sizes[i]);
         }
@@ -485,27 +483,41 @@ FileStorage::AllocateBatch(const std::vector<std::string>& keys,
     return result;
 }
 
-void FileStorage::ClientBufferGCThreadFunc() {
-    LOG(INFO) << "action=client_buffer_gc_thread_started";
-    while (client_buffer_gc_running_) {
-        {
-            MutexLocker locker(&client_buffer_mutex_);
-            if (!client_buffer_allocated_batches_.empty()) {
-                auto now = std::chrono::steady_clock::now();
-                client_buffer_allocated_batches_.erase(
-                    std::remove_if(
-                        client_buffer_allocated_batches_.begin(),
-                        client_buffer_allocated_batches_.end(),
-                        [&](const std::shared_ptr<AllocatedBatch>& batch) {
-                            return now >= batch->lease_timeout;
-                        }),
-                    client_buffer_allocated_batches_.end());
-            }
+tl::expected<void, ErrorCode> FileStorage::ReleaseBatch(uint64_t batch_id) {
+    std::shared_ptr<AllocatedBatch> batch;
+    {
+        MutexLocker locker(&client_buffer_mutex_);
+        auto it = client_buffer_allocated_batches_.find(batch_id);
+        if (it == client_buffer_allocated_batches_.end()) {
+            // Its lease ran out before the reader was done
+            VLOG(1) << "Client buffer batch already released, id = "
+                    << batch_id;
+            return tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
+        }
+        batch = std::move(it->second);
+        client_buffer_allocated_batches_.erase(it);
+        // The lease is dropped when it reaches the front
+        ReleaseExpiredBatches();
+    }
+    // The handles free the buffers once the last reference goes, outside of
+    // the lock
+    return {};
+}
+
+void FileStorage::ReleaseExpiredBatches() {
+    auto now = std::chrono::steady_clock::now();
+    while (!client_buffer_leases_.empty()) {
+        auto& [lease_timeout, batch_id] = client_buffer_leases_.front();
+        auto it = client_buffer_allocated_batches_.find(batch_id);
+        if (it != client_buffer_allocated_batches_.end()) {
+            if (now < lease_timeout) break;
+            LOG(WARNING) << "Client buffer batch lease expired before "
+                            "release, id = "
+                         << batch_id;
+            client_buffer_allocated_batches_.erase(it);
         }
-        std::this_thread::sleep_for(
-            std::chrono::seconds(config_.client_buffer_gc_interval_seconds));
+        client_buffer_leases_.pop_front();
     }
-    LOG(INFO) << "action=client_buffer_gc_thread_stopped";
 }
 
 }  // namespace mooncake
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include "flat_replica_list.h"
+
+#include <glog/logging.h>
+
+#include <unordered_map>
+
+namespace mooncake {
+
+namespace {
+
+// Interns strings into the table of flat. The strings passed to Add must
+// outlive the table, which indexes them by view.
+class StringTable {
+   public:
+    explicit StringTable(FlatReplicaLists& flat) : flat_(flat) {
+        flat_.string_offsets.push_back(0);
+    }
+
+    uint32_t Add(const std::string& value) {
+        auto it = index_.find(value);
+        if (it != index_.end()) {
+            return it->second;
+        }
+        const auto index =
+            static_cast<uint32_t>(flat_.string_offsets.size() - 1);
+        flat_.strings.append(value);
+        flat_.string_offsets.push_back(
+            static_cast<uint32_t>(flat_.strings.size()));
+        index_.emplace(value, index);
+        return index;
+    }
+
+   private:
+    FlatReplicaLists& flat_;
+    std::unordered_map<std::string_view, uint32_t> index_;
+};
+
+bool IsConsistent(const FlatReplicaLists& flat) {
+    const size_t num_keys = flat.key_error.size();
+    const size_t num_replicas = flat.replica_id.size();
+    const size_t num_stripes = flat.stripe_size.size();
+    const size_t num_strings =
+        flat.string_offsets.empty() ? 0 : flat.string_offsets.size() - 1;
+
+    if (flat.key_lease_ttl_ms.size() != num_keys ||
+        flat.key_promote.size() != num_keys ||
+        flat.key_has_checksum.size() != num_keys ||
+        flat.key_checksum.size() != num_keys ||
+        flat.replica_end.size() != num_keys ||
+        flat.replica_status.size() != num_replicas ||
+        flat.replica_kind.size() != num_replicas ||
+        flat.replica_parity_stripes.size() != num_replicas ||
+        flat.replica_object_size.size() != num_replicas ||
+        flat.replica_string.size() != num_replicas ||
+        flat.replica_client_id_first.size() != num_replicas ||
+        flat.replica_client_id_second.size() != num_replicas ||
+        flat.stripe_end.size() != num_replicas ||
+        flat.stripe_address.size() != num_stripes ||
+        flat.stripe_protocol.size() != num_stripes ||
+        flat.stripe_endpoint.size() != num_stripes ||
+        flat.string_offsets.empty()) {
+        return false;
+    }
+    for (size_t i = 0; i + 1 < flat.string_offsets.size(); ++i) {
+        if (flat.string_offsets[i] > flat.string_offsets[i + 1]) return false;
+    }
+    if (flat.string_offsets.front() != 0 ||
+        flat.string_offsets.back() != flat.strings.size()) {
+        return false;
+    }
+
+    uint32_t prev = 0;
+    for (auto end : flat.replica_end) {
+        if (end < prev || end > num_replicas) return false;
+        prev = end;
+    }
+    if (prev != num_replicas) return false;
+
+    prev = 0;
+    for (auto end : flat.stripe_end) {
+        if (end < prev || end > num_stripes) return false;
+        prev = end;
+    }
+    if (prev != num_stripes) return false;
+
+    for (size_t r = 0; r < num_replicas; ++r) {
+        if (flat.replica_kind[r] > 2 ||
+            (flat.replica_kind[r] != 0 &&
+             flat.replica_string[r] >= num_strings)) {
+            return false;
+        }
+    }
+    for (size_t s = 0; s < num_stripes; ++s) {
+        if (flat.stripe_protocol[s] >= num_strings ||
+            flat.stripe_endpoint[s] >= num_strings) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+FlatReplicaLists EncodeReplicaLists(
+    const std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>&
+        results) {
+    FlatReplicaLists flat;
+    StringTable strings(flat);
+    flat.key_error.reserve(results.size());
+    flat.key_lease_ttl_ms.reserve(results.size());
+    flat.key_promote.reserve(results.size());
+    flat.key_has_checksum.reserve(results.size());
+    flat.key_checksum.reserve(results.size());
+    flat.replica_end.reserve(results.size());
+
+    auto add_stripe = [&](const AllocatedBuffer::Descriptor& stripe) {
+        flat.stripe_size.push_back(stripe.size_);
+        flat.stripe_address.push_back(stripe.buffer_address_);
+        flat.stripe_protocol.push_back(strings.Add(stripe.protocol_));
+        flat.stripe_endpoint.push_back(strings.Add(stripe.transport_endpoint_));
+    };
+
+    for (const auto& result : results) {
+        if (!result) {
+            flat.key_error.push_back(static_cast<int32_t>(result.error()));
+            flat.key_lease_ttl_ms.push_back(0);
+            flat.key_promote.push_back(0);
+            flat.key_has_checksum.push_back(0);
+            flat.key_checksum.push_back(0);
+            flat.replica_end.push_back(
+                static_cast<uint32_t>(flat.replica_id.size()));
+            continue;
+        }
+        flat.key_error.push_back(static_cast<int32_t>(ErrorCode::OK));
+        flat.key_lease_ttl_ms.push_back(result->lease_ttl_ms);
+        flat.key_promote.push_back(result->promote ? 1 : 0);
+        flat.key_has_checksum.push_back(result->checksum ? 1 : 0);
+        flat.key_checksum.push_back(result->checksum.value_or(0));
+
+        for (const auto& replica : result->replicas) {
+            const auto& variant = replica.descriptor_variant;
+            uint32_t parity_stripes = 0;
+            uint64_t object_size = 0;
+            uint32_t string = 0;
+            UUID client_id{0, 0};
+            if (auto* memory = std::get_if<MemoryDescriptor>(&variant)) {
+                parity_stripes = memory->parity_stripes;
+                add_stripe(memory->buffer_descriptor);
+                for (const auto& stripe : memory->extra_stripes) {
+                    add_stripe(stripe);
+                }
+            } else if (auto* disk = std::get_if<DiskDescriptor>(&variant)) {
+                object_size = disk->object_size;
+                string = strings.Add(disk->file_path);
+            } else if (auto* local =
+                           std::get_if<LocalDiskDescriptor>(&variant)) {
+                object_size = local->object_size;
+                string = strings.Add(local->transport_endpoint);
+                client_id = local->client_id;
+            }
+            flat.replica_id.push_back(replica.id);
+            flat.replica_status.push_back(
+                static_cast<uint8_t>(replica.status));
+            flat.replica_kind.push_back(
+                static_cast<uint8_t>(variant.index()));
+            flat.replica_parity_stripes.push_back(parity_stripes);
+            flat.replica_object_size.push_back(object_size);
+            flat.replica_string.push_back(string);
+            flat.replica_client_id_first.push_back(client_id.first);
+            flat.replica_client_id_second.push_back(client_id.second);
+            flat.stripe_end.push_back(
+                static_cast<uint32_t>(flat.stripe_size.size()));
+        }
+        flat.replica_end.push_back(
+            static_cast<uint32_t>(flat.replica_id.size()));
+    }
+    return flat;
+}
+
+std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>
+DecodeReplicaLists(const FlatReplicaLists& flat) {
+    const size_t num_keys = flat.key_error.size();
+    std::vector<tl::expected<GetReplicaListResponse, ErrorCode>> results;
+    if (!IsConsistent(flat)) {
+        LOG(ERROR) << "Inconsistent flat replica lists for " << num_keys
+                   << " keys";
+        results.assign(num_keys,
+                       tl::make_unexpected(ErrorCode::INVALID_PARAMS));
+        return results;
+    }
+    results.reserve(num_keys);
+
+    auto stripe = [&](uint32_t s) {
+        AllocatedBuffer::Descriptor desc;
+        desc.size_ = flat.stripe_size[s];
+        desc.buffer_address_ = flat.stripe_address[s];
+        desc.protocol_ = flat.string(flat.stripe_protocol[s]);
+        desc.transport_endpoint_ = flat.string(flat.stripe_endpoint[s]);
+        return desc;
+    };
+
+    uint32_t replica_begin = 0;
+    for (size_t i = 0; i < num_keys; ++i) {
+        const uint32_t replica_end = flat.replica_end[i];
+        const auto error = static_cast<ErrorCode>(flat.key_error[i]);
+        if (error != ErrorCode::OK) {
+            results.emplace_back(tl::make_unexpected(error));
+            replica_begin = replica_end;
+            continue;
+        }
+
+        GetReplicaListResponse response;
+        response.lease_ttl_ms = flat.key_lease_ttl_ms[i];
+        response.promote = flat.key_promote[i] != 0;
+        if (flat.key_has_checksum[i]) {
+            response.checksum = flat.key_checksum[i];
+        }
+        response.replicas.reserve(replica_end - replica_begin);
+        for (uint32_t r = replica_begin; r < replica_end; ++r) {
+            Replica::Descriptor replica;
+            replica.id = flat.replica_id[r];
+            replica.status = static_cast<ReplicaStatus>(flat.replica_status[r]);
+            const uint32_t stripe_begin = r == 0 ? 0 : flat.stripe_end[r - 1];
+            const uint32_t stripe_end = flat.stripe_end[r];
+            switch (flat.replica_kind[r]) {
+                case 0: {
+                    MemoryDescriptor memory;
+                    if (stripe_begin < stripe_end) {
+                        memory.buffer_descriptor = stripe(stripe_begin);
+                        memory.extra_stripes.reserve(stripe_end - stripe_begin -
+                                                     1);
+                        for (uint32_t s = stripe_begin + 1; s < stripe_end;
+                             ++s) {
+                            memory.extra_stripes.push_back(stripe(s));
+                        }
+                    }
+                    memory.parity_stripes = flat.replica_parity_stripes[r];
+                    replica.descriptor_variant = std::move(memory);
+                    break;
+                }
+                case 1: {
+                    DiskDescriptor disk;
+                    disk.file_path = flat.string(flat.replica_string[r]);
+                    disk.object_size = flat.replica_object_size[r];
+                    replica.descriptor_variant = std::move(disk);
+                    break;
+                }
+                default: {
+                    LocalDiskDescriptor local;
+                    local.client_id = {flat.replica_client_id_first[r],
+                                       flat.replica_client_id_second[r]};
+                    local.object_size = flat.replica_object_size[r];
+                    local.transport_endpoint =
+                        flat.string(flat.replica_string[r]);
+                    replica.descriptor_variant = std::move(local);
+                    break;
+                }
+            }
+            response.replicas.push_back(std::move(replica));
+        }
+        results.emplace_back(std::move(response));
+        replica_begin = replica_end;
+    }
+    return results;
+}
+
+}  // namespace mooncake
@@ -0,0 +1,329 @@
+#include "gds_file_reader.h"
+
+#include <glog/logging.h>
+
+#ifdef USE_NVMEOF
+#include <cuda_runtime.h>
+#include <cufile.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <ctime>
+
+#include "transport/nvmeof_transport/cufile_desc_pool.h"
+#endif
+
+namespace mooncake {
+
+#ifdef USE_NVMEOF
+
+namespace {
+
+// Longest single read, so that a large slice is spread over the batch
+constexpr size_t kMaxPieceSize = 16 * 1024 * 1024;
+// Wait of the completion thread for the oldest batch in flight
+constexpr long kPollTimeoutNs = 100 * 1000;
+
+}  // namespace
+
+struct GdsFileReader::FileRequest {
+    std::string path;
+    std::vector<Slice> slices;
+    size_t length{0};
+    Callback done;
+    int fd{-1};
+    CUfileHandle_t handle{nullptr};
+    // One read per piece of a slice; the cookie is its index
+    std::vector<CUfileIOParams_t> params;
+    size_t next_param{0};
+    // Descriptor of the batch in flight, its size and the reads reaped
+    int desc_idx{-1};
+    size_t batch_size{0};
+    size_t batch_done{0};
+    bool failed{false};
+
+    ~FileRequest() {
+        if (handle != nullptr) {
+            cuFileHandleDeregister(handle);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+std::unique_ptr<GdsFileReader> GdsFileReader::Create(size_t max_batch_size) {
+    CUfileError_t err = cuFileDriverOpen();
+    if (err.err != CU_FILE_SUCCESS) {
+        LOG(WARNING) << "cuFileDriverOpen failed with " << err.err
+                     << ", disk replicas are read through host memory";
+        return nullptr;
+    }
+    return std::unique_ptr<GdsFileReader>(
+        new GdsFileReader(new CUFileDescPool(max_batch_size), max_batch_size));
+}
+
+GdsFileReader::GdsFileReader(CUFileDescPool* desc_pool, size_t max_batch_size)
+    : desc_pool_(desc_pool), max_batch_size_(max_batch_size) {
+    thread_ = std::thread(&GdsFileReader::CompletionThread, this);
+    VLOG(1) << "Created GdsFileReader with batch size " << max_batch_size;
+}
+
+GdsFileReader::~GdsFileReader() {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        shutdown_.store(true);
+    }
+    pending_cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    delete desc_pool_;
+}
+
+bool GdsFileReader::IsDeviceMemory(const std::vector<Slice>& slices) {
+    bool any = false;
+    for (const auto& slice : slices) {
+        if (slice.ptr == nullptr) {
+            continue;
+        }
+        cudaPointerAttributes attributes;
+        if (cudaPointerGetAttributes(&attributes, slice.ptr) != cudaSuccess) {
+            // Clear the error of a pointer CUDA does not know
+            cudaGetLastError();
+            return false;
+        }
+        if (attributes.type != cudaMemoryTypeDevice) {
+            return false;
+        }
+        any = true;
+    }
+    return any;
+}
+
+void GdsFileReader::Read(const std::string& path, std::vector<Slice> slices,
+                         size_t length, Callback done) {
+    auto request = std::make_shared<FileRequest>();
+    request->path = path;
+    request->slices = std::move(slices);
+    request->length = length;
+    request->done = std::move(done);
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (!shutdown_.load()) {
+            pending_.push_back(request);
+            request.reset();
+        }
+    }
+    if (request) {
+        LOG(WARNING) << "Attempting to read " << path
+                     << " from shutdown GdsFileReader";
+        request->done(ErrorCode::TRANSFER_FAIL);
+        return;
+    }
+    pending_cv_.notify_one();
+}
+
+void GdsFileReader::CompletionThread() {
+    VLOG(2) << "GdsFileReader completion thread started";
+
+    while (true) {
+        std::vector<std::shared_ptr<FileRequest>> requests;
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex_);
+            if (active_.empty()) {
+                pending_cv_.wait(lock, [this] {
+                    return !pending_.empty() || shutdown_.load();
+                });
+            }
+            requests.swap(pending_);
+            if (requests.empty() && active_.empty() && shutdown_.load()) {
+                break;
+            }
+        }
+
+        for (auto& request : requests) {
+            if (StartRequest(*request)) {
+                active_.push_back(std::move(request));
+            }
+        }
+
+        for (auto it = active_.begin(); it != active_.end();) {
+            FileRequest& request = **it;
+            bool finished = false;
+            if (request.desc_idx < 0) {
+                finished = !SubmitBatch(request);
+            } else if (PollBatch(request)) {
+                desc_pool_->freeCUfileDesc(request.desc_idx);
+                request.desc_idx = -1;
+                finished = request.failed ||
+                           request.next_param == request.params.size() ||
+                           !SubmitBatch(request);
+            }
+            if (finished) {
+                FinishRequest(request);
+                it = active_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    VLOG(2) << "GdsFileReader completion thread exiting";
+}
+
+bool GdsFileReader::StartRequest(FileRequest& request) {
+    size_t total_size = 0;
+    for (const auto& slice : request.slices) {
+        total_size += slice.size;
+    }
+    if (total_size != request.length) {
+        LOG(ERROR) << "Total read size mismatch for: " << request.path
+                   << ", expected: " << request.length
+                   << ", got: " << total_size;
+        request.done(ErrorCode::FILE_READ_FAIL);
+        return false;
+    }
+
+    request.fd = open(request.path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    if (request.fd < 0) {
+        PLOG(ERROR) << "Failed to open file for GDS reading: " << request.path;
+        request.done(ErrorCode::FILE_OPEN_FAIL);
+        return false;
+    }
+    CUfileDescr_t descr = {};
+    descr.handle.fd = request.fd;
+    descr.type = CU_FILE_HANDLE_TYPE_OPAQUE_FD;
+    CUfileError_t err = cuFileHandleRegister(&request.handle, &descr);
+    if (err.err != CU_FILE_SUCCESS) {
+        LOG(ERROR) << "cuFileHandleRegister failed with " << err.err
+                   << " for: " << request.path;
+        request.handle = nullptr;
+        request.done(ErrorCode::FILE_OPEN_FAIL);
+        return false;
+    }
+
+    off_t offset = 0;
+    for (const auto& slice : request.slices) {
+        if (slice.ptr != nullptr) {
+            for (size_t done = 0; done < slice.size; done += kMaxPieceSize) {
+                CUfileIOParams_t params = {};
+                params.mode = CUFILE_BATCH;
+                params.opcode = CUFILE_READ;
+                params.fh = request.handle;
+                params.u.batch.devPtr_base = slice.ptr;
+                params.u.batch.devPtr_offset = done;
+                params.u.batch.file_offset = offset + done;
+                params.u.batch.size =
+                    std::min(kMaxPieceSize, slice.size - done);
+                params.cookie = reinterpret_cast<void*>(request.params.size());
+                request.params.push_back(params);
+            }
+        }
+        offset += slice.size;
+    }
+
+    if (request.params.empty()) {
+        request.done(ErrorCode::OK);
+        return false;
+    }
+    return true;
+}
+
+bool GdsFileReader::SubmitBatch(FileRequest& request) {
+    const size_t batch_size =
+        std::min(max_batch_size_, request.params.size() - request.next_param);
+    try {
+        int idx = desc_pool_->allocCUfileDesc(batch_size);
+        if (idx < 0) {
+            // All descriptors are in use, retried on the next pass
+            return true;
+        }
+        for (size_t i = 0; i < batch_size; ++i) {
+            desc_pool_->pushParams(idx,
+                                   request.params[request.next_param + i]);
+        }
+        request.desc_idx = idx;
+        request.batch_size = batch_size;
+        request.batch_done = 0;
+        request.next_param += batch_size;
+        desc_pool_->submitBatch(idx);
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Failed to submit GDS reads of " << request.path << ": "
+                   << e.what();
+        if (request.desc_idx >= 0) {
+            desc_pool_->freeCUfileDesc(request.desc_idx);
+            request.desc_idx = -1;
+        }
+        request.failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool GdsFileReader::PollBatch(FileRequest& request) {
+    CUFileBatchDesc* desc = desc_pool_->getDesc(request.desc_idx);
+    unsigned nr = request.batch_size - request.batch_done;
+    // Only the first request waits, the others are checked without blocking
+    const bool wait = active_.front().get() == &request;
+    timespec timeout = {0, wait ? kPollTimeoutNs : 0};
+    CUfileError_t err =
+        cuFileBatchIOGetStatus(desc->batch_handle->handle, wait ? 1 : 0, &nr,
+                               desc->io_events.data(), &timeout);
+    if (err.err != CU_FILE_SUCCESS) {
+        LOG(ERROR) << "cuFileBatchIOGetStatus failed with " << err.err
+                   << " for: " << request.path;
+        // Stop the reads still in flight before the batch is reused
+        cuFileBatchIOCancel(desc->batch_handle->handle);
+        request.failed = true;
+        return true;
+    }
+    unsigned reaped = 0;
+    for (unsigned i = 0; i < nr; ++i) {
+        const CUfileIOEvents_t& event = desc->io_events[i];
+        if (event.status == CUFILE_WAITING ||
+            event.status == CUFILE_PENDING) {
+            continue;
+        }
+        ++reaped;
+        const auto& params =
+            request.params[reinterpret_cast<size_t>(event.cookie)];
+        if (event.status != CUFILE_COMPLETE ||
+            static_cast<size_t>(event.ret) != params.u.batch.size) {
+            LOG(ERROR) << "Failed to read " << params.u.batch.size
+                       << " bytes at offset " << params.u.batch.file_offset
+                       << " of " << request.path << ", status "
+                       << event.status << ", result " << event.ret;
+            request.failed = true;
+        }
+    }
+    request.batch_done += reaped;
+    return request.batch_done == request.batch_size;
+}
+
+void GdsFileReader::FinishRequest(FileRequest& request) {
+    request.done(request.failed ? ErrorCode::FILE_READ_FAIL : ErrorCode::OK);
+}
+
+#else
+
+std::unique_ptr<GdsFileReader> GdsFileReader::Create(size_t) {
+    return nullptr;
+}
+
+GdsFileReader::~GdsFileReader() = default;
+
+bool GdsFileReader::IsDeviceMemory(const std::vector<Slice>&) {
+    return false;
+}
+
+void GdsFileReader::Read(const std::string& path, std::vector<Slice>, size_t,
+                         Callback done) {
+    LOG(ERROR) << "Built without GPUDirect Storage, cannot read " << path;
+    done(ErrorCode::TRANSFER_FAIL);
+}
+
+#endif
+
+}  // namespace mooncake
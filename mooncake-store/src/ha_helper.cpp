@@ -1,10 +1,21 @@
 #include "ha_helper.h"
+
+#include <ylt/coro_rpc/coro_rpc_client.hpp>
+
+#include <algorithm>
+#include <optional>
+
 #include "etcd_helper.h"
+#include "hash_ring.h"
+#include "master_service.h"
 #include "rpc_service.h"
 
 namespace mooncake {
 
-MasterViewHelper::MasterViewHelper() {
+namespace {
+
+// Prefix of the etcd keys of the cluster
+std::string ClusterKeyPrefix() {
     std::string cluster_id;
     const char* cluster_id_env = std::getenv("MC_STORE_CLUSTER_ID");
     if (cluster_id_env != nullptr && strlen(cluster_id_env) > 0) {
@@ -16,7 +27,19 @@ MasterViewHelper::MasterViewHelper() {
     if (!cluster_id.empty() && cluster_id.back() != '/') {
         cluster_id += '/';
     }
-    master_view_key_ = "mooncake-store/" + cluster_id + "master_view";
+    return "mooncake-store/" + cluster_id;
+}
+
+struct EtcdKeyValue {
+    std::string key;
+    std::string value;
+};
+YLT_REFL(EtcdKeyValue, key, value);
+
+}  // namespace
+
+MasterViewHelper::MasterViewHelper() {
+    master_view_key_ = ClusterKeyPrefix() + "master_view";
     LOG(INFO) << "Master view key: " << master_view_key_;
 }
 
@@ -109,6 +132,289 @@ ErrorCode MasterViewHelper::GetMasterView(std::string& master_address,
     }
 }
 
+PartitionRingHelper::PartitionRingHelper() {
+    ring_prefix_ = ClusterKeyPrefix() + "partition_ring/";
+    LOG(INFO) << "Partition ring prefix: " << ring_prefix_;
+}
+
+ErrorCode PartitionRingHelper::ConnectToEtcd(
+    const std::string& etcd_endpoints) {
+    return EtcdHelper::ConnectToEtcdStoreClient(etcd_endpoints);
+}
+
+ErrorCode PartitionRingHelper::Join(const std::string& master_address,
+                                    EtcdLeaseId& lease_id) {
+    auto ret = EtcdHelper::GrantLease(ETCD_MASTER_VIEW_LEASE_TTL, lease_id);
+    if (ret != ErrorCode::OK) {
+        LOG(ERROR) << "Failed to grant lease: " << ret;
+        return ret;
+    }
+    const std::string key = ring_prefix_ + master_address;
+    EtcdRevisionId revision = 0;
+    ret = EtcdHelper::CreateWithLease(key.c_str(), key.size(),
+                                      master_address.c_str(),
+                                      master_address.size(), lease_id,
+                                      revision);
+    if (ret != ErrorCode::OK) {
+        // ETCD_TRANSACTION_FAIL until the lease of an earlier run expires
+        LOG(ERROR) << "Failed to join the partition ring as "
+                   << master_address << ": " << ret;
+        return ret;
+    }
+    LOG(INFO) << "Joined the partition ring as " << master_address
+              << ", revision: " << revision;
+    return ErrorCode::OK;
+}
+
+void PartitionRingHelper::KeepMembership(EtcdLeaseId lease_id) {
+    EtcdHelper::KeepAlive(lease_id);
+}
+
+ErrorCode PartitionRingHelper::GetMembers(std::vector<std::string>& members) {
+    std::string range_end = ring_prefix_;
+    range_end.back()++;
+    std::string json;
+    EtcdRevisionId revision = 0;
+    auto ret = EtcdHelper::GetRangeAsJson(
+        ring_prefix_.c_str(), ring_prefix_.size(), range_end.c_str(),
+        range_end.size(), 0, json, revision);
+    if (ret != ErrorCode::OK) {
+        LOG(ERROR) << "Failed to get the partition ring: " << ret;
+        return ret;
+    }
+    std::vector<EtcdKeyValue> kvs;
+    try {
+        struct_json::from_json(kvs, json);
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Failed to parse the partition ring: " << e.what();
+        return ErrorCode::ETCD_OPERATION_ERROR;
+    }
+    members.clear();
+    for (auto& kv : kvs) {
+        members.push_back(std::move(kv.value));
+    }
+    std::sort(members.begin(), members.end());
+    return ErrorCode::OK;
+}
+
+PartitionMember::PartitionMember(MasterService& master_service,
+                                 const std::string& etcd_endpoints,
+                                 const std::string& local_address)
+    : master_service_(master_service),
+      etcd_endpoints_(etcd_endpoints),
+      local_address_(local_address) {}
+
+PartitionMember::~PartitionMember() { Stop(); }
+
+ErrorCode PartitionMember::Start() {
+    auto ret = ring_helper_.ConnectToEtcd(etcd_endpoints_);
+    if (ret != ErrorCode::OK) {
+        LOG(ERROR) << "Failed to connect to etcd endpoints: "
+                   << etcd_endpoints_;
+        return ret;
+    }
+    running_ = true;
+    membership_thread_ =
+        std::thread(&PartitionMember::MembershipThreadFunc, this);
+    ring_thread_ = std::thread(&PartitionMember::RingThreadFunc, this);
+    return ErrorCode::OK;
+}
+
+void PartitionMember::Stop() {
+    running_ = false;
+    const EtcdLeaseId lease_id = lease_id_.exchange(0);
+    if (lease_id != 0) {
+        EtcdHelper::CancelKeepAlive(lease_id);
+    }
+    if (membership_thread_.joinable()) {
+        membership_thread_.join();
+    }
+    if (ring_thread_.joinable()) {
+        ring_thread_.join();
+    }
+}
+
+void PartitionMember::MembershipThreadFunc() {
+    while (running_) {
+        EtcdLeaseId lease_id = 0;
+        if (ring_helper_.Join(local_address_, lease_id) == ErrorCode::OK) {
+            lease_id_ = lease_id;
+            // Blocks until the lease is lost or Stop() cancels it
+            ring_helper_.KeepMembership(lease_id);
+            lease_id_ = 0;
+            if (running_) {
+                LOG(ERROR) << "Lost the partition ring lease, rejoining";
+            }
+        }
+        if (running_) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(kRetrySleepMs));
+        }
+    }
+}
+
+void PartitionMember::RingThreadFunc() {
+    std::vector<std::string> current_members;
+    // Passes left over the objects this master no longer owns. Clients
+    // refresh the ring every ping, so a pass one poll after a change also
+    // catches the puts of clients that still had the old ring.
+    int unowned_passes = 0;
+    std::optional<HashRing> ring;
+    size_t self_index = 0;
+    while (running_) {
+        std::vector<std::string> members;
+        if (ring_helper_.GetMembers(members) == ErrorCode::OK &&
+            members != current_members) {
+            LOG(INFO) << "Partition ring changed from "
+                      << current_members.size() << " to " << members.size()
+                      << " masters";
+            current_members = members;
+            ring.emplace(std::move(members));
+            const auto& ring_members = ring->members();
+            auto self = std::find(ring_members.begin(), ring_members.end(),
+                                  local_address_);
+            if (self == ring_members.end()) {
+                // Not registered yet, or the lease expired: remove nothing
+                // until registered again
+                ring.reset();
+            } else {
+                self_index = self - ring_members.begin();
+                unowned_passes = 2;
+            }
+        }
+        if (ring && unowned_passes > 0) {
+            long kept = 0;
+            const long removed = master_service_.RemoveUnownedObjects(
+                [&](const std::string& key) {
+                    return ring->OwnerOf(key) == self_index;
+                },
+                kept);
+            LOG_IF(INFO, removed > 0 || kept > 0)
+                << "Removed " << removed
+                << " objects owned by other masters, kept " << kept
+                << " in use";
+            // Kept objects are retried until their leases expire
+            unowned_passes--;
+            if (kept > 0) {
+                unowned_passes = std::max(unowned_passes, 1);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kRingPollMs));
+    }
+}
+
+StandbyReplicator::StandbyReplicator(MasterService& master_service,
+                                     const std::string& etcd_endpoints,
+                                     const std::string& local_address)
+    : master_service_(master_service),
+      etcd_endpoints_(etcd_endpoints),
+      local_address_(local_address) {}
+
+StandbyReplicator::~StandbyReplicator() { Stop(); }
+
+void StandbyReplicator::Start() {
+    running_ = true;
+    replicate_thread_ = std::thread(&StandbyReplicator::ReplicateThreadFunc,
+                                    this);
+}
+
+void StandbyReplicator::Stop() {
+    running_ = false;
+    if (replicate_thread_.joinable()) {
+        replicate_thread_.join();
+    }
+}
+
+void StandbyReplicator::ReplicateThreadFunc() {
+    MasterViewHelper mv_helper;
+    if (mv_helper.ConnectToEtcd(etcd_endpoints_) != ErrorCode::OK) {
+        LOG(ERROR) << "Failed to connect to etcd endpoints: "
+                   << etcd_endpoints_ << ", standby replication disabled";
+        return;
+    }
+    while (running_) {
+        std::string leader_address;
+        ViewVersionId version = 0;
+        if (mv_helper.GetMasterView(leader_address, version) == ErrorCode::OK &&
+            leader_address != local_address_) {
+            ReplicateFrom(leader_address);
+        }
+        if (running_) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(kRetrySleepMs));
+        }
+    }
+}
+
+void StandbyReplicator::ReplicateFrom(const std::string& leader_address) {
+    coro_rpc::coro_rpc_client client;
+    auto conn_result =
+        async_simple::coro::syncAwait(client.connect(leader_address));
+    if (conn_result.val() != 0) {
+        LOG(WARNING) << "Failed to connect to leader " << leader_address
+                     << ": " << conn_result.message();
+        return;
+    }
+
+    // The snapshot holds all metadata and may take a while to transfer
+    auto snapshot_result = async_simple::coro::syncAwait(
+        client.call_for<&WrappedMasterService::GetStandbySnapshot>(
+            std::chrono::seconds(ETCD_MASTER_VIEW_LEASE_TTL * 10)));
+    if (!snapshot_result) {
+        LOG(WARNING) << "Failed to get standby snapshot from leader "
+                     << leader_address << ": " << snapshot_result.error().msg;
+        return;
+    }
+    if (!snapshot_result.value()) {
+        LOG(WARNING) << "Leader " << leader_address
+                     << " refused standby snapshot: "
+                     << snapshot_result.value().error();
+        return;
+    }
+    const auto& snapshot = snapshot_result.value().value();
+    auto load_result = master_service_.LoadStandbySnapshot(snapshot);
+    if (!load_result) {
+        LOG(ERROR) << "Failed to load standby snapshot: "
+                   << load_result.error();
+        return;
+    }
+    uint64_t next_sequence_id = snapshot.sequence_id;
+    LOG(INFO) << "Standby bootstrapped from leader " << leader_address
+              << ", sequence_id=" << next_sequence_id;
+
+    while (running_) {
+        auto fetch_result = async_simple::coro::syncAwait(
+            client.call<&WrappedMasterService::FetchOpLog>(next_sequence_id,
+                                                           kFetchBatchSize));
+        if (!fetch_result) {
+            LOG(WARNING) << "Failed to fetch oplog from leader "
+                         << leader_address << ": "
+                         << fetch_result.error().msg;
+            return;
+        }
+        if (!fetch_result.value()) {
+            // OPLOG_TRUNCATED means this standby fell behind the leader
+            LOG(WARNING) << "Leader " << leader_address
+                         << " refused to fetch oplog from sequence_id="
+                         << next_sequence_id << ": "
+                         << fetch_result.value().error();
+            return;
+        }
+        const auto& response = fetch_result.value().value();
+        if (response.entries.empty()) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(kIdleSleepMs));
+            continue;
+        }
+        auto apply_result = master_service_.ApplyOpLog(response.entries);
+        if (!apply_result) {
+            LOG(ERROR) << "Failed to apply oplog: " << apply_result.error();
+            return;
+        }
+        next_sequence_id = response.entries.back().sequence_id + 1;
+    }
+}
+
 MasterServiceSupervisor::MasterServiceSupervisor(
     const MasterServiceSupervisorConfig& config)
     : config_(config) {}
@@ -131,6 +437,20 @@ int MasterServiceSupervisor::Start() {
                        << config_.etcd_endpoints;
             return -1;
         }
+        // The master service is created before the election, so that it can
+        // replicate the leader as a warm standby in the meantime.
+        mooncake::WrappedMasterService wrapped_master_service(
+            mooncake::WrappedMasterServiceConfig(config_, 0));
+        MasterService& master_service =
+            wrapped_master_service.GetMasterService();
+        std::unique_ptr<StandbyReplicator> replicator;
+        if (config_.oplog_capacity > 0 && master_service.EnterStandby()) {
+            replicator = std::make_unique<StandbyReplicator>(
+                master_service, config_.etcd_endpoints,
+                config_.local_hostname);
+            replicator->Start();
+        }
+
         LOG(INFO) << "Trying to elect self as leader...";
         EtcdLeaseId lease_id = 0;
         // view_version will be updated by ElectLeader and then used in
@@ -152,8 +472,18 @@ int MasterServiceSupervisor::Start() {
         std::this_thread::sleep_for(std::chrono::seconds(waiting_time));
 
         LOG(INFO) << "Starting master service...";
-        mooncake::WrappedMasterService wrapped_master_service(
-            mooncake::WrappedMasterServiceConfig(config_, view_version));
+        if (replicator) {
+            // The old leader has retired, nothing is left to replicate.
+            replicator->Stop();
+            replicator.reset();
+            auto promote_result = master_service.Promote(view_version);
+            if (!promote_result) {
+                LOG(ERROR) << "Failed to promote standby master: "
+                           << promote_result.error();
+            }
+        } else {
+            master_service.SetViewVersion(view_version);
+        }
         mooncake::RegisterRpcService(server, wrapped_master_service);
         // Metric reporting is now handled by WrappedMasterService.
 
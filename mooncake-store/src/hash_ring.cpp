@@ -0,0 +1,91 @@
+#include "hash_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mooncake {
+
+namespace {
+
+constexpr uint64_t kMul = 0x9e3779b97f4a7c15ULL;
+
+// Finalizer of MurmurHash3
+uint64_t Mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}  // namespace
+
+uint64_t HashRing::Hash(std::string_view data) {
+    uint64_t h = Mix(data.size() * kMul);
+    const char* p = data.data();
+    size_t len = data.size();
+    while (len >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        h = (h ^ Mix(word)) * kMul;
+        p += 8;
+        len -= 8;
+    }
+    if (len > 0) {
+        uint64_t word = 0;
+        std::memcpy(&word, p, len);
+        h = (h ^ Mix(word)) * kMul;
+    }
+    return Mix(h);
+}
+
+HashRing::HashRing(std::vector<std::string> members, size_t virtual_nodes)
+    : members_(std::move(members)) {
+    std::sort(members_.begin(), members_.end());
+    members_.erase(std::unique(members_.begin(), members_.end()),
+                   members_.end());
+    points_.reserve(members_.size() * virtual_nodes);
+    for (size_t i = 0; i < members_.size(); ++i) {
+        for (size_t v = 0; v < virtual_nodes; ++v) {
+            points_.emplace_back(Hash(members_[i] + "#" + std::to_string(v)),
+                                 static_cast<uint32_t>(i));
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+size_t HashRing::OwnerOf(std::string_view key) const {
+    const uint64_t h = Hash(key);
+    auto it = std::lower_bound(
+        points_.begin(), points_.end(), h,
+        [](const auto& point, uint64_t value) { return point.first < value; });
+    if (it == points_.end()) {
+        it = points_.begin();
+    }
+    return it->second;
+}
+
+std::vector<Segment> SliceSegment(const Segment& segment, size_t max_slices,
+                                  size_t alignment) {
+    const size_t units = segment.size / alignment;
+    const size_t num_slices = std::clamp<size_t>(units, 1, max_slices);
+    const size_t slice_size = units / num_slices * alignment;
+
+    std::vector<Segment> slices(num_slices, segment);
+    for (size_t i = 0; i < num_slices; ++i) {
+        slices[i].id = {segment.id.first ^ Mix(i + 1),
+                        segment.id.second + i + 1};
+        slices[i].base = segment.base + i * slice_size;
+        slices[i].size =
+            i + 1 < num_slices ? slice_size : segment.size - i * slice_size;
+    }
+    return slices;
+}
+
+std::string SegmentSliceKey(const Segment& segment, size_t index) {
+    return std::to_string(segment.id.first) + "-" +
+           std::to_string(segment.id.second) + "#" + std::to_string(index);
+}
+
+}  // namespace mooncake
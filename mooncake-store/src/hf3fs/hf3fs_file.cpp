@@ -5,6 +5,8 @@
 #include <unistd.h>
 #include <sys/file.h>
 
+#include <algorithm>
+
 namespace mooncake {
 
 ThreeFSFile::ThreeFSFile(const std::string& filename, int fd,
@@ -343,4 +345,114 @@ tl::expected<size_t, ErrorCode> ThreeFSFile::vector_read(const iovec* iov,
     return total_bytes_read;
 }
 
+void ThreeFSFile::batch_io(USRBIOResourceManager* resource_manager,
+                           std::vector<Hf3fsBatchEntry>& entries, bool read) {
+    const ErrorCode fail_code =
+        read ? ErrorCode::FILE_READ_FAIL : ErrorCode::FILE_WRITE_FAIL;
+    auto* resource = resource_manager->getThreadResource();
+    if (!resource || !resource->initialized) {
+        for (auto& entry : entries) {
+            entry.result = ErrorCode::FILE_OPEN_FAIL;
+        }
+        return;
+    }
+
+    auto& threefs_iov = resource->iov_;
+    auto& ior = read ? resource->ior_read_ : resource->ior_write_;
+    const size_t iov_size = resource->config_.iov_size;
+    const size_t max_ios = std::max<size_t>(resource->config_.ior_entries, 1);
+    char* iov_base = reinterpret_cast<char*>(threefs_iov.base);
+
+    auto fail = [&](Hf3fsBatchEntry& entry) {
+        entry.result = fail_code;
+        // Lets the destructor delete a partially written file
+        entry.file->error_code_ = fail_code;
+    };
+
+    // Pieces of the next submission, each with its own range of the iov
+    struct Piece {
+        size_t entry;
+        size_t offset;
+        size_t length;
+        size_t iov_offset;
+    };
+    std::vector<Piece> pieces;
+    pieces.reserve(max_ios);
+    std::vector<hf3fs_cqe> cqes(max_ios);
+    size_t iov_used = 0;
+
+    auto submit = [&]() {
+        int prepared = 0;
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            const auto& piece = pieces[i];
+            auto& entry = entries[piece.entry];
+            char* ptr = iov_base + piece.iov_offset;
+            if (!read) {
+                memcpy(ptr, entry.buffer + piece.offset, piece.length);
+            }
+            int ret = hf3fs_prep_io(&ior, &threefs_iov, read, ptr,
+                                    entry.file->fd_, piece.offset, piece.length,
+                                    reinterpret_cast<const void*>(i));
+            if (ret < 0) {
+                fail(entry);
+                continue;
+            }
+            ++prepared;
+        }
+
+        if (prepared > 0 && hf3fs_submit_ios(&ior) < 0) {
+            // Nothing was issued, the prepared ios are dropped with the ring
+            for (const auto& piece : pieces) {
+                fail(entries[piece.entry]);
+            }
+            prepared = 0;
+        }
+
+        while (prepared > 0) {
+            int ret = hf3fs_wait_for_ios(&ior, cqes.data(), prepared, 1,
+                                         nullptr);
+            if (ret < 0) {
+                for (const auto& piece : pieces) {
+                    fail(entries[piece.entry]);
+                }
+                break;
+            }
+            for (int i = 0; i < ret; ++i) {
+                const auto& piece =
+                    pieces[reinterpret_cast<size_t>(cqes[i].userdata)];
+                auto& entry = entries[piece.entry];
+                if (cqes[i].result < 0 ||
+                    static_cast<size_t>(cqes[i].result) != piece.length) {
+                    fail(entry);
+                } else if (read) {
+                    memcpy(entry.buffer + piece.offset,
+                           iov_base + piece.iov_offset, piece.length);
+                }
+            }
+            prepared -= ret;
+        }
+
+        pieces.clear();
+        iov_used = 0;
+    };
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto& entry = entries[i];
+        entry.result = ErrorCode::OK;
+        size_t offset = 0;
+        while (offset < entry.length) {
+            const size_t length = std::min(entry.length - offset, iov_size);
+            if (pieces.size() == max_ios || iov_used + length > iov_size) {
+                submit();
+            }
+            pieces.push_back({i, offset, length, iov_used});
+            iov_used += length;
+            offset += length;
+        }
+    }
+    if (!pieces.empty()) {
+        submit();
+    }
+}
+
 }  // namespace mooncake
\ No newline at end of file
@@ -1,20 +1,31 @@
 #include "local_hot_cache.h"
 
 #include <algorithm>
+#include <bit>
 #include <cstring>
 #include <cstdlib>
 #include <shared_mutex>
 #include <cstdint>
 #include <glog/logging.h>
 
+#include "cuda_staging.h"
+
 namespace mooncake {
 namespace {
 constexpr size_t DEFAULT_BLOCK_SIZE = 16 * 1024 * 1024;  // 16MB default block
-}
-
-LocalHotCache::LocalHotCache(size_t total_size_bytes, size_t block_size_bytes)
+// Blocks per shard when the shard number is not given, and the most shards
+constexpr size_t kBlocksPerShard = 16;
+constexpr size_t kMaxShards = 32;
+// Allocator nodes reserved up front, it grows on demand
+constexpr uint32_t kAllocatorInitCapacity = 1024;
+}  // namespace
+
+LocalHotCache::LocalHotCache(size_t total_size_bytes, size_t block_size_bytes,
+                             size_t shard_num, int device)
     : block_size_((block_size_bytes > 0) ? block_size_bytes
                                          : DEFAULT_BLOCK_SIZE),
+      capacity_(0),
+      device_(device),
       bulk_memory_standard_(nullptr) {
     // calculate the block number
     size_t block_num = 0;
@@ -22,96 +33,97 @@ LocalHotCache::LocalHotCache(size_t total_size_bytes, size_t block_size_bytes)
         block_num = total_size_bytes / block_size_;
     }
 
-    blocks_.reserve(block_num);
-
-    // Try to allocate all blocks in one bulk allocation first
-    size_t total_size = block_num * block_size_;
-    if (block_num > 0 && total_size > 0) {
-        bulk_memory_standard_ = std::malloc(total_size);
-        if (bulk_memory_standard_) {
-            // Bulk allocation succeeded: split into individual blocks
-            char* base_ptr = static_cast<char*>(bulk_memory_standard_);
-            for (size_t i = 0; i < block_num; ++i) {
-                auto block = std::make_unique<HotMemBlock>();
-                block->addr = base_ptr + i * block_size_;
-                block->size = block_size_;
-                block->ref_count = 0;
-                block->key_.clear();  // Initialize key as empty
-                lru_queue_.push_back(block.get());
-                blocks_.emplace_back(std::move(block));
-            }
-        } else {
-            // Bulk allocation failed: fall back to individual allocations
-            for (size_t i = 0; i < block_num; ++i) {
-                void* ptr = std::malloc(block_size_);
-                if (ptr) {
-                    auto block = std::make_unique<HotMemBlock>();
-                    block->addr = ptr;
-                    block->size = block_size_;
-                    block->ref_count = 0;
-                    block->key_.clear();  // Initialize key as empty
-                    lru_queue_.push_back(block.get());
-                    blocks_.emplace_back(std::move(block));
-                }
-            }
-        }
+    if (shard_num == 0) {
+        shard_num = std::clamp<size_t>(block_num / kBlocksPerShard, 1,
+                                       kMaxShards);
+    }
+    shards_.reserve(shard_num);
+    for (size_t i = 0; i < shard_num; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
     }
+
+    const size_t total_size = block_num * block_size_;
+    if (total_size == 0) {
+        return;
+    }
+    bulk_memory_standard_ =
+        device_ >= 0 ? CudaStaging::AllocateDeviceMemory(device_, total_size)
+                     : std::malloc(total_size);
+    if (!bulk_memory_standard_) {
+        LOG(ERROR) << "Failed to allocate " << total_size
+                   << " bytes for the local hot cache"
+                   << (device_ >= 0 ? " on device " + std::to_string(device_)
+                                    : std::string());
+        return;
+    }
+    capacity_ = total_size;
+    allocator_ = offset_allocator::OffsetAllocator::create(
+        reinterpret_cast<uint64_t>(bulk_memory_standard_), total_size,
+        kAllocatorInitCapacity);
 }
 
 LocalHotCache::~LocalHotCache() {
-    // Free bulk allocated memory if it exists
-    if (bulk_memory_standard_) {
-        std::free(bulk_memory_standard_);
-    } else {
-        // Free individually allocated blocks
-        for (auto& block : blocks_) {
-            if (block && block->addr) {
-                std::free(block->addr);
-            }
+    for (auto& shard : shards_) {
+        for (HotMemBlock* block : shard->clock) {
+            delete block;
         }
     }
+    allocator_.reset();
+    if (bulk_memory_standard_ && device_ >= 0) {
+        CudaStaging::FreeDeviceMemory(bulk_memory_standard_);
+    } else if (bulk_memory_standard_) {
+        std::free(bulk_memory_standard_);
+    }
 }
 
-bool LocalHotCache::PutHotKey(HotMemBlock* block) {
-    std::unique_lock<std::shared_mutex> lk(lru_mutex_);
+size_t LocalHotCache::shardIndex(const std::string& key) const {
+    return std::hash<std::string>{}(key) % shards_.size();
+}
 
+bool LocalHotCache::PutHotKey(HotMemBlock* block) {
     if (!block) return false;
 
-    // Handle return-to-lru tail case (empty key or cancelled task)
+    // Handle return-to-pool case (empty key or cancelled task)
     if (block->key_.empty()) {
-        block->ref_count = 0;
-        lru_queue_.push_back(block);  // Add to tail as free block
+        delete block;
         return false;
     }
 
     const std::string& key = block->key_;
+    const size_t index = shardIndex(key);
+    Shard& shard = *shards_[index];
+    std::unique_lock<std::shared_mutex> lk(shard.mutex);
+    block->shard = index;
+    block->ref_count = 0;
 
     // Race condition check: did someone else insert this key while we were
     // copying
-    if (key_to_lru_it_.find(key) != key_to_lru_it_.end()) {
-        // Lost race -> Return to lru tail as free block
-        block->key_.clear();
-        block->ref_count = 0;
-        lru_queue_.push_back(block);
+    if (shard.index.find(key) != shard.index.end()) {
+        // Lost race -> Free the block
+        lk.unlock();
+        delete block;
         return false;
     }
 
-    // Publish the new mapping
-    block->ref_count = 0;
-    lru_queue_.push_front(block);
-    key_to_lru_it_[key] = lru_queue_.begin();
+    // Publish the new mapping just behind the hand, so that it is the last
+    // one the hand visits
+    block->referenced = false;
+    shard.index[key] = shard.clock.insert(shard.hand, block);
+    cached_bytes_.fetch_add(block->size, std::memory_order_relaxed);
     return true;
 }
 
 bool LocalHotCache::HasHotKey(const std::string& key) const {
-    std::shared_lock<std::shared_mutex> lk(lru_mutex_);
-    return key_to_lru_it_.find(key) != key_to_lru_it_.end();
+    const Shard& shard = *shards_[shardIndex(key)];
+    std::shared_lock<std::shared_mutex> lk(shard.mutex);
+    return shard.index.find(key) != shard.index.end();
 }
 
 HotMemBlock* LocalHotCache::GetHotKey(const std::string& key) {
-    std::unique_lock<std::shared_mutex> lk(lru_mutex_);
-    auto it = key_to_lru_it_.find(key);
-    if (it == key_to_lru_it_.end()) {
+    Shard& shard = *shards_[shardIndex(key)];
+    std::shared_lock<std::shared_mutex> lk(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
         return nullptr;
     }
     HotMemBlock* blk = *(it->second);
@@ -120,19 +132,19 @@ HotMemBlock* LocalHotCache::GetHotKey(const std::string& key) {
         return nullptr;
     }
 
-    // Mark block as in use to prevent it from being reused during memcpy
+    // Mark block as in use to prevent it from being reused during memcpy.
+    // Eviction holds the lock exclusively, so it cannot race with this.
     blk->ref_count++;
-
-    // update lru queue
-    touchLRU(it);
+    blk->referenced.store(true, std::memory_order_relaxed);
 
     return blk;
 }
 
 void LocalHotCache::ReleaseHotKey(const std::string& key) {
-    std::unique_lock<std::shared_mutex> lk(lru_mutex_);
-    auto it = key_to_lru_it_.find(key);
-    if (it == key_to_lru_it_.end()) {
+    Shard& shard = *shards_[shardIndex(key)];
+    std::shared_lock<std::shared_mutex> lk(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
         return;
     }
     HotMemBlock* block = *(it->second);
@@ -142,70 +154,171 @@ void LocalHotCache::ReleaseHotKey(const std::string& key) {
 }
 
 bool LocalHotCache::TouchHotKey(const std::string& key) {
-    std::unique_lock<std::shared_mutex> lk(lru_mutex_);
-    auto it = key_to_lru_it_.find(key);
-    if (it == key_to_lru_it_.end()) {
+    Shard& shard = *shards_[shardIndex(key)];
+    std::shared_lock<std::shared_mutex> lk(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
         return false;
     }
-    touchLRU(it);
+    (*it->second)->referenced.store(true, std::memory_order_relaxed);
     return true;
 }
 
 HotMemBlock* LocalHotCache::GetFreeBlock() {
-    std::unique_lock<std::shared_mutex> lk(lru_mutex_);
+    return takeBlock(next_shard_.fetch_add(1, std::memory_order_relaxed) %
+                         shards_.size(),
+                     block_size_, nullptr);
+}
+
+HotMemBlock* LocalHotCache::GetFreeBlock(
+    const std::string& key, size_t size,
+    const std::function<bool(const std::string&)>& admit) {
+    return takeBlock(shardIndex(key), size, admit);
+}
 
-    if (lru_queue_.empty()) {
+HotMemBlock* LocalHotCache::takeBlock(
+    size_t start, size_t size,
+    const std::function<bool(const std::string&)>& admit) {
+    if (!allocator_ || size == 0 || size > capacity_) {
         return nullptr;
     }
+    const size_t shard_num = shards_.size();
 
-    // Find the first block from the tail that is not in use
-    auto victim_it = lru_queue_.end();
-    for (auto it = lru_queue_.rbegin(); it != lru_queue_.rend(); ++it) {
-        if ((*it)->ref_count == 0) {
-            // Convert reverse iterator to forward iterator
-            victim_it = std::next(it).base();
+    // Evict the shards in turn until the block fits. A shard is only left
+    // once it has nothing more to evict.
+    size_t index = start;
+    size_t exhausted = 0;
+    while (true) {
+        auto allocation = allocator_->allocate(size);
+        if (allocation) {
+            // Now this block is exclusively owned by the caller.
+            auto* block = new HotMemBlock();
+            block->addr = allocation->ptr();
+            block->size = size;
+            block->allocation = std::move(allocation);
+            return block;
+        }
+        if (exhausted == shard_num) {
             break;
         }
-    }
 
-    // If all blocks are in use, cannot reuse any block
-    if (victim_it == lru_queue_.end()) {
-        return nullptr;
+        HotMemBlock* victim = nullptr;
+        bool rejected = false;
+        {
+            Shard& shard = *shards_[index];
+            std::unique_lock<std::shared_mutex> lk(shard.mutex);
+            victim = evict(shard, admit, &rejected);
+        }
+        if (rejected) {
+            return nullptr;
+        }
+        if (victim) {
+            // Freeing the victim returns its space to the arena
+            delete victim;
+            exhausted = 0;
+        } else {
+            ++exhausted;
+            index = (index + 1) % shard_num;
+        }
     }
 
-    HotMemBlock* victim = *victim_it;
-
-    // Remove from LRU list completely (detach)
-    lru_queue_.erase(victim_it);
+    // The rest of the arena is in use, cannot fit the block
+    return nullptr;
+}
 
-    // If victim was bound to an old key, remove the old mapping
-    if (!victim->key_.empty()) {
-        auto it_map = key_to_lru_it_.find(victim->key_);
-        if (it_map != key_to_lru_it_.end()) {
-            key_to_lru_it_.erase(it_map);
+HotMemBlock* LocalHotCache::evict(
+    Shard& shard, const std::function<bool(const std::string&)>& admit,
+    bool* rejected) {
+    // Two rounds clear every reference bit, so only pinned blocks survive
+    const size_t steps = 2 * shard.clock.size();
+    for (size_t step = 0; step < steps; ++step) {
+        if (shard.hand == shard.clock.end()) {
+            shard.hand = shard.clock.begin();
+        }
+        HotMemBlock* block = *shard.hand;
+        if (block->ref_count > 0 ||
+            block->referenced.exchange(false, std::memory_order_relaxed)) {
+            ++shard.hand;
+            continue;
         }
-        victim->key_.clear();
+        if (admit && !admit(block->key_)) {
+            *rejected = true;
+            return nullptr;
+        }
+        shard.index.erase(block->key_);
+        block->key_.clear();
+        shard.hand = shard.clock.erase(shard.hand);
+        cached_bytes_.fetch_sub(block->size, std::memory_order_relaxed);
+        return block;
     }
+    return nullptr;
+}
 
-    // Now this block is exclusively owned by the caller.
-    // It is detached from the cache structure.
-    victim->ref_count = 0;
+size_t LocalHotCache::GetCacheSize() const {
+    return capacity_ / block_size_;
+}
 
-    return victim;
+size_t LocalHotCache::GetReservedBytes() const {
+    if (!allocator_) {
+        return 0;
+    }
+    return allocator_->get_metrics().allocated_size_;
 }
 
-void LocalHotCache::touchLRU(
-    std::unordered_map<std::string, std::list<HotMemBlock*>::iterator>::iterator
-        it) {
-    HotMemBlock* blk = *(it->second);
-    lru_queue_.erase(it->second);
-    lru_queue_.push_front(blk);
-    it->second = lru_queue_.begin();
+size_t LocalHotCache::GetCachedCount() const {
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lk(shard->mutex);
+        count += shard->index.size();
+    }
+    return count;
 }
 
-size_t LocalHotCache::GetCacheSize() const {
-    std::shared_lock<std::shared_mutex> lk(lru_mutex_);
-    return lru_queue_.size();
+FrequencySketch::FrequencySketch(size_t capacity)
+    : counters_(kDepth *
+                std::bit_ceil(std::max<size_t>(capacity * 4, 256))),
+      width_mask_(counters_.size() / kDepth - 1),
+      sample_size_(10 * std::max<size_t>(capacity, 32)) {}
+
+size_t FrequencySketch::counterIndex(uint64_t hash, size_t row) const {
+    // Independent hash per row from one std::hash (splitmix64 finalizer)
+    uint64_t x = hash + (row + 1) * 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return row * (width_mask_ + 1) + (x & width_mask_);
+}
+
+void FrequencySketch::Increment(const std::string& key) {
+    const uint64_t hash = std::hash<std::string>{}(key);
+    for (size_t row = 0; row < kDepth; ++row) {
+        auto& counter = counters_[counterIndex(hash, row)];
+        uint8_t count = counter.load(std::memory_order_relaxed);
+        if (count < kMaxCount) {
+            counter.compare_exchange_weak(count, count + 1,
+                                          std::memory_order_relaxed);
+        }
+    }
+    if (additions_.fetch_add(1, std::memory_order_relaxed) + 1 ==
+        sample_size_) {
+        // Age the counts; concurrent increments may be lost or kept
+        for (auto& counter : counters_) {
+            counter.store(counter.load(std::memory_order_relaxed) / 2,
+                          std::memory_order_relaxed);
+        }
+        additions_.fetch_sub(sample_size_ / 2, std::memory_order_relaxed);
+    }
+}
+
+uint32_t FrequencySketch::Estimate(const std::string& key) const {
+    const uint64_t hash = std::hash<std::string>{}(key);
+    uint32_t estimate = kMaxCount;
+    for (size_t row = 0; row < kDepth; ++row) {
+        estimate = std::min<uint32_t>(
+            estimate, counters_[counterIndex(hash, row)].load(
+                          std::memory_order_relaxed));
+    }
+    return estimate;
 }
 
 constexpr size_t kDefaultHotCacheWorkers = 2;
@@ -214,6 +327,7 @@ LocalHotCacheHandler::LocalHotCacheHandler(
     std::shared_ptr<LocalHotCache> hot_cache, size_t num_worker_threads,
     size_t max_queue_capacity)
     : hot_cache_(hot_cache),
+      admission_sketch_(hot_cache ? hot_cache->GetCacheSize() : 1),
       max_queue_capacity_(max_queue_capacity),
       shutdown_(false) {
     size_t workers =
@@ -252,7 +366,9 @@ bool LocalHotCacheHandler::SubmitPutTask(const std::string& key,
         return false;
     }
 
-    // Optimization: if key exists, just touch LRU to avoid data copy
+    admission_sketch_.Increment(key);
+
+    // Optimization: if key exists, just touch it to avoid data copy
     if (hot_cache_->TouchHotKey(key)) {
         return true;
     }
@@ -268,19 +384,24 @@ bool LocalHotCacheHandler::SubmitPutTask(const std::string& key,
         }
     }
 
-    // Try to get a free block (may evict from LRU tail)
-    HotMemBlock* block = hot_cache_->GetFreeBlock();
+    // Try to get a block sized to the slice (may evict with CLOCK). A full
+    // cache only evicts for a key that is more frequent than the victims, so
+    // that a scan does not flush the hot blocks.
+    bool admitted = true;
+    HotMemBlock* block = hot_cache_->GetFreeBlock(
+        key, slice.size,
+        [this, &key, &admitted](const std::string& victim) {
+            admitted = admission_sketch_.Estimate(key) >
+                       admission_sketch_.Estimate(victim);
+            return admitted;
+        });
     if (!block) {
-        LOG(ERROR) << "Hot cache is fully in-use, fail to get a free block: "
-                   << key;
-        return false;
-    }
-
-    // Check size compatibility
-    if (slice.size > block->size) {
-        // Slice too big for block, return block to pool
-        block->key_.clear();
-        hot_cache_->PutHotKey(block);
+        if (!admitted) {
+            VLOG(2) << "Hot cache admission rejected key: " << key;
+            return true;
+        }
+        LOG(ERROR) << "Hot cache is fully in-use, fail to get a block of "
+                   << slice.size << " bytes: " << key;
         return false;
     }
 
@@ -307,6 +428,10 @@ bool LocalHotCacheHandler::SubmitPutTask(const std::string& key,
     return true;
 }
 
+void LocalHotCacheHandler::RecordHit(const std::string& key) {
+    admission_sketch_.Increment(key);
+}
+
 void LocalHotCacheHandler::workerThread() {
     VLOG(2) << "LocalHotCacheHandler worker thread started";
 
@@ -333,7 +458,7 @@ void LocalHotCacheHandler::workerThread() {
         // Execute the task if we have one
         if (task.hot_cache && task.block) {
             try {
-                // Insert the pre-filled block into LRU
+                // Insert the pre-filled block into the cache
                 if (task.hot_cache->PutHotKey(task.block)) {
                     VLOG(2) << "Put task completed: " << task.key;
                 } else {
@@ -1,8 +1,12 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <pthread.h>
+#include <sched.h>
 
+#include <atomic>
 #include <chrono>  // For std::chrono
 #include <csignal>
+#include <cstring>
 #include <memory>  // For std::unique_ptr
 #include <thread>  // For std::thread
 #include <ylt/coro_rpc/coro_rpc_server.hpp>
@@ -40,6 +44,42 @@ DEFINE_double(eviction_ratio, mooncake::DEFAULT_EVICTION_RATIO,
 DEFINE_double(eviction_high_watermark_ratio,
               mooncake::DEFAULT_EVICTION_HIGH_WATERMARK_RATIO,
               "Ratio of high watermark trigger eviction");
+DEFINE_uint32(eviction_sample_size, mooncake::DEFAULT_EVICTION_SAMPLE_SIZE,
+              "Number of objects sampled per shard in incremental eviction "
+              "(0 = use full-scan eviction)");
+DEFINE_uint32(eviction_shards_per_tick,
+              mooncake::DEFAULT_EVICTION_SHARDS_PER_TICK,
+              "Number of metadata shards visited per incremental eviction "
+              "tick");
+DEFINE_bool(enable_cost_aware_eviction, false,
+            "Evict by GreedyDual-Size-Frequency priority, i.e. the objects "
+            "with the least recompute cost per byte and access, instead of "
+            "by lease timeout");
+DEFINE_string(tenant_quotas, "",
+              "Memory quotas of the tenants, e.g. \"llama=64GB,qwen=32GB\". "
+              "A key belongs to the tenant named by its prefix up to the "
+              "first '/', and the objects of tenants over their quota are "
+              "evicted first");
+DEFINE_uint64(put_lease_ttl_ms, 0,
+              "Milliseconds for which clients may hold buffers granted for "
+              "puts they have not started yet, so that small puts need no "
+              "PutStart. 0 grants no put leases");
+DEFINE_bool(enable_segment_pressure_eviction, false,
+            "Evict from each segment above the high watermark, or from the "
+            "fullest ones when an allocation fails, instead of by the "
+            "global usage ratio");
+DEFINE_uint32(rebalance_bandwidth_mb, 0,
+              "MB per second of objects moved from the most loaded segments "
+              "to newly mounted ones, hottest first, 0 to disable");
+DEFINE_uint32(tiering_demote_access_count,
+              mooncake::DEFAULT_TIERING_DEMOTE_ACCESS_COUNT,
+              "Accesses after which an eviction victim is demoted to the local "
+              "disk of its owner instead of dropped, requires enable_offload "
+              "(0 = offload every put)");
+DEFINE_uint32(tiering_promote_disk_reads,
+              mooncake::DEFAULT_TIERING_PROMOTE_DISK_READS,
+              "Disk reads after which an object without memory replica is "
+              "copied back to memory by its reader (0 = never promote)");
 // RPC server configuration parameters (new, preferred)
 // TODO: deprecate port and max_threads in the future
 DEFINE_int32(rpc_thread_num, 0,
@@ -63,6 +103,13 @@ DEFINE_validator(eviction_ratio, [](const char* flagname, double value) {
 });
 DEFINE_bool(enable_ha, false,
             "Enable high availability, which depends on etcd");
+DEFINE_bool(enable_partition, false,
+            "Run as one of several active masters that each own the keys "
+            "hashed to them, with the ring kept in etcd");
+DEFINE_uint32(partition_workers, 1,
+              "With enable_partition, number of partition masters run by "
+              "this process on consecutive ports from rpc_port, each with one "
+              "RPC thread pinned to its own core");
 DEFINE_bool(enable_offload, false, "Enable offload availability");
 DEFINE_string(
     etcd_endpoints, "",
@@ -76,15 +123,68 @@ DEFINE_string(root_fs_dir, mooncake::DEFAULT_ROOT_FS_DIR,
 DEFINE_int64(global_file_segment_size,
              mooncake::DEFAULT_GLOBAL_FILE_SEGMENT_SIZE,
              "Size of global NFS/3FS segment in bytes");
+DEFINE_string(snapshot_path, mooncake::DEFAULT_SNAPSHOT_PATH,
+              "File for metadata snapshots of the master. If set, the master "
+              "restores from it on startup and rewrites it periodically. "
+              "Empty string disables snapshots");
+DEFINE_uint64(snapshot_interval_sec, mooncake::DEFAULT_SNAPSHOT_INTERVAL_SEC,
+              "Interval in seconds between two metadata snapshots, 0 means "
+              "only restore on startup");
+DEFINE_uint64(oplog_capacity, mooncake::DEFAULT_OPLOG_CAPACITY,
+              "Number of operation log entries the leader keeps for warm "
+              "standby masters in HA mode, 0 disables standby replication");
+DEFINE_bool(enable_prefix_index, false,
+            "Keep the keys of every metadata shard sorted, so that regex "
+            "queries anchored by a literal prefix only visit the matching "
+            "keys");
+DEFINE_uint64(allocator_cache_max_size, 0,
+              "Allocations of at most this many bytes are served from "
+              "per-thread caches of the offset allocator of each segment, 0 "
+              "disables the caches");
+DEFINE_uint64(defrag_interval_sec, 0,
+              "Seconds between background defragmentation rounds that move "
+              "small objects out of fragmented memory segments, 0 disables "
+              "defragmentation");
+DEFINE_double(defrag_threshold, 0.5,
+              "Memory segments whose largest free region is less than this "
+              "fraction of their free space are defragmented");
+DEFINE_uint32(defrag_max_moves, 16,
+              "Maximum number of objects moved by one defragmentation round");
+DEFINE_uint64(defrag_max_request_rate, 0,
+              "Defragmentation rounds are skipped while the master serves more "
+              "than this many put and get requests per second, 0 disables the "
+              "check");
+DEFINE_uint64(slab_size, mooncake::DEFAULT_SLAB_SIZE,
+              "Size in bytes of the slabs carved into fixed size slots by the "
+              "slab memory allocator");
+DEFINE_uint32(slab_class_min_count, mooncake::DEFAULT_SLAB_CLASS_MIN_COUNT,
+              "Number of allocations of the same size after which the slab "
+              "memory allocator serves that size from slabs");
+DEFINE_uint32(cxl_promote_access_count, 0,
+              "With enable_cxl, objects on CXL memory read this many times "
+              "recently are copied to a DRAM segment, 0 disables promotion");
+DEFINE_uint32(hot_replica_read_rate, 0,
+              "Objects read this many times within a second get extra memory "
+              "replicas on other segments, 0 disables hot replication");
+DEFINE_uint32(hot_replica_max_replicas, 3,
+              "Number of memory replicas hot replication grows an object to");
+DEFINE_uint64(hot_replica_cooldown_sec, 60,
+              "Seconds after its last hot second at which an object drops the "
+              "replicas hot replication added");
+DEFINE_bool(enable_dedup, false,
+            "Let puts that carry a content hash share the replicas of an "
+            "object with the same content");
 DEFINE_string(cluster_id, mooncake::DEFAULT_CLUSTER_ID,
               "Cluster ID for the master service, used for kvcache persistence "
               "in HA mode");
 
 DEFINE_string(memory_allocator, "offset",
-              "Memory allocator for global segments, cachelib | offset");
+              "Memory allocator for global segments, cachelib | offset | "
+              "slab");
 DEFINE_string(
     allocation_strategy, "random",
-    "Allocation strategy for segments, random | free_ratio_first | cxl");
+    "Allocation strategy for segments, random | free_ratio_first | cxl | "
+    "load_aware");
 DEFINE_bool(enable_http_metadata_server, false,
             "Enable HTTP metadata server instead of etcd");
 DEFINE_int32(http_metadata_server_port, 8080,
@@ -163,6 +263,32 @@ void InitMasterConf(const mooncake::DefaultConfig& default_config,
     default_config.GetDouble("eviction_high_watermark_ratio",
                              &master_config.eviction_high_watermark_ratio,
                              FLAGS_eviction_high_watermark_ratio);
+    default_config.GetUInt32("eviction_sample_size",
+                             &master_config.eviction_sample_size,
+                             FLAGS_eviction_sample_size);
+    default_config.GetUInt32("eviction_shards_per_tick",
+                             &master_config.eviction_shards_per_tick,
+                             FLAGS_eviction_shards_per_tick);
+    default_config.GetBool("enable_cost_aware_eviction",
+                           &master_config.enable_cost_aware_eviction,
+                           FLAGS_enable_cost_aware_eviction);
+    default_config.GetString("tenant_quotas", &master_config.tenant_quotas,
+                             FLAGS_tenant_quotas);
+    default_config.GetUInt64("put_lease_ttl_ms",
+                             &master_config.put_lease_ttl_ms,
+                             FLAGS_put_lease_ttl_ms);
+    default_config.GetBool("enable_segment_pressure_eviction",
+                           &master_config.enable_segment_pressure_eviction,
+                           FLAGS_enable_segment_pressure_eviction);
+    default_config.GetUInt32("rebalance_bandwidth_mb",
+                             &master_config.rebalance_bandwidth_mb,
+                             FLAGS_rebalance_bandwidth_mb);
+    default_config.GetUInt32("tiering_demote_access_count",
+                             &master_config.tiering_demote_access_count,
+                             FLAGS_tiering_demote_access_count);
+    default_config.GetUInt32("tiering_promote_disk_reads",
+                             &master_config.tiering_promote_disk_reads,
+                             FLAGS_tiering_promote_disk_reads);
     default_config.GetInt64("client_live_ttl_sec",
                             &master_config.client_live_ttl_sec,
                             FLAGS_client_ttl);
@@ -171,6 +297,11 @@ void InitMasterConf(const mooncake::DefaultConfig& default_config,
                            FLAGS_enable_ha);
     default_config.GetBool("enable_offload", &master_config.enable_offload,
                            FLAGS_enable_offload);
+    default_config.GetBool("enable_partition", &master_config.enable_partition,
+                           FLAGS_enable_partition);
+    default_config.GetUInt32("partition_workers",
+                             &master_config.partition_workers,
+                             FLAGS_partition_workers);
     default_config.GetString("etcd_endpoints", &master_config.etcd_endpoints,
                              FLAGS_etcd_endpoints);
     default_config.GetString("cluster_id", &master_config.cluster_id,
@@ -180,6 +311,51 @@ void InitMasterConf(const mooncake::DefaultConfig& default_config,
     default_config.GetInt64("global_file_segment_size",
                             &master_config.global_file_segment_size,
                             FLAGS_global_file_segment_size);
+    default_config.GetString("snapshot_path", &master_config.snapshot_path,
+                             FLAGS_snapshot_path);
+    default_config.GetUInt64("snapshot_interval_sec",
+                             &master_config.snapshot_interval_sec,
+                             FLAGS_snapshot_interval_sec);
+    default_config.GetUInt64("oplog_capacity", &master_config.oplog_capacity,
+                             FLAGS_oplog_capacity);
+    default_config.GetBool("enable_prefix_index",
+                           &master_config.enable_prefix_index,
+                           FLAGS_enable_prefix_index);
+    default_config.GetUInt64("allocator_cache_max_size",
+                             &master_config.allocator_cache_max_size,
+                             FLAGS_allocator_cache_max_size);
+    default_config.GetUInt64("defrag_interval_sec",
+                             &master_config.defrag_interval_sec,
+                             FLAGS_defrag_interval_sec);
+    default_config.GetDouble("defrag_threshold",
+                             &master_config.defrag_threshold,
+                             FLAGS_defrag_threshold);
+    default_config.GetUInt32("defrag_max_moves",
+                             &master_config.defrag_max_moves,
+                             FLAGS_defrag_max_moves);
+    default_config.GetUInt64("defrag_max_request_rate",
+                             &master_config.defrag_max_request_rate,
+                             FLAGS_defrag_max_request_rate);
+    default_config.GetUInt64("slab_size",
+                             &master_config.slab_size,
+                             FLAGS_slab_size);
+    default_config.GetUInt32("slab_class_min_count",
+                             &master_config.slab_class_min_count,
+                             FLAGS_slab_class_min_count);
+    default_config.GetUInt32("cxl_promote_access_count",
+                             &master_config.cxl_promote_access_count,
+                             FLAGS_cxl_promote_access_count);
+    default_config.GetUInt32("hot_replica_read_rate",
+                             &master_config.hot_replica_read_rate,
+                             FLAGS_hot_replica_read_rate);
+    default_config.GetUInt32("hot_replica_max_replicas",
+                             &master_config.hot_replica_max_replicas,
+                             FLAGS_hot_replica_max_replicas);
+    default_config.GetUInt64("hot_replica_cooldown_sec",
+                             &master_config.hot_replica_cooldown_sec,
+                             FLAGS_hot_replica_cooldown_sec);
+    default_config.GetBool("enable_dedup", &master_config.enable_dedup,
+                           FLAGS_enable_dedup);
     default_config.GetString("memory_allocator",
                              &master_config.memory_allocator,
                              FLAGS_memory_allocator);
@@ -342,6 +518,57 @@ void LoadConfigFromCmdline(mooncake::MasterConfig& master_config,
         master_config.eviction_high_watermark_ratio =
             FLAGS_eviction_high_watermark_ratio;
     }
+    if ((google::GetCommandLineFlagInfo("eviction_sample_size", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.eviction_sample_size = FLAGS_eviction_sample_size;
+    }
+    if ((google::GetCommandLineFlagInfo("eviction_shards_per_tick", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.eviction_shards_per_tick = FLAGS_eviction_shards_per_tick;
+    }
+    if ((google::GetCommandLineFlagInfo("enable_cost_aware_eviction", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.enable_cost_aware_eviction =
+            FLAGS_enable_cost_aware_eviction;
+    }
+    if ((google::GetCommandLineFlagInfo("tenant_quotas", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.tenant_quotas = FLAGS_tenant_quotas;
+    }
+    if ((google::GetCommandLineFlagInfo("put_lease_ttl_ms", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.put_lease_ttl_ms = FLAGS_put_lease_ttl_ms;
+    }
+    if ((google::GetCommandLineFlagInfo("enable_segment_pressure_eviction",
+                                        &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.enable_segment_pressure_eviction =
+            FLAGS_enable_segment_pressure_eviction;
+    }
+    if ((google::GetCommandLineFlagInfo("rebalance_bandwidth_mb", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.rebalance_bandwidth_mb = FLAGS_rebalance_bandwidth_mb;
+    }
+    if ((google::GetCommandLineFlagInfo("tiering_demote_access_count",
+                                        &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.tiering_demote_access_count =
+            FLAGS_tiering_demote_access_count;
+    }
+    if ((google::GetCommandLineFlagInfo("tiering_promote_disk_reads", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.tiering_promote_disk_reads =
+            FLAGS_tiering_promote_disk_reads;
+    }
     if ((google::GetCommandLineFlagInfo("enable_ha", &info) &&
          !info.is_default) ||
         !conf_set) {
@@ -352,6 +579,16 @@ void LoadConfigFromCmdline(mooncake::MasterConfig& master_config,
         !conf_set) {
         master_config.enable_offload = FLAGS_enable_offload;
     }
+    if ((google::GetCommandLineFlagInfo("enable_partition", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.enable_partition = FLAGS_enable_partition;
+    }
+    if ((google::GetCommandLineFlagInfo("partition_workers", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.partition_workers = FLAGS_partition_workers;
+    }
     if ((google::GetCommandLineFlagInfo("etcd_endpoints", &info) &&
          !info.is_default) ||
         !conf_set) {
@@ -377,6 +614,90 @@ void LoadConfigFromCmdline(mooncake::MasterConfig& master_config,
         !conf_set) {
         master_config.global_file_segment_size = FLAGS_global_file_segment_size;
     }
+    if ((google::GetCommandLineFlagInfo("snapshot_path", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.snapshot_path = FLAGS_snapshot_path;
+    }
+    if ((google::GetCommandLineFlagInfo("snapshot_interval_sec", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.snapshot_interval_sec = FLAGS_snapshot_interval_sec;
+    }
+    if ((google::GetCommandLineFlagInfo("oplog_capacity", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.oplog_capacity = FLAGS_oplog_capacity;
+    }
+    if ((google::GetCommandLineFlagInfo("enable_prefix_index", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.enable_prefix_index = FLAGS_enable_prefix_index;
+    }
+    if ((google::GetCommandLineFlagInfo("allocator_cache_max_size", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.allocator_cache_max_size =
+            FLAGS_allocator_cache_max_size;
+    }
+    if ((google::GetCommandLineFlagInfo("defrag_interval_sec", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.defrag_interval_sec = FLAGS_defrag_interval_sec;
+    }
+    if ((google::GetCommandLineFlagInfo("defrag_threshold", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.defrag_threshold = FLAGS_defrag_threshold;
+    }
+    if ((google::GetCommandLineFlagInfo("defrag_max_moves", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.defrag_max_moves = FLAGS_defrag_max_moves;
+    }
+    if ((google::GetCommandLineFlagInfo("defrag_max_request_rate", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.defrag_max_request_rate = FLAGS_defrag_max_request_rate;
+    }
+    if ((google::GetCommandLineFlagInfo("slab_size", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.slab_size = FLAGS_slab_size;
+    }
+    if ((google::GetCommandLineFlagInfo("slab_class_min_count", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.slab_class_min_count = FLAGS_slab_class_min_count;
+    }
+    if ((google::GetCommandLineFlagInfo("cxl_promote_access_count", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.cxl_promote_access_count =
+            FLAGS_cxl_promote_access_count;
+    }
+    if ((google::GetCommandLineFlagInfo("hot_replica_read_rate", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.hot_replica_read_rate = FLAGS_hot_replica_read_rate;
+    }
+    if ((google::GetCommandLineFlagInfo("hot_replica_max_replicas", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.hot_replica_max_replicas =
+            FLAGS_hot_replica_max_replicas;
+    }
+    if ((google::GetCommandLineFlagInfo("hot_replica_cooldown_sec", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.hot_replica_cooldown_sec =
+            FLAGS_hot_replica_cooldown_sec;
+    }
+    if ((google::GetCommandLineFlagInfo("enable_dedup", &info) &&
+         !info.is_default) ||
+        !conf_set) {
+        master_config.enable_dedup = FLAGS_enable_dedup;
+    }
     if ((google::GetCommandLineFlagInfo("memory_allocator", &info) &&
          !info.is_default) ||
         !conf_set) {
@@ -487,6 +808,94 @@ std::unique_ptr<mooncake::HttpMetadataServer> StartHttpMetadataServer(
     }
 }
 
+// Serves one arc of the partition ring on rpc_port + index with a single
+// RPC thread, pinned to cpu unless it is negative
+int RunPartitionWorker(const mooncake::MasterConfig& master_config,
+                       uint32_t index, int cpu) {
+    mooncake::MasterConfig config = master_config;
+    config.rpc_port = master_config.rpc_port + index;
+    config.rpc_thread_num = 1;
+    if (index > 0 && !config.snapshot_path.empty()) {
+        config.snapshot_path += "." + std::to_string(index);
+    }
+    mooncake::WrappedMasterServiceConfig service_config(config, 0);
+    // Metrics are process wide, reported and served by the first worker
+    service_config.enable_metric_reporting =
+        index == 0 && config.enable_metric_reporting;
+    service_config.enable_http_server = index == 0;
+    mooncake::WrappedMasterService wrapped_master_service(service_config);
+
+    // Set before the server creates its thread, which inherits it. The
+    // background threads of the service, created above, are left to the
+    // scheduler.
+    if (cpu >= 0) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        int ret =
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (ret != 0) {
+            LOG(WARNING) << "Failed to pin partition worker " << index
+                         << " to cpu " << cpu << ": " << strerror(ret);
+        }
+    }
+    coro_rpc::coro_rpc_server server(
+        config.rpc_thread_num, config.rpc_port, config.rpc_address,
+        std::chrono::seconds(config.rpc_conn_timeout_seconds),
+        config.rpc_enable_tcp_no_delay);
+    const char* value = std::getenv("MC_RPC_PROTOCOL");
+    if (value && std::string_view(value) == "rdma") {
+        server.init_ibv();
+    }
+    mooncake::RegisterRpcService(server, wrapped_master_service);
+
+    mooncake::PartitionMember partition_member(
+        wrapped_master_service.GetMasterService(), config.etcd_endpoints,
+        config.rpc_address + ":" + std::to_string(config.rpc_port));
+    if (partition_member.Start() != mooncake::ErrorCode::OK) {
+        LOG(FATAL) << "Partition worker " << index
+                   << " failed to join the partition ring";
+        return 1;
+    }
+    LOG(INFO) << "Partition worker " << index << " serving on port "
+              << config.rpc_port << ", cpu=" << cpu;
+    int ret = server.start();
+    return ret;
+}
+
+// Runs partition_workers members of the partition ring in this process.
+// Each owns the metadata of its arcs in a MasterService of its own, served
+// by one RPC thread on its own core, so that the workers share no locks
+// and clients route keys and split batches to them like to any other
+// partition master.
+int RunPartitionWorkers(const mooncake::MasterConfig& master_config) {
+    std::vector<int> cpus;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+    }
+    if (cpus.size() < master_config.partition_workers) {
+        LOG(WARNING) << "Running " << master_config.partition_workers
+                     << " partition workers on " << cpus.size()
+                     << " cpus, some share a cpu";
+    }
+
+    std::atomic<int> exit_code{0};
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < master_config.partition_workers; ++i) {
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        workers.emplace_back([&master_config, &exit_code, i, cpu] {
+            int ret = RunPartitionWorker(master_config, i, cpu);
+            if (ret != 0) exit_code = ret;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    return exit_code;
+}
+
 int main(int argc, char* argv[]) {
     mooncake::init_ylt_log_level();
     // Initialize gflags
@@ -516,15 +925,30 @@ int main(int argc, char* argv[]) {
         LOG(FATAL) << "Etcd endpoints must be set when enable_ha is true";
         return 1;
     }
-    if (!master_config.enable_ha && !master_config.etcd_endpoints.empty()) {
+    if (master_config.enable_partition) {
+        if (master_config.enable_ha) {
+            LOG(FATAL) << "enable_partition and enable_ha cannot both be set";
+            return 1;
+        }
+        if (master_config.etcd_endpoints.empty()) {
+            LOG(FATAL)
+                << "Etcd endpoints must be set when enable_partition is true";
+            return 1;
+        }
+    } else if (master_config.partition_workers > 1) {
+        LOG(FATAL) << "partition_workers requires enable_partition";
+        return 1;
+    } else if (!master_config.enable_ha &&
+               !master_config.etcd_endpoints.empty()) {
         LOG(WARNING)
             << "Etcd endpoints are set but will not be used in non-HA mode";
     }
     if (master_config.memory_allocator != "cachelib" &&
-        master_config.memory_allocator != "offset") {
+        master_config.memory_allocator != "offset" &&
+        master_config.memory_allocator != "slab") {
         LOG(FATAL) << "Invalid memory allocator: "
                    << master_config.memory_allocator
-                   << ", must be 'cachelib' or 'offset'";
+                   << ", must be 'cachelib', 'offset' or 'slab'";
         return 1;
     }
 
@@ -545,7 +969,23 @@ int main(int argc, char* argv[]) {
         << ", eviction_ratio=" << master_config.eviction_ratio
         << ", eviction_high_watermark_ratio="
         << master_config.eviction_high_watermark_ratio
+        << ", eviction_sample_size=" << master_config.eviction_sample_size
+        << ", eviction_shards_per_tick="
+        << master_config.eviction_shards_per_tick
+        << ", enable_cost_aware_eviction="
+        << master_config.enable_cost_aware_eviction
+        << ", tenant_quotas=" << master_config.tenant_quotas
+        << ", put_lease_ttl_ms=" << master_config.put_lease_ttl_ms
+        << ", enable_segment_pressure_eviction="
+        << master_config.enable_segment_pressure_eviction
+        << ", rebalance_bandwidth_mb=" << master_config.rebalance_bandwidth_mb
+        << ", tiering_demote_access_count="
+        << master_config.tiering_demote_access_count
+        << ", tiering_promote_disk_reads="
+        << master_config.tiering_promote_disk_reads
         << ", enable_ha=" << master_config.enable_ha
+        << ", enable_partition=" << master_config.enable_partition
+        << ", partition_workers=" << master_config.partition_workers
         << ", enable_offload=" << master_config.enable_offload
         << ", etcd_endpoints=" << master_config.etcd_endpoints
         << ", client_ttl=" << master_config.client_live_ttl_sec
@@ -560,6 +1000,26 @@ int main(int argc, char* argv[]) {
         << ", root_fs_dir=" << master_config.root_fs_dir
         << ", global_file_segment_size="
         << master_config.global_file_segment_size
+        << ", snapshot_path=" << master_config.snapshot_path
+        << ", snapshot_interval_sec=" << master_config.snapshot_interval_sec
+        << ", oplog_capacity=" << master_config.oplog_capacity
+        << ", enable_prefix_index=" << master_config.enable_prefix_index
+        << ", allocator_cache_max_size="
+        << master_config.allocator_cache_max_size
+        << ", defrag_interval_sec=" << master_config.defrag_interval_sec
+        << ", defrag_threshold=" << master_config.defrag_threshold
+        << ", defrag_max_moves=" << master_config.defrag_max_moves
+        << ", defrag_max_request_rate=" << master_config.defrag_max_request_rate
+        << ", slab_size=" << master_config.slab_size
+        << ", slab_class_min_count=" << master_config.slab_class_min_count
+        << ", cxl_promote_access_count="
+        << master_config.cxl_promote_access_count
+        << ", hot_replica_read_rate=" << master_config.hot_replica_read_rate
+        << ", hot_replica_max_replicas="
+        << master_config.hot_replica_max_replicas
+        << ", hot_replica_cooldown_sec="
+        << master_config.hot_replica_cooldown_sec
+        << ", enable_dedup=" << master_config.enable_dedup
         << ", memory_allocator=" << master_config.memory_allocator
         << ", enable_http_metadata_server="
         << master_config.enable_http_metadata_server
@@ -605,6 +1065,8 @@ int main(int argc, char* argv[]) {
         mooncake::MasterServiceSupervisor supervisor(
             mooncake::MasterServiceSupervisorConfig{master_config});
         return supervisor.Start();
+    } else if (master_config.partition_workers > 1) {
+        return RunPartitionWorkers(master_config);
     } else {
         // version is not used in non-HA mode, just pass a dummy value
         mooncake::ViewVersionId version = 0;
@@ -621,6 +1083,20 @@ int main(int argc, char* argv[]) {
             mooncake::WrappedMasterServiceConfig(master_config, version));
 
         mooncake::RegisterRpcService(server, wrapped_master_service);
+
+        // Other masters own the keys of the other arcs of the ring
+        std::unique_ptr<mooncake::PartitionMember> partition_member;
+        if (master_config.enable_partition) {
+            partition_member = std::make_unique<mooncake::PartitionMember>(
+                wrapped_master_service.GetMasterService(),
+                master_config.etcd_endpoints,
+                master_config.rpc_address + ":" +
+                    std::to_string(master_config.rpc_port));
+            if (partition_member->Start() != mooncake::ErrorCode::OK) {
+                LOG(FATAL) << "Failed to join the partition ring";
+                return 1;
+            }
+        }
         return server.start();
     }
 }
@@ -4,17 +4,23 @@
 #include <async_simple/coro/Lazy.h>
 #include <async_simple/coro/SyncAwait.h>
 
+#include <algorithm>
 #include <csignal>
+#include <future>
 #include <string>
 #include <vector>
 #include <ylt/coro_rpc/impl/coro_rpc_client.hpp>
 #include <ylt/util/tl/expected.hpp>
 
 #include "mutex.h"
+#include "ping_aggregator.h"
 #include "rpc_service.h"
 #include "types.h"
+#include "utils.h"
 #include "utils/scoped_vlog_timer.h"
+#include "flat_replica_list.h"
 #include "master_metric_manager.h"
+#include "request_trace.h"
 #include "version.h"
 
 namespace mooncake {
@@ -32,6 +38,16 @@ struct RpcNameTraits<&WrappedMasterService::BatchExistKey> {
     static constexpr const char* value = "BatchExistKey";
 };
 
+template <>
+struct RpcNameTraits<&WrappedMasterService::BatchExistKeyPrefix> {
+    static constexpr const char* value = "BatchExistKeyPrefix";
+};
+
+template <>
+struct RpcNameTraits<&WrappedMasterService::ScanKeys> {
+    static constexpr const char* value = "ScanKeys";
+};
+
 template <>
 struct RpcNameTraits<&WrappedMasterService::GetReplicaList> {
     static constexpr const char* value = "GetReplicaList";
@@ -62,6 +78,11 @@ struct RpcNameTraits<&WrappedMasterService::BatchGetReplicaList> {
     static constexpr const char* value = "BatchGetReplicaList";
 };
 
+template <>
+struct RpcNameTraits<&WrappedMasterService::BatchGetReplicaListFlat> {
+    static constexpr const char* value = "BatchGetReplicaListFlat";
+};
+
 template <>
 struct RpcNameTraits<&WrappedMasterService::PutStart> {
     static constexpr const char* value = "PutStart";
@@ -87,11 +108,41 @@ struct RpcNameTraits<&WrappedMasterService::PutRevoke> {
     static constexpr const char* value = "PutRevoke";
 };
 
+template <>
+struct RpcNameTraits<&WrappedMasterService::StreamPutStart> {
+    static constexpr const char* value = "StreamPutStart";
+};
+
+template <>
+struct RpcNameTraits<&WrappedMasterService::StreamPutCommit> {
+    static constexpr const char* value = "StreamPutCommit";
+};
+
+template <>
+struct RpcNameTraits<&WrappedMasterService::GetStreamReplicaList> {
+    static constexpr const char* value = "GetStreamReplicaList";
+};
+
 template <>
 struct RpcNameTraits<&WrappedMasterService::BatchPutRevoke> {
     static constexpr const char* value = "BatchPutRevoke";
 };
 
+template <>
+struct RpcNameTraits<&WrappedMasterService::GrantPutLease> {
+    static constexpr const char* value = "GrantPutLease";
+};
+
+template <>
+struct RpcNameTraits<&WrappedMasterService::BatchLeasedPutEnd> {
+    static constexpr const char* value = "BatchLeasedPutEnd";
+};
+
+template <>
+struct RpcNameTraits<&WrappedMasterService::ReleasePutLease> {
+    static constexpr const char* value = "ReleasePutLease";
+};
+
 template <>
 struct RpcNameTraits<&WrappedMasterService::Remove> {
     static constexpr const char* value = "Remove";
@@ -127,6 +178,11 @@ struct RpcNameTraits<&WrappedMasterService::Ping> {
     static constexpr const char* value = "Ping";
 };
 
+template <>
+struct RpcNameTraits<&WrappedMasterService::BatchPing> {
+    static constexpr const char* value = "BatchPing";
+};
+
 template <>
 struct RpcNameTraits<&WrappedMasterService::GetFsdir> {
     static constexpr const char* value = "GetFsdir";
@@ -207,6 +263,11 @@ struct RpcNameTraits<&WrappedMasterService::FetchTasks> {
     static constexpr const char* value = "FetchTasks";
 };
 
+template <>
+struct RpcNameTraits<&WrappedMasterService::WaitTasks> {
+    static constexpr const char* value = "WaitTasks";
+};
+
 template <>
 struct RpcNameTraits<&WrappedMasterService::MarkTaskToComplete> {
     static constexpr const char* value = "MarkTaskToComplete";
@@ -221,12 +282,17 @@ tl::expected<ReturnType, ErrorCode> MasterClient::invoke_rpc(Args&&... args) {
         metrics_->rpc_count.inc({RpcNameTraits<ServiceMethod>::value});
     }
 
+    TraceSpan span(RpcNameTraits<ServiceMethod>::value);
+    const std::string trace_attachment = FormatTraceId(CurrentTraceId());
     auto start_time = std::chrono::steady_clock::now();
     return async_simple::coro::syncAwait(
         [&]() -> async_simple::coro::Lazy<tl::expected<ReturnType, ErrorCode>> {
             auto ret = co_await pool->send_request(
                 [&](coro_io::client_reuse_hint,
                     coro_rpc::coro_rpc_client& client) {
+                    // Set even when empty, so that a pooled client does not
+                    // pass on the trace id of an earlier request
+                    client.set_req_attachment(trace_attachment);
                     return client.send_request<ServiceMethod>(
                         std::forward<Args>(args)...);
                 });
@@ -261,6 +327,8 @@ std::vector<tl::expected<ResultType, ErrorCode>> MasterClient::invoke_batch_rpc(
         metrics_->rpc_count.inc({RpcNameTraits<ServiceMethod>::value});
     }
 
+    TraceSpan span(RpcNameTraits<ServiceMethod>::value);
+    const std::string trace_attachment = FormatTraceId(CurrentTraceId());
     auto start_time = std::chrono::steady_clock::now();
     return async_simple::coro::syncAwait(
         [&]() -> async_simple::coro::Lazy<
@@ -268,6 +336,7 @@ std::vector<tl::expected<ResultType, ErrorCode>> MasterClient::invoke_batch_rpc(
             auto ret = co_await pool->send_request(
                 [&](coro_io::client_reuse_hint,
                     coro_rpc::coro_rpc_client& client) {
+                    client.set_req_attachment(trace_attachment);
                     return client.send_request<ServiceMethod>(
                         std::forward<Args>(args)...);
                 });
@@ -299,8 +368,125 @@ std::vector<tl::expected<ResultType, ErrorCode>> MasterClient::invoke_batch_rpc(
         }());
 }
 
+namespace {
+
+// Slices of a segment are whole multiples of the slab size of Cachelib,
+// the strictest of the allocators of the master
+constexpr size_t kSegmentSliceAlignment = 4 * 1024 * 1024;
+
+// An object must fit in one slice, so fewer slices allow larger objects
+size_t PartitionSegmentSlices() {
+    static const size_t slices = std::max<size_t>(
+        1, GetEnvOr<size_t>("MC_STORE_PARTITION_SEGMENT_SLICES", 16));
+    return slices;
+}
+
+template <typename T>
+std::vector<T> Pick(const std::vector<T>& values,
+                    const std::vector<size_t>& indices) {
+    std::vector<T> picked;
+    picked.reserve(indices.size());
+    for (size_t index : indices) {
+        picked.push_back(values[index]);
+    }
+    return picked;
+}
+
+}  // namespace
+
+template <typename ResultType, typename Fn>
+std::vector<tl::expected<ResultType, ErrorCode>> MasterClient::PartitionBatch(
+    const Partitions& partitions, const std::vector<std::string>& keys,
+    Fn&& fn) {
+    std::vector<std::vector<size_t>> groups(partitions.masters.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        groups[partitions.ring.OwnerOf(keys[i])].push_back(i);
+    }
+    std::vector<tl::expected<ResultType, ErrorCode>> results(
+        keys.size(), tl::make_unexpected(ErrorCode::RPC_FAIL));
+    auto run = [&](size_t master) {
+        const auto& indices = groups[master];
+        auto group_results = fn(*partitions.masters[master], indices);
+        if (group_results.size() != indices.size()) {
+            LOG(ERROR) << "Got " << group_results.size() << " results for "
+                       << indices.size() << " keys";
+            return;
+        }
+        for (size_t i = 0; i < indices.size(); ++i) {
+            results[indices[i]] = std::move(group_results[i]);
+        }
+    };
+    // The last group is run by the calling thread
+    std::vector<std::future<void>> futures;
+    std::optional<size_t> last;
+    for (size_t master = 0; master < groups.size(); ++master) {
+        if (groups[master].empty()) {
+            continue;
+        }
+        if (last) {
+            futures.push_back(std::async(std::launch::async, run, *last));
+        }
+        last = master;
+    }
+    if (last) {
+        run(*last);
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+    return results;
+}
+
+template <typename Fn>
+auto MasterClient::ForEachMaster(const Partitions& partitions, Fn&& fn) {
+    std::vector<std::future<std::invoke_result_t<Fn&, MasterClient&>>>
+        futures;
+    for (size_t i = 1; i < partitions.masters.size(); ++i) {
+        futures.push_back(std::async(std::launch::async, [&fn, &partitions,
+                                                          i]() {
+            return fn(*partitions.masters[i]);
+        }));
+    }
+    std::vector<std::invoke_result_t<Fn&, MasterClient&>> results;
+    results.reserve(partitions.masters.size());
+    results.push_back(fn(*partitions.masters[0]));
+    for (auto& future : futures) {
+        results.push_back(future.get());
+    }
+    return results;
+}
+
 MasterClient::~MasterClient() = default;
 
+void MasterClient::InitCoalescers() {
+    const auto window_us = GetEnvOr<int64_t>("MC_STORE_MASTER_COALESCE_US", 0);
+    if (window_us <= 0) {
+        return;
+    }
+    const auto max_batch = std::max<size_t>(
+        1, GetEnvOr<size_t>("MC_STORE_MASTER_COALESCE_MAX", 128));
+    const std::chrono::microseconds window(window_us);
+
+    exist_key_coalescer_ = std::make_unique<RpcCoalescer<bool>>(
+        [this](const std::vector<std::string>& keys) {
+            return BatchExistKey(keys);
+        },
+        window, max_batch);
+    get_replica_list_coalescer_ =
+        std::make_unique<RpcCoalescer<GetReplicaListResponse>>(
+            [this](const std::vector<std::string>& keys) {
+                return BatchGetReplicaList(keys);
+            },
+            window, max_batch);
+    put_end_coalescer_ = std::make_unique<RpcCoalescer<void>>(
+        [this](const std::vector<std::string>& keys) {
+            return BatchPutEnd(keys);
+        },
+        window, max_batch);
+    LOG(INFO) << "Coalescing master calls, window=" << window_us
+              << "us, max_batch=" << max_batch;
+}
+
 ErrorCode MasterClient::Connect(const std::string& master_addr) {
     ScopedVLogTimer timer(1, "MasterClient::Connect");
     timer.LogRequest("master_addr=", master_addr);
@@ -313,6 +499,8 @@ ErrorCode MasterClient::Connect(const std::string& master_addr) {
         client_accessor_.SetClientPool(client_pool);
         client_addr_param_ = master_addr;
     }
+    // The puts seen by another master do not carry over
+    put_sequence_id_ = 0;
     auto pool = client_accessor_.GetClientPool();
     // The client pool does not have native connection check method, so we need
     // to use custom ServiceReady API.
@@ -335,12 +523,126 @@ ErrorCode MasterClient::Connect(const std::string& master_addr) {
     return ErrorCode::OK;
 }
 
+ErrorCode MasterClient::ConnectPartitioned(
+    const std::vector<std::string>& master_addrs) {
+    ScopedVLogTimer timer(1, "MasterClient::ConnectPartitioned");
+    timer.LogRequest("masters_count=", master_addrs.size());
+
+    if (master_addrs.empty()) {
+        LOG(ERROR) << "No master to connect to";
+        timer.LogResponse("error_code=", ErrorCode::INVALID_PARAMS);
+        return ErrorCode::INVALID_PARAMS;
+    }
+    std::lock_guard<std::mutex> lock(partition_segments_mutex_);
+    auto old_partitions = GetPartitions();
+    auto partitions = std::make_shared<Partitions>();
+    partitions->ring = HashRing(master_addrs);
+    for (const auto& addr : partitions->ring.members()) {
+        std::shared_ptr<MasterClient> master;
+        if (old_partitions) {
+            const auto& old_members = old_partitions->ring.members();
+            auto it = std::find(old_members.begin(), old_members.end(), addr);
+            if (it != old_members.end()) {
+                master = old_partitions->masters[it - old_members.begin()];
+            }
+        }
+        if (!master) {
+            master = std::make_shared<MasterClient>(client_id_, metrics_);
+            master->WatchPuts(watch_puts_);
+            ErrorCode err = master->Connect(addr);
+            if (err != ErrorCode::OK) {
+                LOG(ERROR) << "Failed to connect to master " << addr << ": "
+                           << err;
+                timer.LogResponse("error_code=", err);
+                return err;
+            }
+        }
+        partitions->masters.push_back(std::move(master));
+    }
+    {
+        std::lock_guard<std::shared_mutex> partitions_lock(partitions_mutex_);
+        partitions_ = partitions;
+    }
+    if (old_partitions) {
+        MoveSegmentSlices(*old_partitions, *partitions);
+    }
+    LOG(INFO) << "Connected to " << partitions->masters.size()
+              << " partitioned masters";
+    timer.LogResponse("error_code=", ErrorCode::OK);
+    return ErrorCode::OK;
+}
+
+std::vector<std::string> MasterClient::GetPartitionMasters() const {
+    auto partitions = GetPartitions();
+    return partitions ? partitions->ring.members()
+                      : std::vector<std::string>{};
+}
+
+std::vector<std::vector<Segment>> MasterClient::SlicesPerMaster(
+    const Partitions& partitions, const Segment& segment) {
+    std::vector<std::vector<Segment>> slices_per_master(
+        partitions.masters.size());
+    auto slices = SliceSegment(segment, PartitionSegmentSlices(),
+                               kSegmentSliceAlignment);
+    for (size_t i = 0; i < slices.size(); ++i) {
+        slices_per_master[partitions.ring.OwnerOf(SegmentSliceKey(segment, i))]
+            .push_back(std::move(slices[i]));
+    }
+    return slices_per_master;
+}
+
+void MasterClient::MoveSegmentSlices(const Partitions& from,
+                                     const Partitions& to) {
+    const auto& to_members = to.ring.members();
+    size_t moved = 0;
+    for (const auto& [id, segment] : partition_segments_) {
+        auto slices = SliceSegment(segment, PartitionSegmentSlices(),
+                                   kSegmentSliceAlignment);
+        for (size_t i = 0; i < slices.size(); ++i) {
+            const std::string key = SegmentSliceKey(segment, i);
+            const auto& old_owner = from.ring.members()[from.ring.OwnerOf(key)];
+            const size_t new_owner = to.ring.OwnerOf(key);
+            if (old_owner == to_members[new_owner]) {
+                continue;
+            }
+            // A master that left the ring has dropped its slices already.
+            // The objects of the slice are lost, like those of an
+            // unmounted segment.
+            auto it =
+                std::find(to_members.begin(), to_members.end(), old_owner);
+            if (it != to_members.end()) {
+                auto result = to.masters[it - to_members.begin()]
+                                  ->UnmountSegment(slices[i].id);
+                LOG_IF(WARNING, !result)
+                    << "Failed to unmount a slice of segment " << segment.name
+                    << " from " << old_owner << ": " << result.error();
+            }
+            // A failed mount is retried by the remount the new owner asks
+            // for on ping
+            auto result = to.masters[new_owner]->MountSegment(slices[i]);
+            LOG_IF(WARNING, !result && result.error() !=
+                                           ErrorCode::SEGMENT_ALREADY_EXISTS)
+                << "Failed to mount a slice of segment " << segment.name
+                << " on " << to_members[new_owner] << ": " << result.error();
+            moved++;
+        }
+    }
+    LOG(INFO) << "Moved " << moved << " segment slices to their new masters";
+}
+
 tl::expected<bool, ErrorCode> MasterClient::ExistKey(
     const std::string& object_key) {
     ScopedVLogTimer timer(1, "MasterClient::ExistKey");
     timer.LogRequest("object_key=", object_key);
 
-    auto result = invoke_rpc<&WrappedMasterService::ExistKey, bool>(object_key);
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(object_key).ExistKey(object_key);
+    }
+
+    auto result = exist_key_coalescer_
+                      ? exist_key_coalescer_->Call(object_key)
+                      : invoke_rpc<&WrappedMasterService::ExistKey, bool>(
+                            object_key);
     timer.LogResponseExpected(result);
     return result;
 }
@@ -350,14 +652,88 @@ std::vector<tl::expected<bool, ErrorCode>> MasterClient::BatchExistKey(
     ScopedVLogTimer timer(1, "MasterClient::BatchExistKey");
     timer.LogRequest("keys_count=", object_keys.size());
 
+    if (auto partitions = GetPartitions()) {
+        return PartitionBatch<bool>(
+            *partitions, object_keys,
+            [&](MasterClient& master, const std::vector<size_t>& indices) {
+                return master.BatchExistKey(Pick(object_keys, indices));
+            });
+    }
+
     auto result = invoke_batch_rpc<&WrappedMasterService::BatchExistKey, bool>(
         object_keys.size(), object_keys);
     timer.LogResponse("result=", result.size(), " keys");
     return result;
 }
 
+tl::expected<uint64_t, ErrorCode> MasterClient::BatchExistKeyPrefix(
+    const std::vector<std::string>& object_keys) {
+    ScopedVLogTimer timer(1, "MasterClient::BatchExistKeyPrefix");
+    timer.LogRequest("keys_count=", object_keys.size());
+
+    // The keys are spread over the masters, so all of them are checked
+    if (GetPartitions()) {
+        auto results = BatchExistKey(object_keys);
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (!results[i]) {
+                return tl::make_unexpected(results[i].error());
+            }
+            if (!*results[i]) {
+                return i;
+            }
+        }
+        return object_keys.size();
+    }
+
+    auto result =
+        invoke_rpc<&WrappedMasterService::BatchExistKeyPrefix, uint64_t>(
+            object_keys);
+    timer.LogResponseExpected(result);
+    return result;
+}
+
+tl::expected<ScanKeysResponse, ErrorCode> MasterClient::ScanKeys(
+    const ScanKeysCursor& cursor, uint64_t limit, const std::string& prefix,
+    bool with_metadata) {
+    ScopedVLogTimer timer(1, "MasterClient::ScanKeys");
+    timer.LogRequest("shard=", cursor.shard, ", limit=", limit);
+
+    // The masters are scanned one after the other
+    if (auto partitions = GetPartitions()) {
+        if (cursor.partition >= partitions->masters.size()) {
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        ScanKeysCursor master_cursor = cursor;
+        master_cursor.partition = 0;
+        auto result = partitions->masters[cursor.partition]->ScanKeys(
+            master_cursor, limit, prefix, with_metadata);
+        if (!result) {
+            return result;
+        }
+        result->next.partition = cursor.partition;
+        if (result->done &&
+            cursor.partition + 1 < partitions->masters.size()) {
+            result->next = ScanKeysCursor{};
+            result->next.partition = cursor.partition + 1;
+            result->done = false;
+        }
+        return result;
+    }
+
+    auto result =
+        invoke_rpc<&WrappedMasterService::ScanKeys, ScanKeysResponse>(
+            cursor, limit, prefix, with_metadata);
+    timer.LogResponseExpected(result);
+    return result;
+}
+
 tl::expected<MasterMetricManager::CacheHitStatDict, ErrorCode>
 MasterClient::CalcCacheStats() {
+    // The hit rates of the masters do not add up, those of one are an
+    // estimate for all
+    if (auto partitions = GetPartitions()) {
+        return partitions->masters[0]->CalcCacheStats();
+    }
     return invoke_rpc<&WrappedMasterService::CalcCacheStats,
                       MasterMetricManager::CacheHitStatDict>();
 }
@@ -369,6 +745,11 @@ MasterClient::BatchQueryIp(const std::vector<UUID>& client_ids) {
     ScopedVLogTimer timer(1, "MasterClient::BatchQueryIp");
     timer.LogRequest("client_ids_count=", client_ids.size());
 
+    // Clients ping every master, so any of them knows them all
+    if (auto partitions = GetPartitions()) {
+        return partitions->masters[0]->BatchQueryIp(client_ids);
+    }
+
     auto result = invoke_rpc<
         &WrappedMasterService::BatchQueryIp,
         std::unordered_map<UUID, std::vector<std::string>, boost::hash<UUID>>>(
@@ -386,6 +767,26 @@ MasterClient::BatchReplicaClear(const std::vector<std::string>& object_keys,
     timer.LogRequest("object_keys_count=", object_keys.size(),
                      ", client_id=", client_id,
                      ", segment_name=", segment_name);
+    if (auto partitions = GetPartitions()) {
+        std::vector<std::string> cleared;
+        std::vector<std::vector<std::string>> keys_per_master(
+            partitions->masters.size());
+        for (const auto& key : object_keys) {
+            keys_per_master[partitions->ring.OwnerOf(key)].push_back(key);
+        }
+        for (size_t i = 0; i < keys_per_master.size(); ++i) {
+            if (keys_per_master[i].empty()) {
+                continue;
+            }
+            auto result = partitions->masters[i]->BatchReplicaClear(
+                keys_per_master[i], client_id, segment_name);
+            if (!result) {
+                return result;
+            }
+            cleared.insert(cleared.end(), result->begin(), result->end());
+        }
+        return cleared;
+    }
     auto result = invoke_rpc<&WrappedMasterService::BatchReplicaClear,
                              std::vector<std::string>>(object_keys, client_id,
                                                        segment_name);
@@ -399,6 +800,21 @@ MasterClient::GetReplicaListByRegex(const std::string& str) {
     ScopedVLogTimer timer(1, "MasterClient::GetReplicaListByRegex");
     timer.LogRequest("Regex=", str);
 
+    if (auto partitions = GetPartitions()) {
+        std::unordered_map<std::string, std::vector<Replica::Descriptor>>
+            merged;
+        for (auto& result : ForEachMaster(
+                 *partitions, [&](MasterClient& master) {
+                     return master.GetReplicaListByRegex(str);
+                 })) {
+            if (!result) {
+                return result;
+            }
+            merged.merge(result.value());
+        }
+        return merged;
+    }
+
     auto result = invoke_rpc<
         &WrappedMasterService::GetReplicaListByRegex,
         std::unordered_map<std::string, std::vector<Replica::Descriptor>>>(str);
@@ -412,8 +828,15 @@ tl::expected<GetReplicaListResponse, ErrorCode> MasterClient::GetReplicaList(
     ScopedVLogTimer timer(1, "MasterClient::GetReplicaList");
     timer.LogRequest("object_key=", object_key);
 
-    auto result = invoke_rpc<&WrappedMasterService::GetReplicaList,
-                             GetReplicaListResponse>(object_key);
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(object_key).GetReplicaList(object_key);
+    }
+
+    auto result =
+        get_replica_list_coalescer_
+            ? get_replica_list_coalescer_->Call(object_key)
+            : invoke_rpc<&WrappedMasterService::GetReplicaList,
+                         GetReplicaListResponse>(object_key);
     timer.LogResponseExpected(result);
     return result;
 }
@@ -423,9 +846,29 @@ MasterClient::BatchGetReplicaList(const std::vector<std::string>& object_keys) {
     ScopedVLogTimer timer(1, "MasterClient::BatchGetReplicaList");
     timer.LogRequest("keys_count=", object_keys.size());
 
-    auto result = invoke_batch_rpc<&WrappedMasterService::BatchGetReplicaList,
-                                   GetReplicaListResponse>(object_keys.size(),
-                                                           object_keys);
+    if (auto partitions = GetPartitions()) {
+        return PartitionBatch<GetReplicaListResponse>(
+            *partitions, object_keys,
+            [&](MasterClient& master, const std::vector<size_t>& indices) {
+                return master.BatchGetReplicaList(Pick(object_keys, indices));
+            });
+    }
+
+    // The flat encoding is decoded with one allocation per array rather
+    // than per key, replica and string
+    std::vector<tl::expected<GetReplicaListResponse, ErrorCode>> result;
+    auto flat = invoke_rpc<&WrappedMasterService::BatchGetReplicaListFlat,
+                           FlatReplicaLists>(object_keys);
+    if (!flat.has_value()) {
+        result.assign(object_keys.size(), tl::make_unexpected(flat.error()));
+    } else if (flat->num_keys() != object_keys.size()) {
+        LOG(ERROR) << "BatchGetReplicaListFlat returned " << flat->num_keys()
+                   << " results for " << object_keys.size() << " keys";
+        result.assign(object_keys.size(),
+                      tl::make_unexpected(ErrorCode::RPC_FAIL));
+    } else {
+        result = DecodeReplicaLists(flat.value());
+    }
     timer.LogResponse("result=", result.size(), " operations");
     return result;
 }
@@ -437,6 +880,10 @@ MasterClient::PutStart(const std::string& key,
     ScopedVLogTimer timer(1, "MasterClient::PutStart");
     timer.LogRequest("key=", key, ", slice_count=", slice_lengths.size());
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).PutStart(key, slice_lengths, config);
+    }
+
     uint64_t total_slice_length = 0;
     for (const auto& slice_length : slice_lengths) {
         total_slice_length += slice_length;
@@ -457,6 +904,16 @@ MasterClient::BatchPutStart(
     ScopedVLogTimer timer(1, "MasterClient::BatchPutStart");
     timer.LogRequest("keys_count=", keys.size());
 
+    if (auto partitions = GetPartitions()) {
+        return PartitionBatch<std::vector<Replica::Descriptor>>(
+            *partitions, keys,
+            [&](MasterClient& master, const std::vector<size_t>& indices) {
+                return master.BatchPutStart(Pick(keys, indices),
+                                            Pick(slice_lengths, indices),
+                                            config);
+            });
+    }
+
     std::vector<uint64_t> total_slice_lengths;
     total_slice_lengths.reserve(slice_lengths.size());
     for (const auto& slice_lengths : slice_lengths) {
@@ -474,24 +931,45 @@ MasterClient::BatchPutStart(
     return result;
 }
 
-tl::expected<void, ErrorCode> MasterClient::PutEnd(const std::string& key,
-                                                   ReplicaType replica_type) {
+tl::expected<void, ErrorCode> MasterClient::PutEnd(
+    const std::string& key, ReplicaType replica_type,
+    std::optional<uint32_t> checksum) {
     ScopedVLogTimer timer(1, "MasterClient::PutEnd");
     timer.LogRequest("key=", key);
 
-    auto result = invoke_rpc<&WrappedMasterService::PutEnd, void>(
-        client_id_, key, replica_type);
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).PutEnd(key, replica_type, checksum);
+    }
+
+    // BatchPutEnd only ends memory replicas, and coalesced calls carry no
+    // checksum
+    const bool coalesce = put_end_coalescer_ &&
+                          replica_type == ReplicaType::MEMORY && !checksum;
+    auto result = coalesce ? put_end_coalescer_->Call(key)
+                           : invoke_rpc<&WrappedMasterService::PutEnd, void>(
+                                 client_id_, key, replica_type, checksum);
     timer.LogResponseExpected(result);
     return result;
 }
 
 std::vector<tl::expected<void, ErrorCode>> MasterClient::BatchPutEnd(
-    const std::vector<std::string>& keys) {
+    const std::vector<std::string>& keys,
+    const std::vector<uint32_t>& checksums) {
     ScopedVLogTimer timer(1, "MasterClient::BatchPutEnd");
     timer.LogRequest("keys_count=", keys.size());
 
+    if (auto partitions = GetPartitions()) {
+        return PartitionBatch<void>(
+            *partitions, keys,
+            [&](MasterClient& master, const std::vector<size_t>& indices) {
+                return master.BatchPutEnd(
+                    Pick(keys, indices),
+                    checksums.empty() ? checksums : Pick(checksums, indices));
+            });
+    }
+
     auto result = invoke_batch_rpc<&WrappedMasterService::BatchPutEnd, void>(
-        keys.size(), client_id_, keys);
+        keys.size(), client_id_, keys, checksums);
     timer.LogResponse("result=", result.size(), " operations");
     return result;
 }
@@ -501,28 +979,135 @@ tl::expected<void, ErrorCode> MasterClient::PutRevoke(
     ScopedVLogTimer timer(1, "MasterClient::PutRevoke");
     timer.LogRequest("key=", key);
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).PutRevoke(key, replica_type);
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::PutRevoke, void>(
         client_id_, key, replica_type);
     timer.LogResponseExpected(result);
     return result;
 }
 
+tl::expected<std::vector<Replica::Descriptor>, ErrorCode>
+MasterClient::StreamPutStart(const std::string& key,
+                             const std::vector<uint64_t>& chunk_lengths,
+                             const ReplicateConfig& config) {
+    ScopedVLogTimer timer(1, "MasterClient::StreamPutStart");
+    timer.LogRequest("key=", key, ", chunk_count=", chunk_lengths.size());
+
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).StreamPutStart(key, chunk_lengths,
+                                                       config);
+    }
+
+    auto result = invoke_rpc<&WrappedMasterService::StreamPutStart,
+                             std::vector<Replica::Descriptor>>(
+        client_id_, key, chunk_lengths, config);
+    timer.LogResponseExpected(result);
+    return result;
+}
+
+tl::expected<void, ErrorCode> MasterClient::StreamPutCommit(
+    const std::string& key, uint64_t first_chunk, uint64_t num_chunks) {
+    ScopedVLogTimer timer(1, "MasterClient::StreamPutCommit");
+    timer.LogRequest("key=", key, ", first_chunk=", first_chunk,
+                     ", num_chunks=", num_chunks);
+
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).StreamPutCommit(key, first_chunk,
+                                                        num_chunks);
+    }
+
+    auto result = invoke_rpc<&WrappedMasterService::StreamPutCommit, void>(
+        client_id_, key, first_chunk, num_chunks);
+    timer.LogResponseExpected(result);
+    return result;
+}
+
+tl::expected<GetStreamReplicaListResponse, ErrorCode>
+MasterClient::GetStreamReplicaList(const std::string& object_key) {
+    ScopedVLogTimer timer(1, "MasterClient::GetStreamReplicaList");
+    timer.LogRequest("object_key=", object_key);
+
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(object_key).GetStreamReplicaList(object_key);
+    }
+
+    auto result = invoke_rpc<&WrappedMasterService::GetStreamReplicaList,
+                             GetStreamReplicaListResponse>(object_key);
+    timer.LogResponseExpected(result);
+    return result;
+}
+
 std::vector<tl::expected<void, ErrorCode>> MasterClient::BatchPutRevoke(
     const std::vector<std::string>& keys) {
     ScopedVLogTimer timer(1, "MasterClient::BatchPutRevoke");
     timer.LogRequest("keys_count=", keys.size());
 
+    if (auto partitions = GetPartitions()) {
+        return PartitionBatch<void>(
+            *partitions, keys,
+            [&](MasterClient& master, const std::vector<size_t>& indices) {
+                return master.BatchPutRevoke(Pick(keys, indices));
+            });
+    }
+
     auto result = invoke_batch_rpc<&WrappedMasterService::BatchPutRevoke, void>(
         keys.size(), client_id_, keys);
     timer.LogResponse("result=", result.size(), " operations");
     return result;
 }
 
+tl::expected<PutLease, ErrorCode> MasterClient::GrantPutLease(
+    uint64_t slice_length, uint64_t slot_count, const ReplicateConfig& config) {
+    ScopedVLogTimer timer(1, "MasterClient::GrantPutLease");
+    timer.LogRequest("slice_length=", slice_length,
+                     ", slot_count=", slot_count);
+
+    // A lease is granted for keys not known yet, so not by their owner
+    if (GetPartitions()) {
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_MODE);
+    }
+
+    auto result = invoke_rpc<&WrappedMasterService::GrantPutLease, PutLease>(
+        client_id_, slice_length, slot_count, config);
+    timer.LogResponseExpected(result);
+    return result;
+}
+
+std::vector<tl::expected<void, ErrorCode>> MasterClient::BatchLeasedPutEnd(
+    const std::vector<LeasedPut>& puts) {
+    ScopedVLogTimer timer(1, "MasterClient::BatchLeasedPutEnd");
+    timer.LogRequest("keys_count=", puts.size());
+
+    auto result =
+        invoke_batch_rpc<&WrappedMasterService::BatchLeasedPutEnd, void>(
+            puts.size(), client_id_, puts);
+    timer.LogResponse("result=", result.size(), " operations");
+    return result;
+}
+
+tl::expected<void, ErrorCode> MasterClient::ReleasePutLease(
+    uint64_t lease_id) {
+    ScopedVLogTimer timer(1, "MasterClient::ReleasePutLease");
+    timer.LogRequest("lease_id=", lease_id);
+
+    auto result = invoke_rpc<&WrappedMasterService::ReleasePutLease, void>(
+        client_id_, lease_id);
+    timer.LogResponseExpected(result);
+    return result;
+}
+
 tl::expected<void, ErrorCode> MasterClient::Remove(const std::string& key,
                                                    bool force) {
     ScopedVLogTimer timer(1, "MasterClient::Remove");
     timer.LogRequest("key=", key, ", force=", force);
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).Remove(key, force);
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::Remove, void>(key, force);
     timer.LogResponseExpected(result);
     return result;
@@ -533,6 +1118,20 @@ tl::expected<long, ErrorCode> MasterClient::RemoveByRegex(
     ScopedVLogTimer timer(1, "MasterClient::RemoveByRegex");
     timer.LogRequest("key=", str, ", force=", force);
 
+    if (auto partitions = GetPartitions()) {
+        long removed = 0;
+        for (auto& result :
+             ForEachMaster(*partitions, [&](MasterClient& master) {
+                 return master.RemoveByRegex(str, force);
+             })) {
+            if (!result) {
+                return result;
+            }
+            removed += result.value();
+        }
+        return removed;
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::RemoveByRegex, long>(str, force);
     timer.LogResponseExpected(result);
@@ -543,6 +1142,20 @@ tl::expected<long, ErrorCode> MasterClient::RemoveAll(bool force) {
     ScopedVLogTimer timer(1, "MasterClient::RemoveAll");
     timer.LogRequest("action=remove_all_objects, force=", force);
 
+    if (auto partitions = GetPartitions()) {
+        long removed = 0;
+        for (auto& result :
+             ForEachMaster(*partitions, [&](MasterClient& master) {
+                 return master.RemoveAll(force);
+             })) {
+            if (!result) {
+                return result;
+            }
+            removed += result.value();
+        }
+        return removed;
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::RemoveAll, long>(force);
     timer.LogResponseExpected(result);
     return result;
@@ -555,6 +1168,24 @@ tl::expected<void, ErrorCode> MasterClient::MountSegment(
                      ", name=", segment.name, ", id=", segment.id,
                      ", client_id=", client_id_);
 
+    if (GetPartitions()) {
+        std::lock_guard<std::mutex> lock(partition_segments_mutex_);
+        auto partitions = GetPartitions();
+        auto slices_per_master = SlicesPerMaster(*partitions, segment);
+        for (size_t i = 0; i < slices_per_master.size(); ++i) {
+            for (const auto& slice : slices_per_master[i]) {
+                auto result = partitions->masters[i]->MountSegment(slice);
+                if (!result &&
+                    result.error() != ErrorCode::SEGMENT_ALREADY_EXISTS) {
+                    timer.LogResponseExpected(result);
+                    return result;
+                }
+            }
+        }
+        partition_segments_[segment.id] = segment;
+        return {};
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::MountSegment, void>(
         segment, client_id_);
     timer.LogResponseExpected(result);
@@ -567,6 +1198,32 @@ tl::expected<void, ErrorCode> MasterClient::ReMountSegment(
     timer.LogRequest("segments_num=", segments.size(),
                      ", client_id=", client_id_);
 
+    if (GetPartitions()) {
+        std::lock_guard<std::mutex> lock(partition_segments_mutex_);
+        auto partitions = GetPartitions();
+        std::vector<std::vector<Segment>> slices_per_master(
+            partitions->masters.size());
+        for (const auto& segment : segments) {
+            auto slices = SlicesPerMaster(*partitions, segment);
+            for (size_t i = 0; i < slices.size(); ++i) {
+                slices_per_master[i].insert(slices_per_master[i].end(),
+                                            slices[i].begin(),
+                                            slices[i].end());
+            }
+            partition_segments_[segment.id] = segment;
+        }
+        tl::expected<void, ErrorCode> remounted;
+        for (size_t i = 0; i < slices_per_master.size(); ++i) {
+            auto result =
+                partitions->masters[i]->ReMountSegment(slices_per_master[i]);
+            if (!result && remounted) {
+                remounted = result;
+            }
+        }
+        timer.LogResponseExpected(remounted);
+        return remounted;
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::ReMountSegment, void>(
         segments, client_id_);
     timer.LogResponseExpected(result);
@@ -578,26 +1235,136 @@ tl::expected<void, ErrorCode> MasterClient::UnmountSegment(
     ScopedVLogTimer timer(1, "MasterClient::UnmountSegment");
     timer.LogRequest("segment_id=", segment_id, ", client_id=", client_id_);
 
+    if (GetPartitions()) {
+        std::lock_guard<std::mutex> lock(partition_segments_mutex_);
+        auto partitions = GetPartitions();
+        auto it = partition_segments_.find(segment_id);
+        if (it == partition_segments_.end()) {
+            LOG(ERROR) << "segment_id=" << segment_id
+                       << ", error=segment_not_mounted";
+            return tl::make_unexpected(ErrorCode::SEGMENT_NOT_FOUND);
+        }
+        auto slices_per_master = SlicesPerMaster(*partitions, it->second);
+        tl::expected<void, ErrorCode> unmounted;
+        for (size_t i = 0; i < slices_per_master.size(); ++i) {
+            for (const auto& slice : slices_per_master[i]) {
+                auto result = partitions->masters[i]->UnmountSegment(slice.id);
+                if (!result && unmounted) {
+                    unmounted = result;
+                }
+            }
+        }
+        partition_segments_.erase(it);
+        timer.LogResponseExpected(unmounted);
+        return unmounted;
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::UnmountSegment, void>(
         segment_id, client_id_);
     timer.LogResponseExpected(result);
     return result;
 }
 
-tl::expected<PingResponse, ErrorCode> MasterClient::Ping() {
+tl::expected<PingResponse, ErrorCode> MasterClient::Ping(
+    const ClientLoadReport& load_report) {
     ScopedVLogTimer timer(1, "MasterClient::Ping");
-    timer.LogRequest("client_id=", client_id_);
+    timer.LogRequest("client_id=", client_id_,
+                     ", traffic_endpoints=", load_report.traffic.size());
+
+    // Fails if any master fails, and asks for a remount if any does. Each
+    // master keeps its own put sequence id.
+    if (auto partitions = GetPartitions()) {
+        auto results = ForEachMaster(*partitions, [&](MasterClient& master) {
+            return master.Ping(load_report);
+        });
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (!results[i]) {
+                return results[i];
+            }
+            if (i == 0) {
+                continue;
+            }
+            if (results[i]->client_status == ClientStatus::NEED_REMOUNT) {
+                results[0]->client_status = ClientStatus::NEED_REMOUNT;
+            }
+            results[0]->put_key_hashes.insert(
+                results[0]->put_key_hashes.end(),
+                results[i]->put_key_hashes.begin(),
+                results[i]->put_key_hashes.end());
+            results[0]->put_keys_truncated |= results[i]->put_keys_truncated;
+        }
+        return results[0];
+    }
 
-    auto result =
-        invoke_rpc<&WrappedMasterService::Ping, PingResponse>(client_id_);
+    std::optional<uint64_t> put_sequence_id;
+    if (watch_puts_) {
+        put_sequence_id = put_sequence_id_.load();
+    }
+    auto result = invoke_rpc<&WrappedMasterService::Ping, PingResponse>(
+        client_id_, load_report, put_sequence_id);
+    if (result && put_sequence_id) {
+        put_sequence_id_ = result->put_sequence_id;
+    }
     timer.LogResponseExpected(result);
     return result;
 }
 
+tl::expected<BatchPingResponse, ErrorCode> MasterClient::AggregatedPing(
+    PingAggregator& aggregator, const ClientLoadReport& load_report,
+    size_t task_batch_size) {
+    ScopedVLogTimer timer(1, "MasterClient::AggregatedPing");
+    timer.LogRequest("client_id=", client_id_,
+                     ", traffic_endpoints=", load_report.traffic.size(),
+                     ", task_batch_size=", task_batch_size);
+
+    BatchPingRequest request;
+    request.client_id = client_id_;
+    request.load_report = load_report;
+    if (watch_puts_) {
+        request.put_sequence_id = put_sequence_id_.load();
+    }
+    request.task_batch_size = task_batch_size;
+    auto result = aggregator.Ping(std::move(request));
+    if (result && watch_puts_) {
+        put_sequence_id_ = result->ping.put_sequence_id;
+    }
+    if (result) {
+        timer.LogResponse("tasks=", result->tasks.size());
+    } else {
+        timer.LogResponse("error_code=", result.error());
+    }
+    return result;
+}
+
+std::vector<tl::expected<BatchPingResponse, ErrorCode>>
+MasterClient::BatchPing(const std::vector<BatchPingRequest>& requests) {
+    ScopedVLogTimer timer(1, "MasterClient::BatchPing");
+    timer.LogRequest("clients_count=", requests.size());
+
+    auto result =
+        invoke_batch_rpc<&WrappedMasterService::BatchPing, BatchPingResponse>(
+            requests.size(), requests);
+    timer.LogResponse("result=", result.size(), " clients");
+    return result;
+}
+
+void MasterClient::WatchPuts(bool watch) {
+    watch_puts_ = watch;
+    if (auto partitions = GetPartitions()) {
+        for (const auto& master : partitions->masters) {
+            master->WatchPuts(watch);
+        }
+    }
+}
+
 tl::expected<std::string, ErrorCode> MasterClient::GetFsdir() {
     ScopedVLogTimer timer(1, "MasterClient::GetFsdir");
     timer.LogRequest("action=get_fsdir");
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->masters[0]->GetFsdir();
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::GetFsdir, std::string>();
     timer.LogResponseExpected(result);
     return result;
@@ -608,6 +1375,10 @@ MasterClient::GetStorageConfig() {
     ScopedVLogTimer timer(1, "MasterClient::GetStorageConfig");
     timer.LogRequest("action=get_storage_config");
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->masters[0]->GetStorageConfig();
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::GetStorageConfig,
                              GetStorageConfigResponse>();
     timer.LogResponseExpected(result);
@@ -620,6 +1391,19 @@ tl::expected<void, ErrorCode> MasterClient::MountLocalDiskSegment(
     timer.LogRequest("client_id=", client_id,
                      ", enable_offloading=", enable_offloading);
 
+    if (auto partitions = GetPartitions()) {
+        for (auto& result :
+             ForEachMaster(*partitions, [&](MasterClient& master) {
+                 return master.MountLocalDiskSegment(client_id,
+                                                     enable_offloading);
+             })) {
+            if (!result) {
+                return result;
+            }
+        }
+        return {};
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::MountLocalDiskSegment, void>(
             client_id, enable_offloading);
@@ -632,6 +1416,10 @@ tl::expected<UUID, ErrorCode> MasterClient::CreateCopyTask(
     ScopedVLogTimer timer(1, "MasterClient::CreateCopyTask");
     timer.LogRequest("key=", key, ", targets_size=", targets.size());
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).CreateCopyTask(key, targets);
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::CreateCopyTask, UUID>(key, targets);
     timer.LogResponseExpected(result);
@@ -644,6 +1432,10 @@ tl::expected<UUID, ErrorCode> MasterClient::CreateMoveTask(
     ScopedVLogTimer timer(1, "MasterClient::CreateMoveTask");
     timer.LogRequest("key=", key, ", source=", source, ", target=", target);
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).CreateMoveTask(key, source, target);
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::CreateMoveTask, UUID>(
         key, source, target);
     timer.LogResponseExpected(result);
@@ -657,6 +1449,21 @@ MasterClient::OffloadObjectHeartbeat(const UUID& client_id,
     timer.LogRequest("client_id=", client_id,
                      ", enable_offloading=", enable_offloading);
 
+    if (auto partitions = GetPartitions()) {
+        std::unordered_map<std::string, int64_t> merged;
+        for (auto& result :
+             ForEachMaster(*partitions, [&](MasterClient& master) {
+                 return master.OffloadObjectHeartbeat(client_id,
+                                                      enable_offloading);
+             })) {
+            if (!result) {
+                return result;
+            }
+            merged.merge(result.value());
+        }
+        return merged;
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::OffloadObjectHeartbeat,
                              std::unordered_map<std::string, int64_t>>(
         client_id, enable_offloading);
@@ -670,6 +1477,25 @@ tl::expected<void, ErrorCode> MasterClient::NotifyOffloadSuccess(
     timer.LogRequest("client_id=", client_id, ", keys_count=", keys.size(),
                      ", metadatas_count=", metadatas.size());
 
+    if (auto partitions = GetPartitions()) {
+        std::vector<std::vector<size_t>> indices(partitions->masters.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            indices[partitions->ring.OwnerOf(keys[i])].push_back(i);
+        }
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].empty()) {
+                continue;
+            }
+            auto result = partitions->masters[i]->NotifyOffloadSuccess(
+                client_id, Pick(keys, indices[i]),
+                Pick(metadatas, indices[i]));
+            if (!result) {
+                return result;
+            }
+        }
+        return {};
+    }
+
     auto result = invoke_rpc<&WrappedMasterService::NotifyOffloadSuccess, void>(
         client_id, keys, metadatas);
     timer.LogResponseExpected(result);
@@ -683,6 +1509,11 @@ tl::expected<CopyStartResponse, ErrorCode> MasterClient::CopyStart(
     timer.LogRequest("key=", key, ", src_segment=", src_segment,
                      ", tgt_segments_count=", tgt_segments.size());
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).CopyStart(key, src_segment,
+                                                  tgt_segments);
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::CopyStart, CopyStartResponse>(
             client_id_, key, src_segment, tgt_segments);
@@ -695,6 +1526,24 @@ tl::expected<QueryTaskResponse, ErrorCode> MasterClient::QueryTask(
     ScopedVLogTimer timer(1, "MasterClient::QueryTask");
     timer.LogRequest("task_id=", task_id);
 
+    // Tasks are created by the owner of their key, which is not known here
+    if (auto partitions = GetPartitions()) {
+        tl::expected<QueryTaskResponse, ErrorCode> found =
+            tl::make_unexpected(ErrorCode::TASK_NOT_FOUND);
+        for (auto& result :
+             ForEachMaster(*partitions, [&](MasterClient& master) {
+                 return master.QueryTask(task_id);
+             })) {
+            if (result || result.error() != ErrorCode::TASK_NOT_FOUND) {
+                found = std::move(result);
+                if (found) {
+                    break;
+                }
+            }
+        }
+        return found;
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::QueryTask, QueryTaskResponse>(
             task_id);
@@ -706,6 +1555,10 @@ tl::expected<void, ErrorCode> MasterClient::CopyEnd(const std::string& key) {
     ScopedVLogTimer timer(1, "MasterClient::CopyEnd");
     timer.LogRequest("key=", key);
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).CopyEnd(key);
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::CopyEnd, void>(client_id_, key);
     timer.LogResponseExpected(result);
@@ -716,6 +1569,23 @@ tl::expected<std::vector<TaskAssignment>, ErrorCode> MasterClient::FetchTasks(
     size_t batch_size) {
     ScopedVLogTimer timer(1, "MasterClient::FetchTasks");
     timer.LogRequest("client_id=", client_id_, ", batch_size=", batch_size);
+    if (auto partitions = GetPartitions()) {
+        std::vector<TaskAssignment> tasks;
+        auto results = ForEachMaster(*partitions, [&](MasterClient& master) {
+            return master.FetchTasks(batch_size);
+        });
+        std::lock_guard<std::mutex> lock(partition_tasks_mutex_);
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (!results[i]) {
+                continue;
+            }
+            for (auto& task : results[i].value()) {
+                partition_tasks_[task.id] = partitions->masters[i];
+                tasks.push_back(std::move(task));
+            }
+        }
+        return tasks;
+    }
     auto result =
         invoke_rpc<&WrappedMasterService::FetchTasks,
                    std::vector<TaskAssignment>>(client_id_, batch_size);
@@ -723,10 +1593,27 @@ tl::expected<std::vector<TaskAssignment>, ErrorCode> MasterClient::FetchTasks(
     return result;
 }
 
+tl::expected<std::vector<TaskAssignment>, ErrorCode> MasterClient::WaitTasks(
+    size_t batch_size, uint64_t wait_ms) {
+    ScopedVLogTimer timer(1, "MasterClient::WaitTasks");
+    timer.LogRequest("client_id=", client_id_, ", batch_size=", batch_size,
+                     ", wait_ms=", wait_ms);
+    auto result =
+        invoke_rpc<&WrappedMasterService::WaitTasks,
+                   std::vector<TaskAssignment>>(client_id_, batch_size,
+                                                wait_ms);
+    timer.LogResponseExpected(result);
+    return result;
+}
+
 tl::expected<void, ErrorCode> MasterClient::CopyRevoke(const std::string& key) {
     ScopedVLogTimer timer(1, "MasterClient::CopyRevoke");
     timer.LogRequest("key=", key);
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).CopyRevoke(key);
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::CopyRevoke, void>(client_id_, key);
     timer.LogResponseExpected(result);
@@ -740,6 +1627,11 @@ tl::expected<MoveStartResponse, ErrorCode> MasterClient::MoveStart(
     timer.LogRequest("key=", key, ", src_segment=", src_segment,
                      ", tgt_segment=", tgt_segment);
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).MoveStart(key, src_segment,
+                                                  tgt_segment);
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::MoveStart, MoveStartResponse>(
             client_id_, key, src_segment, tgt_segment);
@@ -751,6 +1643,10 @@ tl::expected<void, ErrorCode> MasterClient::MoveEnd(const std::string& key) {
     ScopedVLogTimer timer(1, "MasterClient::MoveEnd");
     timer.LogRequest("key=", key);
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).MoveEnd(key);
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::MoveEnd, void>(client_id_, key);
     timer.LogResponseExpected(result);
@@ -761,6 +1657,10 @@ tl::expected<void, ErrorCode> MasterClient::MoveRevoke(const std::string& key) {
     ScopedVLogTimer timer(1, "MasterClient::MoveRevoke");
     timer.LogRequest("key=", key);
 
+    if (auto partitions = GetPartitions()) {
+        return partitions->OwnerOf(key).MoveRevoke(key);
+    }
+
     auto result =
         invoke_rpc<&WrappedMasterService::MoveRevoke, void>(client_id_, key);
     timer.LogResponseExpected(result);
@@ -771,6 +1671,21 @@ tl::expected<void, ErrorCode> MasterClient::MarkTaskToComplete(
     const TaskCompleteRequest& task_update) {
     ScopedVLogTimer timer(1, "MasterClient::MarkTaskToComplete");
     timer.LogRequest("client_id=", client_id_, ", task_id=", task_update.id);
+    if (GetPartitions()) {
+        std::shared_ptr<MasterClient> master;
+        {
+            std::lock_guard<std::mutex> lock(partition_tasks_mutex_);
+            auto it = partition_tasks_.find(task_update.id);
+            if (it == partition_tasks_.end()) {
+                LOG(ERROR) << "task_id=" << task_update.id
+                           << ", error=task_not_fetched";
+                return tl::make_unexpected(ErrorCode::TASK_NOT_FOUND);
+            }
+            master = std::move(it->second);
+            partition_tasks_.erase(it);
+        }
+        return master->MarkTaskToComplete(task_update);
+    }
     auto result = invoke_rpc<&WrappedMasterService::MarkTaskToComplete, void>(
         client_id_, task_update);
     timer.LogResponseExpected(result);
@@ -223,6 +223,9 @@ MasterMetricManager::MasterMetricManager()
                           "Total number of cache hits in the memory pool"),
       file_cache_hit_nums_("file_cache_hit_nums_",
                            "Total number of cache hits in the ssd"),
+      local_disk_cache_hit_nums_(
+          "local_disk_cache_hit_nums_",
+          "Total number of cache hits in the local disk of clients"),
       mem_cache_nums_("mem_cache_nums_",
                       "Total number of cached values in the memory pool"),
       file_cache_nums_("file_cache_nums_",
@@ -240,6 +243,65 @@ MasterMetricManager::MasterMetricManager()
                          "Total number of keys evicted"),
       evicted_size_("master_evicted_size_bytes",
                     "Total bytes of evicted objects"),
+      // (100us, 1ms, 10ms, 100ms, 1s, 10s)
+      eviction_pass_latency_us_(
+          "master_eviction_pass_latency_us",
+          "Distribution of eviction pass latency in microseconds",
+          {100, 1000, 10000, 100000, 1000000, 10000000}),
+      eviction_pass_size_("master_eviction_pass_size",
+                          "Distribution of keys evicted per eviction pass",
+                          {1, 16, 256, 4096, 65536, 1048576}),
+      ttl_expired_keys_("master_ttl_expired_keys_total",
+                        "Total number of objects removed when their TTL ran "
+                        "out"),
+      ttl_expired_size_("master_ttl_expired_size_bytes",
+                        "Total bytes of objects removed when their TTL ran "
+                        "out"),
+
+      // (10us, 50us, 100us, 500us, 1ms, 5ms, 10ms, 50ms, 100ms, 1s)
+      rpc_latency_us_("master_rpc_latency_us",
+                      "Distribution of RPC latency in microseconds",
+                      {10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000,
+                       1000000},
+                      {"rpc"}),
+      // (1us, 10us, 100us, 1ms, 10ms, 100ms)
+      shard_lock_wait_us_(
+          "master_shard_lock_wait_us",
+          "Distribution of the time contended metadata shard lock "
+          "acquisitions waited, in microseconds",
+          {1, 10, 100, 1000, 10000, 100000}),
+
+      // Initialize Tenant Metrics
+      tenant_quota_("master_tenant_quota_bytes",
+                    "Memory quota of the tenant", {"tenant"}),
+      tenant_mem_size_("master_tenant_allocated_bytes",
+                       "Memory bytes currently held by the objects of the "
+                       "tenant",
+                       {"tenant"}),
+      tenant_get_hits_("master_tenant_get_hits_total",
+                       "Total number of reads of the tenant served from "
+                       "memory",
+                       {"tenant"}),
+      tenant_get_misses_("master_tenant_get_misses_total",
+                         "Total number of reads of the tenant that found no "
+                         "memory replica",
+                         {"tenant"}),
+
+      // Initialize Tiering Counters
+      tiering_demotions_(
+          "master_tiering_demotions_total",
+          "Total number of eviction victims demoted to the local disk"),
+      tiering_promotions_(
+          "master_tiering_promotions_total",
+          "Total number of disk reads asked to promote objects to memory"),
+
+      // Initialize Deduplication Counters
+      dedup_hits_("master_dedup_hits_total",
+                  "Total number of puts that shared the replicas of stored "
+                  "content"),
+      dedup_saved_bytes_("master_dedup_saved_bytes_total",
+                         "Total bytes not allocated nor transferred thanks to "
+                         "deduplicated puts"),
 
       // Initialize Discarded Replicas Counters
       put_start_discard_cnt_("master_put_start_discard_cnt",
@@ -416,6 +478,7 @@ void MasterMetricManager::update_metrics_for_zero_output() {
     // Update cache hit rate metrics
     mem_cache_hit_nums_.inc(0);
     file_cache_hit_nums_.inc(0);
+    local_disk_cache_hit_nums_.inc(0);
     valid_get_nums_.inc(0);
     total_get_nums_.inc(0);
 
@@ -424,6 +487,21 @@ void MasterMetricManager::update_metrics_for_zero_output() {
     eviction_attempts_.inc(0);
     evicted_key_count_.inc(0);
     evicted_size_.inc(0);
+    eviction_pass_latency_us_.observe(0);
+    eviction_pass_size_.observe(0);
+    ttl_expired_keys_.inc(0);
+    ttl_expired_size_.inc(0);
+
+    // Update RPC Latency Metrics
+    shard_lock_wait_us_.observe(0);
+
+    // Update Tiering Counters
+    tiering_demotions_.inc(0);
+    tiering_promotions_.inc(0);
+
+    // Update Deduplication Counters
+    dedup_hits_.inc(0);
+    dedup_saved_bytes_.inc(0);
 
     // Update PutStart Discard Metrics
     put_start_discard_cnt_.inc(0);
@@ -435,7 +513,8 @@ void MasterMetricManager::update_metrics_for_zero_output() {
     // Note: dynamic_gauge_1t (mem_allocated_size_per_segment_ and
     // mem_total_capacity_per_segment_) are not initialized here because they
     // require label values. They will be initialized when first used with
-    // actual segment names.
+    // actual segment names. The same goes for rpc_latency_us_ and RPC names,
+    // and for the tenant metrics and tenant names.
 }
 
 // Memory Storage Metrics
@@ -581,6 +660,9 @@ void MasterMetricManager::inc_mem_cache_hit_nums(int64_t val) {
 void MasterMetricManager::inc_file_cache_hit_nums(int64_t val) {
     file_cache_hit_nums_.inc(val);
 }
+void MasterMetricManager::inc_local_disk_cache_hit_nums(int64_t val) {
+    local_disk_cache_hit_nums_.inc(val);
+}
 void MasterMetricManager::inc_mem_cache_nums(int64_t val) {
     mem_cache_nums_.inc(val);
 }
@@ -1043,6 +1125,54 @@ void MasterMetricManager::inc_eviction_success(int64_t key_count,
 
 void MasterMetricManager::inc_eviction_fail() { eviction_attempts_.inc(); }
 
+void MasterMetricManager::observe_eviction_pass(int64_t latency_us,
+                                                int64_t evicted_keys) {
+    eviction_pass_latency_us_.observe(latency_us);
+    eviction_pass_size_.observe(evicted_keys);
+}
+
+// RPC Latency Metrics
+void MasterMetricManager::observe_rpc_latency(const std::string& rpc,
+                                              int64_t latency_us) {
+    rpc_latency_us_.observe({rpc}, latency_us);
+}
+
+void MasterMetricManager::observe_shard_lock_wait(int64_t wait_us) {
+    shard_lock_wait_us_.observe(wait_us);
+}
+
+// Tenant Metrics
+void MasterMetricManager::set_tenant_quota(const std::string& tenant,
+                                           int64_t bytes) {
+    tenant_quota_.update({tenant}, bytes);
+}
+
+void MasterMetricManager::inc_tenant_mem_size(const std::string& tenant,
+                                              int64_t val) {
+    tenant_mem_size_.inc({tenant}, val);
+}
+
+void MasterMetricManager::dec_tenant_mem_size(const std::string& tenant,
+                                              int64_t val) {
+    tenant_mem_size_.dec({tenant}, val);
+}
+
+void MasterMetricManager::inc_tenant_get_hits(const std::string& tenant) {
+    tenant_get_hits_.inc({tenant});
+}
+
+void MasterMetricManager::inc_tenant_get_misses(const std::string& tenant) {
+    tenant_get_misses_.inc({tenant});
+}
+
+int64_t MasterMetricManager::get_tenant_get_hits(const std::string& tenant) {
+    return tenant_get_hits_.value({tenant});
+}
+
+int64_t MasterMetricManager::get_tenant_get_misses(const std::string& tenant) {
+    return tenant_get_misses_.value({tenant});
+}
+
 int64_t MasterMetricManager::get_eviction_success() {
     return eviction_success_.value();
 }
@@ -1059,6 +1189,44 @@ int64_t MasterMetricManager::get_evicted_size() {
     return evicted_size_.value();
 }
 
+void MasterMetricManager::inc_ttl_expired(int64_t size) {
+    ttl_expired_keys_.inc();
+    ttl_expired_size_.inc(size);
+}
+
+int64_t MasterMetricManager::get_ttl_expired_keys() {
+    return ttl_expired_keys_.value();
+}
+
+// Tiering Metrics
+void MasterMetricManager::inc_tiering_demotions(int64_t val) {
+    tiering_demotions_.inc(val);
+}
+
+void MasterMetricManager::inc_tiering_promotions(int64_t val) {
+    tiering_promotions_.inc(val);
+}
+
+int64_t MasterMetricManager::get_tiering_demotions() {
+    return tiering_demotions_.value();
+}
+
+int64_t MasterMetricManager::get_tiering_promotions() {
+    return tiering_promotions_.value();
+}
+
+// Deduplication Metrics
+void MasterMetricManager::inc_dedup_hits(int64_t saved_bytes) {
+    dedup_hits_.inc();
+    dedup_saved_bytes_.inc(saved_bytes);
+}
+
+int64_t MasterMetricManager::get_dedup_hits() { return dedup_hits_.value(); }
+
+int64_t MasterMetricManager::get_dedup_saved_bytes() {
+    return dedup_saved_bytes_.value();
+}
+
 // PutStart Discard Metrics Getters
 int64_t MasterMetricManager::get_put_start_discard_cnt() {
     return put_start_discard_cnt_.value();
@@ -1318,6 +1486,29 @@ std::string MasterMetricManager::serialize_metrics() {
     serialize_metric(eviction_attempts_);
     serialize_metric(evicted_key_count_);
     serialize_metric(evicted_size_);
+    serialize_metric(eviction_pass_latency_us_);
+    serialize_metric(eviction_pass_size_);
+    serialize_metric(ttl_expired_keys_);
+    serialize_metric(ttl_expired_size_);
+
+    // Serialize RPC Latency Metrics
+    serialize_metric(rpc_latency_us_);
+    serialize_metric(shard_lock_wait_us_);
+
+    // Serialize Tenant Metrics
+    serialize_metric(tenant_quota_);
+    serialize_metric(tenant_mem_size_);
+    serialize_metric(tenant_get_hits_);
+    serialize_metric(tenant_get_misses_);
+
+    // Serialize Tiering Metrics
+    serialize_metric(mem_cache_hit_nums_);
+    serialize_metric(file_cache_hit_nums_);
+    serialize_metric(local_disk_cache_hit_nums_);
+    serialize_metric(tiering_demotions_);
+    serialize_metric(tiering_promotions_);
+    serialize_metric(dedup_hits_);
+    serialize_metric(dedup_saved_bytes_);
 
     // Serialize PutStart Discard Metrics
     serialize_metric(put_start_discard_cnt_);
@@ -1617,7 +1808,15 @@ std::string MasterMetricManager::get_summary_string() {
        << "Success/Attempts=" << eviction_success << "/" << eviction_attempts
        << ", "
        << "keys=" << evicted_key_count << ", "
-       << "size=" << byte_size_to_string(evicted_size);
+       << "size=" << byte_size_to_string(evicted_size)
+       << ", TTL expired keys=" << ttl_expired_keys_.value();
+
+    // Tiering summary
+    ss << " | Tier Hits (Mem/SSD/LocalDisk): " << mem_cache_hit_nums_.value()
+       << "/" << file_cache_hit_nums_.value() << "/"
+       << local_disk_cache_hit_nums_.value()
+       << ", Demotions=" << tiering_demotions_.value()
+       << ", Promotions=" << tiering_promotions_.value();
 
     // Discard summary
     ss << " | Discard: "
@@ -1,15 +1,25 @@
 #include "master_service.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <cassert>
 #include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <random>
 #include <shared_mutex>
 #include <regex>
 #include <unordered_set>
 #include <ylt/util/tl/expected.hpp>
 
+#include "hash_ring.h"
 #include "master_metric_manager.h"
 #include "segment.h"
 #include "types.h"
+#include "utils.h"
 
 namespace mooncake {
 
@@ -19,8 +29,27 @@ MasterService::MasterService(const MasterServiceConfig& config)
     : default_kv_lease_ttl_(config.default_kv_lease_ttl),
       default_kv_soft_pin_ttl_(config.default_kv_soft_pin_ttl),
       allow_evict_soft_pinned_objects_(config.allow_evict_soft_pinned_objects),
+      enable_prefix_index_(config.enable_prefix_index),
       eviction_ratio_(config.eviction_ratio),
       eviction_high_watermark_ratio_(config.eviction_high_watermark_ratio),
+      eviction_sample_size_(config.eviction_sample_size),
+      eviction_shards_per_tick_(config.eviction_shards_per_tick),
+      enable_cost_aware_eviction_(config.enable_cost_aware_eviction),
+      enable_segment_pressure_eviction_(
+          config.enable_segment_pressure_eviction),
+      tiering_demote_access_count_(config.tiering_demote_access_count),
+      tiering_promote_disk_reads_(config.tiering_promote_disk_reads),
+      cxl_promote_access_count_(
+          config.enable_cxl ? config.cxl_promote_access_count : 0),
+      hot_replica_read_rate_(config.hot_replica_read_rate),
+      hot_replica_max_replicas_(config.hot_replica_max_replicas),
+      hot_replica_cooldown_(config.hot_replica_cooldown_sec),
+      rebalance_bandwidth_mb_(config.rebalance_bandwidth_mb),
+      enable_dedup_(config.enable_dedup),
+      defrag_interval_sec_(config.defrag_interval_sec),
+      defrag_threshold_(config.defrag_threshold),
+      defrag_max_moves_(config.defrag_max_moves),
+      defrag_max_request_rate_(config.defrag_max_request_rate),
       client_live_ttl_sec_(config.client_live_ttl_sec),
       enable_ha_(config.enable_ha),
       enable_offload_(config.enable_offload),
@@ -29,16 +58,25 @@ MasterService::MasterService(const MasterServiceConfig& config)
       global_file_segment_size_(config.global_file_segment_size),
       enable_disk_eviction_(config.enable_disk_eviction),
       quota_bytes_(config.quota_bytes),
-      segment_manager_(config.memory_allocator, config.enable_cxl),
+      segment_manager_(config.memory_allocator, config.enable_cxl,
+                       config.allocator_cache_max_size, config.slab_size,
+                       config.slab_class_min_count),
       memory_allocator_type_(config.memory_allocator),
-      allocation_strategy_(
-          CreateAllocationStrategy(config.allocation_strategy_type)),
+      segment_load_tracker_(
+          config.allocation_strategy_type == AllocationStrategyType::LOAD_AWARE
+              ? std::make_shared<SegmentLoadTracker>()
+              : nullptr),
+      allocation_strategy_(CreateAllocationStrategy(
+          config.allocation_strategy_type, segment_load_tracker_)),
       put_start_discard_timeout_sec_(config.put_start_discard_timeout_sec),
       put_start_release_timeout_sec_(config.put_start_release_timeout_sec),
+      put_lease_ttl_(config.put_lease_ttl_ms),
       task_manager_(config.task_manager_config),
       cxl_path_(config.cxl_path),
       cxl_size_(config.cxl_size),
-      enable_cxl_(config.enable_cxl) {
+      enable_cxl_(config.enable_cxl),
+      snapshot_path_(config.snapshot_path),
+      snapshot_interval_sec_(config.snapshot_interval_sec) {
     if (eviction_ratio_ < 0.0 || eviction_ratio_ > 1.0) {
         LOG(ERROR) << "Eviction ratio must be between 0.0 and 1.0, "
                    << "current value: " << eviction_ratio_;
@@ -51,6 +89,18 @@ MasterService::MasterService(const MasterServiceConfig& config)
             << "current value: " << eviction_high_watermark_ratio_;
         throw std::invalid_argument("Invalid eviction high watermark ratio");
     }
+    if (eviction_sample_size_ > 0 && eviction_shards_per_tick_ == 0) {
+        LOG(ERROR) << "eviction_shards_per_tick must be positive when "
+                   << "sampled eviction is enabled, eviction_sample_size="
+                   << eviction_sample_size_;
+        throw std::invalid_argument("Invalid eviction shards per tick");
+    }
+
+    if (defrag_threshold_ < 0.0 || defrag_threshold_ > 1.0) {
+        LOG(ERROR) << "Defrag threshold must be between 0.0 and 1.0, "
+                   << "current value: " << defrag_threshold_;
+        throw std::invalid_argument("Invalid defrag threshold");
+    }
 
     if (put_start_release_timeout_sec_ <= put_start_discard_timeout_sec_) {
         LOG(ERROR) << "put_start_release_timeout="
@@ -62,6 +112,18 @@ MasterService::MasterService(const MasterServiceConfig& config)
             "put_start_discard_timeout_sec");
     }
 
+    if (!tenants_.Configure(config.tenant_quotas)) {
+        throw std::invalid_argument("Invalid tenant quotas");
+    }
+
+    {
+        // So that clients do not mistake leases of a restarted master for
+        // those they hold
+        std::random_device rd;
+        std::lock_guard lock(put_leases_mutex_);
+        next_put_lease_id_ = ((static_cast<uint64_t>(rd()) << 32) | rd()) | 1;
+    }
+
     eviction_running_ = true;
     eviction_thread_ = std::thread(&MasterService::EvictionThreadFunc, this);
     VLOG(1) << "action=start_eviction_thread";
@@ -76,8 +138,23 @@ MasterService::MasterService(const MasterServiceConfig& config)
     task_cleanup_running_ = true;
     task_cleanup_thread_ =
         std::thread(&MasterService::TaskCleanupThreadFunc, this);
+    task_waiter_thread_ =
+        std::thread(&MasterService::TaskWaiterThreadFunc, this);
     VLOG(1) << "action=start_task_cleanup_thread";
 
+    sweep_running_ = true;
+    sweep_thread_ = std::thread(&MasterService::SweepThreadFunc, this);
+    VLOG(1) << "action=start_sweep_thread";
+
+    const uint64_t ttl_start_tick = TtlTick(std::chrono::steady_clock::now());
+    for (auto& ttl_wheel : ttl_wheels_) {
+        std::lock_guard<std::mutex> lock(ttl_wheel.mutex);
+        ttl_wheel.wheel = TimingWheel(ttl_start_tick);
+    }
+    ttl_running_ = true;
+    ttl_thread_ = std::thread(&MasterService::TtlThreadFunc, this);
+    VLOG(1) << "action=start_ttl_thread";
+
     if (!root_fs_dir_.empty()) {
         use_disk_replica_ = true;
         MasterMetricManager::instance().inc_total_file_capacity(
@@ -88,6 +165,48 @@ MasterService::MasterService(const MasterServiceConfig& config)
         segment_manager_.initializeCxlAllocator(cxl_path_, cxl_size_);
         VLOG(1) << "action=start_cxl_global_allocator";
     }
+
+    if (enable_prefix_index_) {
+        for (size_t i = 0; i < kNumShards; ++i) {
+            MetadataShardAccessorRW shard(this, i);
+            shard->metadata.EnableOrderedKeys();
+        }
+        VLOG(1) << "action=enable_prefix_index";
+    }
+
+    // Standby masters replay buffers at the addresses chosen by the leader,
+    // which is only supported by the offset allocator.
+    if (enable_ha_ && config.oplog_capacity > 0 && !enable_cxl_ &&
+        memory_allocator_type_ == BufferAllocatorType::OFFSET) {
+        oplog_ = std::make_unique<OpLog>(config.oplog_capacity);
+        VLOG(1) << "action=enable_oplog, capacity=" << config.oplog_capacity;
+    }
+
+    if (!snapshot_path_.empty()) {
+        if (std::filesystem::exists(snapshot_path_)) {
+            auto result = LoadSnapshot(snapshot_path_);
+            if (!result) {
+                LOG(ERROR) << "path=" << snapshot_path_
+                           << ", error=load_snapshot_failed, error_code="
+                           << result.error()
+                           << ", action=start_with_empty_metadata";
+            }
+        }
+        if (snapshot_interval_sec_ > 0) {
+            snapshot_running_ = true;
+            snapshot_thread_ =
+                std::thread(&MasterService::SnapshotThreadFunc, this);
+            VLOG(1) << "action=start_snapshot_thread";
+        }
+    }
+
+    // Only the offset allocator tracks the free regions around a buffer
+    if (defrag_interval_sec_ > 0 && defrag_max_moves_ > 0 && !enable_cxl_ &&
+        memory_allocator_type_ == BufferAllocatorType::OFFSET) {
+        defrag_running_ = true;
+        defrag_thread_ = std::thread(&MasterService::DefragThreadFunc, this);
+        VLOG(1) << "action=start_defrag_thread";
+    }
 }
 
 MasterService::~MasterService() {
@@ -95,19 +214,58 @@ MasterService::~MasterService() {
     eviction_running_ = false;
     client_monitor_running_ = false;
     task_cleanup_running_ = false;
+    snapshot_running_ = false;
+    defrag_running_ = false;
+    sweep_running_ = false;
+    ttl_running_ = false;
 
     // Wake sleepers so join() doesn't block for long sleep intervals.
     task_cleanup_cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(task_waiters_mutex_);
+        task_waiters_cv_.notify_all();
+    }
+    snapshot_cv_.notify_all();
+    defrag_cv_.notify_all();
+    sweep_cv_.notify_all();
+    ttl_cv_.notify_all();
+
+    if (defrag_thread_.joinable()) {
+        defrag_thread_.join();
+    }
 
     if (eviction_thread_.joinable()) {
         eviction_thread_.join();
     }
+    if (ttl_thread_.joinable()) {
+        ttl_thread_.join();
+    }
     if (client_monitor_thread_.joinable()) {
         client_monitor_thread_.join();
     }
+    // Joined after the client monitor, which requests sweeps
+    if (sweep_thread_.joinable()) {
+        sweep_thread_.join();
+    }
     if (task_cleanup_thread_.joinable()) {
         task_cleanup_thread_.join();
     }
+    if (task_waiter_thread_.joinable()) {
+        task_waiter_thread_.join();
+    }
+    if (snapshot_thread_.joinable()) {
+        snapshot_thread_.join();
+        // Take a final snapshot so that a graceful restart loses nothing.
+        // A standby master must not overwrite the snapshot of the leader.
+        if (!standby_) {
+            auto result = SaveSnapshot(snapshot_path_);
+            if (!result) {
+                LOG(ERROR) << "path=" << snapshot_path_
+                           << ", error=save_final_snapshot_failed, error_code="
+                           << result.error();
+            }
+        }
+    }
 }
 
 auto MasterService::MountSegment(const Segment& segment, const UUID& client_id)
@@ -146,6 +304,17 @@ auto MasterService::MountSegment(const Segment& segment, const UUID& client_id)
     } else if (err != ErrorCode::OK) {
         return tl::make_unexpected(err);
     }
+    if (IsOpLogEnabled()) {
+        OpLogEntry entry;
+        entry.type = OpLogType::MOUNT_SEGMENT;
+        entry.client_id = client_id;
+        entry.segments.push_back(segment);
+        oplog_->Append(std::move(entry));
+    }
+    if (rebalance_bandwidth_mb_ > 0) {
+        std::lock_guard<std::mutex> lock(rebalance_mutex_);
+        rebalance_targets_.insert(segment.name);
+    }
     return {};
 }
 
@@ -186,6 +355,13 @@ auto MasterService::ReMountSegment(const std::vector<Segment>& segments,
     if (err != ErrorCode::OK) {
         return tl::make_unexpected(err);
     }
+    if (IsOpLogEnabled()) {
+        OpLogEntry entry;
+        entry.type = OpLogType::REMOUNT_SEGMENTS;
+        entry.client_id = client_id;
+        entry.segments = segments;
+        oplog_->Append(std::move(entry));
+    }
 
     // Change the client status to OK
     ok_client_.insert(client_id);
@@ -194,25 +370,6 @@ auto MasterService::ReMountSegment(const std::vector<Segment>& segments,
     return {};
 }
 
-void MasterService::ClearInvalidHandles() {
-    for (size_t i = 0; i < kNumShards; i++) {
-        MetadataShardAccessorRW shard(this, i);
-        auto it = shard->metadata.begin();
-        while (it != shard->metadata.end()) {
-            if (CleanupStaleHandles(it->second)) {
-                // If the object is empty, we need to erase the iterator and
-                // also erase the key from processing_keys and
-                // replication_tasks.
-                shard->processing_keys.erase(it->first);
-                shard->replication_tasks.erase(it->first);
-                it = shard->metadata.erase(it);
-            } else {
-                ++it;
-            }
-        }
-    }
-}
-
 void MasterService::TaskCleanupThreadFunc() {
     LOG(INFO) << "Task cleanup thread started";
     while (task_cleanup_running_) {
@@ -235,6 +392,66 @@ void MasterService::TaskCleanupThreadFunc() {
     LOG(INFO) << "Task cleanup thread stopped";
 }
 
+void MasterService::TaskWaiterThreadFunc() {
+    // Idle wait, waiters parked meanwhile notify the thread
+    const auto kIdleWait = std::chrono::milliseconds(kMaxTaskWaitMs);
+    std::unique_lock<std::mutex> lock(task_waiters_mutex_);
+    while (true) {
+        const bool running = task_cleanup_running_.load();
+        const auto now = std::chrono::steady_clock::now();
+        auto next_deadline = now + kIdleWait;
+        std::vector<FetchTasksCallback> expired;
+        for (auto it = task_waiters_.begin(); it != task_waiters_.end();) {
+            auto& waiters = it->second;
+            for (size_t i = 0; i < waiters.size();) {
+                if (!running || waiters[i].deadline <= now) {
+                    expired.push_back(std::move(waiters[i].done));
+                    waiters[i] = std::move(waiters.back());
+                    waiters.pop_back();
+                } else {
+                    next_deadline =
+                        std::min(next_deadline, waiters[i].deadline);
+                    ++i;
+                }
+            }
+            it = waiters.empty() ? task_waiters_.erase(it) : std::next(it);
+        }
+        if (!expired.empty()) {
+            lock.unlock();
+            for (auto& done : expired) done(std::vector<TaskAssignment>{});
+            lock.lock();
+            continue;
+        }
+        if (!running) break;
+        task_waiters_cv_.wait_until(lock, next_deadline);
+    }
+}
+
+void MasterService::WakeTaskWaiters(const UUID& client_id) {
+    std::vector<TaskWaiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(task_waiters_mutex_);
+        auto it = task_waiters_.find(client_id);
+        if (it == task_waiters_.end()) return;
+        waiters = std::move(it->second);
+        task_waiters_.erase(it);
+    }
+    std::vector<TaskWaiter> still_waiting;
+    for (auto& waiter : waiters) {
+        auto tasks = FetchTasks(client_id, waiter.batch_size);
+        if (tasks && tasks->empty()) {
+            // Taken by an earlier waiter of the same client
+            still_waiting.push_back(std::move(waiter));
+            continue;
+        }
+        waiter.done(std::move(tasks));
+    }
+    if (still_waiting.empty()) return;
+    std::lock_guard<std::mutex> lock(task_waiters_mutex_);
+    auto& parked = task_waiters_[client_id];
+    for (auto& waiter : still_waiting) parked.push_back(std::move(waiter));
+}
+
 auto MasterService::UnmountSegment(const UUID& segment_id,
                                    const UUID& client_id)
     -> tl::expected<void, ErrorCode> {
@@ -253,10 +470,19 @@ auto MasterService::UnmountSegment(const UUID& segment_id,
         if (err != ErrorCode::OK) {
             return tl::make_unexpected(err);
         }
+        if (IsOpLogEnabled()) {
+            OpLogEntry entry;
+            entry.type = OpLogType::UNMOUNT_SEGMENT;
+            entry.client_id = client_id;
+            entry.segment_id = segment_id;
+            oplog_->Append(std::move(entry));
+        }
     }  // Release the segment mutex before long-running step 2 and avoid
        // deadlocks
 
-    // 2. Remove the metadata of the related objects
+    // 2. Remove the metadata of the related objects. Accesses clean up the
+    // objects of shards that are not swept yet.
+    BumpSegmentGeneration();
     ClearInvalidHandles();
 
     // 3. Commit the unmount operation
@@ -271,17 +497,33 @@ auto MasterService::UnmountSegment(const UUID& segment_id,
 
 auto MasterService::ExistKey(const std::string& key)
     -> tl::expected<bool, ErrorCode> {
-    MetadataAccessorRO accessor(this, key);
-    if (!accessor.Exists()) {
-        VLOG(1) << "key=" << key << ", info=object_not_found";
-        return false;
+    const auto now = std::chrono::steady_clock::now();
+    {
+        MetadataAccessorRO accessor(this, key);
+        if (accessor.Exists()) {
+            return IsCompletedObject(accessor.Get(), now);
+        }
+    }
+    const std::string content_key =
+        enable_dedup_ ? ResolveDedupAlias(key) : std::string();
+    if (!content_key.empty()) {
+        MetadataAccessorRO accessor(this, content_key);
+        if (accessor.Exists()) {
+            return IsCompletedObject(accessor.Get(), now);
+        }
     }
+    VLOG(1) << "key=" << key << ", info=object_not_found";
+    return false;
+}
 
-    const auto& metadata = accessor.Get();
+bool MasterService::IsCompletedObject(
+    const ObjectMetadata& metadata,
+    std::chrono::steady_clock::time_point now) const {
     if (metadata.HasReplica(&Replica::fn_is_completed)) {
         // Grant a lease to the object as it may be further used by the
         // client.
-        metadata.GrantLease(default_kv_lease_ttl_, default_kv_soft_pin_ttl_);
+        metadata.GrantLease(default_kv_lease_ttl_, default_kv_soft_pin_ttl_,
+                            now);
         return true;
     }
 
@@ -290,29 +532,171 @@ auto MasterService::ExistKey(const std::string& key)
 
 std::vector<tl::expected<bool, ErrorCode>> MasterService::BatchExistKey(
     const std::vector<std::string>& keys) {
-    std::vector<tl::expected<bool, ErrorCode>> results;
-    results.reserve(keys.size());
-    for (const auto& key : keys) {
-        results.emplace_back(ExistKey(key));
+    std::vector<tl::expected<bool, ErrorCode>> results(keys.size(), false);
+    std::vector<size_t> missing;
+    const auto now = std::chrono::steady_clock::now();
+    VisitKeysByShard(keys, [&](size_t key_idx, size_t,
+                               const ObjectMetadata* metadata) {
+        if (metadata == nullptr) {
+            missing.push_back(key_idx);
+            return;
+        }
+        results[key_idx] = IsCompletedObject(*metadata, now);
+    });
+    for (size_t key_idx : missing) {
+        if (enable_dedup_) {
+            // Deduplicated keys have no metadata of their own
+            results[key_idx] = ExistKey(keys[key_idx]);
+        } else {
+            VLOG(1) << "key=" << keys[key_idx] << ", info=object_not_found";
+        }
     }
     return results;
 }
 
+auto MasterService::BatchExistKeyPrefix(const std::vector<std::string>& keys)
+    -> tl::expected<uint64_t, ErrorCode> {
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto exists = ExistKey(keys[i]);
+        if (!exists) {
+            return tl::make_unexpected(exists.error());
+        }
+        if (!*exists) {
+            return i;
+        }
+    }
+    return keys.size();
+}
+
+void MasterService::VisitKeysByShard(
+    const std::vector<std::string>& keys,
+    const std::function<void(size_t key_idx, size_t shard_idx,
+                             const ObjectMetadata* metadata)>& visit_fn)
+    const {
+    // (shard index, key index) pairs
+    std::vector<std::pair<size_t, size_t>> order;
+    order.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        order.emplace_back(getShardIndex(keys[i]), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    size_t pos = 0;
+    while (pos < order.size()) {
+        const size_t shard_idx = order[pos].first;
+        MetadataShardAccessorRO shard(this, shard_idx);
+        for (; pos < order.size() && order[pos].first == shard_idx; ++pos) {
+            const size_t key_idx = order[pos].second;
+            auto it = shard->metadata.find(keys[key_idx]);
+            const bool valid =
+                it != shard->metadata.end() && it->second.IsValid();
+            visit_fn(key_idx, shard_idx, valid ? &it->second : nullptr);
+        }
+    }
+}
+
 auto MasterService::GetAllKeys()
     -> tl::expected<std::vector<std::string>, ErrorCode> {
     std::vector<std::string> all_keys;
     for (size_t i = 0; i < kNumShards; i++) {
         MetadataShardAccessorRO shard(this, i);
         for (const auto& item : shard->metadata) {
+            if (!enable_dedup_ || !IsDedupContentKey(item.first)) {
+                all_keys.push_back(item.first);
+            }
+        }
+        for (const auto& item : shard->dedup_aliases) {
             all_keys.push_back(item.first);
         }
     }
     return all_keys;
 }
 
+auto MasterService::ScanKeys(const ScanKeysCursor& cursor, uint64_t limit,
+                             const std::string& prefix, bool with_metadata)
+    -> tl::expected<ScanKeysResponse, ErrorCode> {
+    if (limit == 0 || limit > kMaxScanKeys || cursor.shard >= kNumShards) {
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+
+    ScanKeysResponse response;
+    auto& entries = response.entries;
+    // Deduplicated keys and their content keys, whose metadata is looked up
+    // once the shard of the alias is unlocked
+    std::vector<std::pair<size_t, std::string>> aliases;
+    size_t shard_idx = cursor.shard;
+    for (; shard_idx < kNumShards && entries.size() < limit; ++shard_idx) {
+        const std::string& after =
+            shard_idx == cursor.shard ? cursor.after : std::string();
+        auto wanted = [&](const std::string& key) {
+            return key > after && key.starts_with(prefix);
+        };
+
+        MetadataShardAccessorRO shard(this, shard_idx);
+        std::vector<const std::string*> keys;
+        for (const auto& item : shard->metadata) {
+            if ((!enable_dedup_ || !IsDedupContentKey(item.first)) &&
+                wanted(item.first)) {
+                keys.push_back(&item.first);
+            }
+        }
+        for (const auto& item : shard->dedup_aliases) {
+            if (wanted(item.first)) keys.push_back(&item.first);
+        }
+
+        // The smallest keys of the shard that fit in the page
+        auto by_key = [](const std::string* a, const std::string* b) {
+            return *a < *b;
+        };
+        const size_t count = std::min(keys.size(), limit - entries.size());
+        std::partial_sort(keys.begin(), keys.begin() + count, keys.end(),
+                          by_key);
+        for (size_t i = 0; i < count; ++i) {
+            ScanKeysEntry entry;
+            entry.key = *keys[i];
+            if (with_metadata) {
+                auto it = shard->metadata.find(entry.key);
+                if (it != shard->metadata.end()) {
+                    entry.size = it->second.size;
+                    entry.num_replicas = it->second.CountReplicas();
+                    entry.soft_pinned = it->second.has_soft_pin;
+                } else {
+                    aliases.emplace_back(entries.size(),
+                                         shard->dedup_aliases.at(entry.key));
+                }
+            }
+            entries.push_back(std::move(entry));
+        }
+        if (count < keys.size()) {
+            // The page ends within this shard
+            response.next.shard = shard_idx;
+            response.next.after = entries.back().key;
+            break;
+        }
+    }
+    if (shard_idx >= kNumShards) {
+        response.next.shard = kNumShards;
+        response.done = true;
+    } else if (response.next.after.empty()) {
+        // Full page at the end of a shard, go on with the next one
+        response.next.shard = shard_idx;
+    }
+
+    for (const auto& [index, content_key] : aliases) {
+        MetadataAccessorRO accessor(this, content_key);
+        if (!accessor.Exists()) continue;
+        auto& entry = entries[index];
+        entry.size = accessor.Get().size;
+        entry.num_replicas = accessor.Get().CountReplicas();
+        entry.soft_pinned = accessor.Get().has_soft_pin;
+    }
+    return response;
+}
+
 auto MasterService::GetAllSegments()
     -> tl::expected<std::vector<std::string>, ErrorCode> {
-    ScopedSegmentAccess segment_access = segment_manager_.getSegmentAccess();
+    const ScopedSegmentAccess segment_access =
+        segment_manager_.getSegmentReadAccess();
     std::vector<std::string> all_segments;
     auto err = segment_access.GetAllSegments(all_segments);
     if (err != ErrorCode::OK) {
@@ -323,7 +707,8 @@ auto MasterService::GetAllSegments()
 
 auto MasterService::QuerySegments(const std::string& segment)
     -> tl::expected<std::pair<size_t, size_t>, ErrorCode> {
-    ScopedSegmentAccess segment_access = segment_manager_.getSegmentAccess();
+    const ScopedSegmentAccess segment_access =
+        segment_manager_.getSegmentReadAccess();
     size_t used, capacity;
     auto err = segment_access.QuerySegments(segment, used, capacity);
     if (err != ErrorCode::OK) {
@@ -334,7 +719,8 @@ auto MasterService::QuerySegments(const std::string& segment)
 
 auto MasterService::QueryIp(const UUID& client_id)
     -> tl::expected<std::vector<std::string>, ErrorCode> {
-    ScopedSegmentAccess segment_access = segment_manager_.getSegmentAccess();
+    const ScopedSegmentAccess segment_access =
+        segment_manager_.getSegmentReadAccess();
     std::vector<Segment> segments;
     ErrorCode err = segment_access.GetClientSegments(client_id, segments);
     if (err != ErrorCode::OK) {
@@ -448,6 +834,7 @@ auto MasterService::BatchReplicaClear(
 
             // Erase the entire metadata (all replicas will be deallocated)
             accessor.Erase();
+            LogObject(key, nullptr);
             cleared_keys.emplace_back(key);
             VLOG(1) << "BatchReplicaClear: successfully cleared all replicas "
                        "for key="
@@ -457,17 +844,8 @@ auto MasterService::BatchReplicaClear(
             bool has_replica_on_segment = false;
             const auto match_replica_on_segment =
                 [&](const Replica& replica) -> bool {
-                if (!replica.is_completed()) {
-                    return false;
-                }
-                const auto segment_names = replica.get_segment_names();
-                for (const auto& seg_name : segment_names) {
-                    if (seg_name.has_value() &&
-                        seg_name.value() == segment_name) {
-                        return true;
-                    }
-                }
-                return false;
+                return replica.is_completed() &&
+                       replica.is_in_segment(segment_name);
             };
 
             metadata.VisitReplicas(
@@ -493,6 +871,9 @@ auto MasterService::BatchReplicaClear(
             // If no valid replicas remain, erase the entire metadata
             if (!metadata.IsValid()) {
                 accessor.Erase();
+                LogObject(key, nullptr);
+            } else {
+                LogObject(key, &metadata);
             }
 
             cleared_keys.emplace_back(key);
@@ -521,50 +902,182 @@ auto MasterService::GetReplicaListByRegex(const std::string& regex_pattern)
         return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
     }
 
+    // With the prefix index only the keys starting with the literal prefix
+    // of the pattern are candidates, and they are still matched against it.
+    const auto prefix = enable_prefix_index_
+                            ? GetRegexLiteralPrefix(regex_pattern)
+                            : std::nullopt;
+    auto visit = [&](const std::string& key, const ObjectMetadata& metadata) {
+        if (!std::regex_search(key, pattern) ||
+            (enable_dedup_ && IsDedupContentKey(key))) {
+            return;
+        }
+        std::vector<Replica::Descriptor> replica_list;
+        metadata.VisitReplicas(&Replica::fn_is_completed,
+                               [&replica_list](const Replica& replica) {
+                                   replica_list.emplace_back(
+                                       replica.get_descriptor());
+                               });
+
+        if (replica_list.empty()) {
+            LOG(WARNING) << "key=" << key
+                         << " matched by regex, but has no complete replicas.";
+            return;
+        }
+
+        results.emplace(key, std::move(replica_list));
+        metadata.GrantLease(default_kv_lease_ttl_, default_kv_soft_pin_ttl_);
+    };
+
+    // Matching deduplicated keys and their content keys
+    std::vector<std::pair<std::string, std::string>> aliases;
     for (size_t i = 0; i < kNumShards; ++i) {
         MetadataShardAccessorRO shard(this, i);
 
-        for (const auto& [key, metadata] : shard->metadata) {
+        if (prefix) {
+            for (const auto& it : shard->metadata.FindPrefix(*prefix)) {
+                visit(it->first, it->second);
+            }
+        } else {
+            for (const auto& [key, metadata] : shard->metadata) {
+                visit(key, metadata);
+            }
+        }
+        for (const auto& [key, content_key] : shard->dedup_aliases) {
             if (std::regex_search(key, pattern)) {
-                std::vector<Replica::Descriptor> replica_list;
-                metadata.VisitReplicas(
-                    &Replica::fn_is_completed,
-                    [&replica_list](const Replica& replica) {
-                        replica_list.emplace_back(replica.get_descriptor());
-                    });
-
-                if (replica_list.empty()) {
-                    LOG(WARNING)
-                        << "key=" << key
-                        << " matched by regex, but has no complete replicas.";
-                    continue;
-                }
-
-                results.emplace(key, std::move(replica_list));
-                metadata.GrantLease(default_kv_lease_ttl_,
-                                    default_kv_soft_pin_ttl_);
+                aliases.emplace_back(key, content_key);
             }
         }
     }
+    for (const auto& [key, content_key] : aliases) {
+        MetadataAccessorRO accessor(this, content_key);
+        if (accessor.Exists()) {
+            visit(key, accessor.Get());
+        }
+    }
 
     return results;
 }
 
 auto MasterService::GetReplicaList(const std::string& key)
     -> tl::expected<GetReplicaListResponse, ErrorCode> {
-    MetadataAccessorRO accessor(this, key);
-
     MasterMetricManager::instance().inc_total_get_nums();
+    const auto now = std::chrono::steady_clock::now();
+    {
+        MetadataAccessorRO accessor(this, key);
+        if (accessor.Exists()) {
+            auto result = GetReplicaList(key, accessor.Get(),
+                                         getShardIndex(key), now);
+            RecordTenantRead(key, result);
+            return result;
+        }
+    }
+    // A deduplicated key reads the replicas of its content
+    const std::string content_key =
+        enable_dedup_ ? ResolveDedupAlias(key) : std::string();
+    if (!content_key.empty()) {
+        MetadataAccessorRO accessor(this, content_key);
+        if (accessor.Exists()) {
+            auto result = GetReplicaList(content_key, accessor.Get(),
+                                         getShardIndex(content_key), now);
+            RecordTenantRead(key, result);
+            return result;
+        }
+    }
+    VLOG(1) << "key=" << key << ", info=object_not_found";
+    tl::expected<GetReplicaListResponse, ErrorCode> result =
+        tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
+    RecordTenantRead(key, result);
+    return result;
+}
 
-    if (!accessor.Exists()) {
-        VLOG(1) << "key=" << key << ", info=object_not_found";
-        return tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
+std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>
+MasterService::BatchGetReplicaList(const std::vector<std::string>& keys) {
+    MasterMetricManager::instance().inc_total_get_nums(keys.size());
+    std::vector<tl::expected<GetReplicaListResponse, ErrorCode>> results(
+        keys.size(), tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND));
+    std::vector<size_t> missing;
+    const auto now = std::chrono::steady_clock::now();
+    VisitKeysByShard(keys, [&](size_t key_idx, size_t shard_idx,
+                               const ObjectMetadata* metadata) {
+        if (metadata == nullptr) {
+            missing.push_back(key_idx);
+            return;
+        }
+        results[key_idx] =
+            GetReplicaList(keys[key_idx], *metadata, shard_idx, now);
+    });
+    if (!enable_dedup_) {
+        for (size_t key_idx : missing) {
+            VLOG(1) << "key=" << keys[key_idx] << ", info=object_not_found";
+        }
+        RecordTenantReads(keys, results);
+        return results;
+    }
+
+    // Deduplicated keys read the replicas of their content
+    std::vector<std::string> content_keys;
+    std::vector<size_t> alias_indices;
+    for (size_t key_idx : missing) {
+        auto content_key = ResolveDedupAlias(keys[key_idx]);
+        if (!content_key.empty()) {
+            content_keys.push_back(std::move(content_key));
+            alias_indices.push_back(key_idx);
+        }
     }
-    const auto& metadata = accessor.Get();
+    VisitKeysByShard(content_keys, [&](size_t idx, size_t shard_idx,
+                                       const ObjectMetadata* metadata) {
+        if (metadata != nullptr) {
+            results[alias_indices[idx]] =
+                GetReplicaList(content_keys[idx], *metadata, shard_idx, now);
+        }
+    });
+    RecordTenantReads(keys, results);
+    return results;
+}
+
+void MasterService::RecordTenantRead(
+    const std::string& key,
+    const tl::expected<GetReplicaListResponse, ErrorCode>& result) const {
+    const auto* tenant = tenants_.Find(key);
+    if (!tenant) {
+        return;
+    }
+    // Reads served from disk count as misses, as they beat no recompute
+    if (result.has_value() && !result->replicas.empty() &&
+        result->replicas[0].is_memory_replica()) {
+        MasterMetricManager::instance().inc_tenant_get_hits(tenant->name);
+    } else {
+        MasterMetricManager::instance().inc_tenant_get_misses(tenant->name);
+    }
+}
+
+void MasterService::RecordTenantReads(
+    const std::vector<std::string>& keys,
+    const std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>&
+        results) const {
+    if (tenants_.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        RecordTenantRead(keys[i], results[i]);
+    }
+}
 
+auto MasterService::GetReplicaList(const std::string& key,
+                                   const ObjectMetadata& metadata,
+                                   size_t shard_idx,
+                                   std::chrono::steady_clock::time_point now)
+    -> tl::expected<GetReplicaListResponse, ErrorCode> {
     std::vector<Replica::Descriptor> replica_list;
+    // Skip the replicas on unmounted segments until the shard is swept
+    const bool may_be_stale = MayHaveStaleHandles(shard_idx);
     metadata.VisitReplicas(
-        &Replica::fn_is_completed, [&replica_list](const Replica& replica) {
+        [may_be_stale](const Replica& replica) {
+            return replica.is_completed() &&
+                   !(may_be_stale && replica.has_invalid_mem_handle());
+        },
+        [&replica_list](const Replica& replica) {
             replica_list.emplace_back(replica.get_descriptor());
         });
 
@@ -572,19 +1085,73 @@ auto MasterService::GetReplicaList(const std::string& key)
         LOG(WARNING) << "key=" << key << ", error=replica_not_ready";
         return tl::make_unexpected(ErrorCode::REPLICA_IS_NOT_READY);
     }
+    // Readers use the first replica, and a promoted object has its memory
+    // replica after the disk ones.
+    auto memory_end =
+        std::stable_partition(replica_list.begin(), replica_list.end(),
+                              [](const Replica::Descriptor& replica) {
+                                  return replica.is_memory_replica();
+                              });
+    // DRAM replicas are read before the slower CXL ones
+    const auto is_dram = [](const Replica::Descriptor& replica) {
+        return replica.get_memory_descriptor().buffer_descriptor.protocol_ !=
+               "cxl";
+    };
+    if (enable_cxl_) {
+        std::stable_partition(replica_list.begin(), memory_end, is_dram);
+    }
 
-    if (replica_list[0].is_memory_replica()) {
+    const bool memory_hit = replica_list[0].is_memory_replica();
+    if (memory_hit) {
         MasterMetricManager::instance().inc_mem_cache_hit_nums();
     } else if (replica_list[0].is_disk_replica()) {
         MasterMetricManager::instance().inc_file_cache_hit_nums();
+    } else if (replica_list[0].is_local_disk_replica()) {
+        MasterMetricManager::instance().inc_local_disk_cache_hit_nums();
     }
     MasterMetricManager::instance().inc_valid_get_nums();
     // Grant a lease to the object so it will not be removed
     // when the client is reading it.
-    metadata.GrantLease(default_kv_lease_ttl_, default_kv_soft_pin_ttl_);
-
-    return GetReplicaListResponse(std::move(replica_list),
-                                  default_kv_lease_ttl_);
+    metadata.GrantLease(default_kv_lease_ttl_, default_kv_soft_pin_ttl_, now);
+    const uint32_t heat = metadata.RecordAccess(heat_epoch_.load());
+    if (enable_cost_aware_eviction_) {
+        UpdateEvictionPriority(metadata, heat);
+    }
+
+    GetReplicaListResponse response(std::move(replica_list),
+                                    default_kv_lease_ttl_);
+    response.checksum = metadata.checksum;
+    // The heat of an object without memory replica counts its disk reads.
+    // Only one reader is asked to promote it, and a reader that fails to do
+    // so is replaced by the next one after as many reads.
+    if (tiering_promote_disk_reads_ > 0 && !memory_hit &&
+        heat % tiering_promote_disk_reads_ == 0 &&
+        !metadata.replication_task.has_value()) {
+        response.promote = true;
+        MasterMetricManager::instance().inc_tiering_promotions();
+    }
+    // An object only on CXL memory is queued for promotion to DRAM
+    if (cxl_promote_access_count_ > 0 && memory_hit &&
+        heat % cxl_promote_access_count_ == 0 &&
+        !is_dram(response.replicas[0]) &&
+        !metadata.replication_task.has_value()) {
+        std::lock_guard<std::mutex> lock(cxl_promotion_mutex_);
+        if (cxl_promotion_queue_.size() < kMaxCxlPromotionQueueSize) {
+            cxl_promotion_queue_.insert(key);
+        }
+    }
+    // Queued once per second in which it is read often enough
+    if (hot_replica_read_rate_ > 0 && memory_hit &&
+        metadata.RecordRead(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::seconds>(
+                now.time_since_epoch())
+                .count())) == hot_replica_read_rate_) {
+        std::lock_guard<std::mutex> lock(hot_replica_mutex_);
+        if (hot_replica_queue_.size() < kMaxHotReplicaQueueSize) {
+            hot_replica_queue_.insert(key);
+        }
+    }
+    return response;
 }
 
 auto MasterService::PutStart(const UUID& client_id, const std::string& key,
@@ -613,12 +1180,53 @@ auto MasterService::PutStart(const UUID& client_id, const std::string& key,
             << ", slice_length=" << slice_length << ", config=" << config
             << ", action=put_start_begin";
 
+    if (enable_dedup_) {
+        if (IsDedupContentKey(key)) {
+            LOG(ERROR) << "key=" << key << ", error=reserved_key_prefix";
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        DropStaleDedupAlias(key);
+        if (!config.content_hash.empty()) {
+            auto result = DedupPutStart(client_id, key, slice_length, config);
+            if (result.has_value()) {
+                return std::move(*result);
+            }
+        }
+    }
+
     // Lock the shard and check if object already exists
     MetadataShardAccessorRW shard(this, getShardIndex(key));
 
     const auto now = std::chrono::steady_clock::now();
+    auto prepared = PrepareNewPut(shard, key, now);
+    if (!prepared) {
+        return tl::make_unexpected(prepared.error());
+    }
+
+    auto replicas = AllocateReplicas(client_id, key, slice_length, config);
+    if (!replicas.has_value()) {
+        return tl::make_unexpected(replicas.error());
+    }
+
+    std::vector<Replica::Descriptor> replica_list;
+    replica_list.reserve(replicas->size());
+    for (const auto& replica : *replicas) {
+        replica_list.emplace_back(replica.get_descriptor());
+    }
+
+    InsertNewPut(shard, client_id, key, total_length, std::move(*replicas),
+                 config, now);
+    return replica_list;
+}
+
+auto MasterService::PrepareNewPut(MetadataShardAccessorRW& shard,
+                                  const std::string& key,
+                                  std::chrono::steady_clock::time_point now)
+    -> tl::expected<void, ErrorCode> {
     auto it = shard->metadata.find(key);
-    if (it != shard->metadata.end() && !CleanupStaleHandles(it->second)) {
+    if (it != shard->metadata.end() &&
+        (!MayHaveStaleHandles(getShardIndex(key)) ||
+         !CleanupStaleHandles(it->second))) {
         auto& metadata = it->second;
         // If the object's PutStart expired and has not completed any
         // replicas, we can discard it and allow the new PutStart to
@@ -632,15 +1240,50 @@ auto MasterService::PutStart(const UUID& client_id, const std::string& key,
                     std::move(replicas),
                     metadata.put_start_time + put_start_release_timeout_sec_);
             }
-            shard->processing_keys.erase(key);
             shard->metadata.erase(it);
         } else {
             LOG(INFO) << "key=" << key << ", info=object_already_exists";
             return tl::make_unexpected(ErrorCode::OBJECT_ALREADY_EXISTS);
         }
     }
+    if (shard->dedup_aliases.contains(key)) {
+        LOG(INFO) << "key=" << key << ", info=object_already_exists";
+        return tl::make_unexpected(ErrorCode::OBJECT_ALREADY_EXISTS);
+    }
+    return {};
+}
+
+void MasterService::InsertNewPut(MetadataShardAccessorRW& shard,
+                                 const UUID& client_id, const std::string& key,
+                                 uint64_t size,
+                                 std::vector<Replica>&& replicas,
+                                 const ReplicateConfig& config,
+                                 std::chrono::steady_clock::time_point now) {
+    // No need to set lease here. The object will not be evicted until
+    // PutEnd is called.
+    auto result = shard->metadata.emplace(
+        std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(client_id, now, size, std::move(replicas),
+                              config.with_soft_pin, tenants_.Find(key)));
+    // Also mark the metadata as processing for monitoring.
+    result.first->second.in_processing = true;
+    UpdateTracking(shard->metadata, result.first);
+    result.first->second.cost_hint = config.cost_hint;
+    if (enable_cost_aware_eviction_) {
+        UpdateEvictionPriority(result.first->second, 1);
+    }
+    if (config.ttl_ms > 0) {
+        const auto expire_time = now + std::chrono::milliseconds(config.ttl_ms);
+        result.first->second.expire_time = expire_time;
+        ScheduleExpiry(key, expire_time);
+    }
+}
 
-    // Allocate replicas
+auto MasterService::AllocateReplicas(const UUID& client_id,
+                                     const std::string& key,
+                                     uint64_t slice_length,
+                                     const ReplicateConfig& config)
+    -> tl::expected<std::vector<Replica>, ErrorCode> {
     std::vector<Replica> replicas;
     {
         ScopedAllocatorAccess allocator_access =
@@ -654,9 +1297,17 @@ auto MasterService::PutStart(const UUID& client_id, const std::string& key,
             preferred_segments = config.preferred_segments;
         }
 
-        auto allocation_result = allocation_strategy_->Allocate(
-            allocator_manager, slice_length, config.replica_num,
-            preferred_segments);
+        // Striped and erasure coded replicas are spread over segments, so
+        // they ignore the preferred segments.
+        auto allocation_result =
+            config.stripe_num > 1 || config.parity_num > 0
+                ? allocation_strategy_->AllocateStriped(
+                      allocator_manager, slice_length, config.replica_num,
+                      config.stripe_num, config.parity_num)
+                : allocation_strategy_->AllocateSpread(
+                      allocator_manager, slice_length, config.replica_num,
+                      preferred_segments,
+                      allocator_access.getClientFailureDomain(client_id));
 
         if (!allocation_result.has_value()) {
             VLOG(1) << "Failed to allocate all replicas for key=" << key
@@ -675,35 +1326,174 @@ auto MasterService::PutStart(const UUID& client_id, const std::string& key,
     if (use_disk_replica_) {
         // Allocate a file path for the disk replica
         std::string file_path = ResolvePath(key);
-        replicas.emplace_back(file_path, total_length,
+        replicas.emplace_back(file_path, slice_length,
                               ReplicaStatus::PROCESSING);
     }
+    return replicas;
+}
+
+auto MasterService::DedupPutStart(const UUID& client_id,
+                                  const std::string& key,
+                                  uint64_t slice_length,
+                                  const ReplicateConfig& config)
+    -> std::optional<
+        tl::expected<std::vector<Replica::Descriptor>, ErrorCode>> {
+    const std::string content_key =
+        std::string(kDedupKeyPrefix) + config.content_hash;
+
+    // Take the key as an alias with a reference to the content first, so
+    // that the content is not removed under it
+    {
+        MetadataShardAccessorRW shard(this, getShardIndex(key));
+        if (shard->metadata.contains(key) ||
+            !shard->dedup_aliases.emplace(key, content_key).second) {
+            return std::nullopt;
+        }
+        std::lock_guard lock(dedup_mutex_);
+        ++dedup_refs_[content_key];
+    }
 
-    std::vector<Replica::Descriptor> replica_list;
-    replica_list.reserve(replicas.size());
-    for (const auto& replica : replicas) {
-        replica_list.emplace_back(replica.get_descriptor());
+    std::optional<tl::expected<std::vector<Replica::Descriptor>, ErrorCode>>
+        result;
+    {
+        MetadataShardAccessorRW shard(this, getShardIndex(content_key));
+        auto it = shard->metadata.find(content_key);
+        if (it != shard->metadata.end() &&
+            (!MayHaveStaleHandles(getShardIndex(content_key)) ||
+             !CleanupStaleHandles(it->second))) {
+            const auto& metadata = it->second;
+            if (metadata.size == slice_length && !metadata.in_processing &&
+                metadata.HasReplica(&Replica::fn_is_completed)) {
+                VLOG(1) << "key=" << key << ", content_key=" << content_key
+                        << ", action=put_start_deduplicated";
+                MasterMetricManager::instance().inc_dedup_hits(
+                    slice_length *
+                    metadata.CountReplicas(&Replica::fn_is_memory_replica));
+                NotifyPut(key);
+                return std::vector<Replica::Descriptor>{};
+            }
+            // Being written by another put, or a hash collision
+        } else {
+            // Drop what stale handle cleanup left of the content
+            if (it != shard->metadata.end()) {
+                shard->metadata.erase(it);
+            }
+            auto replicas =
+                AllocateReplicas(client_id, content_key, slice_length, config);
+            if (replicas.has_value()) {
+                std::vector<Replica::Descriptor> replica_list;
+                replica_list.reserve(replicas->size());
+                for (const auto& replica : *replicas) {
+                    replica_list.emplace_back(replica.get_descriptor());
+                }
+                auto emplaced = shard->metadata.emplace(
+                    std::piecewise_construct,
+                    std::forward_as_tuple(content_key),
+                    std::forward_as_tuple(client_id,
+                                          std::chrono::steady_clock::now(),
+                                          slice_length, std::move(*replicas),
+                                          config.with_soft_pin,
+                                          tenants_.Find(key)));
+                emplaced.first->second.in_processing = true;
+                emplaced.first->second.cost_hint = config.cost_hint;
+                UpdateTracking(shard->metadata, emplaced.first);
+                return replica_list;
+            }
+            result = tl::make_unexpected(replicas.error());
+        }
     }
 
-    // No need to set lease here. The object will not be evicted until
-    // PutEnd is called.
-    shard->metadata.emplace(
-        std::piecewise_construct, std::forward_as_tuple(key),
-        std::forward_as_tuple(client_id, now, total_length, std::move(replicas),
-                              config.with_soft_pin));
-    // Also insert the metadata into processing set for monitoring.
-    shard->processing_keys.insert(key);
+    // Not deduplicated after all, give the key back
+    if (!RemoveDedupAlias(key, content_key).empty()) {
+        ReleaseDedupReference(content_key, false);
+    }
+    return result;
+}
 
-    return replica_list;
+std::string MasterService::ResolveDedupAlias(const std::string& key) const {
+    MetadataShardAccessorRO shard(this, getShardIndex(key));
+    auto it = shard->dedup_aliases.find(key);
+    return it == shard->dedup_aliases.end() ? std::string() : it->second;
 }
 
-auto MasterService::PutEnd(const UUID& client_id, const std::string& key,
-                           ReplicaType replica_type)
-    -> tl::expected<void, ErrorCode> {
-    MetadataAccessorRW accessor(this, key);
-    if (!accessor.Exists()) {
-        LOG(ERROR) << "key=" << key << ", error=object_not_found";
-        return tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
+std::string MasterService::RemoveDedupAlias(const std::string& key,
+                                            const std::string& content_key) {
+    MetadataShardAccessorRW shard(this, getShardIndex(key));
+    auto it = shard->dedup_aliases.find(key);
+    if (it == shard->dedup_aliases.end() ||
+        (!content_key.empty() && it->second != content_key)) {
+        return std::string();
+    }
+    std::string removed = std::move(it->second);
+    shard->dedup_aliases.erase(it);
+    return removed;
+}
+
+void MasterService::DropStaleDedupAlias(const std::string& key) {
+    const std::string content_key = ResolveDedupAlias(key);
+    if (content_key.empty()) {
+        return;
+    }
+    {
+        MetadataAccessorRO accessor(this, content_key);
+        if (accessor.Exists()) {
+            return;
+        }
+    }
+    if (!RemoveDedupAlias(key, content_key).empty()) {
+        ReleaseDedupReference(content_key, false);
+    }
+}
+
+void MasterService::ReleaseDedupReference(const std::string& content_key,
+                                          bool force) {
+    MetadataAccessorRW accessor(this, content_key);
+    {
+        std::lock_guard lock(dedup_mutex_);
+        auto it = dedup_refs_.find(content_key);
+        if (it != dedup_refs_.end() && --it->second > 0) {
+            return;
+        }
+        if (it != dedup_refs_.end()) {
+            dedup_refs_.erase(it);
+        }
+    }
+    if (!accessor.Exists()) {
+        return;
+    }
+    // Skipped like Remove() does, and then left to eviction
+    const auto& metadata = accessor.Get();
+    if ((!force && !metadata.IsLeaseExpired()) ||
+        !metadata.AllReplicas(&Replica::fn_is_completed) ||
+        accessor.HasReplicationTask()) {
+        VLOG(1) << "content_key=" << content_key
+                << ", info=unreferenced_content_in_use";
+        return;
+    }
+    accessor.Erase();
+    LogObject(content_key, nullptr);
+}
+
+auto MasterService::PutEnd(const UUID& client_id, const std::string& key,
+                           ReplicaType replica_type,
+                           std::optional<uint32_t> checksum)
+    -> tl::expected<void, ErrorCode> {
+    if (enable_dedup_) {
+        // The first put of deduplicated content writes its content key
+        const std::string content_key = ResolveDedupAlias(key);
+        if (!content_key.empty()) {
+            auto result =
+                PutEnd(client_id, content_key, replica_type, checksum);
+            if (result) {
+                NotifyPut(key);
+            }
+            return result;
+        }
+    }
+    MetadataAccessorRW accessor(this, key);
+    if (!accessor.Exists()) {
+        LOG(ERROR) << "key=" << key << ", error=object_not_found";
+        return tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
     }
 
     auto& metadata = accessor.Get();
@@ -713,13 +1503,25 @@ auto MasterService::PutEnd(const UUID& client_id, const std::string& key,
         return tl::make_unexpected(ErrorCode::ILLEGAL_CLIENT);
     }
 
+    if (checksum) {
+        if (metadata.checksum && *metadata.checksum != *checksum) {
+            LOG(WARNING) << "key=" << key << ", replica_type=" << replica_type
+                         << ", warn=checksum_changed";
+        }
+        metadata.checksum = checksum;
+    }
     metadata.VisitReplicas(
         [replica_type](const Replica& replica) {
             return replica.type() == replica_type;
         },
         [](Replica& replica) { replica.mark_complete(); });
+    if (replica_type == ReplicaType::MEMORY) {
+        // Every chunk of a streamed put is readable now
+        metadata.stream.reset();
+    }
 
-    if (enable_offload_) {
+    // With heat driven demotion, objects are only offloaded when evicted
+    if (enable_offload_ && tiering_demote_access_count_ == 0) {
         metadata.VisitReplicas(&Replica::fn_is_completed,
                                [this, &key](const Replica& replica) {
                                    PushOffloadingQueue(key, replica);
@@ -741,9 +1543,133 @@ auto MasterService::PutEnd(const UUID& client_id, const std::string& key,
     // at beginning. 2. If this object has soft pin enabled, set it to be soft
     // pinned.
     metadata.GrantLease(0, default_kv_soft_pin_ttl_);
+    LogObject(key, &metadata);
+    NotifyPut(key);
+    return {};
+}
+
+auto MasterService::StreamPutStart(const UUID& client_id,
+                                   const std::string& key,
+                                   const std::vector<uint64_t>& chunk_lengths,
+                                   const ReplicateConfig& config)
+    -> tl::expected<std::vector<Replica::Descriptor>, ErrorCode> {
+    // Chunks are read at their offset in the replica, so the replicas must
+    // be one contiguous buffer each
+    if (chunk_lengths.empty() || chunk_lengths.size() > kMaxStreamChunks ||
+        config.stripe_num > 1 || config.parity_num > 0) {
+        LOG(ERROR) << "key=" << key << ", chunk_count=" << chunk_lengths.size()
+                   << ", config=" << config << ", error=invalid_stream_params";
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    uint64_t total_length = 0;
+    for (const auto length : chunk_lengths) {
+        if (length == 0) {
+            LOG(ERROR) << "key=" << key << ", error=empty_stream_chunk";
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        total_length += length;
+    }
+
+    // Readers of a streamed object follow its own commits, so it is not
+    // deduplicated
+    ReplicateConfig stream_config = config;
+    stream_config.content_hash.clear();
+    auto result = PutStart(client_id, key, total_length, stream_config);
+    if (!result) {
+        return result;
+    }
+
+    MetadataAccessorRW accessor(this, key);
+    if (!accessor.Exists() || accessor.Get().client_id != client_id) {
+        // Discarded by a PutStart of another client in between
+        return tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
+    }
+    auto stream = std::make_unique<ObjectMetadata::StreamState>();
+    stream->chunk_lengths = chunk_lengths;
+    stream->committed.assign((chunk_lengths.size() + 63) / 64, 0);
+    accessor.Get().stream = std::move(stream);
+    return result;
+}
+
+auto MasterService::StreamPutCommit(const UUID& client_id,
+                                    const std::string& key,
+                                    uint64_t first_chunk, uint64_t num_chunks)
+    -> tl::expected<void, ErrorCode> {
+    MetadataAccessorRW accessor(this, key);
+    if (!accessor.Exists()) {
+        LOG(ERROR) << "key=" << key << ", error=object_not_found";
+        return tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
+    }
+
+    auto& metadata = accessor.Get();
+    if (client_id != metadata.client_id) {
+        LOG(ERROR) << "Illegal client " << client_id
+                   << " to StreamPutCommit key " << key
+                   << ", was PutStart-ed by " << metadata.client_id;
+        return tl::make_unexpected(ErrorCode::ILLEGAL_CLIENT);
+    }
+    if (!metadata.stream) {
+        LOG(ERROR) << "key=" << key << ", error=object_not_streamed";
+        return tl::make_unexpected(ErrorCode::INVALID_WRITE);
+    }
+    auto& stream = *metadata.stream;
+    if (num_chunks == 0 || first_chunk >= stream.chunk_lengths.size() ||
+        num_chunks > stream.chunk_lengths.size() - first_chunk) {
+        LOG(ERROR) << "key=" << key << ", first_chunk=" << first_chunk
+                   << ", num_chunks=" << num_chunks
+                   << ", chunk_count=" << stream.chunk_lengths.size()
+                   << ", error=invalid_stream_chunks";
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    for (uint64_t i = first_chunk; i < first_chunk + num_chunks; ++i) {
+        stream.committed[i / 64] |= 1ULL << (i % 64);
+    }
     return {};
 }
 
+auto MasterService::GetStreamReplicaList(const std::string& key)
+    -> tl::expected<GetStreamReplicaListResponse, ErrorCode> {
+    MetadataAccessorRO accessor(this, key);
+    if (!accessor.Exists()) {
+        VLOG(1) << "key=" << key << ", info=object_not_found";
+        return tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
+    }
+
+    const auto& metadata = accessor.Get();
+    GetStreamReplicaListResponse response;
+    if (!metadata.stream) {
+        MasterMetricManager::instance().inc_total_get_nums();
+        auto result = GetReplicaList(key, metadata, getShardIndex(key),
+                                     std::chrono::steady_clock::now());
+        if (!result) {
+            return tl::make_unexpected(result.error());
+        }
+        response.replicas = std::move(result->replicas);
+        response.lease_ttl_ms = result->lease_ttl_ms;
+        return response;
+    }
+
+    // The memory replicas are still being written to; the reader only
+    // transfers the committed chunks
+    metadata.VisitReplicas(
+        [](const Replica& replica) {
+            return replica.is_memory_replica() && replica.is_processing();
+        },
+        [&response](const Replica& replica) {
+            response.replicas.emplace_back(replica.get_descriptor());
+        });
+    if (response.replicas.empty()) {
+        return tl::make_unexpected(ErrorCode::REPLICA_IS_NOT_READY);
+    }
+    response.chunk_lengths = metadata.stream->chunk_lengths;
+    response.committed = metadata.stream->committed;
+    // Keeps the object from being removed right after its PutEnd while it
+    // is read
+    metadata.GrantLease(default_kv_lease_ttl_, default_kv_soft_pin_ttl_);
+    response.lease_ttl_ms = default_kv_lease_ttl_;
+    return response;
+}
+
 auto MasterService::AddReplica(const UUID& client_id, const std::string& key,
                                Replica& replica)
     -> tl::expected<void, ErrorCode> {
@@ -761,10 +1687,14 @@ auto MasterService::AddReplica(const UUID& client_id, const std::string& key,
         return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
     }
 
+    // A pending demotion is done, the memory replicas may be evicted
+    metadata.demotion_start.reset();
+
     if (!metadata.HasReplica(&Replica::fn_is_local_disk_replica)) {
         std::vector<Replica> replicas;
         replicas.emplace_back(std::move(replica));
         metadata.AddReplicas(std::move(replicas));
+        LogObject(key, &metadata);
         return {};
     }
 
@@ -785,12 +1715,23 @@ auto MasterService::AddReplica(const UUID& client_id, const std::string& key,
                     .get_local_disk_descriptor()
                     .object_size;
         });
+    LogObject(key, &metadata);
     return {};
 }
 
 auto MasterService::PutRevoke(const UUID& client_id, const std::string& key,
                               ReplicaType replica_type)
     -> tl::expected<void, ErrorCode> {
+    if (enable_dedup_) {
+        const std::string content_key = ResolveDedupAlias(key);
+        if (!content_key.empty()) {
+            auto result = PutRevoke(client_id, content_key, replica_type);
+            if (result && !RemoveDedupAlias(key, content_key).empty()) {
+                ReleaseDedupReference(content_key, false);
+            }
+            return result;
+        }
+    }
     MetadataAccessorRW accessor(this, key);
     if (!accessor.Exists()) {
         LOG(INFO) << "key=" << key << ", info=object_not_found";
@@ -820,6 +1761,9 @@ auto MasterService::PutRevoke(const UUID& client_id, const std::string& key,
         MasterMetricManager::instance().dec_file_cache_nums();
     }
 
+    if (replica_type == ReplicaType::MEMORY) {
+        metadata.stream.reset();
+    }
     metadata.EraseReplicas([replica_type](const Replica& replica) {
         return replica.type() == replica_type;
     });
@@ -837,11 +1781,20 @@ auto MasterService::PutRevoke(const UUID& client_id, const std::string& key,
 }
 
 std::vector<tl::expected<void, ErrorCode>> MasterService::BatchPutEnd(
-    const UUID& client_id, const std::vector<std::string>& keys) {
+    const UUID& client_id, const std::vector<std::string>& keys,
+    const std::vector<uint32_t>& checksums) {
     std::vector<tl::expected<void, ErrorCode>> results;
     results.reserve(keys.size());
-    for (const auto& key : keys) {
-        results.emplace_back(PutEnd(client_id, key, ReplicaType::MEMORY));
+    if (!checksums.empty() && checksums.size() != keys.size()) {
+        results.assign(keys.size(),
+                       tl::make_unexpected(ErrorCode::INVALID_PARAMS));
+        return results;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        results.emplace_back(PutEnd(
+            client_id, keys[i], ReplicaType::MEMORY,
+            checksums.empty() ? std::nullopt
+                              : std::optional<uint32_t>(checksums[i])));
     }
     return results;
 }
@@ -856,6 +1809,209 @@ std::vector<tl::expected<void, ErrorCode>> MasterService::BatchPutRevoke(
     return results;
 }
 
+auto MasterService::GrantPutLease(const UUID& client_id,
+                                  uint64_t slice_length, uint64_t slot_count,
+                                  const ReplicateConfig& config)
+    -> tl::expected<PutLease, ErrorCode> {
+    if (put_lease_ttl_.count() == 0 || use_disk_replica_ || oplog_) {
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_MODE);
+    }
+    if (config.replica_num == 0 || slice_length == 0 || slot_count == 0 ||
+        config.stripe_num > 1 || config.parity_num > 0 ||
+        !config.content_hash.empty() ||
+        (memory_allocator_type_ == BufferAllocatorType::CACHELIB &&
+         slice_length > kMaxSliceSize)) {
+        LOG(ERROR) << "client_id=" << client_id
+                   << ", slice_length=" << slice_length
+                   << ", slot_count=" << slot_count << ", config=" << config
+                   << ", error=invalid_put_lease";
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    slot_count = std::min(slot_count, kMaxPutLeaseSlots);
+
+    PutLease granted;
+    granted.slice_length = slice_length;
+    granted.ttl_ms = put_lease_ttl_.count();
+    PutLeaseState lease{client_id, slice_length,
+                        std::chrono::steady_clock::now() + put_lease_ttl_,
+                        {}};
+    for (uint64_t i = 0; i < slot_count; ++i) {
+        auto replicas = AllocateReplicas(client_id, "", slice_length, config);
+        if (!replicas.has_value()) {
+            if (i == 0) {
+                return tl::make_unexpected(replicas.error());
+            }
+            // Grant what fits rather than fail
+            break;
+        }
+        std::vector<Replica::Descriptor> descriptors;
+        descriptors.reserve(replicas->size());
+        for (const auto& replica : *replicas) {
+            descriptors.emplace_back(replica.get_descriptor());
+        }
+        granted.slots.push_back(std::move(descriptors));
+        lease.slots.emplace_back(std::move(*replicas));
+    }
+
+    std::lock_guard lock(put_leases_mutex_);
+    granted.lease_id = next_put_lease_id_++;
+    put_leases_.emplace(granted.lease_id, std::move(lease));
+    VLOG(1) << "client_id=" << client_id << ", lease_id=" << granted.lease_id
+            << ", slice_length=" << slice_length
+            << ", slots=" << granted.slots.size()
+            << ", action=put_lease_granted";
+    return granted;
+}
+
+std::vector<tl::expected<void, ErrorCode>> MasterService::BatchLeasedPutEnd(
+    const UUID& client_id, const std::vector<LeasedPut>& puts) {
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<tl::expected<void, ErrorCode>> results(puts.size());
+    std::vector<std::vector<Replica>> slots(puts.size());
+    std::vector<uint64_t> sizes(puts.size(), 0);
+    {
+        std::lock_guard lock(put_leases_mutex_);
+        for (size_t i = 0; i < puts.size(); ++i) {
+            auto it = put_leases_.find(puts[i].lease_id);
+            // Expired leases are left to SweepPutLeases
+            if (it == put_leases_.end() || it->second.expire_time <= now) {
+                results[i] = tl::make_unexpected(ErrorCode::LEASE_EXPIRED);
+                continue;
+            }
+            auto& lease = it->second;
+            if (lease.client_id != client_id) {
+                results[i] = tl::make_unexpected(ErrorCode::ILLEGAL_CLIENT);
+                continue;
+            }
+            if (puts[i].slot >= lease.slots.size() ||
+                !lease.slots[puts[i].slot].has_value()) {
+                results[i] = tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+                continue;
+            }
+            slots[i] = std::move(*lease.slots[puts[i].slot]);
+            lease.slots[puts[i].slot].reset();
+            sizes[i] = lease.slice_length;
+        }
+    }
+
+    for (size_t i = 0; i < puts.size(); ++i) {
+        if (!results[i].has_value()) {
+            continue;
+        }
+        const auto& key = puts[i].key;
+        // The slot was written already, so its replicas are freed at once
+        // if the put fails
+        if (key.empty() || (enable_dedup_ && IsDedupContentKey(key))) {
+            LOG(ERROR) << "key=" << key << ", error=invalid_leased_put";
+            results[i] = tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+            continue;
+        }
+        if (std::any_of(slots[i].begin(), slots[i].end(),
+                        [](const Replica& replica) {
+                            return replica.has_invalid_mem_handle();
+                        })) {
+            LOG(WARNING) << "key=" << key << ", error=leased_segment_gone";
+            results[i] = tl::make_unexpected(ErrorCode::INVALID_REPLICA);
+            continue;
+        }
+        if (enable_dedup_) {
+            DropStaleDedupAlias(key);
+        }
+        {
+            MetadataShardAccessorRW shard(this, getShardIndex(key));
+            auto prepared = PrepareNewPut(shard, key, now);
+            if (!prepared) {
+                results[i] = tl::make_unexpected(prepared.error());
+                continue;
+            }
+            InsertNewPut(shard, client_id, key, sizes[i], std::move(slots[i]),
+                         puts[i].config, now);
+        }
+        results[i] = PutEnd(client_id, key, ReplicaType::MEMORY,
+                            puts[i].checksum);
+    }
+    return results;
+}
+
+auto MasterService::ReleasePutLease(const UUID& client_id, uint64_t lease_id)
+    -> tl::expected<void, ErrorCode> {
+    PutLeaseState lease;
+    {
+        std::lock_guard lock(put_leases_mutex_);
+        auto it = put_leases_.find(lease_id);
+        if (it == put_leases_.end()) {
+            return tl::make_unexpected(ErrorCode::LEASE_EXPIRED);
+        }
+        if (it->second.client_id != client_id) {
+            return tl::make_unexpected(ErrorCode::ILLEGAL_CLIENT);
+        }
+        lease = std::move(it->second);
+        put_leases_.erase(it);
+    }
+    DiscardPutLease(std::move(lease));
+    return {};
+}
+
+void MasterService::DiscardPutLease(PutLeaseState&& lease) {
+    std::vector<Replica> replicas;
+    for (auto& slot : lease.slots) {
+        if (!slot.has_value()) {
+            continue;
+        }
+        for (auto& replica : *slot) {
+            replicas.emplace_back(std::move(replica));
+        }
+    }
+    if (replicas.empty()) {
+        return;
+    }
+    std::lock_guard lock(discarded_replicas_mutex_);
+    discarded_replicas_.emplace_back(
+        std::move(replicas),
+        std::chrono::steady_clock::now() + put_start_release_timeout_sec_);
+}
+
+void MasterService::SweepPutLeases(std::chrono::steady_clock::time_point now) {
+    std::vector<PutLeaseState> expired;
+    {
+        std::lock_guard lock(put_leases_mutex_);
+        for (auto it = put_leases_.begin(); it != put_leases_.end();) {
+            if (it->second.expire_time <= now) {
+                expired.emplace_back(std::move(it->second));
+                it = put_leases_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& lease : expired) {
+        DiscardPutLease(std::move(lease));
+    }
+}
+
+void MasterService::ReleaseClientPutLeases(
+    const std::vector<UUID>& client_ids) {
+    if (client_ids.empty()) {
+        return;
+    }
+    std::vector<PutLeaseState> released;
+    {
+        std::lock_guard lock(put_leases_mutex_);
+        for (auto it = put_leases_.begin(); it != put_leases_.end();) {
+            if (std::find(client_ids.begin(), client_ids.end(),
+                          it->second.client_id) != client_ids.end()) {
+                released.emplace_back(std::move(it->second));
+                it = put_leases_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& lease : released) {
+        DiscardPutLease(std::move(lease));
+    }
+}
+
 tl::expected<CopyStartResponse, ErrorCode> MasterService::CopyStart(
     const UUID& client_id, const std::string& key,
     const std::string& src_segment,
@@ -873,13 +2029,29 @@ tl::expected<CopyStartResponse, ErrorCode> MasterService::CopyStart(
     }
 
     auto& metadata = accessor.Get();
-    auto source = metadata.GetReplicaBySegmentName(src_segment);
+    // An empty source segment promotes the object from disk to memory
+    const bool promote = src_segment.empty();
+    Replica* source = nullptr;
+    if (promote) {
+        source = metadata.GetFirstReplica([](const Replica& replica) {
+            return (replica.is_disk_replica() ||
+                    replica.is_local_disk_replica()) &&
+                   replica.is_completed();
+        });
+    } else {
+        source = metadata.GetReplicaBySegmentName(src_segment);
+    }
     if (source == nullptr || !source->is_completed() ||
         source->has_invalid_mem_handle()) {
         LOG(ERROR) << "key=" << key << ", src_segment=" << src_segment
                    << ", replica not found or not valid";
         return tl::make_unexpected(ErrorCode::REPLICA_NOT_FOUND);
     }
+    if (source->is_striped()) {
+        LOG(ERROR) << "key=" << key << ", src_segment=" << src_segment
+                   << ", striped replicas cannot be copied or moved";
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
 
     std::vector<Replica> replicas;
     replicas.reserve(tgt_segments.size());
@@ -888,20 +2060,35 @@ tl::expected<CopyStartResponse, ErrorCode> MasterService::CopyStart(
             segment_manager_.getAllocatorAccess();
         const auto& allocator_manager = allocator_access.getAllocatorManager();
 
-        for (auto& tgt_segment : tgt_segments) {
-            if (metadata.GetReplicaBySegmentName(tgt_segment) != nullptr) {
-                // Skip used segments.
-                continue;
+        if (promote) {
+            // Nothing to do if someone else promoted it already
+            if (!metadata.HasReplica(&Replica::fn_is_memory_replica)) {
+                auto allocated = allocation_strategy_->Allocate(
+                    allocator_manager, metadata.size, 1, tgt_segments);
+                if (!allocated.has_value()) {
+                    VLOG(1) << "key=" << key
+                            << ", failed to allocate promoted replica";
+                    return tl::make_unexpected(allocated.error());
+                }
+                replicas = std::move(allocated.value());
             }
+        } else {
+            for (auto& tgt_segment : tgt_segments) {
+                if (metadata.GetReplicaBySegmentName(tgt_segment) != nullptr) {
+                    // Skip used segments.
+                    continue;
+                }
 
-            auto replica = allocation_strategy_->AllocateFrom(
-                allocator_manager, metadata.size, tgt_segment);
-            if (!replica.has_value()) {
-                LOG(ERROR) << "key=" << key << ", tgt_segment=" << tgt_segment
-                           << ", failed to allocate replica";
-                return tl::make_unexpected(replica.error());
+                auto replica = allocation_strategy_->AllocateFrom(
+                    allocator_manager, metadata.size, tgt_segment);
+                if (!replica.has_value()) {
+                    LOG(ERROR) << "key=" << key
+                               << ", tgt_segment=" << tgt_segment
+                               << ", failed to allocate replica";
+                    return tl::make_unexpected(replica.error());
+                }
+                replicas.push_back(std::move(*replica));
             }
-            replicas.push_back(std::move(*replica));
         }
     }
 
@@ -917,12 +2104,9 @@ tl::expected<CopyStartResponse, ErrorCode> MasterService::CopyStart(
     }
 
     // Create replication task for tracking.
-    auto& shard = accessor.GetShard();
-    shard->replication_tasks.emplace(
-        std::piecewise_construct, std::forward_as_tuple(key),
-        std::forward_as_tuple(client_id, std::chrono::steady_clock::now(),
-                              ReplicationTask::Type::COPY, source->id(),
-                              std::move(replica_ids)));
+    accessor.SetReplicationTask({client_id, std::chrono::steady_clock::now(),
+                                 ReplicationTask::Type::COPY, source->id(),
+                                 std::move(replica_ids)});
 
     // Increase source refcnt to protect it from eviction.
     source->inc_refcnt();
@@ -999,6 +2183,7 @@ tl::expected<void, ErrorCode> MasterService::CopyEnd(const UUID& client_id,
     }
 
     accessor.EraseReplicationTask();
+    LogObject(key, &metadata);
 
     return all_complete ? tl::expected<void, ErrorCode>()
                         : tl::make_unexpected(ErrorCode::REPLICA_IS_GONE);
@@ -1085,6 +2270,11 @@ tl::expected<MoveStartResponse, ErrorCode> MasterService::MoveStart(
                    << ", replica not found or not completed";
         return tl::make_unexpected(ErrorCode::REPLICA_NOT_FOUND);
     }
+    if (source->is_striped()) {
+        LOG(ERROR) << "key=" << key << ", src_segment=" << src_segment
+                   << ", striped replicas cannot be copied or moved";
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
 
     std::vector<Replica> replicas;
     if (metadata.GetReplicaBySegmentName(tgt_segment) == nullptr) {
@@ -1114,12 +2304,9 @@ tl::expected<MoveStartResponse, ErrorCode> MasterService::MoveStart(
     }
 
     // Create replication task for tracking.
-    auto& shard = accessor.GetShard();
-    shard->replication_tasks.emplace(
-        std::piecewise_construct, std::forward_as_tuple(key),
-        std::forward_as_tuple(client_id, std::chrono::steady_clock::now(),
-                              ReplicationTask::Type::MOVE, source->id(),
-                              std::move(replica_ids)));
+    accessor.SetReplicationTask({client_id, std::chrono::steady_clock::now(),
+                                 ReplicationTask::Type::MOVE, source->id(),
+                                 std::move(replica_ids)});
 
     // Increase source refcnt to protect it from eviction.
     source->inc_refcnt();
@@ -1212,6 +2399,7 @@ tl::expected<void, ErrorCode> MasterService::MoveEnd(const UUID& client_id,
     }
 
     accessor.EraseReplicationTask();
+    LogObject(key, &metadata);
 
     return {};
 }
@@ -1270,6 +2458,18 @@ tl::expected<void, ErrorCode> MasterService::MoveRevoke(
 
 auto MasterService::Remove(const std::string& key, bool force)
     -> tl::expected<void, ErrorCode> {
+    if (enable_dedup_) {
+        if (IsDedupContentKey(key)) {
+            LOG(ERROR) << "key=" << key << ", error=reserved_key_prefix";
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        // Only the last key referring to content frees it
+        const std::string content_key = RemoveDedupAlias(key);
+        if (!content_key.empty()) {
+            ReleaseDedupReference(content_key, force);
+            return {};
+        }
+    }
     MetadataAccessorRW accessor(this, key);
     if (!accessor.Exists()) {
         VLOG(1) << "key=" << key << ", error=object_not_found";
@@ -1301,6 +2501,7 @@ auto MasterService::Remove(const std::string& key, bool force)
 
     // Remove object metadata
     accessor.Erase();
+    LogObject(key, nullptr);
     return {};
 }
 
@@ -1317,48 +2518,73 @@ auto MasterService::RemoveByRegex(const std::string& regex_pattern, bool force)
         return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
     }
 
+    const auto prefix = enable_prefix_index_
+                            ? GetRegexLiteralPrefix(regex_pattern)
+                            : std::nullopt;
+
+    // Content keys of the removed deduplicated keys
+    std::vector<std::string> released_content_keys;
     for (size_t i = 0; i < kNumShards; ++i) {
         MetadataShardAccessorRW shard(this, i);
 
-        for (auto it = shard->metadata.begin(); it != shard->metadata.end();) {
-            if (std::regex_search(it->first, pattern)) {
-                if (!force && !it->second.IsLeaseExpired()) {
-                    VLOG(1) << "key=" << it->first
-                            << " matched by regex, but has lease. Skipping "
-                            << "removal.";
-                    ++it;
-                    continue;
-                }
-                /**
-                 * The reason the force operation here does not bypass the
-                 * replica check is that put operations (which could also be
-                 * copy or move) and remove operations might be happening
-                 * concurrently, making it extremely dangerous to perform a
-                 * direct removal at this point.
-                 */
-                if (!it->second.AllReplicas(&Replica::fn_is_completed)) {
-                    LOG(WARNING) << "key=" << it->first
-                                 << " matched by regex, but not all replicas "
-                                    "are complete. Skipping removal.";
-                    ++it;
-                    continue;
-                }
-                if (metadata_shards_[i].replication_tasks.contains(it->first)) {
-                    LOG(WARNING) << "key=" << it->first
-                                 << ", matched by regex, but has replication "
-                                    "task. Skipping removal.";
-                    ++it;
-                    continue;
-                }
-
+        // Erasing an entry does not invalidate the iterators to the others.
+        auto try_remove = [&](ObjectMetadataMap::iterator it) {
+            if (!std::regex_search(it->first, pattern) ||
+                (enable_dedup_ && IsDedupContentKey(it->first))) {
+                return;
+            }
+            if (!force && !it->second.IsLeaseExpired()) {
                 VLOG(1) << "key=" << it->first
-                        << " matched by regex. Removing.";
-                it = shard->metadata.erase(it);
-                removed_count++;
-            } else {
-                ++it;
+                        << " matched by regex, but has lease. Skipping "
+                        << "removal.";
+                return;
+            }
+            /**
+             * The reason the force operation here does not bypass the
+             * replica check is that put operations (which could also be
+             * copy or move) and remove operations might be happening
+             * concurrently, making it extremely dangerous to perform a
+             * direct removal at this point.
+             */
+            if (!it->second.AllReplicas(&Replica::fn_is_completed)) {
+                LOG(WARNING) << "key=" << it->first
+                             << " matched by regex, but not all replicas "
+                                "are complete. Skipping removal.";
+                return;
+            }
+            if (it->second.replication_task) {
+                LOG(WARNING) << "key=" << it->first
+                             << ", matched by regex, but has replication "
+                                "task. Skipping removal.";
+                return;
+            }
+
+            VLOG(1) << "key=" << it->first << " matched by regex. Removing.";
+            LogObject(it->first, nullptr);
+            shard->metadata.erase(it);
+            removed_count++;
+        };
+
+        if (prefix) {
+            for (auto it : shard->metadata.FindPrefix(*prefix)) {
+                try_remove(it);
+            }
+        } else {
+            for (auto it = shard->metadata.begin();
+                 it != shard->metadata.end();) {
+                try_remove(it++);
             }
         }
+        TakeDedupAliases(
+            shard, [&](const std::string& key) {
+                return std::regex_search(key, pattern);
+            },
+            released_content_keys);
+    }
+    // The content is locked after the shard of its aliases
+    removed_count += released_content_keys.size();
+    for (const auto& content_key : released_content_keys) {
+        ReleaseDedupReference(content_key, force);
     }
 
     VLOG(1) << "action=remove_by_regex, pattern=" << regex_pattern
@@ -1373,9 +2599,11 @@ long MasterService::RemoveAll(bool force) {
     // calling std::chrono::steady_clock::now()
     auto now = std::chrono::steady_clock::now();
 
+    // Content keys of the removed deduplicated keys
+    std::vector<std::string> released_content_keys;
     for (size_t i = 0; i < kNumShards; i++) {
         MetadataShardAccessorRW shard(this, i);
-        if (shard->metadata.empty()) {
+        if (shard->metadata.empty() && shard->dedup_aliases.empty()) {
             continue;
         }
 
@@ -1390,16 +2618,24 @@ long MasterService::RemoveAll(bool force) {
              */
             if ((force || it->second.IsLeaseExpired(now)) &&
                 it->second.AllReplicas(&Replica::fn_is_completed) &&
-                !shard->replication_tasks.contains(it->first)) {
+                !it->second.replication_task) {
                 auto mem_rep_count =
                     it->second.CountReplicas(&Replica::fn_is_memory_replica);
                 total_freed_size += it->second.size * mem_rep_count;
+                LogObject(it->first, nullptr);
                 it = shard->metadata.erase(it);
                 removed_count++;
             } else {
                 ++it;
             }
         }
+        TakeDedupAliases(
+            shard, [](const std::string&) { return true; },
+            released_content_keys);
+    }
+    removed_count += released_content_keys.size();
+    for (const auto& content_key : released_content_keys) {
+        ReleaseDedupReference(content_key, force);
     }
 
     VLOG(1) << "action=remove_all_objects"
@@ -1408,6 +2644,63 @@ long MasterService::RemoveAll(bool force) {
     return removed_count;
 }
 
+long MasterService::RemoveUnownedObjects(
+    const std::function<bool(const std::string& key)>& owned, long& kept) {
+    long removed_count = 0;
+    kept = 0;
+    auto now = std::chrono::steady_clock::now();
+
+    // Content keys are owned by the master of their aliases, they go with
+    // the last alias
+    std::vector<std::string> released_content_keys;
+    for (size_t i = 0; i < kNumShards; i++) {
+        MetadataShardAccessorRW shard(this, i);
+        for (auto it = shard->metadata.begin(); it != shard->metadata.end();) {
+            if ((enable_dedup_ && IsDedupContentKey(it->first)) ||
+                owned(it->first)) {
+                ++it;
+                continue;
+            }
+            if (!it->second.IsLeaseExpired(now) ||
+                !it->second.AllReplicas(&Replica::fn_is_completed) ||
+                it->second.replication_task) {
+                kept++;
+                ++it;
+                continue;
+            }
+            LogObject(it->first, nullptr);
+            it = shard->metadata.erase(it);
+            removed_count++;
+        }
+        TakeDedupAliases(
+            shard, [&](const std::string& key) { return !owned(key); },
+            released_content_keys);
+    }
+    removed_count += released_content_keys.size();
+    for (const auto& content_key : released_content_keys) {
+        ReleaseDedupReference(content_key, false);
+    }
+
+    VLOG(1) << "action=remove_unowned_objects"
+            << ", removed_count=" << removed_count << ", kept=" << kept;
+    return removed_count;
+}
+
+void MasterService::TakeDedupAliases(
+    MetadataShardAccessorRW& shard,
+    const std::function<bool(const std::string& key)>& pred,
+    std::vector<std::string>& content_keys) {
+    for (auto it = shard->dedup_aliases.begin();
+         it != shard->dedup_aliases.end();) {
+        if (pred(it->first)) {
+            content_keys.push_back(std::move(it->second));
+            it = shard->dedup_aliases.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 bool MasterService::CleanupStaleHandles(ObjectMetadata& metadata) {
     // Remove those with invalid allocators
     metadata.EraseReplicas([](const Replica& replica) {
@@ -1427,24 +2720,1811 @@ size_t MasterService::GetKeyCount() const {
     return total;
 }
 
-auto MasterService::Ping(const UUID& client_id)
-    -> tl::expected<PingResponse, ErrorCode> {
-    std::shared_lock<std::shared_mutex> lock(client_mutex_);
-    ClientStatus client_status;
-    auto it = ok_client_.find(client_id);
-    if (it != ok_client_.end()) {
-        client_status = ClientStatus::OK;
-    } else {
+namespace {
+
+// Layout of a snapshot file: a SnapshotFileHeader, followed by num_sections
+// SnapshotSection entries and the data of each section. Section 0 holds the
+// segments, section 1 the discarded replicas that still own allocations and
+// section 2 + i the objects of metadata shard i.
+constexpr uint64_t kSnapshotMagic = 0x50414e534b4f4f4dULL;  // "MOOKSNAP"
+constexpr uint32_t kSnapshotVersion = 4;
+constexpr size_t kSnapshotSegmentSection = 0;
+constexpr size_t kSnapshotDiscardedSection = 1;
+constexpr size_t kSnapshotFirstShardSection = 2;
+// Keys are restored into the shard they were saved from, so the key hash
+// must not change between the writer and the reader.
+constexpr const char* kSnapshotHashProbe = "mooncake_snapshot_hash_probe";
+
+struct SnapshotFileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t num_sections;
+    uint64_t hash_probe;
+    uint64_t file_size;
+};
+
+struct SnapshotSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+size_t GetSnapshotThreadNum(size_t num_tasks) {
+    size_t thread_num = std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(thread_num, num_tasks));
+}
+
+// Runs fn(i) for every i in [0, num_tasks) on GetSnapshotThreadNum() threads.
+template <typename Fn>
+void ParallelForEach(size_t num_tasks, Fn&& fn) {
+    const size_t thread_num = GetSnapshotThreadNum(num_tasks);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_num);
+    for (size_t t = 0; t < thread_num; t++) {
+        threads.emplace_back([&fn, t, thread_num, num_tasks]() {
+            for (size_t i = t; i < num_tasks; i += thread_num) {
+                fn(i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Serializes a section with the two-pass approach of serializer.h.
+// serialize_fn is invoked with a SerializeSizeCounter and a SerializeWriter.
+template <typename Fn>
+bool SerializeSection(Fn&& serialize_fn, std::vector<SerializedByte>& buffer) {
+    SerializeSizeCounter counter;
+    serialize_fn(counter);
+    if (counter.has_error()) {
+        LOG(ERROR) << "Serializing snapshot section failed, error="
+                   << counter.get_error();
+        return false;
+    }
+    buffer.resize(counter.get_size());
+    SerializeWriter writer(buffer.data(), buffer.size());
+    serialize_fn(writer);
+    if (writer.has_error() || !writer.finish_write()) {
+        LOG(ERROR) << "Serializing snapshot section failed, error="
+                   << writer.get_error();
+        return false;
+    }
+    return true;
+}
+
+// Unmaps a memory-mapped snapshot file on destruction.
+class SnapshotMapping {
+   public:
+    SnapshotMapping(void* addr, size_t size) : addr_(addr), size_(size) {}
+    ~SnapshotMapping() {
+        if (addr_ != MAP_FAILED) {
+            munmap(addr_, size_);
+        }
+    }
+    SnapshotMapping(const SnapshotMapping&) = delete;
+    SnapshotMapping& operator=(const SnapshotMapping&) = delete;
+
+    bool valid() const { return addr_ != MAP_FAILED; }
+    uint8_t* data() const { return static_cast<uint8_t*>(addr_); }
+    size_t size() const { return size_; }
+
+   private:
+    void* addr_;
+    size_t size_;
+};
+
+int64_t RemainingMs(const std::chrono::steady_clock::time_point& timeout,
+                    const std::chrono::steady_clock::time_point& now) {
+    return std::max<int64_t>(
+        0,
+        std::chrono::duration_cast<std::chrono::milliseconds>(timeout - now)
+            .count());
+}
+
+// Lay out the captured sections after the header and the section table.
+// Returns the total size of the snapshot.
+uint64_t BuildSnapshotLayout(
+    const std::vector<std::vector<SerializedByte>>& sections,
+    SnapshotFileHeader& header, std::vector<SnapshotSection>& table) {
+    const size_t num_sections = sections.size();
+    table.resize(num_sections);
+    uint64_t file_size =
+        sizeof(SnapshotFileHeader) + num_sections * sizeof(SnapshotSection);
+    for (size_t i = 0; i < num_sections; i++) {
+        table[i] = {file_size, sections[i].size()};
+        file_size += sections[i].size();
+    }
+    header = {kSnapshotMagic, kSnapshotVersion,
+              static_cast<uint32_t>(num_sections),
+              std::hash<std::string>{}(kSnapshotHashProbe), file_size};
+    return file_size;
+}
+
+// Copy the header, the section table and the sections into base, which must
+// be large enough to hold the whole snapshot.
+void WriteSnapshotImage(
+    uint8_t* base, const SnapshotFileHeader& header,
+    const std::vector<SnapshotSection>& table,
+    const std::vector<std::vector<SerializedByte>>& sections) {
+    std::memcpy(base, &header, sizeof(header));
+    std::memcpy(base + sizeof(header), table.data(),
+                table.size() * sizeof(SnapshotSection));
+    ParallelForEach(sections.size(), [&](size_t i) {
+        if (!sections[i].empty()) {
+            std::memcpy(base + table[i].offset, sections[i].data(),
+                        sections[i].size());
+        }
+    });
+}
+
+}  // namespace
+
+void MasterService::ClearInvalidHandles() {
+    const auto start_time = std::chrono::steady_clock::now();
+    std::atomic<size_t> swept_shards{0};
+    std::atomic<size_t> removed_objects{0};
+    ParallelForEach(kNumShards, [&](size_t i) {
+        // Buffers of segments unmounted before this generation are invalid
+        const uint64_t generation =
+            segment_generation_.load(std::memory_order_acquire);
+        MetadataShardAccessorRW shard(this, i);
+        if (shard->swept_generation == generation) {
+            return;
+        }
+        size_t removed = 0;
+        auto it = shard->metadata.begin();
+        while (it != shard->metadata.end()) {
+            if (CleanupStaleHandles(it->second)) {
+                // If the object is empty, we need to erase the iterator.
+                it = shard->metadata.erase(it);
+                removed++;
+            } else {
+                ++it;
+            }
+        }
+        shard->swept_generation = generation;
+        swept_shards.fetch_add(1, std::memory_order_relaxed);
+        removed_objects.fetch_add(removed, std::memory_order_relaxed);
+    });
+    VLOG(1) << "action=clear_invalid_handles, swept_shards="
+            << swept_shards.load() << ", removed_objects="
+            << removed_objects.load() << ", total_ms="
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start_time)
+                   .count();
+}
+
+void MasterService::RequestInvalidHandleSweep() {
+    {
+        std::lock_guard<std::mutex> lk(sweep_mutex_);
+        sweep_requested_ = true;
+    }
+    sweep_cv_.notify_one();
+}
+
+void MasterService::SweepThreadFunc() {
+    LOG(INFO) << "Sweep thread started";
+    while (sweep_running_) {
+        {
+            std::unique_lock<std::mutex> lk(sweep_mutex_);
+            sweep_cv_.wait(lk, [&] {
+                return sweep_requested_ || !sweep_running_.load();
+            });
+            sweep_requested_ = false;
+        }
+
+        if (!sweep_running_) {
+            break;
+        }
+        ClearInvalidHandles();
+    }
+    LOG(INFO) << "Sweep thread stopped";
+}
+
+template <typename T>
+void MasterService::SerializeShardTo(
+    T& serializer, const MetadataShard& shard,
+    const AllocatorIndex& allocator_index,
+    const std::chrono::steady_clock::time_point& now) const {
+    auto is_serializable = [&allocator_index](const Replica& replica) {
+        return replica.is_serializable(allocator_index);
+    };
+
+    uint64_t num_objects = shard.metadata.size();
+    serializer.write(&num_objects, sizeof(num_objects));
+    for (const auto& [key, metadata] : shard.metadata) {
+        int64_t lease_ms = 0;
+        int64_t soft_pin_ms = 0;
+        uint8_t has_soft_pin = 0;
+        lease_ms = RemainingMs(metadata.lease_timeout.load(), now);
+        if (metadata.has_soft_pin) {
+            has_soft_pin = 1;
+            soft_pin_ms = RemainingMs(metadata.soft_pin_timeout.load(), now);
+        }
+        uint64_t size = metadata.size;
+        uint8_t has_checksum = metadata.checksum ? 1 : 0;
+        uint32_t checksum = metadata.checksum.value_or(0);
+        uint64_t num_replicas = metadata.CountReplicas(is_serializable);
+
+        serialize_string(serializer, key);
+        serializer.write(&metadata.client_id.first,
+                         sizeof(metadata.client_id.first));
+        serializer.write(&metadata.client_id.second,
+                         sizeof(metadata.client_id.second));
+        serializer.write(&size, sizeof(size));
+        serializer.write(&lease_ms, sizeof(lease_ms));
+        serializer.write(&has_soft_pin, sizeof(has_soft_pin));
+        serializer.write(&soft_pin_ms, sizeof(soft_pin_ms));
+        serializer.write(&has_checksum, sizeof(has_checksum));
+        serializer.write(&checksum, sizeof(checksum));
+        serializer.write(&num_replicas, sizeof(num_replicas));
+        metadata.VisitReplicas(is_serializable,
+                               [&](const Replica& replica) {
+                                   replica.serialize_to(serializer,
+                                                        allocator_index);
+                               });
+    }
+}
+
+size_t MasterService::DeserializeShard(
+    SerializerReader& reader, MetadataShardAccessorRW& shard,
+    const std::vector<std::shared_ptr<OffsetBufferAllocator>>& allocators) {
+    const auto now = std::chrono::steady_clock::now();
+    size_t restored = 0;
+
+    uint64_t num_objects = 0;
+    reader.read(&num_objects, sizeof(num_objects));
+    for (uint64_t i = 0; i < num_objects; i++) {
+        UUID client_id;
+        uint64_t size = 0;
+        int64_t lease_ms = 0;
+        uint8_t has_soft_pin = 0;
+        int64_t soft_pin_ms = 0;
+        uint8_t has_checksum = 0;
+        uint32_t checksum = 0;
+        uint64_t num_replicas = 0;
+
+        std::string key = deserialize_string(reader);
+        reader.read(&client_id.first, sizeof(client_id.first));
+        reader.read(&client_id.second, sizeof(client_id.second));
+        reader.read(&size, sizeof(size));
+        reader.read(&lease_ms, sizeof(lease_ms));
+        reader.read(&has_soft_pin, sizeof(has_soft_pin));
+        reader.read(&soft_pin_ms, sizeof(soft_pin_ms));
+        reader.read(&has_checksum, sizeof(has_checksum));
+        reader.read(&checksum, sizeof(checksum));
+        reader.read(&num_replicas, sizeof(num_replicas));
+
+        // Replicas that were still being written or copied are released
+        // right away, their writers are gone after the restart.
+        std::vector<Replica> replicas;
+        for (uint64_t j = 0; j < num_replicas; j++) {
+            auto replica = Replica::deserialize_from(reader, allocators);
+            if (replica.is_completed()) {
+                replicas.emplace_back(std::move(replica));
+            }
+        }
+
+        if (replicas.empty() || size == 0) {
+            continue;
+        }
+        auto [it, inserted] = shard->metadata.emplace(
+            std::piecewise_construct, std::forward_as_tuple(key),
+            std::forward_as_tuple(client_id, now, size, std::move(replicas),
+                                  has_soft_pin != 0, tenants_.Find(key)));
+        if (!inserted) {
+            LOG(WARNING) << "key=" << key
+                         << ", warn=duplicated_key_in_snapshot";
+            continue;
+        }
+        it->second.lease_timeout = now + std::chrono::milliseconds(lease_ms);
+        if (has_checksum) {
+            it->second.checksum = checksum;
+        }
+        if (it->second.has_soft_pin) {
+            it->second.soft_pin_timeout =
+                now + std::chrono::milliseconds(soft_pin_ms);
+        }
+        restored++;
+    }
+    return restored;
+}
+
+auto MasterService::CaptureSnapshot(
+    std::vector<std::vector<SerializedByte>>& sections, size_t& num_objects,
+    uint64_t& next_sequence_id) -> tl::expected<void, ErrorCode> {
+    constexpr size_t num_sections = kSnapshotFirstShardSection + kNumShards;
+    sections.assign(num_sections, {});
+    num_objects = 0;
+
+    // Take a consistent cut of the allocators and the objects that refer
+    // to their allocations. Holding all shard locks in shared mode blocks
+    // mutations while readers go through. The discarded replicas lock is
+    // taken before the segment lock so that no allocation is released
+    // between serializing the allocators and the discarded replicas.
+    std::deque<MetadataShardAccessorRO> shards;
+    for (size_t i = 0; i < kNumShards; i++) {
+        shards.emplace_back(this, i);
+        num_objects += shards.back()->metadata.size();
+    }
+    std::lock_guard discarded_lock(discarded_replicas_mutex_);
+    ScopedSegmentAccess segment_access = segment_manager_.getSegmentAccess();
+    // Log entries are appended under the shard or segment locks, so no entry
+    // can be appended concurrently.
+    next_sequence_id = oplog_ ? oplog_->NextSequenceId() : 0;
+
+    AllocatorIndex allocator_index;
+    ErrorCode err = segment_access.SerializeSegments(
+        sections[kSnapshotSegmentSection], allocator_index);
+    if (err != ErrorCode::OK) {
+        return tl::make_unexpected(err);
+    }
+
+    // Discarded replicas still own their allocations. They are stored so
+    // that the restored allocators can release them.
+    auto serialize_discarded = [&](auto& serializer) {
+        uint64_t num_replicas = 0;
+        for (const auto& item : discarded_replicas_) {
+            for (const auto& replica : item.replicas()) {
+                if (replica.is_memory_replica() &&
+                    replica.is_serializable(allocator_index)) {
+                    num_replicas++;
+                }
+            }
+        }
+        serializer.write(&num_replicas, sizeof(num_replicas));
+        for (const auto& item : discarded_replicas_) {
+            for (const auto& replica : item.replicas()) {
+                if (replica.is_memory_replica() &&
+                    replica.is_serializable(allocator_index)) {
+                    replica.serialize_to(serializer, allocator_index);
+                }
+            }
+        }
+    };
+    if (!SerializeSection(serialize_discarded,
+                          sections[kSnapshotDiscardedSection])) {
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    std::atomic<bool> failed{false};
+    ParallelForEach(kNumShards, [&](size_t i) {
+        auto serialize_shard = [&](auto& serializer) {
+            SerializeShardTo(serializer, metadata_shards_[i], allocator_index,
+                             now);
+        };
+        if (!SerializeSection(serialize_shard,
+                              sections[kSnapshotFirstShardSection + i])) {
+            failed = true;
+        }
+    });
+    if (failed) {
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+    return {};
+}
+
+auto MasterService::SaveSnapshot(const std::string& path)
+    -> tl::expected<void, ErrorCode> {
+    std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+    const auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<std::vector<SerializedByte>> sections;
+    size_t num_objects = 0;
+    uint64_t next_sequence_id = 0;
+    auto captured = CaptureSnapshot(sections, num_objects, next_sequence_id);
+    if (!captured) {
+        return captured;
+    }
+    const auto capture_time = std::chrono::steady_clock::now();
+
+    SnapshotFileHeader header;
+    std::vector<SnapshotSection> table;
+    const uint64_t file_size = BuildSnapshotLayout(sections, header, table);
+
+    // Write into a temporary file and rename it afterwards, so that a crash
+    // never leaves a partially written snapshot at path.
+    const std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG(ERROR) << "path=" << tmp_path
+                   << ", error=open_snapshot_failed, errno=" << errno;
+        return tl::make_unexpected(ErrorCode::FILE_OPEN_FAIL);
+    }
+    bool success = ftruncate(fd, file_size) == 0;
+    if (success) {
+        SnapshotMapping mapping(mmap(nullptr, file_size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED, fd, 0),
+                                file_size);
+        success = mapping.valid();
+        if (success) {
+            WriteSnapshotImage(mapping.data(), header, table, sections);
+            success = msync(mapping.data(), file_size, MS_SYNC) == 0;
+        }
+    }
+    success = success && fsync(fd) == 0;
+    close(fd);
+    if (!success || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        LOG(ERROR) << "path=" << path
+                   << ", error=write_snapshot_failed, errno=" << errno;
+        unlink(tmp_path.c_str());
+        return tl::make_unexpected(ErrorCode::FILE_WRITE_FAIL);
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+    LOG(INFO) << "action=save_snapshot, path=" << path
+              << ", objects=" << num_objects << ", bytes=" << file_size
+              << ", capture_ms="
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     capture_time - start_time)
+                     .count()
+              << ", total_ms="
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     end_time - start_time)
+                     .count();
+    return {};
+}
+
+auto MasterService::LoadSnapshot(const std::string& path)
+    -> tl::expected<size_t, ErrorCode> {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG(ERROR) << "path=" << path
+                   << ", error=open_snapshot_failed, errno=" << errno;
+        return tl::make_unexpected(errno == ENOENT ? ErrorCode::FILE_NOT_FOUND
+                                                   : ErrorCode::FILE_OPEN_FAIL);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(SnapshotFileHeader)) {
+        LOG(ERROR) << "path=" << path << ", error=invalid_snapshot_size";
+        close(fd);
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    const size_t file_size = st.st_size;
+    SnapshotMapping mapping(
+        mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0),
+        file_size);
+    close(fd);
+    if (!mapping.valid()) {
+        LOG(ERROR) << "path=" << path
+                   << ", error=mmap_snapshot_failed, errno=" << errno;
+        return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
+    }
+    return RestoreSnapshot(mapping.data(), file_size, path);
+}
+
+auto MasterService::RestoreSnapshot(const uint8_t* base, size_t size,
+                                    const std::string& source)
+    -> tl::expected<size_t, ErrorCode> {
+    if (GetKeyCount() != 0) {
+        LOG(ERROR) << "source=" << source
+                   << ", error=restore_snapshot_on_non_empty_master";
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_STATUS);
+    }
+    if (size < sizeof(SnapshotFileHeader)) {
+        LOG(ERROR) << "source=" << source << ", error=invalid_snapshot_size";
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+
+    constexpr size_t num_sections = kSnapshotFirstShardSection + kNumShards;
+    SnapshotFileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion ||
+        header.num_sections != num_sections ||
+        header.hash_probe != std::hash<std::string>{}(kSnapshotHashProbe)) {
+        LOG(ERROR) << "source=" << source << ", error=incompatible_snapshot"
+                   << ", version=" << header.version
+                   << ", num_sections=" << header.num_sections;
+        return tl::make_unexpected(ErrorCode::INVALID_VERSION);
+    }
+    const size_t table_end =
+        sizeof(SnapshotFileHeader) + num_sections * sizeof(SnapshotSection);
+    if (header.file_size != size || size < table_end) {
+        LOG(ERROR) << "source=" << source << ", error=truncated_snapshot";
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    std::vector<SnapshotSection> table(num_sections);
+    std::memcpy(table.data(), base + sizeof(SnapshotFileHeader),
+                num_sections * sizeof(SnapshotSection));
+    for (const auto& section : table) {
+        if (section.offset < table_end || section.offset > size ||
+            section.size > size - section.offset) {
+            LOG(ERROR) << "source=" << source
+                       << ", error=corrupted_snapshot_table";
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+    }
+
+    // Mount the segments with their restored allocators first. Restored
+    // clients are monitored again, so the segments of clients that did not
+    // survive the restart are unmounted after client_live_ttl_sec.
+    std::vector<std::shared_ptr<OffsetBufferAllocator>> allocators;
+    std::vector<UUID> client_ids;
+    {
+        std::unique_lock<std::shared_mutex> client_lock(client_mutex_);
+        ScopedSegmentAccess segment_access =
+            segment_manager_.getSegmentAccess();
+        const auto& section = table[kSnapshotSegmentSection];
+        SerializerReader reader(base + section.offset, section.size);
+        ErrorCode err =
+            segment_access.DeserializeSegments(reader, allocators, client_ids);
+        if (err != ErrorCode::OK) {
+            return tl::make_unexpected(err);
+        }
+        for (const auto& client_id : client_ids) {
+            if (ok_client_.insert(client_id).second) {
+                MasterMetricManager::instance().inc_active_clients();
+            }
+            PodUUID pod_client_id = {client_id.first, client_id.second};
+            if (!client_ping_queue_.push(pod_client_id)) {
+                LOG(ERROR) << "client_id=" << client_id
+                           << ", error=client_ping_queue_full";
+            }
+        }
+    }
+
+    std::atomic<bool> failed{false};
+    try {
+        // Allocations of discarded replicas are released by dropping them.
+        const auto& section = table[kSnapshotDiscardedSection];
+        SerializerReader reader(base + section.offset, section.size);
+        uint64_t num_replicas = 0;
+        reader.read(&num_replicas, sizeof(num_replicas));
+        for (uint64_t i = 0; i < num_replicas; i++) {
+            Replica::deserialize_from(reader, allocators);
+        }
+        if (!reader.finish_read()) {
+            throw std::runtime_error("wrong_data_size");
+        }
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "source=" << source
+                   << ", error=restore_discarded_replicas_failed, reason="
+                   << e.what();
+        failed = true;
+    }
+
+    std::atomic<size_t> num_restored{0};
+    if (!failed) {
+        ParallelForEach(kNumShards, [&](size_t i) {
+            const auto& section = table[kSnapshotFirstShardSection + i];
+            MetadataShardAccessorRW shard(this, i);
+            try {
+                SerializerReader reader(base + section.offset, section.size);
+                num_restored += DeserializeShard(reader, shard, allocators);
+                if (!reader.finish_read()) {
+                    throw std::runtime_error("wrong_data_size");
+                }
+            } catch (const std::exception& e) {
+                LOG(ERROR) << "shard=" << i
+                           << ", error=restore_snapshot_shard_failed, reason="
+                           << e.what();
+                failed = true;
+            }
+        });
+    }
+
+    if (failed) {
+        // Roll back to an empty master rather than serving a partial view.
+        ResetMetadata(client_ids);
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+    LOG(INFO) << "action=load_snapshot, source=" << source
+              << ", segments=" << allocators.size()
+              << ", objects=" << num_restored.load() << ", total_ms="
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     end_time - start_time)
+                     .count();
+    return num_restored.load();
+}
+
+void MasterService::ResetMetadata(const std::vector<UUID>& client_ids) {
+    for (size_t i = 0; i < kNumShards; i++) {
+        MetadataShardAccessorRW shard(this, i);
+        shard->metadata.clear();
+        shard->dedup_aliases.clear();
+    }
+    {
+        std::lock_guard lock(dedup_mutex_);
+        dedup_refs_.clear();
+    }
+    std::unique_lock<std::shared_mutex> client_lock(client_mutex_);
+    ScopedSegmentAccess segment_access = segment_manager_.getSegmentAccess();
+    for (const auto& client_id : client_ids) {
+        if (ok_client_.erase(client_id) > 0) {
+            MasterMetricManager::instance().dec_active_clients();
+        }
+        std::vector<Segment> segments;
+        segment_access.GetClientSegments(client_id, segments);
+        for (const auto& segment : segments) {
+            size_t metrics_dec_capacity = 0;
+            if (segment_access.PrepareUnmountSegment(
+                    segment.id, metrics_dec_capacity) == ErrorCode::OK) {
+                segment_access.CommitUnmountSegment(segment.id, client_id,
+                                                    metrics_dec_capacity);
+            }
+        }
+    }
+}
+
+namespace {
+
+OpLogReplica MakeOpLogReplica(const Replica& replica) {
+    OpLogReplica op_replica;
+    op_replica.type = replica.type();
+    if (replica.is_memory_replica()) {
+        const auto buffers = replica.get_memory_buffers();
+        op_replica.segment_name = buffers[0]->getSegmentName();
+        op_replica.address = reinterpret_cast<uintptr_t>(buffers[0]->data());
+        op_replica.size = buffers[0]->size();
+        for (size_t i = 1; i < buffers.size(); ++i) {
+            op_replica.extra_stripes.push_back(
+                {buffers[i]->getSegmentName(),
+                 reinterpret_cast<uintptr_t>(buffers[i]->data()),
+                 buffers[i]->size()});
+        }
+        op_replica.parity_stripes = replica.get_parity_stripes();
+        return op_replica;
+    }
+    const auto desc = replica.get_descriptor();
+    if (desc.is_disk_replica()) {
+        const auto& disk_desc = desc.get_disk_descriptor();
+        op_replica.file_path = disk_desc.file_path;
+        op_replica.size = disk_desc.object_size;
+    } else {
+        const auto& local_disk_desc = desc.get_local_disk_descriptor();
+        op_replica.client_id = local_disk_desc.client_id;
+        op_replica.size = local_disk_desc.object_size;
+        op_replica.transport_endpoint = local_disk_desc.transport_endpoint;
+    }
+    return op_replica;
+}
+
+bool IsObjectEntry(const OpLogEntry& entry) {
+    return entry.type == OpLogType::UPSERT_OBJECT ||
+           entry.type == OpLogType::REMOVE_OBJECT ||
+           entry.type == OpLogType::EVICT_OBJECT;
+}
+
+}  // namespace
+
+void MasterService::LogObject(const std::string& key,
+                              const ObjectMetadata* metadata,
+                              OpLogType remove_type) {
+    if (!IsOpLogEnabled()) {
+        return;
+    }
+    OpLogEntry entry;
+    entry.key = key;
+    if (metadata != nullptr) {
+        metadata->VisitReplicas(
+            [](const Replica& replica) {
+                return replica.is_completed() &&
+                       !replica.has_invalid_mem_handle();
+            },
+            [&entry](const Replica& replica) {
+                entry.replicas.push_back(MakeOpLogReplica(replica));
+            });
+    }
+    if (entry.replicas.empty()) {
+        entry.type = remove_type;
+    } else {
+        entry.type = OpLogType::UPSERT_OBJECT;
+        entry.client_id = metadata->client_id;
+        entry.size = metadata->size;
+        entry.soft_pin = metadata->has_soft_pin;
+        entry.checksum = metadata->checksum;
+    }
+    oplog_->Append(std::move(entry));
+}
+
+auto MasterService::FetchOpLog(uint64_t start_sequence_id,
+                               uint64_t max_entries)
+    -> tl::expected<FetchOpLogResponse, ErrorCode> {
+    if (!oplog_) {
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_MODE);
+    }
+    if (standby_) {
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_STATUS);
+    }
+    FetchOpLogResponse response;
+    ErrorCode err =
+        oplog_->Read(start_sequence_id, max_entries, response.entries);
+    if (err != ErrorCode::OK) {
+        return tl::make_unexpected(err);
+    }
+    response.next_sequence_id = oplog_->NextSequenceId();
+    return response;
+}
+
+auto MasterService::GetStandbySnapshot()
+    -> tl::expected<StandbySnapshotResponse, ErrorCode> {
+    if (!oplog_) {
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_MODE);
+    }
+    if (standby_) {
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_STATUS);
+    }
+    std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+    const auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<std::vector<SerializedByte>> sections;
+    size_t num_objects = 0;
+    StandbySnapshotResponse response;
+    auto captured =
+        CaptureSnapshot(sections, num_objects, response.sequence_id);
+    if (!captured) {
+        return tl::make_unexpected(captured.error());
+    }
+
+    SnapshotFileHeader header;
+    std::vector<SnapshotSection> table;
+    response.data.resize(BuildSnapshotLayout(sections, header, table));
+    WriteSnapshotImage(response.data.data(), header, table, sections);
+
+    LOG(INFO) << "action=get_standby_snapshot, objects=" << num_objects
+              << ", bytes=" << response.data.size()
+              << ", sequence_id=" << response.sequence_id << ", total_ms="
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start_time)
+                     .count();
+    return response;
+}
+
+auto MasterService::EnterStandby() -> tl::expected<void, ErrorCode> {
+    if (enable_cxl_ || memory_allocator_type_ != BufferAllocatorType::OFFSET) {
+        LOG(ERROR) << "error=standby_requires_offset_allocator";
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_MODE);
+    }
+    standby_ = true;
+    LOG(INFO) << "action=enter_standby";
+    return {};
+}
+
+auto MasterService::LoadStandbySnapshot(const StandbySnapshotResponse& snapshot)
+    -> tl::expected<void, ErrorCode> {
+    if (!standby_) {
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_STATUS);
+    }
+
+    // Drop whatever was replicated from a previous leader.
+    std::vector<UUID> client_ids;
+    {
+        std::shared_lock<std::shared_mutex> client_lock(client_mutex_);
+        ScopedSegmentAccess segment_access =
+            segment_manager_.getSegmentAccess();
+        segment_access.GetAllClients(client_ids);
+        for (const auto& client_id : ok_client_) {
+            if (std::find(client_ids.begin(), client_ids.end(), client_id) ==
+                client_ids.end()) {
+                client_ids.push_back(client_id);
+            }
+        }
+    }
+    ResetMetadata(client_ids);
+
+    auto result = RestoreSnapshot(snapshot.data.data(), snapshot.data.size(),
+                                  "standby_snapshot");
+    if (!result) {
+        return tl::make_unexpected(result.error());
+    }
+    return {};
+}
+
+void MasterService::ApplyObjectEntry(MetadataShardAccessorRW& shard,
+                                     const OpLogEntry& entry,
+                                     const StandbyAllocatorMap& allocators) {
+    // Every entry carries the whole state of the object.
+    shard->metadata.erase(entry.key);
+    if (entry.type != OpLogType::UPSERT_OBJECT) {
+        return;
+    }
+
+    std::vector<Replica> replicas;
+    for (const auto& op_replica : entry.replicas) {
+        switch (op_replica.type) {
+            case ReplicaType::MEMORY: {
+                std::vector<OpLogStripe> op_stripes;
+                op_stripes.push_back({op_replica.segment_name,
+                                      op_replica.address, op_replica.size});
+                op_stripes.insert(op_stripes.end(),
+                                  op_replica.extra_stripes.begin(),
+                                  op_replica.extra_stripes.end());
+                std::vector<std::unique_ptr<AllocatedBuffer>> stripes;
+                for (const auto& op_stripe : op_stripes) {
+                    void* buffer_ptr =
+                        reinterpret_cast<void*>(op_stripe.address);
+                    std::unique_ptr<AllocatedBuffer> buffer;
+                    auto it = allocators.find(op_stripe.segment_name);
+                    if (it != allocators.end()) {
+                        for (const auto& allocator : it->second) {
+                            if (allocator->contains(buffer_ptr,
+                                                    op_stripe.size)) {
+                                buffer = allocator->adoptBuffer(
+                                    buffer_ptr, op_stripe.size);
+                                break;
+                            }
+                        }
+                    }
+                    if (!buffer) {
+                        // The segment is already unmounted by a later entry.
+                        VLOG(1) << "key=" << entry.key
+                                << ", segment_name=" << op_stripe.segment_name
+                                << ", warn=replicated_buffer_without_segment";
+                        break;
+                    }
+                    stripes.push_back(std::move(buffer));
+                }
+                if (stripes.size() != op_stripes.size()) {
+                    // Adopted stripes are released with the vector.
+                    break;
+                }
+                replicas.emplace_back(std::move(stripes),
+                                      ReplicaStatus::COMPLETE,
+                                      op_replica.parity_stripes);
+                break;
+            }
+            case ReplicaType::DISK:
+                replicas.emplace_back(op_replica.file_path, op_replica.size,
+                                      ReplicaStatus::COMPLETE);
+                break;
+            case ReplicaType::LOCAL_DISK:
+                replicas.emplace_back(op_replica.client_id, op_replica.size,
+                                      op_replica.transport_endpoint,
+                                      ReplicaStatus::COMPLETE);
+                break;
+        }
+    }
+    if (replicas.empty() || entry.size == 0) {
+        return;
+    }
+
+    auto result = shard->metadata.emplace(
+        std::piecewise_construct, std::forward_as_tuple(entry.key),
+        std::forward_as_tuple(entry.client_id,
+                              std::chrono::steady_clock::now(), entry.size,
+                              std::move(replicas), entry.soft_pin,
+                              tenants_.Find(entry.key)));
+    result.first->second.checksum = entry.checksum;
+    result.first->second.GrantLease(0, default_kv_soft_pin_ttl_);
+}
+
+void MasterService::ApplyObjectEntries(
+    const std::vector<const OpLogEntry*>& entries) {
+    if (entries.empty()) {
+        return;
+    }
+
+    // Segments only change between two batches, so the allocators can be
+    // looked up without holding the segment lock.
+    StandbyAllocatorMap allocators;
+    {
+        ScopedAllocatorAccess allocator_access =
+            segment_manager_.getAllocatorAccess();
+        const auto& allocator_manager = allocator_access.getAllocatorManager();
+        for (const auto& name : allocator_manager.getNames()) {
+            const auto* segment_allocators =
+                allocator_manager.getAllocators(name);
+            if (segment_allocators == nullptr) {
+                continue;
+            }
+            for (const auto& allocator : *segment_allocators) {
+                auto offset_allocator =
+                    std::dynamic_pointer_cast<OffsetBufferAllocator>(allocator);
+                if (offset_allocator) {
+                    allocators[name].push_back(std::move(offset_allocator));
+                }
+            }
+        }
+    }
+
+    // Entries of the same key stay in order since they go to the same shard.
+    std::vector<std::vector<const OpLogEntry*>> shard_entries(kNumShards);
+    for (const auto* entry : entries) {
+        shard_entries[getShardIndex(entry->key)].push_back(entry);
+    }
+    auto apply_shard = [&](size_t i) {
+        if (shard_entries[i].empty()) {
+            return;
+        }
+        MetadataShardAccessorRW shard(this, i);
+        for (const auto* entry : shard_entries[i]) {
+            ApplyObjectEntry(shard, *entry, allocators);
+        }
+    };
+    if (entries.size() < kOpLogParallelApplyThreshold) {
+        for (size_t i = 0; i < kNumShards; i++) {
+            apply_shard(i);
+        }
+    } else {
+        ParallelForEach(kNumShards, apply_shard);
+    }
+}
+
+auto MasterService::ApplyOpLog(const std::vector<OpLogEntry>& entries)
+    -> tl::expected<void, ErrorCode> {
+    if (!standby_) {
+        LOG(ERROR) << "error=apply_oplog_on_leader";
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_STATUS);
+    }
+
+    std::vector<const OpLogEntry*> object_entries;
+    for (const auto& entry : entries) {
+        if (IsObjectEntry(entry)) {
+            object_entries.push_back(&entry);
+            continue;
+        }
+
+        // Segment entries are barriers, the objects logged before them may
+        // refer to the segment being mounted or unmounted.
+        ApplyObjectEntries(object_entries);
+        object_entries.clear();
+
+        tl::expected<void, ErrorCode> result;
+        switch (entry.type) {
+            case OpLogType::MOUNT_SEGMENT:
+                if (entry.segments.size() != 1) {
+                    result = tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+                    break;
+                }
+                result = MountSegment(entry.segments[0], entry.client_id);
+                break;
+            case OpLogType::REMOUNT_SEGMENTS:
+                result = ReMountSegment(entry.segments, entry.client_id);
+                break;
+            case OpLogType::UNMOUNT_SEGMENT:
+                result = UnmountSegment(entry.segment_id, entry.client_id);
+                break;
+            case OpLogType::MOUNT_LOCAL_DISK_SEGMENT:
+                result = MountLocalDiskSegment(entry.client_id,
+                                               entry.enable_offloading);
+                break;
+            case OpLogType::EXPIRE_CLIENT:
+                ExpireClients({entry.client_id});
+                break;
+            default:
+                result = tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+                break;
+        }
+        if (!result) {
+            LOG(WARNING) << "sequence_id=" << entry.sequence_id
+                         << ", type=" << static_cast<int>(entry.type)
+                         << ", client_id=" << entry.client_id
+                         << ", warn=apply_oplog_entry_failed, error_code="
+                         << result.error();
+        }
+    }
+    ApplyObjectEntries(object_entries);
+    return {};
+}
+
+auto MasterService::Promote(ViewVersionId view_version)
+    -> tl::expected<void, ErrorCode> {
+    if (!standby_) {
+        return tl::make_unexpected(ErrorCode::UNAVAILABLE_IN_CURRENT_STATUS);
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+
+    size_t num_buffers = 0;
+    std::atomic<size_t> num_detached{0};
+    {
+        std::unique_lock<std::shared_mutex> client_lock(client_mutex_);
+        std::deque<MetadataShardAccessorRW> shards;
+        for (size_t i = 0; i < kNumShards; i++) {
+            shards.emplace_back(this, i);
+        }
+
+        {
+            ScopedAllocatorAccess allocator_access =
+                segment_manager_.getAllocatorAccess();
+            const auto& allocator_manager =
+                allocator_access.getAllocatorManager();
+
+            // Every mounted allocator is rebuilt, including the empty ones.
+            std::vector<std::shared_ptr<OffsetBufferAllocator>> allocators;
+            std::unordered_map<const BufferAllocatorBase*, size_t>
+                allocator_ids;
+            for (const auto& name : allocator_manager.getNames()) {
+                const auto* segment_allocators =
+                    allocator_manager.getAllocators(name);
+                if (segment_allocators == nullptr) {
+                    continue;
+                }
+                for (const auto& allocator : *segment_allocators) {
+                    auto offset_allocator =
+                        std::dynamic_pointer_cast<OffsetBufferAllocator>(
+                            allocator);
+                    if (offset_allocator) {
+                        allocator_ids.emplace(offset_allocator.get(),
+                                              allocators.size());
+                        allocators.push_back(std::move(offset_allocator));
+                    }
+                }
+            }
+
+            std::vector<std::vector<AllocatedBuffer*>> buffers(
+                allocators.size());
+            for (auto& shard : shards) {
+                for (auto& [key, metadata] : shard->metadata) {
+                    metadata.VisitReplicas(
+                        &Replica::fn_is_memory_replica,
+                        [&](Replica& replica) {
+                            for (auto* buffer : replica.get_memory_buffers()) {
+                                auto allocator = buffer->getAllocator();
+                                auto it = allocator_ids.find(allocator.get());
+                                if (it != allocator_ids.end()) {
+                                    buffers[it->second].push_back(buffer);
+                                    num_buffers++;
+                                }
+                            }
+                        });
+                }
+            }
+
+            ParallelForEach(allocators.size(), [&](size_t i) {
+                num_detached += allocators[i]->rebuildAllocations(buffers[i]);
+            });
+        }
+
+        // Restart the timing of all clients, so that they have
+        // client_live_ttl_sec to reach the new leader.
+        std::vector<UUID> client_ids;
+        {
+            ScopedSegmentAccess segment_access =
+                segment_manager_.getSegmentAccess();
+            segment_access.GetAllClients(client_ids);
+        }
+        client_ids.insert(client_ids.end(), ok_client_.begin(),
+                          ok_client_.end());
+        for (const auto& client_id : client_ids) {
+            PodUUID pod_client_id = {client_id.first, client_id.second};
+            if (!client_ping_queue_.push(pod_client_id)) {
+                LOG(ERROR) << "client_id=" << client_id
+                           << ", error=client_ping_queue_full";
+            }
+        }
+
+        view_version_ = view_version;
+        standby_ = false;
+    }
+
+    if (num_detached > 0) {
+        BumpSegmentGeneration();
+        ClearInvalidHandles();
+    }
+    LOG(INFO) << "action=promote, view_version=" << view_version
+              << ", buffers=" << num_buffers
+              << ", detached=" << num_detached.load() << ", total_ms="
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start_time)
+                     .count();
+    return {};
+}
+
+void MasterService::SnapshotThreadFunc() {
+    LOG(INFO) << "Snapshot thread started, path=" << snapshot_path_
+              << ", interval_sec=" << snapshot_interval_sec_;
+    while (snapshot_running_) {
+        {
+            std::unique_lock<std::mutex> lk(snapshot_thread_mutex_);
+            snapshot_cv_.wait_for(
+                lk, std::chrono::seconds(snapshot_interval_sec_),
+                [&] { return !snapshot_running_.load(); });
+        }
+
+        if (!snapshot_running_) {
+            break;
+        }
+        if (standby_) {
+            // Only the leader writes snapshots.
+            continue;
+        }
+
+        auto result = SaveSnapshot(snapshot_path_);
+        if (!result) {
+            LOG(ERROR) << "path=" << snapshot_path_
+                       << ", error=save_snapshot_failed, error_code="
+                       << result.error();
+        }
+    }
+    LOG(INFO) << "Snapshot thread stopped";
+}
+
+void MasterService::DefragThreadFunc() {
+    LOG(INFO) << "Defrag thread started, interval_sec=" << defrag_interval_sec_
+              << ", threshold=" << defrag_threshold_
+              << ", max_moves=" << defrag_max_moves_
+              << ", max_request_rate=" << defrag_max_request_rate_;
+
+    // Puts and gets served by the master, including the keys of batches
+    auto served_requests = []() {
+        auto& metrics = MasterMetricManager::instance();
+        return metrics.get_put_start_requests() +
+               metrics.get_batch_put_start_items() +
+               metrics.get_get_replica_list_requests() +
+               metrics.get_batch_get_replica_list_items();
+    };
+    int64_t last_requests = served_requests();
+    auto last_time = std::chrono::steady_clock::now();
+
+    while (defrag_running_) {
+        {
+            std::unique_lock<std::mutex> lk(defrag_thread_mutex_);
+            defrag_cv_.wait_for(lk, std::chrono::seconds(defrag_interval_sec_),
+                                [&] { return !defrag_running_.load(); });
+        }
+
+        if (!defrag_running_) {
+            break;
+        }
+
+        const int64_t requests = served_requests();
+        const auto now = std::chrono::steady_clock::now();
+        const double elapsed_sec =
+            std::chrono::duration<double>(now - last_time).count();
+        const double request_rate =
+            elapsed_sec > 0 ? (requests - last_requests) / elapsed_sec : 0;
+        last_requests = requests;
+        last_time = now;
+
+        if (standby_) {
+            // Standby masters do not own the placement of objects.
+            continue;
+        }
+        if (defrag_max_request_rate_ > 0 &&
+            request_rate > static_cast<double>(defrag_max_request_rate_)) {
+            VLOG(1) << "action=skip_defrag, request_rate=" << request_rate;
+            continue;
+        }
+
+        const size_t num_moves = DefragmentSegments();
+        if (num_moves > 0) {
+            LOG(INFO) << "action=defrag, submitted_moves=" << num_moves;
+        }
+    }
+    LOG(INFO) << "Defrag thread stopped";
+}
+
+size_t MasterService::DefragmentSegments() {
+    std::lock_guard<std::mutex> defrag_lock(defrag_mutex_);
+
+    // Free space of every memory segment and its largest free region
+    struct SegmentSpace {
+        uint64_t free_size{0};
+        uint64_t largest_free_region{0};
+        bool fragmented{false};
+    };
+    std::unordered_map<std::string, SegmentSpace> segments;
+    bool has_fragmented = false;
+    {
+        ScopedAllocatorAccess allocator_access =
+            segment_manager_.getAllocatorAccess();
+        const auto& allocator_manager = allocator_access.getAllocatorManager();
+        for (const auto& name : allocator_manager.getNames()) {
+            const auto allocators = allocator_manager.getAllocators(name);
+            if (allocators == nullptr) {
+                continue;
+            }
+            auto& space = segments[name];
+            for (const auto& allocator : *allocators) {
+                space.free_size += allocator->capacity() - allocator->size();
+                space.largest_free_region =
+                    std::max<uint64_t>(space.largest_free_region,
+                                       allocator->getLargestFreeRegion());
+            }
+            space.fragmented =
+                space.free_size > 0 &&
+                static_cast<double>(space.largest_free_region) <
+                    defrag_threshold_ * static_cast<double>(space.free_size);
+            has_fragmented |= space.fragmented;
+        }
+    }
+    if (!has_fragmented || segments.size() < 2) {
+        return 0;
+    }
+
+    // Cold, unreferenced memory replicas on fragmented segments. Moving one
+    // away merges the free regions on both of its sides.
+    struct Candidate {
+        std::string key;
+        std::string source;
+        uint64_t size;
+        uint64_t free_neighbor_size;
+        std::vector<std::string> replica_segments;
+    };
+    std::vector<Candidate> candidates;
+    const size_t max_candidates =
+        kDefragCandidatesPerMove * static_cast<size_t>(defrag_max_moves_);
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kNumShards && candidates.size() < max_candidates;
+         ++i) {
+        MetadataShardAccessorRO shard(this, defrag_shard_cursor_);
+        defrag_shard_cursor_ = (defrag_shard_cursor_ + 1) % kNumShards;
+        for (const auto& [key, metadata] : shard->metadata) {
+            if (metadata.in_processing || metadata.replication_task ||
+                metadata.demotion_start || !metadata.IsLeaseExpired(now)) {
+                continue;
+            }
+            const Replica* source = nullptr;
+            uint64_t free_neighbor_size = 0;
+            metadata.VisitReplicas(
+                [&](const Replica& replica) {
+                    return source == nullptr && replica.is_memory_replica() &&
+                           replica.is_completed() && !replica.is_striped() &&
+                           replica.get_refcnt() == 0;
+                },
+                [&](const Replica& replica) {
+                    const auto buffers = replica.get_memory_buffers();
+                    if (buffers.size() != 1) {
+                        return;
+                    }
+                    auto it = segments.find(buffers[0]->getSegmentName());
+                    if (it == segments.end() || !it->second.fragmented) {
+                        return;
+                    }
+                    free_neighbor_size = buffers[0]->getFreeNeighborSize();
+                    if (free_neighbor_size > 0) {
+                        source = &replica;
+                    }
+                });
+            if (source == nullptr) {
+                continue;
+            }
+            candidates.push_back(
+                {key, source->get_memory_buffers()[0]->getSegmentName(),
+                 metadata.size, free_neighbor_size,
+                 metadata.GetReplicaSegmentNames()});
+        }
+    }
+    if (candidates.empty()) {
+        return 0;
+    }
+
+    // Prefer the objects separating the most free space, and the smaller
+    // ones among equals since they are cheaper to move.
+    const size_t num_candidates =
+        std::min<size_t>(candidates.size(), defrag_max_moves_);
+    std::partial_sort(candidates.begin(), candidates.begin() + num_candidates,
+                      candidates.end(),
+                      [](const Candidate& lhs, const Candidate& rhs) {
+                          if (lhs.free_neighbor_size !=
+                              rhs.free_neighbor_size) {
+                              return lhs.free_neighbor_size >
+                                     rhs.free_neighbor_size;
+                          }
+                          return lhs.size < rhs.size;
+                      });
+    candidates.resize(num_candidates);
+
+    size_t num_moves = 0;
+    for (const auto& candidate : candidates) {
+        // Move into the segment with the largest free region that is not
+        // fragmented and does not hold the object yet
+        SegmentSpace* target_space = nullptr;
+        const std::string* target = nullptr;
+        for (auto& [name, space] : segments) {
+            if (space.fragmented ||
+                space.largest_free_region < candidate.size ||
+                std::find(candidate.replica_segments.begin(),
+                          candidate.replica_segments.end(),
+                          name) != candidate.replica_segments.end()) {
+                continue;
+            }
+            if (target_space == nullptr ||
+                space.largest_free_region > target_space->largest_free_region) {
+                target_space = &space;
+                target = &name;
+            }
+        }
+        if (target == nullptr) {
+            continue;
+        }
+
+        auto task_id =
+            CreateMoveTask(candidate.key, candidate.source, *target);
+        if (!task_id) {
+            VLOG(1) << "key=" << candidate.key
+                    << ", source_segment=" << candidate.source
+                    << ", target_segment=" << *target
+                    << ", error=create_defrag_move_failed, error_code="
+                    << task_id.error();
+            continue;
+        }
+        // Spread the moves, the region is only known again next round
+        target_space->largest_free_region -= candidate.size;
+        ++num_moves;
+    }
+    return num_moves;
+}
+
+size_t MasterService::PromoteCxlObjects() {
+    if (cxl_promote_access_count_ == 0) {
+        return 0;
+    }
+    std::unordered_set<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(cxl_promotion_mutex_);
+        keys.swap(cxl_promotion_queue_);
+    }
+
+    size_t num_promotions = 0;
+    for (const auto& key : keys) {
+        std::string source;
+        uint64_t size = 0;
+        {
+            MetadataAccessorRO accessor(this, key);
+            if (!accessor.Exists() || accessor.Get().replication_task) {
+                continue;
+            }
+            const auto& metadata = accessor.Get();
+            // Promoted already if it has a replica outside the CXL memory
+            const bool on_dram = metadata.HasReplica([](const Replica& r) {
+                return r.is_memory_replica() && r.is_completed() &&
+                       !r.get_memory_buffers()[0]->isCxl();
+            });
+            const Replica* replica =
+                metadata.GetFirstReplica([](const Replica& r) {
+                    return r.is_memory_replica() && r.is_completed() &&
+                           !r.is_striped() &&
+                           !r.has_invalid_mem_handle() &&
+                           r.get_memory_buffers()[0]->isCxl();
+                });
+            if (on_dram || replica == nullptr) {
+                continue;
+            }
+            const auto segment_names = replica->get_segment_names();
+            if (segment_names.empty() || !segment_names[0].has_value()) {
+                continue;
+            }
+            source = *segment_names[0];
+            size = metadata.size;
+        }
+
+        // The CXL memory is shared by all clients, so the client owning the
+        // target copies the object.
+        std::string target;
+        UUID target_client;
+        {
+            const ScopedSegmentAccess segment_access =
+                segment_manager_.getSegmentReadAccess();
+            if (segment_access.SelectDramSegment(size, target) !=
+                    ErrorCode::OK ||
+                segment_access.GetClientIdBySegmentName(
+                    target, target_client) != ErrorCode::OK) {
+                VLOG(1) << "key=" << key
+                        << ", info=no_dram_segment_for_cxl_promotion";
+                continue;
+            }
+        }
+        auto task_id =
+            task_manager_.get_write_access()
+                .submit_task_typed<TaskType::REPLICA_COPY>(
+                    target_client,
+                    {.key = key, .source = source, .targets = {target}});
+        if (task_id) WakeTaskWaiters(target_client);
+        if (!task_id) {
+            VLOG(1) << "key=" << key << ", target_segment=" << target
+                    << ", error=create_cxl_promotion_task_failed, error_code="
+                    << task_id.error();
+            continue;
+        }
+        VLOG(1) << "key=" << key << ", source_segment=" << source
+                << ", target_segment=" << target
+                << ", action=promote_from_cxl";
+        num_promotions++;
+    }
+    return num_promotions;
+}
+
+size_t MasterService::ReplicateHotObjects() {
+    if (hot_replica_read_rate_ == 0) {
+        return 0;
+    }
+    std::unordered_set<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(hot_replica_mutex_);
+        keys.swap(hot_replica_queue_);
+    }
+
+    std::lock_guard<std::mutex> hot_lock(hot_objects_mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    size_t num_copies = 0;
+    for (const auto& key : keys) {
+        std::chrono::steady_clock::time_point put_start_time;
+        std::vector<std::string> holders;
+        uint64_t size = 0;
+        size_t num_memory_replicas = 0;
+        {
+            MetadataAccessorRO accessor(this, key);
+            if (!accessor.Exists()) {
+                continue;
+            }
+            const auto& metadata = accessor.Get();
+            put_start_time = metadata.put_start_time;
+            metadata.VisitReplicas(
+                [](const Replica& replica) {
+                    return replica.is_memory_replica() &&
+                           replica.is_completed();
+                },
+                [&num_memory_replicas](const Replica&) {
+                    ++num_memory_replicas;
+                });
+            if (metadata.replication_task) {
+                // Still being copied, or moved, keep it hot
+                num_memory_replicas = hot_replica_max_replicas_;
+            }
+            holders = metadata.GetReplicaSegmentNames();
+            size = metadata.size;
+        }
+
+        auto& hot = hot_objects_[key];
+        if (hot.put_start_time != put_start_time) {
+            hot = HotObject{put_start_time, now, {}};
+        }
+        hot.last_hot = now;
+        if (num_memory_replicas >= hot_replica_max_replicas_) {
+            continue;
+        }
+
+        std::string target;
+        {
+            const ScopedSegmentAccess segment_access =
+                segment_manager_.getSegmentReadAccess();
+            if (segment_access.SelectDramSegment(size, target, holders) !=
+                ErrorCode::OK) {
+                VLOG(1) << "key=" << key
+                        << ", info=no_segment_for_hot_replica";
+                continue;
+            }
+        }
+        auto task_id = CreateCopyTask(key, {target});
+        if (!task_id) {
+            VLOG(1) << "key=" << key << ", target_segment=" << target
+                    << ", error=create_hot_replica_task_failed, error_code="
+                    << task_id.error();
+            continue;
+        }
+        VLOG(1) << "key=" << key << ", target_segment=" << target
+                << ", action=replicate_hot_object";
+        hot.targets.push_back(target);
+        num_copies++;
+    }
+
+    // Drop the replicas added to the objects that cooled down. An object
+    // still being read or copied is tried again on the next round.
+    for (auto it = hot_objects_.begin(); it != hot_objects_.end();) {
+        // The accessor outlives the entry
+        const std::string key = it->first;
+        const HotObject& hot = it->second;
+        if (now - hot.last_hot < hot_replica_cooldown_) {
+            ++it;
+            continue;
+        }
+        MetadataAccessorRW accessor(this, key);
+        if (!accessor.Exists() ||
+            accessor.Get().put_start_time != hot.put_start_time) {
+            it = hot_objects_.erase(it);
+            continue;
+        }
+        auto& metadata = accessor.Get();
+        if (metadata.replication_task || !metadata.IsLeaseExpired()) {
+            ++it;
+            continue;
+        }
+        size_t num_memory_replicas = 0;
+        metadata.VisitReplicas(
+            [](const Replica& replica) {
+                return replica.is_memory_replica() && replica.is_completed();
+            },
+            [&num_memory_replicas](const Replica&) { ++num_memory_replicas; });
+        const auto& targets = hot.targets;
+        const size_t num_dropped = metadata.EraseReplicas(
+            [&targets, &num_memory_replicas](const Replica& replica) {
+                if (num_memory_replicas <= 1 || !replica.is_memory_replica() ||
+                    !replica.is_completed() || replica.is_striped() ||
+                    replica.get_refcnt() != 0) {
+                    return false;
+                }
+                const auto segment_names = replica.get_segment_names();
+                if (segment_names.empty() || !segment_names[0].has_value() ||
+                    std::find(targets.begin(), targets.end(),
+                              *segment_names[0]) == targets.end()) {
+                    return false;
+                }
+                --num_memory_replicas;
+                return true;
+            });
+        if (num_dropped > 0) {
+            VLOG(1) << "key=" << key << ", dropped_replicas=" << num_dropped
+                    << ", action=drop_cold_hot_replicas";
+            LogObject(key, &metadata);
+        }
+        it = hot_objects_.erase(it);
+    }
+    return num_copies;
+}
+
+size_t MasterService::RebalanceSegments() {
+    if (rebalance_bandwidth_mb_ == 0) {
+        return 0;
+    }
+    std::unordered_set<std::string> targets;
+    {
+        std::lock_guard<std::mutex> lock(rebalance_mutex_);
+        targets = rebalance_targets_;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed_sec = std::min(
+        1.0, std::chrono::duration<double>(now - rebalance_refill_time_)
+                 .count());
+    rebalance_refill_time_ = now;
+    if (targets.empty()) {
+        return 0;
+    }
+    // Hold at most a second worth of bytes
+    const double rate = rebalance_bandwidth_mb_ * 1024.0 * 1024.0;
+    rebalance_budget_ = std::min(rate, rebalance_budget_ + rate * elapsed_sec);
+    if (rebalance_budget_ <= 0) {
+        return 0;
+    }
+
+    auto usages = GetSegmentUsages();
+    for (auto it = rebalance_moves_.begin(); it != rebalance_moves_.end();) {
+        const auto& move = it->second;
+        std::vector<std::string> holders;
+        if (now - move.submit_time <= kRebalanceMoveTimeout) {
+            MetadataAccessorRO accessor(this, it->first);
+            if (accessor.Exists()) {
+                holders = accessor.Get().GetReplicaSegmentNames();
+            }
+        }
+        auto holds = [&holders](const std::string& name) {
+            return std::find(holders.begin(), holders.end(), name) !=
+                   holders.end();
+        };
+        if (!holds(move.source)) {
+            // Done, timed out or removed
+            it = rebalance_moves_.erase(it);
+            continue;
+        }
+        if (!holds(move.target)) {
+            usages[move.target].used += move.size;
+        }
+        auto& source_used = usages[move.source].used;
+        source_used -= std::min(source_used, move.size);
+        ++it;
+    }
+    uint64_t total_capacity = 0;
+    uint64_t total_used = 0;
+    for (const auto& [name, usage] : usages) {
+        total_capacity += usage.capacity;
+        total_used += usage.used;
+    }
+    if (total_capacity == 0) {
+        return 0;
+    }
+    const double global_ratio =
+        static_cast<double>(total_used) / static_cast<double>(total_capacity);
+    auto ratio_of = [](const SegmentUsage& usage) {
+        return usage.capacity == 0 ? 1.0
+                                   : static_cast<double>(usage.used) /
+                                         static_cast<double>(usage.capacity);
+    };
+
+    // Retire the targets which caught up or were unmounted
+    std::vector<std::string> finished;
+    for (auto it = targets.begin(); it != targets.end();) {
+        auto usage = usages.find(*it);
+        if (usage == usages.end() ||
+            ratio_of(usage->second) + kRebalanceSlack >= global_ratio) {
+            finished.push_back(*it);
+            it = targets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (!finished.empty()) {
+        std::lock_guard<std::mutex> lock(rebalance_mutex_);
+        for (const auto& name : finished) {
+            rebalance_targets_.erase(name);
+            LOG(INFO) << "segment_name=" << name
+                      << ", action=rebalance_finished";
+        }
+    }
+    if (targets.empty()) {
+        return 0;
+    }
+
+    std::unordered_set<std::string> sources;
+    for (const auto& [name, usage] : usages) {
+        if (!targets.count(name) && ratio_of(usage) > global_ratio) {
+            sources.insert(name);
+        }
+    }
+    if (sources.empty()) {
+        return 0;
+    }
+
+    struct Candidate {
+        uint32_t heat;
+        std::string key;
+        std::string source;
+        uint64_t size;
+        std::vector<std::string> holders;
+    };
+    std::vector<Candidate> candidates;
+    const uint32_t epoch = heat_epoch_.load();
+    for (size_t i = 0; i < kRebalanceShardsPerTick; ++i) {
+        MetadataShardAccessorRO shard(this, rebalance_shard_cursor_);
+        rebalance_shard_cursor_ = (rebalance_shard_cursor_ + 1) % kNumShards;
+        for (const auto& [key, metadata] : shard->metadata) {
+            if (metadata.replication_task || rebalance_moves_.count(key)) {
+                continue;
+            }
+            const Replica* replica =
+                metadata.GetFirstReplica([&sources](const Replica& r) {
+                    if (!r.is_memory_replica() || !r.is_completed() ||
+                        r.is_striped() || r.has_invalid_mem_handle()) {
+                        return false;
+                    }
+                    const auto names = r.get_segment_names();
+                    return !names.empty() && names[0].has_value() &&
+                           sources.count(*names[0]) > 0;
+                });
+            if (replica == nullptr) {
+                continue;
+            }
+            candidates.push_back({metadata.GetAccessCount(epoch), key,
+                                  *replica->get_segment_names()[0],
+                                  metadata.size,
+                                  metadata.GetReplicaSegmentNames()});
+        }
+    }
+    // Hottest first, they carry the most of the read load
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& lhs, const Candidate& rhs) {
+                  return lhs.heat > rhs.heat;
+              });
+
+    size_t num_moves = 0;
+    for (const auto& candidate : candidates) {
+        if (rebalance_budget_ <= 0 || num_moves >= kMaxRebalanceMovesPerTick) {
+            break;
+        }
+        auto& source_usage = usages[candidate.source];
+        if (ratio_of(source_usage) <= global_ratio) {
+            continue;  // Drained enough
+        }
+        // The least loaded target not holding the object yet
+        const std::string* target = nullptr;
+        double target_ratio = 0;
+        for (const auto& name : targets) {
+            const double ratio = ratio_of(usages[name]);
+            if (ratio + kRebalanceSlack >= global_ratio ||
+                std::find(candidate.holders.begin(), candidate.holders.end(),
+                          name) != candidate.holders.end()) {
+                continue;
+            }
+            if (target == nullptr || ratio < target_ratio) {
+                target = &name;
+                target_ratio = ratio;
+            }
+        }
+        if (target == nullptr) {
+            continue;
+        }
+        auto task_id = CreateMoveTask(candidate.key, candidate.source, *target);
+        if (!task_id) {
+            VLOG(1) << "key=" << candidate.key
+                    << ", target_segment=" << *target
+                    << ", error=create_rebalance_task_failed, error_code="
+                    << task_id.error();
+            continue;
+        }
+        VLOG(1) << "key=" << candidate.key
+                << ", source_segment=" << candidate.source
+                << ", target_segment=" << *target
+                << ", action=rebalance_move";
+        rebalance_moves_[candidate.key] = {now, candidate.source, *target,
+                                           candidate.size};
+        source_usage.used -= std::min(source_usage.used, candidate.size);
+        usages[*target].used += candidate.size;
+        rebalance_budget_ -= candidate.size;
+        num_moves++;
+    }
+    return num_moves;
+}
+
+auto MasterService::Ping(const UUID& client_id,
+                         const ClientLoadReport& load_report,
+                         std::optional<uint64_t> put_sequence_id)
+    -> tl::expected<PingResponse, ErrorCode> {
+    std::shared_lock<std::shared_mutex> lock(client_mutex_);
+    ClientStatus client_status;
+    auto it = ok_client_.find(client_id);
+    if (it != ok_client_.end()) {
+        client_status = ClientStatus::OK;
+    } else {
         client_status = ClientStatus::NEED_REMOUNT;
     }
-    PodUUID pod_client_id = {client_id.first, client_id.second};
-    if (!client_ping_queue_.push(pod_client_id)) {
-        // Queue is full
-        LOG(ERROR) << "client_id=" << client_id
-                   << ", error=client_ping_queue_full";
-        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    PodUUID pod_client_id = {client_id.first, client_id.second};
+    if (!client_ping_queue_.push(pod_client_id)) {
+        // Queue is full
+        LOG(ERROR) << "client_id=" << client_id
+                   << ", error=client_ping_queue_full";
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+    if (segment_load_tracker_) {
+        segment_load_tracker_->Report(load_report);
+    }
+    PingResponse response(view_version_, client_status);
+    if (put_sequence_id) {
+        FillPutNotifications(*put_sequence_id, response);
+    }
+    return response;
+}
+
+std::vector<tl::expected<BatchPingResponse, ErrorCode>>
+MasterService::BatchPing(const std::vector<BatchPingRequest>& requests) {
+    std::vector<tl::expected<BatchPingResponse, ErrorCode>> results;
+    results.reserve(requests.size());
+    for (const auto& request : requests) {
+        auto ping = Ping(request.client_id, request.load_report,
+                         request.put_sequence_id);
+        if (!ping) {
+            results.emplace_back(tl::make_unexpected(ping.error()));
+            continue;
+        }
+        BatchPingResponse response;
+        response.ping = std::move(ping.value());
+        if (request.task_batch_size > 0) {
+            auto tasks = FetchTasks(request.client_id, request.task_batch_size);
+            if (tasks) {
+                response.tasks = std::move(tasks.value());
+            }
+        }
+        results.emplace_back(std::move(response));
+    }
+    return results;
+}
+
+void MasterService::NotifyPut(const std::string& key) {
+    if (!put_notifications_watched_.load(std::memory_order_acquire)) {
+        return;
+    }
+    const uint64_t hash = HashRing::Hash(key);
+    std::lock_guard<std::mutex> lock(put_notification_mutex_);
+    put_notification_hashes_[next_put_notification_ %
+                             kPutNotificationCapacity] = hash;
+    ++next_put_notification_;
+}
+
+void MasterService::FillPutNotifications(uint64_t put_sequence_id,
+                                         PingResponse& response) {
+    std::lock_guard<std::mutex> lock(put_notification_mutex_);
+    if (put_notification_hashes_.empty()) {
+        // Puts are only recorded once a client watches them
+        put_notification_hashes_.resize(kPutNotificationCapacity);
+        put_notifications_watched_.store(true, std::memory_order_release);
+    }
+    const uint64_t next = next_put_notification_;
+    response.put_sequence_id = next;
+    if (put_sequence_id == 0 || put_sequence_id > next ||
+        next - put_sequence_id > kMaxPutNotificationsPerPing) {
+        // New watcher, restarted master, or too far behind
+        response.put_keys_truncated = true;
+        return;
+    }
+    response.put_key_hashes.reserve(next - put_sequence_id);
+    for (uint64_t seq = put_sequence_id; seq < next; ++seq) {
+        response.put_key_hashes.push_back(
+            put_notification_hashes_[seq % kPutNotificationCapacity]);
     }
-    return PingResponse(view_version_, client_status);
 }
 
 tl::expected<std::string, ErrorCode> MasterService::GetFsdir() const {
@@ -1487,6 +4567,13 @@ auto MasterService::MountLocalDiskSegment(const UUID& client_id,
     } else if (err != ErrorCode::OK) {
         return tl::make_unexpected(err);
     }
+    if (IsOpLogEnabled()) {
+        OpLogEntry entry;
+        entry.type = OpLogType::MOUNT_LOCAL_DISK_SEGMENT;
+        entry.client_id = client_id;
+        entry.enable_offloading = enable_offloading;
+        oplog_->Append(std::move(entry));
+    }
     return {};
 }
 
@@ -1532,6 +4619,15 @@ auto MasterService::NotifyOffloadSuccess(
 
 tl::expected<void, ErrorCode> MasterService::PushOffloadingQueue(
     const std::string& key, const Replica& replica) {
+    if (replica.is_striped()) {
+        // A striped object has no single owner to offload it.
+        return {};
+    }
+    if (enable_dedup_ && IsDedupContentKey(key)) {
+        // Local disk replicas are read back under the key of the reader,
+        // which is an alias of deduplicated content
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
     const auto& segment_names = replica.get_segment_names();
     if (segment_names.empty()) {
         return {};
@@ -1572,23 +4668,82 @@ tl::expected<void, ErrorCode> MasterService::PushOffloadingQueue(
     return {};
 }
 
+bool MasterService::DemoteBeforeEvict(
+    const std::string& key, ObjectMetadata& metadata,
+    const std::chrono::steady_clock::time_point& now) {
+    if (!enable_offload_ || tiering_demote_access_count_ == 0) {
+        return false;
+    }
+    if (metadata.demotion_start) {
+        if (now - *metadata.demotion_start < kDemotionTimeout) {
+            return true;
+        }
+        LOG(WARNING) << "key=" << key
+                     << ", info=demotion_timeout, evicting without offload";
+        metadata.demotion_start.reset();
+        return false;
+    }
+    // Objects already on a disk tier only drop their memory replicas, and
+    // cold objects are dropped altogether.
+    if (metadata.HasReplica(&Replica::fn_is_disk_replica) ||
+        metadata.HasReplica(&Replica::fn_is_local_disk_replica) ||
+        metadata.GetAccessCount(heat_epoch_.load()) <
+            tiering_demote_access_count_) {
+        return false;
+    }
+    const Replica* replica = metadata.GetFirstReplica([](const Replica& r) {
+        return r.is_memory_replica() && r.is_completed() && !r.is_striped();
+    });
+    if (replica == nullptr || !PushOffloadingQueue(key, *replica)) {
+        // No local disk segment with room, evict as usual
+        return false;
+    }
+    metadata.demotion_start = now;
+    MasterMetricManager::instance().inc_tiering_demotions();
+    return true;
+}
+
 void MasterService::EvictionThreadFunc() {
     VLOG(1) << "action=eviction_thread_started";
 
     auto last_discard_time = std::chrono::steady_clock::now();
     while (eviction_running_) {
+        if (standby_) {
+            // A standby master replays the evictions of the leader.
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(kEvictionThreadSleepMs));
+            continue;
+        }
         const auto now = std::chrono::steady_clock::now();
         double used_ratio =
             MasterMetricManager::instance().get_global_mem_used_ratio();
-        if (used_ratio > eviction_high_watermark_ratio_ ||
-            (need_eviction_ && eviction_ratio_ > 0.0)) {
+        std::unordered_map<std::string, uint64_t> segment_targets;
+        if (enable_segment_pressure_eviction_) {
+            segment_targets = GetSegmentEvictionTargets(need_eviction_);
+            if (segment_targets.empty()) {
+                // No segment has anything to free
+                need_eviction_ = false;
+            }
+        }
+        if (!segment_targets.empty()) {
+            SegmentPressureEvict(std::move(segment_targets));
+            last_discard_time = now;
+        } else if (!enable_segment_pressure_eviction_ &&
+                   (sampled_eviction_pass_.active ||
+                    used_ratio > eviction_high_watermark_ratio_ ||
+                    (need_eviction_ && eviction_ratio_ > 0.0))) {
             double evict_ratio_target = std::max(
                 eviction_ratio_,
                 used_ratio - eviction_high_watermark_ratio_ + eviction_ratio_);
             double evict_ratio_lowerbound =
                 std::max(evict_ratio_target * 0.5,
                          used_ratio - eviction_high_watermark_ratio_);
-            BatchEvict(evict_ratio_target, evict_ratio_lowerbound);
+            if (eviction_sample_size_ > 0) {
+                // The ratios are only used when a new pass starts.
+                SampledEvict(evict_ratio_target, evict_ratio_lowerbound);
+            } else {
+                BatchEvict(evict_ratio_target, evict_ratio_lowerbound);
+            }
             last_discard_time = now;
         } else if (now - last_discard_time > put_start_release_timeout_sec_) {
             // Try discarding expired processing keys and ongoing replication
@@ -1600,6 +4755,10 @@ void MasterService::EvictionThreadFunc() {
             ReleaseExpiredDiscardedReplicas(now);
             last_discard_time = now;
         }
+        SweepPutLeases(now);
+        PromoteCxlObjects();
+        ReplicateHotObjects();
+        RebalanceSegments();
 
         std::this_thread::sleep_for(
             std::chrono::milliseconds(kEvictionThreadSleepMs));
@@ -1608,109 +4767,145 @@ void MasterService::EvictionThreadFunc() {
     VLOG(1) << "action=eviction_thread_stopped";
 }
 
-void MasterService::DiscardExpiredProcessingReplicas(
-    MetadataShardAccessorRW& shard,
-    const std::chrono::steady_clock::time_point& now) {
-    std::list<DiscardedReplicas> discarded_replicas;
+void MasterService::ScheduleExpiry(
+    const std::string& key, std::chrono::steady_clock::time_point expire_time) {
+    auto& ttl_wheel = ttl_wheels_[getShardIndex(key) % kTtlWheelGroups];
+    // Rounded up, so that objects are never removed early
+    const uint64_t expire_tick = TtlTick(expire_time) + 1;
+    std::lock_guard<std::mutex> lock(ttl_wheel.mutex);
+    ttl_wheel.wheel.Schedule(key, expire_tick);
+}
 
-    // Part 1: Discard expired PutStart operations.
-    for (auto key_it = shard->processing_keys.begin();
-         key_it != shard->processing_keys.end();) {
-        auto it = shard->metadata.find(*key_it);
-        if (it == shard->metadata.end()) {
-            // The key has been removed from metadata. This should be
-            // impossible.
-            LOG(ERROR) << "Key " << *key_it
-                       << " was removed while in processing";
-            key_it = shard->processing_keys.erase(key_it);
+void MasterService::ExpireObjects(const std::vector<std::string>& keys) {
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& key : keys) {
+        MetadataAccessorRW accessor(this, key);
+        if (!accessor.Exists()) {
             continue;
         }
-
-        auto& metadata = it->second;
-        // If the object is not valid or not in processing state, just
-        // remove it from the processing set.
-        if (!metadata.IsValid() ||
-            metadata.AllReplicas(&Replica::fn_is_completed)) {
-            if (!metadata.IsValid()) {
-                shard->metadata.erase(it);
-            }
-            key_it = shard->processing_keys.erase(key_it);
+        auto& metadata = accessor.Get();
+        // Removed and put again since, without a TTL or with a later one
+        if (!metadata.expire_time || *metadata.expire_time > now) {
             continue;
         }
-
-        // If the object's PutStart timedout, discard and release it's
-        // space. Note that instead of releasing the space directly, we
-        // insert the replicas into the discarded list so that the
-        // discarding and releasing operations can be recorded in
-        // statistics.
-        const auto ttl =
-            metadata.put_start_time + put_start_release_timeout_sec_;
-        if (ttl < now) {
-            auto replicas = metadata.PopReplicas(&Replica::fn_is_processing);
-            if (!replicas.empty()) {
-                discarded_replicas.emplace_back(std::move(replicas), ttl);
-            }
-
-            if (!metadata.IsValid()) {
-                // All replicas of this object are discarded, just
-                // remove the whole object.
-                shard->metadata.erase(it);
-            }
-
-            key_it = shard->processing_keys.erase(key_it);
+        // Readers keep the object until their lease ends, and objects being
+        // written or replicated are retried later
+        if (!metadata.IsLeaseExpired()) {
+            ScheduleExpiry(key, metadata.lease_timeout.load());
             continue;
         }
-
-        key_it++;
-    }
-
-    // Part 2: Discard expired CopyStart/MoveStart operations.
-    for (auto task_it = shard->replication_tasks.begin();
-         task_it != shard->replication_tasks.end();) {
-        auto metadata_it = shard->metadata.find(task_it->first);
-        if (metadata_it == shard->metadata.end()) {
-            // The key has been removed from metadata. This should be
-            // impossible.
-            LOG(ERROR) << "Key " << task_it->first
-                       << " was removed with ongoing replication task";
-            task_it = shard->replication_tasks.erase(task_it);
+        if (!metadata.AllReplicas(&Replica::fn_is_completed) ||
+            accessor.HasReplicationTask()) {
+            ScheduleExpiry(key, now + std::chrono::milliseconds(kTtlRetryMs));
             continue;
         }
+        MasterMetricManager::instance().inc_ttl_expired(metadata.size);
+        VLOG(1) << "key=" << key << ", action=ttl_expired";
+        accessor.Erase();
+        LogObject(key, nullptr);
+    }
+}
 
-        const auto ttl =
-            task_it->second.start_time + put_start_release_timeout_sec_;
-        if (ttl > now) {
-            // The task is not expired, skip it.
-            task_it++;
-            continue;
+void MasterService::TtlThreadFunc() {
+    VLOG(1) << "action=ttl_thread_started";
+    std::vector<std::string> expired;
+    while (ttl_running_) {
+        {
+            std::unique_lock<std::mutex> lock(ttl_thread_mutex_);
+            ttl_cv_.wait_for(lock, std::chrono::milliseconds(kTtlTickMs),
+                             [this] { return !ttl_running_.load(); });
+        }
+        if (!ttl_running_) {
+            break;
+        }
+        const uint64_t now_tick = TtlTick(std::chrono::steady_clock::now());
+        for (auto& ttl_wheel : ttl_wheels_) {
+            {
+                std::lock_guard<std::mutex> lock(ttl_wheel.mutex);
+                ttl_wheel.wheel.Advance(now_tick, expired);
+            }
+            // The shards are locked with the wheel released, since puts lock
+            // them the other way around
+            if (!expired.empty()) {
+                ExpireObjects(expired);
+                expired.clear();
+            }
         }
+    }
+    VLOG(1) << "action=ttl_thread_stopped";
+}
+
+void MasterService::DiscardExpiredProcessingReplicas(
+    MetadataShardAccessorRW& shard,
+    const std::chrono::steady_clock::time_point& now) {
+    std::list<DiscardedReplicas> discarded_replicas;
 
-        auto& metadata = metadata_it->second;
+    // Only the objects with in-flight operations are tracked, so neither
+    // part needs to scan the shard.
+    for (const std::string* key : shard->metadata.TrackedKeys()) {
+        auto it = shard->metadata.find(*key);
+        auto& metadata = it->second;
 
-        // Release source refcnt.
-        auto source = metadata.GetReplicaByID(task_it->second.source_id);
-        if (source != nullptr) {
-            source->dec_refcnt();
+        // Part 1: Discard expired PutStart operations.
+        if (metadata.in_processing) {
+            // If the object is not valid or not in processing state, just
+            // clear its processing state.
+            if (!metadata.IsValid() ||
+                metadata.AllReplicas(&Replica::fn_is_completed)) {
+                metadata.in_processing = false;
+            } else {
+                // If the object's PutStart timedout, discard and release
+                // it's space. Note that instead of releasing the space
+                // directly, we insert the replicas into the discarded list
+                // so that the discarding and releasing operations can be
+                // recorded in statistics.
+                const auto ttl =
+                    metadata.put_start_time + put_start_release_timeout_sec_;
+                if (ttl < now) {
+                    auto replicas =
+                        metadata.PopReplicas(&Replica::fn_is_processing);
+                    if (!replicas.empty()) {
+                        discarded_replicas.emplace_back(std::move(replicas),
+                                                        ttl);
+                    }
+                    metadata.in_processing = false;
+                }
+            }
         }
 
-        // Discard allocated replicas.
-        auto& replica_ids = task_it->second.replica_ids;
-        auto replicas =
-            metadata.PopReplicas([&replica_ids](const Replica& replica) {
-                auto it = std::find(replica_ids.begin(), replica_ids.end(),
-                                    replica.id());
-                return it != replica_ids.end();
-            });
-        if (!replicas.empty()) {
-            discarded_replicas.emplace_back(std::move(replicas), ttl);
+        // Part 2: Discard expired CopyStart/MoveStart operations.
+        if (metadata.replication_task) {
+            const auto& task = *metadata.replication_task;
+            const auto ttl = task.start_time + put_start_release_timeout_sec_;
+            if (ttl <= now) {
+                // Release source refcnt.
+                auto source = metadata.GetReplicaByID(task.source_id);
+                if (source != nullptr) {
+                    source->dec_refcnt();
+                }
+
+                // Discard allocated replicas.
+                const auto& replica_ids = task.replica_ids;
+                auto replicas = metadata.PopReplicas(
+                    [&replica_ids](const Replica& replica) {
+                        auto it = std::find(replica_ids.begin(),
+                                            replica_ids.end(), replica.id());
+                        return it != replica_ids.end();
+                    });
+                if (!replicas.empty()) {
+                    discarded_replicas.emplace_back(std::move(replicas), ttl);
+                }
+                metadata.replication_task.reset();
+            }
         }
 
-        // Check whether the object is still valid.
+        // All replicas of this object may be discarded, just remove the
+        // whole object.
         if (!metadata.IsValid()) {
-            shard->metadata.erase(metadata_it);
+            shard->metadata.erase(it);
+        } else {
+            UpdateTracking(shard->metadata, it);
         }
-
-        task_it = shard->replication_tasks.erase(task_it);
     }
 
     if (!discarded_replicas.empty()) {
@@ -1750,8 +4945,8 @@ void MasterService::BatchEvict(double evict_ratio_target,
     uint64_t total_freed_size = 0;
 
     // Candidates for second pass eviction
-    std::vector<std::chrono::steady_clock::time_point> no_pin_objects;
-    std::vector<std::chrono::steady_clock::time_point> soft_pin_objects;
+    std::vector<double> no_pin_objects;
+    std::vector<double> soft_pin_objects;
 
     auto can_evict_replicas = [](const ObjectMetadata& metadata) {
         return metadata.HasReplica([](const Replica& replica) {
@@ -1760,7 +4955,10 @@ void MasterService::BatchEvict(double evict_ratio_target,
         });
     };
 
-    auto evict_replicas = [](ObjectMetadata& metadata) {
+    auto evict_replicas = [this](ObjectMetadata& metadata) {
+        AdvanceEvictionClock(metadata);
+        // From now on the heat counts the reads served by disk
+        metadata.ResetAccessCount();
         return metadata.EraseReplicas([](const Replica& replica) {
             return replica.is_memory_replica() && replica.is_completed() &&
                    replica.get_refcnt() == 0;
@@ -1788,8 +4986,7 @@ void MasterService::BatchEvict(double evict_ratio_target,
         const long ideal_evict_num =
             std::ceil(object_count * evict_ratio_target) - evicted_count;
 
-        std::vector<std::chrono::steady_clock::time_point>
-            candidates;  // can be removed
+        std::vector<double> candidates;  // can be removed
         for (auto it = shard->metadata.begin(); it != shard->metadata.end();
              it++) {
             // Skip objects that are not expired or have incomplete replicas
@@ -1800,16 +4997,16 @@ void MasterService::BatchEvict(double evict_ratio_target,
             if (!it->second.IsSoftPinned(now)) {
                 if (ideal_evict_num > 0) {
                     // first pass candidates
-                    candidates.push_back(it->second.lease_timeout);
+                    candidates.push_back(EvictionRank(it->second));
                 } else {
                     // No need to evict any object in this shard, put to
                     // second pass candidates
-                    no_pin_objects.push_back(it->second.lease_timeout);
+                    no_pin_objects.push_back(EvictionRank(it->second));
                 }
             } else if (allow_evict_soft_pinned_objects_) {
                 // second pass candidates, only if
                 // allow_evict_soft_pinned_objects_ is true
-                soft_pin_objects.push_back(it->second.lease_timeout);
+                soft_pin_objects.push_back(EvictionRank(it->second));
             }
         }
 
@@ -1820,8 +5017,8 @@ void MasterService::BatchEvict(double evict_ratio_target,
             std::nth_element(candidates.begin(),
                              candidates.begin() + (evict_num - 1),
                              candidates.end());
-            auto target_timeout = candidates[evict_num - 1];
-            // Evict objects with lease timeout less than or equal to target.
+            auto target_rank = candidates[evict_num - 1];
+            // Evict objects with rank less than or equal to target.
             auto it = shard->metadata.begin();
             while (it != shard->metadata.end()) {
                 // Skip objects that are not allowed to be evicted in the first
@@ -1832,20 +5029,28 @@ void MasterService::BatchEvict(double evict_ratio_target,
                     ++it;
                     continue;
                 }
-                if (it->second.lease_timeout <= target_timeout) {
+                if (EvictionRank(it->second) <= target_rank) {
+                    if (DemoteBeforeEvict(it->first, it->second, now)) {
+                        ++it;
+                        continue;
+                    }
                     // Evict this object
                     total_freed_size +=
                         it->second.size *
                         evict_replicas(it->second);  // Erase memory replicas
                     if (it->second.IsValid() == false) {
+                        LogObject(it->first, nullptr,
+                                  OpLogType::EVICT_OBJECT);
                         it = shard->metadata.erase(it);
                     } else {
+                        LogObject(it->first, &it->second,
+                                  OpLogType::EVICT_OBJECT);
                         ++it;
                     }
                     shard_evicted_count++;
                 } else {
                     // second pass candidates
-                    no_pin_objects.push_back(it->second.lease_timeout);
+                    no_pin_objects.push_back(EvictionRank(it->second));
                     ++it;
                 }
             }
@@ -1880,26 +5085,31 @@ void MasterService::BatchEvict(double evict_ratio_target,
             std::nth_element(no_pin_objects.begin(),
                              no_pin_objects.begin() + (target_evict_num - 1),
                              no_pin_objects.end());
-            auto target_timeout = no_pin_objects[target_evict_num - 1];
+            auto target_rank = no_pin_objects[target_evict_num - 1];
 
-            // Evict objects with lease timeout less than or equal to target.
+            // Evict objects with rank less than or equal to target.
             // Stop when the target is reached.
             for (size_t i = 0; i < kNumShards && target_evict_num > 0; i++) {
                 MetadataShardAccessorRW shard(this,
                                               (start_idx + i) % kNumShards);
                 auto it = shard->metadata.begin();
                 while (it != shard->metadata.end() && target_evict_num > 0) {
-                    if (it->second.lease_timeout <= target_timeout &&
+                    if (EvictionRank(it->second) <= target_rank &&
                         !it->second.IsSoftPinned(now) &&
-                        can_evict_replicas(it->second)) {
+                        can_evict_replicas(it->second) &&
+                        !DemoteBeforeEvict(it->first, it->second, now)) {
                         // Evict this object
                         total_freed_size +=
                             it->second.size *
                             evict_replicas(
                                 it->second);  // Erase memory replicas
                         if (it->second.IsValid() == false) {
+                            LogObject(it->first, nullptr,
+                                      OpLogType::EVICT_OBJECT);
                             it = shard->metadata.erase(it);
                         } else {
+                            LogObject(it->first, &it->second,
+                                      OpLogType::EVICT_OBJECT);
                             ++it;
                         }
                         evicted_count++;
@@ -1917,12 +5127,12 @@ void MasterService::BatchEvict(double evict_ratio_target,
             const long soft_pin_evict_num =
                 target_evict_num - static_cast<long>(no_pin_objects.size());
             // For soft pin objects, prioritize to evict the ones with smaller
-            // lease timeout.
+            // rank.
             std::nth_element(
                 soft_pin_objects.begin(),
                 soft_pin_objects.begin() + (soft_pin_evict_num - 1),
                 soft_pin_objects.end());
-            auto soft_target_timeout = soft_pin_objects[soft_pin_evict_num - 1];
+            auto soft_target_rank = soft_pin_objects[soft_pin_evict_num - 1];
 
             // Stop when the target is reached.
             for (size_t i = 0; i < kNumShards && target_evict_num > 0; i++) {
@@ -1939,16 +5149,21 @@ void MasterService::BatchEvict(double evict_ratio_target,
                         continue;
                     }
                     // Evict objects with 1). no soft pin OR 2). with soft pin
-                    // and lease timeout less than or equal to target.
-                    if (!it->second.IsSoftPinned(now) ||
-                        it->second.lease_timeout <= soft_target_timeout) {
+                    // and rank less than or equal to target.
+                    if ((!it->second.IsSoftPinned(now) ||
+                         EvictionRank(it->second) <= soft_target_rank) &&
+                        !DemoteBeforeEvict(it->first, it->second, now)) {
                         total_freed_size +=
                             it->second.size *
                             evict_replicas(
                                 it->second);  // Erase memory replicas
                         if (it->second.IsValid() == false) {
+                            LogObject(it->first, nullptr,
+                                      OpLogType::EVICT_OBJECT);
                             it = shard->metadata.erase(it);
                         } else {
+                            LogObject(it->first, &it->second,
+                                      OpLogType::EVICT_OBJECT);
                             ++it;
                         }
                         evicted_count++;
@@ -1983,11 +5198,531 @@ void MasterService::BatchEvict(double evict_ratio_target,
         }
         MasterMetricManager::instance().inc_eviction_fail();
     }
+    MasterMetricManager::instance().observe_eviction_pass(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - now)
+            .count(),
+        evicted_count);
+    heat_epoch_.fetch_add(1);
     VLOG(1) << "action=evict_objects"
             << ", evicted_count=" << evicted_count
             << ", total_freed_size=" << total_freed_size;
 }
 
+double MasterService::EvictionRank(const ObjectMetadata& metadata) const {
+    double rank;
+    if (enable_cost_aware_eviction_) {
+        // Zero for objects neither put nor read by this master, e.g. those
+        // restored from a snapshot, which count as just put
+        if (metadata.eviction_priority.load(std::memory_order_relaxed) == 0) {
+            UpdateEvictionPriority(metadata, 1);
+        }
+        rank = metadata.eviction_priority.load(std::memory_order_relaxed);
+    } else {
+        rank = static_cast<double>(
+            metadata.lease_timeout.load().time_since_epoch().count());
+    }
+    // Both ranks are non-negative. The objects of tenants over their quota
+    // rank below all others, in the same order among themselves.
+    if (metadata.tenant && metadata.tenant->IsOverQuota()) {
+        return -1.0 / (1.0 + rank);
+    }
+    return rank;
+}
+
+void MasterService::UpdateEvictionPriority(const ObjectMetadata& metadata,
+                                           uint32_t frequency) const {
+    // Objects without a hint cost one per byte
+    const double cost_per_byte =
+        metadata.cost_hint > 0
+            ? static_cast<double>(metadata.cost_hint) / metadata.size
+            : 1.0;
+    metadata.eviction_priority.store(
+        eviction_clock_.load(std::memory_order_relaxed) +
+            std::max<uint32_t>(frequency, 1) * cost_per_byte,
+        std::memory_order_relaxed);
+}
+
+void MasterService::AdvanceEvictionClock(const ObjectMetadata& metadata) {
+    if (!enable_cost_aware_eviction_) {
+        return;
+    }
+    // The clock is the highest priority evicted so far, so that objects
+    // not read since age out against those read recently
+    const double priority =
+        metadata.eviction_priority.load(std::memory_order_relaxed);
+    double clock = eviction_clock_.load(std::memory_order_relaxed);
+    while (clock < priority &&
+           !eviction_clock_.compare_exchange_weak(clock, priority,
+                                                  std::memory_order_relaxed)) {
+    }
+}
+
+long MasterService::EvictSampledFromShard(
+    MetadataShardAccessorRW& shard, std::chrono::steady_clock::time_point& now,
+    bool allow_soft_pinned, long max_evict_num, uint64_t& freed_size) {
+    auto& metadata = shard->metadata;
+    if (metadata.empty() || max_evict_num <= 0) {
+        return 0;
+    }
+
+    struct Candidate {
+        bool soft_pinned;
+        double rank;
+        const std::string* key;  // points into the map node, stable until
+                                 // the node is erased
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(eviction_sample_size_);
+
+    auto try_add_candidate = [&](const std::string& key,
+                                 const ObjectMetadata& object) {
+        if (!object.IsLeaseExpired(now) ||
+            !object.HasReplica([](const Replica& replica) {
+                return replica.is_memory_replica() && replica.is_completed() &&
+                       replica.get_refcnt() == 0;
+            })) {
+            return;
+        }
+        const bool soft_pinned = object.IsSoftPinned(now);
+        if (soft_pinned && !allow_soft_pinned) {
+            return;
+        }
+        candidates.push_back({soft_pinned, EvictionRank(object), &key});
+    };
+
+    size_t sampled = 0;
+    if (metadata.size() <= eviction_sample_size_) {
+        // Small shard, just look at everything.
+        for (const auto& [key, object] : metadata) {
+            try_add_candidate(key, object);
+        }
+    } else {
+        // Sample consecutive slots starting from a random one, so that
+        // repeated ticks converge to an approximate LRU order without
+        // scanning the shard. The shard has more objects than the sample, so
+        // wrapping around never visits an object twice.
+        auto it = metadata.begin_from(rand() % metadata.capacity());
+        for (; sampled < eviction_sample_size_; ++it) {
+            if (it == metadata.end()) {
+                it = metadata.begin();
+            }
+            sampled++;
+            try_add_candidate(it->first, it->second);
+        }
+    }
+
+    if (candidates.empty()) {
+        return 0;
+    }
+
+    // Only evict the older half of the sampled candidates so that recently
+    // used objects survive even when they happen to be sampled.
+    const long evict_num =
+        std::min(max_evict_num,
+                 std::max(1L, static_cast<long>(candidates.size() + 1) / 2));
+    std::partial_sort(candidates.begin(), candidates.begin() + evict_num,
+                      candidates.end(),
+                      [](const Candidate& lhs, const Candidate& rhs) {
+                          if (lhs.soft_pinned != rhs.soft_pinned) {
+                              return !lhs.soft_pinned;
+                          }
+                          return lhs.rank < rhs.rank;
+                      });
+
+    long evicted_count = 0;
+    for (long i = 0; i < evict_num; ++i) {
+        auto it = metadata.find(*candidates[i].key);
+        if (it == metadata.end() ||
+            DemoteBeforeEvict(it->first, it->second, now)) {
+            continue;
+        }
+        AdvanceEvictionClock(it->second);
+        it->second.ResetAccessCount();
+        freed_size += it->second.size *
+                      it->second.EraseReplicas([](const Replica& replica) {
+                          return replica.is_memory_replica() &&
+                                 replica.is_completed() &&
+                                 replica.get_refcnt() == 0;
+                      });
+        if (!it->second.IsValid()) {
+            LogObject(it->first, nullptr, OpLogType::EVICT_OBJECT);
+            metadata.erase(it);
+        } else {
+            LogObject(it->first, &it->second, OpLogType::EVICT_OBJECT);
+        }
+        evicted_count++;
+    }
+    return evicted_count;
+}
+
+void MasterService::SampledEvict(double evict_ratio_target,
+                                 double evict_ratio_lowerbound) {
+    auto& pass = sampled_eviction_pass_;
+    auto now = std::chrono::steady_clock::now();
+
+    if (!pass.active) {
+        if (evict_ratio_target < evict_ratio_lowerbound) {
+            LOG(ERROR) << "evict_ratio_target=" << evict_ratio_target
+                       << ", evict_ratio_lowerbound=" << evict_ratio_lowerbound
+                       << ", error=invalid_params";
+            evict_ratio_lowerbound = evict_ratio_target;
+        }
+        // The key count gauge is approximate but avoids locking every shard
+        // just to start a pass.
+        const long object_count = std::max<int64_t>(
+            0, MasterMetricManager::instance().get_key_count());
+        pass = SampledEvictionPass{};
+        pass.active = true;
+        pass.target_evict_num = std::max(
+            1L,
+            static_cast<long>(std::ceil(object_count * evict_ratio_target)));
+        pass.lowerbound_evict_num = static_cast<long>(
+            std::ceil(object_count * evict_ratio_lowerbound));
+        pass.start_time = now;
+    }
+
+    for (uint32_t i = 0; i < eviction_shards_per_tick_ &&
+                         pass.evicted_count < pass.target_evict_num;
+         ++i) {
+        MetadataShardAccessorRW shard(this, eviction_shard_cursor_);
+        eviction_shard_cursor_ = (eviction_shard_cursor_ + 1) % kNumShards;
+        pass.visited_shards++;
+
+        // Discard expired processing keys first so that they won't be counted
+        // in later evictions.
+        DiscardExpiredProcessingReplicas(shard, now);
+
+        // Spread the pass over shards in proportion to their sizes.
+        const long shard_quota = std::max(
+            1L, static_cast<long>(
+                    std::ceil(shard->metadata.size() * evict_ratio_target)));
+        const long shard_evicted = EvictSampledFromShard(
+            shard, now, pass.allow_soft_pinned,
+            std::min(shard_quota, pass.target_evict_num - pass.evicted_count),
+            pass.freed_size);
+        pass.evicted_count += shard_evicted;
+        pass.sweep_evicted_count += shard_evicted;
+    }
+
+    if (pass.evicted_count < pass.target_evict_num) {
+        if (pass.visited_shards < kNumShards) {
+            return;  // Continue in the next tick.
+        }
+        // A whole sweep is done.
+        const bool made_progress = pass.sweep_evicted_count > 0;
+        pass.visited_shards = 0;
+        pass.sweep_evicted_count = 0;
+        if (made_progress) {
+            return;
+        }
+        if (!pass.allow_soft_pinned && allow_evict_soft_pinned_objects_ &&
+            pass.evicted_count < pass.lowerbound_evict_num) {
+            // Nothing left without soft pin, fall back to soft pinned
+            // objects to reach the lower bound.
+            pass.allow_soft_pinned = true;
+            return;
+        }
+    }
+
+    // The pass is finished.
+    uint64_t released_discarded_cnt = ReleaseExpiredDiscardedReplicas(now);
+    if (pass.evicted_count > 0 || released_discarded_cnt > 0) {
+        need_eviction_ = false;
+        MasterMetricManager::instance().inc_eviction_success(
+            pass.evicted_count, pass.freed_size);
+    } else {
+        if (MasterMetricManager::instance().get_key_count() == 0) {
+            // No objects to evict, no need to check again
+            need_eviction_ = false;
+        }
+        MasterMetricManager::instance().inc_eviction_fail();
+    }
+    MasterMetricManager::instance().observe_eviction_pass(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - pass.start_time)
+            .count(),
+        pass.evicted_count);
+    heat_epoch_.fetch_add(1);
+    VLOG(1) << "action=sampled_evict_objects"
+            << ", evicted_count=" << pass.evicted_count
+            << ", total_freed_size=" << pass.freed_size;
+    pass.active = false;
+}
+
+auto MasterService::GetSegmentUsages()
+    -> std::unordered_map<std::string, SegmentUsage> {
+    std::unordered_map<std::string, SegmentUsage> usages;
+    ScopedAllocatorAccess allocator_access =
+        segment_manager_.getAllocatorAccess();
+    const auto& allocator_manager = allocator_access.getAllocatorManager();
+    for (const auto& name : allocator_manager.getNames()) {
+        const auto* allocators = allocator_manager.getAllocators(name);
+        if (allocators == nullptr) {
+            continue;
+        }
+        auto& usage = usages[name];
+        for (const auto& allocator : *allocators) {
+            if (!allocator) continue;
+            usage.capacity += allocator->capacity();
+            usage.used += allocator->size();
+        }
+    }
+    return usages;
+}
+
+std::unordered_map<std::string, uint64_t>
+MasterService::GetSegmentEvictionTargets(bool allocation_failed) {
+    const auto usages = GetSegmentUsages();
+    uint64_t total_capacity = 0;
+    uint64_t total_used = 0;
+    for (const auto& [name, usage] : usages) {
+        total_capacity += usage.capacity;
+        total_used += usage.used;
+    }
+
+    std::unordered_map<std::string, uint64_t> targets;
+    if (total_capacity == 0) {
+        return targets;
+    }
+    const double global_ratio =
+        static_cast<double>(total_used) / static_cast<double>(total_capacity);
+    for (const auto& [name, usage] : usages) {
+        if (usage.capacity == 0 || usage.used == 0) {
+            continue;
+        }
+        const double used_ratio = static_cast<double>(usage.used) /
+                                  static_cast<double>(usage.capacity);
+        if (used_ratio <= eviction_high_watermark_ratio_ &&
+            !(allocation_failed && eviction_ratio_ > 0.0 &&
+              used_ratio >= global_ratio)) {
+            continue;
+        }
+        const double evict_ratio = std::max(
+            eviction_ratio_,
+            used_ratio - eviction_high_watermark_ratio_ + eviction_ratio_);
+        targets[name] = std::min<uint64_t>(
+            usage.used,
+            static_cast<uint64_t>(std::ceil(evict_ratio * usage.capacity)));
+    }
+    return targets;
+}
+
+void MasterService::SegmentPressureEvict(
+    std::unordered_map<std::string, uint64_t> targets) {
+    auto now = std::chrono::steady_clock::now();
+    const auto start_time = now;
+    const size_t num_segments = targets.size();
+
+    // Whether the replica can be dropped and is on a segment of budget
+    auto on_segment_of =
+        [](const Replica& replica,
+           const std::unordered_map<std::string, uint64_t>& budget) {
+            if (!replica.is_memory_replica() || !replica.is_completed() ||
+                replica.get_refcnt() != 0) {
+                return false;
+            }
+            for (const auto& name : replica.get_segment_names()) {
+                if (name.has_value() && budget.count(*name)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+    // Takes the bytes freed by a dropped replica off budget, approximating
+    // a striped replica as spread evenly over its segments
+    auto charge = [](const Replica& replica, uint64_t size,
+                     std::unordered_map<std::string, uint64_t>& budget) {
+        const auto names = replica.get_segment_names();
+        const uint64_t share = size / std::max<size_t>(names.size(), 1);
+        for (const auto& name : names) {
+            if (!name.has_value()) continue;
+            auto it = budget.find(*name);
+            if (it == budget.end()) continue;
+            if (it->second <= share) {
+                budget.erase(it);
+            } else {
+                it->second -= share;
+            }
+        }
+    };
+
+    struct Candidate {
+        bool soft_pinned;
+        double rank;
+        const std::string* key;  // points into the map node
+    };
+    std::vector<Candidate> candidates;
+    long evicted_count = 0;
+    uint64_t freed_size = 0;
+
+    // Objects are spread evenly over the shards, so each shard frees its
+    // share of what is left to free
+    size_t start_idx = rand() % kNumShards;
+    for (size_t i = 0; i < kNumShards && !targets.empty(); i++) {
+        MetadataShardAccessorRW shard(this, (start_idx + i) % kNumShards);
+        DiscardExpiredProcessingReplicas(shard, now);
+
+        const size_t shards_left = kNumShards - i;
+        std::unordered_map<std::string, uint64_t> quotas;
+        for (const auto& [name, bytes] : targets) {
+            quotas[name] = (bytes + shards_left - 1) / shards_left;
+        }
+
+        candidates.clear();
+        for (const auto& [key, object] : shard->metadata) {
+            if (!object.IsLeaseExpired(now) ||
+                !object.HasReplica([&](const Replica& replica) {
+                    return on_segment_of(replica, quotas);
+                })) {
+                continue;
+            }
+            const bool soft_pinned = object.IsSoftPinned(now);
+            if (soft_pinned && !allow_evict_soft_pinned_objects_) {
+                continue;
+            }
+            candidates.push_back({soft_pinned, EvictionRank(object), &key});
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Candidate& lhs, const Candidate& rhs) {
+                      if (lhs.soft_pinned != rhs.soft_pinned) {
+                          return !lhs.soft_pinned;
+                      }
+                      return lhs.rank < rhs.rank;
+                  });
+
+        for (const auto& candidate : candidates) {
+            if (quotas.empty()) {
+                break;
+            }
+            auto it = shard->metadata.find(*candidate.key);
+            auto& object = it->second;
+            auto pressured = [&](const Replica& replica) {
+                return on_segment_of(replica, quotas);
+            };
+            // The quota of its segments may be used up already
+            if (!object.HasReplica(pressured) ||
+                DemoteBeforeEvict(it->first, object, now)) {
+                continue;
+            }
+            AdvanceEvictionClock(object);
+            auto dropped = object.PopReplicas(pressured);
+            for (const auto& replica : dropped) {
+                charge(replica, object.size, quotas);
+                charge(replica, object.size, targets);
+            }
+            freed_size += object.size * dropped.size();
+            if (!object.HasReplica([](const Replica& replica) {
+                    return replica.is_memory_replica();
+                })) {
+                // From now on the heat counts the reads served by disk
+                object.ResetAccessCount();
+            }
+            if (!object.IsValid()) {
+                LogObject(it->first, nullptr, OpLogType::EVICT_OBJECT);
+                shard->metadata.erase(it);
+            } else {
+                LogObject(it->first, &object, OpLogType::EVICT_OBJECT);
+            }
+            evicted_count++;
+        }
+    }
+
+    uint64_t released_discarded_cnt = ReleaseExpiredDiscardedReplicas(now);
+    if (evicted_count > 0 || released_discarded_cnt > 0) {
+        need_eviction_ = false;
+        MasterMetricManager::instance().inc_eviction_success(evicted_count,
+                                                             freed_size);
+    } else {
+        if (MasterMetricManager::instance().get_key_count() == 0) {
+            // No objects to evict, no need to check again
+            need_eviction_ = false;
+        }
+        MasterMetricManager::instance().inc_eviction_fail();
+    }
+    MasterMetricManager::instance().observe_eviction_pass(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time)
+            .count(),
+        evicted_count);
+    heat_epoch_.fetch_add(1);
+    VLOG(1) << "action=segment_pressure_evict"
+            << ", pressured_segments=" << num_segments
+            << ", evicted_count=" << evicted_count
+            << ", total_freed_size=" << freed_size;
+}
+
+// Expire the clients and unmount their segments. Shared by the client
+// monitor and the operation log replay of standby masters.
+void MasterService::ExpireClients(const std::vector<UUID>& expired_clients) {
+    // Record which segments are unmounted, will be used in the commit
+    // phase.
+    std::vector<UUID> unmount_segments;
+    std::vector<size_t> dec_capacities;
+    std::vector<UUID> client_ids;
+    std::vector<std::string> segment_names;
+    {
+        // Lock client_mutex and segment_mutex
+        std::unique_lock<std::shared_mutex> lock(client_mutex_);
+        for (auto& client_id : expired_clients) {
+            auto it = ok_client_.find(client_id);
+            if (it != ok_client_.end()) {
+                ok_client_.erase(it);
+                MasterMetricManager::instance().dec_active_clients();
+            }
+        }
+
+        ScopedSegmentAccess segment_access =
+            segment_manager_.getSegmentAccess();
+        for (auto& client_id : expired_clients) {
+            if (IsOpLogEnabled()) {
+                OpLogEntry entry;
+                entry.type = OpLogType::EXPIRE_CLIENT;
+                entry.client_id = client_id;
+                oplog_->Append(std::move(entry));
+            }
+            std::vector<Segment> segments;
+            segment_access.GetClientSegments(client_id, segments);
+            for (auto& seg : segments) {
+                size_t metrics_dec_capacity = 0;
+                if (segment_access.PrepareUnmountSegment(
+                        seg.id, metrics_dec_capacity) == ErrorCode::OK) {
+                    unmount_segments.push_back(seg.id);
+                    dec_capacities.push_back(metrics_dec_capacity);
+                    client_ids.push_back(client_id);
+                    segment_names.push_back(seg.name);
+                } else {
+                    LOG(ERROR) << "client_id=" << client_id
+                               << ", segment_name=" << seg.name
+                               << ", "
+                                  "error=prepare_unmount_expired_"
+                                  "segment_failed";
+                }
+            }
+        }
+    }  // Release the mutex before committing the unmount
+    ReleaseClientPutLeases(expired_clients);
+
+    if (!unmount_segments.empty()) {
+        // The objects of the expired segments are removed by the sweep
+        // thread and, until it reaches their shard, on access. Their
+        // buffers are already invalid, so the segments can be committed
+        // right away and the client monitor is not blocked by the sweep.
+        BumpSegmentGeneration();
+
+        ScopedSegmentAccess segment_access =
+            segment_manager_.getSegmentAccess();
+        for (size_t i = 0; i < unmount_segments.size(); i++) {
+            segment_access.CommitUnmountSegment(
+                unmount_segments[i], client_ids[i], dec_capacities[i]);
+            LOG(INFO) << "client_id=" << client_ids[i]
+                      << ", segment_name=" << segment_names[i]
+                      << ", action=unmount_expired_segment";
+        }
+        RequestInvalidHandleSweep();
+    }
+}
+
 void MasterService::ClientMonitorFunc() {
     std::unordered_map<UUID, std::chrono::steady_clock::time_point,
                        boost::hash<UUID>>
@@ -2003,6 +5738,15 @@ void MasterService::ClientMonitorFunc() {
                 now + std::chrono::seconds(client_live_ttl_sec_);
         }
 
+        if (standby_) {
+            // Clients only ping the leader, which expires them through the
+            // operation log. Promote() restarts the timing of all clients.
+            client_ttl.clear();
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(kClientMonitorSleepMs));
+            continue;
+        }
+
         // Find out expired clients
         std::vector<UUID> expired_clients;
         for (auto it = client_ttl.begin(); it != client_ttl.end();) {
@@ -2018,62 +5762,7 @@ void MasterService::ClientMonitorFunc() {
 
         // Update the client status to NEED_REMOUNT
         if (!expired_clients.empty()) {
-            // Record which segments are unmounted, will be used in the commit
-            // phase.
-            std::vector<UUID> unmount_segments;
-            std::vector<size_t> dec_capacities;
-            std::vector<UUID> client_ids;
-            std::vector<std::string> segment_names;
-            {
-                // Lock client_mutex and segment_mutex
-                std::unique_lock<std::shared_mutex> lock(client_mutex_);
-                for (auto& client_id : expired_clients) {
-                    auto it = ok_client_.find(client_id);
-                    if (it != ok_client_.end()) {
-                        ok_client_.erase(it);
-                        MasterMetricManager::instance().dec_active_clients();
-                    }
-                }
-
-                ScopedSegmentAccess segment_access =
-                    segment_manager_.getSegmentAccess();
-                for (auto& client_id : expired_clients) {
-                    std::vector<Segment> segments;
-                    segment_access.GetClientSegments(client_id, segments);
-                    for (auto& seg : segments) {
-                        size_t metrics_dec_capacity = 0;
-                        if (segment_access.PrepareUnmountSegment(
-                                seg.id, metrics_dec_capacity) ==
-                            ErrorCode::OK) {
-                            unmount_segments.push_back(seg.id);
-                            dec_capacities.push_back(metrics_dec_capacity);
-                            client_ids.push_back(client_id);
-                            segment_names.push_back(seg.name);
-                        } else {
-                            LOG(ERROR) << "client_id=" << client_id
-                                       << ", segment_name=" << seg.name
-                                       << ", "
-                                          "error=prepare_unmount_expired_"
-                                          "segment_failed";
-                        }
-                    }
-                }
-            }  // Release the mutex before long-running ClearInvalidHandles and
-               // avoid deadlocks
-
-            if (!unmount_segments.empty()) {
-                ClearInvalidHandles();
-
-                ScopedSegmentAccess segment_access =
-                    segment_manager_.getSegmentAccess();
-                for (size_t i = 0; i < unmount_segments.size(); i++) {
-                    segment_access.CommitUnmountSegment(
-                        unmount_segments[i], client_ids[i], dec_capacities[i]);
-                    LOG(INFO) << "client_id=" << client_ids[i]
-                              << ", segment_name=" << segment_names[i]
-                              << ", action=unmount_expired_segment";
-                }
-            }
+            ExpireClients(expired_clients);
         }
 
         std::this_thread::sleep_for(
@@ -2128,7 +5817,8 @@ tl::expected<UUID, ErrorCode> MasterService::CreateCopyTask(
         return tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND);
     }
 
-    ScopedSegmentAccess segment_accessor = segment_manager_.getSegmentAccess();
+    const ScopedSegmentAccess segment_accessor =
+        segment_manager_.getSegmentReadAccess();
     for (const auto& target : targets) {
         if (!segment_accessor.ExistsSegmentName(target)) {
             LOG(ERROR) << "key=" << key << ", target_segment=" << target
@@ -2157,11 +5847,13 @@ tl::expected<UUID, ErrorCode> MasterService::CreateCopyTask(
                    << ", error=client_id_not_found";
         return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
     }
-    return task_manager_.get_write_access()
-        .submit_task_typed<TaskType::REPLICA_COPY>(
-            select_client, {.key = key,
-                            .source = selected_source_segment,
-                            .targets = targets});
+    auto task_id = task_manager_.get_write_access()
+                       .submit_task_typed<TaskType::REPLICA_COPY>(
+                           select_client, {.key = key,
+                                           .source = selected_source_segment,
+                                           .targets = targets});
+    if (task_id) WakeTaskWaiters(select_client);
+    return task_id;
 }
 
 tl::expected<UUID, ErrorCode> MasterService::CreateMoveTask(
@@ -2180,7 +5872,8 @@ tl::expected<UUID, ErrorCode> MasterService::CreateMoveTask(
         return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
     }
 
-    ScopedSegmentAccess segment_accessor = segment_manager_.getSegmentAccess();
+    const ScopedSegmentAccess segment_accessor =
+        segment_manager_.getSegmentReadAccess();
     if (!segment_accessor.ExistsSegmentName(target)) {
         LOG(ERROR) << "key=" << key << ", target_segment=" << target
                    << ", error=target_segment_not_mounted";
@@ -2206,9 +5899,13 @@ tl::expected<UUID, ErrorCode> MasterService::CreateMoveTask(
         return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
     }
 
-    return task_manager_.get_write_access()
-        .submit_task_typed<TaskType::REPLICA_MOVE>(
-            select_client, {.key = key, .source = source, .target = target});
+    auto task_id =
+        task_manager_.get_write_access()
+            .submit_task_typed<TaskType::REPLICA_MOVE>(
+                select_client,
+                {.key = key, .source = source, .target = target});
+    if (task_id) WakeTaskWaiters(select_client);
+    return task_id;
 }
 
 tl::expected<QueryTaskResponse, ErrorCode> MasterService::QueryTask(
@@ -2233,6 +5930,28 @@ tl::expected<std::vector<TaskAssignment>, ErrorCode> MasterService::FetchTasks(
     return assignments;
 }
 
+void MasterService::WaitTasks(const UUID& client_id, size_t batch_size,
+                              uint64_t wait_ms, FetchTasksCallback done) {
+    auto tasks = FetchTasks(client_id, batch_size);
+    if (!tasks || !tasks->empty() || wait_ms == 0 ||
+        !task_cleanup_running_.load()) {
+        done(std::move(tasks));
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(task_waiters_mutex_);
+        task_waiters_[client_id].push_back(
+            {.batch_size = batch_size,
+             .deadline = std::chrono::steady_clock::now() +
+                         std::chrono::milliseconds(
+                             std::min(wait_ms, kMaxTaskWaitMs)),
+             .done = std::move(done)});
+    }
+    task_waiters_cv_.notify_one();
+    // A task submitted since the fetch above found no waiter to wake
+    WakeTaskWaiters(client_id);
+}
+
 tl::expected<void, ErrorCode> MasterService::MarkTaskToComplete(
     const UUID& client_id, const TaskCompleteRequest& request) {
     auto write_access = task_manager_.get_write_access();
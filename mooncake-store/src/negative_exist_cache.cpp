@@ -0,0 +1,78 @@
+#include "negative_exist_cache.h"
+
+#include "hash_ring.h"
+
+namespace mooncake {
+
+NegativeExistCache::NegativeExistCache(size_t capacity,
+                                       std::chrono::milliseconds ttl)
+    : capacity_(capacity), ttl_(ttl) {}
+
+bool NegativeExistCache::Contains(const std::string& key) {
+    MutexLocker lock(&mutex_);
+    auto it = index_.find(HashRing::Hash(key));
+    if (it == index_.end() || it->second->key != key) {
+        return false;
+    }
+    if (std::chrono::steady_clock::now() >= it->second->expires_at) {
+        EraseLocked(it);
+        return false;
+    }
+    return true;
+}
+
+void NegativeExistCache::Add(const std::string& key) {
+    const uint64_t hash = HashRing::Hash(key);
+    const auto expires_at = std::chrono::steady_clock::now() + ttl_;
+    MutexLocker lock(&mutex_);
+    auto it = index_.find(hash);
+    if (it != index_.end()) {
+        // Also replaces a key with the same hash
+        it->second->key = key;
+        it->second->expires_at = expires_at;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    if (index_.size() >= capacity_) {
+        index_.erase(entries_.back().hash);
+        entries_.pop_back();
+    }
+    entries_.push_front(Entry{hash, key, expires_at});
+    index_.emplace(hash, entries_.begin());
+}
+
+void NegativeExistCache::Invalidate(const std::string& key) {
+    MutexLocker lock(&mutex_);
+    auto it = index_.find(HashRing::Hash(key));
+    if (it != index_.end()) {
+        EraseLocked(it);
+    }
+}
+
+void NegativeExistCache::InvalidateHashes(const std::vector<uint64_t>& hashes) {
+    MutexLocker lock(&mutex_);
+    for (const uint64_t hash : hashes) {
+        auto it = index_.find(hash);
+        if (it != index_.end()) {
+            EraseLocked(it);
+        }
+    }
+}
+
+void NegativeExistCache::Clear() {
+    MutexLocker lock(&mutex_);
+    entries_.clear();
+    index_.clear();
+}
+
+size_t NegativeExistCache::Size() const {
+    MutexLocker lock(&mutex_);
+    return index_.size();
+}
+
+void NegativeExistCache::EraseLocked(Index::iterator it) {
+    entries_.erase(it->second);
+    index_.erase(it);
+}
+
+}  // namespace mooncake
@@ -3,6 +3,8 @@
 
 #include "offset_allocator/offset_allocator.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
@@ -442,6 +444,23 @@ uint32 __Allocator::allocationSize(OffsetAllocation allocation) const {
     return m_nodes[allocation.metadata].dataSize;
 }
 
+uint32 __Allocator::freeNeighborSize(OffsetAllocation allocation) const {
+    if (allocation.metadata == OffsetAllocation::NO_SPACE) return 0;
+    if (allocation.metadata >= m_nodes.size()) return 0;
+
+    const Node& node = m_nodes[allocation.metadata];
+    uint32 size = 0;
+    if (node.neighborPrev != Node::unused &&
+        !m_nodes[node.neighborPrev].used) {
+        size += m_nodes[node.neighborPrev].dataSize;
+    }
+    if (node.neighborNext != Node::unused &&
+        !m_nodes[node.neighborNext].used) {
+        size += m_nodes[node.neighborNext].dataSize;
+    }
+    return size;
+}
+
 OffsetAllocStorageReport __Allocator::storageReport() const {
     uint32 largestFreeRegion = 0;
     uint32 freeStorage = 0;
@@ -477,6 +496,74 @@ OffsetAllocStorageReportFull __Allocator::storageReportFull() const {
     return report;
 }
 
+uint32 __Allocator::allocationUnits(uint32 size) {
+#ifdef OFFSET_ALLOCATOR_NOT_ROUND_UP
+    return size;
+#else
+    return SmallFloat::floatToUint(SmallFloat::uintToFloatRoundUp(size));
+#endif
+}
+
+uint32 __Allocator::sizeClass(uint32 size) {
+    return SmallFloat::uintToFloatRoundUp(size);
+}
+
+void __Allocator::rebuild(
+    const std::vector<std::pair<uint32, uint32>>& used_nodes,
+    std::vector<NodeIndex>& node_indices) {
+    // Every used node may need a free node in front of it, plus the free
+    // node at the end of the storage.
+    const uint32 required_capacity =
+        static_cast<uint32>(used_nodes.size()) * 2 + 1;
+    ASSERT(required_capacity <= m_max_capacity);
+    m_current_capacity = std::max(m_current_capacity, required_capacity);
+
+    m_freeStorage = 0;
+    m_usedBinsTop = 0;
+    m_freeOffset = 0;
+    for (uint32 i = 0; i < NUM_TOP_BINS; i++) m_usedBins[i] = 0;
+    for (uint32 i = 0; i < NUM_LEAF_BINS; i++) m_binIndices[i] = Node::unused;
+
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_nodes.reserve(m_max_capacity);
+    m_freeNodes.reserve(m_max_capacity);
+    m_nodes.resize(m_current_capacity);
+    m_freeNodes.resize(m_current_capacity);
+    for (uint32 i = 0; i < m_current_capacity; i++) {
+        m_freeNodes[i] = i;
+    }
+
+    // Lay out the used nodes and the free gaps between them from the lowest
+    // offset, linking each node to its neighbors.
+    uint32 cursor = 0;
+    uint32 prevIndex = Node::unused;
+    auto linkNode = [&](uint32 nodeIndex) {
+        m_nodes[nodeIndex].neighborPrev = prevIndex;
+        if (prevIndex != Node::unused)
+            m_nodes[prevIndex].neighborNext = nodeIndex;
+        prevIndex = nodeIndex;
+    };
+
+    node_indices.clear();
+    node_indices.reserve(used_nodes.size());
+    for (const auto& [offset, size] : used_nodes) {
+        ASSERT(offset >= cursor);
+        if (offset > cursor) {
+            linkNode(insertNodeIntoBin(offset - cursor, cursor));
+        }
+        uint32 nodeIndex = m_freeNodes[m_freeOffset++];
+        m_nodes[nodeIndex] = {
+            .dataOffset = offset, .dataSize = size, .used = true};
+        linkNode(nodeIndex);
+        node_indices.push_back(nodeIndex);
+        cursor = offset + size;
+    }
+    if (cursor < m_size) {
+        linkNode(insertNodeIntoBin(m_size - cursor, cursor));
+    }
+}
+
 // OffsetAllocationHandle implementation
 OffsetAllocationHandle::OffsetAllocationHandle(
     std::shared_ptr<OffsetAllocator> allocator, OffsetAllocation allocation,
@@ -529,6 +616,14 @@ OffsetAllocationHandle::~OffsetAllocationHandle() {
     }
 }
 
+uint64_t OffsetAllocationHandle::freeNeighborSize() const {
+    auto allocator = m_allocator.lock();
+    if (!allocator) {
+        return 0;
+    }
+    return allocator->freeNeighborSize(m_allocation);
+}
+
 // Helper function to calculate the multiplier
 static uint64_t calculateMultiplier(size_t size) {
     uint64_t multiplier_bits = 0;
@@ -557,27 +652,190 @@ OffsetAllocator::OffsetAllocator(uint64_t base, size_t size,
                                                 init_capacity, max_capacity);
 }
 
-std::optional<OffsetAllocationHandle> OffsetAllocator::allocate(size_t size) {
-    if (size == 0) {
-        return std::nullopt;
+uint64_t OffsetAllocator::toUnits(uint64_t size) const {
+    return m_multiplier_bits > 0
+               ? ((size + (static_cast<uint64_t>(1) << m_multiplier_bits) -
+                   1u) >>
+                  m_multiplier_bits)
+               : size;
+}
+
+void OffsetAllocator::enableCache(uint64_t max_cached_size,
+                                  uint32 magazine_size) {
+#ifdef OFFSET_ALLOCATOR_NOT_ROUND_UP
+    // Allocations of a bin have different sizes, so they cannot be reused
+    (void)max_cached_size;
+    (void)magazine_size;
+#else
+    const uint64_t max_units =
+        std::min<uint64_t>(toUnits(max_cached_size), SmallFloat::MAX_BIN_SIZE);
+    if (max_units == 0 || magazine_size == 0) {
+        return;
+    }
+    m_cache_max_units = static_cast<uint32>(max_units);
+    m_magazine_size = magazine_size;
+    m_cache_shards = std::make_unique<CacheShard[]>(kCacheShards);
+    const uint32 num_classes = __Allocator::sizeClass(m_cache_max_units) + 1;
+    for (uint32 i = 0; i < kCacheShards; i++) {
+        SpinLocker locker(&m_cache_shards[i].lock);
+        m_cache_shards[i].magazines.resize(num_classes);
     }
+#endif
+}
+
+OffsetAllocator::CacheShard& OffsetAllocator::localCacheShard() const {
+    static std::atomic<uint32> next_shard{0};
+    thread_local uint32 shard =
+        next_shard.fetch_add(1, std::memory_order_relaxed) % kCacheShards;
+    return m_cache_shards[shard];
+}
 
+bool OffsetAllocator::refillMagazine(CacheShard& shard, uint32 size_class) {
+    const uint32 units = SmallFloat::floatToUint(size_class);
+    auto& magazine = shard.magazines[size_class];
+    const uint32 batch = std::max(m_magazine_size / 2, 1u);
     MutexLocker guard(&m_mutex);
     if (!m_allocator) {
+        return false;
+    }
+    for (uint32 i = 0; i < batch; i++) {
+        OffsetAllocation allocation = m_allocator->allocate(units);
+        if (allocation.isNoSpace()) {
+            break;
+        }
+        magazine.push_back(allocation);
+        shard.cached_units += units;
+    }
+    return !magazine.empty();
+}
+
+std::optional<OffsetAllocationHandle> OffsetAllocator::allocateCached(
+    size_t size, uint32 units) {
+    const uint32 size_class = __Allocator::sizeClass(units);
+    auto& shard = localCacheShard();
+    SpinLocker locker(&shard.lock);
+    auto& magazine = shard.magazines[size_class];
+    if (magazine.empty() && !refillMagazine(shard, size_class)) {
         return std::nullopt;
     }
+    OffsetAllocation allocation = magazine.back();
+    magazine.pop_back();
+    shard.cached_units -= SmallFloat::floatToUint(size_class);
+    shard.allocated_size += size;
+    shard.allocated_num++;
+    return OffsetAllocationHandle(
+        shared_from_this(), allocation,
+        m_base + (allocation.getOffset() << m_multiplier_bits), size);
+}
+
+void OffsetAllocator::freeCached(const OffsetAllocation& allocation,
+                                 uint64_t size, uint32 units) {
+    const uint32 size_class = __Allocator::sizeClass(units);
+    const uint32 class_units = SmallFloat::floatToUint(size_class);
+    auto& shard = localCacheShard();
+    SpinLocker locker(&shard.lock);
+    shard.allocated_size -= size;
+    shard.allocated_num--;
+    auto& magazine = shard.magazines[size_class];
+    magazine.push_back(allocation);
+    shard.cached_units += class_units;
+    if (magazine.size() <= m_magazine_size) {
+        return;
+    }
+    // Drain half of the magazine so that alternating frees and allocations
+    // do not go to the shared allocator every time
+    MutexLocker guard(&m_mutex);
+    while (magazine.size() > m_magazine_size / 2) {
+        if (m_allocator) {
+            m_allocator->free(magazine.back());
+        }
+        magazine.pop_back();
+        shard.cached_units -= class_units;
+    }
+}
+
+void OffsetAllocator::flushCaches() const {
+    if (!m_cache_shards) {
+        return;
+    }
+    for (uint32 i = 0; i < kCacheShards; i++) {
+        auto& shard = m_cache_shards[i];
+        SpinLocker locker(&shard.lock);
+        if (shard.cached_units == 0 && shard.allocated_num == 0 &&
+            shard.allocated_size == 0) {
+            continue;
+        }
+        MutexLocker guard(&m_mutex);
+        // Fold the shard counters into the allocator ones as well
+        m_allocated_size += shard.allocated_size;
+        m_allocated_num += shard.allocated_num;
+        shard.allocated_size = 0;
+        shard.allocated_num = 0;
+        for (auto& magazine : shard.magazines) {
+            for (const auto& allocation : magazine) {
+                if (m_allocator) {
+                    m_allocator->free(allocation);
+                }
+            }
+            magazine.clear();
+        }
+        shard.cached_units = 0;
+    }
+}
 
-    size_t fake_size =
-        m_multiplier_bits > 0
-            ? ((size + (static_cast<uint64_t>(1) << m_multiplier_bits) - 1u) >>
-               m_multiplier_bits)
-            : size;
+OffsetAllocator::CacheTotals OffsetAllocator::cacheTotals() const {
+    CacheTotals totals;
+    if (!m_cache_shards) {
+        return totals;
+    }
+    for (uint32 i = 0; i < kCacheShards; i++) {
+        auto& shard = m_cache_shards[i];
+        SpinLocker locker(&shard.lock);
+        totals.allocated_size += shard.allocated_size;
+        totals.allocated_num += shard.allocated_num;
+        totals.cached_units += shard.cached_units;
+    }
+    return totals;
+}
 
+std::optional<OffsetAllocationHandle> OffsetAllocator::allocate(size_t size) {
+    if (size == 0) {
+        return std::nullopt;
+    }
+
+    const uint64_t fake_size = toUnits(size);
     if (fake_size > SmallFloat::MAX_BIN_SIZE) {
         return std::nullopt;
     }
 
+    bool flushed = false;
+    if (m_cache_shards && fake_size <= m_cache_max_units) {
+        auto handle = allocateCached(size, static_cast<uint32>(fake_size));
+        if (handle) {
+            return handle;
+        }
+        // Out of space: other shards may still cache free allocations
+        flushCaches();
+        flushed = true;
+    }
+
+    MutexLocker guard(&m_mutex);
+    if (!m_allocator) {
+        return std::nullopt;
+    }
+
     OffsetAllocation allocation = m_allocator->allocate(fake_size);
+    if (allocation.isNoSpace() && m_cache_shards && !flushed) {
+        // Give the cached allocations back and retry. Shard locks are
+        // taken before m_mutex, so it is released meanwhile.
+        guard.unlock();
+        flushCaches();
+        guard.lock();
+        if (!m_allocator) {
+            return std::nullopt;
+        }
+        allocation = m_allocator->allocate(fake_size);
+    }
     if (allocation.isNoSpace()) {
         // Log metrics to help understand why allocation failed
         // Note: We're already holding m_mutex, so use internal method
@@ -607,6 +865,16 @@ OffsetAllocStorageReport OffsetAllocator::storageReport() const {
             report.largestFreeRegion << m_multiplier_bits};
 }
 
+uint64_t OffsetAllocator::freeNeighborSize(
+    const OffsetAllocation& allocation) const {
+    MutexLocker guard(&m_mutex);
+    if (!m_allocator) {
+        return 0;
+    }
+    return static_cast<uint64_t>(m_allocator->freeNeighborSize(allocation))
+           << m_multiplier_bits;
+}
+
 OffsetAllocStorageReportFull OffsetAllocator::storageReportFull() const {
     MutexLocker lock(&m_mutex);
     if (!m_allocator) {
@@ -640,12 +908,25 @@ OffsetAllocatorMetrics OffsetAllocator::get_metrics_internal() const {
 }
 
 OffsetAllocatorMetrics OffsetAllocator::get_metrics() const {
+    // Shard locks are taken before m_mutex everywhere else
+    const CacheTotals totals = cacheTotals();
     MutexLocker guard(&m_mutex);
-    return get_metrics_internal();
+    OffsetAllocatorMetrics metrics = get_metrics_internal();
+    metrics.allocated_size_ += totals.allocated_size;
+    metrics.allocated_num_ += totals.allocated_num;
+    metrics.cached_size_ = totals.cached_units << m_multiplier_bits;
+    return metrics;
 }
 
 void OffsetAllocator::freeAllocation(const OffsetAllocation& allocation,
                                      uint64_t size) {
+    if (m_cache_shards) {
+        const uint64_t units = toUnits(size);
+        if (units <= m_cache_max_units) {
+            freeCached(allocation, size, static_cast<uint32>(units));
+            return;
+        }
+    }
     MutexLocker lock(&m_mutex);
     if (m_allocator) {
         m_allocator->free(allocation);
@@ -655,6 +936,83 @@ void OffsetAllocator::freeAllocation(const OffsetAllocation& allocation,
     }
 }
 
+std::vector<std::optional<OffsetAllocationHandle>> OffsetAllocator::rebuild(
+    const std::vector<std::pair<uint64_t, uint64_t>>& buffers) {
+    std::vector<std::optional<OffsetAllocationHandle>> handles(buffers.size());
+
+    std::vector<size_t> order(buffers.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&buffers](size_t lhs, size_t rhs) {
+        return buffers[lhs].first < buffers[rhs].first;
+    });
+
+    // The allocator is reset below, so only clear the caches
+    if (m_cache_shards) {
+        for (uint32 i = 0; i < kCacheShards; i++) {
+            auto& shard = m_cache_shards[i];
+            SpinLocker locker(&shard.lock);
+            for (auto& magazine : shard.magazines) {
+                magazine.clear();
+            }
+            shard.cached_units = 0;
+            shard.allocated_size = 0;
+            shard.allocated_num = 0;
+        }
+    }
+
+    MutexLocker guard(&m_mutex);
+    if (!m_allocator) {
+        return handles;
+    }
+
+    const uint64_t unit = static_cast<uint64_t>(1) << m_multiplier_bits;
+    const uint64_t total_units = m_capacity >> m_multiplier_bits;
+    const uint64_t max_nodes = (m_allocator->maxCapacity() - 1) / 2;
+
+    std::vector<std::pair<uint32, uint32>> used_nodes;
+    std::vector<size_t> accepted;
+    used_nodes.reserve(buffers.size());
+    accepted.reserve(buffers.size());
+    uint64_t cursor = 0;
+    for (size_t index : order) {
+        const auto& [address, size] = buffers[index];
+        if (size == 0 || address < m_base || (address - m_base) % unit != 0 ||
+            used_nodes.size() >= max_nodes) {
+            continue;
+        }
+        const uint64_t offset = (address - m_base) >> m_multiplier_bits;
+        const uint64_t fake_size = (size + unit - 1) >> m_multiplier_bits;
+        if (fake_size > SmallFloat::MAX_BIN_SIZE || offset < cursor) {
+            continue;
+        }
+        const uint64_t units =
+            __Allocator::allocationUnits(static_cast<uint32>(fake_size));
+        if (offset + units > total_units) {
+            continue;
+        }
+        used_nodes.emplace_back(static_cast<uint32>(offset),
+                                static_cast<uint32>(units));
+        accepted.push_back(index);
+        cursor = offset + units;
+    }
+
+    std::vector<NodeIndex> node_indices;
+    m_allocator->rebuild(used_nodes, node_indices);
+    m_allocated_size = 0;
+    m_allocated_num = accepted.size();
+    for (size_t i = 0; i < accepted.size(); i++) {
+        const auto& [address, size] = buffers[accepted[i]];
+        m_allocated_size += size;
+        handles[accepted[i]].emplace(
+            shared_from_this(),
+            OffsetAllocation(used_nodes[i].first, node_indices[i]), address,
+            size);
+    }
+    return handles;
+}
+
 // Stream output operator implementation
 std::ostream& operator<<(std::ostream& os,
                          const OffsetAllocatorMetrics& metrics) {
@@ -671,7 +1029,9 @@ std::ostream& operator<<(std::ostream& os,
        << ", free_space="
        << mooncake::byte_size_to_string(metrics.total_free_space_)
        << ", largest_free="
-       << mooncake::byte_size_to_string(metrics.largest_free_region_) << "}";
+       << mooncake::byte_size_to_string(metrics.largest_free_region_)
+       << ", cached=" << mooncake::byte_size_to_string(metrics.cached_size_)
+       << "}";
     return os;
 }
 
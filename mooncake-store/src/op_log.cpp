@@ -0,0 +1,57 @@
+#include "op_log.h"
+
+#include <glog/logging.h>
+
+namespace mooncake {
+
+OpLog::OpLog(size_t capacity) : capacity_(capacity) {
+    if (capacity_ == 0) {
+        throw std::invalid_argument("OpLog capacity must be positive");
+    }
+}
+
+uint64_t OpLog::Append(OpLogEntry&& entry) {
+    MutexLocker lock(&mutex_);
+    entry.sequence_id = first_sequence_id_ + entries_.size();
+    const uint64_t sequence_id = entry.sequence_id;
+    entries_.emplace_back(std::move(entry));
+    if (entries_.size() > capacity_) {
+        entries_.pop_front();
+        first_sequence_id_++;
+    }
+    return sequence_id;
+}
+
+ErrorCode OpLog::Read(uint64_t start_sequence_id, size_t max_entries,
+                      std::vector<OpLogEntry>& entries) const {
+    MutexLocker lock(&mutex_);
+    const uint64_t next_sequence_id = first_sequence_id_ + entries_.size();
+    if (start_sequence_id < first_sequence_id_) {
+        VLOG(1) << "start_sequence_id=" << start_sequence_id
+                << ", first_sequence_id=" << first_sequence_id_
+                << ", error=oplog_truncated";
+        return ErrorCode::OPLOG_TRUNCATED;
+    }
+    if (start_sequence_id > next_sequence_id) {
+        LOG(ERROR) << "start_sequence_id=" << start_sequence_id
+                   << ", next_sequence_id=" << next_sequence_id
+                   << ", error=oplog_sequence_id_in_future";
+        return ErrorCode::INVALID_PARAMS;
+    }
+
+    const size_t begin = start_sequence_id - first_sequence_id_;
+    const size_t end = std::min(entries_.size(), begin + max_entries);
+    entries.clear();
+    entries.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+        entries.push_back(entries_[i]);
+    }
+    return ErrorCode::OK;
+}
+
+uint64_t OpLog::NextSequenceId() const {
+    MutexLocker lock(&mutex_);
+    return first_sequence_id_ + entries_.size();
+}
+
+}  // namespace mooncake
@@ -0,0 +1,136 @@
+#include "ping_aggregator.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "master_client.h"
+
+namespace mooncake {
+
+std::shared_ptr<PingAggregator> PingAggregator::Get(
+    const std::string& master_address) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<PingAggregator>>
+        aggregators;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = aggregators[master_address];
+    if (auto aggregator = slot.lock()) {
+        return aggregator;
+    }
+
+    // Only called from the round thread, which reconnects after a round
+    // failed as a whole
+    auto master_client = std::make_shared<MasterClient>(generate_uuid());
+    auto connected = std::make_shared<bool>(false);
+    auto aggregator = std::make_shared<PingAggregator>(
+        [master_client, connected,
+         master_address](const std::vector<BatchPingRequest>& requests) {
+            if (!*connected) {
+                ErrorCode err = master_client->Connect(master_address);
+                if (err != ErrorCode::OK) {
+                    LOG(ERROR) << "Failed to connect the ping aggregator to "
+                               << master_address << ": " << err;
+                    return Results(requests.size(), tl::make_unexpected(err));
+                }
+                *connected = true;
+            }
+            auto results = master_client->BatchPing(requests);
+            *connected = std::any_of(
+                results.begin(), results.end(), [](const auto& result) {
+                    return result || result.error() != ErrorCode::RPC_FAIL;
+                });
+            return results;
+        },
+        kDefaultInterval, kDefaultMaxBatch);
+    slot = aggregator;
+    LOG(INFO) << "Aggregating the pings of this process to master "
+              << master_address;
+    return aggregator;
+}
+
+PingAggregator::PingAggregator(BatchFn batch_fn,
+                               std::chrono::milliseconds interval,
+                               size_t max_batch)
+    : batch_fn_(std::move(batch_fn)),
+      interval_(interval),
+      max_batch_(std::max<size_t>(1, max_batch)),
+      round_thread_([this] { RoundThreadMain(); }) {}
+
+PingAggregator::~PingAggregator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    round_thread_.join();
+}
+
+tl::expected<BatchPingResponse, ErrorCode> PingAggregator::Ping(
+    BatchPingRequest request) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stopping_) {
+        return tl::make_unexpected(ErrorCode::RPC_FAIL);
+    }
+    if (!open_) {
+        open_ = std::make_shared<Round>();
+    }
+    std::shared_ptr<Round> round = open_;
+    const size_t index = round->requests.size();
+    round->requests.push_back(std::move(request));
+    cv_.wait(lock, [&] { return round->done || stopping_; });
+    if (!round->done) {
+        return tl::make_unexpected(ErrorCode::RPC_FAIL);
+    }
+    return std::move(round->results[index]);
+}
+
+void PingAggregator::RoundThreadMain() {
+    auto next_round = std::chrono::steady_clock::now() + interval_;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_until(lock, next_round, [&] { return stopping_; });
+        if (stopping_) {
+            break;
+        }
+        // Rounds keep their cadence unless one took longer than the interval
+        const auto now = std::chrono::steady_clock::now();
+        next_round = std::max(next_round + interval_, now);
+
+        std::shared_ptr<Round> round = std::move(open_);
+        open_ = nullptr;
+        if (!round) {
+            continue;
+        }
+        lock.unlock();
+        Results results = Send(round->requests);
+        lock.lock();
+        round->results = std::move(results);
+        round->done = true;
+        cv_.notify_all();
+    }
+}
+
+PingAggregator::Results PingAggregator::Send(
+    const std::vector<BatchPingRequest>& requests) {
+    Results results;
+    results.reserve(requests.size());
+    for (size_t begin = 0; begin < requests.size(); begin += max_batch_) {
+        const size_t end = std::min(requests.size(), begin + max_batch_);
+        std::vector<BatchPingRequest> batch(requests.begin() + begin,
+                                            requests.begin() + end);
+        Results batch_results = batch_fn_(batch);
+        if (batch_results.size() != batch.size()) {
+            batch_results.assign(batch.size(),
+                                 tl::make_unexpected(ErrorCode::RPC_FAIL));
+        }
+        for (auto& result : batch_results) {
+            results.push_back(std::move(result));
+        }
+    }
+    return results;
+}
+
+}  // namespace mooncake
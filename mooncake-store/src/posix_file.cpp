@@ -1,12 +1,54 @@
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <string>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <vector>
 #include <glog/logging.h>
 
 #include "file_interface.h"
 
 namespace mooncake {
+namespace {
+
+// Runs transfer, i.e. preadv or pwritev, until all of iov is done, as each
+// call takes at most IOV_MAX vectors and may transfer fewer bytes than
+// asked. Reads stop early at the end of the file.
+template <typename Transfer>
+tl::expected<size_t, ErrorCode> TransferAll(Transfer transfer,
+                                            const iovec *iov, int iovcnt,
+                                            off_t offset, ErrorCode error) {
+    std::vector<iovec> pending(iov, iov + std::max(iovcnt, 0));
+    size_t first = 0;
+    size_t done = 0;
+    while (first < pending.size()) {
+        const int count =
+            static_cast<int>(std::min<size_t>(pending.size() - first, IOV_MAX));
+        ssize_t n = transfer(&pending[first], count, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return tl::make_unexpected(error);
+        }
+        if (n == 0) break;  // EOF
+        done += n;
+        // Skip the vectors done and trim the one done partly
+        size_t left = n;
+        while (first < pending.size() && left >= pending[first].iov_len) {
+            left -= pending[first].iov_len;
+            ++first;
+        }
+        if (left > 0) {
+            pending[first].iov_base =
+                static_cast<char *>(pending[first].iov_base) + left;
+            pending[first].iov_len -= left;
+        }
+    }
+    return done;
+}
+
+}  // namespace
+
 PosixFile::PosixFile(const std::string &filename, int fd)
     : StorageFile(filename, fd) {
     if (fd < 0) {
@@ -108,12 +150,11 @@ tl::expected<size_t, ErrorCode> PosixFile::vector_write(const iovec *iov,
         return make_error<size_t>(ErrorCode::FILE_NOT_FOUND);
     }
 
-    ssize_t ret = ::pwritev(fd_, iov, iovcnt, offset);
-    if (ret < 0) {
-        return make_error<size_t>(ErrorCode::FILE_WRITE_FAIL);
-    }
-
-    return ret;
+    return TransferAll(
+        [this](const iovec *vecs, int count, off_t at) {
+            return ::pwritev(fd_, vecs, count, at);
+        },
+        iov, iovcnt, offset, ErrorCode::FILE_WRITE_FAIL);
 }
 
 tl::expected<size_t, ErrorCode> PosixFile::vector_read(const iovec *iov,
@@ -123,12 +164,11 @@ tl::expected<size_t, ErrorCode> PosixFile::vector_read(const iovec *iov,
         return make_error<size_t>(ErrorCode::FILE_NOT_FOUND);
     }
 
-    ssize_t ret = ::preadv(fd_, iov, iovcnt, offset);
-    if (ret < 0) {
-        return make_error<size_t>(ErrorCode::FILE_READ_FAIL);
-    }
-
-    return ret;
+    return TransferAll(
+        [this](const iovec *vecs, int count, off_t at) {
+            return ::preadv(fd_, vecs, count, at);
+        },
+        iov, iovcnt, offset, ErrorCode::FILE_READ_FAIL);
 }
 
 }  // namespace mooncake
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <netinet/in.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -142,6 +143,49 @@ void ResourceTracker::startSignalThread() {
     });
 }
 
+// NUMA nodes the segment memory is placed on, from MC_STORE_SEGMENT_NUMA:
+// "auto" for the nodes of the NICs in the local topology, or a comma
+// separated list of nodes. Empty if the memory is not bound.
+static std::vector<int> GetSegmentNumaNodes(Client &client) {
+    std::vector<int> nodes;
+    const char *env = std::getenv("MC_STORE_SEGMENT_NUMA");
+    if (env == nullptr || *env == '\0') {
+        return nodes;
+    }
+
+    if (std::string(env) == "auto") {
+        auto topology = client.GetLocalTopology();
+        if (topology) {
+            // Entries of host memory are named cpu:<node> and prefer the
+            // NICs attached to that node
+            for (const auto &[name, entry] : topology->getMatrix()) {
+                if (name.rfind("cpu:", 0) == 0 &&
+                    !entry.preferred_hca.empty()) {
+                    nodes.push_back(std::atoi(name.c_str() + 4));
+                }
+            }
+        }
+        std::sort(nodes.begin(), nodes.end());
+        if (nodes.empty()) {
+            LOG(WARNING) << "No NIC with a NUMA node in the local topology, "
+                            "segment memory is not bound";
+        }
+        return nodes;
+    }
+
+    for (const auto &token : splitString(env)) {
+        char *end = nullptr;
+        const long node = std::strtol(token.c_str(), &end, 10);
+        if (end == token.c_str() || *end != '\0' || node < 0) {
+            LOG(WARNING) << "Invalid MC_STORE_SEGMENT_NUMA='" << env
+                         << "', segment memory is not bound";
+            return {};
+        }
+        nodes.push_back(static_cast<int>(node));
+    }
+    return nodes;
+}
+
 RealClient::RealClient() {
     // Initialize logging severity (leave as before)
     mooncake::init_ylt_log_level();
@@ -152,6 +196,11 @@ RealClient::RealClient() {
 RealClient::~RealClient() {
     // Ensure resources are cleaned even if not explicitly closed
     tearDownAll_internal();
+    MutexLocker locker(&async_mutex_);
+    if (async_event_fd_ >= 0) {
+        close(async_event_fd_);
+        async_event_fd_ = -1;
+    }
 }
 
 std::shared_ptr<RealClient> RealClient::create() {
@@ -253,8 +302,21 @@ tl::expected<void, ErrorCode> RealClient::setup_internal(
     // fail in some rdma implementations.
     // Dummy Client can create shm and share it with Real Client, so Real Client
     // can create client buffer allocator on the shared memory later.
+    // Segments are placed on the NUMA nodes round robin, the local buffer on
+    // the first one
+    const std::vector<int> numa_nodes = this->protocol != "ascend"
+                                            ? GetSegmentNumaNodes(*client_)
+                                            : std::vector<int>();
+    const size_t prefault_threads =
+        this->protocol != "ascend"
+            ? GetEnvOr<uint32_t>("MC_STORE_PREFAULT_THREADS", 0)
+            : 0;
+    const bool should_use_mmap =
+        should_use_hugepage || !numa_nodes.empty() || prefault_threads > 0;
+
     client_buffer_allocator_ = ClientBufferAllocator::create(
-        local_buffer_size, this->protocol, should_use_hugepage);
+        local_buffer_size, this->protocol, should_use_hugepage,
+        numa_nodes.empty() ? -1 : numa_nodes.front(), prefault_threads);
     if (local_buffer_size > 0) {
         LOG(INFO) << "Registering local memory: " << local_buffer_size
                   << " bytes";
@@ -266,6 +328,10 @@ tl::expected<void, ErrorCode> RealClient::setup_internal(
                        << toString(result.error());
             return tl::unexpected(result.error());
         }
+#ifdef USE_CUDA
+        cuda_staging_ = std::make_unique<CudaStaging>(
+            client_buffer_allocator_->getBase(), local_buffer_size);
+#endif
     } else {
         LOG(INFO) << "Local buffer size is 0, skip registering local memory";
     }
@@ -300,6 +366,11 @@ tl::expected<void, ErrorCode> RealClient::setup_internal(
         auto max_mr_size = globalConfig().max_mr_size;     // Max segment size
         uint64_t total_glbseg_size = global_segment_size;  // For logging
         uint64_t current_glbseg_size = 0;                  // For logging
+        size_t segment_index = 0;
+        // Segments in GPU memory are read by clients on this host through
+        // the CUDA IPC handles the transfer engine exports, over NVLink
+        const int segment_cuda_device =
+            GetEnvOr<int>("MC_STORE_SEGMENT_CUDA_DEVICE", -1);
         while (global_segment_size > 0) {
             size_t segment_size = std::min(global_segment_size, max_mr_size);
             global_segment_size -= segment_size;
@@ -309,11 +380,19 @@ tl::expected<void, ErrorCode> RealClient::setup_internal(
 
             size_t mapped_size = segment_size;
             void *ptr = nullptr;
-            if (should_use_hugepage) {
+            if (segment_cuda_device >= 0) {
+                ptr = CudaStaging::AllocateDeviceMemory(segment_cuda_device,
+                                                        segment_size);
+            } else if (should_use_mmap) {
+                const int numa_node =
+                    numa_nodes.empty()
+                        ? -1
+                        : numa_nodes[segment_index % numa_nodes.size()];
                 mapped_size =
                     align_up(segment_size, get_hugepage_size_from_env());
-                ptr = allocate_buffer_mmap_memory(mapped_size,
-                                                  get_hugepage_size_from_env());
+                ptr = allocate_buffer_mmap_memory(
+                    mapped_size, get_hugepage_size_from_env(), numa_node,
+                    prefault_threads);
             } else {
                 ptr = allocate_buffer_allocator_memory(segment_size,
                                                        this->protocol);
@@ -323,9 +402,11 @@ tl::expected<void, ErrorCode> RealClient::setup_internal(
                 LOG(ERROR) << "Failed to allocate segment memory";
                 return tl::unexpected(ErrorCode::INVALID_PARAMS);
             }
-            if (this->protocol == "ascend") {
+            if (segment_cuda_device >= 0) {
+                cuda_segment_ptrs_.emplace_back(ptr);
+            } else if (this->protocol == "ascend") {
                 ascend_segment_ptrs_.emplace_back(ptr);
-            } else if (should_use_hugepage) {
+            } else if (should_use_mmap) {
                 hugepage_segment_ptrs_.emplace_back(
                     ptr, HugepageSegmentDeleter{mapped_size});
             } else {
@@ -338,6 +419,7 @@ tl::expected<void, ErrorCode> RealClient::setup_internal(
                            << toString(mount_result.error());
                 return tl::unexpected(mount_result.error());
             }
+            ++segment_index;
         }
         if (total_glbseg_size == 0) {
             LOG(INFO) << "Global segment size is 0, skip mounting segment";
@@ -502,6 +584,9 @@ tl::expected<void, ErrorCode> RealClient::tearDownAll_internal() {
     }
 
     stop_ipc_server();
+    stop_request_rings();
+    // Let the queued async operations finish while client_ is still alive
+    stop_async_workers();
 
     if (!client_) {
         // Not initialized or already cleaned; treat as success for idempotence
@@ -517,11 +602,13 @@ tl::expected<void, ErrorCode> RealClient::tearDownAll_internal() {
         }
     }
     // Reset all resources
+    cuda_staging_.reset();
     client_.reset();
     client_buffer_allocator_.reset();
     port_binder_.reset();
     hugepage_segment_ptrs_.clear();
     segment_ptrs_.clear();
+    cuda_segment_ptrs_.clear();
     local_hostname = "";
     device_name = "";
     protocol = "";
@@ -696,6 +783,183 @@ int RealClient::put_batch(const std::vector<std::string> &keys,
         put_batch_internal(keys, values, config, client_buffer_allocator_));
 }
 
+std::vector<tl::expected<void, ErrorCode>> RealClient::batch_put_parts_internal(
+    const std::vector<std::string> &keys,
+    const std::vector<std::vector<std::span<const char>>> &all_parts,
+    const ReplicateConfig &config) {
+    if (config.prefer_alloc_in_same_node) {
+        LOG(ERROR) << "prefer_alloc_in_same_node is not supported.";
+        return std::vector<tl::expected<void, ErrorCode>>(
+            keys.size(), tl::unexpected(ErrorCode::INVALID_PARAMS));
+    }
+    if (!client_ || !client_buffer_allocator_) {
+        LOG(ERROR) << "Client is not initialized";
+        return std::vector<tl::expected<void, ErrorCode>>(
+            keys.size(), tl::unexpected(ErrorCode::INVALID_PARAMS));
+    }
+    if (keys.size() != all_parts.size()) {
+        LOG(ERROR) << "Key and parts size mismatch";
+        return std::vector<tl::expected<void, ErrorCode>>(
+            keys.size(), tl::unexpected(ErrorCode::INVALID_PARAMS));
+    }
+
+    std::vector<tl::expected<void, ErrorCode>> results(keys.size());
+    // Staging buffers of the parts outside registered memory, released once
+    // BatchPut returned
+    std::vector<BufferHandle> staging;
+    std::vector<std::string> batch_keys;
+    std::vector<std::vector<Slice>> batch_slices;
+    std::vector<size_t> batch_indices;
+    // Keys with parts copied from the GPU are put in waves of about
+    // CudaStaging::kWaveSize bytes copied, each once its copies are done,
+    // while the copies of the next ones go on. Ends of the waves in
+    // batch_keys.
+    std::vector<std::pair<size_t, CudaStaging::Fence>> device_waves;
+    size_t wave_device_size = 0;
+    bool copied_from_device = false;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const auto &parts = all_parts[i];
+        std::vector<bool> in_place(parts.size());
+        std::vector<bool> on_device(parts.size());
+        size_t staged_size = 0;
+        size_t device_size = 0;
+        for (size_t j = 0; j < parts.size(); ++j) {
+            in_place[j] =
+                is_registered_memory(parts[j].data(), parts[j].size_bytes());
+            if (!in_place[j]) {
+                staged_size += parts[j].size_bytes();
+                on_device[j] =
+                    cuda_staging_ &&
+                    CudaStaging::IsDeviceMemory(parts[j].data());
+                if (on_device[j]) device_size += parts[j].size_bytes();
+            }
+        }
+
+        char *staged = nullptr;
+        if (staged_size > 0) {
+            auto alloc_result = client_buffer_allocator_->allocate(staged_size);
+            if (!alloc_result) {
+                LOG(ERROR) << "Failed to allocate buffer for batch_put_parts, "
+                              "key: "
+                           << keys[i] << ", staged size: " << staged_size;
+                results[i] = tl::unexpected(ErrorCode::INVALID_PARAMS);
+                continue;
+            }
+            staged = static_cast<char *>(alloc_result->ptr());
+            staging.emplace_back(std::move(*alloc_result));
+        }
+
+        // Parts staged one after the other end up in the same slices
+        std::vector<Slice> slices;
+        bool copy_failed = false;
+        for (size_t j = 0; j < parts.size(); ++j) {
+            char *data = const_cast<char *>(parts[j].data());
+            size_t size = parts[j].size_bytes();
+            if (on_device[j]) {
+                copied_from_device = true;
+                copy_failed |= !cuda_staging_->CopyToHost(staged, data, size);
+                data = staged;
+                staged += size;
+            } else if (!in_place[j]) {
+                memcpy(staged, data, size);
+                data = staged;
+                staged += size;
+            }
+            while (size > 0) {
+                if (!slices.empty()) {
+                    auto &last = slices.back();
+                    if (static_cast<char *>(last.ptr) + last.size == data &&
+                        last.size < kMaxSliceSize) {
+                        size_t grow = std::min(size, kMaxSliceSize - last.size);
+                        last.size += grow;
+                        data += grow;
+                        size -= grow;
+                        continue;
+                    }
+                }
+                size_t chunk_size = std::min(size, kMaxSliceSize);
+                slices.emplace_back(Slice{data, chunk_size});
+                data += chunk_size;
+                size -= chunk_size;
+            }
+        }
+        if (copy_failed) {
+            LOG(ERROR) << "Failed to copy GPU data for batch_put_parts, key: "
+                       << keys[i];
+            results[i] = tl::unexpected(ErrorCode::INTERNAL_ERROR);
+            continue;
+        }
+        if (slices.empty()) {
+            LOG(WARNING) << "Attempting to put empty data for key: " << keys[i];
+            continue;
+        }
+        batch_keys.push_back(keys[i]);
+        batch_slices.push_back(std::move(slices));
+        batch_indices.push_back(i);
+        wave_device_size += device_size;
+        if (wave_device_size >= CudaStaging::kWaveSize) {
+            device_waves.emplace_back(batch_keys.size(),
+                                      cuda_staging_->Mark());
+            wave_device_size = 0;
+        }
+    }
+    if (wave_device_size > 0) {
+        device_waves.emplace_back(batch_keys.size(), cuda_staging_->Mark());
+    }
+
+    if (device_waves.empty() && !batch_keys.empty()) {
+        auto batch_results =
+            client_->BatchPut(batch_keys, batch_slices, config);
+        for (size_t k = 0; k < batch_results.size(); ++k) {
+            results[batch_indices[k]] = std::move(batch_results[k]);
+        }
+    } else if (!batch_keys.empty()) {
+        // The keys after the last copy from the GPU go with the last wave
+        device_waves.back().first = batch_keys.size();
+        size_t begin = 0;
+        for (const auto &[end, fence] : device_waves) {
+            const bool copied = cuda_staging_->Wait(fence);
+            std::vector<std::string> wave_keys(batch_keys.begin() + begin,
+                                               batch_keys.begin() + end);
+            std::vector<std::vector<Slice>> wave_slices(
+                std::make_move_iterator(batch_slices.begin() + begin),
+                std::make_move_iterator(batch_slices.begin() + end));
+            if (!copied) {
+                for (size_t k = begin; k < end; ++k) {
+                    results[batch_indices[k]] =
+                        tl::unexpected(ErrorCode::INTERNAL_ERROR);
+                }
+            } else {
+                auto batch_results =
+                    client_->BatchPut(wave_keys, wave_slices, config);
+                for (size_t k = 0; k < batch_results.size(); ++k) {
+                    results[batch_indices[begin + k]] =
+                        std::move(batch_results[k]);
+                }
+            }
+            begin = end;
+        }
+    }
+    // The staging buffers must outlive the copies of the keys that failed
+    if (copied_from_device) {
+        cuda_staging_->Synchronize();
+    }
+    return results;
+}
+
+std::vector<int> RealClient::batch_put_parts(
+    const std::vector<std::string> &keys,
+    const std::vector<std::vector<std::span<const char>>> &all_parts,
+    const ReplicateConfig &config) {
+    auto internal_results = batch_put_parts_internal(keys, all_parts, config);
+    std::vector<int> results;
+    results.reserve(internal_results.size());
+    for (const auto &result : internal_results) {
+        results.push_back(to_py_ret(result));
+    }
+    return results;
+}
+
 tl::expected<void, ErrorCode> RealClient::put_parts_internal(
     const std::string &key, std::vector<std::span<const char>> values,
     const ReplicateConfig &config,
@@ -736,11 +1000,26 @@ tl::expected<void, ErrorCode> RealClient::put_parts_internal(
 
     // Copy all parts into the contiguous buffer
     size_t offset = 0;
+    bool copied_from_device = false;
+    bool copy_failed = false;
     for (const auto &value : values) {
-        memcpy(static_cast<char *>(buffer_handle.ptr()) + offset, value.data(),
-               value.size_bytes());
+        char *dst = static_cast<char *>(buffer_handle.ptr()) + offset;
+        if (cuda_staging_ && CudaStaging::IsDeviceMemory(value.data())) {
+            copied_from_device = true;
+            copy_failed |= !cuda_staging_->CopyToHost(dst, value.data(),
+                                                      value.size_bytes());
+        } else {
+            memcpy(dst, value.data(), value.size_bytes());
+        }
         offset += value.size_bytes();
     }
+    if (copied_from_device) {
+        copy_failed |= !cuda_staging_->Synchronize();
+    }
+    if (copy_failed) {
+        LOG(ERROR) << "Failed to copy GPU data for put_parts, key: " << key;
+        return tl::unexpected(ErrorCode::INTERNAL_ERROR);
+    }
 
     // Split into slices
     std::vector<Slice> slices = split_into_slices(buffer_handle);
@@ -856,6 +1135,10 @@ std::vector<int> RealClient::batchIsExist(
     return results;
 }
 
+int64_t RealClient::batchIsExistPrefix(const std::vector<std::string> &keys) {
+    return to_py_ret(batchIsExistPrefix_internal(keys));
+}
+
 tl::expected<int64_t, ErrorCode> RealClient::getSize_internal(
     const std::string &key) {
     if (!client_) {
@@ -967,6 +1250,8 @@ tl::expected<void, ErrorCode> RealClient::map_shm_internal(
 
 tl::expected<void, ErrorCode> RealClient::unmap_shm_internal(
     const UUID &client_id) {
+    // Before taking the lock, the serving threads need it to finish
+    stop_request_ring(client_id);
     std::unique_lock<std::shared_mutex> lock(dummy_client_mutex_);
     auto it = shm_contexts_.find(client_id);
     if (it == shm_contexts_.end()) {
@@ -1053,6 +1338,99 @@ tl::expected<void, ErrorCode> RealClient::unregister_shm_buffer_internal(
     return {};
 }
 
+static void stop_ring_server(std::shared_ptr<ShmRequestRing> &ring,
+                             std::vector<std::thread> &threads) {
+    if (ring) {
+        ring->Stop();
+    }
+    for (auto &thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+tl::expected<void, ErrorCode> RealClient::map_request_ring_internal(
+    int fd, size_t ring_size, const UUID &client_id) {
+    if (closed_) {
+        close(fd);
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    auto ring = ShmRequestRing::Attach(fd, ring_size);
+    if (!ring) {
+        return tl::make_unexpected(ring.error());
+    }
+
+    RequestRingServer server;
+    server.ring = std::move(ring.value());
+    const size_t num_threads = std::max<size_t>(
+        1, GetEnvOr<size_t>("MC_STORE_SHM_RING_THREADS",
+                            kDefaultRequestRingThreads));
+    for (size_t i = 0; i < num_threads; ++i) {
+        server.threads.emplace_back(&RealClient::serve_request_ring, this,
+                                    server.ring.get(), client_id);
+    }
+
+    RequestRingServer previous;
+    {
+        MutexLocker locker(&request_rings_mutex_);
+        auto &entry = request_rings_[client_id];
+        previous = std::move(entry);
+        entry = std::move(server);
+    }
+    stop_ring_server(previous.ring, previous.threads);
+    LOG(INFO) << "client_id=" << client_id
+              << ", action=request_ring_mapped, size=" << ring_size
+              << ", threads=" << num_threads;
+    return {};
+}
+
+void RealClient::serve_request_ring(ShmRequestRing *ring,
+                                    const UUID &client_id) {
+    ring->Serve([this, &client_id](const ShmRequestRing::Request &request,
+                                   std::vector<int64_t> &results) {
+        results.reserve(request.keys.size());
+        if (request.op == ShmRequestRing::Op::BATCH_GET_INTO) {
+            for (const auto &result : batch_get_into_dummy_helper(
+                     request.keys, request.buffers, request.sizes,
+                     client_id)) {
+                results.push_back(to_py_ret(result));
+            }
+        } else {
+            for (const auto &result : batch_put_from_dummy_helper(
+                     request.keys, request.buffers, request.sizes,
+                     request.config, client_id)) {
+                results.push_back(to_py_ret(result));
+            }
+        }
+    });
+}
+
+void RealClient::stop_request_ring(const UUID &client_id) {
+    RequestRingServer server;
+    {
+        MutexLocker locker(&request_rings_mutex_);
+        auto it = request_rings_.find(client_id);
+        if (it == request_rings_.end()) {
+            return;
+        }
+        server = std::move(it->second);
+        request_rings_.erase(it);
+    }
+    stop_ring_server(server.ring, server.threads);
+}
+
+void RealClient::stop_request_rings() {
+    std::unordered_map<UUID, RequestRingServer, boost::hash<UUID>> servers;
+    {
+        MutexLocker locker(&request_rings_mutex_);
+        servers.swap(request_rings_);
+    }
+    for (auto &[client_id, server] : servers) {
+        stop_ring_server(server.ring, server.threads);
+    }
+}
+
 // Implementation of get_buffer_internal method
 std::shared_ptr<BufferHandle> RealClient::get_buffer_internal(
     const std::string &key,
@@ -1296,8 +1674,115 @@ tl::expected<void, ErrorCode> RealClient::register_buffer_internal(
         LOG(ERROR) << "Client is not initialized";
         return tl::unexpected(ErrorCode::INVALID_PARAMS);
     }
-    return client_->RegisterLocalMemory(buffer, size, kWildcardLocation, false,
-                                        true);
+    auto result = client_->RegisterLocalMemory(buffer, size, kWildcardLocation,
+                                               false, true);
+    if (result) {
+        MutexLocker locker(&registered_buffers_mutex_);
+        registered_buffers_[reinterpret_cast<uintptr_t>(buffer)] = size;
+    }
+    return result;
+}
+
+bool RealClient::needs_cuda_staging(const void *ptr, size_t size) {
+    return cuda_staging_ && !is_registered_memory(ptr, size) &&
+           CudaStaging::IsDeviceMemory(ptr);
+}
+
+std::vector<tl::expected<int64_t, ErrorCode>>
+RealClient::batch_get_into_staged(const std::vector<std::string> &keys,
+                                  const std::vector<void *> &buffers,
+                                  const std::vector<size_t> &sizes) {
+    std::vector<tl::expected<int64_t, ErrorCode>> results(keys.size());
+    std::vector<bool> on_device(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        on_device[i] = needs_cuda_staging(buffers[i], sizes[i]);
+    }
+
+    // Staging buffers of the wave being copied to the GPU, and its keys
+    std::vector<BufferHandle> copying;
+    std::vector<size_t> copying_indices;
+    CudaStaging::Fence copying_fence = nullptr;
+    auto wait_copying = [&]() {
+        if (copying.empty()) return;
+        if (!cuda_staging_->Wait(copying_fence)) {
+            for (size_t i : copying_indices) {
+                results[i] = tl::unexpected(ErrorCode::INTERNAL_ERROR);
+            }
+        }
+        copying.clear();
+        copying_indices.clear();
+    };
+
+    size_t next = 0;
+    while (next < keys.size()) {
+        std::vector<BufferHandle> staging;
+        std::vector<std::string> wave_keys;
+        std::vector<void *> wave_buffers;
+        std::vector<size_t> wave_sizes;
+        std::vector<size_t> wave_indices;
+        size_t wave_size = 0;
+        for (; next < keys.size() && wave_size < CudaStaging::kWaveSize;
+             ++next) {
+            void *buffer = buffers[next];
+            if (on_device[next]) {
+                auto alloc_result =
+                    client_buffer_allocator_->allocate(sizes[next]);
+                if (!alloc_result) {
+                    LOG(ERROR) << "Failed to allocate staging buffer, key: "
+                               << keys[next] << ", size: " << sizes[next];
+                    results[next] = tl::unexpected(ErrorCode::BUFFER_OVERFLOW);
+                    continue;
+                }
+                buffer = alloc_result->ptr();
+                staging.emplace_back(std::move(*alloc_result));
+                wave_size += sizes[next];
+            }
+            wave_keys.push_back(keys[next]);
+            wave_buffers.push_back(buffer);
+            wave_sizes.push_back(sizes[next]);
+            wave_indices.push_back(next);
+        }
+        if (wave_keys.empty()) continue;
+
+        // Staged in the client buffer, the wave is read directly
+        auto wave_results =
+            batch_get_into_internal(wave_keys, wave_buffers, wave_sizes);
+        wait_copying();
+        for (size_t k = 0; k < wave_indices.size(); ++k) {
+            const size_t i = wave_indices[k];
+            results[i] = std::move(wave_results[k]);
+            if (!on_device[i] || !results[i]) continue;
+            if (!cuda_staging_->CopyToDevice(buffers[i], wave_buffers[k],
+                                             results[i].value())) {
+                results[i] = tl::unexpected(ErrorCode::INTERNAL_ERROR);
+                continue;
+            }
+            copying_indices.push_back(i);
+        }
+        copying = std::move(staging);
+        copying_fence = copying.empty() ? nullptr : cuda_staging_->Mark();
+    }
+    wait_copying();
+    return results;
+}
+
+bool RealClient::is_registered_memory(const void *ptr, size_t size) {
+    const auto addr = reinterpret_cast<uintptr_t>(ptr);
+    if (client_buffer_allocator_) {
+        const auto base =
+            reinterpret_cast<uintptr_t>(client_buffer_allocator_->getBase());
+        if (addr >= base &&
+            addr + size <= base + client_buffer_allocator_->size()) {
+            return true;
+        }
+    }
+    MutexLocker locker(&registered_buffers_mutex_);
+    auto it = registered_buffers_.upper_bound(addr);
+    if (it == registered_buffers_.begin()) {
+        return false;
+    }
+    --it;
+    return addr + size <= it->first + it->second;
 }
 
 int RealClient::register_buffer(void *buffer, size_t size) {
@@ -1310,6 +1795,10 @@ tl::expected<void, ErrorCode> RealClient::unregister_buffer_internal(
         LOG(ERROR) << "Client is not initialized";
         return tl::unexpected(ErrorCode::INVALID_PARAMS);
     }
+    {
+        MutexLocker locker(&registered_buffers_mutex_);
+        registered_buffers_.erase(reinterpret_cast<uintptr_t>(buffer));
+    }
     auto unregister_result = client_->unregisterLocalMemory(buffer, true);
     if (!unregister_result) {
         LOG(ERROR) << "Unregister buffer failed with error: "
@@ -1331,6 +1820,9 @@ tl::expected<int64_t, ErrorCode> RealClient::get_into_internal(
         LOG(ERROR) << "Client is not initialized";
         return tl::unexpected(ErrorCode::INVALID_PARAMS);
     }
+    if (needs_cuda_staging(buffer, size)) {
+        return batch_get_into_staged({key}, {buffer}, {size})[0];
+    }
 
     // Step 1: Get object info
     auto query_result = client_->Query(key);
@@ -1391,6 +1883,134 @@ int64_t RealClient::get_into(const std::string &key, void *buffer,
     return to_py_ret(get_into_internal(key, buffer, size));
 }
 
+int RealClient::async_completion_fd() {
+    MutexLocker locker(&async_mutex_);
+    if (async_event_fd_ < 0) {
+        async_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (async_event_fd_ < 0) {
+            LOG(ERROR) << "Failed to create async completion eventfd: "
+                       << strerror(errno);
+        }
+    }
+    return async_event_fd_;
+}
+
+uint64_t RealClient::submit_async(size_t num_results,
+                                  std::function<std::vector<int64_t>()> op) {
+    if (async_completion_fd() < 0) {
+        return 0;
+    }
+    auto complete = [this](uint64_t id, std::vector<int64_t> results) {
+        MutexLocker locker(&async_mutex_);
+        async_completions_.emplace_back(id, std::move(results));
+        uint64_t one = 1;
+        if (write(async_event_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG(ERROR) << "Failed to signal async completion: "
+                       << strerror(errno);
+        }
+    };
+
+    MutexLocker locker(&async_mutex_);
+    const uint64_t id = next_async_id_++;
+    if (async_stopped_ || !client_) {
+        locker.unlock();
+        complete(id, std::vector<int64_t>(
+                         num_results, toInt(ErrorCode::INVALID_PARAMS)));
+        return id;
+    }
+    if (!async_workers_) {
+        async_workers_ = std::make_unique<ThreadPool>(std::max<size_t>(
+            1, GetEnvOr<size_t>("MC_STORE_ASYNC_WORKERS",
+                                kDefaultAsyncWorkers)));
+    }
+    async_workers_->enqueue(
+        [id, num_results, op = std::move(op), complete]() mutable {
+            std::vector<int64_t> results;
+            try {
+                results = op();
+            } catch (const std::exception &e) {
+                LOG(ERROR) << "Async operation " << id
+                           << " failed: " << e.what();
+                results.assign(num_results,
+                               toInt(ErrorCode::INTERNAL_ERROR));
+            }
+            complete(id, std::move(results));
+        });
+    return id;
+}
+
+void RealClient::stop_async_workers() {
+    std::unique_ptr<ThreadPool> workers;
+    {
+        MutexLocker locker(&async_mutex_);
+        async_stopped_ = true;
+        workers = std::move(async_workers_);
+    }
+    // Joined without the lock, the workers take it to queue their results
+    if (workers) {
+        workers->stop();
+    }
+}
+
+uint64_t RealClient::submit_get_into(const std::string &key, void *buffer,
+                                     size_t size) {
+    return submit_async(1, [this, key, buffer, size] {
+        return std::vector<int64_t>{
+            to_py_ret(get_into_internal(key, buffer, size))};
+    });
+}
+
+uint64_t RealClient::submit_batch_get_into(
+    const std::vector<std::string> &keys, const std::vector<void *> &buffers,
+    const std::vector<size_t> &sizes) {
+    return submit_async(keys.size(), [this, keys, buffers, sizes] {
+        return batch_get_into(keys, buffers, sizes);
+    });
+}
+
+uint64_t RealClient::submit_put_from(const std::string &key, void *buffer,
+                                     size_t size,
+                                     const ReplicateConfig &config) {
+    return submit_async(1, [this, key, buffer, size, config] {
+        return std::vector<int64_t>{
+            to_py_ret(put_from_internal(key, buffer, size, config))};
+    });
+}
+
+uint64_t RealClient::submit_batch_put_from(
+    const std::vector<std::string> &keys, const std::vector<void *> &buffers,
+    const std::vector<size_t> &sizes, const ReplicateConfig &config) {
+    return submit_async(keys.size(), [this, keys, buffers, sizes, config] {
+        auto results = batch_put_from(keys, buffers, sizes, config);
+        return std::vector<int64_t>(results.begin(), results.end());
+    });
+}
+
+std::vector<std::pair<uint64_t, std::vector<int64_t>>>
+RealClient::poll_async_completions() {
+    std::vector<std::pair<uint64_t, std::vector<int64_t>>> completions;
+    MutexLocker locker(&async_mutex_);
+    if (async_event_fd_ >= 0) {
+        uint64_t count;
+        // EAGAIN only means there was nothing to reset
+        if (read(async_event_fd_, &count, sizeof(count)) < 0 &&
+            errno != EAGAIN) {
+            LOG(ERROR) << "Failed to reset async completion eventfd: "
+                       << strerror(errno);
+        }
+    }
+    completions.swap(async_completions_);
+    return completions;
+}
+
+int RealClient::prefetch(const std::vector<std::string> &keys) {
+    if (!client_) {
+        LOG(ERROR) << "Client is not initialized";
+        return toInt(ErrorCode::INVALID_PARAMS);
+    }
+    return client_->Prefetch(keys) ? 0 : toInt(ErrorCode::BUFFER_OVERFLOW);
+}
+
 std::string RealClient::get_hostname() const { return local_hostname; }
 
 std::vector<int> RealClient::batch_put_from(
@@ -1562,6 +2182,103 @@ int RealClient::put_from(const std::string &key, void *buffer, size_t size,
     return to_py_ret(put_from_internal(key, buffer, size, config));
 }
 
+// Splits a registered buffer into slices no longer than kMaxSliceSize
+static std::vector<Slice> split_into_slices(void *buffer, size_t size) {
+    std::vector<Slice> slices;
+    for (uint64_t offset = 0; offset < size;) {
+        auto chunk_size = std::min(size - offset, kMaxSliceSize);
+        slices.emplace_back(
+            Slice{static_cast<char *>(buffer) + offset, chunk_size});
+        offset += chunk_size;
+    }
+    return slices;
+}
+
+int RealClient::stream_put_start(const std::string &key,
+                                 const std::vector<uint64_t> &chunk_sizes,
+                                 const ReplicateConfig &config) {
+    if (!client_) {
+        LOG(ERROR) << "Client is not initialized";
+        return toInt(ErrorCode::INVALID_PARAMS);
+    }
+    return to_py_ret(client_->StreamPutStart(key, chunk_sizes, config));
+}
+
+int RealClient::stream_put_from(const std::string &key, uint64_t chunk_index,
+                                void *buffer, size_t size) {
+    if (!client_) {
+        LOG(ERROR) << "Client is not initialized";
+        return toInt(ErrorCode::INVALID_PARAMS);
+    }
+    auto slices = split_into_slices(buffer, size);
+    return to_py_ret(client_->StreamPutChunk(key, chunk_index, slices));
+}
+
+int RealClient::stream_put_end(const std::string &key) {
+    if (!client_) {
+        LOG(ERROR) << "Client is not initialized";
+        return toInt(ErrorCode::INVALID_PARAMS);
+    }
+    return to_py_ret(client_->StreamPutEnd(key));
+}
+
+int64_t RealClient::get_range_into(const std::string &key, uint64_t offset,
+                                   void *buffer, size_t size) {
+    if (!client_) {
+        LOG(ERROR) << "Client is not initialized";
+        return toInt(ErrorCode::INVALID_PARAMS);
+    }
+    auto slices = split_into_slices(buffer, size);
+    auto result = client_->GetRange(key, offset, slices);
+    if (!result) {
+        return toInt(result.error());
+    }
+    return static_cast<int64_t>(size);
+}
+
+std::shared_ptr<BufferHandle> RealClient::get_ranges_buffer(
+    const std::string &key,
+    const std::vector<std::pair<uint64_t, uint64_t>> &ranges) {
+    if (!client_ || !client_buffer_allocator_) {
+        LOG(ERROR) << "Client is not initialized";
+        return nullptr;
+    }
+    uint64_t total_length = 0;
+    for (const auto &[offset, length] : ranges) {
+        total_length += length;
+    }
+    if (total_length == 0) {
+        return nullptr;
+    }
+    auto alloc_result = client_buffer_allocator_->allocate(total_length);
+    if (!alloc_result) {
+        LOG(ERROR) << "Failed to allocate buffer for get_ranges_buffer, key: "
+                   << key;
+        return nullptr;
+    }
+    auto &buffer_handle = *alloc_result;
+
+    std::vector<uint64_t> offsets;
+    std::vector<std::vector<Slice>> slices;
+    offsets.reserve(ranges.size());
+    slices.reserve(ranges.size());
+    char *dest = static_cast<char *>(buffer_handle.ptr());
+    for (const auto &[offset, length] : ranges) {
+        offsets.push_back(offset);
+        slices.push_back(split_into_slices(dest, length));
+        dest += length;
+    }
+    auto result = client_->GetRanges(key, offsets, slices);
+    if (!result) {
+        if (result.error() != ErrorCode::OBJECT_NOT_FOUND) {
+            LOG(ERROR) << "GetRanges failed for key: " << key
+                       << " with error: " << toString(result.error());
+        }
+        return nullptr;
+    }
+    return std::make_shared<BufferHandle>(std::move(buffer_handle));
+}
+
 std::vector<int64_t> RealClient::batch_get_into(
     const std::vector<std::string> &keys, const std::vector<void *> &buffers,
     const std::vector<size_t> &sizes) {
@@ -1656,6 +2373,11 @@ RealClient::batch_get_into_internal(const std::vector<std::string> &keys,
     if (num_keys == 0) {
         return results;
     }
+    for (size_t i = 0; cuda_staging_ && i < num_keys; ++i) {
+        if (needs_cuda_staging(buffers[i], sizes[i])) {
+            return batch_get_into_staged(keys, buffers, sizes);
+        }
+    }
 
     // Query metadata for all keys
     const auto query_results = client_->BatchQuery(keys);
@@ -1799,6 +2521,15 @@ RealClient::batch_get_into_internal(const std::vector<std::string> &keys,
                             .original_index] =
                     tl::make_unexpected(batch_get_offload_result.error());
             }
+            continue;
+        }
+        // Copy the objects that the master asked for back to memory
+        for (const auto &offload_object_it : offload_objects_it.second) {
+            const auto &op =
+                valid_local_disk_operations.at(offload_object_it.first);
+            if (op.query_result.promote) {
+                client_->Promote(op.key, op.slices);
+            }
         }
     }
 
@@ -1835,6 +2566,19 @@ std::vector<tl::expected<bool, ErrorCode>> RealClient::batchIsExist_internal(
     return client_->BatchIsExist(keys);
 }
 
+tl::expected<int64_t, ErrorCode> RealClient::batchIsExistPrefix_internal(
+    const std::vector<std::string> &keys) {
+    if (!client_) {
+        LOG(ERROR) << "Client is not initialized";
+        return tl::unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    auto result = client_->BatchIsExistPrefix(keys);
+    if (!result) {
+        return tl::unexpected(result.error());
+    }
+    return static_cast<int64_t>(result.value());
+}
+
 int RealClient::put_from_with_metadata(const std::string &key, void *buffer,
                                        void *metadata_buffer, size_t size,
                                        size_t metadata_size,
@@ -2272,8 +3016,12 @@ void RealClient::ipc_server_func() {
             status = -1;
         } else {
             UUID client_id = {req.client_id_first, req.client_id_second};
-            auto ret = map_shm_internal(fd, req.dummy_base_addr, req.shm_size,
-                                        req.is_local_buffer, client_id);
+            auto ret = req.is_request_ring
+                           ? map_request_ring_internal(fd, req.shm_size,
+                                                       client_id)
+                           : map_shm_internal(fd, req.dummy_base_addr,
+                                              req.shm_size,
+                                              req.is_local_buffer, client_id);
             if (!ret) {
                 status = toInt(ret.error());
                 // FD is closed inside map_shm_internal
@@ -2353,7 +3101,8 @@ tl::expected<QueryTaskResponse, ErrorCode> RealClient::query_task(
 tl::expected<BatchGetOffloadObjectResponse, ErrorCode>
 RealClient::batch_get_offload_object(const std::vector<std::string> &keys,
                                      const std::vector<int64_t> &sizes) {
-    auto result = file_storage_->BatchGet(keys, sizes);
+    uint64_t batch_id = 0;
+    auto result = file_storage_->BatchGet(keys, sizes, batch_id);
     if (!result) {
         LOG(ERROR) << "Batch get offload object failed,err_code = "
                    << result.error();
@@ -2361,7 +3110,15 @@ RealClient::batch_get_offload_object(const std::vector<std::string> &keys,
     }
     return BatchGetOffloadObjectResponse(
         std::move(result.value()), client_->GetTransportEndpoint(),
-        file_storage_->config_.client_buffer_gc_ttl_ms);
+        file_storage_->config_.client_buffer_gc_ttl_ms, batch_id);
+}
+
+tl::expected<void, ErrorCode> RealClient::release_offload_object(
+    uint64_t batch_id) {
+    if (!file_storage_) {
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    return file_storage_->ReleaseBatch(batch_id);
 }
 
 tl::expected<void, ErrorCode>
@@ -2385,6 +3142,10 @@ RealClient::batch_get_into_offload_object_internal(
     auto result =
         client_->BatchGetOffloadObject(batchGetResp->transfer_engine_addr, keys,
                                        batchGetResp->pointers, objects);
+    // The transfer is over whether it succeeded or not, so the remote
+    // buffers can go back to its allocator rather than wait for the lease
+    client_requester_->release_offload_object(target_rpc_service_addr,
+                                              batchGetResp->batch_id);
     auto end_time = std::chrono::steady_clock::now();
     auto elapsed_time = static_cast<uint64_t>(
         std::chrono::duration_cast<std::chrono::milliseconds>(end_time -
@@ -2433,6 +3194,18 @@ ClientRequester::batch_get_offload_object(const std::string &client_addr,
     return result;
 }
 
+tl::expected<void, ErrorCode> ClientRequester::release_offload_object(
+    const std::string &client_addr, uint64_t batch_id) {
+    auto result = invoke_rpc<&RealClient::release_offload_object, void>(
+        client_addr, batch_id);
+    if (!result) {
+        LOG(WARNING) << "Failed to release offload object batch " << batch_id
+                     << ", client_addr = " << client_addr
+                     << ", error is: " << result.error();
+    }
+    return result;
+}
+
 template <auto ServiceMethod, typename ReturnType, typename... Args>
 tl::expected<ReturnType, ErrorCode> ClientRequester::invoke_rpc(
     const std::string &client_addr, Args &&...args) {
@@ -0,0 +1,78 @@
+#include "replica_cache.h"
+
+namespace mooncake {
+
+ReplicaCache::ReplicaCache(size_t capacity,
+                           std::chrono::milliseconds min_remaining_lease)
+    : capacity_(capacity), min_remaining_lease_(min_remaining_lease) {}
+
+bool ReplicaCache::Get(const std::string& key,
+                       std::vector<Replica::Descriptor>& replicas,
+                       TimePoint& lease_timeout,
+                       std::optional<uint32_t>* checksum) {
+    MutexLocker lock(&mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return false;
+    }
+    if (std::chrono::steady_clock::now() + min_remaining_lease_ >=
+        it->second->lease_timeout) {
+        lru_.erase(it->second);
+        index_.erase(it);
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    replicas = it->second->replicas;
+    lease_timeout = it->second->lease_timeout;
+    if (checksum) {
+        *checksum = it->second->checksum;
+    }
+    return true;
+}
+
+void ReplicaCache::Put(const std::string& key,
+                       const std::vector<Replica::Descriptor>& replicas,
+                       TimePoint lease_timeout,
+                       std::optional<uint32_t> checksum) {
+    if (std::chrono::steady_clock::now() + min_remaining_lease_ >=
+        lease_timeout) {
+        return;
+    }
+    MutexLocker lock(&mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->replicas = replicas;
+        it->second->lease_timeout = lease_timeout;
+        it->second->checksum = checksum;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    if (index_.size() >= capacity_) {
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+    lru_.push_front(Entry{key, replicas, lease_timeout, checksum});
+    index_.emplace(key, lru_.begin());
+}
+
+void ReplicaCache::Invalidate(const std::string& key) {
+    MutexLocker lock(&mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+}
+
+void ReplicaCache::Clear() {
+    MutexLocker lock(&mutex_);
+    lru_.clear();
+    index_.clear();
+}
+
+size_t ReplicaCache::Size() const {
+    MutexLocker lock(&mutex_);
+    return index_.size();
+}
+
+}  // namespace mooncake
@@ -0,0 +1,74 @@
+#include "replica_load_tracker.h"
+
+#include <algorithm>
+#include <random>
+
+namespace mooncake {
+
+void ReplicaLoadTracker::OnStart(const std::string& endpoint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loads_[endpoint].in_flight++;
+}
+
+void ReplicaLoadTracker::OnFinish(const std::string& endpoint,
+                                  Clock::duration latency, bool success,
+                                  Clock::time_point now) {
+    if (!success) {
+        latency = std::max<Clock::duration>(latency, kFailurePenalty);
+    }
+    const double sample_us =
+        std::chrono::duration<double, std::micro>(latency).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& load = loads_[endpoint];
+    if (load.in_flight > 0) {
+        load.in_flight--;
+    }
+    if (now - load.updated > kStatsTtl) {
+        load.latency_us = sample_us;
+    } else {
+        load.latency_us += kLatencyWeight * (sample_us - load.latency_us);
+    }
+    load.updated = now;
+}
+
+double ReplicaLoadTracker::CostLocked(const EndpointLoad& load,
+                                      Clock::time_point now) const {
+    // Without recent samples the reads ahead are all there is to go by
+    const double latency_us =
+        now - load.updated > kStatsTtl ? 1.0 : load.latency_us;
+    return latency_us * (1 + load.in_flight);
+}
+
+double ReplicaLoadTracker::Cost(const std::string& endpoint,
+                                Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = loads_.find(endpoint);
+    return it == loads_.end() ? 1.0 : CostLocked(it->second, now);
+}
+
+size_t ReplicaLoadTracker::Choose(
+    const std::vector<const std::string*>& endpoints,
+    Clock::time_point now) const {
+    if (endpoints.size() <= 1) {
+        return 0;
+    }
+    static thread_local std::mt19937 gen(std::random_device{}());
+    // Random order, so that ties do not all go to the same replica
+    const size_t first =
+        std::uniform_int_distribution<size_t>(0, endpoints.size() - 1)(gen);
+    size_t second =
+        std::uniform_int_distribution<size_t>(0, endpoints.size() - 2)(gen);
+    if (second >= first) {
+        second++;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto cost = [&](size_t index) {
+        auto it = loads_.find(*endpoints[index]);
+        return it == loads_.end() ? 1.0 : CostLocked(it->second, now);
+    };
+    return cost(second) < cost(first) ? second : first;
+}
+
+}  // namespace mooncake
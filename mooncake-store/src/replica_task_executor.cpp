@@ -0,0 +1,193 @@
+#include "replica_task_executor.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+#include "utils.h"
+
+namespace mooncake {
+
+ReplicaTaskExecutor::Config ReplicaTaskExecutor::Config::FromEnv() {
+    Config config;
+    config.max_workers = static_cast<size_t>(std::max<int64_t>(
+        GetEnvOr<int64_t>("MC_STORE_TASK_MAX_WORKERS", 8), 1));
+    config.batch_size = static_cast<size_t>(std::max<int64_t>(
+        GetEnvOr<int64_t>("MC_STORE_TASK_BATCH_SIZE", 8), 1));
+    config.bandwidth_bytes_per_sec =
+        static_cast<uint64_t>(std::max<int64_t>(
+            GetEnvOr<int64_t>("MC_STORE_TASK_BANDWIDTH_MBPS", 0), 0)) *
+        1024 * 1024;
+    return config;
+}
+
+namespace {
+
+ReplicaTaskExecutor::Config Sanitize(ReplicaTaskExecutor::Config config) {
+    config.min_workers = std::max<size_t>(config.min_workers, 1);
+    config.max_workers = std::max(config.max_workers, config.min_workers);
+    config.batch_size = std::max<size_t>(config.batch_size, 1);
+    return config;
+}
+
+}  // namespace
+
+ReplicaTaskExecutor::ReplicaTaskExecutor(const Config& config,
+                                         BatchHandler handler)
+    : config_(Sanitize(config)), handler_(std::move(handler)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < config_.min_workers; ++i) {
+        SpawnWorkerLocked();
+    }
+}
+
+ReplicaTaskExecutor::~ReplicaTaskExecutor() { Stop(); }
+
+bool ReplicaTaskExecutor::Submit(ReplicaTask task, Clock::duration delay) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+        return false;
+    }
+    if (delay > Clock::duration::zero()) {
+        delayed_.emplace(Clock::now() + delay, std::move(task));
+        // An idle worker waits for the earliest delayed task
+        cv_.notify_one();
+        return true;
+    }
+    ready_.push_back(std::move(task));
+    if (idle_workers_ > 0) {
+        cv_.notify_one();
+    } else if (num_workers_ < config_.max_workers) {
+        SpawnWorkerLocked();
+    }
+    return true;
+}
+
+void ReplicaTaskExecutor::Stop() {
+    std::list<Worker> workers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            return;
+        }
+        stopped_ = true;
+        const size_t dropped = ready_.size() + delayed_.size();
+        if (dropped > 0) {
+            LOG(WARNING) << "action=replica_tasks_dropped"
+                         << ", task_count=" << dropped
+                         << ", reason=executor_stopped";
+        }
+        ready_.clear();
+        delayed_.clear();
+        workers.swap(workers_);
+    }
+    cv_.notify_all();
+    for (auto& worker : workers) {
+        worker.thread.join();
+    }
+}
+
+void ReplicaTaskExecutor::Throttle(uint64_t bytes) {
+    if (config_.bandwidth_bytes_per_sec == 0 || bytes == 0) {
+        return;
+    }
+    const auto cost = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(
+            static_cast<double>(bytes) /
+            static_cast<double>(config_.bandwidth_bytes_per_sec)));
+    Clock::time_point start;
+    {
+        std::lock_guard<std::mutex> lock(throttle_mutex_);
+        start = std::max(throttle_until_, Clock::now() - kMaxBurst);
+        throttle_until_ = start + cost;
+    }
+    std::this_thread::sleep_until(start);
+}
+
+size_t ReplicaTaskExecutor::num_workers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_workers_;
+}
+
+size_t ReplicaTaskExecutor::num_pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ready_.size() + delayed_.size();
+}
+
+void ReplicaTaskExecutor::PromoteDueLocked(Clock::time_point now) {
+    while (!delayed_.empty() && delayed_.begin()->first <= now) {
+        ready_.push_back(std::move(delayed_.begin()->second));
+        delayed_.erase(delayed_.begin());
+    }
+}
+
+void ReplicaTaskExecutor::SpawnWorkerLocked() {
+    // Join the workers that left for being idle
+    for (auto it = workers_.begin(); it != workers_.end();) {
+        if (it->exited) {
+            it->thread.join();
+            it = workers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // The worker waits for mutex_ before touching its entry
+    auto& worker = workers_.emplace_back();
+    num_workers_++;
+    worker.thread = std::thread([this, &worker] { WorkerMain(&worker); });
+}
+
+void ReplicaTaskExecutor::WorkerMain(Worker* worker) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto idle_since = Clock::now();
+    while (!stopped_) {
+        const auto now = Clock::now();
+        PromoteDueLocked(now);
+        if (!ready_.empty()) {
+            const size_t count = std::min(config_.batch_size, ready_.size());
+            std::vector<ReplicaTask> batch;
+            batch.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(ready_.front()));
+                ready_.pop_front();
+            }
+            // Leave the rest to another worker
+            if (!ready_.empty()) {
+                if (idle_workers_ > 0) {
+                    cv_.notify_one();
+                } else if (num_workers_ < config_.max_workers) {
+                    SpawnWorkerLocked();
+                }
+            }
+            lock.unlock();
+            try {
+                handler_(batch);
+            } catch (const std::exception& e) {
+                LOG(ERROR) << "action=replica_task_batch_failed"
+                           << ", task_count=" << batch.size()
+                           << ", exception=" << e.what();
+            }
+            lock.lock();
+            idle_since = Clock::now();
+            continue;
+        }
+
+        if (now - idle_since >= config_.idle_timeout) {
+            if (num_workers_ > config_.min_workers) {
+                break;
+            }
+            idle_since = now;
+        }
+        auto deadline = idle_since + config_.idle_timeout;
+        if (!delayed_.empty()) {
+            deadline = std::min(deadline, delayed_.begin()->first);
+        }
+        idle_workers_++;
+        cv_.wait_until(lock, deadline);
+        idle_workers_--;
+    }
+    num_workers_--;
+    worker->exited = true;
+}
+
+}  // namespace mooncake
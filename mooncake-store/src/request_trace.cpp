@@ -0,0 +1,207 @@
+#include "request_trace.h"
+
+#include <glog/logging.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "utils.h"
+
+namespace mooncake {
+
+namespace {
+
+thread_local uint64_t tls_trace_id = 0;
+
+uint64_t SampleEvery() {
+    static const uint64_t sample_every =
+        GetEnvOr<uint64_t>("MC_STORE_TRACE_SAMPLE_EVERY", 0);
+    return sample_every;
+}
+
+uint64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+uint64_t ThreadId() {
+    static thread_local const uint64_t tid = syscall(SYS_gettid);
+    return tid;
+}
+
+std::mt19937_64& ThreadRng() {
+    static thread_local std::mt19937_64 rng(std::random_device{}() ^
+                                            ThreadId());
+    return rng;
+}
+
+struct SpanRecord {
+    const char* name;
+    uint64_t trace_id;
+    uint64_t start_us;
+    uint64_t duration_us;
+    uint64_t tid;
+};
+
+// Buffers the spans of the process and appends them to the trace file.
+// The file is a JSON array of trace events, which the trace viewers accept
+// without its closing bracket, so it is valid at every flush.
+class TraceCollector {
+   public:
+    static TraceCollector& instance() {
+        static TraceCollector collector;
+        return collector;
+    }
+
+    void Record(const SpanRecord& span) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(span);
+        if (pending_.size() >= kFlushSpans) {
+            FlushLocked();
+        }
+    }
+
+    void Flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FlushLocked();
+    }
+
+   private:
+    static constexpr size_t kFlushSpans = 1024;
+
+    TraceCollector()
+        : path_(GetEnvStringOr(
+              "MC_STORE_TRACE_FILE",
+              "mooncake_trace_" + std::to_string(getpid()) + ".json")) {}
+
+    ~TraceCollector() {
+        Flush();
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    void FlushLocked() {
+        if (pending_.empty()) {
+            return;
+        }
+        if (!file_) {
+            file_ = std::fopen(path_.c_str(), "w");
+            if (!file_) {
+                LOG(ERROR) << "Failed to open trace file " << path_
+                           << ", dropping " << pending_.size() << " spans";
+                pending_.clear();
+                return;
+            }
+            std::fputs("[\n", file_);
+            LOG(INFO) << "Writing request traces to " << path_;
+        }
+        const auto pid = getpid();
+        for (const auto& span : pending_) {
+            std::fprintf(file_,
+                         "%s{\"name\":\"%s\",\"cat\":\"mooncake\","
+                         "\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":%d,"
+                         "\"tid\":%lu,\"args\":{\"trace_id\":\"%016lx\"}}",
+                         first_event_ ? "" : ",\n", span.name,
+                         static_cast<unsigned long>(span.start_us),
+                         static_cast<unsigned long>(span.duration_us),
+                         static_cast<int>(pid),
+                         static_cast<unsigned long>(span.tid),
+                         static_cast<unsigned long>(span.trace_id));
+            first_event_ = false;
+        }
+        std::fflush(file_);
+        pending_.clear();
+    }
+
+    const std::string path_;
+    std::mutex mutex_;
+    std::vector<SpanRecord> pending_;
+    FILE* file_ = nullptr;
+    bool first_event_ = true;
+};
+
+}  // namespace
+
+bool TracingEnabled() { return SampleEvery() > 0; }
+
+uint64_t CurrentTraceId() { return tls_trace_id; }
+
+uint64_t SampleTraceId() {
+    if (tls_trace_id != 0) {
+        return tls_trace_id;
+    }
+    const uint64_t sample_every = SampleEvery();
+    if (sample_every == 0) {
+        return 0;
+    }
+    // Start each thread at a random phase so that threads issuing
+    // requests in lockstep do not all sample the same ones
+    static thread_local uint64_t countdown =
+        ThreadRng()() % sample_every + 1;
+    if (--countdown != 0) {
+        return 0;
+    }
+    countdown = sample_every;
+    uint64_t trace_id;
+    do {
+        trace_id = ThreadRng()();
+    } while (trace_id == 0);
+    return trace_id;
+}
+
+std::string FormatTraceId(uint64_t trace_id) {
+    if (trace_id == 0) {
+        return {};
+    }
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016lx",
+                  static_cast<unsigned long>(trace_id));
+    return buf;
+}
+
+uint64_t ParseTraceId(std::string_view text) {
+    if (text.empty() || text.size() > 16) {
+        return 0;
+    }
+    uint64_t trace_id = 0;
+    for (char c : text) {
+        uint64_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else {
+            return 0;
+        }
+        trace_id = trace_id << 4 | digit;
+    }
+    return trace_id;
+}
+
+void FlushTraces() {
+    if (TracingEnabled()) {
+        TraceCollector::instance().Flush();
+    }
+}
+
+void TraceSpan::Begin() {
+    parent_trace_id_ = tls_trace_id;
+    tls_trace_id = trace_id_;
+    start_us_ = NowUs();
+}
+
+void TraceSpan::End() {
+    const uint64_t end_us = NowUs();
+    tls_trace_id = parent_trace_id_;
+    TraceCollector::instance().Record(
+        {name_, trace_id_, start_us_, end_us - start_us_, ThreadId()});
+}
+
+}  // namespace mooncake
@@ -5,6 +5,7 @@
 #include <ylt/struct_json/json_writer.h>
 
 #include <atomic>
+#include <charconv>
 #include <chrono>
 #include <cstdint>
 #include <sstream>
@@ -17,8 +18,10 @@
 
 #include "master_metric_manager.h"
 #include "master_service.h"
+#include "request_trace.h"
 #include "rpc_helper.h"
 #include "types.h"
+#include "utils.h"
 #include "utils/scoped_vlog_timer.h"
 #include "version.h"
 
@@ -26,12 +29,64 @@ namespace mooncake {
 
 const uint64_t kMetricReportIntervalSeconds = 10;
 
+namespace {
+
+// Trace id the client sent along the RPC being served, 0 if none
+uint64_t RequestTraceId() {
+    if (!TracingEnabled()) {
+        return 0;
+    }
+    // Unset outside of the RPC handlers, e.g. for the HTTP queries
+    auto* context = coro_rpc::get_context();
+    return context ? ParseTraceId(context->get_request_attachment()) : 0;
+}
+
+// Records the latency of an RPC in its histogram and offers it to the slow
+// RPC sampler when the RPC returns, and traces it if the client traces the
+// request. key must outlive the scope.
+class RpcLatencyScope {
+   public:
+    RpcLatencyScope(SlowRpcSampler& sampler, const char* rpc,
+                    std::string_view key, size_t batch_size)
+        : sampler_(sampler),
+          rpc_(rpc),
+          key_(key),
+          batch_size_(batch_size),
+          start_(std::chrono::steady_clock::now()),
+          span_(rpc, RequestTraceId()) {}
+
+    ~RpcLatencyScope() {
+        const auto latency_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start_)
+                .count();
+        MasterMetricManager::instance().observe_rpc_latency(rpc_, latency_us);
+        sampler_.Offer(rpc_, key_, batch_size_, latency_us);
+    }
+
+   private:
+    SlowRpcSampler& sampler_;
+    const char* rpc_;
+    std::string_view key_;
+    size_t batch_size_;
+    std::chrono::steady_clock::time_point start_;
+    TraceSpan span_;
+};
+
+std::string_view FirstKey(const std::vector<std::string>& keys) {
+    return keys.empty() ? std::string_view() : std::string_view(keys.front());
+}
+
+}  // namespace
+
 WrappedMasterService::WrappedMasterService(
     const WrappedMasterServiceConfig& config)
     : master_service_(MasterServiceConfig(config)),
+      slow_rpc_sampler_(
+          GetEnvOr<size_t>("MC_STORE_MASTER_SLOW_RPC_SAMPLES", 0)),
       http_server_(4, config.http_port),
       metric_report_running_(config.enable_metric_reporting) {
-    init_http_server();
+    if (config.enable_http_server) init_http_server();
 
     if (config.enable_metric_reporting) {
         metric_report_thread_ = std::thread([this]() {
@@ -39,6 +94,13 @@ WrappedMasterService::WrappedMasterService(
                 std::string metrics_summary =
                     MasterMetricManager::instance().get_summary_string();
                 LOG(INFO) << "Master Metrics: " << metrics_summary;
+                FlushTraces();
+                for (const auto& sample : slow_rpc_sampler_.Drain()) {
+                    LOG(INFO) << "Slow RPC: " << sample.rpc
+                              << ", key=" << sample.key
+                              << ", batch_size=" << sample.batch_size
+                              << ", latency=" << sample.latency_us << "us";
+                }
                 std::this_thread::sleep_for(
                     std::chrono::seconds(kMetricReportIntervalSeconds));
             }
@@ -120,6 +182,37 @@ void WrappedMasterService::init_http_server() {
             }
         });
 
+    // One page of keys, e.g. /scan_keys?limit=1000&prefix=user_ to start,
+    // then with the shard and after of the returned next cursor until done
+    http_server_.set_http_handler<GET>(
+        "/scan_keys", [&](coro_http_request& req, coro_http_response& resp) {
+            resp.add_header("Content-Type", "application/json; charset=utf-8");
+            auto parse = [&req](std::string_view name, uint64_t fallback) {
+                auto value = req.get_query_value(name);
+                uint64_t parsed = fallback;
+                if (!value.empty()) {
+                    std::from_chars(value.data(), value.data() + value.size(),
+                                    parsed);
+                }
+                return parsed;
+            };
+            ScanKeysCursor cursor;
+            cursor.shard = parse("shard", 0);
+            cursor.after = std::string(req.get_query_value("after"));
+            auto result = master_service_.ScanKeys(
+                cursor, parse("limit", 1000),
+                std::string(req.get_query_value("prefix")),
+                parse("metadata", 0) != 0);
+            if (result) {
+                std::string json;
+                struct_json::to_json(result.value(), json);
+                resp.set_status_and_content(status_type::ok, std::move(json));
+            } else {
+                resp.set_status_and_content(status_type::bad_request,
+                                            toString(result.error()));
+            }
+        });
+
     http_server_.set_http_handler<GET>(
         "/get_all_segments",
         [&](coro_http_request& req, coro_http_response& resp) {
@@ -258,6 +351,7 @@ WrappedMasterService::CalcCacheStats() {
 
 tl::expected<bool, ErrorCode> WrappedMasterService::ExistKey(
     const std::string& key) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "ExistKey", key, 1);
     return execute_rpc(
         "ExistKey", [&] { return master_service_.ExistKey(key); },
         [&](auto& timer) { timer.LogRequest("key=", key); },
@@ -267,6 +361,8 @@ tl::expected<bool, ErrorCode> WrappedMasterService::ExistKey(
 
 std::vector<tl::expected<bool, ErrorCode>> WrappedMasterService::BatchExistKey(
     const std::vector<std::string>& keys) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "BatchExistKey", FirstKey(keys),
+                            keys.size());
     ScopedVLogTimer timer(1, "BatchExistKey");
     const size_t total_keys = keys.size();
     timer.LogRequest("keys_count=", total_keys);
@@ -298,6 +394,38 @@ std::vector<tl::expected<bool, ErrorCode>> WrappedMasterService::BatchExistKey(
     return result;
 }
 
+tl::expected<uint64_t, ErrorCode> WrappedMasterService::BatchExistKeyPrefix(
+    const std::vector<std::string>& keys) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "BatchExistKeyPrefix",
+                            FirstKey(keys), keys.size());
+    return execute_rpc(
+        "BatchExistKeyPrefix",
+        [&] { return master_service_.BatchExistKeyPrefix(keys); },
+        [&](auto& timer) { timer.LogRequest("keys_count=", keys.size()); },
+        [&] {
+            MasterMetricManager::instance().inc_batch_exist_key_requests(
+                keys.size());
+        },
+        [&] {
+            MasterMetricManager::instance().inc_batch_exist_key_failures(
+                keys.size());
+        });
+}
+
+tl::expected<ScanKeysResponse, ErrorCode> WrappedMasterService::ScanKeys(
+    const ScanKeysCursor& cursor, uint64_t limit, const std::string& prefix,
+    bool with_metadata) {
+    ScopedVLogTimer timer(1, "ScanKeys");
+    timer.LogRequest("shard=", cursor.shard, ", limit=", limit,
+                     ", prefix=", prefix);
+
+    auto result =
+        master_service_.ScanKeys(cursor, limit, prefix, with_metadata);
+
+    timer.LogResponseExpected(result);
+    return result;
+}
+
 tl::expected<
     std::unordered_map<UUID, std::vector<std::string>, boost::hash<UUID>>,
     ErrorCode>
@@ -396,6 +524,7 @@ WrappedMasterService::GetReplicaListByRegex(const std::string& str) {
 
 tl::expected<GetReplicaListResponse, ErrorCode>
 WrappedMasterService::GetReplicaList(const std::string& key) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "GetReplicaList", key, 1);
     return execute_rpc(
         "GetReplicaList", [&] { return master_service_.GetReplicaList(key); },
         [&](auto& timer) { timer.LogRequest("key=", key); },
@@ -408,18 +537,15 @@ WrappedMasterService::GetReplicaList(const std::string& key) {
 std::vector<tl::expected<GetReplicaListResponse, ErrorCode>>
 WrappedMasterService::BatchGetReplicaList(
     const std::vector<std::string>& keys) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "BatchGetReplicaList",
+                            FirstKey(keys), keys.size());
     ScopedVLogTimer timer(1, "BatchGetReplicaList");
     const size_t total_keys = keys.size();
     timer.LogRequest("keys_count=", total_keys);
     MasterMetricManager::instance().inc_batch_get_replica_list_requests(
         total_keys);
 
-    std::vector<tl::expected<GetReplicaListResponse, ErrorCode>> results;
-    results.reserve(keys.size());
-
-    for (const auto& key : keys) {
-        results.emplace_back(master_service_.GetReplicaList(key));
-    }
+    auto results = master_service_.BatchGetReplicaList(keys);
 
     size_t failure_count = 0;
     for (size_t i = 0; i < results.size(); ++i) {
@@ -451,10 +577,16 @@ WrappedMasterService::BatchGetReplicaList(
     return results;
 }
 
+FlatReplicaLists WrappedMasterService::BatchGetReplicaListFlat(
+    const std::vector<std::string>& keys) {
+    return EncodeReplicaLists(BatchGetReplicaList(keys));
+}
+
 tl::expected<std::vector<Replica::Descriptor>, ErrorCode>
 WrappedMasterService::PutStart(const UUID& client_id, const std::string& key,
                                const uint64_t slice_length,
                                const ReplicateConfig& config) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "PutStart", key, 1);
     return execute_rpc(
         "PutStart",
         [&] {
@@ -470,20 +602,78 @@ WrappedMasterService::PutStart(const UUID& client_id, const std::string& key,
 }
 
 tl::expected<void, ErrorCode> WrappedMasterService::PutEnd(
-    const UUID& client_id, const std::string& key, ReplicaType replica_type) {
+    const UUID& client_id, const std::string& key, ReplicaType replica_type,
+    std::optional<uint32_t> checksum) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "PutEnd", key, 1);
     return execute_rpc(
         "PutEnd",
-        [&] { return master_service_.PutEnd(client_id, key, replica_type); },
+        [&] {
+            return master_service_.PutEnd(client_id, key, replica_type,
+                                          checksum);
+        },
         [&](auto& timer) {
             timer.LogRequest("client_id=", client_id, ", key=", key,
-                             ", replica_type=", replica_type);
+                             ", replica_type=", replica_type,
+                             ", has_checksum=", checksum.has_value());
         },
         [] { MasterMetricManager::instance().inc_put_end_requests(); },
         [] { MasterMetricManager::instance().inc_put_end_failures(); });
 }
 
+tl::expected<std::vector<Replica::Descriptor>, ErrorCode>
+WrappedMasterService::StreamPutStart(const UUID& client_id,
+                                     const std::string& key,
+                                     const std::vector<uint64_t>& chunk_lengths,
+                                     const ReplicateConfig& config) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "StreamPutStart", key, 1);
+    return execute_rpc(
+        "StreamPutStart",
+        [&] {
+            return master_service_.StreamPutStart(client_id, key,
+                                                  chunk_lengths, config);
+        },
+        [&](auto& timer) {
+            timer.LogRequest("client_id=", client_id, ", key=", key,
+                             ", chunk_count=", chunk_lengths.size());
+        },
+        [&] { MasterMetricManager::instance().inc_put_start_requests(); },
+        [] { MasterMetricManager::instance().inc_put_start_failures(); });
+}
+
+tl::expected<void, ErrorCode> WrappedMasterService::StreamPutCommit(
+    const UUID& client_id, const std::string& key, uint64_t first_chunk,
+    uint64_t num_chunks) {
+    return execute_rpc(
+        "StreamPutCommit",
+        [&] {
+            return master_service_.StreamPutCommit(client_id, key, first_chunk,
+                                                   num_chunks);
+        },
+        [&](auto& timer) {
+            timer.LogRequest("client_id=", client_id, ", key=", key,
+                             ", first_chunk=", first_chunk,
+                             ", num_chunks=", num_chunks);
+        },
+        [] {}, [] {});
+}
+
+tl::expected<GetStreamReplicaListResponse, ErrorCode>
+WrappedMasterService::GetStreamReplicaList(const std::string& key) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "GetStreamReplicaList", key,
+                            1);
+    return execute_rpc(
+        "GetStreamReplicaList",
+        [&] { return master_service_.GetStreamReplicaList(key); },
+        [&](auto& timer) { timer.LogRequest("key=", key); },
+        [] { MasterMetricManager::instance().inc_get_replica_list_requests(); },
+        [] {
+            MasterMetricManager::instance().inc_get_replica_list_failures();
+        });
+}
+
 tl::expected<void, ErrorCode> WrappedMasterService::PutRevoke(
     const UUID& client_id, const std::string& key, ReplicaType replica_type) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "PutRevoke", key, 1);
     return execute_rpc(
         "PutRevoke",
         [&] { return master_service_.PutRevoke(client_id, key, replica_type); },
@@ -500,6 +690,8 @@ WrappedMasterService::BatchPutStart(const UUID& client_id,
                                     const std::vector<std::string>& keys,
                                     const std::vector<uint64_t>& slice_lengths,
                                     const ReplicateConfig& config) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "BatchPutStart", FirstKey(keys),
+                            keys.size());
     ScopedVLogTimer timer(1, "BatchPutStart");
     const size_t total_keys = keys.size();
     timer.LogRequest("client_id=", client_id, ", keys_count=", total_keys);
@@ -509,8 +701,11 @@ WrappedMasterService::BatchPutStart(const UUID& client_id,
         results;
     results.reserve(keys.size());
 
+    // A content hash describes one value, not every value of the batch
+    ReplicateConfig batch_config = config;
+    batch_config.content_hash.clear();
     if (config.prefer_alloc_in_same_node) {
-        ReplicateConfig new_config = config;
+        ReplicateConfig new_config = batch_config;
         for (size_t i = 0; i < keys.size(); ++i) {
             auto result = master_service_.PutStart(
                 client_id, keys[i], slice_lengths[i], new_config);
@@ -534,7 +729,7 @@ WrappedMasterService::BatchPutStart(const UUID& client_id,
     } else {
         for (size_t i = 0; i < keys.size(); ++i) {
             results.emplace_back(master_service_.PutStart(
-                client_id, keys[i], slice_lengths[i], config));
+                client_id, keys[i], slice_lengths[i], batch_config));
         }
     }
 
@@ -576,19 +771,17 @@ WrappedMasterService::BatchPutStart(const UUID& client_id,
 }
 
 std::vector<tl::expected<void, ErrorCode>> WrappedMasterService::BatchPutEnd(
-    const UUID& client_id, const std::vector<std::string>& keys) {
+    const UUID& client_id, const std::vector<std::string>& keys,
+    const std::vector<uint32_t>& checksums) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "BatchPutEnd", FirstKey(keys),
+                            keys.size());
     ScopedVLogTimer timer(1, "BatchPutEnd");
     const size_t total_keys = keys.size();
     timer.LogRequest("client_id=", client_id, ", keys_count=", total_keys);
     MasterMetricManager::instance().inc_batch_put_end_requests(total_keys);
 
-    std::vector<tl::expected<void, ErrorCode>> results;
-    results.reserve(keys.size());
-
-    for (const auto& key : keys) {
-        results.emplace_back(
-            master_service_.PutEnd(client_id, key, ReplicaType::MEMORY));
-    }
+    std::vector<tl::expected<void, ErrorCode>> results =
+        master_service_.BatchPutEnd(client_id, keys, checksums);
 
     size_t failure_count = 0;
     for (size_t i = 0; i < results.size(); ++i) {
@@ -616,6 +809,8 @@ std::vector<tl::expected<void, ErrorCode>> WrappedMasterService::BatchPutEnd(
 
 std::vector<tl::expected<void, ErrorCode>> WrappedMasterService::BatchPutRevoke(
     const UUID& client_id, const std::vector<std::string>& keys) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "BatchPutRevoke", FirstKey(keys),
+                            keys.size());
     ScopedVLogTimer timer(1, "BatchPutRevoke");
     const size_t total_keys = keys.size();
     timer.LogRequest("client_id=", client_id, ", keys_count=", total_keys);
@@ -653,8 +848,85 @@ std::vector<tl::expected<void, ErrorCode>> WrappedMasterService::BatchPutRevoke(
     return results;
 }
 
+tl::expected<PutLease, ErrorCode> WrappedMasterService::GrantPutLease(
+    const UUID& client_id, uint64_t slice_length, uint64_t slot_count,
+    const ReplicateConfig& config) {
+    return execute_rpc(
+        "GrantPutLease",
+        [&] {
+            return master_service_.GrantPutLease(client_id, slice_length,
+                                                 slot_count, config);
+        },
+        [&](auto& timer) {
+            timer.LogRequest("client_id=", client_id,
+                             ", slice_length=", slice_length,
+                             ", slot_count=", slot_count);
+        },
+        [] {}, [] {});
+}
+
+std::vector<tl::expected<void, ErrorCode>>
+WrappedMasterService::BatchLeasedPutEnd(const UUID& client_id,
+                                        const std::vector<LeasedPut>& puts) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "BatchLeasedPutEnd",
+                            puts.empty() ? std::string_view()
+                                         : std::string_view(puts.front().key),
+                            puts.size());
+    ScopedVLogTimer timer(1, "BatchLeasedPutEnd");
+    const size_t total_keys = puts.size();
+    timer.LogRequest("client_id=", client_id, ", keys_count=", total_keys);
+    // Each leased put stands for a PutStart and a PutEnd
+    MasterMetricManager::instance().inc_batch_put_end_requests(total_keys);
+
+    std::vector<tl::expected<void, ErrorCode>> results =
+        master_service_.BatchLeasedPutEnd(client_id, puts);
+
+    size_t failure_count = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (!results[i].has_value()) {
+            failure_count++;
+            auto error = results[i].error();
+            // The client puts these keys the usual way instead
+            if (error == ErrorCode::OBJECT_ALREADY_EXISTS ||
+                error == ErrorCode::LEASE_EXPIRED) {
+                VLOG(1) << "BatchLeasedPutEnd failed for key[" << i << "] '"
+                        << puts[i].key << "': " << toString(error);
+            } else {
+                LOG(ERROR) << "BatchLeasedPutEnd failed for key[" << i
+                           << "] '" << puts[i].key
+                           << "': " << toString(error);
+            }
+        }
+    }
+
+    if (failure_count == total_keys) {
+        MasterMetricManager::instance().inc_batch_put_end_failures(
+            failure_count);
+    } else if (failure_count != 0) {
+        MasterMetricManager::instance().inc_batch_put_end_partial_success(
+            failure_count);
+    }
+
+    timer.LogResponse("total=", results.size(),
+                      ", success=", results.size() - failure_count,
+                      ", failures=", failure_count);
+    return results;
+}
+
+tl::expected<void, ErrorCode> WrappedMasterService::ReleasePutLease(
+    const UUID& client_id, uint64_t lease_id) {
+    return execute_rpc(
+        "ReleasePutLease",
+        [&] { return master_service_.ReleasePutLease(client_id, lease_id); },
+        [&](auto& timer) {
+            timer.LogRequest("client_id=", client_id, ", lease_id=", lease_id);
+        },
+        [] {}, [] {});
+}
+
 tl::expected<void, ErrorCode> WrappedMasterService::Remove(
     const std::string& key, bool force) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "Remove", key, 1);
     return execute_rpc(
         "Remove", [&] { return master_service_.Remove(key, force); },
         [&](auto& timer) { timer.LogRequest("key=", key, ", force=", force); },
@@ -685,6 +957,7 @@ long WrappedMasterService::RemoveAll(bool force) {
 
 tl::expected<void, ErrorCode> WrappedMasterService::MountSegment(
     const Segment& segment, const UUID& client_id) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "MountSegment", segment.name, 1);
     return execute_rpc(
         "MountSegment",
         [&] { return master_service_.MountSegment(segment, client_id); },
@@ -712,6 +985,7 @@ tl::expected<void, ErrorCode> WrappedMasterService::ReMountSegment(
 
 tl::expected<void, ErrorCode> WrappedMasterService::UnmountSegment(
     const UUID& segment_id, const UUID& client_id) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "UnmountSegment", {}, 1);
     return execute_rpc(
         "UnmountSegment",
         [&] { return master_service_.UnmountSegment(segment_id, client_id); },
@@ -858,6 +1132,22 @@ WrappedMasterService::FetchTasks(const UUID& client_id, size_t batch_size) {
         [] { MasterMetricManager::instance().inc_fetch_tasks_failures(); });
 }
 
+void WrappedMasterService::WaitTasks(
+    coro_rpc::context<tl::expected<std::vector<TaskAssignment>, ErrorCode>>
+        context,
+    UUID client_id, size_t batch_size, uint64_t wait_ms) {
+    MasterMetricManager::instance().inc_fetch_tasks_requests();
+    master_service_.WaitTasks(
+        client_id, batch_size, wait_ms,
+        [context](tl::expected<std::vector<TaskAssignment>, ErrorCode>
+                      result) mutable {
+            if (!result) {
+                MasterMetricManager::instance().inc_fetch_tasks_failures();
+            }
+            context.response_msg(std::move(result));
+        });
+}
+
 tl::expected<void, ErrorCode> WrappedMasterService::MarkTaskToComplete(
     const UUID& client_id, const TaskCompleteRequest& request) {
     return execute_rpc(
@@ -892,18 +1182,80 @@ WrappedMasterService::GetStorageConfig() {
 }
 
 tl::expected<PingResponse, ErrorCode> WrappedMasterService::Ping(
-    const UUID& client_id) {
+    const UUID& client_id, const ClientLoadReport& load_report,
+    std::optional<uint64_t> put_sequence_id) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "Ping", {}, 1);
     ScopedVLogTimer timer(1, "Ping");
-    timer.LogRequest("client_id=", client_id);
+    timer.LogRequest("client_id=", client_id,
+                     ", traffic_endpoints=", load_report.traffic.size());
 
     MasterMetricManager::instance().inc_ping_requests();
 
-    auto result = master_service_.Ping(client_id);
+    auto result = master_service_.Ping(client_id, load_report, put_sequence_id);
 
     timer.LogResponseExpected(result);
     return result;
 }
 
+std::vector<tl::expected<BatchPingResponse, ErrorCode>>
+WrappedMasterService::BatchPing(const std::vector<BatchPingRequest>& requests) {
+    RpcLatencyScope latency(slow_rpc_sampler_, "BatchPing", {},
+                            requests.size());
+    ScopedVLogTimer timer(1, "BatchPing");
+    timer.LogRequest("clients_count=", requests.size());
+
+    MasterMetricManager::instance().inc_ping_requests(requests.size());
+
+    auto result = master_service_.BatchPing(requests);
+
+    size_t failure_count = 0;
+    size_t task_count = 0;
+    for (const auto& response : result) {
+        if (!response) {
+            failure_count++;
+        } else {
+            task_count += response->tasks.size();
+        }
+    }
+    timer.LogResponse("total=", result.size(), ", failures=", failure_count,
+                      ", tasks=", task_count);
+    return result;
+}
+
+tl::expected<FetchOpLogResponse, ErrorCode> WrappedMasterService::FetchOpLog(
+    uint64_t start_sequence_id, uint64_t max_entries) {
+    ScopedVLogTimer timer(2, "FetchOpLog");
+    timer.LogRequest("start_sequence_id=", start_sequence_id,
+                     ", max_entries=", max_entries);
+
+    auto result = master_service_.FetchOpLog(start_sequence_id, max_entries);
+
+    // The entries themselves are too verbose to be logged
+    if (result) {
+        timer.LogResponse("entries=", result->entries.size(),
+                          ", next_sequence_id=", result->next_sequence_id);
+    } else {
+        timer.LogResponseExpected(result);
+    }
+    return result;
+}
+
+tl::expected<StandbySnapshotResponse, ErrorCode>
+WrappedMasterService::GetStandbySnapshot() {
+    ScopedVLogTimer timer(1, "GetStandbySnapshot");
+    timer.LogRequest("action=get_standby_snapshot");
+
+    auto result = master_service_.GetStandbySnapshot();
+
+    if (result) {
+        timer.LogResponse("sequence_id=", result->sequence_id,
+                          ", bytes=", result->data.size());
+    } else {
+        timer.LogResponseExpected(result);
+    }
+    return result;
+}
+
 tl::expected<std::string, ErrorCode> WrappedMasterService::ServiceReady() {
     return GetMooncakeStoreVersion();
 }
@@ -961,18 +1313,35 @@ void RegisterRpcService(
     server
         .register_handler<&mooncake::WrappedMasterService::BatchGetReplicaList>(
             &wrapped_master_service);
+    server.register_handler<
+        &mooncake::WrappedMasterService::BatchGetReplicaListFlat>(
+        &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::PutStart>(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::PutEnd>(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::PutRevoke>(
         &wrapped_master_service);
+    server.register_handler<&mooncake::WrappedMasterService::StreamPutStart>(
+        &wrapped_master_service);
+    server.register_handler<&mooncake::WrappedMasterService::StreamPutCommit>(
+        &wrapped_master_service);
+    server.register_handler<
+        &mooncake::WrappedMasterService::GetStreamReplicaList>(
+        &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::BatchPutStart>(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::BatchPutEnd>(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::BatchPutRevoke>(
         &wrapped_master_service);
+    server.register_handler<&mooncake::WrappedMasterService::GrantPutLease>(
+        &wrapped_master_service);
+    server.register_handler<
+        &mooncake::WrappedMasterService::BatchLeasedPutEnd>(
+        &wrapped_master_service);
+    server.register_handler<&mooncake::WrappedMasterService::ReleasePutLease>(
+        &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::Remove>(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::RemoveByRegex>(
@@ -987,12 +1356,19 @@ void RegisterRpcService(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::Ping>(
         &wrapped_master_service);
+    server.register_handler<&mooncake::WrappedMasterService::BatchPing>(
+        &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::GetFsdir>(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::GetStorageConfig>(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::BatchExistKey>(
         &wrapped_master_service);
+    server.register_handler<
+        &mooncake::WrappedMasterService::BatchExistKeyPrefix>(
+        &wrapped_master_service);
+    server.register_handler<&mooncake::WrappedMasterService::ScanKeys>(
+        &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::ServiceReady>(
         &wrapped_master_service);
     server.register_handler<
@@ -1024,9 +1400,16 @@ void RegisterRpcService(
         &wrapped_master_service);
     server.register_handler<&mooncake::WrappedMasterService::FetchTasks>(
         &wrapped_master_service);
+    server.register_handler<&mooncake::WrappedMasterService::WaitTasks>(
+        &wrapped_master_service);
     server
         .register_handler<&mooncake::WrappedMasterService::MarkTaskToComplete>(
             &wrapped_master_service);
+    server.register_handler<&mooncake::WrappedMasterService::FetchOpLog>(
+        &wrapped_master_service);
+    server
+        .register_handler<&mooncake::WrappedMasterService::GetStandbySnapshot>(
+            &wrapped_master_service);
 }
 
 }  // namespace mooncake
@@ -79,9 +79,18 @@ ErrorCode ScopedSegmentAccess::MountSegment(const Segment& segment,
                 allocator = std::make_shared<CachelibBufferAllocator>(
                     segment.name, buffer, size, segment.te_endpoint);
                 break;
-            case BufferAllocatorType::OFFSET:
-                allocator = std::make_shared<OffsetBufferAllocator>(
+            case BufferAllocatorType::OFFSET: {
+                auto offset_allocator = std::make_shared<OffsetBufferAllocator>(
                     segment.name, buffer, size, segment.te_endpoint);
+                offset_allocator->enableAllocationCache(
+                    segment_manager_->allocator_cache_max_size_);
+                allocator = std::move(offset_allocator);
+                break;
+            }
+            case BufferAllocatorType::SLAB:
+                allocator = std::make_shared<SlabBufferAllocator>(
+                    segment.name, buffer, size, segment.te_endpoint,
+                    segment_manager_->size_classes_);
                 break;
             default:
                 LOG(ERROR) << "segment_name=" << segment.name
@@ -102,7 +111,8 @@ ErrorCode ScopedSegmentAccess::MountSegment(const Segment& segment,
         return ErrorCode::INVALID_PARAMS;
     }
 
-    segment_manager_->allocator_manager_.addAllocator(segment.name, allocator);
+    segment_manager_->allocator_manager_.addAllocator(segment.name, allocator,
+                                                      segment.failure_domain);
     segment_manager_->client_segments_[client_id].push_back(segment.id);
     segment_manager_->mounted_segments_[segment.id] = {
         segment, SegmentStatus::OK, std::move(allocator)};
@@ -254,8 +264,17 @@ ErrorCode ScopedSegmentAccess::GetClientSegments(
     return ErrorCode::OK;
 }
 
+void ScopedSegmentAccess::GetAllClients(std::vector<UUID>& client_ids) const {
+    client_ids.clear();
+    client_ids.reserve(segment_manager_->client_segments_.size());
+    for (const auto& [client_id, segment_ids] :
+         segment_manager_->client_segments_) {
+        client_ids.push_back(client_id);
+    }
+}
+
 ErrorCode ScopedSegmentAccess::GetAllSegments(
-    std::vector<std::string>& all_segments) {
+    std::vector<std::string>& all_segments) const {
     all_segments.clear();
     for (auto& segment : segment_manager_->mounted_segments_) {
         if (segment.second.status == SegmentStatus::OK) {
@@ -266,7 +285,8 @@ ErrorCode ScopedSegmentAccess::GetAllSegments(
 }
 
 ErrorCode ScopedSegmentAccess::QuerySegments(const std::string& segment,
-                                             size_t& used, size_t& capacity) {
+                                             size_t& used,
+                                             size_t& capacity) const {
     size_t total_used = 0, total_capacity = 0;
     const auto& allocator_manager = segment_manager_->allocator_manager_;
     const auto& allocators = allocator_manager.getAllocators(segment);
@@ -307,6 +327,231 @@ bool ScopedSegmentAccess::ExistsSegmentName(
     return it != segment_manager_->client_by_name_.end();
 }
 
+ErrorCode ScopedSegmentAccess::SelectDramSegment(
+    size_t size, std::string& segment_name,
+    const std::vector<std::string>& excluded) const {
+    const MountedSegment* best = nullptr;
+    size_t best_free = 0;
+    for (const auto& [id, mounted] : segment_manager_->mounted_segments_) {
+        const auto& allocator = mounted.buf_allocator;
+        if (mounted.status != SegmentStatus::OK || !allocator ||
+            mounted.segment.protocol == "cxl" ||
+            allocator->getLargestFreeRegion() < size ||
+            std::find(excluded.begin(), excluded.end(),
+                      mounted.segment.name) != excluded.end()) {
+            continue;
+        }
+        const size_t free = allocator->capacity() - allocator->size();
+        if (best == nullptr || free > best_free) {
+            best = &mounted;
+            best_free = free;
+        }
+    }
+    if (best == nullptr) {
+        return ErrorCode::NO_AVAILABLE_HANDLE;
+    }
+    segment_name = best->segment.name;
+    return ErrorCode::OK;
+}
+
+template <typename T>
+void ScopedSegmentAccess::SerializeSegmentsTo(
+    T& serializer, AllocatorIndex& allocator_index) const {
+    allocator_index.clear();
+
+    uint64_t num_segments = 0;
+    for (const auto& [client_id, segment_ids] :
+         segment_manager_->client_segments_) {
+        for (const auto& segment_id : segment_ids) {
+            auto it = segment_manager_->mounted_segments_.find(segment_id);
+            if (it != segment_manager_->mounted_segments_.end() &&
+                it->second.status == SegmentStatus::OK) {
+                num_segments++;
+            }
+        }
+    }
+    serializer.write(&num_segments, sizeof(num_segments));
+
+    for (const auto& [client_id, segment_ids] :
+         segment_manager_->client_segments_) {
+        for (const auto& segment_id : segment_ids) {
+            auto it = segment_manager_->mounted_segments_.find(segment_id);
+            if (it == segment_manager_->mounted_segments_.end() ||
+                it->second.status != SegmentStatus::OK) {
+                continue;
+            }
+            const auto& segment = it->second.segment;
+            auto allocator = std::dynamic_pointer_cast<OffsetBufferAllocator>(
+                it->second.buf_allocator);
+            if (!allocator) {
+                serializer.set_error("allocator_not_serializable");
+                return;
+            }
+            uint64_t base = segment.base;
+            uint64_t size = segment.size;
+            serializer.write(&client_id.first, sizeof(client_id.first));
+            serializer.write(&client_id.second, sizeof(client_id.second));
+            serializer.write(&segment.id.first, sizeof(segment.id.first));
+            serializer.write(&segment.id.second, sizeof(segment.id.second));
+            serialize_string(serializer, segment.name);
+            serializer.write(&base, sizeof(base));
+            serializer.write(&size, sizeof(size));
+            serialize_string(serializer, segment.te_endpoint);
+            serialize_string(serializer, segment.protocol);
+            serialize_string(serializer, segment.failure_domain);
+            allocator->serialize_to(serializer);
+            allocator_index.emplace(allocator.get(),
+                                    static_cast<uint32_t>(
+                                        allocator_index.size()));
+        }
+    }
+
+    uint64_t num_local_disk_segments =
+        segment_manager_->client_local_disk_segment_.size();
+    serializer.write(&num_local_disk_segments,
+                     sizeof(num_local_disk_segments));
+    for (const auto& [client_id, local_disk_segment] :
+         segment_manager_->client_local_disk_segment_) {
+        uint8_t enable_offloading = local_disk_segment->enable_offloading;
+        serializer.write(&client_id.first, sizeof(client_id.first));
+        serializer.write(&client_id.second, sizeof(client_id.second));
+        serializer.write(&enable_offloading, sizeof(enable_offloading));
+    }
+}
+
+ErrorCode ScopedSegmentAccess::SerializeSegments(
+    std::vector<SerializedByte>& buffer,
+    AllocatorIndex& allocator_index) const {
+    if (segment_manager_->enable_cxl_ ||
+        segment_manager_->memory_allocator_ != BufferAllocatorType::OFFSET) {
+        LOG(ERROR) << "error=snapshot_requires_offset_allocator";
+        return ErrorCode::UNAVAILABLE_IN_CURRENT_MODE;
+    }
+
+    SerializeSizeCounter counter;
+    SerializeSegmentsTo(counter, allocator_index);
+    if (counter.has_error()) {
+        LOG(ERROR) << "Serializing segments failed, error="
+                   << counter.get_error();
+        return ErrorCode::INTERNAL_ERROR;
+    }
+
+    buffer.resize(counter.get_size());
+    SerializeWriter writer(buffer.data(), buffer.size());
+    SerializeSegmentsTo(writer, allocator_index);
+    if (writer.has_error() || !writer.finish_write()) {
+        LOG(ERROR) << "Serializing segments failed, error="
+                   << writer.get_error();
+        return ErrorCode::INTERNAL_ERROR;
+    }
+    return ErrorCode::OK;
+}
+
+ErrorCode ScopedSegmentAccess::DeserializeSegments(
+    SerializerReader& reader,
+    std::vector<std::shared_ptr<OffsetBufferAllocator>>& allocators,
+    std::vector<UUID>& client_ids) {
+    if (segment_manager_->enable_cxl_ ||
+        segment_manager_->memory_allocator_ != BufferAllocatorType::OFFSET) {
+        LOG(ERROR) << "error=snapshot_requires_offset_allocator";
+        return ErrorCode::UNAVAILABLE_IN_CURRENT_MODE;
+    }
+
+    struct RestoredSegment {
+        UUID client_id;
+        Segment segment;
+        std::shared_ptr<OffsetBufferAllocator> allocator;
+    };
+    std::vector<RestoredSegment> restored;
+    std::vector<std::pair<UUID, bool>> local_disk_segments;
+
+    // Parse everything before mounting so that a corrupted snapshot leaves
+    // the segment manager untouched.
+    try {
+        uint64_t num_segments = 0;
+        reader.read(&num_segments, sizeof(num_segments));
+        for (uint64_t i = 0; i < num_segments; i++) {
+            RestoredSegment entry;
+            uint64_t base = 0;
+            uint64_t size = 0;
+            reader.read(&entry.client_id.first, sizeof(entry.client_id.first));
+            reader.read(&entry.client_id.second,
+                        sizeof(entry.client_id.second));
+            reader.read(&entry.segment.id.first,
+                        sizeof(entry.segment.id.first));
+            reader.read(&entry.segment.id.second,
+                        sizeof(entry.segment.id.second));
+            entry.segment.name = deserialize_string(reader);
+            reader.read(&base, sizeof(base));
+            reader.read(&size, sizeof(size));
+            entry.segment.base = base;
+            entry.segment.size = size;
+            entry.segment.te_endpoint = deserialize_string(reader);
+            entry.segment.protocol = deserialize_string(reader);
+            entry.segment.failure_domain = deserialize_string(reader);
+            entry.allocator = OffsetBufferAllocator::deserialize_from(reader);
+            if (entry.allocator->capacity() != entry.segment.size ||
+                entry.allocator->getSegmentName() != entry.segment.name) {
+                LOG(ERROR) << "segment_name=" << entry.segment.name
+                           << ", error=allocator_does_not_match_segment";
+                return ErrorCode::INVALID_PARAMS;
+            }
+            entry.allocator->enableAllocationCache(
+                segment_manager_->allocator_cache_max_size_);
+            restored.emplace_back(std::move(entry));
+        }
+
+        uint64_t num_local_disk_segments = 0;
+        reader.read(&num_local_disk_segments,
+                    sizeof(num_local_disk_segments));
+        for (uint64_t i = 0; i < num_local_disk_segments; i++) {
+            UUID client_id;
+            uint8_t enable_offloading = 0;
+            reader.read(&client_id.first, sizeof(client_id.first));
+            reader.read(&client_id.second, sizeof(client_id.second));
+            reader.read(&enable_offloading, sizeof(enable_offloading));
+            local_disk_segments.emplace_back(client_id, enable_offloading != 0);
+        }
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Deserializing segments failed, error=" << e.what();
+        return ErrorCode::INVALID_PARAMS;
+    }
+
+    for (const auto& entry : restored) {
+        if (segment_manager_->mounted_segments_.contains(entry.segment.id)) {
+            LOG(ERROR) << "segment_name=" << entry.segment.name
+                       << ", error=segment_already_exists";
+            return ErrorCode::SEGMENT_ALREADY_EXISTS;
+        }
+    }
+
+    allocators.clear();
+    client_ids.clear();
+    for (auto& entry : restored) {
+        const auto& segment = entry.segment;
+        segment_manager_->allocator_manager_.addAllocator(
+            segment.name, entry.allocator, segment.failure_domain);
+        segment_manager_->client_segments_[entry.client_id].push_back(
+            segment.id);
+        segment_manager_->mounted_segments_[segment.id] = {
+            segment, SegmentStatus::OK, entry.allocator};
+        segment_manager_->client_by_name_[segment.name] = entry.client_id;
+        MasterMetricManager::instance().inc_total_mem_capacity(segment.name,
+                                                               segment.size);
+        allocators.push_back(std::move(entry.allocator));
+        if (std::find(client_ids.begin(), client_ids.end(), entry.client_id) ==
+            client_ids.end()) {
+            client_ids.push_back(entry.client_id);
+        }
+    }
+    for (const auto& [client_id, enable_offloading] : local_disk_segments) {
+        segment_manager_->client_local_disk_segment_.try_emplace(
+            client_id, std::make_shared<LocalDiskSegment>(enable_offloading));
+    }
+
+    return ErrorCode::OK;
+}
+
 void SegmentManager::initializeCxlAllocator(const std::string& cxl_path,
                                             const size_t cxl_size) {
     LOG(INFO) << "Init CXL global allocator.";
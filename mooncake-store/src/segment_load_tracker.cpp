@@ -0,0 +1,106 @@
+#include "segment_load_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace mooncake {
+
+SegmentLoadTracker::SegmentLoadTracker(std::chrono::milliseconds decay_period)
+    : decay_period_sec_(
+          std::max(std::chrono::duration<double>(decay_period).count(),
+                   1e-3)) {}
+
+double SegmentLoadTracker::Decayed(const DecayedBytes& value,
+                                   Clock::time_point now) const {
+    if (now <= value.updated) {
+        return value.bytes;
+    }
+    const double elapsed =
+        std::chrono::duration<double>(now - value.updated).count();
+    return value.bytes * std::exp(-elapsed / decay_period_sec_);
+}
+
+void SegmentLoadTracker::Add(DecayedBytes& value, double bytes,
+                             Clock::time_point now) {
+    value.bytes = Decayed(value, now) + bytes;
+    value.updated = std::max(value.updated, now);
+}
+
+void SegmentLoadTracker::Report(const ClientLoadReport& report,
+                                Clock::time_point now) {
+    if (report.traffic.empty() &&
+        (report.endpoint.empty() || report.rack.empty())) {
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!report.endpoint.empty() && !report.rack.empty()) {
+        racks_[HostOf(report.endpoint)] = report.rack;
+    }
+    for (const auto& traffic : report.traffic) {
+        const double bytes =
+            static_cast<double>(traffic.read_bytes + traffic.write_bytes);
+        if (traffic.endpoint.empty() || bytes == 0) {
+            continue;
+        }
+        Add(endpoints_[traffic.endpoint], bytes, now);
+        Add(total_, bytes, now);
+    }
+}
+
+double SegmentLoadTracker::GetBandwidth(const std::string& endpoint,
+                                        Clock::time_point now) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = endpoints_.find(endpoint);
+    if (it == endpoints_.end()) {
+        return 0;
+    }
+    return Decayed(it->second, now) / decay_period_sec_;
+}
+
+double SegmentLoadTracker::GetMeanBandwidth(Clock::time_point now) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (endpoints_.empty()) {
+        return 0;
+    }
+    return Decayed(total_, now) / decay_period_sec_ /
+           static_cast<double>(endpoints_.size());
+}
+
+int SegmentLoadTracker::GetDistance(const std::string& endpoint_a,
+                                    const std::string& endpoint_b) const {
+    const std::string host_a = HostOf(endpoint_a);
+    const std::string host_b = HostOf(endpoint_b);
+    if (!host_a.empty() && host_a == host_b) {
+        return kSameHost;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it_a = racks_.find(host_a);
+    auto it_b = racks_.find(host_b);
+    if (it_a != racks_.end() && it_b != racks_.end() &&
+        it_a->second == it_b->second) {
+        return kSameRack;
+    }
+    return kRemote;
+}
+
+std::string SegmentLoadTracker::HostOf(const std::string& endpoint) {
+    if (!endpoint.empty() && endpoint[0] == '[') {
+        const size_t closing_bracket = endpoint.find(']');
+        if (closing_bracket == std::string::npos) {
+            return endpoint;
+        }
+        return endpoint.substr(1, closing_bracket - 1);
+    }
+    // A bare IPv6 address has several colons and no port
+    const size_t colon_pos = endpoint.find(':');
+    if (colon_pos == std::string::npos ||
+        endpoint.find(':', colon_pos + 1) != std::string::npos) {
+        return endpoint;
+    }
+    return endpoint.substr(0, colon_pos);
+}
+
+}  // namespace mooncake
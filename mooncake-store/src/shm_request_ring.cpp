@@ -0,0 +1,476 @@
+#include "shm_request_ring.h"
+
+#include <glog/logging.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <ctime>
+
+namespace mooncake {
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "the ring needs address-free atomics");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex words must be plain 32-bit integers");
+
+struct alignas(64) ShmRequestRing::Header {
+    uint32_t magic;
+    uint32_t num_slots;
+    uint64_t slot_size;
+    alignas(64) std::atomic<uint64_t> enqueue_pos;
+    alignas(64) std::atomic<uint64_t> dequeue_pos;
+    // Bumped on every submission; servers with nothing to do wait on it
+    alignas(64) std::atomic<uint32_t> doorbell;
+    std::atomic<uint32_t> sleepers;
+};
+
+struct ShmRequestRing::Cell {
+    std::atomic<uint64_t> sequence;
+    uint64_t slot;
+};
+
+// Followed by the payload: one Entry per key, then the key bytes. The
+// server overwrites the payload with one int64_t result per key.
+struct alignas(64) ShmRequestRing::Slot {
+    std::atomic<uint32_t> state;
+    uint32_t op;
+    uint32_t count;
+    uint32_t flags;
+    uint64_t payload_len;
+    uint64_t replica_num;
+    uint64_t stripe_num;
+    uint64_t parity_num;
+};
+
+namespace {
+
+enum SlotState : uint32_t {
+    kSlotFree = 0,
+    kSlotSubmitted = 1,
+    // Submitted, and the submitter sleeps on the state word
+    kSlotWaiting = 2,
+    kSlotDone = 3,
+};
+
+enum SlotFlags : uint32_t {
+    kWithSoftPin = 1,
+    kPreferAllocInSameNode = 2,
+};
+
+struct Entry {
+    uint64_t buffer;
+    uint64_t size;
+    uint32_t key_len;
+    uint32_t reserved;
+};
+
+constexpr size_t kAlignment = 64;
+
+size_t AlignUp(size_t size) {
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+int MemfdCreate(const char *name, unsigned int flags) {
+#ifdef __NR_memfd_create
+    return syscall(__NR_memfd_create, name, flags);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+// The ring is shared between processes, so the futexes are not private
+void FutexWait(std::atomic<uint32_t> *word, uint32_t expected,
+               int timeout_ms) {
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT,
+            expected, &timeout, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t> *word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, count,
+            nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+size_t ShmRequestRing::SegmentSize(uint32_t num_slots, size_t slot_size) {
+    return AlignUp(sizeof(Header)) + AlignUp(num_slots * sizeof(Cell)) +
+           num_slots * slot_size;
+}
+
+ShmRequestRing::ShmRequestRing(int fd, void *base, size_t size,
+                               uint32_t num_slots, size_t slot_size)
+    : fd_(fd),
+      base_(base),
+      size_(size),
+      num_slots_(num_slots),
+      slot_size_(slot_size) {}
+
+ShmRequestRing::~ShmRequestRing() {
+    if (base_ && munmap(base_, size_) != 0) {
+        LOG(ERROR) << "Failed to unmap request ring: " << strerror(errno);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+tl::expected<std::shared_ptr<ShmRequestRing>, ErrorCode>
+ShmRequestRing::Create(uint32_t num_slots, size_t slot_size) {
+    if (num_slots == 0 || (num_slots & (num_slots - 1)) != 0 ||
+        slot_size % kAlignment != 0 ||
+        slot_size < sizeof(Slot) + sizeof(Entry)) {
+        LOG(ERROR) << "Invalid request ring geometry: " << num_slots
+                   << " slots of " << slot_size << " bytes";
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    size_t size = SegmentSize(num_slots, slot_size);
+    int fd = MemfdCreate("mooncake_request_ring", MFD_CLOEXEC);
+    if (fd < 0) {
+        LOG(ERROR) << "Failed to create request ring: " << strerror(errno);
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+    if (ftruncate(fd, size) != 0) {
+        LOG(ERROR) << "Failed to size request ring: " << strerror(errno);
+        close(fd);
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+    void *base =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        LOG(ERROR) << "Failed to map request ring: " << strerror(errno);
+        close(fd);
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+
+    // The segment starts zeroed, which is a valid state for every atomic
+    std::shared_ptr<ShmRequestRing> ring(
+        new ShmRequestRing(fd, base, size, num_slots, slot_size));
+    auto header = ring->header();
+    header->magic = kMagic;
+    header->num_slots = num_slots;
+    header->slot_size = slot_size;
+    for (uint32_t i = 0; i < num_slots; ++i) {
+        ring->cells()[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    ring->free_slots_.reserve(num_slots);
+    for (uint32_t i = num_slots; i > 0; --i) {
+        ring->free_slots_.push_back(i - 1);
+    }
+    return ring;
+}
+
+tl::expected<std::shared_ptr<ShmRequestRing>, ErrorCode>
+ShmRequestRing::Attach(int fd, size_t size) {
+    if (fd < 0 || size < SegmentSize(0, 0)) {
+        LOG(ERROR) << "Invalid request ring: fd " << fd << ", size " << size;
+        if (fd >= 0) close(fd);
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    void *base =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        LOG(ERROR) << "Failed to map request ring: " << strerror(errno);
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+
+    auto header = static_cast<const Header *>(base);
+    uint32_t num_slots = header->num_slots;
+    uint64_t slot_size = header->slot_size;
+    if (header->magic != kMagic || num_slots == 0 ||
+        (num_slots & (num_slots - 1)) != 0 || slot_size % kAlignment != 0 ||
+        slot_size < sizeof(Slot) + sizeof(Entry) ||
+        num_slots > size / slot_size ||
+        SegmentSize(num_slots, slot_size) != size) {
+        LOG(ERROR) << "Malformed request ring of " << size << " bytes";
+        munmap(base, size);
+        return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+    }
+    return std::shared_ptr<ShmRequestRing>(
+        new ShmRequestRing(-1, base, size, num_slots, slot_size));
+}
+
+ShmRequestRing::Header *ShmRequestRing::header() const {
+    return static_cast<Header *>(base_);
+}
+
+ShmRequestRing::Cell *ShmRequestRing::cells() const {
+    return reinterpret_cast<Cell *>(static_cast<char *>(base_) +
+                                    AlignUp(sizeof(Header)));
+}
+
+ShmRequestRing::Slot *ShmRequestRing::slot(uint32_t index) const {
+    return reinterpret_cast<Slot *>(static_cast<char *>(base_) +
+                                    AlignUp(sizeof(Header)) +
+                                    AlignUp(num_slots_ * sizeof(Cell)) +
+                                    index * slot_size_);
+}
+
+size_t ShmRequestRing::PayloadCapacity() const {
+    return slot_size_ - sizeof(Slot);
+}
+
+bool ShmRequestRing::Enqueue(uint32_t index) {
+    auto header = this->header();
+    const uint64_t mask = num_slots_ - 1;
+    uint64_t pos = header->enqueue_pos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+        cell = &cells()[pos & mask];
+        uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence - pos);
+        if (diff == 0) {
+            if (header->enqueue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = header->enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->slot = index;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool ShmRequestRing::Dequeue(uint32_t &index) {
+    auto header = this->header();
+    const uint64_t mask = num_slots_ - 1;
+    uint64_t pos = header->dequeue_pos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+        cell = &cells()[pos & mask];
+        uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence - (pos + 1));
+        if (diff == 0) {
+            if (header->dequeue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = header->dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    uint64_t slot_index = cell->slot;
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    index = slot_index < num_slots_ ? static_cast<uint32_t>(slot_index)
+                                    : num_slots_;
+    return true;
+}
+
+void ShmRequestRing::RingDoorbell() {
+    auto header = this->header();
+    header->doorbell.fetch_add(1);
+    if (header->sleepers.load() > 0) {
+        FutexWake(&header->doorbell, 1);
+    }
+}
+
+bool ShmRequestRing::Fits(const Request &request) const {
+    if (request.keys.size() != request.buffers.size() ||
+        request.keys.size() != request.sizes.size() ||
+        !request.config.preferred_segments.empty() ||
+        !request.config.preferred_segment.empty()) {
+        return false;
+    }
+    size_t length = request.keys.size() * sizeof(Entry);
+    for (const auto &key : request.keys) {
+        length += key.size();
+    }
+    return length <= PayloadCapacity();
+}
+
+void ShmRequestRing::Encode(const Request &request, Slot *slot) const {
+    auto payload = reinterpret_cast<char *>(slot + 1);
+    auto entries = reinterpret_cast<Entry *>(payload);
+    char *key_data = payload + request.keys.size() * sizeof(Entry);
+    for (size_t i = 0; i < request.keys.size(); ++i) {
+        const auto &key = request.keys[i];
+        entries[i] = Entry{request.buffers[i], request.sizes[i],
+                           static_cast<uint32_t>(key.size()), 0};
+        memcpy(key_data, key.data(), key.size());
+        key_data += key.size();
+    }
+    slot->op = static_cast<uint32_t>(request.op);
+    slot->count = static_cast<uint32_t>(request.keys.size());
+    slot->payload_len = key_data - payload;
+    uint32_t flags = 0;
+    if (request.config.with_soft_pin) flags |= kWithSoftPin;
+    if (request.config.prefer_alloc_in_same_node) {
+        flags |= kPreferAllocInSameNode;
+    }
+    slot->flags = flags;
+    slot->replica_num = request.config.replica_num;
+    slot->stripe_num = request.config.stripe_num;
+    slot->parity_num = request.config.parity_num;
+}
+
+bool ShmRequestRing::Decode(const Slot *slot, Request &request) const {
+    // Read every field once, the submitter could still be changing them
+    const uint32_t op = slot->op;
+    const size_t count = slot->count;
+    const size_t payload_len = slot->payload_len;
+    if ((op != static_cast<uint32_t>(Op::BATCH_GET_INTO) &&
+         op != static_cast<uint32_t>(Op::BATCH_PUT_FROM)) ||
+        count == 0 || payload_len > PayloadCapacity() ||
+        count > payload_len / sizeof(Entry)) {
+        return false;
+    }
+    request.op = static_cast<Op>(op);
+    request.config.with_soft_pin = slot->flags & kWithSoftPin;
+    request.config.prefer_alloc_in_same_node =
+        slot->flags & kPreferAllocInSameNode;
+    request.config.replica_num = slot->replica_num;
+    request.config.stripe_num = slot->stripe_num;
+    request.config.parity_num = slot->parity_num;
+
+    auto payload = reinterpret_cast<const char *>(slot + 1);
+    auto entries = reinterpret_cast<const Entry *>(payload);
+    size_t offset = count * sizeof(Entry);
+    request.keys.reserve(count);
+    request.buffers.reserve(count);
+    request.sizes.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Entry entry = entries[i];
+        if (entry.key_len > payload_len - offset) {
+            return false;
+        }
+        request.keys.emplace_back(payload + offset, entry.key_len);
+        request.buffers.push_back(entry.buffer);
+        request.sizes.push_back(entry.size);
+        offset += entry.key_len;
+    }
+    return true;
+}
+
+void ShmRequestRing::Complete(Slot *slot,
+                              const std::vector<int64_t> &results) {
+    size_t count =
+        std::min(results.size(), PayloadCapacity() / sizeof(int64_t));
+    memcpy(reinterpret_cast<char *>(slot + 1), results.data(),
+           count * sizeof(int64_t));
+    slot->count = static_cast<uint32_t>(count);
+    if (slot->state.exchange(kSlotDone, std::memory_order_acq_rel) ==
+        kSlotWaiting) {
+        FutexWake(&slot->state, 1);
+    }
+}
+
+tl::expected<std::vector<int64_t>, ErrorCode> ShmRequestRing::Submit(
+    const Request &request, const std::function<bool()> &alive) {
+    if (request.keys.empty()) {
+        return std::vector<int64_t>();
+    }
+    if (!Fits(request)) {
+        return tl::make_unexpected(ErrorCode::BUFFER_OVERFLOW);
+    }
+    uint32_t index;
+    {
+        std::lock_guard<std::mutex> lock(free_mutex_);
+        if (free_slots_.empty()) {
+            return tl::make_unexpected(ErrorCode::BUFFER_OVERFLOW);
+        }
+        index = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    Slot *slot = this->slot(index);
+    Encode(request, slot);
+    slot->state.store(kSlotSubmitted, std::memory_order_release);
+    // Cannot fail, the queue has room for every slot
+    Enqueue(index);
+    RingDoorbell();
+
+    uint32_t state = slot->state.load(std::memory_order_acquire);
+    while (state != kSlotDone) {
+        if (state == kSlotSubmitted &&
+            !slot->state.compare_exchange_weak(state, kSlotWaiting,
+                                               std::memory_order_acq_rel)) {
+            continue;
+        }
+        FutexWait(&slot->state, kSlotWaiting, kWaitTimeoutMs);
+        state = slot->state.load(std::memory_order_acquire);
+        if (state != kSlotDone && !alive()) {
+            LOG(WARNING) << "Real client went away while serving request "
+                            "slot "
+                         << index;
+            return tl::make_unexpected(ErrorCode::RPC_FAIL);
+        }
+    }
+
+    std::vector<int64_t> results(request.keys.size(),
+                                 toInt(ErrorCode::INTERNAL_ERROR));
+    size_t count = std::min<size_t>(slot->count, results.size());
+    memcpy(results.data(), slot + 1, count * sizeof(int64_t));
+    slot->state.store(kSlotFree, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(free_mutex_);
+        free_slots_.push_back(index);
+    }
+    return results;
+}
+
+void ShmRequestRing::Serve(const Handler &handler) {
+    auto header = this->header();
+    auto last_work = std::chrono::steady_clock::now();
+    while (!stopped_.load(std::memory_order_acquire)) {
+        // Read before looking at the queue, so that a submission racing
+        // with the wait below changes it and the wait returns at once
+        uint32_t doorbell = header->doorbell.load();
+        uint32_t index;
+        if (!Dequeue(index)) {
+            if (std::chrono::steady_clock::now() - last_work <
+                std::chrono::microseconds(kServerSpinUs)) {
+                continue;
+            }
+            header->sleepers.fetch_add(1);
+            FutexWait(&header->doorbell, doorbell, kWaitTimeoutMs);
+            header->sleepers.fetch_sub(1);
+            continue;
+        }
+        if (index >= num_slots_) {
+            LOG(ERROR) << "Dropping malformed request ring entry";
+            continue;
+        }
+
+        Slot *slot = this->slot(index);
+        Request request;
+        std::vector<int64_t> results;
+        if (Decode(slot, request)) {
+            handler(request, results);
+            results.resize(request.keys.size(),
+                           toInt(ErrorCode::INTERNAL_ERROR));
+        } else {
+            LOG(ERROR) << "Malformed request in ring slot " << index;
+            results.assign(std::min<size_t>(slot->count, PayloadCapacity() /
+                                                             sizeof(int64_t)),
+                           toInt(ErrorCode::INVALID_PARAMS));
+        }
+        Complete(slot, results);
+        last_work = std::chrono::steady_clock::now();
+    }
+}
+
+void ShmRequestRing::Stop() {
+    stopped_.store(true, std::memory_order_release);
+    header()->doorbell.fetch_add(1);
+    FutexWake(&header()->doorbell, INT_MAX);
+}
+
+}  // namespace mooncake
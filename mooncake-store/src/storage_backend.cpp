@@ -2,7 +2,9 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <sys/uio.h>
 #include <errno.h>
 #include <cstring>
@@ -13,6 +15,10 @@
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <numeric>
 #include <unordered_set>
 
 #include <ylt/struct_pb.hpp>
@@ -24,11 +30,192 @@
 
 namespace mooncake {
 
+namespace {
+
+// Directory of the pack files of StorageBackendAdaptor, inside its fsdir
+constexpr const char* kPackDirName = "packs";
+
+// Pack files are padded to a multiple of this many bytes
+constexpr size_t kPackAlignment = 4096;
+
+using ScanMetaHandler =
+    std::function<ErrorCode(const std::vector<std::string>& keys,
+                            std::vector<StorageObjectMetadata>& metadatas)>;
+
+// Run fn(0) ... fn(n - 1) on up to threads threads
+void ParallelFor(size_t n, size_t threads,
+                 const std::function<void(size_t)>& fn) {
+    threads = std::min(std::max<size_t>(threads, 1), n);
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) {
+                fn(i);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Bytes a value takes in its bucket file
+int64_t StoredSize(const BucketObjectMetadata& metadata) {
+    return metadata.codec ? metadata.stored_size : metadata.data_size;
+}
+
+StorageObjectMetadata ToStorageObjectMetadata(
+    int64_t bucket_id, const BucketObjectMetadata& metadata) {
+    return StorageObjectMetadata{bucket_id,
+                                 metadata.offset,
+                                 metadata.key_size,
+                                 metadata.data_size,
+                                 "",
+                                 metadata.stored_size,
+                                 static_cast<uint8_t>(metadata.codec)};
+}
+
+int64_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+/**
+ * @brief Runs ScanMeta handler calls on worker threads, so that the scan
+ * of the next batch overlaps with the handler (an RPC to the master) of the
+ * previous ones.
+ *
+ * At most one batch per worker waits in the queue. After a handler error,
+ * queued batches are dropped and Submit and Finish return the error.
+ */
+class ScanMetaPipeline {
+   public:
+    ScanMetaPipeline(const ScanMetaHandler& handler, size_t threads)
+        : handler_(handler) {
+        for (size_t i = 1; i < threads; ++i) {
+            workers_.emplace_back(&ScanMetaPipeline::Worker, this);
+        }
+    }
+
+    ~ScanMetaPipeline() { Finish(); }
+
+    // One thread runs the handler inline, as a plain loop would
+    tl::expected<void, ErrorCode> Submit(
+        std::vector<std::string>&& keys,
+        std::vector<StorageObjectMetadata>&& metadatas) {
+        if (keys.empty()) {
+            return {};
+        }
+        if (workers_.empty()) {
+            auto error_code = handler_(keys, metadatas);
+            if (error_code != ErrorCode::OK) {
+                LOG(ERROR) << "ScanMeta handler failed: " << error_code;
+                return tl::make_unexpected(error_code);
+            }
+            return {};
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_cv_.wait(lock, [this] {
+            return batches_.size() < workers_.size() ||
+                   error_ != ErrorCode::OK;
+        });
+        if (error_ != ErrorCode::OK) {
+            return tl::make_unexpected(error_);
+        }
+        batches_.emplace_back(std::move(keys), std::move(metadatas));
+        lock.unlock();
+        work_cv_.notify_one();
+        return {};
+    }
+
+    // Wait for the submitted batches
+    tl::expected<void, ErrorCode> Finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto& worker : workers_) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        if (error_ != ErrorCode::OK) {
+            return tl::make_unexpected(error_);
+        }
+        return {};
+    }
+
+   private:
+    void Worker() {
+        while (true) {
+            std::pair<std::vector<std::string>,
+                      std::vector<StorageObjectMetadata>>
+                batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_cv_.wait(lock,
+                              [this] { return !batches_.empty() || done_; });
+                if (batches_.empty()) {
+                    return;
+                }
+                batch = std::move(batches_.front());
+                batches_.pop_front();
+                if (error_ != ErrorCode::OK) {
+                    continue;
+                }
+            }
+            space_cv_.notify_one();
+            auto error_code = handler_(batch.first, batch.second);
+            if (error_code != ErrorCode::OK) {
+                LOG(ERROR) << "ScanMeta handler failed: " << error_code;
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error_ == ErrorCode::OK) {
+                    error_ = error_code;
+                }
+                space_cv_.notify_all();
+            }
+        }
+    }
+
+    const ScanMetaHandler& handler_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable space_cv_;
+    std::deque<std::pair<std::vector<std::string>,
+                         std::vector<StorageObjectMetadata>>>
+        batches_;
+    ErrorCode error_ = ErrorCode::OK;
+    bool done_ = false;
+};
+
+}  // namespace
+
 bool FilePerKeyConfig::Validate() const {
     if (fsdir.empty()) {
         LOG(ERROR) << "FilePerKeyConfig: fsdir is invalid";
         return false;
     }
+    if (aggregate_value_size_limit < 0) {
+        LOG(ERROR) << "FilePerKeyConfig: aggregate_value_size_limit must >= 0";
+        return false;
+    }
+    if (aggregate_value_size_limit > 0 &&
+        aggregate_buffer_size < 2 * aggregate_value_size_limit) {
+        LOG(ERROR) << "FilePerKeyConfig: aggregate_buffer_size must be at "
+                      "least twice aggregate_value_size_limit";
+        return false;
+    }
     return true;
 }
 
@@ -41,6 +228,31 @@ bool BucketBackendConfig::Validate() const {
         LOG(ERROR) << "BucketBackendConfig: bucket_size_limit must > 0";
         return false;
     }
+    if (compaction_live_percent < 0 || compaction_live_percent > 100) {
+        LOG(ERROR) << "BucketBackendConfig: compaction_live_percent must be "
+                      "in [0, 100]";
+        return false;
+    }
+    if (compaction_bytes_per_sec < 0) {
+        LOG(ERROR) << "BucketBackendConfig: compaction_bytes_per_sec must >= 0";
+        return false;
+    }
+    if (!IsCompressionCodecAvailable(compression_codec)) {
+        LOG(ERROR) << "BucketBackendConfig: compression codec "
+                   << CompressionCodecName(compression_codec)
+                   << " is not built in";
+        return false;
+    }
+    if (compression_min_size < 0) {
+        LOG(ERROR) << "BucketBackendConfig: compression_min_size must >= 0";
+        return false;
+    }
+    if (compression_min_saving_percent < 0 ||
+        compression_min_saving_percent >= 100) {
+        LOG(ERROR) << "BucketBackendConfig: compression_min_saving_percent "
+                      "must be in [0, 100)";
+        return false;
+    }
     return true;
 }
 
@@ -52,6 +264,18 @@ FilePerKeyConfig FilePerKeyConfig::FromEnvironment() {
     config.enable_eviction =
         GetEnvOr<bool>("ENABLE_EVICTION", config.enable_eviction);
 
+    config.aggregate_value_size_limit =
+        GetEnvOr<int64_t>("MOONCAKE_OFFLOAD_AGGREGATE_VALUE_SIZE_LIMIT_BYTES",
+                          config.aggregate_value_size_limit);
+
+    config.aggregate_buffer_size =
+        GetEnvOr<int64_t>("MOONCAKE_OFFLOAD_AGGREGATE_BUFFER_SIZE_BYTES",
+                          config.aggregate_buffer_size);
+
+    config.aggregate_flush_interval_ms =
+        GetEnvOr<uint32_t>("MOONCAKE_OFFLOAD_AGGREGATE_FLUSH_INTERVAL_MS",
+                           config.aggregate_flush_interval_ms);
+
     return config;
 }
 
@@ -64,12 +288,97 @@ BucketBackendConfig BucketBackendConfig::FromEnvironment() {
     config.bucket_size_limit = GetEnvOr<int64_t>(
         "MOONCAKE_OFFLOAD_BUCKET_SIZE_LIMIT_BYTES", config.bucket_size_limit);
 
+    config.compaction_live_percent =
+        GetEnvOr<int64_t>("MOONCAKE_OFFLOAD_COMPACTION_LIVE_PERCENT",
+                          config.compaction_live_percent);
+
+    config.compaction_interval_seconds =
+        GetEnvOr<uint32_t>("MOONCAKE_OFFLOAD_COMPACTION_INTERVAL_SECONDS",
+                           config.compaction_interval_seconds);
+
+    config.compaction_bytes_per_sec =
+        GetEnvOr<int64_t>("MOONCAKE_OFFLOAD_COMPACTION_BYTES_PER_SEC",
+                          config.compaction_bytes_per_sec);
+
+    auto codec_name = GetEnvStringOr(
+        "MOONCAKE_OFFLOAD_COMPRESSION",
+        CompressionCodecName(config.compression_codec));
+    auto codec = ParseCompressionCodec(codec_name);
+    if (codec) {
+        config.compression_codec = *codec;
+    } else {
+        LOG(ERROR) << "Unknown offload compression codec: " << codec_name;
+    }
+
+    config.compression_level = GetEnvOr<int32_t>(
+        "MOONCAKE_OFFLOAD_COMPRESSION_LEVEL", config.compression_level);
+
+    config.compression_min_size =
+        GetEnvOr<int64_t>("MOONCAKE_OFFLOAD_COMPRESSION_MIN_SIZE_BYTES",
+                          config.compression_min_size);
+
+    config.compression_min_saving_percent =
+        GetEnvOr<int64_t>("MOONCAKE_OFFLOAD_COMPRESSION_MIN_SAVING_PERCENT",
+                          config.compression_min_saving_percent);
+
+    config.compression_threads = std::max<uint32_t>(
+        GetEnvOr<uint32_t>("MOONCAKE_OFFLOAD_COMPRESSION_THREADS",
+                           config.compression_threads),
+        1);
+
+    config.load_threads = std::max<uint32_t>(
+        GetEnvOr<uint32_t>("MOONCAKE_OFFLOAD_LOAD_THREADS",
+                           config.load_threads),
+        1);
+
+    return config;
+}
+
+bool OffsetAllocatorBackendConfig::Validate() const {
+    if (index_log_checkpoint_bytes <= 0) {
+        LOG(ERROR) << "OffsetAllocatorBackendConfig: "
+                      "index_log_checkpoint_bytes must > 0";
+        return false;
+    }
+    if (allocation_alignment & (allocation_alignment - 1)) {
+        LOG(ERROR) << "OffsetAllocatorBackendConfig: "
+                      "allocation_alignment must be a power of two";
+        return false;
+    }
+    if (discard_batch_bytes < 0) {
+        LOG(ERROR) << "OffsetAllocatorBackendConfig: "
+                      "discard_batch_bytes must >= 0";
+        return false;
+    }
+    return true;
+}
+
+OffsetAllocatorBackendConfig OffsetAllocatorBackendConfig::FromEnvironment() {
+    OffsetAllocatorBackendConfig config;
+
+    config.persist_index = GetEnvOr<bool>("MOONCAKE_OFFLOAD_PERSIST_INDEX",
+                                          config.persist_index);
+
+    config.index_log_checkpoint_bytes =
+        GetEnvOr<int64_t>("MOONCAKE_OFFLOAD_INDEX_LOG_CHECKPOINT_BYTES",
+                          config.index_log_checkpoint_bytes);
+
+    config.allocation_alignment =
+        GetEnvOr<uint64_t>("MOONCAKE_OFFLOAD_ALLOCATION_ALIGNMENT",
+                           config.allocation_alignment);
+
+    config.discard_batch_bytes =
+        GetEnvOr<int64_t>("MOONCAKE_OFFLOAD_DISCARD_BATCH_BYTES",
+                          config.discard_batch_bytes);
+
     return config;
 }
 
 StorageBackendInterface::StorageBackendInterface(
     const FileStorageConfig& config)
-    : file_storage_config_(config) {}
+    : file_storage_config_(config),
+      key_filter_(std::max<int64_t>(config.total_keys_limit, 0),
+                  config.key_filter_bits_per_key) {}
 
 std::string StorageBackend::GetActualFsdir() const {
     std::string actual_fsdir = fsdir_;
@@ -462,6 +771,49 @@ tl::expected<void, ErrorCode> StorageBackend::LoadObject(
     return {};
 }
 
+std::vector<tl::expected<void, ErrorCode>> StorageBackend::BatchStoreObjects(
+    const std::vector<std::string>& paths,
+    const std::vector<std::span<const char>>& data) {
+#ifdef USE_3FS
+    // 3FS never evicts, so there is no space to reserve per file
+    if (is_3fs_dir_) {
+        std::vector<std::span<char>> buffers;
+        buffers.reserve(data.size());
+        for (const auto& d : data) {
+            // Only read from by writes
+            buffers.emplace_back(const_cast<char*>(d.data()), d.size());
+        }
+        return Batch3FSIO(paths, buffers, FileMode::Write);
+    }
+#endif
+    std::vector<tl::expected<void, ErrorCode>> results;
+    results.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        results.push_back(StoreObject(paths[i], data[i]));
+    }
+    return results;
+}
+
+std::vector<tl::expected<void, ErrorCode>> StorageBackend::BatchLoadObjects(
+    const std::vector<std::string>& paths, std::vector<std::string>& strs) {
+#ifdef USE_3FS
+    if (is_3fs_dir_) {
+        std::vector<std::span<char>> buffers;
+        buffers.reserve(strs.size());
+        for (auto& str : strs) {
+            buffers.emplace_back(str.data(), str.size());
+        }
+        return Batch3FSIO(paths, buffers, FileMode::Read);
+    }
+#endif
+    std::vector<tl::expected<void, ErrorCode>> results;
+    results.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        results.push_back(LoadObject(paths[i], strs[i], strs[i].size()));
+    }
+    return results;
+}
+
 void StorageBackend::RemoveFile(const std::string& path) {
     namespace fs = std::filesystem;
     // TODO: attention: this function is not thread-safe, need to add lock if
@@ -737,6 +1089,48 @@ tl::expected<size_t, ErrorCode> StorageBackend::WriteDataToFile(
     return file_total_size;
 }
 
+#ifdef USE_3FS
+std::vector<tl::expected<void, ErrorCode>> StorageBackend::Batch3FSIO(
+    const std::vector<std::string>& paths,
+    const std::vector<std::span<char>>& buffers, FileMode mode) {
+    std::vector<tl::expected<void, ErrorCode>> results(paths.size());
+    // Files stay open until all of their pieces are done
+    std::vector<std::unique_ptr<StorageFile>> files;
+    std::vector<Hf3fsBatchEntry> entries;
+    std::vector<size_t> entry_paths;
+    files.reserve(paths.size());
+    entries.reserve(paths.size());
+    entry_paths.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ResolvePath(paths[i]);
+        auto file = create_file(paths[i], mode);
+        if (!file) {
+            LOG(ERROR) << "Failed to open file: " << paths[i];
+            results[i] = tl::make_unexpected(ErrorCode::FILE_OPEN_FAIL);
+            continue;
+        }
+        entries.push_back({static_cast<ThreeFSFile*>(file.get()),
+                           buffers[i].data(), buffers[i].size()});
+        entry_paths.push_back(i);
+        files.push_back(std::move(file));
+    }
+
+    ThreeFSFile::batch_io(resource_manager_.get(), entries,
+                          mode == FileMode::Read);
+
+    for (size_t j = 0; j < entries.size(); ++j) {
+        if (entries[j].result != ErrorCode::OK) {
+            LOG(ERROR) << "Batched 3FS "
+                       << (mode == FileMode::Read ? "read" : "write")
+                       << " failed for: " << paths[entry_paths[j]]
+                       << ", error: " << entries[j].result;
+            results[entry_paths[j]] = tl::make_unexpected(entries[j].result);
+        }
+    }
+    return results;
+}
+#endif
+
 std::unique_ptr<StorageFile> StorageBackend::create_file(
     const std::string& path, FileMode mode) const {
     int flags = O_CLOEXEC;
@@ -925,18 +1319,73 @@ StorageBackendAdaptor::StorageBackendAdaptor(
       total_keys(0),
       total_size(0) {}
 
+StorageBackendAdaptor::~StorageBackendAdaptor() {
+    {
+        std::lock_guard<std::mutex> lock(aggregate_flush_mutex_);
+        aggregate_flush_stop_ = true;
+    }
+    aggregate_flush_cv_.notify_all();
+    if (aggregate_flush_thread_.joinable()) {
+        aggregate_flush_thread_.join();
+    }
+
+    if (storage_backend_ && aggregate_log_.has_value()) {
+        // The owner of the complete handlers may already be gone, so the
+        // written keys are only reported by ScanMeta after a restart
+        MutexLocker lock(&aggregate_mutex_);
+        FlushAggregateLog();
+    }
+}
+
 tl::expected<void, ErrorCode> StorageBackendAdaptor::Init() {
     std::string storage_root =
         file_storage_config_.storage_filepath + file_per_key_config_.fsdir;
 
+#ifdef USE_3FS
+    namespace fs = std::filesystem;
+    const fs::path root_path(file_storage_config_.storage_filepath);
+    const bool is_3fs_dir = fs::exists(root_path / "3fs-virt") &&
+                            fs::is_directory(root_path / "3fs-virt");
+    storage_backend_ = std::make_unique<StorageBackend>(
+        file_storage_config_.storage_filepath, file_per_key_config_.fsdir,
+        is_3fs_dir, file_per_key_config_.enable_eviction);
+#else
     storage_backend_ = std::make_unique<StorageBackend>(
         file_storage_config_.storage_filepath, file_per_key_config_.fsdir,
         file_per_key_config_.enable_eviction);
+#endif
     auto init_result = storage_backend_->Init();
     if (!init_result) {
         LOG(ERROR) << "Failed to init storage backend";
         return init_result;
     }
+
+    if (file_per_key_config_.aggregate_value_size_limit > 0 &&
+        !aggregate_log_.has_value()) {
+        const auto buffer_size =
+            static_cast<size_t>(file_per_key_config_.aggregate_buffer_size);
+        try {
+            aggregate_allocator_ = ClientBufferAllocator::create(buffer_size);
+        } catch (const std::bad_alloc&) {
+            LOG(ERROR) << "Failed to allocate aggregation log of "
+                       << buffer_size << " bytes";
+            return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+        }
+        aggregate_log_ = aggregate_allocator_->allocate(buffer_size);
+        if (!aggregate_log_.has_value()) {
+            LOG(ERROR) << "Failed to allocate aggregation log of "
+                       << buffer_size << " bytes";
+            return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+        }
+        if (file_per_key_config_.aggregate_flush_interval_ms > 0) {
+            aggregate_flush_thread_ = std::thread(
+                &StorageBackendAdaptor::AggregateFlushThread, this);
+        }
+        LOG(INFO) << "Aggregating values of at most "
+                  << file_per_key_config_.aggregate_value_size_limit
+                  << " bytes into pack files of up to " << buffer_size
+                  << " bytes";
+    }
     return {};
 }
 
@@ -976,6 +1425,138 @@ std::string StorageBackendAdaptor::ResolvePath(const std::string& key) const {
     return full_path.lexically_normal().string();
 }
 
+std::string StorageBackendAdaptor::PackPath(int64_t pack_id) const {
+    namespace fs = std::filesystem;
+    fs::path full_path = fs::path(file_storage_config_.storage_filepath) /
+                         file_per_key_config_.fsdir / kPackDirName /
+                         (std::to_string(pack_id) + ".pack");
+    return full_path.lexically_normal().string();
+}
+
+void StorageBackendAdaptor::AppendToAggregateLog(
+    const std::string& key, const std::string& kv_buf, int64_t value_size,
+    uint64_t batch_id, const CompleteHandler& complete_handler,
+    std::vector<PendingBatch>& flushed) {
+    const auto capacity = static_cast<int64_t>(aggregate_log_->size());
+    const auto record_size =
+        static_cast<int64_t>(sizeof(uint64_t) + kv_buf.size());
+    if (aggregate_log_used_ + record_size > capacity) {
+        auto batches = FlushAggregateLog();
+        std::move(batches.begin(), batches.end(), std::back_inserter(flushed));
+    }
+    if (aggregate_log_used_ == 0) {
+        aggregate_log_start_ = std::chrono::steady_clock::now();
+    }
+
+    char* log = static_cast<char*>(aggregate_log_->ptr());
+    const uint64_t length = kv_buf.size();
+    const int64_t offset = aggregate_log_used_ + sizeof(length);
+    std::memcpy(log + aggregate_log_used_, &length, sizeof(length));
+    std::memcpy(log + offset, kv_buf.data(), kv_buf.size());
+    pending_records_.push_back(
+        PendingRecord{key, offset, static_cast<int64_t>(kv_buf.size())});
+    aggregate_log_used_ += record_size;
+
+    if (pending_batches_.empty() ||
+        pending_batches_.back().batch_id != batch_id) {
+        pending_batches_.push_back(PendingBatch{batch_id, complete_handler});
+    }
+    pending_batches_.back().keys.push_back(key);
+    pending_batches_.back().metadatas.emplace_back(StorageObjectMetadata{
+        -1, 0, static_cast<int64_t>(key.size()), value_size, ""});
+}
+
+std::vector<StorageBackendAdaptor::PendingBatch>
+StorageBackendAdaptor::FlushAggregateLog() {
+    std::vector<PendingBatch> flushed;
+    if (aggregate_log_used_ == 0) {
+        return flushed;
+    }
+
+    // The zero padding also ends the records of the pack
+    char* log = static_cast<char*>(aggregate_log_->ptr());
+    const auto size = std::min(
+        align_up(static_cast<size_t>(aggregate_log_used_), kPackAlignment),
+        aggregate_log_->size());
+    std::memset(log + aggregate_log_used_, 0, size - aggregate_log_used_);
+
+    const int64_t pack_id = pack_id_generator_.NextId();
+    auto store_result = storage_backend_->StoreObject(
+        PackPath(pack_id), std::span<const char>(log, size));
+    if (!store_result) {
+        LOG(ERROR) << "Failed to write pack file " << PackPath(pack_id)
+                   << ", error: " << store_result.error() << " - dropping "
+                   << pending_records_.size() << " keys";
+    } else {
+        MutexLocker lock(&mutex_);
+        for (const auto& record : pending_records_) {
+            packed_entries_[record.key] =
+                PackedEntry{pack_id, record.offset, record.size};
+            total_keys++;
+            total_size += record.size;
+            key_filter_.Insert(record.key);
+        }
+        flushed = std::move(pending_batches_);
+    }
+
+    pending_records_.clear();
+    pending_batches_.clear();
+    aggregate_log_used_ = 0;
+    return flushed;
+}
+
+void StorageBackendAdaptor::NotifyPackedBatches(
+    std::vector<PendingBatch>& batches) {
+    for (auto& batch : batches) {
+        if (batch.complete_handler == nullptr || batch.keys.empty()) {
+            continue;
+        }
+        auto error_code = batch.complete_handler(batch.keys, batch.metadatas);
+        if (error_code != ErrorCode::OK) {
+            LOG(ERROR) << "Complete handler failed: " << error_code << " - "
+                       << batch.keys.size()
+                       << " keys were written to a pack file but master was "
+                          "not notified. Master will learn about them via "
+                          "ScanMeta on next restart.";
+        }
+    }
+}
+
+void StorageBackendAdaptor::AggregateFlushThread() {
+    const auto interval = std::chrono::milliseconds(
+        file_per_key_config_.aggregate_flush_interval_ms);
+    auto wait = interval;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(aggregate_flush_mutex_);
+            if (aggregate_flush_cv_.wait_for(
+                    lock, wait, [this] { return aggregate_flush_stop_; })) {
+                return;
+            }
+        }
+
+        std::vector<PendingBatch> flushed;
+        wait = interval;
+        {
+            MutexLocker lock(&aggregate_mutex_);
+            if (aggregate_log_used_ > 0) {
+                auto age = std::chrono::steady_clock::now() -
+                           aggregate_log_start_;
+                if (age >= interval) {
+                    flushed = FlushAggregateLog();
+                } else {
+                    // Wake up right after the oldest value reaches the interval
+                    using std::chrono::milliseconds;
+                    wait = std::chrono::duration_cast<milliseconds>(
+                               interval - age) +
+                           milliseconds(1);
+                }
+            }
+        }
+        NotifyPackedBatches(flushed);
+    }
+}
+
 std::string StorageBackendAdaptor::ConcatSlicesToString(
     const std::vector<Slice>& slices) {
     size_t total = 0;
@@ -1013,12 +1594,22 @@ tl::expected<int64_t, ErrorCode> StorageBackendAdaptor::BatchOffload(
     metadatas.reserve(batch_object.size());
     keys.reserve(batch_object.size());
 
-    // Process each key; continue on individual failures to support partial
-    // success
+    // Encode every key first so that all files are written as one batch
+    std::vector<std::string> entry_keys;
+    std::vector<int64_t> value_sizes;
+    std::vector<std::string> paths;
+    std::vector<std::string> kv_bufs;
+    entry_keys.reserve(batch_object.size());
+    value_sizes.reserve(batch_object.size());
+    paths.reserve(batch_object.size());
+    kv_bufs.reserve(batch_object.size());
+    // Small objects are copied into the aggregation log instead
+    std::vector<std::string> aggregated_keys;
+    std::vector<int64_t> aggregated_value_sizes;
+    std::vector<std::string> aggregated_kv_bufs;
     for (auto& object : batch_object) {
         KVEntry kv;
         kv.key = object.first;
-        auto value = object.second;
 
         // Test-only: Check if this key should fail (deterministic failure
         // injection)
@@ -1028,30 +1619,68 @@ tl::expected<int64_t, ErrorCode> StorageBackendAdaptor::BatchOffload(
             continue;  // Simulate StoreObject failure
         }
 
-        auto path = ResolvePath(kv.key);
-        kv.value = ConcatSlicesToString(value);
+        kv.value = ConcatSlicesToString(object.second);
 
         std::string kv_buf;
         struct_pb::to_pb(kv, kv_buf);
-        auto store_result = storage_backend_->StoreObject(path, kv_buf);
-        if (!store_result) {
-            LOG(ERROR) << "Failed to store object for key: " << kv.key
-                       << ", error: " << store_result.error()
+        const auto value_size = static_cast<int64_t>(kv.value.size());
+        if (aggregate_log_.has_value() &&
+            value_size <= file_per_key_config_.aggregate_value_size_limit &&
+            sizeof(uint64_t) + kv_buf.size() <= aggregate_log_->size()) {
+            aggregated_keys.push_back(std::move(kv.key));
+            aggregated_value_sizes.push_back(value_size);
+            aggregated_kv_bufs.push_back(std::move(kv_buf));
+            continue;
+        }
+        paths.push_back(ResolvePath(kv.key));
+        kv_bufs.push_back(std::move(kv_buf));
+        value_sizes.push_back(value_size);
+        entry_keys.push_back(std::move(kv.key));
+    }
+
+    std::vector<std::span<const char>> data;
+    data.reserve(kv_bufs.size());
+    for (const auto& kv_buf : kv_bufs) {
+        data.emplace_back(kv_buf.data(), kv_buf.size());
+    }
+    auto store_results = storage_backend_->BatchStoreObjects(paths, data);
+
+    // Continue on individual failures to support partial success
+    for (size_t i = 0; i < entry_keys.size(); ++i) {
+        const auto& key = entry_keys[i];
+        if (!store_results[i]) {
+            LOG(ERROR) << "Failed to store object for key: " << key
+                       << ", error: " << store_results[i].error()
                        << " - continuing with remaining keys";
             continue;  // Continue processing other keys
         }
 
+        key_filter_.Insert(key);
         {
             MutexLocker lock(&mutex_);
             total_keys++;
-            total_size += kv_buf.size();
+            total_size += kv_bufs[i].size();
+            packed_entries_.erase(key);
         }
 
-        metadatas.emplace_back(
-            StorageObjectMetadata{-1, 0, static_cast<int64_t>(kv.key.size()),
-                                  static_cast<int64_t>(kv.value.size()), ""});
-        keys.emplace_back(kv.key);
+        metadatas.emplace_back(StorageObjectMetadata{
+            -1, 0, static_cast<int64_t>(key.size()), value_sizes[i], ""});
+        keys.emplace_back(key);
+    }
+
+    // complete_handler of aggregated keys is called once their pack file is
+    // written, which may include the keys of earlier calls
+    std::vector<PendingBatch> flushed;
+    if (!aggregated_keys.empty()) {
+        MutexLocker lock(&aggregate_mutex_);
+        const uint64_t batch_id = next_batch_id_++;
+        for (size_t i = 0; i < aggregated_keys.size(); ++i) {
+            AppendToAggregateLog(aggregated_keys[i], aggregated_kv_bufs[i],
+                                 aggregated_value_sizes[i], batch_id,
+                                 complete_handler, flushed);
+        }
     }
+    NotifyPackedBatches(flushed);
 
     // Only report successful keys to master
     if (complete_handler != nullptr && !keys.empty()) {
@@ -1067,38 +1696,104 @@ tl::expected<int64_t, ErrorCode> StorageBackendAdaptor::BatchOffload(
         }
     }
 
-    return static_cast<int64_t>(keys.size());
+    return static_cast<int64_t>(keys.size() + aggregated_keys.size());
 }
 
 tl::expected<bool, ErrorCode> StorageBackendAdaptor::IsExist(
     const std::string& key) {
-    auto path = ResolvePath(key);
+    // Files of a previous run are only in the filter after ScanMeta
+    if (meta_scanned_.load(std::memory_order_acquire) &&
+        !key_filter_.MayContain(key)) {
+        return false;
+    }
     namespace fs = std::filesystem;
+    {
+        MutexLocker lock(&mutex_);
+        auto it = packed_entries_.find(key);
+        if (it != packed_entries_.end()) {
+            // The whole pack may have been evicted
+            return fs::exists(PackPath(it->second.pack_id));
+        }
+    }
+    auto path = ResolvePath(key);
     return fs::exists(path);
 }
 
 tl::expected<void, ErrorCode> StorageBackendAdaptor::BatchLoad(
     const std::unordered_map<std::string, Slice>& batched_slices) {
-    for (const auto& [key, slice] : batched_slices) {
+    std::vector<std::pair<PackedEntry, Slice>> packed_loads;
+    std::vector<std::pair<const std::string*, Slice>> file_loads;
+    {
+        MutexLocker lock(&mutex_);
+        for (const auto& [key, slice] : batched_slices) {
+            auto it = packed_entries_.find(key);
+            if (it != packed_entries_.end()) {
+                packed_loads.emplace_back(it->second, slice);
+            } else {
+                file_loads.emplace_back(&key, slice);
+            }
+        }
+    }
+
+    for (const auto& [entry, slice] : packed_loads) {
+        // Read only the record of the key from its pack file
+        std::string kv_buf(entry.size, '\0');
+        std::vector<Slice> pack_slices{
+            {nullptr, static_cast<size_t>(entry.offset)},
+            {kv_buf.data(), kv_buf.size()}};
+        auto load_result = storage_backend_->LoadObject(
+            PackPath(entry.pack_id), pack_slices, entry.offset + entry.size);
+        if (!load_result) {
+            LOG(ERROR) << "Failed to load from pack file";
+            return tl::make_unexpected(load_result.error());
+        }
+
+        KVEntry kv;
+        struct_pb::from_pb(kv, kv_buf);
+        if (kv.value.size() != slice.size) {
+            LOG(ERROR) << "Size mismatch of packed key: " << kv.key
+                       << ", expected: " << slice.size
+                       << ", got: " << kv.value.size();
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        if (!kv.value.empty()) {
+            std::memcpy(slice.ptr, kv.value.data(), kv.value.size());
+        }
+    }
+
+    std::vector<std::string> paths;
+    std::vector<std::string> kv_bufs;
+    std::vector<Slice> slices;
+    paths.reserve(file_loads.size());
+    kv_bufs.reserve(file_loads.size());
+    slices.reserve(file_loads.size());
+    for (const auto& [key_ptr, slice] : file_loads) {
+        const std::string& key = *key_ptr;
         KVEntry kv;
         kv.key = key;
-        auto path = ResolvePath(kv.key);
+        paths.push_back(ResolvePath(kv.key));
 
+        // Sizes the buffer to the encoded length of the stored entry
         kv.value.resize(slice.size);
 
         std::string kv_buf;
         struct_pb::to_pb(kv, kv_buf);
+        kv_bufs.push_back(std::move(kv_buf));
+        slices.push_back(slice);
+    }
 
-        auto r = storage_backend_->LoadObject(path, kv_buf, kv_buf.size());
-        if (!r) {
+    auto load_results = storage_backend_->BatchLoadObjects(paths, kv_bufs);
+    for (size_t i = 0; i < load_results.size(); ++i) {
+        if (!load_results[i]) {
             LOG(ERROR) << "Failed to load from file";
-            return tl::make_unexpected(r.error());
+            return tl::make_unexpected(load_results[i].error());
         }
 
-        struct_pb::from_pb(kv, kv_buf);
+        KVEntry kv;
+        struct_pb::from_pb(kv, kv_bufs[i]);
 
         if (!kv.value.empty()) {
-            std::memcpy(slice.ptr, kv.value.data(), kv.value.size());
+            std::memcpy(slices[i].ptr, kv.value.data(), kv.value.size());
         }
     }
     return {};
@@ -1148,6 +1843,18 @@ tl::expected<void, ErrorCode> StorageBackendAdaptor::ScanMeta(
         return {};
     };
 
+    auto add_key = [&](std::string&& key,
+                       int64_t value_size) -> tl::expected<void, ErrorCode> {
+        keys.emplace_back(std::move(key));
+        metas.emplace_back(StorageObjectMetadata{
+            -1, 0, (int64_t)keys.back().size(), value_size, ""});
+        if ((int64_t)keys.size() >=
+            file_storage_config_.scanmeta_iterator_keys_limit) {
+            return flush();
+        }
+        return {};
+    };
+
     MutexLocker lock(&mutex_);
 
     std::error_code ec_root;
@@ -1188,6 +1895,7 @@ tl::expected<void, ErrorCode> StorageBackendAdaptor::ScanMeta(
                 total_keys++;
                 total_size += buf.size();
 
+                key_filter_.Insert(kv.key);
                 keys.emplace_back(std::move(kv.key));
                 metas.emplace_back(StorageObjectMetadata{
                     -1, 0, (int64_t)keys.back().size(),
@@ -1205,10 +1913,91 @@ tl::expected<void, ErrorCode> StorageBackendAdaptor::ScanMeta(
         }
     }
 
+    auto pr = ScanPacks(add_key);
+    if (!pr) return pr;
+    auto fr = flush();
+    if (!fr) return fr;
+
     meta_scanned_.store(true, std::memory_order_acquire);
     return {};
 }
 
+tl::expected<void, ErrorCode> StorageBackendAdaptor::ScanPacks(
+    const std::function<tl::expected<void, ErrorCode>(
+        std::string&& key, int64_t value_size)>& add_key) {
+    namespace fs = std::filesystem;
+
+    fs::path pack_dir = fs::path(file_storage_config_.storage_filepath) /
+                        file_per_key_config_.fsdir / kPackDirName;
+    std::error_code ec;
+    if (!fs::is_directory(pack_dir, ec)) {
+        return {};
+    }
+
+    // Pack ids grow with time, so later packs hold the latest copy of a key
+    std::vector<std::pair<int64_t, fs::path>> packs;
+    for (auto it = fs::directory_iterator(pack_dir, ec);
+         !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        const auto& p = it->path();
+        if (p.extension() != ".pack" || !it->is_regular_file(ec) || ec) {
+            continue;
+        }
+        try {
+            packs.emplace_back(std::stoll(p.stem().string()), p);
+        } catch (const std::exception&) {
+            LOG(WARNING) << "Skipping unexpected file in pack directory: "
+                         << p;
+        }
+    }
+    std::sort(packs.begin(), packs.end());
+
+    std::unordered_map<std::string, int64_t> value_sizes;
+    for (const auto& [pack_id, path] : packs) {
+        uintmax_t sz = fs::file_size(path, ec);
+        if (ec) continue;
+
+        std::string buf;
+        auto r = storage_backend_->LoadObject(path.string(), buf, (int64_t)sz);
+        if (!r) {
+            LOG(WARNING) << "Failed to load pack file: " << path;
+            continue;
+        }
+
+        size_t pos = 0;
+        while (pos + sizeof(uint64_t) <= buf.size()) {
+            uint64_t length;
+            std::memcpy(&length, buf.data() + pos, sizeof(length));
+            if (length == 0) break;
+            pos += sizeof(length);
+            if (length > buf.size() - pos) {
+                LOG(WARNING) << "Truncated record in pack file: " << path;
+                break;
+            }
+
+            KVEntry kv;
+            struct_pb::from_pb(kv, buf.substr(pos, length));
+            total_size += length;
+            packed_entries_[kv.key] = PackedEntry{
+                pack_id, static_cast<int64_t>(pos), (int64_t)length};
+            value_sizes[kv.key] = static_cast<int64_t>(kv.value.size());
+            pos += length;
+        }
+    }
+
+    for (const auto& [key, value_size] : value_sizes) {
+        // Keys also stored as their own file were reported by the walk
+        if (fs::exists(ResolvePath(key), ec)) {
+            packed_entries_.erase(key);
+            continue;
+        }
+        total_keys++;
+        key_filter_.Insert(key);
+        auto r = add_key(std::string(key), value_size);
+        if (!r) return r;
+    }
+    return {};
+}
+
 BucketIdGenerator::BucketIdGenerator(int64_t start) {
     if (start <= 0) {
         auto cur_time_stamp = time_gen();
@@ -1233,6 +2022,17 @@ BucketStorageBackend::BucketStorageBackend(
       storage_path_(file_storage_config_.storage_filepath),
       bucket_backend_config_(bucket_backend_config_) {}
 
+BucketStorageBackend::~BucketStorageBackend() {
+    {
+        std::lock_guard<std::mutex> lock(compaction_mutex_);
+        compaction_stop_ = true;
+    }
+    compaction_cv_.notify_all();
+    if (compaction_thread_.joinable()) {
+        compaction_thread_.join();
+    }
+}
+
 tl::expected<int64_t, ErrorCode> BucketStorageBackend::BatchOffload(
     const std::unordered_map<std::string, std::vector<Slice>>& batch_object,
     std::function<ErrorCode(const std::vector<std::string>& keys,
@@ -1255,11 +2055,13 @@ tl::expected<int64_t, ErrorCode> BucketStorageBackend::BatchOffload(
     if (!enable_offloading_res.value()) {
         return tl::make_unexpected(ErrorCode::KEYS_ULTRA_LIMIT);
     }
+    std::vector<std::unique_ptr<char[]>> compressed_buffers;
+    auto stored_batch = CompressBatch(batch_object, compressed_buffers);
     auto bucket_id = bucket_id_generator_->NextId();
     std::vector<iovec> iovs;
     std::vector<StorageObjectMetadata> metadatas;
     auto build_bucket_result =
-        BuildBucket(bucket_id, batch_object, iovs, metadatas);
+        BuildBucket(bucket_id, stored_batch, iovs, metadatas);
     if (!build_bucket_result) {
         LOG(ERROR) << "Failed to build bucket with id: " << bucket_id;
         return tl::make_unexpected(build_bucket_result.error());
@@ -1301,6 +2103,7 @@ tl::expected<int64_t, ErrorCode> BucketStorageBackend::BatchOffload(
     total_size_ += bucket->data_size + bucket->meta_size;
     object_bucket_map_.reserve(object_bucket_map_.size() + bucket->keys.size());
     for (size_t i = 0; i < bucket->keys.size(); ++i) {
+        key_filter_.Insert(bucket->keys[i]);
         // Use insert instead of emplace to be explicit about not overwriting
         auto [it, inserted] = object_bucket_map_.insert(
             {bucket->keys[i], std::move(metadatas[i])});
@@ -1342,6 +2145,9 @@ tl::expected<void, ErrorCode> BucketStorageBackend::BatchLoad(
         int64_t key_size;
         int64_t data_size;
         Slice dest_slice;
+        int64_t stored_size;
+        CompressionCodec codec;
+        iovec read_iov{};  // Where the stored bytes of the value go
     };
 
     // Group by bucket for efficient file access
@@ -1384,17 +2190,45 @@ tl::expected<void, ErrorCode> BucketStorageBackend::BatchLoad(
             }
 
             // Copy metadata into read plan
-            bucket_read_plans[metadata.bucket_id].push_back(
-                ReadPlan{key, metadata.bucket_id, metadata.offset,
-                         metadata.key_size, metadata.data_size, dest_slice});
+            bucket_read_plans[metadata.bucket_id].push_back(ReadPlan{
+                key, metadata.bucket_id, metadata.offset, metadata.key_size,
+                metadata.data_size, dest_slice, metadata.stored_size,
+                static_cast<CompressionCodec>(metadata.codec)});
         }
     }
     // Lock released here - bucket files protected by BucketReadGuards
     // which remain alive until this function returns (~line bucket_guards
     // destructor), keeping inflight_reads_ > 0 throughout the I/O phase.
 
-    // Step 2: Perform IO without holding any locks
+    // Step 2: Perform IO without holding any locks, one bucket file per
+    // thread. Compressed values are read into staging buffers and
+    // decompressed in step 3.
+    std::vector<std::pair<const ReadPlan*, std::unique_ptr<char[]>>>
+        compressed_reads;
+    std::vector<std::pair<int64_t, std::vector<ReadPlan>*>> buckets;
+    buckets.reserve(bucket_read_plans.size());
     for (auto& [bucket_id, read_plans] : bucket_read_plans) {
+        std::sort(read_plans.begin(), read_plans.end(),
+                  [](const ReadPlan& a, const ReadPlan& b) {
+                      return a.offset < b.offset;
+                  });
+        for (auto& plan : read_plans) {
+            plan.read_iov = iovec{plan.dest_slice.ptr, plan.dest_slice.size};
+            if (plan.codec != CompressionCodec::kNone) {
+                compressed_reads.emplace_back(
+                    &plan, std::unique_ptr<char[]>(new char[plan.stored_size]));
+                plan.read_iov = iovec{compressed_reads.back().second.get(),
+                                      static_cast<size_t>(plan.stored_size)};
+            }
+        }
+        buckets.emplace_back(bucket_id, &read_plans);
+    }
+
+    // Values stored back to back, with only their keys between them, are
+    // read by a single preadv that drops the keys into a scratch buffer
+    auto read_bucket = [this](int64_t bucket_id,
+                              const std::vector<ReadPlan>& read_plans)
+        -> tl::expected<void, ErrorCode> {
         // Open file for this bucket (cheap syscall, no lock needed)
         auto filepath_res = GetBucketDataPath(bucket_id);
         if (!filepath_res) {
@@ -1402,7 +2236,6 @@ tl::expected<void, ErrorCode> BucketStorageBackend::BatchLoad(
                        << bucket_id;
             return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
         }
-
         auto file_res = OpenFile(filepath_res.value(), FileMode::Read);
         if (!file_res) {
             LOG(ERROR) << "Failed to open bucket file: "
@@ -1411,27 +2244,89 @@ tl::expected<void, ErrorCode> BucketStorageBackend::BatchLoad(
         }
         auto& file = file_res.value();
 
-        // Read each key's data
+        int64_t max_key_size = 0;
         for (const auto& plan : read_plans) {
-            // Read value (skip key in file: offset + key_size)
-            iovec iov{plan.dest_slice.ptr, plan.dest_slice.size};
-            auto read_res =
-                file->vector_read(&iov, 1, plan.offset + plan.key_size);
-
+            max_key_size = std::max(max_key_size, plan.key_size);
+        }
+        std::vector<char> key_scratch(max_key_size);
+        std::vector<iovec> iovs;
+        for (size_t first = 0, last = 0; first < read_plans.size();
+             first = last) {
+            // Value first and the ones right after it
+            const int64_t offset =
+                read_plans[first].offset + read_plans[first].key_size;
+            int64_t end = offset;
+            iovs.clear();
+            for (last = first; last < read_plans.size(); ++last) {
+                const auto& plan = read_plans[last];
+                if (last > first) {
+                    if (plan.offset != end) break;
+                    if (plan.key_size > 0) {
+                        iovs.push_back(iovec{key_scratch.data(),
+                                             static_cast<size_t>(
+                                                 plan.key_size)});
+                    }
+                    end += plan.key_size;
+                }
+                iovs.push_back(plan.read_iov);
+                end += plan.read_iov.iov_len;
+            }
+            auto read_res = file->vector_read(
+                iovs.data(), static_cast<int>(iovs.size()), offset);
             if (!read_res) {
-                LOG(ERROR) << "vector_read failed for key: " << plan.key
-                           << ", bucket_id=" << plan.bucket_id
+                LOG(ERROR) << "vector_read failed for key: "
+                           << read_plans[first].key
+                           << ", bucket_id=" << bucket_id
+                           << ", values=" << last - first
                            << ", error: " << read_res.error();
                 return tl::make_unexpected(read_res.error());
             }
-
-            if (read_res.value() != plan.dest_slice.size) {
-                LOG(ERROR) << "Read size mismatch for key: " << plan.key
-                           << ", expected: " << plan.dest_slice.size
+            if (static_cast<int64_t>(read_res.value()) != end - offset) {
+                LOG(ERROR) << "Read size mismatch for key: "
+                           << read_plans[first].key
+                           << ", values=" << last - first
+                           << ", expected: " << end - offset
                            << ", got: " << read_res.value();
                 return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
             }
         }
+        return {};
+    };
+
+    std::vector<ErrorCode> read_errors(buckets.size(), ErrorCode::OK);
+    ParallelFor(buckets.size(), bucket_backend_config_.load_threads,
+                [&](size_t i) {
+                    auto result =
+                        read_bucket(buckets[i].first, *buckets[i].second);
+                    if (!result) {
+                        read_errors[i] = result.error();
+                    }
+                });
+    for (ErrorCode error : read_errors) {
+        if (error != ErrorCode::OK) {
+            return tl::make_unexpected(error);
+        }
+    }
+
+    // Step 3: Decompress into the destination slices
+    std::atomic<bool> decompress_failed{false};
+    ParallelFor(
+        compressed_reads.size(), bucket_backend_config_.compression_threads,
+        [&](size_t i) {
+            const auto& [plan, buffer] = compressed_reads[i];
+            const auto start = std::chrono::steady_clock::now();
+            if (!Decompress(plan->codec, buffer.get(), plan->stored_size,
+                            plan->dest_slice.ptr, plan->dest_slice.size)) {
+                LOG(ERROR) << "Failed to decompress key: " << plan->key
+                           << ", bucket_id=" << plan->bucket_id
+                           << ", codec=" << CompressionCodecName(plan->codec);
+                decompress_failed.store(true, std::memory_order_relaxed);
+            }
+            decompress_time_us_.fetch_add(MicrosecondsSince(start),
+                                          std::memory_order_relaxed);
+        });
+    if (decompress_failed.load(std::memory_order_relaxed)) {
+        return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
     }
 
     // bucket_guards go out of scope here, decrementing inflight_reads_
@@ -1461,8 +2356,10 @@ tl::expected<void, ErrorCode> BucketStorageBackend::Init() {
         SharedMutexLocker lock(&mutex_);
         object_bucket_map_.clear();
         buckets_.clear();
+        key_filter_.Clear();
         total_size_ = 0;
         int64_t max_bucket_id = BucketIdGenerator::INIT_NEW_START_ID;
+        std::vector<int64_t> bucket_ids;
         for (const auto& entry :
              fs::recursive_directory_iterator(storage_path_)) {
             if (entry.is_regular_file() &&
@@ -1476,76 +2373,95 @@ tl::expected<void, ErrorCode> BucketStorageBackend::Init() {
                     return tl::make_unexpected(
                         ErrorCode::BUCKET_ALREADY_EXISTS);
                 }
-                auto load_bucket_metadata_result =
-                    LoadBucketMetadata(bucket_id, metadata_it->second);
-                if (!load_bucket_metadata_result) {
-                    LOG(ERROR)
-                        << "Failed to load metadata for bucket: "
-                        << bucket_id_str
-                        << ", will delete the bucket's data and metadata";
-
-                    auto bucket_data_path_res = GetBucketDataPath(bucket_id);
-                    if (bucket_data_path_res) {
-                        fs::remove(bucket_data_path_res.value());
-                    }
+                bucket_ids.push_back(bucket_id);
+            }
+        }
 
-                    auto bucket_meta_path_res =
-                        GetBucketMetadataPath(bucket_id);
-                    if (bucket_meta_path_res) {
-                        fs::remove(bucket_meta_path_res.value());
-                    }
+        // Each metadata file is read whole by one thread; the results are
+        // validated and indexed below in directory order
+        std::vector<std::shared_ptr<BucketMetadata>> loaded_metadatas;
+        loaded_metadatas.reserve(bucket_ids.size());
+        for (auto bucket_id : bucket_ids) {
+            loaded_metadatas.push_back(buckets_[bucket_id]);
+        }
+        std::vector<char> load_failed(bucket_ids.size(), 0);
+        ParallelFor(bucket_ids.size(), file_storage_config_.scanmeta_threads,
+                    [&](size_t i) {
+                        load_failed[i] = !LoadBucketMetadata(
+                            bucket_ids[i], loaded_metadatas[i]);
+                    });
+
+        for (size_t bucket_index = 0; bucket_index < bucket_ids.size();
+             ++bucket_index) {
+            const int64_t bucket_id = bucket_ids[bucket_index];
+            const auto bucket_id_str = std::to_string(bucket_id);
+            auto metadata_it = buckets_.find(bucket_id);
+            if (load_failed[bucket_index]) {
+                LOG(ERROR)
+                    << "Failed to load metadata for bucket: "
+                    << bucket_id_str
+                    << ", will delete the bucket's data and metadata";
 
-                    buckets_.erase(bucket_id);
-                    continue;
+                auto bucket_data_path_res = GetBucketDataPath(bucket_id);
+                if (bucket_data_path_res) {
+                    fs::remove(bucket_data_path_res.value());
                 }
-                auto& meta = *(metadata_it->second);
-                if (meta.data_size == 0 || meta.meta_size == 0 ||
-                    meta.metadatas.empty() || meta.keys.empty()) {
-                    LOG(ERROR) << "Metadata validation failed for bucket: "
-                               << bucket_id_str
-                               << ", will delete the bucket's data and "
-                                  "metadata. Detailed values:";
-                    LOG(ERROR) << "  data_size: " << meta.data_size
-                               << " (should not be 0)";
-                    LOG(ERROR) << "  meta_size: " << meta.meta_size
-                               << " (should not be 0)";
-                    LOG(ERROR)
-                        << "  object_metadata.size(): " << meta.metadatas.size()
-                        << " (empty: "
-                        << (meta.metadatas.empty() ? "true" : "false") << ")";
-
-                    LOG(ERROR)
-                        << "  keys.size(): " << meta.keys.size()
-                        << " (empty: " << (meta.keys.empty() ? "true" : "false")
-                        << ")";
-                    auto bucket_data_path_res = GetBucketDataPath(bucket_id);
-                    if (bucket_data_path_res) {
-                        fs::remove(bucket_data_path_res.value());
-                    }
-
-                    auto bucket_meta_path_res =
-                        GetBucketMetadataPath(bucket_id);
-                    if (bucket_meta_path_res) {
-                        fs::remove(bucket_meta_path_res.value());
-                    }
 
-                    buckets_.erase(bucket_id);
-                    continue;
+                auto bucket_meta_path_res =
+                    GetBucketMetadataPath(bucket_id);
+                if (bucket_meta_path_res) {
+                    fs::remove(bucket_meta_path_res.value());
                 }
-                if (bucket_id > max_bucket_id) {
-                    max_bucket_id = bucket_id;
+
+                buckets_.erase(bucket_id);
+                continue;
+            }
+            auto& meta = *(metadata_it->second);
+            if (meta.data_size == 0 || meta.meta_size == 0 ||
+                meta.metadatas.empty() || meta.keys.empty()) {
+                LOG(ERROR) << "Metadata validation failed for bucket: "
+                           << bucket_id_str
+                           << ", will delete the bucket's data and "
+                              "metadata. Detailed values:";
+                LOG(ERROR) << "  data_size: " << meta.data_size
+                           << " (should not be 0)";
+                LOG(ERROR) << "  meta_size: " << meta.meta_size
+                           << " (should not be 0)";
+                LOG(ERROR)
+                    << "  object_metadata.size(): " << meta.metadatas.size()
+                    << " (empty: "
+                    << (meta.metadatas.empty() ? "true" : "false") << ")";
+
+                LOG(ERROR)
+                    << "  keys.size(): " << meta.keys.size()
+                    << " (empty: " << (meta.keys.empty() ? "true" : "false")
+                    << ")";
+                auto bucket_data_path_res = GetBucketDataPath(bucket_id);
+                if (bucket_data_path_res) {
+                    fs::remove(bucket_data_path_res.value());
                 }
-                total_size_ += metadata_it->second->data_size +
-                               metadata_it->second->meta_size;
-                for (size_t i = 0; i < metadata_it->second->keys.size(); i++) {
-                    object_bucket_map_.emplace(
-                        metadata_it->second->keys[i],
-                        StorageObjectMetadata{
-                            metadata_it->first,
-                            metadata_it->second->metadatas[i].offset,
-                            metadata_it->second->metadatas[i].key_size,
-                            metadata_it->second->metadatas[i].data_size, ""});
+
+                auto bucket_meta_path_res =
+                    GetBucketMetadataPath(bucket_id);
+                if (bucket_meta_path_res) {
+                    fs::remove(bucket_meta_path_res.value());
                 }
+
+                buckets_.erase(bucket_id);
+                continue;
+            }
+            if (bucket_id > max_bucket_id) {
+                max_bucket_id = bucket_id;
+            }
+            total_size_ += metadata_it->second->data_size +
+                           metadata_it->second->meta_size;
+            for (size_t i = 0; i < metadata_it->second->keys.size(); i++) {
+                key_filter_.Insert(metadata_it->second->keys[i]);
+                object_bucket_map_.emplace(
+                    metadata_it->second->keys[i],
+                    ToStorageObjectMetadata(
+                        metadata_it->first,
+                        metadata_it->second->metadatas[i]));
             }
         }
 
@@ -1618,6 +2534,11 @@ tl::expected<void, ErrorCode> BucketStorageBackend::Init() {
                       << "Last used bucket ID was " << max_bucket_id;
         }
         initialized_.store(true, std::memory_order_release);
+        if (bucket_backend_config_.compaction_live_percent > 0 &&
+            bucket_backend_config_.compaction_interval_seconds > 0) {
+            compaction_thread_ =
+                std::thread(&BucketStorageBackend::CompactionThread, this);
+        }
     } catch (const std::exception& e) {
         LOG(ERROR) << "Bucket storage backend initialize error: " << e.what()
                    << std::endl;
@@ -1629,6 +2550,9 @@ tl::expected<void, ErrorCode> BucketStorageBackend::Init() {
 
 tl::expected<bool, ErrorCode> BucketStorageBackend::IsExist(
     const std::string& key) {
+    if (!key_filter_.MayContain(key)) {
+        return false;
+    }
     SharedMutexLocker lock(&mutex_, shared_lock);
     auto bucket_id_it = object_bucket_map_.find(key);
     if (bucket_id_it != object_bucket_map_.end()) {
@@ -1657,24 +2581,37 @@ tl::expected<void, ErrorCode> BucketStorageBackend::ScanMeta(
     const std::function<
         ErrorCode(const std::vector<std::string>& keys,
                   std::vector<StorageObjectMetadata>& metadatas)>& handler) {
-    while (true) {
-        auto has_next_res = HasNext();
-        if (!has_next_res) {
-            LOG(ERROR) << "Failed to check for next bucket: "
-                       << has_next_res.error();
-            return tl::make_unexpected(has_next_res.error());
-        }
-        if (!has_next_res.value()) {
-            break;
+    // The handler of a batch runs while the following buckets are scanned
+    ScanMetaPipeline pipeline(handler, file_storage_config_.scanmeta_threads);
+    MutexLocker locker(&iterator_mutex_);
+    while (next_bucket_ != 0) {
+        std::vector<std::string> keys;
+        std::vector<StorageObjectMetadata> metadatas;
+        std::vector<int64_t> buckets;
+        auto key_iterator_result =
+            BucketScan(next_bucket_, keys, metadatas, buckets,
+                       file_storage_config_.scanmeta_iterator_keys_limit);
+        if (!key_iterator_result) {
+            LOG(ERROR) << "Bucket scan failed, error : "
+                       << key_iterator_result.error();
+            pipeline.Finish();
+            return tl::make_unexpected(key_iterator_result.error());
         }
-        auto add_all_object_res = HandleNext(handler);
-        if (!add_all_object_res) {
+        auto submit_result =
+            pipeline.Submit(std::move(keys), std::move(metadatas));
+        if (!submit_result) {
             LOG(ERROR) << "Failed to add all object to master: "
-                       << add_all_object_res.error();
-            return add_all_object_res;
+                       << submit_result.error();
+            return submit_result;
         }
+        next_bucket_ = key_iterator_result.value();
     }
-    return {};
+    auto finish_result = pipeline.Finish();
+    if (!finish_result) {
+        LOG(ERROR) << "Failed to add all object to master: "
+                   << finish_result.error();
+    }
+    return finish_result;
 }
 
 tl::expected<int64_t, ErrorCode> BucketStorageBackend::BucketScan(
@@ -1698,10 +2635,8 @@ tl::expected<int64_t, ErrorCode> BucketStorageBackend::BucketScan(
         buckets.emplace_back(bucket_it->first);
         for (size_t i = 0; i < bucket_it->second->keys.size(); i++) {
             keys.emplace_back(bucket_it->second->keys[i]);
-            metadatas.emplace_back(StorageObjectMetadata{
-                bucket_it->first, bucket_it->second->metadatas[i].offset,
-                bucket_it->second->metadatas[i].key_size,
-                bucket_it->second->metadatas[i].data_size, ""});
+            metadatas.emplace_back(ToStorageObjectMetadata(
+                bucket_it->first, bucket_it->second->metadatas[i]));
         }
     }
     return 0;
@@ -1825,36 +2760,142 @@ tl::expected<void, ErrorCode> BucketStorageBackend::GroupOffloadingKeysByBucket(
 
 tl::expected<std::shared_ptr<BucketMetadata>, ErrorCode>
 BucketStorageBackend::BuildBucket(
-    int64_t bucket_id,
-    const std::unordered_map<std::string, std::vector<Slice>>& batch_object,
-    std::vector<iovec>& iovs, std::vector<StorageObjectMetadata>& metadatas) {
+    int64_t bucket_id, const StoredBatch& batch, std::vector<iovec>& iovs,
+    std::vector<StorageObjectMetadata>& metadatas) {
     auto bucket = std::make_shared<BucketMetadata>();
     int64_t storage_offset = 0;
-    for (const auto& object : batch_object) {
-        if (object.second.empty()) {
+    for (const auto& object : batch) {
+        if (object.second.slices.empty()) {
             LOG(ERROR) << "Failed to create bucket, object is empty";
             return tl::make_unexpected(ErrorCode::INVALID_KEY);
         }
-        int64_t object_total_size = 0;
+        int64_t object_stored_size = 0;
         iovs.emplace_back(
             iovec{const_cast<char*>(object.first.data()), object.first.size()});
-        for (const auto& slice : object.second) {
-            object_total_size += slice.size;
+        for (const auto& slice : object.second.slices) {
+            object_stored_size += slice.size;
             iovs.emplace_back(iovec{slice.ptr, slice.size});
         }
-        bucket->data_size += object_total_size + object.first.size();
-        bucket->metadatas.emplace_back(BucketObjectMetadata{
+        const bool compressed =
+            object.second.codec != CompressionCodec::kNone;
+        BucketObjectMetadata object_metadata{
             storage_offset, static_cast<int64_t>(object.first.size()),
-            object_total_size});
-        metadatas.emplace_back(StorageObjectMetadata{
-            bucket_id, storage_offset,
-            static_cast<int64_t>(object.first.size()), object_total_size, ""});
+            object.second.data_size, compressed ? object_stored_size : 0,
+            static_cast<uint32_t>(object.second.codec)};
+        bucket->data_size += object_stored_size + object.first.size();
+        bucket->metadatas.push_back(object_metadata);
+        metadatas.push_back(
+            ToStorageObjectMetadata(bucket_id, object_metadata));
         bucket->keys.push_back(object.first);
-        storage_offset += object_total_size + object.first.size();
+        storage_offset += object_stored_size + object.first.size();
     }
     return bucket;
 }
 
+BucketStorageBackend::StoredBatch BucketStorageBackend::CompressBatch(
+    const std::unordered_map<std::string, std::vector<Slice>>& batch_object,
+    std::vector<std::unique_ptr<char[]>>& buffers) {
+    const auto codec = bucket_backend_config_.compression_codec;
+    StoredBatch batch;
+    batch.reserve(batch_object.size());
+    std::vector<StoredValue*> candidates;
+    int64_t data_bytes = 0;
+    for (const auto& [key, slices] : batch_object) {
+        int64_t size = 0;
+        for (const auto& slice : slices) {
+            size += slice.size;
+        }
+        data_bytes += size;
+        auto& value = batch.emplace(key, StoredValue{slices, size,
+                                                     CompressionCodec::kNone})
+                          .first->second;
+        if (codec != CompressionCodec::kNone && size > 0 &&
+            size >= bucket_backend_config_.compression_min_size) {
+            candidates.push_back(&value);
+        }
+    }
+
+    // A value is kept only if it fits in the capacity, so incompressible
+    // values fail early and are stored raw
+    std::vector<std::unique_ptr<char[]>> compressed(candidates.size());
+    std::vector<size_t> compressed_sizes(candidates.size(), 0);
+    ParallelFor(
+        candidates.size(), bucket_backend_config_.compression_threads,
+        [&](size_t i) {
+            const auto start = std::chrono::steady_clock::now();
+            const auto& value = *candidates[i];
+            const size_t capacity =
+                value.data_size *
+                (100 - bucket_backend_config_.compression_min_saving_percent) /
+                100;
+            if (capacity == 0) {
+                return;
+            }
+            // The codecs take one buffer, gather values of several slices
+            std::unique_ptr<char[]> gathered;
+            const void* src = value.slices[0].ptr;
+            if (value.slices.size() > 1) {
+                gathered.reset(new char[value.data_size]);
+                size_t offset = 0;
+                for (const auto& slice : value.slices) {
+                    std::memcpy(gathered.get() + offset, slice.ptr,
+                                slice.size);
+                    offset += slice.size;
+                }
+                src = gathered.get();
+            }
+            std::unique_ptr<char[]> buffer(new char[capacity]);
+            const size_t size =
+                Compress(codec, bucket_backend_config_.compression_level, src,
+                         value.data_size, buffer.get(), capacity);
+            if (size > 0) {
+                compressed[i] = std::move(buffer);
+                compressed_sizes[i] = size;
+            }
+            compress_time_us_.fetch_add(MicrosecondsSince(start),
+                                        std::memory_order_relaxed);
+        });
+
+    int64_t stored_bytes = data_bytes;
+    int64_t compressed_values = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (compressed_sizes[i] == 0) {
+            continue;
+        }
+        auto& value = *candidates[i];
+        value.slices = {Slice{compressed[i].get(), compressed_sizes[i]}};
+        value.codec = codec;
+        stored_bytes -= value.data_size - compressed_sizes[i];
+        buffers.push_back(std::move(compressed[i]));
+        compressed_values++;
+    }
+    offloaded_values_.fetch_add(batch.size(), std::memory_order_relaxed);
+    compressed_values_.fetch_add(compressed_values, std::memory_order_relaxed);
+    offloaded_data_bytes_.fetch_add(data_bytes, std::memory_order_relaxed);
+    offloaded_stored_bytes_.fetch_add(stored_bytes, std::memory_order_relaxed);
+    if (!candidates.empty()) {
+        VLOG(1) << "Compressed " << compressed_values << " of "
+                << batch.size() << " offloaded values with "
+                << CompressionCodecName(codec) << ", " << data_bytes
+                << " bytes stored as " << stored_bytes;
+    }
+    return batch;
+}
+
+CompressionStats BucketStorageBackend::GetCompressionStats() const {
+    CompressionStats stats;
+    stats.values = offloaded_values_.load(std::memory_order_relaxed);
+    stats.compressed_values =
+        compressed_values_.load(std::memory_order_relaxed);
+    stats.data_bytes = offloaded_data_bytes_.load(std::memory_order_relaxed);
+    stats.stored_bytes =
+        offloaded_stored_bytes_.load(std::memory_order_relaxed);
+    stats.compress_time_us = compress_time_us_.load(std::memory_order_relaxed);
+    stats.decompress_time_us =
+        decompress_time_us_.load(std::memory_order_relaxed);
+    return stats;
+}
+
 tl::expected<void, ErrorCode> BucketStorageBackend::WriteBucket(
     int64_t bucket_id, std::shared_ptr<BucketMetadata> bucket_metadata,
     std::vector<iovec>& iovs) {
@@ -1941,8 +2982,6 @@ void BucketStorageBackend::CleanupOrphanedBucket(int64_t bucket_id) {
 
 tl::expected<void, ErrorCode> BucketStorageBackend::DeleteBucket(
     int64_t bucket_id) {
-    namespace fs = std::filesystem;
-
     std::shared_ptr<BucketMetadata> bucket_metadata;
     std::vector<std::string> keys_to_remove;
 
@@ -1967,27 +3006,370 @@ tl::expected<void, ErrorCode> BucketStorageBackend::DeleteBucket(
             auto obj_it = object_bucket_map_.find(key);
             if (obj_it != object_bucket_map_.end() &&
                 obj_it->second.bucket_id == bucket_id) {
-                total_size_ -=
-                    obj_it->second.data_size + obj_it->second.key_size;
                 object_bucket_map_.erase(obj_it);
             }
         }
 
-        // Subtract metadata size
-        total_size_ -= bucket_metadata->meta_size;
+        // The whole file is freed, including the space of removed objects
+        total_size_ -= bucket_metadata->data_size + bucket_metadata->meta_size;
     }
     // Lock released - new readers can't find this bucket anymore
 
     // Step 2: Wait for in-flight reads to complete
     // Readers that started before we removed from buckets_ still hold guards
+    auto wait_result = WaitForInflightReads(bucket_id, bucket_metadata);
+    if (!wait_result) {
+        return wait_result;
+    }
+
+    // Step 3: Safe to delete files now - no readers are using them
+    RemoveBucketFiles(bucket_id);
+
+    LOG(INFO) << "DeleteBucket: successfully deleted bucket_id=" << bucket_id
+              << ", keys_removed=" << keys_to_remove.size();
+    return {};
+}
+
+tl::expected<int64_t, ErrorCode> BucketStorageBackend::BatchRemove(
+    const std::vector<std::string>& keys) {
+    if (!initialized_.load(std::memory_order_acquire)) {
+        LOG(ERROR)
+            << "Storage backend is not initialized. Call Init() before use.";
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+    MutexLocker maintenance_locker(&maintenance_mutex_);
+
+    int64_t removed = 0;
+    // Copies of the shrunk buckets to persist, and buckets left empty
+    std::vector<std::pair<int64_t, std::shared_ptr<BucketMetadata>>> updated;
+    std::vector<int64_t> emptied;
+    {
+        SharedMutexLocker lock(&mutex_);
+        std::unordered_set<int64_t> touched;
+        for (const auto& key : keys) {
+            auto obj_it = object_bucket_map_.find(key);
+            if (obj_it == object_bucket_map_.end()) {
+                continue;
+            }
+            const int64_t bucket_id = obj_it->second.bucket_id;
+            object_bucket_map_.erase(obj_it);
+            ++removed;
+
+            auto bucket_it = buckets_.find(bucket_id);
+            if (bucket_it == buckets_.end()) {
+                continue;
+            }
+            auto& bucket = *bucket_it->second;
+            auto key_it =
+                std::find(bucket.keys.begin(), bucket.keys.end(), key);
+            if (key_it != bucket.keys.end()) {
+                bucket.metadatas.erase(bucket.metadatas.begin() +
+                                       (key_it - bucket.keys.begin()));
+                bucket.keys.erase(key_it);
+                touched.insert(bucket_id);
+            }
+        }
+        // total_size_ keeps the space of removed objects until the bucket
+        // is compacted or deleted
+        for (int64_t bucket_id : touched) {
+            const auto& bucket = buckets_.at(bucket_id);
+            if (bucket->keys.empty()) {
+                emptied.push_back(bucket_id);
+            } else {
+                updated.emplace_back(bucket_id,
+                                     std::make_shared<BucketMetadata>(*bucket));
+            }
+        }
+    }
+
+    for (auto& [bucket_id, metadata] : updated) {
+        auto store_result = StoreBucketMetadata(bucket_id, metadata);
+        if (!store_result) {
+            LOG(ERROR) << "Failed to persist removed keys of bucket "
+                       << bucket_id << ", error: " << store_result.error();
+            return tl::make_unexpected(store_result.error());
+        }
+        SharedMutexLocker lock(&mutex_);
+        auto bucket_it = buckets_.find(bucket_id);
+        if (bucket_it == buckets_.end()) {
+            // Deleted meanwhile, drop the metadata file just written
+            lock.unlock();
+            RemoveBucketFiles(bucket_id);
+            continue;
+        }
+        total_size_ += metadata->meta_size - bucket_it->second->meta_size;
+        bucket_it->second->meta_size = metadata->meta_size;
+    }
+
+    for (int64_t bucket_id : emptied) {
+        auto delete_result = DeleteBucket(bucket_id);
+        if (!delete_result &&
+            delete_result.error() != ErrorCode::BUCKET_NOT_FOUND) {
+            return tl::make_unexpected(delete_result.error());
+        }
+    }
+    return removed;
+}
+
+struct BucketStorageBackend::CompactionSource {
+    int64_t bucket_id;
+    // Keeps DeleteBucket from removing the files while they are read
+    BucketReadGuard guard;
+    std::vector<std::string> keys;
+    std::vector<BucketObjectMetadata> metadatas;
+    int64_t live_bytes;
+};
+
+tl::expected<int64_t, ErrorCode> BucketStorageBackend::CompactBuckets() {
+    if (!initialized_.load(std::memory_order_acquire)) {
+        LOG(ERROR)
+            << "Storage backend is not initialized. Call Init() before use.";
+        return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+    }
+    const int64_t live_percent = bucket_backend_config_.compaction_live_percent;
+    if (live_percent <= 0) {
+        return 0;
+    }
+    MutexLocker maintenance_locker(&maintenance_mutex_);
+
+    // An object is live if the object map still points to its bucket, which
+    // also catches duplicates left by an interrupted compaction
+    std::vector<CompactionSource> sources;
+    {
+        SharedMutexLocker lock(&mutex_, shared_lock);
+        for (const auto& [bucket_id, bucket] : buckets_) {
+            CompactionSource source{bucket_id, BucketReadGuard(bucket), {}, {},
+                                    0};
+            for (size_t i = 0; i < bucket->keys.size(); ++i) {
+                auto obj_it = object_bucket_map_.find(bucket->keys[i]);
+                if (obj_it == object_bucket_map_.end() ||
+                    obj_it->second.bucket_id != bucket_id) {
+                    continue;
+                }
+                source.keys.push_back(bucket->keys[i]);
+                source.metadatas.push_back(bucket->metadatas[i]);
+                source.live_bytes += bucket->metadatas[i].key_size +
+                                     StoredSize(bucket->metadatas[i]);
+            }
+            if (source.live_bytes * 100 < live_percent * bucket->data_size) {
+                sources.push_back(std::move(source));
+            }
+        }
+    }
+    if (sources.empty()) {
+        return 0;
+    }
+    // Sparsest buckets first, they reclaim the most per byte rewritten
+    std::sort(sources.begin(), sources.end(),
+              [](const CompactionSource& a, const CompactionSource& b) {
+                  return a.live_bytes * b.guard.get()->data_size <
+                         b.live_bytes * a.guard.get()->data_size;
+              });
+
+    const size_t source_count = sources.size();
+    const int64_t rate = bucket_backend_config_.compaction_bytes_per_sec;
+    const auto start = std::chrono::steady_clock::now();
+    int64_t reclaimed = 0;
+    int64_t written = 0;
+    size_t compacted = 0;
+    size_t next = 0;
+    while (next < sources.size()) {
+        // Pack whole buckets into one new bucket within the bucket limits
+        std::vector<CompactionSource> group;
+        int64_t group_keys = 0;
+        int64_t group_bytes = 0;
+        while (next < sources.size()) {
+            const auto& source = sources[next];
+            const int64_t keys = source.keys.size();
+            if (!group.empty() &&
+                (group_keys + keys > bucket_backend_config_.bucket_keys_limit ||
+                 group_bytes + source.live_bytes >
+                     bucket_backend_config_.bucket_size_limit)) {
+                break;
+            }
+            group_keys += keys;
+            group_bytes += source.live_bytes;
+            group.push_back(std::move(sources[next++]));
+        }
+
+        const size_t group_size = group.size();
+        auto group_result = CompactGroup(group, written);
+        if (!group_result) {
+            LOG(ERROR) << "Bucket compaction failed, error: "
+                       << group_result.error();
+            return tl::make_unexpected(group_result.error());
+        }
+        reclaimed += group_result.value();
+        compacted += group_size;
+
+        // Throttle to the configured rate, waking up early on shutdown
+        std::unique_lock<std::mutex> lock(compaction_mutex_);
+        if (rate > 0) {
+            const auto due =
+                start + std::chrono::microseconds(written * 1000000 / rate);
+            compaction_cv_.wait_until(lock, due,
+                                      [this] { return compaction_stop_; });
+        }
+        if (compaction_stop_) {
+            break;
+        }
+    }
+
+    compaction_reclaimed_bytes_.fetch_add(reclaimed, std::memory_order_relaxed);
+    LOG(INFO) << "Bucket compaction rewrote " << compacted << " of "
+              << source_count << " sparse bucket(s), wrote " << written
+              << " bytes, reclaimed " << reclaimed << " bytes";
+    return reclaimed;
+}
+
+tl::expected<int64_t, ErrorCode> BucketStorageBackend::CompactGroup(
+    std::vector<CompactionSource>& group, int64_t& written) {
+    // Step 1: Read the live objects of the group, compressed values are
+    // copied as they are
+    StoredBatch batch;
+    std::unordered_map<std::string, int64_t> source_bucket;
+    std::vector<std::unique_ptr<char[]>> buffers;
+    for (const auto& source : group) {
+        if (source.keys.empty()) {
+            continue;
+        }
+        auto filepath_res = GetBucketDataPath(source.bucket_id);
+        if (!filepath_res) {
+            return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
+        }
+        auto file_res = OpenFile(filepath_res.value(), FileMode::Read);
+        if (!file_res) {
+            LOG(ERROR) << "Failed to open bucket file: "
+                       << filepath_res.value();
+            return tl::make_unexpected(file_res.error());
+        }
+        auto& file = file_res.value();
+        for (size_t i = 0; i < source.keys.size(); ++i) {
+            const auto& metadata = source.metadatas[i];
+            const int64_t stored_size = StoredSize(metadata);
+            auto buffer = std::make_unique<char[]>(stored_size);
+            iovec iov{buffer.get(), static_cast<size_t>(stored_size)};
+            auto read_res =
+                file->vector_read(&iov, 1, metadata.offset + metadata.key_size);
+            if (!read_res) {
+                LOG(ERROR) << "vector_read failed for key: " << source.keys[i]
+                           << ", bucket_id=" << source.bucket_id
+                           << ", error: " << read_res.error();
+                return tl::make_unexpected(read_res.error());
+            }
+            if (static_cast<int64_t>(read_res.value()) != stored_size) {
+                LOG(ERROR) << "Read size mismatch for key: " << source.keys[i]
+                           << ", expected: " << stored_size
+                           << ", got: " << read_res.value();
+                return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
+            }
+            batch.emplace(
+                source.keys[i],
+                StoredValue{{Slice{buffer.get(),
+                                   static_cast<size_t>(stored_size)}},
+                            metadata.data_size,
+                            static_cast<CompressionCodec>(metadata.codec)});
+            source_bucket.emplace(source.keys[i], source.bucket_id);
+            buffers.push_back(std::move(buffer));
+        }
+    }
+
+    // Step 2: Write them to a new bucket
+    int64_t new_bucket_id = 0;
+    std::shared_ptr<BucketMetadata> new_bucket;
+    std::vector<StorageObjectMetadata> metadatas;
+    if (!batch.empty()) {
+        new_bucket_id = bucket_id_generator_->NextId();
+        std::vector<iovec> iovs;
+        auto build_bucket_result =
+            BuildBucket(new_bucket_id, batch, iovs, metadatas);
+        if (!build_bucket_result) {
+            return tl::make_unexpected(build_bucket_result.error());
+        }
+        new_bucket = build_bucket_result.value();
+        auto write_bucket_result =
+            WriteBucket(new_bucket_id, new_bucket, iovs);
+        if (!write_bucket_result) {
+            return tl::make_unexpected(write_bucket_result.error());
+        }
+        written += new_bucket->data_size;
+    }
+
+    // Step 3: Switch the objects to the new bucket and drop the old ones.
+    // Readers see either bucket, and both hold the same data.
+    int64_t reclaimed = 0;
+    std::vector<size_t> dropped;
+    {
+        SharedMutexLocker lock(&mutex_);
+        if (new_bucket) {
+            for (size_t i = 0; i < new_bucket->keys.size(); ++i) {
+                const auto& key = new_bucket->keys[i];
+                auto obj_it = object_bucket_map_.find(key);
+                if (obj_it != object_bucket_map_.end() &&
+                    obj_it->second.bucket_id == source_bucket.at(key)) {
+                    obj_it->second = metadatas[i];
+                }
+            }
+            total_size_ += new_bucket->data_size + new_bucket->meta_size;
+            reclaimed -= new_bucket->data_size + new_bucket->meta_size;
+            buckets_.emplace(new_bucket_id, new_bucket);
+        }
+        for (size_t i = 0; i < group.size(); ++i) {
+            auto bucket_it = buckets_.find(group[i].bucket_id);
+            // Skip buckets deleted meanwhile, DeleteBucket owns their files
+            if (bucket_it == buckets_.end() ||
+                bucket_it->second != group[i].guard.get()) {
+                continue;
+            }
+            const auto& bucket = bucket_it->second;
+            total_size_ -= bucket->data_size + bucket->meta_size;
+            reclaimed += bucket->data_size + bucket->meta_size;
+            buckets_.erase(bucket_it);
+            dropped.push_back(i);
+        }
+    }
+
+    // Step 4: Delete the old files after their in-flight reads
+    for (size_t i : dropped) {
+        auto bucket = group[i].guard.get();
+        group[i].guard = BucketReadGuard(nullptr);
+        if (!WaitForInflightReads(group[i].bucket_id, bucket)) {
+            // Better an orphan than a read of a deleted file
+            continue;
+        }
+        RemoveBucketFiles(group[i].bucket_id);
+    }
+    return reclaimed;
+}
+
+void BucketStorageBackend::CompactionThread() {
+    const auto interval = std::chrono::seconds(
+        bucket_backend_config_.compaction_interval_seconds);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(compaction_mutex_);
+            if (compaction_cv_.wait_for(lock, interval,
+                                        [this] { return compaction_stop_; })) {
+                break;
+            }
+        }
+        auto compact_result = CompactBuckets();
+        if (!compact_result) {
+            LOG(WARNING) << "Background bucket compaction failed, error: "
+                         << compact_result.error();
+        }
+    }
+}
+
+tl::expected<void, ErrorCode> BucketStorageBackend::WaitForInflightReads(
+    int64_t bucket_id, const std::shared_ptr<BucketMetadata>& bucket) {
     constexpr int kMaxSpinIterations = 1000;
     constexpr auto kSleepDuration = std::chrono::microseconds(100);
     constexpr auto kMaxWaitTime = std::chrono::seconds(10);
 
     int spin_count = 0;
     auto wait_start = std::chrono::steady_clock::now();
-    while (bucket_metadata->inflight_reads_.load(std::memory_order_acquire) >
-           0) {
+    while (bucket->inflight_reads_.load(std::memory_order_acquire) > 0) {
         if (++spin_count > kMaxSpinIterations) {
             // After spinning, sleep briefly and check timeout
             std::this_thread::sleep_for(kSleepDuration);
@@ -1995,26 +3377,29 @@ tl::expected<void, ErrorCode> BucketStorageBackend::DeleteBucket(
 
             auto elapsed = std::chrono::steady_clock::now() - wait_start;
             if (elapsed > kMaxWaitTime) {
-                LOG(ERROR)
-                    << "DeleteBucket: timed out waiting for in-flight reads"
-                    << ", bucket_id=" << bucket_id << ", inflight_reads="
-                    << bucket_metadata->inflight_reads_.load(
-                           std::memory_order_relaxed);
+                LOG(ERROR) << "Timed out waiting for in-flight reads"
+                           << ", bucket_id=" << bucket_id
+                           << ", inflight_reads="
+                           << bucket->inflight_reads_.load(
+                                  std::memory_order_relaxed);
                 return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
             }
         } else {
             PAUSE();
         }
     }
+    return {};
+}
 
-    // Step 3: Safe to delete files now - no readers are using them
+void BucketStorageBackend::RemoveBucketFiles(int64_t bucket_id) {
+    namespace fs = std::filesystem;
     std::error_code ec;
 
     auto data_path_res = GetBucketDataPath(bucket_id);
     if (data_path_res) {
         fs::remove(data_path_res.value(), ec);
         if (ec && ec != std::errc::no_such_file_or_directory) {
-            LOG(WARNING) << "DeleteBucket: failed to remove data file: "
+            LOG(WARNING) << "Failed to remove bucket data file: "
                          << data_path_res.value()
                          << ", error: " << ec.message();
         }
@@ -2025,15 +3410,11 @@ tl::expected<void, ErrorCode> BucketStorageBackend::DeleteBucket(
         ec.clear();
         fs::remove(meta_path_res.value(), ec);
         if (ec && ec != std::errc::no_such_file_or_directory) {
-            LOG(WARNING) << "DeleteBucket: failed to remove metadata file: "
+            LOG(WARNING) << "Failed to remove bucket metadata file: "
                          << meta_path_res.value()
                          << ", error: " << ec.message();
         }
     }
-
-    LOG(INFO) << "DeleteBucket: successfully deleted bucket_id=" << bucket_id
-              << ", keys_removed=" << keys_to_remove.size();
-    return {};
 }
 
 tl::expected<void, ErrorCode> BucketStorageBackend::StoreBucketMetadata(
@@ -2145,51 +3526,510 @@ BucketStorageBackend::OpenFile(const std::string& path, FileMode mode) const {
     return std::make_unique<PosixFile>(path, fd);
 }
 
-tl::expected<void, ErrorCode> BucketStorageBackend::HandleNext(
-    const std::function<
-        ErrorCode(const std::vector<std::string>& keys,
-                  std::vector<StorageObjectMetadata>& metadatas)>& handler) {
-    MutexLocker locker(&iterator_mutex_);
-    std::vector<std::string> keys;
-    std::vector<StorageObjectMetadata> metadatas;
-    std::vector<int64_t> buckets;
-    auto key_iterator_result =
-        BucketScan(next_bucket_, keys, metadatas, buckets,
-                   file_storage_config_.scanmeta_iterator_keys_limit);
-    if (!key_iterator_result) {
-        LOG(ERROR) << "Bucket scan failed, error : "
-                   << key_iterator_result.error();
-        return tl::make_unexpected(key_iterator_result.error());
-    }
-    auto handle_result = handler(keys, metadatas);
-    if (handle_result != ErrorCode::OK) {
-        LOG(ERROR) << "Key iterator failed, error : " << handle_result;
-        return tl::make_unexpected(handle_result);
-    }
-    next_bucket_ = key_iterator_result.value();
-    return {};
+// ============================================================================
+// OffsetAllocatorStorageBackend Implementation
+// ============================================================================
+
+namespace {
+
+// Index checkpoints and logs start with a header and hold a sequence of
+// records, each an IndexRecordHeader followed by the key. A record with a
+// wrong checksum ends the file, e.g. the torn tail of a log.
+constexpr uint32_t kIndexMagic = 0x58444e49;  // "INDX"
+constexpr uint32_t kIndexVersion = 1;
+
+struct IndexFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    // Capacity of the data file the index belongs to
+    uint64_t capacity;
+};
+
+struct IndexRecordHeader {
+    uint64_t offset;
+    uint32_t key_len;
+    uint32_t total_size;
+    uint32_t value_size;
+    uint32_t checksum;
+};
+
+static_assert(sizeof(IndexRecordHeader) == 24);
+
+// FNV-1a over the record fields and the key
+uint32_t IndexRecordChecksum(const IndexRecordHeader& header,
+                             std::string_view key) {
+    uint32_t hash = 2166136261U;
+    auto mix = [&hash](const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619U;
+        }
+    };
+    mix(&header, offsetof(IndexRecordHeader, checksum));
+    mix(key.data(), key.size());
+    return hash;
 }
 
-tl::expected<bool, ErrorCode> BucketStorageBackend::HasNext() {
-    MutexLocker locker(&iterator_mutex_);
-    return next_bucket_ != 0;
+void AppendIndexRecord(std::string& out, std::string_view key,
+                       uint64_t offset, uint32_t total_size,
+                       uint32_t value_size) {
+    IndexRecordHeader header{offset, static_cast<uint32_t>(key.size()),
+                             total_size, value_size, 0};
+    header.checksum = IndexRecordChecksum(header, key);
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(key.data(), key.size());
 }
 
-// ============================================================================
-// OffsetAllocatorStorageBackend Implementation
-// ============================================================================
+std::string IndexFilePrologue(uint64_t capacity) {
+    IndexFileHeader header{kIndexMagic, kIndexVersion, capacity};
+    return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+class IndexFileMapping {
+   public:
+    IndexFileMapping(void* addr, size_t size) : addr_(addr), size_(size) {}
+    ~IndexFileMapping() {
+        if (addr_ != MAP_FAILED) {
+            munmap(addr_, size_);
+        }
+    }
+    IndexFileMapping(const IndexFileMapping&) = delete;
+    IndexFileMapping& operator=(const IndexFileMapping&) = delete;
+
+    bool valid() const { return addr_ != MAP_FAILED; }
+    const uint8_t* data() const { return static_cast<const uint8_t*>(addr_); }
+
+   private:
+    void* addr_;
+    size_t size_;
+};
+
+// Apply the records of an index file in order. A missing file is empty.
+template <typename Apply>
+tl::expected<size_t, ErrorCode> ReplayIndexFile(const std::string& path,
+                                                uint64_t capacity,
+                                                Apply&& apply) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        LOG(ERROR) << "path=" << path
+                   << ", error=open_index_failed, errno=" << errno;
+        return tl::make_unexpected(ErrorCode::FILE_OPEN_FAIL);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
+    }
+    const size_t size = st.st_size;
+    if (size < sizeof(IndexFileHeader)) {
+        close(fd);
+        return 0;
+    }
+    IndexFileMapping mapping(
+        mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0), size);
+    close(fd);
+    if (!mapping.valid()) {
+        LOG(ERROR) << "path=" << path
+                   << ", error=mmap_index_failed, errno=" << errno;
+        return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
+    }
+    madvise(const_cast<uint8_t*>(mapping.data()), size, MADV_SEQUENTIAL);
+
+    IndexFileHeader file_header;
+    std::memcpy(&file_header, mapping.data(), sizeof(file_header));
+    if (file_header.magic != kIndexMagic ||
+        file_header.version != kIndexVersion ||
+        file_header.capacity != capacity) {
+        LOG(ERROR) << "path=" << path << ", error=incompatible_index"
+                   << ", version=" << file_header.version
+                   << ", capacity=" << file_header.capacity;
+        return tl::make_unexpected(ErrorCode::INVALID_VERSION);
+    }
+
+    size_t records = 0;
+    size_t pos = sizeof(IndexFileHeader);
+    while (size - pos >= sizeof(IndexRecordHeader)) {
+        IndexRecordHeader header;
+        std::memcpy(&header, mapping.data() + pos, sizeof(header));
+        if (size - pos - sizeof(header) < header.key_len) {
+            break;
+        }
+        std::string_view key(
+            reinterpret_cast<const char*>(mapping.data() + pos +
+                                          sizeof(header)),
+            header.key_len);
+        if (IndexRecordChecksum(header, key) != header.checksum) {
+            break;
+        }
+        apply(key, header);
+        pos += sizeof(header) + header.key_len;
+        ++records;
+    }
+    if (pos != size) {
+        LOG(WARNING) << "path=" << path << ", ignored_tail_bytes="
+                     << size - pos;
+    }
+    return records;
+}
+
+}  // namespace
 
 OffsetAllocatorStorageBackend::OffsetAllocatorStorageBackend(
-    const FileStorageConfig& file_storage_config_)
+    const FileStorageConfig& file_storage_config_,
+    const OffsetAllocatorBackendConfig& backend_config)
     : StorageBackendInterface(file_storage_config_),
-      storage_path_(file_storage_config_.storage_filepath) {
+      storage_path_(file_storage_config_.storage_filepath),
+      backend_config_(backend_config) {
     capacity_ = file_storage_config_.total_size_limit;
 }
 
+OffsetAllocatorStorageBackend::~OffsetAllocatorStorageBackend() {
+    if (backend_config_.persist_index &&
+        initialized_.load(std::memory_order_acquire)) {
+        auto checkpoint_result = CheckpointIndex();
+        if (!checkpoint_result) {
+            LOG(WARNING) << "Failed to checkpoint the index on shutdown, it "
+                            "is recovered from the index log instead";
+        }
+    }
+    MutexLocker lock(&index_mutex_);
+    if (index_log_fd_ >= 0) {
+        close(index_log_fd_);
+        index_log_fd_ = -1;
+    }
+}
+
+void OffsetAllocatorStorageBackend::DiscardQueue::Add(
+    offset_allocator::OffsetAllocationHandle&& handle) {
+    MutexLocker lock(&mutex_);
+    pending_bytes_ += handle.size();
+    pending_.push_back(std::move(handle));
+    if (pending_bytes_ >= batch_bytes_) {
+        FlushLocked();
+    }
+}
+
+void OffsetAllocatorStorageBackend::DiscardQueue::Flush() {
+    MutexLocker lock(&mutex_);
+    FlushLocked();
+}
+
+void OffsetAllocatorStorageBackend::DiscardQueue::FlushLocked() {
+    std::sort(pending_.begin(), pending_.end(),
+              [](const auto& a, const auto& b) {
+                  return a.address() < b.address();
+              });
+    // Adjacent extents are punched with one call
+    size_t i = 0;
+    while (supported_ && i < pending_.size()) {
+        uint64_t begin = pending_[i].address();
+        uint64_t end = begin + pending_[i].size();
+        for (++i; i < pending_.size() && pending_[i].address() == end; ++i) {
+            end += pending_[i].size();
+        }
+        if (fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, begin,
+                      end - begin) != 0) {
+            LOG(WARNING) << "Failed to punch [" << begin << ", " << end
+                         << ") out of the data file: " << strerror(errno)
+                         << ", freed extents are no longer discarded";
+            supported_ = false;
+            break;
+        }
+        discarded_bytes.fetch_add(end - begin, std::memory_order_relaxed);
+        discard_calls.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Return the extents to the allocator
+    pending_.clear();
+    pending_bytes_ = 0;
+}
+
+uint64_t OffsetAllocatorStorageBackend::AllocationSize(
+    uint64_t record_size) const {
+    const uint64_t alignment = backend_config_.allocation_alignment;
+    return alignment ? (record_size + alignment - 1) & ~(alignment - 1)
+                     : record_size;
+}
+
+int64_t OffsetAllocatorStorageBackend::ReadDeviceWrittenBytes() const {
+    if (device_stat_path_.empty()) {
+        return -1;
+    }
+    std::ifstream stat_file(device_stat_path_);
+    // Fields of the block layer statistics, the 7th counts sectors written
+    uint64_t fields[7];
+    for (auto& field : fields) {
+        if (!(stat_file >> field)) {
+            return -1;
+        }
+    }
+    return static_cast<int64_t>(fields[6] * 512);
+}
+
+OffsetAllocatorDiskStats OffsetAllocatorStorageBackend::GetDiskStats() const {
+    OffsetAllocatorDiskStats stats;
+    stats.record_bytes = record_bytes_.load(std::memory_order_relaxed);
+    stats.allocated_bytes = allocated_bytes_.load(std::memory_order_relaxed);
+    if (discard_queue_) {
+        stats.discarded_bytes =
+            discard_queue_->discarded_bytes.load(std::memory_order_relaxed);
+        stats.discard_calls =
+            discard_queue_->discard_calls.load(std::memory_order_relaxed);
+    }
+    int64_t device_written = ReadDeviceWrittenBytes();
+    if (device_written >= 0) {
+        stats.device_written_bytes = device_written - device_written_base_;
+    }
+    return stats;
+}
+
 std::string OffsetAllocatorStorageBackend::GetDataFilePath() const {
     return (std::filesystem::path(storage_path_) / "kv_cache.data").string();
 }
 
+std::string OffsetAllocatorStorageBackend::GetIndexCheckpointPath() const {
+    return (std::filesystem::path(storage_path_) / "kv_cache.index").string();
+}
+
+std::string OffsetAllocatorStorageBackend::GetIndexLogPath() const {
+    return (std::filesystem::path(storage_path_) / "kv_cache.index.log")
+        .string();
+}
+
+tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::OpenIndexLog() {
+    const std::string path = GetIndexLogPath();
+    int fd = open(path.c_str(), O_CLOEXEC | O_WRONLY | O_CREAT | O_TRUNC,
+                  0644);
+    if (fd < 0) {
+        LOG(ERROR) << "path=" << path
+                   << ", error=open_index_log_failed, errno=" << errno;
+        return tl::make_unexpected(ErrorCode::FILE_OPEN_FAIL);
+    }
+    const std::string prologue = IndexFilePrologue(capacity_);
+    if (!WriteAll(fd, prologue.data(), prologue.size())) {
+        LOG(ERROR) << "path=" << path
+                   << ", error=write_index_log_failed, errno=" << errno;
+        close(fd);
+        return tl::make_unexpected(ErrorCode::FILE_WRITE_FAIL);
+    }
+    index_log_fd_ = fd;
+    index_log_bytes_ = prologue.size();
+    return {};
+}
+
+bool OffsetAllocatorStorageBackend::LogIndexEntry(const std::string& key,
+                                                  const IndexEntry& entry) {
+    std::string record;
+    record.reserve(sizeof(IndexRecordHeader) + key.size());
+    AppendIndexRecord(record, key, entry.offset, entry.total_size,
+                      entry.value_size);
+    MutexLocker lock(&index_mutex_);
+    if (index_log_fd_ < 0) {
+        return false;
+    }
+    if (!WriteAll(index_log_fd_, record.data(), record.size())) {
+        // The object stays readable until the next restart
+        LOG(ERROR) << "Failed to log index entry for key: " << key
+                   << ", errno=" << errno;
+        return false;
+    }
+    index_log_bytes_ += record.size();
+    return index_log_bytes_ >= backend_config_.index_log_checkpoint_bytes;
+}
+
+tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::CheckpointIndex() {
+    if (!backend_config_.persist_index ||
+        !initialized_.load(std::memory_order_acquire)) {
+        return {};
+    }
+    bool expected = false;
+    if (!checkpoint_running_.compare_exchange_strong(expected, true)) {
+        return {};
+    }
+    struct RunningGuard {
+        std::atomic<bool>& running;
+        ~RunningGuard() { running.store(false, std::memory_order_release); }
+    } running_guard{checkpoint_running_};
+
+    const std::string checkpoint_path = GetIndexCheckpointPath();
+    const std::string log_path = GetIndexLogPath();
+    const std::string old_log_path = log_path + ".old";
+
+    // Everything logged before the snapshot moves to the old log, which
+    // stays until the checkpoint replacing it is durable
+    std::string image = IndexFilePrologue(capacity_);
+    size_t num_entries = 0;
+    bool reopen_log = false;
+    {
+        std::vector<std::unique_ptr<SharedMutexLocker>> shard_locks;
+        shard_locks.reserve(kNumShards);
+        for (size_t i = 0; i < kNumShards; ++i) {
+            shard_locks.emplace_back(std::make_unique<SharedMutexLocker>(
+                &shards_[i].mutex, shared_lock));
+        }
+        for (size_t i = 0; i < kNumShards; ++i) {
+            for (const auto& [key, entry] : shards_[i].map) {
+                AppendIndexRecord(image, key, entry.offset, entry.total_size,
+                                  entry.value_size);
+                ++num_entries;
+            }
+        }
+
+        MutexLocker lock(&index_mutex_);
+        if (index_log_fd_ < 0) {
+            // Nothing is logged without a log, e.g. during Init, so both
+            // logs are replaced by an empty one after the checkpoint
+            reopen_log = true;
+        } else if (!std::filesystem::exists(old_log_path)) {
+            close(index_log_fd_);
+            index_log_fd_ = -1;
+            if (rename(log_path.c_str(), old_log_path.c_str()) != 0) {
+                LOG(ERROR) << "path=" << log_path
+                           << ", error=rotate_index_log_failed, errno="
+                           << errno;
+                return tl::make_unexpected(ErrorCode::FILE_WRITE_FAIL);
+            }
+            auto open_result = OpenIndexLog();
+            if (!open_result) {
+                return open_result;
+            }
+        }
+        // Otherwise a failed checkpoint left the old log behind, and the
+        // current log keeps growing until this checkpoint replaces both
+    }
+
+    const std::string tmp_path = checkpoint_path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_CLOEXEC | O_WRONLY | O_CREAT | O_TRUNC,
+                  0644);
+    if (fd < 0) {
+        LOG(ERROR) << "path=" << tmp_path
+                   << ", error=open_index_checkpoint_failed, errno=" << errno;
+        return tl::make_unexpected(ErrorCode::FILE_OPEN_FAIL);
+    }
+    bool success = WriteAll(fd, image.data(), image.size()) && fsync(fd) == 0;
+    close(fd);
+    if (!success || rename(tmp_path.c_str(), checkpoint_path.c_str()) != 0) {
+        LOG(ERROR) << "path=" << checkpoint_path
+                   << ", error=write_index_checkpoint_failed, errno=" << errno;
+        unlink(tmp_path.c_str());
+        return tl::make_unexpected(ErrorCode::FILE_WRITE_FAIL);
+    }
+    unlink(old_log_path.c_str());
+    if (reopen_log) {
+        MutexLocker lock(&index_mutex_);
+        if (index_log_fd_ < 0) {
+            auto open_result = OpenIndexLog();
+            if (!open_result) {
+                return open_result;
+            }
+        }
+    }
+    VLOG(1) << "action=checkpoint_index, path=" << checkpoint_path
+            << ", entries=" << num_entries << ", bytes=" << image.size();
+    return {};
+}
+
+tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::RecoverIndex() {
+    const auto start_time = std::chrono::steady_clock::now();
+    const std::string log_path = GetIndexLogPath();
+
+    // Later records of a key replace earlier ones
+    std::unordered_map<std::string, IndexEntry> index;
+    auto apply = [&index, this](std::string_view key,
+                                const IndexRecordHeader& header) {
+        if (header.total_size !=
+                RecordHeader::SIZE + header.key_len + header.value_size ||
+            header.offset + header.total_size > capacity_) {
+            return;
+        }
+        index.insert_or_assign(
+            std::string(key),
+            IndexEntry{header.offset, header.total_size, header.value_size});
+    };
+    size_t num_records = 0;
+    for (const auto& path :
+         {GetIndexCheckpointPath(), log_path + ".old", log_path}) {
+        auto replay_result = ReplayIndexFile(path, capacity_, apply);
+        if (!replay_result) {
+            return tl::make_unexpected(replay_result.error());
+        }
+        num_records += replay_result.value();
+    }
+
+    std::vector<std::pair<std::string, IndexEntry>> entries(
+        std::make_move_iterator(index.begin()),
+        std::make_move_iterator(index.end()));
+    index.clear();
+    std::vector<std::pair<uint64_t, uint64_t>> buffers;
+    buffers.reserve(entries.size());
+    for (const auto& [key, entry] : entries) {
+        buffers.emplace_back(entry.offset, entry.total_size);
+    }
+    // Records get their padded extent back, as far as the next record
+    if (backend_config_.allocation_alignment) {
+        std::vector<size_t> order(buffers.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&buffers](size_t a, size_t b) {
+            return buffers[a].first < buffers[b].first;
+        });
+        for (size_t i = 0; i < order.size(); ++i) {
+            auto& [offset, size] = buffers[order[i]];
+            uint64_t limit = i + 1 < order.size()
+                                 ? buffers[order[i + 1]].first
+                                 : capacity_;
+            size = std::max<uint64_t>(
+                size, std::min<uint64_t>(AllocationSize(size),
+                                         limit > offset ? limit - offset : 0));
+        }
+    }
+    // Records overlapping one at a lower offset are dropped
+    auto handles = allocator_->rebuild(buffers);
+
+    size_t num_dropped = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (!handles[i].has_value()) {
+            ++num_dropped;
+            continue;
+        }
+        const auto& [key, entry] = entries[i];
+        auto& shard = shards_[ShardForKey(key)];
+        SharedMutexLocker lock(&shard.mutex);
+        key_filter_.Insert(key);
+        shard.map.insert_or_assign(
+            key, ObjectEntry(entry.offset, entry.total_size, entry.value_size,
+                             std::make_shared<RefCountedAllocationHandle>(
+                                 std::move(handles[i].value()),
+                                 discard_queue_)));
+        total_size_.fetch_add(entry.total_size, std::memory_order_relaxed);
+        total_keys_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    LOG(INFO) << "action=recover_index, records=" << num_records
+              << ", objects=" << entries.size() - num_dropped
+              << ", dropped=" << num_dropped << ", total_ms="
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start_time)
+                     .count();
+    return {};
+}
+
 //-----------------------------------------------------------------------------
 
 tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::Init() {
@@ -2207,7 +4047,8 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::Init() {
             return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
         }
 
-        // Clear in-memory maps (V1: no persistence, start fresh)
+        // Clear in-memory maps (restored by RecoverIndex() below when the
+        // index is persisted)
         // Lock all shards to ensure exclusive access during initialization
         {
             std::vector<std::unique_ptr<SharedMutexLocker>> shard_locks;
@@ -2219,6 +4060,7 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::Init() {
             }
             total_size_.store(0, std::memory_order_relaxed);
             total_keys_.store(0, std::memory_order_relaxed);
+            key_filter_.Clear();
         }
 
         // Get data file path
@@ -2243,9 +4085,17 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::Init() {
             int get() const { return fd; }
         };
 
-        // Open/truncate data file in read-write mode
+        // Open/truncate data file in read-write mode. A persisted index
+        // refers to the records of the existing file, which are kept.
         // We need raw fd for fallocate, so open directly
-        int flags = O_CLOEXEC | O_RDWR | O_CREAT | O_TRUNC;
+        int flags = O_CLOEXEC | O_RDWR | O_CREAT;
+        if (!backend_config_.persist_index) {
+            flags |= O_TRUNC;
+            // An index of an earlier run would describe truncated data
+            fs::remove(GetIndexCheckpointPath());
+            fs::remove(GetIndexLogPath());
+            fs::remove(GetIndexLogPath() + ".old");
+        }
         int raw_fd = open(data_file_path_.c_str(), flags, 0644);
         if (raw_fd < 0) {
             LOG(ERROR) << "Failed to open data file: " << data_file_path_;
@@ -2264,6 +4114,24 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::Init() {
             }
         }
 
+        struct stat data_file_stat;
+        if (fstat(fd_guard.get(), &data_file_stat) == 0) {
+            device_stat_path_ =
+                "/sys/dev/block/" +
+                std::to_string(major(data_file_stat.st_dev)) + ":" +
+                std::to_string(minor(data_file_stat.st_dev)) + "/stat";
+            device_written_base_ = ReadDeviceWrittenBytes();
+            if (device_written_base_ < 0) {
+                device_stat_path_.clear();
+            }
+        }
+        record_bytes_.store(0, std::memory_order_relaxed);
+        allocated_bytes_.store(0, std::memory_order_relaxed);
+        if (backend_config_.discard_batch_bytes > 0) {
+            discard_queue_ = std::make_shared<DiscardQueue>(
+                fd_guard.get(), backend_config_.discard_batch_bytes);
+        }
+
         // Release fd to PosixFile (PosixFile takes ownership and will close it)
         data_file_ =
             std::make_unique<PosixFile>(data_file_path_, fd_guard.release());
@@ -2275,7 +4143,25 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::Init() {
             return tl::make_unexpected(ErrorCode::FILE_WRITE_FAIL);
         }
 
+        if (backend_config_.persist_index) {
+            auto recover_result = RecoverIndex();
+            if (!recover_result) {
+                // Nothing was restored, the unreadable index is replaced
+                LOG(WARNING) << "Failed to recover the index of "
+                             << data_file_path_ << ": "
+                             << recover_result.error()
+                             << ", starting with an empty index";
+            }
+        }
+
         initialized_.store(true, std::memory_order_release);
+
+        // Fold the recovered logs into a checkpoint and start an empty log
+        auto checkpoint_result = CheckpointIndex();
+        if (!checkpoint_result) {
+            initialized_.store(false, std::memory_order_release);
+            return checkpoint_result;
+        }
         LOG(INFO) << "OffsetAllocatorStorageBackend initialized, capacity: "
                   << capacity_ << " bytes, data file: " << data_file_path_;
     } catch (const std::exception& e) {
@@ -2316,6 +4202,7 @@ tl::expected<int64_t, ErrorCode> OffsetAllocatorStorageBackend::BatchOffload(
     std::vector<StorageObjectMetadata> metadatas;
     keys.reserve(batch_object.size());
     metadatas.reserve(batch_object.size());
+    bool checkpoint_due = false;
 
     // Process each object in the batch; continue on individual failures to
     // support partial success
@@ -2350,7 +4237,8 @@ tl::expected<int64_t, ErrorCode> OffsetAllocatorStorageBackend::BatchOffload(
 
         // Step 1: Allocate space (allocator is thread-safe, ensures unique
         // offsets) No locks held during allocation
-        auto allocation = allocator_->allocate(record_size);
+        const uint64_t allocation_size = AllocationSize(record_size);
+        auto allocation = allocator_->allocate(allocation_size);
         if (!allocation.has_value()) {
             LOG(ERROR) << "Failed to allocate " << record_size
                        << " bytes for key: " << key
@@ -2401,9 +4289,12 @@ tl::expected<int64_t, ErrorCode> OffsetAllocatorStorageBackend::BatchOffload(
             continue;  // Continue processing other keys
         }
 
+        record_bytes_.fetch_add(record_size, std::memory_order_relaxed);
+        allocated_bytes_.fetch_add(allocation_size, std::memory_order_relaxed);
+
         // Step 3: Wrap allocation in refcounted handle
         auto allocation_ptr = std::make_shared<RefCountedAllocationHandle>(
-            std::move(allocation.value()));
+            std::move(allocation.value()), discard_queue_);
 
         // Step 4: Update metadata map under exclusive shard lock
         // Lock only the shard for this key (other shards can proceed in
@@ -2425,10 +4316,16 @@ tl::expected<int64_t, ErrorCode> OffsetAllocatorStorageBackend::BatchOffload(
                 // Physical extent freed when last reader releases it
             }
 
+            key_filter_.Insert(key);
             // Update map (insert_or_assign handles both insert and overwrite)
             shard.map.insert_or_assign(
                 key, ObjectEntry(offset, record_size, value_size,
                                  std::move(allocation_ptr)));
+            if (backend_config_.persist_index) {
+                checkpoint_due |= LogIndexEntry(
+                    key, IndexEntry{offset, static_cast<uint32_t>(record_size),
+                                    value_size});
+            }
 
             // Update total size atomically (lock-free, separate from map
             // updates)
@@ -2447,6 +4344,15 @@ tl::expected<int64_t, ErrorCode> OffsetAllocatorStorageBackend::BatchOffload(
             static_cast<int64_t>(value_size), ""});
     }
 
+    if (checkpoint_due) {
+        auto checkpoint_result = CheckpointIndex();
+        if (!checkpoint_result) {
+            LOG(WARNING) << "Index checkpoint failed: "
+                         << checkpoint_result.error()
+                         << ", the index log keeps growing until it succeeds";
+        }
+    }
+
     // Invoke complete handler only if we have successful keys to report
     if (complete_handler != nullptr && !keys.empty()) {
         auto error_code = complete_handler(keys, metadatas);
@@ -2522,20 +4428,26 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::BatchLoad(
     // Step 2: Perform disk I/O without holding any locks
     // Allocations are kept alive by shared_ptr references in read_plans
     for (const auto& plan : read_plans) {
-        // Read header first
+        // Read the header, the key and the value of the record at once,
+        // sized by the metadata, then check them against it
         RecordHeader header;
-        iovec header_iovs[2] = {{&header.key_len, sizeof(header.key_len)},
-                                {&header.value_len, sizeof(header.value_len)}};
-        auto read_header_result =
-            data_file_->vector_read(header_iovs, 2, plan.offset);
-        if (!read_header_result) {
-            LOG(ERROR) << "Failed to read header for key: " << plan.key
-                       << ", error: " << read_header_result.error();
-            return tl::make_unexpected(read_header_result.error());
-        }
-
-        if (read_header_result.value() != RecordHeader::SIZE) {
-            LOG(ERROR) << "Header read size mismatch for key: " << plan.key;
+        std::string stored_key(plan.key.size(), '\0');
+        iovec record_iovs[4] = {
+            {&header.key_len, sizeof(header.key_len)},
+            {&header.value_len, sizeof(header.value_len)},
+            {stored_key.data(), stored_key.size()},
+            {plan.dest_slice.ptr, plan.dest_slice.size}};
+        auto read_result = data_file_->vector_read(record_iovs, 4, plan.offset);
+        if (!read_result) {
+            LOG(ERROR) << "Failed to read record for key: " << plan.key
+                       << ", error: " << read_result.error();
+            return tl::make_unexpected(read_result.error());
+        }
+
+        if (read_result.value() !=
+            RecordHeader::SIZE + stored_key.size() + plan.value_size) {
+            LOG(ERROR) << "Record read size mismatch for key: " << plan.key
+                       << ", got: " << read_result.value();
             return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
         }
 
@@ -2547,44 +4459,11 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::BatchLoad(
             return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
         }
 
-        // Read key from disk
-        std::string stored_key(header.key_len, '\0');
-        iovec key_iov = {stored_key.data(), header.key_len};
-        auto read_key_result = data_file_->vector_read(
-            &key_iov, 1, plan.offset + RecordHeader::SIZE);
-        if (!read_key_result) {
-            LOG(ERROR) << "Failed to read key for: " << plan.key
-                       << ", error: " << read_key_result.error();
-            return tl::make_unexpected(read_key_result.error());
-        }
-
-        if (read_key_result.value() != header.key_len) {
-            LOG(ERROR) << "Key read size mismatch for: " << plan.key;
-            return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
-        }
-
-        // Validate key matches expected
+        // Validate key matches expected, which also checks its length
         auto validate_result = header.ValidateKey(plan.key, stored_key);
         if (!validate_result) {
             return tl::make_unexpected(validate_result.error());
         }
-
-        // Read value into destination slice
-        iovec value_iov = {plan.dest_slice.ptr, plan.dest_slice.size};
-        auto read_value_result = data_file_->vector_read(
-            &value_iov, 1, plan.offset + RecordHeader::SIZE + header.key_len);
-        if (!read_value_result) {
-            LOG(ERROR) << "Failed to read value for key: " << plan.key
-                       << ", error: " << read_value_result.error();
-            return tl::make_unexpected(read_value_result.error());
-        }
-
-        if (read_value_result.value() != header.value_len) {
-            LOG(ERROR) << "Value read size mismatch for key: " << plan.key
-                       << ", expected: " << header.value_len
-                       << ", got: " << read_value_result.value();
-            return tl::make_unexpected(ErrorCode::FILE_READ_FAIL);
-        }
     }
 
     // read_plans destructor releases all AllocationPtr references
@@ -2603,6 +4482,9 @@ tl::expected<bool, ErrorCode> OffsetAllocatorStorageBackend::IsExist(
         return tl::make_unexpected(ErrorCode::INTERNAL_ERROR);
     }
 
+    if (!key_filter_.MayContain(key)) {
+        return false;
+    }
     size_t shard_idx = ShardForKey(key);
     auto& shard = shards_[shard_idx];
     SharedMutexLocker lock(&shard.mutex, /*shared_mode=*/shared_lock);
@@ -2648,19 +4530,18 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::ScanMeta(
     std::vector<std::string> keys;
     std::vector<StorageObjectMetadata> metadatas;
 
+    // Handlers run on the pipeline threads while the shards are scanned
+    ScanMetaPipeline pipeline(handler, file_storage_config_.scanmeta_threads);
+
     // Helper function: sends accumulated keys/metadatas to handler and clears
     // buffers Called when batch size reaches scanmeta_iterator_keys_limit to
     // avoid sending all keys at once.
     auto flush = [&]() -> tl::expected<void, ErrorCode> {
-        if (keys.empty()) return {};
-        auto error_code = handler(keys, metadatas);
-        if (error_code != ErrorCode::OK) {
-            LOG(ERROR) << "ScanMeta handler failed: " << error_code;
-            return tl::make_unexpected(error_code);
-        }
+        auto submit_result =
+            pipeline.Submit(std::move(keys), std::move(metadatas));
         keys.clear();
         metadatas.clear();
-        return {};
+        return submit_result;
     };
 
     {
@@ -2713,7 +4594,7 @@ tl::expected<void, ErrorCode> OffsetAllocatorStorageBackend::ScanMeta(
         return flush_result;
     }
 
-    return {};
+    return pipeline.Finish();
 }
 
 //-----------------------------------------------------------------------------
@@ -2741,7 +4622,14 @@ CreateStorageBackend(const FileStorageConfig& config) {
                 config, file_per_key_backend_config);
         }
         case StorageBackendType::kOffsetAllocator: {
-            return std::make_shared<OffsetAllocatorStorageBackend>(config);
+            auto offset_allocator_backend_config =
+                OffsetAllocatorBackendConfig::FromEnvironment();
+            if (!offset_allocator_backend_config.Validate()) {
+                throw std::invalid_argument(
+                    "Invalid StorageBackend configuration");
+            }
+            return std::make_shared<OffsetAllocatorStorageBackend>(
+                config, offset_allocator_backend_config);
         }
         default: {
             LOG(FATAL) << "Unsupported backend type";
@@ -13,7 +13,7 @@ std::optional<Task> ScopedTaskReadAccess::find_task_by_id(
 }
 
 tl::expected<UUID, ErrorCode> ScopedTaskWriteAccess::submit_task(
-    const UUID& client_id, TaskType type, const std::string& payload) {
+    const UUID& client_id, TaskType type, TaskPayload payload) {
     if (manager_->total_pending_tasks_ >= manager_->max_total_pending_tasks_) {
         LOG(ERROR) << "Cannot submit new task: pending task limit reached ("
                    << manager_->total_pending_tasks_ << "/"
@@ -28,17 +28,17 @@ tl::expected<UUID, ErrorCode> ScopedTaskWriteAccess::submit_task(
     Task task = {.id = id,
                  .type = type,
                  .status = TaskStatus::PENDING,
-                 .payload = payload,
+                 .payload = std::move(payload),
                  .created_at = now,
                  .last_updated_at = now,
                  .message = "",
                  .assigned_client = client_id,
                  .max_retry_attempts = manager_->max_retry_attempts_};
     manager_->total_pending_tasks_++;
-    manager_->all_tasks_[task.id] = task;
-    manager_->pending_tasks_[client_id].push(task.id);
+    manager_->pending_tasks_[client_id].push(id);
+    manager_->all_tasks_.emplace(id, std::move(task));
 
-    return task.id;
+    return id;
 }
 
 std::vector<Task> ScopedTaskWriteAccess::pop_tasks(const UUID& client_id,
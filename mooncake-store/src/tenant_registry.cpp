@@ -0,0 +1,70 @@
+#include "tenant_registry.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include "master_metric_manager.h"
+#include "utils.h"
+
+namespace mooncake {
+
+void TenantRegistry::Tenant::Charge(int64_t bytes) {
+    if (bytes > 0) {
+        memory_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        MasterMetricManager::instance().inc_tenant_mem_size(name, bytes);
+    } else if (bytes < 0) {
+        memory_bytes.fetch_sub(-bytes, std::memory_order_relaxed);
+        MasterMetricManager::instance().dec_tenant_mem_size(name, -bytes);
+    }
+}
+
+tl::expected<void, ErrorCode> TenantRegistry::Configure(
+    const std::string& quotas) {
+    std::stringstream entries(quotas);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        if (entry.find_first_not_of(" \t") == std::string::npos) {
+            continue;
+        }
+        const size_t eq = entry.find('=');
+        std::string name = eq == std::string::npos ? "" : entry.substr(0, eq);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        // Zero if the quota does not parse
+        const uint64_t quota =
+            name.empty() ? 0 : string_to_byte_size(entry.substr(eq + 1));
+        if (quota == 0 || name.find('/') != std::string::npos) {
+            LOG(ERROR) << "entry=" << entry << ", error=invalid_tenant_quota";
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        if (by_name_.count(name)) {
+            LOG(ERROR) << "tenant=" << name << ", error=duplicated_tenant";
+            return tl::make_unexpected(ErrorCode::INVALID_PARAMS);
+        }
+        tenants_.push_back(std::make_unique<Tenant>(name, quota));
+        by_name_.emplace(name, tenants_.back().get());
+        // "infinite" parses to the largest uint64_t
+        constexpr uint64_t kMaxGauge = std::numeric_limits<int64_t>::max();
+        MasterMetricManager::instance().set_tenant_quota(
+            name, static_cast<int64_t>(std::min(quota, kMaxGauge)));
+        LOG(INFO) << "tenant=" << name << ", quota_bytes=" << quota;
+    }
+    return {};
+}
+
+TenantRegistry::Tenant* TenantRegistry::Find(const std::string& key) const {
+    if (tenants_.empty()) {
+        return nullptr;
+    }
+    const size_t slash = key.find('/');
+    if (slash == std::string::npos) {
+        return nullptr;
+    }
+    auto it = by_name_.find(key.substr(0, slash));
+    return it != by_name_.end() ? it->second : nullptr;
+}
+
+}  // namespace mooncake
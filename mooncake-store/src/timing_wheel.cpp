@@ -0,0 +1,66 @@
+#include "timing_wheel.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace mooncake {
+
+void TimingWheel::Schedule(std::string key, uint64_t expire_tick) {
+    // The current tick has been visited already
+    Insert(Entry{std::move(key), expire_tick}, current_tick_ + 1);
+    ++size_;
+}
+
+void TimingWheel::Insert(Entry&& entry, uint64_t min_tick) {
+    const uint64_t tick = std::max(entry.expire_tick, min_tick);
+    const uint64_t delta = tick - current_tick_;
+    size_t level = 0;
+    while (level + 1 < kLevels && delta >= (uint64_t{1} << (kSlotBits *
+                                                             (level + 1)))) {
+        ++level;
+    }
+    const size_t slot = (tick >> (kSlotBits * level)) & (kSlots - 1);
+    slots_[level][slot].push_back(std::move(entry));
+}
+
+void TimingWheel::Advance(uint64_t now_tick,
+                          std::vector<std::string>& expired) {
+    while (current_tick_ < now_tick) {
+        if (size_ == 0) {
+            current_tick_ = now_tick;
+            return;
+        }
+        ++current_tick_;
+        // Move down the slots the upper wheels turned to, from the top, so
+        // that entries cascaded twice land in a slot not yet visited
+        for (size_t level = kLevels - 1; level > 0; --level) {
+            const uint64_t span = uint64_t{1} << (kSlotBits * level);
+            if (current_tick_ % span != 0) continue;
+            auto& slot =
+                slots_[level][(current_tick_ >> (kSlotBits * level)) &
+                              (kSlots - 1)];
+            if (slot.empty()) continue;
+            auto entries = std::move(slot);
+            slot.clear();
+            for (auto& entry : entries) {
+                Insert(std::move(entry), current_tick_);
+            }
+        }
+
+        auto& slot = slots_[0][current_tick_ & (kSlots - 1)];
+        if (slot.empty()) continue;
+        auto entries = std::move(slot);
+        slot.clear();
+        for (auto& entry : entries) {
+            if (entry.expire_tick <= current_tick_) {
+                expired.push_back(std::move(entry.key));
+                --size_;
+            } else {
+                // Beyond the range of the top level when scheduled
+                Insert(std::move(entry), current_tick_ + 1);
+            }
+        }
+    }
+}
+
+}  // namespace mooncake
@@ -1,11 +1,21 @@
 #include "transfer_task.h"
 
 #include <glog/logging.h>
+#include <numa.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <cstdlib>
+#include <tuple>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "cuda_staging.h"
+#include "erasure_code.h"
+#include "request_trace.h"
 #include "transfer_engine.h"
 #include "transport/transport.h"
+#include "utils.h"
 
 namespace mooncake {
 
@@ -15,6 +25,10 @@ namespace mooncake {
 // to fully utilize the available ssd bandwidth, we use a default of 10 worker
 // threads.
 constexpr int kDefaultFilereadWorkers = 10;
+// Reads of disk replicas in flight when io_uring is used
+constexpr int64_t kDefaultIoUringDepth = 128;
+// Reads of one cuFile batch when disk replicas are read into GPU memory
+constexpr int64_t kDefaultGdsBatchSize = 128;
 
 FilereadWorkerPool::FilereadWorkerPool(std::shared_ptr<StorageBackend>& backend)
     : shutdown_(false) {
@@ -119,89 +133,215 @@ void FilereadWorkerPool::workerThread() {
 // ============================================================================
 // MemcpyWorkerPool Implementation
 // ============================================================================
-// Since memcpy is bound by memory bandwidth, we only need one worker thread.
-constexpr int kDefaultMemcpyWorkers = 1;
+namespace {
+
+constexpr int64_t kDefaultMemcpyWorkersPerNode = 4;
+constexpr int64_t kDefaultMemcpyChunkSize = 4 * 1024 * 1024;
+constexpr int64_t kDefaultMemcpyNonTemporalThreshold = 8 * 1024 * 1024;
+constexpr int64_t kMinMemcpyChunkSize = 64 * 1024;
+
+// memcpy with streaming stores, so that a large copy does not evict the data
+// of other threads from the cache on its way through.
+void NonTemporalMemcpy(void* dest, const void* src, size_t size) {
+#if defined(__x86_64__)
+    auto* d = static_cast<char*>(dest);
+    auto* s = static_cast<const char*>(src);
+    const size_t head =
+        std::min(size, (16 - reinterpret_cast<uintptr_t>(d) % 16) % 16);
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+        const auto* in = reinterpret_cast<const __m128i*>(s);
+        auto* out = reinterpret_cast<__m128i*>(d);
+        __m128i v0 = _mm_loadu_si128(in);
+        __m128i v1 = _mm_loadu_si128(in + 1);
+        __m128i v2 = _mm_loadu_si128(in + 2);
+        __m128i v3 = _mm_loadu_si128(in + 3);
+        _mm_stream_si128(out, v0);
+        _mm_stream_si128(out + 1, v1);
+        _mm_stream_si128(out + 2, v2);
+        _mm_stream_si128(out + 3, v3);
+    }
+    std::memcpy(d, s, size);
+    // Order the streaming stores before the completion is published
+    _mm_sfence();
+#else
+    std::memcpy(dest, src, size);
+#endif
+}
+
+// NUMA node of the page holding addr, or a negative value if unknown
+int GetNumaNode(const void* addr) {
+    static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    void* page = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(addr) &
+                                         ~(page_size - 1));
+    int status = -1;
+    if (numa_move_pages(0, 1, &page, nullptr, &status, 0) != 0) {
+        return -1;
+    }
+    return status;
+}
+
+}  // namespace
 
 MemcpyWorkerPool::MemcpyWorkerPool() : shutdown_(false) {
-    VLOG(1) << "Creating MemcpyWorkerPool with " << kDefaultMemcpyWorkers
-            << " workers";
+    const int64_t workers_per_node = std::max<int64_t>(
+        1, GetEnvOr<int64_t>("MC_STORE_MEMCPY_WORKERS",
+                             kDefaultMemcpyWorkersPerNode));
+    chunk_size_ = std::max<int64_t>(
+        kMinMemcpyChunkSize,
+        GetEnvOr<int64_t>("MC_STORE_MEMCPY_CHUNK_SIZE",
+                          kDefaultMemcpyChunkSize));
+    non_temporal_threshold_ = std::max<int64_t>(
+        0, GetEnvOr<int64_t>("MC_STORE_MEMCPY_NT_THRESHOLD",
+                             kDefaultMemcpyNonTemporalThreshold));
+
+    // One group per node with CPUs. Memory-only nodes are copied by group 0.
+    if (numa_available() >= 0) {
+        const int max_node = numa_max_node();
+        node_to_group_.assign(max_node + 1, 0);
+        struct bitmask* cpus = numa_allocate_cpumask();
+        for (int node = 0; node <= max_node; ++node) {
+            if (numa_node_to_cpus(node, cpus) != 0 ||
+                numa_bitmask_weight(cpus) == 0) {
+                continue;
+            }
+            node_to_group_[node] = groups_.size();
+            groups_.push_back(std::make_unique<WorkerGroup>());
+            groups_.back()->numa_node = node;
+        }
+        numa_free_cpumask(cpus);
+    }
+    if (groups_.empty()) {
+        node_to_group_.clear();
+        groups_.push_back(std::make_unique<WorkerGroup>());
+        groups_.back()->numa_node = -1;
+    }
+
+    VLOG(1) << "Creating MemcpyWorkerPool with " << groups_.size()
+            << " NUMA groups of " << workers_per_node << " workers";
 
     // Start worker threads
-    workers_.reserve(kDefaultMemcpyWorkers);
-    for (int i = 0; i < kDefaultMemcpyWorkers; ++i) {
-        workers_.emplace_back(&MemcpyWorkerPool::workerThread, this);
+    for (auto& group : groups_) {
+        group->workers.reserve(workers_per_node);
+        for (int64_t i = 0; i < workers_per_node; ++i) {
+            group->workers.emplace_back(&MemcpyWorkerPool::workerThread, this,
+                                        group.get());
+        }
     }
 }
 
 MemcpyWorkerPool::~MemcpyWorkerPool() {
     // Signal shutdown
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        shutdown_.store(true);
+    shutdown_.store(true);
+    for (auto& group : groups_) {
+        {
+            std::lock_guard<std::mutex> lock(group->queue_mutex);
+        }
+        group->queue_cv.notify_all();
     }
-    queue_cv_.notify_all();
 
     // Wait for all workers to finish
-    for (auto& worker : workers_) {
-        if (worker.joinable()) {
-            worker.join();
+    for (auto& group : groups_) {
+        for (auto& worker : group->workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
         }
     }
 
     VLOG(1) << "MemcpyWorkerPool destroyed";
 }
 
+MemcpyWorkerPool::WorkerGroup& MemcpyWorkerPool::selectGroup(
+    const void* addr) {
+    if (groups_.size() == 1) {
+        return *groups_[0];
+    }
+    const int node = GetNumaNode(addr);
+    if (node >= 0 && static_cast<size_t>(node) < node_to_group_.size()) {
+        return *groups_[node_to_group_[node]];
+    }
+    // Not faulted in yet, spread over the nodes
+    return *groups_[next_group_.fetch_add(1) % groups_.size()];
+}
+
 void MemcpyWorkerPool::submitTask(MemcpyTask task) {
+    auto progress = std::make_shared<TaskProgress>();
+    progress->state = std::move(task.state);
+
+    std::vector<Chunk> chunks;
+    for (const auto& op : task.operations) {
+        const bool non_temporal =
+            non_temporal_threshold_ > 0 && op.size >= non_temporal_threshold_;
+        for (size_t offset = 0; offset < op.size; offset += chunk_size_) {
+            chunks.push_back(Chunk{static_cast<char*>(op.dest) + offset,
+                                   static_cast<const char*>(op.src) + offset,
+                                   std::min(chunk_size_, op.size - offset),
+                                   non_temporal, progress});
+        }
+    }
+    if (chunks.empty()) {
+        progress->state->set_completed(ErrorCode::OK);
+        return;
+    }
+    progress->remaining.store(chunks.size());
+
+    WorkerGroup& group = selectGroup(chunks.front().dest);
     {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
+        std::lock_guard<std::mutex> lock(group.queue_mutex);
         if (shutdown_.load()) {
             LOG(WARNING)
                 << "Attempting to submit task to shutdown MemcpyWorkerPool";
-            task.state->set_completed(ErrorCode::TRANSFER_FAIL);
+            progress->state->set_completed(ErrorCode::TRANSFER_FAIL);
             return;
         }
-        task_queue_.push(std::move(task));
+        for (auto& chunk : chunks) {
+            group.chunk_queue.push(std::move(chunk));
+        }
+    }
+    if (chunks.size() == 1) {
+        group.queue_cv.notify_one();
+    } else {
+        group.queue_cv.notify_all();
     }
-    queue_cv_.notify_one();
 }
 
-void MemcpyWorkerPool::workerThread() {
-    VLOG(2) << "MemcpyWorkerPool worker thread started";
+void MemcpyWorkerPool::workerThread(WorkerGroup* group) {
+    if (group->numa_node >= 0) {
+        bindToSocket(group->numa_node);
+    }
+    VLOG(2) << "MemcpyWorkerPool worker thread started on NUMA node "
+            << group->numa_node;
 
     while (true) {
-        MemcpyTask task({}, nullptr);
+        Chunk chunk{};
 
-        // Wait for task or shutdown signal
+        // Wait for a chunk or shutdown signal
         {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            queue_cv_.wait(lock, [this] {
-                return shutdown_.load() || !task_queue_.empty();
+            std::unique_lock<std::mutex> lock(group->queue_mutex);
+            group->queue_cv.wait(lock, [this, group] {
+                return shutdown_.load() || !group->chunk_queue.empty();
             });
 
-            if (shutdown_.load() && task_queue_.empty()) {
+            // Queued chunks are drained before exiting
+            if (group->chunk_queue.empty()) {
                 break;
             }
-
-            if (!task_queue_.empty()) {
-                task = std::move(task_queue_.front());
-                task_queue_.pop();
-            }
+            chunk = std::move(group->chunk_queue.front());
+            group->chunk_queue.pop();
         }
 
-        // Execute the task if we have one
-        if (task.state) {
-            try {
-                for (const auto& op : task.operations) {
-                    std::memcpy(op.dest, op.src, op.size);
-                }
-
-                VLOG(2) << "Memcpy task completed successfully with "
-                        << task.operations.size() << " operations";
-                task.state->set_completed(ErrorCode::OK);
-            } catch (const std::exception& e) {
-                LOG(ERROR) << "Exception during async memcpy: " << e.what();
-                task.state->set_completed(ErrorCode::TRANSFER_FAIL);
-            }
+        if (chunk.non_temporal) {
+            NonTemporalMemcpy(chunk.dest, chunk.src, chunk.size);
+        } else {
+            std::memcpy(chunk.dest, chunk.src, chunk.size);
+        }
+        if (chunk.progress->remaining.fetch_sub(1) == 1) {
+            VLOG(2) << "Memcpy task completed successfully";
+            chunk.progress->state->set_completed(ErrorCode::OK);
         }
     }
 
@@ -342,6 +482,29 @@ void TransferEngineOperationState::wait_for_completion() {
                    << " seconds for batch " << batch_id_;
     }
 #else
+    if (completion_notify_) {
+        Status s =
+            engine_.waitBatchCompletion(batch_id_, timeout_seconds * 1000);
+        if (s.ok()) {
+            // Settles the status of the tasks, which are all finished
+            std::lock_guard<std::mutex> lock(mutex_);
+            check_task_status();
+            if (!result_.has_value()) set_result_internal(ErrorCode::OK);
+            VLOG(1) << "Transfer engine operation completed for batch "
+                    << batch_id_
+                    << " with result: " << static_cast<int>(result_.value());
+            return;
+        }
+        if (s.IsBatchBusy()) {
+            LOG(ERROR) << "Failed to complete transfers after "
+                       << timeout_seconds << " seconds for batch " << batch_id_;
+            std::lock_guard<std::mutex> lock(mutex_);
+            set_result_internal(ErrorCode::TRANSFER_FAIL);
+            return;
+        }
+        // The batch is not signalled after all, poll it
+    }
+
     VLOG(1) << "Starting transfer engine polling for batch " << batch_id_;
 
     constexpr int64_t kOneSecondInNano = 1000 * 1000 * 1000;
@@ -371,6 +534,47 @@ void TransferEngineOperationState::wait_for_completion() {
 #endif
 }
 
+void TransferEngineOperationState::wait_for_completion_until(
+    Deadline deadline) {
+    if (deadline == kNoDeadline) {
+        wait_for_completion();
+        return;
+    }
+    while (!is_completed()) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+#ifndef USE_EVENT_DRIVEN_COMPLETION
+        if (!completion_notify_) {
+            continue;
+        }
+#endif
+        // Any error, e.g. of a batch that must be polled after all, is
+        // settled by is_completed
+        engine_.waitBatchCompletion(
+            batch_id_,
+            std::chrono::ceil<std::chrono::milliseconds>(deadline - now)
+                .count());
+    }
+    if (is_completed()) {
+        return;
+    }
+
+    LOG(WARNING) << "Canceling the pending transfers of batch " << batch_id_
+                 << " at their deadline";
+    Status s = engine_.cancelBatch(batch_id_);
+    if (!s.ok()) {
+        VLOG(1) << "Failed to cancel batch " << batch_id_ << ": "
+                << s.message();
+    }
+    wait_for_completion();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (result_ != ErrorCode::OK) {
+        result_ = ErrorCode::TRANSFER_TIMEOUT;
+    }
+}
+
 // ============================================================================
 // TransferFuture Implementation
 // ============================================================================
@@ -387,28 +591,199 @@ bool TransferFuture::isReady() const { return state_->is_completed(); }
 
 ErrorCode TransferFuture::wait() {
     if (!isReady()) {
+        TraceSpan span("TransferFuture::wait");
         state_->wait_for_completion();
     }
     return state_->get_result();
 }
 
+ErrorCode TransferFuture::waitUntil(Deadline deadline) {
+    if (!isReady()) {
+        TraceSpan span("TransferFuture::wait");
+        state_->wait_for_completion_until(deadline);
+    }
+    return state_->get_result();
+}
+
 ErrorCode TransferFuture::get() { return wait(); }
 
 TransferStrategy TransferFuture::strategy() const {
     return state_->get_strategy();
 }
 
+bool ErasureCodedOperationState::is_completed() {
+    if (!future_.isReady()) {
+        return false;
+    }
+    finish();
+    return true;
+}
+
+void ErasureCodedOperationState::wait_for_completion() {
+    future_.wait();
+    finish();
+}
+
+void ErasureCodedOperationState::wait_for_completion_until(
+    Deadline deadline) {
+    future_.waitUntil(deadline);
+    finish();
+}
+
+void ErasureCodedOperationState::finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (result_.has_value()) {
+        return;
+    }
+    ErrorCode result = future_.get();
+    if (result == ErrorCode::OK && on_complete_) {
+        result = on_complete_();
+    }
+    buffers_.clear();
+    result_.emplace(result);
+}
+
 // ============================================================================
 // TransferSubmitter Implementation
 // ============================================================================
 
+namespace {
+
+// Buffer for the parity and degraded reads of erasure coded replicas
+constexpr size_t kDefaultErasureCodeBufferSize = 256 * 1024 * 1024;
+
+// Stripes [begin, end) of mem_desc as a descriptor without parity
+MemoryDescriptor SelectStripes(const MemoryDescriptor& mem_desc, size_t begin,
+                               size_t end) {
+    MemoryDescriptor selected;
+    selected.buffer_descriptor = mem_desc.stripe(begin);
+    for (size_t i = begin + 1; i < end; ++i) {
+        selected.extra_stripes.push_back(mem_desc.stripe(i));
+    }
+    return selected;
+}
+
+bool HasLostStripe(const MemoryDescriptor& mem_desc) {
+    for (size_t i = 0; i < 1 + mem_desc.extra_stripes.size(); ++i) {
+        if (mem_desc.stripe(i).transport_endpoint_.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Encode the parity of the data stripes of mem_desc, which are laid out in
+// slices, into the zeroed parity stripes.
+void EncodeParity(const ReedSolomonCode& code, const MemoryDescriptor& mem_desc,
+                  const std::vector<Slice>& slices,
+                  const std::vector<uint8_t*>& parity, uint64_t parity_len) {
+    // The contiguous pieces of every data stripe in the slices
+    struct Piece {
+        const uint8_t* ptr;
+        uint64_t len;
+    };
+    const size_t num_data = code.data_shards();
+    std::vector<std::vector<Piece>> pieces(num_data);
+    size_t slice_index = 0;
+    uint64_t slice_offset = 0;
+    for (size_t i = 0; i < num_data; ++i) {
+        uint64_t remaining = mem_desc.stripe(i).size_;
+        while (remaining > 0) {
+            const auto& slice = slices[slice_index];
+            const uint64_t len =
+                std::min<uint64_t>(slice.size - slice_offset, remaining);
+            if (len > 0) {
+                pieces[i].push_back(
+                    {static_cast<const uint8_t*>(slice.ptr) + slice_offset,
+                     len});
+            }
+            remaining -= len;
+            slice_offset += len;
+            if (slice_offset == slice.size) {
+                slice_index++;
+                slice_offset = 0;
+            }
+        }
+    }
+
+    // Encode the longest ranges that are contiguous in every data stripe.
+    // Short stripes are padded with zeros.
+    std::vector<size_t> piece_index(num_data, 0);
+    std::vector<uint64_t> piece_offset(num_data, 0);
+    std::vector<const uint8_t*> data(num_data);
+    std::vector<uint8_t*> parity_at(parity.size());
+    for (uint64_t offset = 0; offset < parity_len;) {
+        uint64_t run = parity_len - offset;
+        for (size_t i = 0; i < num_data; ++i) {
+            if (piece_index[i] == pieces[i].size()) {
+                data[i] = nullptr;
+                continue;
+            }
+            const auto& piece = pieces[i][piece_index[i]];
+            data[i] = piece.ptr + piece_offset[i];
+            run = std::min(run, piece.len - piece_offset[i]);
+        }
+        for (size_t j = 0; j < parity.size(); ++j) {
+            parity_at[j] = parity[j] + offset;
+        }
+        code.Encode(data, parity_at, run);
+        for (size_t i = 0; i < num_data; ++i) {
+            if (data[i] == nullptr) {
+                continue;
+            }
+            piece_offset[i] += run;
+            if (piece_offset[i] == pieces[i][piece_index[i]].len) {
+                piece_index[i]++;
+                piece_offset[i] = 0;
+            }
+        }
+        offset += run;
+    }
+}
+
+// Merge the requests of a batch that continue one another both locally and
+// remotely, e.g. those of objects put together and read into one buffer.
+// Requests of a batch are independent, so they may be reordered.
+void MergeAdjacentRequests(std::vector<TransferRequest>& requests) {
+    if (requests.size() < 2) {
+        return;
+    }
+    std::sort(requests.begin(), requests.end(),
+              [](const TransferRequest& a, const TransferRequest& b) {
+                  return std::tie(a.target_id, a.target_offset) <
+                         std::tie(b.target_id, b.target_offset);
+              });
+    const auto plain = [](const TransferRequest& request) {
+        return request.source_iov == nullptr && request.block_count == 0 &&
+               !request.isAtomic();
+    };
+    size_t merged = 0;
+    for (size_t i = 1; i < requests.size(); ++i) {
+        auto& last = requests[merged];
+        const auto& next = requests[i];
+        if (plain(last) && plain(next) && last.opcode == next.opcode &&
+            last.target_id == next.target_id &&
+            last.target_offset + last.length == next.target_offset &&
+            static_cast<char*>(last.source) + last.length == next.source) {
+            last.length += next.length;
+        } else {
+            requests[++merged] = next;
+        }
+    }
+    requests.resize(merged + 1);
+}
+
+}  // namespace
+
 TransferSubmitter::TransferSubmitter(TransferEngine& engine,
                                      std::shared_ptr<StorageBackend>& backend,
-                                     TransferMetric* transfer_metric)
+                                     TransferMetric* transfer_metric,
+                                     SegmentTrafficCounter* traffic_counter)
     : engine_(engine),
       memcpy_pool_(std::make_unique<MemcpyWorkerPool>()),
       fileread_pool_(std::make_unique<FilereadWorkerPool>(backend)),
-      transfer_metric_(transfer_metric) {
+      transfer_metric_(transfer_metric),
+      traffic_counter_(traffic_counter) {
     // Read MC_STORE_MEMCPY environment variable, default to false (disabled)
     const char* env_value = std::getenv("MC_STORE_MEMCPY");
     if (env_value == nullptr) {
@@ -431,23 +806,69 @@ TransferSubmitter::TransferSubmitter(TransferEngine& engine,
         }
     }
 
+#ifdef USE_3FS
+    const bool is_3fs = backend && backend->is_3fs_dir_;
+#else
+    const bool is_3fs = false;
+#endif
+    // 3FS files are read through its own USRBIO path
+    if (backend && !is_3fs && GetEnvOr<int64_t>("MC_STORE_IO_URING", 1) != 0) {
+        uring_reader_ = UringFileReader::Create(std::max<int64_t>(
+            1, GetEnvOr<int64_t>("MC_STORE_IO_URING_DEPTH",
+                                 kDefaultIoUringDepth)));
+    }
+    if (backend && !is_3fs && GetEnvOr<int64_t>("MC_STORE_GDS", 1) != 0) {
+        gds_reader_ = GdsFileReader::Create(std::clamp<int64_t>(
+            GetEnvOr<int64_t>("MC_STORE_GDS_BATCH_SIZE", kDefaultGdsBatchSize),
+            1, kDefaultGdsBatchSize));
+    }
+
     VLOG(1) << "TransferSubmitter initialized with memcpy_enabled="
-            << memcpy_enabled_;
+            << memcpy_enabled_ << ", io_uring=" << (uring_reader_ != nullptr)
+            << ", gds=" << (gds_reader_ != nullptr);
+}
+
+TransferSubmitter::~TransferSubmitter() {
+    if (ec_buffer_allocator_) {
+        engine_.unregisterLocalMemory(ec_buffer_allocator_->getBase());
+    }
 }
 
 std::optional<TransferFuture> TransferSubmitter::submit(
     const Replica::Descriptor& replica, std::vector<Slice>& slices,
-    TransferRequest::OpCode op_code) {
+    TransferRequest::OpCode op_code, TransferRequest::Priority priority) {
+    TraceSpan span("TransferSubmitter::submit");
     std::optional<TransferFuture> future;
 
     if (replica.is_memory_replica()) {
         auto& mem_desc = replica.get_memory_descriptor();
         auto& handle = mem_desc.buffer_descriptor;
 
-        if (!validateTransferParams(handle, slices)) {
+        if (!validateTransferParams(mem_desc, slices)) {
             return std::nullopt;
         }
 
+        if (mem_desc.is_erasure_coded()) {
+            future = submitErasureCodedOperation(mem_desc, slices, op_code,
+                                                 priority);
+            if (future.has_value()) {
+                updateTransferMetrics(slices, op_code);
+            }
+            return future;
+        }
+
+        if (mem_desc.is_striped()) {
+            std::vector<TransferRequest> requests;
+            if (!appendStripedRequests(mem_desc, slices, op_code, requests)) {
+                return std::nullopt;
+            }
+            future = submitTransfer(requests, priority);
+            if (future.has_value()) {
+                updateTransferMetrics(slices, op_code);
+            }
+            return future;
+        }
+
         TransferStrategy strategy = selectStrategy(handle, slices);
 
         switch (strategy) {
@@ -455,7 +876,9 @@ std::optional<TransferFuture> TransferSubmitter::submit(
                 future = submitMemcpyOperation(handle, slices, op_code);
                 break;
             case TransferStrategy::TRANSFER_ENGINE:
-                future = submitTransferEngineOperation(handle, slices, op_code);
+            case TransferStrategy::INTRA_NODE_COPY:
+                future = submitTransferEngineOperation(handle, slices, op_code,
+                                                       priority);
                 break;
             default:
                 LOG(ERROR) << "Unknown transfer strategy: " << strategy;
@@ -473,39 +896,68 @@ std::optional<TransferFuture> TransferSubmitter::submit(
     return future;
 }
 
+bool TransferSubmitter::isBatchable(const Replica::Descriptor& replica,
+                                    const std::vector<Slice>& slices) const {
+    if (!replica.is_memory_replica()) {
+        return false;
+    }
+    const auto& mem_desc = replica.get_memory_descriptor();
+    const auto& handle = mem_desc.buffer_descriptor;
+    return !mem_desc.is_striped() && !handle.transport_endpoint_.empty() &&
+           validateTransferParams(mem_desc, slices) &&
+           selectStrategy(handle, slices) != TransferStrategy::LOCAL_MEMCPY;
+}
+
 std::optional<TransferFuture> TransferSubmitter::submit_batch(
     const std::vector<Replica::Descriptor>& replicas,
     std::vector<std::vector<Slice>>& all_slices,
-    TransferRequest::OpCode op_code) {
+    TransferRequest::OpCode op_code, TransferRequest::Priority priority) {
+    TraceSpan span("TransferSubmitter::submit_batch");
     std::optional<TransferFuture> future;
     std::vector<TransferRequest> requests;
+    std::vector<std::vector<iovec>> iov_lists(replicas.size());
     for (size_t i = 0; i < replicas.size(); ++i) {
         auto& replica = replicas[i];
         auto& slices = all_slices[i];
         auto& mem_desc = replica.get_memory_descriptor();
-        if (!validateTransferParams(mem_desc.buffer_descriptor, slices)) {
+        if (!validateTransferParams(mem_desc, slices)) {
             return std::nullopt;
         }
+        if (mem_desc.is_erasure_coded()) {
+            // Without parity to encode or stripes to decode, only the data
+            // stripes are read.
+            const auto data_stripes = SelectStripes(mem_desc, 0,
+                                                    mem_desc.data_stripes());
+            if (op_code != TransferRequest::READ ||
+                HasLostStripe(data_stripes) ||
+                !appendStripedRequests(data_stripes, slices, op_code,
+                                       requests)) {
+                LOG(ERROR) << "Batched transfer of erasure coded replica is "
+                              "only supported for reads without lost stripes";
+                return std::nullopt;
+            }
+            continue;
+        }
+        if (mem_desc.is_striped()) {
+            if (!appendStripedRequests(mem_desc, slices, op_code, requests)) {
+                return std::nullopt;
+            }
+            continue;
+        }
         auto& handle = mem_desc.buffer_descriptor;
-        uint64_t offset = 0;
         SegmentHandle seg = engine_.openSegment(handle.transport_endpoint_);
         if (seg == static_cast<uint64_t>(ERR_INVALID_ARGUMENT)) {
             LOG(ERROR) << "Failed to open segment "
                        << handle.transport_endpoint_;
             return std::nullopt;
         }
-        for (auto slice : slices) {
-            TransferRequest request;
-            request.opcode = op_code;
-            request.source = static_cast<char*>(slice.ptr);
-            request.target_id = seg;
-            request.target_offset = handle.buffer_address_ + offset;
-            request.length = slice.size;
-            requests.emplace_back(request);
-            offset += slice.size;
-        }
+        uint64_t offset = appendContiguousRequests(
+            slices, seg, handle.buffer_address_, op_code, iov_lists[i],
+            requests);
+        recordTraffic(handle.transport_endpoint_, offset, op_code);
     }
-    future = submitTransfer(requests);
+    MergeAdjacentRequests(requests);
+    future = submitTransfer(requests, priority);
     // Update metrics on successful submission
     if (future.has_value()) {
         for (auto& slices : all_slices) {
@@ -538,13 +990,15 @@ TransferSubmitter::submit_batch_get_offload_object(
         request.target_offset = pointer;
         request.length = slice.size;
         requests.emplace_back(request);
+        recordTraffic(transfer_engine_addr, slice.size, TransferRequest::READ);
     }
-    return submitTransfer(requests);
+    return submitTransfer(requests, TransferRequest::HIGH);
 }
 
 std::optional<TransferFuture> TransferSubmitter::submitMemcpyOperation(
     const AllocatedBuffer::Descriptor& handle, const std::vector<Slice>& slices,
     const TransferRequest::OpCode op_code) {
+    TraceSpan span("TransferSubmitter::submitMemcpyOperation");
     auto state = std::make_shared<MemcpyOperationState>();
 
     // Create memcpy operations
@@ -587,8 +1041,48 @@ std::optional<TransferFuture> TransferSubmitter::submitMemcpyOperation(
     return TransferFuture(state);
 }
 
+void TransferSubmitter::recordTraffic(const std::string& endpoint,
+                                      uint64_t bytes,
+                                      TransferRequest::OpCode op_code) {
+    if (traffic_counter_ != nullptr && bytes > 0) {
+        traffic_counter_->record(endpoint, bytes, op_code);
+    }
+}
+
+void SegmentTrafficCounter::record(const std::string& endpoint,
+                                   uint64_t bytes,
+                                   TransferRequest::OpCode op_code) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& traffic = traffic_[endpoint];
+    if (op_code == TransferRequest::READ) {
+        traffic.read_bytes += bytes;
+    } else {
+        traffic.write_bytes += bytes;
+    }
+}
+
+std::vector<SegmentTraffic> SegmentTrafficCounter::take() {
+    std::unordered_map<std::string, SegmentTraffic> traffic;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        traffic.swap(traffic_);
+    }
+    std::vector<SegmentTraffic> result;
+    result.reserve(traffic.size());
+    for (auto& [endpoint, entry] : traffic) {
+        entry.endpoint = endpoint;
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
 std::optional<TransferFuture> TransferSubmitter::submitTransfer(
-    std::vector<TransferRequest>& requests) {
+    std::vector<TransferRequest>& requests,
+    TransferRequest::Priority priority) {
+    TraceSpan span("TransferSubmitter::submitTransfer");
+    for (auto& request : requests) {
+        request.priority = priority;
+    }
     // Allocate batch ID
     const size_t batch_size = requests.size();
     BatchID batch_id = engine_.allocateBatchID(batch_size);
@@ -597,6 +1091,15 @@ std::optional<TransferFuture> TransferSubmitter::submitTransfer(
         return std::nullopt;
     }
 
+#ifndef USE_EVENT_DRIVEN_COMPLETION
+    // Lets wait_for_completion() block until the engine signals the batch;
+    // it falls back to polling if a transport cannot signal completions
+    bool completion_notify =
+        engine_.enableBatchCompletionNotify(batch_id).ok();
+#else
+    bool completion_notify = false;
+#endif
+
     // Submit transfer
     Status s = engine_.submitTransfer(batch_id, requests);
     if (!s.ok()) {
@@ -617,14 +1120,15 @@ std::optional<TransferFuture> TransferSubmitter::submitTransfer(
     // Create state with transfer engine context - no polling thread
     // needed
     auto state = std::make_shared<TransferEngineOperationState>(
-        engine_, batch_id, batch_size);
+        engine_, batch_id, batch_size, completion_notify);
 
     return TransferFuture(state);
 }
 
 std::optional<TransferFuture> TransferSubmitter::submitTransferEngineOperation(
     const AllocatedBuffer::Descriptor& handle, const std::vector<Slice>& slices,
-    const TransferRequest::OpCode op_code) {
+    const TransferRequest::OpCode op_code, TransferRequest::Priority priority) {
+    TraceSpan span("TransferSubmitter::submitTransferEngineOperation");
     if (handle.transport_endpoint_.empty()) {
         LOG(ERROR) << "Transport endpoint is empty for handle with address "
                    << handle.buffer_address_;
@@ -640,35 +1144,288 @@ std::optional<TransferFuture> TransferSubmitter::submitTransferEngineOperation(
 
     // Create transfer requests
     std::vector<TransferRequest> requests;
-    requests.reserve(slices.size());
-    uint64_t base_address = static_cast<uint64_t>(handle.buffer_address_);
-    uint64_t offset = 0;
+    std::vector<iovec> iov;
+    uint64_t offset = appendContiguousRequests(
+        slices, seg, static_cast<uint64_t>(handle.buffer_address_), op_code,
+        iov, requests);
+    recordTraffic(handle.transport_endpoint_, offset, op_code);
+    return submitTransfer(requests, priority);
+}
 
-    for (size_t i = 0; i < slices.size(); ++i) {
-        const auto& slice = slices[i];
+uint64_t TransferSubmitter::appendContiguousRequests(
+    const std::vector<Slice>& slices, SegmentHandle seg, uint64_t target_offset,
+    const TransferRequest::OpCode op_code, std::vector<iovec>& iov,
+    std::vector<TransferRequest>& requests) {
+    TransferRequest request;
+    request.opcode = op_code;
+    request.target_id = seg;
+    request.target_offset = target_offset;
+    request.length = 0;
+    iov.clear();
+    for (const auto& slice : slices) {
         if (slice.ptr == nullptr) continue;
+        iov.push_back(iovec{slice.ptr, slice.size});
+        request.length += slice.size;
+    }
+    if (iov.size() > 1 && engine_.supportsScatterGather()) {
+        // A single request, whose slices share WRs on RDMA
+        request.source = iov[0].iov_base;
+        request.source_iov = iov.data();
+        request.source_iov_count = iov.size();
+        requests.emplace_back(request);
+        return request.length;
+    }
+    uint64_t offset = 0;
+    for (const auto& entry : iov) {
+        request.source = entry.iov_base;
+        request.target_offset = target_offset + offset;
+        request.length = entry.iov_len;
+        requests.emplace_back(request);
+        offset += entry.iov_len;
+    }
+    return offset;
+}
 
-        TransferRequest request;
-        request.opcode = op_code;
-        request.source = static_cast<char*>(slice.ptr);
-        request.target_id = seg;
-        request.target_offset = base_address + offset;
-        request.length = slice.size;
+bool TransferSubmitter::appendStripedRequests(
+    const MemoryDescriptor& mem_desc, const std::vector<Slice>& slices,
+    const TransferRequest::OpCode op_code,
+    std::vector<TransferRequest>& requests) {
+    std::vector<const AllocatedBuffer::Descriptor*> stripes;
+    stripes.push_back(&mem_desc.buffer_descriptor);
+    for (const auto& stripe : mem_desc.extra_stripes) {
+        stripes.push_back(&stripe);
+    }
 
-        offset += slice.size;
-        requests.emplace_back(request);
+    // The slices cover the stripes exactly, see validateTransferParams.
+    size_t slice_index = 0;
+    uint64_t slice_offset = 0;
+    for (const auto* stripe : stripes) {
+        if (stripe->transport_endpoint_.empty()) {
+            LOG(ERROR) << "Transport endpoint is empty for stripe with address "
+                       << stripe->buffer_address_;
+            return false;
+        }
+        SegmentHandle seg = engine_.openSegment(stripe->transport_endpoint_);
+        if (seg == static_cast<uint64_t>(ERR_INVALID_ARGUMENT)) {
+            LOG(ERROR) << "Failed to open segment for endpoint='"
+                       << stripe->transport_endpoint_ << "'";
+            return false;
+        }
+
+        uint64_t stripe_offset = 0;
+        while (stripe_offset < stripe->size_) {
+            const auto& slice = slices[slice_index];
+            const uint64_t length = std::min<uint64_t>(
+                slice.size - slice_offset, stripe->size_ - stripe_offset);
+            if (length > 0) {
+                TransferRequest request;
+                request.opcode = op_code;
+                request.source = static_cast<char*>(slice.ptr) + slice_offset;
+                request.target_id = seg;
+                request.target_offset = stripe->buffer_address_ + stripe_offset;
+                request.length = length;
+                requests.emplace_back(request);
+            }
+            stripe_offset += length;
+            slice_offset += length;
+            if (slice_offset == slice.size) {
+                slice_index++;
+                slice_offset = 0;
+            }
+        }
+        recordTraffic(stripe->transport_endpoint_, stripe->size_, op_code);
+    }
+    return true;
+}
+
+std::optional<BufferHandle> TransferSubmitter::allocateErasureCodeBuffer(
+    size_t size) {
+    std::lock_guard<std::mutex> lock(ec_buffer_mutex_);
+    if (!ec_buffer_allocator_) {
+        const size_t buffer_size = std::max<int64_t>(
+            GetEnvOr<int64_t>("MC_STORE_EC_BUFFER_SIZE",
+                              kDefaultErasureCodeBufferSize),
+            1);
+        auto allocator = ClientBufferAllocator::create(buffer_size);
+        if (engine_.registerLocalMemory(allocator->getBase(), buffer_size) !=
+            0) {
+            LOG(ERROR) << "Failed to register erasure code buffer of size "
+                       << buffer_size;
+            return std::nullopt;
+        }
+        ec_buffer_allocator_ = std::move(allocator);
+    }
+    auto buffer = ec_buffer_allocator_->allocate(size);
+    if (!buffer) {
+        LOG(ERROR) << "Failed to allocate " << size
+                   << " bytes of erasure code buffer, consider raising "
+                      "MC_STORE_EC_BUFFER_SIZE";
+    }
+    return buffer;
+}
+
+std::optional<TransferFuture> TransferSubmitter::submitErasureCodedOperation(
+    const MemoryDescriptor& mem_desc, const std::vector<Slice>& slices,
+    const TransferRequest::OpCode op_code, TransferRequest::Priority priority) {
+    TraceSpan span("TransferSubmitter::submitErasureCodedOperation");
+    const size_t num_data = mem_desc.data_stripes();
+    const size_t num_stripes = num_data + mem_desc.parity_stripes;
+    const uint64_t stripe_len = mem_desc.stripe(num_stripes - 1).size_;
+    std::vector<bool> present(num_stripes);
+    size_t num_lost = 0;
+    bool data_lost = false;
+    for (size_t i = 0; i < num_stripes; ++i) {
+        present[i] = !mem_desc.stripe(i).transport_endpoint_.empty();
+        if (!present[i]) {
+            num_lost++;
+            data_lost = data_lost || i < num_data;
+        }
+    }
+    if (num_lost > mem_desc.parity_stripes ||
+        (op_code == TransferRequest::WRITE && num_lost > 0)) {
+        LOG(ERROR) << "Erasure coded replica lost " << num_lost << " of "
+                   << num_stripes << " stripes";
+        return std::nullopt;
+    }
+
+    std::vector<TransferRequest> requests;
+    if (op_code == TransferRequest::READ && !data_lost) {
+        auto data_stripes = SelectStripes(mem_desc, 0, num_data);
+        if (!appendStripedRequests(data_stripes, slices, op_code, requests)) {
+            return std::nullopt;
+        }
+        return submitTransfer(requests, priority);
+    }
+
+    const ReedSolomonCode code(num_data, mem_desc.parity_stripes);
+    std::vector<BufferHandle> buffers;
+    std::function<ErrorCode()> on_complete;
+    if (op_code == TransferRequest::WRITE) {
+        auto buffer =
+            allocateErasureCodeBuffer(mem_desc.parity_stripes * stripe_len);
+        if (!buffer) {
+            return std::nullopt;
+        }
+        auto* base = static_cast<uint8_t*>(buffer->ptr());
+        std::memset(base, 0, mem_desc.parity_stripes * stripe_len);
+        std::vector<uint8_t*> parity;
+        std::vector<Slice> parity_slices;
+        for (size_t j = 0; j < mem_desc.parity_stripes; ++j) {
+            parity.push_back(base + j * stripe_len);
+            parity_slices.push_back({parity.back(), stripe_len});
+        }
+        EncodeParity(code, mem_desc, slices, parity, stripe_len);
+
+        if (!appendStripedRequests(SelectStripes(mem_desc, 0, num_data),
+                                   slices, op_code, requests) ||
+            !appendStripedRequests(
+                SelectStripes(mem_desc, num_data, num_stripes), parity_slices,
+                op_code, requests)) {
+            return std::nullopt;
+        }
+        buffers.push_back(std::move(*buffer));
+    } else {
+        // Degraded read: fetch num_data present stripes into the buffer,
+        // decode the lost data stripes and copy the data into the slices.
+        auto buffer = allocateErasureCodeBuffer(num_stripes * stripe_len);
+        if (!buffer) {
+            return std::nullopt;
+        }
+        auto* base = static_cast<uint8_t*>(buffer->ptr());
+        // Short data stripes are zero padded, as they were encoded.
+        std::memset(base, 0, num_stripes * stripe_len);
+        std::vector<uint8_t*> shards(num_stripes);
+        std::vector<bool> fetched(num_stripes, false);
+        size_t num_fetched = 0;
+        for (size_t i = 0; i < num_stripes; ++i) {
+            shards[i] = base + i * stripe_len;
+            if (!present[i] || num_fetched == num_data) {
+                continue;
+            }
+            std::vector<Slice> stripe_slice = {
+                {shards[i], mem_desc.stripe(i).size_}};
+            if (!appendStripedRequests(SelectStripes(mem_desc, i, i + 1),
+                                       stripe_slice, op_code, requests)) {
+                return std::nullopt;
+            }
+            fetched[i] = true;
+            num_fetched++;
+        }
+
+        on_complete = [code, mem_desc, slices, shards, fetched, stripe_len,
+                       num_data]() {
+            if (!code.Decode(shards, fetched, stripe_len)) {
+                return ErrorCode::INVALID_REPLICA;
+            }
+            size_t slice_index = 0;
+            uint64_t slice_offset = 0;
+            for (size_t i = 0; i < num_data; ++i) {
+                const uint8_t* src = shards[i];
+                uint64_t remaining = mem_desc.stripe(i).size_;
+                while (remaining > 0) {
+                    const auto& slice = slices[slice_index];
+                    const uint64_t len = std::min<uint64_t>(
+                        slice.size - slice_offset, remaining);
+                    std::memcpy(static_cast<char*>(slice.ptr) + slice_offset,
+                                src, len);
+                    src += len;
+                    remaining -= len;
+                    slice_offset += len;
+                    if (slice_offset == slice.size) {
+                        slice_index++;
+                        slice_offset = 0;
+                    }
+                }
+            }
+            return ErrorCode::OK;
+        };
+        buffers.push_back(std::move(*buffer));
     }
-    return submitTransfer(requests);
+
+    auto future = submitTransfer(requests, priority);
+    if (!future) {
+        return std::nullopt;
+    }
+    return TransferFuture(std::make_shared<ErasureCodedOperationState>(
+        std::move(*future), std::move(buffers), std::move(on_complete)));
 }
 
 std::optional<TransferFuture> TransferSubmitter::submitFileReadOperation(
     const Replica::Descriptor& replica, std::vector<Slice>& slices,
     TransferRequest::OpCode op_code) {
+    TraceSpan span("TransferSubmitter::submitFileReadOperation");
     auto state = std::make_shared<FilereadOperationState>();
     auto disk_replica = replica.get_disk_descriptor();
     std::string file_path = disk_replica.file_path;
     size_t file_length = disk_replica.object_size;
 
+    auto on_done = [state, file_path](ErrorCode error_code) {
+        if (error_code == ErrorCode::OK) {
+            VLOG(2) << "Fileread task completed successfully with "
+                    << file_path;
+            state->set_completed(ErrorCode::OK);
+        } else {
+            LOG(ERROR) << "Fileread task failed for file: " << file_path
+                       << " with error: " << toString(error_code);
+            state->set_completed(ErrorCode::TRANSFER_FAIL);
+        }
+    };
+
+    // GPU buffers are filled by the drive without a host bounce buffer
+    if (gds_reader_ && GdsFileReader::IsDeviceMemory(slices)) {
+        gds_reader_->Read(file_path, slices, file_length, std::move(on_done));
+        VLOG(1) << "Fileread transfer submitted to cuFile with " << file_path;
+        return TransferFuture(state);
+    }
+
+    if (uring_reader_) {
+        uring_reader_->Read(file_path, slices, file_length,
+                            std::move(on_done));
+        VLOG(1) << "Fileread transfer submitted to io_uring with " << file_path;
+        return TransferFuture(state);
+    }
+
+
     // Submit memcpy operations to worker pool for async execution
     FilereadTask task(file_path, file_length, slices, state);
     fileread_pool_->submitTask(std::move(task));
@@ -681,6 +1438,11 @@ std::optional<TransferFuture> TransferSubmitter::submitFileReadOperation(
 TransferStrategy TransferSubmitter::selectStrategy(
     const AllocatedBuffer::Descriptor& handle,
     const std::vector<Slice>& slices) const {
+    const bool local = isLocalTransfer(handle);
+    if (local && touchesDeviceMemory(handle, slices)) {
+        return TransferStrategy::INTRA_NODE_COPY;
+    }
+
     // Check if memcpy operations are enabled via environment variable
     if (!memcpy_enabled_) {
         VLOG(2) << "Memcpy operations disabled via MC_STORE_MEMCPY environment "
@@ -689,13 +1451,28 @@ TransferStrategy TransferSubmitter::selectStrategy(
     }
 
     // Check conditions for local memcpy optimization
-    if (isLocalTransfer(handle)) {
+    if (local) {
         return TransferStrategy::LOCAL_MEMCPY;
     }
 
     return TransferStrategy::TRANSFER_ENGINE;
 }
 
+bool TransferSubmitter::touchesDeviceMemory(
+    const AllocatedBuffer::Descriptor& handle,
+    const std::vector<Slice>& slices) const {
+    // The replica address only means something to CUDA in the process that
+    // mounted it; elsewhere it is not device memory to this process
+    if (CudaStaging::IsDeviceMemory(
+            reinterpret_cast<const void*>(handle.buffer_address_))) {
+        return true;
+    }
+    for (const auto& slice : slices) {
+        if (slice.ptr && CudaStaging::IsDeviceMemory(slice.ptr)) return true;
+    }
+    return false;
+}
+
 namespace {
 // Helper function to extract IP address from endpoint string (ip:port format)
 // Supports both IPv4 (ip:port) and IPv6 ([ipv6]:port) formats
@@ -742,14 +1519,13 @@ bool TransferSubmitter::isLocalTransfer(
 }
 
 bool TransferSubmitter::validateTransferParams(
-    const AllocatedBuffer::Descriptor& handle,
-    const std::vector<Slice>& slices) const {
+    const MemoryDescriptor& mem_desc, const std::vector<Slice>& slices) const {
     uint64_t all_slice_len = 0;
     for (auto slice : slices) {
         all_slice_len += slice.size;
     }
-    if (handle.size_ != all_slice_len) {
-        LOG(ERROR) << "handles len:" << handle.size_
+    if (mem_desc.total_size() != all_slice_len) {
+        LOG(ERROR) << "handles len:" << mem_desc.total_size()
                    << ", all_slice_len:" << all_slice_len;
         return false;
     }
@@ -0,0 +1,338 @@
+#include "uring_file_reader.h"
+
+#include <glog/logging.h>
+
+#ifdef USE_URING
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace mooncake {
+
+#ifdef USE_URING
+
+namespace {
+
+// Alignment of O_DIRECT reads, a multiple of the logical block size of
+// common devices
+constexpr uint64_t kDirectIoAlignment = 4096;
+// Longest single read, so that a large slice is spread over the queue
+constexpr uint64_t kMaxPieceSize = 1024 * 1024;
+
+}  // namespace
+
+struct UringFileReader::FileRequest {
+    std::string path;
+    std::vector<Slice> slices;
+    size_t length{0};
+    Callback done;
+    int direct_fd{-1};
+    int buffered_fd{-1};
+    size_t pieces_left{0};
+    bool failed{false};
+
+    ~FileRequest() {
+        if (direct_fd >= 0) {
+            close(direct_fd);
+        }
+        if (buffered_fd >= 0) {
+            close(buffered_fd);
+        }
+    }
+};
+
+struct UringFileReader::Piece {
+    std::shared_ptr<FileRequest> request;
+    bool direct;
+    char* buffer;
+    uint64_t offset;
+    uint32_t length;
+};
+
+std::unique_ptr<UringFileReader> UringFileReader::Create(size_t queue_depth) {
+    auto ring = std::make_unique<io_uring>();
+    // One more entry for the wakeup read
+    int rc = io_uring_queue_init(queue_depth + 1, ring.get(), 0);
+    if (rc < 0) {
+        LOG(WARNING) << "io_uring_queue_init failed: " << strerror(-rc)
+                     << ", disk replicas are read by worker threads";
+        return nullptr;
+    }
+    int event_fd = eventfd(0, EFD_CLOEXEC);
+    if (event_fd < 0) {
+        PLOG(WARNING) << "Failed to create eventfd for io_uring reads";
+        io_uring_queue_exit(ring.get());
+        return nullptr;
+    }
+    return std::unique_ptr<UringFileReader>(
+        new UringFileReader(ring.release(), event_fd, queue_depth));
+}
+
+UringFileReader::UringFileReader(io_uring* ring, int event_fd,
+                                 size_t queue_depth)
+    : ring_(ring), event_fd_(event_fd), queue_depth_(queue_depth) {
+    ArmWakeup();
+    thread_ = std::thread(&UringFileReader::CompletionThread, this);
+    VLOG(1) << "Created UringFileReader with queue depth " << queue_depth;
+}
+
+UringFileReader::~UringFileReader() {
+    shutdown_.store(true);
+    uint64_t one = 1;
+    if (write(event_fd_, &one, sizeof(one)) < 0) {
+        PLOG(ERROR) << "Failed to wake up the io_uring completion thread";
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    io_uring_queue_exit(ring_);
+    delete ring_;
+    close(event_fd_);
+}
+
+void UringFileReader::Read(const std::string& path, std::vector<Slice> slices,
+                           size_t length, Callback done) {
+    auto request = std::make_shared<FileRequest>();
+    request->path = path;
+    request->slices = std::move(slices);
+    request->length = length;
+    request->done = std::move(done);
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (!shutdown_.load()) {
+            pending_.push_back(request);
+            request.reset();
+        }
+    }
+    if (request) {
+        LOG(WARNING) << "Attempting to read " << path
+                     << " from shutdown UringFileReader";
+        request->done(ErrorCode::TRANSFER_FAIL);
+        return;
+    }
+    uint64_t one = 1;
+    if (write(event_fd_, &one, sizeof(one)) < 0) {
+        PLOG(ERROR) << "Failed to wake up the io_uring completion thread";
+    }
+}
+
+void UringFileReader::ArmWakeup() {
+    // Reads of pieces are only prepared after this, and the previous wakeup
+    // read has been submitted, so the SQ has room
+    io_uring_sqe* sqe = io_uring_get_sqe(ring_);
+    CHECK(sqe != nullptr);
+    io_uring_prep_read(sqe, event_fd_, &event_value_, sizeof(event_value_),
+                       0);
+    // Pieces have a non-null user_data
+    io_uring_sqe_set_data(sqe, nullptr);
+}
+
+void UringFileReader::CompletionThread() {
+    VLOG(2) << "UringFileReader completion thread started";
+
+    while (true) {
+        int rc = io_uring_submit_and_wait(ring_, 1);
+        if (rc < 0 && rc != -EINTR) {
+            LOG(ERROR) << "io_uring_submit_and_wait failed: " << strerror(-rc);
+        }
+
+        bool wakeup = false;
+        unsigned head;
+        unsigned count = 0;
+        io_uring_cqe* cqe;
+        io_uring_for_each_cqe(ring_, head, cqe) {
+            ++count;
+            if (io_uring_cqe_get_data(cqe) == nullptr) {
+                wakeup = true;
+            } else {
+                CompletePiece(static_cast<Piece*>(io_uring_cqe_get_data(cqe)),
+                              cqe->res);
+            }
+        }
+        io_uring_cq_advance(ring_, count);
+
+        if (wakeup) {
+            std::vector<std::shared_ptr<FileRequest>> requests;
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex_);
+                requests.swap(pending_);
+            }
+            for (const auto& request : requests) {
+                StartRequest(request);
+            }
+            ArmWakeup();
+        }
+        PrepareReads();
+
+        if (shutdown_.load() && active_requests_ == 0) {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            if (pending_.empty()) {
+                break;
+            }
+        }
+    }
+
+    VLOG(2) << "UringFileReader completion thread exiting";
+}
+
+void UringFileReader::StartRequest(
+    const std::shared_ptr<FileRequest>& request) {
+    size_t total_size = 0;
+    for (const auto& slice : request->slices) {
+        total_size += slice.size;
+    }
+    if (total_size != request->length) {
+        LOG(ERROR) << "Total read size mismatch for: " << request->path
+                   << ", expected: " << request->length
+                   << ", got: " << total_size;
+        request->done(ErrorCode::FILE_READ_FAIL);
+        return;
+    }
+
+    request->buffered_fd = open(request->path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (request->buffered_fd < 0) {
+        PLOG(ERROR) << "Failed to open file for reading: " << request->path;
+        request->done(ErrorCode::FILE_OPEN_FAIL);
+        return;
+    }
+    // File systems without O_DIRECT support are read through the page cache
+    request->direct_fd =
+        open(request->path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+
+    std::vector<Piece*> pieces;
+    auto add_pieces = [&](bool direct, char* buffer, uint64_t offset,
+                          uint64_t length) {
+        while (length > 0) {
+            const uint64_t piece_size = std::min(length, kMaxPieceSize);
+            pieces.push_back(new Piece{request, direct, buffer, offset,
+                                       static_cast<uint32_t>(piece_size)});
+            buffer += piece_size;
+            offset += piece_size;
+            length -= piece_size;
+        }
+    };
+
+    uint64_t offset = 0;
+    for (const auto& slice : request->slices) {
+        if (slice.ptr != nullptr) {
+            char* buffer = static_cast<char*>(slice.ptr);
+            uint64_t head = slice.size;
+            uint64_t body = 0;
+            // The buffer and the file offset must be aligned together
+            if (request->direct_fd >= 0 &&
+                reinterpret_cast<uintptr_t>(buffer) % kDirectIoAlignment ==
+                    offset % kDirectIoAlignment) {
+                head = std::min<uint64_t>(
+                    slice.size, (kDirectIoAlignment -
+                                 offset % kDirectIoAlignment) %
+                                    kDirectIoAlignment);
+                body = (slice.size - head) / kDirectIoAlignment *
+                       kDirectIoAlignment;
+            }
+            add_pieces(false, buffer, offset, head);
+            add_pieces(true, buffer + head, offset + head, body);
+            add_pieces(false, buffer + head + body, offset + head + body,
+                       slice.size - head - body);
+        }
+        offset += slice.size;
+    }
+
+    if (pieces.empty()) {
+        request->done(ErrorCode::OK);
+        return;
+    }
+    request->pieces_left = pieces.size();
+    ++active_requests_;
+    queued_.insert(queued_.end(), pieces.begin(), pieces.end());
+}
+
+void UringFileReader::PrepareReads() {
+    while (!queued_.empty() && in_flight_ < queue_depth_) {
+        Piece* piece = queued_.front();
+        if (piece->request->failed) {
+            queued_.pop_front();
+            FinishPiece(piece);
+            continue;
+        }
+        io_uring_sqe* sqe = io_uring_get_sqe(ring_);
+        if (sqe == nullptr) {
+            break;
+        }
+        queued_.pop_front();
+        const int fd = piece->direct ? piece->request->direct_fd
+                                     : piece->request->buffered_fd;
+        io_uring_prep_read(sqe, fd, piece->buffer, piece->length,
+                           piece->offset);
+        io_uring_sqe_set_data(sqe, piece);
+        ++in_flight_;
+    }
+}
+
+void UringFileReader::CompletePiece(Piece* piece, int result) {
+    --in_flight_;
+    if (result == -EINTR || result == -EAGAIN) {
+        queued_.push_front(piece);
+        return;
+    }
+    if (result < 0 && piece->direct) {
+        // e.g. the device needs a larger alignment
+        VLOG(1) << "O_DIRECT read of " << piece->request->path
+                << " failed: " << strerror(-result)
+                << ", retrying through the page cache";
+        piece->direct = false;
+        queued_.push_front(piece);
+        return;
+    }
+    if (result <= 0) {
+        LOG(ERROR) << "Failed to read " << piece->length << " bytes at offset "
+                   << piece->offset << " of " << piece->request->path << ": "
+                   << (result < 0 ? strerror(-result) : "unexpected EOF");
+        piece->request->failed = true;
+        FinishPiece(piece);
+        return;
+    }
+    if (static_cast<uint32_t>(result) < piece->length) {
+        // Short read, continue after the bytes that were read
+        piece->buffer += result;
+        piece->offset += result;
+        piece->length -= result;
+        piece->direct = piece->direct && result % kDirectIoAlignment == 0;
+        queued_.push_front(piece);
+        return;
+    }
+    FinishPiece(piece);
+}
+
+void UringFileReader::FinishPiece(Piece* piece) {
+    std::shared_ptr<FileRequest> request = std::move(piece->request);
+    delete piece;
+    if (--request->pieces_left == 0) {
+        --active_requests_;
+        request->done(request->failed ? ErrorCode::FILE_READ_FAIL
+                                      : ErrorCode::OK);
+    }
+}
+
+#else
+
+std::unique_ptr<UringFileReader> UringFileReader::Create(size_t) {
+    return nullptr;
+}
+
+UringFileReader::~UringFileReader() = default;
+
+void UringFileReader::Read(const std::string& path, std::vector<Slice>, size_t,
+                           Callback done) {
+    LOG(ERROR) << "Built without io_uring, cannot read " << path;
+    done(ErrorCode::TRANSFER_FAIL);
+}
+
+#endif
+
+}  // namespace mooncake
@@ -8,11 +8,17 @@
 #include <boost/algorithm/string.hpp>
 
 #include <algorithm>
+#include <cctype>
 #include <random>
 #include <cerrno>
 #include <csignal>
 #include <cstring>
 #include <sys/mman.h>
+#include <numa.h>
+#include <numaif.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #ifdef USE_ASCEND_DIRECT
 #include "acl/acl.h"
 #include "config.h"
@@ -160,15 +166,57 @@ void *allocate_buffer_allocator_memory(size_t total_size,
     return aligned_alloc(alignment, total_size);
 }
 
-void *allocate_buffer_mmap_memory(size_t total_size, size_t alignment) {
+// Fault in the pages of [ptr, ptr + size) with num_threads threads
+static bool prefault_memory(void *ptr, size_t size, size_t page_size,
+                            size_t num_threads) {
+    const size_t num_pages = (size + page_size - 1) / page_size;
+    num_threads = std::max<size_t>(1, std::min(num_threads, num_pages));
+    const size_t pages_per_thread = (num_pages + num_threads - 1) / num_threads;
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        const size_t begin = i * pages_per_thread * page_size;
+        const size_t end = std::min(size, begin + pages_per_thread * page_size);
+        if (begin >= end) {
+            break;
+        }
+        threads.emplace_back([&failed, ptr, begin, end, page_size]() {
+            char *base = static_cast<char *>(ptr);
+#ifdef MADV_POPULATE_WRITE
+            // Fails instead of raising SIGBUS when huge pages run out
+            if (madvise(base + begin, end - begin, MADV_POPULATE_WRITE) == 0) {
+                return;
+            }
+            if (errno != EINVAL) {
+                failed = true;
+                return;
+            }
+#endif
+            for (size_t offset = begin; offset < end; offset += page_size) {
+                *reinterpret_cast<volatile char *>(base + offset) = 0;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return !failed;
+}
+
+void *allocate_buffer_mmap_memory(size_t total_size, size_t alignment,
+                                  int numa_node, size_t prefault_threads) {
     if (total_size == 0) {
         LOG(ERROR) << "Total size must be greater than 0 for hugepage mmap";
         return nullptr;
     }
 
-    unsigned int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE;
-    const size_t effective_alignment =
-        std::max(alignment, get_hugepage_size_from_env(&flags));
+    // The memory policy must be set before the pages are faulted in
+    const bool populate = numa_node < 0 && prefault_threads == 0;
+    unsigned int flags =
+        MAP_PRIVATE | MAP_ANONYMOUS | (populate ? MAP_POPULATE : 0);
+    const size_t hugepage_size = get_hugepage_size_from_env(&flags);
+    const size_t effective_alignment = std::max(alignment, hugepage_size);
     const size_t map_size = align_up(total_size, effective_alignment);
 
     void *ptr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, flags, -1, 0);
@@ -177,7 +225,46 @@ void *allocate_buffer_mmap_memory(size_t total_size, size_t alignment) {
                    << ", errno=" << errno << " (" << strerror(errno) << ")";
         return nullptr;
     }
+    if (populate) {
+        return ptr;
+    }
+
+    if (numa_node >= 0) {
+        if (numa_available() < 0 || numa_node > numa_max_node()) {
+            LOG(WARNING) << "NUMA node " << numa_node
+                         << " is not available, memory is not bound";
+        } else {
+            // Preferred rather than strict binding, so that a node short of
+            // huge pages falls back to the others instead of failing faults
+            struct bitmask *nodes = numa_allocate_nodemask();
+            numa_bitmask_setbit(nodes, numa_node);
+            if (mbind(ptr, map_size, MPOL_PREFERRED, nodes->maskp,
+                      nodes->size + 1, 0) != 0) {
+                LOG(WARNING) << "mbind to NUMA node " << numa_node
+                             << " failed, errno=" << errno << " ("
+                             << strerror(errno) << ")";
+            }
+            numa_free_nodemask(nodes);
+        }
+    }
 
+    const size_t page_size =
+        hugepage_size > 0 ? hugepage_size
+                          : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto start = std::chrono::steady_clock::now();
+    if (!prefault_memory(ptr, map_size, page_size, prefault_threads)) {
+        LOG(ERROR) << "Failed to fault in memory, size=" << map_size
+                   << ", numa_node=" << numa_node;
+        munmap(ptr, map_size);
+        return nullptr;
+    }
+    LOG(INFO) << "Faulted in " << map_size << " bytes on NUMA node "
+              << numa_node << " with " << std::max<size_t>(1, prefault_threads)
+              << " threads in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count()
+              << " ms";
     return ptr;
 }
 
@@ -261,6 +348,61 @@ std::vector<std::string> splitString(const std::string &str, char delimiter,
     return result;
 }
 
+std::optional<std::string> GetRegexLiteralPrefix(const std::string &pattern) {
+    if (pattern.size() < 2 || pattern[0] != '^') {
+        return std::nullopt;
+    }
+    // Top level alternatives may not share the prefix of the first one
+    int depth = 0;
+    bool in_class = false;
+    for (size_t i = 1; i < pattern.size(); ++i) {
+        const char c = pattern[i];
+        if (c == '\\') {
+            ++i;
+        } else if (in_class) {
+            in_class = c != ']';
+        } else if (c == '[') {
+            in_class = true;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            --depth;
+        } else if (c == '|' && depth == 0) {
+            return std::nullopt;
+        }
+    }
+    static const std::string kSpecial = ".[](){}*+?^$\\|";
+    std::string prefix;
+    size_t pos = 1;
+    while (pos < pattern.size()) {
+        char c = pattern[pos];
+        size_t next = pos + 1;
+        if (c == '\\') {
+            // Escaped punctuation is literal, other escapes are classes,
+            // back references or control characters
+            if (next == pattern.size() ||
+                std::isalnum(static_cast<unsigned char>(pattern[next]))) {
+                break;
+            }
+            c = pattern[next++];
+        } else if (kSpecial.find(c) != std::string::npos) {
+            break;
+        }
+        // A quantifier that allows zero repetitions makes the char optional
+        if (next < pattern.size() &&
+            (pattern[next] == '*' || pattern[next] == '?' ||
+             pattern[next] == '{')) {
+            break;
+        }
+        prefix.push_back(c);
+        pos = next;
+    }
+    if (prefix.empty()) {
+        return std::nullopt;
+    }
+    return prefix;
+}
+
 tl::expected<std::string, int> httpGet(const std::string &url) {
     coro_http::coro_http_client client;
     auto res = client.get(url);
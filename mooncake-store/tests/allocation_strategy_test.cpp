@@ -25,7 +25,8 @@ static constexpr size_t MiB = 1024 * 1024;
 
 // Strategy types for parameterized tests
 const auto kStrategyTypes = ::testing::Values(
-    AllocationStrategyType::RANDOM, AllocationStrategyType::FREE_RATIO_FIRST);
+    AllocationStrategyType::RANDOM, AllocationStrategyType::FREE_RATIO_FIRST,
+    AllocationStrategyType::LOAD_AWARE);
 
 const auto kAllocatorTypes = ::testing::Values(BufferAllocatorType::CACHELIB,
                                                BufferAllocatorType::OFFSET);
@@ -89,6 +90,9 @@ INSTANTIATE_TEST_SUITE_P(
             case AllocationStrategyType::FREE_RATIO_FIRST:
                 strategy_str = "FreeRatioFirst";
                 break;
+            case AllocationStrategyType::LOAD_AWARE:
+                strategy_str = "LoadAware";
+                break;
             default:
                 strategy_str = "Unknown";
         }
@@ -459,6 +463,75 @@ TEST_P(AllocationStrategyParameterizedTest, ExcludedSegmentsAllocation) {
     }
 }
 
+// Test allocation of replicas striped across segments
+TEST_P(AllocationStrategyParameterizedTest, StripedAllocation) {
+    AllocatorManager allocator_manager;
+    std::vector<std::shared_ptr<BufferAllocatorBase>> allocators;
+    for (size_t i = 0; i < 5; i++) {
+        const std::string name = "segment" + std::to_string(i);
+        allocators.push_back(CreateTestAllocator(name, i * 0x10000000ULL));
+        allocator_manager.addAllocator(name, allocators.back());
+    }
+
+    // 3 replicas of 2 stripes need 6 segments, so only 2 can be allocated.
+    const size_t slice_length = 1024 * 1024 + 1;
+    auto result =
+        strategy_->AllocateStriped(allocator_manager, slice_length, 3, 2);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value().size(), 2);
+
+    std::unordered_set<std::string> segment_names;
+    for (const auto& replica : result.value()) {
+        EXPECT_TRUE(replica.is_striped());
+        EXPECT_EQ(replica.get_memory_buffer_size(), slice_length);
+        auto descriptor = replica.get_descriptor();
+        const auto& mem_desc = descriptor.get_memory_descriptor();
+        ASSERT_EQ(mem_desc.extra_stripes.size(), 1);
+        EXPECT_EQ(mem_desc.buffer_descriptor.size_, slice_length / 2 + 1);
+        EXPECT_EQ(mem_desc.extra_stripes[0].size_, slice_length / 2);
+        EXPECT_EQ(mem_desc.total_size(), slice_length);
+        segment_names.insert(mem_desc.buffer_descriptor.transport_endpoint_);
+        segment_names.insert(mem_desc.extra_stripes[0].transport_endpoint_);
+    }
+    // No two stripes share a segment
+    EXPECT_EQ(segment_names.size(), 4);
+
+    // The stripe count is capped by the slice length
+    result = strategy_->AllocateStriped(allocator_manager, 3, 1, 4);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value().size(), 1);
+    EXPECT_EQ(result.value()[0].get_segment_names().size(), 3);
+
+    // A single stripe is a plain allocation
+    result = strategy_->AllocateStriped(allocator_manager, 1024, 1, 1);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_FALSE(result.value()[0].is_striped());
+
+    // Not enough segments for even one replica
+    result = strategy_->AllocateStriped(allocator_manager, 1024, 1, 6);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), ErrorCode::NO_AVAILABLE_HANDLE);
+
+    // Parity stripes are as long as the longest data stripe
+    result = strategy_->AllocateStriped(allocator_manager, 1025, 1, 2, 2);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value().size(), 1);
+    EXPECT_TRUE(result.value()[0].is_erasure_coded());
+    auto descriptor = result.value()[0].get_descriptor();
+    const auto& mem_desc = descriptor.get_memory_descriptor();
+    ASSERT_EQ(mem_desc.parity_stripes, 2);
+    ASSERT_EQ(mem_desc.data_stripes(), 2);
+    EXPECT_EQ(mem_desc.total_size(), 1025);
+    EXPECT_EQ(mem_desc.stripe(2).size_, 513);
+    EXPECT_EQ(mem_desc.stripe(3).size_, 513);
+
+    // More stripes than the Reed-Solomon code supports
+    result = strategy_->AllocateStriped(allocator_manager, 1024 * 1024, 1, 200,
+                                        100);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), ErrorCode::INVALID_PARAMS);
+}
+
 // Test allocation when all available segments are excluded
 TEST_F(AllocationStrategyTest, AllSegmentsExcluded) {
     auto allocator1 = std::make_shared<OffsetBufferAllocator>(
@@ -646,6 +719,158 @@ TEST_P(AllocationStrategyParameterizedTest,
         << "FreeRatioFirst should balance utilization ratios";
 }
 
+// Test the bandwidth and distances derived from client load reports
+TEST_F(AllocationStrategyTest, SegmentLoadTrackerReports) {
+    EXPECT_EQ(SegmentLoadTracker::HostOf("10.0.0.1:12345"), "10.0.0.1");
+    EXPECT_EQ(SegmentLoadTracker::HostOf("[fe80::1]:12345"), "fe80::1");
+    EXPECT_EQ(SegmentLoadTracker::HostOf("fe80::1"), "fe80::1");
+    EXPECT_EQ(SegmentLoadTracker::HostOf("node1"), "node1");
+
+    SegmentLoadTracker tracker(std::chrono::seconds(1));
+    const auto now = SegmentLoadTracker::Clock::now();
+    tracker.Report({"10.0.0.1:1", "rack-a", {{"10.0.0.2:1", 100 * MiB, 0}}},
+                   now);
+    tracker.Report({"10.0.0.2:1", "rack-a", {{"10.0.0.3:1", 0, 10 * MiB}}},
+                   now);
+    tracker.Report({"10.0.0.3:1", "rack-b", {}}, now);
+
+    // Reports sum up and decay with the period
+    EXPECT_DOUBLE_EQ(tracker.GetBandwidth("10.0.0.2:1", now), 100.0 * MiB);
+    EXPECT_DOUBLE_EQ(tracker.GetBandwidth("10.0.0.3:1", now), 10.0 * MiB);
+    EXPECT_DOUBLE_EQ(tracker.GetMeanBandwidth(now), 55.0 * MiB);
+    EXPECT_DOUBLE_EQ(tracker.GetBandwidth("10.0.0.4:1", now), 0);
+    const auto later = now + std::chrono::seconds(1);
+    EXPECT_NEAR(tracker.GetBandwidth("10.0.0.2:1", later),
+                100.0 * MiB * std::exp(-1.0), 1.0);
+
+    EXPECT_EQ(tracker.GetDistance("10.0.0.1:1", "10.0.0.1:2"),
+              SegmentLoadTracker::kSameHost);
+    EXPECT_EQ(tracker.GetDistance("10.0.0.1:1", "10.0.0.2:1"),
+              SegmentLoadTracker::kSameRack);
+    EXPECT_EQ(tracker.GetDistance("10.0.0.1:1", "10.0.0.3:1"),
+              SegmentLoadTracker::kRemote);
+    EXPECT_EQ(tracker.GetDistance("10.0.0.1:1", "10.0.0.4:1"),
+              SegmentLoadTracker::kRemote);
+}
+
+// Test that LoadAware places most replicas away from a busy endpoint
+TEST_F(AllocationStrategyTest, LoadAwareAvoidsBusyEndpoint) {
+    AllocatorManager allocator_manager;
+    const std::array<std::string, 2> names = {"10.0.0.1:1", "10.0.0.2:1"};
+    for (size_t i = 0; i < names.size(); i++) {
+        allocator_manager.addAllocator(
+            names[i], std::make_shared<OffsetBufferAllocator>(
+                          names[i], 0x100000000ULL + i * 0x10000000ULL,
+                          64 * MiB, names[i]));
+    }
+
+    auto tracker = std::make_shared<SegmentLoadTracker>();
+    tracker->Report({"10.0.0.3:1", "", {{names[0], 1024 * MiB, 0}}});
+    LoadAwareAllocationStrategy strategy(tracker);
+
+    std::unordered_map<std::string, size_t> count;
+    std::vector<std::vector<Replica>> replicas;
+    for (size_t i = 0; i < 1000; i++) {
+        auto result = strategy.Allocate(allocator_manager, 1024);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result.value().size(), 1);
+        const auto& mem_desc =
+            result.value()[0].get_descriptor().get_memory_descriptor();
+        count[mem_desc.buffer_descriptor.transport_endpoint_]++;
+        replicas.push_back(std::move(result.value()));
+    }
+
+    // The busy endpoint only wins when it is sampled twice
+    EXPECT_GT(count[names[1]], 2 * count[names[0]]);
+}
+
+// Test that LoadAware prefers segments in the rack of the requester
+TEST_F(AllocationStrategyTest, LoadAwarePrefersRequesterRack) {
+    AllocatorManager allocator_manager;
+    const std::array<std::string, 2> names = {"10.0.0.1:1", "10.0.0.2:1"};
+    for (size_t i = 0; i < names.size(); i++) {
+        allocator_manager.addAllocator(
+            names[i], std::make_shared<OffsetBufferAllocator>(
+                          names[i], 0x100000000ULL + i * 0x10000000ULL,
+                          64 * MiB, names[i]));
+    }
+
+    auto tracker = std::make_shared<SegmentLoadTracker>();
+    tracker->Report({"10.0.0.1:1", "rack-a", {}});
+    tracker->Report({"10.0.0.2:1", "rack-b", {}});
+    tracker->Report({"10.0.0.3:1", "rack-b", {}});
+    LoadAwareAllocationStrategy strategy(tracker);
+
+    // The requester has no segment of its own
+    const std::vector<std::string> preferred = {"10.0.0.3:1"};
+    std::unordered_map<std::string, size_t> count;
+    std::vector<std::vector<Replica>> replicas;
+    for (size_t i = 0; i < 1000; i++) {
+        auto result = strategy.Allocate(allocator_manager, 1024, 1, preferred);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result.value().size(), 1);
+        const auto& mem_desc =
+            result.value()[0].get_descriptor().get_memory_descriptor();
+        count[mem_desc.buffer_descriptor.transport_endpoint_]++;
+        replicas.push_back(std::move(result.value()));
+    }
+
+    EXPECT_GT(count[names[1]], 2 * count[names[0]]);
+}
+
+// Test that replicas are spread over hosts and racks while space allows,
+// and that the first one stays in the rack of the requester
+TEST_P(AllocationStrategyParameterizedTest, SpreadOverFailureDomains) {
+    AllocatorManager allocator_manager;
+    // Two hosts in rack-a, two in rack-b and a host without label
+    const std::vector<std::pair<std::string, std::string>> segments = {
+        {"10.0.0.1:1", "rack-a"}, {"10.0.0.1:2", "rack-a"},
+        {"10.0.0.2:1", "rack-a"}, {"10.0.1.1:1", "rack-b"},
+        {"10.0.1.2:1", "rack-b"}, {"10.0.2.1:1", ""}};
+    for (size_t i = 0; i < segments.size(); i++) {
+        const auto& [name, rack] = segments[i];
+        allocator_manager.addAllocator(
+            name, CreateTestAllocator(name, i * 0x10000000ULL), rack);
+    }
+    EXPECT_EQ(allocator_manager.getFailureDomain("10.0.0.2:1"), "rack-a");
+    EXPECT_EQ(allocator_manager.getHost("10.0.0.1:2"), "10.0.0.1");
+
+    const auto host_of = [](const Replica& replica) {
+        return SegmentLoadTracker::HostOf(
+            replica.get_descriptor()
+                .get_memory_descriptor()
+                .buffer_descriptor.transport_endpoint_);
+    };
+    std::vector<std::vector<Replica>> allocations;
+    for (int i = 0; i < 50; i++) {
+        auto result =
+            strategy_->AllocateSpread(allocator_manager, 1024, 3, {}, "rack-b");
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result->size(), 3);
+        std::set<std::string> hosts;
+        std::set<std::string> racks;
+        for (const auto& replica : *result) {
+            hosts.insert(host_of(replica));
+            racks.insert(host_of(replica).substr(0, 6));
+        }
+        EXPECT_EQ(hosts.size(), 3);
+        EXPECT_EQ(racks.size(), 3);
+        EXPECT_EQ(host_of(result->front()).substr(0, 6), "10.0.1");
+        allocations.push_back(std::move(*result));
+    }
+
+    // Without other hosts the replicas share one, rather than being fewer
+    AllocatorManager one_host;
+    for (size_t i = 0; i < 3; i++) {
+        const std::string name = "10.0.3.1:" + std::to_string(i);
+        one_host.addAllocator(
+            name, CreateTestAllocator(name, i * 0x10000000ULL), "rack-c");
+    }
+    auto result = strategy_->AllocateSpread(one_host, 1024, 3);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->size(), 3);
+}
+
 // Test the performance comparison between strategies
 TEST_F(AllocationStrategyTest, PerformanceComparison) {
     const auto kNumSegments = 512;
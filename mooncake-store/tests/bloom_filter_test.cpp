@@ -0,0 +1,69 @@
+#include "bloom_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mooncake::test {
+
+TEST(BloomFilterTest, NoFalseNegatives) {
+    BloomFilter filter(10000, 10);
+    ASSERT_TRUE(filter.enabled());
+    for (int i = 0; i < 10000; ++i) {
+        filter.Insert("key_" + std::to_string(i));
+    }
+    for (int i = 0; i < 10000; ++i) {
+        EXPECT_TRUE(filter.MayContain("key_" + std::to_string(i))) << i;
+    }
+}
+
+TEST(BloomFilterTest, FalsePositiveRate) {
+    BloomFilter filter(10000, 10);
+    for (int i = 0; i < 10000; ++i) {
+        filter.Insert("key_" + std::to_string(i));
+    }
+    int false_positives = 0;
+    for (int i = 0; i < 100000; ++i) {
+        false_positives += filter.MayContain("miss_" + std::to_string(i));
+    }
+    // About 1% at 10 bits per key
+    EXPECT_LT(false_positives, 3000);
+}
+
+TEST(BloomFilterTest, DisabledAndClear) {
+    BloomFilter disabled(10000, 0);
+    EXPECT_FALSE(disabled.enabled());
+    EXPECT_TRUE(disabled.MayContain("anything"));
+
+    BloomFilter filter(100, 10);
+    EXPECT_FALSE(filter.MayContain("key"));
+    filter.Insert("key");
+    EXPECT_TRUE(filter.MayContain("key"));
+    filter.Clear();
+    EXPECT_FALSE(filter.MayContain("key"));
+}
+
+TEST(BloomFilterTest, ConcurrentInsert) {
+    BloomFilter filter(40000, 10);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&filter, t]() {
+            for (int i = 0; i < 10000; ++i) {
+                filter.Insert(std::to_string(t) + "_" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < 4; ++t) {
+        for (int i = 0; i < 10000; ++i) {
+            ASSERT_TRUE(
+                filter.MayContain(std::to_string(t) + "_" + std::to_string(i)));
+        }
+    }
+}
+
+}  // namespace mooncake::test
@@ -2,6 +2,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 #include <memory>
@@ -40,6 +41,11 @@ class BufferAllocatorTest : public ::testing::Test {
             case BufferAllocatorType::OFFSET:
                 return std::make_shared<OffsetBufferAllocator>(
                     segment_name, base, size, segment_name);
+            case BufferAllocatorType::SLAB:
+                return std::make_shared<SlabBufferAllocator>(
+                    segment_name, base, size, segment_name,
+                    std::make_shared<SizeClassRegistry>(kTestSlabSize,
+                                                        kTestClassMinCount));
             default:
                 throw std::invalid_argument("Invalid allocator type");
         }
@@ -52,12 +58,20 @@ class BufferAllocatorTest : public ::testing::Test {
         auto descriptor = bufHandle.get_descriptor();
         EXPECT_EQ(bufHandle.getSegmentName(), segment_name);
         EXPECT_EQ(descriptor.transport_endpoint_, transport_endpoint);
+        EXPECT_EQ(descriptor.protocol_, "tcp");
         EXPECT_EQ(descriptor.size_, alloc_size);
         EXPECT_NE(bufHandle.data(), nullptr);
+        EXPECT_TRUE(bufHandle.isInSegment(segment_name));
+        EXPECT_FALSE(bufHandle.isInSegment(segment_name + "_other"));
+        EXPECT_FALSE(bufHandle.isCxl());
     }
 
+    static constexpr uint64_t kTestSlabSize = 1024 * 1024;
+    static constexpr uint32_t kTestClassMinCount = 4;
+
     std::vector<BufferAllocatorType> allocator_types_ = {
-        BufferAllocatorType::CACHELIB, BufferAllocatorType::OFFSET};
+        BufferAllocatorType::CACHELIB, BufferAllocatorType::OFFSET,
+        BufferAllocatorType::SLAB};
 };
 
 // Test basic allocation and deallocation functionality
@@ -184,10 +198,73 @@ TEST_F(BufferAllocatorTest, ParallelAllocation) {
         }
 
         LOG(INFO) << "Completed parallel allocation/deallocation test for "
-                  << (allocator_type == BufferAllocatorType::CACHELIB
-                          ? "CACHELIB"
-                          : "OFFSET");
+                  << allocator_type;
+    }
+}
+
+// Test that the slab allocator learns size classes and packs them into slabs
+TEST_F(BufferAllocatorTest, SlabAllocatorSizeClasses) {
+    const size_t size = 1024 * 1024 * 16;  // 16MB
+    const size_t base = 0x100000000ULL;
+    auto size_classes = std::make_shared<SizeClassRegistry>(
+        kTestSlabSize, kTestClassMinCount);
+    auto allocator = std::make_shared<SlabBufferAllocator>(
+        "slab", base, size, "slab", size_classes);
+
+    // Sizes below the learning threshold come from the free space
+    const size_t class_size = 64 * 1024;
+    std::vector<std::unique_ptr<AllocatedBuffer>> handles;
+    for (uint32_t i = 0; i + 1 < kTestClassMinCount; ++i) {
+        handles.push_back(allocator->allocate(class_size));
+        ASSERT_NE(handles.back(), nullptr);
+    }
+    EXPECT_TRUE(size_classes->classes().empty());
+    EXPECT_EQ(allocator->slabCount(), 0);
+    handles.clear();
+
+    // The next allocation of the same size learns the class
+    handles.push_back(allocator->allocate(class_size));
+    ASSERT_NE(handles.back(), nullptr);
+    EXPECT_EQ(size_classes->classes(), std::vector<uint64_t>{class_size});
+    EXPECT_EQ(allocator->slabCount(), 1);
+
+    // Slots of a slab are adjacent and the segment fills up completely
+    while (auto handle = allocator->allocate(class_size)) {
+        handles.push_back(std::move(handle));
+    }
+    EXPECT_EQ(handles.size(), size / class_size);
+    EXPECT_EQ(allocator->size(), size);
+    EXPECT_EQ(allocator->slabCount(), size / kTestSlabSize);
+    std::vector<uintptr_t> addresses;
+    for (const auto& handle : handles) {
+        addresses.push_back(reinterpret_cast<uintptr_t>(handle->data()));
+    }
+    std::sort(addresses.begin(), addresses.end());
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        EXPECT_EQ(addresses[i], base + i * class_size);
+    }
+    EXPECT_EQ(allocator->getLargestFreeRegion(), 0);
+
+    // A freed slot is reused and empty slabs go back to the segment
+    void* freed = handles.back()->data();
+    handles.pop_back();
+    EXPECT_EQ(allocator->getLargestFreeRegion(), class_size);
+    handles.push_back(allocator->allocate(class_size));
+    ASSERT_NE(handles.back(), nullptr);
+    EXPECT_EQ(handles.back()->data(), freed);
+    handles.clear();
+    EXPECT_EQ(allocator->slabCount(), 0);
+    EXPECT_EQ(allocator->size(), 0);
+    EXPECT_EQ(allocator->getLargestFreeRegion(), size);
+
+    // Sizes that do not fit enough slots into a slab never become classes
+    const size_t large_size = kTestSlabSize / 2;
+    for (uint32_t i = 0; i < kTestClassMinCount * 2; ++i) {
+        auto handle = allocator->allocate(large_size);
+        ASSERT_NE(handle, nullptr);
     }
+    EXPECT_EQ(size_classes->classes().size(), 1);
+    EXPECT_EQ(allocator->slabCount(), 0);
 }
 
 // Test fixture for SimpleAllocator tests
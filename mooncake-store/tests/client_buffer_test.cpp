@@ -90,6 +90,24 @@ TEST_F(ClientBufferTest, MultipleAllocations) {
     // All handles will be automatically deallocated when vector is destroyed
 }
 
+// Test a buffer bound to a NUMA node and faulted in by several threads
+TEST_F(ClientBufferTest, NumaBoundPrefaultedBuffer) {
+    const size_t buffer_size = 16 * 1024 * 1024;  // 16MB
+    const size_t alloc_size = 64 * 1024;          // 64KB
+
+    auto allocator = ClientBufferAllocator::create(
+        buffer_size, "", /*use_hugepage=*/false, /*numa_node=*/0,
+        /*prefault_threads=*/4);
+    ASSERT_NE(allocator, nullptr);
+    ASSERT_NE(allocator->getBase(), nullptr);
+    EXPECT_EQ(allocator->size(), buffer_size);
+
+    auto handle_opt = allocator->allocate(alloc_size);
+    ASSERT_TRUE(handle_opt.has_value());
+    VerifyBufferHandle(handle_opt.value(), alloc_size);
+    VerifyAlignment(handle_opt->ptr());
+}
+
 // Test allocation failure when requesting too much memory
 TEST_F(ClientBufferTest, AllocationTooLarge) {
     const size_t buffer_size = 1024 * 1024;  // 1MB
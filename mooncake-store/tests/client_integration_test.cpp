@@ -652,6 +652,108 @@ TEST_F(ClientIntegrationTest, BatchPutGetOperations) {
     }
 }
 
+// Test BatchPut split into pipelined sub-batches
+TEST_F(ClientIntegrationTest, PipelinedBatchPutOperations) {
+    setenv("MC_STORE_BATCH_PUT_PIPELINE_SIZE", "7", 1);
+    setenv("MC_STORE_BATCH_PUT_PIPELINE_DEPTH", "3", 1);
+    auto pipelined_client = CreateClient("localhost:17816");
+    unsetenv("MC_STORE_BATCH_PUT_PIPELINE_SIZE");
+    unsetenv("MC_STORE_BATCH_PUT_PIPELINE_DEPTH");
+    ASSERT_TRUE(pipelined_client != nullptr);
+
+    constexpr size_t kBufferSize = 16 * 1024 * 1024;
+    auto allocator = std::make_unique<SimpleAllocator>(kBufferSize);
+    ASSERT_TRUE(pipelined_client
+                    ->RegisterLocalMemory(allocator->getBase(), kBufferSize,
+                                          "cpu:0", false, false)
+                    .has_value());
+
+    const int batch_sz = 50;
+    std::vector<std::string> keys;
+    std::vector<std::string> test_data_list;
+    std::vector<std::vector<Slice>> batched_slices;
+    for (int i = 0; i < batch_sz; i++) {
+        keys.push_back("test_key_pipelined_put_" + std::to_string(i));
+        test_data_list.push_back("pipelined_data_" + std::to_string(i));
+        void* buffer = allocator->allocate(test_data_list[i].size());
+        memcpy(buffer, test_data_list[i].data(), test_data_list[i].size());
+        batched_slices.push_back({Slice{buffer, test_data_list[i].size()}});
+    }
+    // The first key already exists, which must not affect the others
+    ReplicateConfig config;
+    config.replica_num = 1;
+    ASSERT_TRUE(
+        pipelined_client->Put(keys[0], batched_slices[0], config).has_value());
+
+    auto results = pipelined_client->BatchPut(keys, batched_slices, config);
+    ASSERT_EQ(batch_sz, results.size());
+    for (int i = 0; i < batch_sz; i++) {
+        ASSERT_TRUE(results[i].has_value())
+            << "BatchPut failed for " << keys[i] << ": "
+            << toString(results[i].error());
+    }
+
+    for (int i = 0; i < batch_sz; i++) {
+        void* target = client_buffer_allocator_->allocate(
+            test_data_list[i].size());
+        std::vector<Slice> slices{Slice{target, test_data_list[i].size()}};
+        auto get_result = test_client_->Get(keys[i], slices);
+        ASSERT_TRUE(get_result.has_value())
+            << "Get failed for " << keys[i] << ": "
+            << toString(get_result.error());
+        EXPECT_EQ(0, memcmp(target, test_data_list[i].data(),
+                            test_data_list[i].size()));
+        client_buffer_allocator_->deallocate(target,
+                                             test_data_list[i].size());
+    }
+    for (int i = 0; i < batch_sz; i++) {
+        allocator->deallocate(batched_slices[i][0].ptr,
+                              batched_slices[i][0].size);
+    }
+}
+
+// Test Put/Get of an erasure coded object with one data and one parity
+// stripe, one on each mounted segment
+TEST_F(ClientIntegrationTest, ErasureCodedPutGet) {
+    const std::string key = "test_erasure_coded_key";
+    const size_t data_size = 1024 * 1024 + 3;
+    void* buffer = client_buffer_allocator_->allocate(data_size);
+    for (size_t i = 0; i < data_size; ++i) {
+        static_cast<uint8_t*>(buffer)[i] = static_cast<uint8_t>(i * 7);
+    }
+    std::vector<Slice> slices;
+    slices.emplace_back(Slice{buffer, data_size});
+
+    ReplicateConfig config;
+    config.replica_num = 1;
+    config.parity_num = 1;
+    auto put_result = test_client_->Put(key, slices, config);
+    ASSERT_TRUE(put_result.has_value())
+        << "Put operation failed: " << toString(put_result.error());
+
+    auto query_result = test_client_->Query(key);
+    ASSERT_TRUE(query_result.has_value());
+    ASSERT_EQ(1, query_result.value().replicas.size());
+    const auto& mem_desc =
+        query_result.value().replicas[0].get_memory_descriptor();
+    EXPECT_TRUE(mem_desc.is_erasure_coded());
+    EXPECT_EQ(data_size, mem_desc.total_size());
+
+    void* read_buffer = client_buffer_allocator_->allocate(data_size);
+    std::vector<Slice> read_slices;
+    read_slices.emplace_back(Slice{read_buffer, data_size});
+    auto get_result = test_client_->Get(key, read_slices);
+    ASSERT_TRUE(get_result.has_value())
+        << "Get operation failed: " << toString(get_result.error());
+    EXPECT_EQ(0, memcmp(buffer, read_buffer, data_size));
+
+    client_buffer_allocator_->deallocate(read_buffer, data_size);
+    client_buffer_allocator_->deallocate(buffer, data_size);
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(default_kv_lease_ttl_));
+    ASSERT_TRUE(test_client_->Remove(key).has_value());
+}
+
 // Test batch IsExist operations through the client
 TEST_F(ClientIntegrationTest, BatchIsExistOperations) {
     int batch_size = 50;
@@ -1,5 +1,6 @@
 // client_local_hot_cache_test.cpp
 #include "client_service.h"
+#include "device_hot_cache.h"
 #include "local_hot_cache.h"
 #include "replica.h"
 #include "test_server_helpers.h"
@@ -515,6 +516,118 @@ TEST_F(LocalHotCacheTest, LocalHotCacheHandlerNullCache) {
     EXPECT_FALSE(handler.SubmitPutTask("key", slice));
 }
 
+// Test that keys are spread over shards that still share their blocks
+TEST_F(LocalHotCacheTest, ShardedCache) {
+    const size_t block_size = 1024 * 1024;
+    LocalHotCache cache(64 * block_size, block_size);
+    EXPECT_EQ(cache.GetShardCount(), 4);  // 64 blocks / 16 per shard
+    EXPECT_EQ(cache.GetCacheSize(), 64);
+
+    // Every block can be filled however the keys hash
+    for (int i = 0; i < 64; ++i) {
+        Slice slice = CreateSlice(1024, static_cast<char>('A' + i % 26));
+        EXPECT_TRUE(PutHotKeyHelper(cache, "key" + std::to_string(i), slice));
+    }
+    for (int i = 0; i < 64; ++i) {
+        const std::string key = "key" + std::to_string(i);
+        HotMemBlock* block = cache.GetHotKey(key);
+        VerifySliceData(block, 1024, static_cast<char>('A' + i % 26));
+        cache.ReleaseHotKey(key);
+    }
+    EXPECT_EQ(cache.GetCacheSize(), 64);
+}
+
+// Test that a full cache only admits keys more frequent than the victim
+TEST_F(LocalHotCacheTest, LocalHotCacheHandlerAdmission) {
+    const size_t cache_size = 32 * 1024 * 1024;  // 32MB = 2 blocks
+    auto cache = std::make_shared<LocalHotCache>(cache_size);
+    LocalHotCacheHandler handler(cache, 2);
+    // Every slice fills a block, so the third one evicts
+    Slice slice = CreateSlice(cache->GetBlockSize(), 'H');
+
+    // Free space admits anything
+    EXPECT_TRUE(handler.SubmitPutTask("hot1", slice));
+    EXPECT_TRUE(handler.SubmitPutTask("hot2", slice));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_TRUE(cache->HasHotKey("hot1"));
+    ASSERT_TRUE(cache->HasHotKey("hot2"));
+    for (int i = 0; i < 2; ++i) {
+        handler.RecordHit("hot1");
+        handler.RecordHit("hot2");
+    }
+
+    // A scan of keys read once does not flush the hot keys
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(
+            handler.SubmitPutTask("scan" + std::to_string(i), slice));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_TRUE(cache->HasHotKey("hot1"));
+    EXPECT_TRUE(cache->HasHotKey("hot2"));
+    EXPECT_FALSE(cache->HasHotKey("scan0"));
+
+    // A key that becomes more frequent than the hot keys gets in
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(handler.SubmitPutTask("scan0", slice));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_TRUE(cache->HasHotKey("scan0"));
+    EXPECT_NE(cache->HasHotKey("hot1"), cache->HasHotKey("hot2"));
+}
+
+// Test that blocks are sized to their objects and evict until they fit
+TEST_F(LocalHotCacheTest, VariableSizeBlocks) {
+    const size_t block_size = 1024 * 1024;
+    LocalHotCache cache(8 * block_size, block_size);
+    auto put = [&](const std::string& key, size_t size, char fill) {
+        HotMemBlock* block = cache.GetFreeBlock(key, size, nullptr);
+        if (!block) {
+            return false;
+        }
+        EXPECT_EQ(block->size, size);
+        std::memset(block->addr, fill, size);
+        block->key_ = key;
+        return cache.PutHotKey(block);
+    };
+
+    // Many small objects share the space of one block
+    for (int i = 0; i < 64; ++i) {
+        EXPECT_TRUE(put("small" + std::to_string(i), 4096, 'S'));
+    }
+    EXPECT_EQ(cache.GetCachedCount(), 64);
+    EXPECT_EQ(cache.GetCachedBytes(), 64 * 4096);
+    EXPECT_GE(cache.GetReservedBytes(), cache.GetCachedBytes());
+
+    // An object larger than the block size is cached too
+    EXPECT_TRUE(put("large", 5 * block_size, 'L'));
+    HotMemBlock* block = cache.GetHotKey("large");
+    VerifySliceData(block, 5 * block_size, 'L');
+    cache.ReleaseHotKey("large");
+
+    // Filling the arena evicts as many objects as needed
+    EXPECT_TRUE(put("large2", 6 * block_size, 'M'));
+    EXPECT_TRUE(cache.HasHotKey("large2"));
+    EXPECT_FALSE(cache.HasHotKey("large"));
+    EXPECT_LE(cache.GetReservedBytes(), 8 * block_size);
+    EXPECT_EQ(cache.GetCacheSize(), 8);
+
+    // Nothing larger than the arena fits
+    EXPECT_EQ(cache.GetFreeBlock("huge", 9 * block_size, nullptr), nullptr);
+}
+
+TEST_F(LocalHotCacheTest, DeviceHotCacheSkipsHostMemory) {
+    DeviceHotCache cache(16 * 1024 * 1024, 1024 * 1024, /*min_reads=*/1);
+    std::vector<char> data(4096, 'D');
+    std::vector<Slice> slices{{data.data(), data.size()}};
+
+    // Host memory is left to the host hot cache
+    for (int i = 0; i < 4; ++i) {
+        cache.Admit("key", slices);
+    }
+    EXPECT_EQ(cache.GetCachedBytes(), 0u);
+    EXPECT_FALSE(cache.Read("key", data.size(), slices));
+}
+
 // Test concurrent access to LocalHotCache
 TEST_F(LocalHotCacheTest, ConcurrentAccess) {
     const size_t cache_size = 128 * 1024 * 1024;  // 128MB = 8 blocks
@@ -955,6 +1068,35 @@ TEST_F(LocalHotCacheTest, BatchGetWithHotCacheEnabled) {
     }
 }
 
+TEST_F(LocalHotCacheTest, PrefetchThenGet) {
+    auto ctx = SetupTestClientWithHotCache();
+    if (!ctx.client || !ctx.client->IsHotCacheEnabled() ||
+        ctx.segment_ptr == nullptr) {
+        CleanupTestClient(ctx);
+        GTEST_SKIP() << "Client with hot cache and segment not available";
+    }
+
+    const std::string test_key = "test_prefetch_key";
+    const std::string test_data = "Test data for prefetch";
+    PutTestData(ctx.client.get(), test_key, test_data);
+
+    // The replica is in the local segment, so the prefetch only warms the
+    // replica cache, and keys that do not exist are ignored
+    EXPECT_TRUE(ctx.client->Prefetch({test_key, "test_prefetch_missing"}));
+    EXPECT_TRUE(ctx.client->Prefetch({}));
+
+    std::vector<char> get_buffer(test_data.size());
+    std::vector<Slice> get_slices;
+    get_slices.emplace_back(Slice{get_buffer.data(), test_data.size()});
+    auto get_result = ctx.client->Get(test_key, get_slices);
+    ASSERT_TRUE(get_result.has_value()) << "Get should succeed";
+    EXPECT_EQ(std::memcmp(get_buffer.data(), test_data.data(),
+                          test_data.size()),
+              0);
+
+    CleanupTestClient(ctx);
+}
+
 }  // namespace testing
 }  // namespace mooncake
 
@@ -3,6 +3,8 @@
 
 #include <cstdlib>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "client_metric.h"
 
@@ -267,4 +269,55 @@ TEST_F(ClientMetricsTest, SerializeWithoutDynamicLabels) {
     }
 }
 
+TEST_F(ClientMetricsTest, PhaseProfilerAggregatesThreads) {
+    ClientPhaseProfiler profiler;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&profiler] {
+            for (int i = 0; i < 100; ++i) {
+                ScopedPhaseTimer timer(&profiler, ClientPhase::kSubmit);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    {
+        ScopedPhaseTimer timer(&profiler, ClientPhase::kWait);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    ScopedPhaseTimer disabled(nullptr, ClientPhase::kWait);
+
+    auto stats = profiler.Snapshot();
+    auto submit = stats[static_cast<size_t>(ClientPhase::kSubmit)];
+    auto wait = stats[static_cast<size_t>(ClientPhase::kWait)];
+    EXPECT_EQ(submit.count, 400u);
+    EXPECT_EQ(wait.count, 1u);
+    EXPECT_GE(wait.total_us, 15000);
+    EXPECT_LT(wait.total_us, 1000000);
+    EXPECT_EQ(stats[static_cast<size_t>(ClientPhase::kMasterQuery)].count,
+              0u);
+}
+
+TEST_F(ClientMetricsTest, PhaseMetricsSummaryAndSerialize) {
+    ClientPhaseMetric metrics(
+        std::map<std::string, std::string>{{"cluster_id", "test"}});
+    EXPECT_NE(metrics.summary_metrics().find("No phases recorded"),
+              std::string::npos);
+
+    {
+        ScopedPhaseTimer timer(&metrics.profiler, ClientPhase::kMasterQuery);
+    }
+    std::string summary = metrics.summary_metrics();
+    EXPECT_NE(summary.find("master_query: count=1"), std::string::npos);
+    EXPECT_EQ(summary.find("wait:"), std::string::npos);
+
+    std::string serialized;
+    metrics.serialize(serialized);
+    EXPECT_NE(serialized.find("mooncake_client_phase_count{cluster_id="
+                              "\"test\",phase=\"master_query\"} 1"),
+              std::string::npos);
+    EXPECT_NE(serialized.find("mooncake_client_phase_time_us{cluster_id="
+                              "\"test\",phase=\"wait\"} 0"),
+              std::string::npos);
+}
+
 }  // namespace mooncake::test
@@ -0,0 +1,77 @@
+#include "compression.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mooncake::test {
+
+class CompressionTest : public ::testing::TestWithParam<CompressionCodec> {
+   protected:
+    void SetUp() override {
+        if (!IsCompressionCodecAvailable(GetParam())) {
+            GTEST_SKIP() << CompressionCodecName(GetParam())
+                         << " is not built in";
+        }
+    }
+};
+
+TEST(CompressionCodecTest, ParseAndName) {
+    for (auto codec : {CompressionCodec::kNone, CompressionCodec::kLz4,
+                       CompressionCodec::kZstd}) {
+        EXPECT_EQ(ParseCompressionCodec(CompressionCodecName(codec)), codec);
+    }
+    EXPECT_FALSE(ParseCompressionCodec("gzip").has_value());
+    EXPECT_TRUE(IsCompressionCodecAvailable(CompressionCodec::kNone));
+}
+
+TEST_P(CompressionTest, RoundTrip) {
+    // Repetitive data, as in KV caches of padded or similar tokens
+    std::string value;
+    for (int i = 0; value.size() < 256 * 1024; ++i) {
+        value += "token_" + std::to_string(i % 97) + ";";
+    }
+    std::vector<char> compressed(value.size());
+    const size_t size = Compress(GetParam(), 1, value.data(), value.size(),
+                                 compressed.data(), compressed.size());
+    ASSERT_GT(size, 0u);
+    EXPECT_LT(size, value.size() / 4);
+
+    std::string decompressed(value.size(), '\0');
+    ASSERT_TRUE(Decompress(GetParam(), compressed.data(), size,
+                           decompressed.data(), decompressed.size()));
+    EXPECT_EQ(decompressed, value);
+
+    // The original size is part of the check
+    std::string shorter(value.size() - 1, '\0');
+    EXPECT_FALSE(Decompress(GetParam(), compressed.data(), size,
+                            shorter.data(), shorter.size()));
+    compressed[size / 2] ^= 0x5a;
+    EXPECT_FALSE(Decompress(GetParam(), compressed.data(), size,
+                            decompressed.data(), decompressed.size()) &&
+                 decompressed == value);
+}
+
+TEST_P(CompressionTest, IncompressibleDataDoesNotFit) {
+    std::vector<char> value(64 * 1024);
+    std::mt19937 gen(42);
+    for (auto& byte : value) {
+        byte = static_cast<char>(gen());
+    }
+    std::vector<char> compressed(value.size() * 9 / 10);
+    EXPECT_EQ(Compress(GetParam(), 1, value.data(), value.size(),
+                       compressed.data(), compressed.size()),
+              0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, CompressionTest,
+                         ::testing::Values(CompressionCodec::kLz4,
+                                           CompressionCodec::kZstd),
+                         [](const auto& info) {
+                             return std::string(
+                                 CompressionCodecName(info.param));
+                         });
+
+}  // namespace mooncake::test
@@ -0,0 +1,74 @@
+#include "crc32c.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mooncake::test {
+
+namespace {
+
+uint32_t BitwiseCrc32c(const uint8_t* data, size_t len) {
+    uint32_t crc = ~0u;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+}  // namespace
+
+TEST(Crc32cTest, KnownValues) {
+    const std::string digits = "123456789";
+    EXPECT_EQ(0xe3069283u, Crc32c(digits.data(), digits.size()));
+    EXPECT_EQ(0u, Crc32c(nullptr, 0));
+
+    // RFC 3720, appendix B.4
+    std::vector<uint8_t> buf(32, 0);
+    EXPECT_EQ(0x8a9136aau, Crc32c(buf.data(), buf.size()));
+    buf.assign(32, 0xff);
+    EXPECT_EQ(0x62a8ab43u, Crc32c(buf.data(), buf.size()));
+    for (size_t i = 0; i < buf.size(); ++i) {
+        buf[i] = static_cast<uint8_t>(i);
+    }
+    EXPECT_EQ(0x46dd794eu, Crc32c(buf.data(), buf.size()));
+}
+
+TEST(Crc32cTest, MatchesBitwise) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> buf(3 * 8192 * 2 + 3 * 256 + 100);
+    for (auto& byte : buf) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    // Unaligned starts and lengths around the interleaved chunk sizes
+    for (size_t offset : {0, 1, 7}) {
+        for (size_t len : std::vector<size_t>{0, 5, 8, 767, 768, 769, 24575,
+                                              24576, 24583, buf.size() - 7}) {
+            EXPECT_EQ(BitwiseCrc32c(buf.data() + offset, len),
+                      Crc32c(buf.data() + offset, len))
+                << "offset=" << offset << ", len=" << len;
+        }
+    }
+}
+
+TEST(Crc32cTest, ChainAndCombine) {
+    std::mt19937 rng(7);
+    std::vector<uint8_t> buf(100000);
+    for (auto& byte : buf) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    const uint32_t whole = Crc32c(buf.data(), buf.size());
+    for (size_t split : {0, 1, 4096, 33333, 99999}) {
+        const uint32_t a = Crc32c(buf.data(), split);
+        EXPECT_EQ(whole, Crc32c(buf.data() + split, buf.size() - split, a));
+        const uint32_t b = Crc32c(buf.data() + split, buf.size() - split);
+        EXPECT_EQ(whole, Crc32cCombine(a, b, buf.size() - split));
+    }
+}
+
+}  // namespace mooncake::test
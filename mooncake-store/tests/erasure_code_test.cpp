@@ -0,0 +1,116 @@
+#include "erasure_code.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace mooncake::test {
+
+namespace {
+
+std::vector<std::vector<uint8_t>> RandomShards(size_t num, size_t len,
+                                               std::mt19937& rng) {
+    std::vector<std::vector<uint8_t>> shards(num, std::vector<uint8_t>(len));
+    for (auto& shard : shards) {
+        for (auto& byte : shard) {
+            byte = static_cast<uint8_t>(rng());
+        }
+    }
+    return shards;
+}
+
+}  // namespace
+
+TEST(ErasureCodeTest, GfMulAddMatchesScalar) {
+    std::mt19937 rng(42);
+    // Odd lengths exercise the scalar tail of the vector loops
+    for (size_t len : {1, 15, 31, 64, 100, 1000}) {
+        auto bufs = RandomShards(2, len, rng);
+        for (int c : {0, 1, 2, 0x53, 0xff}) {
+            std::vector<uint8_t> expected = bufs[1];
+            for (size_t i = 0; i < len; ++i) {
+                expected[i] ^= GfMul(static_cast<uint8_t>(c), bufs[0][i]);
+            }
+            std::vector<uint8_t> actual = bufs[1];
+            GfMulAdd(static_cast<uint8_t>(c), bufs[0].data(), actual.data(),
+                     len);
+            EXPECT_EQ(expected, actual) << "len=" << len << ", c=" << c;
+        }
+    }
+    EXPECT_EQ(0, GfMul(0, 7));
+    EXPECT_EQ(1, GfMul(0x8e, 2));  // x^8 = x^4 + x^3 + x^2 + 1
+}
+
+TEST(ErasureCodeTest, RecoverFromAnyLostShards) {
+    constexpr size_t kDataShards = 4;
+    constexpr size_t kParityShards = 2;
+    constexpr size_t kLen = 4099;
+    std::mt19937 rng(7);
+    ReedSolomonCode code(kDataShards, kParityShards);
+
+    auto data = RandomShards(kDataShards, kLen, rng);
+    std::vector<std::vector<uint8_t>> parity(kParityShards,
+                                             std::vector<uint8_t>(kLen, 0));
+    std::vector<const uint8_t*> data_ptrs;
+    for (const auto& shard : data) {
+        data_ptrs.push_back(shard.data());
+    }
+    std::vector<uint8_t*> parity_ptrs;
+    for (auto& shard : parity) {
+        parity_ptrs.push_back(shard.data());
+    }
+    // Encoding in two ranges gives the same parity
+    code.Encode(data_ptrs, parity_ptrs, 1000);
+    for (auto& ptr : data_ptrs) ptr += 1000;
+    for (auto& ptr : parity_ptrs) ptr += 1000;
+    code.Encode(data_ptrs, parity_ptrs, kLen - 1000);
+
+    const size_t num_shards = kDataShards + kParityShards;
+    for (size_t lost1 = 0; lost1 < num_shards; ++lost1) {
+        for (size_t lost2 = lost1 + 1; lost2 < num_shards; ++lost2) {
+            auto shards = data;
+            shards.insert(shards.end(), parity.begin(), parity.end());
+            std::vector<bool> present(num_shards, true);
+            present[lost1] = present[lost2] = false;
+            std::fill(shards[lost1].begin(), shards[lost1].end(), 0xaa);
+            std::fill(shards[lost2].begin(), shards[lost2].end(), 0xaa);
+            std::vector<uint8_t*> ptrs;
+            for (auto& shard : shards) {
+                ptrs.push_back(shard.data());
+            }
+            ASSERT_TRUE(code.Decode(ptrs, present, kLen));
+            for (size_t i = 0; i < kDataShards; ++i) {
+                EXPECT_EQ(data[i], shards[i])
+                    << "lost " << lost1 << " and " << lost2;
+            }
+        }
+    }
+
+    // Three lost shards are more than the parity can recover
+    std::vector<uint8_t*> ptrs(num_shards, nullptr);
+    std::vector<bool> present(num_shards, true);
+    present[0] = present[1] = present[2] = false;
+    EXPECT_FALSE(code.Decode(ptrs, present, kLen));
+}
+
+TEST(ErasureCodeTest, NullDataIsZero) {
+    std::mt19937 rng(3);
+    ReedSolomonCode code(2, 1);
+    auto data = RandomShards(1, 64, rng);
+    std::vector<uint8_t> zeros(64, 0);
+    std::vector<uint8_t> expected(64, 0);
+    std::vector<uint8_t> actual(64, 0);
+    std::vector<uint8_t*> expected_ptrs = {expected.data()};
+    std::vector<uint8_t*> actual_ptrs = {actual.data()};
+    code.Encode({data[0].data(), zeros.data()}, expected_ptrs, 64);
+    code.Encode({data[0].data(), nullptr}, actual_ptrs, 64);
+    EXPECT_EQ(expected, actual);
+}
+
+}  // namespace mooncake::test
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -162,6 +162,32 @@ TEST_F(FileStorageTest, BatchLoad) {
     }
 }
 
+TEST_F(FileStorageTest, ReleaseBatchFreesClientBuffers) {
+    std::vector<std::string> keys;
+    std::vector<int64_t> sizes;
+    std::unordered_map<std::string, std::string> batch_data;
+    auto file_storage_config = FileStorageConfig::FromEnvironment();
+    file_storage_config.storage_filepath = data_path;
+    file_storage_config.local_buffer_size = 128 * 1024 * 1024;
+    FileStorage fileStorage(file_storage_config, nullptr, "localhost:9003");
+    ASSERT_TRUE(FileStorageBatchOffload(fileStorage, keys, sizes, batch_data));
+
+    uint64_t batch_id = 0;
+    ASSERT_TRUE(fileStorage.BatchGet(keys, sizes, batch_id));
+    ASSERT_TRUE(fileStorage.ReleaseBatch(batch_id));
+    auto again = fileStorage.ReleaseBatch(batch_id);
+    ASSERT_FALSE(again);
+    EXPECT_EQ(again.error(), ErrorCode::OBJECT_NOT_FOUND);
+
+    // A batch never released goes once its lease runs out
+    fileStorage.config_.client_buffer_gc_ttl_ms = 0;
+    uint64_t abandoned_id = 0;
+    ASSERT_TRUE(fileStorage.BatchGet(keys, sizes, abandoned_id));
+    ASSERT_TRUE(fileStorage.BatchGet(keys, sizes, batch_id));
+    EXPECT_NE(abandoned_id, batch_id);
+    EXPECT_FALSE(fileStorage.ReleaseBatch(abandoned_id));
+}
+
 TEST_F(FileStorageTest, GroupOffloadingKeysByBucket_bucket_keys_limit) {
     std::unordered_map<std::string, int64_t> offloading_objects;
     for (size_t i = 0; i < 35; i++) {
@@ -0,0 +1,144 @@
+#include "flat_replica_list.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+namespace mooncake::test {
+
+class FlatReplicaListTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("FlatReplicaListTest");
+        FLAGS_logtostderr = 1;
+    }
+
+    void TearDown() override { google::ShutdownGoogleLogging(); }
+
+    static AllocatedBuffer::Descriptor MakeStripe(uint64_t size,
+                                                  uintptr_t address,
+                                                  const std::string& endpoint) {
+        AllocatedBuffer::Descriptor stripe;
+        stripe.size_ = size;
+        stripe.buffer_address_ = address;
+        stripe.protocol_ = "rdma";
+        stripe.transport_endpoint_ = endpoint;
+        return stripe;
+    }
+
+    static GetReplicaListResponse MakeResponse() {
+        GetReplicaListResponse response;
+        response.lease_ttl_ms = 5000;
+        response.promote = true;
+
+        Replica::Descriptor memory;
+        memory.id = 7;
+        memory.status = ReplicaStatus::COMPLETE;
+        MemoryDescriptor memory_desc;
+        memory_desc.buffer_descriptor = MakeStripe(100, 0x1000, "node-a:1");
+        memory_desc.extra_stripes.push_back(
+            MakeStripe(100, 0x2000, "node-b:1"));
+        memory_desc.extra_stripes.push_back(
+            MakeStripe(100, 0x3000, "node-a:1"));
+        memory_desc.parity_stripes = 1;
+        memory.descriptor_variant = memory_desc;
+        response.replicas.push_back(memory);
+
+        Replica::Descriptor disk;
+        disk.id = 8;
+        disk.status = ReplicaStatus::COMPLETE;
+        disk.descriptor_variant = DiskDescriptor{"/data/object", 200};
+        response.replicas.push_back(disk);
+
+        Replica::Descriptor local;
+        local.id = 9;
+        local.status = ReplicaStatus::PROCESSING;
+        LocalDiskDescriptor local_desc;
+        local_desc.client_id = {11, 12};
+        local_desc.object_size = 300;
+        local_desc.transport_endpoint = "node-b:1";
+        local.descriptor_variant = local_desc;
+        response.replicas.push_back(local);
+        return response;
+    }
+};
+
+TEST_F(FlatReplicaListTest, RoundTrip) {
+    std::vector<tl::expected<GetReplicaListResponse, ErrorCode>> results;
+    results.emplace_back(MakeResponse());
+    results.emplace_back(tl::make_unexpected(ErrorCode::OBJECT_NOT_FOUND));
+    results.emplace_back(MakeResponse());
+    results[2]->checksum = 0xdeadbeef;
+
+    auto flat = EncodeReplicaLists(results);
+    ASSERT_EQ(flat.num_keys(), 3u);
+    // "rdma", "node-a:1", "node-b:1" and the file path, once each
+    EXPECT_EQ(flat.string_offsets.size(), 5u);
+
+    auto decoded = DecodeReplicaLists(flat);
+    ASSERT_EQ(decoded.size(), 3u);
+    ASSERT_FALSE(decoded[1].has_value());
+    EXPECT_EQ(decoded[1].error(), ErrorCode::OBJECT_NOT_FOUND);
+    ASSERT_TRUE(decoded[0].has_value() && decoded[2].has_value());
+    EXPECT_FALSE(decoded[0]->checksum.has_value());
+    EXPECT_EQ(decoded[2]->checksum, 0xdeadbeefu);
+
+    for (size_t i : {0u, 2u}) {
+        ASSERT_TRUE(decoded[i].has_value());
+        const auto& response = decoded[i].value();
+        EXPECT_EQ(response.lease_ttl_ms, 5000u);
+        EXPECT_TRUE(response.promote);
+        ASSERT_EQ(response.replicas.size(), 3u);
+
+        const auto& memory = response.replicas[0];
+        EXPECT_EQ(memory.id, 7u);
+        EXPECT_EQ(memory.status, ReplicaStatus::COMPLETE);
+        ASSERT_TRUE(memory.is_memory_replica());
+        const auto& memory_desc = memory.get_memory_descriptor();
+        EXPECT_EQ(memory_desc.parity_stripes, 1u);
+        ASSERT_EQ(memory_desc.extra_stripes.size(), 2u);
+        EXPECT_EQ(memory_desc.buffer_descriptor.buffer_address_, 0x1000u);
+        EXPECT_EQ(memory_desc.buffer_descriptor.protocol_, "rdma");
+        EXPECT_EQ(memory_desc.extra_stripes[0].transport_endpoint_,
+                  "node-b:1");
+        EXPECT_EQ(memory_desc.extra_stripes[1].buffer_address_, 0x3000u);
+        EXPECT_EQ(memory_desc.extra_stripes[1].transport_endpoint_,
+                  "node-a:1");
+
+        const auto* disk = std::get_if<DiskDescriptor>(
+            &response.replicas[1].descriptor_variant);
+        ASSERT_NE(disk, nullptr);
+        EXPECT_EQ(disk->file_path, "/data/object");
+        EXPECT_EQ(disk->object_size, 200u);
+
+        const auto* local = std::get_if<LocalDiskDescriptor>(
+            &response.replicas[2].descriptor_variant);
+        ASSERT_NE(local, nullptr);
+        EXPECT_EQ(response.replicas[2].status, ReplicaStatus::PROCESSING);
+        EXPECT_EQ(local->client_id, (UUID{11, 12}));
+        EXPECT_EQ(local->object_size, 300u);
+        EXPECT_EQ(local->transport_endpoint, "node-b:1");
+    }
+}
+
+TEST_F(FlatReplicaListTest, InconsistentArraysFailAllKeys) {
+    std::vector<tl::expected<GetReplicaListResponse, ErrorCode>> results;
+    results.emplace_back(MakeResponse());
+    results.emplace_back(MakeResponse());
+
+    auto flat = EncodeReplicaLists(results);
+    flat.stripe_endpoint.back() = 1000;
+
+    auto decoded = DecodeReplicaLists(flat);
+    ASSERT_EQ(decoded.size(), 2u);
+    for (const auto& result : decoded) {
+        ASSERT_FALSE(result.has_value());
+        EXPECT_EQ(result.error(), ErrorCode::INVALID_PARAMS);
+    }
+}
+
+}  // namespace mooncake::test
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,73 @@
+#include "gds_file_reader.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <future>
+
+#ifdef USE_NVMEOF
+#include <cuda_runtime.h>
+#endif
+
+namespace mooncake {
+
+class GdsFileReaderTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("GdsFileReaderTest");
+        FLAGS_logtostderr = 1;
+    }
+
+    void TearDown() override { google::ShutdownGoogleLogging(); }
+};
+
+TEST_F(GdsFileReaderTest, HostMemoryIsNotDeviceMemory) {
+    std::vector<char> buffer(4096);
+    EXPECT_FALSE(GdsFileReader::IsDeviceMemory({Slice{buffer.data(), 4096}}));
+    // Only skipped ranges leave nothing to read into the GPU
+    EXPECT_FALSE(GdsFileReader::IsDeviceMemory({Slice{nullptr, 4096}}));
+}
+
+#ifdef USE_NVMEOF
+TEST_F(GdsFileReaderTest, ReadIntoDeviceMemory) {
+    auto reader = GdsFileReader::Create(4);
+    if (!reader) {
+        GTEST_SKIP() << "GPUDirect Storage is not available";
+    }
+    void* device = nullptr;
+    if (cudaMalloc(&device, 2 * 1024 * 1024) != cudaSuccess) {
+        GTEST_SKIP() << "No CUDA device";
+    }
+
+    const std::string path = "gds_file_reader_test.bin";
+    std::vector<char> data(3 * 1024 * 1024);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i * 131 + 17);
+    }
+    std::ofstream(path, std::ios::binary).write(data.data(), data.size());
+
+    // The first MiB is skipped, the rest lands in the GPU buffer
+    std::vector<Slice> slices = {Slice{nullptr, 1024 * 1024},
+                                 Slice{device, 2 * 1024 * 1024}};
+    ASSERT_TRUE(GdsFileReader::IsDeviceMemory(slices));
+    std::promise<ErrorCode> promise;
+    reader->Read(path, slices, data.size(),
+                 [&promise](ErrorCode rc) { promise.set_value(rc); });
+    EXPECT_EQ(promise.get_future().get(), ErrorCode::OK);
+
+    std::vector<char> copy(2 * 1024 * 1024);
+    ASSERT_EQ(cudaMemcpy(copy.data(), device, copy.size(),
+                         cudaMemcpyDeviceToHost),
+              cudaSuccess);
+    EXPECT_TRUE(std::equal(copy.begin(), copy.end(),
+                           data.begin() + 1024 * 1024));
+
+    cudaFree(device);
+    std::remove(path.c_str());
+}
+#endif
+
+}  // namespace mooncake
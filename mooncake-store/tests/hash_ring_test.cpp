@@ -0,0 +1,107 @@
+#include "hash_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace mooncake::test {
+
+namespace {
+
+std::vector<std::string> Masters(int count) {
+    std::vector<std::string> masters;
+    for (int i = 0; i < count; ++i) {
+        masters.push_back("10.0.0." + std::to_string(i + 1) + ":50051");
+    }
+    return masters;
+}
+
+}  // namespace
+
+TEST(HashRingTest, OwnersDoNotDependOnMemberOrder) {
+    auto masters = Masters(4);
+    HashRing ring(masters);
+    std::vector<std::string> reversed(masters.rbegin(), masters.rend());
+    reversed.push_back(masters[0]);
+    HashRing other(reversed);
+    ASSERT_EQ(ring.members(), other.members());
+    for (int i = 0; i < 1000; ++i) {
+        const std::string key = "key_" + std::to_string(i);
+        EXPECT_EQ(ring.OwnerOf(key), other.OwnerOf(key));
+    }
+}
+
+TEST(HashRingTest, StableHash) {
+    // Clients and masters of different builds must agree
+    EXPECT_EQ(HashRing::Hash(""), HashRing::Hash(std::string()));
+    EXPECT_NE(HashRing::Hash("a"), HashRing::Hash("b"));
+    EXPECT_NE(HashRing::Hash("key_1"), HashRing::Hash("key_10"));
+    EXPECT_NE(HashRing::Hash(std::string("a\0", 2)), HashRing::Hash("a"));
+}
+
+TEST(HashRingTest, Balance) {
+    HashRing ring(Masters(4));
+    std::vector<int> counts(4);
+    const int kKeys = 100000;
+    for (int i = 0; i < kKeys; ++i) {
+        counts[ring.OwnerOf("key_" + std::to_string(i))]++;
+    }
+    for (int count : counts) {
+        EXPECT_GT(count, kKeys / 4 * 7 / 10);
+        EXPECT_LT(count, kKeys / 4 * 13 / 10);
+    }
+}
+
+TEST(HashRingTest, AddingMemberOnlyMovesKeysToIt) {
+    HashRing ring(Masters(4));
+    HashRing grown(Masters(5));
+    const std::string added = Masters(5)[4];
+    int moved = 0;
+    const int kKeys = 100000;
+    for (int i = 0; i < kKeys; ++i) {
+        const std::string key = "key_" + std::to_string(i);
+        const auto& before = ring.members()[ring.OwnerOf(key)];
+        const auto& after = grown.members()[grown.OwnerOf(key)];
+        if (before != after) {
+            EXPECT_EQ(after, added);
+            moved++;
+        }
+    }
+    // About a fifth of the keys
+    EXPECT_GT(moved, kKeys / 10);
+    EXPECT_LT(moved, kKeys * 3 / 10);
+}
+
+TEST(HashRingTest, SliceSegment) {
+    constexpr size_t kAlign = 4 * 1024 * 1024;
+    Segment segment;
+    segment.id = {7, 9};
+    segment.name = "node1";
+    segment.base = 64 * kAlign;
+    segment.size = 10 * kAlign + 4096;
+
+    auto slices = SliceSegment(segment, 4, kAlign);
+    ASSERT_EQ(slices.size(), 4u);
+    uintptr_t next = segment.base;
+    for (const auto& slice : slices) {
+        EXPECT_EQ(slice.base, next);
+        EXPECT_EQ(slice.base % kAlign, 0u);
+        EXPECT_EQ(slice.name, segment.name);
+        EXPECT_NE(slice.id, segment.id);
+        next += slice.size;
+    }
+    EXPECT_EQ(next, segment.base + segment.size);
+    EXPECT_EQ(slices[0].size, 2 * kAlign);
+    EXPECT_NE(slices[0].id, slices[1].id);
+    EXPECT_EQ(SliceSegment(segment, 4, kAlign)[2].id, slices[2].id);
+
+    // Never smaller than one alignment unit
+    segment.size = 2 * kAlign;
+    EXPECT_EQ(SliceSegment(segment, 4, kAlign).size(), 2u);
+    segment.size = kAlign / 2;
+    ASSERT_EQ(SliceSegment(segment, 4, kAlign).size(), 1u);
+    EXPECT_EQ(SliceSegment(segment, 4, kAlign)[0].size, segment.size);
+}
+
+}  // namespace mooncake::test
@@ -427,6 +427,40 @@ TEST_F(MasterMetricsTest, BatchRequestTest) {
     ASSERT_EQ(metrics.get_batch_put_start_failed_items(), 3);
 }
 
+TEST_F(MasterMetricsTest, ConcurrentUpdatesTest) {
+    auto& metrics = MasterMetricManager::instance();
+    const int64_t pings = metrics.get_ping_requests();
+    const int64_t keys = metrics.get_key_count();
+    const int kThreads = 80;  // More than there are stripes
+    const int kUpdates = 10000;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&metrics, i] {
+            for (int j = 0; j < kUpdates; ++j) {
+                metrics.inc_ping_requests();
+                if (i % 2)
+                    metrics.inc_key_count(2);
+                else
+                    metrics.dec_key_count();
+            }
+        });
+    }
+    // Reads while updating see a consistent, growing count
+    int64_t last = pings;
+    for (int i = 0; i < 100; ++i) {
+        int64_t now = metrics.get_ping_requests();
+        ASSERT_GE(now, last);
+        last = now;
+    }
+    for (auto& thread : threads) thread.join();
+
+    ASSERT_EQ(metrics.get_ping_requests(), pings + kThreads * kUpdates);
+    ASSERT_EQ(metrics.get_key_count(), keys + kThreads / 2 * kUpdates);
+    ASSERT_NE(metrics.serialize_metrics().find("master_ping_requests_total"),
+              std::string::npos);
+}
+
 }  // namespace mooncake::test
 
 int main(int argc, char** argv) {
@@ -3,14 +3,23 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <unistd.h>
+
 #include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <random>
+#include <set>
 #include <thread>
 #include <vector>
 #include <unordered_set>
 #include <utility>
 
+#include "hash_ring.h"
 #include "types.h"
 
 namespace mooncake::test {
@@ -376,6 +385,92 @@ TEST_F(MasterServiceTest, PutStartEndFlow) {
     EXPECT_EQ(ReplicaStatus::COMPLETE, replica_list[0].status);
 }
 
+TEST_F(MasterServiceTest, StreamPutFlow) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    const UUID invalid_client_id = generate_uuid();
+
+    std::string key = "stream_key";
+    std::vector<uint64_t> chunk_lengths = {256, 512, 256};
+    ReplicateConfig config;
+    config.replica_num = 1;
+
+    auto start_result =
+        service_->StreamPutStart(client_id, key, chunk_lengths, config);
+    ASSERT_TRUE(start_result.has_value());
+    ASSERT_EQ(1, start_result->size());
+    EXPECT_EQ(1024, start_result.value()[0]
+                        .get_memory_descriptor()
+                        .buffer_descriptor.size_);
+
+    // Nothing is readable before the first commit, and regular Gets wait
+    // for PutEnd
+    auto list_result = service_->GetStreamReplicaList(key);
+    ASSERT_TRUE(list_result.has_value());
+    EXPECT_TRUE(list_result->is_streaming());
+    EXPECT_EQ(chunk_lengths, list_result->chunk_lengths);
+    EXPECT_FALSE(list_result->IsReadable(0, 1));
+    EXPECT_EQ(ErrorCode::REPLICA_IS_NOT_READY,
+              service_->GetReplicaList(key).error());
+
+    EXPECT_EQ(ErrorCode::ILLEGAL_CLIENT,
+              service_->StreamPutCommit(invalid_client_id, key, 0, 1).error());
+    EXPECT_EQ(ErrorCode::INVALID_PARAMS,
+              service_->StreamPutCommit(client_id, key, 2, 2).error());
+    EXPECT_EQ(ErrorCode::INVALID_PARAMS,
+              service_->StreamPutCommit(client_id, key, 0, 0).error());
+
+    // Commit the first two chunks, the ranges within them become readable
+    ASSERT_TRUE(service_->StreamPutCommit(client_id, key, 0, 2).has_value());
+    list_result = service_->GetStreamReplicaList(key);
+    ASSERT_TRUE(list_result.has_value());
+    EXPECT_GT(list_result->lease_ttl_ms, 0);
+    EXPECT_TRUE(list_result->IsReadable(0, 768));
+    EXPECT_TRUE(list_result->IsReadable(300, 100));
+    EXPECT_FALSE(list_result->IsReadable(700, 100));
+    EXPECT_FALSE(list_result->IsReadable(0, 2048));
+
+    // After PutEnd the object reads like any other
+    ASSERT_TRUE(
+        service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+    list_result = service_->GetStreamReplicaList(key);
+    ASSERT_TRUE(list_result.has_value());
+    EXPECT_FALSE(list_result->is_streaming());
+    ASSERT_EQ(1, list_result->replicas.size());
+    EXPECT_EQ(ReplicaStatus::COMPLETE, list_result->replicas[0].status);
+    EXPECT_EQ(ErrorCode::INVALID_WRITE,
+              service_->StreamPutCommit(client_id, key, 2, 1).error());
+}
+
+TEST_F(MasterServiceTest, StreamPutStartInvalidParams) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    ReplicateConfig config;
+    config.replica_num = 1;
+
+    EXPECT_EQ(ErrorCode::INVALID_PARAMS,
+              service_->StreamPutStart(client_id, "key", {}, config).error());
+    EXPECT_EQ(
+        ErrorCode::INVALID_PARAMS,
+        service_->StreamPutStart(client_id, "key", {64, 0}, config).error());
+
+    ReplicateConfig striped = config;
+    striped.stripe_num = 2;
+    EXPECT_EQ(
+        ErrorCode::INVALID_PARAMS,
+        service_->StreamPutStart(client_id, "key", {64, 64}, striped).error());
+
+    // A revoked stream leaves nothing behind
+    ASSERT_TRUE(
+        service_->StreamPutStart(client_id, "key", {64}, config).has_value());
+    ASSERT_TRUE(
+        service_->PutRevoke(client_id, "key", ReplicaType::MEMORY).has_value());
+    EXPECT_EQ(ErrorCode::OBJECT_NOT_FOUND,
+              service_->GetStreamReplicaList("key").error());
+}
+
 TEST_F(MasterServiceTest, PutWithPreferredSegment) {
     // For backward compatibility, test the deprecated single preferred_segment
     std::unique_ptr<MasterService> service_(new MasterService());
@@ -707,6 +802,256 @@ TEST_F(MasterServiceTest, GetReplicaList) {
     EXPECT_TRUE(get_result2.has_value());
     auto replica_list_local = get_result2.value().replicas;
     EXPECT_FALSE(replica_list_local.empty());
+    EXPECT_FALSE(get_result2.value().checksum.has_value());
+}
+
+TEST_F(MasterServiceTest, PutEndWithChecksum) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    ReplicateConfig config;
+    config.replica_num = 1;
+
+    ASSERT_TRUE(service_->PutStart(client_id, "key0", 1024, config));
+    ASSERT_TRUE(
+        service_->PutEnd(client_id, "key0", ReplicaType::MEMORY, 0xdeadbeef));
+    auto get_result = service_->GetReplicaList("key0");
+    ASSERT_TRUE(get_result.has_value());
+    EXPECT_EQ(0xdeadbeef, get_result.value().checksum);
+
+    // The checksums of a batch must match the keys one to one
+    std::vector<std::string> keys = {"key1", "key2"};
+    for (const auto& key : keys) {
+        ASSERT_TRUE(service_->PutStart(client_id, key, 1024, config));
+    }
+    auto bad_results = service_->BatchPutEnd(client_id, keys, {1});
+    ASSERT_EQ(2u, bad_results.size());
+    for (const auto& result : bad_results) {
+        EXPECT_EQ(ErrorCode::INVALID_PARAMS, result.error());
+    }
+    auto results = service_->BatchPutEnd(client_id, keys, {1, 2});
+    ASSERT_EQ(2u, results.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_TRUE(results[i].has_value());
+        auto result = service_->GetReplicaList(keys[i]);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(i + 1, result.value().checksum);
+    }
+}
+
+TEST_F(MasterServiceTest, DeduplicatedPuts) {
+    auto service_config = MasterServiceConfig::builder()
+                              .set_default_kv_lease_ttl(0)
+                              .set_enable_dedup(true)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    ReplicateConfig config;
+    config.replica_num = 1;
+    config.content_hash = "prefix_block_0";
+
+    // The first put writes the content
+    auto first = service_->PutStart(client_id, "session_a/block", 1024, config);
+    ASSERT_TRUE(first.has_value());
+    ASSERT_EQ(1u, first->size());
+    // Content being written is not shared, the put is stored by itself
+    auto concurrent =
+        service_->PutStart(client_id, "session_c/block", 1024, config);
+    ASSERT_TRUE(concurrent.has_value());
+    EXPECT_EQ(1u, concurrent->size());
+    ASSERT_TRUE(
+        service_->PutEnd(client_id, "session_a/block", ReplicaType::MEMORY));
+
+    // The next ones share its replicas, and have nothing to write
+    auto second =
+        service_->PutStart(client_id, "session_b/block", 1024, config);
+    ASSERT_TRUE(second.has_value());
+    EXPECT_TRUE(second->empty());
+    EXPECT_EQ(ErrorCode::OBJECT_ALREADY_EXISTS,
+              service_->PutStart(client_id, "session_b/block", 1024, config)
+                  .error());
+    // Another size is another content
+    auto other_size =
+        service_->PutStart(client_id, "session_d/block", 2048, config);
+    ASSERT_TRUE(other_size.has_value());
+    EXPECT_EQ(1u, other_size->size());
+
+    auto get_a = service_->GetReplicaList("session_a/block");
+    auto get_b = service_->GetReplicaList("session_b/block");
+    ASSERT_TRUE(get_a.has_value());
+    ASSERT_TRUE(get_b.has_value());
+    EXPECT_EQ(get_a->replicas[0]
+                  .get_memory_descriptor()
+                  .buffer_descriptor.buffer_address_,
+              get_b->replicas[0]
+                  .get_memory_descriptor()
+                  .buffer_descriptor.buffer_address_);
+    auto batch = service_->BatchGetReplicaList(
+        {"session_a/block", "session_b/block", "missing"});
+    ASSERT_EQ(3u, batch.size());
+    EXPECT_TRUE(batch[0].has_value());
+    EXPECT_TRUE(batch[1].has_value());
+    EXPECT_FALSE(batch[2].has_value());
+    EXPECT_TRUE(service_->ExistKey("session_b/block").value());
+
+    // The internal content key is neither listed nor removable
+    auto keys = service_->GetAllKeys();
+    ASSERT_TRUE(keys.has_value());
+    for (const auto& key : *keys) {
+        EXPECT_EQ(std::string::npos, key.find("prefix_block_0")) << key;
+    }
+    EXPECT_EQ(ErrorCode::INVALID_PARAMS,
+              service_->Remove("__mooncake_dedup__/prefix_block_0").error());
+
+    // Removing one key keeps the content for the other
+    ASSERT_TRUE(service_->Remove("session_a/block").has_value());
+    EXPECT_EQ(ErrorCode::OBJECT_NOT_FOUND,
+              service_->GetReplicaList("session_a/block").error());
+    ASSERT_TRUE(service_->GetReplicaList("session_b/block").has_value());
+
+    // The last reference frees it
+    ASSERT_TRUE(service_->Remove("session_b/block").has_value());
+    EXPECT_EQ(ErrorCode::OBJECT_NOT_FOUND,
+              service_->GetReplicaList("session_b/block").error());
+    auto third = service_->PutStart(client_id, "session_e/block", 1024, config);
+    ASSERT_TRUE(third.has_value());
+    EXPECT_EQ(1u, third->size());
+}
+
+TEST_F(MasterServiceTest, RemovesObjectsWhenTtlRunsOut) {
+    auto service_config =
+        MasterServiceConfig::builder().set_default_kv_lease_ttl(200).build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    ReplicateConfig config;
+    config.replica_num = 1;
+    ReplicateConfig ttl_config = config;
+    ttl_config.ttl_ms = 300;
+    const int64_t expired_before =
+        MasterMetricManager::instance().get_ttl_expired_keys();
+
+    for (const auto& [key, key_config] :
+         {std::pair{"kept", config}, std::pair{"short_lived", ttl_config}}) {
+        ASSERT_TRUE(
+            service_->PutStart(client_id, key, 1024, key_config).has_value());
+        ASSERT_TRUE(service_->PutEnd(client_id, key, ReplicaType::MEMORY)
+                        .has_value());
+    }
+    // The lease granted to the reader delays the removal past the TTL
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_TRUE(service_->ExistKey("short_lived").value());
+
+    bool expired = false;
+    for (int i = 0; i < 30 && !expired; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        expired = MasterMetricManager::instance().get_ttl_expired_keys() >
+                  expired_before;
+    }
+    EXPECT_TRUE(expired);
+    EXPECT_FALSE(service_->ExistKey("short_lived").value());
+    EXPECT_TRUE(service_->ExistKey("kept").value());
+    // The key can be put again
+    ASSERT_TRUE(service_->PutStart(client_id, "short_lived", 1024, config)
+                    .has_value());
+}
+
+TEST_F(MasterServiceTest, ScanKeysInPages) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    ReplicateConfig config;
+    config.replica_num = 1;
+
+    std::set<std::string> expected;
+    for (int i = 0; i < 300; ++i) {
+        std::string key = (i % 3 ? "scan_a_" : "scan_b_") + std::to_string(i);
+        ASSERT_TRUE(
+            service_->PutStart(client_id, key, 1024, config).has_value());
+        ASSERT_TRUE(service_->PutEnd(client_id, key, ReplicaType::MEMORY)
+                        .has_value());
+        if (i % 3) expected.insert(key);
+    }
+
+    std::set<std::string> scanned;
+    ScanKeysCursor cursor;
+    int pages = 0;
+    while (true) {
+        auto page = service_->ScanKeys(cursor, 7, "scan_a_", true);
+        ASSERT_TRUE(page.has_value());
+        EXPECT_LE(page->entries.size(), 7u);
+        for (const auto& entry : page->entries) {
+            EXPECT_TRUE(scanned.insert(entry.key).second) << entry.key;
+            EXPECT_EQ(1024u, entry.size);
+            EXPECT_EQ(1u, entry.num_replicas);
+        }
+        ++pages;
+        if (page->done) break;
+        // Removed keys do not disturb the scan
+        ASSERT_TRUE(service_->Remove("scan_b_" + std::to_string(pages * 3))
+                        .has_value());
+        cursor = page->next;
+    }
+    EXPECT_EQ(expected, scanned);
+    EXPECT_GE(pages, 200 / 7);
+
+    EXPECT_EQ(ErrorCode::INVALID_PARAMS,
+              service_->ScanKeys({}, 0, "", false).error());
+    ScanKeysCursor past_end;
+    past_end.shard = 1 << 20;
+    EXPECT_EQ(ErrorCode::INVALID_PARAMS,
+              service_->ScanKeys(past_end, 10, "", false).error());
+}
+
+TEST_F(MasterServiceTest, BatchGetReplicaList) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    ReplicateConfig config;
+    config.replica_num = 1;
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 16; ++i) {
+        keys.push_back("batch_key_" + std::to_string(i));
+        ASSERT_TRUE(service_->PutStart(client_id, keys.back(), 1024, config)
+                        .has_value());
+        ASSERT_TRUE(
+            service_->PutEnd(client_id, keys.back(), ReplicaType::MEMORY)
+                .has_value());
+    }
+    ASSERT_TRUE(
+        service_->PutStart(client_id, "processing", 1024, config).has_value());
+    keys.insert(keys.begin() + 3, "non_existent");
+    keys.insert(keys.begin() + 7, "processing");
+
+    // Results follow the order of the keys, whichever shard they are in
+    auto results = service_->BatchGetReplicaList(keys);
+    ASSERT_EQ(keys.size(), results.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == "non_existent") {
+            ASSERT_FALSE(results[i].has_value());
+            EXPECT_EQ(ErrorCode::OBJECT_NOT_FOUND, results[i].error());
+        } else if (keys[i] == "processing") {
+            ASSERT_FALSE(results[i].has_value());
+            EXPECT_EQ(ErrorCode::REPLICA_IS_NOT_READY, results[i].error());
+        } else {
+            ASSERT_TRUE(results[i].has_value());
+            auto single = service_->GetReplicaList(keys[i]);
+            ASSERT_TRUE(single.has_value());
+            ASSERT_EQ(1, results[i]->replicas.size());
+            EXPECT_EQ(single->replicas[0].get_memory_descriptor()
+                          .buffer_descriptor.buffer_address_,
+                      results[i]
+                          ->replicas[0]
+                          .get_memory_descriptor()
+                          .buffer_descriptor.buffer_address_);
+            // The batch granted a lease to every object
+            auto remove_result = service_->Remove(keys[i]);
+            ASSERT_FALSE(remove_result.has_value());
+            EXPECT_EQ(ErrorCode::OBJECT_HAS_LEASE, remove_result.error());
+        }
+    }
 }
 
 TEST_F(MasterServiceTest, RemoveObject) {
@@ -807,6 +1152,51 @@ TEST_F(MasterServiceTest, RemoveByRegex) {
     }
 }
 
+TEST_F(MasterServiceTest, RegexWithPrefixIndex) {
+    const uint64_t kv_lease_ttl = 50;
+    for (bool enable_prefix_index : {false, true}) {
+        auto service_config = MasterServiceConfig::builder()
+                                  .set_default_kv_lease_ttl(kv_lease_ttl)
+                                  .set_enable_prefix_index(enable_prefix_index)
+                                  .build();
+        auto service_ = std::make_unique<MasterService>(service_config);
+        [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+        const UUID client_id = generate_uuid();
+        for (const std::string key :
+             {"model/layer1", "model/layer2", "model/layer10", "model/head",
+              "other/layer1", "modelx"}) {
+            ReplicateConfig config;
+            config.replica_num = 1;
+            ASSERT_TRUE(
+                service_->PutStart(client_id, key, 1024, config).has_value());
+            ASSERT_TRUE(service_->PutEnd(client_id, key, ReplicaType::MEMORY)
+                            .has_value());
+        }
+
+        auto result = service_->GetReplicaListByRegex("^model/layer\\d$");
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(2, result->size());
+        EXPECT_TRUE(result->count("model/layer1"));
+        EXPECT_TRUE(result->count("model/layer2"));
+
+        // Patterns without a literal prefix fall back to a full scan
+        result = service_->GetReplicaListByRegex("layer1");
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(3, result->size());
+        result = service_->GetReplicaListByRegex("^model/head|^modelx");
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(2, result->size());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl));
+        auto removed = service_->RemoveByRegex("^model/");
+        ASSERT_TRUE(removed.has_value());
+        EXPECT_EQ(4, removed.value());
+        EXPECT_FALSE(service_->ExistKey("model/layer10").value());
+        EXPECT_TRUE(service_->ExistKey("other/layer1").value());
+        EXPECT_TRUE(service_->ExistKey("modelx").value());
+    }
+}
+
 TEST_F(MasterServiceTest, CopyStart) {
     const uint64_t kv_lease_ttl = 50;
     auto service_config = MasterServiceConfig::builder()
@@ -1611,6 +2001,60 @@ TEST_F(MasterServiceTest, DiscardTimeoutCopyMove) {
     EXPECT_EQ(move_end_result.error(), ErrorCode::OBJECT_NOT_FOUND);
 }
 
+TEST_F(MasterServiceTest, DefragmentSegments) {
+    const uint64_t kv_lease_ttl = 50;
+    auto service_config = MasterServiceConfig::builder()
+                              .set_default_kv_lease_ttl(kv_lease_ttl)
+                              .set_defrag_max_moves(4)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const auto context1 = PrepareSimpleSegment(*service_, "segment_1");
+
+    // Fill segment_1 with 1MB objects
+    const UUID client_id = generate_uuid();
+    constexpr uint64_t kObjectSize = 1024 * 1024;
+    constexpr size_t kNumObjects = kDefaultSegmentSize / kObjectSize;
+    ReplicateConfig config;
+    config.replica_num = 1;
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < kNumObjects; ++i) {
+        keys.push_back("defrag_key_" + std::to_string(i));
+        ASSERT_TRUE(
+            service_->PutStart(client_id, keys[i], kObjectSize, config));
+        ASSERT_TRUE(service_->PutEnd(client_id, keys[i], ReplicaType::MEMORY));
+    }
+    const auto context2 =
+        PrepareSimpleSegment(*service_, "segment_2", 0x400000000);
+
+    // A full segment is not fragmented.
+    std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl + 10));
+    EXPECT_EQ(0u, service_->DefragmentSegments());
+
+    // Removing every other object leaves 8MB free in 1MB holes.
+    for (size_t i = 0; i < kNumObjects; i += 2) {
+        ASSERT_TRUE(service_->Remove(keys[i]));
+    }
+
+    // The remaining objects of segment_1 are moved to segment_2 by its
+    // client, at most defrag_max_moves per round.
+    EXPECT_EQ(4u, service_->DefragmentSegments());
+    auto tasks = service_->FetchTasks(context1.client_id, 16);
+    ASSERT_TRUE(tasks.has_value());
+    ASSERT_EQ(4u, tasks->size());
+    for (const auto& task : *tasks) {
+        EXPECT_EQ(TaskType::REPLICA_MOVE, task.type);
+    }
+    tasks = service_->FetchTasks(context2.client_id, 16);
+    ASSERT_TRUE(tasks.has_value());
+    EXPECT_TRUE(tasks->empty());
+
+    // Objects that are in use are not moved.
+    for (size_t i = 1; i < kNumObjects; i += 2) {
+        ASSERT_TRUE(service_->GetReplicaList(keys[i]));
+    }
+    EXPECT_EQ(0u, service_->DefragmentSegments());
+}
+
 TEST_F(MasterServiceTest, RemoveByRegexComplex) {
     const uint64_t kv_lease_ttl = 100;
     auto service_config = MasterServiceConfig::builder()
@@ -1822,6 +2266,44 @@ TEST_F(MasterServiceTest, RemoveAll) {
     }
 }
 
+TEST_F(MasterServiceTest, RemoveUnownedObjects) {
+    const uint64_t kv_lease_ttl = 50;
+    auto service_config = MasterServiceConfig::builder()
+                              .set_default_kv_lease_ttl(kv_lease_ttl)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    for (int i = 0; i < 10; ++i) {
+        std::string key = "test_key" + std::to_string(i);
+        ReplicateConfig config;
+        config.replica_num = 1;
+        ASSERT_TRUE(service_->PutStart(client_id, key, 1024, config));
+        ASSERT_TRUE(service_->PutEnd(client_id, key, ReplicaType::MEMORY));
+    }
+    ASSERT_TRUE(service_->GetReplicaList("test_key1").has_value());
+    std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl));
+    // Only grant a lease to one of the unowned keys
+    ASSERT_TRUE(service_->GetReplicaList("test_key1").has_value());
+
+    // Keys with an even index stay owned by this master
+    auto owned = [](const std::string& key) {
+        return (key.back() - '0') % 2 == 0;
+    };
+    long kept = 0;
+    EXPECT_EQ(4, service_->RemoveUnownedObjects(owned, kept));
+    EXPECT_EQ(1, kept);
+    for (int i = 0; i < 10; ++i) {
+        auto exist_result = service_->ExistKey("test_key" + std::to_string(i));
+        ASSERT_TRUE(exist_result.has_value());
+        EXPECT_EQ(exist_result.value(), i % 2 == 0 || i == 1) << i;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl));
+    EXPECT_EQ(1, service_->RemoveUnownedObjects(owned, kept));
+    EXPECT_EQ(0, kept);
+}
+
 TEST_F(MasterServiceTest, SingleSliceMultiReplicaFlow) {
     const uint64_t kv_lease_ttl = 50;
     auto service_config = MasterServiceConfig::builder()
@@ -2342,6 +2824,48 @@ TEST_F(MasterServiceTest, UnmountSegmentPerformance) {
               << "Unmount time: " << unmount_duration.count() << "ms\n";
 }
 
+TEST_F(MasterServiceTest, ExpiredClientObjectsSweptInBackground) {
+    const uint64_t client_live_ttl = 1;
+    auto service_config = MasterServiceConfig::builder()
+                              .set_client_live_ttl_sec(client_live_ttl)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const auto context = PrepareSimpleSegment(*service_);
+
+    constexpr int kNumKeys = 64;
+    std::vector<std::string> keys;
+    for (int i = 0; i < kNumKeys; ++i) {
+        keys.push_back(
+            GenerateKeyForSegment(context.client_id, service_, "test_segment"));
+    }
+    ASSERT_EQ(kNumKeys, service_->GetKeyCount());
+
+    // The client stops pinging, so the client monitor unmounts its segment
+    // and the sweep thread removes its objects.
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (service_->GetKeyCount() > 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    EXPECT_EQ(0, service_->GetKeyCount());
+    for (const auto& key : keys) {
+        auto get_result = service_->GetReplicaList(key);
+        ASSERT_FALSE(get_result.has_value());
+        EXPECT_EQ(ErrorCode::OBJECT_NOT_FOUND, get_result.error());
+    }
+
+    // The keys can be written again to a new segment
+    const auto new_context = PrepareSimpleSegment(*service_, "new_segment");
+    auto put_start_result = service_->PutStart(new_context.client_id, keys[0],
+                                               1024, {.replica_num = 1});
+    ASSERT_TRUE(put_start_result.has_value());
+    EXPECT_TRUE(service_
+                    ->PutEnd(new_context.client_id, keys[0],
+                             ReplicaType::MEMORY)
+                    .has_value());
+}
+
 TEST_F(MasterServiceTest, RemoveLeasedObject) {
     const uint64_t kv_lease_ttl = 50;
     auto service_config = MasterServiceConfig::builder()
@@ -2513,96 +3037,357 @@ TEST_F(MasterServiceTest, EvictObject) {
     service_->RemoveAll();
 }
 
-TEST_F(MasterServiceTest, TryEvictLeasedObject) {
+TEST_F(MasterServiceTest, SampledEvictObject) {
     // set a large kv_lease_ttl so the granted lease will not quickly expire
-    const uint64_t kv_lease_ttl = 500;
+    const uint64_t kv_lease_ttl = 2000;
     auto service_config = MasterServiceConfig::builder()
                               .set_default_kv_lease_ttl(kv_lease_ttl)
+                              .set_eviction_sample_size(16)
+                              .set_eviction_shards_per_tick(128)
                               .build();
     std::unique_ptr<MasterService> service_(new MasterService(service_config));
     const UUID client_id = generate_uuid();
     constexpr size_t buffer = 0x300000000;
-    constexpr size_t size = 1024 * 1024 * 16;
-    constexpr size_t object_size = 1024 * 1024;
+    constexpr size_t size = 1024 * 1024 * 16 * 15;
+    constexpr size_t object_size = 1024 * 15;
     [[maybe_unused]] const auto context =
         PrepareSimpleSegment(*service_, "test_segment", buffer, size);
 
-    // Verify leased object will not be evicted.
+    const int64_t evicted_before =
+        MasterMetricManager::instance().get_evicted_key_count();
+
+    // Verify incremental eviction frees enough space to keep putting objects
     int success_puts = 0;
-    int failed_puts = 0;
-    std::vector<std::string> leased_keys;
-    for (int i = 0; i < 16 + 10; ++i) {
+    for (int i = 0; i < 1024 * 16 + 50; ++i) {
         std::string key = "test_key" + std::to_string(i);
-        uint64_t slice_length = object_size;
         ReplicateConfig config;
         config.replica_num = 1;
         auto put_start_result =
-            service_->PutStart(client_id, key, slice_length, config);
+            service_->PutStart(client_id, key, object_size, config);
         if (put_start_result.has_value()) {
             auto put_end_result =
                 service_->PutEnd(client_id, key, ReplicaType::MEMORY);
             ASSERT_TRUE(put_end_result.has_value());
-            // the object is leased
-            auto get_result = service_->GetReplicaList(key);
-            ASSERT_TRUE(get_result.has_value());
-            leased_keys.push_back(key);
             success_puts++;
         } else {
-            failed_puts++;
+            // wait for eviction to work
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
         }
     }
-    ASSERT_GT(success_puts, 0);
-    ASSERT_GT(failed_puts, 0);
-    // wait for eviction to do eviction
-    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-    // All leased objects should be accessible
-    for (const auto& key : leased_keys) {
-        auto get_result = service_->GetReplicaList(key);
-        ASSERT_TRUE(get_result.has_value());
-    }
+    ASSERT_GT(success_puts, 1024 * 16);
+    EXPECT_GT(MasterMetricManager::instance().get_evicted_key_count(),
+              evicted_before);
     std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl));
     service_->RemoveAll();
 }
 
-TEST_F(MasterServiceTest, RemoveSoftPinObject) {
-    const uint64_t kv_lease_ttl = 200;
-    // set a large soft_pin_ttl so the granted soft pin will not quickly expire
-    const uint64_t kv_soft_pin_ttl = 10000;
-    const bool allow_evict_soft_pinned_objects = true;
+TEST_F(MasterServiceTest, CostAwareEvictionKeepsCostlyObjects) {
+    const uint64_t kv_lease_ttl = 2000;
     auto service_config = MasterServiceConfig::builder()
                               .set_default_kv_lease_ttl(kv_lease_ttl)
-                              .set_default_kv_soft_pin_ttl(kv_soft_pin_ttl)
-                              .set_allow_evict_soft_pinned_objects(
-                                  allow_evict_soft_pinned_objects)
+                              .set_enable_cost_aware_eviction(true)
                               .build();
     std::unique_ptr<MasterService> service_(new MasterService(service_config));
     const UUID client_id = generate_uuid();
-    // Mount segment and put an object
     constexpr size_t buffer = 0x300000000;
-    constexpr size_t size = 1024 * 1024 * 16;
+    constexpr size_t size = 1024 * 1024 * 16 * 15;
+    constexpr size_t object_size = 1024 * 15;
     [[maybe_unused]] const auto context =
         PrepareSimpleSegment(*service_, "test_segment", buffer, size);
 
-    std::string key = "test_key";
-    uint64_t slice_length = 1024;
-    ReplicateConfig config;
-    config.replica_num = 1;
-    config.with_soft_pin = true;
-
-    // Verify soft pin does not block remove
-    ASSERT_TRUE(
-        service_->PutStart(client_id, key, slice_length, config).has_value());
-    ASSERT_TRUE(
-        service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
-    EXPECT_TRUE(service_->Remove(key).has_value());
+    auto put = [&](const std::string& key, uint64_t cost_hint) {
+        ReplicateConfig config;
+        config.replica_num = 1;
+        config.cost_hint = cost_hint;
+        auto put_start_result =
+            service_->PutStart(client_id, key, object_size, config);
+        if (!put_start_result.has_value()) {
+            return false;
+        }
+        EXPECT_TRUE(
+            service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+        return true;
+    };
 
-    // Verify soft pin does not block RemoveAll
-    ASSERT_TRUE(
-        service_->PutStart(client_id, key, slice_length, config).has_value());
-    ASSERT_TRUE(
-        service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
-    EXPECT_EQ(1, service_->RemoveAll());
-}
+    // Put first, so that by lease timeout they would be evicted first
+    constexpr int kCostlyKeys = 1024;
+    for (int i = 0; i < kCostlyKeys; ++i) {
+        ASSERT_TRUE(put("costly_key" + std::to_string(i), object_size * 1000));
+    }
+    int success_puts = 0;
+    for (int i = 0; i < 1024 * 16 + 50; ++i) {
+        if (put("cheap_key" + std::to_string(i), 0)) {
+            success_puts++;
+        } else {
+            // wait for eviction to work
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    ASSERT_GT(success_puts, 1024 * 15);
+
+    int costly_left = 0;
+    for (int i = 0; i < kCostlyKeys; ++i) {
+        auto exist = service_->ExistKey("costly_key" + std::to_string(i));
+        if (exist.has_value() && exist.value()) {
+            costly_left++;
+        }
+    }
+    EXPECT_EQ(costly_left, kCostlyKeys);
+    std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl));
+    service_->RemoveAll();
+}
+
+TEST_F(MasterServiceTest, TenantOverQuotaIsEvictedFirst) {
+    const uint64_t kv_lease_ttl = 2000;
+    auto service_config = MasterServiceConfig::builder()
+                              .set_default_kv_lease_ttl(kv_lease_ttl)
+                              .set_tenant_quotas("quiet=64MB,noisy=16MB")
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const UUID client_id = generate_uuid();
+    constexpr size_t buffer = 0x300000000;
+    constexpr size_t size = 1024 * 1024 * 16 * 15;
+    constexpr size_t object_size = 1024 * 15;
+    [[maybe_unused]] const auto context =
+        PrepareSimpleSegment(*service_, "test_segment", buffer, size);
+
+    auto put = [&](const std::string& key) {
+        ReplicateConfig config;
+        config.replica_num = 1;
+        auto put_start_result =
+            service_->PutStart(client_id, key, object_size, config);
+        if (!put_start_result.has_value()) {
+            return false;
+        }
+        EXPECT_TRUE(
+            service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+        return true;
+    };
+
+    // Put first, so that by lease timeout they would be evicted first
+    constexpr int kQuietKeys = 1024;
+    for (int i = 0; i < kQuietKeys; ++i) {
+        ASSERT_TRUE(put("quiet/key" + std::to_string(i)));
+    }
+    int success_puts = 0;
+    for (int i = 0; i < 1024 * 16 + 50; ++i) {
+        if (put("noisy/key" + std::to_string(i))) {
+            success_puts++;
+        } else {
+            // wait for eviction to work
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    ASSERT_GT(success_puts, 1024 * 15);
+
+    int quiet_left = 0;
+    for (int i = 0; i < kQuietKeys; ++i) {
+        auto exist = service_->ExistKey("quiet/key" + std::to_string(i));
+        if (exist.has_value() && exist.value()) {
+            quiet_left++;
+        }
+    }
+    EXPECT_EQ(quiet_left, kQuietKeys);
+
+    auto& metrics = MasterMetricManager::instance();
+    const int64_t hits = metrics.get_tenant_get_hits("quiet");
+    const int64_t misses = metrics.get_tenant_get_misses("quiet");
+    EXPECT_TRUE(service_->GetReplicaList("quiet/key0").has_value());
+    EXPECT_FALSE(service_->GetReplicaList("quiet/missing").has_value());
+    EXPECT_EQ(metrics.get_tenant_get_hits("quiet"), hits + 1);
+    EXPECT_EQ(metrics.get_tenant_get_misses("quiet"), misses + 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl));
+    service_->RemoveAll();
+}
+
+TEST_F(MasterServiceTest, RejectsMalformedTenantQuotas) {
+    for (const std::string quotas : {"quiet", "quiet=", "quiet=1GB,quiet=2GB",
+                                     "=1GB", "a/b=1GB"}) {
+        auto service_config =
+            MasterServiceConfig::builder().set_tenant_quotas(quotas).build();
+        EXPECT_THROW(MasterService service(service_config),
+                     std::invalid_argument)
+            << quotas;
+    }
+}
+
+TEST_F(MasterServiceTest, SegmentPressureEvictionSparesIdleSegments) {
+    auto service_config = MasterServiceConfig::builder()
+                              .set_eviction_ratio(0.1)
+                              .set_eviction_high_watermark_ratio(0.5)
+                              .set_enable_segment_pressure_eviction(true)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const UUID client_id = generate_uuid();
+    constexpr size_t object_size = 1024 * 1024;
+    // The hot segment goes over the watermark, the cluster stays far below
+    [[maybe_unused]] const auto hot = PrepareSimpleSegment(
+        *service_, "hot_segment", 0x300000000, 16 * object_size);
+    [[maybe_unused]] const auto idle = PrepareSimpleSegment(
+        *service_, "idle_segment", 0x400000000, 1024 * object_size);
+
+    auto put = [&](const std::string& key, const std::string& segment) {
+        ReplicateConfig config;
+        config.replica_num = 1;
+        config.preferred_segment = segment;
+        ASSERT_TRUE(
+            service_->PutStart(client_id, key, object_size, config)
+                .has_value());
+        ASSERT_TRUE(
+            service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+    };
+    constexpr int kHotKeys = 12;
+    constexpr int kIdleKeys = 32;
+    for (int i = 0; i < kHotKeys; ++i) {
+        put("hot_key" + std::to_string(i), "hot_segment");
+    }
+    for (int i = 0; i < kIdleKeys; ++i) {
+        put("idle_key" + std::to_string(i), "idle_segment");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    auto count_existing = [&](const std::string& prefix, int num) {
+        int existing = 0;
+        for (int i = 0; i < num; ++i) {
+            auto exist = service_->ExistKey(prefix + std::to_string(i));
+            if (exist.has_value() && exist.value()) {
+                existing++;
+            }
+        }
+        return existing;
+    };
+    // 12 of 16 objects is 0.25 over the watermark, and 0.1 more is evicted
+    EXPECT_LE(count_existing("hot_key", kHotKeys), 8);
+    EXPECT_EQ(count_existing("idle_key", kIdleKeys), kIdleKeys);
+    service_->RemoveAll();
+}
+
+TEST_F(MasterServiceTest, RebalanceTowardsNewSegment) {
+    auto service_config = MasterServiceConfig::builder()
+                              .set_rebalance_bandwidth_mb(1024)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const UUID client_id = generate_uuid();
+    constexpr size_t object_size = 1024 * 1024;
+    const auto old_segment = PrepareSimpleSegment(
+        *service_, "old_segment", 0x300000000, 16 * object_size);
+    constexpr int kNumKeys = 8;
+    for (int i = 0; i < kNumKeys; ++i) {
+        const std::string key = "key" + std::to_string(i);
+        ReplicateConfig config;
+        config.replica_num = 1;
+        ASSERT_TRUE(service_->PutStart(client_id, key, object_size, config)
+                        .has_value());
+        ASSERT_TRUE(
+            service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+    }
+
+    // Half full against empty, so about half of the objects move over
+    [[maybe_unused]] const auto new_segment = PrepareSimpleSegment(
+        *service_, "new_segment", 0x400000000, 16 * object_size);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    auto fetched =
+        service_->FetchTasks(old_segment.client_id, /*batch_size=*/16);
+    ASSERT_TRUE(fetched.has_value());
+    EXPECT_GE(fetched->size(), 3);
+    EXPECT_LE(fetched->size(), 5);
+    for (const auto& task : *fetched) {
+        EXPECT_EQ(TaskType::REPLICA_MOVE, task.type);
+    }
+    service_->RemoveAll();
+}
+
+TEST_F(MasterServiceTest, TryEvictLeasedObject) {
+    // set a large kv_lease_ttl so the granted lease will not quickly expire
+    const uint64_t kv_lease_ttl = 500;
+    auto service_config = MasterServiceConfig::builder()
+                              .set_default_kv_lease_ttl(kv_lease_ttl)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const UUID client_id = generate_uuid();
+    constexpr size_t buffer = 0x300000000;
+    constexpr size_t size = 1024 * 1024 * 16;
+    constexpr size_t object_size = 1024 * 1024;
+    [[maybe_unused]] const auto context =
+        PrepareSimpleSegment(*service_, "test_segment", buffer, size);
+
+    // Verify leased object will not be evicted.
+    int success_puts = 0;
+    int failed_puts = 0;
+    std::vector<std::string> leased_keys;
+    for (int i = 0; i < 16 + 10; ++i) {
+        std::string key = "test_key" + std::to_string(i);
+        uint64_t slice_length = object_size;
+        ReplicateConfig config;
+        config.replica_num = 1;
+        auto put_start_result =
+            service_->PutStart(client_id, key, slice_length, config);
+        if (put_start_result.has_value()) {
+            auto put_end_result =
+                service_->PutEnd(client_id, key, ReplicaType::MEMORY);
+            ASSERT_TRUE(put_end_result.has_value());
+            // the object is leased
+            auto get_result = service_->GetReplicaList(key);
+            ASSERT_TRUE(get_result.has_value());
+            leased_keys.push_back(key);
+            success_puts++;
+        } else {
+            failed_puts++;
+        }
+    }
+    ASSERT_GT(success_puts, 0);
+    ASSERT_GT(failed_puts, 0);
+    // wait for eviction to do eviction
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // All leased objects should be accessible
+    for (const auto& key : leased_keys) {
+        auto get_result = service_->GetReplicaList(key);
+        ASSERT_TRUE(get_result.has_value());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl));
+    service_->RemoveAll();
+}
+
+TEST_F(MasterServiceTest, RemoveSoftPinObject) {
+    const uint64_t kv_lease_ttl = 200;
+    // set a large soft_pin_ttl so the granted soft pin will not quickly expire
+    const uint64_t kv_soft_pin_ttl = 10000;
+    const bool allow_evict_soft_pinned_objects = true;
+    auto service_config = MasterServiceConfig::builder()
+                              .set_default_kv_lease_ttl(kv_lease_ttl)
+                              .set_default_kv_soft_pin_ttl(kv_soft_pin_ttl)
+                              .set_allow_evict_soft_pinned_objects(
+                                  allow_evict_soft_pinned_objects)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const UUID client_id = generate_uuid();
+    // Mount segment and put an object
+    constexpr size_t buffer = 0x300000000;
+    constexpr size_t size = 1024 * 1024 * 16;
+    [[maybe_unused]] const auto context =
+        PrepareSimpleSegment(*service_, "test_segment", buffer, size);
+
+    std::string key = "test_key";
+    uint64_t slice_length = 1024;
+    ReplicateConfig config;
+    config.replica_num = 1;
+    config.with_soft_pin = true;
+
+    // Verify soft pin does not block remove
+    ASSERT_TRUE(
+        service_->PutStart(client_id, key, slice_length, config).has_value());
+    ASSERT_TRUE(
+        service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+    EXPECT_TRUE(service_->Remove(key).has_value());
+
+    // Verify soft pin does not block RemoveAll
+    ASSERT_TRUE(
+        service_->PutStart(client_id, key, slice_length, config).has_value());
+    ASSERT_TRUE(
+        service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+    EXPECT_EQ(1, service_->RemoveAll());
+}
 
 TEST_F(MasterServiceTest, SoftPinObjectsNotEvictedBeforeOtherObjects) {
     const uint64_t kv_lease_ttl = 200;
@@ -2973,6 +3758,125 @@ TEST_F(MasterServiceTest, BatchExistKeyTest) {
     ASSERT_FALSE(exist_resp[test_object_num].value());
 }
 
+TEST_F(MasterServiceTest, BatchExistKeyPrefixTest) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    const UUID client_id = generate_uuid();
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(
+        *service_, "test_segment", 0x300000000, 1024 * 1024 * 16);
+
+    ReplicateConfig config;
+    config.replica_num = 1;
+    for (const std::string key : {"block0", "block1", "block3"}) {
+        ASSERT_TRUE(service_->PutStart(client_id, key, 1024, config));
+        ASSERT_TRUE(service_->PutEnd(client_id, key, ReplicaType::MEMORY));
+    }
+
+    auto prefix = service_->BatchExistKeyPrefix(
+        {"block0", "block1", "block2", "block3"});
+    ASSERT_TRUE(prefix.has_value());
+    EXPECT_EQ(2u, prefix.value());
+
+    prefix = service_->BatchExistKeyPrefix({"block0", "block1"});
+    ASSERT_TRUE(prefix.has_value());
+    EXPECT_EQ(2u, prefix.value());
+
+    prefix = service_->BatchExistKeyPrefix({"block2", "block0"});
+    ASSERT_TRUE(prefix.has_value());
+    EXPECT_EQ(0u, prefix.value());
+
+    prefix = service_->BatchExistKeyPrefix({});
+    ASSERT_TRUE(prefix.has_value());
+    EXPECT_EQ(0u, prefix.value());
+}
+
+TEST_F(MasterServiceTest, PingReportsPutKeys) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    const UUID client_id = generate_uuid();
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(
+        *service_, "test_segment", 0x300000000, 1024 * 1024 * 16);
+    ReplicateConfig config;
+    config.replica_num = 1;
+    auto put = [&](const std::string& key) {
+        ASSERT_TRUE(service_->PutStart(client_id, key, 1024, config));
+        ASSERT_TRUE(service_->PutEnd(client_id, key, ReplicaType::MEMORY));
+    };
+
+    // Not watching
+    auto ping = service_->Ping(client_id);
+    ASSERT_TRUE(ping.has_value());
+    EXPECT_TRUE(ping->put_key_hashes.empty());
+    EXPECT_FALSE(ping->put_keys_truncated);
+
+    // The first ping of a watcher does not know what it missed
+    put("before_watch");
+    ping = service_->Ping(client_id, ClientLoadReport(), 0);
+    ASSERT_TRUE(ping.has_value());
+    EXPECT_TRUE(ping->put_keys_truncated);
+    uint64_t put_sequence_id = ping->put_sequence_id;
+    EXPECT_NE(0u, put_sequence_id);
+
+    put("key1");
+    put("key2");
+    ping = service_->Ping(client_id, ClientLoadReport(), put_sequence_id);
+    ASSERT_TRUE(ping.has_value());
+    EXPECT_FALSE(ping->put_keys_truncated);
+    EXPECT_EQ((std::vector<uint64_t>{HashRing::Hash("key1"),
+                                     HashRing::Hash("key2")}),
+              ping->put_key_hashes);
+    put_sequence_id = ping->put_sequence_id;
+
+    ping = service_->Ping(client_id, ClientLoadReport(), put_sequence_id);
+    ASSERT_TRUE(ping.has_value());
+    EXPECT_FALSE(ping->put_keys_truncated);
+    EXPECT_TRUE(ping->put_key_hashes.empty());
+    EXPECT_EQ(put_sequence_id, ping->put_sequence_id);
+
+    // A sequence id from another master
+    ping = service_->Ping(client_id, ClientLoadReport(), put_sequence_id + 10);
+    ASSERT_TRUE(ping.has_value());
+    EXPECT_TRUE(ping->put_keys_truncated);
+}
+
+TEST_F(MasterServiceTest, BatchPingFetchesTasks) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    const auto context0 = PrepareSimpleSegment(*service_, "segment_0");
+    [[maybe_unused]] const auto context1 =
+        PrepareSimpleSegment(*service_, "segment_1", 0x400000000);
+    const UUID unknown_client = generate_uuid();
+
+    ReplicateConfig config;
+    config.replica_num = 1;
+    config.preferred_segment = "segment_0";
+    ASSERT_TRUE(service_->PutStart(context0.client_id, "key", 1024, config));
+    ASSERT_TRUE(
+        service_->PutEnd(context0.client_id, "key", ReplicaType::MEMORY));
+    ASSERT_TRUE(service_->CreateCopyTask("key", {"segment_1"}));
+
+    std::vector<BatchPingRequest> requests(3);
+    requests[0].client_id = context0.client_id;
+    requests[0].task_batch_size = 16;
+    requests[1].client_id = unknown_client;
+    requests[1].task_batch_size = 16;
+    requests[2].client_id = context0.client_id;
+    requests[2].put_sequence_id = 0;
+    auto results = service_->BatchPing(requests);
+    ASSERT_EQ(3u, results.size());
+
+    ASSERT_TRUE(results[0].has_value());
+    EXPECT_EQ(ClientStatus::OK, results[0]->ping.client_status);
+    ASSERT_EQ(1u, results[0]->tasks.size());
+    EXPECT_EQ(TaskType::REPLICA_COPY, results[0]->tasks[0].type);
+
+    ASSERT_TRUE(results[1].has_value());
+    EXPECT_EQ(ClientStatus::NEED_REMOUNT, results[1]->ping.client_status);
+    EXPECT_TRUE(results[1]->tasks.empty());
+
+    // Watching puts without fetching tasks
+    ASSERT_TRUE(results[2].has_value());
+    EXPECT_TRUE(results[2]->ping.put_keys_truncated);
+    EXPECT_TRUE(results[2]->tasks.empty());
+}
+
 TEST_F(MasterServiceTest, BatchQueryIpTest) {
     std::unique_ptr<MasterService> service_(new MasterService());
     const UUID client_id = generate_uuid();
@@ -3350,6 +4254,270 @@ TEST_F(MasterServiceTest, OffloadObjectHeartbeat) {
     }
 }
 
+TEST_F(MasterServiceTest, DemoteAndPromoteHotObject) {
+    const uint64_t kv_lease_ttl = 50;
+    auto service_config = MasterServiceConfig::builder()
+                              .set_default_kv_lease_ttl(kv_lease_ttl)
+                              .set_eviction_ratio(1.0)
+                              .set_enable_offload(true)
+                              .set_tiering_demote_access_count(2)
+                              .set_tiering_promote_disk_reads(2)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const UUID client_id = generate_uuid();
+    constexpr size_t buffer = 0x300000000;
+    constexpr size_t size = 1024 * 1024 * 4;
+    constexpr size_t object_size = 1024 * 1024;
+    auto segment = MakeSegment("segment", buffer, size);
+    ASSERT_TRUE(service_->MountSegment(segment, client_id).has_value());
+    ASSERT_TRUE(service_->MountLocalDiskSegment(client_id, false).has_value());
+
+    ReplicateConfig config;
+    config.replica_num = 1;
+    for (const std::string key : {"hot", "cold"}) {
+        auto put_start_result =
+            service_->PutStart(client_id, key, object_size, config);
+        ASSERT_TRUE(put_start_result.has_value());
+        ASSERT_TRUE(
+            service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+    }
+    // Puts are not offloaded while offloading is driven by heat
+    auto offload_res = service_->OffloadObjectHeartbeat(client_id, true);
+    ASSERT_TRUE(offload_res.has_value());
+    EXPECT_EQ(0, offload_res->size());
+
+    ASSERT_TRUE(service_->GetReplicaList("hot").has_value());
+    ASSERT_TRUE(service_->GetReplicaList("hot").has_value());
+    std::this_thread::sleep_for(std::chrono::milliseconds(kv_lease_ttl * 2));
+
+    // Trigger eviction, the cold object is dropped and the hot one is queued
+    // for offloading instead
+    EXPECT_FALSE(
+        service_->PutStart(client_id, "big", 3 * object_size, config)
+            .has_value());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_FALSE(service_->ExistKey("cold").value());
+    EXPECT_TRUE(service_->ExistKey("hot").value());
+    offload_res = service_->OffloadObjectHeartbeat(client_id, true);
+    ASSERT_TRUE(offload_res.has_value());
+    ASSERT_EQ(1, offload_res->size());
+    EXPECT_EQ(object_size, offload_res->at("hot"));
+
+    // Once on local disk, the memory replica of the hot object is evicted
+    StorageObjectMetadata metadata{0, 0, 3, object_size, "segment"};
+    ASSERT_TRUE(
+        service_->NotifyOffloadSuccess(client_id, {"hot"}, {metadata})
+            .has_value());
+    EXPECT_FALSE(
+        service_->PutStart(client_id, "big", 4 * object_size, config)
+            .has_value());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // Every second disk read asks the client to promote the object
+    auto get_result = service_->GetReplicaList("hot");
+    ASSERT_TRUE(get_result.has_value());
+    ASSERT_EQ(1, get_result->replicas.size());
+    EXPECT_TRUE(get_result->replicas[0].is_local_disk_replica());
+    auto second_result = service_->GetReplicaList("hot");
+    ASSERT_TRUE(second_result.has_value());
+    EXPECT_NE(get_result->promote, second_result->promote);
+
+    // Promotion copies the disk replica back to memory
+    auto copy_result = service_->CopyStart(client_id, "hot", "", {});
+    ASSERT_TRUE(copy_result.has_value());
+    EXPECT_TRUE(copy_result->source.is_local_disk_replica());
+    ASSERT_EQ(1, copy_result->targets.size());
+    EXPECT_TRUE(copy_result->targets[0].is_memory_replica());
+    ASSERT_TRUE(service_->CopyEnd(client_id, "hot").has_value());
+    get_result = service_->GetReplicaList("hot");
+    ASSERT_TRUE(get_result.has_value());
+    ASSERT_EQ(2, get_result->replicas.size());
+    EXPECT_TRUE(get_result->replicas[0].is_memory_replica());
+    service_->RemoveAll();
+}
+
+TEST_F(MasterServiceTest, PromoteHotCxlObjectToDram) {
+    constexpr size_t kCxlSize = 1024 * 1024 * 64;
+    auto service_config =
+        MasterServiceConfig::builder()
+            .set_memory_allocator(BufferAllocatorType::CACHELIB)
+            .set_enable_cxl(true)
+            .set_cxl_path("cxl_dev")
+            .set_cxl_size(kCxlSize)
+            .set_cxl_promote_access_count(2)
+            .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    Segment cxl_segment = MakeSegment("cxl_seg", 0, kCxlSize);
+    cxl_segment.protocol = "cxl";
+    const UUID cxl_client_id = generate_uuid();
+    ASSERT_TRUE(
+        service_->MountSegment(cxl_segment, cxl_client_id).has_value());
+    const auto dram = PrepareSimpleSegment(*service_, "dram_seg");
+
+    ReplicateConfig config;
+    config.replica_num = 1;
+    config.preferred_segment = "cxl_seg";
+    for (const std::string key : {"hot", "cold"}) {
+        ASSERT_TRUE(
+            service_->PutStart(cxl_client_id, key, 1024, config).has_value());
+        ASSERT_TRUE(service_->PutEnd(cxl_client_id, key, ReplicaType::MEMORY)
+                        .has_value());
+    }
+
+    // Only the object read the configured number of times is promoted
+    ASSERT_TRUE(service_->GetReplicaList("hot").has_value());
+    ASSERT_TRUE(service_->GetReplicaList("hot").has_value());
+    ASSERT_TRUE(service_->GetReplicaList("cold").has_value());
+    // The eviction thread may drain the queue first
+    service_->PromoteCxlObjects();
+
+    // The client owning the DRAM segment copies the object out of CXL
+    auto fetched = service_->FetchTasks(dram.client_id, /*batch_size=*/16);
+    ASSERT_TRUE(fetched.has_value());
+    ASSERT_EQ(1, fetched->size());
+    EXPECT_EQ(TaskType::REPLICA_COPY, fetched->at(0).type);
+    auto copy_result = service_->CopyStart(dram.client_id, "hot", "cxl_dev",
+                                           {"dram_seg"});
+    ASSERT_TRUE(copy_result.has_value());
+    ASSERT_TRUE(service_->CopyEnd(dram.client_id, "hot").has_value());
+
+    // Reads are served from DRAM first, the CXL replica is kept
+    auto get_result = service_->GetReplicaList("hot");
+    ASSERT_TRUE(get_result.has_value());
+    ASSERT_EQ(2, get_result->replicas.size());
+    EXPECT_NE("cxl", get_result->replicas[0]
+                         .get_memory_descriptor()
+                         .buffer_descriptor.protocol_);
+    EXPECT_EQ("cxl", get_result->replicas[1]
+                         .get_memory_descriptor()
+                         .buffer_descriptor.protocol_);
+    ASSERT_TRUE(service_->GetReplicaList("hot").has_value());
+    service_->PromoteCxlObjects();
+    fetched = service_->FetchTasks(dram.client_id, /*batch_size=*/16);
+    ASSERT_TRUE(fetched.has_value());
+    EXPECT_TRUE(fetched->empty());
+    service_->RemoveAll();
+}
+
+TEST_F(MasterServiceTest, ReplicateHotObjectAndDropWhenCold) {
+    auto service_config = MasterServiceConfig::builder()
+                              .set_default_kv_lease_ttl(50)
+                              .set_hot_replica_read_rate(1)
+                              .set_hot_replica_max_replicas(2)
+                              .set_hot_replica_cooldown_sec(1)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const auto seg_a = PrepareSimpleSegment(*service_, "seg_a");
+    [[maybe_unused]] const auto seg_b = PrepareSimpleSegment(
+        *service_, "seg_b", kDefaultSegmentBase + kDefaultSegmentSize);
+
+    ReplicateConfig config;
+    config.replica_num = 1;
+    config.preferred_segment = "seg_a";
+    for (const std::string key : {"hot", "cold"}) {
+        ASSERT_TRUE(
+            service_->PutStart(seg_a.client_id, key, 1024, config).has_value());
+        ASSERT_TRUE(service_->PutEnd(seg_a.client_id, key, ReplicaType::MEMORY)
+                        .has_value());
+    }
+
+    // Only the object that is read gets a copy task, run by the client
+    // holding it
+    ASSERT_TRUE(service_->GetReplicaList("hot").has_value());
+    // The eviction thread may drain the queue first
+    service_->ReplicateHotObjects();
+    auto fetched = service_->FetchTasks(seg_a.client_id, /*batch_size=*/16);
+    ASSERT_TRUE(fetched.has_value());
+    ASSERT_EQ(1, fetched->size());
+    EXPECT_EQ(TaskType::REPLICA_COPY, fetched->at(0).type);
+    ASSERT_TRUE(
+        service_->CopyStart(seg_a.client_id, "hot", "seg_a", {"seg_b"})
+            .has_value());
+    ASSERT_TRUE(service_->CopyEnd(seg_a.client_id, "hot").has_value());
+
+    // No more copies once the object has hot_replica_max_replicas
+    auto get_result = service_->GetReplicaList("hot");
+    ASSERT_TRUE(get_result.has_value());
+    ASSERT_EQ(2, get_result->replicas.size());
+    service_->ReplicateHotObjects();
+    fetched = service_->FetchTasks(seg_a.client_id, /*batch_size=*/16);
+    ASSERT_TRUE(fetched.has_value());
+    EXPECT_TRUE(fetched->empty());
+
+    // After the cooldown the added replica is dropped, the original kept
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    service_->ReplicateHotObjects();
+    get_result = service_->GetReplicaList("hot");
+    ASSERT_TRUE(get_result.has_value());
+    ASSERT_EQ(1, get_result->replicas.size());
+    EXPECT_EQ("seg_a", get_result->replicas[0]
+                           .get_memory_descriptor()
+                           .buffer_descriptor.transport_endpoint_);
+    service_->RemoveAll();
+}
+
+TEST_F(MasterServiceTest, LeasedPutsTakeGrantedSlots) {
+    ReplicateConfig config;
+    config.replica_num = 1;
+    {
+        std::unique_ptr<MasterService> service_(new MasterService());
+        const auto segment = PrepareSimpleSegment(*service_);
+        auto refused =
+            service_->GrantPutLease(segment.client_id, 1024, 4, config);
+        ASSERT_FALSE(refused.has_value());
+        EXPECT_EQ(ErrorCode::UNAVAILABLE_IN_CURRENT_MODE, refused.error());
+    }
+
+    auto service_config =
+        MasterServiceConfig::builder().set_put_lease_ttl_ms(200).build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    const auto segment = PrepareSimpleSegment(*service_);
+    auto lease = service_->GrantPutLease(segment.client_id, 1024, 4, config);
+    ASSERT_TRUE(lease.has_value());
+    ASSERT_EQ(4, lease->slots.size());
+    for (const auto& slot : lease->slots) {
+        ASSERT_EQ(1, slot.size());
+        EXPECT_EQ(1024, slot[0]
+                            .get_memory_descriptor()
+                            .buffer_descriptor.size_);
+    }
+
+    auto leased = [&](const std::string& key, uint64_t slot) {
+        LeasedPut put;
+        put.key = key;
+        put.lease_id = lease->lease_id;
+        put.slot = slot;
+        put.config = config;
+        return put;
+    };
+    // A slot is used once, and a key is still put once
+    auto results = service_->BatchLeasedPutEnd(
+        segment.client_id,
+        {leased("a", 0), leased("b", 1), leased("c", 0), leased("a", 2)});
+    ASSERT_EQ(4, results.size());
+    EXPECT_TRUE(results[0].has_value());
+    EXPECT_TRUE(results[1].has_value());
+    EXPECT_EQ(ErrorCode::INVALID_PARAMS, results[2].error());
+    EXPECT_EQ(ErrorCode::OBJECT_ALREADY_EXISTS, results[3].error());
+    auto get_result = service_->GetReplicaList("a");
+    ASSERT_TRUE(get_result.has_value());
+    EXPECT_EQ(lease->slots[0][0]
+                  .get_memory_descriptor()
+                  .buffer_descriptor.buffer_address_,
+              get_result->replicas[0]
+                  .get_memory_descriptor()
+                  .buffer_descriptor.buffer_address_);
+
+    // Slots belong to the client granted the lease, until it expires
+    results = service_->BatchLeasedPutEnd(generate_uuid(), {leased("d", 3)});
+    EXPECT_EQ(ErrorCode::ILLEGAL_CLIENT, results[0].error());
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    results = service_->BatchLeasedPutEnd(segment.client_id, {leased("d", 3)});
+    EXPECT_EQ(ErrorCode::LEASE_EXPIRED, results[0].error());
+    EXPECT_FALSE(service_->GetReplicaList("d").has_value());
+    service_->RemoveAll();
+}
+
 TEST_F(MasterServiceTest, BatchReplicaClearAllSegments) {
     const uint64_t kv_lease_ttl = 50;
     auto service_config = MasterServiceConfig::builder()
@@ -3958,6 +5126,63 @@ TEST_F(MasterServiceTest, FetchTasksReturnsAssignedTasksOnlyAndDrainsQueue) {
     EXPECT_TRUE(fetch0_again->empty());
 }
 
+TEST_F(MasterServiceTest, WaitTasksWakesOnSubmitAndTimesOut) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    const auto ctx0 = PrepareSimpleSegment(*service_, "segment_0", 0x300000000,
+                                           kDefaultSegmentSize);
+    [[maybe_unused]] const auto ctx1 = PrepareSimpleSegment(
+        *service_, "segment_1", 0x400000000, kDefaultSegmentSize);
+    const UUID put_client_id = generate_uuid();
+    const std::string key = "wait_tasks_key";
+    ReplicateConfig config;
+    config.replica_num = 1;
+    config.preferred_segment = "segment_0";
+    ASSERT_TRUE(
+        service_->PutStart(put_client_id, key, /*slice_length=*/1024, config)
+            .has_value());
+    ASSERT_TRUE(
+        service_->PutEnd(put_client_id, key, ReplicaType::MEMORY).has_value());
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<size_t> fetched;
+    auto done = [&](tl::expected<std::vector<TaskAssignment>, ErrorCode> r) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fetched = r.has_value() ? r->size() : 0;
+        cv.notify_all();
+    };
+
+    // Parked until the task below is created for the client
+    service_->WaitTasks(ctx0.client_id, 16, /*wait_ms=*/5000, done);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_FALSE(fetched.has_value());
+    }
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(service_->CreateCopyTask(key, {"segment_1"}).has_value());
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5),
+                                [&] { return fetched.has_value(); }));
+        EXPECT_EQ(*fetched, 1u);
+        EXPECT_LT(std::chrono::steady_clock::now() - start,
+                  std::chrono::seconds(1));
+        fetched.reset();
+    }
+
+    // Nothing left, answered empty at the deadline
+    start = std::chrono::steady_clock::now();
+    service_->WaitTasks(ctx0.client_id, 16, /*wait_ms=*/100, done);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5),
+                                [&] { return fetched.has_value(); }));
+        EXPECT_EQ(*fetched, 0u);
+        EXPECT_GE(std::chrono::steady_clock::now() - start,
+                  std::chrono::milliseconds(100));
+    }
+}
+
 TEST_F(MasterServiceTest, FetchTasksRespectsBatchSize) {
     std::unique_ptr<MasterService> service_(new MasterService());
 
@@ -4272,6 +5497,367 @@ TEST_F(MasterServiceTest, ForceRemoveAllLeasedObjects) {
         ASSERT_FALSE(exist_result.value());
     }
 }
+
+TEST_F(MasterServiceTest, SnapshotAndRestore) {
+    const std::string snapshot_path =
+        (std::filesystem::temp_directory_path() /
+         ("master_snapshot_test_" + std::to_string(getpid())))
+            .string();
+    const UUID client_id = generate_uuid();
+    constexpr int kNumObjects = 100;
+
+    std::unordered_map<std::string, uintptr_t> addresses;
+    {
+        std::unique_ptr<MasterService> service_(new MasterService());
+        [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+        for (int i = 0; i < kNumObjects; ++i) {
+            std::string key = "snapshot_key_" + std::to_string(i);
+            auto put_start_result =
+                service_->PutStart(client_id, key, 1024, {.replica_num = 1});
+            ASSERT_TRUE(put_start_result.has_value());
+            ASSERT_TRUE(
+                service_->PutEnd(client_id, key, ReplicaType::MEMORY)
+                    .has_value());
+            addresses[key] = put_start_result.value()[0]
+                                 .get_memory_descriptor()
+                                 .buffer_descriptor.buffer_address_;
+        }
+        // Incomplete objects are not restored
+        ASSERT_TRUE(service_
+                        ->PutStart(client_id, "processing_key", 1024,
+                                   {.replica_num = 1})
+                        .has_value());
+        ASSERT_TRUE(service_->SaveSnapshot(snapshot_path).has_value());
+    }
+
+    std::unique_ptr<MasterService> service_(new MasterService());
+    auto load_result = service_->LoadSnapshot(snapshot_path);
+    ASSERT_TRUE(load_result.has_value());
+    EXPECT_EQ(kNumObjects, load_result.value());
+    EXPECT_EQ(kNumObjects, service_->GetKeyCount());
+
+    auto segments = service_->GetAllSegments();
+    ASSERT_TRUE(segments.has_value());
+    ASSERT_EQ(1, segments.value().size());
+    EXPECT_EQ("test_segment", segments.value()[0]);
+
+    for (const auto& [key, address] : addresses) {
+        auto get_result = service_->GetReplicaList(key);
+        ASSERT_TRUE(get_result.has_value());
+        ASSERT_EQ(1, get_result.value().replicas.size());
+        EXPECT_EQ(address, get_result.value()
+                               .replicas[0]
+                               .get_memory_descriptor()
+                               .buffer_descriptor.buffer_address_);
+    }
+    auto exist_result = service_->ExistKey("processing_key");
+    ASSERT_TRUE(exist_result.has_value());
+    EXPECT_FALSE(exist_result.value());
+
+    // New allocations must not overlap the restored ones
+    auto put_start_result =
+        service_->PutStart(client_id, "new_key", 1024, {.replica_num = 1});
+    ASSERT_TRUE(put_start_result.has_value());
+    uintptr_t new_address = put_start_result.value()[0]
+                                .get_memory_descriptor()
+                                .buffer_descriptor.buffer_address_;
+    for (const auto& [key, address] : addresses) {
+        EXPECT_TRUE(new_address + 1024 <= address ||
+                    address + 1024 <= new_address);
+    }
+    ASSERT_TRUE(service_->PutRevoke(client_id, "new_key", ReplicaType::MEMORY)
+                    .has_value());
+
+    // Removing the restored objects releases their space
+    EXPECT_EQ(kNumObjects, service_->RemoveAll(true));
+    auto query_result = service_->QuerySegments("test_segment");
+    ASSERT_TRUE(query_result.has_value());
+    EXPECT_EQ(0, query_result.value().first);
+
+    std::filesystem::remove(snapshot_path);
+}
+
+TEST_F(MasterServiceTest, StripedPutAndSnapshot) {
+    const std::string snapshot_path =
+        (std::filesystem::temp_directory_path() /
+         ("master_striped_snapshot_test_" + std::to_string(getpid())))
+            .string();
+    const UUID client_id = generate_uuid();
+    constexpr size_t kBaseAddr = 0x300000000;
+    constexpr size_t kSegmentSize = 1024 * 1024 * 16;  // 16MB
+    constexpr uint64_t kValueLength = 3 * 1024 + 1;
+
+    std::vector<AllocatedBuffer::Descriptor> stripes;
+    {
+        std::unique_ptr<MasterService> service_(new MasterService());
+        std::vector<MountedSegmentContext> contexts;
+        for (int i = 0; i < 3; ++i) {
+            contexts.push_back(PrepareSimpleSegment(
+                *service_, "segment_" + std::to_string(i),
+                kBaseAddr + static_cast<size_t>(i) * kSegmentSize,
+                kSegmentSize));
+        }
+
+        ReplicateConfig config;
+        config.replica_num = 1;
+        config.stripe_num = 3;
+        auto put_start_result =
+            service_->PutStart(client_id, "striped_key", kValueLength, config);
+        ASSERT_TRUE(put_start_result.has_value());
+        ASSERT_EQ(1, put_start_result.value().size());
+        const auto& mem_desc =
+            put_start_result.value()[0].get_memory_descriptor();
+        ASSERT_TRUE(mem_desc.is_striped());
+        EXPECT_EQ(kValueLength, mem_desc.total_size());
+        stripes.push_back(mem_desc.buffer_descriptor);
+        stripes.insert(stripes.end(), mem_desc.extra_stripes.begin(),
+                       mem_desc.extra_stripes.end());
+        ASSERT_EQ(3, stripes.size());
+        std::unordered_set<std::string> used_segments;
+        for (const auto& stripe : stripes) {
+            used_segments.insert(stripe.transport_endpoint_);
+        }
+        EXPECT_EQ(3, used_segments.size());
+        ASSERT_TRUE(
+            service_->PutEnd(client_id, "striped_key", ReplicaType::MEMORY)
+                .has_value());
+
+        // Striped replicas cannot be copied
+        auto copy_result =
+            service_->CopyStart(client_id, "striped_key",
+                                stripes[0].transport_endpoint_, {"segment_x"});
+        ASSERT_FALSE(copy_result.has_value());
+        EXPECT_EQ(ErrorCode::INVALID_PARAMS, copy_result.error());
+
+        ASSERT_TRUE(service_->SaveSnapshot(snapshot_path).has_value());
+    }
+
+    std::unique_ptr<MasterService> service_(new MasterService());
+    auto load_result = service_->LoadSnapshot(snapshot_path);
+    ASSERT_TRUE(load_result.has_value());
+    EXPECT_EQ(1, load_result.value());
+    auto get_result = service_->GetReplicaList("striped_key");
+    ASSERT_TRUE(get_result.has_value());
+    ASSERT_EQ(1, get_result.value().replicas.size());
+    const auto& mem_desc =
+        get_result.value().replicas[0].get_memory_descriptor();
+    ASSERT_EQ(2, mem_desc.extra_stripes.size());
+    for (size_t i = 0; i < stripes.size(); ++i) {
+        const auto& stripe =
+            i == 0 ? mem_desc.buffer_descriptor : mem_desc.extra_stripes[i - 1];
+        EXPECT_EQ(stripes[i].transport_endpoint_, stripe.transport_endpoint_);
+        EXPECT_EQ(stripes[i].buffer_address_, stripe.buffer_address_);
+        EXPECT_EQ(stripes[i].size_, stripe.size_);
+    }
+
+    // Removing the object releases every stripe
+    EXPECT_EQ(1, service_->RemoveAll(true));
+    for (const auto& stripe : stripes) {
+        auto query_result = service_->QuerySegments(stripe.transport_endpoint_);
+        ASSERT_TRUE(query_result.has_value());
+        EXPECT_EQ(0, query_result.value().first);
+    }
+
+    std::filesystem::remove(snapshot_path);
+}
+
+TEST_F(MasterServiceTest, ErasureCodedPutSurvivesUnmount) {
+    std::unique_ptr<MasterService> service_(new MasterService());
+    const UUID client_id = generate_uuid();
+    constexpr size_t kBaseAddr = 0x300000000;
+    constexpr size_t kSegmentSize = 1024 * 1024 * 16;  // 16MB
+    constexpr uint64_t kValueLength = 2 * 1024 + 1;
+    std::vector<MountedSegmentContext> contexts;
+    for (int i = 0; i < 4; ++i) {
+        contexts.push_back(PrepareSimpleSegment(
+            *service_, "segment_" + std::to_string(i),
+            kBaseAddr + static_cast<size_t>(i) * kSegmentSize, kSegmentSize));
+    }
+
+    // 2 data and 1 parity stripes, the parity as long as the longest one
+    ReplicateConfig config;
+    config.replica_num = 1;
+    config.stripe_num = 2;
+    config.parity_num = 1;
+    auto put_start_result =
+        service_->PutStart(client_id, "ec_key", kValueLength, config);
+    ASSERT_TRUE(put_start_result.has_value());
+    const auto mem_desc = put_start_result.value()[0].get_memory_descriptor();
+    ASSERT_TRUE(mem_desc.is_erasure_coded());
+    ASSERT_EQ(2, mem_desc.data_stripes());
+    EXPECT_EQ(kValueLength, mem_desc.total_size());
+    EXPECT_EQ(kValueLength / 2 + 1, mem_desc.stripe(2).size_);
+    ASSERT_TRUE(
+        service_->PutEnd(client_id, "ec_key", ReplicaType::MEMORY).has_value());
+
+    // Losing one stripe leaves a degraded but readable replica
+    auto segment_index = [&](const std::string& name) {
+        return static_cast<size_t>(name.back() - '0');
+    };
+    const auto& lost = contexts[segment_index(
+        mem_desc.stripe(0).transport_endpoint_)];
+    ASSERT_TRUE(
+        service_->UnmountSegment(lost.segment_id, lost.client_id).has_value());
+    auto get_result = service_->GetReplicaList("ec_key");
+    ASSERT_TRUE(get_result.has_value());
+    ASSERT_EQ(1, get_result.value().replicas.size());
+    const auto& degraded =
+        get_result.value().replicas[0].get_memory_descriptor();
+    EXPECT_TRUE(degraded.stripe(0).transport_endpoint_.empty());
+    EXPECT_FALSE(degraded.stripe(1).transport_endpoint_.empty());
+    EXPECT_EQ(kValueLength, degraded.total_size());
+
+    // Losing a second stripe is more than the parity covers
+    const auto& lost2 = contexts[segment_index(
+        mem_desc.stripe(1).transport_endpoint_)];
+    ASSERT_TRUE(service_->UnmountSegment(lost2.segment_id, lost2.client_id)
+                    .has_value());
+    get_result = service_->GetReplicaList("ec_key");
+    EXPECT_FALSE(get_result.has_value());
+}
+
+TEST_F(MasterServiceTest, LoadInvalidSnapshot) {
+    const std::string snapshot_path =
+        (std::filesystem::temp_directory_path() /
+         ("master_invalid_snapshot_test_" + std::to_string(getpid())))
+            .string();
+    std::unique_ptr<MasterService> service_(new MasterService());
+
+    auto load_result = service_->LoadSnapshot(snapshot_path);
+    ASSERT_FALSE(load_result.has_value());
+    EXPECT_EQ(ErrorCode::FILE_NOT_FOUND, load_result.error());
+
+    {
+        std::ofstream file(snapshot_path, std::ios::binary);
+        std::string garbage(4096, 'x');
+        file.write(garbage.data(), garbage.size());
+    }
+    load_result = service_->LoadSnapshot(snapshot_path);
+    ASSERT_FALSE(load_result.has_value());
+    EXPECT_EQ(ErrorCode::INVALID_VERSION, load_result.error());
+    EXPECT_EQ(0, service_->GetKeyCount());
+
+    std::filesystem::remove(snapshot_path);
+}
+
+TEST_F(MasterServiceTest, WarmStandbyReplication) {
+    auto service_config = MasterServiceConfig::builder()
+                              .set_enable_ha(true)
+                              .set_oplog_capacity(1024)
+                              .build();
+    const UUID client_id = generate_uuid();
+    constexpr int kNumObjects = 20;
+
+    std::unique_ptr<MasterService> leader(new MasterService(service_config));
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*leader);
+    std::unordered_map<std::string, uintptr_t> addresses;
+    auto put_object = [&](const std::string& key) {
+        auto put_start_result =
+            leader->PutStart(client_id, key, 1024, {.replica_num = 1});
+        ASSERT_TRUE(put_start_result.has_value());
+        ASSERT_TRUE(
+            leader->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+        addresses[key] = put_start_result.value()[0]
+                             .get_memory_descriptor()
+                             .buffer_descriptor.buffer_address_;
+    };
+    for (int i = 0; i < kNumObjects / 2; ++i) {
+        put_object("standby_key_" + std::to_string(i));
+    }
+
+    // Bootstrap the standby from a snapshot of the leader
+    std::unique_ptr<MasterService> standby(new MasterService(service_config));
+    ASSERT_TRUE(standby->EnterStandby().has_value());
+    EXPECT_TRUE(standby->IsStandby());
+    auto snapshot = leader->GetStandbySnapshot();
+    ASSERT_TRUE(snapshot.has_value());
+    ASSERT_TRUE(standby->LoadStandbySnapshot(snapshot.value()).has_value());
+    EXPECT_EQ(kNumObjects / 2, standby->GetKeyCount());
+
+    // Replay the mutations after the snapshot
+    for (int i = kNumObjects / 2; i < kNumObjects; ++i) {
+        put_object("standby_key_" + std::to_string(i));
+    }
+    ASSERT_TRUE(leader->Remove("standby_key_0", true).has_value());
+    addresses.erase("standby_key_0");
+
+    auto fetch_result =
+        leader->FetchOpLog(snapshot.value().sequence_id, kNumObjects);
+    ASSERT_TRUE(fetch_result.has_value());
+    EXPECT_EQ(kNumObjects / 2 + 1, fetch_result.value().entries.size());
+    ASSERT_TRUE(standby->ApplyOpLog(fetch_result.value().entries).has_value());
+    EXPECT_EQ(fetch_result.value().next_sequence_id,
+              fetch_result.value().entries.back().sequence_id + 1);
+    EXPECT_FALSE(
+        leader->ApplyOpLog(fetch_result.value().entries).has_value());
+
+    EXPECT_EQ(kNumObjects - 1, standby->GetKeyCount());
+    for (const auto& [key, address] : addresses) {
+        auto get_result = standby->GetReplicaList(key);
+        ASSERT_TRUE(get_result.has_value());
+        ASSERT_EQ(1, get_result.value().replicas.size());
+        EXPECT_EQ(address, get_result.value()
+                               .replicas[0]
+                               .get_memory_descriptor()
+                               .buffer_descriptor.buffer_address_);
+    }
+
+    // After promotion new allocations must not overlap the replicated ones
+    ASSERT_TRUE(standby->Promote(1).has_value());
+    EXPECT_FALSE(standby->IsStandby());
+    auto put_start_result =
+        standby->PutStart(client_id, "new_key", 1024, {.replica_num = 1});
+    ASSERT_TRUE(put_start_result.has_value());
+    uintptr_t new_address = put_start_result.value()[0]
+                                .get_memory_descriptor()
+                                .buffer_descriptor.buffer_address_;
+    for (const auto& [key, address] : addresses) {
+        EXPECT_TRUE(new_address + 1024 <= address ||
+                    address + 1024 <= new_address);
+    }
+    ASSERT_TRUE(
+        standby->PutRevoke(client_id, "new_key", ReplicaType::MEMORY)
+            .has_value());
+
+    EXPECT_EQ(kNumObjects - 1, standby->RemoveAll(true));
+    auto query_result = standby->QuerySegments("test_segment");
+    ASSERT_TRUE(query_result.has_value());
+    EXPECT_EQ(0, query_result.value().first);
+}
+
+TEST_F(MasterServiceTest, FetchTruncatedOpLog) {
+    auto service_config = MasterServiceConfig::builder()
+                              .set_enable_ha(true)
+                              .set_oplog_capacity(4)
+                              .build();
+    std::unique_ptr<MasterService> service_(new MasterService(service_config));
+    [[maybe_unused]] const auto context = PrepareSimpleSegment(*service_);
+    const UUID client_id = generate_uuid();
+    for (int i = 0; i < 10; ++i) {
+        std::string key = "oplog_key_" + std::to_string(i);
+        ASSERT_TRUE(service_->PutStart(client_id, key, 1024, {.replica_num = 1})
+                        .has_value());
+        ASSERT_TRUE(
+            service_->PutEnd(client_id, key, ReplicaType::MEMORY).has_value());
+    }
+
+    // One mount entry and ten upsert entries, only the last four are kept
+    auto fetch_result = service_->FetchOpLog(1, 100);
+    ASSERT_FALSE(fetch_result.has_value());
+    EXPECT_EQ(ErrorCode::OPLOG_TRUNCATED, fetch_result.error());
+
+    fetch_result = service_->FetchOpLog(8, 100);
+    ASSERT_TRUE(fetch_result.has_value());
+    ASSERT_EQ(4, fetch_result.value().entries.size());
+    EXPECT_EQ(8, fetch_result.value().entries.front().sequence_id);
+    EXPECT_EQ(12, fetch_result.value().next_sequence_id);
+
+    // The oplog is disabled without HA
+    std::unique_ptr<MasterService> non_ha_service(new MasterService());
+    fetch_result = non_ha_service->FetchOpLog(1, 100);
+    ASSERT_FALSE(fetch_result.has_value());
+    EXPECT_EQ(ErrorCode::UNAVAILABLE_IN_CURRENT_MODE, fetch_result.error());
+}
 }  // namespace mooncake::test
 
 int main(int argc, char** argv) {
@@ -0,0 +1,80 @@
+#include "negative_exist_cache.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "hash_ring.h"
+
+namespace mooncake::test {
+
+class NegativeExistCacheTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("NegativeExistCacheTest");
+        FLAGS_logtostderr = 1;
+    }
+
+    void TearDown() override { google::ShutdownGoogleLogging(); }
+};
+
+TEST_F(NegativeExistCacheTest, AddContainsInvalidate) {
+    NegativeExistCache cache(16, std::chrono::seconds(10));
+    EXPECT_FALSE(cache.Contains("key"));
+
+    cache.Add("key");
+    EXPECT_TRUE(cache.Contains("key"));
+    EXPECT_FALSE(cache.Contains("other"));
+    cache.Add("key");
+    EXPECT_EQ(1, cache.Size());
+
+    cache.Invalidate("key");
+    EXPECT_FALSE(cache.Contains("key"));
+    EXPECT_EQ(0, cache.Size());
+
+    cache.Add("a");
+    cache.Add("b");
+    cache.Clear();
+    EXPECT_FALSE(cache.Contains("a"));
+    EXPECT_FALSE(cache.Contains("b"));
+}
+
+TEST_F(NegativeExistCacheTest, InvalidateHashes) {
+    NegativeExistCache cache(16, std::chrono::seconds(10));
+    cache.Add("a");
+    cache.Add("b");
+    cache.Add("c");
+
+    // As listed in a ping response
+    cache.InvalidateHashes({HashRing::Hash("a"), HashRing::Hash("c"),
+                            HashRing::Hash("not-cached")});
+    EXPECT_FALSE(cache.Contains("a"));
+    EXPECT_TRUE(cache.Contains("b"));
+    EXPECT_FALSE(cache.Contains("c"));
+    EXPECT_EQ(1, cache.Size());
+}
+
+TEST_F(NegativeExistCacheTest, ExpiresAfterTtl) {
+    NegativeExistCache cache(16, std::chrono::milliseconds(50));
+    cache.Add("key");
+    EXPECT_TRUE(cache.Contains("key"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    EXPECT_FALSE(cache.Contains("key"));
+    EXPECT_EQ(0, cache.Size());
+}
+
+TEST_F(NegativeExistCacheTest, EvictsOldestWhenFull) {
+    NegativeExistCache cache(2, std::chrono::seconds(10));
+    cache.Add("a");
+    cache.Add("b");
+    // Renewing moves a key to the front
+    cache.Add("a");
+    cache.Add("c");
+    EXPECT_EQ(2, cache.Size());
+    EXPECT_TRUE(cache.Contains("a"));
+    EXPECT_FALSE(cache.Contains("b"));
+    EXPECT_TRUE(cache.Contains("c"));
+}
+
+}  // namespace mooncake::test
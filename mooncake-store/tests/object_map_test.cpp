@@ -0,0 +1,219 @@
+#include "object_map.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mooncake::test {
+
+// A value that can be neither copied nor moved, like ObjectMetadata
+struct PinnedValue {
+    PinnedValue(int value_, int* live_) : value(value_), live(live_) {
+        (*live)++;
+    }
+    ~PinnedValue() { (*live)--; }
+    PinnedValue(const PinnedValue&) = delete;
+    PinnedValue(PinnedValue&&) = delete;
+
+    int value;
+    int* live;
+};
+
+class ObjectMapTest : public ::testing::Test {
+   protected:
+    bool Insert(ObjectMap<PinnedValue>& map, const std::string& key,
+                int value) {
+        return map
+            .emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                     std::forward_as_tuple(value, &live_))
+            .second;
+    }
+
+    int live_ = 0;
+};
+
+TEST_F(ObjectMapTest, InsertFindErase) {
+    ObjectMap<PinnedValue> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.end(), map.find("missing"));
+    EXPECT_EQ(0, map.erase("missing"));
+
+    EXPECT_TRUE(Insert(map, "a", 1));
+    EXPECT_FALSE(Insert(map, "a", 2));
+    EXPECT_EQ(1, map.size());
+    EXPECT_EQ(1, live_);
+    auto it = map.find("a");
+    ASSERT_NE(map.end(), it);
+    EXPECT_EQ("a", it->first);
+    EXPECT_EQ(1, it->second.value);
+    EXPECT_TRUE(map.contains("a"));
+
+    EXPECT_EQ(1, map.erase("a"));
+    EXPECT_FALSE(map.contains("a"));
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(0, live_);
+}
+
+TEST_F(ObjectMapTest, RandomOperationsMatchUnorderedMap) {
+    ObjectMap<PinnedValue> map;
+    std::unordered_map<std::string, int> expected;
+    std::mt19937 rng(42);
+    constexpr int kNumKeys = 5000;
+
+    for (int round = 0; round < 200000; ++round) {
+        const std::string key = "key_" + std::to_string(rng() % kNumKeys);
+        if (rng() % 3 != 0) {
+            const int value = static_cast<int>(rng());
+            EXPECT_EQ(expected.emplace(key, value).second,
+                      Insert(map, key, value));
+        } else {
+            EXPECT_EQ(expected.erase(key), map.erase(key));
+        }
+    }
+
+    ASSERT_EQ(expected.size(), map.size());
+    EXPECT_EQ(static_cast<int>(expected.size()), live_);
+    size_t visited = 0;
+    for (const auto& [key, value] : map) {
+        auto it = expected.find(key);
+        ASSERT_NE(expected.end(), it);
+        EXPECT_EQ(it->second, value.value);
+        visited++;
+    }
+    EXPECT_EQ(expected.size(), visited);
+    // The load factor including tombstones stays below 7/8.
+    EXPECT_LT(map.size() * 8, map.capacity() * 7);
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(0, live_);
+    EXPECT_TRUE(Insert(map, "key_0", 0));
+}
+
+TEST_F(ObjectMapTest, EraseWhileIterating) {
+    ObjectMap<PinnedValue> map;
+    for (int i = 0; i < 1000; ++i) {
+        Insert(map, std::to_string(i), i);
+    }
+    const PinnedValue* pinned = &map.find("1")->second;
+    for (auto it = map.begin(); it != map.end();) {
+        if (it->second.value % 2 == 0) {
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    EXPECT_EQ(500, map.size());
+    EXPECT_EQ(500, live_);
+    // Values of the remaining entries never move.
+    EXPECT_EQ(pinned, &map.find("1")->second);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(i % 2 == 1, map.contains(std::to_string(i)));
+    }
+}
+
+TEST_F(ObjectMapTest, BeginFromVisitsLaterSlots) {
+    ObjectMap<PinnedValue> map;
+    for (int i = 0; i < 100; ++i) {
+        Insert(map, std::to_string(i), i);
+    }
+    size_t total = 0;
+    for (auto it = map.begin_from(0); it != map.end(); ++it) {
+        total++;
+    }
+    EXPECT_EQ(map.size(), total);
+
+    size_t tail = 0;
+    for (auto it = map.begin_from(map.capacity() / 2); it != map.end(); ++it) {
+        tail++;
+    }
+    EXPECT_LE(tail, total);
+    EXPECT_EQ(map.end(), map.begin_from(map.capacity()));
+}
+
+TEST_F(ObjectMapTest, TrackedEntries) {
+    ObjectMap<PinnedValue> map;
+    for (int i = 0; i < 100; ++i) {
+        Insert(map, std::to_string(i), i);
+    }
+    for (int i = 0; i < 10; ++i) {
+        map.Track(map.find(std::to_string(i)));
+    }
+    map.Track(map.find("0"));
+    EXPECT_EQ(10, map.tracked_size());
+    EXPECT_TRUE(map.IsTracked(map.find("5")));
+    EXPECT_FALSE(map.IsTracked(map.find("50")));
+
+    map.Untrack(map.find("1"));
+    map.erase("2");
+    // Growing the table keeps the tracked entries.
+    for (int i = 100; i < 2000; ++i) {
+        Insert(map, std::to_string(i), i);
+    }
+
+    auto keys = map.TrackedKeys();
+    ASSERT_EQ(8, keys.size());
+    EXPECT_EQ(8, map.tracked_size());
+    std::vector<std::string> sorted;
+    for (const auto* key : keys) {
+        sorted.push_back(*key);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ((std::vector<std::string>{"0", "3", "4", "5", "6", "7", "8",
+                                        "9"}),
+              sorted);
+
+    map.clear();
+    EXPECT_EQ(0, map.tracked_size());
+    EXPECT_TRUE(map.TrackedKeys().empty());
+}
+
+TEST_F(ObjectMapTest, FindPrefix) {
+    ObjectMap<PinnedValue> map;
+    for (int i = 0; i < 300; ++i) {
+        Insert(map, "a/" + std::to_string(i), i);
+        Insert(map, "b/" + std::to_string(i), i);
+    }
+    auto keys_of = [](const std::vector<ObjectMap<PinnedValue>::iterator>&
+                          entries) {
+        std::vector<std::string> keys;
+        for (const auto& it : entries) {
+            keys.push_back(it->first);
+        }
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    };
+    const auto scanned = keys_of(map.FindPrefix("a/1"));
+    EXPECT_EQ(111, scanned.size());  // 1, 10-19, 100-199
+
+    map.EnableOrderedKeys();
+    EXPECT_TRUE(map.HasOrderedKeys());
+    EXPECT_EQ(scanned, keys_of(map.FindPrefix("a/1")));
+    EXPECT_EQ(600, map.FindPrefix("").size());
+    EXPECT_TRUE(map.FindPrefix("c").empty());
+
+    // The index follows insertions, erasures and growth.
+    map.erase("a/1");
+    for (auto it : map.FindPrefix("b/")) {
+        map.erase(it);
+    }
+    for (int i = 1000; i < 3000; ++i) {
+        Insert(map, "a/" + std::to_string(i), i);
+    }
+    EXPECT_EQ(110 + 1000, map.FindPrefix("a/1").size());
+    EXPECT_TRUE(map.FindPrefix("b/").empty());
+    for (const auto& it : map.FindPrefix("a/2")) {
+        EXPECT_EQ(it->first, map.find(it->first)->first);
+    }
+
+    map.clear();
+    EXPECT_TRUE(map.FindPrefix("").empty());
+    EXPECT_TRUE(Insert(map, "a/1", 1));
+    EXPECT_EQ(1, map.FindPrefix("a/").size());
+}
+
+}  // namespace mooncake::test
@@ -8,6 +8,7 @@
 #include <map>
 #include <memory>
 #include <random>
+#include <thread>
 
 namespace mooncake::offset_allocator {
 
@@ -1391,6 +1392,141 @@ TEST_F(OffsetAllocatorTest, MetricsInterface) {
     EXPECT_EQ(after_all_free.largest_free_region_, ALLOCATOR_SIZE);
 }
 
+TEST_F(OffsetAllocatorTest, FreeNeighborSize) {
+    constexpr uint64_t ALLOCATOR_SIZE = 1024 * 1024;  // 1MB
+    constexpr size_t ALLOC_SIZE = 4096;
+    auto allocator = OffsetAllocator::create(0, ALLOCATOR_SIZE, 1000);
+
+    auto first = allocator->allocate(ALLOC_SIZE);
+    auto middle = allocator->allocate(ALLOC_SIZE);
+    auto last = allocator->allocate(ALLOC_SIZE);
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(middle.has_value());
+    ASSERT_TRUE(last.has_value());
+    EXPECT_EQ(middle->freeNeighborSize(), 0);
+    EXPECT_EQ(last->freeNeighborSize(), ALLOCATOR_SIZE - 3 * ALLOC_SIZE);
+
+    // Freed neighbors are counted on both sides, merged ones only once.
+    first.reset();
+    EXPECT_EQ(middle->freeNeighborSize(), ALLOC_SIZE);
+    last.reset();
+    EXPECT_EQ(middle->freeNeighborSize(), ALLOCATOR_SIZE - ALLOC_SIZE);
+
+    // Handles outliving their allocator report nothing.
+    allocator.reset();
+    EXPECT_EQ(middle->freeNeighborSize(), 0);
+}
+
+TEST_F(OffsetAllocatorTest, CachedAllocationMetrics) {
+    constexpr uint64_t ALLOCATOR_SIZE = 1024 * 1024;  // 1MB
+    constexpr size_t ALLOC_SIZE = 4096;
+    auto allocator = OffsetAllocator::create(0, ALLOCATOR_SIZE, 1000);
+    allocator->enableCache(64 * 1024);
+
+    std::vector<OffsetAllocationHandle> handles;
+    for (int i = 0; i < 16; ++i) {
+        auto handle = allocator->allocate(ALLOC_SIZE);
+        ASSERT_TRUE(handle.has_value());
+        handles.push_back(std::move(*handle));
+    }
+    OffsetAllocatorMetrics metrics = allocator->get_metrics();
+    EXPECT_EQ(metrics.allocated_size_, 16 * ALLOC_SIZE);
+    EXPECT_EQ(metrics.allocated_num_, 16);
+    EXPECT_EQ(metrics.total_free_space_ + metrics.cached_size_ +
+                  metrics.allocated_size_,
+              ALLOCATOR_SIZE);
+
+    // Freed small allocations are kept cached instead of being returned.
+    handles.clear();
+    OffsetAllocatorMetrics after_free = allocator->get_metrics();
+    EXPECT_EQ(after_free.allocated_size_, 0);
+    EXPECT_EQ(after_free.allocated_num_, 0);
+    EXPECT_GT(after_free.cached_size_, 0);
+    EXPECT_EQ(after_free.total_free_space_ + after_free.cached_size_,
+              ALLOCATOR_SIZE);
+
+    // Allocations above the cached size bypass the cache.
+    auto large = allocator->allocate(128 * 1024);
+    ASSERT_TRUE(large.has_value());
+    EXPECT_EQ(allocator->get_metrics().allocated_size_, 128 * 1024);
+}
+
+TEST_F(OffsetAllocatorTest, CachedAllocationFlushWhenFull) {
+    constexpr uint64_t ALLOCATOR_SIZE = 1024 * 1024;  // 1MB
+    auto allocator = OffsetAllocator::create(0, ALLOCATOR_SIZE, 1000);
+    allocator->enableCache(64 * 1024);
+
+    {
+        std::vector<OffsetAllocationHandle> handles;
+        for (int i = 0; i < 64; ++i) {
+            auto handle = allocator->allocate(1024);
+            ASSERT_TRUE(handle.has_value());
+            handles.push_back(std::move(*handle));
+        }
+    }
+    ASSERT_GT(allocator->get_metrics().cached_size_, 0);
+
+    // The cached ranges are given back when the allocator runs out of space.
+    auto whole = allocator->allocate(ALLOCATOR_SIZE);
+    ASSERT_TRUE(whole.has_value());
+    OffsetAllocatorMetrics metrics = allocator->get_metrics();
+    EXPECT_EQ(metrics.allocated_size_, ALLOCATOR_SIZE);
+    EXPECT_EQ(metrics.cached_size_, 0);
+}
+
+TEST_F(OffsetAllocatorTest, CachedAllocationMultiThread) {
+    constexpr uint64_t ALLOCATOR_SIZE = 64 * 1024 * 1024;
+    constexpr int NUM_THREADS = 8;
+    constexpr int ITERATIONS = 2000;
+    auto allocator = OffsetAllocator::create(0, ALLOCATOR_SIZE, 100000);
+    allocator->enableCache(64 * 1024);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&allocator, t]() {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<size_t> size_dist(1, 64 * 1024);
+            std::vector<OffsetAllocationHandle> handles;
+            for (int i = 0; i < ITERATIONS; ++i) {
+                auto handle = allocator->allocate(size_dist(gen));
+                ASSERT_TRUE(handle.has_value());
+                handles.push_back(std::move(*handle));
+                if (handles.size() > 32) {
+                    handles.erase(handles.begin());
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    OffsetAllocatorMetrics metrics = allocator->get_metrics();
+    EXPECT_EQ(metrics.allocated_size_, 0);
+    EXPECT_EQ(metrics.allocated_num_, 0);
+    EXPECT_EQ(metrics.total_free_space_ + metrics.cached_size_,
+              ALLOCATOR_SIZE);
+}
+
+TEST_F(OffsetAllocatorTest, CachedAllocationSerialization) {
+    constexpr uint64_t ALLOCATOR_SIZE = 1024 * 1024;  // 1MB
+    auto alloc_a = OffsetAllocator::create(0, ALLOCATOR_SIZE, 1000);
+    alloc_a->enableCache(64 * 1024);
+
+    std::vector<OffsetAllocationHandle> handles;
+    for (int i = 0; i < 32; ++i) {
+        auto handle = alloc_a->allocate(2048);
+        ASSERT_TRUE(handle.has_value());
+        if (i % 2 == 0) {
+            handles.push_back(std::move(*handle));
+        }
+    }
+    ASSERT_GT(alloc_a->get_metrics().cached_size_, 0);
+
+    // Cached ranges are serialized as free space.
+    testSerializeAllocator(alloc_a, handles);
+}
+
 // ========== Serialization TESTS ==========
 
 TEST_F(OffsetAllocatorTest, SerializationEmptyAllocator) {
@@ -0,0 +1,93 @@
+#include "ping_aggregator.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace mooncake::test {
+
+class PingAggregatorTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("PingAggregatorTest");
+        FLAGS_logtostderr = 1;
+    }
+
+    void TearDown() override { google::ShutdownGoogleLogging(); }
+
+    // Answers every ping with the put sequence id it was sent
+    static PingAggregator::Results Echo(
+        const std::vector<BatchPingRequest>& requests) {
+        PingAggregator::Results results;
+        for (const auto& request : requests) {
+            BatchPingResponse response;
+            response.ping.put_sequence_id = request.put_sequence_id.value();
+            results.emplace_back(std::move(response));
+        }
+        return results;
+    }
+};
+
+TEST_F(PingAggregatorTest, ConcurrentPingsShareRounds) {
+    constexpr int kClients = 64;
+    constexpr size_t kMaxBatch = 16;
+    std::atomic<int> batch_calls{0};
+    std::atomic<size_t> largest_batch{0};
+    PingAggregator aggregator(
+        [&](const std::vector<BatchPingRequest>& requests) {
+            ++batch_calls;
+            size_t largest = largest_batch.load();
+            while (requests.size() > largest &&
+                   !largest_batch.compare_exchange_weak(largest,
+                                                        requests.size())) {
+            }
+            return Echo(requests);
+        },
+        std::chrono::milliseconds(200), kMaxBatch);
+
+    std::atomic<int> answered{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < kClients; ++i) {
+        clients.emplace_back([&, i] {
+            BatchPingRequest request;
+            request.client_id = generate_uuid();
+            request.put_sequence_id = i;
+            auto result = aggregator.Ping(std::move(request));
+            if (result && result->ping.put_sequence_id ==
+                              static_cast<uint64_t>(i)) {
+                ++answered;
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    EXPECT_EQ(kClients, answered.load());
+    EXPECT_LE(largest_batch.load(), kMaxBatch);
+    // One round at most per interval, split into batches of kMaxBatch
+    EXPECT_LT(batch_calls.load(), kClients);
+}
+
+TEST_F(PingAggregatorTest, WrongSizedResultsFailTheBatch) {
+    PingAggregator aggregator(
+        [](const std::vector<BatchPingRequest>&) {
+            return PingAggregator::Results();
+        },
+        std::chrono::milliseconds(10), 16);
+
+    BatchPingRequest request;
+    request.put_sequence_id = 0;
+    auto result = aggregator.Ping(std::move(request));
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(ErrorCode::RPC_FAIL, result.error());
+}
+
+}  // namespace mooncake::test
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
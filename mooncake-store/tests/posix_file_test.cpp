@@ -3,6 +3,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/uio.h>
+#include <climits>
+#include <vector>
 #include "file_interface.h"
 
 namespace mooncake {
@@ -132,6 +134,38 @@ TEST_F(PosixFileTest, VectorizedRead) {
     EXPECT_EQ(posix_file.get_error_code(), ErrorCode::OK);
 }
 
+// Test vectorized I/O with more vectors than one call takes
+TEST_F(PosixFileTest, VectorizedIOBeyondIovMax) {
+    PosixFile posix_file(test_filename, test_fd);
+
+    const size_t count = IOV_MAX * 2 + 3;
+    std::vector<char> data(count);
+    std::vector<iovec> iov(count);
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = static_cast<char>('a' + i % 26);
+        iov[i] = iovec{&data[i], 1};
+    }
+    auto written = posix_file.vector_write(iov.data(), count, 0);
+    ASSERT_TRUE(written) << "Vector write failed with error: "
+                         << toString(written.error());
+    EXPECT_EQ(*written, count);
+
+    std::vector<char> read_back(count);
+    for (size_t i = 0; i < count; ++i) {
+        iov[i] = iovec{&read_back[i], 1};
+    }
+    auto read = posix_file.vector_read(iov.data(), count, 0);
+    ASSERT_TRUE(read) << "Vector read failed with error: "
+                      << toString(read.error());
+    EXPECT_EQ(*read, count);
+    EXPECT_EQ(read_back, data);
+
+    // Reads stop at the end of the file
+    auto past_end = posix_file.vector_read(iov.data(), count, 5);
+    ASSERT_TRUE(past_end);
+    EXPECT_EQ(*past_end, count - 5);
+}
+
 // Test error cases
 TEST_F(PosixFileTest, ErrorCases) {
     // Test invalid file descriptor
@@ -608,6 +608,63 @@ TEST_F(RealClientTest, TestBatchPutAndGetMultiBuffers) {
         << "Dst data buffer unregistration should succeed";
 }
 
+TEST_F(RealClientTest, TestBatchPutParts) {
+    ASSERT_TRUE(master_.Start(InProcMasterConfigBuilder().build()))
+        << "Failed to start in-proc master";
+    master_address_ = master_.master_address();
+
+    const std::string rdma_devices = (FLAGS_protocol == std::string("rdma"))
+                                         ? FLAGS_device_name
+                                         : std::string("");
+    ASSERT_EQ(
+        py_client_->setup_real("localhost:17813", "P2PHANDSHAKE",
+                               16 * 1024 * 1024, 16 * 1024 * 1024,
+                               FLAGS_protocol, rdma_devices, master_address_),
+        0);
+
+    // The header of each object is not registered and gets staged, its body
+    // is written from the registered buffer
+    const size_t kNumKeys = 8;
+    const size_t kBodySize = 4096;
+    std::string bodies(kNumKeys * kBodySize, '\0');
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        bodies[i] = static_cast<char>('a' + i % 26);
+    }
+    ASSERT_EQ(py_client_->register_buffer(bodies.data(), bodies.size()), 0);
+
+    std::vector<std::string> keys;
+    std::vector<std::string> headers;
+    for (size_t i = 0; i < kNumKeys; ++i) {
+        keys.push_back("test_batch_put_parts_" + std::to_string(i));
+        headers.push_back("header_" + std::to_string(i));
+    }
+    std::vector<std::vector<std::span<const char>>> all_parts;
+    for (size_t i = 0; i < kNumKeys; ++i) {
+        all_parts.push_back(
+            {std::span<const char>(headers[i]),
+             std::span<const char>(bodies.data() + i * kBodySize, kBodySize)});
+    }
+    std::vector<int> results = py_client_->batch_put_parts(keys, all_parts);
+    ASSERT_EQ(results.size(), kNumKeys);
+    for (auto result : results) {
+        EXPECT_EQ(result, 0) << "Put operation should succeed";
+    }
+
+    std::string dst(headers[0].size() + kBodySize + 16, '\0');
+    ASSERT_EQ(py_client_->register_buffer(dst.data(), dst.size()), 0);
+    for (size_t i = 0; i < kNumKeys; ++i) {
+        const std::string expected =
+            headers[i] + bodies.substr(i * kBodySize, kBodySize);
+        int64_t read = py_client_->get_into(keys[i], dst.data(), dst.size());
+        ASSERT_EQ(read, static_cast<int64_t>(expected.size()));
+        EXPECT_EQ(dst.substr(0, expected.size()), expected)
+            << "Object " << i << " should be its header then its body";
+    }
+
+    EXPECT_EQ(py_client_->unregister_buffer(dst.data()), 0);
+    EXPECT_EQ(py_client_->unregister_buffer(bodies.data()), 0);
+}
+
 TEST_F(RealClientTest, TestBatchAndNormalGetReplicaDesc) {
     // Start in-proc master
     ASSERT_TRUE(master_.Start(InProcMasterConfigBuilder().build()))
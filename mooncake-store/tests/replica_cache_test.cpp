@@ -0,0 +1,97 @@
+#include "replica_cache.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace mooncake::test {
+
+class ReplicaCacheTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("ReplicaCacheTest");
+        FLAGS_logtostderr = 1;
+    }
+
+    void TearDown() override { google::ShutdownGoogleLogging(); }
+
+    static std::vector<Replica::Descriptor> MakeReplicas(
+        const std::string& file_path) {
+        Replica::Descriptor descriptor;
+        descriptor.descriptor_variant = DiskDescriptor{file_path, 1024};
+        descriptor.status = ReplicaStatus::COMPLETE;
+        return {descriptor};
+    }
+
+    static ReplicaCache::TimePoint After(int64_t ms) {
+        return std::chrono::steady_clock::now() +
+               std::chrono::milliseconds(ms);
+    }
+};
+
+TEST_F(ReplicaCacheTest, GetPutInvalidate) {
+    ReplicaCache cache(16, std::chrono::milliseconds(0));
+    std::vector<Replica::Descriptor> replicas;
+    ReplicaCache::TimePoint lease_timeout;
+    EXPECT_FALSE(cache.Get("key", replicas, lease_timeout));
+
+    const auto timeout = After(10000);
+    cache.Put("key", MakeReplicas("/a"), timeout);
+    ASSERT_TRUE(cache.Get("key", replicas, lease_timeout));
+    ASSERT_EQ(1, replicas.size());
+    EXPECT_EQ("/a", replicas[0].get_disk_descriptor().file_path);
+    EXPECT_EQ(timeout, lease_timeout);
+
+    // A newer query result replaces the cached one
+    cache.Put("key", MakeReplicas("/b"), After(10000));
+    ASSERT_TRUE(cache.Get("key", replicas, lease_timeout));
+    EXPECT_EQ("/b", replicas[0].get_disk_descriptor().file_path);
+    EXPECT_EQ(1, cache.Size());
+
+    cache.Invalidate("key");
+    EXPECT_FALSE(cache.Get("key", replicas, lease_timeout));
+    cache.Put("key", MakeReplicas("/a"), After(10000));
+    cache.Clear();
+    EXPECT_EQ(0, cache.Size());
+}
+
+TEST_F(ReplicaCacheTest, LeaseExpiry) {
+    ReplicaCache cache(16, std::chrono::milliseconds(50));
+    std::vector<Replica::Descriptor> replicas;
+    ReplicaCache::TimePoint lease_timeout;
+
+    // Too short to be served, so it is not cached at all
+    cache.Put("short", MakeReplicas("/a"), After(10));
+    EXPECT_EQ(0, cache.Size());
+
+    cache.Put("key", MakeReplicas("/a"), After(100));
+    EXPECT_TRUE(cache.Get("key", replicas, lease_timeout));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    // Less than the minimum remaining lease is left
+    EXPECT_FALSE(cache.Get("key", replicas, lease_timeout));
+    EXPECT_EQ(0, cache.Size());
+}
+
+TEST_F(ReplicaCacheTest, EvictLeastRecentlyUsed) {
+    ReplicaCache cache(2, std::chrono::milliseconds(0));
+    std::vector<Replica::Descriptor> replicas;
+    ReplicaCache::TimePoint lease_timeout;
+
+    cache.Put("a", MakeReplicas("/a"), After(10000));
+    cache.Put("b", MakeReplicas("/b"), After(10000));
+    EXPECT_TRUE(cache.Get("a", replicas, lease_timeout));
+    cache.Put("c", MakeReplicas("/c"), After(10000));
+
+    EXPECT_EQ(2, cache.Size());
+    EXPECT_TRUE(cache.Get("a", replicas, lease_timeout));
+    EXPECT_FALSE(cache.Get("b", replicas, lease_timeout));
+    EXPECT_TRUE(cache.Get("c", replicas, lease_timeout));
+}
+
+}  // namespace mooncake::test
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+#include "replica_load_tracker.h"
+
+#include <gtest/gtest.h>
+
+namespace mooncake::test {
+
+using Clock = ReplicaLoadTracker::Clock;
+
+TEST(ReplicaLoadTrackerTest, PrefersFasterEndpoint) {
+    ReplicaLoadTracker tracker;
+    const std::string fast = "fast:1";
+    const std::string slow = "slow:1";
+    const auto now = Clock::now();
+    for (const auto* endpoint : {&fast, &slow}) {
+        tracker.OnStart(*endpoint);
+    }
+    tracker.OnFinish(fast, std::chrono::microseconds(10), true, now);
+    tracker.OnFinish(slow, std::chrono::microseconds(1000), true, now);
+    EXPECT_LT(tracker.Cost(fast, now), tracker.Cost(slow, now));
+
+    // With two candidates both are compared, whatever the sampling order
+    for (int i = 0; i < 32; ++i) {
+        EXPECT_EQ(1u, tracker.Choose({&slow, &fast}, now));
+    }
+}
+
+TEST(ReplicaLoadTrackerTest, CountsReadsInFlight) {
+    ReplicaLoadTracker tracker;
+    const std::string busy = "busy:1";
+    const std::string idle = "idle:1";
+    const auto now = Clock::now();
+    for (const auto* endpoint : {&busy, &idle}) {
+        tracker.OnStart(*endpoint);
+        tracker.OnFinish(*endpoint, std::chrono::microseconds(100), true, now);
+    }
+    const double idle_cost = tracker.Cost(busy, now);
+    EXPECT_DOUBLE_EQ(idle_cost, tracker.Cost(idle, now));
+
+    // Same latency, but three reads are queued on busy already
+    for (int i = 0; i < 3; ++i) {
+        tracker.OnStart(busy);
+    }
+    EXPECT_DOUBLE_EQ(4 * idle_cost, tracker.Cost(busy, now));
+    EXPECT_EQ(1u, tracker.Choose({&busy, &idle}, now));
+}
+
+TEST(ReplicaLoadTrackerTest, FailuresAndStaleStatistics) {
+    ReplicaLoadTracker tracker;
+    const std::string broken = "broken:1";
+    const std::string healthy = "healthy:1";
+    const auto now = Clock::now();
+    tracker.OnStart(broken);
+    tracker.OnFinish(broken, std::chrono::microseconds(10), false, now);
+    tracker.OnStart(healthy);
+    tracker.OnFinish(healthy, std::chrono::microseconds(500), true, now);
+    const double penalty_us = std::chrono::duration<double, std::micro>(
+                                  ReplicaLoadTracker::kFailurePenalty)
+                                  .count();
+    EXPECT_GE(tracker.Cost(broken, now), penalty_us);
+    EXPECT_EQ(1u, tracker.Choose({&broken, &healthy}, now));
+
+    // Once its statistics expire, the endpoint is tried again
+    const auto later = now + ReplicaLoadTracker::kStatsTtl +
+                       std::chrono::seconds(1);
+    EXPECT_DOUBLE_EQ(1.0, tracker.Cost(broken, later));
+    EXPECT_DOUBLE_EQ(1.0, tracker.Cost("unknown:1", later));
+}
+
+TEST(ReplicaLoadTrackerTest, SpreadsTies) {
+    ReplicaLoadTracker tracker;
+    const std::string a = "a:1";
+    const std::string b = "b:1";
+    const std::string c = "c:1";
+    int chosen[3] = {0, 0, 0};
+    for (int i = 0; i < 300; ++i) {
+        chosen[tracker.Choose({&a, &b, &c})]++;
+    }
+    for (int count : chosen) {
+        EXPECT_GT(count, 0);
+    }
+}
+
+}  // namespace mooncake::test
@@ -0,0 +1,180 @@
+#include "replica_task_executor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mooncake::test {
+
+using Clock = ReplicaTaskExecutor::Clock;
+
+namespace {
+
+// Holds the handlers back until Open()
+class Gate {
+   public:
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return open_; });
+    }
+
+    void Open() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_ = true;
+        }
+        cv_.notify_all();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool open_ = false;
+};
+
+template <typename Predicate>
+bool WaitFor(Predicate predicate,
+             Clock::duration timeout = std::chrono::seconds(5)) {
+    const auto deadline = Clock::now() + timeout;
+    while (!predicate()) {
+        if (Clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST(ReplicaTaskExecutorTest, RunsQueuedTasksInBatches) {
+    Gate gate;
+    std::mutex mutex;
+    std::vector<size_t> batch_sizes;
+    ReplicaTaskExecutor::Config config;
+    config.max_workers = 1;
+    config.batch_size = 8;
+    ReplicaTaskExecutor executor(config, [&](std::vector<ReplicaTask>& batch) {
+        gate.Wait();
+        std::lock_guard<std::mutex> lock(mutex);
+        batch_sizes.push_back(batch.size());
+    });
+
+    ASSERT_TRUE(executor.Submit(ReplicaTask{}));
+    ASSERT_TRUE(WaitFor([&] { return executor.num_pending() == 0; }));
+    // Queued while the only worker is busy
+    for (int i = 0; i < 16; ++i) {
+        ASSERT_TRUE(executor.Submit(ReplicaTask{}));
+    }
+    gate.Open();
+    ASSERT_TRUE(WaitFor([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return batch_sizes.size() == 3;
+    }));
+    EXPECT_EQ(batch_sizes, (std::vector<size_t>{1, 8, 8}));
+    EXPECT_EQ(executor.num_workers(), 1u);
+}
+
+TEST(ReplicaTaskExecutorTest, AddsWorkersForBacklogAndRetiresIdleOnes) {
+    Gate gate;
+    std::atomic<int> running{0};
+    std::atomic<int> max_running{0};
+    std::atomic<int> done{0};
+    ReplicaTaskExecutor::Config config;
+    config.max_workers = 3;
+    config.batch_size = 1;
+    config.idle_timeout = std::chrono::milliseconds(50);
+    ReplicaTaskExecutor executor(config, [&](std::vector<ReplicaTask>&) {
+        const int now_running = ++running;
+        int seen = max_running.load();
+        while (now_running > seen &&
+               !max_running.compare_exchange_weak(seen, now_running)) {
+        }
+        gate.Wait();
+        --running;
+        ++done;
+    });
+    EXPECT_EQ(executor.num_workers(), 1u);
+
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(executor.Submit(ReplicaTask{}));
+    }
+    ASSERT_TRUE(WaitFor([&] { return running.load() == 3; }));
+    EXPECT_EQ(executor.num_workers(), 3u);
+    gate.Open();
+    ASSERT_TRUE(WaitFor([&] { return done.load() == 5; }));
+    EXPECT_EQ(max_running.load(), 3);
+
+    ASSERT_TRUE(WaitFor([&] { return executor.num_workers() == 1; }));
+    // The remaining worker still takes new tasks
+    ASSERT_TRUE(executor.Submit(ReplicaTask{}));
+    ASSERT_TRUE(WaitFor([&] { return done.load() == 6; }));
+}
+
+TEST(ReplicaTaskExecutorTest, DelaysRetries) {
+    std::atomic<bool> ran{false};
+    Clock::time_point ran_at;
+    ReplicaTaskExecutor executor(ReplicaTaskExecutor::Config{},
+                                 [&](std::vector<ReplicaTask>& batch) {
+                                     ASSERT_EQ(batch.size(), 1u);
+                                     EXPECT_EQ(batch[0].retry_count, 2u);
+                                     ran_at = Clock::now();
+                                     ran = true;
+                                 });
+    ReplicaTask task;
+    task.retry_count = 2;
+    const auto submitted_at = Clock::now();
+    ASSERT_TRUE(executor.Submit(task, std::chrono::milliseconds(100)));
+    EXPECT_EQ(executor.num_pending(), 1u);
+    ASSERT_TRUE(WaitFor([&] { return ran.load(); }));
+    EXPECT_GE(ran_at - submitted_at, std::chrono::milliseconds(100));
+}
+
+TEST(ReplicaTaskExecutorTest, StopDropsQueuedTasks) {
+    std::atomic<int> ran{0};
+    ReplicaTaskExecutor executor(
+        ReplicaTaskExecutor::Config{},
+        [&](std::vector<ReplicaTask>& batch) { ran += batch.size(); });
+    ASSERT_TRUE(executor.Submit(ReplicaTask{}, std::chrono::seconds(60)));
+
+    const auto start = Clock::now();
+    executor.Stop();
+    EXPECT_LT(Clock::now() - start, std::chrono::seconds(5));
+    EXPECT_EQ(executor.num_pending(), 0u);
+    EXPECT_EQ(executor.num_workers(), 0u);
+    EXPECT_FALSE(executor.Submit(ReplicaTask{}));
+    EXPECT_EQ(ran.load(), 0);
+}
+
+TEST(ReplicaTaskExecutorTest, ThrottlesToBandwidth) {
+    ReplicaTaskExecutor::Config config;
+    // 1 MiB every 100ms
+    config.bandwidth_bytes_per_sec = 10 * 1024 * 1024;
+    ReplicaTaskExecutor executor(config, [](std::vector<ReplicaTask>&) {});
+
+    const auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 5; ++i) {
+        threads.emplace_back([&] { executor.Throttle(1024 * 1024); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // The first 100ms are a burst, the other 4 MiB take 300ms
+    const auto elapsed = Clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(280));
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+
+    ReplicaTaskExecutor unlimited(ReplicaTaskExecutor::Config{},
+                                  [](std::vector<ReplicaTask>&) {});
+    const auto unlimited_start = Clock::now();
+    unlimited.Throttle(uint64_t{1} << 40);
+    EXPECT_LT(Clock::now() - unlimited_start, std::chrono::milliseconds(50));
+}
+
+}  // namespace mooncake::test
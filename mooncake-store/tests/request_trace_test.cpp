@@ -0,0 +1,85 @@
+#include "request_trace.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace mooncake::test {
+
+const char* kTraceFile = "/tmp/mooncake_request_trace_test.json";
+
+class RequestTraceTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("RequestTraceTest");
+        FLAGS_logtostderr = 1;
+    }
+
+    void TearDown() override { google::ShutdownGoogleLogging(); }
+};
+
+TEST_F(RequestTraceTest, TraceIdRoundTrip) {
+    EXPECT_EQ(FormatTraceId(0), "");
+    EXPECT_EQ(ParseTraceId(""), 0u);
+    EXPECT_EQ(ParseTraceId("not-an-id"), 0u);
+    EXPECT_EQ(ParseTraceId("0123456789abcdef0"), 0u);
+    for (uint64_t id : {1ull, 0xabcdefull, 0xffffffffffffffffull}) {
+        EXPECT_EQ(ParseTraceId(FormatTraceId(id)), id);
+    }
+}
+
+TEST_F(RequestTraceTest, SamplesOneInN) {
+    ASSERT_TRUE(TracingEnabled());
+    int sampled = 0;
+    for (int i = 0; i < 40; ++i) {
+        if (SampleTraceId() != 0) {
+            ++sampled;
+        }
+    }
+    EXPECT_EQ(sampled, 10);
+}
+
+TEST_F(RequestTraceTest, SpansShareTheTraceOfTheirThread) {
+    EXPECT_EQ(CurrentTraceId(), 0u);
+    {
+        TraceSpan root("RequestTraceTest::Root", 42);
+        EXPECT_EQ(CurrentTraceId(), 42u);
+        // Nested requests join the enclosing trace
+        EXPECT_EQ(SampleTraceId(), 42u);
+        TraceSpan child("RequestTraceTest::Child");
+        EXPECT_EQ(CurrentTraceId(), 42u);
+    }
+    EXPECT_EQ(CurrentTraceId(), 0u);
+    {
+        TraceSpan untraced("RequestTraceTest::Untraced");
+        EXPECT_EQ(CurrentTraceId(), 0u);
+    }
+    FlushTraces();
+
+    std::ifstream file(kTraceFile);
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string trace = content.str();
+    EXPECT_EQ(trace.front(), '[');
+    EXPECT_NE(trace.find("\"name\":\"RequestTraceTest::Root\""),
+              std::string::npos);
+    EXPECT_NE(trace.find("\"name\":\"RequestTraceTest::Child\""),
+              std::string::npos);
+    EXPECT_NE(trace.find("\"trace_id\":\"000000000000002a\""),
+              std::string::npos);
+    EXPECT_EQ(trace.find("RequestTraceTest::Untraced"), std::string::npos);
+}
+
+}  // namespace mooncake::test
+
+int main(int argc, char** argv) {
+    // Read once per process, on first use
+    setenv("MC_STORE_TRACE_SAMPLE_EVERY", "4", 1);
+    setenv("MC_STORE_TRACE_FILE", mooncake::test::kTraceFile, 1);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
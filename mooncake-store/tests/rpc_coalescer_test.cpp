@@ -0,0 +1,101 @@
+#include "rpc_coalescer.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace mooncake::test {
+
+class RpcCoalescerTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("RpcCoalescerTest");
+        FLAGS_logtostderr = 1;
+    }
+
+    void TearDown() override { google::ShutdownGoogleLogging(); }
+};
+
+TEST_F(RpcCoalescerTest, LoneCallIsSentAtOnce) {
+    std::atomic<int> batch_calls{0};
+    RpcCoalescer<bool> coalescer(
+        [&](const std::vector<std::string>& keys) {
+            ++batch_calls;
+            RpcCoalescer<bool>::Results results;
+            for (const auto& key : keys) {
+                results.emplace_back(key == "present");
+            }
+            return results;
+        },
+        std::chrono::seconds(10), 16);
+
+    auto start = std::chrono::steady_clock::now();
+    auto present = coalescer.Call("present");
+    auto missing = coalescer.Call("missing");
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_TRUE(present.has_value());
+    EXPECT_TRUE(present.value());
+    ASSERT_TRUE(missing.has_value());
+    EXPECT_FALSE(missing.value());
+    EXPECT_EQ(batch_calls.load(), 2);
+    // Without a batch in flight the window is not waited for
+    EXPECT_LT(elapsed, std::chrono::seconds(5));
+}
+
+TEST_F(RpcCoalescerTest, ConcurrentCallsShareBatches) {
+    constexpr int kThreads = 32;
+    std::atomic<int> batch_calls{0};
+    RpcCoalescer<int> coalescer(
+        [&](const std::vector<std::string>& keys) {
+            ++batch_calls;
+            // Keep the batch in flight so that the other callers pile up
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            RpcCoalescer<int>::Results results;
+            for (const auto& key : keys) {
+                results.emplace_back(std::stoi(key));
+            }
+            return results;
+        },
+        std::chrono::milliseconds(50), 8);
+
+    std::vector<std::thread> threads;
+    std::vector<int> values(kThreads, -1);
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i] {
+            auto result = coalescer.Call(std::to_string(i));
+            if (result.has_value()) {
+                values[i] = result.value();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 0; i < kThreads; ++i) {
+        EXPECT_EQ(values[i], i);
+    }
+    EXPECT_LT(batch_calls.load(), kThreads);
+}
+
+TEST_F(RpcCoalescerTest, ShortBatchResultFailsAllCallers) {
+    RpcCoalescer<void> coalescer(
+        [](const std::vector<std::string>&) {
+            return RpcCoalescer<void>::Results{};
+        },
+        std::chrono::microseconds(50), 4);
+
+    auto result = coalescer.Call("key");
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), ErrorCode::RPC_FAIL);
+}
+
+}  // namespace mooncake::test
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 
 #include <boost/functional/hash.hpp>
+#include <thread>
 
 namespace mooncake {
 
@@ -460,6 +461,42 @@ TEST_F(SegmentTest, QuerySegments) {
     ASSERT_EQ(capacity, 0);
 }
 
+// ReadAccessSharesLock:
+// 1. Mount a segment, then hold a read-only segment access.
+// 2. Another reader and an allocator user must not block on it.
+TEST_F(SegmentTest, ReadAccessSharesLock) {
+    SegmentManager segment_manager;
+    Segment segment;
+    segment.id = generate_uuid();
+    segment.name = "test_segment";
+    segment.size = 1024 * 1024 * 16;
+    segment.base = 0x100000000;
+    {
+        auto segment_access = segment_manager.getSegmentAccess();
+        ASSERT_EQ(segment_access.MountSegment(segment, generate_uuid()),
+                  ErrorCode::OK);
+    }
+
+    const auto read_access = segment_manager.getSegmentReadAccess();
+    size_t used = 0, capacity = 0;
+    ASSERT_EQ(read_access.QuerySegments(segment.name, used, capacity),
+              ErrorCode::OK);
+    ASSERT_EQ(capacity, segment.size);
+
+    std::thread other([&]() {
+        const auto other_access = segment_manager.getSegmentReadAccess();
+        std::vector<std::string> all_segments;
+        EXPECT_EQ(other_access.GetAllSegments(all_segments), ErrorCode::OK);
+        EXPECT_EQ(all_segments.size(), 1);
+
+        auto allocator_access = segment_manager.getAllocatorAccess();
+        EXPECT_NE(
+            allocator_access.getAllocatorManager().getAllocators(segment.name),
+            nullptr);
+    });
+    other.join();
+}
+
 // Mount Local Disk Segment Operations Tests:
 TEST_F(SegmentTest, MountLocalDiskSegmentSuccess) {
     SegmentManager segment_manager;
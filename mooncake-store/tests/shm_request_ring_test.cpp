@@ -0,0 +1,152 @@
+#include "shm_request_ring.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mooncake::test {
+
+namespace {
+
+// The serving side of a ring, mapped a second time as the RealClient does
+class RingServer {
+   public:
+    RingServer(const ShmRequestRing &ring, size_t num_threads) {
+        auto attached = ShmRequestRing::Attach(dup(ring.fd()), ring.size());
+        EXPECT_TRUE(attached.has_value());
+        ring_ = std::move(attached.value());
+        for (size_t i = 0; i < num_threads; ++i) {
+            threads_.emplace_back([this] {
+                ring_->Serve([](const ShmRequestRing::Request &request,
+                                std::vector<int64_t> &results) {
+                    for (size_t i = 0; i < request.keys.size(); ++i) {
+                        results.push_back(
+                            request.op == ShmRequestRing::Op::BATCH_GET_INTO
+                                ? static_cast<int64_t>(request.sizes[i] +
+                                                       request.keys[i].size())
+                                : static_cast<int64_t>(
+                                      request.config.replica_num));
+                    }
+                });
+            });
+        }
+    }
+
+    ~RingServer() {
+        ring_->Stop();
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+    }
+
+   private:
+    std::shared_ptr<ShmRequestRing> ring_;
+    std::vector<std::thread> threads_;
+};
+
+ShmRequestRing::Request MakeRequest(ShmRequestRing::Op op, int num_keys) {
+    ShmRequestRing::Request request;
+    request.op = op;
+    for (int i = 0; i < num_keys; ++i) {
+        request.keys.push_back("key_" + std::to_string(i));
+        request.buffers.push_back(0x1000 * (i + 1));
+        request.sizes.push_back(i * 10);
+    }
+    return request;
+}
+
+}  // namespace
+
+TEST(ShmRequestRingTest, ServesRequests) {
+    auto ring = ShmRequestRing::Create(8, 4096);
+    ASSERT_TRUE(ring.has_value());
+    RingServer server(*ring.value(), 1);
+
+    auto request = MakeRequest(ShmRequestRing::Op::BATCH_GET_INTO, 5);
+    auto results = ring.value()->Submit(request, [] { return true; });
+    ASSERT_TRUE(results.has_value());
+    ASSERT_EQ(results->size(), 5u);
+    for (size_t i = 0; i < 5; ++i) {
+        EXPECT_EQ((*results)[i],
+                  static_cast<int64_t>(i * 10 + request.keys[i].size()));
+    }
+
+    auto put = MakeRequest(ShmRequestRing::Op::BATCH_PUT_FROM, 3);
+    put.config.replica_num = 2;
+    results = ring.value()->Submit(put, [] { return true; });
+    ASSERT_TRUE(results.has_value());
+    EXPECT_EQ(*results, std::vector<int64_t>(3, 2));
+}
+
+TEST(ShmRequestRingTest, ConcurrentSubmitters) {
+    auto ring = ShmRequestRing::Create(4, 4096);
+    ASSERT_TRUE(ring.has_value());
+    RingServer server(*ring.value(), 2);
+
+    std::vector<std::thread> submitters;
+    std::atomic<int> served{0};
+    for (int t = 0; t < 4; ++t) {
+        submitters.emplace_back([&, t] {
+            auto request =
+                MakeRequest(ShmRequestRing::Op::BATCH_GET_INTO, t + 1);
+            for (int i = 0; i < 1000; ++i) {
+                auto results =
+                    ring.value()->Submit(request, [] { return true; });
+                ASSERT_TRUE(results.has_value());
+                ASSERT_EQ(results->size(), request.keys.size());
+                EXPECT_EQ(results->back(),
+                          static_cast<int64_t>(request.sizes.back() +
+                                               request.keys.back().size()));
+                served++;
+            }
+        });
+    }
+    for (auto &thread : submitters) {
+        thread.join();
+    }
+    EXPECT_EQ(served.load(), 4000);
+}
+
+TEST(ShmRequestRingTest, OversizedRequestsAreLeftToTheCaller) {
+    auto ring = ShmRequestRing::Create(2, 1024);
+    ASSERT_TRUE(ring.has_value());
+    auto request = MakeRequest(ShmRequestRing::Op::BATCH_GET_INTO, 100);
+    EXPECT_FALSE(ring.value()->Fits(request));
+    auto results = ring.value()->Submit(request, [] { return true; });
+    ASSERT_FALSE(results.has_value());
+    EXPECT_EQ(results.error(), ErrorCode::BUFFER_OVERFLOW);
+
+    auto put = MakeRequest(ShmRequestRing::Op::BATCH_PUT_FROM, 1);
+    put.config.preferred_segments.push_back("segment");
+    EXPECT_FALSE(ring.value()->Fits(put));
+}
+
+TEST(ShmRequestRingTest, GivesUpWhenServerIsGone) {
+    auto ring = ShmRequestRing::Create(2, 1024);
+    ASSERT_TRUE(ring.has_value());
+    auto request = MakeRequest(ShmRequestRing::Op::BATCH_GET_INTO, 1);
+    auto results = ring.value()->Submit(request, [] { return false; });
+    ASSERT_FALSE(results.has_value());
+    EXPECT_EQ(results.error(), ErrorCode::RPC_FAIL);
+
+    // The abandoned slot is not reused, the other one still is
+    RingServer server(*ring.value(), 1);
+    results = ring.value()->Submit(request, [] { return true; });
+    ASSERT_TRUE(results.has_value());
+    results = ring.value()->Submit(request, [] { return true; });
+    ASSERT_TRUE(results.has_value());
+}
+
+TEST(ShmRequestRingTest, RejectsMalformedSegments) {
+    auto ring = ShmRequestRing::Create(2, 1024);
+    ASSERT_TRUE(ring.has_value());
+    auto attached = ShmRequestRing::Attach(dup(ring.value()->fd()),
+                                           ring.value()->size() - 64);
+    EXPECT_FALSE(attached.has_value());
+    EXPECT_FALSE(ShmRequestRing::Create(3, 1024).has_value());
+}
+
+}  // namespace mooncake::test
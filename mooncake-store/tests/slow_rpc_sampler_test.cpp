@@ -0,0 +1,80 @@
+#include "slow_rpc_sampler.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace mooncake::test {
+
+class SlowRpcSamplerTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("SlowRpcSamplerTest");
+        FLAGS_logtostderr = 1;
+    }
+
+    void TearDown() override { google::ShutdownGoogleLogging(); }
+};
+
+TEST_F(SlowRpcSamplerTest, KeepsSlowestPerInterval) {
+    SlowRpcSampler sampler(3);
+    for (uint64_t latency : {5, 40, 10, 30, 20, 50, 1}) {
+        sampler.Offer("GetReplicaList", "key" + std::to_string(latency), 1,
+                      latency);
+    }
+    sampler.Offer("BatchPutStart", "first", 64, 45);
+
+    auto samples = sampler.Drain();
+    ASSERT_EQ(samples.size(), 3u);
+    EXPECT_EQ(samples[0].latency_us, 50u);
+    EXPECT_EQ(samples[0].key, "key50");
+    EXPECT_EQ(samples[1].rpc, "BatchPutStart");
+    EXPECT_EQ(samples[1].batch_size, 64u);
+    EXPECT_EQ(samples[2].latency_us, 40u);
+
+    // The next interval starts empty and accepts fast RPCs again
+    EXPECT_TRUE(sampler.Drain().empty());
+    sampler.Offer("ExistKey", "key", 1, 2);
+    samples = sampler.Drain();
+    ASSERT_EQ(samples.size(), 1u);
+    EXPECT_EQ(samples[0].latency_us, 2u);
+}
+
+TEST_F(SlowRpcSamplerTest, ConcurrentOffers) {
+    constexpr int kThreads = 8;
+    constexpr uint64_t kOffersPerThread = 1000;
+    SlowRpcSampler sampler(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (uint64_t i = 0; i < kOffersPerThread; ++i) {
+                sampler.Offer("Ping", {}, 1, i * kThreads + t);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto samples = sampler.Drain();
+    ASSERT_EQ(samples.size(), 4u);
+    const uint64_t slowest = kOffersPerThread * kThreads - 1;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        EXPECT_EQ(samples[i].latency_us, slowest - i);
+    }
+}
+
+TEST_F(SlowRpcSamplerTest, DisabledKeepsNothing) {
+    SlowRpcSampler sampler(0);
+    EXPECT_FALSE(sampler.enabled());
+    sampler.Offer("ExistKey", "key", 1, 1000);
+    EXPECT_TRUE(sampler.Drain().empty());
+}
+
+}  // namespace mooncake::test
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
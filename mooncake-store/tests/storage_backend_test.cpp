@@ -9,6 +9,9 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <optional>
+#include <random>
+#include <unordered_set>
 #include <fcntl.h>
 #include <unistd.h>
 #include <ylt/util/tl/expected.hpp>
@@ -507,6 +510,43 @@ TEST_F(StorageBackendTest, OrphanedBucketFileCleanup) {
     ASSERT_TRUE(is_exist.value());
 }
 
+TEST_F(StorageBackendTest, StorageBackendBatchStoreAndLoadObjects) {
+    auto storage_backend =
+        StorageBackend::Create(data_path, "batch_objects", false);
+    ASSERT_TRUE(storage_backend);
+    ASSERT_TRUE(storage_backend->Init(0));
+
+    const std::string root = data_path + "/moon_batch_objects/";
+    std::vector<std::string> paths = {root + "a", root + "b", root + "c"};
+    std::vector<std::string> values = {"first value", std::string(8192, 'x'),
+                                       "third"};
+    std::vector<std::span<const char>> data;
+    for (const auto& value : values) {
+        data.emplace_back(value.data(), value.size());
+    }
+    auto store_results = storage_backend->BatchStoreObjects(paths, data);
+    ASSERT_EQ(paths.size(), store_results.size());
+    for (const auto& result : store_results) {
+        EXPECT_TRUE(result);
+    }
+
+    // A missing file fails only its own entry
+    paths.push_back(root + "missing");
+    std::vector<std::string> strs;
+    for (const auto& value : values) {
+        strs.emplace_back(value.size(), '\0');
+    }
+    strs.emplace_back(16, '\0');
+    auto load_results = storage_backend->BatchLoadObjects(paths, strs);
+    ASSERT_EQ(paths.size(), load_results.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_TRUE(load_results[i]);
+        EXPECT_EQ(values[i], strs[i]);
+    }
+    ASSERT_FALSE(load_results.back());
+    EXPECT_EQ(ErrorCode::FILE_OPEN_FAIL, load_results.back().error());
+}
+
 TEST_F(StorageBackendTest, AdaptorBatchOffloadAndBatchLoad) {
     FileStorageConfig cfg;
 
@@ -831,6 +871,115 @@ TEST_F(StorageBackendTest, AdaptorScanMetaAndBatchLoadAcrossRestart) {
     }
 }
 
+TEST_F(StorageBackendTest, AdaptorAggregatesSmallObjectsIntoPacks) {
+    FileStorageConfig cfg;
+    cfg.storage_filepath = data_path;
+    cfg.scanmeta_iterator_keys_limit = 16;
+    cfg.total_keys_limit = 100;
+    cfg.total_size_limit = 1 << 20;
+
+    FilePerKeyConfig file_per_key_config;
+    file_per_key_config.fsdir = "file_per_key_dir_aggregate";
+    file_per_key_config.enable_eviction = true;
+    file_per_key_config.aggregate_value_size_limit = 16;
+    file_per_key_config.aggregate_buffer_size = 64 * 1024;
+    file_per_key_config.aggregate_flush_interval_ms = 20;
+
+    std::unordered_map<std::string, std::string> test_data = {
+        {"small-1", "a"},
+        {"small-2", "bb"},
+        {"small/3", "ccc"},
+        {"large", std::string(256, 'x')},
+    };
+
+    auto load_and_check = [&](StorageBackendAdaptor& adaptor) {
+        std::unordered_map<std::string, Slice> load_slices;
+        std::vector<std::unique_ptr<char[]>> load_buffers;
+        for (auto& [key, value] : test_data) {
+            auto buf = std::make_unique<char[]>(value.size());
+            load_slices.emplace(key, Slice{buf.get(), value.size()});
+            load_buffers.emplace_back(std::move(buf));
+        }
+        ASSERT_TRUE(adaptor.BatchLoad(load_slices));
+        for (auto& [key, value] : test_data) {
+            auto& slice = load_slices.at(key);
+            EXPECT_EQ(std::string(static_cast<char*>(slice.ptr), slice.size),
+                      value);
+            auto exist = adaptor.IsExist(key);
+            ASSERT_TRUE(exist);
+            EXPECT_TRUE(exist.value()) << key;
+        }
+    };
+
+    {
+        StorageBackendAdaptor adaptor(cfg, file_per_key_config);
+        ASSERT_TRUE(adaptor.Init());
+
+        std::unordered_map<std::string, std::vector<Slice>> batch_object;
+        for (auto& [key, value] : test_data) {
+            batch_object[key].emplace_back(Slice{value.data(), value.size()});
+        }
+
+        std::mutex notified_mutex;
+        std::unordered_map<std::string, int64_t> notified;
+        auto offload_res = adaptor.BatchOffload(
+            batch_object, [&](const std::vector<std::string>& keys,
+                              std::vector<StorageObjectMetadata>& metas) {
+                std::lock_guard<std::mutex> lock(notified_mutex);
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    notified[keys[i]] = metas[i].data_size;
+                }
+                return ErrorCode::OK;
+            });
+        ASSERT_TRUE(offload_res);
+        EXPECT_EQ(offload_res.value(), 4);
+
+        // Small objects are reported once the flush thread writes their pack
+        for (int i = 0; i < 500; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(notified_mutex);
+                if (notified.size() == test_data.size()) break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        {
+            std::lock_guard<std::mutex> lock(notified_mutex);
+            ASSERT_EQ(notified.size(), test_data.size());
+            for (auto& [key, value] : test_data) {
+                EXPECT_EQ(notified[key], static_cast<int64_t>(value.size()));
+            }
+        }
+        EXPECT_TRUE(fs::exists(fs::path(data_path) /
+                               file_per_key_config.fsdir / "packs"));
+
+        load_and_check(adaptor);
+    }
+
+    {
+        StorageBackendAdaptor adaptor(cfg, file_per_key_config);
+        ASSERT_TRUE(adaptor.Init());
+
+        std::unordered_map<std::string, int> scanned;
+        auto scan_res =
+            adaptor.ScanMeta([&](const std::vector<std::string>& keys,
+                                 std::vector<StorageObjectMetadata>& metas) {
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    scanned[keys[i]]++;
+                    EXPECT_EQ(metas[i].data_size,
+                              static_cast<int64_t>(test_data[keys[i]].size()));
+                }
+                return ErrorCode::OK;
+            });
+        ASSERT_TRUE(scan_res);
+        ASSERT_EQ(scanned.size(), test_data.size());
+        for (auto& [key, count] : scanned) {
+            EXPECT_EQ(count, 1) << key;
+        }
+
+        load_and_check(adaptor);
+    }
+}
+
 //-----------------------------------------------------------------------------
 
 TEST_F(StorageBackendTest, OffsetAllocatorStorageBackend_BasicPutGet) {
@@ -966,6 +1115,62 @@ TEST_F(StorageBackendTest, OffsetAllocatorStorageBackend_Overwrite) {
 
 //-----------------------------------------------------------------------------
 
+TEST_F(StorageBackendTest, OffsetAllocatorStorageBackend_AlignedAndDiscarded) {
+    FileStorageConfig config;
+    config.storage_filepath = data_path;
+    config.storage_backend_type = StorageBackendType::kOffsetAllocator;
+    config.total_size_limit = 100 * 1024 * 1024;
+    config.total_keys_limit = 10000;
+    OffsetAllocatorBackendConfig backend_config;
+    backend_config.allocation_alignment = 4096;
+    // Every freed extent is punched at once
+    backend_config.discard_batch_bytes = 1;
+
+    OffsetAllocatorStorageBackend storage_backend(config, backend_config);
+    ASSERT_TRUE(storage_backend.Init());
+
+    auto offload = [&](const std::string& key, const std::string& value) {
+        std::unordered_map<std::string, std::vector<Slice>> batch_object;
+        batch_object.emplace(
+            key, std::vector<Slice>{
+                     Slice{const_cast<char*>(value.data()), value.size()}});
+        int64_t offset = -1;
+        auto offload_res = storage_backend.BatchOffload(
+            batch_object, [&](const std::vector<std::string>&,
+                              std::vector<StorageObjectMetadata>& metadatas) {
+                offset = metadatas[0].offset;
+                return ErrorCode::OK;
+            });
+        EXPECT_TRUE(offload_res);
+        return offset;
+    };
+
+    std::vector<std::string> values = {"a", std::string(5000, 'b'), "c"};
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(offload("key_" + std::to_string(i), values[i]) % 4096, 0);
+    }
+    values[0] = "overwritten";
+    EXPECT_EQ(offload("key_0", values[0]) % 4096, 0);
+
+    auto stats = storage_backend.GetDiskStats();
+    EXPECT_EQ(stats.allocated_bytes, 5 * 4096);
+    EXPECT_LT(stats.record_bytes, stats.allocated_bytes);
+    EXPECT_EQ(stats.discarded_bytes, 4096);
+    EXPECT_EQ(stats.discard_calls, 1);
+
+    // Punching the old extent leaves the other records intact
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::string loaded(values[i].size(), '\0');
+        std::unordered_map<std::string, Slice> load_slices;
+        load_slices.emplace("key_" + std::to_string(i),
+                            Slice{loaded.data(), loaded.size()});
+        ASSERT_TRUE(storage_backend.BatchLoad(load_slices));
+        EXPECT_EQ(loaded, values[i]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
 TEST_F(StorageBackendTest, OffsetAllocatorStorageBackend_SizeMismatch) {
     FileStorageConfig config;
     config.storage_filepath = data_path;
@@ -1748,6 +1953,115 @@ TEST_F(StorageBackendTest,
         << "Writer should have completed some writes";
 }
 
+//-----------------------------------------------------------------------------
+
+namespace {
+
+ErrorCode OffloadValues(
+    StorageBackendInterface& storage_backend,
+    const std::vector<std::pair<std::string, std::string>>& objects) {
+    std::unordered_map<std::string, std::vector<Slice>> batch_object;
+    for (const auto& [key, value] : objects) {
+        batch_object.emplace(
+            key, std::vector<Slice>{Slice{const_cast<char*>(value.data()),
+                                          value.size()}});
+    }
+    auto offload_res = storage_backend.BatchOffload(batch_object, nullptr);
+    if (!offload_res) {
+        return offload_res.error();
+    }
+    return offload_res.value() == static_cast<int64_t>(objects.size())
+               ? ErrorCode::OK
+               : ErrorCode::INTERNAL_ERROR;
+}
+
+std::optional<std::string> LoadValue(StorageBackendInterface& storage_backend,
+                                     const std::string& key, size_t size) {
+    std::string value(size, '\0');
+    std::unordered_map<std::string, Slice> load_slices;
+    load_slices.emplace(key, Slice{value.data(), size});
+    if (!storage_backend.BatchLoad(load_slices)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+}  // namespace
+
+TEST_F(StorageBackendTest, OffsetAllocatorStorageBackend_PersistentIndex) {
+    FileStorageConfig config;
+    config.storage_filepath = data_path;
+    config.storage_backend_type = StorageBackendType::kOffsetAllocator;
+    config.total_size_limit = 64 * 1024 * 1024;
+    config.total_keys_limit = 10000;
+    OffsetAllocatorBackendConfig backend_config;
+    backend_config.persist_index = true;
+    // Checkpoint every few records to exercise log rotation
+    backend_config.index_log_checkpoint_bytes = 256;
+
+    std::string crash_path = data_path + "_crash";
+    fs::remove_all(crash_path);
+    {
+        OffsetAllocatorStorageBackend storage_backend(config, backend_config);
+        ASSERT_TRUE(storage_backend.Init());
+        for (int i = 0; i < 50; ++i) {
+            ASSERT_EQ(OffloadValues(storage_backend,
+                                    {{"persist_" + std::to_string(i),
+                                      "value_" + std::to_string(i)}}),
+                      ErrorCode::OK);
+        }
+        // Overwritten keys recover their latest value
+        ASSERT_EQ(OffloadValues(storage_backend,
+                                {{"persist_0", "new_value_0"},
+                                 {"persist_1", "new_value_1"}}),
+                  ErrorCode::OK);
+
+        // A copy of the files taken while running, as after a crash
+        fs::copy(data_path, crash_path, fs::copy_options::recursive);
+    }
+
+    for (const auto& path : {data_path, crash_path}) {
+        config.storage_filepath = path;
+        OffsetAllocatorStorageBackend storage_backend(config, backend_config);
+        ASSERT_TRUE(storage_backend.Init()) << path;
+        EXPECT_EQ(storage_backend.IsExist("persist_49").value(), true) << path;
+        EXPECT_EQ(LoadValue(storage_backend, "persist_0", 11), "new_value_0")
+            << path;
+        EXPECT_EQ(LoadValue(storage_backend, "persist_1", 11), "new_value_1")
+            << path;
+        for (int i = 2; i < 50; ++i) {
+            std::string expected = "value_" + std::to_string(i);
+            EXPECT_EQ(LoadValue(storage_backend, "persist_" + std::to_string(i),
+                                expected.size()),
+                      expected)
+                << path;
+        }
+
+        // New objects do not overwrite the recovered ones
+        ASSERT_EQ(OffloadValues(storage_backend, {{"after_restart", "fresh"}}),
+                  ErrorCode::OK);
+        EXPECT_EQ(LoadValue(storage_backend, "after_restart", 5), "fresh");
+        EXPECT_EQ(LoadValue(storage_backend, "persist_2", 7), "value_2");
+
+        std::atomic<int> scanned{0};
+        ASSERT_TRUE(storage_backend.ScanMeta(
+            [&scanned](const std::vector<std::string>& keys,
+                       std::vector<StorageObjectMetadata>&) {
+                scanned += keys.size();
+                return ErrorCode::OK;
+            }));
+        EXPECT_EQ(scanned.load(), 51) << path;
+    }
+
+    // Without persist_index the data file starts empty again
+    config.storage_filepath = data_path;
+    OffsetAllocatorStorageBackend fresh_backend(config);
+    ASSERT_TRUE(fresh_backend.Init());
+    EXPECT_FALSE(fresh_backend.IsExist("persist_2").value());
+    EXPECT_FALSE(fs::exists(data_path + "/kv_cache.index"));
+    fs::remove_all(crash_path);
+}
+
 //-----------------------------------------------------------------------------
 // BucketStorageBackend: Duplicate Key Detection Tests (Phase 0 - D0)
 //-----------------------------------------------------------------------------
@@ -2611,6 +2925,328 @@ TEST_F(StorageBackendTest, BucketStorageBackend_ConcurrentReadWriteDelete) {
     EXPECT_GT(read_count.load(), 0) << "Should have some successful reads";
 }
 
+//-----------------------------------------------------------------------------
+// Compaction Tests
+//-----------------------------------------------------------------------------
+
+TEST_F(StorageBackendTest, BucketStorageBackend_CompactSparseBuckets) {
+    FileStorageConfig config;
+    config.storage_filepath = data_path;
+    BucketBackendConfig bucket_config;
+    bucket_config.compaction_interval_seconds = 0;  // Compact explicitly
+    auto storage_backend =
+        std::make_unique<BucketStorageBackend>(config, bucket_config);
+    ASSERT_TRUE(storage_backend->Init());
+
+    // Three buckets of four 1KB objects
+    std::unordered_map<std::string, std::string> values;
+    std::vector<int64_t> bucket_ids;
+    for (int b = 0; b < 3; ++b) {
+        std::unordered_map<std::string, std::vector<Slice>> batch;
+        for (int i = 0; i < 4; ++i) {
+            std::string key = "compact_" + std::to_string(b) + "_" +
+                              std::to_string(i);
+            values[key] = std::string(1024, static_cast<char>('a' + b * 4 + i));
+            batch.emplace(key, std::vector<Slice>{Slice{
+                                   values[key].data(), values[key].size()}});
+        }
+        auto offload_result = storage_backend->BatchOffload(batch, nullptr);
+        ASSERT_TRUE(offload_result.has_value());
+        bucket_ids.push_back(offload_result.value());
+    }
+
+    // Buckets 0 and 1 keep one live object, bucket 2 keeps three
+    std::vector<std::string> removed = {"compact_0_0", "compact_0_1",
+                                        "compact_0_2", "compact_1_1",
+                                        "compact_1_2", "compact_1_3",
+                                        "compact_2_0", "unknown_key"};
+    auto remove_result = storage_backend->BatchRemove(removed);
+    ASSERT_TRUE(remove_result.has_value());
+    EXPECT_EQ(remove_result.value(), 7);
+    for (const auto& key : removed) {
+        EXPECT_FALSE(storage_backend->IsExist(key).value()) << key;
+        values.erase(key);
+    }
+
+    auto compact_result = storage_backend->CompactBuckets();
+    ASSERT_TRUE(compact_result.has_value());
+    EXPECT_GT(compact_result.value(), 4096);
+    EXPECT_EQ(storage_backend->GetCompactionReclaimedBytes(),
+              compact_result.value());
+
+    // The sparse buckets are gone, the dense one is kept
+    std::vector<std::string> bucket_keys;
+    EXPECT_FALSE(storage_backend->GetBucketKeys(bucket_ids[0], bucket_keys));
+    EXPECT_FALSE(storage_backend->GetBucketKeys(bucket_ids[1], bucket_keys));
+    EXPECT_TRUE(storage_backend->GetBucketKeys(bucket_ids[2], bucket_keys));
+    EXPECT_FALSE(fs::exists(data_path + "/" + std::to_string(bucket_ids[0]) +
+                            ".bucket"));
+    EXPECT_FALSE(fs::exists(data_path + "/" + std::to_string(bucket_ids[1]) +
+                            ".meta"));
+
+    // Nothing is left to compact
+    compact_result = storage_backend->CompactBuckets();
+    ASSERT_TRUE(compact_result.has_value());
+    EXPECT_EQ(compact_result.value(), 0);
+
+    auto verify = [&](BucketStorageBackend& backend) {
+        for (const auto& [key, value] : values) {
+            std::string loaded(value.size(), '\0');
+            std::unordered_map<std::string, Slice> load_slices;
+            load_slices.emplace(key, Slice{loaded.data(), loaded.size()});
+            ASSERT_TRUE(backend.BatchLoad(load_slices).has_value()) << key;
+            EXPECT_EQ(loaded, value) << key;
+        }
+        auto metadata = backend.GetStoreMetadata();
+        ASSERT_TRUE(metadata.has_value());
+        EXPECT_EQ(metadata->total_keys, 5);
+    };
+    verify(*storage_backend);
+
+    // Removals and the compacted layout survive a restart
+    storage_backend.reset();
+    BucketStorageBackend restarted(config, bucket_config);
+    ASSERT_TRUE(restarted.Init());
+    for (const auto& key : removed) {
+        EXPECT_FALSE(restarted.IsExist(key).value()) << key;
+    }
+    verify(restarted);
+}
+
+TEST_F(StorageBackendTest, BucketStorageBackend_CompressedValues) {
+    BucketBackendConfig bucket_config;
+    if (IsCompressionCodecAvailable(CompressionCodec::kLz4)) {
+        bucket_config.compression_codec = CompressionCodec::kLz4;
+    } else if (IsCompressionCodecAvailable(CompressionCodec::kZstd)) {
+        bucket_config.compression_codec = CompressionCodec::kZstd;
+    } else {
+        GTEST_SKIP() << "No compression codec built in";
+    }
+    bucket_config.compression_min_size = 1024;
+    bucket_config.compaction_interval_seconds = 0;  // Compact explicitly
+    FileStorageConfig config;
+    config.storage_filepath = data_path;
+    auto storage_backend =
+        std::make_unique<BucketStorageBackend>(config, bucket_config);
+    ASSERT_TRUE(storage_backend->Init());
+
+    // A compressible value in two slices, an incompressible one and one
+    // below the size threshold
+    std::string text;
+    for (int i = 0; text.size() < 64 * 1024; ++i) {
+        text += "layer_" + std::to_string(i % 61) + ";";
+    }
+    std::string noise(64 * 1024, '\0');
+    std::mt19937 gen(7);
+    for (auto& c : noise) {
+        c = static_cast<char>(gen());
+    }
+    std::unordered_map<std::string, std::string> values = {
+        {"text", text}, {"noise", noise}, {"small", text.substr(0, 512)}};
+    std::unordered_map<std::string, std::vector<Slice>> batch;
+    batch["text"] = {Slice{values["text"].data(), 1000},
+                     Slice{values["text"].data() + 1000, text.size() - 1000}};
+    for (const std::string key : {"noise", "small"}) {
+        batch[key] = {Slice{values[key].data(), values[key].size()}};
+    }
+    auto offload_result = storage_backend->BatchOffload(
+        batch, [&](const std::vector<std::string>& keys,
+                   std::vector<StorageObjectMetadata>& metadatas) {
+            // The master sees the sizes of the values
+            for (size_t i = 0; i < keys.size(); ++i) {
+                EXPECT_EQ(metadatas[i].data_size,
+                          static_cast<int64_t>(values[keys[i]].size()));
+            }
+            return ErrorCode::OK;
+        });
+    ASSERT_TRUE(offload_result.has_value());
+
+    auto stats = storage_backend->GetCompressionStats();
+    EXPECT_EQ(stats.values, 3);
+    EXPECT_EQ(stats.compressed_values, 1);
+    const int64_t data_bytes = text.size() + noise.size() + 512;
+    EXPECT_EQ(stats.data_bytes, data_bytes);
+    EXPECT_LT(stats.stored_bytes,
+              data_bytes - static_cast<int64_t>(text.size() / 2));
+    EXPECT_GT(stats.Ratio(), 1.0);
+    EXPECT_LT(fs::file_size(data_path + "/" +
+                            std::to_string(offload_result.value()) +
+                            ".bucket"),
+              static_cast<uintmax_t>(data_bytes));
+
+    auto verify = [&](BucketStorageBackend& backend) {
+        std::unordered_map<std::string, std::string> loaded;
+        std::unordered_map<std::string, Slice> load_slices;
+        for (const auto& [key, value] : values) {
+            loaded[key].resize(value.size());
+            load_slices.emplace(key,
+                                Slice{loaded[key].data(), loaded[key].size()});
+        }
+        ASSERT_TRUE(backend.BatchLoad(load_slices).has_value());
+        for (const auto& [key, value] : values) {
+            EXPECT_EQ(loaded[key], value) << key;
+        }
+    };
+    verify(*storage_backend);
+
+    // Compaction copies the compressed value as it is
+    ASSERT_TRUE(storage_backend->BatchRemove({"noise"}).has_value());
+    values.erase("noise");
+    auto compact_result = storage_backend->CompactBuckets();
+    ASSERT_TRUE(compact_result.has_value());
+    EXPECT_GT(compact_result.value(), 0);
+    verify(*storage_backend);
+
+    storage_backend.reset();
+    BucketStorageBackend restarted(config, bucket_config);
+    ASSERT_TRUE(restarted.Init());
+    verify(restarted);
+}
+
+//-----------------------------------------------------------------------------
+
+TEST_F(StorageBackendTest, BucketStorageBackend_RemoveAllKeysDeletesBucket) {
+    FileStorageConfig config;
+    config.storage_filepath = data_path;
+    BucketBackendConfig bucket_config;
+    bucket_config.compaction_interval_seconds = 0;
+    BucketStorageBackend storage_backend(config, bucket_config);
+    ASSERT_TRUE(storage_backend.Init());
+
+    std::string value = "remove_all_value";
+    std::unordered_map<std::string, std::vector<Slice>> batch;
+    batch.emplace("remove_all_k1",
+                  std::vector<Slice>{Slice{value.data(), value.size()}});
+    batch.emplace("remove_all_k2",
+                  std::vector<Slice>{Slice{value.data(), value.size()}});
+    auto offload_result = storage_backend.BatchOffload(batch, nullptr);
+    ASSERT_TRUE(offload_result.has_value());
+    int64_t bucket_id = offload_result.value();
+
+    auto remove_result =
+        storage_backend.BatchRemove({"remove_all_k1", "remove_all_k2"});
+    ASSERT_TRUE(remove_result.has_value());
+    EXPECT_EQ(remove_result.value(), 2);
+    EXPECT_FALSE(fs::exists(data_path + "/" + std::to_string(bucket_id) +
+                            ".bucket"));
+    auto metadata = storage_backend.GetStoreMetadata();
+    ASSERT_TRUE(metadata.has_value());
+    EXPECT_EQ(metadata->total_keys, 0);
+    EXPECT_EQ(metadata->total_size, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+TEST_F(StorageBackendTest, BucketStorageBackend_ParallelScanMeta) {
+    FileStorageConfig config;
+    config.storage_filepath = data_path;
+    config.scanmeta_threads = 4;
+    config.scanmeta_iterator_keys_limit = 3;
+    BucketBackendConfig bucket_config;
+    bucket_config.compaction_interval_seconds = 0;
+
+    constexpr int kBuckets = 32;
+    std::string value = "parallel_scan_value";
+    {
+        BucketStorageBackend storage_backend(config, bucket_config);
+        ASSERT_TRUE(storage_backend.Init());
+        for (int i = 0; i < kBuckets; ++i) {
+            std::unordered_map<std::string, std::vector<Slice>> batch;
+            for (int j = 0; j < 2; ++j) {
+                batch.emplace("scan_" + std::to_string(i) + "_" +
+                                  std::to_string(j),
+                              std::vector<Slice>{
+                                  Slice{value.data(), value.size()}});
+            }
+            ASSERT_TRUE(storage_backend.BatchOffload(batch, nullptr));
+        }
+    }
+
+    // Metadata files are loaded by several threads after a restart
+    BucketStorageBackend storage_backend(config, bucket_config);
+    ASSERT_TRUE(storage_backend.Init());
+    auto metadata = storage_backend.GetStoreMetadata();
+    ASSERT_TRUE(metadata.has_value());
+    EXPECT_EQ(metadata->total_keys, kBuckets * 2);
+
+    std::mutex mutex;
+    std::unordered_set<std::string> scanned;
+    std::atomic<int> running{0};
+    int max_running = 0;
+    auto scan_result = storage_backend.ScanMeta(
+        [&](const std::vector<std::string>& keys,
+            std::vector<StorageObjectMetadata>& metadatas) {
+            EXPECT_EQ(keys.size(), metadatas.size());
+            ++running;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                max_running = std::max(max_running, running.load());
+                for (const auto& key : keys) {
+                    EXPECT_TRUE(scanned.insert(key).second) << key;
+                }
+            }
+            --running;
+            return ErrorCode::OK;
+        });
+    ASSERT_TRUE(scan_result.has_value());
+    EXPECT_EQ(scanned.size(), static_cast<size_t>(kBuckets * 2));
+    EXPECT_GT(max_running, 1);
+
+    // A failing handler fails the scan
+    BucketStorageBackend failing_backend(config, bucket_config);
+    ASSERT_TRUE(failing_backend.Init());
+    auto failing_result = failing_backend.ScanMeta(
+        [](const std::vector<std::string>&,
+           std::vector<StorageObjectMetadata>&) {
+            return ErrorCode::INTERNAL_ERROR;
+        });
+    ASSERT_FALSE(failing_result.has_value());
+    EXPECT_EQ(failing_result.error(), ErrorCode::INTERNAL_ERROR);
+}
+
+//-----------------------------------------------------------------------------
+
+TEST_F(StorageBackendTest, BucketStorageBackend_KeyFilterAcrossRestart) {
+    FileStorageConfig config;
+    config.storage_filepath = data_path;
+    config.total_keys_limit = 1000;
+    BucketBackendConfig bucket_config;
+    bucket_config.compaction_interval_seconds = 0;
+
+    std::string value = "key_filter_value";
+    {
+        BucketStorageBackend storage_backend(config, bucket_config);
+        ASSERT_TRUE(storage_backend.Init());
+        std::unordered_map<std::string, std::vector<Slice>> batch;
+        for (int i = 0; i < 100; ++i) {
+            batch.emplace("filter_key_" + std::to_string(i),
+                          std::vector<Slice>{
+                              Slice{value.data(), value.size()}});
+        }
+        ASSERT_TRUE(storage_backend.BatchOffload(batch, nullptr));
+        EXPECT_FALSE(storage_backend.IsExist("filter_missing").value());
+    }
+
+    // The filter is rebuilt from the bucket metadata on Init
+    for (uint32_t bits_per_key : {10u, 0u}) {
+        config.key_filter_bits_per_key = bits_per_key;
+        BucketStorageBackend storage_backend(config, bucket_config);
+        ASSERT_TRUE(storage_backend.Init());
+        for (int i = 0; i < 100; ++i) {
+            auto is_exist =
+                storage_backend.IsExist("filter_key_" + std::to_string(i));
+            ASSERT_TRUE(is_exist.has_value());
+            EXPECT_TRUE(is_exist.value()) << i;
+        }
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_FALSE(
+                storage_backend.IsExist("filter_missing_" + std::to_string(i))
+                    .value());
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------
 
 }  // namespace mooncake::test
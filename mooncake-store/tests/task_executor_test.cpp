@@ -6,6 +6,7 @@
 #include "glog/logging.h"
 #include <ylt/struct_json/json_writer.h>
 #include <ylt/struct_json/json_reader.h>
+#include <ylt/struct_pack.hpp>
 #include <memory>
 #include <thread>
 #include <chrono>
@@ -147,19 +148,17 @@ TEST_F(TaskExecutorTest, TaskWithReplicaCopyPayload) {
     payload.key = "test_key";
     payload.targets = {"target1", "target2"};
 
-    struct_json::to_json(payload, task.payload);
+    task.payload = payload;
 
     EXPECT_EQ(task.id.first, test_id.first);
     EXPECT_EQ(task.id.second, test_id.second);
     EXPECT_EQ(task.type, TaskType::REPLICA_COPY);
     EXPECT_EQ(task.status, TaskStatus::PENDING);
-    EXPECT_FALSE(task.payload.empty());
 
-    // Verify we can deserialize
-    ReplicaCopyPayload deserialized;
-    struct_json::from_json(deserialized, task.payload);
-    EXPECT_EQ(deserialized.key, "test_key");
-    EXPECT_EQ(deserialized.targets.size(), 2);
+    const auto* stored = std::get_if<ReplicaCopyPayload>(&task.payload);
+    ASSERT_NE(stored, nullptr);
+    EXPECT_EQ(stored->key, "test_key");
+    EXPECT_EQ(stored->targets.size(), 2);
 }
 
 TEST_F(TaskExecutorTest, TaskWithReplicaMovePayload) {
@@ -173,18 +172,16 @@ TEST_F(TaskExecutorTest, TaskWithReplicaMovePayload) {
     payload.source = "source_segment";
     payload.target = "target_segment";
 
-    struct_json::to_json(payload, task.payload);
+    task.payload = payload;
 
     EXPECT_EQ(task.type, TaskType::REPLICA_MOVE);
     EXPECT_EQ(task.status, TaskStatus::PENDING);
-    EXPECT_FALSE(task.payload.empty());
 
-    // Verify we can deserialize
-    ReplicaMovePayload deserialized;
-    struct_json::from_json(deserialized, task.payload);
-    EXPECT_EQ(deserialized.key, "test_key");
-    EXPECT_EQ(deserialized.source, "source_segment");
-    EXPECT_EQ(deserialized.target, "target_segment");
+    const auto* stored = std::get_if<ReplicaMovePayload>(&task.payload);
+    ASSERT_NE(stored, nullptr);
+    EXPECT_EQ(stored->key, "test_key");
+    EXPECT_EQ(stored->source, "source_segment");
+    EXPECT_EQ(stored->target, "target_segment");
 }
 
 // Replica Descriptor Tests
@@ -227,16 +224,15 @@ TEST_F(TaskExecutorTest, ClientTaskStructure) {
     ReplicaCopyPayload payload;
     payload.key = "test_key";
     payload.targets = {"target1"};
-    struct_json::to_json(payload, assignment.payload);
+    assignment.payload = payload;
 
     EXPECT_EQ(assignment.type, TaskType::REPLICA_COPY);
-    EXPECT_FALSE(assignment.payload.empty());
 
-    // Verify we can deserialize
-    ReplicaCopyPayload deserialized;
-    struct_json::from_json(deserialized, assignment.payload);
-    EXPECT_EQ(deserialized.key, "test_key");
-    EXPECT_EQ(deserialized.targets.size(), 1);
+    const auto* stored =
+        std::get_if<ReplicaCopyPayload>(&assignment.payload);
+    ASSERT_NE(stored, nullptr);
+    EXPECT_EQ(stored->key, "test_key");
+    EXPECT_EQ(stored->targets.size(), 1);
 }
 
 TEST_F(TaskExecutorTest, TaskAssignmentToClientTaskConversion) {
@@ -247,19 +243,21 @@ TEST_F(TaskExecutorTest, TaskAssignmentToClientTaskConversion) {
     ReplicaCopyPayload payload;
     payload.key = "test_key";
     payload.targets = {"target1", "target2"};
-    struct_json::to_json(payload, assignment.payload);
+    assignment.payload = payload;
 
     // Simulate ClientTask construction (ClientTask is private, so we test the
     // pattern) In actual Client code: ClientTask client_task;
     // client_task.assignment = assignment; client_task.retry_count = 0;
     EXPECT_EQ(assignment.type, TaskType::REPLICA_COPY);
-    EXPECT_FALSE(assignment.payload.empty());
 
-    // Verify payload can be deserialized
-    ReplicaCopyPayload deserialized;
-    struct_json::from_json(deserialized, assignment.payload);
-    EXPECT_EQ(deserialized.key, "test_key");
-    EXPECT_EQ(deserialized.targets.size(), 2);
+    // The payload survives the round trip through the RPC encoding
+    auto buffer = struct_pack::serialize<std::string>(assignment);
+    auto decoded = struct_pack::deserialize<TaskAssignment>(buffer);
+    ASSERT_TRUE(decoded.has_value());
+    const auto* stored = std::get_if<ReplicaCopyPayload>(&decoded->payload);
+    ASSERT_NE(stored, nullptr);
+    EXPECT_EQ(stored->key, "test_key");
+    EXPECT_EQ(stored->targets.size(), 2);
 }
 
 // Copy/Move Method Parameter Validation Tests
@@ -456,25 +454,14 @@ TEST_F(TaskExecutorTest, TaskTypeHandling) {
     EXPECT_NE(invalid_type, TaskType::REPLICA_MOVE);
 }
 
-TEST_F(TaskExecutorTest, PayloadDeserializationErrorHandling) {
+TEST_F(TaskExecutorTest, PayloadTypeMismatchHandling) {
     TaskAssignment assignment;
     assignment.id = generate_uuid();
     assignment.type = TaskType::REPLICA_COPY;
-    assignment.payload = R"({"invalid": "json"})";  // Missing required fields
-
-    // This should be caught by exception handler in ExecuteTask
-    ReplicaCopyPayload payload;
-    bool exception_caught = false;
-    try {
-        struct_json::from_json(payload, assignment.payload);
-    } catch (const std::exception& e) {
-        exception_caught = true;
-    }
+    // A move payload on a copy task, rejected by StartReplicaTask
+    assignment.payload = ReplicaMovePayload{};
 
-    // struct_json does not throw, but field will be default
-    EXPECT_FALSE(exception_caught);
-    EXPECT_TRUE(payload.key.empty());
-    EXPECT_TRUE(payload.targets.empty());
+    EXPECT_EQ(std::get_if<ReplicaCopyPayload>(&assignment.payload), nullptr);
 }
 
 // Multiple Target Segments Handling Tests
@@ -0,0 +1,73 @@
+#include "timing_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mooncake::test {
+
+TEST(TimingWheelTest, ExpiresKeysOnTheirTick) {
+    TimingWheel wheel(1000);
+    std::mt19937_64 rng(42);
+    // Deadlines in every level
+    std::map<std::string, uint64_t> deadlines;
+    for (int i = 0; i < 2000; ++i) {
+        const uint64_t range = uint64_t{1} << (i % 21);
+        const uint64_t tick = 1000 + 1 + rng() % range;
+        deadlines["key" + std::to_string(i)] = tick;
+        wheel.Schedule("key" + std::to_string(i), tick);
+    }
+    EXPECT_EQ(wheel.size(), deadlines.size());
+
+    std::vector<std::string> expired;
+    uint64_t tick = 1000;
+    size_t seen = 0;
+    while (wheel.size() > 0) {
+        // Big and small steps
+        const uint64_t last_tick = tick;
+        tick += 1 + rng() % 5000;
+        wheel.Advance(tick, expired);
+        for (; seen < expired.size(); ++seen) {
+            const uint64_t deadline = deadlines.at(expired[seen]);
+            EXPECT_LE(deadline, tick) << expired[seen];
+            EXPECT_GT(deadline, last_tick) << expired[seen];
+        }
+    }
+    EXPECT_EQ(expired.size(), deadlines.size());
+}
+
+TEST(TimingWheelTest, ExactTicksAndPastDeadlines) {
+    TimingWheel wheel(10);
+    wheel.Schedule("past", 3);
+    wheel.Schedule("at_64", 74);
+    wheel.Schedule("at_4096", 4106);
+    // Beyond the range of the top level
+    const uint64_t far = 10 + (uint64_t{1} << 24) + 100;
+    wheel.Schedule("far", far);
+
+    std::vector<std::string> expired;
+    wheel.Advance(11, expired);
+    EXPECT_EQ(expired, std::vector<std::string>{"past"});
+    wheel.Advance(73, expired);
+    EXPECT_EQ(expired.size(), 1u);
+    wheel.Advance(74, expired);
+    EXPECT_EQ(expired.back(), "at_64");
+    wheel.Advance(4105, expired);
+    EXPECT_EQ(expired.size(), 2u);
+    wheel.Advance(4106, expired);
+    EXPECT_EQ(expired.back(), "at_4096");
+    wheel.Advance(far - 1, expired);
+    EXPECT_EQ(expired.size(), 3u);
+    wheel.Advance(far, expired);
+    EXPECT_EQ(expired.back(), "far");
+    EXPECT_EQ(wheel.size(), 0u);
+
+    // An empty wheel jumps ahead at once
+    wheel.Advance(uint64_t{1} << 40, expired);
+    EXPECT_EQ(wheel.current_tick(), uint64_t{1} << 40);
+}
+
+}  // namespace mooncake::test
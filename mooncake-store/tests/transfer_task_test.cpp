@@ -69,6 +69,19 @@ TEST_F(TransferTaskTest, MemcpyOperationState) {
     EXPECT_EQ(state->get_result(), ErrorCode::OK);
 }
 
+// Local copies cannot be canceled, so a deadline that passed still waits
+TEST_F(TransferTaskTest, WaitUntilPastDeadlineWaitsForLocalCopies) {
+    auto state = std::make_shared<MemcpyOperationState>();
+    TransferFuture future(state);
+    std::thread completer([state] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        state->set_completed(ErrorCode::OK);
+    });
+    EXPECT_EQ(future.waitUntil(std::chrono::steady_clock::now()),
+              ErrorCode::OK);
+    completer.join();
+}
+
 // Test MemcpyWorkerPool basic functionality
 TEST_F(TransferTaskTest, MemcpyWorkerPoolBasic) {
     MemcpyWorkerPool pool;
@@ -144,11 +157,49 @@ TEST_F(TransferTaskTest, MemcpyWorkerPoolMultipleOperations) {
     }
 }
 
+// Test copies split into chunks and copied with streaming stores
+TEST_F(TransferTaskTest, MemcpyWorkerPoolLargeOperations) {
+    MemcpyWorkerPool pool;
+    EXPECT_GE(pool.groupCount(), 1);
+
+    // Larger than the default chunk size and non-temporal threshold, with
+    // unaligned ends
+    const size_t data_size = 20 * 1024 * 1024 + 13;
+    std::vector<char> src(data_size + 1);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<char>(i * 31 + 7);
+    }
+    std::vector<char> large_dest(data_size + 1, 0);
+    std::vector<char> small_dest(100, 0);
+
+    auto state = std::make_shared<MemcpyOperationState>();
+    std::vector<MemcpyOperation> operations;
+    operations.emplace_back(large_dest.data() + 1, src.data(), data_size);
+    operations.emplace_back(small_dest.data(), src.data() + 1,
+                            small_dest.size());
+    operations.emplace_back(small_dest.data(), src.data(), 0);
+    pool.submitTask(MemcpyTask(std::move(operations), state));
+    state->wait_for_completion();
+
+    EXPECT_EQ(state->get_result(), ErrorCode::OK);
+    EXPECT_EQ(large_dest[0], 0);
+    EXPECT_EQ(0, std::memcmp(large_dest.data() + 1, src.data(), data_size));
+    EXPECT_EQ(0, std::memcmp(small_dest.data(), src.data() + 1,
+                             small_dest.size()));
+
+    // A task without operations completes immediately
+    auto empty_state = std::make_shared<MemcpyOperationState>();
+    pool.submitTask(MemcpyTask({}, empty_state));
+    EXPECT_TRUE(empty_state->is_completed());
+    EXPECT_EQ(empty_state->get_result(), ErrorCode::OK);
+}
+
 // Test TransferStrategy enum and stream operator
 TEST_F(TransferTaskTest, TransferStrategyEnum) {
     // Test enum values
     EXPECT_EQ(static_cast<int>(TransferStrategy::LOCAL_MEMCPY), 0);
     EXPECT_EQ(static_cast<int>(TransferStrategy::TRANSFER_ENGINE), 1);
+    EXPECT_EQ(static_cast<int>(TransferStrategy::INTRA_NODE_COPY), 4);
 
     // Test stream operator
     std::ostringstream oss;
@@ -158,6 +209,10 @@ TEST_F(TransferTaskTest, TransferStrategyEnum) {
     oss.str("");
     oss << TransferStrategy::TRANSFER_ENGINE;
     EXPECT_EQ(oss.str(), "TRANSFER_ENGINE");
+
+    oss.str("");
+    oss << TransferStrategy::INTRA_NODE_COPY;
+    EXPECT_EQ(oss.str(), "INTRA_NODE_COPY");
 }
 
 }  // namespace mooncake
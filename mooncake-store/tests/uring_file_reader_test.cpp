@@ -0,0 +1,116 @@
+#include "uring_file_reader.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+
+namespace mooncake {
+
+class UringFileReaderTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        google::InitGoogleLogging("UringFileReaderTest");
+        FLAGS_logtostderr = 1;
+
+        reader_ = UringFileReader::Create(8);
+        if (!reader_) {
+            GTEST_SKIP() << "io_uring is not available";
+        }
+
+        // Spans several pieces and ends off a block boundary
+        data_.resize(3 * 1024 * 1024 + 4096 + 123);
+        for (size_t i = 0; i < data_.size(); ++i) {
+            data_[i] = static_cast<char>(i * 131 + 17);
+        }
+        std::ofstream out(test_filename_, std::ios::binary);
+        out.write(data_.data(), data_.size());
+    }
+
+    void TearDown() override {
+        reader_.reset();
+        std::remove(test_filename_.c_str());
+        google::ShutdownGoogleLogging();
+    }
+
+    ErrorCode ReadSync(const std::string& path, std::vector<Slice> slices,
+                       size_t length) {
+        std::promise<ErrorCode> promise;
+        reader_->Read(path, std::move(slices), length,
+                      [&promise](ErrorCode rc) { promise.set_value(rc); });
+        return promise.get_future().get();
+    }
+
+    const std::string test_filename_ = "uring_file_reader_test.bin";
+    std::vector<char> data_;
+    std::unique_ptr<UringFileReader> reader_;
+};
+
+TEST_F(UringFileReaderTest, ReadAlignedAndUnalignedSlices) {
+    // An aligned buffer exercises O_DIRECT, an offset one the page cache
+    const size_t first = 1024 * 1024 + 4096;
+    void* aligned = std::aligned_alloc(4096, first);
+    ASSERT_NE(aligned, nullptr);
+    std::vector<char> rest(data_.size() - first + 1);
+
+    ErrorCode rc = ReadSync(test_filename_,
+                            {Slice{aligned, first},
+                             Slice{rest.data() + 1, data_.size() - first}},
+                            data_.size());
+    EXPECT_EQ(rc, ErrorCode::OK);
+    EXPECT_EQ(0, std::memcmp(aligned, data_.data(), first));
+    EXPECT_EQ(0, std::memcmp(rest.data() + 1, data_.data() + first,
+                             data_.size() - first));
+    std::free(aligned);
+}
+
+TEST_F(UringFileReaderTest, SkipNullSlices) {
+    std::vector<char> tail(100);
+    const size_t skipped = data_.size() - tail.size();
+    ErrorCode rc = ReadSync(
+        test_filename_,
+        {Slice{nullptr, skipped}, Slice{tail.data(), tail.size()}},
+        data_.size());
+    EXPECT_EQ(rc, ErrorCode::OK);
+    EXPECT_EQ(0, std::memcmp(tail.data(), data_.data() + skipped,
+                             tail.size()));
+}
+
+TEST_F(UringFileReaderTest, ConcurrentReads) {
+    const size_t num_reads = 32;
+    std::vector<std::vector<char>> buffers(num_reads,
+                                           std::vector<char>(data_.size()));
+    std::vector<std::promise<ErrorCode>> promises(num_reads);
+    for (size_t i = 0; i < num_reads; ++i) {
+        reader_->Read(test_filename_,
+                      {Slice{buffers[i].data(), buffers[i].size()}},
+                      data_.size(),
+                      [&promises, i](ErrorCode rc) {
+                          promises[i].set_value(rc);
+                      });
+    }
+    for (size_t i = 0; i < num_reads; ++i) {
+        EXPECT_EQ(promises[i].get_future().get(), ErrorCode::OK);
+        EXPECT_EQ(buffers[i], data_);
+    }
+}
+
+TEST_F(UringFileReaderTest, Errors) {
+    std::vector<char> buffer(data_.size() + 10);
+    // Missing file
+    EXPECT_EQ(ReadSync("uring_file_reader_test.missing",
+                       {Slice{buffer.data(), 10}}, 10),
+              ErrorCode::FILE_OPEN_FAIL);
+    // Slices do not add up to the length
+    EXPECT_EQ(ReadSync(test_filename_, {Slice{buffer.data(), 10}}, 20),
+              ErrorCode::FILE_READ_FAIL);
+    // Past the end of the file
+    EXPECT_EQ(ReadSync(test_filename_, {Slice{buffer.data(), buffer.size()}},
+                       buffer.size()),
+              ErrorCode::FILE_READ_FAIL);
+}
+
+}  // namespace mooncake
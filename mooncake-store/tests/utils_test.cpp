@@ -132,6 +132,23 @@ TEST(UtilsTest, SplitStringBasic) {
     EXPECT_EQ(tokens[3], "d");
 }
 
+TEST(UtilsTest, GetRegexLiteralPrefix) {
+    EXPECT_EQ("model/", GetRegexLiteralPrefix("^model/"));
+    EXPECT_EQ("model/layer", GetRegexLiteralPrefix("^model/layer\\d+"));
+    EXPECT_EQ("a.b", GetRegexLiteralPrefix("^a\\.b.*"));
+    EXPECT_EQ("ab", GetRegexLiteralPrefix("^abc?"));
+    EXPECT_EQ("abc", GetRegexLiteralPrefix("^abc+"));
+    EXPECT_EQ("ab", GetRegexLiteralPrefix("^abc{0,2}"));
+    EXPECT_EQ("ab", GetRegexLiteralPrefix("^ab(c|d)"));
+
+    EXPECT_EQ(std::nullopt, GetRegexLiteralPrefix("model/"));
+    EXPECT_EQ(std::nullopt, GetRegexLiteralPrefix("^"));
+    EXPECT_EQ(std::nullopt, GetRegexLiteralPrefix("^a*"));
+    EXPECT_EQ(std::nullopt, GetRegexLiteralPrefix("^.*"));
+    EXPECT_EQ(std::nullopt, GetRegexLiteralPrefix("^\\w+"));
+    EXPECT_EQ(std::nullopt, GetRegexLiteralPrefix("^a|^b"));
+}
+
 TEST(UtilsTest, AutoPortBinderRAII) {
     // Test RAII behavior - port should be released when binder is destroyed
     int port;
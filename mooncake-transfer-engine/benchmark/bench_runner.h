@@ -52,12 +52,17 @@ class BenchRunner {
     virtual uint64_t getLocalBufferBase(int thread_id, uint64_t block_size,
                                         uint64_t batch_size) const = 0;
 
-    virtual uint64_t getTargetBufferBase(int thread_id, uint64_t block_size,
+    // Number of targets opened by startInitiator
+    virtual size_t numTargets() const = 0;
+
+    virtual uint64_t getTargetBufferBase(size_t target, int thread_id,
+                                         uint64_t block_size,
                                          uint64_t batch_size) const = 0;
 
-    virtual double runSingleTransfer(uint64_t local_addr, uint64_t target_addr,
-                                     uint64_t block_size, uint64_t batch_size,
-                                     OpCode opcode) = 0;
+    // Submits requests as one batch and waits for all of them, returning
+    // the latency in microseconds
+    virtual double runSingleTransfer(
+        const std::vector<XferBenchRequest>& requests, OpCode opcode) = 0;
 };
 
 }  // namespace tent
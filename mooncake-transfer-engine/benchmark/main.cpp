@@ -14,14 +14,35 @@
 
 #include "utils.h"
 
+#include <random>
+
 #include "bench_runner.h"
 #include "te_backend.h"
 #include "tent_backend.h"
 
 using namespace mooncake::tent;
 
-int processBatchSizes(BenchRunner& runner, size_t block_size, size_t batch_size,
-                      int num_threads) {
+// Largest request any case of the sweep issues, which is the distance
+// between the slots of a batch and sizes the buffer region of each thread
+static size_t maxRequestSize() {
+    size_t max_size = XferBenchConfig::max_block_size;
+    for (auto size : XferBenchConfig::block_sizes)
+        max_size = std::max(max_size, size);
+    for (auto& entry : XferBenchConfig::size_mix)
+        max_size = std::max(max_size, entry.first);
+    return max_size;
+}
+
+// Distance between the requests of a batch in bench_case
+static size_t slotSize(const XferBenchCase& bench_case) {
+    if (bench_case.block_size) return bench_case.block_size;
+    size_t max_size = 0;
+    for (auto& entry : XferBenchConfig::size_mix)
+        max_size = std::max(max_size, entry.first);
+    return max_size;
+}
+
+int processBatchSizes(BenchRunner& runner, const XferBenchCase& bench_case) {
     bool mixed_opcode = false;
     OpCode opcode = READ;
     if (XferBenchConfig::check_consistency || XferBenchConfig::op_type == "mix")
@@ -35,62 +56,101 @@ int processBatchSizes(BenchRunner& runner, size_t block_size, size_t batch_size,
         exit(EXIT_FAILURE);
     }
 
+    const size_t batch_size = bench_case.batch_size;
+    const size_t slot_size = slotSize(bench_case);
+    const size_t num_targets = runner.numTargets();
     XferBenchStats stats;
     std::mutex mutex;
     int rc = runner.runInitiatorTasks([&](int thread_id) -> int {
         runner.pinThread(thread_id);
-        auto max_block_size = XferBenchConfig::max_block_size;
+        auto max_block_size = maxRequestSize();
         auto max_batch_size = XferBenchConfig::max_batch_size;
         auto local_gpu_offset = std::max(0, XferBenchConfig::local_gpu_id);
         auto target_gpu_offset = std::max(0, XferBenchConfig::target_gpu_id);
         uint64_t local_addr = runner.getLocalBufferBase(
             local_gpu_offset + thread_id, max_block_size, max_batch_size);
-        uint64_t target_addr = runner.getTargetBufferBase(
-            target_gpu_offset + thread_id, max_block_size, max_batch_size);
+        std::vector<uint64_t> target_addrs;
+        for (size_t target = 0; target < num_targets; ++target)
+            target_addrs.push_back(runner.getTargetBufferBase(
+                target, target_gpu_offset + thread_id, max_block_size,
+                max_batch_size));
 
+        // Request i of a batch goes to target i % num_targets, so every
+        // batch fans out over all targets
+        std::vector<XferBenchRequest> requests(batch_size);
+        for (size_t i = 0; i < batch_size; ++i) {
+            auto target = i % num_targets;
+            requests[i] = {local_addr + slot_size * i, target,
+                           target_addrs[target] + slot_size * i,
+                           bench_case.block_size};
+        }
+        std::mt19937_64 rng(std::random_device{}() + thread_id);
+        std::vector<double> weights;
+        for (auto& entry : XferBenchConfig::size_mix)
+            weights.push_back(entry.second);
+        std::discrete_distribution<size_t> size_dist(weights.begin(),
+                                                     weights.end());
+        std::bernoulli_distribution read_dist(XferBenchConfig::read_ratio);
+        uint64_t total_bytes = 0;
+        auto nextBatch = [&]() {
+            if (bench_case.block_size == 0) {
+                for (auto& request : requests)
+                    request.length =
+                        XferBenchConfig::size_mix[size_dist(rng)].first;
+            }
+            uint64_t bytes = 0;
+            for (auto& request : requests) bytes += request.length;
+            return bytes;
+        };
+
+        nextBatch();
         XferBenchTimer timer;
         while (timer.lap_us(false) < 1000000ull) {
-            runner.runSingleTransfer(local_addr, target_addr, block_size,
-                                     batch_size, opcode);
+            runner.runSingleTransfer(requests, opcode);
         }
         timer.reset();
-        std::vector<double> transfer_duration;
-        if (mixed_opcode) {
+        XferLatencyHistogram transfer_duration;
+        if (XferBenchConfig::check_consistency) {
+            std::vector<uint8_t> patterns(batch_size);
             while (timer.lap_us(false) <
                    XferBenchConfig::duration * 1000000ull) {
-                uint8_t pattern = 0;
-                if (XferBenchConfig::check_consistency)
-                    pattern =
-                        fillData((void*)local_addr, block_size * batch_size);
-                auto val = runner.runSingleTransfer(
-                    local_addr, target_addr, block_size, batch_size, WRITE);
-                transfer_duration.push_back(val);
-                fillData((void*)local_addr, block_size * batch_size);
-                val = runner.runSingleTransfer(local_addr, target_addr,
-                                               block_size, batch_size, READ);
-                if (XferBenchConfig::check_consistency)
-                    verifyData((void*)local_addr, block_size * batch_size,
-                               pattern);
-                transfer_duration.push_back(val);
+                auto bytes = nextBatch();
+                for (size_t i = 0; i < batch_size; ++i)
+                    patterns[i] = fillData((void*)requests[i].local_addr,
+                                           requests[i].length);
+                auto val = runner.runSingleTransfer(requests, WRITE);
+                transfer_duration.add(val);
+                for (auto& request : requests)
+                    fillData((void*)request.local_addr, request.length);
+                val = runner.runSingleTransfer(requests, READ);
+                for (size_t i = 0; i < batch_size; ++i)
+                    verifyData((void*)requests[i].local_addr,
+                               requests[i].length, patterns[i]);
+                transfer_duration.add(val);
+                total_bytes += 2 * bytes;
             }
         } else {
             while (timer.lap_us(false) <
                    XferBenchConfig::duration * 1000000ull) {
-                auto val = runner.runSingleTransfer(
-                    local_addr, target_addr, block_size, batch_size, opcode);
-                transfer_duration.push_back(val);
+                auto bytes = nextBatch();
+                auto batch_opcode = opcode;
+                if (mixed_opcode) batch_opcode = read_dist(rng) ? READ : WRITE;
+                auto val = runner.runSingleTransfer(requests, batch_opcode);
+                transfer_duration.add(val);
+                total_bytes += bytes;
             }
         }
         auto total_duration = timer.lap_us();
         mutex.lock();
         stats.total_duration.add(total_duration);
-        for (auto val : transfer_duration) stats.transfer_duration.add(val);
+        stats.transfer_duration.merge(transfer_duration);
+        stats.total_bytes += total_bytes;
         mutex.unlock();
         return 0;
     });
 
     if (rc != 0) return -1;
-    printStats(block_size, batch_size, stats, num_threads);
+    printStats(bench_case, stats);
     return 0;
 }
 
@@ -105,7 +165,7 @@ int main(int argc, char* argv[]) {
         runner = std::make_unique<TEBenchRunner>();
     else
         runner = std::make_unique<TENTBenchRunner>();
-    if (XferBenchConfig::target_seg_name.empty()) {
+    if (XferBenchConfig::target_seg_names.empty()) {
         std::cout << "\033[33mTo start initiators, run " << std::endl
                   << "  ./tebench --target_seg_name="
                   << runner->getSegmentName()
@@ -114,25 +174,36 @@ int main(int argc, char* argv[]) {
                   << "Press Ctrl-C to terminate\033[0m" << std::endl;
         return runner->runTarget();
     }
+
+    // Block sizes of the sweep, 0 standing for requests drawn from size_mix
+    std::vector<size_t> block_sizes;
+    if (!XferBenchConfig::size_mix.empty())
+        block_sizes.push_back(0);
+    else if (!XferBenchConfig::block_sizes.empty())
+        block_sizes = XferBenchConfig::block_sizes;
+    else
+        for (size_t block_size = XferBenchConfig::start_block_size;
+             block_size <= XferBenchConfig::max_block_size; block_size *= 2)
+            block_sizes.push_back(block_size);
+
     printStatsHeader();
     bool interrupted = false;
     for (int num_threads = XferBenchConfig::start_num_threads;
          !interrupted && num_threads <= XferBenchConfig::max_num_threads;
          num_threads *= 2) {
         runner->startInitiator(num_threads);
-        for (size_t block_size = XferBenchConfig::start_block_size;
-             !interrupted && block_size <= XferBenchConfig::max_block_size;
-             block_size *= 2) {
+        for (size_t i = 0; !interrupted && i < block_sizes.size(); ++i) {
             for (size_t batch_size = XferBenchConfig::start_batch_size;
                  !interrupted && batch_size <= XferBenchConfig::max_batch_size;
                  batch_size *= 2) {
-                if (block_size * batch_size * num_threads >
+                XferBenchCase bench_case{block_sizes[i], batch_size,
+                                         num_threads};
+                if (slotSize(bench_case) * batch_size * num_threads >
                     XferBenchConfig::total_buffer_size) {
-                    LOG(INFO) << "Skipped for block_size " << block_size
+                    LOG(INFO) << "Skipped for block_size " << block_sizes[i]
                               << " batch_size " << batch_size;
                 } else {
-                    if (processBatchSizes(*runner, block_size, batch_size,
-                                          num_threads) != 0)
+                    if (processBatchSizes(*runner, bench_case) != 0)
                         interrupted = true;
                 }
             }
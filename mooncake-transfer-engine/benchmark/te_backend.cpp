@@ -186,12 +186,19 @@ int TEBenchRunner::runTarget() {
 }
 
 int TEBenchRunner::startInitiator(int num_threads) {
-    handle_ = engine_->openSegment(XferBenchConfig::target_seg_name);
-    info_ = engine_->getMetadata()->getSegmentDescByID(handle_);
-    std::sort(
-        info_->buffers.begin(), info_->buffers.end(),
-        [](const TransferMetadata::BufferDesc& a,
-           const TransferMetadata::BufferDesc& b) { return a.name < b.name; });
+    handles_.clear();
+    infos_.clear();
+    for (const auto& seg_name : XferBenchConfig::target_seg_names) {
+        auto handle = engine_->openSegment(seg_name);
+        auto info = engine_->getMetadata()->getSegmentDescByID(handle);
+        std::sort(info->buffers.begin(), info->buffers.end(),
+                  [](const TransferMetadata::BufferDesc& a,
+                     const TransferMetadata::BufferDesc& b) {
+                      return a.name < b.name;
+                  });
+        handles_.push_back(handle);
+        infos_.push_back(info);
+    }
     threads_.resize(num_threads);
     g_te_running = true;
     current_task_.resize(threads_.size());
@@ -265,24 +272,23 @@ int TEBenchRunner::runInitiatorTasks(
     return g_te_running ? 0 : -1;
 }
 
-double TEBenchRunner::runSingleTransfer(uint64_t local_addr,
-                                        uint64_t target_addr,
-                                        uint64_t block_size,
-                                        uint64_t batch_size, OpCode opcode) {
+double TEBenchRunner::runSingleTransfer(
+    const std::vector<XferBenchRequest>& requests, OpCode opcode) {
+    const uint64_t batch_size = requests.size();
     auto batch_id = engine_->allocateBatchID(batch_size);
-    std::vector<TransferRequest> requests;
-    for (uint64_t i = 0; i < batch_size; ++i) {
+    std::vector<TransferRequest> entries;
+    for (const auto& request : requests) {
         TransferRequest entry;
         entry.opcode =
             opcode == READ ? TransferRequest::READ : TransferRequest::WRITE;
-        entry.length = block_size;
-        entry.source = (void*)(local_addr + block_size * i);
-        entry.target_id = handle_;
-        entry.target_offset = target_addr + block_size * i;
-        requests.emplace_back(entry);
+        entry.length = request.length;
+        entry.source = (void*)request.local_addr;
+        entry.target_id = handles_[request.target];
+        entry.target_offset = request.target_addr;
+        entries.emplace_back(entry);
     }
     XferBenchTimer timer;
-    CHECK_FAIL(engine_->submitTransfer(batch_id, requests));
+    CHECK_FAIL(engine_->submitTransfer(batch_id, entries));
     while (true) {
         uint64_t success_count = 0;
         for (uint64_t i = 0; i < batch_size; ++i) {
@@ -61,14 +61,17 @@ class TEBenchRunner : public BenchRunner {
                block_size * batch_size * (thread_id / num_buffers);
     }
 
-    uint64_t getTargetBufferBase(int thread_id, uint64_t block_size,
+    size_t numTargets() const { return handles_.size(); }
+
+    uint64_t getTargetBufferBase(size_t target, int thread_id,
+                                 uint64_t block_size,
                                  uint64_t batch_size) const {
-        return info_->buffers[thread_id % info_->buffers.size()].addr +
-               block_size * batch_size * (thread_id / info_->buffers.size());
+        const auto& info = *infos_[target];
+        return info->buffers[thread_id % info->buffers.size()].addr +
+               block_size * batch_size * (thread_id / info->buffers.size());
     }
 
-    double runSingleTransfer(uint64_t local_addr, uint64_t target_addr,
-                             uint64_t block_size, uint64_t batch_size,
+    double runSingleTransfer(const std::vector<XferBenchRequest>& requests,
                              OpCode opcode);
 
    private:
@@ -81,8 +84,9 @@ class TEBenchRunner : public BenchRunner {
    private:
     std::unique_ptr<mooncake::TransferEngine> engine_;
     std::vector<void*> pinned_buffer_list_;
-    SegmentID handle_;
-    std::shared_ptr<TransferMetadata::SegmentDesc> info_;
+    // One entry per target in XferBenchConfig::target_seg_names
+    std::vector<SegmentID> handles_;
+    std::vector<std::shared_ptr<TransferMetadata::SegmentDesc>> infos_;
 
     std::vector<std::function<int(int)>> current_task_;
     std::vector<std::thread> threads_;
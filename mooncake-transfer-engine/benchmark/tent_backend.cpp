@@ -167,13 +167,21 @@ int TENTBenchRunner::runTarget() {
 }
 
 int TENTBenchRunner::startInitiator(int num_threads) {
-    CHECK_FAIL(engine_->openSegment(handle_, XferBenchConfig::target_seg_name));
-    info_.buffers.clear();
-    CHECK_FAIL(engine_->getSegmentInfo(handle_, info_));
-    std::sort(info_.buffers.begin(), info_.buffers.end(),
-              [](const SegmentInfo::Buffer& a, const SegmentInfo::Buffer& b) {
-                  return a.location < b.location;
-              });
+    handles_.clear();
+    infos_.clear();
+    for (const auto& seg_name : XferBenchConfig::target_seg_names) {
+        SegmentID handle;
+        SegmentInfo info;
+        CHECK_FAIL(engine_->openSegment(handle, seg_name));
+        CHECK_FAIL(engine_->getSegmentInfo(handle, info));
+        std::sort(
+            info.buffers.begin(), info.buffers.end(),
+            [](const SegmentInfo::Buffer& a, const SegmentInfo::Buffer& b) {
+                return a.location < b.location;
+            });
+        handles_.push_back(handle);
+        infos_.push_back(std::move(info));
+    }
     threads_.resize(num_threads);
     current_task_.resize(threads_.size());
     g_tent_running = true;
@@ -265,28 +273,27 @@ int TENTBenchRunner::runInitiatorTasks(
     return g_tent_running ? 0 : -1;
 }
 
-double TENTBenchRunner::runSingleTransfer(uint64_t local_addr,
-                                          uint64_t target_addr,
-                                          uint64_t block_size,
-                                          uint64_t batch_size, OpCode opcode) {
-    auto batch_id = engine_->allocateBatch(batch_size);
-    std::vector<Request> requests;
-    for (uint64_t i = 0; i < batch_size; ++i) {
+double TENTBenchRunner::runSingleTransfer(
+    const std::vector<XferBenchRequest>& requests, OpCode opcode) {
+    auto batch_id = engine_->allocateBatch(requests.size());
+    std::vector<Request> entries;
+    for (const auto& request : requests) {
         Request entry;
         entry.opcode = opcode == READ ? Request::READ : Request::WRITE;
-        entry.length = block_size;
-        entry.source = (void*)(local_addr + block_size * i);
-        entry.target_id = handle_;
-        entry.target_offset = target_addr + block_size * i;
-        requests.emplace_back(entry);
+        entry.length = request.length;
+        entry.source = (void*)request.local_addr;
+        entry.target_id = handles_[request.target];
+        entry.target_offset = request.target_addr;
+        entries.emplace_back(entry);
     }
     XferBenchTimer timer;
     if (XferBenchConfig::notifi) {
-        // Use target_addr as msg for verification by peer
-        Notification notifi{"benchmark", std::to_string(target_addr)};
-        CHECK_FAIL(engine_->submitTransfer(batch_id, requests, notifi));
+        // Use the first target_addr as msg for verification by peer
+        Notification notifi{"benchmark",
+                            std::to_string(requests[0].target_addr)};
+        CHECK_FAIL(engine_->submitTransfer(batch_id, entries, notifi));
     } else {
-        CHECK_FAIL(engine_->submitTransfer(batch_id, requests));
+        CHECK_FAIL(engine_->submitTransfer(batch_id, entries));
     }
     while (true) {
         TransferStatus overall_status;
@@ -15,19 +15,30 @@
 #include "utils.h"
 
 #include <gflags/gflags.h>
+#include <fstream>
 #include <iostream>
 
 DEFINE_string(seg_name, "", "Memory segment name for the local side");
 DEFINE_string(seg_type, "DRAM",
               "Memory segment type for the target side: DRAM|VRAM");
-DEFINE_string(target_seg_name, "", "Memory segment name for the target side");
+DEFINE_string(target_seg_name, "",
+              "Memory segment name for the target side. A comma-separated "
+              "list spreads the requests of every batch over the targets");
 DEFINE_string(op_type, "read", "Operation type to benchmark: read|write|mix");
+DEFINE_double(read_ratio, 0.5,
+              "Fraction of batches that are READ with --op_type=mix");
 DEFINE_bool(check_consistency, false,
             "Enable data consistency check after transfer.");
 DEFINE_uint64(total_buffer_size, 1UL << 30,
               "Total buffer size for testing (in bytes).");
 DEFINE_uint64(start_block_size, 4096, "Start block size (in bytes).");
 DEFINE_uint64(max_block_size, 1UL << 26, "Maximum block size (in bytes).");
+DEFINE_string(block_sizes, "",
+              "Comma-separated block sizes to sweep (in bytes), replacing "
+              "the powers of two from start_block_size to max_block_size");
+DEFINE_string(size_mix, "",
+              "Comma-separated size:weight pairs, e.g. 4096:3,65536:1. When "
+              "set, the size of every request is drawn from this mix");
 DEFINE_uint64(start_batch_size, 1, "Start batch size (number of requests).");
 DEFINE_uint64(max_batch_size, 1, "Maximum batch size (number of requests).");
 DEFINE_int32(duration, 5, "Number of duration per test case.");
@@ -48,18 +59,25 @@ DEFINE_string(xport_type, "", "Transport type: rdma|shm|mnnvl|gds|iouring");
 DEFINE_string(backend, "tent", "Transport backend: classic|tent");
 DEFINE_bool(notifi, false,
             "Enable RDMA notification for performance measurement.");
+DEFINE_string(output_format, "table",
+              "Format of the results: table|csv|json (one object per line)");
+DEFINE_string(output_file, "", "File to write the results to, or stdout");
 
 namespace mooncake {
 namespace tent {
 std::string XferBenchConfig::seg_name;
 std::string XferBenchConfig::seg_type;
 std::string XferBenchConfig::target_seg_name;
+std::vector<std::string> XferBenchConfig::target_seg_names;
 std::string XferBenchConfig::op_type;
+double XferBenchConfig::read_ratio = 0.5;
 bool XferBenchConfig::check_consistency = false;
 
 size_t XferBenchConfig::total_buffer_size = 0;
 size_t XferBenchConfig::start_block_size = 0;
 size_t XferBenchConfig::max_block_size = 0;
+std::vector<size_t> XferBenchConfig::block_sizes;
+std::vector<std::pair<size_t, double>> XferBenchConfig::size_mix;
 size_t XferBenchConfig::start_batch_size = 0;
 size_t XferBenchConfig::max_batch_size = 0;
 int XferBenchConfig::duration = 0;
@@ -76,16 +94,46 @@ bool XferBenchConfig::notifi = false;
 int XferBenchConfig::local_gpu_id = 0;
 int XferBenchConfig::target_gpu_id = 0;
 
+std::string XferBenchConfig::output_format;
+std::string XferBenchConfig::output_file;
+
+static std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
 void XferBenchConfig::loadFromFlags() {
     seg_type = FLAGS_seg_type;
     seg_name = FLAGS_seg_name;
     target_seg_name = FLAGS_target_seg_name;
+    target_seg_names = splitList(FLAGS_target_seg_name);
     op_type = FLAGS_op_type;
+    read_ratio = FLAGS_read_ratio;
     check_consistency = FLAGS_check_consistency;
 
     total_buffer_size = FLAGS_total_buffer_size;
     start_block_size = FLAGS_start_block_size;
     max_block_size = FLAGS_max_block_size;
+    block_sizes.clear();
+    for (const auto& item : splitList(FLAGS_block_sizes))
+        block_sizes.push_back(std::stoull(item));
+    size_mix.clear();
+    for (const auto& item : splitList(FLAGS_size_mix)) {
+        auto pos = item.find(':');
+        size_t size = std::stoull(item.substr(0, pos));
+        double weight =
+            pos == std::string::npos ? 1.0 : std::stod(item.substr(pos + 1));
+        if (size == 0 || weight <= 0) {
+            LOG(ERROR) << "Invalid args: bad size_mix entry " << item;
+            exit(EXIT_FAILURE);
+        }
+        size_mix.emplace_back(size, weight);
+    }
     start_batch_size = FLAGS_start_batch_size;
     max_batch_size = FLAGS_max_batch_size;
     start_num_threads = FLAGS_start_num_threads;
@@ -102,6 +150,14 @@ void XferBenchConfig::loadFromFlags() {
 
     local_gpu_id = FLAGS_local_gpu_id;
     target_gpu_id = FLAGS_target_gpu_id;
+
+    output_format = FLAGS_output_format;
+    output_file = FLAGS_output_file;
+    if (output_format != "table" && output_format != "csv" &&
+        output_format != "json") {
+        LOG(ERROR) << "Invalid args: output_format only support table|csv|json";
+        exit(EXIT_FAILURE);
+    }
 }
 
 double XferMetricStats::percentile(double p) {
@@ -120,44 +176,122 @@ double XferMetricStats::percentile(double p) {
     }
 }
 
+static std::ostream& output() {
+    static std::ofstream file;
+    if (XferBenchConfig::output_file.empty()) return std::cout;
+    if (!file.is_open()) {
+        file.open(XferBenchConfig::output_file);
+        if (!file) {
+            LOG(ERROR) << "Cannot open output_file "
+                       << XferBenchConfig::output_file;
+            exit(EXIT_FAILURE);
+        }
+    }
+    return file;
+}
+
 void printStatsHeader() {
+    auto& out = output();
+    if (XferBenchConfig::output_format == "csv") {
+        out << "backend,xport_type,op_type,read_ratio,num_targets,"
+               "num_threads,block_size,batch_size,ops,bytes,bw_gbps,"
+               "avg_lat_us,avg_tx_us,p50_tx_us,p90_tx_us,p99_tx_us,"
+               "p999_tx_us,max_tx_us"
+            << std::endl;
+        return;
+    }
+    if (XferBenchConfig::output_format == "json") return;
     // clang-format off
-    std::cout << std::left
-              << std::setw(14) << "BlkSize (B)"
-              << std::setw(8) << "Batch"
-              << std::setw(14) << "BW (GB/S)"
-              << std::setw(14) << "Avg Lat (us)"
-              << std::setw(14) << "Avg Tx (us)"
-              << std::setw(14) << "P99 Tx (us)"
-              << std::setw(14) << "P999 Tx (us)"
-              << std::endl;
-    std::cout << std::string(160, '-') << std::endl;
+    out << std::left
+        << std::setw(14) << "BlkSize (B)"
+        << std::setw(8) << "Batch"
+        << std::setw(9) << "Threads"
+        << std::setw(14) << "BW (GB/S)"
+        << std::setw(14) << "Avg Lat (us)"
+        << std::setw(14) << "Avg Tx (us)"
+        << std::setw(14) << "P50 Tx (us)"
+        << std::setw(14) << "P90 Tx (us)"
+        << std::setw(14) << "P99 Tx (us)"
+        << std::setw(14) << "P999 Tx (us)"
+        << std::endl;
+    out << std::string(160, '-') << std::endl;
     // clang-format on
 }
 
-void printStats(size_t block_size, size_t batch_size, XferBenchStats& stats,
-                int num_threads) {
-    size_t total_data_transferred = 0;
-    double avg_latency = 0, throughput_gb = 0;
-    auto num_ops = stats.transfer_duration.count();
+void printStats(const XferBenchCase& bench_case, XferBenchStats& stats) {
+    const auto& latency = stats.transfer_duration;
+    auto num_ops = latency.count();
     double total_duration = stats.total_duration.avg();
-    total_data_transferred = ((block_size * batch_size) * num_ops);
-    avg_latency = (total_duration * num_threads / num_ops);
-    throughput_gb = (((double)total_data_transferred / (1000 * 1000 * 1000)) /
-                     (total_duration / 1e6));  // In GB/Sec
+    double avg_latency =
+        num_ops ? total_duration * bench_case.num_threads / num_ops : 0;
+    double throughput_gb = (((double)stats.total_bytes / (1000 * 1000 * 1000)) /
+                            (total_duration / 1e6));  // In GB/Sec
+    // 0 stands for the requests drawn from size_mix
+    std::string block_size = bench_case.block_size
+                                 ? std::to_string(bench_case.block_size)
+                                 : std::string("mix");
+
+    auto& out = output();
+    if (XferBenchConfig::output_format == "csv" ||
+        XferBenchConfig::output_format == "json") {
+        const bool csv = XferBenchConfig::output_format == "csv";
+        std::vector<std::pair<std::string, std::string>> fields = {
+            {"backend", XferBenchConfig::backend},
+            {"xport_type", XferBenchConfig::xport_type},
+            {"op_type", XferBenchConfig::op_type},
+            {"read_ratio", std::to_string(XferBenchConfig::read_ratio)},
+            {"num_targets",
+             std::to_string(XferBenchConfig::target_seg_names.size())},
+            {"num_threads", std::to_string(bench_case.num_threads)},
+            {"block_size", block_size},
+            {"batch_size", std::to_string(bench_case.batch_size)},
+            {"ops", std::to_string(num_ops)},
+            {"bytes", std::to_string(stats.total_bytes)},
+            {"bw_gbps", std::to_string(throughput_gb)},
+            {"avg_lat_us", std::to_string(avg_latency)},
+            {"avg_tx_us", std::to_string(latency.avg())},
+            {"p50_tx_us", std::to_string(latency.percentile(50))},
+            {"p90_tx_us", std::to_string(latency.percentile(90))},
+            {"p99_tx_us", std::to_string(latency.percentile(99))},
+            {"p999_tx_us", std::to_string(latency.percentile(99.9))},
+            {"max_tx_us", std::to_string(latency.max())}};
+        // Only the first fields and block_size ("mix") are not numbers
+        const size_t num_string_fields = 3;
+        out << (csv ? "" : "{");
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i) out << ",";
+            const bool quoted = i < num_string_fields ||
+                                (fields[i].first == "block_size" &&
+                                 bench_case.block_size == 0);
+            if (csv) {
+                out << fields[i].second;
+            } else {
+                out << "\"" << fields[i].first << "\":";
+                if (quoted)
+                    out << "\"" << fields[i].second << "\"";
+                else
+                    out << fields[i].second;
+            }
+        }
+        out << (csv ? "" : "}") << std::endl;
+        return;
+    }
 
     // Tabulate print with fixed width for each string
     // clang-format off
-    std::cout << std::left << std::fixed << std::setprecision(6)
-              << std::setw(14) << block_size
-              << std::setw(8)  << batch_size
-              << std::setw(14) << throughput_gb
-              << std::setprecision(1)
-              << std::setw(14) << avg_latency
-              << std::setw(14) << stats.transfer_duration.avg()
-              << std::setw(14) << stats.transfer_duration.p99()
-              << std::setw(14) << stats.transfer_duration.p999()
-              << std::endl;
+    out << std::left << std::fixed << std::setprecision(6)
+        << std::setw(14) << block_size
+        << std::setw(8)  << bench_case.batch_size
+        << std::setw(9)  << bench_case.num_threads
+        << std::setw(14) << throughput_gb
+        << std::setprecision(1)
+        << std::setw(14) << avg_latency
+        << std::setw(14) << latency.avg()
+        << std::setw(14) << latency.percentile(50)
+        << std::setw(14) << latency.percentile(90)
+        << std::setw(14) << latency.percentile(99)
+        << std::setw(14) << latency.percentile(99.9)
+        << std::endl;
     // clang-format on
 }
 
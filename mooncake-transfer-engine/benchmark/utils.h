@@ -51,12 +51,19 @@ struct XferBenchConfig {
     static std::string seg_name;
     static std::string seg_type;
     static std::string target_seg_name;
+    // target_seg_name split at commas, one entry per target
+    static std::vector<std::string> target_seg_names;
     static std::string op_type;
+    static double read_ratio;
     static bool check_consistency;
 
     static size_t total_buffer_size;
     static size_t start_block_size;
     static size_t max_block_size;
+    // Block sizes to sweep instead of the powers of two from start to max
+    static std::vector<size_t> block_sizes;
+    // (size, weight) pairs request sizes are drawn from, if not empty
+    static std::vector<std::pair<size_t, double>> size_mix;
     static size_t start_batch_size;
     static size_t max_batch_size;
     static int duration;
@@ -72,6 +79,9 @@ struct XferBenchConfig {
 
     static int local_gpu_id;
     static int target_gpu_id;
+
+    static std::string output_format;
+    static std::string output_file;
 };
 
 struct XferMetricStats {
@@ -113,9 +123,94 @@ struct XferMetricStats {
     std::vector<double> samples;
 };
 
+// Latency histogram with HdrHistogram-style log-linear buckets: values
+// below 2 * kSubBuckets are exact, and larger ones land in one of
+// kSubBuckets sub-buckets of their power of two, so a percentile is off by
+// at most 1/kSubBuckets of its value. Memory stays constant however many
+// samples are recorded, and histograms of several threads merge exactly.
+class XferLatencyHistogram {
+   public:
+    static constexpr int kSubBucketBits = 7;
+    static constexpr uint64_t kSubBuckets = 1ull << kSubBucketBits;
+
+    XferLatencyHistogram()
+        : counts_((64 - kSubBucketBits + 1) * kSubBuckets) {}
+
+    void add(uint64_t value) {
+        counts_[bucketOf(value)]++;
+        total_count_++;
+        sum_ += value;
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const XferLatencyHistogram& other) {
+        for (size_t i = 0; i < counts_.size(); ++i)
+            counts_[i] += other.counts_[i];
+        total_count_ += other.total_count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return total_count_; }
+
+    double avg() const {
+        return total_count_ ? (double)sum_ / total_count_ : 0.0;
+    }
+
+    uint64_t max() const { return max_; }
+
+    // Upper bound of the bucket holding the p-th percentile, p in [0, 100]
+    uint64_t percentile(double p) const {
+        if (total_count_ == 0) return 0;
+        uint64_t rank = (uint64_t)std::ceil(p / 100.0 * total_count_);
+        rank = std::clamp<uint64_t>(rank, 1, total_count_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(upperBoundOf(i), max_);
+        }
+        return max_;
+    }
+
+   private:
+    static size_t bucketOf(uint64_t value) {
+        if (value < kSubBuckets) return value;
+        int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+        return (shift + 1) * kSubBuckets + (value >> shift) - kSubBuckets;
+    }
+
+    static uint64_t upperBoundOf(size_t bucket) {
+        if (bucket < kSubBuckets) return bucket;
+        int shift = bucket / kSubBuckets - 1;
+        uint64_t sub = bucket % kSubBuckets + kSubBuckets;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
 struct XferBenchStats {
     XferMetricStats total_duration;
-    XferMetricStats transfer_duration;
+    XferLatencyHistogram transfer_duration;
+    uint64_t total_bytes = 0;
+};
+
+// One point of the benchmark matrix
+struct XferBenchCase {
+    size_t block_size;  // 0 when request sizes are drawn from size_mix
+    size_t batch_size;
+    int num_threads;
+};
+
+// One request of a batch, to target target of the opened targets
+struct XferBenchRequest {
+    uint64_t local_addr;
+    size_t target;
+    uint64_t target_addr;
+    uint64_t length;
 };
 
 class XferBenchTimer {
@@ -143,8 +238,7 @@ class XferBenchTimer {
 
 void printStatsHeader();
 
-void printStats(size_t block_size, size_t batch_size, XferBenchStats& stats,
-                int num_threads);
+void printStats(const XferBenchCase& bench_case, XferBenchStats& stats);
 
 #ifdef USE_CUDA
 static inline bool isCudaMemory(void* ptr) {
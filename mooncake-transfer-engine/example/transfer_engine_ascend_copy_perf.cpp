@@ -0,0 +1,163 @@
+// Copyright 2025 Huawei Technologies Co., Ltd
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares copying a batch of KV blocks between HBM and host memory one
+// aclrtMemcpyAsync per block with the batched AscendCopyEngine used by the
+// Ascend transports.
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "acl/acl.h"
+#include "transport/ascend_transport/ascend_copy_engine.h"
+
+DEFINE_string(operation, "d2h", "Copy direction: d2h or h2d");
+DEFINE_int32(batch_size, 256, "Blocks copied per batch");
+DEFINE_uint64(block_size, 16384, "Size of each block");
+DEFINE_uint64(block_gap, 4096,
+              "Bytes between two blocks; 0 lets adjacent blocks coalesce");
+DEFINE_int32(iterations, 100, "Batches copied per method");
+DEFINE_uint64(device_logicid, 0, "The device logic ID of this machine");
+
+using namespace mooncake;
+
+namespace {
+
+using CopyOp = AscendCopyEngine::CopyOp;
+
+double runPerBlock(const std::vector<CopyOp> &ops, aclrtMemcpyKind kind,
+                   aclrtStream stream) {
+    auto start = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < FLAGS_iterations; ++iter) {
+        for (auto &op : ops) {
+            aclError ret = aclrtMemcpyAsync(op.dest, op.length, op.src,
+                                            op.length, kind, stream);
+            if (ret != ACL_ERROR_NONE) {
+                LOG(ERROR) << "aclrtMemcpyAsync failed, ret: " << ret;
+                return -1;
+            }
+        }
+        aclError ret = aclrtSynchronizeStream(stream);
+        if (ret != ACL_ERROR_NONE) {
+            LOG(ERROR) << "aclrtSynchronizeStream failed, ret: " << ret;
+            return -1;
+        }
+    }
+    return std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+double runBatched(const std::vector<CopyOp> &ops, aclrtMemcpyKind kind,
+                  AscendCopyEngine &engine) {
+    auto start = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < FLAGS_iterations; ++iter) {
+        aclError ret = engine.copy(ops, kind);
+        if (ret != ACL_ERROR_NONE) {
+            LOG(ERROR) << "AscendCopyEngine copy failed, ret: " << ret;
+            return -1;
+        }
+    }
+    return std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+void report(const std::string &name, double duration_us) {
+    const double bytes = 1.0 * FLAGS_iterations * FLAGS_batch_size *
+                         FLAGS_block_size;
+    std::cout << std::left << std::setw(12) << name << std::fixed
+              << std::setprecision(2) << duration_us / FLAGS_iterations
+              << " us/batch, " << bytes / duration_us / 1000 << " GB/s"
+              << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+
+    const auto device_id = static_cast<int32_t>(FLAGS_device_logicid);
+    aclError ret = aclInit(nullptr);
+    if (ret != ACL_ERROR_NONE) {
+        LOG(ERROR) << "Failed to initialize ACL";
+        return ret;
+    }
+    ret = aclrtSetDevice(device_id);
+    if (ret != ACL_ERROR_NONE) {
+        LOG(ERROR) << "Failed to set device ACL";
+        return ret;
+    }
+
+    const size_t stride = FLAGS_block_size + FLAGS_block_gap;
+    const size_t size = stride * FLAGS_batch_size;
+    void *dev_addr = nullptr;
+    void *host_addr = nullptr;
+    ret = aclrtMalloc(&dev_addr, size, ACL_MEM_MALLOC_HUGE_FIRST);
+    if (ret != ACL_ERROR_NONE) {
+        LOG(ERROR) << "Failed to allocate device memory, ret: " << ret;
+        return ret;
+    }
+    ret = aclrtMallocHost(&host_addr, size);
+    if (ret != ACL_ERROR_NONE) {
+        LOG(ERROR) << "Failed to allocate host memory, ret: " << ret;
+        return ret;
+    }
+
+    const bool d2h = FLAGS_operation == "d2h";
+    const aclrtMemcpyKind kind =
+        d2h ? ACL_MEMCPY_DEVICE_TO_HOST : ACL_MEMCPY_HOST_TO_DEVICE;
+    std::vector<CopyOp> ops;
+    for (int i = 0; i < FLAGS_batch_size; ++i) {
+        char *dev = static_cast<char *>(dev_addr) + i * stride;
+        char *host = static_cast<char *>(host_addr) + i * stride;
+        ops.push_back({d2h ? host : dev, d2h ? dev : host,
+                       static_cast<size_t>(FLAGS_block_size)});
+    }
+
+    aclrtStream stream;
+    ret = aclrtCreateStream(&stream);
+    if (ret != ACL_ERROR_NONE) {
+        LOG(ERROR) << "Failed to create stream, ret: " << ret;
+        return ret;
+    }
+    AscendCopyEngine engine(device_id, -1);
+    ret = engine.init();
+    if (ret != ACL_ERROR_NONE) {
+        return ret;
+    }
+
+    // Warm up both paths before they are timed
+    runPerBlock(ops, kind, stream);
+    runBatched(ops, kind, engine);
+
+    std::cout << FLAGS_operation << ", " << FLAGS_batch_size << " blocks of "
+              << FLAGS_block_size << " bytes, gap " << FLAGS_block_gap
+              << std::endl;
+    report("per-block", runPerBlock(ops, kind, stream));
+    report("batched", runBatched(ops, kind, engine));
+
+    aclrtDestroyStream(stream);
+    aclrtFreeHost(host_addr);
+    aclrtFree(dev_addr);
+    return 0;
+}
@@ -42,24 +42,85 @@ struct GlobalConfig {
     size_t max_sge = 4;
     size_t max_wr = 256;
     size_t max_inline = 64;
+    // QPs of a device share one receive queue instead of allocating their own
+    bool shared_rq = false;
+    // Notifies of transfers submitted with a notify are sent as RDMA
+    // SEND_WITH_IMM to peers that enable it too, instead of over the RPC of
+    // the metadata; needs shared_rq, whose queue receives them
+    bool rdma_notify_imm = false;
+    // Only every this many WRs of a post, and its last one, is signaled
+    size_t wr_signal_interval = 1;
     ibv_mtu mtu_length = IBV_MTU_4096;
     uint16_t handshake_port = 12001;
     int workers_per_ctx = 2;
+    bool work_stealing = true;
+    // Slices of a request are spread over all preferred devices of its
+    // buffer, favoring the least loaded one
+    bool rail_spray = true;
+    // Workers without completions for this long wait for CQ events instead
+    // of busy polling; 0 always busy polls
+    uint64_t cq_poll_idle_us = 0;
     size_t slice_size = 65536;
+    // RDMA slices are sized per peer from its bandwidth-delay product
+    // within these bounds, starting at slice_size; off if MC_SLICE_SIZE is
+    // set
+    bool rdma_auto_slice = true;
+    size_t rdma_min_slice_size = 16384;
+    size_t rdma_max_slice_size = 1048576;
+    // Endpoints get one more QP, used by TransferRequest::HIGH slices only;
+    // peers must agree on it like on num_qp_per_ep
+    bool rdma_priority_qp = false;
+    // Rounds the high priority class is served for each round of the
+    // normal class while both have slices queued; 0 serves the normal class
+    // only when no high priority slice waits
+    int rdma_priority_weight = 0;
     int retry_cnt = 9;
     int handshake_listen_backlog = 128;
     bool metacache = true;
+    // Cached segment descriptors are refreshed when the metadata store
+    // reports a change, if it can watch keys (etcd)
+    bool metacache_watch = true;
+    // Segment descriptors are published in a compact binary form, and
+    // changes to the buffers of the local segment as deltas. Peers must be
+    // able to read it.
+    bool metadata_binary = false;
     int log_level = google::INFO;
     bool trace = false;
     int64_t slice_timeout = -1;
     uint16_t rpc_min_port = 15000;
     uint16_t rpc_max_port = 17000;
     bool use_ipv6 = false;
+    // TCP requests are striped over up to tcp_conns_per_peer connections in
+    // pieces of at least tcp_stripe_size bytes; 0 disables striping
+    size_t tcp_stripe_size = 4194304;
+    // Also the number of idle connections kept open per TCP peer
+    size_t tcp_conns_per_peer = 4;
+    bool tcp_zerocopy = false;
+    // Device memory is registered by whole allocation and kept registered,
+    // idle allocations up to gpu_mr_cache_idle_size bytes
+    bool gpu_mr_cache = false;
+    size_t gpu_mr_cache_idle_size = 16ull << 30;
+    // RDMA segments on this host are also reached over intra-node NVLink,
+    // and requests of at least multi_path_split_size bytes (0: never) are
+    // split between both, multi_path_nvlink_ratio percent over NVLink
+    bool multi_path = false;
+    size_t multi_path_split_size = 0;
+    int multi_path_nvlink_ratio = 75;
+    // Requests to buffers of this process are copied by local_memcpy_threads
+    // threads instead of going through the loopback of the NIC
+    bool local_memcpy = true;
+    size_t local_memcpy_threads = 4;
     size_t fragment_limit = 16384;
     bool enable_dest_device_affinity = false;
     int parallel_reg_mr = -1;
+    // Host memory is registered as on-demand paging MRs, which skips pinning
+    // it up front, on devices that support ODP for RC read and write
+    bool ib_odp = false;
     size_t eic_max_block_size = 64UL * 1024 * 1024;
     EndpointStoreType endpoint_store_type = EndpointStoreType::SIEVE;
+    // Endpoints of a device are split over this many independently locked
+    // stores
+    size_t endpoint_store_shards = 16;
     int ib_traffic_class = -1;
     // ib_pci_relaxed_ordering_mode: 0: off, 1: on if supported, 2: auto
     int ib_pci_relaxed_ordering_mode = 0;
@@ -51,6 +51,7 @@ const static std::string GPU_PREFIX = "musa:";
 #define CUDA_SUCCESS MUSA_SUCCESS
 #define CUDA_ERROR_NOT_PERMITTED MUSA_ERROR_NOT_PERMITTED
 #define CUDA_ERROR_NOT_SUPPORTED MUSA_ERROR_NOT_SUPPORTED
+#define CUDA_ERROR_OUT_OF_MEMORY MUSA_ERROR_OUT_OF_MEMORY
 #define cudaDeviceCanAccessPeer musaDeviceCanAccessPeer
 #define cudaDeviceEnablePeerAccess musaDeviceEnablePeerAccess
 #define cudaDeviceGetPCIBusId musaDeviceGetPCIBusId
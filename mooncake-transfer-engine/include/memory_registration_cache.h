@@ -0,0 +1,108 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEMORY_REGISTRATION_CACHE_H
+#define MEMORY_REGISTRATION_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace mooncake {
+
+// Registrations of device memory at the granularity of its allocations.
+// Registering a tensor registers the whole cudaMalloc block around it, so
+// the other tensors a caching allocator carves out of that block reuse the
+// registration. Registered blocks never overlap, so a map ordered by base
+// address finds the block covering any pointer, like an interval tree.
+// Blocks count their users; a block nobody uses stays registered until its
+// memory is reported freed, a different allocation shows up at its
+// address, or the idle blocks exceed idle_limit bytes, oldest first.
+class MemoryRegistrationCache {
+   public:
+    struct Allocation {
+        uintptr_t base = 0;
+        size_t length = 0;
+        // Tells apart allocations that reuse an address
+        uint64_t buffer_id = 0;
+    };
+
+    // Finds the allocation containing addr; false if it is not device
+    // memory, which is then registered as is
+    using ResolveFunc = std::function<bool(void *addr, Allocation &)>;
+    using RegisterFunc = std::function<int(void *addr, size_t length)>;
+    using UnregisterFunc = std::function<int(void *addr)>;
+
+    MemoryRegistrationCache(ResolveFunc resolve, UnregisterFunc unregister,
+                            size_t idle_limit);
+
+    ~MemoryRegistrationCache() = default;
+
+    MemoryRegistrationCache(const MemoryRegistrationCache &) = delete;
+    MemoryRegistrationCache &operator=(const MemoryRegistrationCache &) =
+        delete;
+
+    // Resolves CUDA device pointers with the driver; false without CUDA
+    static bool resolveDeviceAllocation(void *addr, Allocation &allocation);
+
+    // Makes [addr, addr + length) registered, calling do_register for its
+    // whole allocation unless a registered block already covers it. Returns
+    // 1 if addr is not device memory and was left to the caller.
+    int acquire(void *addr, size_t length, const RegisterFunc &do_register);
+
+    // Drops a use taken by acquire(addr); 1 if addr has none
+    int release(void *addr);
+
+    // The allocation containing addr was freed: its block is unregistered
+    // now, even if it is still in use
+    int invalidate(void *addr);
+
+    size_t idleBytes() const;
+
+   private:
+    struct Block {
+        size_t length;
+        uint64_t buffer_id;
+        size_t users;
+        // Position in idle_list_ while users is 0
+        std::list<uintptr_t>::iterator idle_pos;
+    };
+
+    std::map<uintptr_t, Block>::iterator findBlock(uintptr_t addr);
+
+    int removeBlock(std::map<uintptr_t, Block>::iterator iter);
+
+    void evictIdleBlocks();
+
+   private:
+    const ResolveFunc resolve_;
+    const UnregisterFunc unregister_;
+    const size_t idle_limit_;
+
+    mutable std::mutex mutex_;
+    std::map<uintptr_t, Block> blocks_;
+    // Block base of each acquired pointer, one entry per use
+    std::unordered_multimap<uintptr_t, uintptr_t> users_;
+    // Bases of the blocks without users, least recently released first
+    std::list<uintptr_t> idle_list_;
+    size_t idle_bytes_ = 0;
+};
+
+}  // namespace mooncake
+
+#endif  // MEMORY_REGISTRATION_CACHE_H
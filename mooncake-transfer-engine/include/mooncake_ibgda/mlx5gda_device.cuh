@@ -0,0 +1,196 @@
+#ifndef _MLX5GDA_DEVICE_CUH_
+#define _MLX5GDA_DEVICE_CUH_
+
+#include <cstdio>
+#include <cuda/atomic>
+
+#include <mooncake_ibgda/mlx5gda.h>
+
+// Device side of mlx5gda: kernels build WQEs in the send queue of a QP
+// created by mlx5gda_create_rc_qp() and ring its doorbell themselves. Unless
+// noted, the functions taking a mlx5gda_qp_devctx must be called with its
+// mutex locked.
+
+namespace mooncake {
+
+static __device__ void device_mutex_lock_system(uint32_t *mutex) {
+    cuda::atomic_ref<uint32_t, cuda::thread_scope_system> lock(*mutex);
+    // Spin until the mutex is acquired
+    while (lock.exchange(1, cuda::memory_order_acquire) != 0);
+}
+
+static __device__ void device_mutex_unlock_system(uint32_t *mutex) {
+    cuda::atomic_ref<uint32_t, cuda::thread_scope_system> lock(*mutex);
+    // Release the mutex
+    lock.store(0, cuda::memory_order_release);
+}
+
+static __device__ uint16_t device_byteswap(uint16_t x) {
+    return __byte_perm(x, x, 0x2301);
+}
+
+static __device__ uint32_t device_byteswap(uint32_t x) {
+    return __byte_perm(x, x, 0x0123);
+}
+
+static __device__ uint64_t device_byteswap(uint64_t x) {
+    uint32_t hi = (uint32_t)(x >> 32);
+    uint32_t lo = (uint32_t)(x);
+
+    hi = __byte_perm(hi, hi, 0x0123);
+    lo = __byte_perm(lo, lo, 0x0123);
+
+    return ((uint64_t)lo << 32) | hi;
+}
+
+__device__ static inline uint16_t ptx_ld16_acq_sys_na(uint16_t *ptr) {
+    uint16_t val;
+    asm volatile("ld.acquire.sys.global.L1::no_allocate.b16 %0, [%1];"
+                 : "=h"(val)
+                 : "l"(ptr));
+    return val;
+}
+
+__device__ static inline void ptx_st32_rel_sys_na(uint32_t *ptr,
+                                                  uint32_t val) {
+    asm volatile("st.release.sys.global.L1::no_allocate.b32 [%0], %1;"
+                 :
+                 : "l"(ptr), "r"(val));
+}
+
+__device__ static inline void ptx_st64_rel_sys_na(uint64_t *ptr,
+                                                  uint64_t val) {
+    asm volatile("st.release.sys.global.L1::no_allocate.b64 [%0], %1;"
+                 :
+                 : "l"(ptr), "l"(val));
+}
+
+/**
+ * Wait until WQE `expect` has completed, i.e. wq_tail moved past it.
+ *
+ * A completion with error traps, after printing its syndrome.
+ */
+static __device__ void __mlx5gda_device_poll_cq(
+    struct mlx5gda_qp_devctx *ctx, uint16_t expect) {
+    uint16_t wq_tail = ctx->wq_tail;
+    while ((int16_t)(wq_tail - expect) <= 0) {
+        uint16_t cq_wqe_counter_be = ptx_ld16_acq_sys_na(&ctx->cq->wqe_counter);
+        uint8_t opcode = ctx->cq->op_own >> 4;
+        if (opcode == 0xD) {
+            printf("Requester_Error: syndrome = 0x%lx\n",
+                   ctx->cq->timestamp >> 56);
+        }
+        if (opcode != 0x0 && opcode != 0xF) {
+            printf("mlx5gda: unexpected CQE opcode 0x%x on QP 0x%x\n", opcode,
+                   ctx->qpn);
+            asm("trap;");
+        }
+        wq_tail = device_byteswap(cq_wqe_counter_be) + 1;
+    }
+    if (wq_tail != ctx->wq_tail) {
+        ctx->wq_tail = wq_tail;
+    }
+}
+
+/**
+ * Ring DB to post WQs up to last_posted_wqe.
+ */
+static __device__ void __mlx5gda_device_post_send_db(
+    struct mlx5gda_qp_devctx *ctx) {
+    // 1. update dbr
+    uint32_t num_posted_wqe = (uint32_t)(ctx->wq_head);
+    ptx_st32_rel_sys_na(&ctx->dbr->send_counter,
+                        device_byteswap((uint32_t)ctx->wq_head));
+    // 2. ring db
+    struct mlx5gda_wqebb *last_wqe =
+        ctx->wq + ((num_posted_wqe - 1) & ctx->wqeid_mask);
+    ptx_st64_rel_sys_na((uint64_t *)(ctx->bf + ctx->bf_offset),
+                        *(uint64_t *)last_wqe);
+    // 3. toggle bf
+    ctx->bf_offset ^= MLX5GDA_BF_SIZE;
+}
+
+// Writes and reads share the WQE layout and differ only in the opcode
+static __device__ void __mlx5gda_device_write_rdma_wqe(
+    struct mlx5gda_qp_devctx *ctx, uint8_t opcode, uint64_t laddr,
+    __be32 lkey, uint64_t raddr, __be32 rkey, uint32_t bytes) {
+    struct mlx5gda_rdma_write_wqe *wqe =
+        (mlx5gda_rdma_write_wqe *)(ctx->wq + (ctx->wq_head & ctx->wqeid_mask));
+    struct mlx5_wqe_ctrl_seg &ctrl_seg = wqe->ctrl;
+    struct mlx5_wqe_raddr_seg &raddr_seg = wqe->raddr;
+    struct mlx5_wqe_data_seg &data_seg = wqe->data;
+
+    ctrl_seg = {};
+    ctrl_seg.qpn_ds = device_byteswap((ctx->qpn << 8) | 3);
+    ctrl_seg.fm_ce_se = MLX5_WQE_CTRL_CQ_UPDATE;
+    ctrl_seg.opmod_idx_opcode =
+        device_byteswap(((uint32_t)ctx->wq_head << 8) | opcode);
+
+    raddr_seg.raddr = device_byteswap(raddr);
+    raddr_seg.rkey = rkey;
+    raddr_seg.reserved = 0;
+
+    data_seg.byte_count = device_byteswap(bytes);
+    data_seg.lkey = lkey;
+    data_seg.addr = device_byteswap(laddr);
+
+    ++ctx->wq_head;
+}
+
+static __device__ void __mlx5gda_device_write_rdma_write_wqe(
+    struct mlx5gda_qp_devctx *ctx, uint64_t laddr, __be32 lkey,
+    uint64_t raddr, __be32 rkey, uint32_t bytes) {
+    __mlx5gda_device_write_rdma_wqe(ctx, MLX5_OPCODE_RDMA_WRITE, laddr, lkey,
+                                    raddr, rkey, bytes);
+}
+
+static __device__ void __mlx5gda_device_write_rdma_read_wqe(
+    struct mlx5gda_qp_devctx *ctx, uint64_t laddr, __be32 lkey,
+    uint64_t raddr, __be32 rkey, uint32_t bytes) {
+    __mlx5gda_device_write_rdma_wqe(ctx, MLX5_OPCODE_RDMA_READ, laddr, lkey,
+                                    raddr, rkey, bytes);
+}
+
+struct mlx5_wqe_atomic_add_32_seg {
+    __be32 add_data;
+    __be32 field_boundary;
+    __be64 compare;
+};
+
+static __device__ void __mlx5gda_device_write_rdma_atomic_add_wqe(
+    struct mlx5gda_qp_devctx *ctx, const int &value, uint64_t laddr,
+    __be32 lkey, uint64_t raddr, __be32 rkey) {
+    struct mlx5gda_rdma_atomic_wqe *wqe =
+        (mlx5gda_rdma_atomic_wqe *)(ctx->wq +
+                                    (ctx->wq_head & ctx->wqeid_mask));
+    struct mlx5_wqe_ctrl_seg &ctrl_seg = wqe->ctrl;
+    struct mlx5_wqe_raddr_seg &raddr_seg = wqe->raddr;
+    struct mlx5_wqe_data_seg &data_seg = wqe->data;
+
+    ctrl_seg = {};
+    ctrl_seg.qpn_ds = device_byteswap((ctx->qpn << 8) | 4);
+    ctrl_seg.fm_ce_se = MLX5_WQE_CTRL_CQ_UPDATE;
+    ctrl_seg.opmod_idx_opcode =
+        device_byteswap(MLX5_OPCODE_ATOMIC_MASKED_FA |
+                        ((uint32_t)ctx->wq_head << 8) | 0x08000000);
+
+    raddr_seg.raddr = device_byteswap(raddr);
+    raddr_seg.rkey = rkey;
+    raddr_seg.reserved = 0;
+
+    auto atomic_add_32_seg =
+        reinterpret_cast<mlx5_wqe_atomic_add_32_seg *>(&wqe->atomic);
+    atomic_add_32_seg->add_data = device_byteswap((uint32_t)value);
+    atomic_add_32_seg->field_boundary = 0;
+    atomic_add_32_seg->compare = 0;
+
+    data_seg.byte_count = device_byteswap((uint32_t)4);
+    data_seg.lkey = lkey;
+    data_seg.addr = device_byteswap(laddr);
+
+    ++ctx->wq_head;
+}
+
+}  // namespace mooncake
+
+#endif
@@ -15,8 +15,10 @@
 #ifndef MULTI_TRANSPORT_H_
 #define MULTI_TRANSPORT_H_
 
+#include <memory>
 #include <unordered_map>
 
+#include "transport/local_memcpy_transport.h"
 #include "transport/transport.h"
 
 namespace mooncake {
@@ -56,10 +58,39 @@ class MultiTransport {
    private:
     Status selectTransport(const TransferRequest &entry, Transport *&transport);
 
+    // With MC_MULTI_PATH, whether a request to an RDMA segment on this host
+    // lands in a buffer that also published an NVLink IPC handle
+    bool reachableOverNvlink(const TransferRequest &entry,
+                             const TransferMetadata::SegmentDesc &desc);
+
+    // Whether the target of a request is a buffer this process registered,
+    // which is then copied by local_memcpy_ rather than over the NIC
+    bool isLocalTarget(const TransferRequest &entry,
+                       const TransferMetadata::SegmentDesc &desc);
+
+    // Submits the head of a large request over NVLink and the rest over
+    // RDMA, both parts moving at the same time
+    Status submitSplitTask(Transport::TransferTask &task);
+
+    // Submits the blocks of a strided or gather/scatter request one by one,
+    // for transports that only take contiguous requests
+    Status submitBlockTask(Transport *transport, Transport::TransferTask &task);
+
+    // Rejects FETCH_ADD and COMPARE_SWAP requests that the transport cannot
+    // run or whose buffers are not 8 aligned 8 bytes
+    Status checkAtomic(Transport *transport, const TransferRequest &entry);
+
+    // Rejects entries routed to transports that cannot signal completions
+    // when the batch has an eventfd or a callback, before any task is added.
+    Status checkCompletionNotify(BatchDesc &batch_desc,
+                                 const std::vector<TransferRequest> &entries);
+
    private:
     std::shared_ptr<TransferMetadata> metadata_;
     std::string local_server_name_;
+    std::string local_host_name_;
     std::map<std::string, std::shared_ptr<Transport>> transport_map_;
+    std::unique_ptr<LocalMemcpyTransport> local_memcpy_;
     RWSpinlock batch_desc_lock_;
     std::unordered_map<BatchID, std::shared_ptr<BatchDesc>> batch_desc_set_;
 };
@@ -73,6 +73,9 @@ class Topology {
         return discover(filter);
     }
 
+    // With MC_TOPOLOGY_CACHE_DIR set, the result is shared through a file in
+    // that directory by all processes of the host seeing the same hardware,
+    // and only the first of them probes the devices
     int discover(const std::vector<std::string> &filter);
 
     int parse(const std::string &topology_json);
@@ -87,6 +90,9 @@ class Topology {
     int selectDevice(const std::string storage_type, std::string_view hint,
                      int retry_count = 0);
 
+    // Devices selectDevice() picks from on the first attempt for storage_type
+    std::vector<int> firstChoiceDevices(const std::string &storage_type) const;
+
     TopologyMatrix getMatrix() const { return matrix_; }
 
     const std::vector<std::string> &getHcaList() const { return hca_list_; }
@@ -94,6 +100,12 @@ class Topology {
    private:
     int resolve();
 
+    int discoverDevices(const std::vector<std::string> &filter);
+
+    bool loadCache(const std::string &path, const std::string &fingerprint);
+
+    void saveCache(const std::string &path, const std::string &fingerprint);
+
    private:
     TopologyMatrix matrix_;
     std::vector<std::string> hca_list_;
@@ -61,6 +61,12 @@ class TransferEngine {
 
     Status CheckSegmentStatus(SegmentID sid);
 
+    // Opens the segments and connects to them ahead of the first transfer,
+    // handshaking with all of them concurrently. Pinned connections are
+    // never evicted from the endpoint cache.
+    int preconnectSegments(const std::vector<std::string>& segment_names,
+                           bool pin = false);
+
     int closeSegment(SegmentHandle handle);
 
     int removeLocalSegment(const std::string& segment_name);
@@ -72,6 +78,10 @@ class TransferEngine {
 
     int unregisterLocalMemory(void* addr, bool update_metadata = true);
 
+    // Reports that the device allocation containing addr was freed, for the
+    // free hook of a caching allocator when MC_GPU_MR_CACHE is set
+    int notifyMemoryFreed(void* addr);
+
     int registerLocalMemoryBatch(const std::vector<BufferEntry>& buffer_list,
                                  const std::string& location);
 
@@ -96,6 +106,33 @@ class TransferEngine {
     int sendNotifyByName(std::string remote_agent,
                          TransferMetadata::NotifyDesc notify_msg);
 
+    // Completion notification, an alternative to polling the transfer status.
+    // A batch must be subscribed to before its first transfer is submitted,
+    // and completes once batch_size tasks have been submitted and finished.
+    // Transports that cannot signal their completions, such as nvmeof, fail
+    // the submission when an eventfd or a callback is set, and otherwise
+    // leave the batch to be polled.
+    Status enableBatchCompletionNotify(BatchID batch_id);
+
+    // Returns an eventfd that becomes readable when the batch completes. It
+    // is owned by the batch and closed by freeBatchID.
+    Status getBatchCompletionFd(BatchID batch_id, int& fd);
+
+    // Runs callback(batch_id, failed) when the batch completes, on the thread
+    // finishing its last slice. It must not block.
+    Status setBatchCompletionCallback(
+        BatchID batch_id, std::function<void(BatchID, bool)> callback);
+
+    // Blocks until the batch completes; returns BatchBusy on timeout, and
+    // InvalidArgument when the batch is not notified and must be polled.
+    Status waitBatchCompletion(BatchID batch_id, int64_t timeout_ms);
+
+    // Cancels the transfers of the batch that are not started yet, e.g. once
+    // their deadline passed. They fail with CANCELED, while those started
+    // still complete, so the batch must be waited for before it is freed.
+    // Only the rdma transport cancels; others run the batch to completion.
+    Status cancelBatch(BatchID batch_id);
+
     Status getTransferStatus(BatchID batch_id, size_t task_id,
                              TransferStatus& status);
 
@@ -109,6 +146,10 @@ class TransferEngine {
 
     bool checkOverlap(void* addr, uint64_t length);
 
+    // Whether submitTransfer() takes strided and gather/scatter requests,
+    // which the TENT runtime does not
+    bool supportsScatterGather() const;
+
     void setAutoDiscover(bool auto_discover);
 
     void* getBaseAddr();
@@ -154,6 +154,37 @@ int genNotifyInEngine(transfer_engine_t engine, uint64_t target_id,
 int getTransferStatus(transfer_engine_t engine, batch_id_t batch_id,
                       size_t task_id, struct transfer_status *status);
 
+/*
+ * Batch-level calls, so that a binding crosses the FFI boundary once per
+ * batch rather than once per task and poll.
+ */
+
+// Call before the first submission to let waitBatchTransfer sleep on the
+// completion of the batch instead of polling it.
+int enableBatchCompletionNotify(transfer_engine_t engine, batch_id_t batch_id);
+
+// Overall status of the batch: COMPLETED once every task completed, FAILED
+// once any failed, and PENDING otherwise.
+int getBatchTransferStatus(transfer_engine_t engine, batch_id_t batch_id,
+                           struct transfer_status *status);
+
+// Fills status_list[i] with the status of task i, for i < count.
+int getTransferStatusList(transfer_engine_t engine, batch_id_t batch_id,
+                          struct transfer_status *status_list, size_t count);
+
+// Blocks until the batch completes or a task fails and fills the overall
+// status; after a failure, other tasks of the batch may still be running.
+// Returns the BatchBusy code (4) if timeout_ms elapses first; a negative
+// timeout_ms waits without limit.
+int waitBatchTransfer(transfer_engine_t engine, batch_id_t batch_id,
+                      int64_t timeout_ms, struct transfer_status *status);
+
+// submitTransfer followed by waitBatchTransfer. The batch must be fresh,
+// in which case its completion is notified rather than polled.
+int submitTransferAndWait(transfer_engine_t engine, batch_id_t batch_id,
+                          struct transfer_request *entries, size_t count,
+                          int64_t timeout_ms, struct transfer_status *status);
+
 int freeBatchID(transfer_engine_t engine, batch_id_t batch_id);
 
 int syncSegmentCache(transfer_engine_t engine);
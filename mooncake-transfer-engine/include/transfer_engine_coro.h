@@ -0,0 +1,43 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TRANSFER_ENGINE_CORO_H_
+#define TRANSFER_ENGINE_CORO_H_
+
+#include <async_simple/coro/Lazy.h>
+
+#include <vector>
+
+#include "transfer_engine.h"
+
+namespace mooncake {
+
+// Submits |entries| as a batch of their own and suspends the calling
+// coroutine until all of them are done. It is resumed by the transport
+// thread finishing the last slice instead of a polling loop, so a few
+// threads can keep thousands of transfers in flight:
+//
+//     Status s = co_await transferAsync(engine, std::move(requests));
+//
+// The coroutine is resumed through its executor if it has one, and
+// directly on the transport thread otherwise, where it must not block.
+// Returns Endpoint if a transfer failed, NotSupportedTransport for
+// transports that cannot signal their completions, such as nvmeof, and
+// NotImplemented on the TENT runtime; those are left to polling.
+async_simple::coro::Lazy<Status> transferAsync(
+    TransferEngine& engine, std::vector<TransferRequest> entries);
+
+}  // namespace mooncake
+
+#endif  // TRANSFER_ENGINE_CORO_H_
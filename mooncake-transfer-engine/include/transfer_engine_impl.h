@@ -30,10 +30,12 @@
 #include <vector>
 
 #include "memory_location.h"
+#include "memory_registration_cache.h"
 #include "multi_transport.h"
 #include "transfer_metadata.h"
 #include "transport/transport.h"
 #ifdef WITH_METRICS
+#include "ylt/coro_http/coro_http_server.hpp"
 #include "ylt/metric/counter.hpp"
 #include "ylt/metric/histogram.hpp"
 #endif
@@ -98,6 +100,12 @@ class TransferEngineImpl {
 
     Status CheckSegmentStatus(SegmentID sid);
 
+    // Opens the segments and connects to them ahead of the first transfer,
+    // handshaking with all of them concurrently. Pinned connections are
+    // never evicted from the endpoint cache.
+    int preconnectSegments(const std::vector<std::string>& segment_names,
+                           bool pin = false);
+
     int closeSegment(SegmentHandle handle);
 
     int removeLocalSegment(const std::string& segment_name);
@@ -109,6 +117,11 @@ class TransferEngineImpl {
 
     int unregisterLocalMemory(void* addr, bool update_metadata = true);
 
+    // Reports that the device allocation containing addr was freed, so that
+    // a registration MC_GPU_MR_CACHE keeps for it is dropped. Meant for the
+    // free hook of a caching allocator; a no-op without the cache.
+    int notifyMemoryFreed(void* addr);
+
     int registerLocalMemoryBatch(const std::vector<BufferEntry>& buffer_list,
                                  const std::string& location);
 
@@ -143,8 +156,13 @@ class TransferEngineImpl {
                                     const std::vector<TransferRequest>& entries,
                                     TransferMetadata::NotifyDesc notify_msg) {
         auto target_id = entries[0].target_id;
+        bool on_completion = notifyOnCompletion(batch_id, entries, notify_msg);
         Status s = multi_transports_->submitTransfer(batch_id, entries);
         if (!s.ok()) {
+            if (on_completion) {
+                auto& batch_desc = Transport::toBatchDesc(batch_id);
+                batch_desc.resetCompletionNotify();
+            }
             return s;
         }
 
@@ -160,6 +178,7 @@ class TransferEngineImpl {
         }
 #endif
 
+        if (on_completion) return s;
         // store notify
         RWSpinlock::WriteGuard guard(send_notifies_lock_);
         notifies_to_send_[batch_id] = std::make_pair(target_id, notify_msg);
@@ -175,6 +194,33 @@ class TransferEngineImpl {
     int sendNotifyByName(std::string remote_agent,
                          TransferMetadata::NotifyDesc notify_msg);
 
+    // Completion notification, an alternative to polling the transfer status.
+    // A batch must be subscribed to before its first transfer is submitted,
+    // and completes once batch_size tasks have been submitted and finished.
+    // Transports that cannot signal their completions, such as nvmeof, fail
+    // the submission when an eventfd or a callback is set, and otherwise
+    // leave the batch to be polled.
+    Status enableBatchCompletionNotify(BatchID batch_id);
+
+    // Returns an eventfd that becomes readable when the batch completes. It
+    // is owned by the batch and closed by freeBatchID.
+    Status getBatchCompletionFd(BatchID batch_id, int& fd);
+
+    // Runs callback(batch_id, failed) when the batch completes, on the thread
+    // finishing its last slice. It must not block.
+    Status setBatchCompletionCallback(
+        BatchID batch_id, std::function<void(BatchID, bool)> callback);
+
+    // Blocks until the batch completes; returns BatchBusy on timeout, and
+    // InvalidArgument when the batch is not notified and must be polled.
+    Status waitBatchCompletion(BatchID batch_id, int64_t timeout_ms);
+
+    // Cancels the transfers of the batch that are not started yet, e.g. once
+    // their deadline passed. They fail with CANCELED, while those started
+    // still complete, so the batch must be waited for before it is freed.
+    // Only the rdma transport cancels; others run the batch to completion.
+    Status cancelBatch(BatchID batch_id);
+
     Status getTransferStatus(BatchID batch_id, size_t task_id,
                              TransferStatus& status) {
         Status result =
@@ -293,6 +339,22 @@ class TransferEngineImpl {
         return local_topology_;
     }
 
+   private:
+    int registerLocalMemoryInternal(void* addr, size_t length,
+                                    const std::string& location,
+                                    bool remote_accessible,
+                                    bool update_metadata);
+
+    int unregisterLocalMemoryInternal(void* addr, bool update_metadata);
+
+    // With rdma_notify_imm, a batch submitted at once to an RDMA target that
+    // receives notifies over RDMA sends its notify from the completion of
+    // its last slice, instead of from the poll that sees it completed.
+    // Returns false when the notify is left to the poll.
+    bool notifyOnCompletion(BatchID batch_id,
+                            const std::vector<TransferRequest>& entries,
+                            const TransferMetadata::NotifyDesc& notify_msg);
+
    private:
     struct MemoryRegion {
         void* addr;
@@ -306,6 +368,8 @@ class TransferEngineImpl {
     std::shared_ptr<MultiTransport> multi_transports_;
     std::shared_mutex mutex_;
     std::vector<MemoryRegion> local_memory_regions_;
+    // Registers device memory by allocation, if MC_GPU_MR_CACHE is set
+    std::unique_ptr<MemoryRegistrationCache> registration_cache_;
     std::shared_ptr<Topology> local_topology_;
 
     RWSpinlock send_notifies_lock_;
@@ -339,11 +403,16 @@ class TransferEngineImpl {
     std::atomic<bool> should_stop_metrics_thread_{false};
     bool metrics_enabled_{false};
     uint64_t metrics_interval_seconds_{5};
+    // Port of the Prometheus endpoint, 0 if it is not served
+    uint16_t metrics_http_port_{0};
+    std::unique_ptr<coro_http::coro_http_server> metrics_http_server_;
 
     // Helper methods for metrics reporting thread management
     void InitializeMetricsConfig();
     void StartMetricsReportingThread();
     void StopMetricsReportingThread();
+    void StartMetricsHttpServer();
+    std::string GetPrometheusMetrics();
 #endif
 };
 }  // namespace mooncake
@@ -26,10 +26,13 @@
 #include <atomic>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "common.h"
 #include "topology.h"
@@ -96,6 +99,11 @@ class TransferMetadata {
         RankInfoDesc rank_info;
 
         int tcp_data_port;
+        // The TCP data port serves several requests per connection
+        bool tcp_persistent = false;
+        // The RDMA devices of the segment receive notifies as
+        // SEND_WITH_IMM (MC_RDMA_NOTIFY_IMM)
+        bool rdma_notify_imm = false;
 
         void dump() const;
     };
@@ -150,6 +158,10 @@ class TransferMetadata {
 
     int syncSegmentCache(const std::string &segment_name);
 
+    // Fetches the descriptors of the given segments that are not cached yet
+    // with batched lookups, e.g. before connecting to many peers at once.
+    int prefetchSegmentDescs(const std::vector<std::string> &segment_names);
+
     int removeSegmentDesc(const std::string &segment_name);
 
     int addLocalMemoryBuffer(const BufferDesc &buffer_desc,
@@ -169,6 +181,9 @@ class TransferMetadata {
     int getRpcMetaEntry(const std::string &server_name, RpcMetaDesc &desc);
     int getNotifies(std::vector<NotifyDesc> &notifies);
 
+    // Queues a notify received by a transport for getNotifies()
+    void addNotify(NotifyDesc &&notify);
+
     const RpcMetaDesc &localRpcMeta() const { return local_rpc_meta_; }
 
     using OnReceiveHandShake = std::function<int(const HandShakeDesc &peer_desc,
@@ -197,6 +212,23 @@ class TransferMetadata {
     int receivePeerNotify(const Json::Value &peer_json,
                           Json::Value &local_json);
     std::string getFullMetadataKey(const std::string &segment_name) const;
+    // Publishes the local segment in binary form, or only the change to its
+    // buffers if small enough (MC_METADATA_BINARY)
+    int publishLocalSegmentDesc(const SegmentDesc &desc);
+
+    // Fetches a segment descriptor and caches it. Concurrent fetches of the
+    // same segment share a single lookup.
+    std::shared_ptr<SegmentDesc> fetchSegmentDesc(
+        const std::string &segment_name);
+    void settleSegmentFetch(const std::string &segment_name,
+                            const std::shared_ptr<SegmentDesc> &segment_desc,
+                            uint64_t version);
+    uint64_t segmentVersion(const std::string &segment_name);
+    bool isSegmentStale(const std::string &segment_name) const {
+        return !stale_segments_.empty() && stale_segments_.count(segment_name);
+    }
+    void onSegmentKeyChanged(const std::string &key);
+    void invalidateSegment(const std::string &segment_name);
 
     bool p2p_handshake_mode_{false};
     std::string common_key_prefix_;
@@ -206,6 +238,16 @@ class TransferMetadata {
     std::unordered_map<uint64_t, std::shared_ptr<SegmentDesc>>
         segment_id_to_desc_map_;
     std::unordered_map<std::string, uint64_t> segment_name_to_id_map_;
+    // Segments changed in the metadata store since they were cached, and the
+    // number of such changes, which tells a fetch that raced with one that
+    // its result is already outdated
+    std::unordered_set<std::string> stale_segments_;
+    std::unordered_map<std::string, uint64_t> segment_version_map_;
+
+    std::mutex inflight_fetch_mutex_;
+    std::unordered_map<std::string,
+                       std::shared_future<std::shared_ptr<SegmentDesc>>>
+        inflight_fetches_;
 
     RWSpinlock notify_lock_;
     std::vector<NotifyDesc> notifys;
@@ -215,6 +257,15 @@ class TransferMetadata {
 
     std::atomic<SegmentID> next_segment_id_;
 
+    // The local segment as last published in full, under published_key_,
+    // and its version; later changes to its buffers are published as a
+    // delta against it
+    std::mutex publish_mutex_;
+    std::string published_key_;
+    std::string published_header_;
+    std::vector<BufferDesc> published_buffers_;
+    uint64_t published_version_ = 0;
+
     std::shared_ptr<HandShakePlugin> handshake_plugin_;
     std::shared_ptr<MetadataStoragePlugin> storage_plugin_;
 };
@@ -28,6 +28,22 @@ struct MetadataStoragePlugin {
     virtual bool get(const std::string &key, Json::Value &value) = 0;
     virtual bool set(const std::string &key, const Json::Value &value) = 0;
     virtual bool remove(const std::string &key) = 0;
+
+    // Fetches several keys in as few round trips as the store allows.
+    // values[i] is left null if keys[i] cannot be retrieved. By default the
+    // keys are fetched one by one.
+    virtual bool getBatch(const std::vector<std::string> &keys,
+                          std::vector<Json::Value> &values);
+
+    // Invokes callback(key, deleted) when a key under prefix is set or
+    // removed, and callback("", false) when changes may have been missed.
+    // Returns false if the store cannot watch keys.
+    using OnChangeCallBack =
+        std::function<void(const std::string &key, bool deleted)>;
+    virtual bool watchPrefix(const std::string &prefix,
+                             OnChangeCallBack callback) {
+        return false;
+    }
 };
 
 struct HandShakePlugin {
@@ -0,0 +1,87 @@
+// Copyright 2025 Huawei Technologies Co., Ltd
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ASCEND_COPY_ENGINE_H
+#define ASCEND_COPY_ENGINE_H
+
+#include <acl/acl.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace mooncake {
+
+// Local copies of the Ascend transports. A batch of copies of one kind is
+// first coalesced, merging copies whose sources and destinations both
+// continue the previous copy, and then issued with the fewest runtime calls:
+// - HBM<->host batches go through aclrtMemcpyBatch, at most
+//   kMaxBatchSize copies per call, unless the runtime does not support it;
+// - host copies are done with aclrtMemcpy;
+// - everything else is queued with aclrtMemcpyAsync on a pooled stream and
+//   synchronized once.
+// Streams are created on first use in the calling thread's context and
+// reused afterwards, one per concurrent caller.
+class AscendCopyEngine {
+   public:
+    struct CopyOp {
+        void *dest;
+        const void *src;
+        size_t length;
+    };
+
+    static constexpr size_t kMaxBatchSize = 4096;
+
+    AscendCopyEngine(int32_t device_logic_id, int32_t timeout_ms);
+
+    ~AscendCopyEngine();
+
+    AscendCopyEngine(const AscendCopyEngine &) = delete;
+    AscendCopyEngine &operator=(const AscendCopyEngine &) = delete;
+
+    // Creates the first stream, so that a missing context fails early
+    aclError init();
+
+    // Performs all copies and returns once they are complete
+    aclError copy(std::vector<CopyOp> ops, aclrtMemcpyKind kind);
+
+    // Merges consecutive copies of adjacent ranges in place
+    static void coalesce(std::vector<CopyOp> &ops);
+
+   private:
+    aclError copyBatch(const CopyOp *ops, size_t count, aclrtMemcpyKind kind);
+
+    aclError copyAsync(const std::vector<CopyOp> &ops, aclrtMemcpyKind kind);
+
+    aclError acquireStream(aclrtStream &stream);
+
+    void releaseStream(aclrtStream stream);
+
+   private:
+    const int32_t device_logic_id_;
+    const int32_t timeout_ms_;
+    // Cleared once aclrtMemcpyBatch reports it is not supported
+    std::atomic<bool> batch_supported_{true};
+
+    std::mutex stream_mutex_;
+    std::vector<aclrtStream> free_streams_;
+    std::vector<aclrtStream> all_streams_;
+};
+
+}  // namespace mooncake
+
+#endif  // ASCEND_COPY_ENGINE_H
@@ -32,6 +32,7 @@
 #include "transfer_metadata.h"
 #include "transport/transport.h"
 #include "adxl/adxl_engine.h"
+#include "transport/ascend_transport/ascend_copy_engine.h"
 
 namespace mooncake {
 class TransferMetadata;
@@ -92,19 +93,6 @@ class AscendDirectTransport : public Transport {
     void localCopy(TransferRequest::OpCode opcode,
                    const std::vector<Slice *> &slice_list);
 
-    aclError copyWithBatch(TransferRequest::OpCode opcode,
-                           const std::vector<Slice *> &slice_list,
-                           aclrtMemcpyKind kind, size_t batch_num,
-                           size_t slice_index) const;
-
-    static void copyWithSync(TransferRequest::OpCode opcode,
-                             const std::vector<Slice *> &slice_list,
-                             aclrtMemcpyKind kind);
-
-    void copyWithAsync(TransferRequest::OpCode opcode,
-                       const std::vector<Slice *> &slice_list,
-                       aclrtMemcpyKind kind);
-
     uint16_t findAdxlListenPort();
 
     int InitAdxlEngine();
@@ -138,7 +126,7 @@ class AscendDirectTransport : public Transport {
     int32_t connect_timeout_ = 10000;
     int32_t transfer_timeout_ = 10000;
     std::string local_adxl_engine_name_{};
-    aclrtStream stream_{};
+    std::unique_ptr<AscendCopyEngine> copy_engine_;
     bool use_buffer_pool_{false};
     bool auto_connect_{false};
     int32_t base_port_ = 20000;
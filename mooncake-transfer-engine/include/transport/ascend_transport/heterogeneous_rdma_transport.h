@@ -18,6 +18,7 @@
 
 #include "transport/rdma_transport/rdma_transport.h"
 #include "acl/acl.h"
+#include "transport/ascend_transport/ascend_copy_engine.h"
 #include <atomic>
 #include <new>
 #include <memory>
@@ -27,6 +28,11 @@
 #define HUGE_DEVICE_SIZE 8 * 1024 * 1024
 #define HUGE_DEVICE_NUM 4
 #define AGGREGATE_SIZE_LIMIT 2 * 1024 * 1024
+// Large requests are staged in chunks, each posted once it is on the host
+#define STAGING_PIPELINE_DEPTH 8
+#define STAGING_MIN_CHUNK_SIZE (2ULL * 1024 * 1024)
+#define STAGING_MAX_CHUNK_SIZE (256ULL * 1024 * 1024)
+#define STAGING_MIN_CHUNK_US 200
 
 namespace mooncake {
 
@@ -76,6 +82,8 @@ class HeterogeneousRdmaTransport : public Transport {
 
     Status noAggTransport(const std::vector<TransferTask *> &task_list);
 
+    uint64_t stagingChunkSize(uint64_t total_length) const;
+
    private:
     struct TransferInfo {
         std::vector<TransferTask *> tasks{};
@@ -146,7 +154,8 @@ class HeterogeneousRdmaTransport : public Transport {
     int logic_device_id_{};
 
     std::unique_ptr<RdmaTransport> transport_{};
-    aclrtStream stream_copy_{};
+    // Batched copies to the host staging buffer and the device blocks
+    std::unique_ptr<AscendCopyEngine> copy_engine_;
     bool stream_copy_created_{};
 
     char *dev_addr_{};
@@ -158,6 +167,10 @@ class HeterogeneousRdmaTransport : public Transport {
     std::condition_variable block_queue_cv_{};
 
     std::mutex memcpy_mutex_;
+    // Measured device to host copy and RDMA bandwidth of the staging
+    // pipeline, in bytes per second, guarded by memcpy_mutex_
+    double copy_bandwidth_{};
+    double wire_bandwidth_{};
 
     std::thread transfer_thread_;
     std::queue<TransferInfo> transfer_queue_;
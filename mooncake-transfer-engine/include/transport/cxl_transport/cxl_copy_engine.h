@@ -0,0 +1,85 @@
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CXL_COPY_ENGINE_H_
+#define CXL_COPY_ENGINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace mooncake {
+
+// Copies the slices of CxlTransport. Each copy of a batch goes to the
+// cheapest engine for its size:
+// - memmove descriptors on an Intel DSA user work queue (MC_CXL_DSA_WQ)
+//   for copies of at least MC_CXL_DSA_MIN_SIZE bytes. They are submitted
+//   first and run while the CPU copies the rest of the batch;
+// - AVX-512 non-temporal stores for copies into CXL memory of at least
+//   MC_CXL_NT_MIN_SIZE bytes, which do not pull the destination lines into
+//   the cache only to write them back;
+// - std::memcpy otherwise.
+// The stores of a batch are ordered by a single fence at its end.
+class CxlCopyEngine {
+   public:
+    struct CopyOp {
+        void *dest;
+        const void *src;
+        size_t size;
+        bool dest_is_cxl;
+    };
+
+    CxlCopyEngine();
+
+    ~CxlCopyEngine();
+
+    CxlCopyEngine(const CxlCopyEngine &) = delete;
+    CxlCopyEngine &operator=(const CxlCopyEngine &) = delete;
+
+    // Performs all copies; returns once they are complete and visible
+    void copyBatch(const std::vector<CopyOp> &ops);
+
+    bool dsaEnabled() const { return dsa_portal_ != nullptr; }
+
+   private:
+    struct DsaChunk;
+
+    bool openDsaQueue(const std::string &wq_path);
+
+    // Submits one descriptor; false if the work queue has no room
+    bool submitDsa(DsaChunk &chunk);
+
+    // Waits for the chunk, finishing it on the CPU if DSA did not
+    void completeDsa(DsaChunk &chunk);
+
+    void copyCpu(void *dest, const void *src, size_t size, bool dest_is_cxl);
+
+   private:
+    size_t nt_min_size_;
+    size_t dsa_min_size_;
+    bool has_avx512_;
+
+    void *dsa_portal_;
+    bool dsa_dedicated_;
+    // Descriptors a dedicated work queue accepts at once; more would be
+    // dropped by the device
+    size_t dsa_wq_size_;
+    size_t dsa_max_transfer_size_;
+    std::atomic<size_t> dsa_inflight_;
+};
+
+}  // namespace mooncake
+
+#endif  // CXL_COPY_ENGINE_H_
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "transfer_metadata.h"
+#include "transport/cxl_transport/cxl_copy_engine.h"
 #include "transport/transport.h"
 
 namespace mooncake {
@@ -78,7 +79,8 @@ class CxlTransport : public Transport {
 
     size_t cxlGetDeviceSize();
 
-    int cxlMemcpy(void *dest_addr, void *source_addr, size_t size);
+    // Copies the slices as one batch of the copy engine and marks them
+    void cxlMemcpyBatch(const std::vector<Slice *> &slices);
 
     bool isAddressInCxlRange(void *addr);
 
@@ -88,6 +90,7 @@ class CxlTransport : public Transport {
     void *cxl_base_addr;
     size_t cxl_dev_size;
     char *cxl_dev_path;
+    std::unique_ptr<CxlCopyEngine> copy_engine_;
 };
 }  // namespace mooncake
 
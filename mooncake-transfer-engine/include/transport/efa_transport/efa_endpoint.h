@@ -24,6 +24,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <queue>
 #include <string>
 #include <vector>
@@ -37,13 +38,42 @@ namespace mooncake {
 
 class EfaContext;
 
+class EfaOpContextPool;
+
 // Custom context for libfabric operations - stores slice pointer for completion
 // handling This struct MUST have fi_context as its first member
 struct EfaOpContext {
     struct fi_context fi_ctx;  // Must be first member
     Transport::Slice *slice;   // Slice pointer for completion handling
-    volatile int *wr_depth;    // Pointer to endpoint's wr_depth_ for CQ
+    volatile int *wr_depth;    // Pointer to the lane's wr_depth for CQ
                                // completion decrement
+    EfaOpContextPool *pool;    // Pool to return the context to
+    EfaOpContext *next;        // Link in the pool's free lists
+};
+
+// Freelist of EfaOpContext owned by one endpoint lane. The poster takes
+// contexts under the lane's post lock, and pollCq returns them from any
+// thread onto a lock-free list that the poster reclaims with one exchange
+// once its own list runs dry. Contexts are allocated in chunks and only
+// released with the pool.
+class EfaOpContextPool {
+   public:
+    EfaOpContextPool() = default;
+    EfaOpContextPool(const EfaOpContextPool &) = delete;
+    EfaOpContextPool &operator=(const EfaOpContextPool &) = delete;
+
+    // Caller must hold the post lock of the owning lane
+    EfaOpContext *get();
+
+    // Thread-safe
+    void put(EfaOpContext *op_ctx);
+
+   private:
+    static constexpr size_t kChunkSize = 256;
+
+    EfaOpContext *free_list_ = nullptr;
+    std::atomic<EfaOpContext *> returned_list_{nullptr};
+    std::vector<std::unique_ptr<EfaOpContext[]>> chunks_;
 };
 
 // EfaEndPoint represents a libfabric endpoint for EFA communication.
@@ -58,7 +88,8 @@ class EfaEndPoint {
     EfaEndPoint(EfaContext &context);
     ~EfaEndPoint();
 
-    // Construct endpoint with specified completion queue
+    // Construct endpoint with specified completion queue and num_qp_list
+    // libfabric endpoints of max_wr outstanding writes each
     int construct(struct fid_cq *cq, size_t num_qp_list = 1, size_t max_sge = 4,
                   size_t max_wr = 256, size_t max_inline = 64);
 
@@ -111,8 +142,8 @@ class EfaEndPoint {
     int submitPostSend(std::vector<Transport::Slice *> &slice_list,
                        std::vector<Transport::Slice *> &failed_slice_list);
 
-    // Get the number of endpoints (always 1 for EFA RDM)
-    size_t getQPNumber() const { return 1; }
+    // Get the number of libfabric endpoints posting to the peer
+    size_t getQPNumber() const { return lanes_.size(); }
 
     // Get local endpoint address for handshake
     std::string getLocalAddr() const;
@@ -123,6 +154,35 @@ class EfaEndPoint {
     EfaContext &context() { return context_; }
 
    private:
+    // One libfabric endpoint of this peer connection, with its own send
+    // queue depth and op contexts. Submitting threads are spread over the
+    // lanes so that they rarely contend for the same post lock.
+    struct Lane {
+        struct fid_ep *ep = nullptr;
+        volatile int wr_depth = 0;
+        // Serializes posts on ep: libfabric RDM endpoints are not
+        // thread-safe by default.
+        std::atomic_flag post_lock = ATOMIC_FLAG_INIT;
+        EfaOpContextPool op_pool;
+    };
+
+    int openEndpoint(struct fid_ep **ep);
+
+    Lane &laneForThread();
+
+    // Reserve up to `wanted` WR slots of the lane and CQ slots of the
+    // context. Returns the number reserved, 0 if none was available
+    // after backing off.
+    int reserveSlots(Lane &lane, int wanted, int cq_limit);
+
+    void releaseSlots(Lane &lane, int count);
+
+    // Post the next `count` slices starting at `next` on the lane, which
+    // the caller has locked and reserved `count` slots of
+    void postBatch(Lane &lane, std::vector<Transport::Slice *> &slice_list,
+                   size_t &next, int count,
+                   std::vector<Transport::Slice *> &failed_slice_list);
+
     // Setup connection using peer's address from handshake
     int doSetupConnection(const std::string &peer_addr,
                           std::string *reply_msg = nullptr);
@@ -137,8 +197,9 @@ class EfaEndPoint {
     RWSpinlock lock_;
     std::string peer_nic_path_;
 
-    // Libfabric endpoint
-    struct fid_ep *ep_;
+    // Libfabric endpoints; the first one's address is exchanged in the
+    // handshake and is the one peers write to
+    std::vector<std::unique_ptr<Lane>> lanes_;
     struct fid_cq *tx_cq_;
     struct fid_cq *rx_cq_;
     fi_addr_t peer_fi_addr_;  // Peer's address in the AV
@@ -147,14 +208,9 @@ class EfaEndPoint {
     std::vector<uint8_t> local_addr_;
     size_t local_addr_len_;
 
-    volatile int wr_depth_;
-    int max_wr_depth_;
+    int max_wr_depth_;  // Per lane
     volatile int *cq_outstanding_;
 
-    // Spinlock to serialize fi_write calls on this endpoint.
-    // libfabric RDM endpoints are not thread-safe by default.
-    std::atomic_flag post_lock_ = ATOMIC_FLAG_INIT;
-
     volatile bool active_;
     volatile uint64_t inactive_time_;
 };
@@ -0,0 +1,114 @@
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GDA_CHANNEL_H_
+#define GDA_CHANNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct mlx5gda_qp;
+struct mlx5gda_qp_devctx;
+struct mlx5dv_devx_umem;
+struct memheap;
+
+namespace mooncake {
+
+class RdmaContext;
+class TransferEngine;
+class TransferMetadata;
+
+// What a kernel needs to post to the queue pairs of a GdaChannel. It only
+// holds device pointers, so it is passed to kernels by value and may be
+// captured in CUDA graphs. See transport/ibgda/gda_device.cuh.
+struct GdaDeviceHandle {
+    mlx5gda_qp_devctx *qps;
+    uint32_t num_qps;
+};
+
+// Queue pairs on a local RDMA device of the engine whose send queues, CQs
+// and doorbell records live in GPU memory, so that CUDA kernels post RDMA
+// reads and writes to them and poll their completions without the host
+// (IBGDA). Only mlx5 devices are supported.
+//
+// The queue pairs use the protection domain of the device in the RDMA
+// transport, so buffers registered with engine.registerLocalMemory() are
+// addressed with the keys published in the segment metadata, and the
+// GID/LID of the peer is taken from its segment. A channel connects to one
+// channel of the peer, created on the same number of queue pairs: each side
+// sends its localInfo() to the other out of band and calls connect() with
+// what it received.
+class GdaChannel {
+   public:
+    // Null, after logging the cause, if the engine has no RDMA transport,
+    // the device is not one of its devices or is not an mlx5 device
+    static std::unique_ptr<GdaChannel> create(TransferEngine &engine,
+                                              const std::string &device_name,
+                                              size_t num_qps = 16,
+                                              size_t max_wr_depth = 4096);
+
+    ~GdaChannel();
+
+    GdaChannel(const GdaChannel &) = delete;
+    GdaChannel &operator=(const GdaChannel &) = delete;
+
+    // The segment, device and queue pair numbers of this channel, as JSON
+    std::string localInfo() const;
+
+    // Connects queue pair i to queue pair i of the channel described by
+    // peer_info, obtained from localInfo() of that channel
+    int connect(const std::string &peer_info);
+
+    bool connected() const { return connected_; }
+
+    GdaDeviceHandle deviceHandle() const;
+
+    // The lkey of a local buffer registered with the engine, for device
+    // posts of this channel. Host byte order.
+    int localKey(const void *addr, uint32_t &lkey) const;
+
+    // The rkey of [addr, addr + length) in the segment of the connected
+    // peer, read from its metadata. Host byte order.
+    int remoteKey(uint64_t addr, size_t length, uint32_t &rkey) const;
+
+   private:
+    GdaChannel(std::shared_ptr<RdmaContext> context,
+               std::shared_ptr<TransferMetadata> metadata);
+
+    int construct(size_t num_qps, size_t max_wr_depth);
+
+   private:
+    std::shared_ptr<RdmaContext> context_;
+    std::shared_ptr<TransferMetadata> metadata_;
+    std::string local_server_name_;
+
+    // GPU memory holding the queues of all queue pairs
+    void *ctrl_buf_ = nullptr;
+    size_t ctrl_buf_size_ = 0;
+    mlx5dv_devx_umem *ctrl_buf_umem_ = nullptr;
+    memheap *ctrl_buf_heap_ = nullptr;
+    std::vector<mlx5gda_qp *> qps_;
+    mlx5gda_qp_devctx *qp_devctxs_ = nullptr;
+
+    bool connected_ = false;
+    std::string peer_server_name_;
+    std::string peer_device_name_;
+};
+
+}  // namespace mooncake
+
+#endif  // GDA_CHANNEL_H_
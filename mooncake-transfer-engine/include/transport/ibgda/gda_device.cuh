@@ -0,0 +1,93 @@
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GDA_DEVICE_CUH_
+#define GDA_DEVICE_CUH_
+
+#include <mooncake_ibgda/mlx5gda_device.cuh>
+
+#include "transport/ibgda/gda_channel.h"
+
+// Device API of GdaChannel. Each call is made by a single thread, e.g. lane
+// 0 of a warp; threads posting to the same queue pair are serialized by its
+// lock. Keys are in host byte order, as returned by GdaChannel::localKey()
+// and GdaChannel::remoteKey(). Every post rings the doorbell.
+//
+// A post returns the index of its WQE in the queue pair. Writes and reads on
+// one queue pair complete in order, so gdaWait() on the last index waits for
+// all of them. Indices wrap at 65536: wait before posting that many more.
+
+namespace mooncake {
+
+namespace gda_detail {
+
+static __device__ uint16_t post(const GdaDeviceHandle &handle,
+                                uint32_t qp_index, bool is_read,
+                                const void *local_addr, uint32_t lkey,
+                                uint64_t remote_addr, uint32_t rkey,
+                                uint32_t length) {
+    auto ctx = handle.qps + qp_index % handle.num_qps;
+    device_mutex_lock_system(&ctx->mutex);
+    // The send queue is full: wait for its oldest WQE
+    if ((uint16_t)(ctx->wq_head - ctx->wq_tail) > ctx->wqeid_mask)
+        __mlx5gda_device_poll_cq(
+            ctx, (uint16_t)(ctx->wq_head - ctx->wqeid_mask - 1));
+    uint16_t wqe_index = ctx->wq_head;
+    if (is_read)
+        __mlx5gda_device_write_rdma_read_wqe(
+            ctx, (uint64_t)local_addr, device_byteswap(lkey), remote_addr,
+            device_byteswap(rkey), length);
+    else
+        __mlx5gda_device_write_rdma_write_wqe(
+            ctx, (uint64_t)local_addr, device_byteswap(lkey), remote_addr,
+            device_byteswap(rkey), length);
+    __mlx5gda_device_post_send_db(ctx);
+    device_mutex_unlock_system(&ctx->mutex);
+    return wqe_index;
+}
+
+}  // namespace gda_detail
+
+// Writes length bytes from local_addr to remote_addr of the peer
+static __device__ uint16_t gdaPostWrite(const GdaDeviceHandle &handle,
+                                        uint32_t qp_index,
+                                        const void *local_addr, uint32_t lkey,
+                                        uint64_t remote_addr, uint32_t rkey,
+                                        uint32_t length) {
+    return gda_detail::post(handle, qp_index, false, local_addr, lkey,
+                            remote_addr, rkey, length);
+}
+
+// Reads length bytes from remote_addr of the peer into local_addr
+static __device__ uint16_t gdaPostRead(const GdaDeviceHandle &handle,
+                                       uint32_t qp_index, void *local_addr,
+                                       uint32_t lkey, uint64_t remote_addr,
+                                       uint32_t rkey, uint32_t length) {
+    return gda_detail::post(handle, qp_index, true, local_addr, lkey,
+                            remote_addr, rkey, length);
+}
+
+// Returns once the WQE wqe_index of the queue pair has completed. A
+// completion with error traps.
+static __device__ void gdaWait(const GdaDeviceHandle &handle,
+                               uint32_t qp_index, uint16_t wqe_index) {
+    auto ctx = handle.qps + qp_index % handle.num_qps;
+    device_mutex_lock_system(&ctx->mutex);
+    __mlx5gda_device_poll_cq(ctx, wqe_index);
+    device_mutex_unlock_system(&ctx->mutex);
+}
+
+}  // namespace mooncake
+
+#endif  // GDA_DEVICE_CUH_
@@ -66,6 +66,8 @@ class IntraNodeNvlinkTransport : public Transport {
 
    private:
     std::atomic_bool running_;
+    // Shares the local segment of the RDMA transport
+    bool companion_ = false;
 
     struct OpenedShmEntry {
         void* shm_addr;
@@ -0,0 +1,88 @@
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LOCAL_MEMCPY_TRANSPORT_H_
+#define LOCAL_MEMCPY_TRANSPORT_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "transport/transport.h"
+
+namespace mooncake {
+
+// Runs the requests whose target is a buffer of this process, which
+// MultiTransport routes here instead of through the loopback of the NIC.
+// Requests are cut into chunks copied by a pool of worker threads, with
+// cudaMemcpy when either side is device memory. It is not installed as a
+// protocol: segments keep publishing the transports they were opened with.
+class LocalMemcpyTransport : public Transport {
+   public:
+    explicit LocalMemcpyTransport(size_t num_threads);
+
+    ~LocalMemcpyTransport() override;
+
+    Status submitTransfer(BatchID batch_id,
+                          const std::vector<TransferRequest> &entries) override;
+
+    Status submitTransferTask(
+        const std::vector<TransferTask *> &task_list) override;
+
+    Status getTransferStatus(BatchID batch_id, size_t task_id,
+                             TransferStatus &status) override;
+
+    bool supportsScatterGather() const override { return true; }
+
+   private:
+    void worker();
+
+    static void copy(Slice *slice);
+
+    int registerLocalMemory(void *addr, size_t length,
+                            const std::string &location,
+                            bool remote_accessible,
+                            bool update_metadata) override {
+        return 0;
+    }
+
+    int unregisterLocalMemory(void *addr, bool update_metadata) override {
+        return 0;
+    }
+
+    int registerLocalMemoryBatch(const std::vector<BufferEntry> &buffer_list,
+                                 const std::string &location) override {
+        return 0;
+    }
+
+    int unregisterLocalMemoryBatch(
+        const std::vector<void *> &addr_list) override {
+        return 0;
+    }
+
+    const char *getName() const override { return "local_memcpy"; }
+
+   private:
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<Slice *> queue_;
+    bool running_ = true;
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace mooncake
+
+#endif  // LOCAL_MEMCPY_TRANSPORT_H_
@@ -0,0 +1,62 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NVLINK_EVENT_POOL_H_
+#define NVLINK_EVENT_POOL_H_
+
+#include "cuda_alike.h"
+
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+
+namespace mooncake {
+
+// CudaEventPool manages a pool of CUDA events per device for async operations
+class CudaEventPool {
+   public:
+    explicit CudaEventPool(int num_events_per_device);
+    ~CudaEventPool();
+
+    // Disable copy (to prevent double-free of CUDA resources)
+    CudaEventPool(const CudaEventPool &) = delete;
+    CudaEventPool &operator=(const CudaEventPool &) = delete;
+
+    // Disable move (std::mutex is not movable)
+    CudaEventPool(CudaEventPool &&) = delete;
+    CudaEventPool &operator=(CudaEventPool &&) = delete;
+
+    // Get an event from the pool (creates new ones if pool is empty)
+    cudaEvent_t getEvent(int device_id);
+
+    // Return an event to the pool for reuse
+    void putEvent(cudaEvent_t event, int device_id);
+
+   private:
+    bool initializeEventsForDevice(int device_id);
+
+    // Helper function to create a single event for a device
+    cudaEvent_t createEventForDevice(int device_id);
+
+    // Helper function to create an event assuming device is already set
+    cudaEvent_t createEvent();
+
+    int num_events_per_device_;
+    std::mutex mutex_;
+    std::unordered_map<int, std::queue<cudaEvent_t>> event_pools_;
+};
+
+}  // namespace mooncake
+
+#endif  // NVLINK_EVENT_POOL_H_
@@ -18,6 +18,8 @@
 #include "topology.h"
 #include "transfer_metadata.h"
 #include "transport/transport.h"
+#include "transport/nvlink_transport/event_pool.h"
+#include "transport/nvlink_transport/stream_pool.h"
 
 namespace mooncake {
 
@@ -72,12 +74,39 @@ class NvlinkTransport : public Transport {
         uint64_t length;
     };
 
+    // Copies recorded on one stream, complete once event fires
+    struct PendingTransfer {
+        cudaEvent_t event;
+        int device_id;
+        std::vector<Slice*> slices;
+    };
+
+    // Enqueue the copies of slices on pooled streams. Slices that cannot be
+    // enqueued are marked failed; the others are added to pending.
+    void issueAsyncCopies(const std::vector<Slice*>& slices,
+                          std::vector<PendingTransfer>& pending);
+
+    // Enqueue slices of one device on a single stream and record an event
+    void issueCopiesOnStream(int device_id, const std::vector<Slice*>& slices,
+                             std::vector<PendingTransfer>& pending);
+
+    // Wait for pending transfers and mark their slices
+    void synchronizePendingTransfers(
+        std::vector<PendingTransfer>& pending_transfers);
+
     std::unordered_map<std::pair<uint64_t, uint64_t>, OpenedShmEntry, PairHash>
         remap_entries_;
     RWSpinlock remap_lock_;
     bool use_fabric_mem_;
 
     std::mutex register_mutex_;
+
+    // Stream and event pools for async copies
+    CudaStreamPool stream_pool_;
+    CudaEventPool event_pool_;
+    // Slices shorter than this are grouped into one cudaMemcpyBatchAsync
+    // per device; 0 issues every slice on its own
+    size_t batch_slice_size_;
 };
 
 }  // namespace mooncake
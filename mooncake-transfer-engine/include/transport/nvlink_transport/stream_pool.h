@@ -0,0 +1,54 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NVLINK_STREAM_POOL_H_
+#define NVLINK_STREAM_POOL_H_
+
+#include "cuda_alike.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mooncake {
+
+// CudaStreamPool manages a pool of CUDA streams per device for async operations
+class CudaStreamPool {
+   public:
+    explicit CudaStreamPool(int num_streams_per_device);
+    ~CudaStreamPool();
+
+    // Disable copy (to prevent double-free of CUDA resources)
+    CudaStreamPool(const CudaStreamPool &) = delete;
+    CudaStreamPool &operator=(const CudaStreamPool &) = delete;
+
+    // Disable move (std::mutex is not movable)
+    CudaStreamPool(CudaStreamPool &&) = delete;
+    CudaStreamPool &operator=(CudaStreamPool &&) = delete;
+
+    // Get next stream for a device in round-robin fashion
+    cudaStream_t getNextStream(int device_id);
+
+   private:
+    bool initializeStreamsForDevice(int device_id);
+
+    int num_streams_per_device_;
+    std::mutex mutex_;
+    std::unordered_map<int, std::vector<cudaStream_t>> streams_;
+    std::unordered_map<int, int> current_stream_idx_;
+};
+
+}  // namespace mooncake
+
+#endif  // NVLINK_STREAM_POOL_H_
@@ -100,6 +100,9 @@ class NVMeoFTransport : public Transport {
 
     const char *getName() const override { return "nvmeof"; }
 
+    // Tasks finish in getTransferStatus() when the cuFile batch is polled
+    bool supportsCompletionNotify() const override { return false; }
+
     std::unordered_map<BatchID, int> batch_to_cufile_desc_;
     std::unordered_map<std::pair<SegmentHandle, uint64_t>,
                        std::shared_ptr<CuFileContext>, pair_hash>
@@ -20,7 +20,9 @@
 #include <atomic>
 #include <memory>
 #include <optional>
+#include <vector>
 
+#include "config.h"
 #include "rdma_context.h"
 #include "rdma_endpoint.h"
 
@@ -41,7 +43,11 @@ class EndpointStore {
     virtual std::shared_ptr<RdmaEndPoint> insertEndpoint(
         const std::string &peer_nic_path, RdmaContext *context) = 0;
     virtual int deleteEndpoint(const std::string &peer_nic_path) = 0;
-    virtual void evictEndpoint() = 0;
+    // Never evict the endpoint of peer_nic_path, including ones inserted
+    // after it is deleted
+    virtual void pinEndpoint(const std::string &peer_nic_path) = 0;
+    // @return false if every endpoint is pinned
+    virtual bool evictEndpoint() = 0;
     virtual void reclaimEndpoint() = 0;
     virtual size_t getSize() = 0;
 
@@ -50,6 +56,15 @@ class EndpointStore {
 
     // Get the total number of QPs across all endpoints
     virtual size_t getTotalQPNumber() = 0;
+
+    // Bumped whenever an endpoint leaves the store, so that lookups cached
+    // outside of it can tell they are stale
+    uint64_t version() const {
+        return version_.load(std::memory_order_acquire);
+    }
+
+   protected:
+    std::atomic<uint64_t> version_{0};
 };
 
 // FIFO
@@ -61,7 +76,8 @@ class FIFOEndpointStore : public EndpointStore {
     std::shared_ptr<RdmaEndPoint> insertEndpoint(
         const std::string &peer_nic_path, RdmaContext *context) override;
     int deleteEndpoint(const std::string &peer_nic_path) override;
-    void evictEndpoint() override;
+    void pinEndpoint(const std::string &peer_nic_path) override;
+    bool evictEndpoint() override;
     void reclaimEndpoint() override;
     size_t getSize() override;
 
@@ -78,6 +94,7 @@ class FIFOEndpointStore : public EndpointStore {
     std::list<std::string> fifo_list_;
 
     std::unordered_set<std::shared_ptr<RdmaEndPoint>> waiting_list_;
+    std::unordered_set<std::string> pinned_set_;
 
     size_t max_size_;
 };
@@ -92,7 +109,8 @@ class SIEVEEndpointStore : public EndpointStore {
     std::shared_ptr<RdmaEndPoint> insertEndpoint(
         const std::string &peer_nic_path, RdmaContext *context) override;
     int deleteEndpoint(const std::string &peer_nic_path) override;
-    void evictEndpoint() override;
+    void pinEndpoint(const std::string &peer_nic_path) override;
+    bool evictEndpoint() override;
     void reclaimEndpoint() override;
     size_t getSize() override;
 
@@ -114,9 +132,52 @@ class SIEVEEndpointStore : public EndpointStore {
 
     std::unordered_set<std::shared_ptr<RdmaEndPoint>> waiting_list_;
     std::atomic<int> waiting_list_len_;
+    std::unordered_set<std::string> pinned_set_;
 
     size_t max_size_;
 };
+
+// Spreads endpoints over independent stores by the hash of the peer NIC
+// path, so that submitting threads only contend with evictions of their own
+// shard. Each shard evicts from itself when it fills up. The last endpoint
+// found by each thread is cached and reused until its shard changes.
+class ShardedEndpointStore : public EndpointStore {
+   public:
+    explicit ShardedEndpointStore(
+        std::vector<std::shared_ptr<EndpointStore>> shards);
+    std::shared_ptr<RdmaEndPoint> getEndpoint(
+        const std::string &peer_nic_path) override;
+    std::shared_ptr<RdmaEndPoint> insertEndpoint(
+        const std::string &peer_nic_path, RdmaContext *context) override;
+    int deleteEndpoint(const std::string &peer_nic_path) override;
+    void pinEndpoint(const std::string &peer_nic_path) override;
+    // There is no store-wide victim, see above
+    bool evictEndpoint() override { return false; }
+    void reclaimEndpoint() override;
+    size_t getSize() override;
+
+    int destroyQPs() override;
+    int disconnectQPs() override;
+
+    size_t getTotalQPNumber() override;
+
+   private:
+    EndpointStore &shardOf(const std::string &peer_nic_path) {
+        return *shards_[std::hash<std::string>{}(peer_nic_path) %
+                        shards_.size()];
+    }
+
+    std::vector<std::shared_ptr<EndpointStore>> shards_;
+    // Tells thread-local cache entries of different stores apart
+    const uint64_t id_;
+};
+
+// Creates a store of |type| holding up to |max_size| endpoints, sharded in
+// up to |num_shards| parts. Small stores are not sharded, as that would
+// evict much earlier than |max_size| under skewed traffic.
+std::shared_ptr<EndpointStore> createEndpointStore(EndpointStoreType type,
+                                                   size_t max_size,
+                                                   size_t num_shards);
 }  // namespace mooncake
 
 #endif
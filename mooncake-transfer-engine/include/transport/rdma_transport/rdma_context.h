@@ -24,11 +24,14 @@
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "common.h"
+#include "rdma_metrics.h"
 #include "rdma_transport.h"
 #include "transport/transport.h"
 
@@ -86,10 +89,21 @@ class RdmaContext {
 
     uint32_t lkey(void *addr);
 
+    // Host memory is registered with on-demand paging instead of pinned
+    bool odpEnabled() const;
+
+    // Whether the device runs FETCH_ADD and COMPARE_SWAP. ODP MRs only take
+    // them if the device also supports atomics on those.
+    bool atomicsSupported() const { return atomics_supported_; }
+
    private:
     int registerMemoryRegionInternal(void *addr, size_t length, int access,
                                      MemoryRegionMeta &mrMeta);
 
+    // ibv_reg_mr for host memory, as an ODP MR when enabled, falling back to
+    // a pinned MR if the ODP registration fails
+    ibv_mr *registerHostMemory(void *addr, size_t length, int access);
+
    public:
     bool active() const { return active_; }
 
@@ -101,6 +115,9 @@ class RdmaContext {
 
     int deleteEndpoint(const std::string &peer_nic_path);
 
+    // Exempts the endpoint of peer_nic_path from eviction
+    void pinEndpoint(const std::string &peer_nic_path);
+
     int disconnectAllEndpoints();
 
     // Get the total number of QPs across all endpoints in this context
@@ -126,6 +143,9 @@ class RdmaContext {
 
     ibv_pd *pd() const { return pd_; }
 
+    // Receive queue shared by all QPs, or nullptr if each QP has its own
+    ibv_srq *srq() const { return srq_; }
+
     uint8_t portNum() const { return port_; }
 
     int activeSpeed() const { return active_speed_; }
@@ -140,6 +160,8 @@ class RdmaContext {
 
     ibv_cq *cq();
 
+    ibv_cq *cq(int cq_index) const { return cq_list_[cq_index].native; }
+
     volatile int *cqOutstandingCount(int cq_index) {
         return &cq_list_[cq_index].outstanding;
     }
@@ -164,13 +186,78 @@ class RdmaContext {
    public:
     int submitPostSend(const std::vector<Transport::Slice *> &slice_list);
 
+    // Bytes submitted to this device and still in flight
+    uint64_t outstandingBytes() const;
+
+    // Bytes this device transferred successfully since it was constructed
+    uint64_t transferredBytes() const;
+
+    // Work requests posted to the CQs of this device and not completed yet
+    uint64_t outstandingWorkRequests() const;
+
+    RdmaDeviceCounters &counters() { return counters_; }
+
+    const RdmaDeviceCounters &counters() const { return counters_; }
+
+   public:
+    // Notifies sent as SEND_WITH_IMM (MC_RDMA_NOTIFY_IMM). They are copied
+    // into registered slots and received into slots posted on the shared
+    // receive queue. Their WRs carry an odd wr_id, while slices are aligned
+    // pointers, which tells their completions apart in the CQ poll.
+    static bool isNotifyWorkRequest(uint64_t wr_id) { return wr_id & 1; }
+
+    bool notifyEnabled() const { return notify_mr_ != nullptr; }
+
+    // The endpoint of peer_nic_path if it exists, never creating one
+    std::shared_ptr<RdmaEndPoint> findEndpoint(
+        const std::string &peer_nic_path);
+
+    // Posts the encoded notify on the connected endpoint; fails when the
+    // notify does not fit a slot or all send slots are in flight
+    int postNotify(RdmaEndPoint &endpoint, const std::string &payload);
+
+    // Completes a notify WR. Received notifies are handed to the engine and
+    // their slot is posted again.
+    void completeNotify(const ibv_wc &wc);
+
+   private:
+    int setupNotifySlots();
+
+    int postNotifyRecv(int slot);
+
+    char *notifySlot(int slot) const {
+        return notify_buffer_ + (size_t)slot * kNotifySlotSize;
+    }
+
+    static const int kNotifyRecvSlots = 64;
+    static const int kNotifySendSlots = 64;
+    static const size_t kNotifySlotSize = 4096;
+    // Immediate data of notifies, dropping stray SENDs of other software
+    static const uint32_t kNotifyImmData = 0x4d434e54;
+
+    struct NotifySend {
+        volatile int *qp_depth = nullptr;
+        volatile int *cq_outstanding = nullptr;
+    };
+
+    char *notify_buffer_ = nullptr;
+    ibv_mr *notify_mr_ = nullptr;
+    std::mutex notify_mutex_;
+    // Indexed by slot - kNotifyRecvSlots
+    std::vector<NotifySend> notify_sends_;
+    std::vector<int> free_notify_sends_;
+
    private:
     const std::string device_name_;
     RdmaTransport &engine_;
 
     ibv_context *context_ = nullptr;
     ibv_pd *pd_ = nullptr;
+    ibv_srq *srq_ = nullptr;
     uint64_t max_mr_size;
+    bool odp_supported_ = false;
+    bool odp_atomics_supported_ = false;
+    bool atomics_supported_ = false;
     int event_fd_ = -1;
 
     size_t num_comp_channel_ = 0;
@@ -198,6 +285,8 @@ class RdmaContext {
 
     std::shared_ptr<WorkerPool> worker_pool_;
 
+    RdmaDeviceCounters counters_;
+
     volatile bool active_;
 };
 
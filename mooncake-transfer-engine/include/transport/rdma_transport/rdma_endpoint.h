@@ -107,8 +107,17 @@ class RdmaEndPoint {
     // Submit some work requests to HW
     // Submitted tasks (success/failed) are removed in slice_list
     // Failed tasks (which must be submitted) are inserted in failed_slice_list
+    // Urgent slices go to the QP kept for them if rdma_priority_qp is set
     int submitPostSend(std::vector<Transport::Slice *> &slice_list,
-                       std::vector<Transport::Slice *> &failed_slice_list);
+                       std::vector<Transport::Slice *> &failed_slice_list,
+                       bool urgent = false);
+
+    // Posts one signaled SEND_WITH_IMM of sge, for RdmaContext::postNotify.
+    // Fails when the endpoint is not connected or its queues are full; on
+    // success the WR is counted in qp_depth and cq_outstanding, which its
+    // completion decrements.
+    int postSendNotify(const ibv_sge &sge, uint64_t wr_id, uint32_t imm_data,
+                       volatile int *&qp_depth, volatile int *&cq_outstanding);
 
     // Get the number of QPs in this endpoint
     size_t getQPNumber() const;
@@ -135,6 +144,7 @@ class RdmaEndPoint {
 
     volatile int *wr_depth_list_;
     int max_wr_depth_;
+    uint32_t max_inline_bytes_;
 
     volatile bool active_;
     volatile int *cq_outstanding_;
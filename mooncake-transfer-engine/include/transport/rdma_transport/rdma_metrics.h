@@ -0,0 +1,92 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RDMA_METRICS_H
+#define RDMA_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mooncake {
+
+// Counters of the work requests one RDMA device posts and completes. They
+// are updated with relaxed atomics on the post and poll paths and read by
+// the metrics exporter only.
+struct RdmaDeviceCounters {
+    // Upper bounds of the CQ poll batch size buckets; a last bucket holds
+    // larger batches
+    static constexpr std::array<uint32_t, 7> kPollBatchBounds = {
+        1, 2, 4, 8, 16, 32, 64};
+
+    std::atomic<uint64_t> post_calls{0};
+    std::atomic<uint64_t> posted_wrs{0};
+    std::atomic<uint64_t> post_failures{0};
+    // Time spent in ibv_post_send
+    std::atomic<uint64_t> post_latency_ns{0};
+
+    // Polls that returned at least one completion, and the number returned
+    std::atomic<uint64_t> poll_calls{0};
+    std::atomic<uint64_t> polled_cqes{0};
+    std::array<std::atomic<uint64_t>, kPollBatchBounds.size() + 1>
+        poll_batch_buckets{};
+
+    void recordPost(uint64_t wr_count, uint64_t latency_ns, bool failed) {
+        post_calls.fetch_add(1, std::memory_order_relaxed);
+        posted_wrs.fetch_add(wr_count, std::memory_order_relaxed);
+        post_latency_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+        if (failed) post_failures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordPoll(uint32_t nr_poll) {
+        if (nr_poll == 0) return;
+        poll_calls.fetch_add(1, std::memory_order_relaxed);
+        polled_cqes.fetch_add(nr_poll, std::memory_order_relaxed);
+        size_t bucket = 0;
+        while (bucket < kPollBatchBounds.size() &&
+               nr_poll > kPollBatchBounds[bucket])
+            ++bucket;
+        poll_batch_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Per TransferRequest::Priority: slices completed successfully, their
+    // bytes, and their time from posting to completion
+    static constexpr size_t kPriorityClasses = 2;
+    std::array<std::atomic<uint64_t>, kPriorityClasses> class_slices{};
+    std::array<std::atomic<uint64_t>, kPriorityClasses> class_bytes{};
+    std::array<std::atomic<uint64_t>, kPriorityClasses> class_latency_ns{};
+
+    void recordCompletion(int priority, uint64_t bytes, uint64_t latency_ns) {
+        if (priority < 0 || (size_t)priority >= kPriorityClasses) return;
+        class_slices[priority].fetch_add(1, std::memory_order_relaxed);
+        class_bytes[priority].fetch_add(bytes, std::memory_order_relaxed);
+        class_latency_ns[priority].fetch_add(latency_ns,
+                                             std::memory_order_relaxed);
+    }
+};
+
+// Reads the hardware counters the driver exposes for a port under
+// /sys/class/infiniband/<device>/ports/<port>/, both the standard
+// `counters` and the vendor `hw_counters` (such as out_of_sequence,
+// packet_seq_err and np_cnp_sent on mlx5), by file name. Files that are
+// not a single integer are skipped. Empty if neither directory exists.
+std::vector<std::pair<std::string, uint64_t>> readRdmaPortCounters(
+    const std::string &device_name, uint8_t port);
+
+}  // namespace mooncake
+
+#endif  // RDMA_METRICS_H
@@ -29,6 +29,7 @@
 
 #include "topology.h"
 #include "transfer_metadata.h"
+#include "transport/rdma_transport/slice_size_tuner.h"
 #include "transport/transport.h"
 
 namespace mooncake {
@@ -59,6 +60,15 @@ class RdmaTransport : public Transport {
 
     const char *getName() const override { return "rdma"; }
 
+    bool supportsScatterGather() const override { return true; }
+
+    // Mapped to IB atomics, if any local device supports them
+    bool supportsAtomics() const override;
+
+    // Sends notify as a SEND_WITH_IMM over an endpoint already connected to
+    // the target, which must advertise rdma_notify_imm in its segment
+    int sendNotify(SegmentID target_id, const NotifyDesc &notify) override;
+
     int registerLocalMemory(void *addr, size_t length,
                             const std::string &location, bool remote_accessible,
                             bool update_metadata) override;
@@ -71,6 +81,18 @@ class RdmaTransport : public Transport {
     int unregisterLocalMemoryBatch(
         const std::vector<void *> &addr_list) override;
 
+    // Bytes each local device transferred successfully, by device name
+    std::vector<std::pair<std::string, uint64_t>> getDeviceTransferredBytes()
+        const;
+
+    // Per-device traffic, work request and CQ poll counters, together with
+    // the port counters of the driver, in the Prometheus text format
+    std::string getPrometheusMetrics() const;
+
+    // The context of a local device, or null if it is not used
+    std::shared_ptr<RdmaContext> getContext(
+        const std::string &device_name) const;
+
    private:
     // Internal version with force_sequential option to avoid nested parallelism
     int registerLocalMemoryInternal(void *addr, size_t length,
@@ -98,9 +120,17 @@ class RdmaTransport : public Transport {
 
     SegmentID getSegmentID(const std::string &segment_name);
 
+    int preconnectSegments(const std::vector<SegmentID> &target_ids,
+                           bool pin) override;
+
    private:
     int allocateLocalSegmentID();
 
+    // Queues a notify received by a context for getNotifies()
+    void deliverNotify(NotifyDesc &&notify) {
+        metadata_->addNotify(std::move(notify));
+    }
+
     int preTouchMemory(void *addr, size_t length);
 
    public:
@@ -126,9 +156,35 @@ class RdmaTransport : public Transport {
                             std::string_view hint, int &buffer_id,
                             int &device_id, int retry_cnt = 0);
 
+    // A contiguous block of a request, in both address spaces
+    struct Block {
+        char *source;
+        uint64_t target;
+        size_t length;
+    };
+
+    // A slice to post: a part of blocks[first_block], or |block_count|
+    // blocks from it on that are adjacent on the target side, one SGE each
+    struct SliceSpec {
+        char *source;
+        uint64_t target;
+        size_t length;
+        size_t first_block;
+        size_t block_count;
+    };
+
+    // Cuts blocks into slices of slice_size bytes, the last one taking up
+    // to fragment_limit more. Up to max_sge adjacent blocks that fit in a
+    // slice together are gathered into one
+    static void buildSliceSpecs(const std::vector<Block> &blocks,
+                                size_t slice_size, size_t fragment_limit,
+                                size_t max_sge, std::vector<SliceSpec> &specs);
+
    private:
     std::vector<std::shared_ptr<RdmaContext>> context_list_;
     std::shared_ptr<Topology> local_topology_;
+    // Null unless rdma_auto_slice is set
+    std::unique_ptr<SliceSizeTuner> slice_size_tuner_;
 };
 
 using TransferRequest = Transport::TransferRequest;
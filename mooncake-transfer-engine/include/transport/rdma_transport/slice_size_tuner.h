@@ -0,0 +1,85 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLICE_SIZE_TUNER_H
+#define SLICE_SIZE_TUNER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "common.h"
+
+namespace mooncake {
+
+// Chooses the slice size of RDMA requests per target segment. Completions
+// of each peer feed two estimates: its round trip time, the lowest latency
+// seen recently, and its bandwidth, the highest rate at which its bytes
+// completed over a window of kWindowNs, decaying slowly. Slices of a peer
+// are as large as its bandwidth-delay product, rounded down to a power of
+// two and kept within the configured bounds, so fast or distant links get
+// fewer larger work requests and lightly used ones small slices. A request
+// too small to give every rail a slice of that size is cut into one slice
+// per rail instead, down to the lower bound. Estimates are updated with
+// relaxed atomics, so a lost sample only delays convergence.
+class SliceSizeTuner {
+   public:
+    // Completions a peer needs before its own estimate is used
+    static constexpr uint64_t kWarmupSamples = 16;
+    static constexpr uint64_t kWindowNs = 1000000;
+
+    SliceSizeTuner(size_t min_size, size_t max_size, size_t default_size);
+
+    // Slice size of a request of length bytes to target_id whose slices are
+    // spread over rail_count devices
+    size_t sliceSize(uint64_t target_id, size_t length,
+                     size_t rail_count) const;
+
+    // Records that bytes posted to target_id at posted_ns completed at
+    // completed_ns, both from getCurrentTimeInNano()
+    void record(uint64_t target_id, uint64_t bytes, uint64_t posted_ns,
+                uint64_t completed_ns);
+
+    // Current per-peer slice size, or the default without enough samples
+    size_t peerSliceSize(uint64_t target_id) const;
+
+   private:
+    struct PeerEstimate {
+        std::atomic<uint64_t> samples{0};
+        std::atomic<uint64_t> rtt_ns{0};
+        // Bytes per microsecond
+        std::atomic<uint64_t> bandwidth{0};
+        std::atomic<uint64_t> window_start_ns{0};
+        std::atomic<uint64_t> window_bytes{0};
+        std::atomic<size_t> slice_size{0};
+    };
+
+    PeerEstimate *findPeer(uint64_t target_id) const;
+
+    size_t clamp(size_t size) const;
+
+   private:
+    const size_t min_size_;
+    const size_t max_size_;
+    const size_t default_size_;
+
+    mutable RWSpinlock peers_lock_;
+    std::unordered_map<uint64_t, std::unique_ptr<PeerEstimate>> peers_;
+};
+
+}  // namespace mooncake
+
+#endif  // SLICE_SIZE_TUNER_H
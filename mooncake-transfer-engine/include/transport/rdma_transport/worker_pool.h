@@ -30,10 +30,41 @@ class WorkerPool {
     // Add slices to queue, called by Transport
     int submitPostSend(const std::vector<Transport::Slice *> &slice_list);
 
+    // Bytes of the slices submitted to this device that have neither
+    // completed nor failed yet
+    uint64_t outstandingBytes() const {
+        uint64_t processed = processed_bytes_.load(std::memory_order_relaxed);
+        uint64_t submitted = submitted_bytes_.load(std::memory_order_relaxed);
+        return submitted > processed ? submitted - processed : 0;
+    }
+
+    // Bytes of the slices this device transferred successfully
+    uint64_t transferredBytes() const {
+        return transferred_bytes_.load(std::memory_order_relaxed);
+    }
+
    private:
     void performPostSend(int thread_id);
 
-    void performPollCq(int thread_id);
+    using SliceList = std::vector<Transport::Slice *>;
+
+    // Posts the slices of queue, keyed by peer NIC path, to their endpoints
+    void postSlices(std::unordered_map<std::string, SliceList> &queue,
+                    SliceList &failed_slice_list, bool urgent);
+
+    // Local queue of thread_id for the priority class of slice
+    std::unordered_map<std::string, SliceList> &localQueue(
+        int thread_id, Transport::Slice *slice);
+
+    void stealSlices(int thread_id);
+
+    // @return The number of completions polled
+    int performPollCq(int thread_id);
+
+    // Sleep until a CQ of thread_id has a completion or slices are submitted
+    void waitCqEvents(int thread_id);
+
+    void wakeCqWaiters();
 
     void redispatch(std::vector<Transport::Slice *> &slice_list, int thread_id);
 
@@ -56,17 +87,30 @@ class WorkerPool {
     std::mutex cond_mutex_;
     std::condition_variable cond_var_;
 
-    using SliceList = std::vector<Transport::Slice *>;
-
     const static int kShardCount = 8;
     std::unordered_map<std::string, SliceList> slice_queue_[kShardCount];
     std::atomic<uint64_t> slice_queue_count_[kShardCount];
+    // Slices of TransferRequest::HIGH requests, queued apart so that they
+    // are posted ahead of the others; guarded by slice_queue_lock_ too
+    std::unordered_map<std::string, SliceList>
+        urgent_slice_queue_[kShardCount];
+    std::atomic<uint64_t> urgent_slice_queue_count_[kShardCount];
     TicketLock slice_queue_lock_[kShardCount];
 
     std::vector<std::unordered_map<std::string, SliceList>>
         collective_slice_queue_;
+    std::vector<std::unordered_map<std::string, SliceList>>
+        collective_urgent_slice_queue_;
+    // Rounds each worker held the normal class back for urgent slices
+    std::vector<int> urgent_rounds_;
 
     std::atomic<uint64_t> submitted_slice_count_, processed_slice_count_;
+    std::atomic<uint64_t> submitted_bytes_, processed_bytes_;
+    std::atomic<uint64_t> transferred_bytes_;
+
+    // Per-worker eventfds waking waitCqEvents()
+    std::vector<int> cq_wake_fd_;
+    std::atomic<int> cq_waiting_count_;
 
     uint64_t success_nr_polls = 0, failed_nr_polls = 0;
 };
@@ -30,6 +30,16 @@ struct RpcResult {
     std::string err_msg;
 };
 
+// Sent instead of the payload when it moves through the transfer engine
+struct TensorDescriptor {
+    std::string segment_name;
+    uint64_t addr = 0;
+    uint64_t length = 0;
+};
+
+class TransferEngine;
+class StagingBuffer;
+
 class RpcCommunicator {
    public:
     RpcCommunicator();
@@ -59,6 +69,19 @@ class RpcCommunicator {
     void setDataReceiveCallback(
         std::function<void(std::string_view, std::string_view)> callback);
 
+    // Moves payloads of at least |threshold| bytes through |engine| rather
+    // than RPC attachments: the sender only sends a descriptor and the
+    // receiver reads the payload into its staging buffer of |staging_size|
+    // bytes. Payloads outside the registered memory of the sender are
+    // copied into its own staging buffer first. Both peers must enable it,
+    // otherwise and on any failure the attachment path is used.
+    // |segment_name| defaults to the RPC address of the engine, which must
+    // outlive the communicator.
+    bool enableTransferEngine(TransferEngine* engine,
+                              const std::string& segment_name = "",
+                              size_t staging_size = 256ull << 20,
+                              size_t threshold = 1ull << 20);
+
    private:
     // Handler methods for RPC calls
     void handleDataTransfer(coro_rpc::context<void> context,
@@ -67,6 +90,15 @@ class RpcCommunicator {
     void handleDataTransferWithAttachment(coro_rpc::context<void> context,
                                           std::string_view data);
     void handleTensorTransferWithAttachment(coro_rpc::context<void> context);
+    // Reads the payload described by |desc| and returns 0 once delivered
+    async_simple::coro::Lazy<int> handleTensorPull(TensorDescriptor desc);
+
+    // Returns -1 if the payload has to be sent as an attachment instead
+    async_simple::coro::Lazy<int> sendThroughEngineAsync(
+        const std::string& target_address, const void* data,
+        size_t data_size);
+
+    bool isRegistered(const void* data, size_t data_size);
 
     // Implementation members
     RpcCommunicatorConfig config_;
@@ -77,6 +109,11 @@ class RpcCommunicator {
     pybind11::handle py_callback_;
     std::shared_ptr<coro_io::client_pools<coro_rpc::coro_rpc_client>>
         client_pools_;
+
+    TransferEngine* engine_ = nullptr;
+    std::string segment_name_;
+    size_t zero_copy_threshold_ = 0;
+    std::unique_ptr<StagingBuffer> staging_;
 };
 
 }  // namespace mooncake
\ No newline at end of file
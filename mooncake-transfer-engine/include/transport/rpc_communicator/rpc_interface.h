@@ -67,6 +67,12 @@ class RpcInterface {
                                      pybind11::handle tensor,
                                      pybind11::handle loop);
 
+    // See RpcCommunicator::enableTransferEngine, |engine_ptr| is
+    // TransferEngine.get_engine_ptr()
+    bool enableTransferEngine(uintptr_t engine_ptr,
+                              const std::string& segment_name,
+                              size_t staging_size, size_t threshold);
+
     void setDataReceiveCallback(pybind11::function callback);
     void setTensorReceiveCallback(pybind11::function callback);
 
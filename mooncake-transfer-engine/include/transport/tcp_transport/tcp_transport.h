@@ -80,10 +80,18 @@ class TcpTransport : public Transport {
 
     void worker();
 
-    void startTransfer(Slice *slice);
+    // Splits request into the slices of task and starts them
+    void submitSlices(const TransferRequest &request, TransferTask &task);
+
+    // Sends slice over an idle connection of its peer if reuse is set and
+    // one is available, or over a new connection otherwise
+    void startTransfer(Slice *slice, bool reuse = true);
 
     const char *getName() const override { return "tcp"; }
 
+    // Emulated by the peer, which runs them on its host memory
+    bool supportsAtomics() const override { return true; }
+
    private:
     TcpContext *context_;
     std::atomic_bool running_;
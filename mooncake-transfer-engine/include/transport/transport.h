@@ -31,6 +31,10 @@
 #include <mutex>
 #include <condition_variable>
 
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include "common/base/status.h"
 #include "transfer_metadata.h"
 
@@ -56,7 +60,13 @@ class Transport {
     using NotifyDesc = TransferMetadata::NotifyDesc;
 
     struct TransferRequest {
-        enum OpCode { READ, WRITE };
+        // FETCH_ADD and COMPARE_SWAP act atomically on the 8 aligned bytes
+        // at target_offset and store their previous value at source, which
+        // must be 8 aligned and registered like any source; length is 8
+        enum OpCode { READ, WRITE, FETCH_ADD, COMPARE_SWAP };
+        // HIGH requests are latency sensitive: the RDMA transport queues
+        // and posts their slices ahead of NORMAL ones
+        enum Priority { NORMAL, HIGH };
 
         OpCode opcode;
         void *source;
@@ -64,6 +74,69 @@ class Transport {
         uint64_t target_offset;
         size_t length;
         int advise_retry_cnt = 0;
+        Priority priority = NORMAL;
+
+        // Non-contiguous layouts moved by a single request, e.g. the pages
+        // of a paged KV cache. |length| is the total in every layout.
+        //
+        // Strided: |block_count| blocks of |block_length| bytes, block i at
+        // source + i * source_stride and target_offset + i * target_stride.
+        size_t block_count = 0;
+        size_t block_length = 0;
+        uint64_t source_stride = 0;
+        uint64_t target_stride = 0;
+        // Gather/scatter: local blocks moved to or from consecutive bytes
+        // from target_offset on; |source| is unused. The list is only read
+        // during submitTransfer().
+        const struct iovec *source_iov = nullptr;
+        size_t source_iov_count = 0;
+
+        // Operands of atomic requests: FETCH_ADD adds compare_add, and
+        // COMPARE_SWAP stores swap if the value equals compare_add
+        uint64_t compare_add = 0;
+        uint64_t swap = 0;
+
+        bool isAtomic() const {
+            return opcode == FETCH_ADD || opcode == COMPARE_SWAP;
+        }
+
+        bool isContiguous() const {
+            return block_count == 0 && source_iov_count == 0;
+        }
+
+        // Bytes from target_offset to the end of the last block
+        uint64_t targetSpan() const {
+            if (block_count == 0) return length;
+            return (block_count - 1) * target_stride + block_length;
+        }
+
+        bool validLayout() const {
+            if (block_count && source_iov_count) return false;
+            if (block_count) return block_count * block_length == length;
+            size_t total = 0;
+            for (size_t i = 0; i < source_iov_count; ++i)
+                total += source_iov[i].iov_len;
+            return source_iov_count == 0 || total == length;
+        }
+
+        // Calls fn(source, target_offset, length) for each contiguous block
+        template <typename Fn>
+        void forEachBlock(Fn &&fn) const {
+            if (source_iov_count) {
+                uint64_t target = target_offset;
+                for (size_t i = 0; i < source_iov_count; ++i) {
+                    fn((char *)source_iov[i].iov_base, target,
+                       source_iov[i].iov_len);
+                    target += source_iov[i].iov_len;
+                }
+            } else if (block_count) {
+                for (size_t i = 0; i < block_count; ++i)
+                    fn((char *)source + i * source_stride,
+                       target_offset + i * target_stride, block_length);
+            } else {
+                fn((char *)source, target_offset, length);
+            }
+        }
     };
 
     enum TransferStatusEnum {
@@ -107,12 +180,20 @@ class Transport {
         void *source_addr;
         size_t length;
         TransferRequest::OpCode opcode;
+        TransferRequest::Priority priority;
         SegmentID target_id;
         std::string peer_nic_path;
         SliceStatus status;
         TransferTask *task;
         std::vector<uint32_t> dest_rkeys;
         bool from_cache;
+        // Local blocks of a slice that gathers several into one WR (or
+        // scatters into them), all under the same lkey. Empty when the
+        // slice is the |length| bytes at source_addr
+        std::vector<std::pair<void *, size_t>> local_blocks;
+        // Operands of FETCH_ADD and COMPARE_SWAP slices
+        uint64_t compare_add;
+        uint64_t swap;
 
         union {
             struct {
@@ -124,6 +205,10 @@ class Transport {
                 volatile int *qp_depth;
                 uint32_t retry_cnt;
                 uint32_t max_retry_cnt;
+                // Unsignaled WRs complete with the next signaled WR of their
+                // post, which links back to them through unsignaled_prev
+                bool signaled;
+                Slice *unsignaled_prev;
             } rdma;
             struct {
                 void *dest_addr;
@@ -172,10 +257,21 @@ class Transport {
 
         volatile int64_t ts;
 
+        // Whether the batch of the slice was canceled, so that the slice
+        // should be failed rather than posted
+        bool isCanceled() const {
+            return toBatchDesc(task->batch_id)
+                .is_canceled.load(std::memory_order_relaxed);
+        }
+
        private:
         inline void check_batch_completion(bool is_failed) {
-#ifdef USE_EVENT_DRIVEN_COMPLETION
             auto &batch_desc = toBatchDesc(task->batch_id);
+#ifndef USE_EVENT_DRIVEN_COMPLETION
+            // Without the build option, only batches whose completion has
+            // been subscribed to are tracked
+            if (!batch_desc.notify_completion) return;
+#endif
             if (is_failed) {
                 batch_desc.has_failure.store(true, std::memory_order_relaxed);
             }
@@ -204,6 +300,12 @@ class Transport {
 
                 // Last task in the batch: wake up waiting thread directly
                 if (prev + 1 == batch_desc.batch_size) {
+                    // The callback runs last and may free the batch, so
+                    // take everything it needs out of the descriptor first
+                    auto callback = std::move(batch_desc.completion_callback);
+                    auto batch_id = batch_desc.id;
+                    bool failed =
+                        batch_desc.has_failure.load(std::memory_order_relaxed);
                     // Publish completion of the entire batch under the same
                     // mutex used by the waiter to avoid lost notifications.
                     //
@@ -213,18 +315,22 @@ class Transport {
                     // make all prior updates visible. For the predicate checked
                     // under the mutex, relaxed would suffice since the mutex
                     // acquire provides the necessary visibility.
+                    //
+                    // Waiters are signalled under the mutex too: freeing the
+                    // batch takes it, so a waiter that saw is_finished cannot
+                    // release the descriptor while it is being signalled.
                     {
                         std::lock_guard<std::mutex> lock(
                             batch_desc.completion_mutex);
                         batch_desc.is_finished.store(true,
                                                      std::memory_order_release);
+                        batch_desc.completion_cv.notify_all();
+                        if (batch_desc.completion_fd >= 0)
+                            eventfd_write(batch_desc.completion_fd, 1);
                     }
-                    // Notify after releasing the lock to avoid waking threads
-                    // only to block again on the mutex.
-                    batch_desc.completion_cv.notify_all();
+                    if (callback) callback(batch_id, failed);
                 }
             }
-#endif
         }
     };
 
@@ -290,9 +396,7 @@ class Transport {
         std::chrono::steady_clock::time_point start_time;
 #endif
 
-#ifdef USE_EVENT_DRIVEN_COMPLETION
         volatile uint64_t completed_slice_count = 0;
-#endif
 
         // record the origin request
 #ifdef USE_ASCEND_HETEROGENEOUS
@@ -322,15 +426,100 @@ class Transport {
         std::atomic<bool> is_finished{
             false};  // Completion flag for wait predicate
         std::atomic<uint64_t> finished_transfer_bytes{0};
+        // Set by cancelBatch; slices that are not posted yet are failed
+        // instead, see Slice::isCanceled
+        std::atomic<bool> is_canceled{false};
 
-#ifdef USE_EVENT_DRIVEN_COMPLETION
-        // Event-driven completion: tracks batch progress and notifies waiters
+        // Event-driven completion: tracks batch progress and notifies waiters.
+        // Always on with USE_EVENT_DRIVEN_COMPLETION, otherwise only once
+        // notify_completion is set, before the first task is submitted.
         std::atomic<uint64_t> finished_task_count{0};
+        bool notify_completion = false;
 
         // Synchronization primitives for direct notification
         std::mutex completion_mutex;
         std::condition_variable completion_cv;
-#endif
+
+        // Optional subscriptions signalled once all batch_size tasks are
+        // finished: an eventfd owned by the batch, and a callback run by the
+        // thread completing the last slice with whether any task failed
+        int completion_fd = -1;
+        std::function<void(BatchID, bool)> completion_callback;
+
+        ~BatchDesc() { resetCompletionNotify(); }
+
+        void resetCompletionNotify() {
+            std::lock_guard<std::mutex> lock(completion_mutex);
+            if (completion_fd >= 0) close(completion_fd);
+            completion_fd = -1;
+            completion_callback = nullptr;
+            notify_completion = false;
+        }
+
+        // Slice lists of the tasks of a previous use of this descriptor,
+        // handed to new tasks so that they do not grow from scratch
+        std::vector<std::vector<Slice *>> spare_slice_lists;
+
+        void recycleSliceList(TransferTask &task) {
+            if (spare_slice_lists.empty()) return;
+            task.slice_list = std::move(spare_slice_lists.back());
+            spare_slice_lists.pop_back();
+        }
+    };
+
+    // Keeps freed batch descriptors of the calling thread for reuse, with
+    // the capacity of their task and slice lists, so that batches allocated
+    // and freed repeatedly do not touch the heap in steady state
+    struct ThreadLocalBatchDescPool {
+        ~ThreadLocalBatchDescPool() {
+            for (auto batch_desc : free_list_) delete batch_desc;
+        }
+
+        BatchDesc *allocate(size_t batch_size) {
+            BatchDesc *batch_desc;
+            if (free_list_.empty()) {
+                batch_desc = new BatchDesc();
+            } else {
+                batch_desc = free_list_.back();
+                free_list_.pop_back();
+                batch_desc->has_failure.store(false, std::memory_order_relaxed);
+                batch_desc->is_finished.store(false, std::memory_order_relaxed);
+                batch_desc->finished_transfer_bytes.store(
+                    0, std::memory_order_relaxed);
+                batch_desc->is_canceled.store(false, std::memory_order_relaxed);
+                batch_desc->finished_task_count.store(
+                    0, std::memory_order_relaxed);
+            }
+            batch_desc->id = BatchID(batch_desc);
+            batch_desc->batch_size = batch_size;
+            batch_desc->task_list.reserve(batch_size);
+            batch_desc->context = NULL;
+            return batch_desc;
+        }
+
+        void deallocate(BatchDesc *batch_desc) {
+            // Large batches would pin too much memory while idle
+            if (free_list_.size() >= kPoolCapacity ||
+                batch_desc->batch_size > kMaxPooledBatchSize) {
+                delete batch_desc;
+                return;
+            }
+            batch_desc->resetCompletionNotify();
+            auto &spare_slice_lists = batch_desc->spare_slice_lists;
+            for (auto &task : batch_desc->task_list) {
+                for (auto &slice : task.slice_list)
+                    Transport::getSliceCache().deallocate(slice);
+                task.slice_list.clear();
+                if (spare_slice_lists.size() < kMaxPooledBatchSize)
+                    spare_slice_lists.push_back(std::move(task.slice_list));
+            }
+            batch_desc->task_list.clear();
+            free_list_.push_back(batch_desc);
+        }
+
+        const static size_t kPoolCapacity = 64;
+        const static size_t kMaxPooledBatchSize = 1024;
+        std::vector<BatchDesc *> free_list_;
     };
 
    public:
@@ -373,6 +562,36 @@ class Transport {
     }
     virtual Status CheckStatus(SegmentID sid) { return Status::OK(); }
 
+    // Establishes the connections later transfers to target_ids would need,
+    // so that their first transfer does not pay for the handshake. When pin
+    // is set, these connections are never evicted. Transports without
+    // connection state ignore it.
+    virtual int preconnectSegments(const std::vector<SegmentID> &target_ids,
+                                   bool pin) {
+        return 0;
+    }
+
+    // Whether every task of this transport finishes through
+    // Slice::markSuccess() or Slice::markFailed(), which is what signals the
+    // completion of batches subscribed to with notify_completion.
+    virtual bool supportsCompletionNotify() const { return true; }
+
+    // Whether submitTransferTask() takes strided and gather/scatter
+    // requests. MultiTransport submits the blocks of such requests one by
+    // one to the transports that do not.
+    virtual bool supportsScatterGather() const { return false; }
+
+    // Whether submitTransferTask() takes FETCH_ADD and COMPARE_SWAP
+    // requests; MultiTransport rejects them for the transports that do not
+    virtual bool supportsAtomics() const { return false; }
+
+    // Sends notify to the target over the data path of this transport, e.g.
+    // when its transfers complete. Returns non-zero when it cannot, and the
+    // RPC of the metadata is used instead.
+    virtual int sendNotify(SegmentID target_id, const NotifyDesc &notify) {
+        return ERR_NOT_IMPLEMENTED;
+    }
+
    protected:
     virtual int install(std::string &local_server_name,
                         std::shared_ptr<TransferMetadata> meta,
@@ -386,6 +605,8 @@ class Transport {
 
     static ThreadLocalSliceCache &getSliceCache();
 
+    static ThreadLocalBatchDescPool &getBatchDescPool();
+
    private:
     virtual int registerLocalMemory(void *addr, size_t length,
                                     const std::string &location,
@@ -1,7 +1,14 @@
 #include "cuda_alike.h"
 #include <sys/types.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // ref: http://github.com/NVIDIA/nccl/blob/v2.28.9-1/src/allocator.cc#L53-L68
 static CUresult cuMemCreateTryFabric(CUmemGenericAllocationHandle *handle,
@@ -19,6 +26,123 @@ static CUresult cuMemCreateTryFabric(CUmemGenericAllocationHandle *handle,
 
 enum class MemoryBackendType { use_cudamalloc, use_cumemcreate, unknown };
 
+namespace {
+
+struct Chunk {
+    CUmemGenericAllocationHandle handle;
+    size_t size;
+    int device;
+};
+
+// Creating, reserving, mapping and granting access to an allocation takes
+// from hundreds of microseconds to milliseconds, paid each time the caching
+// allocator of PyTorch grows. Freed chunks are kept with their physical
+// memory, mapping and access rights, and handed out again to allocations of
+// the same size class on the same device. Each chunk keeps a reservation of
+// its own: the NVLink transport registers the range cuMemGetAddressRange
+// returns with the fabric handle of a single allocation.
+//
+// At most MC_NVLINK_ALLOC_CACHE_MB (default 2048, 0 disables caching) MiB
+// are kept per process; they are released when cuMemCreate runs out of
+// memory.
+class ChunkPool {
+   public:
+    ChunkPool() {
+        const char *env = std::getenv("MC_NVLINK_ALLOC_CACHE_MB");
+        max_cached_bytes_ = (env ? std::strtoull(env, nullptr, 10) : 2048)
+                            << 20;
+    }
+
+    // Rounds up to a multiple of the granularity and of a quarter of the
+    // largest power of two not above size, wasting at most 25%
+    static size_t sizeClass(size_t size, size_t granularity) {
+        size = (size + granularity - 1) / granularity * granularity;
+        if (size == 0) return granularity;
+        size_t step = size_t(1) << (63 - __builtin_clzll(size));
+        step = std::max(step / 4, granularity);
+        return (size + step - 1) / step * step;
+    }
+
+    void *take(int device, size_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cached_.find({device, size});
+        if (it == cached_.end() || it->second.empty()) return nullptr;
+        auto entry = it->second.back();
+        it->second.pop_back();
+        cached_bytes_ -= size;
+        live_[entry.first] = entry.second;
+        return entry.first;
+    }
+
+    void add(void *ptr, const Chunk &chunk) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_[ptr] = chunk;
+    }
+
+    // False if ptr was not allocated by the pool
+    bool put(void *ptr) {
+        Chunk chunk;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = live_.find(ptr);
+            if (it == live_.end()) return false;
+            chunk = it->second;
+            live_.erase(it);
+            if (cached_bytes_ + chunk.size <= max_cached_bytes_) {
+                cached_[{chunk.device, chunk.size}].emplace_back(ptr, chunk);
+                cached_bytes_ += chunk.size;
+                return true;
+            }
+        }
+        destroy(ptr, chunk);
+        return true;
+    }
+
+    // Releases the chunks cached for device, true if there were any
+    bool trim(int device) {
+        std::vector<std::pair<void *, Chunk>> released;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto it = cached_.begin(); it != cached_.end();) {
+                if (it->first.first != device) {
+                    ++it;
+                    continue;
+                }
+                for (auto &entry : it->second) {
+                    cached_bytes_ -= entry.second.size;
+                    released.push_back(entry);
+                }
+                it = cached_.erase(it);
+            }
+        }
+        for (auto &entry : released) destroy(entry.first, entry.second);
+        return !released.empty();
+    }
+
+    static void destroy(void *ptr, const Chunk &chunk) {
+        cuMemUnmap((CUdeviceptr)ptr, chunk.size);
+        cuMemAddressFree((CUdeviceptr)ptr, chunk.size);
+        cuMemRelease(chunk.handle);
+    }
+
+   private:
+    std::mutex mutex_;
+    size_t max_cached_bytes_;
+    size_t cached_bytes_ = 0;
+    std::map<std::pair<int, size_t>, std::vector<std::pair<void *, Chunk>>>
+        cached_;
+    std::unordered_map<void *, Chunk> live_;
+};
+
+// Never destroyed: the CUDA driver may be gone by the time static
+// destructors run
+ChunkPool &chunkPool() {
+    static auto *pool = new ChunkPool();
+    return *pool;
+}
+
+}  // namespace
+
 extern "C" {
 
 MemoryBackendType mc_probe_fabric_support(int device_id) {
@@ -98,10 +222,12 @@ void *mc_nvlink_malloc(ssize_t size, int device, cudaStream_t stream) {
         std::cerr << "cuMemGetAllocationGranularity failed: " << result;
         return nullptr;
     }
-    // fix size
-    size = (size + granularity - 1) & ~(granularity - 1);
-    if (size == 0) size = granularity;
+    size = ChunkPool::sizeClass(size, granularity);
+    ptr = chunkPool().take(device, size);
+    if (ptr) return ptr;
     result = cuMemCreateTryFabric(&handle, size, &prop, 0);
+    if (result == CUDA_ERROR_OUT_OF_MEMORY && chunkPool().trim(device))
+        result = cuMemCreateTryFabric(&handle, size, &prop, 0);
     if (result != CUDA_SUCCESS) {
         std::cerr << "cuMemCreateTryFabric failed: " << result;
         return nullptr;
@@ -135,6 +261,7 @@ void *mc_nvlink_malloc(ssize_t size, int device, cudaStream_t stream) {
         cuMemRelease(handle);
         return nullptr;
     }
+    chunkPool().add(ptr, Chunk{handle, (size_t)size, device});
     return ptr;
 }
 
@@ -142,6 +269,7 @@ void mc_nvlink_free(void *ptr, ssize_t ssize, int device, cudaStream_t stream) {
     CUmemGenericAllocationHandle handle;
     size_t size = 0;
     if (!ptr) return;
+    if (chunkPool().put(ptr)) return;
     auto result = cuMemRetainAllocationHandle(&handle, ptr);
     if (result != CUDA_SUCCESS) {
         std::cerr << "cuMemRetainAllocationHandle failed: " << result << "\n";
@@ -30,6 +30,9 @@ use anyhow::{anyhow, bail, Result};
 use std::ffi::{c_void, CString};
 type BatchID = u64;
 
+// Status code returned when a wait times out
+const BATCH_BUSY: i32 = 4;
+
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub enum OpcodeEnum {
     Read = 0,
@@ -180,16 +183,7 @@ impl TransferEngine {
         batch_id: BatchID,
         requests: &mut [TransferRequest],
     ) -> Result<()> {
-        let mut requests_c: Vec<bindings::transfer_request_t> = vec![];
-        for i in 0..requests.len() {
-            requests_c.push(bindings::transfer_request_t {
-                opcode: requests[i].opcode as i32,
-                source: requests[i].source,
-                target_id: requests[i].target_id,
-                target_offset: requests[i].target_offset,
-                length: requests[i].length,
-            })
-        }
+        let mut requests_c = Self::to_c_requests(requests);
         let ret = unsafe {
             bindings::submitTransfer(self.engine, batch_id, requests_c.as_mut_ptr(), requests.len())
         };
@@ -214,6 +208,120 @@ impl TransferEngine {
         }
     }
 
+    /// Lets wait_batch_transfer sleep on the completion of a batch that has
+    /// no transfer submitted yet, instead of polling it.
+    pub fn enable_batch_completion_notify(&self, batch_id: BatchID) -> Result<()> {
+        let ret = unsafe { bindings::enableBatchCompletionNotify(self.engine, batch_id) };
+        if ret != 0 {
+            bail!("Failed to enable batch completion notify")
+        } else {
+            Ok(())
+        }
+    }
+
+    pub fn get_batch_transfer_status(&self, batch_id: BatchID) -> Result<(i32, u64)> {
+        let mut status = bindings::transfer_status_t {
+            status: 0,
+            transferred_bytes: 0,
+        };
+        let ret = unsafe { bindings::getBatchTransferStatus(self.engine, batch_id, &mut status) };
+        if ret != 0 {
+            bail!("Failed to get batch transfer status")
+        } else {
+            Ok((status.status, status.transferred_bytes))
+        }
+    }
+
+    /// Status of tasks 0..count in a single call.
+    pub fn get_transfer_status_list(
+        &self,
+        batch_id: BatchID,
+        count: usize,
+    ) -> Result<Vec<(i32, u64)>> {
+        let mut status_list = vec![
+            bindings::transfer_status_t {
+                status: 0,
+                transferred_bytes: 0,
+            };
+            count
+        ];
+        let ret = unsafe {
+            bindings::getTransferStatusList(self.engine, batch_id, status_list.as_mut_ptr(), count)
+        };
+        if ret != 0 {
+            bail!("Failed to get transfer status list")
+        } else {
+            Ok(status_list
+                .iter()
+                .map(|status| (status.status, status.transferred_bytes))
+                .collect())
+        }
+    }
+
+    /// Blocks until the batch completes or a task fails. Returns None if
+    /// timeout_ms elapses first; a negative timeout_ms waits without limit.
+    pub fn wait_batch_transfer(
+        &self,
+        batch_id: BatchID,
+        timeout_ms: i64,
+    ) -> Result<Option<(i32, u64)>> {
+        let mut status = bindings::transfer_status_t {
+            status: 0,
+            transferred_bytes: 0,
+        };
+        let ret = unsafe {
+            bindings::waitBatchTransfer(self.engine, batch_id, timeout_ms, &mut status)
+        };
+        match ret {
+            0 => Ok(Some((status.status, status.transferred_bytes))),
+            BATCH_BUSY => Ok(None),
+            _ => bail!("Failed to wait for batch transfer"),
+        }
+    }
+
+    /// submit_transfer and wait_batch_transfer in a single call, for a
+    /// batch that has no transfer submitted yet.
+    pub fn submit_transfer_and_wait(
+        &self,
+        batch_id: BatchID,
+        requests: &mut [TransferRequest],
+        timeout_ms: i64,
+    ) -> Result<Option<(i32, u64)>> {
+        let mut requests_c = Self::to_c_requests(requests);
+        let mut status = bindings::transfer_status_t {
+            status: 0,
+            transferred_bytes: 0,
+        };
+        let ret = unsafe {
+            bindings::submitTransferAndWait(
+                self.engine,
+                batch_id,
+                requests_c.as_mut_ptr(),
+                requests.len(),
+                timeout_ms,
+                &mut status,
+            )
+        };
+        match ret {
+            0 => Ok(Some((status.status, status.transferred_bytes))),
+            BATCH_BUSY => Ok(None),
+            _ => bail!("Failed to submit and wait for transfer"),
+        }
+    }
+
+    fn to_c_requests(requests: &[TransferRequest]) -> Vec<bindings::transfer_request_t> {
+        requests
+            .iter()
+            .map(|request| bindings::transfer_request_t {
+                opcode: request.opcode as i32,
+                source: request.source,
+                target_id: request.target_id,
+                target_offset: request.target_offset,
+                length: request.length,
+            })
+            .collect()
+    }
+
     pub fn free_batch_id(&self, batch_id: BatchID) -> Result<()> {
         let ret = unsafe { bindings::freeBatchID(self.engine, batch_id) };
         if ret != 0 {
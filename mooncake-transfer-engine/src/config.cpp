@@ -122,6 +122,24 @@ void loadGlobalConfig(GlobalConfig &config) {
                 << "Ignore value from environment variable MC_MAX_INLINE";
     }
 
+    const char *wr_signal_interval_env = std::getenv("MC_WR_SIGNAL_INTERVAL");
+    if (wr_signal_interval_env) {
+        size_t val = atoi(wr_signal_interval_env);
+        if (val > 0)
+            config.wr_signal_interval = val;
+        else
+            LOG(WARNING) << "Ignore value from environment variable "
+                            "MC_WR_SIGNAL_INTERVAL";
+    }
+
+    if (std::getenv("MC_SHARED_RQ")) {
+        config.shared_rq = true;
+    }
+
+    if (std::getenv("MC_RDMA_NOTIFY_IMM")) {
+        config.rdma_notify_imm = true;
+    }
+
     const char *mtu_length_env = std::getenv("MC_MTU");
     if (mtu_length_env) {
         size_t val = atoi(mtu_length_env);
@@ -160,16 +178,70 @@ void loadGlobalConfig(GlobalConfig &config) {
                 << "Ignore value from environment variable MC_WORKERS_PER_CTX";
     }
 
+    if (std::getenv("MC_DISABLE_WORK_STEALING")) {
+        config.work_stealing = false;
+    }
+
+    if (std::getenv("MC_DISABLE_RAIL_SPRAY")) {
+        config.rail_spray = false;
+    }
+
+    const char *cq_poll_idle_us_env = std::getenv("MC_CQ_POLL_IDLE_US");
+    if (cq_poll_idle_us_env) {
+        config.cq_poll_idle_us = atoll(cq_poll_idle_us_env);
+    }
+
     const char *slice_size_env = std::getenv("MC_SLICE_SIZE");
     if (slice_size_env) {
         size_t val = atoi(slice_size_env);
-        if (val > 0)
+        if (val > 0) {
             config.slice_size = val;
-        else
+            config.rdma_auto_slice = false;
+        } else
             LOG(WARNING)
                 << "Ignore value from environment variable MC_SLICE_SIZE";
     }
 
+    const char *auto_slice_env = std::getenv("MC_RDMA_AUTO_SLICE");
+    if (auto_slice_env) {
+        config.rdma_auto_slice = atoi(auto_slice_env) != 0;
+    }
+
+    const char *min_slice_size_env = std::getenv("MC_RDMA_MIN_SLICE_SIZE");
+    if (min_slice_size_env) {
+        size_t val = atoll(min_slice_size_env);
+        if (val > 0)
+            config.rdma_min_slice_size = val;
+        else
+            LOG(WARNING) << "Ignore value from environment variable "
+                            "MC_RDMA_MIN_SLICE_SIZE";
+    }
+
+    const char *max_slice_size_env = std::getenv("MC_RDMA_MAX_SLICE_SIZE");
+    if (max_slice_size_env) {
+        size_t val = atoll(max_slice_size_env);
+        if (val >= config.rdma_min_slice_size)
+            config.rdma_max_slice_size = val;
+        else
+            LOG(WARNING) << "Ignore value from environment variable "
+                            "MC_RDMA_MAX_SLICE_SIZE";
+    }
+
+    const char *priority_qp_env = std::getenv("MC_RDMA_PRIORITY_QP");
+    if (priority_qp_env) {
+        config.rdma_priority_qp = atoi(priority_qp_env) != 0;
+    }
+
+    const char *priority_weight_env = std::getenv("MC_RDMA_PRIORITY_WEIGHT");
+    if (priority_weight_env) {
+        int val = atoi(priority_weight_env);
+        if (val >= 0)
+            config.rdma_priority_weight = val;
+        else
+            LOG(WARNING) << "Ignore value from environment variable "
+                            "MC_RDMA_PRIORITY_WEIGHT";
+    }
+
     const char *min_reg_size_env = std::getenv("MC_MIN_REG_SIZE");
     if (min_reg_size_env) {
         size_t val = atoll(min_reg_size_env);
@@ -196,6 +268,14 @@ void loadGlobalConfig(GlobalConfig &config) {
         config.metacache = false;
     }
 
+    if (std::getenv("MC_DISABLE_METACACHE_WATCH")) {
+        config.metacache_watch = false;
+    }
+
+    if (std::getenv("MC_METADATA_BINARY")) {
+        config.metadata_binary = true;
+    }
+
     const char *handshake_listen_backlog =
         std::getenv("MC_HANDSHAKE_LISTEN_BACKLOG");
     if (handshake_listen_backlog) {
@@ -273,6 +353,70 @@ void loadGlobalConfig(GlobalConfig &config) {
                 << "Ignore value from environment variable MC_PRC_MAX_PORT";
     }
 
+    const char *tcp_stripe_size_env = std::getenv("MC_TCP_STRIPE_SIZE");
+    if (tcp_stripe_size_env) {
+        config.tcp_stripe_size = atoll(tcp_stripe_size_env);
+    }
+
+    const char *tcp_conns_per_peer_env = std::getenv("MC_TCP_CONNS_PER_PEER");
+    if (tcp_conns_per_peer_env) {
+        size_t val = atoi(tcp_conns_per_peer_env);
+        if (val > 0 && val <= 64)
+            config.tcp_conns_per_peer = val;
+        else
+            LOG(WARNING) << "Ignore value from environment variable "
+                            "MC_TCP_CONNS_PER_PEER";
+    }
+
+    if (std::getenv("MC_TCP_ZEROCOPY")) {
+        config.tcp_zerocopy = true;
+    }
+
+    if (std::getenv("MC_GPU_MR_CACHE")) {
+        config.gpu_mr_cache = true;
+    }
+
+    const char *gpu_mr_cache_idle_env =
+        std::getenv("MC_GPU_MR_CACHE_IDLE_SIZE");
+    if (gpu_mr_cache_idle_env) {
+        config.gpu_mr_cache_idle_size = atoll(gpu_mr_cache_idle_env);
+    }
+
+    if (std::getenv("MC_MULTI_PATH")) {
+        config.multi_path = true;
+    }
+
+    const char *multi_path_split_env = std::getenv("MC_MULTI_PATH_SPLIT_SIZE");
+    if (multi_path_split_env) {
+        config.multi_path_split_size = atoll(multi_path_split_env);
+    }
+
+    const char *multi_path_ratio_env =
+        std::getenv("MC_MULTI_PATH_NVLINK_RATIO");
+    if (multi_path_ratio_env) {
+        int val = atoi(multi_path_ratio_env);
+        if (val > 0 && val < 100)
+            config.multi_path_nvlink_ratio = val;
+        else
+            LOG(WARNING) << "Ignore value from environment variable "
+                            "MC_MULTI_PATH_NVLINK_RATIO";
+    }
+
+    if (std::getenv("MC_DISABLE_LOCAL_MEMCPY")) {
+        config.local_memcpy = false;
+    }
+
+    const char *local_memcpy_threads_env =
+        std::getenv("MC_LOCAL_MEMCPY_THREADS");
+    if (local_memcpy_threads_env) {
+        int val = atoi(local_memcpy_threads_env);
+        if (val > 0 && val <= 64)
+            config.local_memcpy_threads = val;
+        else
+            LOG(WARNING) << "Ignore value from environment variable "
+                            "MC_LOCAL_MEMCPY_THREADS";
+    }
+
     if (std::getenv("MC_USE_IPV6")) {
         config.use_ipv6 = true;
     }
@@ -305,6 +449,10 @@ void loadGlobalConfig(GlobalConfig &config) {
         }
     }
 
+    if (std::getenv("MC_IB_ODP")) {
+        config.ib_odp = true;
+    }
+
     const char *endpoint_store_type_env = std::getenv("MC_ENDPOINT_STORE_TYPE");
     if (endpoint_store_type_env) {
         if (strcmp(endpoint_store_type_env, "FIFO") == 0) {
@@ -317,6 +465,17 @@ void loadGlobalConfig(GlobalConfig &config) {
         }
     }
 
+    const char *endpoint_store_shards_env =
+        std::getenv("MC_ENDPOINT_STORE_SHARDS");
+    if (endpoint_store_shards_env) {
+        int val = atoi(endpoint_store_shards_env);
+        if (val > 0 && val <= 1024)
+            config.endpoint_store_shards = val;
+        else
+            LOG(WARNING) << "Ignore value from environment variable "
+                            "MC_ENDPOINT_STORE_SHARDS";
+    }
+
     const char *traffic_class_env = std::getenv("MC_IB_TC");
     if (traffic_class_env) {
         try {
@@ -375,6 +534,15 @@ void updateGlobalConfig(ibv_device_attr &device_attr) {
         config.max_cqe = device_attr.max_cqe;
     if (config.max_mr_size > device_attr.max_mr_size)
         config.max_mr_size = device_attr.max_mr_size;
+    if (config.shared_rq && device_attr.max_srq <= 0) {
+        LOG(WARNING) << "Shared receive queues are not supported by device";
+        config.shared_rq = false;
+    }
+    if (config.rdma_notify_imm && !config.shared_rq) {
+        LOG(WARNING) << "RDMA notifies need shared receive queues, "
+                        "sending them over RPC";
+        config.rdma_notify_imm = false;
+    }
 }
 
 void dumpGlobalConfig() {
@@ -392,9 +560,33 @@ void dumpGlobalConfig() {
     LOG(INFO) << "max_sge = " << config.max_sge;
     LOG(INFO) << "max_wr = " << config.max_wr;
     LOG(INFO) << "max_inline = " << config.max_inline;
+    LOG(INFO) << "shared_rq = " << config.shared_rq;
+    LOG(INFO) << "rdma_notify_imm = " << config.rdma_notify_imm;
+    LOG(INFO) << "wr_signal_interval = " << config.wr_signal_interval;
     LOG(INFO) << "mtu_length = " << mtuLengthToString(config.mtu_length);
+    LOG(INFO) << "work_stealing = " << config.work_stealing;
+    LOG(INFO) << "rail_spray = " << config.rail_spray;
+    LOG(INFO) << "cq_poll_idle_us = " << config.cq_poll_idle_us;
     LOG(INFO) << "parallel_reg_mr = " << config.parallel_reg_mr;
+    LOG(INFO) << "ib_odp = " << config.ib_odp;
+    LOG(INFO) << "rdma_auto_slice = " << config.rdma_auto_slice;
+    LOG(INFO) << "rdma_min_slice_size = " << config.rdma_min_slice_size;
+    LOG(INFO) << "rdma_max_slice_size = " << config.rdma_max_slice_size;
+    LOG(INFO) << "rdma_priority_qp = " << config.rdma_priority_qp;
+    LOG(INFO) << "rdma_priority_weight = " << config.rdma_priority_weight;
+    LOG(INFO) << "tcp_stripe_size = " << config.tcp_stripe_size;
+    LOG(INFO) << "tcp_conns_per_peer = " << config.tcp_conns_per_peer;
+    LOG(INFO) << "tcp_zerocopy = " << config.tcp_zerocopy;
+    LOG(INFO) << "gpu_mr_cache = " << config.gpu_mr_cache;
+    LOG(INFO) << "gpu_mr_cache_idle_size = " << config.gpu_mr_cache_idle_size;
+    LOG(INFO) << "multi_path = " << config.multi_path;
+    LOG(INFO) << "multi_path_split_size = " << config.multi_path_split_size;
+    LOG(INFO) << "multi_path_nvlink_ratio = "
+              << config.multi_path_nvlink_ratio;
     LOG(INFO) << "ib_traffic_class = " << config.ib_traffic_class;
+    LOG(INFO) << "metacache = " << config.metacache;
+    LOG(INFO) << "metacache_watch = " << config.metacache_watch;
+    LOG(INFO) << "metadata_binary = " << config.metadata_binary;
 }
 
 GlobalConfig &globalConfig() {
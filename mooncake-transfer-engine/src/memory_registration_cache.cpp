@@ -0,0 +1,176 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "memory_registration_cache.h"
+
+#include <glog/logging.h>
+
+#include "error.h"
+
+#ifdef USE_CUDA
+#include <cuda.h>
+#endif
+
+namespace mooncake {
+
+MemoryRegistrationCache::MemoryRegistrationCache(ResolveFunc resolve,
+                                                 UnregisterFunc unregister,
+                                                 size_t idle_limit)
+    : resolve_(std::move(resolve)),
+      unregister_(std::move(unregister)),
+      idle_limit_(idle_limit) {}
+
+bool MemoryRegistrationCache::resolveDeviceAllocation(void *addr,
+                                                      Allocation &allocation) {
+#ifdef USE_CUDA
+    CUmemorytype mem_type;
+    if (cuPointerGetAttribute(&mem_type, CU_POINTER_ATTRIBUTE_MEMORY_TYPE,
+                              (CUdeviceptr)addr) != CUDA_SUCCESS ||
+        mem_type != CU_MEMORYTYPE_DEVICE)
+        return false;
+    CUdeviceptr base;
+    size_t length;
+    if (cuMemGetAddressRange(&base, &length, (CUdeviceptr)addr) !=
+        CUDA_SUCCESS)
+        return false;
+    unsigned long long buffer_id = 0;
+    if (cuPointerGetAttribute(&buffer_id, CU_POINTER_ATTRIBUTE_BUFFER_ID,
+                              (CUdeviceptr)addr) != CUDA_SUCCESS)
+        return false;
+    allocation.base = (uintptr_t)base;
+    allocation.length = length;
+    allocation.buffer_id = buffer_id;
+    return true;
+#else
+    (void)addr;
+    (void)allocation;
+    return false;
+#endif
+}
+
+std::map<uintptr_t, MemoryRegistrationCache::Block>::iterator
+MemoryRegistrationCache::findBlock(uintptr_t addr) {
+    auto iter = blocks_.upper_bound(addr);
+    if (iter == blocks_.begin()) return blocks_.end();
+    --iter;
+    if (addr >= iter->first + iter->second.length) return blocks_.end();
+    return iter;
+}
+
+int MemoryRegistrationCache::removeBlock(
+    std::map<uintptr_t, Block>::iterator iter) {
+    if (iter->second.users == 0) {
+        idle_list_.erase(iter->second.idle_pos);
+        idle_bytes_ -= iter->second.length;
+    } else {
+        for (auto user = users_.begin(); user != users_.end();) {
+            if (user->second == iter->first)
+                user = users_.erase(user);
+            else
+                ++user;
+        }
+    }
+    int ret = unregister_((void *)iter->first);
+    blocks_.erase(iter);
+    return ret;
+}
+
+void MemoryRegistrationCache::evictIdleBlocks() {
+    while (idle_bytes_ > idle_limit_ && !idle_list_.empty()) {
+        auto iter = blocks_.find(idle_list_.front());
+        removeBlock(iter);
+    }
+}
+
+int MemoryRegistrationCache::acquire(void *addr, size_t length,
+                                     const RegisterFunc &do_register) {
+    Allocation allocation;
+    if (!resolve_(addr, allocation)) return 1;
+    if ((uintptr_t)addr + length > allocation.base + allocation.length) {
+        LOG(ERROR) << "Memory region " << addr << " of " << length
+                   << " bytes exceeds its allocation";
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = findBlock(allocation.base);
+    if (iter != blocks_.end() &&
+        (iter->first != allocation.base ||
+         iter->second.length != allocation.length ||
+         iter->second.buffer_id != allocation.buffer_id)) {
+        // The memory of the block was freed without being reported, and
+        // reallocated
+        LOG(INFO) << "Dropping stale registration of "
+                  << (void *)iter->first;
+        removeBlock(iter);
+        iter = blocks_.end();
+    }
+
+    if (iter == blocks_.end()) {
+        // Stale blocks may also start inside the new allocation
+        auto next = blocks_.lower_bound(allocation.base);
+        while (next != blocks_.end() &&
+               next->first < allocation.base + allocation.length) {
+            removeBlock(next);
+            next = blocks_.lower_bound(allocation.base);
+        }
+        int ret = do_register((void *)allocation.base, allocation.length);
+        if (ret) return ret;
+        iter = blocks_
+                   .emplace(allocation.base,
+                            Block{allocation.length, allocation.buffer_id, 0,
+                                  idle_list_.end()})
+                   .first;
+    } else if (iter->second.users == 0) {
+        idle_list_.erase(iter->second.idle_pos);
+        idle_bytes_ -= iter->second.length;
+    }
+    iter->second.users++;
+    users_.emplace((uintptr_t)addr, iter->first);
+    return 0;
+}
+
+int MemoryRegistrationCache::release(void *addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto user = users_.find((uintptr_t)addr);
+    if (user == users_.end()) return 1;
+    auto iter = blocks_.find(user->second);
+    users_.erase(user);
+    if (iter == blocks_.end()) return 0;
+    if (--iter->second.users == 0) {
+        iter->second.idle_pos =
+            idle_list_.insert(idle_list_.end(), iter->first);
+        idle_bytes_ += iter->second.length;
+        evictIdleBlocks();
+    }
+    return 0;
+}
+
+int MemoryRegistrationCache::invalidate(void *addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = findBlock((uintptr_t)addr);
+    if (iter == blocks_.end()) return 0;
+    if (iter->second.users) {
+        LOG(WARNING) << "Memory " << addr << " was freed while "
+                     << iter->second.users << " registrations still use it";
+    }
+    return removeBlock(iter);
+}
+
+size_t MemoryRegistrationCache::idleBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_bytes_;
+}
+
+}  // namespace mooncake
@@ -56,22 +56,25 @@
 #include "transport/efa_transport/efa_transport.h"
 #endif
 
+#include <algorithm>
 #include <cassert>
 
 namespace mooncake {
 MultiTransport::MultiTransport(std::shared_ptr<TransferMetadata> metadata,
                                std::string &local_server_name)
-    : metadata_(metadata), local_server_name_(local_server_name) {}
+    : metadata_(metadata),
+      local_server_name_(local_server_name),
+      local_host_name_(parseHostNameWithPort(local_server_name).first) {
+    if (globalConfig().local_memcpy)
+        local_memcpy_ = std::make_unique<LocalMemcpyTransport>(
+            globalConfig().local_memcpy_threads);
+}
 
 MultiTransport::~MultiTransport() {}
 
 MultiTransport::BatchID MultiTransport::allocateBatchID(size_t batch_size) {
-    auto batch_desc = new BatchDesc();
+    auto batch_desc = Transport::getBatchDescPool().allocate(batch_size);
     if (!batch_desc) return ERR_MEMORY;
-    batch_desc->id = BatchID(batch_desc);
-    batch_desc->batch_size = batch_size;
-    batch_desc->task_list.reserve(batch_size);
-    batch_desc->context = NULL;
 #ifdef CONFIG_USE_BATCH_DESC_SET
     batch_desc_lock_.lock();
     batch_desc_set_[batch_desc->id] = batch_desc;
@@ -89,7 +92,7 @@ Status MultiTransport::freeBatchID(BatchID batch_id) {
                 "BatchID cannot be freed until all tasks are done");
         }
     }
-    delete &batch_desc;
+    Transport::getBatchDescPool().deallocate(&batch_desc);
 #ifdef CONFIG_USE_BATCH_DESC_SET
     RWSpinlock::WriteGuard guard(batch_desc_lock_);
     batch_desc_set_.erase(batch_id);
@@ -97,6 +100,26 @@ Status MultiTransport::freeBatchID(BatchID batch_id) {
     return Status::OK();
 }
 
+Status MultiTransport::checkCompletionNotify(
+    BatchDesc &batch_desc, const std::vector<TransferRequest> &entries) {
+    for (auto &request : entries) {
+        Transport *transport = nullptr;
+        auto status = selectTransport(request, transport);
+        if (!status.ok()) return status;
+        if (transport->supportsCompletionNotify()) continue;
+        if (batch_desc.completion_fd >= 0 || batch_desc.completion_callback) {
+            return Status::NotSupportedTransport(
+                std::string(transport->getName()) +
+                " transport does not support completion notification");
+        }
+        // Nobody but waitBatchCompletion() relies on it, which then reports
+        // that the batch has to be polled
+        batch_desc.notify_completion = false;
+        return Status::OK();
+    }
+    return Status::OK();
+}
+
 Status MultiTransport::submitTransfer(
     BatchID batch_id, const std::vector<TransferRequest> &entries) {
     auto &batch_desc = *((BatchDesc *)(batch_id));
@@ -105,16 +128,43 @@ Status MultiTransport::submitTransfer(
             "Exceed the limitation of batch capacity");
     }
 
+    if (batch_desc.notify_completion) {
+        auto status = checkCompletionNotify(batch_desc, entries);
+        if (!status.ok()) return status;
+    }
+
     size_t task_id = batch_desc.task_list.size();
     batch_desc.task_list.resize(task_id + entries.size());
 
-    std::unordered_map<Transport *, std::vector<Transport::TransferTask *> >
+    // Reused across calls, so that steady state submission does not allocate
+    thread_local std::vector<
+        std::pair<Transport *, std::vector<Transport::TransferTask *> > >
         submit_tasks;
+    for (auto &entry : submit_tasks) entry.second.clear();
+    thread_local std::vector<Transport::TransferTask *> split_tasks;
+    split_tasks.clear();
+    thread_local std::vector<
+        std::pair<Transport *, Transport::TransferTask *> >
+        block_tasks;
+    block_tasks.clear();
+    // Requests routed to NVLink this large also use RDMA
+    const size_t split_size = globalConfig().multi_path_split_size;
+    Transport *split_transport =
+        split_size && getTransport("rdma") ? getTransport("nvlink_intra")
+                                           : nullptr;
     for (auto &request : entries) {
+        if (!request.validLayout()) {
+            return Status::InvalidArgument(
+                "Request length does not match its blocks");
+        }
         Transport *transport = nullptr;
         auto status = selectTransport(request, transport);
         if (!status.ok()) return status;
         assert(transport);
+        if (request.isAtomic()) {
+            status = checkAtomic(transport, request);
+            if (!status.ok()) return status;
+        }
         auto &task = batch_desc.task_list[task_id];
         task.batch_id = batch_id;
 #ifdef USE_ASCEND_HETEROGENEOUS
@@ -122,11 +172,31 @@ Status MultiTransport::submitTransfer(
 #else
         task.request = &request;
 #endif
+        batch_desc.recycleSliceList(task);
         ++task_id;
-        submit_tasks[transport].push_back(&task);
+        if (!request.isContiguous() && !transport->supportsScatterGather()) {
+            block_tasks.emplace_back(transport, &task);
+            continue;
+        }
+        if (split_transport && transport == split_transport &&
+            request.isContiguous() && request.length >= split_size) {
+            split_tasks.push_back(&task);
+            continue;
+        }
+        auto it = std::find_if(submit_tasks.begin(), submit_tasks.end(),
+                               [transport](const auto &entry) {
+                                   return entry.first == transport;
+                               });
+        if (it == submit_tasks.end()) {
+            submit_tasks.emplace_back(transport,
+                                      std::vector<Transport::TransferTask *>());
+            it = std::prev(submit_tasks.end());
+        }
+        it->second.push_back(&task);
     }
     Status overall_status = Status::OK();
     for (auto &entry : submit_tasks) {
+        if (entry.second.empty()) continue;
         auto status = entry.first->submitTransferTask(entry.second);
         if (!status.ok()) {
             // LOG(ERROR) << "Failed to submit transfer task to "
@@ -134,9 +204,99 @@ Status MultiTransport::submitTransfer(
             overall_status = status;
         }
     }
+    for (auto task : split_tasks) {
+        auto status = submitSplitTask(*task);
+        if (!status.ok()) overall_status = status;
+    }
+    for (auto &entry : block_tasks) {
+        auto status = submitBlockTask(entry.first, *entry.second);
+        if (!status.ok()) overall_status = status;
+    }
     return overall_status;
 }
 
+Status MultiTransport::submitBlockTask(Transport *transport,
+                                       Transport::TransferTask &task) {
+    auto request = task.request;
+    // Holds the task open until all blocks are submitted
+    Transport::Slice *guard = Transport::getSliceCache().allocate();
+    guard->source_addr = request->source;
+    guard->length = 0;
+    guard->opcode = request->opcode;
+    guard->task = &task;
+    guard->target_id = request->target_id;
+    guard->status = Transport::Slice::PENDING;
+    guard->ts = 0;
+    task.slice_list.push_back(guard);
+    __sync_fetch_and_add(&task.slice_count, 1);
+
+    std::vector<Transport::TransferTask *> task_list{&task};
+    TransferRequest block = *request;
+    block.block_count = 0;
+    block.source_iov = nullptr;
+    block.source_iov_count = 0;
+    Status status = Status::OK();
+    request->forEachBlock([&](char *source, uint64_t target, size_t length) {
+        if (!status.ok() || !length) return;
+        block.source = source;
+        block.target_offset = target;
+        block.length = length;
+        task.request = &block;
+        status = transport->submitTransferTask(task_list);
+    });
+    task.request = request;
+    task.total_bytes = request->length;
+    if (status.ok())
+        guard->markSuccess();
+    else
+        guard->markFailed();
+    return status;
+}
+
+Status MultiTransport::submitSplitTask(Transport::TransferTask &task) {
+    // Parts are cut at page boundaries
+    const size_t kAlignment = 4096;
+    auto request = task.request;
+    size_t nvlink_length =
+        request->length * globalConfig().multi_path_nvlink_ratio / 100;
+    nvlink_length &= ~(kAlignment - 1);
+    TransferRequest nvlink_part = *request;
+    nvlink_part.length = nvlink_length;
+    TransferRequest rdma_part = *request;
+    rdma_part.source = (char *)request->source + nvlink_length;
+    rdma_part.target_offset += nvlink_length;
+    rdma_part.length -= nvlink_length;
+
+    // Holds the task open until both parts are submitted, as the RDMA part
+    // may complete before the NVLink part adds its slice
+    Transport::Slice *guard = Transport::getSliceCache().allocate();
+    guard->source_addr = request->source;
+    guard->length = 0;
+    guard->opcode = request->opcode;
+    guard->task = &task;
+    guard->target_id = request->target_id;
+    guard->status = Transport::Slice::PENDING;
+    guard->ts = 0;
+    task.slice_list.push_back(guard);
+    __sync_fetch_and_add(&task.slice_count, 1);
+
+    // The RDMA part is posted first, the NVLink copy blocks until done
+    std::vector<Transport::TransferTask *> task_list{&task};
+    task.request = &rdma_part;
+    auto status = getTransport("rdma")->submitTransferTask(task_list);
+    if (status.ok() && nvlink_part.length) {
+        task.request = &nvlink_part;
+        status = getTransport("nvlink_intra")->submitTransferTask(task_list);
+    }
+    task.request = request;
+    task.total_bytes = request->length;
+    if (status.ok())
+        guard->markSuccess();
+    else
+        guard->markFailed();
+    return status;
+}
+
 Status MultiTransport::getTransferStatus(BatchID batch_id, size_t task_id,
                                          TransferStatus &status) {
     auto &batch_desc = *((BatchDesc *)(batch_id));
@@ -151,7 +311,10 @@ Status MultiTransport::getTransferStatus(BatchID batch_id, size_t task_id,
     assert(task.slice_count);
     if (success_slice_count + failed_slice_count == task.slice_count) {
         if (failed_slice_count) {
-            status.s = Transport::TransferStatusEnum::FAILED;
+            status.s =
+                batch_desc.is_canceled.load(std::memory_order_relaxed)
+                    ? Transport::TransferStatusEnum::CANCELED
+                    : Transport::TransferStatusEnum::FAILED;
         } else {
             status.s = Transport::TransferStatusEnum::COMPLETED;
         }
@@ -203,8 +366,9 @@ Status MultiTransport::getBatchTransferStatus(BatchID batch_id,
         if (task_status.s == Transport::TransferStatusEnum::COMPLETED) {
             status.transferred_bytes += task_status.transferred_bytes;
             success_count++;
-        } else if (task_status.s == Transport::TransferStatusEnum::FAILED) {
-            status.s = Transport::TransferStatusEnum::FAILED;
+        } else if (task_status.s == Transport::TransferStatusEnum::FAILED ||
+                   task_status.s == Transport::TransferStatusEnum::CANCELED) {
+            status.s = task_status.s;
             return Status::OK();
         }
     }
@@ -356,6 +520,16 @@ Status MultiTransport::selectTransport(const TransferRequest &entry,
         proto = "ascend";
     }
 #endif
+    // Atomics stay on the NIC, which does not order them with CPU stores
+    if (local_memcpy_ && !entry.isAtomic() &&
+        isLocalTarget(entry, *target_segment_desc)) {
+        transport = local_memcpy_.get();
+        return Status::OK();
+    }
+    if (proto == "rdma" && !entry.isAtomic() &&
+        reachableOverNvlink(entry, *target_segment_desc)) {
+        proto = "nvlink_intra";
+    }
     if (!transport_map_.count(proto)) {
         return Status::NotSupportedTransport("Transport " + proto +
                                              " not installed");
@@ -364,6 +538,55 @@ Status MultiTransport::selectTransport(const TransferRequest &entry,
     return Status::OK();
 }
 
+Status MultiTransport::checkAtomic(Transport *transport,
+                                   const TransferRequest &entry) {
+    if (!transport->supportsAtomics()) {
+        return Status::NotSupportedTransport(
+            std::string("Atomic requests are not supported by transport ") +
+            transport->getName());
+    }
+    if (entry.length != sizeof(uint64_t) || !entry.isContiguous() ||
+        entry.target_offset % sizeof(uint64_t) ||
+        (uintptr_t)entry.source % sizeof(uint64_t)) {
+        return Status::InvalidArgument(
+            "Atomic requests take 8 aligned bytes at source and target");
+    }
+    return Status::OK();
+}
+
+bool MultiTransport::reachableOverNvlink(
+    const TransferRequest &entry, const TransferMetadata::SegmentDesc &desc) {
+    if (!globalConfig().multi_path || !transport_map_.count("nvlink_intra"))
+        return false;
+    if (entry.target_id != LOCAL_SEGMENT_ID &&
+        parseHostNameWithPort(desc.name).first != local_host_name_)
+        return false;
+    for (auto &buffer : desc.buffers) {
+        if (buffer.addr <= entry.target_offset &&
+            entry.target_offset + entry.targetSpan() <=
+                buffer.addr + buffer.length) {
+            return !buffer.shm_name.empty();
+        }
+    }
+    return false;
+}
+
+bool MultiTransport::isLocalTarget(const TransferRequest &entry,
+                                   const TransferMetadata::SegmentDesc &desc) {
+    // Only the buffers of these segments are at addresses of this process
+    if (desc.protocol != "rdma" && desc.protocol != "tcp") return false;
+    if (entry.target_id != LOCAL_SEGMENT_ID && desc.name != local_server_name_)
+        return false;
+    for (auto &buffer : desc.buffers) {
+        if (buffer.addr <= entry.target_offset &&
+            entry.target_offset + entry.targetSpan() <=
+                buffer.addr + buffer.length) {
+            return true;
+        }
+    }
+    return false;
+}
+
 Transport *MultiTransport::getTransport(const std::string &proto) {
     if (!transport_map_.count(proto)) return nullptr;
     return transport_map_[proto].get();
@@ -14,8 +14,10 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <map>
 #include <set>
 #include <string>
@@ -23,12 +25,15 @@
 #include <vector>
 #include <ctype.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <infiniband/verbs.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "cuda_alike.h"
 #include "memory_location.h"
@@ -362,7 +367,133 @@ void Topology::clear() {
     resolved_matrix_.clear();
 }
 
+static std::vector<std::string> listDirectory(const std::string &path) {
+    std::vector<std::string> names;
+    DIR *dir = opendir(path.c_str());
+    if (!dir) return names;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Everything the discovered topology depends on that may change while a
+// cache file outlives the process: the boot, the PCI devices, the state of
+// the RDMA ports and the devices this process is allowed to see
+static std::string topologyFingerprint(const std::vector<std::string> &filter) {
+    std::ostringstream out;
+    out << "v1;";
+    std::string boot_id;
+    std::ifstream("/proc/sys/kernel/random/boot_id") >> boot_id;
+    out << "boot=" << boot_id << ";pci=";
+    for (auto &device : listDirectory("/sys/bus/pci/devices"))
+        out << device << ",";
+    out << ";ports=";
+    for (auto &device : listDirectory("/sys/class/infiniband")) {
+        auto ports_dir = "/sys/class/infiniband/" + device + "/ports";
+        for (auto &port : listDirectory(ports_dir)) {
+            std::string state;
+            std::getline(std::ifstream(ports_dir + "/" + port + "/state"),
+                         state);
+            out << device << "/" << port << "=" << state << ",";
+        }
+    }
+    out << ";filter=";
+    for (auto &device : filter) out << device << ",";
+    for (auto env : {"CUDA_VISIBLE_DEVICES", "HIP_VISIBLE_DEVICES",
+                     "MUSA_VISIBLE_DEVICES"}) {
+        auto value = getenv(env);
+        out << ";" << env << "=" << (value ? value : "");
+    }
+    return out.str();
+}
+
 int Topology::discover(const std::vector<std::string> &filter) {
+    auto cache_dir = getenv("MC_TOPOLOGY_CACHE_DIR");
+    if (!cache_dir || !*cache_dir) return discoverDevices(filter);
+
+    auto fingerprint = topologyFingerprint(filter);
+    char name[64];
+    snprintf(name, sizeof(name), "mooncake_topology_%016zx.json",
+             std::hash<std::string>{}(fingerprint));
+    std::string path = std::string(cache_dir) + "/" + name;
+
+    // Processes starting together wait for the first one to discover
+    int lock_fd =
+        open((path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (lock_fd < 0) {
+        PLOG(WARNING) << "Topology: cannot open lock of cache " << path;
+    } else if (flock(lock_fd, LOCK_EX) != 0) {
+        PLOG(WARNING) << "Topology: cannot lock cache " << path;
+        close(lock_fd);
+        lock_fd = -1;
+    }
+
+    int ret = 0;
+    if (loadCache(path, fingerprint)) {
+        LOG(INFO) << "Topology: loaded from cache " << path;
+    } else {
+        ret = discoverDevices(filter);
+        // An empty result may be transient, e.g. a port still coming up
+        if (ret == 0 && !matrix_.empty()) saveCache(path, fingerprint);
+    }
+    if (lock_fd >= 0) close(lock_fd);
+    return ret;
+}
+
+bool Topology::loadCache(const std::string &path,
+                         const std::string &fingerprint) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string text = content.str();
+
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string errs;
+    if (!reader->parse(text.data(), text.data() + text.size(), &root,
+                       &errs) ||
+        !root.isObject() || root["fingerprint"].asString() != fingerprint ||
+        !root["topology"].isString()) {
+        LOG(INFO) << "Topology: ignoring stale cache " << path;
+        return false;
+    }
+    if (parse(root["topology"].asString()) != 0) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+void Topology::saveCache(const std::string &path,
+                         const std::string &fingerprint) {
+    Json::Value root;
+    root["fingerprint"] = fingerprint;
+    root["topology"] = toString();
+    // Readers never see a partial file
+    auto tmp_path = path + "." + std::to_string(getpid());
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        file << root.toStyledString();
+        if (!file) {
+            LOG(WARNING) << "Topology: cannot write cache " << tmp_path;
+            file.close();
+            unlink(tmp_path.c_str());
+            return;
+        }
+    }
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+        PLOG(WARNING) << "Topology: cannot install cache " << path;
+        unlink(tmp_path.c_str());
+    }
+}
+
+int Topology::discoverDevices(const std::vector<std::string> &filter) {
     matrix_.clear();
     auto all_hca = listInfiniBandDevices(filter);
     for (auto &ent : discoverCpuTopology(all_hca)) {
@@ -483,6 +614,14 @@ int Topology::selectDevice(const std::string storage_type, int retry_count) {
     return 0;
 }
 
+std::vector<int> Topology::firstChoiceDevices(
+    const std::string &storage_type) const {
+    auto it = resolved_matrix_.find(storage_type);
+    if (it == resolved_matrix_.end()) return {};
+    if (!it->second.preferred_hca.empty()) return it->second.preferred_hca;
+    return it->second.avail_hca;
+}
+
 int Topology::resolve() {
     resolved_matrix_.clear();
     hca_list_.clear();
@@ -67,6 +67,11 @@ Status TransferEngine::CheckSegmentStatus(SegmentID sid) {
     return impl_->CheckSegmentStatus(sid);
 }
 
+int TransferEngine::preconnectSegments(
+    const std::vector<std::string>& segment_names, bool pin) {
+    return impl_->preconnectSegments(segment_names, pin);
+}
+
 int TransferEngine::closeSegment(SegmentHandle handle) {
     return impl_->closeSegment(handle);
 }
@@ -87,6 +92,10 @@ int TransferEngine::unregisterLocalMemory(void* addr, bool update_metadata) {
     return impl_->unregisterLocalMemory(addr, update_metadata);
 }
 
+int TransferEngine::notifyMemoryFreed(void* addr) {
+    return impl_->notifyMemoryFreed(addr);
+}
+
 int TransferEngine::registerLocalMemoryBatch(
     const std::vector<BufferEntry>& buffer_list, const std::string& location) {
     return impl_->registerLocalMemoryBatch(buffer_list, location);
@@ -141,6 +150,28 @@ Status TransferEngine::getBatchTransferStatus(BatchID batch_id,
     return impl_->getBatchTransferStatus(batch_id, status);
 }
 
+Status TransferEngine::enableBatchCompletionNotify(BatchID batch_id) {
+    return impl_->enableBatchCompletionNotify(batch_id);
+}
+
+Status TransferEngine::getBatchCompletionFd(BatchID batch_id, int& fd) {
+    return impl_->getBatchCompletionFd(batch_id, fd);
+}
+
+Status TransferEngine::setBatchCompletionCallback(
+    BatchID batch_id, std::function<void(BatchID, bool)> callback) {
+    return impl_->setBatchCompletionCallback(batch_id, std::move(callback));
+}
+
+Status TransferEngine::waitBatchCompletion(BatchID batch_id,
+                                           int64_t timeout_ms) {
+    return impl_->waitBatchCompletion(batch_id, timeout_ms);
+}
+
+Status TransferEngine::cancelBatch(BatchID batch_id) {
+    return impl_->cancelBatch(batch_id);
+}
+
 Transport* TransferEngine::getTransport(const std::string& proto) {
     return impl_->getTransport(proto);
 }
@@ -157,6 +188,8 @@ bool TransferEngine::checkOverlap(void* addr, uint64_t length) {
     return impl_->checkOverlap(addr, length);
 }
 
+bool TransferEngine::supportsScatterGather() const { return true; }
+
 void TransferEngine::setAutoDiscover(bool auto_discover) {
     impl_->setAutoDiscover(auto_discover);
 }
@@ -314,6 +347,15 @@ Status TransferEngine::CheckSegmentStatus(SegmentID sid) {
         return impl_->CheckSegmentStatus(sid);
 }
 
+int TransferEngine::preconnectSegments(
+    const std::vector<std::string>& segment_names, bool pin) {
+    if (use_tent_) {
+        LOG(WARNING) << "preconnectSegments is not supported by TENT";
+        return 0;
+    }
+    return impl_->preconnectSegments(segment_names, pin);
+}
+
 int TransferEngine::closeSegment(SegmentHandle handle) {
     if (use_tent_) {
         auto status = impl_tent_->closeSegment(handle);
@@ -352,6 +394,12 @@ int TransferEngine::unregisterLocalMemory(void* addr, bool update_metadata) {
         return impl_->unregisterLocalMemory(addr, update_metadata);
 }
 
+int TransferEngine::notifyMemoryFreed(void* addr) {
+    // TENT keeps no registrations beyond the buffers it was given
+    if (use_tent_) return 0;
+    return impl_->notifyMemoryFreed(addr);
+}
+
 int TransferEngine::registerLocalMemoryBatch(
     const std::vector<BufferEntry>& buffer_list, const std::string& location) {
     if (use_tent_) {
@@ -407,12 +455,21 @@ Status TransferEngine::submitTransfer(
     if (use_tent_) {
         std::vector<mooncake::tent::Request> requests;
         for (auto& item : entries) {
+            if (!item.isContiguous())
+                return Status::InvalidArgument(
+                    "Strided and gather/scatter requests are not supported "
+                    "by TENT");
+            if (item.isAtomic())
+                return Status::InvalidArgument(
+                    "Atomic requests are not supported by TENT");
             mooncake::tent::Request req;
             req.opcode = (mooncake::tent::Request::OpCode)(int)item.opcode;
             req.length = item.length;
             req.source = item.source;
             req.target_id = item.target_id;
             req.target_offset = item.target_offset;
+            req.priority =
+                (mooncake::tent::Request::Priority)(int)item.priority;
             requests.push_back(req);
         }
         auto status = impl_tent_->submitTransfer(batch_id, requests);
@@ -431,12 +488,21 @@ Status TransferEngine::submitTransferWithNotify(
     if (use_tent_) {
         std::vector<mooncake::tent::Request> requests;
         for (auto& item : entries) {
+            if (!item.isContiguous())
+                return Status::InvalidArgument(
+                    "Strided and gather/scatter requests are not supported "
+                    "by TENT");
+            if (item.isAtomic())
+                return Status::InvalidArgument(
+                    "Atomic requests are not supported by TENT");
             mooncake::tent::Request req;
             req.opcode = (mooncake::tent::Request::OpCode)(int)item.opcode;
             req.length = item.length;
             req.source = item.source;
             req.target_id = item.target_id;
             req.target_offset = item.target_offset;
+            req.priority =
+                (mooncake::tent::Request::Priority)(int)item.priority;
             requests.push_back(req);
         }
         mooncake::tent::Notification notifi;
@@ -527,6 +593,42 @@ Status TransferEngine::getBatchTransferStatus(BatchID batch_id,
         return impl_->getBatchTransferStatus(batch_id, status);
 }
 
+Status TransferEngine::enableBatchCompletionNotify(BatchID batch_id) {
+    if (use_tent_)
+        return Status::NotImplemented(
+            "Completion notification is not supported by TENT");
+    return impl_->enableBatchCompletionNotify(batch_id);
+}
+
+Status TransferEngine::getBatchCompletionFd(BatchID batch_id, int& fd) {
+    if (use_tent_)
+        return Status::NotImplemented(
+            "Completion notification is not supported by TENT");
+    return impl_->getBatchCompletionFd(batch_id, fd);
+}
+
+Status TransferEngine::setBatchCompletionCallback(
+    BatchID batch_id, std::function<void(BatchID, bool)> callback) {
+    if (use_tent_)
+        return Status::NotImplemented(
+            "Completion notification is not supported by TENT");
+    return impl_->setBatchCompletionCallback(batch_id, std::move(callback));
+}
+
+Status TransferEngine::waitBatchCompletion(BatchID batch_id,
+                                           int64_t timeout_ms) {
+    if (use_tent_)
+        return Status::NotImplemented(
+            "Completion notification is not supported by TENT");
+    return impl_->waitBatchCompletion(batch_id, timeout_ms);
+}
+
+Status TransferEngine::cancelBatch(BatchID batch_id) {
+    if (use_tent_)
+        return Status::NotImplemented("Cancellation is not supported by TENT");
+    return impl_->cancelBatch(batch_id);
+}
+
 Transport* TransferEngine::getTransport(const std::string& proto) {
     if (use_tent_)
         return nullptr;
@@ -554,6 +656,8 @@ bool TransferEngine::checkOverlap(void* addr, uint64_t length) {
     return false;
 }
 
+bool TransferEngine::supportsScatterGather() const { return !use_tent_; }
+
 void TransferEngine::setAutoDiscover(bool auto_discover) {
     if (!use_tent_) impl_->setAutoDiscover(auto_discover);
 }
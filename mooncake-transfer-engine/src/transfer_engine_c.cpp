@@ -14,8 +14,11 @@
 
 #include "transfer_engine_c.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <thread>
 
 #include "transfer_engine.h"
 #include "transport/transport.h"
@@ -122,9 +125,8 @@ batch_id_t allocateBatchID(transfer_engine_t engine, size_t batch_size) {
     return (batch_id_t)native->allocateBatchID(batch_size);
 }
 
-int submitTransfer(transfer_engine_t engine, batch_id_t batch_id,
-                   struct transfer_request *entries, size_t count) {
-    TransferEngine *native = (TransferEngine *)engine;
+static std::vector<Transport::TransferRequest> toNativeRequests(
+    struct transfer_request *entries, size_t count) {
     std::vector<Transport::TransferRequest> native_entries;
     native_entries.resize(count);
     for (size_t index = 0; index < count; index++) {
@@ -135,6 +137,13 @@ int submitTransfer(transfer_engine_t engine, batch_id_t batch_id,
         native_entries[index].target_offset = entries[index].target_offset;
         native_entries[index].length = entries[index].length;
     }
+    return native_entries;
+}
+
+int submitTransfer(transfer_engine_t engine, batch_id_t batch_id,
+                   struct transfer_request *entries, size_t count) {
+    TransferEngine *native = (TransferEngine *)engine;
+    auto native_entries = toNativeRequests(entries, count);
     Status s =
         native->submitTransfer((Transport::BatchID)batch_id, native_entries);
     return (int)s.code();
@@ -144,16 +153,7 @@ int submitTransferWithNotify(transfer_engine_t engine, batch_id_t batch_id,
                              struct transfer_request *entries, size_t count,
                              notify_msg_t notify_msg) {
     TransferEngine *native = (TransferEngine *)engine;
-    std::vector<Transport::TransferRequest> native_entries;
-    native_entries.resize(count);
-    for (size_t index = 0; index < count; index++) {
-        native_entries[index].opcode =
-            (Transport::TransferRequest::OpCode)entries[index].opcode;
-        native_entries[index].source = entries[index].source;
-        native_entries[index].target_id = entries[index].target_id;
-        native_entries[index].target_offset = entries[index].target_offset;
-        native_entries[index].length = entries[index].length;
-    }
+    auto native_entries = toNativeRequests(entries, count);
     TransferMetadata::NotifyDesc native_notify_msg;
     native_notify_msg.name = notify_msg.name;
     native_notify_msg.notify_msg = notify_msg.msg;
@@ -175,6 +175,85 @@ int getTransferStatus(transfer_engine_t engine, batch_id_t batch_id,
     return (int)s.code();
 }
 
+int enableBatchCompletionNotify(transfer_engine_t engine,
+                                batch_id_t batch_id) {
+    TransferEngine *native = (TransferEngine *)engine;
+    Status s =
+        native->enableBatchCompletionNotify((Transport::BatchID)batch_id);
+    return (int)s.code();
+}
+
+int getBatchTransferStatus(transfer_engine_t engine, batch_id_t batch_id,
+                           struct transfer_status *status) {
+    TransferEngine *native = (TransferEngine *)engine;
+    Transport::TransferStatus native_status;
+    Status s = native->getBatchTransferStatus((Transport::BatchID)batch_id,
+                                              native_status);
+    if (s.ok()) {
+        status->status = (int)native_status.s;
+        status->transferred_bytes = native_status.transferred_bytes;
+    }
+    return (int)s.code();
+}
+
+int getTransferStatusList(transfer_engine_t engine, batch_id_t batch_id,
+                          struct transfer_status *status_list, size_t count) {
+    for (size_t task_id = 0; task_id < count; ++task_id) {
+        int ret = getTransferStatus(engine, batch_id, task_id,
+                                    &status_list[task_id]);
+        if (ret) return ret;
+    }
+    return 0;
+}
+
+int waitBatchTransfer(transfer_engine_t engine, batch_id_t batch_id,
+                      int64_t timeout_ms, struct transfer_status *status) {
+    // Sleeps on the completion in slices, so that a batch that is never
+    // filled up to batch_size is still seen done by its status
+    const int64_t kWaitSliceMs = 10;
+    const int64_t kMaxBackoffUs = 1000;
+    TransferEngine *native = (TransferEngine *)engine;
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if (timeout_ms >= 0)
+        deadline = std::chrono::steady_clock::now() +
+                   std::chrono::milliseconds(timeout_ms);
+    bool notified = true;
+    int64_t backoff_us = 1;
+    while (true) {
+        int ret = getBatchTransferStatus(engine, batch_id, status);
+        if (ret) return ret;
+        if (status->status != STATUS_WAITING &&
+            status->status != STATUS_PENDING)
+            return 0;
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return (int)Status::Code::kBatchBusy;
+        if (notified) {
+            auto remaining_ms =
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - now)
+                    .count();
+            Status s = native->waitBatchCompletion(
+                (Transport::BatchID)batch_id,
+                std::clamp<int64_t>(remaining_ms, 1, kWaitSliceMs));
+            if (s.ok() || s.IsBatchBusy()) continue;
+            // Not subscribed, or the engine cannot notify it
+            notified = false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(backoff_us));
+        backoff_us = std::min(backoff_us * 2, kMaxBackoffUs);
+    }
+}
+
+int submitTransferAndWait(transfer_engine_t engine, batch_id_t batch_id,
+                          struct transfer_request *entries, size_t count,
+                          int64_t timeout_ms, struct transfer_status *status) {
+    // Best effort: without a subscription the wait polls
+    enableBatchCompletionNotify(engine, batch_id);
+    int ret = submitTransfer(engine, batch_id, entries, count);
+    if (ret) return ret;
+    return waitBatchTransfer(engine, batch_id, timeout_ms, status);
+}
+
 notify_msg_t *getNotifsFromEngine(transfer_engine_t engine, int *size) {
     TransferEngine *native = (TransferEngine *)engine;
     std::vector<TransferMetadata::NotifyDesc> notifies_desc;
@@ -0,0 +1,116 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transfer_engine_coro.h"
+
+#include <async_simple/Executor.h>
+#include <glog/logging.h>
+
+#include <atomic>
+#include <coroutine>
+
+namespace mooncake {
+namespace {
+
+// Lives in the frame of transferAsync, shared by the awaiter and the
+// completion callback
+struct BatchCompletion {
+    // Set by the second of await_suspend and the callback to get there,
+    // which is the one resuming the coroutine
+    std::atomic<bool> arrived{false};
+    bool failed = false;
+};
+
+class BatchCompletionAwaiter {
+   public:
+    BatchCompletionAwaiter(TransferEngine& engine, BatchID batch_id,
+                           const std::vector<TransferRequest>& entries,
+                           BatchCompletion& completion,
+                           async_simple::Executor* executor = nullptr)
+        : engine_(engine),
+          batch_id_(batch_id),
+          entries_(entries),
+          completion_(completion),
+          executor_(executor) {}
+
+    // Called by Lazy with the executor of the awaiting coroutine
+    BatchCompletionAwaiter coAwait(async_simple::Executor* executor) {
+        return BatchCompletionAwaiter(engine_, batch_id_, entries_,
+                                      completion_, executor);
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        auto completion = &completion_;
+        auto executor = executor_;
+        // The batch may complete, and the coroutine be resumed, before
+        // submitTransfer returns, so neither may use the awaiter after
+        // that
+        Status status = engine_.setBatchCompletionCallback(
+            batch_id_, [completion, executor, handle](BatchID, bool failed) {
+                completion->failed = failed;
+                if (!completion->arrived.exchange(true,
+                                                  std::memory_order_acq_rel))
+                    return;
+                if (!executor ||
+                    !executor->schedule([handle] { handle.resume(); }))
+                    handle.resume();
+            });
+        if (status.ok()) status = engine_.submitTransfer(batch_id_, entries_);
+        if (!status.ok()) {
+            // Not all tasks are submitted, so the callback does not run
+            status_ = status;
+            return false;
+        }
+        return !completion->arrived.exchange(true, std::memory_order_acq_rel);
+    }
+
+    Status await_resume() {
+        if (!status_.ok()) return status_;
+        if (completion_.failed)
+            return Status::Endpoint("Failed to transfer the batch");
+        return Status::OK();
+    }
+
+   private:
+    TransferEngine& engine_;
+    const BatchID batch_id_;
+    const std::vector<TransferRequest>& entries_;
+    BatchCompletion& completion_;
+    async_simple::Executor* const executor_;
+    Status status_;
+};
+
+}  // namespace
+
+async_simple::coro::Lazy<Status> transferAsync(
+    TransferEngine& engine, std::vector<TransferRequest> entries) {
+    if (entries.empty()) co_return Status::OK();
+    auto batch_id = engine.allocateBatchID(entries.size());
+    if (batch_id == INVALID_BATCH_ID) {
+        co_return Status::TooManyRequests("Failed to allocate batch ID");
+    }
+    BatchCompletion completion;
+    Status status = co_await BatchCompletionAwaiter(engine, batch_id,
+                                                    entries, completion);
+    auto free_status = engine.freeBatchID(batch_id);
+    if (!free_status.ok()) {
+        LOG(ERROR) << "Failed to free batch " << batch_id << ": "
+                   << free_status.ToString();
+    }
+    co_return status;
+}
+
+}  // namespace mooncake
@@ -27,9 +27,11 @@
 #include <sstream>
 #endif
 
+#include "config.h"
 #include "transfer_metadata_plugin.h"
 #include "transport/transport.h"
 #include "transport/barex_transport/barex_transport.h"
+#include "transport/rdma_transport/rdma_transport.h"
 
 namespace mooncake {
 
@@ -189,6 +191,14 @@ int TransferEngineImpl::init(const std::string& metadata_conn_string,
     multi_transports_ =
         std::make_shared<MultiTransport>(metadata_, local_server_name_);
 #endif
+    if (globalConfig().gpu_mr_cache) {
+        registration_cache_ = std::make_unique<MemoryRegistrationCache>(
+            MemoryRegistrationCache::resolveDeviceAllocation,
+            [this](void* addr) {
+                return unregisterLocalMemoryInternal(addr, true);
+            },
+            globalConfig().gpu_mr_cache_idle_size);
+    }
     int ret = metadata_->addRpcMetaEntry(local_server_name_, desc);
     if (ret) return ret;
 
@@ -279,6 +289,20 @@ int TransferEngineImpl::init(const std::string& metadata_conn_string,
                 return -1;
             }
             LOG(INFO) << "Using RDMA transport (RoCE/iWARP)";
+#ifdef USE_INTRA_NVLINK
+            if (globalConfig().multi_path) {
+                // Shares the RDMA segment, used for peers on this host
+                t = multi_transports_->installTransport("nvlink_intra",
+                                                        nullptr);
+                if (!t) {
+                    LOG(ERROR) << "Failed to install Intra-Node NVLink "
+                                  "transport";
+                    return -1;
+                }
+                LOG(INFO) << "Using Intra-Node NVLink transport for peers on "
+                             "this host (MC_MULTI_PATH set)";
+            }
+#endif
         }
 
 #else
@@ -383,6 +407,102 @@ int TransferEngineImpl::getNotifies(
     return metadata_->getNotifies(notifies);
 }
 
+Status TransferEngineImpl::enableBatchCompletionNotify(BatchID batch_id) {
+    auto& batch_desc = Transport::toBatchDesc(batch_id);
+    if (!batch_desc.task_list.empty()) {
+        return Status::InvalidArgument(
+            "Completion notification must be enabled before submitting");
+    }
+    batch_desc.notify_completion = true;
+    return Status::OK();
+}
+
+Status TransferEngineImpl::getBatchCompletionFd(BatchID batch_id, int& fd) {
+    auto status = enableBatchCompletionNotify(batch_id);
+    if (!status.ok()) return status;
+    auto& batch_desc = Transport::toBatchDesc(batch_id);
+    if (batch_desc.completion_fd < 0) {
+        batch_desc.completion_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (batch_desc.completion_fd < 0) {
+            PLOG(ERROR) << "Failed to create completion eventfd";
+            return Status::Context("Failed to create completion eventfd");
+        }
+    }
+    fd = batch_desc.completion_fd;
+    return Status::OK();
+}
+
+Status TransferEngineImpl::setBatchCompletionCallback(
+    BatchID batch_id, std::function<void(BatchID, bool)> callback) {
+    auto status = enableBatchCompletionNotify(batch_id);
+    if (!status.ok()) return status;
+    Transport::toBatchDesc(batch_id).completion_callback = std::move(callback);
+    return Status::OK();
+}
+
+Status TransferEngineImpl::waitBatchCompletion(BatchID batch_id,
+                                               int64_t timeout_ms) {
+    auto& batch_desc = Transport::toBatchDesc(batch_id);
+#ifndef USE_EVENT_DRIVEN_COMPLETION
+    if (!batch_desc.notify_completion) {
+        return Status::InvalidArgument(
+            "Completion notification is not enabled for the batch");
+    }
+#endif
+    if (batch_desc.is_finished.load(std::memory_order_acquire)) {
+        return Status::OK();
+    }
+    std::unique_lock<std::mutex> lock(batch_desc.completion_mutex);
+    bool completed = batch_desc.completion_cv.wait_for(
+        lock, std::chrono::milliseconds(timeout_ms), [&batch_desc] {
+            return batch_desc.is_finished.load(std::memory_order_relaxed);
+        });
+    if (!completed) {
+        return Status::BatchBusy("Batch is not completed before the timeout");
+    }
+    return Status::OK();
+}
+
+Status TransferEngineImpl::cancelBatch(BatchID batch_id) {
+    auto& batch_desc = Transport::toBatchDesc(batch_id);
+    batch_desc.is_canceled.store(true, std::memory_order_relaxed);
+    return Status::OK();
+}
+
+bool TransferEngineImpl::notifyOnCompletion(
+    BatchID batch_id, const std::vector<TransferRequest>& entries,
+    const TransferMetadata::NotifyDesc& notify_msg) {
+    if (!globalConfig().rdma_notify_imm) return false;
+    auto& batch_desc = Transport::toBatchDesc(batch_id);
+    // The completion of a batch is only signalled once batch_size tasks
+    // are submitted; subscriptions of the caller are left alone
+    if (batch_desc.notify_completion || !batch_desc.task_list.empty() ||
+        entries.size() != batch_desc.batch_size)
+        return false;
+    auto target_id = entries[0].target_id;
+    auto desc = metadata_->getSegmentDescByID(target_id);
+    if (!desc || desc->protocol != "rdma" || !desc->rdma_notify_imm)
+        return false;
+    auto transport = multi_transports_->getTransport("rdma");
+    if (!transport) return false;
+    for (auto& entry : entries)
+        if (entry.target_id != target_id) return false;
+
+    batch_desc.notify_completion = true;
+    batch_desc.completion_callback = [this, transport, target_id, notify_msg](
+                                         BatchID, bool failed) {
+        // Like the poll, which only sends it once the batch is COMPLETED
+        if (failed || !transport->sendNotify(target_id, notify_msg)) return;
+        // The callback must not block, so the rare fallback to the RPC,
+        // e.g. when every notify slot is in flight, gets its own thread
+        std::thread([this, target_id, notify_msg] {
+            if (sendNotifyByID(target_id, notify_msg))
+                LOG(ERROR) << "Failed to send notify message";
+        }).detach();
+    };
+    return true;
+}
+
 int TransferEngineImpl::sendNotifyByID(
     SegmentID target_id, TransferMetadata::NotifyDesc notify_msg) {
     auto desc = metadata_->getSegmentDescByID(target_id);
@@ -438,6 +558,27 @@ Status TransferEngineImpl::CheckSegmentStatus(SegmentID sid) {
 #endif
 }
 
+int TransferEngineImpl::preconnectSegments(
+    const std::vector<std::string>& segment_names, bool pin) {
+    // One batched lookup instead of one round trip per segment
+    metadata_->prefetchSegmentDescs(segment_names);
+    std::vector<SegmentID> target_ids;
+    target_ids.reserve(segment_names.size());
+    for (auto& segment_name : segment_names) {
+        auto handle = openSegment(segment_name);
+        if (handle == (Transport::SegmentHandle)-1) {
+            LOG(ERROR) << "Cannot open segment " << segment_name;
+            return ERR_INVALID_ARGUMENT;
+        }
+        target_ids.push_back(handle);
+    }
+    for (auto transport : multi_transports_->listTransports()) {
+        int ret = transport->preconnectSegments(target_ids, pin);
+        if (ret) return ret;
+    }
+    return 0;
+}
+
 int TransferEngineImpl::closeSegment(Transport::SegmentHandle handle) {
     return 0;
 }
@@ -466,6 +607,23 @@ int TransferEngineImpl::registerLocalMemory(void* addr, size_t length,
                                             const std::string& location,
                                             bool remote_accessible,
                                             bool update_metadata) {
+    if (registration_cache_ && length) {
+        int ret = registration_cache_->acquire(
+            addr, length, [&](void* block_addr, size_t block_length) {
+                return registerLocalMemoryInternal(block_addr, block_length,
+                                                   location, remote_accessible,
+                                                   update_metadata);
+            });
+        // Otherwise addr is not device memory
+        if (ret <= 0) return ret;
+    }
+    return registerLocalMemoryInternal(addr, length, location,
+                                       remote_accessible, update_metadata);
+}
+
+int TransferEngineImpl::registerLocalMemoryInternal(
+    void* addr, size_t length, const std::string& location,
+    bool remote_accessible, bool update_metadata) {
     if (checkOverlap(addr, length)) {
         LOG(ERROR)
             << "Transfer Engine does not support overlapped memory region";
@@ -490,6 +648,19 @@ int TransferEngineImpl::registerLocalMemory(void* addr, size_t length,
 
 int TransferEngineImpl::unregisterLocalMemory(void* addr,
                                               bool update_metadata) {
+    // Blocks of the cache stay registered until evicted or freed
+    if (registration_cache_ && registration_cache_->release(addr) == 0)
+        return 0;
+    return unregisterLocalMemoryInternal(addr, update_metadata);
+}
+
+int TransferEngineImpl::notifyMemoryFreed(void* addr) {
+    if (!registration_cache_) return 0;
+    return registration_cache_->invalidate(addr);
+}
+
+int TransferEngineImpl::unregisterLocalMemoryInternal(void* addr,
+                                                      bool update_metadata) {
     for (auto& transport : multi_transports_->listTransports()) {
         int ret = transport->unregisterLocalMemory(addr, update_metadata);
         if (ret) return ret;
@@ -588,6 +759,48 @@ void TransferEngineImpl::InitializeMetricsConfig() {
                          << ", using default: " << metrics_interval_seconds_;
         }
     }
+
+    // Check for the port of the Prometheus endpoint
+    const char* port_env = getenv("MC_TE_METRIC_PORT");
+    if (port_env) {
+        try {
+            int port = std::stoi(port_env);
+            if (port > 0 && port <= 65535) {
+                metrics_http_port_ = static_cast<uint16_t>(port);
+            } else {
+                LOG(WARNING) << "Invalid MC_TE_METRIC_PORT value: "
+                             << port_env << ", metrics will not be served";
+            }
+        } catch (const std::exception& e) {
+            LOG(WARNING) << "Failed to parse MC_TE_METRIC_PORT: " << port_env
+                         << ", metrics will not be served";
+        }
+    }
+}
+
+std::string TransferEngineImpl::GetPrometheusMetrics() {
+    std::string metrics;
+    task_completion_latency_us_.serialize(metrics);
+    if (!multi_transports_) return metrics;
+    auto rdma_transport =
+        dynamic_cast<RdmaTransport*>(multi_transports_->getTransport("rdma"));
+    if (rdma_transport) metrics += rdma_transport->getPrometheusMetrics();
+    return metrics;
+}
+
+void TransferEngineImpl::StartMetricsHttpServer() {
+    using namespace coro_http;
+    metrics_http_server_ =
+        std::make_unique<coro_http_server>(1, metrics_http_port_);
+    metrics_http_server_->set_http_handler<GET>(
+        "/metrics", [this](coro_http_request& req, coro_http_response& resp) {
+            resp.add_header("Content-Type", "text/plain; version=0.0.4");
+            resp.set_status_and_content(status_type::ok,
+                                        GetPrometheusMetrics());
+        });
+    metrics_http_server_->async_start();
+    LOG(INFO) << "Serving transfer engine metrics on port "
+              << metrics_http_port_ << " at /metrics";
 }
 
 void TransferEngineImpl::StartMetricsReportingThread() {
@@ -599,6 +812,7 @@ void TransferEngineImpl::StartMetricsReportingThread() {
     }
 
     should_stop_metrics_thread_ = false;
+    if (metrics_http_port_) StartMetricsHttpServer();
 
     // Initialize previous bucket counts
     {
@@ -611,6 +825,7 @@ void TransferEngineImpl::StartMetricsReportingThread() {
         LOG(INFO) << "Metrics reporting thread started (interval: "
                   << metrics_interval_seconds_ << "s)";
         constexpr double kBytesPerMegabyte = 1024.0 * 1024.0;
+        std::unordered_map<std::string, uint64_t> prev_device_bytes;
 
         while (!should_stop_metrics_thread_) {
             // Sleep for the interval, checking periodically for stop signal
@@ -674,6 +889,26 @@ void TransferEngineImpl::StartMetricsReportingThread() {
                         << throughput_megabytes_per_second << " MB/s";
             }
 
+            // Per-NIC throughput, showing how slices spread over the rails
+            auto rdma_transport = dynamic_cast<RdmaTransport*>(
+                multi_transports_->getTransport("rdma"));
+            if (rdma_transport) {
+                bool first_device = true;
+                for (auto& [device_name, bytes] :
+                     rdma_transport->getDeviceTransferredBytes()) {
+                    uint64_t delta = bytes - prev_device_bytes[device_name];
+                    prev_device_bytes[device_name] = bytes;
+                    if (!has_throughput) continue;
+                    log_msg << (first_device ? " (" : ", ") << device_name
+                            << ": " << std::fixed << std::setprecision(2)
+                            << delta / (metrics_interval_seconds_ *
+                                        kBytesPerMegabyte)
+                            << " MB/s";
+                    first_device = false;
+                }
+                if (!first_device) log_msg << ")";
+            }
+
             if (!has_latency) {
                 LOG(INFO) << log_msg.str();
                 continue;
@@ -724,6 +959,10 @@ void TransferEngineImpl::StartMetricsReportingThread() {
 }
 
 void TransferEngineImpl::StopMetricsReportingThread() {
+    if (metrics_http_server_) {
+        metrics_http_server_->stop();
+        metrics_http_server_.reset();
+    }
     should_stop_metrics_thread_ = true;  // Signal the thread to stop
     if (metrics_reporting_thread_.joinable()) {
         LOG(INFO) << "Waiting for metrics reporting thread to join...";
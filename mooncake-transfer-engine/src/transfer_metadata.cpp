@@ -16,8 +16,12 @@
 
 #include <json/value.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <random>
 #include <set>
+#include <unordered_set>
 
 #include "common.h"
 #include "config.h"
@@ -84,6 +88,370 @@ struct TransferHandshakeUtil {
     }
 };
 
+namespace {
+
+// Segment descriptors in compact binary form (MC_METADATA_BINARY) are
+// carried by a JSON object holding the encoding and the base64 data
+const char *kBinaryEncoding = "binary/1";
+// Key of the buffers changed since a versioned descriptor was published
+const char *kDeltaKeySuffix = "@delta";
+// Deltas of up to this many buffers, or a quarter of the buffers of the
+// published descriptor, are published instead of the whole descriptor
+const size_t kMinDeltaBuffers = 16;
+
+const char kBase64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string toBase64(const std::string &data) {
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t n = (uint8_t)data[i] << 16 | (uint8_t)data[i + 1] << 8 |
+                     (uint8_t)data[i + 2];
+        out.push_back(kBase64Chars[n >> 18]);
+        out.push_back(kBase64Chars[(n >> 12) & 63]);
+        out.push_back(kBase64Chars[(n >> 6) & 63]);
+        out.push_back(kBase64Chars[n & 63]);
+    }
+    if (i < data.size()) {
+        uint32_t n = (uint8_t)data[i] << 16;
+        if (i + 1 < data.size()) n |= (uint8_t)data[i + 1] << 8;
+        out.push_back(kBase64Chars[n >> 18]);
+        out.push_back(kBase64Chars[(n >> 12) & 63]);
+        out.push_back(i + 1 < data.size() ? kBase64Chars[(n >> 6) & 63] : '=');
+        out.push_back('=');
+    }
+    return out;
+}
+
+bool fromBase64(const std::string &text, std::string &data) {
+    data.clear();
+    data.reserve(text.size() / 4 * 3);
+    uint32_t n = 0;
+    int bits = 0;
+    for (char c : text) {
+        if (c == '=') break;
+        const char *pos = strchr(kBase64Chars, c);
+        if (!c || !pos) return false;
+        n = n << 6 | (pos - kBase64Chars);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            data.push_back(static_cast<char>((n >> bits) & 0xff));
+        }
+    }
+    return true;
+}
+
+// Integers are LEB128 varints, strings are prefixed by their length
+void putVarint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void putString(std::string &out, const std::string &value) {
+    putVarint(out, value.size());
+    out.append(value);
+}
+
+void putKeys(std::string &out, const std::vector<uint32_t> &keys) {
+    putVarint(out, keys.size());
+    for (auto key : keys) putVarint(out, key);
+}
+
+// Reads what put*() wrote; ok is cleared once the data runs out
+struct BinaryReader {
+    const std::string &data;
+    size_t pos = 0;
+    bool ok = true;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; ok && shift < 64 && pos < data.size();
+             shift += 7) {
+            uint8_t byte = data[pos++];
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    std::string string() {
+        uint64_t size = varint();
+        if (!ok || size > data.size() - pos) {
+            ok = false;
+            return "";
+        }
+        pos += size;
+        return data.substr(pos - size, size);
+    }
+
+    void keys(std::vector<uint32_t> &keys) {
+        uint64_t count = varint();
+        // Each key takes a byte at least
+        if (count > data.size() - pos) ok = false;
+        for (uint64_t i = 0; ok && i < count; ++i)
+            keys.push_back(static_cast<uint32_t>(varint()));
+    }
+};
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^
+           static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool isRdmaLikeProtocol(const std::string &protocol) {
+    return protocol == "rdma" || protocol == "barex" || protocol == "efa";
+}
+
+bool isShmProtocol(const std::string &protocol) {
+    return protocol == "nvlink" || protocol == "nvlink_intra" ||
+           protocol == "hip" || protocol == "ubshmem";
+}
+
+bool isBinaryProtocol(const std::string &protocol) {
+    return isRdmaLikeProtocol(protocol) || isShmProtocol(protocol) ||
+           protocol == "tcp" || protocol == "ascend" || protocol == "cxl";
+}
+
+// Everything in a segment descriptor but its buffers and timestamp
+std::string encodeBinaryHeader(const TransferMetadata::SegmentDesc &desc) {
+    std::string out;
+    putString(out, desc.name);
+    putString(out, desc.protocol);
+    putVarint(out, static_cast<uint32_t>(desc.tcp_data_port));
+    putVarint(out,
+              (desc.tcp_persistent ? 1 : 0) | (desc.rdma_notify_imm ? 2 : 0));
+    putVarint(out, desc.devices.size());
+    for (const auto &device : desc.devices) {
+        putString(out, device.name);
+        putVarint(out, device.lid);
+        putString(out, device.gid);
+    }
+    if (isRdmaLikeProtocol(desc.protocol))
+        putString(out, Json::FastWriter{}.write(desc.topology.toJson()));
+    if (desc.protocol == "cxl") {
+        putString(out, desc.cxl_name);
+        putVarint(out, desc.cxl_base_addr);
+    }
+    if (desc.protocol == "ascend") {
+        const auto &rank_info = desc.rank_info;
+        putVarint(out, rank_info.rankId);
+        putString(out, rank_info.hostIp);
+        putVarint(out, rank_info.hostPort);
+        putVarint(out, rank_info.deviceLogicId);
+        putVarint(out, rank_info.devicePhyId);
+        putVarint(out, rank_info.deviceType);
+        putString(out, rank_info.deviceIp);
+        putVarint(out, rank_info.devicePort);
+        putVarint(out, rank_info.pid);
+    }
+    return out;
+}
+
+bool decodeBinaryHeader(BinaryReader &in, TransferMetadata::SegmentDesc &desc) {
+    desc.name = in.string();
+    desc.protocol = in.string();
+    desc.tcp_data_port = static_cast<int>(in.varint());
+    uint64_t flags = in.varint();
+    desc.tcp_persistent = flags & 1;
+    desc.rdma_notify_imm = flags & 2;
+    uint64_t count = in.varint();
+    for (uint64_t i = 0; in.ok && i < count; ++i) {
+        TransferMetadata::DeviceDesc device;
+        device.name = in.string();
+        device.lid = static_cast<uint16_t>(in.varint());
+        device.gid = in.string();
+        desc.devices.push_back(device);
+    }
+    if (in.ok && isRdmaLikeProtocol(desc.protocol) &&
+        desc.topology.parse(in.string())) {
+        LOG(WARNING) << "Corrupted topology of segment descriptor, name "
+                     << desc.name;
+    }
+    if (desc.protocol == "cxl") {
+        desc.cxl_name = in.string();
+        desc.cxl_base_addr = in.varint();
+    }
+    if (desc.protocol == "ascend") {
+        auto &rank_info = desc.rank_info;
+        rank_info.rankId = in.varint();
+        rank_info.hostIp = in.string();
+        rank_info.hostPort = in.varint();
+        rank_info.deviceLogicId = in.varint();
+        rank_info.devicePhyId = in.varint();
+        rank_info.deviceType = in.varint();
+        rank_info.deviceIp = in.string();
+        rank_info.devicePort = in.varint();
+        rank_info.pid = in.varint();
+    }
+    return in.ok;
+}
+
+// Buffers follow each other in memory more often than not, so a buffer is
+// encoded relative to the one before: its address as the distance from where
+// that one ends, and its name as an index into the names seen so far
+void encodeBinaryBuffers(
+    const std::string &protocol,
+    const std::vector<TransferMetadata::BufferDesc> &buffers,
+    std::string &out) {
+    const bool cxl = protocol == "cxl";
+    putVarint(out, buffers.size());
+    std::unordered_map<std::string, uint64_t> names;
+    uint64_t prev_end = 0;
+    for (const auto &buffer : buffers) {
+        auto iter = names.find(buffer.name);
+        if (iter != names.end()) {
+            putVarint(out, iter->second);
+        } else {
+            uint64_t index = names.size();
+            putVarint(out, index);
+            putString(out, buffer.name);
+            names.emplace(buffer.name, index);
+        }
+        const uint64_t start = cxl ? buffer.offset : buffer.addr;
+        putVarint(out, zigzag(static_cast<int64_t>(start - prev_end)));
+        putVarint(out, buffer.length);
+        prev_end = start + buffer.length;
+        const bool same_keys = buffer.rkey == buffer.lkey;
+        putVarint(out, (same_keys ? 1 : 0) | (buffer.shm_name.empty() ? 0 : 2));
+        putKeys(out, buffer.lkey);
+        if (!same_keys) putKeys(out, buffer.rkey);
+        if (!buffer.shm_name.empty()) putString(out, buffer.shm_name);
+    }
+}
+
+bool decodeBinaryBuffers(BinaryReader &in, const std::string &protocol,
+                         std::vector<TransferMetadata::BufferDesc> &buffers) {
+    const bool cxl = protocol == "cxl";
+    uint64_t count = in.varint();
+    std::vector<std::string> names;
+    uint64_t prev_end = 0;
+    for (uint64_t i = 0; in.ok && i < count; ++i) {
+        TransferMetadata::BufferDesc buffer{};
+        uint64_t index = in.varint();
+        if (index == names.size()) names.push_back(in.string());
+        if (!in.ok || index >= names.size()) return false;
+        buffer.name = names[index];
+        const uint64_t start = prev_end + unzigzag(in.varint());
+        (cxl ? buffer.offset : buffer.addr) = start;
+        buffer.length = in.varint();
+        prev_end = start + buffer.length;
+        uint64_t flags = in.varint();
+        in.keys(buffer.lkey);
+        if (flags & 1)
+            buffer.rkey = buffer.lkey;
+        else
+            in.keys(buffer.rkey);
+        if (flags & 2) buffer.shm_name = in.string();
+        if (!in.ok || buffer.name.empty() || !buffer.length ||
+            (!cxl && !buffer.addr) ||
+            (isRdmaLikeProtocol(protocol) &&
+             (buffer.rkey.empty() ||
+              buffer.rkey.size() != buffer.lkey.size())) ||
+            (isShmProtocol(protocol) && buffer.shm_name.empty()))
+            return false;
+        buffers.push_back(std::move(buffer));
+    }
+    return in.ok;
+}
+
+bool sameBuffer(const TransferMetadata::BufferDesc &lhs,
+                const TransferMetadata::BufferDesc &rhs, bool cxl) {
+    return (cxl ? lhs.offset == rhs.offset : lhs.addr == rhs.addr) &&
+           lhs.length == rhs.length && lhs.name == rhs.name &&
+           lhs.lkey == rhs.lkey && lhs.rkey == rhs.rkey &&
+           lhs.shm_name == rhs.shm_name;
+}
+
+// The buffers of to that are not in from, and those of from not in to
+void diffBuffers(const std::vector<TransferMetadata::BufferDesc> &from,
+                 const std::vector<TransferMetadata::BufferDesc> &to, bool cxl,
+                 std::vector<TransferMetadata::BufferDesc> &added,
+                 std::vector<TransferMetadata::BufferDesc> &removed) {
+    std::unordered_multimap<uint64_t, size_t> unmatched;
+    for (size_t i = 0; i < from.size(); ++i)
+        unmatched.emplace(cxl ? from[i].offset : from[i].addr, i);
+    for (const auto &buffer : to) {
+        auto range =
+            unmatched.equal_range(cxl ? buffer.offset : buffer.addr);
+        auto iter = range.first;
+        while (iter != range.second &&
+               !sameBuffer(from[iter->second], buffer, cxl))
+            ++iter;
+        if (iter == range.second)
+            added.push_back(buffer);
+        else
+            unmatched.erase(iter);
+    }
+    for (auto &entry : unmatched) removed.push_back(from[entry.second]);
+}
+
+std::shared_ptr<TransferMetadata::SegmentDesc> decodeBinarySegmentDesc(
+    const Json::Value &segmentJSON, const std::string &segment_name) {
+    if (segmentJSON["encoding"].asString() != kBinaryEncoding) {
+        LOG(ERROR) << "Unsupported segment descriptor encoding "
+                   << segmentJSON["encoding"].asString() << ", name "
+                   << segment_name;
+        return nullptr;
+    }
+    std::string data;
+    auto desc = std::make_shared<TransferMetadata::SegmentDesc>();
+    BinaryReader in{data};
+    if (!fromBase64(segmentJSON["data"].asString(), data) ||
+        !decodeBinaryHeader(in, *desc) ||
+        !decodeBinaryBuffers(in, desc->protocol, desc->buffers) ||
+        in.pos != data.size()) {
+        LOG(WARNING) << "Corrupted segment descriptor, name " << segment_name;
+        return nullptr;
+    }
+    desc->timestamp = segmentJSON["timestamp"].asString();
+    return desc;
+}
+
+// Applies the delta published for a versioned segment descriptor, unless it
+// belongs to another version of the descriptor
+void applySegmentDelta(const Json::Value &segmentJSON,
+                       const Json::Value &deltaJSON,
+                       TransferMetadata::SegmentDesc &desc) {
+    if (!deltaJSON.isMember("base_version") ||
+        deltaJSON["base_version"].asUInt64() !=
+            segmentJSON["version"].asUInt64())
+        return;
+    std::string data;
+    std::vector<TransferMetadata::BufferDesc> added, removed;
+    BinaryReader in{data};
+    if (!fromBase64(deltaJSON["data"].asString(), data) ||
+        !decodeBinaryBuffers(in, desc.protocol, added) ||
+        !decodeBinaryBuffers(in, desc.protocol, removed) ||
+        in.pos != data.size()) {
+        LOG(WARNING) << "Corrupted segment descriptor delta, name "
+                     << desc.name;
+        return;
+    }
+    const bool cxl = desc.protocol == "cxl";
+    for (const auto &buffer : removed) {
+        auto iter = std::find_if(
+            desc.buffers.begin(), desc.buffers.end(),
+            [&](const TransferMetadata::BufferDesc &entry) {
+                return sameBuffer(entry, buffer, cxl);
+            });
+        if (iter != desc.buffers.end()) desc.buffers.erase(iter);
+    }
+    desc.buffers.insert(desc.buffers.end(), added.begin(), added.end());
+}
+
+}  // namespace
+
 TransferMetadata::TransferMetadata(const std::string &conn_string) {
     next_segment_id_.store(1);
 
@@ -118,10 +486,23 @@ TransferMetadata::TransferMetadata(const std::string &conn_string) {
         LOG(ERROR)
             << "Unable to create metadata storage plugin with conn string "
             << conn_string;
+        return;
+    }
+    auto on_change = [this](const std::string &key, bool) {
+        onSegmentKeyChanged(key);
+    };
+    if (globalConfig().metacache && globalConfig().metacache_watch &&
+        storage_plugin_->watchPrefix(common_key_prefix_, on_change)) {
+        LOG(INFO) << "Watching segment descriptors under "
+                  << common_key_prefix_;
     }
 }
 
-TransferMetadata::~TransferMetadata() { handshake_plugin_.reset(); }
+TransferMetadata::~TransferMetadata() {
+    // Stops the watch, which calls back into this object
+    storage_plugin_.reset();
+    handshake_plugin_.reset();
+}
 
 std::string TransferMetadata::getFullMetadataKey(
     const std::string &segment_name) const {
@@ -162,11 +543,34 @@ int TransferMetadata::getNotifies(std::vector<NotifyDesc> &notifies) {
     return 0;
 }
 
+void TransferMetadata::addNotify(NotifyDesc &&notify) {
+    RWSpinlock::WriteGuard guard(notify_lock_);
+    notifys.push_back(std::move(notify));
+}
+
 int TransferMetadata::encodeSegmentDesc(const SegmentDesc &desc,
                                         Json::Value &segmentJSON) {
+    if (globalConfig().metadata_binary) {
+        if (!isBinaryProtocol(desc.protocol)) {
+            LOG(ERROR) << "Unsupported segment descriptor for register, name "
+                       << desc.name << " protocol " << desc.protocol;
+            return ERR_METADATA;
+        }
+        std::string data = encodeBinaryHeader(desc);
+        encodeBinaryBuffers(desc.protocol, desc.buffers, data);
+        segmentJSON["name"] = desc.name;
+        segmentJSON["encoding"] = kBinaryEncoding;
+        segmentJSON["timestamp"] = getCurrentDateTime();
+        segmentJSON["data"] = toBase64(data);
+        return 0;
+    }
+
     segmentJSON["name"] = desc.name;
     segmentJSON["protocol"] = desc.protocol;
     segmentJSON["tcp_data_port"] = desc.tcp_data_port;
+    if (desc.protocol == "tcp")
+        segmentJSON["tcp_persistent"] = desc.tcp_persistent;
+    if (desc.rdma_notify_imm) segmentJSON["rdma_notify_imm"] = true;
     segmentJSON["timestamp"] = getCurrentDateTime();
 
     if (segmentJSON["protocol"] == "rdma" ||
@@ -194,6 +598,9 @@ int TransferMetadata::encodeSegmentDesc(const SegmentDesc &desc,
             Json::Value lkeyJSON(Json::arrayValue);
             for (auto &entry : buffer.lkey) lkeyJSON.append(entry);
             bufferJSON["lkey"] = lkeyJSON;
+            // Also reachable over intra-node NVLink (MC_MULTI_PATH)
+            if (!buffer.shm_name.empty())
+                bufferJSON["shm_name"] = buffer.shm_name;
             buffersJSON.append(bufferJSON);
         }
         segmentJSON["buffers"] = buffersJSON;
@@ -314,21 +721,88 @@ int TransferMetadata::removeSegmentDesc(const std::string &segment_name) {
         }
         return 0;
     }
-    if (!storage_plugin_->remove(getFullMetadataKey(segment_name))) {
+    const auto key = getFullMetadataKey(segment_name);
+    if (!storage_plugin_->remove(key)) {
         LOG(ERROR) << "Failed to unregister segment descriptor, name "
                    << segment_name;
         return ERR_METADATA;
     }
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    if (key == published_key_) {
+        storage_plugin_->remove(key + kDeltaKeySuffix);
+        published_key_.clear();
+        published_buffers_.clear();
+    }
     return 0;
 }
 
+int TransferMetadata::publishLocalSegmentDesc(const SegmentDesc &desc) {
+    if (!isBinaryProtocol(desc.protocol))
+        return updateSegmentDesc(desc.name, desc);
+    const auto key = getFullMetadataKey(desc.name);
+    const auto header = encodeBinaryHeader(desc);
+    auto publish_delta = [&](const std::vector<BufferDesc> &added,
+                             const std::vector<BufferDesc> &removed) {
+        std::string data;
+        encodeBinaryBuffers(desc.protocol, added, data);
+        encodeBinaryBuffers(desc.protocol, removed, data);
+        Json::Value deltaJSON;
+        deltaJSON["encoding"] = kBinaryEncoding;
+        deltaJSON["base_version"] =
+            static_cast<Json::UInt64>(published_version_);
+        deltaJSON["data"] = toBase64(data);
+        if (!storage_plugin_->set(key + kDeltaKeySuffix, deltaJSON)) {
+            LOG(ERROR) << "Failed to register segment descriptor delta, name "
+                       << desc.name << " protocol " << desc.protocol;
+            return ERR_METADATA;
+        }
+        return 0;
+    };
+
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    if (key == published_key_ && header == published_header_) {
+        std::vector<BufferDesc> added, removed;
+        diffBuffers(published_buffers_, desc.buffers, desc.protocol == "cxl",
+                    added, removed);
+        if (added.size() + removed.size() <=
+            std::max(kMinDeltaBuffers, published_buffers_.size() / 4))
+            return publish_delta(added, removed);
+    }
+
+    Json::Value segmentJSON;
+    int ret = encodeSegmentDesc(desc, segmentJSON);
+    if (ret) return ret;
+    // Random at first, so that a delta left behind by an earlier process
+    // does not apply to the descriptors of this one
+    if (!published_version_) {
+        std::random_device random;
+        published_version_ = static_cast<uint64_t>(random()) << 32 | random();
+    }
+    ++published_version_;
+    segmentJSON["version"] = static_cast<Json::UInt64>(published_version_);
+    published_key_.clear();
+    if (!storage_plugin_->set(key, segmentJSON)) {
+        LOG(ERROR) << "Failed to register segment descriptor, name "
+                   << desc.name << " protocol " << desc.protocol;
+        return ERR_METADATA;
+    }
+    published_key_ = key;
+    published_header_ = header;
+    published_buffers_ = desc.buffers;
+    return publish_delta({}, {});
+}
+
 std::shared_ptr<TransferMetadata::SegmentDesc>
 TransferMetadata::decodeSegmentDesc(Json::Value &segmentJSON,
                                     const std::string &segment_name) {
+    if (segmentJSON.isMember("encoding"))
+        return decodeBinarySegmentDesc(segmentJSON, segment_name);
     auto desc = std::make_shared<SegmentDesc>();
     desc->name = segmentJSON["name"].asString();
     desc->protocol = segmentJSON["protocol"].asString();
     desc->tcp_data_port = segmentJSON["tcp_data_port"].asInt();
+    desc->tcp_persistent = segmentJSON["tcp_persistent"].asBool();
+    desc->rdma_notify_imm = segmentJSON["rdma_notify_imm"].asBool();
     if (segmentJSON.isMember("timestamp"))
         desc->timestamp = segmentJSON["timestamp"].asString();
 
@@ -356,6 +830,8 @@ TransferMetadata::decodeSegmentDesc(Json::Value &segmentJSON,
                 buffer.rkey.push_back(rkeyJSON.asUInt());
             for (const auto &lkeyJSON : bufferJSON["lkey"])
                 buffer.lkey.push_back(lkeyJSON.asUInt());
+            if (bufferJSON.isMember("shm_name"))
+                buffer.shm_name = bufferJSON["shm_name"].asString();
             if (buffer.name.empty() || !buffer.addr || !buffer.length ||
                 buffer.rkey.empty() ||
                 buffer.rkey.size() != buffer.lkey.size()) {
@@ -500,6 +976,7 @@ int TransferMetadata::receivePeerMetadata(const Json::Value &peer_json,
 std::shared_ptr<TransferMetadata::SegmentDesc> TransferMetadata::getSegmentDesc(
     const std::string &segment_name) {
     Json::Value peer_json;
+    Json::Value delta_json;
 
     if (p2p_handshake_mode_) {
         auto [ip, port] = parseHostNameWithPort(segment_name);
@@ -524,15 +1001,110 @@ std::shared_ptr<TransferMetadata::SegmentDesc> TransferMetadata::getSegmentDesc(
             return nullptr;
         }
     } else {
-        if (!storage_plugin_->get(getFullMetadataKey(segment_name),
-                                  peer_json)) {
+        const auto key = getFullMetadataKey(segment_name);
+        if (!storage_plugin_->get(key, peer_json)) {
             LOG(WARNING) << "Failed to retrieve segment descriptor, name "
                          << segment_name;
             return nullptr;
         }
+        // Without its delta, the descriptor is served as it was published
+        if (peer_json.isMember("version"))
+            storage_plugin_->get(key + kDeltaKeySuffix, delta_json);
+    }
+
+    auto desc = decodeSegmentDesc(peer_json, segment_name);
+    if (desc && !delta_json.isNull())
+        applySegmentDelta(peer_json, delta_json, *desc);
+    return desc;
+}
+
+std::shared_ptr<TransferMetadata::SegmentDesc>
+TransferMetadata::fetchSegmentDesc(const std::string &segment_name) {
+    std::promise<std::shared_ptr<SegmentDesc>> promise;
+    std::shared_future<std::shared_ptr<SegmentDesc>> inflight;
+    {
+        std::lock_guard<std::mutex> lock(inflight_fetch_mutex_);
+        auto it = inflight_fetches_.find(segment_name);
+        if (it != inflight_fetches_.end())
+            inflight = it->second;
+        else
+            inflight_fetches_[segment_name] = promise.get_future().share();
+    }
+    // Another thread is already fetching this segment
+    if (inflight.valid()) return inflight.get();
+
+    // Fetch segment descriptor without holding lock (may involve network I/O)
+    auto version = segmentVersion(segment_name);
+    auto segment_desc = getSegmentDesc(segment_name);
+    settleSegmentFetch(segment_name, segment_desc, version);
+    promise.set_value(segment_desc);
+
+    std::lock_guard<std::mutex> lock(inflight_fetch_mutex_);
+    inflight_fetches_.erase(segment_name);
+    return segment_desc;
+}
+
+void TransferMetadata::settleSegmentFetch(
+    const std::string &segment_name,
+    const std::shared_ptr<SegmentDesc> &segment_desc, uint64_t version) {
+    RWSpinlock::WriteGuard guard(segment_lock_);
+    // A segment changed again during the fetch stays stale. A failed fetch
+    // keeps serving the cached descriptor, as without watching.
+    auto version_iter = segment_version_map_.find(segment_name);
+    if (version_iter == segment_version_map_.end() ||
+        version_iter->second == version)
+        stale_segments_.erase(segment_name);
+    if (!segment_desc) return;
+
+    auto iter = segment_name_to_id_map_.find(segment_name);
+    SegmentID segment_id;
+    if (iter != segment_name_to_id_map_.end()) {
+        segment_id = iter->second;
+        if (segment_id == LOCAL_SEGMENT_ID) return;
+    } else {
+        segment_id = next_segment_id_.fetch_add(1);
+        segment_name_to_id_map_[segment_name] = segment_id;
+    }
+    segment_id_to_desc_map_[segment_id] = segment_desc;
+}
+
+uint64_t TransferMetadata::segmentVersion(const std::string &segment_name) {
+    RWSpinlock::ReadGuard guard(segment_lock_);
+    auto iter = segment_version_map_.find(segment_name);
+    return iter == segment_version_map_.end() ? 0 : iter->second;
+}
+
+void TransferMetadata::onSegmentKeyChanged(const std::string &key) {
+    RWSpinlock::WriteGuard guard(segment_lock_);
+    if (key.empty()) {
+        // Changes may have been missed, so none of the cache can be trusted
+        for (auto &entry : segment_name_to_id_map_)
+            invalidateSegment(entry.first);
+        return;
     }
+    if (key.compare(0, common_key_prefix_.size(), common_key_prefix_) ||
+        !key.compare(0, rpc_meta_prefix_.size(), rpc_meta_prefix_))
+        return;
+    // Reverse getFullMetadataKey(), deltas belonging to their descriptor
+    auto segment_name = key.substr(common_key_prefix_.size());
+    const size_t suffix_size = strlen(kDeltaKeySuffix);
+    if (segment_name.size() > suffix_size &&
+        !segment_name.compare(segment_name.size() - suffix_size, suffix_size,
+                              kDeltaKeySuffix))
+        segment_name.resize(segment_name.size() - suffix_size);
+    invalidateSegment(segment_name);
+    const std::string ram_prefix = "ram/";
+    if (!segment_name.compare(0, ram_prefix.size(), ram_prefix))
+        invalidateSegment(segment_name.substr(ram_prefix.size()));
+}
 
-    return decodeSegmentDesc(peer_json, segment_name);
+void TransferMetadata::invalidateSegment(const std::string &segment_name) {
+    auto iter = segment_name_to_id_map_.find(segment_name);
+    if (iter != segment_name_to_id_map_.end() &&
+        iter->second == LOCAL_SEGMENT_ID)
+        return;
+    segment_version_map_[segment_name]++;
+    stale_segments_.insert(segment_name);
 }
 
 int TransferMetadata::syncSegmentCache(const std::string &segment_name) {
@@ -548,24 +1120,72 @@ int TransferMetadata::syncSegmentCache(const std::string &segment_name) {
         }
     }
 
-    // Fetch updates without holding lock (may involve network I/O)
-    std::vector<std::pair<std::string, std::shared_ptr<SegmentDesc>>> updates;
     for (const auto &name : names_to_sync) {
-        auto segment_desc = getSegmentDesc(name);
-        if (segment_desc) {
-            updates.emplace_back(name, segment_desc);
-        } else {
+        if (!fetchSegmentDesc(name)) {
             LOG(WARNING) << "segment " << name << " is now invalid";
         }
     }
+    return 0;
+}
 
-    // Apply updates with write lock
-    RWSpinlock::WriteGuard guard(segment_lock_);
-    for (const auto &[name, desc] : updates) {
-        auto it = segment_name_to_id_map_.find(name);
-        if (it != segment_name_to_id_map_.end()) {
-            segment_id_to_desc_map_[it->second] = desc;
+int TransferMetadata::prefetchSegmentDescs(
+    const std::vector<std::string> &segment_names) {
+    std::vector<std::string> names;
+    std::vector<uint64_t> versions;
+    {
+        RWSpinlock::ReadGuard guard(segment_lock_);
+        std::unordered_set<std::string> visited;
+        for (auto &name : segment_names) {
+            if (!visited.insert(name).second) continue;
+            if (segment_name_to_id_map_.count(name) && !isSegmentStale(name))
+                continue;
+            auto iter = segment_version_map_.find(name);
+            names.push_back(name);
+            versions.push_back(
+                iter == segment_version_map_.end() ? 0 : iter->second);
+        }
+    }
+    if (names.empty()) return 0;
+
+    if (p2p_handshake_mode_) {
+        // Descriptors are exchanged with each peer, there is nothing to batch
+        for (auto &name : names) fetchSegmentDesc(name);
+        return 0;
+    }
+
+    std::vector<std::string> keys;
+    keys.reserve(names.size());
+    for (auto &name : names) keys.push_back(getFullMetadataKey(name));
+    std::vector<Json::Value> values;
+    if (!storage_plugin_->getBatch(keys, values)) {
+        LOG(ERROR) << "Failed to retrieve " << keys.size()
+                   << " segment descriptors";
+        return ERR_METADATA;
+    }
+    std::vector<std::string> delta_keys;
+    std::vector<size_t> delta_owners;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!values[i].isMember("version")) continue;
+        delta_keys.push_back(keys[i] + kDeltaKeySuffix);
+        delta_owners.push_back(i);
+    }
+    std::vector<Json::Value> deltas(names.size()), delta_values;
+    if (!delta_keys.empty() &&
+        storage_plugin_->getBatch(delta_keys, delta_values)) {
+        for (size_t i = 0; i < delta_owners.size(); ++i)
+            deltas[delta_owners[i]] = delta_values[i];
+    }
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (values[i].isNull()) {
+            LOG(WARNING) << "Failed to retrieve segment descriptor, name "
+                         << names[i];
+            continue;
         }
+        auto segment_desc = decodeSegmentDesc(values[i], names[i]);
+        if (segment_desc && !deltas[i].isNull())
+            applySegmentDelta(values[i], deltas[i], *segment_desc);
+        if (segment_desc)
+            settleSegmentFetch(names[i], segment_desc, versions[i]);
     }
     return 0;
 }
@@ -573,94 +1193,63 @@ int TransferMetadata::syncSegmentCache(const std::string &segment_name) {
 std::shared_ptr<TransferMetadata::SegmentDesc>
 TransferMetadata::getSegmentDescByName(const std::string &segment_name,
                                        bool force_update) {
-    if (globalConfig().metacache && !force_update) {
-        RWSpinlock::ReadGuard guard(segment_lock_);
-        auto iter = segment_name_to_id_map_.find(segment_name);
-        if (iter != segment_name_to_id_map_.end())
-            return segment_id_to_desc_map_[iter->second];
-    }
-
-    // Check if it's LOCAL_SEGMENT_ID
     {
         RWSpinlock::ReadGuard guard(segment_lock_);
         auto iter = segment_name_to_id_map_.find(segment_name);
         if (iter != segment_name_to_id_map_.end() &&
-            iter->second == LOCAL_SEGMENT_ID) {
-            return segment_id_to_desc_map_[iter->second];
+            (iter->second == LOCAL_SEGMENT_ID ||
+             (globalConfig().metacache && !force_update &&
+              !isSegmentStale(segment_name)))) {
+            auto desc_iter = segment_id_to_desc_map_.find(iter->second);
+            if (desc_iter != segment_id_to_desc_map_.end())
+                return desc_iter->second;
         }
     }
-
-    // Fetch segment descriptor without holding lock (may involve network I/O)
-    auto segment_desc = this->getSegmentDesc(segment_name);
-    if (!segment_desc) return nullptr;
-
-    // Update cache with write lock
-    RWSpinlock::WriteGuard guard(segment_lock_);
-    auto iter = segment_name_to_id_map_.find(segment_name);
-    SegmentID segment_id;
-    if (iter != segment_name_to_id_map_.end()) {
-        segment_id = iter->second;
-    } else {
-        segment_id = next_segment_id_.fetch_add(1);
-    }
-    segment_id_to_desc_map_[segment_id] = segment_desc;
-    segment_name_to_id_map_[segment_name] = segment_id;
-    return segment_desc;
+    return fetchSegmentDesc(segment_name);
 }
 
 std::shared_ptr<TransferMetadata::SegmentDesc>
 TransferMetadata::getSegmentDescByID(SegmentID segment_id, bool force_update) {
-    if (segment_id != LOCAL_SEGMENT_ID &&
-        (!globalConfig().metacache || force_update)) {
-        // Get segment name without holding lock during network I/O
-        std::string segment_name;
-        {
-            RWSpinlock::ReadGuard guard(segment_lock_);
-            if (!segment_id_to_desc_map_.count(segment_id)) return nullptr;
-            segment_name = segment_id_to_desc_map_[segment_id]->name;
-        }
-
-        // Fetch segment descriptor without holding lock (may involve network
-        // I/O)
-        auto segment_desc = getSegmentDesc(segment_name);
-        if (!segment_desc) return nullptr;
-
-        // Update cache with write lock
-        RWSpinlock::WriteGuard guard(segment_lock_);
-        segment_id_to_desc_map_[segment_id] = segment_desc;
-        return segment_id_to_desc_map_[segment_id];
-    } else {
+    std::shared_ptr<SegmentDesc> cached_desc;
+    {
         RWSpinlock::ReadGuard guard(segment_lock_);
-        if (!segment_id_to_desc_map_.count(segment_id)) return nullptr;
-        return segment_id_to_desc_map_[segment_id];
+        auto iter = segment_id_to_desc_map_.find(segment_id);
+        if (iter == segment_id_to_desc_map_.end()) return nullptr;
+        cached_desc = iter->second;
+        if (segment_id == LOCAL_SEGMENT_ID) return cached_desc;
+        if (globalConfig().metacache && !force_update &&
+            !isSegmentStale(cached_desc->name))
+            return cached_desc;
     }
+
+    auto segment_desc = fetchSegmentDesc(cached_desc->name);
+    if (!segment_desc && globalConfig().metacache && !force_update)
+        return cached_desc;
+    return segment_desc;
 }
 
 TransferMetadata::SegmentID TransferMetadata::getSegmentID(
     const std::string &segment_name) {
     {
         RWSpinlock::ReadGuard guard(segment_lock_);
-        if (segment_name_to_id_map_.count(segment_name))
-            return segment_name_to_id_map_[segment_name];
+        auto iter = segment_name_to_id_map_.find(segment_name);
+        if (iter != segment_name_to_id_map_.end()) return iter->second;
     }
 
-    // Fetch segment descriptor without holding lock (may involve network I/O)
-    auto segment_desc = this->getSegmentDesc(segment_name);
-    if (!segment_desc) return -1;
+    if (!fetchSegmentDesc(segment_name)) return -1;
 
-    // Update cache with write lock, double-check to avoid duplicate
-    RWSpinlock::WriteGuard guard(segment_lock_);
-    if (segment_name_to_id_map_.count(segment_name))
-        return segment_name_to_id_map_[segment_name];
-    SegmentID id = next_segment_id_.fetch_add(1);
-    segment_id_to_desc_map_[id] = segment_desc;
-    segment_name_to_id_map_[segment_name] = id;
-    return id;
+    RWSpinlock::ReadGuard guard(segment_lock_);
+    auto iter = segment_name_to_id_map_.find(segment_name);
+    if (iter == segment_name_to_id_map_.end()) return -1;
+    return iter->second;
 }
 
 int TransferMetadata::updateLocalSegmentDesc(uint64_t segment_id) {
     RWSpinlock::ReadGuard guard(segment_lock_);
     auto desc = segment_id_to_desc_map_[segment_id];
+    if (segment_id == LOCAL_SEGMENT_ID && globalConfig().metadata_binary &&
+        !p2p_handshake_mode_)
+        return publishLocalSegmentDesc(*desc);
     return this->updateSegmentDesc(desc->name, *desc);
 }
 
@@ -691,7 +1280,24 @@ int TransferMetadata::addLocalMemoryBuffer(const BufferDesc &buffer_desc,
         auto &segment_desc = segment_id_to_desc_map_[LOCAL_SEGMENT_ID];
         *new_segment_desc = *segment_desc;
         segment_desc = new_segment_desc;
-        segment_desc->buffers.push_back(buffer_desc);
+        // Transports sharing the segment register the same buffer, each
+        // filling in its own keys
+        auto iter = std::find_if(
+            segment_desc->buffers.begin(), segment_desc->buffers.end(),
+            [&buffer_desc](const BufferDesc &entry) {
+                return entry.addr == buffer_desc.addr &&
+                       entry.length == buffer_desc.length;
+            });
+        if (iter == segment_desc->buffers.end()) {
+            segment_desc->buffers.push_back(buffer_desc);
+        } else {
+            if (iter->lkey.empty()) {
+                iter->lkey = buffer_desc.lkey;
+                iter->rkey = buffer_desc.rkey;
+            }
+            if (iter->shm_name.empty())
+                iter->shm_name = buffer_desc.shm_name;
+        }
     }
     if (update_metadata) return updateLocalSegmentDesc();
     return 0;
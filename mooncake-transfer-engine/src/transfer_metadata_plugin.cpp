@@ -158,6 +158,46 @@ struct RedisStoragePlugin : public MetadataStoragePlugin {
         return true;
     }
 
+    virtual bool getBatch(const std::vector<std::string> &keys,
+                          std::vector<Json::Value> &values) {
+        values.assign(keys.size(), Json::Value());
+        if (keys.empty()) return true;
+        std::vector<const char *> argv;
+        std::vector<size_t> argvlen;
+        argv.reserve(keys.size() + 1);
+        argvlen.reserve(keys.size() + 1);
+        argv.push_back("MGET");
+        argvlen.push_back(4);
+        for (auto &key : keys) {
+            argv.push_back(key.c_str());
+            argvlen.push_back(key.size());
+        }
+
+        std::lock_guard<std::mutex> lock(access_client_mutex_);
+        if (!client_) return false;
+        redisReply *resp = (redisReply *)redisCommandArgv(
+            client_, argv.size(), argv.data(), argvlen.data());
+        if (!resp || resp->type != REDIS_REPLY_ARRAY ||
+            resp->elements != keys.size()) {
+            LOG(ERROR) << "RedisStoragePlugin: unable to get " << keys.size()
+                       << " keys from " << metadata_uri_;
+            if (resp) freeReplyObject(resp);
+            return false;
+        }
+        for (size_t i = 0; i < keys.size(); ++i) {
+            auto element = resp->element[i];
+            if (!element || !element->str) continue;
+            std::string errs;
+            if (!parseJsonString(std::string(element->str, element->len),
+                                 values[i], &errs)) {
+                LOG(ERROR) << "RedisStoragePlugin: JSON parse error: " << errs;
+                values[i] = Json::Value();
+            }
+        }
+        freeReplyObject(resp);
+        return true;
+    }
+
     virtual bool set(const std::string &key, const Json::Value &value) {
         std::lock_guard<std::mutex> lock(access_client_mutex_);
         if (!client_) return false;
@@ -449,7 +489,18 @@ struct EtcdStoragePlugin : public MetadataStoragePlugin {
         }
     }
 
-    virtual ~EtcdStoragePlugin() { EtcdCloseWrapper(); }
+    virtual ~EtcdStoragePlugin() {
+        if (!watch_prefix_.empty()) {
+            char *err_msg = nullptr;
+            if (EtcdCancelWatchPrefixWrapper((char *)watch_prefix_.c_str(),
+                                             &err_msg)) {
+                LOG(ERROR) << "EtcdStoragePlugin: unable to cancel watch of "
+                           << watch_prefix_ << ": " << err_msg;
+                free(err_msg);
+            }
+        }
+        EtcdCloseWrapper();
+    }
 
     virtual bool get(const std::string &key, Json::Value &value) {
         char *json_data = nullptr;
@@ -477,6 +528,66 @@ struct EtcdStoragePlugin : public MetadataStoragePlugin {
         return true;
     }
 
+    virtual bool getBatch(const std::vector<std::string> &keys,
+                          std::vector<Json::Value> &values) {
+        values.assign(keys.size(), Json::Value());
+        if (keys.empty()) return true;
+        std::vector<char *> key_list;
+        key_list.reserve(keys.size());
+        for (auto &key : keys) key_list.push_back((char *)key.c_str());
+        std::vector<char *> json_data(keys.size(), nullptr);
+        char *err_msg = nullptr;
+        auto ret = EtcdGetBatchWrapper(key_list.data(), (int)keys.size(),
+                                       json_data.data(), &err_msg);
+        if (ret) {
+            LOG(ERROR) << "EtcdStoragePlugin: unable to get " << keys.size()
+                       << " keys in " << metadata_uri_ << ": " << err_msg;
+            free(err_msg);
+            return false;
+        }
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!json_data[i]) continue;
+            std::string errs;
+            if (!parseJsonString(json_data[i], values[i], &errs)) {
+                LOG(ERROR) << "EtcdStoragePlugin: JSON parse error: " << errs;
+                values[i] = Json::Value();
+            }
+            // free the memory allocated by EtcdGetBatchWrapper
+            free(json_data[i]);
+        }
+        return true;
+    }
+
+    virtual bool watchPrefix(const std::string &prefix,
+                             OnChangeCallBack callback) {
+        if (!watch_prefix_.empty()) return false;
+        watch_callback_ = std::move(callback);
+        watch_prefix_ = prefix;
+        char *err_msg = nullptr;
+        auto ret = EtcdWatchPrefixWrapper((char *)watch_prefix_.c_str(), this,
+                                          (void *)&onWatchEvent, &err_msg);
+        if (ret) {
+            LOG(ERROR) << "EtcdStoragePlugin: unable to watch " << prefix
+                       << " in " << metadata_uri_ << ": " << err_msg;
+            free(err_msg);
+            watch_prefix_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // event_type: 0 for put, 1 for delete, 2 once the watch was broken
+    static void onWatchEvent(void *context, const char *key, size_t key_size,
+                             const char *value, size_t value_size,
+                             int event_type, long long mod_revision) {
+        auto plugin = static_cast<EtcdStoragePlugin *>(context);
+        if (event_type == 2) {
+            plugin->watch_callback_("", false);
+            return;
+        }
+        plugin->watch_callback_(std::string(key, key_size), event_type == 1);
+    }
+
     virtual bool set(const std::string &key, const Json::Value &value) {
         Json::FastWriter writer;
         const std::string json_file = writer.write(value);
@@ -508,6 +619,8 @@ struct EtcdStoragePlugin : public MetadataStoragePlugin {
 
     const std::string metadata_uri_;
     char *err_msg_;
+    std::string watch_prefix_;
+    OnChangeCallBack watch_callback_;
 };
 #endif
 #endif  // USE_ETCD
@@ -531,6 +644,15 @@ std::pair<std::string, std::string> parseConnectionString(
     return result;
 }
 
+bool MetadataStoragePlugin::getBatch(const std::vector<std::string> &keys,
+                                     std::vector<Json::Value> &values) {
+    values.assign(keys.size(), Json::Value());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (!get(keys[i], values[i])) values[i] = Json::Value();
+    }
+    return true;
+}
+
 std::shared_ptr<MetadataStoragePlugin> MetadataStoragePlugin::Create(
     const std::string &conn_string) {
     auto parsed_conn_string = parseConnectionString(conn_string);
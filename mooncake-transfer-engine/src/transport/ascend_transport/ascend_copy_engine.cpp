@@ -0,0 +1,186 @@
+// Copyright 2025 Huawei Technologies Co., Ltd
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transport/ascend_transport/ascend_copy_engine.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+namespace mooncake {
+
+AscendCopyEngine::AscendCopyEngine(int32_t device_logic_id, int32_t timeout_ms)
+    : device_logic_id_(device_logic_id), timeout_ms_(timeout_ms) {}
+
+AscendCopyEngine::~AscendCopyEngine() {
+    for (auto stream : all_streams_) {
+        (void)aclrtDestroyStream(stream);
+    }
+}
+
+aclError AscendCopyEngine::init() {
+    aclrtStream stream;
+    aclError ret = acquireStream(stream);
+    if (ret == ACL_ERROR_NONE) {
+        releaseStream(stream);
+    }
+    return ret;
+}
+
+void AscendCopyEngine::coalesce(std::vector<CopyOp> &ops) {
+    if (ops.empty()) {
+        return;
+    }
+    size_t last = 0;
+    for (size_t i = 1; i < ops.size(); ++i) {
+        auto &prev = ops[last];
+        if (static_cast<char *>(prev.dest) + prev.length == ops[i].dest &&
+            static_cast<const char *>(prev.src) + prev.length == ops[i].src) {
+            prev.length += ops[i].length;
+        } else {
+            ops[++last] = ops[i];
+        }
+    }
+    ops.resize(last + 1);
+}
+
+aclError AscendCopyEngine::copy(std::vector<CopyOp> ops,
+                                aclrtMemcpyKind kind) {
+    coalesce(ops);
+    if (ops.empty()) {
+        return ACL_ERROR_NONE;
+    }
+    if (kind == ACL_MEMCPY_HOST_TO_HOST) {
+        // Host copies do not go through a stream
+        for (auto &op : ops) {
+            aclError ret =
+                aclrtMemcpy(op.dest, op.length, op.src, op.length, kind);
+            if (ret != ACL_ERROR_NONE) {
+                LOG(ERROR) << "aclrtMemcpy failed, ret: " << ret;
+                return ret;
+            }
+        }
+        return ACL_ERROR_NONE;
+    }
+    const bool batched = kind == ACL_MEMCPY_HOST_TO_DEVICE ||
+                         kind == ACL_MEMCPY_DEVICE_TO_HOST;
+    if (batched && batch_supported_.load(std::memory_order_relaxed)) {
+        for (size_t index = 0; index < ops.size(); index += kMaxBatchSize) {
+            const size_t count = std::min(kMaxBatchSize, ops.size() - index);
+            aclError ret = copyBatch(ops.data() + index, count, kind);
+            if (ret == ACL_ERROR_RT_FEATURE_NOT_SUPPORT) {
+                LOG(INFO) << "aclrtMemcpyBatch is not supported, copying "
+                             "with aclrtMemcpyAsync";
+                batch_supported_.store(false, std::memory_order_relaxed);
+                return copyAsync(
+                    std::vector<CopyOp>(ops.begin() + index, ops.end()), kind);
+            }
+            if (ret != ACL_ERROR_NONE) {
+                return ret;
+            }
+        }
+        return ACL_ERROR_NONE;
+    }
+    return copyAsync(ops, kind);
+}
+
+aclError AscendCopyEngine::copyBatch(const CopyOp *ops, size_t count,
+                                     aclrtMemcpyKind kind) {
+    std::vector<void *> dests(count);
+    std::vector<void *> srcs(count);
+    std::vector<size_t> sizes(count);
+    for (size_t i = 0; i < count; ++i) {
+        dests[i] = ops[i].dest;
+        srcs[i] = const_cast<void *>(ops[i].src);
+        sizes[i] = ops[i].length;
+    }
+    auto device_loc =
+        aclrtMemLocation{static_cast<uint32_t>(device_logic_id_),
+                         aclrtMemLocationType::ACL_MEM_LOCATION_TYPE_DEVICE};
+    auto host_loc =
+        aclrtMemLocation{0, aclrtMemLocationType::ACL_MEM_LOCATION_TYPE_HOST};
+    // All copies of the batch share one attribute starting at index 0
+    aclrtMemcpyBatchAttr attr =
+        kind == ACL_MEMCPY_DEVICE_TO_HOST
+            ? aclrtMemcpyBatchAttr{host_loc, device_loc, {}}
+            : aclrtMemcpyBatchAttr{device_loc, host_loc, {}};
+    size_t attr_index = 0;
+    size_t fail_index = 0;
+    aclError ret = aclrtMemcpyBatch(dests.data(), sizes.data(), srcs.data(),
+                                    sizes.data(), count, &attr, &attr_index,
+                                    1, &fail_index);
+    if (ret != ACL_ERROR_NONE && ret != ACL_ERROR_RT_FEATURE_NOT_SUPPORT) {
+        LOG(ERROR) << "aclrtMemcpyBatch failed at copy " << fail_index
+                   << " of " << count << ", ret: " << ret;
+    }
+    return ret;
+}
+
+aclError AscendCopyEngine::copyAsync(const std::vector<CopyOp> &ops,
+                                     aclrtMemcpyKind kind) {
+    aclrtStream stream;
+    aclError ret = acquireStream(stream);
+    if (ret != ACL_ERROR_NONE) {
+        return ret;
+    }
+    aclError copy_ret = ACL_ERROR_NONE;
+    for (auto &op : ops) {
+        copy_ret = aclrtMemcpyAsync(op.dest, op.length, op.src, op.length,
+                                    kind, stream);
+        if (copy_ret != ACL_ERROR_NONE) {
+            LOG(ERROR) << "aclrtMemcpyAsync failed, ret: " << copy_ret
+                       << ", dest: " << op.dest << ", src: " << op.src
+                       << ", len: " << op.length;
+            break;
+        }
+    }
+    // Wait for the copies already queued even if a later one failed
+    ret = aclrtSynchronizeStreamWithTimeout(stream, timeout_ms_);
+    if (ret != ACL_ERROR_NONE) {
+        LOG(ERROR) << "aclrtSynchronizeStreamWithTimeout failed, ret: " << ret;
+        (void)aclrtStreamAbort(stream);
+        // Drop the abort error before the stream is reused
+        (void)aclrtSynchronizeStream(stream);
+    }
+    releaseStream(stream);
+    return copy_ret != ACL_ERROR_NONE ? copy_ret : ret;
+}
+
+aclError AscendCopyEngine::acquireStream(aclrtStream &stream) {
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex_);
+        if (!free_streams_.empty()) {
+            stream = free_streams_.back();
+            free_streams_.pop_back();
+            return ACL_ERROR_NONE;
+        }
+    }
+    aclError ret = aclrtCreateStreamWithConfig(
+        &stream, 0, ACL_STREAM_FAST_LAUNCH | ACL_STREAM_FAST_SYNC);
+    if (ret != ACL_ERROR_NONE) {
+        LOG(ERROR) << "AscendCopyEngine: cannot create stream, ret: " << ret;
+        return ret;
+    }
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    all_streams_.push_back(stream);
+    return ACL_ERROR_NONE;
+}
+
+void AscendCopyEngine::releaseStream(aclrtStream stream) {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    free_streams_.push_back(stream);
+}
+
+}  // namespace mooncake
@@ -36,7 +36,6 @@
 
 namespace mooncake {
 namespace {
-constexpr size_t kMemcpyBatchLimit = 4096U;
 constexpr int64_t kMillisToNano = 1000000;
 constexpr size_t kDefaultThreadPoolSize = 8U;
 constexpr size_t kBufferModeThreadPoolSize = 1U;
@@ -149,8 +148,9 @@ int AscendDirectTransport::install(std::string &local_server_name,
         }
     }
     transfer_timeout_in_nano_ = transfer_timeout_ * kMillisToNano;
-    ret = aclrtCreateStreamWithConfig(
-        &stream_, 0, ACL_STREAM_FAST_LAUNCH | ACL_STREAM_FAST_SYNC);
+    copy_engine_ =
+        std::make_unique<AscendCopyEngine>(device_logic_id_, transfer_timeout_);
+    ret = copy_engine_->init();
     if (ret != ACL_ERROR_NONE) {
         LOG(ERROR) << "AscendDirectTransport: cannot create stream, ret: "
                    << ret;
@@ -991,141 +991,27 @@ void AscendDirectTransport::localCopy(TransferRequest::OpCode opcode,
         kind = (opcode == TransferRequest::WRITE) ? ACL_MEMCPY_DEVICE_TO_HOST
                                                   : ACL_MEMCPY_HOST_TO_DEVICE;
     }
-    if (kind == ACL_MEMCPY_HOST_TO_HOST) {
-        return copyWithSync(opcode, slice_list, kind);
-    }
-    if (kind == ACL_MEMCPY_DEVICE_TO_DEVICE) {
-        return copyWithAsync(opcode, slice_list, kind);
-    }
-    auto left_num = slice_list.size();
-    size_t slice_index = 0;
-    while (left_num > 0) {
-        auto batch_num = std::min(left_num, kMemcpyBatchLimit);
-        ret = copyWithBatch(opcode, slice_list, kind, batch_num, slice_index);
-        if (ret == ACL_ERROR_RT_FEATURE_NOT_SUPPORT) {
-            return copyWithAsync(opcode, slice_list, kind);
-        }
-        left_num -= batch_num;
-        slice_index += batch_num;
-    }
-}
-
-aclError AscendDirectTransport::copyWithBatch(
-    TransferRequest::OpCode opcode, const std::vector<Slice *> &slice_list,
-    aclrtMemcpyKind kind, size_t batch_num, size_t slice_index) const {
-    std::vector<void *> void_remote_addrs(batch_num);
-    std::vector<void *> void_local_addrs(batch_num);
-    std::vector<aclrtMemcpyBatchAttr> attrs(batch_num);
-    std::vector<size_t> attrsIds(batch_num);
-    std::vector<size_t> sizes(batch_num);
-    size_t idx = 0;
-    for (size_t i = 0; i < batch_num; i++) {
-        auto device_loc = aclrtMemLocation{
-            static_cast<uint32_t>(device_logic_id_),
-            aclrtMemLocationType::ACL_MEM_LOCATION_TYPE_DEVICE};
-        auto host_loc = aclrtMemLocation{
-            0, aclrtMemLocationType::ACL_MEM_LOCATION_TYPE_HOST};
-        if (kind == ACL_MEMCPY_DEVICE_TO_HOST) {
-            attrs[i] = aclrtMemcpyBatchAttr{host_loc, device_loc, {}};
-        } else {
-            attrs[i] = aclrtMemcpyBatchAttr{device_loc, host_loc, {}};
-        }
-        attrsIds[i] = idx++;
-        auto &slice = slice_list[slice_index + i];
-        void_local_addrs[i] = slice->source_addr;
-        void_remote_addrs[i] =
-            reinterpret_cast<void *>(slice->ascend_direct.dest_addr);
-        sizes[i] = slice->length;
-    }
-    size_t fail_idx;
-    aclError ret;
-    if (opcode == TransferRequest::WRITE) {
-        ret = aclrtMemcpyBatch(void_remote_addrs.data(), sizes.data(),
-                               void_local_addrs.data(), sizes.data(),
-                               sizes.size(), attrs.data(), attrsIds.data(),
-                               attrs.size(), &fail_idx);
-    } else {
-        ret = aclrtMemcpyBatch(void_local_addrs.data(), sizes.data(),
-                               void_remote_addrs.data(), sizes.data(),
-                               sizes.size(), attrs.data(), attrsIds.data(),
-                               attrs.size(), &fail_idx);
-    }
-    if (ret != ACL_ERROR_RT_FEATURE_NOT_SUPPORT) {
-        if (ret == ACL_ERROR_NONE) {
-            VLOG(1) << "Copy with aclrtMemcpyBatch suc.";
-            for (size_t i = 0; i < batch_num; i++) {
-                auto &slice = slice_list[slice_index + i];
-                slice->markSuccess();
-            }
-        } else {
-            LOG(ERROR) << "aclrtMemcpyBatch failed, ret:" << ret;
-            for (size_t i = 0; i < batch_num; i++) {
-                auto &slice = slice_list[slice_index + i];
-                slice->markFailed();
-            }
-        }
-    }
-    return ret;
-}
-
-void AscendDirectTransport::copyWithSync(TransferRequest::OpCode opcode,
-                                         const std::vector<Slice *> &slice_list,
-                                         aclrtMemcpyKind kind) {
+    std::vector<AscendCopyEngine::CopyOp> ops;
+    ops.reserve(slice_list.size());
     for (auto &slice : slice_list) {
         auto local_ptr = slice->source_addr;
         auto remote_ptr =
             reinterpret_cast<void *>(slice->ascend_direct.dest_addr);
-        auto len = slice->length;
-        aclError ret;
         if (opcode == TransferRequest::WRITE) {
-            ret = aclrtMemcpy(remote_ptr, len, local_ptr, len, kind);
+            ops.push_back({remote_ptr, local_ptr, slice->length});
         } else {
-            ret = aclrtMemcpy(local_ptr, len, remote_ptr, len, kind);
+            ops.push_back({local_ptr, remote_ptr, slice->length});
         }
-        if (ret == ACL_ERROR_NONE) {
-            VLOG(1) << "Copy with aclrtMemcpy suc.";
-            slice->markSuccess();
-        } else {
-            LOG(ERROR) << "aclrtMemcpy failed, ret:" << ret;
-            slice->markFailed();
-        }
-    }
-}
-
-void AscendDirectTransport::copyWithAsync(
-    TransferRequest::OpCode opcode, const std::vector<Slice *> &slice_list,
-    aclrtMemcpyKind kind) {
-    std::vector<Slice *> async_list;
-    aclError ret;
-    for (auto &slice : slice_list) {
-        auto local_ptr = slice->source_addr;
-        auto remote_ptr =
-            reinterpret_cast<void *>(slice->ascend_direct.dest_addr);
-        auto len = slice->length;
-        if (opcode == TransferRequest::WRITE) {
-            ret = aclrtMemcpyAsync(remote_ptr, len, local_ptr, len, kind,
-                                   stream_);
-        } else {
-            ret = aclrtMemcpyAsync(local_ptr, len, remote_ptr, len, kind,
-                                   stream_);
-        }
-        if (ret != ACL_ERROR_NONE) {
-            LOG(ERROR) << "aclrtMemcpyAsync failed, ret:" << ret;
-            slice->markFailed();
-            continue;
-        }
-        async_list.emplace_back(slice);
     }
-    ret = aclrtSynchronizeStreamWithTimeout(stream_, transfer_timeout_);
+    ret = copy_engine_->copy(std::move(ops), kind);
     if (ret == ACL_ERROR_NONE) {
-        VLOG(1) << "Copy with aclrtMemcpyAsync suc.";
-        for (auto &slice : async_list) {
+        VLOG(1) << "Local copy of " << slice_list.size() << " slices suc.";
+        for (auto &slice : slice_list) {
             slice->markSuccess();
         }
     } else {
-        LOG(ERROR) << "Memory copy failed.";
-        (void)aclrtStreamAbort(stream_);
-        for (auto &slice : async_list) {
+        LOG(ERROR) << "Local copy failed, ret:" << ret;
+        for (auto &slice : slice_list) {
             slice->markFailed();
         }
     }
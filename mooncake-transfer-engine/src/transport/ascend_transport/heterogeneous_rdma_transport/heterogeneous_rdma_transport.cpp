@@ -1,4 +1,5 @@
 #include "transport/ascend_transport/heterogeneous_rdma_transport.h"
+#include <algorithm>
 #include <chrono>
 
 namespace mooncake {
@@ -12,6 +13,18 @@ bool isCpuMemory(void *addr) {
     }
     return (attributes.location.type == 0);
 }
+
+void updateBandwidth(double &bandwidth, uint64_t bytes, double seconds) {
+    if (seconds <= 0) return;
+    double sample = bytes / seconds;
+    bandwidth = bandwidth ? 0.8 * bandwidth + 0.2 * sample : sample;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
 }  // namespace
 
 HeterogeneousRdmaTransport::~HeterogeneousRdmaTransport() {
@@ -223,11 +236,15 @@ int HeterogeneousRdmaTransport::checkAndCreateStreamCopy() {
                 << ret;
             return ret;
         }
-        ret = aclrtCreateStream(&stream_copy_);
+        // No timeout, as with the device to host copies of transferLoop
+        copy_engine_ =
+            std::make_unique<AscendCopyEngine>(logic_device_id_, -1);
+        ret = copy_engine_->init();
         if (ret) {
             LOG(ERROR)
                 << "HeterogeneousRdmaTransport: aclrtCreateStream error, ret: "
                 << ret;
+            copy_engine_.reset();
             return ret;
         }
         stream_copy_created_ = true;
@@ -260,83 +277,106 @@ Status HeterogeneousRdmaTransport::submitTransfer(
 
     {
         std::lock_guard<std::mutex> lock(memcpy_mutex_);
+        std::vector<AscendCopyEngine::CopyOp> ops;
+        ops.reserve(entries.size());
         for (auto &request : entries) {
             if (host_offset_ + request.length > HUGE_HOST_SIZE) {
                 host_offset_ = 0;
             }
-            ret = aclrtMemcpyAsync(host_addr_ + host_offset_, request.length,
-                                   request.source, request.length,
-                                   ACL_MEMCPY_DEVICE_TO_HOST, stream_copy_);
-            if (ret) {
-                LOG(ERROR) << "HeterogeneousRdmaTransport: aclrtMemcpyAsync "
-                              "error, ret: "
-                           << ret << ", hostAddr: " << host_addr_
-                           << ", host_offset_: " << host_offset_
-                           << ", deviceAddr: " << request.source
-                           << "len: " << request.length;
-                return Status::InvalidArgument(
-                    "HeterogeneousRdmaTransport: aclrtMemcpyAsync error");
-            }
+            ops.push_back(
+                {host_addr_ + host_offset_, request.source, request.length});
             new_entries[index] = request;
             new_entries[index].source = host_addr_ + host_offset_;
             host_offset_ += request.length;
+            ++index;
         }
 
-        ret = aclrtSynchronizeStream(stream_copy_);
+        ret = copy_engine_->copy(std::move(ops), ACL_MEMCPY_DEVICE_TO_HOST);
         if (ret) {
-            LOG(ERROR) << "HeterogeneousRdmaTransport: aclrtSynchronizeStream "
-                          "error, ret: "
-                       << ret;
+            LOG(ERROR) << "HeterogeneousRdmaTransport: dtoh copy of "
+                       << entries.size() << " requests error, ret: " << ret;
             return Status::InvalidArgument(
-                "HeterogeneousRdmaTransport: aclrtSynchronizeStream error");
+                "HeterogeneousRdmaTransport: aclrtMemcpyAsync error");
         }
     }
 
     return transport_->submitTransfer(batch_id, new_entries);
 }
 
+// The pipeline exposes the copy of the first chunk and the transfer of the
+// last one, so chunks are a fraction of the whole, but long enough on the
+// faster side that the cost of each copy call and post stays small.
+uint64_t HeterogeneousRdmaTransport::stagingChunkSize(
+    uint64_t total_length) const {
+    double bandwidth = std::max(copy_bandwidth_, wire_bandwidth_);
+    uint64_t min_chunk =
+        std::max<uint64_t>(STAGING_MIN_CHUNK_SIZE,
+                           bandwidth * STAGING_MIN_CHUNK_US / 1000000);
+    min_chunk = std::min<uint64_t>(min_chunk, STAGING_MAX_CHUNK_SIZE);
+    return std::clamp<uint64_t>(total_length / STAGING_PIPELINE_DEPTH,
+                                min_chunk, STAGING_MAX_CHUNK_SIZE);
+}
+
+// Copies the sources to the host in chunks and posts each chunk as soon as
+// it is there, so that chunk i is on the wire while chunk i + 1 is copied
 Status HeterogeneousRdmaTransport::noAggTransport(
     const std::vector<TransferTask *> &task_list) {
-    int ret = 0;
-    for (size_t index = 0; index < task_list.size(); ++index) {
-        auto &task = *task_list[index];
-        auto &request = *task.request;
-
-        if (host_offset_ + request.length > HUGE_HOST_SIZE) {
-            host_offset_ = 0;
-            // LOG(INFO) << "HeterogeneousRdmaTransport::noAggTransport
-            // host_offset reset";
+    uint64_t total_length = 0;
+    for (auto task : task_list) total_length += task->request->length;
+    const uint64_t chunk_size = stagingChunkSize(total_length);
+
+    std::vector<TransferTask *> posted;
+    uint64_t posted_bytes = 0;
+    auto posted_at = std::chrono::steady_clock::now();
+    size_t index = 0;
+    while (index < task_list.size()) {
+        std::vector<TransferTask *> tasks;
+        std::vector<AscendCopyEngine::CopyOp> ops;
+        uint64_t chunk_bytes = 0;
+        while (index < task_list.size()) {
+            auto &request = *task_list[index]->request;
+            if (!tasks.empty() && chunk_bytes + request.length > chunk_size)
+                break;
+            if (host_offset_ + request.length > HUGE_HOST_SIZE) {
+                host_offset_ = 0;
+            }
+            ops.push_back(
+                {host_addr_ + host_offset_, request.source, request.length});
+            request.source = host_addr_ + host_offset_;
+            host_offset_ += request.length;
+            chunk_bytes += request.length;
+            tasks.push_back(task_list[index]);
+            ++index;
         }
 
-        ret = aclrtMemcpyAsync(host_addr_ + host_offset_, request.length,
-                               request.source, request.length,
-                               ACL_MEMCPY_DEVICE_TO_HOST, stream_copy_);
+        auto copy_start = std::chrono::steady_clock::now();
+        int ret =
+            copy_engine_->copy(std::move(ops), ACL_MEMCPY_DEVICE_TO_HOST);
         if (ret) {
-            LOG(ERROR)
-                << "HeterogeneousRdmaTransport: aclrtMemcpyAsync error, ret: "
-                << ret << ", hostAddr: " << host_addr_
-                << ", host_offset_: " << host_offset_
-                << ", deviceAddr: " << request.source
-                << ", len: " << request.length;
+            LOG(ERROR) << "HeterogeneousRdmaTransport: dtoh copy of "
+                       << tasks.size() << " tasks error, ret: " << ret;
             return Status::InvalidArgument(
-                "HeterogeneousRdmaTransport: Exceed the limitation of "
-                "capacity, batch id: ");
+                "HeterogeneousRdmaTransport: aclrtMemcpyAsync dtoh error");
         }
-        request.source = host_addr_ + host_offset_;
-        host_offset_ += request.length;
-    }
-
-    ret = aclrtSynchronizeStream(stream_copy_);
-    if (ret) {
-        LOG(ERROR)
-            << "HeterogeneousRdmaTransport: aclrtSynchronizeStream error, ret: "
-            << ret;
-        return Status::InvalidArgument(
-            "HeterogeneousRdmaTransport: Exceed the limitation of capacity, "
-            "batch id: ");
+        updateBandwidth(copy_bandwidth_, chunk_bytes,
+                        secondsSince(copy_start));
+
+        // If the previous chunk is already through, the wire is at least
+        // that fast
+        if (!posted.empty() &&
+            std::all_of(posted.begin(), posted.end(), [](TransferTask *task) {
+                return task->success_slice_count == task->slice_count;
+            }))
+            updateBandwidth(wire_bandwidth_, posted_bytes,
+                            secondsSince(posted_at));
+
+        auto s = transport_->submitTransferTask(tasks);
+        if (!s.ok()) return s;
+        posted = std::move(tasks);
+        posted_bytes = chunk_bytes;
+        posted_at = std::chrono::steady_clock::now();
     }
-
-    return transport_->submitTransferTask(task_list);
+    return Status::OK();
 }
 
 Status HeterogeneousRdmaTransport::aggTransport(
@@ -346,6 +386,7 @@ Status HeterogeneousRdmaTransport::aggTransport(
         auto block = acquireBlock();
         uint64_t block_offset = 0;
         std::vector<TransferTask *> tasks;
+        std::vector<AscendCopyEngine::CopyOp> ops;
 
         while (index < task_list.size()) {
             auto &request = *(task_list[index]->request);
@@ -353,31 +394,20 @@ Status HeterogeneousRdmaTransport::aggTransport(
                 break;
             }
 
-            int ret = aclrtMemcpyAsync(
-                block + block_offset, request.length, request.source,
-                request.length, ACL_MEMCPY_DEVICE_TO_DEVICE, stream_copy_);
-            if (ret) {
-                LOG(ERROR) << "HeterogeneousRdmaTransport: aclrtMemcpyAsync "
-                              "dtod error, ret: "
-                           << ret << ", host_offset_: " << host_offset_
-                           << ", deviceAddr: " << request.source
-                           << ", len: " << request.length;
-                return Status::InvalidArgument(
-                    "HeterogeneousRdmaTransport: aclrtMemcpyAsync dtod error");
-            }
-
+            ops.push_back({block + block_offset, request.source,
+                           request.length});
             tasks.push_back(task_list[index]);
             block_offset += request.length;
             ++index;
         }
 
-        int ret = aclrtSynchronizeStream(stream_copy_);
+        int ret =
+            copy_engine_->copy(std::move(ops), ACL_MEMCPY_DEVICE_TO_DEVICE);
         if (ret) {
-            LOG(ERROR) << "HeterogeneousRdmaTransport: aclrtSynchronizeStream "
-                          "failed, ret: "
-                       << ret;
+            LOG(ERROR) << "HeterogeneousRdmaTransport: dtod copy of "
+                       << tasks.size() << " tasks error, ret: " << ret;
             return Status::InvalidArgument(
-                "HeterogeneousRdmaTransport: aclrtSynchronizeStream error");
+                "HeterogeneousRdmaTransport: aclrtMemcpyAsync dtod error");
         }
 
         addTransfer(std::move(tasks), block, block_offset);
@@ -0,0 +1,315 @@
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transport/cxl_transport/cxl_copy_engine.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#include <linux/idxd.h>
+#endif
+
+namespace mooncake {
+
+namespace {
+
+constexpr size_t kDefaultNtMinSize = 16 * 1024;
+constexpr size_t kDefaultDsaMinSize = 64 * 1024;
+constexpr size_t kDsaPortalSize = 0x1000;
+
+size_t getSizeFromEnv(const char *name, size_t default_value) {
+    const char *env = std::getenv(name);
+    if (!env) return default_value;
+    char *end = nullptr;
+    unsigned long long val = strtoull(env, &end, 10);
+    if (end == env || *end != '\0') {
+        LOG(WARNING) << "Invalid " << name << " value " << env
+                     << ", using default " << default_value;
+        return default_value;
+    }
+    return static_cast<size_t>(val);
+}
+
+// Reads a sysfs attribute of an idxd work queue, e.g. `mode` of wq0.0
+std::string readWqAttribute(const std::string &wq_name,
+                            const std::string &attr) {
+    std::ifstream file("/sys/bus/dsa/devices/" + wq_name + "/" + attr);
+    std::string value;
+    std::getline(file, value);
+    return value;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx512f"))) void copyNonTemporalAvx512(
+    void *dest, const void *src, size_t size) {
+    char *d = static_cast<char *>(dest);
+    const char *s = static_cast<const char *>(src);
+
+    // Streaming stores need a 64-byte aligned destination
+    size_t head = (64 - (reinterpret_cast<uintptr_t>(d) & 63)) & 63;
+    if (head > size) head = size;
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+
+    for (; size >= 256; size -= 256, d += 256, s += 256) {
+        __m512i v0 = _mm512_loadu_si512(s);
+        __m512i v1 = _mm512_loadu_si512(s + 64);
+        __m512i v2 = _mm512_loadu_si512(s + 128);
+        __m512i v3 = _mm512_loadu_si512(s + 192);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(d), v0);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(d + 64), v1);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(d + 128), v2);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(d + 192), v3);
+    }
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(d),
+                            _mm512_loadu_si512(s));
+    }
+    std::memcpy(d, s, size);
+}
+
+__attribute__((target("movdir64b"))) void submitDedicated(void *portal,
+                                                         const void *desc) {
+    _movdir64b(portal, desc);
+}
+
+// Returns false if the shared work queue rejected the descriptor
+__attribute__((target("enqcmd"))) bool submitShared(void *portal,
+                                                    const void *desc) {
+    return _enqcmd(portal, desc) == 0;
+}
+
+bool cpuSupports(int ecx_bit) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return ecx & (1u << ecx_bit);
+}
+
+constexpr int kCpuidMovdir64b = 28;
+constexpr int kCpuidEnqcmd = 29;
+#endif
+
+}  // namespace
+
+// One DSA descriptor of a batch and the completion record the device
+// writes when it is done
+struct CxlCopyEngine::DsaChunk {
+#if defined(__x86_64__)
+    alignas(32) dsa_completion_record completion;
+#endif
+    char *dest;
+    const char *src;
+    size_t size;
+    bool dest_is_cxl;
+};
+
+CxlCopyEngine::CxlCopyEngine()
+    : nt_min_size_(getSizeFromEnv("MC_CXL_NT_MIN_SIZE", kDefaultNtMinSize)),
+      dsa_min_size_(
+          getSizeFromEnv("MC_CXL_DSA_MIN_SIZE", kDefaultDsaMinSize)),
+      has_avx512_(false),
+      dsa_portal_(nullptr),
+      dsa_dedicated_(true),
+      dsa_wq_size_(0),
+      dsa_max_transfer_size_(0),
+      dsa_inflight_(0) {
+#if defined(__x86_64__)
+    has_avx512_ = __builtin_cpu_supports("avx512f");
+#endif
+    const char *wq_path = std::getenv("MC_CXL_DSA_WQ");
+    if (wq_path && !openDsaQueue(wq_path)) {
+        LOG(WARNING) << "CxlCopyEngine: cannot use DSA work queue " << wq_path
+                     << ", copying with the CPU only";
+    }
+    LOG(INFO) << "CxlCopyEngine: avx512 non-temporal stores "
+              << (has_avx512_ ? "enabled" : "disabled") << " from "
+              << nt_min_size_ << " bytes, DSA "
+              << (dsaEnabled() ? "enabled" : "disabled") << " from "
+              << dsa_min_size_ << " bytes";
+}
+
+CxlCopyEngine::~CxlCopyEngine() {
+    if (dsa_portal_) munmap(dsa_portal_, kDsaPortalSize);
+}
+
+bool CxlCopyEngine::openDsaQueue(const std::string &wq_path) {
+#if defined(__x86_64__)
+    std::string wq_name = wq_path.substr(wq_path.find_last_of('/') + 1);
+    std::string mode = readWqAttribute(wq_name, "mode");
+    if (mode != "dedicated" && mode != "shared") {
+        LOG(ERROR) << "CxlCopyEngine: unknown mode '" << mode
+                   << "' of work queue " << wq_name;
+        return false;
+    }
+    dsa_dedicated_ = mode == "dedicated";
+    if (!cpuSupports(dsa_dedicated_ ? kCpuidMovdir64b : kCpuidEnqcmd)) {
+        LOG(ERROR) << "CxlCopyEngine: CPU cannot submit to " << mode
+                   << " work queues";
+        return false;
+    }
+    dsa_wq_size_ = strtoull(readWqAttribute(wq_name, "size").c_str(),
+                            nullptr, 10);
+    dsa_max_transfer_size_ = strtoull(
+        readWqAttribute(wq_name, "max_transfer_size").c_str(), nullptr, 10);
+    if (dsa_max_transfer_size_ == 0 ||
+        (dsa_dedicated_ && dsa_wq_size_ == 0)) {
+        LOG(ERROR) << "CxlCopyEngine: cannot read the configuration of "
+                   << "work queue " << wq_name;
+        return false;
+    }
+
+    int fd = open(wq_path.c_str(), O_RDWR);
+    if (fd < 0) {
+        PLOG(ERROR) << "CxlCopyEngine: cannot open " << wq_path;
+        return false;
+    }
+    void *portal = mmap(nullptr, kDsaPortalSize, PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (portal == MAP_FAILED) {
+        PLOG(ERROR) << "CxlCopyEngine: cannot map the portal of " << wq_path;
+        return false;
+    }
+    dsa_portal_ = portal;
+    LOG(INFO) << "CxlCopyEngine: using " << mode << " DSA work queue "
+              << wq_name << ", max transfer size " << dsa_max_transfer_size_;
+    return true;
+#else
+    (void)wq_path;
+    LOG(ERROR) << "CxlCopyEngine: DSA is only available on x86_64";
+    return false;
+#endif
+}
+
+void CxlCopyEngine::copyCpu(void *dest, const void *src, size_t size,
+                            bool dest_is_cxl) {
+#if defined(__x86_64__)
+    if (has_avx512_ && dest_is_cxl && size >= nt_min_size_) {
+        copyNonTemporalAvx512(dest, src, size);
+        return;
+    }
+#endif
+    std::memcpy(dest, src, size);
+}
+
+bool CxlCopyEngine::submitDsa(DsaChunk &chunk) {
+#if defined(__x86_64__)
+    if (dsa_dedicated_) {
+        // A dedicated queue silently drops descriptors beyond its size
+        size_t inflight = dsa_inflight_.load(std::memory_order_relaxed);
+        do {
+            if (inflight >= dsa_wq_size_) return false;
+        } while (!dsa_inflight_.compare_exchange_weak(
+            inflight, inflight + 1, std::memory_order_relaxed));
+    }
+
+    dsa_hw_desc desc = {};
+    desc.opcode = DSA_OPCODE_MEMMOVE;
+    // No IDXD_OP_FLAG_CC, so the device writes the destination to memory
+    // instead of the cache. Page faults are not blocked on but reported,
+    // and the CPU copies the rest.
+    desc.flags = IDXD_OP_FLAG_CRAV | IDXD_OP_FLAG_RCR;
+    desc.src_addr = reinterpret_cast<uint64_t>(chunk.src);
+    desc.dst_addr = reinterpret_cast<uint64_t>(chunk.dest);
+    desc.xfer_size = static_cast<uint32_t>(chunk.size);
+    desc.completion_addr = reinterpret_cast<uint64_t>(&chunk.completion);
+    std::memset(&chunk.completion, 0, sizeof(chunk.completion));
+
+    // Make the cleared completion record visible before the device can
+    // write it
+    _mm_sfence();
+    if (dsa_dedicated_) {
+        submitDedicated(dsa_portal_, &desc);
+        return true;
+    }
+    return submitShared(dsa_portal_, &desc);
+#else
+    (void)chunk;
+    return false;
+#endif
+}
+
+void CxlCopyEngine::completeDsa(DsaChunk &chunk) {
+#if defined(__x86_64__)
+    while (chunk.completion.status == 0) _mm_pause();
+    if (dsa_dedicated_) dsa_inflight_.fetch_sub(1, std::memory_order_relaxed);
+
+    uint8_t status = chunk.completion.status & DSA_COMP_STATUS_MASK;
+    if (status == DSA_COMP_SUCCESS) return;
+    size_t done = 0;
+    if (status == DSA_COMP_PAGE_FAULT_NOBOF) {
+        done = chunk.completion.bytes_completed;
+    } else {
+        LOG(WARNING) << "CxlCopyEngine: DSA memmove failed with status "
+                     << static_cast<int>(status) << ", copying with the CPU";
+    }
+    copyCpu(chunk.dest + done, chunk.src + done, chunk.size - done,
+            chunk.dest_is_cxl);
+#else
+    (void)chunk;
+#endif
+}
+
+void CxlCopyEngine::copyBatch(const std::vector<CopyOp> &ops) {
+    // Chunks need stable addresses for the completion records
+    std::deque<DsaChunk> dsa_chunks;
+    std::vector<const CopyOp *> cpu_ops;
+    cpu_ops.reserve(ops.size());
+
+    for (auto &op : ops) {
+        if (!dsaEnabled() || op.size < dsa_min_size_) {
+            cpu_ops.push_back(&op);
+            continue;
+        }
+        for (size_t offset = 0; offset < op.size;
+             offset += dsa_max_transfer_size_) {
+            DsaChunk &chunk = dsa_chunks.emplace_back();
+            chunk.dest = static_cast<char *>(op.dest) + offset;
+            chunk.src = static_cast<const char *>(op.src) + offset;
+            chunk.size = std::min(dsa_max_transfer_size_, op.size - offset);
+            chunk.dest_is_cxl = op.dest_is_cxl;
+            if (!submitDsa(chunk)) {
+                // Work queue is full, so the CPU is the faster choice
+                copyCpu(chunk.dest, chunk.src, chunk.size, chunk.dest_is_cxl);
+                dsa_chunks.pop_back();
+            }
+        }
+    }
+
+    // Copy the small ones while the device works on the large ones
+    for (auto op : cpu_ops) {
+        copyCpu(op->dest, op->src, op->size, op->dest_is_cxl);
+    }
+    for (auto &chunk : dsa_chunks) completeDsa(chunk);
+
+    // Order all stores of the batch, including the non-temporal ones,
+    // before the slices are reported complete
+    __sync_synchronize();
+}
+
+}  // namespace mooncake
@@ -48,6 +48,7 @@ CxlTransport::CxlTransport() {
         cxl_dev_path = (char *)env_cxl_dev_path;
         cxl_dev_size = cxlGetDeviceSize();
     }
+    copy_engine_ = std::make_unique<CxlCopyEngine>();
 }
 
 CxlTransport::~CxlTransport() {
@@ -106,29 +107,36 @@ size_t CxlTransport::cxlGetDeviceSize() {
     return 0;
 }
 
-int CxlTransport::cxlMemcpy(void *dest, void *src, size_t size) {
-    // Input validation
-    if (!src || !dest) {
-        LOG(ERROR) << "CxlTransport::cxlMemcpy invalid arguments: null pointer "
-                      "provided.";
-        return -1;  // null pointer
-    }
-
-    // Validate memory bounds using the helper function
-    if (!validateMemoryBounds(dest, src, size)) {
-        return -1;  // validation failed
-    }
-
-    // Perform the memory copy
-    std::memcpy(dest, src, size);
-
-    // Memory barriers and cache operations
-    if (isAddressInCxlRange(dest) || isAddressInCxlRange(src)) {
-        // Ensure memory ordering for CXL operations
-        __sync_synchronize();
+void CxlTransport::cxlMemcpyBatch(const std::vector<Slice *> &slices) {
+    std::vector<CxlCopyEngine::CopyOp> ops;
+    std::vector<Slice *> copied_slices;
+    ops.reserve(slices.size());
+    copied_slices.reserve(slices.size());
+    for (auto slice : slices) {
+        // READ: Destination is in local memory, Source is on CXL
+        // WRITE: Source is in local memory, Destination is on CXL
+        void *dest = slice->source_addr;
+        void *src = (void *)slice->cxl.dest_addr;
+        if (slice->opcode != TransferRequest::READ) std::swap(dest, src);
+
+        // Input validation
+        if (!src || !dest) {
+            LOG(ERROR) << "CxlTransport::cxlMemcpy invalid arguments: null "
+                          "pointer provided.";
+            slice->markFailed();
+            continue;
+        }
+        if (!validateMemoryBounds(dest, src, slice->length)) {
+            slice->markFailed();
+            continue;
+        }
+        ops.push_back(
+            {dest, src, slice->length, isAddressInCxlRange(dest)});
+        copied_slices.push_back(slice);
     }
 
-    return 0;  // success
+    copy_engine_->copyBatch(ops);
+    for (auto slice : copied_slices) slice->markSuccess();
 }
 
 bool CxlTransport::validateMemoryBounds(void *dest, void *src, size_t size) {
@@ -315,6 +323,8 @@ Status CxlTransport::submitTransfer(
     size_t task_id = batch_desc.task_list.size();
     batch_desc.task_list.resize(task_id + entries.size());
 
+    std::vector<Slice *> slices;
+    slices.reserve(entries.size());
     for (auto &request : entries) {
         TransferTask &task = batch_desc.task_list[task_id];
         ++task_id;
@@ -329,26 +339,17 @@ Status CxlTransport::submitTransfer(
         slice->target_id = request.target_id;
         slice->status = Slice::PENDING;
         __sync_fetch_and_add(&task.slice_count, 1);
-        int err;
-        if (slice->opcode == TransferRequest::READ)
-            // READ: Source is in local memory, Destination is on CXL
-            err = cxlMemcpy(slice->source_addr, (void *)slice->cxl.dest_addr,
-                            slice->length);
-        else
-            // WRITE: Source is in local memory, Destination is on CXL
-            err = cxlMemcpy((void *)slice->cxl.dest_addr, slice->source_addr,
-                            slice->length);
-        if (err != 0)
-            slice->markFailed();
-        else
-            slice->markSuccess();
+        slices.push_back(slice);
     }
+    cxlMemcpyBatch(slices);
 
     return Status::OK();
 }
 
 Status CxlTransport::submitTransferTask(
     const std::vector<TransferTask *> &task_list) {
+    std::vector<Slice *> slices;
+    slices.reserve(task_list.size());
     for (size_t index = 0; index < task_list.size(); ++index) {
         assert(task_list[index]);
         auto &task = *task_list[index];
@@ -367,20 +368,9 @@ Status CxlTransport::submitTransferTask(
         slice->status = Slice::PENDING;
         task.slice_list.push_back(slice);
         __sync_fetch_and_add(&task.slice_count, 1);
-        int err;
-        if (slice->opcode == TransferRequest::READ)
-            // READ: Source is in local memory, Destination is on CXL
-            err = cxlMemcpy(slice->source_addr, (void *)slice->cxl.dest_addr,
-                            slice->length);
-        else
-            // WRITE: Source is in local memory, Destination is on CXL
-            err = cxlMemcpy((void *)slice->cxl.dest_addr, slice->source_addr,
-                            slice->length);
-        if (err != 0)
-            slice->markFailed();
-        else
-            slice->markSuccess();
+        slices.push_back(slice);
     }
+    cxlMemcpyBatch(slices);
     return Status::OK();
 }
 
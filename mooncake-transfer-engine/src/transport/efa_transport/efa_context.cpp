@@ -368,7 +368,10 @@ std::shared_ptr<EfaEndPoint> EfaContext::endpoint(
     // and duplicate AV entries for the same peer.
     auto new_endpoint = std::make_shared<EfaEndPoint>(*this);
     if (!cq_list_.empty() && cq_list_[0]) {
-        int ret = new_endpoint->construct(cq_list_[0]->cq);
+        auto &config = globalConfig();
+        int ret = new_endpoint->construct(cq_list_[0]->cq,
+                                          config.num_qp_per_ep,
+                                          config.max_sge, config.max_wr);
         if (ret != 0) {
             LOG(ERROR) << "Failed to construct EFA endpoint";
             return nullptr;
@@ -503,7 +506,7 @@ int EfaContext::pollCq(int max_entries, int cq_index) {
     ssize_t ret = fi_cq_read(cq, entries, to_poll);
 
     if (ret > 0) {
-        // Process completions outside the lock (markSuccess / delete are safe)
+        // Process completions outside the lock (markSuccess / put are safe)
         std::unordered_map<volatile int *, int> wr_depth_set;
         for (ssize_t i = 0; i < ret; i++) {
             EfaOpContext *op_ctx =
@@ -513,7 +516,7 @@ int EfaContext::pollCq(int max_entries, int cq_index) {
                 if (op_ctx->wr_depth) {
                     wr_depth_set[op_ctx->wr_depth]++;
                 }
-                delete op_ctx;
+                op_ctx->pool->put(op_ctx);
             }
         }
         for (auto &entry : wr_depth_set) {
@@ -542,7 +545,7 @@ int EfaContext::pollCq(int max_entries, int cq_index) {
                 if (op_ctx->wr_depth) {
                     wr_depth_set[op_ctx->wr_depth]++;
                 }
-                delete op_ctx;
+                op_ctx->pool->put(op_ctx);
             }
             err_count++;
         }
@@ -16,6 +16,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstring>
@@ -30,19 +31,17 @@ namespace mooncake {
 EfaEndPoint::EfaEndPoint(EfaContext &context)
     : context_(context),
       status_(INITIALIZING),
-      ep_(nullptr),
       tx_cq_(nullptr),
       rx_cq_(nullptr),
       peer_fi_addr_(FI_ADDR_UNSPEC),
       local_addr_len_(0),
-      wr_depth_(0),
       max_wr_depth_(0),
       cq_outstanding_(nullptr),
       active_(true),
       inactive_time_(0) {}
 
 EfaEndPoint::~EfaEndPoint() {
-    if (ep_) deconstruct();
+    if (!lanes_.empty()) deconstruct();
 }
 
 int EfaEndPoint::construct(struct fid_cq *cq, size_t num_qp_list,
@@ -57,70 +56,88 @@ int EfaEndPoint::construct(struct fid_cq *cq, size_t num_qp_list,
     max_wr_depth_ = max_wr;
     cq_outstanding_ = context_.cqOutstandingCount(0);
 
+    if (num_qp_list == 0) num_qp_list = 1;
+    for (size_t i = 0; i < num_qp_list; ++i) {
+        auto lane = std::make_unique<Lane>();
+        int ret = openEndpoint(&lane->ep);
+        if (ret) {
+            deconstruct();
+            return ret;
+        }
+        lanes_.push_back(std::move(lane));
+    }
+
+    // Get local endpoint address
+    local_addr_len_ = 64;  // EFA addresses are typically 32 bytes
+    local_addr_.resize(local_addr_len_);
+    int ret =
+        fi_getname(&lanes_[0]->ep->fid, local_addr_.data(), &local_addr_len_);
+    if (ret) {
+        LOG(ERROR) << "fi_getname failed: " << fi_strerror(-ret);
+        deconstruct();
+        return ERR_ENDPOINT;
+    }
+    local_addr_.resize(local_addr_len_);
+
+    status_.store(UNCONNECTED, std::memory_order_relaxed);
+    return 0;
+}
+
+int EfaEndPoint::openEndpoint(struct fid_ep **ep) {
     // Create endpoint
-    int ret = fi_endpoint(context_.domain(), context_.info(), &ep_, nullptr);
+    int ret = fi_endpoint(context_.domain(), context_.info(), ep, nullptr);
     if (ret) {
         LOG(ERROR) << "fi_endpoint failed: " << fi_strerror(-ret);
+        *ep = nullptr;
         return ERR_ENDPOINT;
     }
 
     // Bind endpoint to AV
-    ret = fi_ep_bind(ep_, &context_.av()->fid, 0);
+    ret = fi_ep_bind(*ep, &context_.av()->fid, 0);
     if (ret) {
         LOG(ERROR) << "fi_ep_bind (av) failed: " << fi_strerror(-ret);
-        fi_close(&ep_->fid);
-        ep_ = nullptr;
+        fi_close(&(*ep)->fid);
+        *ep = nullptr;
         return ERR_ENDPOINT;
     }
 
     // Bind endpoint to TX CQ
-    ret = fi_ep_bind(ep_, &tx_cq_->fid, FI_TRANSMIT);
+    ret = fi_ep_bind(*ep, &tx_cq_->fid, FI_TRANSMIT);
     if (ret) {
         LOG(ERROR) << "fi_ep_bind (tx_cq) failed: " << fi_strerror(-ret);
-        fi_close(&ep_->fid);
-        ep_ = nullptr;
+        fi_close(&(*ep)->fid);
+        *ep = nullptr;
         return ERR_ENDPOINT;
     }
 
     // Bind endpoint to RX CQ
-    ret = fi_ep_bind(ep_, &rx_cq_->fid, FI_RECV);
+    ret = fi_ep_bind(*ep, &rx_cq_->fid, FI_RECV);
     if (ret) {
         LOG(ERROR) << "fi_ep_bind (rx_cq) failed: " << fi_strerror(-ret);
-        fi_close(&ep_->fid);
-        ep_ = nullptr;
+        fi_close(&(*ep)->fid);
+        *ep = nullptr;
         return ERR_ENDPOINT;
     }
 
     // Enable endpoint
-    ret = fi_enable(ep_);
+    ret = fi_enable(*ep);
     if (ret) {
         LOG(ERROR) << "fi_enable failed: " << fi_strerror(-ret);
-        fi_close(&ep_->fid);
-        ep_ = nullptr;
-        return ERR_ENDPOINT;
-    }
-
-    // Get local endpoint address
-    local_addr_len_ = 64;  // EFA addresses are typically 32 bytes
-    local_addr_.resize(local_addr_len_);
-    ret = fi_getname(&ep_->fid, local_addr_.data(), &local_addr_len_);
-    if (ret) {
-        LOG(ERROR) << "fi_getname failed: " << fi_strerror(-ret);
-        fi_close(&ep_->fid);
-        ep_ = nullptr;
+        fi_close(&(*ep)->fid);
+        *ep = nullptr;
         return ERR_ENDPOINT;
     }
-    local_addr_.resize(local_addr_len_);
-
-    status_.store(UNCONNECTED, std::memory_order_relaxed);
     return 0;
 }
 
 int EfaEndPoint::deconstruct() {
-    if (ep_) {
-        fi_close(&ep_->fid);
-        ep_ = nullptr;
+    for (auto &lane : lanes_) {
+        if (lane->ep) {
+            fi_close(&lane->ep->fid);
+            lane->ep = nullptr;
+        }
     }
+    lanes_.clear();
     return 0;
 }
 
@@ -279,7 +296,12 @@ const std::string EfaEndPoint::toString() const {
     return "EfaEndPoint[" + context_.nicPath() + " <-> " + peer_nic_path_ + "]";
 }
 
-bool EfaEndPoint::hasOutstandingSlice() const { return wr_depth_ > 0; }
+bool EfaEndPoint::hasOutstandingSlice() const {
+    for (auto &lane : lanes_) {
+        if (lane->wr_depth > 0) return true;
+    }
+    return false;
+}
 
 int EfaEndPoint::doSetupConnection(const std::string &peer_addr,
                                    std::string *reply_msg) {
@@ -293,6 +315,139 @@ int EfaEndPoint::doSetupConnection(const std::string &peer_addr,
     return 0;
 }
 
+EfaEndPoint::Lane &EfaEndPoint::laneForThread() {
+    // Threads take lanes round-robin on their first post and keep them, so
+    // up to lanes_.size() threads post to the peer without contention
+    static std::atomic<size_t> next_thread_index{0};
+    thread_local size_t thread_index =
+        next_thread_index.fetch_add(1, std::memory_order_relaxed);
+    return *lanes_[thread_index % lanes_.size()];
+}
+
+// Use atomic reserve-before-post to prevent CQ overflow when multiple
+// threads post to endpoints sharing the same CQ.  The CQ has a fixed
+// capacity (max_cqe); if more completions arrive than it can hold, the
+// provider silently drops them and those slices never complete (hang).
+int EfaEndPoint::reserveSlots(Lane &lane, int wanted, int cq_limit) {
+    const int kMaxBackoffYields = 100000;
+    int backoff = 0;
+    while (true) {
+        // Try to reserve WR slots
+        int cur_wr = lane.wr_depth;
+        int count = std::min(wanted, max_wr_depth_ - cur_wr);
+        if (count > 0) {
+            if (!__sync_bool_compare_and_swap(&lane.wr_depth, cur_wr,
+                                              cur_wr + count)) {
+                continue;  // CAS failed, retry immediately
+            }
+            // WR slots reserved. Now try to reserve as many CQ slots.
+            if (!cq_outstanding_) return count;
+            int cur_cq = *cq_outstanding_;
+            while (cur_cq < cq_limit) {
+                int reserved = std::min(count, cq_limit - cur_cq);
+                if (__sync_bool_compare_and_swap(cq_outstanding_, cur_cq,
+                                                 cur_cq + reserved)) {
+                    if (reserved < count)
+                        __sync_fetch_and_sub(&lane.wr_depth, count - reserved);
+                    return reserved;
+                }
+                cur_cq = *cq_outstanding_;
+            }
+            // CQ full - release WR reservation and back off
+            __sync_fetch_and_sub(&lane.wr_depth, count);
+        }
+        if (++backoff > kMaxBackoffYields) return 0;
+        std::this_thread::yield();
+    }
+}
+
+void EfaEndPoint::releaseSlots(Lane &lane, int count) {
+    __sync_fetch_and_sub(&lane.wr_depth, count);
+    if (cq_outstanding_) __sync_fetch_and_sub(cq_outstanding_, count);
+}
+
+void EfaEndPoint::postBatch(
+    Lane &lane, std::vector<Transport::Slice *> &slice_list, size_t &next,
+    int count, std::vector<Transport::Slice *> &failed_slice_list) {
+    // Resolve descriptors first, so that the last write posted is known
+    // and can be posted without FI_MORE
+    std::vector<std::pair<Transport::Slice *, void *>> batch;
+    batch.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        Transport::Slice *slice = slice_list[next++];
+        void *local_desc = context_.mrDesc(slice->source_addr);
+        if (!local_desc) {
+            LOG(ERROR) << "No MR descriptor found for address "
+                       << slice->source_addr;
+            releaseSlots(lane, 1);
+            failed_slice_list.push_back(slice);
+            continue;
+        }
+        batch.emplace_back(slice, local_desc);
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Transport::Slice *slice = batch[i].first;
+        void *local_desc = batch[i].second;
+
+        // The context is returned to the lane's pool after CQ completion
+        // in pollCq
+        EfaOpContext *op_ctx = lane.op_pool.get();
+        op_ctx->fi_ctx = {};
+        op_ctx->slice = slice;
+        op_ctx->wr_depth = &lane.wr_depth;
+
+        struct iovec iov;
+        iov.iov_base = (void *)slice->source_addr;  // local buffer
+        iov.iov_len = slice->length;
+        struct fi_rma_iov rma_iov;
+        rma_iov.addr = slice->rdma.dest_addr;  // remote address
+        rma_iov.len = slice->length;
+        rma_iov.key = slice->rdma.dest_rkey;  // remote key
+        struct fi_msg_rma msg = {};
+        msg.msg_iov = &iov;
+        msg.desc = &local_desc;
+        msg.iov_count = 1;
+        msg.addr = peer_fi_addr_;
+        msg.rma_iov = &rma_iov;
+        msg.rma_iov_count = 1;
+        msg.context = &op_ctx->fi_ctx;  // context for completion
+
+        // FI_MORE lets the provider defer ringing the doorbell until the
+        // last write of the batch. If that write fails hard, the deferred
+        // ones are flushed by the next post on the lane.
+        uint64_t flags = FI_COMPLETION;
+        if (i + 1 < batch.size()) flags |= FI_MORE;
+
+        ssize_t ret;
+        while ((ret = fi_writemsg(lane.ep, &msg, flags)) == -FI_EAGAIN) {
+            // Provider queue full - let other posters on the lane and the
+            // CQ poller progress, then retry the same slice
+            lane.post_lock.clear(std::memory_order_release);
+            std::this_thread::yield();
+            while (lane.post_lock.test_and_set(std::memory_order_acquire)) {
+            }
+        }
+
+        if (ret == 0) {
+            // Successfully posted - do NOT mark success here!
+            // Success is marked only after CQ completion in pollCq.
+            // WR and CQ reservations are already accounted for.
+            slice->status = Transport::Slice::PENDING;
+        } else {
+            // Hard error - release reservations
+            LOG(ERROR) << "fi_writemsg failed: " << fi_strerror(-ret)
+                       << " (source=" << slice->source_addr
+                       << ", len=" << slice->length
+                       << ", dest=" << (void *)slice->rdma.dest_addr
+                       << ", rkey=" << slice->rdma.dest_rkey << ")";
+            lane.op_pool.put(op_ctx);
+            releaseSlots(lane, 1);
+            failed_slice_list.push_back(slice);
+        }
+    }
+}
+
 int EfaEndPoint::submitPostSend(
     std::vector<Transport::Slice *> &slice_list,
     std::vector<Transport::Slice *> &failed_slice_list) {
@@ -309,133 +464,68 @@ int EfaEndPoint::submitPostSend(
         }
     }
 
-    // Process slices - using fi_write for RDMA write operations.
-    // Use atomic reserve-before-post to prevent CQ overflow when multiple
-    // threads post to endpoints sharing the same CQ.  The CQ has a fixed
-    // capacity (max_cqe); if more completions arrive than it can hold, the
-    // provider silently drops them and those slices never complete (hang).
-    const int kMaxBackoffYields = 100000;
+    // Post the slices in batches of writes chained with FI_MORE, each
+    // under a single acquisition of the lane's post lock. Concurrent posts
+    // on the same RDM endpoint corrupt provider state; cross-endpoint
+    // safety is handled by the FI_THREAD_SAFE hint.
+    const int kMaxPostBatch = 32;
     const int cq_limit = static_cast<int>(globalConfig().max_cqe);
-
-    for (auto it = slice_list.begin(); it != slice_list.end();) {
-        // --- Atomically reserve CQ and WR capacity before posting ---
-        // This eliminates the TOCTOU race where multiple threads pass the
-        // capacity check simultaneously and collectively overflow the CQ.
-        int backoff = 0;
-        bool reserved = false;
-        while (!reserved) {
-            // Try to reserve one WR slot
-            int cur_wr = wr_depth_;
-            if (cur_wr >= max_wr_depth_) {
-                if (++backoff > kMaxBackoffYields) goto timeout;
-                std::this_thread::yield();
-                continue;
-            }
-            if (!__sync_bool_compare_and_swap(&wr_depth_, cur_wr, cur_wr + 1)) {
-                continue;  // CAS failed, retry immediately
-            }
-            // WR slot reserved. Now try to reserve CQ slot.
-            if (cq_outstanding_) {
-                int cur_cq = *cq_outstanding_;
-                while (cur_cq < cq_limit) {
-                    if (__sync_bool_compare_and_swap(cq_outstanding_, cur_cq,
-                                                     cur_cq + 1)) {
-                        reserved = true;
-                        break;
-                    }
-                    cur_cq = *cq_outstanding_;
-                }
-                if (!reserved) {
-                    // CQ full - release WR reservation and back off
-                    __sync_fetch_and_sub(&wr_depth_, 1);
-                    if (++backoff > kMaxBackoffYields) goto timeout;
-                    std::this_thread::yield();
-                    continue;
-                }
-            } else {
-                reserved = true;
+    Lane &lane = laneForThread();
+
+    size_t next = 0;
+    while (next < slice_list.size()) {
+        int wanted = static_cast<int>(
+            std::min<size_t>(kMaxPostBatch, slice_list.size() - next));
+        int count = reserveSlots(lane, wanted, cq_limit);
+        if (count == 0) {
+            LOG(WARNING) << "EFA submitPostSend: timed out waiting for CQ "
+                            "drain"
+                         << " (wr_depth=" << lane.wr_depth
+                         << ", max=" << max_wr_depth_ << ", cq_outstanding="
+                         << (cq_outstanding_ ? *cq_outstanding_ : -1)
+                         << ", max_cqe=" << cq_limit << ")";
+            for (; next < slice_list.size(); ++next) {
+                failed_slice_list.push_back(slice_list[next]);
             }
+            break;
         }
 
-        {
-            Transport::Slice *slice = *it;
-
-            // Get memory region descriptor for the local buffer
-            void *local_desc = context_.mrDesc(slice->source_addr);
-            if (!local_desc) {
-                LOG(ERROR) << "No MR descriptor found for address "
-                           << slice->source_addr;
-                // Release reservations
-                __sync_fetch_and_sub(&wr_depth_, 1);
-                if (cq_outstanding_) __sync_fetch_and_sub(cq_outstanding_, 1);
-                failed_slice_list.push_back(slice);
-                it = slice_list.erase(it);
-                continue;
-            }
-
-            // Allocate operation context to track the slice for completion
-            // Note: This memory is freed after CQ completion in pollCq
-            EfaOpContext *op_ctx = new EfaOpContext();
-            memset(op_ctx, 0, sizeof(EfaOpContext));
-            op_ctx->slice = slice;
-            op_ctx->wr_depth = &wr_depth_;
-
-            // Serialize fi_write per-endpoint: concurrent fi_write on the
-            // same RDM endpoint corrupts provider state.  Cross-endpoint
-            // safety is handled by the FI_THREAD_SAFE hint.
-            while (post_lock_.test_and_set(std::memory_order_acquire)) {
-            }
-            ssize_t ret = fi_write(ep_,
-                                   (void *)slice->source_addr,  // local buffer
-                                   slice->length, local_desc, peer_fi_addr_,
-                                   slice->rdma.dest_addr,  // remote address
-                                   slice->rdma.dest_rkey,  // remote key
-                                   &op_ctx->fi_ctx);  // context for completion
-            post_lock_.clear(std::memory_order_release);
-
-            if (ret == 0) {
-                // Successfully posted - do NOT mark success here!
-                // Success is marked only after CQ completion in pollCq.
-                // WR and CQ reservations are already accounted for.
-                slice->status = Transport::Slice::PENDING;
-                it = slice_list.erase(it);
-            } else if (ret == -FI_EAGAIN) {
-                // Provider queue full - release reservations and retry
-                delete op_ctx;
-                __sync_fetch_and_sub(&wr_depth_, 1);
-                if (cq_outstanding_) __sync_fetch_and_sub(cq_outstanding_, 1);
-                std::this_thread::yield();
-                // Don't advance iterator - retry the same slice
-            } else {
-                // Hard error - release reservations
-                LOG(ERROR) << "fi_write failed: " << fi_strerror(-ret)
-                           << " (source=" << slice->source_addr
-                           << ", len=" << slice->length
-                           << ", dest=" << (void *)slice->rdma.dest_addr
-                           << ", rkey=" << slice->rdma.dest_rkey << ")";
-                delete op_ctx;
-                __sync_fetch_and_sub(&wr_depth_, 1);
-                if (cq_outstanding_) __sync_fetch_and_sub(cq_outstanding_, 1);
-                failed_slice_list.push_back(slice);
-                it = slice_list.erase(it);
-            }
+        while (lane.post_lock.test_and_set(std::memory_order_acquire)) {
         }
-        continue;
-
-    timeout:
-        LOG(WARNING) << "EFA submitPostSend: timed out waiting for CQ drain"
-                     << " (wr_depth=" << wr_depth_ << ", max=" << max_wr_depth_
-                     << ", cq_outstanding="
-                     << (cq_outstanding_ ? *cq_outstanding_ : -1)
-                     << ", max_cqe=" << cq_limit << ")";
-        for (; it != slice_list.end(); ++it) {
-            failed_slice_list.push_back(*it);
+        postBatch(lane, slice_list, next, count, failed_slice_list);
+        lane.post_lock.clear(std::memory_order_release);
+    }
+    slice_list.clear();
+    return 0;
+}
+
+EfaOpContext *EfaOpContextPool::get() {
+    if (!free_list_) {
+        free_list_ =
+            returned_list_.exchange(nullptr, std::memory_order_acquire);
+    }
+    if (!free_list_) {
+        auto chunk = std::make_unique<EfaOpContext[]>(kChunkSize);
+        for (size_t i = 0; i < kChunkSize; ++i) {
+            chunk[i].pool = this;
+            chunk[i].next = i + 1 < kChunkSize ? &chunk[i + 1] : nullptr;
         }
-        slice_list.clear();
-        return 0;
+        free_list_ = &chunk[0];
+        chunks_.push_back(std::move(chunk));
     }
+    EfaOpContext *op_ctx = free_list_;
+    free_list_ = op_ctx->next;
+    return op_ctx;
+}
 
-    return 0;
+void EfaOpContextPool::put(EfaOpContext *op_ctx) {
+    // Only pushes happen concurrently, and the poster detaches the whole
+    // list at once, so this Treiber push is free of ABA
+    op_ctx->next = returned_list_.load(std::memory_order_relaxed);
+    while (!returned_list_.compare_exchange_weak(op_ctx->next, op_ctx,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+    }
 }
 
 }  // namespace mooncake
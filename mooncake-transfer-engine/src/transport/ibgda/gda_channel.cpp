@@ -0,0 +1,285 @@
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transport/ibgda/gda_channel.h"
+
+#include <cuda_runtime.h>
+#include <glog/logging.h>
+#include <infiniband/mlx5dv.h>
+#include <jsoncpp/json/json.h>
+
+#include <mooncake_ibgda/memheap.h>
+#include <mooncake_ibgda/mlx5_prm.h>
+#include <mooncake_ibgda/mlx5gda.h>
+
+#include <sstream>
+
+#include "config.h"
+#include "error.h"
+#include "transfer_engine.h"
+#include "transport/rdma_transport/rdma_context.h"
+#include "transport/rdma_transport/rdma_transport.h"
+
+namespace mooncake {
+
+// Queue indices are 16 bits wide on the device
+static const size_t kMaxWrDepth = 16384;
+
+GdaChannel::GdaChannel(std::shared_ptr<RdmaContext> context,
+                       std::shared_ptr<TransferMetadata> metadata)
+    : context_(std::move(context)),
+      metadata_(std::move(metadata)),
+      local_server_name_(getServerNameFromNicPath(context_->nicPath())) {}
+
+std::unique_ptr<GdaChannel> GdaChannel::create(TransferEngine &engine,
+                                               const std::string &device_name,
+                                               size_t num_qps,
+                                               size_t max_wr_depth) {
+    if (num_qps == 0 || max_wr_depth == 0 || max_wr_depth > kMaxWrDepth) {
+        LOG(ERROR) << "GdaChannel: invalid num_qps " << num_qps
+                   << " or max_wr_depth " << max_wr_depth;
+        return nullptr;
+    }
+    auto rdma = dynamic_cast<RdmaTransport *>(engine.getTransport("rdma"));
+    if (!rdma) {
+        LOG(ERROR) << "GdaChannel: RDMA transport is not installed";
+        return nullptr;
+    }
+    auto context = rdma->getContext(device_name);
+    if (!context) {
+        LOG(ERROR) << "GdaChannel: device " << device_name
+                   << " is not used by the RDMA transport";
+        return nullptr;
+    }
+    std::unique_ptr<GdaChannel> channel(
+        new GdaChannel(std::move(context), rdma->meta()));
+    if (channel->construct(num_qps, max_wr_depth)) return nullptr;
+    return channel;
+}
+
+int GdaChannel::construct(size_t num_qps, size_t max_wr_depth) {
+    mlx5dv_pd mpd;
+    mlx5dv_obj dv_obj = {};
+    dv_obj.pd.in = context_->pd();
+    dv_obj.pd.out = &mpd;
+    if (mlx5dv_init_obj(&dv_obj, MLX5DV_OBJ_PD)) {
+        LOG(ERROR) << "GdaChannel: " << context_->deviceName()
+                   << " is not an mlx5 device";
+        return ERR_DEVICE_NOT_FOUND;
+    }
+
+    // Each queue pair takes a send queue and a CQ of max_wr_depth entries,
+    // rounded up to a power of two, and two doorbell records, all of them
+    // aligned to an adapter page
+    const size_t page_size = (size_t)1 << MLX5_ADAPTER_PAGE_SHIFT;
+    size_t num_wqebb = 1;
+    while (num_wqebb < max_wr_depth) num_wqebb <<= 1;
+    const size_t queue_bytes = num_wqebb * sizeof(mlx5gda_wqebb);
+    ctrl_buf_size_ = num_qps * (2 * (queue_bytes + page_size) + page_size);
+    if (cudaMalloc(&ctrl_buf_, ctrl_buf_size_) != cudaSuccess) {
+        LOG(ERROR) << "GdaChannel: failed to allocate " << ctrl_buf_size_
+                   << " bytes of GPU memory: "
+                   << cudaGetErrorString(cudaGetLastError());
+        ctrl_buf_ = nullptr;
+        return ERR_MEMORY;
+    }
+    ctrl_buf_umem_ = mlx5dv_devx_umem_reg(context_->context(), ctrl_buf_,
+                                          ctrl_buf_size_,
+                                          IBV_ACCESS_LOCAL_WRITE);
+    if (!ctrl_buf_umem_) {
+        PLOG(ERROR) << "GdaChannel: failed to register queues of "
+                    << context_->deviceName()
+                    << ", check that the GPU supports GPUDirect RDMA";
+        return ERR_MEMORY;
+    }
+    ctrl_buf_heap_ = memheap_create(ctrl_buf_size_);
+    if (!ctrl_buf_heap_) return ERR_MEMORY;
+    if (cudaMalloc(&qp_devctxs_, num_qps * sizeof(mlx5gda_qp_devctx)) !=
+        cudaSuccess) {
+        LOG(ERROR) << "GdaChannel: failed to allocate queue pair contexts";
+        qp_devctxs_ = nullptr;
+        return ERR_MEMORY;
+    }
+
+    cudaStream_t stream;
+    if (cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking) !=
+        cudaSuccess) {
+        LOG(ERROR) << "GdaChannel: failed to create stream";
+        return ERR_CONTEXT;
+    }
+    int ret = 0;
+    for (size_t i = 0; i < num_qps && !ret; ++i) {
+        auto qp = mlx5gda_create_rc_qp(mpd, ctrl_buf_, ctrl_buf_umem_,
+                                       ctrl_buf_heap_, context_->pd(),
+                                       (int)max_wr_depth, context_->portNum(),
+                                       stream);
+        if (!qp) {
+            PLOG(ERROR) << "GdaChannel: failed to create queue pair";
+            ret = ERR_ENDPOINT;
+            break;
+        }
+        qps_.push_back(qp);
+        if (mlx5gda_modify_rc_qp_rst2init(qp, 0)) {
+            PLOG(ERROR) << "GdaChannel: failed to modify queue pair to INIT";
+            ret = ERR_ENDPOINT;
+        }
+    }
+    // The queues are initialized on the stream
+    if (cudaStreamSynchronize(stream) != cudaSuccess && !ret) ret = ERR_MEMORY;
+    cudaStreamDestroy(stream);
+    if (ret) return ret;
+
+    std::vector<mlx5gda_qp_devctx> devctxs(num_qps);
+    char *ctrl_buf = (char *)ctrl_buf_;
+    for (size_t i = 0; i < num_qps; ++i) {
+        auto qp = qps_[i];
+        auto &devctx = devctxs[i];
+        devctx = {};
+        devctx.qpn = qp->qpn;
+        devctx.wqeid_mask = qp->num_wqebb - 1;
+        devctx.wq = (mlx5gda_wqebb *)(ctrl_buf + qp->wq_offset);
+        devctx.cq = (mlx5_cqe64 *)(ctrl_buf + qp->send_cq->cq_offset);
+        devctx.dbr = (mlx5gda_wq_dbr *)(ctrl_buf + qp->dbr_offset);
+        devctx.bf = (char *)qp->uar->reg_addr;
+    }
+    if (cudaMemcpy(qp_devctxs_, devctxs.data(),
+                   num_qps * sizeof(mlx5gda_qp_devctx),
+                   cudaMemcpyHostToDevice) != cudaSuccess) {
+        LOG(ERROR) << "GdaChannel: failed to copy queue pair contexts";
+        return ERR_MEMORY;
+    }
+    return 0;
+}
+
+GdaChannel::~GdaChannel() {
+    for (auto qp : qps_) mlx5gda_destroy_qp(ctrl_buf_heap_, qp);
+    if (ctrl_buf_heap_) memheap_destroy(ctrl_buf_heap_);
+    if (ctrl_buf_umem_) mlx5dv_devx_umem_dereg(ctrl_buf_umem_);
+    if (qp_devctxs_) cudaFree(qp_devctxs_);
+    if (ctrl_buf_) cudaFree(ctrl_buf_);
+}
+
+std::string GdaChannel::localInfo() const {
+    Json::Value root;
+    root["segment_name"] = local_server_name_;
+    root["device_name"] = context_->deviceName();
+    Json::Value qp_num(Json::arrayValue);
+    for (auto qp : qps_) qp_num.append(qp->qpn);
+    root["qp_num"] = qp_num;
+    return Json::FastWriter{}.write(root);
+}
+
+int GdaChannel::connect(const std::string &peer_info) {
+    if (connected_) {
+        LOG(ERROR) << "GdaChannel: already connected to "
+                   << MakeNicPath(peer_server_name_, peer_device_name_);
+        return ERR_INVALID_ARGUMENT;
+    }
+    Json::Value root;
+    std::string errs;
+    std::istringstream stream(peer_info);
+    if (!Json::parseFromStream(Json::CharReaderBuilder{}, stream, &root,
+                               &errs)) {
+        LOG(ERROR) << "GdaChannel: malformed peer info: " << errs;
+        return ERR_MALFORMED_JSON;
+    }
+    auto server_name = root["segment_name"].asString();
+    auto device_name = root["device_name"].asString();
+    auto &qp_num = root["qp_num"];
+    if (!qp_num.isArray() || qp_num.size() != qps_.size()) {
+        LOG(ERROR) << "GdaChannel: queue pair count mismatch with "
+                   << MakeNicPath(server_name, device_name);
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    auto segment_desc = metadata_->getSegmentDescByName(server_name);
+    const TransferMetadata::DeviceDesc *peer_device = nullptr;
+    if (segment_desc) {
+        for (auto &device : segment_desc->devices)
+            if (device.name == device_name) peer_device = &device;
+    }
+    if (!peer_device) {
+        LOG(ERROR) << "GdaChannel: peer NIC " << device_name
+                   << " not found in " << server_name;
+        return ERR_DEVICE_NOT_FOUND;
+    }
+
+    ibv_ah_attr ah_attr = {};
+    std::istringstream gid_stream(peer_device->gid);
+    for (int i = 0; i < 16; ++i) {
+        int value;
+        gid_stream >> std::hex >> value;
+        ah_attr.grh.dgid.raw[i] = static_cast<uint8_t>(value);
+        if (i < 15) gid_stream.ignore(1, ':');
+    }
+    ah_attr.grh.sgid_index = context_->gidIndex();
+    ah_attr.grh.hop_limit = 1;
+    ah_attr.is_global = 1;
+    ah_attr.port_num = context_->portNum();
+    ibv_mtu mtu = context_->activeMTU();
+    if (globalConfig().mtu_length < mtu) mtu = globalConfig().mtu_length;
+
+    for (size_t i = 0; i < qps_.size(); ++i) {
+        // On RoCE the LID field carries the UDP source port, which spreads
+        // the queue pairs over the paths of the fabric
+        if (qps_[i]->port_attr.link_layer == IBV_LINK_LAYER_ETHERNET)
+            ah_attr.dlid = 0xC000 | (i & 0x3FFF);
+        else
+            ah_attr.dlid = peer_device->lid;
+        if (mlx5gda_modify_rc_qp_init2rtr(qps_[i], ah_attr,
+                                          qp_num[(int)i].asUInt(), mtu) ||
+            mlx5gda_modify_rc_qp_rtr2rts(qps_[i])) {
+            PLOG(ERROR) << "GdaChannel: failed to connect queue pair " << i
+                        << " to " << MakeNicPath(server_name, device_name);
+            return ERR_ENDPOINT;
+        }
+    }
+    peer_server_name_ = server_name;
+    peer_device_name_ = device_name;
+    connected_ = true;
+    return 0;
+}
+
+GdaDeviceHandle GdaChannel::deviceHandle() const {
+    return GdaDeviceHandle{qp_devctxs_, (uint32_t)qps_.size()};
+}
+
+int GdaChannel::localKey(const void *addr, uint32_t &lkey) const {
+    lkey = context_->lkey(const_cast<void *>(addr));
+    return lkey ? 0 : ERR_ADDRESS_NOT_REGISTERED;
+}
+
+int GdaChannel::remoteKey(uint64_t addr, size_t length,
+                          uint32_t &rkey) const {
+    if (!connected_) return ERR_INVALID_ARGUMENT;
+    auto segment_desc = metadata_->getSegmentDescByName(peer_server_name_);
+    if (!segment_desc) return ERR_METADATA;
+    size_t device_id = 0;
+    while (device_id < segment_desc->devices.size() &&
+           segment_desc->devices[device_id].name != peer_device_name_)
+        ++device_id;
+    for (auto &buffer : segment_desc->buffers) {
+        if (buffer.addr <= addr &&
+            addr + length <= buffer.addr + buffer.length &&
+            device_id < buffer.rkey.size()) {
+            rkey = buffer.rkey[device_id];
+            return 0;
+        }
+    }
+    LOG(ERROR) << "GdaChannel: [" << (void *)addr << ", +" << length
+               << ") is not registered in " << peer_server_name_;
+    return ERR_ADDRESS_NOT_REGISTERED;
+}
+
+}  // namespace mooncake
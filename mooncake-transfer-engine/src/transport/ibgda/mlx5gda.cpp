@@ -347,6 +347,18 @@ fail:
     return NULL;
 }
 
+void mlx5gda_destroy_qp(struct memheap *ctrl_buf_heap, struct mlx5gda_qp *qp) {
+    if (!qp) return;
+    if (qp->mqp) {
+        mlx5dv_devx_obj_destroy(qp->mqp);
+    }
+    destroy_uar(qp->uar);
+    mlx5gda_destroy_cq(ctrl_buf_heap, qp->send_cq);
+    memheap_free(ctrl_buf_heap, qp->wq_offset);
+    memheap_free(ctrl_buf_heap, qp->dbr_offset);
+    free(qp);
+}
+
 int mlx5gda_modify_rc_qp_rst2init(struct mlx5gda_qp *qp, uint16_t pkey_index) {
     if (!qp || !qp->mqp) {
         errno = EINVAL;
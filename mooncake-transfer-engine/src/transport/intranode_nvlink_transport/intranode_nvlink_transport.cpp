@@ -151,6 +151,13 @@ int IntraNodeNvlinkTransport::install(
     metadata_ = metadata;
     local_server_name_ = local_server_name;
 
+    if (metadata_->getSegmentDescByID(LOCAL_SEGMENT_ID)) {
+        // Installed next to the RDMA transport (MC_MULTI_PATH): device
+        // buffers of its segment also publish their IPC handles
+        companion_ = true;
+        return 0;
+    }
+
     auto desc = std::make_shared<SegmentDesc>();
     if (!desc) return ERR_MEMORY;
     desc->name = local_server_name_;
@@ -289,12 +296,18 @@ int IntraNodeNvlinkTransport::registerLocalMemory(void *addr, size_t length,
     cudaPointerAttributes attr;
     cudaError_t err = cudaPointerGetAttributes(&attr, addr);
     if (err != cudaSuccess) {
+        if (companion_) {
+            // Host memory unknown to CUDA is left to the RDMA transport
+            cudaGetLastError();
+            return 0;
+        }
         LOG(ERROR)
             << "IntraNodeNvlinkTransport: cudaPointerGetAttributes failed";
         return -1;
     }
 
     if (attr.type != cudaMemoryTypeDevice) {
+        if (companion_) return 0;
         LOG(ERROR) << "Unsupported memory type, " << addr << " " << attr.type;
         return -1;
     }
@@ -302,6 +315,13 @@ int IntraNodeNvlinkTransport::registerLocalMemory(void *addr, size_t length,
     cudaIpcMemHandle_t handle;
     err = cudaIpcGetMemHandle(&handle, addr);
     if (err != cudaSuccess) {
+        if (companion_) {
+            LOG(WARNING) << "IntraNodeNvlinkTransport: cudaIpcGetMemHandle "
+                            "failed, "
+                         << addr << " is only reachable over RDMA";
+            cudaGetLastError();
+            return 0;
+        }
         LOG(ERROR) << "IntraNodeNvlinkTransport: cudaIpcGetMemHandle failed";
         return -1;
     }
@@ -312,11 +332,14 @@ int IntraNodeNvlinkTransport::registerLocalMemory(void *addr, size_t length,
     desc.length = length;
     desc.name = location;
     desc.shm_name = serializeBinaryData(&handle, sizeof(cudaIpcMemHandle_t));
-    return metadata_->addLocalMemoryBuffer(desc, true);
+    // A buffer without its RDMA keys is published by the RDMA transport
+    return metadata_->addLocalMemoryBuffer(desc, !companion_);
 }
 
 int IntraNodeNvlinkTransport::unregisterLocalMemory(void *addr,
                                                     bool update_metadata) {
+    // The buffer is shared with the RDMA transport, which removes it
+    if (companion_) return 0;
     return metadata_->removeLocalMemoryBuffer(addr, update_metadata);
 }
 
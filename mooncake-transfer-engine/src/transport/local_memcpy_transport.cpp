@@ -0,0 +1,184 @@
+// Copyright 2024 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transport/local_memcpy_transport.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "cuda_alike.h"
+
+namespace mooncake {
+
+namespace {
+
+// Requests are copied in chunks of this size, so that a large one is spread
+// over the workers
+constexpr size_t kChunkSize = 2 * 1024 * 1024;
+
+#if defined(USE_CUDA) || defined(USE_MUSA) || defined(USE_HIP)
+bool isDeviceMemory(const void *addr) {
+    cudaPointerAttributes attributes;
+    if (cudaPointerGetAttributes(&attributes, addr) != cudaSuccess) {
+        cudaGetLastError();
+        return false;
+    }
+    return attributes.type == cudaMemoryTypeDevice;
+}
+#endif
+
+}  // namespace
+
+LocalMemcpyTransport::LocalMemcpyTransport(size_t num_threads) {
+    num_threads = std::max<size_t>(num_threads, 1);
+    for (size_t i = 0; i < num_threads; ++i)
+        workers_.emplace_back([this] { worker(); });
+}
+
+LocalMemcpyTransport::~LocalMemcpyTransport() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        running_ = false;
+    }
+    queue_cv_.notify_all();
+    for (auto &worker : workers_) worker.join();
+}
+
+Status LocalMemcpyTransport::submitTransfer(
+    BatchID batch_id, const std::vector<TransferRequest> &entries) {
+    auto &batch_desc = *((BatchDesc *)(batch_id));
+    if (batch_desc.task_list.size() + entries.size() > batch_desc.batch_size) {
+        return Status::TooManyRequests(
+            "Exceed the limitation of batch capacity");
+    }
+    size_t task_id = batch_desc.task_list.size();
+    batch_desc.task_list.resize(task_id + entries.size());
+    std::vector<TransferTask *> task_list;
+    task_list.reserve(entries.size());
+    for (auto &request : entries) {
+        auto &task = batch_desc.task_list[task_id++];
+        task.batch_id = batch_id;
+        task.request = &request;
+        task_list.push_back(&task);
+    }
+    return submitTransferTask(task_list);
+}
+
+Status LocalMemcpyTransport::submitTransferTask(
+    const std::vector<TransferTask *> &task_list) {
+    std::vector<Slice *> slices;
+    for (auto task_ptr : task_list) {
+        assert(task_ptr && task_ptr->request);
+        auto &task = *task_ptr;
+        auto &request = *task.request;
+        task.total_bytes = request.length;
+        size_t first_slice = slices.size();
+        request.forEachBlock([&](char *source, uint64_t target,
+                                 size_t length) {
+            // An empty block still gets a slice, which completes its task
+            for (size_t offset = 0; offset == 0 || offset < length;
+                 offset += kChunkSize) {
+                Slice *slice = getSliceCache().allocate();
+                slice->source_addr = source + offset;
+                slice->length = std::min(kChunkSize, length - offset);
+                slice->opcode = request.opcode;
+                slice->local.dest_addr = (char *)target + offset;
+                slice->task = &task;
+                slice->target_id = request.target_id;
+                slice->status = Slice::PENDING;
+                slice->ts = 0;
+                task.slice_list.push_back(slice);
+                slices.push_back(slice);
+            }
+        });
+        // All chunks are counted before the first one may complete the task
+        __sync_fetch_and_add(&task.slice_count, slices.size() - first_slice);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.insert(queue_.end(), slices.begin(), slices.end());
+    }
+    if (slices.size() > 1)
+        queue_cv_.notify_all();
+    else
+        queue_cv_.notify_one();
+    return Status::OK();
+}
+
+Status LocalMemcpyTransport::getTransferStatus(BatchID batch_id,
+                                               size_t task_id,
+                                               TransferStatus &status) {
+    auto &batch_desc = *((BatchDesc *)(batch_id));
+    if (task_id >= batch_desc.task_list.size()) {
+        return Status::InvalidArgument("Task ID out of range");
+    }
+    auto &task = batch_desc.task_list[task_id];
+    status.transferred_bytes = task.transferred_bytes;
+    uint64_t success_slice_count = task.success_slice_count;
+    uint64_t failed_slice_count = task.failed_slice_count;
+    if (success_slice_count + failed_slice_count == task.slice_count) {
+        status.s = failed_slice_count ? TransferStatusEnum::FAILED
+                                      : TransferStatusEnum::COMPLETED;
+        task.is_finished = true;
+    } else {
+        status.s = TransferStatusEnum::WAITING;
+    }
+    return Status::OK();
+}
+
+void LocalMemcpyTransport::worker() {
+    while (true) {
+        Slice *slice;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock,
+                           [this] { return !running_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            slice = queue_.front();
+            queue_.pop_front();
+        }
+        copy(slice);
+    }
+}
+
+void LocalMemcpyTransport::copy(Slice *slice) {
+    if (slice->isCanceled()) {
+        slice->markFailed();
+        return;
+    }
+    const bool is_read = slice->opcode == TransferRequest::READ;
+    void *dest = is_read ? slice->source_addr : slice->local.dest_addr;
+    const void *src = is_read ? slice->local.dest_addr : slice->source_addr;
+#if defined(USE_CUDA) || defined(USE_MUSA) || defined(USE_HIP)
+    if (isDeviceMemory(dest) || isDeviceMemory(src)) {
+        cudaError_t err =
+            cudaMemcpy(dest, src, slice->length, cudaMemcpyDefault);
+        if (err != cudaSuccess) {
+            LOG(ERROR) << "LocalMemcpyTransport: cudaMemcpy failed: "
+                       << cudaGetErrorString(err);
+            slice->markFailed();
+            return;
+        }
+        slice->markSuccess();
+        return;
+    }
+#endif
+    std::memcpy(dest, src, slice->length);
+    slice->markSuccess();
+}
+
+}  // namespace mooncake
@@ -24,6 +24,7 @@
 #include <cstdint>
 #include <iomanip>
 #include <memory>
+#include <unordered_map>
 
 #include "common.h"
 #include "common/serialization.h"
@@ -42,6 +43,17 @@ static bool checkCudaErrorReturn(cudaError_t result, const char *message) {
 }
 
 namespace mooncake {
+
+// Pool configuration constants
+// These can be overridden via environment variables:
+// - MC_NVLINK_NUM_STREAMS: number of CUDA streams per device
+// - MC_NVLINK_NUM_EVENTS: number of CUDA events per device
+// - MC_NVLINK_BATCH_SLICE_SIZE: slices shorter than this many bytes are
+//   grouped into one cudaMemcpyBatchAsync, 0 disables batching
+constexpr int kDefaultNumStreams = 16;
+constexpr int kDefaultNumEvents = 64;
+constexpr size_t kDefaultBatchSliceSize = 64 * 1024;
+
 static int getNumDevices() {
     static int cached_num_devices = -1;
     if (cached_num_devices == -1) {
@@ -132,7 +144,121 @@ static bool enableP2PAccess(int src_device_id, int dst_device_id) {
     return true;
 }
 
-NvlinkTransport::NvlinkTransport() : use_fabric_mem_(supportFabricMem()) {}
+static int getPoolSize(const char *env_name, int default_value) {
+    const char *env = getenv(env_name);
+    if (env) {
+        try {
+            int value = std::stoi(env);
+            if (value > 0) {
+                return value;
+            }
+            LOG(WARNING) << env_name << " value " << value
+                         << " must be positive, using default "
+                         << default_value;
+        } catch (...) {
+            LOG(WARNING) << "Invalid " << env_name << " value, using default "
+                         << default_value;
+        }
+    }
+    return default_value;
+}
+
+static size_t getBatchSliceSize() {
+    const char *env = getenv("MC_NVLINK_BATCH_SLICE_SIZE");
+    if (env) {
+        try {
+            return std::stoull(env);
+        } catch (...) {
+            LOG(WARNING) << "Invalid MC_NVLINK_BATCH_SLICE_SIZE value, using "
+                            "default "
+                         << kDefaultBatchSliceSize;
+        }
+    }
+    return kDefaultBatchSliceSize;
+}
+
+// Device that owns ptr, or the current device for host memory
+static int getDeviceFromPointer(void *ptr) {
+    cudaPointerAttributes attr;
+    if (checkCudaErrorReturn(cudaPointerGetAttributes(&attr, ptr),
+                             "NvlinkTransport: cudaPointerGetAttributes "
+                             "failed") &&
+        attr.type == cudaMemoryTypeDevice) {
+        return attr.device;
+    }
+    int device_id = 0;
+    if (cudaGetDevice(&device_id) != cudaSuccess) device_id = 0;
+    return device_id;
+}
+
+static cudaError_t copySliceAsync(Slice *slice, cudaStream_t stream) {
+    if (slice->opcode == TransferRequest::READ)
+        return cudaMemcpyAsync(slice->source_addr,
+                               (void *)slice->local.dest_addr, slice->length,
+                               cudaMemcpyDefault, stream);
+    return cudaMemcpyAsync((void *)slice->local.dest_addr, slice->source_addr,
+                           slice->length, cudaMemcpyDefault, stream);
+}
+
+// Submit all slices to the copy engines with one cudaMemcpyBatchAsync,
+// which costs a single driver call instead of one per slice. Returns false
+// if the API is unavailable or rejects the batch; the caller then issues
+// the slices one by one, which is harmless even if part of the batch was
+// enqueued since the copies are idempotent.
+static bool copyBatchAsync(const std::vector<Slice *> &slices,
+                           cudaStream_t stream) {
+#if CUDART_VERSION >= 12080
+    std::vector<const void *> dsts, srcs;
+    std::vector<size_t> sizes;
+    dsts.reserve(slices.size());
+    srcs.reserve(slices.size());
+    sizes.reserve(slices.size());
+    for (auto slice : slices) {
+        void *local = slice->source_addr;
+        void *remote = (void *)slice->local.dest_addr;
+        bool read = slice->opcode == TransferRequest::READ;
+        dsts.push_back(read ? local : remote);
+        srcs.push_back(read ? remote : local);
+        sizes.push_back(slice->length);
+    }
+    // Read the sources in stream order, as cudaMemcpyAsync does
+    cudaMemcpyAttributes attr = {};
+    attr.srcAccessOrder = cudaMemcpySrcAccessOrderStream;
+    size_t attr_index = 0;
+#if CUDART_VERSION >= 13000
+    cudaError_t err =
+        cudaMemcpyBatchAsync(dsts.data(), srcs.data(), sizes.data(),
+                             slices.size(), &attr, &attr_index, 1, stream);
+#else
+    size_t fail_index = 0;
+    cudaError_t err = cudaMemcpyBatchAsync(
+        const_cast<void **>(dsts.data()), const_cast<void **>(srcs.data()),
+        sizes.data(), slices.size(), &attr, &attr_index, 1, &fail_index,
+        stream);
+#endif
+    if (err != cudaSuccess) {
+        if (globalConfig().trace) {
+            LOG(INFO) << "NvlinkTransport: cudaMemcpyBatchAsync failed ("
+                      << cudaGetErrorString(err)
+                      << "), falling back to cudaMemcpyAsync";
+        }
+        // Clear the error so that it is not reported by later calls
+        (void)cudaGetLastError();
+        return false;
+    }
+    return true;
+#else
+    (void)slices;
+    (void)stream;
+    return false;
+#endif
+}
+
+NvlinkTransport::NvlinkTransport()
+    : use_fabric_mem_(supportFabricMem()),
+      stream_pool_(getPoolSize("MC_NVLINK_NUM_STREAMS", kDefaultNumStreams)),
+      event_pool_(getPoolSize("MC_NVLINK_NUM_EVENTS", kDefaultNumEvents)),
+      batch_slice_size_(getBatchSliceSize()) {}
 //     int num_devices = getNumDevices();
 //     if (globalConfig().trace) {
 //         LOG(INFO) << "NvlinkTransport: use_fabric_mem_:" << use_fabric_mem_
@@ -203,6 +329,9 @@ Status NvlinkTransport::submitTransfer(
     size_t task_id = batch_desc.task_list.size();
     batch_desc.task_list.resize(task_id + entries.size());
 
+    std::vector<Slice *> slices;
+    std::vector<PendingTransfer> pending_transfers;
+    slices.reserve(entries.size());
     for (auto &request : entries) {
         TransferTask &task = batch_desc.task_list[task_id];
         ++task_id;
@@ -210,7 +339,12 @@ Status NvlinkTransport::submitTransfer(
         if (request.target_id != LOCAL_SEGMENT_ID) {
             int rc = relocateSharedMemoryAddress(dest_addr, request.length,
                                                  request.target_id);
-            if (rc) return Status::Memory("device memory not registered");
+            if (rc) {
+                // Complete the slices already created before failing
+                issueAsyncCopies(slices, pending_transfers);
+                synchronizePendingTransfers(pending_transfers);
+                return Status::Memory("device memory not registered");
+            }
         }
         task.total_bytes = request.length;
         Slice *slice = getSliceCache().allocate();
@@ -222,19 +356,11 @@ Status NvlinkTransport::submitTransfer(
         slice->target_id = request.target_id;
         slice->status = Slice::PENDING;
         __sync_fetch_and_add(&task.slice_count, 1);
-        cudaError_t err;
-        if (slice->opcode == TransferRequest::READ)
-            err = cudaMemcpy(slice->source_addr, (void *)slice->local.dest_addr,
-                             slice->length, cudaMemcpyDefault);
-        else
-            err = cudaMemcpy((void *)slice->local.dest_addr, slice->source_addr,
-                             slice->length, cudaMemcpyDefault);
-        if (err != cudaSuccess)
-            slice->markFailed();
-        else
-            slice->markSuccess();
+        slices.push_back(slice);
     }
 
+    issueAsyncCopies(slices, pending_transfers);
+    synchronizePendingTransfers(pending_transfers);
     return Status::OK();
 }
 
@@ -266,6 +392,9 @@ Status NvlinkTransport::getTransferStatus(BatchID batch_id, size_t task_id,
 
 Status NvlinkTransport::submitTransferTask(
     const std::vector<TransferTask *> &task_list) {
+    std::vector<Slice *> slices;
+    std::vector<PendingTransfer> pending_transfers;
+    slices.reserve(task_list.size());
     for (size_t index = 0; index < task_list.size(); ++index) {
         assert(task_list[index]);
         auto &task = *task_list[index];
@@ -275,7 +404,12 @@ Status NvlinkTransport::submitTransferTask(
         if (request.target_id != LOCAL_SEGMENT_ID) {
             int rc = relocateSharedMemoryAddress(dest_addr, request.length,
                                                  request.target_id);
-            if (rc) return Status::Memory("device memory not registered");
+            if (rc) {
+                // Complete the slices already created before failing
+                issueAsyncCopies(slices, pending_transfers);
+                synchronizePendingTransfers(pending_transfers);
+                return Status::Memory("device memory not registered");
+            }
         }
         task.total_bytes = request.length;
         Slice *slice = getSliceCache().allocate();
@@ -288,21 +422,105 @@ Status NvlinkTransport::submitTransferTask(
         slice->status = Slice::PENDING;
         task.slice_list.push_back(slice);
         __sync_fetch_and_add(&task.slice_count, 1);
-        cudaError_t err;
-        if (slice->opcode == TransferRequest::READ)
-            err = cudaMemcpy(slice->source_addr, (void *)slice->local.dest_addr,
-                             slice->length, cudaMemcpyDefault);
-        else
-            err = cudaMemcpy((void *)slice->local.dest_addr, slice->source_addr,
-                             slice->length, cudaMemcpyDefault);
-        if (err != cudaSuccess)
-            slice->markFailed();
-        else
-            slice->markSuccess();
+        slices.push_back(slice);
     }
+
+    issueAsyncCopies(slices, pending_transfers);
+    synchronizePendingTransfers(pending_transfers);
     return Status::OK();
 }
 
+void NvlinkTransport::issueAsyncCopies(const std::vector<Slice *> &slices,
+                                       std::vector<PendingTransfer> &pending) {
+    // Small slices of each device, issued together once all are seen
+    std::unordered_map<int, std::vector<Slice *>> small_slices;
+    for (auto slice : slices) {
+        int device_id = getDeviceFromPointer(slice->source_addr);
+        if (slice->length < batch_slice_size_) {
+            small_slices[device_id].push_back(slice);
+            continue;
+        }
+        issueCopiesOnStream(device_id, {slice}, pending);
+    }
+    for (auto &entry : small_slices) {
+        issueCopiesOnStream(entry.first, entry.second, pending);
+    }
+}
+
+void NvlinkTransport::issueCopiesOnStream(
+    int device_id, const std::vector<Slice *> &slices,
+    std::vector<PendingTransfer> &pending) {
+    if (!checkCudaErrorReturn(cudaSetDevice(device_id),
+                              "NvlinkTransport: failed to set device")) {
+        for (auto slice : slices) slice->markFailed();
+        return;
+    }
+
+    cudaEvent_t event = event_pool_.getEvent(device_id);
+    cudaStream_t stream = stream_pool_.getNextStream(device_id);
+    if (event == nullptr || stream == nullptr) {
+        LOG(ERROR) << "NvlinkTransport: failed to get event or stream from "
+                      "pool for device "
+                   << device_id;
+        for (auto slice : slices) slice->markFailed();
+        event_pool_.putEvent(event, device_id);
+        return;
+    }
+
+    PendingTransfer transfer{event, device_id, {}};
+    if (slices.size() > 1 && copyBatchAsync(slices, stream)) {
+        transfer.slices = slices;
+    } else {
+        transfer.slices.reserve(slices.size());
+        for (auto slice : slices) {
+            if (checkCudaErrorReturn(copySliceAsync(slice, stream),
+                                     "NvlinkTransport: cudaMemcpyAsync "
+                                     "failed"))
+                transfer.slices.push_back(slice);
+            else
+                slice->markFailed();
+        }
+    }
+    if (transfer.slices.empty()) {
+        event_pool_.putEvent(event, device_id);
+        return;
+    }
+
+    if (!checkCudaErrorReturn(cudaEventRecord(event, stream),
+                              "NvlinkTransport: cudaEventRecord failed")) {
+        // Without an event, wait for the whole stream instead
+        cudaError_t err = cudaStreamSynchronize(stream);
+        for (auto slice : transfer.slices) {
+            if (err == cudaSuccess)
+                slice->markSuccess();
+            else
+                slice->markFailed();
+        }
+        event_pool_.putEvent(event, device_id);
+        return;
+    }
+    pending.push_back(std::move(transfer));
+}
+
+void NvlinkTransport::synchronizePendingTransfers(
+    std::vector<PendingTransfer> &pending_transfers) {
+    for (auto &pt : pending_transfers) {
+        cudaError_t err = cudaEventSynchronize(pt.event);
+        if (err != cudaSuccess) {
+            LOG(ERROR) << "NvlinkTransport: cudaEventSynchronize failed: "
+                       << cudaGetErrorString(err);
+        }
+        for (auto slice : pt.slices) {
+            if (err == cudaSuccess)
+                slice->markSuccess();
+            else
+                slice->markFailed();
+        }
+        event_pool_.putEvent(pt.event, pt.device_id);
+    }
+    pending_transfers.clear();
+}
+
 int NvlinkTransport::registerLocalMemory(void *addr, size_t length,
                                          const std::string &location,
                                          bool remote_accessible,
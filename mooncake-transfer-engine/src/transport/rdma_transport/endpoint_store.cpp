@@ -18,6 +18,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <algorithm>
 #include <cstddef>
 #include <memory>
 #include <utility>
@@ -49,12 +50,19 @@ std::shared_ptr<RdmaEndPoint> FIFOEndpointStore::insertEndpoint(
         return nullptr;
     }
     auto &config = globalConfig();
-    int ret =
-        endpoint->construct(context->cq(), config.num_qp_per_ep, config.max_sge,
-                            config.max_wr, config.max_inline);
+    int ret = endpoint->construct(
+        context->cq(), config.num_qp_per_ep + (config.rdma_priority_qp ? 1 : 0),
+        config.max_sge, config.max_wr, config.max_inline);
     if (ret) return nullptr;
 
-    while (this->getSize() >= max_size_) evictEndpoint();
+    while (this->getSize() >= max_size_) {
+        if (!evictEndpoint()) {
+            LOG(WARNING) << "All " << getSize()
+                         << " endpoints are pinned, exceeding the limit of "
+                         << max_size_;
+            break;
+        }
+    }
 
     endpoint->setPeerNicPath(peer_nic_path);
     endpoint_map_[peer_nic_path] = endpoint;
@@ -75,19 +83,28 @@ int FIFOEndpointStore::deleteEndpoint(const std::string &peer_nic_path) {
         auto fifo_iter = fifo_map_[peer_nic_path];
         fifo_list_.erase(fifo_iter);
         fifo_map_.erase(peer_nic_path);
+        version_.fetch_add(1, std::memory_order_release);
     }
     return 0;
 }
 
-void FIFOEndpointStore::evictEndpoint() {
-    if (fifo_list_.empty()) return;
-    std::string victim = fifo_list_.front();
-    fifo_list_.pop_front();
+void FIFOEndpointStore::pinEndpoint(const std::string &peer_nic_path) {
+    RWSpinlock::WriteGuard guard(endpoint_map_lock_);
+    pinned_set_.insert(peer_nic_path);
+}
+
+bool FIFOEndpointStore::evictEndpoint() {
+    auto o = fifo_list_.begin();
+    while (o != fifo_list_.end() && pinned_set_.count(*o)) ++o;
+    if (o == fifo_list_.end()) return false;
+    std::string victim = *o;
+    fifo_list_.erase(o);
     fifo_map_.erase(victim);
     LOG(INFO) << victim << " evicted";
     waiting_list_.insert(endpoint_map_[victim]);
     endpoint_map_.erase(victim);
-    return;
+    version_.fetch_add(1, std::memory_order_release);
+    return true;
 }
 
 void FIFOEndpointStore::reclaimEndpoint() {
@@ -152,12 +169,19 @@ std::shared_ptr<RdmaEndPoint> SIEVEEndpointStore::insertEndpoint(
         return nullptr;
     }
     auto &config = globalConfig();
-    int ret =
-        endpoint->construct(context->cq(), config.num_qp_per_ep, config.max_sge,
-                            config.max_wr, config.max_inline);
+    int ret = endpoint->construct(
+        context->cq(), config.num_qp_per_ep + (config.rdma_priority_qp ? 1 : 0),
+        config.max_sge, config.max_wr, config.max_inline);
     if (ret) return nullptr;
 
-    while (this->getSize() >= max_size_) evictEndpoint();
+    while (this->getSize() >= max_size_) {
+        if (!evictEndpoint()) {
+            LOG(WARNING) << "All " << getSize()
+                         << " endpoints are pinned, exceeding the limit of "
+                         << max_size_;
+            break;
+        }
+    }
 
     endpoint->setPeerNicPath(peer_nic_path);
     endpoint_map_[peer_nic_path] = std::make_pair(endpoint, true);
@@ -182,19 +206,32 @@ int SIEVEEndpointStore::deleteEndpoint(const std::string &peer_nic_path) {
         }
         fifo_list_.erase(fifo_iter);
         fifo_map_.erase(peer_nic_path);
+        version_.fetch_add(1, std::memory_order_release);
     }
     return 0;
 }
 
-void SIEVEEndpointStore::evictEndpoint() {
-    if (fifo_list_.empty()) {
-        return;
+void SIEVEEndpointStore::pinEndpoint(const std::string &peer_nic_path) {
+    RWSpinlock::WriteGuard guard(endpoint_map_lock_);
+    pinned_set_.insert(peer_nic_path);
+}
+
+bool SIEVEEndpointStore::evictEndpoint() {
+    if (fifo_list_.size() <= pinned_set_.size()) {
+        size_t pinned_count = 0;
+        for (auto &peer_nic_path : fifo_list_)
+            pinned_count += pinned_set_.count(peer_nic_path);
+        if (pinned_count == fifo_list_.size()) return false;
     }
     auto o = hand_.has_value() ? hand_.value() : --fifo_list_.end();
     std::string victim;
     while (true) {
         victim = *o;
-        if (endpoint_map_[victim].second.load(std::memory_order_relaxed)) {
+        // Pinned endpoints are passed over like visited ones
+        if (pinned_set_.count(victim)) {
+            o = (o == fifo_list_.begin() ? --fifo_list_.end() : std::prev(o));
+        } else if (endpoint_map_[victim].second.load(
+                       std::memory_order_relaxed)) {
             endpoint_map_[victim].second.store(false,
                                                std::memory_order_relaxed);
             o = (o == fifo_list_.begin() ? --fifo_list_.end() : std::prev(o));
@@ -211,7 +248,8 @@ void SIEVEEndpointStore::evictEndpoint() {
     waiting_list_len_++;
     waiting_list_.insert(victim_instance);
     endpoint_map_.erase(victim);
-    return;
+    version_.fetch_add(1, std::memory_order_release);
+    return true;
 }
 
 void SIEVEEndpointStore::reclaimEndpoint() {
@@ -255,4 +293,113 @@ size_t SIEVEEndpointStore::getTotalQPNumber() {
     return total_qps;
 }
 
+namespace {
+struct CachedEndpoint {
+    uint64_t store_id = 0;
+    EndpointStore *shard = nullptr;
+    uint64_t version = 0;
+    std::string peer_nic_path;
+    // Weak so that the cache never keeps an endpoint, and its QPs, alive
+    std::weak_ptr<RdmaEndPoint> endpoint;
+};
+
+// One entry per store, modulo collisions, for threads feeding several NICs
+const size_t kEndpointCacheSlots = 8;
+thread_local CachedEndpoint tl_endpoint_cache[kEndpointCacheSlots];
+
+std::atomic<uint64_t> next_store_id{1};
+
+// Sharding starts once every shard holds at least this many endpoints
+const size_t kMinEndpointsPerShard = 64;
+}  // namespace
+
+ShardedEndpointStore::ShardedEndpointStore(
+    std::vector<std::shared_ptr<EndpointStore>> shards)
+    : shards_(std::move(shards)),
+      id_(next_store_id.fetch_add(1, std::memory_order_relaxed)) {
+    assert(!shards_.empty());
+}
+
+std::shared_ptr<RdmaEndPoint> ShardedEndpointStore::getEndpoint(
+    const std::string &peer_nic_path) {
+    auto &cached = tl_endpoint_cache[id_ % kEndpointCacheSlots];
+    // A cache hit does not set the SIEVE visited bit, which is fine: the bit
+    // is only cleared by an eviction, which invalidates the cache, so the
+    // next lookup goes through the shard and sets it again
+    if (cached.store_id == id_ && cached.version == cached.shard->version() &&
+        cached.peer_nic_path == peer_nic_path) {
+        auto endpoint = cached.endpoint.lock();
+        if (endpoint) return endpoint;
+    }
+    auto &shard = shardOf(peer_nic_path);
+    // Read before the lookup, so that a concurrent removal leaves the entry
+    // stale rather than valid
+    uint64_t version = shard.version();
+    auto endpoint = shard.getEndpoint(peer_nic_path);
+    if (endpoint) {
+        cached.store_id = id_;
+        cached.shard = &shard;
+        cached.version = version;
+        cached.peer_nic_path = peer_nic_path;
+        cached.endpoint = endpoint;
+    }
+    return endpoint;
+}
+
+std::shared_ptr<RdmaEndPoint> ShardedEndpointStore::insertEndpoint(
+    const std::string &peer_nic_path, RdmaContext *context) {
+    return shardOf(peer_nic_path).insertEndpoint(peer_nic_path, context);
+}
+
+int ShardedEndpointStore::deleteEndpoint(const std::string &peer_nic_path) {
+    return shardOf(peer_nic_path).deleteEndpoint(peer_nic_path);
+}
+
+void ShardedEndpointStore::pinEndpoint(const std::string &peer_nic_path) {
+    shardOf(peer_nic_path).pinEndpoint(peer_nic_path);
+}
+
+void ShardedEndpointStore::reclaimEndpoint() {
+    for (auto &shard : shards_) shard->reclaimEndpoint();
+}
+
+size_t ShardedEndpointStore::getSize() {
+    size_t size = 0;
+    for (auto &shard : shards_) size += shard->getSize();
+    return size;
+}
+
+int ShardedEndpointStore::destroyQPs() {
+    for (auto &shard : shards_) shard->destroyQPs();
+    return 0;
+}
+
+int ShardedEndpointStore::disconnectQPs() {
+    for (auto &shard : shards_) shard->disconnectQPs();
+    return 0;
+}
+
+size_t ShardedEndpointStore::getTotalQPNumber() {
+    size_t total_qps = 0;
+    for (auto &shard : shards_) total_qps += shard->getTotalQPNumber();
+    return total_qps;
+}
+
+std::shared_ptr<EndpointStore> createEndpointStore(EndpointStoreType type,
+                                                   size_t max_size,
+                                                   size_t num_shards) {
+    num_shards = std::min(num_shards, max_size / kMinEndpointsPerShard);
+    if (num_shards == 0) num_shards = 1;
+    size_t shard_size = (max_size + num_shards - 1) / num_shards;
+    std::vector<std::shared_ptr<EndpointStore>> shards;
+    for (size_t i = 0; i < num_shards; ++i) {
+        if (type == EndpointStoreType::FIFO)
+            shards.push_back(std::make_shared<FIFOEndpointStore>(shard_size));
+        else
+            shards.push_back(std::make_shared<SIEVEEndpointStore>(shard_size));
+    }
+    if (num_shards == 1) return shards[0];
+    return std::make_shared<ShardedEndpointStore>(std::move(shards));
+}
+
 }  // namespace mooncake
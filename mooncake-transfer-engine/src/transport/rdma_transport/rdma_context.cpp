@@ -16,6 +16,7 @@
 
 #include <fcntl.h>
 #include <sys/epoll.h>
+#include <unistd.h>
 
 #include <atomic>
 #include <cassert>
@@ -64,19 +65,14 @@ int RdmaContext::construct(size_t num_cq_list, size_t num_comp_channels,
                            int max_endpoints) {
     // Create endpoint store based on configuration
     auto &config = globalConfig();
-    switch (config.endpoint_store_type) {
-        case EndpointStoreType::FIFO:
-            endpoint_store_ =
-                std::make_shared<FIFOEndpointStore>(max_endpoints);
-            LOG(INFO) << "Using FIFO endpoint store";
-            break;
-        case EndpointStoreType::SIEVE:
-        default:
-            endpoint_store_ =
-                std::make_shared<SIEVEEndpointStore>(max_endpoints);
-            LOG(INFO) << "Using SIEVE endpoint store";
-            break;
-    }
+    endpoint_store_ =
+        createEndpointStore(config.endpoint_store_type, max_endpoints,
+                            config.endpoint_store_shards);
+    LOG(INFO) << "Using "
+              << (config.endpoint_store_type == EndpointStoreType::FIFO
+                      ? "FIFO"
+                      : "SIEVE")
+              << " endpoint store";
     if (openRdmaDevice(device_name_, port, gid_index)) {
         LOG(ERROR) << "Failed to open device " << device_name_ << " on port "
                    << port << " with GID " << gid_index;
@@ -90,6 +86,27 @@ int RdmaContext::construct(size_t num_cq_list, size_t num_comp_channels,
         return ERR_CONTEXT;
     }
 
+    if (config.shared_rq) {
+        // The transport only posts one-sided READ/WRITE, so nothing is
+        // received but notifies. Sharing one minimal queue saves the receive
+        // ring each QP would otherwise allocate.
+        ibv_srq_init_attr srq_attr;
+        memset(&srq_attr, 0, sizeof(srq_attr));
+        srq_attr.attr.max_wr = config.rdma_notify_imm ? kNotifyRecvSlots : 1;
+        srq_attr.attr.max_sge = 1;
+        srq_ = ibv_create_srq(pd_, &srq_attr);
+        if (!srq_) {
+            PLOG(ERROR) << "Failed to create shared receive queue on device "
+                        << device_name_;
+            return ERR_CONTEXT;
+        }
+        if (config.rdma_notify_imm && setupNotifySlots()) {
+            LOG(ERROR) << "Failed to set up notify slots on device "
+                       << device_name_;
+            return ERR_CONTEXT;
+        }
+    }
+
     num_comp_channel_ = num_comp_channels;
     comp_channel_ = new ibv_comp_channel *[num_comp_channels];
     for (size_t i = 0; i < num_comp_channels; ++i) {
@@ -194,6 +211,20 @@ int RdmaContext::deconstruct() {
         comp_channel_ = nullptr;
     }
 
+    if (srq_) {
+        if (ibv_destroy_srq(srq_))
+            PLOG(ERROR) << "Failed to destroy shared receive queue";
+        srq_ = nullptr;
+    }
+
+    if (notify_mr_) {
+        if (ibv_dereg_mr(notify_mr_))
+            PLOG(ERROR) << "Failed to unregister notify slots";
+        notify_mr_ = nullptr;
+    }
+    free(notify_buffer_);
+    notify_buffer_ = nullptr;
+
     if (pd_) {
         if (ibv_dealloc_pd(pd_))
             PLOG(ERROR) << "Failed to deallocate protection domain";
@@ -217,6 +248,8 @@ int RdmaContext::registerMemoryRegionInternal(void *addr, size_t length,
                       << "shrink it to " << globalConfig().max_mr_size;
         length = (size_t)globalConfig().max_mr_size;
     }
+    // Devices without atomics may reject MRs asking for them
+    if (!atomics_supported_) access &= ~IBV_ACCESS_REMOTE_ATOMIC;
 #if !defined(WITH_NVIDIA_PEERMEM) && defined(USE_CUDA)
     // Implement register memory in a way that does not assume the presence of
     // nvidia-peermem. If memory is on CPU call ibv_reg_mr() as usual. If memory
@@ -229,22 +262,24 @@ int RdmaContext::registerMemoryRegionInternal(void *addr, size_t length,
     // Register memory depending on whether memory is on host or GPU.
     if (result != CUDA_SUCCESS || memType == CU_MEMORYTYPE_HOST) {
         mrMeta.addr = addr;
-        mrMeta.mr = ibv_reg_mr(pd_, addr, length, access);
+        mrMeta.mr = registerHostMemory(addr, length, access);
     } else if (memType == CU_MEMORYTYPE_DEVICE) {
+        // The dmabuf covers the whole allocation, which addr may be inside
+        CUdeviceptr allocBase;
         size_t allocSize;
-        result = cuPointerGetAttribute(
-            &allocSize, CU_POINTER_ATTRIBUTE_RANGE_SIZE, (CUdeviceptr)addr);
+        result = cuMemGetAddressRange(&allocBase, &allocSize,
+                                      (CUdeviceptr)addr);
         if (result != CUDA_SUCCESS) {
             const char *errStr;
             cuGetErrorString(result, &errStr);
-            LOG(ERROR) << "Failed to call cuPointerGetAttribute for "
+            LOG(ERROR) << "Failed to call cuMemGetAddressRange for "
                        << (uintptr_t)addr << " cuda error=" << errStr;
             return ERR_CONTEXT;
         }
 
         int dmabuf_fd;
         result = cuMemGetHandleForAddressRange(
-            &dmabuf_fd, (CUdeviceptr)addr, allocSize,
+            &dmabuf_fd, allocBase, allocSize,
             CU_MEM_RANGE_HANDLE_TYPE_DMA_BUF_FD, 0);
         if (result != CUDA_SUCCESS) {
             const char *errStr;
@@ -254,12 +289,19 @@ int RdmaContext::registerMemoryRegionInternal(void *addr, size_t length,
             return ERR_CONTEXT;
         }
         mrMeta.addr = addr;
-        mrMeta.mr = ibv_reg_dmabuf_mr(pd_, 0 /* offset */, length,
-                                      (uintptr_t)addr, dmabuf_fd, access);
+        // Dmabuf MRs fault their pages in like ODP ones
+        if (!odp_atomics_supported_) access &= ~IBV_ACCESS_REMOTE_ATOMIC;
+        mrMeta.mr = ibv_reg_dmabuf_mr(pd_, (uintptr_t)addr - allocBase,
+                                      length, (uintptr_t)addr, dmabuf_fd,
+                                      access);
+        // The MR holds its own reference to the dmabuf
+        int saved_errno = errno;
+        close(dmabuf_fd);
+        errno = saved_errno;
     }
 #else
     mrMeta.addr = addr;
-    mrMeta.mr = ibv_reg_mr(pd_, addr, length, access);
+    mrMeta.mr = registerHostMemory(addr, length, access);
 #endif
     if (!mrMeta.mr) {
         PLOG(ERROR) << "Failed to register memory " << addr;
@@ -268,6 +310,23 @@ int RdmaContext::registerMemoryRegionInternal(void *addr, size_t length,
     return 0;
 }
 
+bool RdmaContext::odpEnabled() const {
+    return odp_supported_ && globalConfig().ib_odp;
+}
+
+ibv_mr *RdmaContext::registerHostMemory(void *addr, size_t length,
+                                        int access) {
+    if (odpEnabled() && (access & IBV_ACCESS_REMOTE_READ)) {
+        int odp_access = access | IBV_ACCESS_ON_DEMAND;
+        if (!odp_atomics_supported_) odp_access &= ~IBV_ACCESS_REMOTE_ATOMIC;
+        ibv_mr *mr = ibv_reg_mr(pd_, addr, length, odp_access);
+        if (mr) return mr;
+        PLOG(WARNING) << "Failed to register ODP memory " << addr
+                      << " on " << deviceName() << ", pinning it instead";
+    }
+    return ibv_reg_mr(pd_, addr, length, access);
+}
+
 int RdmaContext::registerMemoryRegion(void *addr, size_t length, int access) {
     MemoryRegionMeta mrMeta;
     int ret = registerMemoryRegionInternal(addr, length, access, mrMeta);
@@ -357,6 +416,105 @@ std::shared_ptr<RdmaEndPoint> RdmaContext::endpoint(
     return endpoint;
 }
 
+std::shared_ptr<RdmaEndPoint> RdmaContext::findEndpoint(
+    const std::string &peer_nic_path) {
+    return endpoint_store_->getEndpoint(peer_nic_path);
+}
+
+int RdmaContext::setupNotifySlots() {
+    const size_t length =
+        (kNotifyRecvSlots + kNotifySendSlots) * kNotifySlotSize;
+    notify_buffer_ = (char *)aligned_alloc(kNotifySlotSize, length);
+    if (!notify_buffer_) return ERR_MEMORY;
+    auto mr = ibv_reg_mr(pd_, notify_buffer_, length, IBV_ACCESS_LOCAL_WRITE);
+    if (!mr) {
+        PLOG(ERROR) << "Failed to register notify slots";
+        return ERR_CONTEXT;
+    }
+    notify_mr_ = mr;
+    notify_sends_.resize(kNotifySendSlots);
+    for (int i = 0; i < kNotifySendSlots; ++i)
+        free_notify_sends_.push_back(kNotifyRecvSlots + i);
+    for (int slot = 0; slot < kNotifyRecvSlots; ++slot) {
+        int ret = postNotifyRecv(slot);
+        if (ret) return ret;
+    }
+    return 0;
+}
+
+int RdmaContext::postNotifyRecv(int slot) {
+    ibv_sge sge{(uint64_t)notifySlot(slot), (uint32_t)kNotifySlotSize,
+                notify_mr_->lkey};
+    ibv_recv_wr wr, *bad_wr = nullptr;
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = ((uint64_t)slot << 1) | 1;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    if (ibv_post_srq_recv(srq_, &wr, &bad_wr)) {
+        PLOG(ERROR) << "Failed to post notify slot on device " << device_name_;
+        return ERR_CONTEXT;
+    }
+    return 0;
+}
+
+int RdmaContext::postNotify(RdmaEndPoint &endpoint,
+                            const std::string &payload) {
+    if (!notify_mr_ || payload.size() > kNotifySlotSize)
+        return ERR_INVALID_ARGUMENT;
+    int slot;
+    {
+        std::lock_guard<std::mutex> lock(notify_mutex_);
+        if (free_notify_sends_.empty()) return ERR_TOO_MANY_REQUESTS;
+        slot = free_notify_sends_.back();
+        free_notify_sends_.pop_back();
+    }
+    memcpy(notifySlot(slot), payload.data(), payload.size());
+    ibv_sge sge{(uint64_t)notifySlot(slot), (uint32_t)payload.size(),
+                notify_mr_->lkey};
+    auto &send = notify_sends_[slot - kNotifyRecvSlots];
+    int ret = endpoint.postSendNotify(sge, ((uint64_t)slot << 1) | 1,
+                                      htonl(kNotifyImmData), send.qp_depth,
+                                      send.cq_outstanding);
+    if (ret) {
+        std::lock_guard<std::mutex> lock(notify_mutex_);
+        free_notify_sends_.push_back(slot);
+    }
+    return ret;
+}
+
+void RdmaContext::completeNotify(const ibv_wc &wc) {
+    int slot = wc.wr_id >> 1;
+    if (slot >= kNotifyRecvSlots) {
+        auto &send = notify_sends_[slot - kNotifyRecvSlots];
+        __sync_fetch_and_sub(send.qp_depth, 1);
+        __sync_fetch_and_sub(send.cq_outstanding, 1);
+        if (wc.status != IBV_WC_SUCCESS)
+            LOG(ERROR) << "Failed to send notify from " << nicPath() << ": "
+                       << ibv_wc_status_str(wc.status);
+        std::lock_guard<std::mutex> lock(notify_mutex_);
+        free_notify_sends_.push_back(slot);
+        return;
+    }
+
+    if (wc.status == IBV_WC_SUCCESS && (wc.wc_flags & IBV_WC_WITH_IMM) &&
+        ntohl(wc.imm_data) == kNotifyImmData) {
+        // Encoded as the sender name and the message, split by a NUL
+        std::string payload(notifySlot(slot), wc.byte_len);
+        auto pos = payload.find('\0');
+        if (pos != std::string::npos) {
+            TransferMetadata::NotifyDesc notify;
+            notify.name = payload.substr(0, pos);
+            notify.notify_msg = payload.substr(pos + 1);
+            engine_.deliverNotify(std::move(notify));
+        }
+    } else if (wc.status != IBV_WC_SUCCESS &&
+               wc.status != IBV_WC_WR_FLUSH_ERR) {
+        LOG(ERROR) << "Failed to receive notify on " << nicPath() << ": "
+                   << ibv_wc_status_str(wc.status);
+    }
+    postNotifyRecv(slot);
+}
+
 int RdmaContext::disconnectAllEndpoints() {
     return endpoint_store_->disconnectQPs();
 }
@@ -365,6 +523,10 @@ int RdmaContext::deleteEndpoint(const std::string &peer_nic_path) {
     return endpoint_store_->deleteEndpoint(peer_nic_path);
 }
 
+void RdmaContext::pinEndpoint(const std::string &peer_nic_path) {
+    endpoint_store_->pinEndpoint(peer_nic_path);
+}
+
 size_t RdmaContext::getTotalQPNumber() const {
     return endpoint_store_->getTotalQPNumber();
 }
@@ -553,6 +715,26 @@ int RdmaContext::openRdmaDevice(const std::string &device_name, uint8_t port,
         }
 #endif
 
+        // RDMA reads and writes over an ODP MR need RC send, read and write
+        // support, the local page faults being taken on the send side
+        bool odp_supported = false, odp_atomics_supported = false;
+        ibv_device_attr_ex device_attr_ex = {};
+        if (ibv_query_device_ex(context, nullptr, &device_attr_ex) == 0) {
+            const uint32_t rc_caps = IBV_ODP_SUPPORT_SEND |
+                                     IBV_ODP_SUPPORT_READ |
+                                     IBV_ODP_SUPPORT_WRITE;
+            const auto &odp_caps = device_attr_ex.odp_caps;
+            odp_supported =
+                (odp_caps.general_caps & IBV_ODP_SUPPORT) &&
+                (odp_caps.per_transport_caps.rc_odp_caps & rc_caps) == rc_caps;
+            odp_atomics_supported = odp_caps.per_transport_caps.rc_odp_caps &
+                                    IBV_ODP_SUPPORT_ATOMIC;
+        }
+        if (globalConfig().ib_odp && !odp_supported) {
+            LOG(WARNING) << "Device " << device_name
+                         << " does not support ODP, pinning memory instead";
+        }
+
         ibv_port_attr port_attr;
         ret = ibv_query_port(context, port, &port_attr);
         if (ret) {
@@ -619,6 +801,9 @@ int RdmaContext::openRdmaDevice(const std::string &device_name, uint8_t port,
         active_mtu_ = attr.active_mtu;
         active_speed_ = attr.active_speed;
         gid_index_ = gid_index;
+        odp_supported_ = odp_supported;
+        odp_atomics_supported_ = odp_atomics_supported;
+        atomics_supported_ = device_attr.atomic_cap != IBV_ATOMIC_NONE;
 
         ibv_free_device_list(devices);
         return 0;
@@ -674,4 +859,21 @@ int RdmaContext::submitPostSend(
     const std::vector<Transport::Slice *> &slice_list) {
     return worker_pool_->submitPostSend(slice_list);
 }
+
+uint64_t RdmaContext::outstandingBytes() const {
+    return worker_pool_ ? worker_pool_->outstandingBytes() : 0;
+}
+
+uint64_t RdmaContext::transferredBytes() const {
+    return worker_pool_ ? worker_pool_->transferredBytes() : 0;
+}
+
+uint64_t RdmaContext::outstandingWorkRequests() const {
+    uint64_t count = 0;
+    for (auto &cq : cq_list_) {
+        int outstanding = cq.outstanding;
+        if (outstanding > 0) count += outstanding;
+    }
+    return count;
+}
 }  // namespace mooncake
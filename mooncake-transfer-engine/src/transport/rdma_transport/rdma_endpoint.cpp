@@ -16,6 +16,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 
@@ -29,6 +30,7 @@ const static uint8_t RETRY_CNT = 7;
 RdmaEndPoint::RdmaEndPoint(RdmaContext &context)
     : context_(context),
       status_(INITIALIZING),
+      max_inline_bytes_(0),
       active_(true),
       cq_outstanding_(nullptr) {}
 
@@ -48,6 +50,7 @@ int RdmaEndPoint::construct(ibv_cq *cq, size_t num_qp_list,
     cq_outstanding_ = (volatile int *)cq->cq_context;
 
     max_wr_depth_ = (int)max_wr_depth;
+    max_inline_bytes_ = max_inline_bytes;
     wr_depth_list_ = new volatile int[num_qp_list];
     if (!wr_depth_list_) {
         LOG(ERROR) << "Failed to allocate memory for work request depth list";
@@ -62,14 +65,22 @@ int RdmaEndPoint::construct(ibv_cq *cq, size_t num_qp_list,
         attr.sq_sig_all = false;
         attr.qp_type = IBV_QPT_RC;
         attr.qp_context = this;
-        attr.cap.max_send_wr = attr.cap.max_recv_wr = max_wr_depth;
-        attr.cap.max_send_sge = attr.cap.max_recv_sge = max_sge_per_wr;
+        attr.cap.max_send_wr = max_wr_depth;
+        attr.cap.max_send_sge = max_sge_per_wr;
+        attr.srq = context_.srq();
+        if (!attr.srq) {
+            attr.cap.max_recv_wr = max_wr_depth;
+            attr.cap.max_recv_sge = max_sge_per_wr;
+        }
         attr.cap.max_inline_data = max_inline_bytes;
         qp_list_[i] = ibv_create_qp(context_.pd(), &attr);
         if (!qp_list_[i]) {
             PLOG(ERROR) << "Failed to create QP";
             return ERR_ENDPOINT;
         }
+        // The device reports the inline size it actually supports
+        max_inline_bytes_ =
+            std::min(max_inline_bytes_, attr.cap.max_inline_data);
     }
 
     status_.store(UNCONNECTED, std::memory_order_relaxed);
@@ -263,49 +274,119 @@ bool RdmaEndPoint::hasOutstandingSlice() const {
     return false;
 }
 
+static ibv_wr_opcode toWrOpcode(Transport::TransferRequest::OpCode opcode) {
+    switch (opcode) {
+        case Transport::TransferRequest::READ:
+            return IBV_WR_RDMA_READ;
+        case Transport::TransferRequest::FETCH_ADD:
+            return IBV_WR_ATOMIC_FETCH_AND_ADD;
+        case Transport::TransferRequest::COMPARE_SWAP:
+            return IBV_WR_ATOMIC_CMP_AND_SWP;
+        default:
+            return IBV_WR_RDMA_WRITE;
+    }
+}
+
 int RdmaEndPoint::submitPostSend(
     std::vector<Transport::Slice *> &slice_list,
-    std::vector<Transport::Slice *> &failed_slice_list) {
+    std::vector<Transport::Slice *> &failed_slice_list, bool urgent) {
     RWSpinlock::WriteGuard guard(lock_);
     if (!active_) return 0;
-    int qp_index = SimpleRandom::Get().next(qp_list_.size());
+    int qp_index;
+    int max_cqe = globalConfig().max_cqe;
+    if (globalConfig().rdma_priority_qp && qp_list_.size() > 1) {
+        // QP 0 carries urgent slices only, so that they never queue behind
+        // bulk WRs, and CQ room for a full send queue of it is kept
+        if (urgent) {
+            qp_index = 0;
+        } else {
+            qp_index = 1 + SimpleRandom::Get().next(qp_list_.size() - 1);
+            max_cqe -= max_wr_depth_;
+        }
+    } else {
+        qp_index = SimpleRandom::Get().next(qp_list_.size());
+    }
     int wr_count = std::min(max_wr_depth_ - wr_depth_list_[qp_index],
                             (int)slice_list.size());
-    wr_count =
-        std::min(int(globalConfig().max_cqe) - *cq_outstanding_, wr_count);
+    wr_count = std::min(max_cqe - *cq_outstanding_, wr_count);
     if (wr_count <= 0) return 0;
 
+    // Slices gathering several local blocks take one SGE per block
+    int sge_count = 0;
+    for (int i = 0; i < wr_count; ++i)
+        sge_count += std::max<int>(1, slice_list[i]->local_blocks.size());
+
     ibv_send_wr wr_list[wr_count], *bad_wr = nullptr;
-    ibv_sge sge_list[wr_count];
+    ibv_sge sge_list[sge_count];
     memset(wr_list, 0, sizeof(ibv_send_wr) * wr_count);
+    const int signal_interval = globalConfig().wr_signal_interval;
+    Transport::Slice *unsignaled_prev = nullptr;
+    int sge_index = 0;
     for (int i = 0; i < wr_count; ++i) {
         auto slice = slice_list[i];
-        auto &sge = sge_list[i];
-        sge.addr = (uint64_t)slice->source_addr;
-        sge.length = slice->length;
-        sge.lkey = slice->rdma.source_lkey;
+        auto sge = &sge_list[sge_index];
+        int num_sge = 0;
+        if (slice->local_blocks.empty()) {
+            sge[num_sge++] = ibv_sge{(uint64_t)slice->source_addr,
+                                     (uint32_t)slice->length,
+                                     slice->rdma.source_lkey};
+        } else {
+            for (auto &block : slice->local_blocks)
+                sge[num_sge++] =
+                    ibv_sge{(uint64_t)block.first, (uint32_t)block.second,
+                            slice->rdma.source_lkey};
+        }
+        sge_index += num_sge;
 
         auto &wr = wr_list[i];
         wr.wr_id = (uint64_t)slice;
-        wr.opcode = slice->opcode == Transport::TransferRequest::READ
-                        ? IBV_WR_RDMA_READ
-                        : IBV_WR_RDMA_WRITE;
-        wr.num_sge = 1;
-        wr.sg_list = &sge;
-        wr.send_flags = IBV_SEND_SIGNALED;
+        wr.opcode = toWrOpcode(slice->opcode);
+        wr.num_sge = num_sge;
+        wr.sg_list = sge;
+        // The last WR of a post is always signaled, so that the completion
+        // of every WR is learned
+        bool signaled = (i + 1) % signal_interval == 0 || i + 1 == wr_count;
+        wr.send_flags = signaled ? IBV_SEND_SIGNALED : 0;
+        if (wr.opcode == IBV_WR_RDMA_WRITE &&
+            slice->length <= max_inline_bytes_)
+            wr.send_flags |= IBV_SEND_INLINE;
         wr.next = (i + 1 == wr_count) ? nullptr : &wr_list[i + 1];
         wr.imm_data = 0;
-        wr.wr.rdma.remote_addr = slice->rdma.dest_addr;
-        wr.wr.rdma.rkey = slice->rdma.dest_rkey;
+        if (wr.opcode == IBV_WR_ATOMIC_FETCH_AND_ADD ||
+            wr.opcode == IBV_WR_ATOMIC_CMP_AND_SWP) {
+            wr.wr.atomic.remote_addr = slice->rdma.dest_addr;
+            wr.wr.atomic.compare_add = slice->compare_add;
+            wr.wr.atomic.swap = slice->swap;
+            wr.wr.atomic.rkey = slice->rdma.dest_rkey;
+        } else {
+            wr.wr.rdma.remote_addr = slice->rdma.dest_addr;
+            wr.wr.rdma.rkey = slice->rdma.dest_rkey;
+        }
         slice->ts = getCurrentTimeInNano();
         slice->status = Transport::Slice::POSTED;
         slice->rdma.qp_depth = &wr_depth_list_[qp_index];
+        slice->rdma.signaled = signaled;
+        slice->rdma.unsignaled_prev = unsignaled_prev;
+        unsignaled_prev = signaled ? nullptr : slice;
     }
     __sync_fetch_and_add(&wr_depth_list_[qp_index], wr_count);
     __sync_fetch_and_add(cq_outstanding_, wr_count);
+    uint64_t post_start_ts = getCurrentTimeInNano();
     int rc = ibv_post_send(qp_list_[qp_index], wr_list, &bad_wr);
+    context_.counters().recordPost(
+        wr_count, getCurrentTimeInNano() - post_start_ts, rc != 0);
     if (rc) {
         PLOG(ERROR) << "Failed to ibv_post_send";
+        // Unsignaled WRs posted just before bad_wr have no signaled WR to
+        // complete with, so they are retried as well
+        if (bad_wr != wr_list) {
+            int i = bad_wr - wr_list - 1;
+            for (; i >= 0 && !slice_list[i]->rdma.signaled; --i) {
+                failed_slice_list.push_back(slice_list[i]);
+                __sync_fetch_and_sub(&wr_depth_list_[qp_index], 1);
+                __sync_fetch_and_sub(cq_outstanding_, 1);
+            }
+        }
         while (bad_wr) {
             int i = bad_wr - wr_list;
             failed_slice_list.push_back(slice_list[i]);
@@ -318,6 +399,41 @@ int RdmaEndPoint::submitPostSend(
     return 0;
 }
 
+int RdmaEndPoint::postSendNotify(const ibv_sge &sge, uint64_t wr_id,
+                                 uint32_t imm_data, volatile int *&qp_depth,
+                                 volatile int *&cq_outstanding) {
+    RWSpinlock::WriteGuard guard(lock_);
+    if (!active_ || !connected() || qp_list_.empty()) return ERR_ENDPOINT;
+    // Urgent slices keep QP 0 to themselves when rdma_priority_qp is set
+    int qp_index = qp_list_.size() > 1 ? 1 : 0;
+    if (wr_depth_list_[qp_index] >= max_wr_depth_ ||
+        *cq_outstanding_ >= (int)globalConfig().max_cqe)
+        return ERR_ENDPOINT;
+
+    ibv_sge sge_copy = sge;
+    ibv_send_wr wr, *bad_wr = nullptr;
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = wr_id;
+    wr.opcode = IBV_WR_SEND_WITH_IMM;
+    wr.sg_list = &sge_copy;
+    wr.num_sge = 1;
+    wr.send_flags = IBV_SEND_SIGNALED;
+    if (sge.length <= max_inline_bytes_) wr.send_flags |= IBV_SEND_INLINE;
+    wr.imm_data = imm_data;
+    // Set before posting, as the WR may complete on another thread at once
+    qp_depth = &wr_depth_list_[qp_index];
+    cq_outstanding = cq_outstanding_;
+    __sync_fetch_and_add(qp_depth, 1);
+    __sync_fetch_and_add(cq_outstanding, 1);
+    if (ibv_post_send(qp_list_[qp_index], &wr, &bad_wr)) {
+        PLOG(ERROR) << "Failed to post notify to " << peer_nic_path_;
+        __sync_fetch_and_sub(qp_depth, 1);
+        __sync_fetch_and_sub(cq_outstanding, 1);
+        return ERR_ENDPOINT;
+    }
+    return 0;
+}
+
 size_t RdmaEndPoint::getQPNumber() const { return qp_list_.size(); }
 
 std::vector<uint32_t> RdmaEndPoint::qpNum() const {
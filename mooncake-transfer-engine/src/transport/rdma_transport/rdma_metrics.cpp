@@ -0,0 +1,46 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transport/rdma_transport/rdma_metrics.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace mooncake {
+
+std::vector<std::pair<std::string, uint64_t>> readRdmaPortCounters(
+    const std::string &device_name, uint8_t port) {
+    namespace fs = std::filesystem;
+    std::vector<std::pair<std::string, uint64_t>> result;
+    const fs::path port_path = fs::path("/sys/class/infiniband") /
+                               device_name / "ports" / std::to_string(port);
+    for (const char *dir : {"counters", "hw_counters"}) {
+        std::error_code ec;
+        fs::directory_iterator it(port_path / dir, ec);
+        if (ec) continue;
+        for (; it != fs::directory_iterator(); it.increment(ec)) {
+            if (ec) break;
+            if (!it->is_regular_file(ec)) continue;
+            std::ifstream file(it->path());
+            uint64_t value;
+            if (file >> value)
+                result.emplace_back(it->path().filename().string(), value);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}  // namespace mooncake
@@ -18,11 +18,14 @@
 #include <sys/mman.h>
 #include <sys/time.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cstddef>
 #include <future>
 #include <set>
+#include <sstream>
 #include <thread>
 
 #include <dlfcn.h>
@@ -100,6 +103,11 @@ int RdmaTransport::install(std::string &local_server_name,
     metadata_ = meta;
     local_server_name_ = local_server_name;
     local_topology_ = topo;
+    if (globalConfig().rdma_auto_slice) {
+        slice_size_tuner_ = std::make_unique<SliceSizeTuner>(
+            globalConfig().rdma_min_slice_size,
+            globalConfig().rdma_max_slice_size, globalConfig().slice_size);
+    }
 
     auto ret = initializeRdmaResources();
     if (ret) {
@@ -186,17 +194,23 @@ int RdmaTransport::registerLocalMemoryInternal(void *addr, size_t length,
                                                bool force_sequential) {
     (void)remote_accessible;
     BufferDesc buffer_desc;
-    const int kBaseAccessRights = IBV_ACCESS_LOCAL_WRITE |
-                                  IBV_ACCESS_REMOTE_WRITE |
-                                  IBV_ACCESS_REMOTE_READ;
+    const int kBaseAccessRights =
+        IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE |
+        IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_ATOMIC;
 
     static int access_rights = kBaseAccessRights;
     if (MCIbRelaxedOrderingEnabled) {
         access_rights |= IBV_ACCESS_RELAXED_ORDERING;
     }
-    bool do_pre_touch = context_list_.size() > 0 &&
+    // ODP MRs neither pin nor fault in the pages at registration
+    bool use_odp = context_list_.size() > 0;
+    for (auto &context : context_list_) {
+        use_odp = use_odp && context->odpEnabled();
+    }
+    bool do_pre_touch = !use_odp && context_list_.size() > 0 &&
                         std::thread::hardware_concurrency() >= 4 &&
                         length >= (size_t)4 * 1024 * 1024 * 1024;
+    auto pre_touch_start = std::chrono::steady_clock::now();
     if (do_pre_touch) {
         // Parallel Pre-touch the memory to speedup the registration process.
         int ret = preTouchMemory(addr, length);
@@ -266,11 +280,19 @@ int RdmaTransport::registerLocalMemoryInternal(void *addr, size_t length,
                                                               reg_start)
             .count();
 
-    if (globalConfig().trace) {
+    auto pre_touch_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            reg_start - pre_touch_start)
+                            .count();
+
+    // Registering large segments can take seconds, which is worth seeing
+    // at startup even without tracing
+    if (globalConfig().trace || pre_touch_ms + reg_duration_ms >= 1000) {
         LOG(INFO) << "registerMemoryRegion: addr=" << addr
                   << ", length=" << length
                   << ", contexts=" << context_list_.size()
                   << ", parallel=" << (use_parallel_reg ? "true" : "false")
+                  << ", odp=" << (use_odp ? "true" : "false")
+                  << ", pre_touch=" << pre_touch_ms << "ms"
                   << ", duration=" << reg_duration_ms << "ms";
     }
 
@@ -367,6 +389,9 @@ int RdmaTransport::allocateLocalSegmentID() {
         desc->devices.push_back(device_desc);
     }
     desc->topology = *(local_topology_.get());
+    desc->rdma_notify_imm = !context_list_.empty();
+    for (auto &entry : context_list_)
+        if (!entry->notifyEnabled()) desc->rdma_notify_imm = false;
     metadata_->addLocalSegment(LOCAL_SEGMENT_ID, local_server_name_,
                                std::move(desc));
     return 0;
@@ -451,11 +476,15 @@ Status RdmaTransport::submitTransferTask(
         slices_to_post;
     auto local_segment_desc = metadata_->getSegmentDescByID(LOCAL_SEGMENT_ID);
     assert(local_segment_desc.get());
-    const size_t kBlockSize = globalConfig().slice_size;
+    const size_t kDefaultBlockSize = globalConfig().slice_size;
     const int kMaxRetryCount = globalConfig().retry_cnt;
     const size_t kFragmentSize = globalConfig().fragment_limit;
     const size_t kSubmitWatermark =
         globalConfig().max_wr * globalConfig().num_qp_per_ep;
+    const bool kRailSpray = globalConfig().rail_spray;
+    const size_t kMaxSge = globalConfig().max_sge;
+    // Bytes assigned to each device that are not submitted to it yet
+    std::vector<uint64_t> assigned_bytes(context_list_.size(), 0);
     uint64_t nr_slices;
     for (size_t index = 0; index < task_list.size(); ++index) {
         assert(task_list[index]);
@@ -464,32 +493,80 @@ Status RdmaTransport::submitTransferTask(
         assert(task.request);
         auto &request = *task.request;
 
+        // The local range of all blocks, which share a buffer if it is
+        // registered as a whole
+        thread_local std::vector<Block> blocks;
+        blocks.clear();
+        uint64_t source_begin = UINT64_MAX, source_end = 0;
+        request.forEachBlock([&](char *source, uint64_t target, size_t len) {
+            if (!len) return;
+            blocks.push_back(Block{source, target, len});
+            source_begin = std::min(source_begin, (uint64_t)source);
+            source_end = std::max(source_end, (uint64_t)source + len);
+        });
+        if (blocks.empty())
+            source_begin = source_end = (uint64_t)request.source;
+
         auto request_buffer_id = -1, request_device_id = -1;
-        if (selectDevice(local_segment_desc.get(), (uint64_t)request.source,
-                         request.length, request_buffer_id,
+        if (selectDevice(local_segment_desc.get(), source_begin,
+                         source_end - source_begin, request_buffer_id,
                          request_device_id)) {
             request_buffer_id = -1;
             request_device_id = -1;
         }
 
-        for (uint64_t offset = 0; offset < request.length;
-             offset += kBlockSize) {
+        // Rails the slices of this request are sprayed across: the active
+        // devices of the first choice affinity tier of its buffer
+        std::vector<int> rail_list;
+        if (kRailSpray && request_buffer_id >= 0 && request_device_id >= 0) {
+            auto &buffer = local_segment_desc->buffers[request_buffer_id];
+            for (int device_id :
+                 local_segment_desc->topology.firstChoiceDevices(buffer.name)) {
+                if (device_id >= 0 &&
+                    (size_t)device_id < context_list_.size() &&
+                    context_list_[device_id]->active())
+                    rail_list.push_back(device_id);
+            }
+        }
+
+        const size_t block_size =
+            slice_size_tuner_
+                ? slice_size_tuner_->sliceSize(
+                      request.target_id, request.length,
+                      std::max<size_t>(rail_list.size(), 1))
+                : kDefaultBlockSize;
+        thread_local std::vector<SliceSpec> specs;
+        buildSliceSpecs(blocks, block_size, kFragmentSize,
+                        request_buffer_id >= 0 ? kMaxSge : 1, specs);
+        for (size_t spec_index = 0; spec_index < specs.size(); ++spec_index) {
+            auto &spec = specs[spec_index];
             Slice *slice = getSliceCache().allocate();
             assert(slice);
             if (!slice->from_cache) {
                 nr_slices++;
             }
 
-            bool merge_final_slice =
-                request.length - offset <= kBlockSize + kFragmentSize;
-
-            slice->source_addr = (char *)request.source + offset;
-            slice->length =
-                merge_final_slice ? request.length - offset : kBlockSize;
+            slice->source_addr = spec.source;
+            slice->length = spec.length;
+            slice->local_blocks.clear();
+            if (spec.block_count > 1) {
+                for (size_t i = 0; i < spec.block_count; ++i) {
+                    auto &block = blocks[spec.first_block + i];
+                    slice->local_blocks.emplace_back(block.source,
+                                                     block.length);
+                }
+            }
             slice->opcode = request.opcode;
-            slice->rdma.dest_addr = request.target_offset + offset;
+            slice->priority = request.priority;
+            slice->compare_add = request.compare_add;
+            slice->swap = request.swap;
+            slice->rdma.dest_addr = spec.target;
             slice->rdma.retry_cnt = request.advise_retry_cnt;
-            slice->rdma.max_retry_cnt = kMaxRetryCount;
+            // A failed atomic WR may have been executed by the target, so
+            // it is not run again
+            slice->rdma.max_retry_cnt = request.isAtomic()
+                                            ? request.advise_retry_cnt + 1
+                                            : kMaxRetryCount;
             slice->task = &task;
             slice->target_id = request.target_id;
             slice->status = Slice::PENDING;
@@ -504,6 +581,20 @@ Status RdmaTransport::submitTransferTask(
                 buffer_id = request_buffer_id;
                 device_id = request_device_id;
             }
+            if (found_device && rail_list.size() > 1) {
+                // Least loaded rail, rotating the start to break ties
+                uint64_t min_load = UINT64_MAX;
+                for (size_t i = 0; i < rail_list.size(); ++i) {
+                    int rail =
+                        rail_list[(i + spec_index) % rail_list.size()];
+                    uint64_t load = context_list_[rail]->outstandingBytes() +
+                                    assigned_bytes[rail];
+                    if (load < min_load) {
+                        min_load = load;
+                        device_id = rail;
+                    }
+                }
+            }
             while (retry_cnt < kMaxRetryCount && !found_device) {
                 if (selectDevice(local_segment_desc.get(),
                                  (uint64_t)slice->source_addr, slice->length,
@@ -542,6 +633,7 @@ Status RdmaTransport::submitTransferTask(
                 }
                 slice->rdma.source_lkey =
                     local_segment_desc->buffers[buffer_id].lkey[device_id];
+                assigned_bytes[device_id] += slice->length;
                 slices_to_post[context].push_back(slice);
                 task.total_bytes += slice->length;
                 __sync_fetch_and_add(&task.slice_count, 1);
@@ -551,12 +643,9 @@ Status RdmaTransport::submitTransferTask(
                 for (auto &entry : slices_to_post)
                     entry.first->submitPostSend(entry.second);
                 slices_to_post.clear();
+                std::fill(assigned_bytes.begin(), assigned_bytes.end(), 0);
                 nr_slices = 0;
             }
-
-            if (merge_final_slice) {
-                break;
-            }
         }
     }
 
@@ -613,11 +702,261 @@ Status RdmaTransport::getTransferStatus(BatchID batch_id, size_t task_id,
     return Status::OK();
 }
 
+std::vector<std::pair<std::string, uint64_t>>
+RdmaTransport::getDeviceTransferredBytes() const {
+    std::vector<std::pair<std::string, uint64_t>> result;
+    for (auto &context : context_list_)
+        result.emplace_back(context->deviceName(), context->transferredBytes());
+    return result;
+}
+
+std::shared_ptr<RdmaContext> RdmaTransport::getContext(
+    const std::string &device_name) const {
+    for (auto &context : context_list_)
+        if (context->deviceName() == device_name) return context;
+    return nullptr;
+}
+
+std::string RdmaTransport::getPrometheusMetrics() const {
+    std::ostringstream out;
+    auto family = [&](const char *name, const char *type, const char *help) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " " << type << "\n";
+    };
+    auto labels = [](const std::shared_ptr<RdmaContext> &context) {
+        return "device=\"" + context->deviceName() + "\",port=\"" +
+               std::to_string(context->portNum()) + "\"";
+    };
+    auto each_device = [&](const char *name, auto value) {
+        for (auto &context : context_list_)
+            out << name << "{" << labels(context) << "} " << value(*context)
+                << "\n";
+    };
+
+    family("mooncake_rdma_transferred_bytes_total", "counter",
+           "Bytes the device transferred successfully");
+    each_device("mooncake_rdma_transferred_bytes_total",
+                [](RdmaContext &c) { return c.transferredBytes(); });
+    family("mooncake_rdma_outstanding_bytes", "gauge",
+           "Bytes submitted to the device and still in flight");
+    each_device("mooncake_rdma_outstanding_bytes",
+                [](RdmaContext &c) { return c.outstandingBytes(); });
+    family("mooncake_rdma_outstanding_work_requests", "gauge",
+           "Work requests posted and not completed yet");
+    each_device("mooncake_rdma_outstanding_work_requests",
+                [](RdmaContext &c) { return c.outstandingWorkRequests(); });
+    family("mooncake_rdma_qps", "gauge", "QPs of the cached endpoints");
+    each_device("mooncake_rdma_qps",
+                [](RdmaContext &c) { return c.getTotalQPNumber(); });
+
+    auto load = [](const std::atomic<uint64_t> &v) {
+        return v.load(std::memory_order_relaxed);
+    };
+    family("mooncake_rdma_post_send_calls_total", "counter",
+           "Calls of ibv_post_send");
+    each_device("mooncake_rdma_post_send_calls_total", [&](RdmaContext &c) {
+        return load(c.counters().post_calls);
+    });
+    family("mooncake_rdma_posted_work_requests_total", "counter",
+           "Work requests passed to ibv_post_send");
+    each_device("mooncake_rdma_posted_work_requests_total",
+                [&](RdmaContext &c) { return load(c.counters().posted_wrs); });
+    family("mooncake_rdma_post_send_failures_total", "counter",
+           "Calls of ibv_post_send that failed");
+    each_device("mooncake_rdma_post_send_failures_total",
+                [&](RdmaContext &c) {
+                    return load(c.counters().post_failures);
+                });
+    family("mooncake_rdma_post_send_seconds_total", "counter",
+           "Time spent in ibv_post_send");
+    each_device("mooncake_rdma_post_send_seconds_total", [&](RdmaContext &c) {
+        return load(c.counters().post_latency_ns) / 1e9;
+    });
+
+    // Batch sizes of the polls that returned completions, as a histogram
+    const auto &bounds = RdmaDeviceCounters::kPollBatchBounds;
+    family("mooncake_rdma_cq_poll_batch_size", "histogram",
+           "Completions returned by each non-empty CQ poll");
+    for (auto &context : context_list_) {
+        auto &counters = context->counters();
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < counters.poll_batch_buckets.size(); ++i) {
+            cumulative += load(counters.poll_batch_buckets[i]);
+            out << "mooncake_rdma_cq_poll_batch_size_bucket{"
+                << labels(context) << ",le=\""
+                << (i < bounds.size() ? std::to_string(bounds[i]) : "+Inf")
+                << "\"} " << cumulative << "\n";
+        }
+        out << "mooncake_rdma_cq_poll_batch_size_sum{" << labels(context)
+            << "} " << load(counters.polled_cqes) << "\n"
+            << "mooncake_rdma_cq_poll_batch_size_count{" << labels(context)
+            << "} " << load(counters.poll_calls) << "\n";
+    }
+
+    const char *kClassNames[] = {"normal", "high"};
+    auto each_class = [&](const char *name, auto value) {
+        for (auto &context : context_list_)
+            for (size_t i = 0; i < RdmaDeviceCounters::kPriorityClasses; ++i)
+                out << name << "{" << labels(context) << ",class=\""
+                    << kClassNames[i] << "\"} " << value(context->counters(), i)
+                    << "\n";
+    };
+    family("mooncake_rdma_class_completed_slices_total", "counter",
+           "Slices completed successfully, by request priority");
+    each_class("mooncake_rdma_class_completed_slices_total",
+               [&](const RdmaDeviceCounters &c, size_t i) {
+                   return load(c.class_slices[i]);
+               });
+    family("mooncake_rdma_class_completed_bytes_total", "counter",
+           "Bytes of the slices completed successfully, by request priority");
+    each_class("mooncake_rdma_class_completed_bytes_total",
+               [&](const RdmaDeviceCounters &c, size_t i) {
+                   return load(c.class_bytes[i]);
+               });
+    family("mooncake_rdma_class_completion_seconds_total", "counter",
+           "Time from posting to completion of the slices completed "
+           "successfully, by request priority");
+    each_class("mooncake_rdma_class_completion_seconds_total",
+               [&](const RdmaDeviceCounters &c, size_t i) {
+                   return load(c.class_latency_ns[i]) / 1e9;
+               });
+
+    family("mooncake_rdma_port_counter", "untyped",
+           "Port counters of the driver under /sys/class/infiniband, in "
+           "their native units");
+    for (auto &context : context_list_)
+        for (auto &[name, value] :
+             readRdmaPortCounters(context->deviceName(), context->portNum()))
+            out << "mooncake_rdma_port_counter{" << labels(context)
+                << ",counter=\"" << name << "\"} " << value << "\n";
+    return out.str();
+}
+
 RdmaTransport::SegmentID RdmaTransport::getSegmentID(
     const std::string &segment_name) {
     return metadata_->getSegmentID(segment_name);
 }
 
+bool RdmaTransport::supportsAtomics() const {
+    for (auto &context : context_list_)
+        if (context->atomicsSupported()) return true;
+    return false;
+}
+
+int RdmaTransport::sendNotify(SegmentID target_id, const NotifyDesc &notify) {
+    auto desc = metadata_->getSegmentDescByID(target_id);
+    if (!desc || !desc->rdma_notify_imm) return ERR_NOT_IMPLEMENTED;
+    std::string payload = notify.name;
+    payload.push_back('\0');
+    payload += notify.notify_msg;
+    // The transfers just completed have connected one of the device pairs
+    for (auto &context : context_list_) {
+        if (!context->active() || !context->notifyEnabled()) continue;
+        for (auto &device : desc->devices) {
+            auto endpoint =
+                context->findEndpoint(MakeNicPath(desc->name, device.name));
+            if (endpoint && !context->postNotify(*endpoint, payload))
+                return 0;
+        }
+    }
+    return ERR_ENDPOINT;
+}
+
+int RdmaTransport::preconnectSegments(
+    const std::vector<SegmentID> &target_ids, bool pin) {
+    if (target_ids.empty()) return 0;
+    const size_t kMaxPreconnectThreads = 16;
+
+    // Fetch all segment descriptors concurrently, so that a cold metadata
+    // cache costs one round trip instead of one per segment
+    std::vector<std::shared_ptr<SegmentDesc>> desc_list(target_ids.size());
+    std::atomic<size_t> next_index(0);
+    auto fetch_desc = [&]() {
+        for (size_t i = next_index++; i < target_ids.size();
+             i = next_index++) {
+            desc_list[i] = metadata_->getSegmentDescByID(target_ids[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    size_t thread_count = std::min(kMaxPreconnectThreads, target_ids.size());
+    for (size_t i = 0; i < thread_count; ++i) threads.emplace_back(fetch_desc);
+    for (auto &thread : threads) thread.join();
+    threads.clear();
+
+    // Same peer NICs the first attempt of selectDevice() picks from
+    std::vector<std::pair<RdmaContext *, std::string>> targets;
+    std::set<std::pair<RdmaContext *, std::string>> seen;
+    int failed_count = 0;
+    for (size_t i = 0; i < target_ids.size(); ++i) {
+        auto &desc = desc_list[i];
+        if (!desc) {
+            LOG(ERROR) << "Cannot get descriptor of segment #"
+                       << target_ids[i];
+            failed_count++;
+            continue;
+        }
+        for (auto &context : context_list_) {
+            if (!context->active()) continue;
+            for (auto &buffer : desc->buffers) {
+                auto devices = desc->topology.firstChoiceDevices(buffer.name);
+                if (globalConfig().enable_dest_device_affinity) {
+                    for (int device_id : devices) {
+                        if (device_id < (int)desc->devices.size() &&
+                            desc->devices[device_id].name ==
+                                context->deviceName()) {
+                            devices = {device_id};
+                            break;
+                        }
+                    }
+                }
+                for (int device_id : devices) {
+                    if (device_id < 0 ||
+                        device_id >= (int)desc->devices.size())
+                        continue;
+                    auto peer_nic_path = MakeNicPath(
+                        desc->name, desc->devices[device_id].name);
+                    if (seen.emplace(context.get(), peer_nic_path).second)
+                        targets.emplace_back(context.get(), peer_nic_path);
+                }
+            }
+        }
+    }
+
+    // Handshakes of different endpoints are independent and each of them
+    // waits for a peer round trip, so run them concurrently
+    std::atomic<int> failed_connect(0);
+    next_index = 0;
+    auto connect = [&]() {
+        for (size_t i = next_index++; i < targets.size(); i = next_index++) {
+            auto &[context, peer_nic_path] = targets[i];
+            auto endpoint = context->endpoint(peer_nic_path);
+            if (!endpoint) {
+                failed_connect++;
+                continue;
+            }
+            if (pin) context->pinEndpoint(peer_nic_path);
+            if (!endpoint->connected() &&
+                endpoint->setupConnectionsByActive()) {
+                LOG(WARNING) << "Failed to pre-connect " << peer_nic_path
+                             << " from " << context->deviceName();
+                failed_connect++;
+            }
+        }
+    };
+    thread_count = std::min(kMaxPreconnectThreads, targets.size());
+    for (size_t i = 0; i < thread_count; ++i) threads.emplace_back(connect);
+    for (auto &thread : threads) thread.join();
+
+    failed_count += failed_connect.load();
+    if (failed_count) {
+        LOG(ERROR) << "RdmaTransport: " << failed_count
+                   << " pre-connections failed out of " << targets.size()
+                   << " endpoints of " << target_ids.size() << " segments";
+        return ERR_ENDPOINT;
+    }
+    return 0;
+}
+
 int RdmaTransport::onSetupRdmaConnections(const HandShakeDesc &peer_desc,
                                           HandShakeDesc &local_desc) {
     auto local_nic_name = getNicNameFromNicPath(peer_desc.peer_nic_path);
@@ -705,6 +1044,41 @@ int RdmaTransport::selectDevice(SegmentDesc *desc, uint64_t offset,
     return ERR_ADDRESS_NOT_REGISTERED;
 }
 
+void RdmaTransport::buildSliceSpecs(const std::vector<Block> &blocks,
+                                    size_t slice_size, size_t fragment_limit,
+                                    size_t max_sge,
+                                    std::vector<SliceSpec> &specs) {
+    specs.clear();
+    for (size_t first = 0; first < blocks.size();) {
+        auto &block = blocks[first];
+        size_t last = first + 1, length = block.length;
+        while (last < blocks.size() && last - first < max_sge &&
+               blocks[last].target ==
+                   blocks[last - 1].target + blocks[last - 1].length &&
+               length + blocks[last].length <= slice_size) {
+            length += blocks[last].length;
+            ++last;
+        }
+        if (last - first > 1) {
+            specs.push_back(SliceSpec{block.source, block.target, length,
+                                      first, last - first});
+            first = last;
+            continue;
+        }
+        for (uint64_t offset = 0; offset < block.length;
+             offset += slice_size) {
+            bool merge_final_slice =
+                block.length - offset <= slice_size + fragment_limit;
+            specs.push_back(SliceSpec{
+                block.source + offset, block.target + offset,
+                merge_final_slice ? block.length - offset : slice_size, first,
+                1});
+            if (merge_final_slice) break;
+        }
+        first = last;
+    }
+}
+
 int RdmaTransport::selectDevice(SegmentDesc *desc, uint64_t offset,
                                 size_t length, int &buffer_id, int &device_id,
                                 int retry_count) {
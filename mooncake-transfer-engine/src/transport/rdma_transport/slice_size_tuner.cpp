@@ -0,0 +1,113 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transport/rdma_transport/slice_size_tuner.h"
+
+#include <algorithm>
+
+namespace mooncake {
+
+static size_t roundDownPowerOfTwo(size_t size) {
+    size_t result = 1;
+    while (result <= size / 2) result *= 2;
+    return result;
+}
+
+SliceSizeTuner::SliceSizeTuner(size_t min_size, size_t max_size,
+                               size_t default_size)
+    : min_size_(min_size),
+      max_size_(std::max(min_size, max_size)),
+      default_size_(default_size) {}
+
+size_t SliceSizeTuner::clamp(size_t size) const {
+    return std::min(max_size_, std::max(min_size_, size));
+}
+
+SliceSizeTuner::PeerEstimate *SliceSizeTuner::findPeer(
+    uint64_t target_id) const {
+    RWSpinlock::ReadGuard guard(peers_lock_);
+    auto iter = peers_.find(target_id);
+    return iter == peers_.end() ? nullptr : iter->second.get();
+}
+
+size_t SliceSizeTuner::peerSliceSize(uint64_t target_id) const {
+    auto peer = findPeer(target_id);
+    if (!peer) return default_size_;
+    size_t size = peer->slice_size.load(std::memory_order_relaxed);
+    return size ? size : default_size_;
+}
+
+size_t SliceSizeTuner::sliceSize(uint64_t target_id, size_t length,
+                                 size_t rail_count) const {
+    size_t size = peerSliceSize(target_id);
+    if (rail_count > 1 && length < size * rail_count) {
+        // One slice per rail, so that a small request uses all of them
+        const size_t kAlignment = 4096;
+        size_t per_rail = (length + rail_count - 1) / rail_count;
+        per_rail = (per_rail + kAlignment - 1) / kAlignment * kAlignment;
+        size = std::max(min_size_, std::min(size, per_rail));
+    }
+    return size;
+}
+
+void SliceSizeTuner::record(uint64_t target_id, uint64_t bytes,
+                            uint64_t posted_ns, uint64_t completed_ns) {
+    if (!posted_ns || completed_ns <= posted_ns) return;
+    auto peer = findPeer(target_id);
+    if (!peer) {
+        RWSpinlock::WriteGuard guard(peers_lock_);
+        auto &entry = peers_[target_id];
+        if (!entry) entry = std::make_unique<PeerEstimate>();
+        peer = entry.get();
+    }
+
+    // The lowest latency seen, drifting up by 1/256 of each larger sample
+    // so that a slower route is eventually followed
+    const uint64_t latency = completed_ns - posted_ns;
+    uint64_t rtt = peer->rtt_ns.load(std::memory_order_relaxed);
+    if (!rtt || latency < rtt)
+        rtt = latency;
+    else
+        rtt += (latency - rtt) / 256;
+    peer->rtt_ns.store(rtt, std::memory_order_relaxed);
+    peer->samples.fetch_add(1, std::memory_order_relaxed);
+
+    peer->window_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    uint64_t start = peer->window_start_ns.load(std::memory_order_relaxed);
+    if (!start) {
+        peer->window_start_ns.compare_exchange_strong(
+            start, posted_ns, std::memory_order_relaxed);
+        return;
+    }
+    // Only the completion that closes the window takes its sample
+    if (completed_ns < start + kWindowNs ||
+        !peer->window_start_ns.compare_exchange_strong(
+            start, completed_ns, std::memory_order_relaxed))
+        return;
+    uint64_t window_bytes =
+        peer->window_bytes.exchange(0, std::memory_order_relaxed);
+    uint64_t sample = window_bytes * 1000 / (completed_ns - start);
+    uint64_t bandwidth = peer->bandwidth.load(std::memory_order_relaxed);
+    bandwidth = std::max(sample, bandwidth - bandwidth / 8);
+    peer->bandwidth.store(bandwidth, std::memory_order_relaxed);
+
+    if (peer->samples.load(std::memory_order_relaxed) < kWarmupSamples ||
+        !bandwidth)
+        return;
+    size_t bdp = bandwidth * rtt / 1000;
+    peer->slice_size.store(clamp(roundDownPowerOfTwo(bdp)),
+                           std::memory_order_relaxed);
+}
+
+}  // namespace mooncake
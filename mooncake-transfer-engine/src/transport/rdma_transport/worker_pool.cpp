@@ -14,8 +14,12 @@
 
 #include "transport/rdma_transport/worker_pool.h"
 
+#include <poll.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
 
 #include "config.h"
@@ -38,10 +42,33 @@ WorkerPool::WorkerPool(RdmaContext &context, int numa_socket_id)
       suspended_flag_(0),
       redispatch_counter_(0),
       submitted_slice_count_(0),
-      processed_slice_count_(0) {
-    for (int i = 0; i < kShardCount; ++i)
+      processed_slice_count_(0),
+      submitted_bytes_(0),
+      processed_bytes_(0),
+      transferred_bytes_(0),
+      cq_waiting_count_(0) {
+    for (int i = 0; i < kShardCount; ++i) {
         slice_queue_count_[i].store(0, std::memory_order_relaxed);
+        urgent_slice_queue_count_[i].store(0, std::memory_order_relaxed);
+    }
     collective_slice_queue_.resize(kTransferWorkerCount);
+    collective_urgent_slice_queue_.resize(kTransferWorkerCount);
+    urgent_rounds_.resize(kTransferWorkerCount, 0);
+    // Notifies arrive while no slice is in flight, so idle workers wait for
+    // CQ events instead of sleeping when they are received
+    if (globalConfig().cq_poll_idle_us || context_.notifyEnabled()) {
+        for (int i = 0; i < kTransferWorkerCount; ++i) {
+            int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (fd < 0) {
+                PLOG(ERROR) << "Worker: Failed to create eventfd, keep busy "
+                               "polling CQs";
+                for (int wake_fd : cq_wake_fd_) close(wake_fd);
+                cq_wake_fd_.clear();
+                break;
+            }
+            cq_wake_fd_.push_back(fd);
+        }
+    }
     for (int i = 0; i < kTransferWorkerCount; ++i)
         worker_thread_.emplace_back(
             std::thread(std::bind(&WorkerPool::transferWorker, this, i)));
@@ -53,8 +80,10 @@ WorkerPool::~WorkerPool() {
     if (workers_running_) {
         cond_var_.notify_all();
         workers_running_.store(false);
+        wakeCqWaiters();
         for (auto &entry : worker_thread_) entry.join();
     }
+    for (int fd : cq_wake_fd_) close(fd);
 }
 
 int WorkerPool::submitPostSend(
@@ -96,7 +125,8 @@ int WorkerPool::submitPostSend(
 #endif  // CONFIG_CACHE_SEGMENT_DESC
 
     SliceList slice_list_map[kShardCount];
-    uint64_t submitted_slice_count = 0;
+    SliceList urgent_slice_list_map[kShardCount];
+    uint64_t submitted_slice_count = 0, submitted_bytes = 0;
     thread_local std::unordered_map<int, uint64_t> failed_target_ids;
     for (auto &slice : slice_list) {
         if (failed_target_ids.count(slice->target_id)) {
@@ -147,47 +177,84 @@ int WorkerPool::submitPostSend(
                         peer_segment_desc->devices[device_id].name);
         slice->peer_nic_path = peer_nic_path;
         int shard_id = (slice->target_id * 10007 + device_id) % kShardCount;
-        slice_list_map[shard_id].push_back(slice);
+        if (slice->priority == Transport::TransferRequest::HIGH)
+            urgent_slice_list_map[shard_id].push_back(slice);
+        else
+            slice_list_map[shard_id].push_back(slice);
         submitted_slice_count++;
+        submitted_bytes += slice->length;
     }
 
     for (int shard_id = 0; shard_id < kShardCount; ++shard_id) {
-        if (slice_list_map[shard_id].empty()) continue;
+        auto &slices = slice_list_map[shard_id];
+        auto &urgent_slices = urgent_slice_list_map[shard_id];
+        if (slices.empty() && urgent_slices.empty()) continue;
         slice_queue_lock_[shard_id].lock();
-        for (auto &slice : slice_list_map[shard_id])
+        for (auto &slice : slices)
             slice_queue_[shard_id][slice->peer_nic_path].push_back(slice);
-        slice_queue_count_[shard_id].fetch_add(slice_list_map[shard_id].size(),
+        for (auto &slice : urgent_slices)
+            urgent_slice_queue_[shard_id][slice->peer_nic_path].push_back(
+                slice);
+        slice_queue_count_[shard_id].fetch_add(slices.size(),
                                                std::memory_order_relaxed);
+        urgent_slice_queue_count_[shard_id].fetch_add(
+            urgent_slices.size(), std::memory_order_relaxed);
         slice_queue_lock_[shard_id].unlock();
     }
 
+    submitted_bytes_.fetch_add(submitted_bytes, std::memory_order_relaxed);
     submitted_slice_count_.fetch_add(submitted_slice_count,
                                      std::memory_order_relaxed);
     if (suspended_flag_.load(std::memory_order_relaxed)) {
         std::lock_guard<std::mutex> lock(cond_mutex_);
         cond_var_.notify_all();
     }
+    if (!cq_wake_fd_.empty()) {
+        // Pairs with the fence of waitCqEvents()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (cq_waiting_count_.load(std::memory_order_relaxed)) wakeCqWaiters();
+    }
 
     return 0;
 }
 
 void WorkerPool::performPostSend(int thread_id) {
     auto &local_slice_queue = collective_slice_queue_[thread_id];
+    auto &local_urgent_slice_queue = collective_urgent_slice_queue_[thread_id];
+    auto drain = [](std::unordered_map<std::string, SliceList> &queue,
+                    std::unordered_map<std::string, SliceList> &local_queue) {
+        for (auto &entry : queue) {
+            for (auto &slice : entry.second)
+                local_queue[entry.first].push_back(slice);
+            entry.second.clear();
+        }
+    };
     for (int shard_id = thread_id; shard_id < kShardCount;
          shard_id += kTransferWorkerCount) {
-        if (slice_queue_count_[shard_id].load(std::memory_order_relaxed) == 0)
+        if (slice_queue_count_[shard_id].load(std::memory_order_relaxed) ==
+                0 &&
+            urgent_slice_queue_count_[shard_id].load(
+                std::memory_order_relaxed) == 0)
             continue;
 
         slice_queue_lock_[shard_id].lock();
-        for (auto &entry : slice_queue_[shard_id]) {
-            for (auto &slice : entry.second)
-                local_slice_queue[entry.first].push_back(slice);
-            entry.second.clear();
-        }
+        drain(slice_queue_[shard_id], local_slice_queue);
+        drain(urgent_slice_queue_[shard_id], local_urgent_slice_queue);
         slice_queue_count_[shard_id].store(0, std::memory_order_relaxed);
+        urgent_slice_queue_count_[shard_id].store(0,
+                                                  std::memory_order_relaxed);
         slice_queue_lock_[shard_id].unlock();
     }
 
+    auto has_slices = [](std::unordered_map<std::string, SliceList> &queue) {
+        for (auto &entry : queue)
+            if (!entry.second.empty()) return true;
+        return false;
+    };
+    if (globalConfig().work_stealing && kTransferWorkerCount > 1 &&
+        !has_slices(local_slice_queue) && !has_slices(local_urgent_slice_queue))
+        stealSlices(thread_id);
+
     // Redispatch slices to other endpoints, for temporary failures
     thread_local int tl_redispatch_counter = 0;
     if (tl_redispatch_counter <
@@ -196,11 +263,34 @@ void WorkerPool::performPostSend(int thread_id) {
             redispatch_counter_.load(std::memory_order_relaxed);
         auto local_slice_queue_clone = local_slice_queue;
         local_slice_queue.clear();
+        for (auto &entry : local_slice_queue_clone)
+            redispatch(entry.second, thread_id);
+        local_slice_queue_clone = local_urgent_slice_queue;
+        local_urgent_slice_queue.clear();
         for (auto &entry : local_slice_queue_clone)
             redispatch(entry.second, thread_id);
         return;
     }
 
+    SliceList failed_slice_list;
+    postSlices(local_urgent_slice_queue, failed_slice_list, true);
+    // Strict priority holds the normal class back while urgent slices wait
+    // for room in their QPs; with a weight it still gets every few rounds
+    const int weight = globalConfig().rdma_priority_weight;
+    if (!has_slices(local_urgent_slice_queue) ||
+        (weight && ++urgent_rounds_[thread_id] >= weight)) {
+        urgent_rounds_[thread_id] = 0;
+        postSlices(local_slice_queue, failed_slice_list, false);
+    }
+
+    if (!failed_slice_list.empty()) {
+        for (auto &slice : failed_slice_list) slice->rdma.retry_cnt++;
+        redispatch(failed_slice_list, thread_id);
+    }
+}
+
+void WorkerPool::postSlices(std::unordered_map<std::string, SliceList> &queue,
+                            SliceList &failed_slice_list, bool urgent) {
 #ifdef CONFIG_CACHE_ENDPOINT
     thread_local uint64_t tl_last_cache_ts = getCurrentTimeInNano();
     thread_local std::unordered_map<std::string, std::shared_ptr<RdmaEndPoint>>
@@ -212,12 +302,26 @@ void WorkerPool::performPostSend(int thread_id) {
     }
 #endif
 
-    SliceList failed_slice_list;
-    for (auto &entry : local_slice_queue) {
+    for (auto &entry : queue) {
+        if (entry.second.empty()) continue;
+        // Posted WRs of a canceled batch run to completion, the rest is
+        // dropped here
+        auto canceled = std::remove_if(entry.second.begin(), entry.second.end(),
+                                       [](Transport::Slice *slice) {
+                                           if (!slice->isCanceled())
+                                               return false;
+                                           slice->markFailed();
+                                           return true;
+                                       });
+        entry.second.erase(canceled, entry.second.end());
         if (entry.second.empty()) continue;
 
 #ifdef USE_FAKE_POST_SEND
-        for (auto &slice : entry.second) slice->markSuccess();
+        for (auto &slice : entry.second) {
+            processed_bytes_ += slice->length;
+            transferred_bytes_ += slice->length;
+            slice->markSuccess();
+        }
         processed_slice_count_.fetch_add(entry.second.size());
         entry.second.clear();
 #else
@@ -257,20 +361,59 @@ void WorkerPool::performPostSend(int thread_id) {
             entry.second.clear();
             continue;
         }
-        endpoint->submitPostSend(entry.second, failed_slice_list);
+        endpoint->submitPostSend(entry.second, failed_slice_list, urgent);
 #endif
     }
+}
 
-    if (!failed_slice_list.empty()) {
-        for (auto &slice : failed_slice_list) slice->rdma.retry_cnt++;
-        redispatch(failed_slice_list, thread_id);
+// Move half of the slices queued in the fullest shard of another worker to
+// the local queue of thread_id. All workers of the pool share the endpoints
+// of context_, so the stolen slices can be posted by this one.
+void WorkerPool::stealSlices(int thread_id) {
+    // A single queued slice is left to its owner
+    int victim_shard_id = -1;
+    uint64_t victim_count = 1;
+    for (int shard_id = 0; shard_id < kShardCount; ++shard_id) {
+        if (shard_id % kTransferWorkerCount == thread_id) continue;
+        auto count =
+            slice_queue_count_[shard_id].load(std::memory_order_relaxed);
+        if (count > victim_count) {
+            victim_shard_id = shard_id;
+            victim_count = count;
+        }
+    }
+    if (victim_shard_id < 0) return;
+
+    auto &local_slice_queue = collective_slice_queue_[thread_id];
+    slice_queue_lock_[victim_shard_id].lock();
+    uint64_t steal_count =
+        slice_queue_count_[victim_shard_id].load(std::memory_order_relaxed) /
+        2;
+    uint64_t stolen_count = 0;
+    for (auto &entry : slice_queue_[victim_shard_id]) {
+        if (stolen_count >= steal_count) break;
+        auto &slices = entry.second;
+        if (slices.empty()) continue;
+        size_t count =
+            std::min<uint64_t>(slices.size(), steal_count - stolen_count);
+        auto &local_slices = local_slice_queue[entry.first];
+        local_slices.insert(local_slices.end(), slices.end() - count,
+                            slices.end());
+        slices.resize(slices.size() - count);
+        stolen_count += count;
     }
+    slice_queue_count_[victim_shard_id].fetch_sub(stolen_count,
+                                                  std::memory_order_relaxed);
+    slice_queue_lock_[victim_shard_id].unlock();
 }
 
-void WorkerPool::performPollCq(int thread_id) {
+int WorkerPool::performPollCq(int thread_id) {
+    int polled_count = 0;
     int processed_slice_count = 0;
+    uint64_t processed_bytes = 0;
     const static size_t kPollCount = 64;
     std::unordered_map<volatile int *, int> qp_depth_set;
+    auto tuner = context_.engine().slice_size_tuner_.get();
     for (int cq_index = thread_id; cq_index < context_.cqCount();
          cq_index += kTransferWorkerCount) {
         ibv_wc wc[kPollCount];
@@ -279,14 +422,30 @@ void WorkerPool::performPollCq(int thread_id) {
             LOG(ERROR) << "Worker: Failed to poll completion queues";
             continue;
         }
+        polled_count += nr_poll;
+        context_.counters().recordPoll(nr_poll);
+        const uint64_t completed_ts = nr_poll ? getCurrentTimeInNano() : 0;
 
+        // Posted WRs are counted, not CQEs, as one CQE may complete several
+        int completed_wr_count = 0;
         for (int i = 0; i < nr_poll; ++i) {
+            if (RdmaContext::isNotifyWorkRequest(wc[i].wr_id)) {
+                context_.completeNotify(wc[i]);
+                continue;
+            }
             Transport::Slice *slice = (Transport::Slice *)wc[i].wr_id;
             assert(slice);
-            if (qp_depth_set.count(slice->rdma.qp_depth))
-                qp_depth_set[slice->rdma.qp_depth]++;
-            else
-                qp_depth_set[slice->rdma.qp_depth] = 1;
+            // Only failed unsignaled WRs have a CQE of their own. They also
+            // fail the later signaled WR of their post, which handles them.
+            if (!slice->rdma.signaled) continue;
+
+            // The slices completed by this CQE, latest first
+            std::vector<Transport::Slice *> group{slice};
+            for (auto prev = slice->rdma.unsignaled_prev; prev;
+                 prev = prev->rdma.unsignaled_prev)
+                group.push_back(prev);
+            qp_depth_set[slice->rdma.qp_depth] += group.size();
+            completed_wr_count += group.size();
             // __sync_fetch_and_sub(slice->rdma.qp_depth, 1);
             if (wc[i].status != IBV_WC_SUCCESS) {
                 bool show_work_request_flushed_error = globalConfig().trace;
@@ -304,6 +463,7 @@ void WorkerPool::performPollCq(int thread_id) {
                         << ", peer_nic: " << slice->peer_nic_path
                         << ", dest_rkey: " << slice->rdma.dest_rkey
                         << ", retry_cnt: " << slice->rdma.retry_cnt
+                        << ", unsignaled: " << group.size() - 1
                         << "): " << ibv_wc_status_str(wc[i].status);
                 failed_nr_polls++;
                 if (context_.active() && failed_nr_polls > 32 &&
@@ -313,33 +473,111 @@ void WorkerPool::performPollCq(int thread_id) {
                     context_.set_active(false);
                 }
                 context_.deleteEndpoint(slice->peer_nic_path);
-                slice->rdma.retry_cnt++;
-                if (slice->rdma.retry_cnt >= slice->rdma.max_retry_cnt) {
-                    slice->markFailed();
-                    processed_slice_count_++;
-                } else {
-                    collective_slice_queue_[thread_id][slice->peer_nic_path]
-                        .push_back(slice);
-                    redispatch_counter_++;
-                    // std::vector<RdmaTransport::Slice *> slice_list { slice };
-                    // redispatch(slice_list, thread_id);
+                // Unsignaled slices may or may not have been transferred,
+                // so the whole group is retried
+                for (auto failed_slice : group) {
+                    failed_slice->rdma.retry_cnt++;
+                    if (failed_slice->rdma.retry_cnt >=
+                        failed_slice->rdma.max_retry_cnt) {
+                        processed_bytes_ += failed_slice->length;
+                        failed_slice->markFailed();
+                        processed_slice_count_++;
+                    } else {
+                        localQueue(thread_id, failed_slice)
+                            [failed_slice->peer_nic_path]
+                                .push_back(failed_slice);
+                        redispatch_counter_++;
+                    }
                 }
             } else {
-                slice->markSuccess();
-                processed_slice_count++;
+                if (tuner) {
+                    // The group was posted together with its signaled WR
+                    uint64_t group_bytes = 0;
+                    for (auto done_slice : group)
+                        group_bytes += done_slice->length;
+                    tuner->record(slice->target_id, group_bytes, slice->ts,
+                                  completed_ts);
+                }
+                for (auto done_slice : group) {
+                    processed_bytes += done_slice->length;
+                    context_.counters().recordCompletion(
+                        done_slice->priority, done_slice->length,
+                        completed_ts - done_slice->ts);
+                    done_slice->markSuccess();
+                }
+                processed_slice_count += group.size();
                 success_nr_polls++;
             }
         }
-        if (nr_poll)
+        if (completed_wr_count)
             __sync_fetch_and_sub(context_.cqOutstandingCount(cq_index),
-                                 nr_poll);
+                                 completed_wr_count);
     }
 
     for (auto &entry : qp_depth_set)
         __sync_fetch_and_sub(entry.first, entry.second);
 
+    if (processed_bytes) {
+        processed_bytes_.fetch_add(processed_bytes);
+        transferred_bytes_.fetch_add(processed_bytes);
+    }
     if (processed_slice_count)
         processed_slice_count_.fetch_add(processed_slice_count);
+    return polled_count;
+}
+
+void WorkerPool::waitCqEvents(int thread_id) {
+    const static int kWaitTimeoutInMs = 10;
+    std::vector<ibv_comp_channel *> channels;
+    std::vector<pollfd> fds;
+    fds.push_back({cq_wake_fd_[thread_id], POLLIN, 0});
+    for (int cq_index = thread_id; cq_index < context_.cqCount();
+         cq_index += kTransferWorkerCount) {
+        auto cq = context_.cq(cq_index);
+        if (ibv_req_notify_cq(cq, 0)) {
+            PLOG(ERROR) << "Worker: Failed to request CQ notification";
+            return;
+        }
+        if (std::find(channels.begin(), channels.end(), cq->channel) ==
+            channels.end()) {
+            channels.push_back(cq->channel);
+            fds.push_back({cq->channel->fd, POLLIN, 0});
+        }
+    }
+
+    auto submitted_slice_count =
+        submitted_slice_count_.load(std::memory_order_relaxed);
+    cq_waiting_count_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Completions that arrived before the CQs were armed raise no event
+    if (submitted_slice_count ==
+            submitted_slice_count_.load(std::memory_order_relaxed) &&
+        !performPollCq(thread_id)) {
+        if (poll(fds.data(), fds.size(), kWaitTimeoutInMs) < 0 &&
+            errno != EINTR)
+            PLOG(ERROR) << "Worker: poll()";
+    }
+    cq_waiting_count_.fetch_sub(1);
+
+    uint64_t value;
+    if (read(cq_wake_fd_[thread_id], &value, sizeof(value)) < 0 &&
+        errno != EAGAIN)
+        PLOG(ERROR) << "Worker: Failed to read eventfd";
+    // Channels may be shared with the CQs of other workers, which re-arm
+    // their CQs in their own next wait
+    for (auto channel : channels) {
+        ibv_cq *event_cq;
+        void *event_cq_context;
+        while (!ibv_get_cq_event(channel, &event_cq, &event_cq_context))
+            ibv_ack_cq_events(event_cq, 1);
+    }
+}
+
+void WorkerPool::wakeCqWaiters() {
+    uint64_t value = 1;
+    for (int fd : cq_wake_fd_)
+        if (write(fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+            PLOG(ERROR) << "Worker: Failed to write eventfd";
 }
 
 void WorkerPool::redispatch(std::vector<Transport::Slice *> &slice_list,
@@ -356,6 +594,7 @@ void WorkerPool::redispatch(std::vector<Transport::Slice *> &slice_list,
 
     for (auto &slice : slice_list) {
         if (slice->rdma.retry_cnt >= slice->rdma.max_retry_cnt) {
+            processed_bytes_ += slice->length;
             slice->markFailed();
             processed_slice_count_++;
         } else {
@@ -366,6 +605,7 @@ void WorkerPool::redispatch(std::vector<Transport::Slice *> &slice_list,
                                             slice->rdma.dest_addr,
                                             slice->length, buffer_id, device_id,
                                             slice->rdma.retry_cnt)) {
+                processed_bytes_ += slice->length;
                 slice->markFailed();
                 processed_slice_count_++;
                 continue;
@@ -376,21 +616,37 @@ void WorkerPool::redispatch(std::vector<Transport::Slice *> &slice_list,
                 MakeNicPath(peer_segment_desc->name,
                             peer_segment_desc->devices[device_id].name);
             slice->peer_nic_path = peer_nic_path;
-            collective_slice_queue_[thread_id][peer_nic_path].push_back(slice);
+            localQueue(thread_id, slice)[peer_nic_path].push_back(slice);
         }
     }
 }
 
+std::unordered_map<std::string, WorkerPool::SliceList> &
+WorkerPool::localQueue(int thread_id, Transport::Slice *slice) {
+    if (slice->priority == Transport::TransferRequest::HIGH)
+        return collective_urgent_slice_queue_[thread_id];
+    return collective_slice_queue_[thread_id];
+}
+
 void WorkerPool::transferWorker(int thread_id) {
     bindToSocket(numa_socket_id_);
-    const static uint64_t kWaitPeriodInNano = 100000000;  // 100ms
+    const uint64_t kCqPollIdleInNano =
+        cq_wake_fd_.empty() ? 0 : globalConfig().cq_poll_idle_us * 1000;
+    const uint64_t kWaitPeriodInNano =
+        kCqPollIdleInNano ? std::min<uint64_t>(kCqPollIdleInNano, 100000000)
+                          : 100000000;  // 100ms
     uint64_t last_wait_ts = getCurrentTimeInNano();
+    uint64_t last_completion_ts = last_wait_ts;
     while (workers_running_.load(std::memory_order_relaxed)) {
         auto processed_slice_count =
             processed_slice_count_.load(std::memory_order_relaxed);
         auto submitted_slice_count =
             submitted_slice_count_.load(std::memory_order_relaxed);
         if (processed_slice_count == submitted_slice_count) {
+            if (context_.notifyEnabled() && !cq_wake_fd_.empty()) {
+                waitCqEvents(thread_id);
+                continue;
+            }
             uint64_t curr_wait_ts = getCurrentTimeInNano();
             if (curr_wait_ts - last_wait_ts > kWaitPeriodInNano) {
                 std::unique_lock<std::mutex> lock(cond_mutex_);
@@ -408,7 +664,16 @@ void WorkerPool::transferWorker(int thread_id) {
         }
         performPostSend(thread_id);
 #ifndef USE_FAKE_POST_SEND
-        performPollCq(thread_id);
+        int polled_count = performPollCq(thread_id);
+        if (kCqPollIdleInNano) {
+            uint64_t curr_ts = getCurrentTimeInNano();
+            if (polled_count) {
+                last_completion_ts = curr_ts;
+            } else if (curr_ts - last_completion_ts > kCqPollIdleInNano) {
+                waitCqEvents(thread_id);
+                last_completion_ts = getCurrentTimeInNano();
+            }
+        }
 #endif
     }
 }
@@ -1,5 +1,10 @@
 #include "transport/rpc_communicator/rpc_communicator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <thread>
 #include <functional>
 #include <glog/logging.h>
@@ -11,10 +16,83 @@
 #include <pybind11/pytypes.h>
 #include "async_simple/coro/SyncAwait.h"
 #include "default_config.h"
+#include "transfer_engine.h"
+#include "transfer_engine_coro.h"
 
 namespace mooncake {
 namespace py = pybind11;
 
+// First-fit allocator over a buffer registered with the transfer engine
+class StagingBuffer {
+   public:
+    StagingBuffer(TransferEngine* engine, size_t size)
+        : engine_(engine), size_(alignUp(size)) {}
+
+    ~StagingBuffer() {
+        if (!base_) return;
+        engine_->unregisterLocalMemory(base_);
+        free(base_);
+    }
+
+    bool init() {
+        base_ = static_cast<char*>(aligned_alloc(kAlignment, size_));
+        if (!base_) return false;
+        if (engine_->registerLocalMemory(base_, size_, kWildcardLocation)) {
+            free(base_);
+            base_ = nullptr;
+            return false;
+        }
+        free_list_[0] = size_;
+        return true;
+    }
+
+    char* allocate(size_t length) {
+        length = alignUp(length);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = free_list_.begin(); it != free_list_.end(); ++it) {
+            if (it->second < length) continue;
+            size_t offset = it->first;
+            size_t remaining = it->second - length;
+            free_list_.erase(it);
+            if (remaining) free_list_[offset + length] = remaining;
+            return base_ + offset;
+        }
+        return nullptr;
+    }
+
+    void deallocate(char* ptr, size_t length) {
+        length = alignUp(length);
+        size_t offset = ptr - base_;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto next = free_list_.lower_bound(offset);
+        if (next != free_list_.end() && offset + length == next->first) {
+            length += next->second;
+            next = free_list_.erase(next);
+        }
+        if (next != free_list_.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += length;
+                return;
+            }
+        }
+        free_list_[offset] = length;
+    }
+
+   private:
+    static constexpr size_t kAlignment = 4096;
+
+    static size_t alignUp(size_t length) {
+        return (length + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    TransferEngine* const engine_;
+    const size_t size_;
+    char* base_ = nullptr;
+    std::mutex mutex_;
+    std::map<size_t, size_t> free_list_;  // offset -> length
+};
+
 class py_rpc_context {
    public:
     void response_msg(py::buffer msg, py::object done) {
@@ -90,7 +168,8 @@ bool RpcCommunicator::initialize(const RpcCommunicatorConfig& config) {
         }
 
         server_->register_handler<&RpcCommunicator::handleDataTransfer,
-                                  &RpcCommunicator::handleTensorTransfer>(this);
+                                  &RpcCommunicator::handleTensorTransfer,
+                                  &RpcCommunicator::handleTensorPull>(this);
     }
     LOG(INFO) << "Environment variable MC_RPC_PROTOCOL is set to "
               << (value ? value : "not set");
@@ -104,6 +183,69 @@ bool RpcCommunicator::initialize(const RpcCommunicatorConfig& config) {
     return true;
 }
 
+bool RpcCommunicator::enableTransferEngine(TransferEngine* engine,
+                                           const std::string& segment_name,
+                                           size_t staging_size,
+                                           size_t threshold) {
+    if (!engine || !engine->getMetadata()) {
+        LOG(ERROR) << "Transfer engine is not initialized";
+        return false;
+    }
+    auto staging = std::make_unique<StagingBuffer>(engine, staging_size);
+    if (!staging->init()) {
+        LOG(ERROR) << "Failed to register a staging buffer of "
+                   << staging_size << " bytes";
+        return false;
+    }
+    engine_ = engine;
+    segment_name_ =
+        segment_name.empty() ? engine->getLocalIpAndPort() : segment_name;
+    zero_copy_threshold_ = std::max<size_t>(threshold, 1);
+    staging_ = std::move(staging);
+    LOG(INFO) << "Payloads of at least " << threshold
+              << " bytes go through the transfer engine as segment "
+              << segment_name_;
+    return true;
+}
+
+bool RpcCommunicator::isRegistered(const void* data, size_t data_size) {
+    auto desc = engine_->getMetadata()->getSegmentDescByID(LOCAL_SEGMENT_ID);
+    if (!desc) return false;
+    auto addr = reinterpret_cast<uint64_t>(data);
+    for (auto& buffer : desc->buffers) {
+        if (addr >= buffer.addr &&
+            addr + data_size <= buffer.addr + buffer.length)
+            return true;
+    }
+    return false;
+}
+
+async_simple::coro::Lazy<int> RpcCommunicator::sendThroughEngineAsync(
+    const std::string& target_address, const void* data, size_t data_size) {
+    char* staged = nullptr;
+    if (!isRegistered(data, data_size)) {
+        staged = staging_->allocate(data_size);
+        if (!staged) co_return -1;
+        memcpy(staged, data, data_size);
+    }
+    TensorDescriptor desc;
+    desc.segment_name = segment_name_;
+    desc.addr = reinterpret_cast<uint64_t>(staged ? staged : data);
+    desc.length = data_size;
+
+    int code = -1;
+    co_await client_pools_->send_request(
+        target_address,
+        [&desc, &code](coro_rpc::coro_rpc_client& client)
+            -> async_simple::coro::Lazy<void> {
+            auto result =
+                co_await client.call<&RpcCommunicator::handleTensorPull>(desc);
+            if (result.has_value()) code = result.value();
+        });
+    if (staged) staging_->deallocate(staged, data_size);
+    co_return code;
+}
+
 bool RpcCommunicator::startServerImpl(bool is_async) {
     if (is_async) {
         return this->startServerAsync();
@@ -168,6 +310,12 @@ int RpcCommunicator::sendData(const std::string& target_address,
 
 async_simple::coro::Lazy<RpcResult> RpcCommunicator::sendDataAsync(
     const std::string& target_address, const void* data, size_t data_size) {
+    if (engine_ && data_size >= zero_copy_threshold_) {
+        int code =
+            co_await sendThroughEngineAsync(target_address, data, data_size);
+        if (code == 0) co_return RpcResult{};
+    }
+
     std::string_view data_view(static_cast<const char*>(data), data_size);
 
     // For large data, use attachment to avoid copying
@@ -289,6 +437,12 @@ int RpcCommunicator::sendTensor(const std::string& target_address,
 
 async_simple::coro::Lazy<int> RpcCommunicator::sendTensorAsync(
     const std::string& target_address, const TensorInfo& tensor) {
+    if (engine_ && tensor.total_bytes >= zero_copy_threshold_) {
+        int code = co_await sendThroughEngineAsync(
+            target_address, tensor.data_ptr, tensor.total_bytes);
+        if (code == 0) co_return 0;
+    }
+
     auto rpc_result = co_await client_pools_->send_request(
         target_address,
         [tensor](coro_rpc::coro_rpc_client& client)
@@ -387,6 +541,42 @@ void RpcCommunicator::handleTensorTransfer(coro_rpc::context<void> context) {
     context.response_msg();
 }
 
+async_simple::coro::Lazy<int> RpcCommunicator::handleTensorPull(
+    TensorDescriptor desc) {
+    if (!engine_ || !desc.length) co_return -1;
+    char* buffer = staging_->allocate(desc.length);
+    if (!buffer) {
+        LOG(WARNING) << "Staging buffer is full, " << desc.length
+                     << " bytes are sent as an attachment";
+        co_return -1;
+    }
+    auto segment_id = engine_->openSegment(desc.segment_name);
+    if (segment_id < 0) {
+        staging_->deallocate(buffer, desc.length);
+        co_return -1;
+    }
+    std::vector<TransferRequest> requests(1);
+    requests[0].opcode = TransferRequest::READ;
+    requests[0].source = buffer;
+    requests[0].target_id = segment_id;
+    requests[0].target_offset = desc.addr;
+    requests[0].length = desc.length;
+    auto status = co_await transferAsync(*engine_, std::move(requests));
+    if (!status.ok()) {
+        LOG(WARNING) << "Failed to read " << desc.length << " bytes from "
+                     << desc.segment_name << ": " << status.ToString();
+        staging_->deallocate(buffer, desc.length);
+        co_return -1;
+    }
+    if (data_receive_callback_) {
+        data_receive_callback_("", std::string_view(buffer, desc.length));
+    } else {
+        LOG(INFO) << "No data receive callback set!";
+    }
+    staging_->deallocate(buffer, desc.length);
+    co_return 0;
+}
+
 void RpcCommunicator::handleDataTransferWithAttachment(
     coro_rpc::context<void> context, std::string_view data) {
     py_rpc_context t{};
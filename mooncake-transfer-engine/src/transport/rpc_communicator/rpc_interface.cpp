@@ -362,6 +362,17 @@ pybind11::object RpcInterface::sendTensorAsync(
     return future_obj;
 }
 
+bool RpcInterface::enableTransferEngine(uintptr_t engine_ptr,
+                                        const std::string& segment_name,
+                                        size_t staging_size,
+                                        size_t threshold) {
+    if (!impl_->communicator) return false;
+    pybind11::gil_scoped_release release;
+    return impl_->communicator->enableTransferEngine(
+        reinterpret_cast<TransferEngine*>(engine_ptr), segment_name,
+        staging_size, threshold);
+}
+
 void RpcInterface::setDataReceiveCallback(pybind11::function callback) {
     pybind11::gil_scoped_acquire acquire;
     impl_->data_receive_callback = callback;
@@ -575,6 +586,10 @@ void bind_rpc_interface(pybind11::module_& m) {
              py::arg("target_address"), py::arg("tensor"))
         .def("send_tensor_async", &RpcInterface::sendTensorAsync,
              py::arg("target_address"), py::arg("tensor"), py::arg("loop"))
+        .def("enable_transfer_engine", &RpcInterface::enableTransferEngine,
+             py::arg("engine_ptr"), py::arg("segment_name") = "",
+             py::arg("staging_buffer_size") = 256ull << 20,
+             py::arg("zero_copy_threshold") = 1ull << 20)
         .def("set_data_receive_callback", &RpcInterface::setDataReceiveCallback)
         .def("set_tensor_receive_callback",
              &RpcInterface::setTensorReceiveCallback);
@@ -16,16 +16,22 @@
 
 #include <bits/stdint-uintn.h>
 #include <glog/logging.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <asio/ip/v6_only.hpp>
+#include <asio/steady_timer.hpp>
 
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <random>
 
 #include "common.h"
+#include "config.h"
 #include "transfer_engine.h"
 #include "transfer_metadata.h"
 #include "transfer_metadata_plugin.h"
@@ -36,6 +42,10 @@
 namespace mooncake {
 using tcpsocket = asio::ip::tcp::socket;
 const static size_t kDefaultBufferSize = 65536;
+// Smaller sends cost more to pin and notify than to copy
+const static size_t kZeroCopyMinSize = 65536;
+const static size_t kZeroCopyChunkSize = 1048576;
+const static int kZeroCopyPollIntervalUs = 50;
 
 struct SessionHeader {
     uint64_t size;
@@ -43,6 +53,11 @@ struct SessionHeader {
     uint8_t opcode;
 };
 
+static bool isAtomicOpcode(uint8_t opcode) {
+    return opcode == (uint8_t)TransferRequest::FETCH_ADD ||
+           opcode == (uint8_t)TransferRequest::COMPARE_SWAP;
+}
+
 #if defined(USE_CUDA) || defined(USE_MUSA) || defined(USE_HIP)
 static bool isCudaMemory(void *addr) {
     cudaPointerAttributes attributes;
@@ -53,8 +68,23 @@ static bool isCudaMemory(void *addr) {
 }
 #endif
 
+static bool isHostMemory(void *addr) {
+#if defined(USE_CUDA) || defined(USE_MUSA) || defined(USE_HIP)
+    return !isCudaMemory(addr);
+#else
+    return true;
+#endif
+}
+
 struct Session : public std::enable_shared_from_this<Session> {
-    explicit Session(tcpsocket socket) : socket_(std::move(socket)) {}
+    explicit Session(tcpsocket socket)
+        : socket_(std::move(socket)), zerocopy_timer_(socket_.get_executor()) {
+        if (globalConfig().tcp_zerocopy) {
+            int one = 1;
+            zerocopy_ = setsockopt(socket_.native_handle(), SOL_SOCKET,
+                                   SO_ZEROCOPY, &one, sizeof(one)) == 0;
+        }
+    }
 
     tcpsocket socket_;
     SessionHeader header_;
@@ -62,25 +92,61 @@ struct Session : public std::enable_shared_from_this<Session> {
     char *local_buffer_;
     std::function<void(TransferStatusEnum)> on_finalize_;
     std::mutex session_mutex_;
+    bool accepted_ = false;
+
+    // Atomic requests send compare_add and swap after the header, and the
+    // peer replies with the previous value; all little endian
+    uint64_t operands_[2];
+    uint64_t result_;
+    bool operands_sent_ = false;
+
+    // MSG_ZEROCOPY sends issued, and those whose pages the kernel released
+    bool zerocopy_ = false;
+    uint32_t zerocopy_sent_ = 0;
+    uint32_t zerocopy_done_ = 0;
+    asio::steady_timer zerocopy_timer_;
 
     void initiate(void *buffer, uint64_t dest_addr, size_t size,
-                  TransferRequest::OpCode opcode) {
+                  TransferRequest::OpCode opcode,
+                  std::function<void(TransferStatusEnum)> on_finalize,
+                  uint64_t compare_add = 0, uint64_t swap = 0) {
         session_mutex_.lock();
+        on_finalize_ = std::move(on_finalize);
         local_buffer_ = (char *)buffer;
         header_.addr = htole64(dest_addr);
         header_.size = htole64(size);
         header_.opcode = (uint8_t)opcode;
+        operands_[0] = htole64(compare_add);
+        operands_[1] = htole64(swap);
+        operands_sent_ = false;
         total_transferred_bytes_ = 0;
         writeHeader();
     }
 
     void onAccept() {
         session_mutex_.lock();
+        accepted_ = true;
         total_transferred_bytes_ = 0;
         readHeader();
     }
 
+    // Whether an idle connection can carry another request, i.e. the peer
+    // has neither closed it nor sent anything unsolicited
+    bool reusable() {
+        char byte;
+        int ret = ::recv(socket_.native_handle(), &byte, 1,
+                         MSG_PEEK | MSG_DONTWAIT);
+        return ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
    private:
+    void finalize(TransferStatusEnum status) {
+        if (on_finalize_) on_finalize_(status);
+        session_mutex_.unlock();
+        // Peers reusing their connections send the next header on it
+        if (accepted_ && status == TransferStatusEnum::COMPLETED) onAccept();
+    }
+
     void writeHeader() {
         // LOG(INFO) << "writeHeader";
         auto self(shared_from_this());
@@ -92,37 +158,140 @@ struct Session : public std::enable_shared_from_this<Session> {
                                << ec.message() << " (value: " << ec.value()
                                << ")" << ", bytes written: " << len
                                << ", expected: " << sizeof(SessionHeader);
-                    if (on_finalize_) on_finalize_(TransferStatusEnum::FAILED);
-                    session_mutex_.unlock();
+                    finalize(TransferStatusEnum::FAILED);
                     return;
                 }
                 if (header_.opcode == (uint8_t)TransferRequest::WRITE)
                     writeBody();
+                else if (isAtomicOpcode(header_.opcode))
+                    writeOperands();
                 else
                     readBody();
             });
     }
 
+    void writeOperands() {
+        auto self(shared_from_this());
+        asio::async_write(
+            socket_, asio::buffer(operands_, sizeof(operands_)),
+            [this, self](const asio::error_code &ec, std::size_t len) {
+                if (ec || len != sizeof(operands_)) {
+                    LOG(ERROR) << "Session::writeOperands failed. Error: "
+                               << ec.message();
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
+                operands_sent_ = true;
+                readResult();
+            });
+    }
+
+    void readResult() {
+        auto self(shared_from_this());
+        asio::async_read(
+            socket_, asio::buffer(&result_, sizeof(result_)),
+            [this, self](const asio::error_code &ec, std::size_t len) {
+                if (ec || len != sizeof(result_)) {
+                    LOG(ERROR) << "Session::readResult failed. Error: "
+                               << ec.message();
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
+                uint64_t value = le64toh(result_);
+#if defined(USE_CUDA) || defined(USE_MUSA) || defined(USE_HIP)
+                if (isCudaMemory(local_buffer_)) {
+                    if (cudaMemcpy(local_buffer_, &value, sizeof(value),
+                                   cudaMemcpyDefault) != cudaSuccess) {
+                        finalize(TransferStatusEnum::FAILED);
+                        return;
+                    }
+                    finalize(TransferStatusEnum::COMPLETED);
+                    return;
+                }
+#endif
+                memcpy(local_buffer_, &value, sizeof(value));
+                finalize(TransferStatusEnum::COMPLETED);
+            });
+    }
+
+    // Runs the atomic request of a peer on the local memory it targets
+    void readOperands() {
+        auto self(shared_from_this());
+        asio::async_read(
+            socket_, asio::buffer(operands_, sizeof(operands_)),
+            [this, self](const asio::error_code &ec, std::size_t len) {
+                if (ec || len != sizeof(operands_)) {
+                    LOG(ERROR) << "Session::readOperands failed. Error: "
+                               << ec.message();
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
+                auto target = (uint64_t *)local_buffer_;
+                if ((uintptr_t)target % sizeof(uint64_t) ||
+                    !isHostMemory(target)) {
+                    LOG(ERROR) << "Session::readOperands cannot run atomics "
+                                  "on "
+                               << (void *)target;
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
+                uint64_t compare_add = le64toh(operands_[0]);
+                uint64_t value;
+                if (header_.opcode == (uint8_t)TransferRequest::FETCH_ADD) {
+                    value = __atomic_fetch_add(target, compare_add,
+                                               __ATOMIC_SEQ_CST);
+                } else {
+                    value = compare_add;
+                    __atomic_compare_exchange_n(
+                        target, &value, le64toh(operands_[1]), false,
+                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+                }
+                result_ = htole64(value);
+                writeResult();
+            });
+    }
+
+    void writeResult() {
+        auto self(shared_from_this());
+        asio::async_write(
+            socket_, asio::buffer(&result_, sizeof(result_)),
+            [this, self](const asio::error_code &ec, std::size_t len) {
+                if (ec || len != sizeof(result_)) {
+                    LOG(ERROR) << "Session::writeResult failed. Error: "
+                               << ec.message();
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
+                finalize(TransferStatusEnum::COMPLETED);
+            });
+    }
+
     void readHeader() {
         // LOG(INFO) << "readHeader";
         auto self(shared_from_this());
         asio::async_read(
             socket_, asio::buffer(&header_, sizeof(SessionHeader)),
             [this, self](const asio::error_code &ec, std::size_t len) {
+                // The peer closes its connection between requests
+                if (ec == asio::error::eof && len == 0) {
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
                 if (ec || len != sizeof(SessionHeader)) {
                     LOG(ERROR)
                         << "Session::readHeader failed. Error: " << ec.message()
                         << " (value: " << ec.value() << ")"
                         << ", bytes read: " << len
                         << ", expected: " << sizeof(SessionHeader);
-                    if (on_finalize_) on_finalize_(TransferStatusEnum::FAILED);
-                    session_mutex_.unlock();
+                    finalize(TransferStatusEnum::FAILED);
                     return;
                 }
 
                 local_buffer_ = (char *)(le64toh(header_.addr));
                 if (header_.opcode == (uint8_t)TransferRequest::WRITE)
                     readBody();
+                else if (isAtomicOpcode(header_.opcode))
+                    readOperands();
                 else
                     writeBody();
             });
@@ -137,13 +306,18 @@ struct Session : public std::enable_shared_from_this<Session> {
         size_t buffer_size =
             std::min(kDefaultBufferSize, size - total_transferred_bytes_);
         if (buffer_size == 0) {
-            if (on_finalize_) on_finalize_(TransferStatusEnum::COMPLETED);
-            session_mutex_.unlock();
+            waitZeroCopy();
             return;
         }
 
         char *dram_buffer = addr + total_transferred_bytes_;
 
+        if (zerocopy_ && buffer_size >= kZeroCopyMinSize &&
+            isHostMemory(addr)) {
+            writeBodyZeroCopy();
+            return;
+        }
+
 #if defined(USE_CUDA) || defined(USE_MUSA) || defined(USE_HIP)
         if (isCudaMemory(addr)) {
             dram_buffer = new char[buffer_size];
@@ -154,8 +328,7 @@ struct Session : public std::enable_shared_from_this<Session> {
                 LOG(ERROR)
                     << "Session::writeBody failed to copy from CUDA memory. "
                     << "Error: " << cudaGetErrorString(cuda_status);
-                if (on_finalize_) on_finalize_(TransferStatusEnum::FAILED);
-                session_mutex_.unlock();
+                finalize(TransferStatusEnum::FAILED);
                 delete[] dram_buffer;
                 return;
             }
@@ -181,15 +354,123 @@ struct Session : public std::enable_shared_from_this<Session> {
                         << ", total_transferred_bytes_: "
                         << total_transferred_bytes_
                         << ", current transferred_bytes: " << transferred_bytes;
-                    if (on_finalize_) on_finalize_(TransferStatusEnum::FAILED);
-                    session_mutex_.unlock();
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
+                total_transferred_bytes_ += transferred_bytes;
+                writeBody();
+            });
+    }
+
+    // Sends the next piece of the body without copying it to the socket
+    // buffer. The pages stay referenced by the kernel until the peer
+    // acknowledges them, which reapZeroCopy() learns from the error queue.
+    void writeBodyZeroCopy() {
+        auto self(shared_from_this());
+        uint64_t size = le64toh(header_.size);
+        char *buffer = local_buffer_ + total_transferred_bytes_;
+        size_t length =
+            std::min(kZeroCopyChunkSize, size - total_transferred_bytes_);
+        socket_.async_send(
+            asio::buffer(buffer, length), MSG_ZEROCOPY,
+            [this, self, buffer](const asio::error_code &ec,
+                                 std::size_t transferred_bytes) {
+                if (ec == asio::error::no_buffer_space) {
+                    // Out of socket memory to track more pinned pages, so
+                    // copy for the rest of this connection
+                    LOG(WARNING) << "Session::writeBodyZeroCopy falls back "
+                                    "to copying sends";
+                    zerocopy_ = false;
+                    writeBody();
+                    return;
+                }
+                if (ec) {
+                    LOG(ERROR)
+                        << "Session::writeBodyZeroCopy failed. "
+                        << "Attempt to write data "
+                        << static_cast<void *>(buffer)
+                        << ". Error: " << ec.message()
+                        << " (value: " << ec.value() << ")"
+                        << ", total_transferred_bytes_: "
+                        << total_transferred_bytes_;
+                    finalize(TransferStatusEnum::FAILED);
                     return;
                 }
+                zerocopy_sent_++;
                 total_transferred_bytes_ += transferred_bytes;
+                if (!reapZeroCopy()) {
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
                 writeBody();
             });
     }
 
+    // The request may only complete once the kernel no longer references
+    // its buffer. Notifications are polled, as waiting for the socket error
+    // condition can miss those that arrived before the wait was armed.
+    void waitZeroCopy() {
+        if (!reapZeroCopy()) {
+            finalize(TransferStatusEnum::FAILED);
+            return;
+        }
+        if (zerocopy_done_ == zerocopy_sent_) {
+            finalize(TransferStatusEnum::COMPLETED);
+            return;
+        }
+        auto self(shared_from_this());
+        zerocopy_timer_.expires_after(
+            std::chrono::microseconds(kZeroCopyPollIntervalUs));
+        zerocopy_timer_.async_wait(
+            [this, self](const asio::error_code &ec) {
+                if (ec) {
+                    finalize(TransferStatusEnum::FAILED);
+                    return;
+                }
+                waitZeroCopy();
+            });
+    }
+
+    // Consumes the zero copy notifications queued on the socket. Returns
+    // false if the error queue reports a real socket error.
+    bool reapZeroCopy() {
+        if (zerocopy_done_ == zerocopy_sent_) return true;
+        int fd = socket_.native_handle();
+        while (true) {
+            char control[CMSG_SPACE(sizeof(sock_extended_err)) * 4];
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                    return true;
+                PLOG(ERROR) << "Session::reapZeroCopy failed";
+                return false;
+            }
+            for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm;
+                 cm = CMSG_NXTHDR(&msg, cm)) {
+                if (!(cm->cmsg_level == SOL_IP &&
+                      cm->cmsg_type == IP_RECVERR) &&
+                    !(cm->cmsg_level == SOL_IPV6 &&
+                      cm->cmsg_type == IPV6_RECVERR))
+                    continue;
+                auto ee = (sock_extended_err *)CMSG_DATA(cm);
+                if (ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                    if (!ee->ee_errno) continue;
+                    LOG(ERROR) << "Session::reapZeroCopy socket error: "
+                               << strerror(ee->ee_errno);
+                    return false;
+                }
+                // [ee_info, ee_data] is the range of completed sends
+                zerocopy_done_ += ee->ee_data - ee->ee_info + 1;
+                // E.g. loopback peers, where pinning only adds overhead
+                if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                    zerocopy_ = false;
+            }
+        }
+    }
+
     void readBody() {
         // LOG(INFO) << "readBody";
         auto self(shared_from_this());
@@ -199,8 +480,7 @@ struct Session : public std::enable_shared_from_this<Session> {
         size_t buffer_size =
             std::min(kDefaultBufferSize, size - total_transferred_bytes_);
         if (buffer_size == 0) {
-            if (on_finalize_) on_finalize_(TransferStatusEnum::COMPLETED);
-            session_mutex_.unlock();
+            finalize(TransferStatusEnum::COMPLETED);
             return;
         }
 
@@ -229,11 +509,10 @@ struct Session : public std::enable_shared_from_this<Session> {
                         << ", total_transferred_bytes_: "
                         << total_transferred_bytes_
                         << ", current transferred_bytes: " << transferred_bytes;
-                    if (on_finalize_) on_finalize_(TransferStatusEnum::FAILED);
 #if defined(USE_CUDA) || defined(USE_MUSA) || defined(USE_HIP)
                     if (is_cuda_memory) delete[] dram_buffer;
 #endif
-                    session_mutex_.unlock();
+                    finalize(TransferStatusEnum::FAILED);
                     return;
                 }
 
@@ -247,10 +526,8 @@ struct Session : public std::enable_shared_from_this<Session> {
                             << "Session::readBody failed to copy to CUDA "
                                "memory. "
                             << "Error: " << cudaGetErrorString(cuda_status);
-                        if (on_finalize_)
-                            on_finalize_(TransferStatusEnum::FAILED);
                         delete[] dram_buffer;
-                        session_mutex_.unlock();
+                        finalize(TransferStatusEnum::FAILED);
                         return;
                     }
                     delete[] dram_buffer;
@@ -297,8 +574,32 @@ struct TcpContext {
         });
     }
 
+    // Returns an idle connection to peer that is still usable, if any
+    std::shared_ptr<Session> acquireSession(const std::string &peer) {
+        std::lock_guard<std::mutex> lock(idle_sessions_mutex);
+        auto &idle_list = idle_sessions[peer];
+        while (!idle_list.empty()) {
+            auto session = std::move(idle_list.back());
+            idle_list.pop_back();
+            if (session->reusable()) return session;
+        }
+        return nullptr;
+    }
+
+    void releaseSession(const std::string &peer,
+                        std::shared_ptr<Session> session) {
+        std::lock_guard<std::mutex> lock(idle_sessions_mutex);
+        auto &idle_list = idle_sessions[peer];
+        if (idle_list.size() < globalConfig().tcp_conns_per_peer)
+            idle_list.push_back(std::move(session));
+    }
+
     asio::io_context io_context;
     asio::ip::tcp::acceptor acceptor;
+    // Connected sockets idle between requests, keyed by peer address
+    std::mutex idle_sessions_mutex;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Session>>>
+        idle_sessions;
 };
 
 TcpTransport::TcpTransport() : context_(nullptr), running_(false) {
@@ -372,6 +673,7 @@ int TcpTransport::allocateLocalSegmentID(int tcp_data_port) {
     desc->name = local_server_name_;
     desc->protocol = "tcp";
     desc->tcp_data_port = tcp_data_port;
+    desc->tcp_persistent = true;
     metadata_->addLocalSegment(LOCAL_SEGMENT_ID, local_server_name_,
                                std::move(desc));
     return 0;
@@ -450,19 +752,7 @@ Status TcpTransport::submitTransfer(
     for (auto &request : entries) {
         TransferTask &task = batch_desc.task_list[task_id];
         ++task_id;
-        task.total_bytes = request.length;
-        Slice *slice = getSliceCache().allocate();
-        slice->source_addr = (char *)request.source;
-        slice->length = request.length;
-        slice->opcode = request.opcode;
-        slice->tcp.dest_addr = request.target_offset;
-        slice->task = &task;
-        slice->target_id = request.target_id;
-        slice->status = Slice::PENDING;
-        slice->ts = 0;
-        task.slice_list.push_back(slice);
-        __sync_fetch_and_add(&task.slice_count, 1);
-        startTransfer(slice);
+        submitSlices(request, task);
     }
 
     return Status::OK();
@@ -475,21 +765,52 @@ Status TcpTransport::submitTransferTask(
         auto &task = *task_list[index];
         assert(task.request);
         auto &request = *task.request;
-        task.total_bytes = request.length;
+        submitSlices(request, task);
+    }
+    return Status::OK();
+}
+
+void TcpTransport::submitSlices(const TransferRequest &request,
+                                TransferTask &task) {
+    task.total_bytes = request.length;
+    // Stripe large requests so that they are not limited to the throughput
+    // of a single TCP stream
+    auto &config = globalConfig();
+    size_t stripe_count = 1;
+    if (config.tcp_stripe_size && request.length > config.tcp_stripe_size)
+        stripe_count = std::min(
+            config.tcp_conns_per_peer,
+            (request.length + config.tcp_stripe_size - 1) /
+                config.tcp_stripe_size);
+    size_t stripe_size = request.length;
+    if (stripe_count > 1) {
+        const size_t kStripeAlignment = 4096;
+        stripe_size = (request.length + stripe_count - 1) / stripe_count;
+        stripe_size = (stripe_size + kStripeAlignment - 1) /
+                      kStripeAlignment * kStripeAlignment;
+        stripe_count = (request.length + stripe_size - 1) / stripe_size;
+    }
+
+    std::vector<Slice *> slice_list;
+    for (size_t i = 0; i < stripe_count; ++i) {
+        size_t offset = i * stripe_size;
         Slice *slice = getSliceCache().allocate();
-        slice->source_addr = (char *)request.source;
-        slice->length = request.length;
+        slice->source_addr = (char *)request.source + offset;
+        slice->length = std::min(stripe_size, request.length - offset);
         slice->opcode = request.opcode;
-        slice->tcp.dest_addr = request.target_offset;
+        slice->compare_add = request.compare_add;
+        slice->swap = request.swap;
+        slice->tcp.dest_addr = request.target_offset + offset;
         slice->task = &task;
         slice->target_id = request.target_id;
         slice->status = Slice::PENDING;
         slice->ts = 0;
         task.slice_list.push_back(slice);
-        __sync_fetch_and_add(&task.slice_count, 1);
-        startTransfer(slice);
+        slice_list.push_back(slice);
     }
-    return Status::OK();
+    // All stripes are counted before the first one may complete the task
+    __sync_fetch_and_add(&task.slice_count, slice_list.size());
+    for (auto slice : slice_list) startTransfer(slice);
 }
 
 void TcpTransport::worker() {
@@ -505,10 +826,8 @@ void TcpTransport::worker() {
     }
 }
 
-void TcpTransport::startTransfer(Slice *slice) {
+void TcpTransport::startTransfer(Slice *slice, bool reuse) {
     try {
-        asio::ip::tcp::resolver resolver(context_->io_context);
-        asio::ip::tcp::socket socket(context_->io_context);
         auto desc = metadata_->getSegmentDescByID(slice->target_id);
         if (!desc) {
             LOG(ERROR) << "TcpTransport::startTransfer failed to get segment "
@@ -526,18 +845,42 @@ void TcpTransport::startTransfer(Slice *slice) {
             slice->markFailed();
             return;
         }
-        auto endpoint_iterator = resolver.resolve(
-            meta_entry.ip_or_host_name, std::to_string(desc->tcp_data_port));
-        asio::connect(socket, endpoint_iterator);
-        auto session = std::make_shared<Session>(std::move(socket));
-        session->on_finalize_ = [slice](TransferStatusEnum status) {
-            if (status == TransferStatusEnum::COMPLETED)
+        std::string peer = meta_entry.ip_or_host_name + ":" +
+                           std::to_string(desc->tcp_data_port);
+        // Older peers serve one request per connection
+        bool persistent = desc->tcp_persistent;
+        std::shared_ptr<Session> session;
+        if (persistent && reuse) session = context_->acquireSession(peer);
+        bool reused = (session != nullptr);
+        if (!session) {
+            asio::ip::tcp::resolver resolver(context_->io_context);
+            asio::ip::tcp::socket socket(context_->io_context);
+            auto endpoint_iterator =
+                resolver.resolve(meta_entry.ip_or_host_name,
+                                 std::to_string(desc->tcp_data_port));
+            asio::connect(socket, endpoint_iterator);
+            session = std::make_shared<Session>(std::move(socket));
+        }
+        // A raw pointer avoids the session owning itself via its callback
+        Session *raw_session = session.get();
+        auto on_finalize = [this, slice, raw_session, peer, persistent,
+                            reused](TransferStatusEnum status) {
+            if (status == TransferStatusEnum::COMPLETED) {
+                if (persistent)
+                    context_->releaseSession(peer,
+                                             raw_session->shared_from_this());
                 slice->markSuccess();
-            else
+            } else if (reused && !raw_session->operands_sent_) {
+                // The peer may have dropped the idle connection meanwhile.
+                // Atomics it may have run already are not sent again.
+                startTransfer(slice, false);
+            } else {
                 slice->markFailed();
+            }
         };
         session->initiate(slice->source_addr, slice->tcp.dest_addr,
-                          slice->length, slice->opcode);
+                          slice->length, slice->opcode, std::move(on_finalize),
+                          slice->compare_add, slice->swap);
     } catch (std::exception &e) {
         LOG(ERROR) << "TcpTransport::startTransfer encountered an ASIO "
                       "exception. Slice details - source_addr: "
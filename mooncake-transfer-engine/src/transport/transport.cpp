@@ -24,13 +24,14 @@ Transport::ThreadLocalSliceCache &Transport::getSliceCache() {
     return tl_slice_cache;
 }
 
+Transport::ThreadLocalBatchDescPool &Transport::getBatchDescPool() {
+    thread_local static ThreadLocalBatchDescPool tl_batch_desc_pool;
+    return tl_batch_desc_pool;
+}
+
 Transport::BatchID Transport::allocateBatchID(size_t batch_size) {
-    auto batch_desc = new BatchDesc();
+    auto batch_desc = getBatchDescPool().allocate(batch_size);
     if (!batch_desc) return ERR_MEMORY;
-    batch_desc->id = BatchID(batch_desc);
-    batch_desc->batch_size = batch_size;
-    batch_desc->task_list.reserve(batch_size);
-    batch_desc->context = NULL;
 #ifdef CONFIG_USE_BATCH_DESC_SET
     batch_desc_lock_.lock();
     batch_desc_set_[batch_desc->id] = batch_desc;
@@ -49,7 +50,7 @@ Status Transport::freeBatchID(BatchID batch_id) {
                 "BatchID cannot be freed until all tasks are done");
         }
     }
-    delete &batch_desc;
+    getBatchDescPool().deallocate(&batch_desc);
 #ifdef CONFIG_USE_BATCH_DESC_SET
     RWSpinlock::WriteGuard guard(batch_desc_lock_);
     batch_desc_set_.erase(batch_id);
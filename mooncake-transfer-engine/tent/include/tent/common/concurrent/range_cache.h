@@ -0,0 +1,120 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TENT_RANGE_CACHE_H
+#define TENT_RANGE_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mooncake {
+namespace tent {
+
+// Maps disjoint address ranges to a value, for lookups on the data path
+// that must not take locks. Writers copy the sorted entries, change the
+// copy and publish it; readers binary-search whatever copy is published.
+// The copies replaced are kept until the cache is destroyed, as readers
+// may still be searching them, so the cache suits sets that change rarely,
+// such as registered or allocated buffers. For the same reason, the entries
+// returned by find() stay valid as long as the cache.
+template <typename Value>
+class RangeCache {
+   public:
+    struct Entry {
+        uint64_t start;
+        uint64_t length;
+        Value value;
+    };
+
+    RangeCache() : entries_(new Entries()) {}
+
+    ~RangeCache() { delete entries_.load(std::memory_order_relaxed); }
+
+    RangeCache(const RangeCache &) = delete;
+    RangeCache &operator=(const RangeCache &) = delete;
+
+    // The entry holding addr, or nullptr
+    const Entry *find(uint64_t addr) const {
+        const Entries *entries = entries_.load(std::memory_order_acquire);
+        auto it = std::upper_bound(
+            entries->begin(), entries->end(), addr,
+            [](uint64_t addr, const Entry &entry) {
+                return addr < entry.start;
+            });
+        if (it == entries->begin()) return nullptr;
+        --it;
+        return addr - it->start < it->length ? &*it : nullptr;
+    }
+
+    // Replaces the entries overlapping [start, start + length)
+    void insert(uint64_t start, uint64_t length, Value value) {
+        if (!length) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto next = std::make_unique<Entries>();
+        const Entries *entries = entries_.load(std::memory_order_relaxed);
+        next->reserve(entries->size() + 1);
+        for (const auto &entry : *entries) {
+            if (entry.start < start + length &&
+                start < entry.start + entry.length)
+                continue;
+            next->push_back(entry);
+        }
+        auto pos = std::upper_bound(next->begin(), next->end(), start,
+                                    [](uint64_t start, const Entry &entry) {
+                                        return start < entry.start;
+                                    });
+        next->insert(pos, Entry{start, length, std::move(value)});
+        publish(std::move(next));
+    }
+
+    // Removes the entry starting at start, if any
+    void erase(uint64_t start) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Entries *entries = entries_.load(std::memory_order_relaxed);
+        auto it = std::find_if(
+            entries->begin(), entries->end(),
+            [start](const Entry &entry) { return entry.start == start; });
+        if (it == entries->end()) return;
+        auto next = std::make_unique<Entries>();
+        next->reserve(entries->size() - 1);
+        next->insert(next->end(), entries->begin(), it);
+        next->insert(next->end(), it + 1, entries->end());
+        publish(std::move(next));
+    }
+
+    size_t size() const {
+        return entries_.load(std::memory_order_acquire)->size();
+    }
+
+   private:
+    using Entries = std::vector<Entry>;
+
+    void publish(std::unique_ptr<Entries> next) {
+        retired_.emplace_back(
+            entries_.exchange(next.release(), std::memory_order_acq_rel));
+    }
+
+    std::mutex mutex_;  // Serializes writers
+    std::atomic<const Entries *> entries_;
+    std::vector<std::unique_ptr<const Entries>> retired_;
+};
+
+}  // namespace tent
+}  // namespace mooncake
+
+#endif  // TENT_RANGE_CACHE_H
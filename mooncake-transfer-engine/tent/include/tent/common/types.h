@@ -37,13 +37,26 @@ struct Notification {
 #define LOCAL_SEGMENT_ID (0ull)
 #endif
 
+// Names a registered local buffer, so that the transports skip the address
+// lookup of a request source. It is only a hint: once buffers below it are
+// registered or removed the handle goes stale and the lookup is done again.
+struct MemoryHandle {
+    uint64_t addr = 0;
+    uint64_t index = UINT64_MAX;
+};
+
 struct Request {
     enum OpCode { READ, WRITE };
+    // HIGH requests are latency sensitive: RDMA workers post their slices
+    // ahead of NORMAL ones
+    enum Priority { NORMAL, HIGH };
     OpCode opcode;
     void* source;
     SegmentID target_id;
     uint64_t target_offset;
     size_t length;
+    Priority priority = NORMAL;
+    MemoryHandle source_handle;  // optional
 };
 
 enum TransferStatusEnum {
@@ -17,6 +17,8 @@
 
 #include <glog/logging.h>
 #include <numa.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <unistd.h>
@@ -28,7 +30,9 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <thread>
+#include <vector>
 
 #if defined(__x86_64__)
 #include <immintrin.h>
@@ -41,35 +45,59 @@
 
 namespace mooncake {
 namespace tent {
-static inline int bindToSocket(int socket_id) {
-    if (numa_available() < 0) {
-        LOG(WARNING) << "The platform does not support NUMA";
-        return -1;
+// CPUs of a list such as "0-3,8", empty if it cannot be parsed
+static inline std::vector<int> parseCpuList(const std::string &cpu_list) {
+    std::vector<int> cpus;
+    if (numa_available() < 0 || cpu_list.empty()) return cpus;
+    struct bitmask *mask = numa_parse_cpustring_all(cpu_list.c_str());
+    if (!mask) return cpus;
+    int nr_possible_cpus = numa_num_possible_cpus();
+    for (int cpu = 0; cpu < nr_possible_cpus; ++cpu) {
+        if (numa_bitmask_isbitset(mask, cpu)) cpus.push_back(cpu);
     }
-    cpu_set_t cpu_set;
-    CPU_ZERO(&cpu_set);
-    if (socket_id < 0 || socket_id >= numa_num_configured_nodes())
-        socket_id = 0;
+    numa_free_cpumask(mask);
+    return cpus;
+}
+
+// CPUs of a NUMA node that the process may run on
+static inline std::vector<int> getNumaNodeCpus(int node) {
+    std::vector<int> cpus;
+    if (numa_available() < 0) return cpus;
+    if (node < 0 || node >= numa_num_configured_nodes()) node = 0;
     struct bitmask *cpu_list = numa_allocate_cpumask();
-    numa_node_to_cpus(socket_id, cpu_list);
+    numa_node_to_cpus(node, cpu_list);
     int nr_possible_cpus = numa_num_possible_cpus();
-    int nr_cpus = 0;
     for (int cpu = 0; cpu < nr_possible_cpus; ++cpu) {
         if (numa_bitmask_isbitset(cpu_list, cpu) &&
-            numa_bitmask_isbitset(numa_all_cpus_ptr, cpu)) {
-            CPU_SET(cpu, &cpu_set);
-            nr_cpus++;
-        }
+            numa_bitmask_isbitset(numa_all_cpus_ptr, cpu))
+            cpus.push_back(cpu);
     }
     numa_free_cpumask(cpu_list);
-    if (nr_cpus == 0) return 0;
+    return cpus;
+}
+
+static inline int bindToCpus(const std::vector<int> &cpus) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+    }
+    if (CPU_COUNT(&cpu_set) == 0) return 0;
     if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set)) {
-        LOG(ERROR) << "bindToSocket: pthread_setaffinity_np failed";
+        LOG(ERROR) << "bindToCpus: pthread_setaffinity_np failed";
         return -1;
     }
     return 0;
 }
 
+static inline int bindToSocket(int socket_id) {
+    if (numa_available() < 0) {
+        LOG(WARNING) << "The platform does not support NUMA";
+        return -1;
+    }
+    return bindToCpus(getNumaNodeCpus(socket_id));
+}
+
 static inline int64_t getCurrentTimeInNano() {
     const int64_t kNanosPerSecond = 1000 * 1000 * 1000;
     struct timespec ts;
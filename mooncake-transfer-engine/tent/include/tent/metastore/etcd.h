@@ -17,6 +17,7 @@
 
 #include <atomic>
 #include <libetcd_wrapper.h>
+#include <string>
 
 #include "tent/runtime/metastore.h"
 
@@ -38,8 +39,22 @@ class EtcdMetaStore : public MetaStore {
 
     virtual Status remove(const std::string &key);
 
+    // Gets the keys in transactions of up to 128 range requests
+    virtual Status getBatch(const std::vector<std::string> &keys,
+                            std::vector<std::string> &values);
+
+    virtual Status watchPrefix(const std::string &prefix, OnChange callback);
+
+   private:
+    // event_type: 0 for put, 1 for delete, 2 once the watch was broken
+    static void onWatchEvent(void *context, const char *key, size_t key_size,
+                             const char *value, size_t value_size,
+                             int event_type, long long mod_revision);
+
    private:
     std::atomic<bool> connected_;
+    std::string watch_prefix_;
+    OnChange watch_callback_;
 };
 }  // namespace tent
 }  // namespace mooncake
@@ -19,6 +19,10 @@
 #include <hiredis/hiredis.h>
 
 #include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "tent/runtime/metastore.h"
 #include "tent/common/utils/ip.h"
@@ -50,16 +54,43 @@ class RedisMetaStore : public MetaStore {
 
     virtual Status remove(const std::string &key);
 
+    // Gets the keys with one MGET
+    virtual Status getBatch(const std::vector<std::string> &keys,
+                            std::vector<std::string> &values);
+
+    // Subscribes to the keyspace notifications of the keys on a connection
+    // of its own. Fails with NotImplemented unless the server has
+    // notify-keyspace-events enabled for string and generic commands.
+    virtual Status watchPrefix(const std::string &prefix, OnChange callback);
+
    private:
     std::atomic<bool> connected_;
     redisContext *client_;
+    // Guards client_, which redisCommand() must not use concurrently
+    std::mutex client_mutex_;
+
+    std::string hostname_;
+    int port_ = REDIS_DEFAULT_PORT;
+    std::string password_;
+    uint8_t db_index_ = REDIS_DEFAULT_DB_INDEX;
+
+    std::string watch_prefix_;
+    OnChange watch_callback_;
+    std::thread watch_thread_;
+    std::atomic<bool> watch_running_{false};
+    std::mutex watch_mutex_;
+    redisContext *watch_client_ = nullptr;  // guarded by watch_mutex_
+
+    // Opens a connection, authenticated and on the selected database
+    Status openConnection(redisContext *&context);
+
+    void watchWorker();
+
+    void stopWatch();
 
     // Helper function for handling Redis replies
     Status handleRedisReply(redisReply *reply,
                             const std::string &operation) const;
-
-    // Helper function for cleaning up failed connections
-    void cleanupFailedConnection();
 };
 }  // namespace tent
 }  // namespace mooncake
@@ -33,6 +33,9 @@ struct MetricsConfig {
     bool enable_json = true;
     std::vector<double> latency_buckets;
     std::vector<double> size_buckets;
+    // Peers with the most traffic exported with their own latency
+    // histogram, the others are folded into peer="other"
+    uint32_t peer_top_n = 16;
 };
 
 // Helper class to load metrics configuration from various sources
@@ -73,6 +76,7 @@ constexpr const char* METRICS_REPORT_INTERVAL =
     "metrics/report_interval_seconds";
 constexpr const char* METRICS_ENABLE_PROMETHEUS = "metrics/enable_prometheus";
 constexpr const char* METRICS_ENABLE_JSON = "metrics/enable_json";
+constexpr const char* METRICS_PEER_TOP_N = "metrics/peer_top_n";
 
 // Bucket configurations
 constexpr const char* METRICS_LATENCY_BUCKETS = "metrics/latency_buckets";
@@ -92,6 +96,7 @@ constexpr const char* ENV_METRICS_ENABLE_JSON = "TENT_METRICS_ENABLE_JSON";
 constexpr const char* ENV_METRICS_LATENCY_BUCKETS =
     "TENT_METRICS_LATENCY_BUCKETS";
 constexpr const char* ENV_METRICS_SIZE_BUCKETS = "TENT_METRICS_SIZE_BUCKETS";
+constexpr const char* ENV_METRICS_PEER_TOP_N = "TENT_METRICS_PEER_TOP_N";
 }  // namespace config_keys
 
 }  // namespace tent
@@ -20,6 +20,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "tent/common/status.h"
@@ -79,6 +80,21 @@ class TentMetrics {
     void recordReadFailed(size_t bytes);
     void recordWriteFailed(size_t bytes);
 
+    // Record the learned service time model of an RDMA device: fixed latency
+    // in seconds, bandwidth correction factor and mean relative prediction
+    // error
+    void recordDeviceModel(const std::string& device, double beta0,
+                           double beta1, double prediction_error);
+
+    // Record the submit-to-completion latency of a task, broken down by the
+    // transport that served it and the peer segment it targeted
+    void recordTaskLatency(const char* transport, const std::string& peer,
+                           size_t bytes, double latency_seconds);
+
+    // Record the latency of a transfer slice posted on a local device
+    void recordDeviceLatency(const std::string& device, size_t bytes,
+                             double latency_seconds);
+
     // Get metrics for HTTP server
     std::string getPrometheusMetrics();
     std::string getJsonMetrics();
@@ -156,6 +172,55 @@ class TentMetrics {
         "tent_write_size_bytes", "Write request size distribution in bytes",
         kSizeBuckets};
 
+    // Gauges labeled by device, values are integers so scaled as named
+    std::vector<ylt::metric::dynamic_gauge_1t*> device_gauges_;
+    ylt::metric::dynamic_gauge_1t device_fixed_latency_{
+        "tent_device_model_fixed_latency_ns",
+        "Learned fixed latency of the device in nanoseconds", {"device"}};
+    ylt::metric::dynamic_gauge_1t device_bandwidth_factor_{
+        "tent_device_model_bandwidth_factor_milli",
+        "Learned bandwidth correction factor of the device, times 1000",
+        {"device"}};
+    ylt::metric::dynamic_gauge_1t device_prediction_error_{
+        "tent_device_model_prediction_error_permille",
+        "Mean relative error of the predicted service time, in permille",
+        {"device"}};
+
+    // Latency breakdowns by transport, peer and device. Every thread
+    // accumulates into its own shard, which is merged into cumulative
+    // histograms when metrics are exported
+    enum LatencyDimension { kByTransport, kByPeer, kByDevice, kNumDimensions };
+
+    struct LatencyStats {
+        std::vector<uint64_t> buckets;  // last bucket is +Inf
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+        double sum_us = 0;
+
+        void merge(const LatencyStats& other);
+    };
+
+    using LatencyStatsMap = std::unordered_map<std::string, LatencyStats>;
+
+    struct LatencyShard {
+        std::mutex mutex;  // only contended while merging
+        LatencyStatsMap stats[kNumDimensions];
+    };
+
+    LatencyShard& localShard();
+
+    void recordLatency(LatencyDimension dim, const std::string& key,
+                       size_t bytes, double latency_seconds);
+
+    LatencyStatsMap mergeLatency(LatencyDimension dim);
+
+    void serializeLatency(std::string& result);
+
+    // Shards outlive their threads so that exported values never decrease
+    std::mutex shards_mutex_;
+    std::vector<std::shared_ptr<LatencyShard>> shards_;
+    std::vector<double> breakdown_buckets_us_{kLatencyBuckets};
+
     // Helper to register all metrics to the vectors
     void registerMetrics();
 #endif  // TENT_METRICS_ENABLED
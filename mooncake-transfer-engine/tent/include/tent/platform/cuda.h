@@ -17,6 +17,7 @@
 
 #include "tent/runtime/platform.h"
 #include "tent/common/config.h"
+#include "tent/common/concurrent/range_cache.h"
 
 namespace mooncake {
 namespace tent {
@@ -41,10 +42,26 @@ class CudaPlatform : public Platform {
     virtual const std::vector<RangeLocation> getLocation(void *start,
                                                          size_t len);
 
+    virtual void addKnownRange(void *start, size_t len);
+
+    virtual void removeKnownRange(void *start);
+
     virtual const std::string type() const { return "cuda"; }
 
+   private:
+    const std::vector<RangeLocation> probeLocation(void *start, size_t len);
+
+    struct KnownRange {
+        MemoryType type;
+        // Locations covering the whole range, in address order
+        std::vector<RangeLocation> regions;
+    };
+
    private:
     std::shared_ptr<Config> conf;
+    // Buffers allocated or registered through the platform, looked up
+    // before asking the driver, whose pointer queries take its locks
+    RangeCache<KnownRange> known_ranges_;
 };
 
 }  // namespace tent
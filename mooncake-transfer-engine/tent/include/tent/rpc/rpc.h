@@ -23,6 +23,7 @@
 #include <string>
 #include <thread>
 #include <vector>
+#include <ylt/coro_io/client_pool.hpp>
 #include <ylt/coro_rpc/coro_rpc_client.hpp>
 #include <ylt/coro_rpc/coro_rpc_server.hpp>
 
@@ -40,7 +41,11 @@ enum RpcFuncID {
     Notify,
     Delegate,
     Pin,
-    Unpin
+    Unpin,
+    SubscribeSegment,
+    UpdateSegment,
+    BootstrapRdmaBatch,
+    Gossip
 };
 
 class CoroRpcAgent {
@@ -61,18 +66,28 @@ class CoroRpcAgent {
 
     Status stop();
 
+    // Thread safe. Calls to one server share a pool of connections, and
+    // several calls can be in flight on one connection.
     Status call(const std::string &server_addr, int func_id,
                 const std::string_view &request, std::string &response);
 
+    // Like call(), without blocking the caller. The request and response
+    // must stay valid until the returned task completes.
+    async_simple::coro::Lazy<Status> callAsync(const std::string &server_addr,
+                                               int func_id,
+                                               std::string_view request,
+                                               std::string &response);
+
    private:
     void process(int func_id);
 
    private:
     coro_rpc::coro_rpc_server *server_ = nullptr;
 
-    std::mutex sessions_mutex_;
-    std::unordered_map<std::string, coro_rpc::coro_rpc_client *> sessions_;
-    std::atomic<int> uid_{0};
+    // Connections are made by the pool of each server, outside of any lock
+    // shared with the calls to other servers
+    std::shared_ptr<coro_io::client_pools<coro_rpc::coro_rpc_client>>
+        client_pools_;
 
     std::mutex func_map_mutex_;
     std::unordered_map<int, Function> func_map_;
@@ -29,6 +29,7 @@
 
 #include "tent/runtime/metastore.h"
 #include "tent/runtime/segment.h"
+#include "tent/runtime/segment_gossip.h"
 #include "tent/runtime/segment_manager.h"
 #include "tent/rpc/rpc.h"
 #include "tent/runtime/topology.h"
@@ -37,6 +38,7 @@
 namespace mooncake {
 namespace tent {
 class TransferEngineImpl;
+class PeerSegmentRegistry;
 
 struct BootstrapDesc {
     std::string local_nic_path;
@@ -74,6 +76,20 @@ class ControlClient {
                             const BootstrapDesc& request,
                             BootstrapDesc& response);
 
+    // Exchanges the descriptors of all the NIC pairs with one server in one
+    // round trip. An entry the peer could not accept has an empty qp_num
+    // and the reason in reply_msg.
+    static Status bootstrapBatch(const std::string& server_addr,
+                                 const std::vector<BootstrapDesc>& requests,
+                                 std::vector<BootstrapDesc>& responses);
+
+    // Runs the batched bootstrap against all the servers concurrently and
+    // returns the status of each
+    static std::vector<Status> bootstrapBatch(
+        const std::vector<std::string>& server_addrs,
+        const std::vector<std::vector<BootstrapDesc>>& requests,
+        std::vector<std::vector<BootstrapDesc>>& responses);
+
     static Status sendData(const std::string& server_addr,
                            uint64_t peer_mem_addr, void* local_mem_addr,
                            size_t length);
@@ -93,6 +109,17 @@ class ControlClient {
 
     static Status unpinStageBuffer(const std::string& server_addr,
                                    uint64_t addr);
+
+    static Status subscribeSegment(const std::string& server_addr,
+                                   const std::string& subscriber_addr,
+                                   const std::string& alias,
+                                   std::string& response);
+
+    static Status updateSegment(const std::string& server_addr,
+                                const std::string& update);
+
+    static Status gossip(const std::string& server_addr,
+                         const std::string& request, std::string& response);
 };
 
 class ControlService {
@@ -121,6 +148,12 @@ class ControlService {
 
     Status start(uint16_t& port, bool ipv6_ = false);
 
+    // P2P mode only: spreads the segment descriptors among the peers,
+    // starting from |seeds|, instead of fetching each from its owner
+    Status enableGossip(const std::string& local_name,
+                        const SegmentGossip::Config& config,
+                        const std::vector<std::string>& seeds);
+
    private:
     void onGetSegmentDesc(const std::string_view& request,
                           std::string& response);
@@ -128,6 +161,9 @@ class ControlService {
     void onBootstrapRdma(const std::string_view& request,
                          std::string& response);
 
+    void onBootstrapRdmaBatch(const std::string_view& request,
+                              std::string& response);
+
     void onSendData(const std::string_view& request, std::string& response);
 
     void onRecvData(const std::string_view& request, std::string& response);
@@ -142,9 +178,19 @@ class ControlService {
     void onUnpinStageBuffer(const std::string_view& request,
                             std::string& response);
 
+    void onSubscribeSegment(const std::string_view& request,
+                            std::string& response);
+
+    void onUpdateSegment(const std::string_view& request,
+                         std::string& response);
+
+    void onGossip(const std::string_view& request, std::string& response);
+
    private:
     std::unique_ptr<SegmentManager> manager_;
     std::shared_ptr<CoroRpcAgent> rpc_server_;
+    PeerSegmentRegistry* peer_registry_ = nullptr;
+    std::shared_ptr<SegmentGossip> gossip_;
 
     OnReceiveBootstrap bootstrap_callback_;
     OnNotify notify_callback_;
@@ -15,8 +15,10 @@
 #ifndef METASTORE_H
 #define METASTORE_H
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "tent/common/status.h"
 
@@ -42,6 +44,22 @@ struct MetaStore {
     virtual Status set(const std::string &key, const std::string &value) = 0;
 
     virtual Status remove(const std::string &key) = 0;
+
+    // Fetches several keys in as few round trips as the store allows.
+    // values[i] is left empty if keys[i] does not exist. By default the
+    // keys are fetched one by one.
+    virtual Status getBatch(const std::vector<std::string> &keys,
+                            std::vector<std::string> &values);
+
+    // Invokes callback(key, deleted) when a key under |prefix| is set or
+    // removed, and callback("", false) when changes may have been missed.
+    // Only one prefix can be watched; fails with NotImplemented if the
+    // store cannot notify changes.
+    using OnChange = std::function<void(const std::string &key, bool deleted)>;
+
+    virtual Status watchPrefix(const std::string &prefix, OnChange callback) {
+        return Status::NotImplemented("watchPrefix not supported" LOC_MARK);
+    }
 };
 }  // namespace tent
 }  // namespace mooncake
@@ -45,6 +45,13 @@ class Platform {
     virtual const std::vector<RangeLocation> getLocation(void *start,
                                                          size_t len) = 0;
 
+    // Tells the platform about a buffer being registered, so that it can
+    // remember its type and location instead of probing them for every
+    // request touching it, until removeKnownRange(start)
+    virtual void addKnownRange(void *start, size_t len) {}
+
+    virtual void removeKnownRange(void *start) {}
+
     virtual const std::string type() const = 0;
 };
 
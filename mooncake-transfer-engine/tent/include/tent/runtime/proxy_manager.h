@@ -60,8 +60,17 @@ class ProxyManager {
     Status unpinStageBuffer(uint64_t addr);
 
    private:
+    enum StageKind { kLocalStage = 0, kCrossStage, kRemoteStage, kStageKinds };
+
     void runner(size_t id);
 
+    // Folds one completed stage into the bandwidth estimate of its kind
+    void recordStage(StageKind kind, size_t length, int64_t elapsed_ns);
+
+    // Picks the chunk length so that the stages of a request overlap
+    size_t pipelineChunkSize(size_t length, bool local_staging,
+                             bool remote_staging) const;
+
     Status transferEventLoop(StagingTask& task, StageBufferCache* cache);
 
     Status transferSync(StagingTask& task, StageBufferCache* cache);
@@ -107,7 +116,11 @@ class ProxyManager {
         std::queue<StagingTask> queue;
     };
     const static size_t kShards = 8;
+    // Stage buffers pinned per location and shard, i.e. pipeline depth
+    const static size_t kStageBuffers = 4;
     WorkerShard shards_[kShards];
+    // Bytes per nanosecond, 0 until the first stage of the kind completes
+    std::atomic<double> stage_bandwidth_[kStageKinds];
     ThreadPool delegate_pool_;
 };
 }  // namespace tent
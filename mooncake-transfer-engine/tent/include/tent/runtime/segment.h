@@ -172,13 +172,27 @@ struct SegmentDesc {
     std::variant<MemorySegmentDesc, FileSegmentDesc> detail;
 
    public:
+    // Buffers of a memory segment are sorted by address, larger first on a
+    // tie. Hits are cached per thread.
     BufferDesc* findBuffer(uint64_t base, uint64_t length);
+    // Skips the search if |handle| still names a buffer containing the range
+    BufferDesc* findBuffer(uint64_t base, uint64_t length,
+                           const MemoryHandle& handle);
+    // Handle of the buffer containing the range, if any
+    bool getMemoryHandle(uint64_t base, uint64_t length, MemoryHandle& handle);
     DeviceDesc* findDevice(const std::string& name);
     const MemorySegmentDesc& getMemory() const {
         return std::get<MemorySegmentDesc>(detail);
     }
 };
 
+// Order of the buffers in MemorySegmentDesc
+inline bool compareBufferDesc(const BufferDesc& lhs, const BufferDesc& rhs) {
+    if (lhs.addr < rhs.addr) return true;
+    if (lhs.addr > rhs.addr) return false;
+    return lhs.length > rhs.length;  // prefer large interval
+}
+
 inline void to_json(json& j, const SegmentDesc& s) {
     j = json{{"name", s.name}, {"type", s.type}, {"machine_id", s.machine_id}};
     if (s.type == SegmentType::Memory) {
@@ -0,0 +1,136 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TENT_SEGMENT_GOSSIP_H
+#define TENT_SEGMENT_GOSSIP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tent/common/status.h"
+#include "tent/thirdparty/nlohmann/json.h"
+
+namespace mooncake {
+namespace tent {
+
+// Disseminates the segment descriptors of the P2P mode among the peers, so
+// that a process learns the descriptors of the whole job from a few peers
+// instead of fetching each from its owner.
+//
+// Every round, a node exchanges with |fanout| random peers: it sends a
+// digest of the versions it knows and the entries that changed in the last
+// few rounds (rumors), and the peer replies with the entries it knows in a
+// newer version. Rumors stay hot for about log2(N) rounds, so a change
+// reaches all N nodes in O(log N) rounds with a constant number of messages
+// per node and round.
+class SegmentGossip {
+   public:
+    struct Config {
+        uint64_t interval_ms = 200;
+        size_t fanout = 2;
+        // Entries per message, rumors and replies each
+        size_t max_entries = 64;
+        // A peer that failed this many exchanges in a row is skipped for
+        // a while
+        int max_failures = 3;
+    };
+
+    // Sends |request| to the gossip service of |peer| and fills |response|
+    using SendFunction = std::function<Status(const std::string& peer,
+                                              const std::string& request,
+                                              std::string& response)>;
+
+    SegmentGossip(const std::string& local_name, const Config& config,
+                  SendFunction send);
+
+    ~SegmentGossip();
+
+    SegmentGossip(const SegmentGossip&) = delete;
+    SegmentGossip& operator=(const SegmentGossip&) = delete;
+
+    // Runs a round every interval_ms in the background
+    void start();
+
+    void stop();
+
+    // Makes |name| a gossip peer, e.g. a seed or a segment opened directly
+    void addPeer(const std::string& name);
+
+    // Publishes the descriptor of the local segment, empty once it is gone
+    void updateLocal(const std::string& desc);
+
+    // Returns false if |name| is unknown or gone
+    bool lookup(const std::string& name, std::string& desc);
+
+    // Exchanges with up to fanout peers
+    void runRound();
+
+    // Handles the request of a peer
+    void onGossip(const std::string_view& request, std::string& response);
+
+    size_t numKnown();
+
+   private:
+    struct Entry {
+        uint64_t version = 0;
+        std::string desc;  // empty for a segment that is gone
+        uint64_t changed_round = 0;
+    };
+
+    static nlohmann::json toJson(const std::string& name, const Entry& entry);
+
+    std::string makeRequest();
+
+    // Takes the entries that are newer than the known ones
+    void mergeEntries(const nlohmann::json& entries);
+
+    std::vector<std::string> pickPeers();
+
+    uint64_t rumorRoundsLocked() const;
+
+   private:
+    const std::string local_name_;
+    const Config config_;
+    const SendFunction send_;
+
+    std::mutex mutex_;
+    uint64_t round_ = 0;
+    std::unordered_map<std::string, Entry> view_;
+    // Names learned without an entry yet, e.g. seeds
+    std::unordered_set<std::string> peers_;
+    struct Failure {
+        int count = 0;
+        uint64_t retry_round = 0;
+    };
+    std::unordered_map<std::string, Failure> failures_;
+
+    std::thread worker_;
+    std::mutex worker_mutex_;
+    std::condition_variable worker_cv_;
+    bool running_ = false;
+};
+
+}  // namespace tent
+}  // namespace mooncake
+
+#endif  // TENT_SEGMENT_GOSSIP_H
@@ -19,9 +19,12 @@
 #include <netdb.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -53,6 +56,15 @@ class SegmentManager {
 
     Status invalidateRemote(SegmentID handle);
 
+    // Fetches the descriptors of the handles not cached yet in one batch
+    // from the registry. They are refreshed on TTL expiry like the others.
+    Status prefetchRemote(const std::vector<SegmentID> &handles);
+
+    // Changes whenever a cached remote descriptor is replaced or dropped
+    uint64_t remoteVersion() const {
+        return version_.load(std::memory_order_relaxed);
+    }
+
    public:
     SegmentDescRef getLocal() { return local_desc_; }
 
@@ -60,34 +72,98 @@ class SegmentManager {
 
     Status deleteLocal();
 
+   public:
+    // Registers a peer to be pushed the changes of the local segment, which
+    // it knows as |alias|. The response carries the current descriptor
+    Status addSubscriber(const std::string &subscriber_addr,
+                         const std::string &alias, std::string &response);
+
+    // Applies a change pushed by the owner of a remote segment
+    Status applyRemoteUpdate(const std::string_view &update);
+
    private:
+    struct SharedSegmentEntry {
+        SegmentDescRef desc;
+        uint64_t version = 0;  // of the owner, 0 if not subscribed
+        uint64_t last_refresh = 0;
+        bool refreshing = false;
+    };
+
     Status getRemote(SegmentDescRef &desc, SegmentID handle);
 
+    Status getRemoteShared(SegmentDescRef &desc, SegmentID handle);
+
+    Status fetchRemote(SharedSegmentEntry &entry, SegmentID handle);
+
+    void publishLocal();
+
+    void enqueuePush(const std::string &server_addr, std::string payload);
+
+    void pushWorker();
+
     Status makeFileRemote(SegmentDescRef &desc,
                           const std::string &segment_name);
 
    private:
+    // Per-thread references into the shared cache, keeping the returned
+    // descriptors alive until the next refresh of the thread
     struct RemoteSegmentCache {
         uint64_t last_refresh = 0;
         uint64_t version = 0;
         std::unordered_map<SegmentID, SegmentDescRef> id_to_desc_map;
     };
 
+    // Immutable snapshot of the segment ID table. Writers publish a modified
+    // copy and bump the epoch; readers keep a per-thread reference and only
+    // load the epoch, so lookups never write to shared cachelines
+    struct SegmentTable {
+        std::unordered_map<SegmentID, std::string> id_to_name_map;
+        std::unordered_map<std::string, SegmentID> name_to_id_map;
+    };
+
+    struct SegmentTableCache {
+        uint64_t epoch = 0;
+        std::shared_ptr<const SegmentTable> table;
+    };
+
+    const SegmentTable &currentTable();
+
+    bool lookupName(SegmentID handle, std::string &segment_name);
+
    private:
-    RWSpinlock lock_;
-    std::unordered_map<SegmentID, std::string> id_to_name_map_;
-    std::unordered_map<std::string, SegmentID> name_to_id_map_;
+    std::mutex table_mutex_;  // serializes writers
+    std::shared_ptr<const SegmentTable> table_;
+    std::atomic<uint64_t> table_epoch_;
+    ThreadLocalStorage<SegmentTableCache> tl_table_cache_;
     std::atomic<SegmentID> next_id_;
 
+    // Bumped whenever thread caches must drop their references
     std::atomic<uint64_t> version_;
 
     SegmentDescRef local_desc_;
     ThreadLocalStorage<RemoteSegmentCache> tl_remote_cache_;
 
+    RWSpinlock shared_cache_lock_;
+    std::unordered_map<SegmentID, SharedSegmentEntry> shared_cache_;
+
     std::unique_ptr<SegmentRegistry> registry_;
 
     std::string file_desc_basepath_;
     uint64_t ttl_ms_ = 10 * 1000;  // N.B. Frequent TTL harms p999
+    // Pushed entries only expire to recover from lost updates
+    uint64_t subscribed_ttl_ms_ = 10 * 60 * 1000;
+
+    // Local segment as last published to the registry and subscribers
+    std::mutex publish_mutex_;
+    json published_desc_;
+    uint64_t published_version_ = 0;
+    std::unordered_map<std::string, std::string> subscribers_;
+
+    std::mutex push_mutex_;
+    std::condition_variable push_cv_;
+    std::deque<std::pair<std::string, std::string>> push_queue_;
+    bool push_running_ = true;
+    std::thread push_thread_;
 };
 }  // namespace tent
 }  // namespace mooncake
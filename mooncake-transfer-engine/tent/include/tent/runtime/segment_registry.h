@@ -22,12 +22,16 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
+#include <vector>
 
 #include "tent/runtime/segment.h"
+#include "tent/runtime/segment_gossip.h"
 
 namespace mooncake {
 namespace tent {
@@ -47,6 +51,15 @@ class SegmentRegistry {
     virtual Status putSegmentDesc(SegmentDescRef &desc) = 0;
 
     virtual Status deleteSegmentDesc(const std::string &segment_name) = 0;
+
+    // descs[i] is left null if segment_names[i] cannot be retrieved. By
+    // default the segments are fetched one by one.
+    virtual Status getSegmentDescBatch(
+        const std::vector<std::string> &segment_names,
+        std::vector<SegmentDescRef> &descs);
+
+    // Called when a cached descriptor of |segment_name| turned out stale
+    virtual void invalidateSegmentDesc(const std::string &segment_name) {}
 };
 
 class CentralSegmentRegistry : public SegmentRegistry {
@@ -56,7 +69,7 @@ class CentralSegmentRegistry : public SegmentRegistry {
     CentralSegmentRegistry(const std::string &type, const std::string &servers,
                            const std::string &password, uint8_t db_index);
 
-    virtual ~CentralSegmentRegistry() {}
+    virtual ~CentralSegmentRegistry();
 
    public:
     virtual Status getSegmentDesc(SegmentDescRef &desc,
@@ -66,8 +79,45 @@ class CentralSegmentRegistry : public SegmentRegistry {
 
     virtual Status deleteSegmentDesc(const std::string &segment_name);
 
+    // One round trip to the store for all the segments not cached
+    virtual Status getSegmentDescBatch(
+        const std::vector<std::string> &segment_names,
+        std::vector<SegmentDescRef> &descs);
+
+   private:
+    // Retries store errors with jittered exponential backoff, so that the
+    // processes of a job do not retry in lockstep
+    Status withBackoff(const std::function<Status()> &op);
+
+    void startWatch();
+
+    void onKeyChanged(const std::string &key);
+
+    bool lookupCache(const std::string &segment_name, SegmentDescRef &desc);
+
+    void insertCache(const std::string &segment_name,
+                     const SegmentDescRef &desc, uint64_t generation);
+
    private:
+    // Entries are only cached while the store notifies changes, and still
+    // expire after the lease as a safety net
+    static constexpr uint64_t kCacheLeaseMs = 60 * 1000;
+    static constexpr int kMaxAttempts = 4;
+    static constexpr uint64_t kBaseBackoffMs = 20;
+
+    struct CacheEntry {
+        SegmentDescRef desc;
+        uint64_t expire_ts;
+    };
+
     std::shared_ptr<MetaStore> plugin_;
+
+    std::mutex cache_mutex_;
+    bool watching_ = false;
+    // Bumped by every change notification, so that a fetch that raced
+    // with a change does not cache its result
+    uint64_t generation_ = 0;
+    std::unordered_map<std::string, CacheEntry> cache_;
 };
 
 class PeerSegmentRegistry : public SegmentRegistry {
@@ -80,13 +130,25 @@ class PeerSegmentRegistry : public SegmentRegistry {
     virtual Status getSegmentDesc(SegmentDescRef &desc,
                                   const std::string &segment_name);
 
-    virtual Status putSegmentDesc(SegmentDescRef &desc) {
-        return Status::OK();  // no operation in purpose
-    }
+    virtual Status putSegmentDesc(SegmentDescRef &desc);
+
+    virtual Status deleteSegmentDesc(const std::string &segment_name);
+
+    // Fetches |segment_name| from its owner the next time, in case the
+    // gossiped descriptor is behind
+    virtual void invalidateSegmentDesc(const std::string &segment_name);
+
+    // Serves the descriptors from the gossiped view when set, and
+    // publishes the local one through it
+    void setGossip(std::shared_ptr<SegmentGossip> gossip);
 
-    virtual Status deleteSegmentDesc(const std::string &segment_name) {
-        return Status::OK();  // no operation in purpose
-    }
+   private:
+    std::shared_ptr<SegmentGossip> getGossip();
+
+   private:
+    std::mutex gossip_mutex_;
+    std::shared_ptr<SegmentGossip> gossip_;
+    std::unordered_set<std::string> bypass_;
 };
 
 }  // namespace tent
@@ -58,6 +58,9 @@ class SegmentTracker {
 
     Status forEach(std::function<Status(BufferDesc&)> callback);
 
+    Status getMemoryHandle(uint64_t base, size_t length,
+                           MemoryHandle& handle);
+
    private:
     SegmentDescRef local_desc_;
     std::mutex mutex_;
@@ -15,64 +15,89 @@
 #ifndef SLAB_H_
 #define SLAB_H_
 
-#include <list>
-#include <mutex>
 #include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace mooncake {
 namespace tent {
 
+// Objects are cached per thread in magazines, fixed-size batches of free
+// objects. Threads exchange whole magazines through a lock-free depot per
+// NUMA node, so that objects freed on another thread than the one that
+// allocated them (e.g. submitted on one thread, completed on the CQ poller)
+// go back in batches without a lock. The lock is only taken to grow.
 class SlabBase {
    public:
     SlabBase(size_t block_size);
 
-    ~SlabBase() {
-        for (auto entry : alloc_list_) free(entry);
-        alloc_list_.clear();
-        free_list_.clear();
-    }
+    ~SlabBase();
 
     void *allocate();
 
     void deallocate(void *object);
 
-    static const size_t kMaxFreeListSizeInThread = 128;
-    static const size_t kAllocateBatchSize = 128;
+    static const size_t kMagazineSize = 128;
+    static const size_t kAllocateBatchSize = kMagazineSize;
+
+    struct Magazine {
+        std::atomic<Magazine *> next{nullptr};
+        size_t count = 0;
+        std::array<void *, kMagazineSize> objects;
+
+        bool empty() const { return count == 0; }
+        bool full() const { return count == kMagazineSize; }
+    };
 
+    // Magazines of a thread. Allocation and deallocation go to the loaded
+    // one; the previous one keeps a thread that alternates around a
+    // magazine boundary from going to the depot each time.
     struct ThreadLocal {
+        Magazine *loaded = nullptr;
+        Magazine *previous = nullptr;
+    };
+
+   private:
+    // Treiber stack. Magazines are only freed with the slab, and the head
+    // carries a tag against ABA.
+    class MagazineStack {
        public:
-        bool enqueue(void *item) {
-            if (full()) return false;
-            buffer[tail] = item;
-            tail = (tail + 1) % kMaxFreeListSizeInThread;
-            ++count;
-            return true;
-        }
-
-        bool dequeue(void *&item) {
-            if (empty()) return false;
-            item = buffer[head];
-            head = (head + 1) % kMaxFreeListSizeInThread;
-            --count;
-            return true;
-        }
+        void push(Magazine *magazine);
 
-        bool empty() const { return count == 0; }
-        bool full() const { return count == kMaxFreeListSizeInThread; }
-        size_t size() const { return count; }
+        Magazine *pop();
 
        private:
-        std::array<void *, kMaxFreeListSizeInThread> buffer;
-        int head = 0, tail = 0, count = 0;
+        std::atomic<uint64_t> head_{0};
     };
 
-   private:
+    struct alignas(64) Depot {
+        MagazineStack full;
+        MagazineStack empty;
+    };
+
+    Depot &localDepot();
+
+    // A full magazine from the local depot, else from another one
+    Magazine *popFull();
+
+    Magazine *newMagazine();
+
+    // A magazine of newly allocated objects
+    Magazine *newFullMagazine();
+
     const size_t block_size_;
     int slab_index_;
+    size_t num_depots_;
+    std::unique_ptr<Depot[]> depots_;
+
     std::mutex mutex_;
-    std::list<void *> free_list_;
-    std::list<void *> alloc_list_;
+    std::vector<void *> alloc_list_;
+    std::vector<Magazine *> magazine_list_;
 };
 
 template <class T>
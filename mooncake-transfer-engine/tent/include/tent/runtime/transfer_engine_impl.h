@@ -93,6 +93,8 @@ class TransferEngineImpl {
 
     Status getSegmentInfo(SegmentID handle, SegmentInfo& info);
 
+    Status warmupSegments(const std::vector<SegmentID>& handles);
+
    public:
     Status allocateLocalMemory(void** addr, size_t size,
                                Location location = kWildcardLocation);
@@ -114,6 +116,10 @@ class TransferEngineImpl {
     Status unregisterLocalMemory(std::vector<void*> addr_list,
                                  std::vector<size_t> size_list = {});
 
+    // Handle of the registered buffer containing the range, to be set as
+    // Request::source_handle
+    Status getMemoryHandle(void* addr, size_t size, MemoryHandle& handle);
+
     // advanced buffer allocate function
     Status allocateLocalMemory(void** addr, size_t size,
                                MemoryOptions& options);
@@ -174,6 +180,11 @@ class TransferEngineImpl {
     TransportType resolveTransport(const Request& req, int priority,
                                    bool invalidate_on_fail = true);
 
+    struct TransportCacheKey;
+
+    // False if the source or target is not in a registered buffer
+    bool makeTransportCacheKey(const Request& req, TransportCacheKey& key);
+
     Status loadTransports();
 
     void findStagingPolicy(const Request& req,
@@ -185,6 +196,9 @@ class TransferEngineImpl {
                                      TransferStatusEnum prev_status,
                                      TransferStatusEnum new_status);
 
+    void recordTaskLatencyBreakdown(const TaskInfo& task,
+                                    double latency_seconds);
+
    private:
     struct AllocatedMemory {
         void* addr;
@@ -198,6 +212,35 @@ class TransferEngineImpl {
         std::vector<Batch*> freelist;
     };
 
+    // The transport picked first only depends on the source buffer, the
+    // target buffer and their descriptors
+    struct TransportCacheKey {
+        uint64_t source_base = 0;
+        SegmentID target_id = 0;
+        uint64_t target_base = 0;
+
+        bool operator==(const TransportCacheKey& rhs) const = default;
+    };
+
+    struct TransportCacheKeyHash {
+        size_t operator()(const TransportCacheKey& key) const {
+            size_t hash = std::hash<uint64_t>()(key.source_base);
+            hash = hash * 31 + std::hash<uint64_t>()(key.target_id);
+            return hash * 31 + std::hash<uint64_t>()(key.target_base);
+        }
+    };
+
+    // Dropped once local buffers are (un)registered or a remote
+    // descriptor changes
+    struct TransportCache {
+        const TransferEngineImpl* owner = nullptr;
+        uint64_t local_epoch = 0;
+        uint64_t remote_version = 0;
+        std::unordered_map<TransportCacheKey, TransportType,
+                           TransportCacheKeyHash>
+            entries;
+    };
+
    private:
     std::shared_ptr<Config> conf_;
     std::shared_ptr<ControlService> metadata_;
@@ -209,6 +252,8 @@ class TransferEngineImpl {
     std::unique_ptr<SegmentTracker> local_segment_tracker_;
 
     ThreadLocalStorage<BatchSet> batch_set_;
+    ThreadLocalStorage<TransportCache> transport_cache_;
+    std::atomic<uint64_t> local_epoch_{0};
 
     std::vector<AllocatedMemory> allocated_memory_;
     std::mutex mutex_;
@@ -130,6 +130,12 @@ class Transport {
             "receiveNotification not implemented" LOC_MARK);
     }
 
+    // Connects ahead of the first transfer to the given segments, for
+    // transports with per-peer connection setup
+    virtual Status warmupSegments(const std::vector<SegmentID> &target_ids) {
+        return Status::OK();
+    }
+
     virtual const char *getName() const { return "<generic>"; }
 
    protected:
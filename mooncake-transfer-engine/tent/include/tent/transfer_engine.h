@@ -42,6 +42,14 @@ struct tent_request {
 
 typedef struct tent_request tent_request_t;
 
+// Names a registered buffer, see tent_submit_with_handles
+struct tent_memory_handle {
+    uint64_t addr;
+    uint64_t index;
+};
+
+typedef struct tent_memory_handle tent_memory_handle_t;
+
 #define STATUS_WAITING (0)
 #define STATUS_PENDING (1)
 #define STATUS_INVALID (2)
@@ -195,6 +203,16 @@ int tent_register_memory_batch_ex(tent_engine_t engine, void** addrs,
 int tent_task_status_list(tent_engine_t engine, tent_batch_id_t batch_id,
                           tent_status_t* statuses, size_t* count);
 
+// Registers the memory like tent_register_memory and returns its handle
+int tent_register_memory_handle(tent_engine_t engine, void* addr, size_t size,
+                                tent_memory_handle_t* handle);
+
+// Like tent_submit, handles[i] names the buffer holding entries[i].source so
+// that its lookup is skipped. handles may be NULL.
+int tent_submit_with_handles(tent_engine_t engine, tent_batch_id_t batch_id,
+                             tent_request_t* entries,
+                             tent_memory_handle_t* handles, size_t count);
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
@@ -252,6 +270,11 @@ class TransferEngine {
 
     Status getSegmentInfo(SegmentID handle, SegmentInfo& info);
 
+    // Sets up the connections to the opened segments ahead of the first
+    // transfer, bootstrapping all of them concurrently. Connections that
+    // fail are retried on first use.
+    Status warmupSegments(const std::vector<SegmentID>& handles);
+
    public:
     Status allocateLocalMemory(void** addr, size_t size,
                                Location location = kWildcardLocation);
@@ -270,6 +293,10 @@ class TransferEngine {
     Status unregisterLocalMemory(std::vector<void*> addr_list,
                                  std::vector<size_t> size_list = {});
 
+    // Handle of the registered buffer containing the range, to be set as
+    // Request::source_handle
+    Status getMemoryHandle(void* addr, size_t size, MemoryHandle& handle);
+
     // advanced buffer allocate function
     Status allocateLocalMemory(void** addr, size_t size,
                                MemoryOptions& options);
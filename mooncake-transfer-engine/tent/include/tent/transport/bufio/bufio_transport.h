@@ -15,6 +15,7 @@
 #ifndef TENT_BUFIO_TRANSPORT_H
 #define TENT_BUFIO_TRANSPORT_H
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -22,6 +23,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "tent/common/concurrent/thread_pool.h"
 #include "tent/runtime/control_plane.h"
 #include "tent/runtime/transport.h"
 
@@ -42,6 +44,7 @@ struct BufIoTask {
 struct BufIoSubBatch : public Transport::SubBatch {
     size_t max_size = 0;
     std::vector<BufIoTask> task_list;
+    std::atomic<int> inflight_tasks{0};  // running in the IO thread pool
 
     size_t size() const override { return task_list.size(); }
 };
@@ -79,6 +82,15 @@ class BufIoTransport : public Transport {
     std::string getBufIoFilePath(SegmentID handle);
     BufIoFileContext* findFileContext(SegmentID handle);
 
+    void runTask(BufIoTask& task, BufIoFileContext* ctx);
+
+    // Reads through the O_DIRECT descriptor in aligned pieces, bouncing
+    // through an aligned buffer unless the destination is aligned host memory
+    ssize_t readDirect(int fd, void* dst, uint64_t offset, size_t length,
+                       bool host_memory);
+
+    void readAhead(BufIoFileContext* ctx, uint64_t offset, size_t length);
+
    private:
     bool installed_;
     std::string local_segment_name_;
@@ -90,6 +102,15 @@ class BufIoTransport : public Transport {
     using FileContextMap =
         std::unordered_map<SegmentID, std::shared_ptr<BufIoFileContext>>;
     FileContextMap file_context_map_;
+
+    // Reads of at least this size bypass the page cache, 0 disables
+    size_t direct_io_threshold_;
+    size_t bounce_buffer_size_;
+    // Window advised ahead of sequential buffered reads, 0 disables
+    size_t readahead_bytes_;
+    // Requests of at least this size run in the IO thread pool
+    size_t parallel_threshold_;
+    std::unique_ptr<ThreadPool> io_pool_;
 };
 
 }  // namespace tent
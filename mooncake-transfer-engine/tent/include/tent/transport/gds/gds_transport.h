@@ -38,6 +38,8 @@ class GdsFileContext;
 struct IOParamRange {
     size_t base;
     size_t count;
+    size_t length;
+    bool coalesced;  // io params shared with the neighboring tasks
 };
 
 // Wrapper for reusable CUfileBatchHandle_t
@@ -91,6 +93,10 @@ class GdsTransport : public Transport {
 
     GdsFileContext* findFileContext(SegmentID target_id);
 
+    BatchHandle* createBatchHandle();
+
+    bool sameLocalBuffer(const Request& prev, const Request& next);
+
    private:
     bool installed_;
     std::string local_segment_name_;
@@ -102,7 +108,13 @@ class GdsTransport : public Transport {
     using FileContextMap =
         std::unordered_map<SegmentID, std::shared_ptr<GdsFileContext>>;
     FileContextMap file_context_map_;
+    // File handles are registered once per file, even if several segments
+    // refer to it
+    std::unordered_map<std::string, std::shared_ptr<GdsFileContext>>
+        file_path_map_;
     size_t io_batch_depth_;
+    size_t handle_pool_size_;
+    size_t coalesce_max_bytes_;
 
     // Object pool for BatchHandle to avoid frequent cuFileBatchIOSetUp/Destroy
     // CUfileBatchHandle_t is reusable per cuFile API documentation
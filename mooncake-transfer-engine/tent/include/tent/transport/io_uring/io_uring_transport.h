@@ -17,12 +17,15 @@
 
 #include <bits/stdint-uintn.h>
 #include <liburing.h>
+#include <sys/uio.h>
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "tent/runtime/control_plane.h"
 #include "tent/runtime/transport.h"
@@ -43,10 +46,25 @@ struct IOUringTask {
     }
 };
 
+// A long-lived ring, lent to one sub-batch at a time
+struct IOUringRing {
+    struct io_uring ring;
+    unsigned entries = 0;
+    // Registered file table, holding the fd installed in each slot or -1.
+    // Empty if the kernel does not support sparse file tables.
+    std::vector<int> fixed_files;
+    // Registered buffers sorted by address, and the registration generation
+    // of the transport they were taken from
+    std::vector<struct iovec> fixed_buffers;
+    uint64_t buffer_version = 0;
+};
+
 struct IOUringSubBatch : public Transport::SubBatch {
     size_t max_size;
     std::vector<IOUringTask> task_list;
-    struct io_uring ring;
+    IOUringRing *ring = nullptr;
+    // Submitted requests whose completion has not been reaped yet
+    size_t inflight = 0;
     virtual size_t size() const { return task_list.size(); }
 };
 
@@ -87,6 +105,16 @@ class IOUringTransport : public Transport {
 
     Status probeCapabilities();
 
+    IOUringRing *acquireRing(size_t entries);
+
+    void releaseRing(IOUringRing *ring, bool idle);
+
+    IOUringRing *createRing(size_t entries);
+
+    void destroyRing(IOUringRing *ring);
+
+    void syncFixedBuffers(IOUringRing *ring);
+
    private:
     bool installed_;
     std::string local_segment_name_;
@@ -98,7 +126,25 @@ class IOUringTransport : public Transport {
     using FileContextMap =
         std::unordered_map<SegmentID, std::shared_ptr<IOUringFileContext>>;
     FileContextMap file_context_map_;
+    int next_file_slot_ = 0;
     uint64_t async_memcpy_threshold_;
+
+    // Idle rings kept for later sub-batches, instead of setting up and
+    // tearing down a ring for each of them
+    RWSpinlock ring_pool_lock_;
+    std::vector<IOUringRing *> ring_pool_;
+    size_t ring_pool_size_ = 16;
+    size_t queue_depth_ = 128;
+    std::atomic<bool> sqpoll_{false};
+    unsigned sqpoll_idle_ms_ = 10;
+    int max_fixed_files_ = 64;
+
+    // Memory buffers registered with the rings, split into iovecs of at
+    // most 1 GiB. buffer_version_ changes whenever they do.
+    bool register_buffers_ = true;
+    RWSpinlock buffer_lock_;
+    std::vector<struct iovec> fixed_buffers_;
+    uint64_t buffer_version_ = 0;
 };
 }  // namespace tent
 }  // namespace mooncake
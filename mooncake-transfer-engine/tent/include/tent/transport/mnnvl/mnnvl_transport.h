@@ -18,8 +18,11 @@
 #include <cuda.h>
 #include <cuda_runtime.h>
 
+#include <atomic>
 #include <functional>
 #include <iostream>
+#include <list>
+#include <memory>
 #include <queue>
 #include <string>
 #include <unordered_set>
@@ -30,12 +33,26 @@
 namespace mooncake {
 namespace tent {
 
+// Fabric memory of a peer imported into this process. It is unmapped when
+// the last task or thread cache referring to it lets go
+struct MnnvlImport {
+    void *addr = nullptr;
+    uint64_t length = 0;
+    CUmemGenericAllocationHandle handle = 0;
+    int cuda_id = 0;
+
+    ~MnnvlImport();
+};
+
+using MnnvlImportRef = std::shared_ptr<MnnvlImport>;
+
 struct MnnvlTask {
     Request request;
     volatile TransferStatusEnum status_word;
     volatile size_t transferred_bytes;
     uint64_t target_addr = 0;
     int cuda_id = 0;
+    MnnvlImportRef import;
 };
 
 struct MnnvlSubBatch : public Transport::SubBatch {
@@ -80,13 +97,24 @@ class MnnvlTransport : public Transport {
 
     virtual Status freeLocalMemory(void *addr, size_t size);
 
+    // Imports the fabric buffers of the given segments ahead of the first
+    // transfer, as long as they fit in the budget
+    virtual Status warmupSegments(const std::vector<SegmentID> &target_ids);
+
    private:
     void startTransfer(MnnvlTask *task, MnnvlSubBatch *batch);
 
     void *createSharedMemory(const std::string &path, size_t size);
 
     Status relocateSharedMemoryAddress(uint64_t &dest_addr, uint64_t length,
-                                       uint64_t target_id);
+                                       uint64_t target_id,
+                                       MnnvlImportRef &import);
+
+    Status importBuffer(const BufferDesc &buffer, MnnvlImportRef &import);
+
+    // Returns the import of |buffer|, importing it on a miss. Needs
+    // relocate_lock_ held for writing
+    Status getImportLocked(const BufferDesc &buffer, MnnvlImportRef &import);
 
     Status setPeerAccess();
 
@@ -96,18 +124,20 @@ class MnnvlTransport : public Transport {
     std::shared_ptr<Topology> local_topology_;
     std::shared_ptr<ControlService> metadata_;
 
-    struct OpenedMnnvlEntry {
-        void *mnnvl_addr;
-        uint64_t length;
-        int cuda_id;
+    struct ImportCacheEntry {
+        MnnvlImportRef import;
+        std::list<std::string>::iterator lru_iter;
     };
 
-    using HashMap =
-        std::unordered_map<SegmentID,
-                           std::unordered_map<uint64_t, OpenedMnnvlEntry>>;
-
+    // Imports of peer buffers by exported handle, least recently used first
+    // in import_lru_, unmapped beyond max_imported_bytes_ of address space
     RWSpinlock relocate_lock_;
-    HashMap relocate_map_;
+    std::unordered_map<std::string, ImportCacheEntry> import_cache_;
+    std::list<std::string> import_lru_;
+    uint64_t imported_bytes_ = 0;
+    uint64_t max_imported_bytes_ = 0;
+    // Bumped on eviction so that thread caches drop their references
+    std::atomic<uint64_t> import_epoch_{0};
     std::shared_ptr<Config> conf_;
 
     std::string machine_id_;
@@ -112,9 +112,30 @@ class RdmaContext {
     // Notification CQ (dedicated for notification QPs)
     RdmaCQ *notifyCq() { return notify_cq_; }
 
+    // Largest serialized notification, and the receive buffers posted
+    static constexpr size_t kNotifyMessageSize = 65536;
+    static constexpr size_t kNotifyRecvSlots = 256;
+    // Set in the wr_id of the receive WRs of notifySrq()
+    static constexpr uint64_t kNotifyRecvTag = 1ull << 63;
+
+    // Shared receive queue of all notification QPs of the device, so that
+    // one ring of pre-posted buffers serves every peer. Null if the device
+    // has no SRQ support, which disables RDMA notifications on it.
+    ibv_srq *notifySrq() { return notify_srq_; }
+
+    // Delivers the notification received in the SRQ receive WR wr_id, if
+    // byte_len is non-zero, and posts the buffer again
+    void handleNotifyRecv(uint64_t wr_id, size_t byte_len);
+
    private:
     int openDevice(const std::string &device_name, uint8_t port);
 
+    int createNotifySrq();
+
+    void destroyNotifySrq();
+
+    void postNotifyRecv(size_t slot);
+
    private:
     // initialized during ctor, will never be changed during the context's
     // lifecycle
@@ -144,6 +165,11 @@ class RdmaContext {
     // Dedicated CQ for notification QPs (one per device)
     RdmaCQ *notify_cq_ = nullptr;
 
+    ibv_srq *notify_srq_ = nullptr;
+    // kNotifyRecvSlots buffers of kNotifyMessageSize bytes, one MR
+    std::vector<char> notify_recv_ring_;
+    ibv_mr *notify_recv_mr_ = nullptr;
+
     const IbvSymbols &verbs_;
 };
 
@@ -15,6 +15,7 @@
 #ifndef TENT_ENDPOINT_H
 #define TENT_ENDPOINT_H
 
+#include <deque>
 #include <queue>
 
 #include "context.h"
@@ -80,7 +81,9 @@ class RdmaEndPoint {
    public:
     enum EndPointStatus { EP_UNINIT, EP_HANDSHAKING, EP_READY, EP_RESET };
 
-    int reset();
+    // Slices queued on the QPs are canceled, or moved to |evicted| if given
+    // so that the caller can resubmit them on another rail
+    int reset(std::vector<RdmaSlice*>* evicted = nullptr);
 
     int construct(RdmaContext* context, EndPointParams* params,
                   const std::string& endpoint_name,
@@ -91,7 +94,26 @@ class RdmaEndPoint {
     Status connect(const std::string& peer_server_name,
                    const std::string& peer_nic_name);
 
-    Status accept(const BootstrapDesc& peer_desc, BootstrapDesc& local_desc);
+    // Splits connect() so that the descriptors of many endpoints can be
+    // exchanged in one bootstrap RPC. beginConnect() takes the lock without
+    // waiting and fills |local_desc|; it returns false if the endpoint is
+    // busy or not handshaking. finishConnect() sets up the QPs from the
+    // reply of the peer and releases the lock, also on failure.
+    bool beginConnect(const std::string& peer_server_name,
+                      const std::string& peer_nic_name,
+                      BootstrapDesc& local_desc);
+
+    Status finishConnect(const std::string& peer_server_name,
+                         const std::string& peer_nic_name,
+                         SegmentDesc& segment_desc,
+                         const BootstrapDesc& peer_desc);
+
+    // Unless |wait|, fails with TooManyRequests instead of waiting for a
+    // handshake in progress on this endpoint
+    static constexpr uint64_t kAcceptSpinNs = 10000000;  // 10ms
+
+    Status accept(const BootstrapDesc& peer_desc, BootstrapDesc& local_desc,
+                  bool wait = true);
 
     EndPointStatus status() const { return status_; }
 
@@ -99,6 +121,11 @@ class RdmaEndPoint {
 
     int getInflightSlices() const;
 
+    // Time of the last acknowledged completion
+    uint64_t lastProgressTs() const {
+        return last_progress_ts_.load(std::memory_order_relaxed);
+    }
+
     RdmaContext& context() const { return *context_; }
 
     std::string name() const { return endpoint_name_; }
@@ -106,12 +133,11 @@ class RdmaEndPoint {
     // Notification QP operations
     uint32_t notifyQpNum() const { return notify_qp_ ? notify_qp_->qp_num : 0; }
 
+    // Messages short enough are sent inline, others are copied into a send
+    // ring. The peer receives them into the shared receive queue of its
+    // device, see RdmaContext::notifySrq().
     bool sendNotification(const std::string& name, const std::string& msg);
 
-    // Process RECV completion: parse message and add to transport queue
-    // directly
-    bool handleNotifyRecv(size_t buffer_idx, size_t byte_len);
-
     // Process SEND completion: cleanup pending send
     void handleNotifySendComplete(uint64_t wr_id);
 
@@ -131,19 +157,33 @@ class RdmaEndPoint {
         bool failed;
     };
 
-    int resetUnlocked();
+    int resetUnlocked(std::vector<RdmaSlice*>* evicted = nullptr);
 
     int submitSlices(std::vector<RdmaSlice*>& slice_list, int qp_index);
 
     int submitRecvImmDataRequest(int qp_index, uint64_t id);
 
-    size_t acknowledge(RdmaSlice* slice, TransferStatusEnum status);
+    // Completed slices go through |batch| if given
+    size_t acknowledge(RdmaSlice* slice, TransferStatusEnum status,
+                       SliceCompletionBatch* batch = nullptr);
 
     volatile int* getQuotaCounter(int qp_index) const {
         return &wr_depth_list_[qp_index].value;
     }
 
    private:
+    void fillBootstrapDesc(const std::string& peer_server_name,
+                           const std::string& peer_nic_name,
+                           BootstrapDesc& local_desc);
+
+    Status completeConnect(const std::string& peer_server_name,
+                           const std::string& peer_nic_name,
+                           SegmentDesc& segment_desc,
+                           const BootstrapDesc& peer_desc);
+
+    Status acceptUnlocked(const BootstrapDesc& peer_desc,
+                          BootstrapDesc& local_desc);
+
     int setupAllQPs(const std::string& peer_gid, uint16_t peer_lid,
                     std::vector<uint32_t> peer_qp_num_list,
                     std::string* reply_msg = nullptr);
@@ -156,9 +196,11 @@ class RdmaEndPoint {
     void cancelQuota(int qp_index, int num_entries);
 
    private:
-    void resetInflightSlices();
+    void resetInflightSlices(std::vector<RdmaSlice*>* evicted = nullptr);
+
+    int createNotifyQp();
 
-    void postNotifyRecv(size_t idx);
+    bool allocateNotifySendRing();
 
    private:
     std::atomic<EndPointStatus> status_;
@@ -171,6 +213,7 @@ class RdmaEndPoint {
     WrDepthBlock* wr_depth_list_;
     volatile int inflight_slices_;
     uint32_t padding_[7];
+    std::atomic<uint64_t> last_progress_ts_{0};
     RWSpinlock lock_;
 
     std::string peer_server_name_;
@@ -181,15 +224,22 @@ class RdmaEndPoint {
     ibv_qp* notify_qp_ = nullptr;
 
     // Notification buffers
-    static constexpr size_t kNotifyBufferSize = 65536;  // 64 KB
     static constexpr size_t kNotifyMaxPendingSends = 256;
-    std::vector<std::vector<char>> notify_recv_buffers_;
-    std::vector<ibv_mr*> notify_recv_mrs_;  // Memory regions for recv buffers
-    std::vector<char> notify_send_buffer_;  // Pre-allocated send buffer
-    ibv_mr* notify_send_mr_ = nullptr;      // Memory region for send buffer
+    static constexpr size_t kNotifySendRingSize = 1 << 20;  // 1 MB
+    // The four fields of a serialized message
+    static constexpr int kNotifySendSge = 4;
+    uint32_t notify_max_inline_ = 0;
+    // Allocated on the first message too long to be sent inline. Messages
+    // in flight occupy [notify_send_tail_, notify_send_head_), both byte
+    // positions increasing forever; notify_send_ends_ has the head after
+    // each of them, in posting order.
+    std::vector<char> notify_send_ring_;
+    ibv_mr* notify_send_mr_ = nullptr;  // Memory region for send ring
+    uint64_t notify_send_head_ = 0;
+    uint64_t notify_send_tail_ = 0;
+    std::deque<uint64_t> notify_send_ends_;
     std::mutex notify_send_mutex_;
     std::condition_variable notify_send_cv_;
-    int notify_pending_count_ = 0;    // Number of pending sends
     uint64_t notify_send_wr_id_ = 0;  // Circular counter for wr_id
     bool notify_connected_ = false;
 };
@@ -48,6 +48,9 @@ struct IbvSymbols {
     int (*ibv_modify_qp)(struct ibv_qp* qp, struct ibv_qp_attr* attr,
                          int attr_mask);
 
+    ibv_srq* (*ibv_create_srq)(ibv_pd* pd, ibv_srq_init_attr* srq_init_attr);
+    int (*ibv_destroy_srq)(ibv_srq* srq);
+
     int (*ibv_get_cq_event)(ibv_comp_channel* channel, ibv_cq** cq,
                             void** cq_context);
     void (*ibv_ack_cq_events)(ibv_cq* cq, unsigned int nevents);
@@ -17,6 +17,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 namespace mooncake {
 namespace tent {
@@ -65,6 +67,11 @@ struct WorkerParams {
     uint64_t grace_period_ns = 5000000;  // 5ms
     std::string rail_topo_path;
     bool show_latency_info = false;
+    // "auto": on the NUMA nodes of the NICs, off their interrupt CPUs;
+    // "numa": round robin over all NUMA nodes; "none": not bound
+    std::string affinity = "auto";
+    // Overrides the affinity, worker i runs on cpu_list[i % size]
+    std::vector<std::string> cpu_list;
 };
 
 struct RdmaParams {
@@ -47,6 +47,9 @@ class SharedQuotaManager;
  *
  *     avg_service_time <- (1 - alpha) * avg_service_time + alpha *
  * observed_time
+ *
+ * With a shared quota segment, the learned model is published there and new
+ * processes start from it instead of the defaults.
  */
 class DeviceQuota {
    public:
@@ -63,6 +66,10 @@ class DeviceQuota {
         uint64_t padding3[7];
         std::atomic<double> beta1{1.0};  // Effective bandwidth correction
         uint64_t padding4[7];
+        std::atomic<uint64_t> samples{0};  // Completions learned from
+        uint64_t padding5[7];
+        std::atomic<double> prediction_error{0.0};  // EWMA of |relative err|
+        uint64_t padding6[7];
     };
 
    public:
@@ -92,6 +99,14 @@ class DeviceQuota {
         return devices_[dev_id].active_bytes.load(std::memory_order_relaxed);
     }
 
+    // Seeds the model of a device, e.g. with what earlier processes learned
+    void warmStart(int dev_id, double beta0, double beta1);
+
+    const DeviceInfo *getDeviceInfo(int dev_id) const {
+        auto it = devices_.find(dev_id);
+        return it == devices_.end() ? nullptr : &it->second;
+    }
+
     void setLearningRate(double alpha) { alpha_ = std::clamp(alpha, 0.0, 1.0); }
 
     void setLocalWeight(double local_weight) {
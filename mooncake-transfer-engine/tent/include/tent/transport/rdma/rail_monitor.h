@@ -21,10 +21,30 @@
 
 namespace mooncake {
 namespace tent {
+// Tracks the health of the rails (local NIC, remote NIC) to one machine.
+// Failing rails are paused, probed while paused if probing is enabled and
+// re-admitted gradually: during probation only a growing fraction of the
+// traffic may use them, and a failure pauses them again at once.
 class RailMonitor {
     const static size_t kMaxNuma = 16;
 
    public:
+    struct Policy {
+        int error_threshold = 3;
+        std::chrono::milliseconds error_window{10000};
+        // Pause of a rail failing for the first time, doubled for each pause
+        // that follows without a clean probation in between
+        std::chrono::milliseconds cooldown{30000};
+        std::chrono::milliseconds max_cooldown{300000};
+        // Interval between probes of a paused rail, scaled like the cooldown;
+        // 0 disables probing
+        std::chrono::milliseconds probe_interval{0};
+        // Consecutive successful probes resuming a paused rail
+        int probe_successes = 3;
+        // Time for a resumed rail to be admitted to all the traffic again
+        std::chrono::milliseconds probation{2000};
+    };
+
     RailMonitor() = default;
 
     ~RailMonitor() = default;
@@ -36,14 +56,27 @@ class RailMonitor {
     Status load(const Topology *local, const Topology *remote,
                 const std::string &rail_topo_json = "");
 
+    void setPolicy(const Policy &policy) { policy_ = policy; }
+
     bool ready() { return ready_; }
 
     bool available(int local_nic, int remote_nic);
 
+    bool paused(int local_nic, int remote_nic);
+
+    // Counts an error, pausing the rail after error_threshold of them
     void markFailed(int local_nic, int remote_nic);
 
+    // Pauses the rail at once, e.g. when it stopped making progress
+    void markDegraded(int local_nic, int remote_nic);
+
     void markRecovered(int local_nic, int remote_nic);
 
+    // Whether a probe of the paused rail should be posted now
+    bool probeDue(int local_nic, int remote_nic);
+
+    void onProbeResult(int local_nic, int remote_nic, bool success);
+
     int findBestRemoteDevice(int local_nic, int remote_numa);
 
     const Topology *remote() { return remote_; }
@@ -55,6 +88,16 @@ class RailMonitor {
 
     void updateBestMapping();
 
+    struct RailState;
+
+    bool admissible(int local_nic, int remote_nic) const;
+
+    void pause(RailState &st, std::chrono::steady_clock::time_point now);
+
+    void resume(RailState &st, std::chrono::steady_clock::time_point now);
+
+    std::chrono::milliseconds probeInterval(const RailState &st) const;
+
    private:
     bool ready_{false};
     const Topology *local_{nullptr};
@@ -69,19 +112,21 @@ class RailMonitor {
 
     struct RailState {
         int error_count = 0;
-        std::chrono::seconds cooldown{0};
+        std::chrono::milliseconds cooldown{0};
         std::chrono::steady_clock::time_point last_error{};
         bool paused = false;
         std::chrono::steady_clock::time_point resume_time{};
+        std::chrono::steady_clock::time_point next_probe{};
+        int probe_successes = 0;
+        bool probation = false;
+        std::chrono::steady_clock::time_point probation_start{};
     };
 
     std::unordered_map<std::pair<int, int>, RailState, PairHash> rail_states_;
     std::unordered_map<int, int> direct_rails_;  // keep static after loaded
     std::unordered_map<int, int> best_mapping_[kMaxNuma];
 
-    int error_threshold_ = 3;
-    std::chrono::seconds error_window_{10};
-    std::chrono::seconds cooldown_{30};
+    Policy policy_;
 };
 
 }  // namespace tent
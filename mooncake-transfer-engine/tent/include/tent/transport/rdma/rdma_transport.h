@@ -97,10 +97,17 @@ class RdmaTransport : public Transport {
     virtual Status receiveNotification(
         std::vector<Notification>& notify_list) override;
 
+    // Connects every enabled local device to every device of the targets.
+    // The NIC pairs of one target share a bootstrap RPC and all targets are
+    // bootstrapped concurrently. Endpoints in a handshake already are left
+    // to it.
+    virtual Status warmupSegments(
+        const std::vector<SegmentID>& target_ids) override;
+
     // Process notification completions (call from worker threads)
     int processNotifyCompletions();
 
-    // Add notification directly to queue (called from endpoint
+    // Add notification directly to queue (called from context
     // handleNotifyRecv)
     void addNotificationToQueue(const std::string& name,
                                 const std::string& msg);
@@ -143,9 +150,10 @@ class RdmaTransport : public Transport {
     void notifyWorkerThread();
     std::thread notify_worker_;
     std::atomic<bool> notify_worker_running_;
-    int notify_poll_interval_us_;                   // Adaptive polling interval
-    static constexpr int kNotifyMinPollUs = 100;    // 100us
-    static constexpr int kNotifyMaxPollUs = 10000;  // 10ms
+    int notify_poll_interval_us_;                  // Adaptive polling interval
+    int notify_spin_us_ = 0;                       // Busy polling window
+    static constexpr int kNotifyMinPollUs = 10;    // 10us
+    static constexpr int kNotifyMaxPollUs = 1000;  // 1ms
 };
 }  // namespace tent
 }  // namespace mooncake
@@ -29,6 +29,7 @@
 #include <cstring>
 #include <atomic>
 #include <vector>
+#include <unordered_map>
 #include <iostream>
 #include <errno.h>
 
@@ -38,7 +39,7 @@ namespace tent {
 static constexpr int MAX_DEVICES = 64;
 static constexpr int MAX_PID_SLOTS = 256;
 static constexpr uint64_t SHM_MAGIC = 0x2025082772805202ULL;
-static constexpr int SHM_VERSION = 1;
+static constexpr int SHM_VERSION = 2;
 
 struct PidUsage {
     pid_t pid;                     // 0 == free slot
@@ -49,6 +50,11 @@ struct PidUsage {
 struct SharedDeviceEntry {
     char dev_name[56];  // NUL-terminated device name, empty means unused
     volatile uint64_t active_bytes;
+    // Service time model learned by the processes, valid once samples > 0
+    volatile double beta0;
+    volatile double beta1;
+    volatile uint64_t model_samples;
+    uint8_t reserved[40];  // padding -> 64B
     PidUsage pid_usages[MAX_PID_SLOTS];
 };
 
@@ -74,6 +80,7 @@ class SharedQuotaManager {
    private:
     Status attachProcess();
     Status detachProcess();
+    void publishModelLocked(int shared_id, int dev_id);
 
    private:
     PidUsage* findOrCreatePidSlotLocked(int dev_id, pid_t pid);
@@ -93,6 +100,8 @@ class SharedQuotaManager {
     size_t size_;
     bool created_;
     DeviceQuota* local_quota_;
+    // Samples of each local device already folded into the shared model
+    std::unordered_map<int, uint64_t> published_samples_;
 };
 
 }  // namespace tent
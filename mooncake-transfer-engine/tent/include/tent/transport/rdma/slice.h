@@ -67,25 +67,22 @@ struct RdmaSlice {
     TransferStatusEnum word = TransferStatusEnum::INITIAL;
     int qp_index = 0;
     int retry_count = 0;
+    int worker_id = -1;  // worker tracking the slice while in flight
     bool failed = false;
+    bool is_probe = false;
     uint64_t enqueue_ts = 0;
     uint64_t submit_ts = 0;
 };
 
 using RdmaSliceStorage = Slab<RdmaSlice>;
 
-static inline void updateSliceStatus(RdmaSlice* slice,
-                                     TransferStatusEnum status) {
-    if (status == PENDING) return;
-    RdmaTask* task = slice->task;
-    if (!__sync_bool_compare_and_swap(&slice->word, PENDING, status)) return;
-    if (status == COMPLETED) {
-        __sync_fetch_and_add(&task->transferred_bytes, slice->length);
-        __sync_fetch_and_add(&task->success_slices, 1);
-    } else {
-        __sync_bool_compare_and_swap(&task->first_error, PENDING, status);
+static inline void resolveSlices(RdmaTask* task, size_t bytes,
+                                 int num_succeeded, int num_resolved) {
+    if (num_succeeded) {
+        __sync_fetch_and_add(&task->transferred_bytes, bytes);
+        __sync_fetch_and_add(&task->success_slices, num_succeeded);
     }
-    int resolved = __sync_add_and_fetch(&task->resolved_slices, 1);
+    int resolved = __sync_add_and_fetch(&task->resolved_slices, num_resolved);
     if (resolved >= task->num_slices) {
         TransferStatusEnum final_st = (task->success_slices == task->num_slices)
                                           ? COMPLETED
@@ -95,6 +92,69 @@ static inline void updateSliceStatus(RdmaSlice* slice,
     }
 }
 
+// Sums the completed slices of a CQ poll per task, so that the counters of
+// a task are updated once per poll rather than once per slice. A task is
+// not reported complete before flush().
+class SliceCompletionBatch {
+   public:
+    SliceCompletionBatch() = default;
+
+    ~SliceCompletionBatch() { flush(); }
+
+    SliceCompletionBatch(const SliceCompletionBatch&) = delete;
+    SliceCompletionBatch& operator=(const SliceCompletionBatch&) = delete;
+
+    void add(RdmaSlice* slice) {
+        RdmaTask* task = slice->task;
+        // Slices of a task mostly complete back to back
+        for (size_t i = num_entries_; i-- > 0;) {
+            if (entries_[i].task == task) {
+                entries_[i].bytes += slice->length;
+                entries_[i].num_slices++;
+                return;
+            }
+        }
+        if (num_entries_ == kMaxEntries) flush();
+        entries_[num_entries_++] = Entry{task, slice->length, 1};
+    }
+
+    void flush() {
+        for (size_t i = 0; i < num_entries_; ++i) {
+            auto& entry = entries_[i];
+            resolveSlices(entry.task, entry.bytes, entry.num_slices,
+                          entry.num_slices);
+        }
+        num_entries_ = 0;
+    }
+
+   private:
+    static constexpr size_t kMaxEntries = 16;
+    struct Entry {
+        RdmaTask* task;
+        size_t bytes;
+        int num_slices;
+    };
+    Entry entries_[kMaxEntries];
+    size_t num_entries_ = 0;
+};
+
+static inline void updateSliceStatus(RdmaSlice* slice,
+                                     TransferStatusEnum status,
+                                     SliceCompletionBatch* batch = nullptr) {
+    if (status == PENDING) return;
+    RdmaTask* task = slice->task;
+    if (!__sync_bool_compare_and_swap(&slice->word, PENDING, status)) return;
+    if (status == COMPLETED) {
+        if (batch)
+            batch->add(slice);
+        else
+            resolveSlices(task, slice->length, 1, 1);
+    } else {
+        __sync_bool_compare_and_swap(&task->first_error, PENDING, status);
+        resolveSlices(task, 0, 0, 1);
+    }
+}
+
 }  // namespace tent
 }  // namespace mooncake
 
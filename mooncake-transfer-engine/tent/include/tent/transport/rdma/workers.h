@@ -58,6 +58,10 @@ class Workers {
 
     void workerThread(int thread_id);
 
+    // CPUs of each worker, from the NUMA nodes and interrupts of the NICs
+    // or from the configured override
+    void planAffinity();
+
     void asyncPostSend();
 
     void asyncPollCq();
@@ -77,7 +81,7 @@ class Workers {
     };
 
     Status getRouteHint(RouteHint &hint, SegmentID segment_id, uint64_t addr,
-                        uint64_t length);
+                        uint64_t length, const MemoryHandle &handle = {});
 
     Status selectOptimalDevice(RouteHint &source, RouteHint &target,
                                RdmaSlice *slice);
@@ -121,11 +125,37 @@ class Workers {
 
     std::shared_ptr<RdmaEndPoint> getEndpoint(PostPath path);
 
-    void disableEndpoint(RdmaSlice *slice);
+    // Marks the rail of the slice failed, or degraded to pause it at once,
+    // and resets its endpoint. Slices still queued there are resubmitted.
+    void disableEndpoint(RdmaSlice *slice, bool degraded = false);
+
+    void resubmitEvicted(std::vector<RdmaSlice *> &slices);
+
+    // Zero-byte RDMA read checking whether a paused rail works again
+    struct RailProbe {
+        std::string machine_id;
+        RdmaTask task;
+        RdmaSlice slice;
+        uint64_t deadline_ts = 0;
+        bool busy = false;
+        bool timed_out = false;
+    };
+
+    void addRailProbe(const std::string &machine_id, RdmaSlice *slice);
+
+    void probeRails();
+
+    void postRailProbe(const PostPath &path, RailProbe &probe);
+
+    void handleProbeCompletion(RdmaSlice *slice, bool success);
 
     using GroupedRequests =
         std::unordered_map<PostPath, std::vector<RdmaSlice *>, PostPathHash>;
 
+    // Posts the grouped slices through the QP qp_index of their endpoints
+    // @return Whether some slices are left for later rounds
+    bool postRequests(GroupedRequests &requests, int qp_index);
+
     struct PerfMetric {
         void add(double val) { samples.push_back(val); }
         size_t count() { return samples.size(); }
@@ -173,12 +203,17 @@ class Workers {
     struct PerfMetricSummary {
         PerfMetric enqueue_lat;
         PerfMetric inflight_lat;
+        // From enqueue to completion, of Request::HIGH slices only
+        PerfMetric urgent_lat;
     };
 
     struct WorkerContext {
         std::thread thread;
         BoundedSliceQueue queue;
         GroupedRequests requests;
+        GroupedRequests urgent_requests;
+        // Rounds the normal class was held back for urgent slices
+        int urgent_rounds = 0;
         std::unordered_set<RdmaSlice *> inflight_slice_set;
         std::atomic<int64_t> inflight_slices = 0;
 
@@ -187,15 +222,29 @@ class Workers {
         volatile bool in_suspend = false;
 
         std::unordered_map<std::string, RailMonitor> rails;
+        std::unordered_map<PostPath, RailProbe, PostPathHash> probes;
+        uint64_t last_probe_ts = 0;
         PerfMetricSummary perf;
         uint64_t padding[16];
     };
 
     WorkerContext *worker_context_;
     uint64_t slice_timeout_ns_;
+    uint64_t rail_stall_timeout_ns_;
+    uint64_t rail_probe_timeout_ns_;
+    RailMonitor::Policy rail_policy_;
+    // Rounds urgent slices are served for each round of the others while
+    // both wait; 0 holds the others back until no urgent slice waits
+    int priority_weight_ = 0;
+    // QP index of worker i for urgent slices is i + urgent_qp_offset_; 0
+    // shares the QP of the worker
+    int urgent_qp_offset_ = 0;
 
     std::unique_ptr<DeviceQuota> device_quota_;
     bool always_tier1_ = false;
+
+    // Empty for a worker that is not bound
+    std::vector<std::vector<int>> worker_cpus_;
 };
 }  // namespace tent
 }  // namespace mooncake
@@ -15,22 +15,39 @@
 #ifndef SHM_TRANSPORT_H_
 #define SHM_TRANSPORT_H_
 
+#include <atomic>
 #include <functional>
 #include <iostream>
+#include <list>
+#include <memory>
 #include <queue>
 #include <string>
 
+#include "tent/common/concurrent/thread_pool.h"
 #include "tent/runtime/control_plane.h"
 #include "tent/runtime/transport.h"
 
 namespace mooncake {
 namespace tent {
 
+// Shared memory of a peer mapped into this process. It is unmapped when the
+// last task or thread cache referring to it lets go
+struct ShmMapping {
+    void *addr = nullptr;
+    uint64_t length = 0;
+
+    ~ShmMapping();
+};
+
+using ShmMappingRef = std::shared_ptr<ShmMapping>;
+
 struct ShmTask {
     Request request;
     volatile TransferStatusEnum status_word;
     volatile size_t transferred_bytes;
     uint64_t target_addr = 0;
+    ShmMappingRef mapping;
+    uint32_t pending_chunks = 0;  // of a copy split across copy threads
 };
 
 struct ShmSubBatch : public Transport::SubBatch {
@@ -77,10 +94,18 @@ class ShmTransport : public Transport {
    private:
     void startTransfer(ShmTask *task, ShmSubBatch *batch);
 
-    void *createSharedMemory(const std::string &path, size_t size);
+    void copyHostMemory(void *dst, const void *src, size_t length);
+
+    void *createSharedMemory(const std::string &path, size_t &size);
+
+    int openSharedMemory(const std::string &path, bool create);
 
     Status relocateSharedMemoryAddress(uint64_t &dest_addr, uint64_t length,
-                                       uint64_t target_id);
+                                       uint64_t target_id,
+                                       ShmMappingRef &mapping);
+
+    Status mapSharedMemory(ShmMappingRef &mapping, const std::string &path,
+                           uint64_t length);
 
    private:
     bool installed_;
@@ -88,26 +113,39 @@ class ShmTransport : public Transport {
     std::shared_ptr<Topology> local_topology_;
     std::shared_ptr<ControlService> metadata_;
 
-    struct OpenedShmEntry {
-        int shm_fd;
-        void *shm_addr;
-        uint64_t length;
+    struct MappingCacheEntry {
+        ShmMappingRef mapping;
+        std::list<std::string>::iterator lru_iter;
     };
 
-    using HashMap =
-        std::unordered_map<SegmentID,
-                           std::unordered_map<uint64_t, OpenedShmEntry>>;
-
+    // Mappings of peer buffers by shm path, least recently used first in
+    // mapping_lru_, unmapped beyond max_mapped_bytes_ of address space
     RWSpinlock relocate_lock_;
-    HashMap relocate_map_;
+    std::unordered_map<std::string, MappingCacheEntry> mapping_cache_;
+    std::list<std::string> mapping_lru_;
+    uint64_t mapped_bytes_ = 0;
+    uint64_t max_mapped_bytes_ = 0;
+    // Bumped on eviction so that thread caches drop their references
+    std::atomic<uint64_t> mapping_epoch_{0};
     std::shared_ptr<Config> conf_;
 
     std::string machine_id_;
 
+    struct AllocatedShmEntry {
+        std::string path;
+        size_t length;
+    };
+
     std::mutex shm_path_mutex_;
-    std::unordered_map<void *, std::string> shm_path_map_;
+    std::unordered_map<void *, AllocatedShmEntry> shm_path_map_;
 
     std::string cxl_mount_path_;
+    std::string hugepage_mount_path_;
+
+    std::unique_ptr<ThreadPool> copy_pool_;
+    size_t parallel_copy_threshold_ = 0;
+    size_t copy_chunk_size_ = 0;
+    size_t nt_copy_threshold_ = 0;
 };
 }  // namespace tent
 }  // namespace mooncake
@@ -41,6 +41,17 @@ Status EtcdMetaStore::connect(const std::string &endpoint) {
 
 Status EtcdMetaStore::disconnect() {
     if (connected_) {
+        if (!watch_prefix_.empty()) {
+            char *err_str = nullptr;
+            // Once it returns, onWatchEvent() is not invoked again
+            if (EtcdCancelWatchPrefixWrapper((char *)watch_prefix_.c_str(),
+                                             &err_str)) {
+                LOG(WARNING) << "Etcd failed to cancel watch of \'"
+                             << watch_prefix_ << "\': " << err_str;
+                free(err_str);
+            }
+            watch_prefix_.clear();
+        }
         EtcdCloseWrapper();
         connected_ = false;
     }
@@ -81,6 +92,69 @@ Status EtcdMetaStore::set(const std::string &key, const std::string &value) {
     return Status::OK();
 }
 
+Status EtcdMetaStore::getBatch(const std::vector<std::string> &keys,
+                               std::vector<std::string> &values) {
+    char *err_str;
+    if (!connected_) {
+        return Status::MetadataError("Etcd connection not available" LOC_MARK);
+    }
+    values.assign(keys.size(), std::string());
+    if (keys.empty()) return Status::OK();
+    std::vector<char *> key_list;
+    key_list.reserve(keys.size());
+    for (auto &key : keys) key_list.push_back((char *)key.c_str());
+    std::vector<char *> raw_values(keys.size(), nullptr);
+    auto ret = EtcdGetBatchWrapper(key_list.data(), (int)keys.size(),
+                                   raw_values.data(), &err_str);
+    if (ret) {
+        std::string message = "Etcd failed to get " +
+                              std::to_string(keys.size()) + " keys: " + err_str;
+        free(err_str);  // free the memory for storing error message
+        return Status::MetadataError(message + LOC_MARK);
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (!raw_values[i]) continue;
+        values[i] = std::string(raw_values[i]);
+        free(raw_values[i]);  // free the memory allocated by the wrapper
+    }
+    return Status::OK();
+}
+
+Status EtcdMetaStore::watchPrefix(const std::string &prefix,
+                                  OnChange callback) {
+    char *err_str;
+    if (!connected_) {
+        return Status::MetadataError("Etcd connection not available" LOC_MARK);
+    }
+    if (!watch_prefix_.empty()) {
+        return Status::InvalidArgument("Etcd prefix already watched" LOC_MARK);
+    }
+    watch_callback_ = std::move(callback);
+    watch_prefix_ = prefix;
+    auto ret = EtcdWatchPrefixWrapper((char *)watch_prefix_.c_str(), this,
+                                      (void *)&onWatchEvent, &err_str);
+    if (ret) {
+        std::string message =
+            "Etcd failed to watch \'" + prefix + "\': " + err_str;
+        free(err_str);  // free the memory for storing error message
+        watch_prefix_.clear();
+        return Status::MetadataError(message + LOC_MARK);
+    }
+    return Status::OK();
+}
+
+void EtcdMetaStore::onWatchEvent(void *context, const char *key,
+                                 size_t key_size, const char *value,
+                                 size_t value_size, int event_type,
+                                 long long mod_revision) {
+    auto store = static_cast<EtcdMetaStore *>(context);
+    if (event_type == 2) {
+        store->watch_callback_("", false);
+        return;
+    }
+    store->watch_callback_(std::string(key, key_size), event_type == 1);
+}
+
 Status EtcdMetaStore::remove(const std::string &key) {
     char *err_str;
     if (!connected_) {
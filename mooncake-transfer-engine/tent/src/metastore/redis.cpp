@@ -15,8 +15,14 @@
 #include "tent/metastore/redis.h"
 
 #include <glog/logging.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <chrono>
 #include <memory>
 
+#include "tent/common/utils/random.h"
+
 namespace mooncake {
 namespace tent {
 
@@ -71,68 +77,74 @@ Status RedisMetaStore::connect(const std::string &endpoint,
     }
 
     auto hostname_port = parseHostNameWithPort(endpoint, REDIS_DEFAULT_PORT);
-    client_ = redisConnect(hostname_port.first.c_str(), hostname_port.second);
-    if (!client_) {
+    hostname_ = hostname_port.first;
+    port_ = hostname_port.second;
+    password_ = password;
+    db_index_ = db_index;
+    CHECK_STATUS(openConnection(client_));
+    connected_ = true;
+    return Status::OK();
+}
+
+Status RedisMetaStore::openConnection(redisContext *&context) {
+    context = redisConnect(hostname_.c_str(), port_);
+    if (!context) {
         std::string message = "Redis cannot connect to endpoint";
         return Status::MetadataError(message + LOC_MARK);
     }
-    if (client_->err) {
+    if (context->err) {
         std::string message =
-            "Redis connection failed: " + std::string(client_->errstr);
-        cleanupFailedConnection();
+            "Redis connection failed: " + std::string(context->errstr);
+        redisFree(context);
+        context = nullptr;
         return Status::MetadataError(message + LOC_MARK);
     }
 
     // Authenticate if password is provided
-    if (!password.empty()) {
+    if (!password_.empty()) {
         // Use binary-safe authentication to prevent password leakage
         redisReply *reply = (redisReply *)redisCommand(
-            client_, "AUTH %b", password.data(), password.size());
+            context, "AUTH %b", password_.data(), password_.size());
         RedisReplyGuard reply_guard(reply);
 
         if (!reply || reply->type == REDIS_REPLY_ERROR) {
             // Don't leak specific error details that might contain sensitive
             // info
             std::string message = "Redis authentication failed";
-            cleanupFailedConnection();
+            redisFree(context);
+            context = nullptr;
             return Status::MetadataError(message + LOC_MARK);
         }
     }
 
     // Select database if db_index is not 0
-    if (db_index != REDIS_DEFAULT_DB_INDEX) {
+    if (db_index_ != REDIS_DEFAULT_DB_INDEX) {
         redisReply *reply =
-            (redisReply *)redisCommand(client_, "SELECT %d", db_index);
+            (redisReply *)redisCommand(context, "SELECT %d", db_index_);
         RedisReplyGuard reply_guard(reply);
 
         if (!reply || reply->type == REDIS_REPLY_ERROR) {
             std::string message =
-                "Redis failed to select database " + std::to_string(db_index);
-            cleanupFailedConnection();
+                "Redis failed to select database " + std::to_string(db_index_);
+            redisFree(context);
+            context = nullptr;
             return Status::MetadataError(message + LOC_MARK);
         }
     }
-
-    connected_ = true;
     return Status::OK();
 }
 
 Status RedisMetaStore::disconnect() {
+    stopWatch();
+    std::lock_guard<std::mutex> lock(client_mutex_);
     if (connected_) {
         redisFree(client_);
+        client_ = nullptr;
         connected_ = false;
     }
     return Status::OK();
 }
 
-void RedisMetaStore::cleanupFailedConnection() {
-    if (client_) {
-        redisFree(client_);
-        client_ = nullptr;
-    }
-    connected_ = false;
-}
-
 Status RedisMetaStore::handleRedisReply(redisReply *reply,
                                         const std::string &operation) const {
     if (!reply) {
@@ -164,6 +176,7 @@ Status RedisMetaStore::get(const std::string &key, std::string &value) {
     }
 
     // Use binary-safe formatting to prevent command injection
+    std::lock_guard<std::mutex> lock(client_mutex_);
     redisReply *resp =
         (redisReply *)redisCommand(client_, "GET %b", key.data(), key.size());
     RedisReplyGuard reply_guard(resp);
@@ -177,7 +190,47 @@ Status RedisMetaStore::get(const std::string &key, std::string &value) {
         return Status::InvalidEntry(key);
     }
 
-    value = std::string(resp->str);
+    value = std::string(resp->str, resp->len);
+    return Status::OK();
+}
+
+Status RedisMetaStore::getBatch(const std::vector<std::string> &keys,
+                                std::vector<std::string> &values) {
+    if (!connected_) {
+        return Status::MetadataError("Redis connection not available" LOC_MARK);
+    }
+    values.assign(keys.size(), std::string());
+    if (keys.empty()) return Status::OK();
+
+    std::vector<const char *> argv;
+    std::vector<size_t> argvlen;
+    argv.reserve(keys.size() + 1);
+    argvlen.reserve(keys.size() + 1);
+    argv.push_back("MGET");
+    argvlen.push_back(4);
+    for (auto &key : keys) {
+        argv.push_back(key.data());
+        argvlen.push_back(key.size());
+    }
+    std::lock_guard<std::mutex> lock(client_mutex_);
+    redisReply *resp = (redisReply *)redisCommandArgv(
+        client_, argv.size(), argv.data(), argvlen.data());
+    RedisReplyGuard reply_guard(resp);
+
+    Status status =
+        handleRedisReply(resp, "MGET of " + std::to_string(keys.size()));
+    if (!status.ok()) {
+        return status;
+    }
+    if (resp->type != REDIS_REPLY_ARRAY || resp->elements != keys.size()) {
+        return Status::MetadataError(
+            "Redis MGET returned malformed reply" LOC_MARK);
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto element = resp->element[i];
+        if (element && element->type == REDIS_REPLY_STRING)
+            values[i] = std::string(element->str, element->len);
+    }
     return Status::OK();
 }
 
@@ -187,6 +240,7 @@ Status RedisMetaStore::set(const std::string &key, const std::string &value) {
     }
 
     // Use binary-safe formatting to prevent command injection
+    std::lock_guard<std::mutex> lock(client_mutex_);
     redisReply *resp =
         (redisReply *)redisCommand(client_, "SET %b %b", key.data(), key.size(),
                                    value.data(), value.size());
@@ -201,11 +255,136 @@ Status RedisMetaStore::remove(const std::string &key) {
     }
 
     // Use binary-safe formatting to prevent command injection
+    std::lock_guard<std::mutex> lock(client_mutex_);
     redisReply *resp =
         (redisReply *)redisCommand(client_, "DEL %b", key.data(), key.size());
     RedisReplyGuard reply_guard(resp);
 
     return handleRedisReply(resp, "DEL '" + key + "'");
 }
+
+// Glob characters in the prefix must match literally in PSUBSCRIBE
+static std::string escapeGlob(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '*' || c == '?' || c == '[' || c == ']' || c == '\\')
+            escaped.push_back('\\');
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+Status RedisMetaStore::watchPrefix(const std::string &prefix,
+                                   OnChange callback) {
+    if (!connected_) {
+        return Status::MetadataError("Redis connection not available" LOC_MARK);
+    }
+    if (watch_running_) {
+        return Status::InvalidArgument("Redis prefix already watched" LOC_MARK);
+    }
+    {
+        // SET notifies '$' and DEL 'g' events, 'A' includes both
+        std::lock_guard<std::mutex> lock(client_mutex_);
+        redisReply *resp = (redisReply *)redisCommand(
+            client_, "CONFIG GET notify-keyspace-events");
+        RedisReplyGuard reply_guard(resp);
+        if (!resp || resp->type != REDIS_REPLY_ARRAY || resp->elements != 2 ||
+            !resp->element[1]->str) {
+            return Status::NotImplemented(
+                "Redis keyspace notifications not readable" LOC_MARK);
+        }
+        std::string flags(resp->element[1]->str, resp->element[1]->len);
+        bool has_events =
+            flags.find('A') != std::string::npos ||
+            (flags.find('$') != std::string::npos &&
+             flags.find('g') != std::string::npos);
+        if (flags.find('K') == std::string::npos || !has_events) {
+            return Status::NotImplemented(
+                "Redis keyspace notifications disabled" LOC_MARK);
+        }
+    }
+    watch_prefix_ = prefix;
+    watch_callback_ = std::move(callback);
+    watch_running_ = true;
+    watch_thread_ = std::thread(&RedisMetaStore::watchWorker, this);
+    return Status::OK();
+}
+
+void RedisMetaStore::stopWatch() {
+    if (!watch_running_.exchange(false)) return;
+    {
+        // Wakes up the worker blocked in redisGetReply()
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        if (watch_client_) shutdown(watch_client_->fd, SHUT_RDWR);
+    }
+    watch_thread_.join();
+}
+
+void RedisMetaStore::watchWorker() {
+    const std::string channel_prefix =
+        "__keyspace@" + std::to_string(db_index_) + "__:";
+    const std::string pattern =
+        channel_prefix + escapeGlob(watch_prefix_) + "*";
+    const uint64_t kMinBackoffMs = 100, kMaxBackoffMs = 10000;
+    uint64_t backoff_ms = kMinBackoffMs;
+    while (watch_running_) {
+        redisContext *context = nullptr;
+        auto status = openConnection(context);
+        if (status.ok()) {
+            redisReply *resp = (redisReply *)redisCommand(
+                context, "PSUBSCRIBE %b", pattern.data(), pattern.size());
+            RedisReplyGuard reply_guard(resp);
+            if (!resp || resp->type == REDIS_REPLY_ERROR)
+                status = Status::MetadataError(
+                    "Redis failed to subscribe keyspace events" LOC_MARK);
+        }
+        if (status.ok()) {
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex_);
+                if (watch_running_) watch_client_ = context;
+            }
+            // Changes before the subscription took effect are unknown
+            watch_callback_("", false);
+            backoff_ms = kMinBackoffMs;
+            void *raw_reply = nullptr;
+            while (watch_running_ &&
+                   redisGetReply(context, &raw_reply) == REDIS_OK) {
+                RedisReplyGuard message((redisReply *)raw_reply);
+                // ["pmessage", pattern, channel, event]
+                if (!message || message->type != REDIS_REPLY_ARRAY ||
+                    message->elements != 4 || !message->element[2]->str ||
+                    !message->element[3]->str)
+                    continue;
+                std::string channel(message->element[2]->str,
+                                    message->element[2]->len);
+                std::string event(message->element[3]->str,
+                                  message->element[3]->len);
+                if (!channel.starts_with(channel_prefix)) continue;
+                watch_callback_(channel.substr(channel_prefix.size()),
+                                event != "set");
+            }
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex_);
+                watch_client_ = nullptr;
+            }
+            if (watch_running_) {
+                LOG(WARNING) << "Redis keyspace subscription broken";
+                watch_callback_("", false);
+            }
+        } else if (watch_running_) {
+            LOG(WARNING) << status.ToString();
+        }
+        if (context) redisFree(context);
+
+        // Jittered, so that the clients of a restarted server spread out
+        uint64_t delay_ms =
+            backoff_ms / 2 + SimpleRandom::Get().next(backoff_ms / 2 + 1);
+        backoff_ms = std::min(backoff_ms * 2, kMaxBackoffMs);
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(delay_ms);
+        while (watch_running_ && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
 }  // namespace tent
 }  // namespace mooncake
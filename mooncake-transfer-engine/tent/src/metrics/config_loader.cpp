@@ -76,6 +76,12 @@ void MetricsConfigLoader::applyEnvironmentOverrides(MetricsConfig& config) {
             config.size_buckets = buckets;
         }
     }
+
+    if (const char* env_val =
+            std::getenv(config_keys::ENV_METRICS_PEER_TOP_N)) {
+        int top_n = ConfigHelper::parseInt(env_val, config.peer_top_n);
+        if (top_n >= 0) config.peer_top_n = static_cast<uint32_t>(top_n);
+    }
 }
 
 MetricsConfig MetricsConfigLoader::loadFromConfig(const Config& config) {
@@ -100,6 +106,8 @@ MetricsConfig MetricsConfigLoader::loadFromConfig(const Config& config) {
                    metrics_config.enable_prometheus);
     metrics_config.enable_json = config.get(config_keys::METRICS_ENABLE_JSON,
                                             metrics_config.enable_json);
+    metrics_config.peer_top_n = config.get(config_keys::METRICS_PEER_TOP_N,
+                                           metrics_config.peer_top_n);
 
     // Load bucket configurations
     auto latency_buckets_array =
@@ -161,6 +169,8 @@ MetricsConfig MetricsConfigLoader::loadWithDefaults(const Config* config) {
                         metrics_config.enable_prometheus);
         metrics_config.enable_json = config->get(
             config_keys::METRICS_ENABLE_JSON, metrics_config.enable_json);
+        metrics_config.peer_top_n = config->get(
+            config_keys::METRICS_PEER_TOP_N, metrics_config.peer_top_n);
 
         auto latency_buckets_array =
             config->getArray<double>(config_keys::METRICS_LATENCY_BUCKETS);
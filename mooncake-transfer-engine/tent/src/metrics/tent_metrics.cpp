@@ -16,6 +16,7 @@
 
 #include <glog/logging.h>
 #include <tent/thirdparty/nlohmann/json.h>
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
@@ -59,6 +60,7 @@ Status TentMetrics::initialize(const MetricsConfig& config) {
         write_latency_ = ylt::metric::histogram_t(
             "tent_write_latency_us",
             "Write latency distribution in microseconds", latency_buckets_us);
+        breakdown_buckets_us_ = latency_buckets_us;
     }
 
     // Configure size histogram buckets if provided
@@ -165,6 +167,7 @@ void TentMetrics::shutdown() {
     counters_.clear();
     histograms_.clear();
     histogram_boundaries_.clear();
+    device_gauges_.clear();
 
     initialized_ = false;
     LOG(INFO) << "TENT metrics shutdown complete";
@@ -196,6 +199,12 @@ void TentMetrics::registerMetrics() {
         kSizeBuckets,
         kSizeBuckets,
     };
+
+    device_gauges_ = {
+        &device_fixed_latency_,
+        &device_bandwidth_factor_,
+        &device_prediction_error_,
+    };
 }
 
 void TentMetrics::recordReadCompleted(size_t bytes, double latency_seconds) {
@@ -246,6 +255,161 @@ void TentMetrics::recordWriteFailed(size_t bytes) {
     write_requests_total_.inc();  // Count failed requests too
 }
 
+void TentMetrics::recordDeviceModel(const std::string& device, double beta0,
+                                    double beta1, double prediction_error) {
+    // Fast path: check runtime switch first
+    if (!initialized_ || !runtime_enabled_.load(std::memory_order_relaxed))
+        return;
+
+    device_fixed_latency_.update({device},
+                                 static_cast<int64_t>(beta0 * 1e9));
+    device_bandwidth_factor_.update({device},
+                                    static_cast<int64_t>(beta1 * 1e3));
+    device_prediction_error_.update(
+        {device}, static_cast<int64_t>(prediction_error * 1e3));
+}
+
+void TentMetrics::LatencyStats::merge(const LatencyStats& other) {
+    if (buckets.size() < other.buckets.size())
+        buckets.resize(other.buckets.size(), 0);
+    for (size_t i = 0; i < other.buckets.size(); ++i)
+        buckets[i] += other.buckets[i];
+    count += other.count;
+    bytes += other.bytes;
+    sum_us += other.sum_us;
+}
+
+TentMetrics::LatencyShard& TentMetrics::localShard() {
+    thread_local std::shared_ptr<LatencyShard> tl_shard;
+    if (!tl_shard) {
+        tl_shard = std::make_shared<LatencyShard>();
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        shards_.push_back(tl_shard);
+    }
+    return *tl_shard;
+}
+
+void TentMetrics::recordLatency(LatencyDimension dim, const std::string& key,
+                                size_t bytes, double latency_seconds) {
+    double latency_us = latency_seconds * 1000000.0;
+    const auto& boundaries = breakdown_buckets_us_;
+    size_t bucket =
+        std::lower_bound(boundaries.begin(), boundaries.end(), latency_us) -
+        boundaries.begin();
+    auto& shard = localShard();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& stats = shard.stats[dim][key];
+    if (stats.buckets.empty()) stats.buckets.resize(boundaries.size() + 1, 0);
+    stats.buckets[bucket]++;
+    stats.count++;
+    stats.bytes += bytes;
+    stats.sum_us += latency_us;
+}
+
+void TentMetrics::recordTaskLatency(const char* transport,
+                                    const std::string& peer, size_t bytes,
+                                    double latency_seconds) {
+    // Fast path: check runtime switch first
+    if (!initialized_ || !runtime_enabled_.load(std::memory_order_relaxed))
+        return;
+
+    recordLatency(kByTransport, transport, bytes, latency_seconds);
+    recordLatency(kByPeer, peer, bytes, latency_seconds);
+}
+
+void TentMetrics::recordDeviceLatency(const std::string& device, size_t bytes,
+                                      double latency_seconds) {
+    // Fast path: check runtime switch first
+    if (!initialized_ || !runtime_enabled_.load(std::memory_order_relaxed))
+        return;
+
+    recordLatency(kByDevice, device, bytes, latency_seconds);
+}
+
+TentMetrics::LatencyStatsMap TentMetrics::mergeLatency(LatencyDimension dim) {
+    std::vector<std::shared_ptr<LatencyShard>> shards;
+    {
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        shards = shards_;
+    }
+    LatencyStatsMap merged;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& entry : shard->stats[dim])
+            merged[entry.first].merge(entry.second);
+    }
+    return merged;
+}
+
+void TentMetrics::serializeLatency(std::string& result) {
+    struct Family {
+        LatencyDimension dim;
+        const char* name;
+        const char* label;
+        const char* help;
+    };
+    static const Family kFamilies[] = {
+        {kByTransport, "tent_transport", "transport",
+         "Task submit to completion latency by transport"},
+        {kByPeer, "tent_peer", "peer",
+         "Task submit to completion latency by peer segment"},
+        {kByDevice, "tent_device", "device",
+         "Slice enqueue to completion latency by local device"},
+    };
+
+    const auto& boundaries = breakdown_buckets_us_;
+    for (const auto& family : kFamilies) {
+        auto merged = mergeLatency(family.dim);
+        if (merged.empty()) continue;
+
+        std::vector<std::pair<std::string, LatencyStats>> series(
+            merged.begin(), merged.end());
+        if (family.dim == kByPeer && series.size() > config_.peer_top_n) {
+            // Keep the busiest peers, the long tail shares one series
+            std::sort(series.begin(), series.end(),
+                      [](const auto& lhs, const auto& rhs) {
+                          return lhs.second.bytes > rhs.second.bytes;
+                      });
+            LatencyStats other;
+            for (size_t i = config_.peer_top_n; i < series.size(); ++i)
+                other.merge(series[i].second);
+            series.resize(config_.peer_top_n);
+            series.emplace_back("other", std::move(other));
+        }
+
+        std::string latency_name = std::string(family.name) + "_latency_us";
+        std::string bytes_name = std::string(family.name) + "_bytes_total";
+        result += "# HELP " + latency_name + " " + family.help +
+                  " in microseconds\n";
+        result += "# TYPE " + latency_name + " histogram\n";
+        for (const auto& [key, stats] : series) {
+            std::string label =
+                std::string(family.label) + "=\"" + key + "\"";
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < stats.buckets.size(); ++i) {
+                cumulative += stats.buckets[i];
+                std::string le = i < boundaries.size()
+                                     ? std::to_string(static_cast<int64_t>(
+                                           boundaries[i]))
+                                     : "+Inf";
+                result += latency_name + "_bucket{" + label + ",le=\"" + le +
+                          "\"} " + std::to_string(cumulative) + "\n";
+            }
+            result += latency_name + "_sum{" + label + "} " +
+                      std::to_string(stats.sum_us) + "\n";
+            result += latency_name + "_count{" + label + "} " +
+                      std::to_string(stats.count) + "\n";
+        }
+        result += "# HELP " + bytes_name + " Bytes transferred by " +
+                  family.label + "\n";
+        result += "# TYPE " + bytes_name + " counter\n";
+        for (const auto& [key, stats] : series) {
+            result += bytes_name + "{" + family.label + "=\"" + key + "\"} " +
+                      std::to_string(stats.bytes) + "\n";
+        }
+    }
+}
+
 std::string TentMetrics::getPrometheusMetrics() {
     if (!initialized_) return "";
 
@@ -264,6 +428,12 @@ std::string TentMetrics::getPrometheusMetrics() {
             histogram->serialize(result);
         }
 
+        for (auto* gauge : device_gauges_) {
+            gauge->serialize(result);
+        }
+
+        serializeLatency(result);
+
         return result;
     } catch (const std::exception& e) {
         LOG(ERROR) << "Failed to serialize Prometheus metrics: " << e.what();
@@ -373,6 +543,11 @@ void TentMetrics::recordReadCompleted(size_t, double) {}
 void TentMetrics::recordWriteCompleted(size_t, double) {}
 void TentMetrics::recordReadFailed(size_t) {}
 void TentMetrics::recordWriteFailed(size_t) {}
+void TentMetrics::recordDeviceModel(const std::string&, double, double,
+                                    double) {}
+void TentMetrics::recordTaskLatency(const char*, const std::string&, size_t,
+                                    double) {}
+void TentMetrics::recordDeviceLatency(const std::string&, size_t, double) {}
 
 std::string TentMetrics::getPrometheusMetrics() {
     return "# TENT metrics disabled at compile time\n";
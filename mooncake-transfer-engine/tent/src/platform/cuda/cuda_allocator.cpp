@@ -31,6 +31,10 @@ Status CudaPlatform::allocate(void** pptr, size_t size,
         CHECK_CUDA(cudaSetDevice(location.index()));
         CHECK_CUDA(cudaMalloc(pptr, size));
         cudaSetDevice(cuda_dev);
+        std::string name = "cuda:" + std::to_string(location.index());
+        known_ranges_.insert(
+            (uint64_t)*pptr, size,
+            KnownRange{MTYPE_CUDA, {{(uint64_t)*pptr, size, name}}});
         return Status::OK();
     }
     int socket_id = 0;
@@ -38,10 +42,24 @@ Status CudaPlatform::allocate(void** pptr, size_t size,
     *pptr = numa_alloc_onnode(size, socket_id);
     if (!(*pptr))
         return Status::InternalError("Unable to allocate DRAM memory");
+    std::string name = "cpu:" + std::to_string(socket_id);
+    known_ranges_.insert(
+        (uint64_t)*pptr, size,
+        KnownRange{MTYPE_CPU, {{(uint64_t)*pptr, size, name}}});
     return Status::OK();
 }
 
 Status CudaPlatform::free(void* ptr, size_t size) {
+    auto known = known_ranges_.find((uint64_t)ptr);
+    if (known && known->start == (uint64_t)ptr) {
+        auto type = known->value.type;
+        known_ranges_.erase((uint64_t)ptr);
+        if (type == MTYPE_CUDA)
+            CHECK_CUDA(cudaFree(ptr));
+        else
+            numa_free(ptr, size);
+        return Status::OK();
+    }
     cudaPointerAttributes attributes;
     CHECK_CUDA(cudaPointerGetAttributes(&attributes, ptr));
     if (attributes.type == cudaMemoryTypeDevice) {
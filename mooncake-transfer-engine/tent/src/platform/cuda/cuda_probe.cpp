@@ -263,6 +263,8 @@ Status CudaPlatform::probe(std::vector<Topology::NicEntry>& nic_list,
 }
 
 MemoryType CudaPlatform::getMemoryType(void* addr) {
+    auto known = known_ranges_.find((uint64_t)addr);
+    if (known) return known->value.type;
     cudaPointerAttributes attributes;
     cudaError_t result;
     result = cudaPointerGetAttributes(&attributes, addr);
@@ -292,6 +294,39 @@ static inline std::string genCudaNodeName(int node) {
 
 const std::vector<RangeLocation> CudaPlatform::getLocation(void* start,
                                                            size_t len) {
+    const uint64_t begin = (uint64_t)start;
+    const uint64_t end = begin + len;
+    auto known = known_ranges_.find(begin);
+    if (known && end - known->start <= known->length) {
+        std::vector<RangeLocation> entries;
+        for (auto& region : known->value.regions) {
+            const uint64_t region_end = region.start + region.len;
+            if (region_end <= begin || region.start >= end) continue;
+            const uint64_t entry_start = std::max(begin, region.start);
+            entries.push_back({entry_start,
+                               size_t(std::min(end, region_end) - entry_start),
+                               region.location});
+        }
+        if (!entries.empty()) return entries;
+    }
+    return probeLocation(start, len);
+}
+
+void CudaPlatform::addKnownRange(void* start, size_t len) {
+    auto regions = probeLocation(start, len);
+    auto type = LocationParser(regions[0].location).type() == "cuda"
+                    ? MTYPE_CUDA
+                    : MTYPE_CPU;
+    known_ranges_.insert((uint64_t)start, len,
+                         KnownRange{type, std::move(regions)});
+}
+
+void CudaPlatform::removeKnownRange(void* start) {
+    known_ranges_.erase((uint64_t)start);
+}
+
+const std::vector<RangeLocation> CudaPlatform::probeLocation(void* start,
+                                                             size_t len) {
     const static size_t kPageSize = 4096;
     std::vector<RangeLocation> entries;
 
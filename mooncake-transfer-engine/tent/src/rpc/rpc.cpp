@@ -12,10 +12,6 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// TODO the implementation needs to be updated
-// - Caching sockets, and supporting multiple calls
-// - Keep it lightweighted and tidy
-
 #include "tent/rpc/rpc.h"
 
 #include <glog/logging.h>
@@ -29,7 +25,11 @@ namespace tent {
 using namespace coro_rpc;
 using namespace async_simple::coro;
 
-CoroRpcAgent::CoroRpcAgent() {}
+CoroRpcAgent::CoroRpcAgent()
+    : client_pools_(
+          std::make_shared<coro_io::client_pools<coro_rpc::coro_rpc_client>>(
+              coro_io::client_pool<coro_rpc::coro_rpc_client>::pool_config{})) {
+}
 
 CoroRpcAgent::~CoroRpcAgent() { stop(); }
 
@@ -71,10 +71,6 @@ Status CoroRpcAgent::stop() {
         delete server_;
         server_ = nullptr;
     }
-    for (auto& entry : sessions_) {
-        delete entry.second;
-    }
-    sessions_.clear();
     return Status::OK();
 }
 
@@ -92,38 +88,35 @@ void CoroRpcAgent::process(int func_id) {
 Status CoroRpcAgent::call(const std::string& server_addr, int func_id,
                           const std::string_view& request,
                           std::string& response) {
-    coro_rpc::coro_rpc_client* client = nullptr;
-    {
-        std::lock_guard<std::mutex> lock(sessions_mutex_);
-        auto it = sessions_.find(server_addr);
-        if (it == sessions_.end()) {
-            coro_rpc_client* client = new coro_rpc_client();
-            auto conn_result =
-                async_simple::coro::syncAwait(client->connect(server_addr));
-            if (conn_result.val() != 0) {
-                LOG(ERROR) << "Failed to connect RPC server. "
-                           << "server " << server_addr << ", "
-                           << "func_id " << func_id << ", "
-                           << "message " << conn_result.message();
-                return Status::RpcServiceError(
-                    "Failed to connect RPC server" LOC_MARK);
-            }
-            it = sessions_.emplace(server_addr, client).first;
-        }
-        client = it->second;
+    return syncAwait(callAsync(server_addr, func_id, request, response));
+}
+
+Lazy<Status> CoroRpcAgent::callAsync(const std::string& server_addr,
+                                     int func_id, std::string_view request,
+                                     std::string& response) {
+    auto client_pool = client_pools_->at(server_addr);
+    auto ret = co_await client_pool->send_request(
+        [&](coro_io::client_reuse_hint, coro_rpc_client& client) {
+            // Set even when empty, so that a pooled client does not pass on
+            // the request of an earlier call
+            client.set_req_attachment(request);
+            return client.send_request<&CoroRpcAgent::process>(func_id);
+        });
+    if (!ret.has_value()) {
+        LOG(ERROR) << "Failed to connect RPC server. "
+                   << "server " << server_addr << ", "
+                   << "func_id " << func_id;
+        co_return Status::RpcServiceError(
+            "Failed to connect RPC server" LOC_MARK);
     }
-    client->set_req_attachment(request);
-    auto call_result = async_simple::coro::syncAwait(
-        client->call<&CoroRpcAgent::process>(func_id));
+    // The connection takes other calls while this one is in flight
+    auto call_result = co_await std::move(ret.value());
     if (!call_result.has_value()) {
-        // LOG(ERROR) << "Failed to call RPC function."
-        //            << "server " << server_addr << ", "
-        //            << "func_id " << func_id;
-        return Status::RpcServiceError("Failed to call RPC function" LOC_MARK);
+        co_return Status::RpcServiceError(
+            "Failed to call RPC function" LOC_MARK);
     }
-    response = client->get_resp_attachment();
-    client->release_resp_attachment();
-    return Status::OK();
+    response.assign(call_result->get_attachment());
+    co_return Status::OK();
 }
 }  // namespace tent
-}  // namespace mooncake
\ No newline at end of file
+}  // namespace mooncake
@@ -15,6 +15,9 @@
 #include "tent/runtime/control_plane.h"
 #include "tent/runtime/transfer_engine_impl.h"
 
+#include <async_simple/coro/Collect.h>
+#include <async_simple/coro/SyncAwait.h>
+
 #include <cassert>
 #include <set>
 
@@ -25,12 +28,18 @@
 
 namespace mooncake {
 namespace tent {
-thread_local CoroRpcAgent tl_rpc_agent;
+// Shared by all threads, so that the calls of all threads to one server use
+// the same connections. Never destroyed, as threads may still call it while
+// the process exits.
+static CoroRpcAgent& rpcClient() {
+    static auto* agent = new CoroRpcAgent();
+    return *agent;
+}
 
 Status ControlClient::getSegmentDesc(const std::string& server_addr,
                                      std::string& response) {
     std::string request;
-    return tl_rpc_agent.call(server_addr, GetSegmentDesc, request, response);
+    return rpcClient().call(server_addr, GetSegmentDesc, request, response);
 }
 
 Status ControlClient::bootstrap(const std::string& server_addr,
@@ -39,12 +48,71 @@ Status ControlClient::bootstrap(const std::string& server_addr,
     std::string request_raw, response_raw;
     json j = request;
     request_raw = j.dump();
-    CHECK_STATUS(tl_rpc_agent.call(server_addr, BootstrapRdma, request_raw,
-                                   response_raw));
+    CHECK_STATUS(rpcClient().call(server_addr, BootstrapRdma, request_raw,
+                                  response_raw));
     response = json::parse(response_raw).get<BootstrapDesc>();
+    if (response.qp_num.empty())
+        return Status::RpcServiceError("Bootstrap rejected by peer: " +
+                                       response.reply_msg + LOC_MARK);
     return Status::OK();
 }
 
+static Status parseBootstrapBatch(const std::string& response_raw,
+                                  size_t count,
+                                  std::vector<BootstrapDesc>& responses) {
+    auto j = json::parse(response_raw, nullptr, false);
+    if (j.is_discarded() || !j.is_array() || j.size() != count)
+        return Status::MalformedJson(
+            "Malformed batched bootstrap response" LOC_MARK);
+    responses = j.get<std::vector<BootstrapDesc>>();
+    return Status::OK();
+}
+
+Status ControlClient::bootstrapBatch(const std::string& server_addr,
+                                     const std::vector<BootstrapDesc>& requests,
+                                     std::vector<BootstrapDesc>& responses) {
+    std::string response_raw;
+    json j = requests;
+    CHECK_STATUS(rpcClient().call(server_addr, BootstrapRdmaBatch, j.dump(),
+                                  response_raw));
+    return parseBootstrapBatch(response_raw, requests.size(), responses);
+}
+
+std::vector<Status> ControlClient::bootstrapBatch(
+    const std::vector<std::string>& server_addrs,
+    const std::vector<std::vector<BootstrapDesc>>& requests,
+    std::vector<std::vector<BootstrapDesc>>& responses) {
+    using async_simple::coro::Lazy;
+    assert(server_addrs.size() == requests.size());
+    const size_t count = server_addrs.size();
+    std::vector<std::string> requests_raw(count), responses_raw(count);
+    std::vector<Lazy<Status>> calls;
+    calls.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        json j = requests[i];
+        requests_raw[i] = j.dump();
+        calls.push_back(rpcClient().callAsync(
+            server_addrs[i], BootstrapRdmaBatch, requests_raw[i],
+            responses_raw[i]));
+    }
+    auto results = async_simple::coro::syncAwait(
+        async_simple::coro::collectAll(std::move(calls)));
+    std::vector<Status> status_list(count);
+    responses.assign(count, {});
+    for (size_t i = 0; i < count; ++i) {
+        if (results[i].hasError()) {
+            status_list[i] = Status::RpcServiceError(
+                "Batched bootstrap call raised an exception" LOC_MARK);
+            continue;
+        }
+        status_list[i] = results[i].value();
+        if (status_list[i].ok())
+            status_list[i] = parseBootstrapBatch(
+                responses_raw[i], requests[i].size(), responses[i]);
+    }
+    return status_list;
+}
+
 Status ControlClient::sendData(const std::string& server_addr,
                                uint64_t peer_mem_addr, void* local_mem_addr,
                                size_t length) {
@@ -53,7 +121,7 @@ Status ControlClient::sendData(const std::string& server_addr,
     request.resize(sizeof(XferDataDesc) + length);
     memcpy(&request[0], &desc, sizeof(desc));
     Platform::getLoader().copy(&request[sizeof(desc)], local_mem_addr, length);
-    auto status = tl_rpc_agent.call(server_addr, SendData, request, response);
+    auto status = rpcClient().call(server_addr, SendData, request, response);
     if (!status.ok()) return status;
     if (!response.empty()) return Status::RpcServiceError(response);
     return Status::OK();
@@ -66,7 +134,7 @@ Status ControlClient::recvData(const std::string& server_addr,
     XferDataDesc desc{htole64(peer_mem_addr), htole64(length)};
     request.resize(sizeof(XferDataDesc));
     memcpy(&request[0], &desc, sizeof(desc));
-    auto status = tl_rpc_agent.call(server_addr, RecvData, request, response);
+    auto status = rpcClient().call(server_addr, RecvData, request, response);
     if (!status.ok()) return status;
     if (response.size() != length)
         return Status::RpcServiceError(
@@ -89,7 +157,7 @@ Status ControlClient::notify(const std::string& server_addr,
     json j = message;
     std::string request = j.dump();
     std::string response;
-    return tl_rpc_agent.call(server_addr, Notify, request, response);
+    return rpcClient().call(server_addr, Notify, request, response);
 }
 
 inline void to_json(json& j, const Request& r) {
@@ -121,7 +189,7 @@ Status ControlClient::delegate(const std::string& server_addr,
     json j = request;
     request_raw = j.dump();
     CHECK_STATUS(
-        tl_rpc_agent.call(server_addr, Delegate, request_raw, response_raw));
+        rpcClient().call(server_addr, Delegate, request_raw, response_raw));
     return response_raw.empty() ? Status::OK()
                                 : Status::RpcServiceError(response_raw);
 }
@@ -133,7 +201,7 @@ Status ControlClient::pinStageBuffer(const std::string& server_addr,
     json j = location;
     request_raw = j.dump();
     CHECK_STATUS(
-        tl_rpc_agent.call(server_addr, Pin, request_raw, response_raw));
+        rpcClient().call(server_addr, Pin, request_raw, response_raw));
     addr = json::parse(response_raw).get<uint64_t>();
     return Status::OK();
 }
@@ -144,10 +212,35 @@ Status ControlClient::unpinStageBuffer(const std::string& server_addr,
     json j = addr;
     request_raw = j.dump();
     CHECK_STATUS(
-        tl_rpc_agent.call(server_addr, Unpin, request_raw, response_raw));
+        rpcClient().call(server_addr, Unpin, request_raw, response_raw));
     return Status::OK();
 }
 
+Status ControlClient::subscribeSegment(const std::string& server_addr,
+                                       const std::string& subscriber_addr,
+                                       const std::string& alias,
+                                       std::string& response) {
+    json j{{"subscriber", subscriber_addr}, {"alias", alias}};
+    std::string request_raw = j.dump();
+    return rpcClient().call(server_addr, SubscribeSegment, request_raw,
+                            response);
+}
+
+Status ControlClient::updateSegment(const std::string& server_addr,
+                                    const std::string& update) {
+    std::string response_raw;
+    CHECK_STATUS(
+        rpcClient().call(server_addr, UpdateSegment, update, response_raw));
+    return response_raw.empty() ? Status::OK()
+                                : Status::RpcServiceError(response_raw);
+}
+
+Status ControlClient::gossip(const std::string& server_addr,
+                             const std::string& request,
+                             std::string& response) {
+    return rpcClient().call(server_addr, Gossip, request, response);
+}
+
 ControlService::ControlService(const std::string& type,
                                const std::string& servers,
                                TransferEngineImpl* impl)
@@ -160,6 +253,7 @@ ControlService::ControlService(const std::string& type,
     : bootstrap_callback_(nullptr), notify_callback_(nullptr), impl_(impl) {
     if (type == "p2p") {
         auto agent = std::make_unique<PeerSegmentRegistry>();
+        peer_registry_ = agent.get();
         manager_ = std::make_unique<SegmentManager>(std::move(agent));
     } else {
         auto agent = std::make_unique<CentralSegmentRegistry>(
@@ -177,6 +271,11 @@ ControlService::ControlService(const std::string& type,
         [this](const std::string_view& request, std::string& response) {
             onBootstrapRdma(request, response);
         });
+    rpc_server_->registerFunction(
+        BootstrapRdmaBatch,
+        [this](const std::string_view& request, std::string& response) {
+            onBootstrapRdmaBatch(request, response);
+        });
     rpc_server_->registerFunction(
         SendData,
         [this](const std::string_view& request, std::string& response) {
@@ -204,14 +303,64 @@ ControlService::ControlService(const std::string& type,
         Unpin, [this](const std::string_view& request, std::string& response) {
             onUnpinStageBuffer(request, response);
         });
+    rpc_server_->registerFunction(
+        SubscribeSegment,
+        [this](const std::string_view& request, std::string& response) {
+            onSubscribeSegment(request, response);
+        });
+    rpc_server_->registerFunction(
+        UpdateSegment,
+        [this](const std::string_view& request, std::string& response) {
+            onUpdateSegment(request, response);
+        });
+    rpc_server_->registerFunction(
+        Gossip, [this](const std::string_view& request, std::string& response) {
+            onGossip(request, response);
+        });
 }
 
-ControlService::~ControlService() {}
+ControlService::~ControlService() {
+    auto gossip = std::atomic_load(&gossip_);
+    if (gossip) {
+        gossip->stop();
+        peer_registry_->setGossip(nullptr);
+    }
+}
 
 Status ControlService::start(uint16_t& port, bool ipv6_) {
     return rpc_server_->start(port, ipv6_);
 }
 
+Status ControlService::enableGossip(const std::string& local_name,
+                                    const SegmentGossip::Config& config,
+                                    const std::vector<std::string>& seeds) {
+    if (!peer_registry_)
+        return Status::InvalidArgument(
+            "Gossip requires the p2p metadata type" LOC_MARK);
+    if (std::atomic_load(&gossip_)) return Status::OK();
+    auto gossip = std::make_shared<SegmentGossip>(
+        local_name, config,
+        [](const std::string& peer, const std::string& request,
+           std::string& response) {
+            return ControlClient::gossip(peer, request, response);
+        });
+    for (auto& seed : seeds) {
+        if (seed != local_name) gossip->addPeer(seed);
+    }
+    // The RPC server is running already
+    std::atomic_store(&gossip_, gossip);
+    peer_registry_->setGossip(gossip);
+    gossip->start();
+    return Status::OK();
+}
+
+void ControlService::onGossip(const std::string_view& request,
+                              std::string& response) {
+    // Left empty until gossip is enabled
+    auto gossip = std::atomic_load(&gossip_);
+    if (gossip) gossip->onGossip(request, response);
+}
+
 void ControlService::onGetSegmentDesc(const std::string_view& request,
                                       std::string& response) {
     json j = *manager_->getLocal();
@@ -229,6 +378,19 @@ void ControlService::onBootstrapRdma(const std::string_view& request,
     response = j.dump();
 }
 
+void ControlService::onBootstrapRdmaBatch(const std::string_view& request,
+                                          std::string& response) {
+    auto request_list =
+        json::parse(request).get<std::vector<BootstrapDesc>>();
+    std::vector<BootstrapDesc> response_list(request_list.size());
+    if (bootstrap_callback_) {
+        for (size_t i = 0; i < request_list.size(); ++i)
+            bootstrap_callback_(request_list[i], response_list[i]);
+    }
+    json j = response_list;
+    response = j.dump();
+}
+
 void ControlService::onSendData(const std::string_view& request,
                                 std::string& response) {
     XferDataDesc* desc = (XferDataDesc*)request.data();
@@ -299,5 +461,21 @@ void ControlService::onUnpinStageBuffer(const std::string_view& request,
     impl_->unlockStageBuffer(addr);
 }
 
+void ControlService::onSubscribeSegment(const std::string_view& request,
+                                        std::string& response) {
+    auto j = json::parse(request);
+    auto status = manager_->addSubscriber(
+        j.at("subscriber").get<std::string>(),
+        j.at("alias").get<std::string>(), response);
+    // An empty response tells the subscriber to rely on its TTL
+    if (!status.ok()) response.clear();
+}
+
+void ControlService::onUpdateSegment(const std::string_view& request,
+                                     std::string& response) {
+    auto status = manager_->applyRemoteUpdate(request);
+    if (!status.ok()) response = status.ToString();
+}
+
 }  // namespace tent
 }  // namespace mooncake
@@ -27,6 +27,17 @@
 
 namespace mooncake {
 namespace tent {
+Status MetaStore::getBatch(const std::vector<std::string> &keys,
+                           std::vector<std::string> &values) {
+    values.assign(keys.size(), std::string());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto status = get(keys[i], values[i]);
+        if (status.IsInvalidEntry()) continue;
+        if (!status.ok()) return status;
+    }
+    return Status::OK();
+}
+
 std::shared_ptr<MetaStore> MetaStore::Create(const std::string &type,
                                              const std::string &servers) {
     return Create(type, servers, "", 0);
@@ -19,11 +19,14 @@
 #include <sstream>
 #include <mutex>
 
+#include "tent/common/utils/os.h"
+
 namespace mooncake {
 namespace tent {
 ProxyManager::ProxyManager(TransferEngineImpl* impl, size_t chunk_size,
                            size_t chunk_count)
     : chunk_size_(chunk_size), chunk_count_(chunk_count), impl_(impl) {
+    for (size_t i = 0; i < kStageKinds; ++i) stage_bandwidth_[i] = 0;
     running_ = true;
     for (size_t i = 0; i < kShards; ++i) {
         shards_[i].thread = std::thread(&ProxyManager::runner, this, i);
@@ -122,6 +125,46 @@ Status ProxyManager::waitCrossStage(const Request& request,
     return impl_->waitTransferCompletion(batch);
 }
 
+void ProxyManager::recordStage(StageKind kind, size_t length,
+                               int64_t elapsed_ns) {
+    if (elapsed_ns <= 0) return;
+    double sample = double(length) / elapsed_ns;
+    double current = stage_bandwidth_[kind].load(std::memory_order_relaxed);
+    // Shards race on the update, losing a sample now and then is harmless
+    double updated =
+        current == 0 ? sample : current + (sample - current) / 8;
+    stage_bandwidth_[kind].store(updated, std::memory_order_relaxed);
+}
+
+size_t ProxyManager::pipelineChunkSize(size_t length, bool local_staging,
+                                       bool remote_staging) const {
+    const static size_t kMinChunkSize = 256 * 1024;
+    const static size_t kAlignment = 64 * 1024;
+    // Shortest stage worth issuing, shorter ones are dominated by the
+    // submission and completion overhead of the stage
+    const static double kMinStageTimeNs = 200 * 1000.0;
+
+    // Give every stage buffer a chunk, so that the stages of consecutive
+    // chunks overlap even for requests of a few chunk sizes
+    size_t chunk = (length + kStageBuffers - 1) / kStageBuffers;
+
+    double bottleneck = 0;
+    auto consider = [&](StageKind kind) {
+        double bw = stage_bandwidth_[kind].load(std::memory_order_relaxed);
+        if (bw > 0 && (bottleneck == 0 || bw < bottleneck)) bottleneck = bw;
+    };
+    consider(kCrossStage);
+    if (local_staging) consider(kLocalStage);
+    if (remote_staging) consider(kRemoteStage);
+
+    size_t floor = kMinChunkSize;
+    if (bottleneck > 0)
+        floor = std::max(floor, size_t(bottleneck * kMinStageTimeNs));
+    chunk = std::max(chunk, floor);
+    chunk = (chunk + kAlignment - 1) / kAlignment * kAlignment;
+    return std::min(chunk, chunk_size_);
+}
+
 Status ProxyManager::submit(TaskInfo* task,
                             const std::vector<std::string>& params) {
     StagingTask staging_task;
@@ -238,7 +281,6 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
     auto server_addr = task.params[0];
     bool local_staging = !task.params[1].empty();
     bool remote_staging = !task.params[2].empty();
-    const static size_t kStageBuffers = 4;
     uint64_t local_stage_buffer[kStageBuffers],
         remote_stage_buffer[kStageBuffers];
     if (local_staging) {
@@ -278,6 +320,7 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
         StageState prev_state;
         StageState state;
         BatchID batch;
+        int64_t start_ts;
     };
 
     std::queue<size_t> event_queue;
@@ -285,16 +328,19 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
     std::unordered_set<uint64_t> local_locked;
     std::unordered_set<uint64_t> remote_locked;
 
-    for (size_t offset = 0; offset < request.length; offset += chunk_size_) {
+    size_t chunk_size =
+        pipelineChunkSize(request.length, local_staging, remote_staging);
+    for (size_t offset = 0; offset < request.length; offset += chunk_size) {
         size_t id = chunks.size();
         Chunk chunk{offset,
-                    std::min(chunk_size_, request.length - offset),
+                    std::min(chunk_size, request.length - offset),
                     local_staging ? local_stage_buffer[id % kStageBuffers]
                                   : (uint64_t)request.source + offset,
                     remote_staging ? remote_stage_buffer[id % kStageBuffers]
                                    : request.target_offset + offset,
                     StageState::PRE,
                     StageState::PRE,
+                    0,
                     0};
         chunks.push_back(chunk);
     }
@@ -302,6 +348,15 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
     for (size_t i = 0; i < chunks.size(); ++i) event_queue.push(i);
     std::vector<std::future<Status>> remote_futures(chunks.size());
 
+    // Stage buffers may only be reused once nothing targets them anymore
+    auto drain = [&]() {
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            if (chunks[i].batch) impl_->waitTransferCompletion(chunks[i].batch);
+            chunks[i].batch = 0;
+            if (remote_futures[i].valid()) remote_futures[i].wait();
+        }
+    };
+
     while (!event_queue.empty()) {
         auto id = event_queue.front();
         auto& chunk = chunks[id];
@@ -317,6 +372,7 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
                     chunk.batch = submitLocalStage(request, chunk.local_buf,
                                                    chunk.length, chunk.offset);
                     chunk.prev_state = chunk.state;
+                    chunk.start_ts = getCurrentTimeInNano();
                     chunk.state = StageState::INFLIGHT;
                 } else if (request.opcode == Request::READ && remote_staging) {
                     if (remote_locked.count(chunk.remote_buf)) {
@@ -328,6 +384,7 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
                                       chunk.length, chunk.offset,
                                       remote_futures[id]);
                     chunk.prev_state = chunk.state;
+                    chunk.start_ts = getCurrentTimeInNano();
                     chunk.state = StageState::INFLIGHT_REMOTE;
                 } else {
                     chunk.state = StageState::CROSS;
@@ -354,6 +411,7 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
                 chunk.batch = submitCrossStage(request, chunk.local_buf,
                                                chunk.remote_buf, chunk.length);
                 chunk.prev_state = chunk.state;
+                chunk.start_ts = getCurrentTimeInNano();
                 chunk.state = StageState::INFLIGHT;
                 event_queue.push(id);
                 break;
@@ -365,11 +423,13 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
                                       chunk.length, chunk.offset,
                                       remote_futures[id]);
                     chunk.prev_state = chunk.state;
+                    chunk.start_ts = getCurrentTimeInNano();
                     chunk.state = StageState::INFLIGHT_REMOTE;
                 } else if (request.opcode == Request::READ && local_staging) {
                     chunk.batch = submitLocalStage(request, chunk.local_buf,
                                                    chunk.length, chunk.offset);
                     chunk.prev_state = chunk.state;
+                    chunk.start_ts = getCurrentTimeInNano();
                     chunk.state = StageState::INFLIGHT;
                     event_queue.push(id);
                 }
@@ -378,13 +438,22 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
 
             case StageState::INFLIGHT: {
                 TransferStatus xfer_status;
-                CHECK_STATUS(
-                    impl_->getTransferStatus(chunk.batch, xfer_status));
+                auto status =
+                    impl_->getTransferStatus(chunk.batch, xfer_status);
+                if (!status.ok()) {
+                    drain();
+                    return status;
+                }
                 if (xfer_status.s == PENDING) {
                     event_queue.push(id);
                     break;
                 }
                 if (xfer_status.s == COMPLETED) {
+                    recordStage(chunk.prev_state == StageState::CROSS
+                                    ? kCrossStage
+                                    : kLocalStage,
+                                chunk.length,
+                                getCurrentTimeInNano() - chunk.start_ts);
                     if (chunk.prev_state == StageState::PRE)
                         chunk.state = StageState::CROSS;
                     else if (chunk.prev_state == StageState::CROSS) {
@@ -416,6 +485,7 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
             }
 
             case StageState::FAILED: {
+                drain();
                 return Status::InternalError(
                     "Proxy event loop in failed state");
             }
@@ -424,6 +494,7 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
                 auto& fut = remote_futures[id];
                 if (!fut.valid()) {
                     chunk.state = StageState::FAILED;
+                    event_queue.push(id);
                     break;
                 }
                 if (fut.wait_for(std::chrono::seconds(0)) ==
@@ -431,8 +502,11 @@ Status ProxyManager::transferEventLoop(StagingTask& task,
                     Status rs = fut.get();
                     if (!rs.ok()) {
                         chunk.state = StageState::FAILED;
+                        event_queue.push(id);
                         break;
                     }
+                    recordStage(kRemoteStage, chunk.length,
+                                getCurrentTimeInNano() - chunk.start_ts);
                     if (chunk.prev_state == StageState::PRE) {
                         chunk.state = StageState::CROSS;
                         event_queue.push(id);
@@ -14,6 +14,7 @@
 
 #include "tent/runtime/segment_registry.h"
 
+#include <algorithm>
 #include <cassert>
 #include <set>
 
@@ -23,18 +24,91 @@
 
 namespace mooncake {
 namespace tent {
+static inline bool containsRange(const BufferDesc &entry, uint64_t base,
+                                 uint64_t length) {
+    if (entry.addr + entry.length < entry.addr) return false;
+    return entry.addr <= base && base + length <= entry.addr + entry.length;
+}
+
+namespace {
+// Last hits of a thread, one per slot so that the local and a remote
+// segment looked up in turn do not evict each other
+struct BufferHitCache {
+    static constexpr size_t kSlots = 4;
+    struct Slot {
+        const SegmentDesc *desc = nullptr;
+        size_t index = 0;
+    } slots[kSlots];
+
+    Slot &get(const SegmentDesc *desc) {
+        return slots[(reinterpret_cast<uintptr_t>(desc) >> 6) % kSlots];
+    }
+};
+thread_local BufferHitCache tl_hit_cache;
+}  // namespace
+
+static BufferDesc *searchBuffer(std::vector<BufferDesc> &buffers,
+                                uint64_t base, uint64_t length) {
+    // The candidates start at or below |base|; nearest first
+    auto it = std::upper_bound(
+        buffers.begin(), buffers.end(), base,
+        [](uint64_t value, const BufferDesc &entry) {
+            return value < entry.addr;
+        });
+    while (it != buffers.begin()) {
+        --it;
+        if (containsRange(*it, base, length)) return &*it;
+        // Sorted buffers do not overlap in practice, give up early
+        if (it->addr + it->length <= base) break;
+    }
+    // Lists not sorted by an older peer are scanned
+    for (auto &entry : buffers) {
+        if (containsRange(entry, base, length)) return &entry;
+    }
+    return nullptr;
+}
+
 BufferDesc *SegmentDesc::findBuffer(uint64_t base, uint64_t length) {
     if (type != SegmentType::Memory) return nullptr;
-    auto &cast = std::get<MemorySegmentDesc>(detail);
-    for (auto &entry : cast.buffers) {
-        // Check for integer overflow in base + length
-        if (base + length < base) return nullptr;
-        if (entry.addr + entry.length < entry.addr) continue;
+    // Check for integer overflow in base + length
+    if (base + length < base) return nullptr;
+    auto &buffers = std::get<MemorySegmentDesc>(detail).buffers;
+    auto &slot = tl_hit_cache.get(this);
+    // Also valid if another descriptor reuses the address: the hit is
+    // checked against the current list
+    if (slot.desc == this && slot.index < buffers.size() &&
+        containsRange(buffers[slot.index], base, length))
+        return &buffers[slot.index];
+    auto entry = searchBuffer(buffers, base, length);
+    if (entry) {
+        slot.desc = this;
+        slot.index = entry - buffers.data();
+    }
+    return entry;
+}
 
-        if (entry.addr <= base && base + length <= entry.addr + entry.length)
-            return &entry;
+BufferDesc *SegmentDesc::findBuffer(uint64_t base, uint64_t length,
+                                    const MemoryHandle &handle) {
+    if (type == SegmentType::Memory && base + length >= base) {
+        auto &buffers = std::get<MemorySegmentDesc>(detail).buffers;
+        if (handle.index < buffers.size()) {
+            auto &entry = buffers[handle.index];
+            if (entry.addr == handle.addr &&
+                containsRange(entry, base, length))
+                return &entry;
+        }
     }
-    return nullptr;
+    return findBuffer(base, length);
+}
+
+bool SegmentDesc::getMemoryHandle(uint64_t base, uint64_t length,
+                                  MemoryHandle &handle) {
+    auto entry = findBuffer(base, length);
+    if (!entry) return false;
+    auto &buffers = std::get<MemorySegmentDesc>(detail).buffers;
+    handle.addr = entry->addr;
+    handle.index = entry - buffers.data();
+    return true;
 }
 
 DeviceDesc *SegmentDesc::findDevice(const std::string &name) {
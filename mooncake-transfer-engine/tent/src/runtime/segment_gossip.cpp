@@ -0,0 +1,233 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tent/runtime/segment_gossip.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "tent/common/utils/os.h"
+#include "tent/common/utils/random.h"
+
+namespace mooncake {
+namespace tent {
+using json = nlohmann::json;
+
+json SegmentGossip::toJson(const std::string& name, const Entry& entry) {
+    return {{"name", name}, {"version", entry.version}, {"desc", entry.desc}};
+}
+
+SegmentGossip::SegmentGossip(const std::string& local_name,
+                             const Config& config, SendFunction send)
+    : local_name_(local_name), config_(config), send_(std::move(send)) {}
+
+SegmentGossip::~SegmentGossip() { stop(); }
+
+void SegmentGossip::start() {
+    std::lock_guard<std::mutex> lk(worker_mutex_);
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread([this] {
+        std::unique_lock<std::mutex> lk(worker_mutex_);
+        while (running_) {
+            // Jittered, so that the rounds of the peers do not align
+            auto interval = config_.interval_ms / 2 +
+                            SimpleRandom::Get().next(config_.interval_ms + 1);
+            worker_cv_.wait_for(lk, std::chrono::milliseconds(interval),
+                                [this] { return !running_; });
+            if (!running_) break;
+            lk.unlock();
+            runRound();
+            lk.lock();
+        }
+    });
+}
+
+void SegmentGossip::stop() {
+    {
+        std::lock_guard<std::mutex> lk(worker_mutex_);
+        running_ = false;
+    }
+    worker_cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void SegmentGossip::addPeer(const std::string& name) {
+    if (name.empty() || name == local_name_) return;
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!view_.count(name)) peers_.insert(name);
+}
+
+void SegmentGossip::updateLocal(const std::string& desc) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto& entry = view_[local_name_];
+    if (entry.version && entry.desc == desc) return;
+    // Time based, so that a restarted process supersedes its previous life
+    entry.version =
+        std::max<uint64_t>(entry.version + 1, getCurrentTimeInNano() / 1000);
+    entry.desc = desc;
+    entry.changed_round = round_;
+}
+
+bool SegmentGossip::lookup(const std::string& name, std::string& desc) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = view_.find(name);
+    if (it == view_.end() || it->second.desc.empty()) return false;
+    desc = it->second.desc;
+    return true;
+}
+
+size_t SegmentGossip::numKnown() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return std::count_if(view_.begin(), view_.end(), [](const auto& item) {
+        return !item.second.desc.empty();
+    });
+}
+
+uint64_t SegmentGossip::rumorRoundsLocked() const {
+    size_t nodes = view_.size() + peers_.size() + 1;
+    uint64_t rounds = 1;
+    while ((size_t(1) << rounds) < nodes) rounds++;
+    return rounds + 2;
+}
+
+std::string SegmentGossip::makeRequest() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    json digest = json::object(), entries = json::array();
+    const uint64_t rumor_rounds = rumorRoundsLocked();
+    for (auto& [name, entry] : view_) {
+        digest[name] = entry.version;
+        if (round_ - entry.changed_round < rumor_rounds &&
+            entries.size() < config_.max_entries)
+            entries.push_back(toJson(name, entry));
+    }
+    json request{
+        {"from", local_name_}, {"digest", digest}, {"entries", entries}};
+    return request.dump();
+}
+
+void SegmentGossip::mergeEntries(const json& entries) {
+    if (!entries.is_array()) return;
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto& item : entries) {
+        auto name = item.value("name", std::string());
+        auto version = item.value("version", uint64_t(0));
+        if (name.empty() || !version) continue;
+        if (name == local_name_) {
+            // Left by a previous life of this process, supersede it
+            auto& local = view_[local_name_];
+            if (version >= local.version) {
+                local.version = version + 1;
+                local.changed_round = round_;
+            }
+            continue;
+        }
+        auto it = view_.find(name);
+        if (it != view_.end() && it->second.version >= version) continue;
+        auto& entry = view_[name];
+        entry.version = version;
+        entry.desc = item.value("desc", std::string());
+        entry.changed_round = round_;
+        peers_.erase(name);
+    }
+}
+
+std::vector<std::string> SegmentGossip::pickPeers() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<std::string> candidates;
+    auto usable = [&](const std::string& name) {
+        auto it = failures_.find(name);
+        return it == failures_.end() || it->second.retry_round <= round_;
+    };
+    for (auto& [name, entry] : view_) {
+        if (name != local_name_ && !entry.desc.empty() && usable(name))
+            candidates.push_back(name);
+    }
+    for (auto& name : peers_) {
+        if (usable(name)) candidates.push_back(name);
+    }
+    // Partial Fisher-Yates shuffle
+    size_t count = std::min(config_.fanout, candidates.size());
+    for (size_t i = 0; i < count; ++i) {
+        size_t j = i + SimpleRandom::Get().next(candidates.size() - i);
+        std::swap(candidates[i], candidates[j]);
+    }
+    candidates.resize(count);
+    return candidates;
+}
+
+void SegmentGossip::runRound() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        round_++;
+    }
+    auto peers = pickPeers();
+    if (peers.empty()) return;
+    auto request = makeRequest();
+    for (auto& peer : peers) {
+        std::string response;
+        auto status = send_(peer, request, response);
+        if (!status.ok()) {
+            std::lock_guard<std::mutex> lk(mutex_);
+            auto& failure = failures_[peer];
+            failure.count++;
+            if (failure.count >= config_.max_failures) {
+                // Backs off exponentially, up to 64 rounds
+                int shift = std::min(failure.count - config_.max_failures, 6);
+                failure.retry_round = round_ + (uint64_t(1) << shift);
+            }
+            VLOG(1) << "Gossip with " << peer
+                    << " failed: " << status.ToString();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            failures_.erase(peer);
+        }
+        auto j = json::parse(response, nullptr, false);
+        if (j.is_discarded() || !j.is_object()) continue;
+        if (j.contains("entries")) mergeEntries(j["entries"]);
+    }
+}
+
+void SegmentGossip::onGossip(const std::string_view& request,
+                             std::string& response) {
+    auto j = json::parse(request, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) return;
+    auto from = j.value("from", std::string());
+    addPeer(from);
+    if (j.contains("entries")) mergeEntries(j["entries"]);
+
+    static const json kEmptyDigest = json::object();
+    const json& digest =
+        j.contains("digest") && j["digest"].is_object() ? j["digest"]
+                                                        : kEmptyDigest;
+    json entries = json::array();
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto& [name, entry] : view_) {
+        if (entries.size() >= config_.max_entries) break;
+        // The requester knows itself best
+        if (name == from) continue;
+        auto it = digest.find(name);
+        uint64_t known = it == digest.end() ? 0 : it->get<uint64_t>();
+        if (entry.version > known)
+            entries.push_back(toJson(name, entry));
+    }
+    response = json{{"entries", entries}}.dump();
+}
+
+}  // namespace tent
+}  // namespace mooncake
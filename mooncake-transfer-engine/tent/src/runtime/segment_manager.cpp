@@ -14,9 +14,11 @@
 
 #include "tent/runtime/segment_manager.h"
 
+#include <algorithm>
 #include <cassert>
 #include <filesystem>
 #include <set>
+#include <unordered_set>
 
 #include "tent/common/status.h"
 #include "tent/runtime/control_plane.h"
@@ -26,34 +28,83 @@
 namespace mooncake {
 namespace tent {
 SegmentManager::SegmentManager(std::unique_ptr<SegmentRegistry> agent)
-    : next_id_(1), version_(0), registry_(std::move(agent)) {
+    : table_(std::make_shared<SegmentTable>()),
+      table_epoch_(1),
+      next_id_(1),
+      version_(0),
+      registry_(std::move(agent)) {
     local_desc_ = std::make_shared<SegmentDesc>();
+    push_thread_ = std::thread(&SegmentManager::pushWorker, this);
 }
 
-SegmentManager::~SegmentManager() {}
+SegmentManager::~SegmentManager() {
+    {
+        std::lock_guard<std::mutex> lk(push_mutex_);
+        push_running_ = false;
+    }
+    push_cv_.notify_all();
+    push_thread_.join();
+}
+
+const SegmentManager::SegmentTable &SegmentManager::currentTable() {
+    auto &cache = tl_table_cache_.get();
+    if (cache.epoch != table_epoch_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lk(table_mutex_);
+        cache.table = table_;
+        cache.epoch = table_epoch_.load(std::memory_order_relaxed);
+    }
+    return *cache.table;
+}
+
+bool SegmentManager::lookupName(SegmentID handle, std::string &segment_name) {
+    auto &table = currentTable();
+    auto it = table.id_to_name_map.find(handle);
+    if (it == table.id_to_name_map.end()) return false;
+    segment_name = it->second;
+    return true;
+}
 
 Status SegmentManager::openRemote(SegmentID &handle,
                                   const std::string &segment_name) {
-    RWSpinlock::WriteGuard guard(lock_);
-    if (name_to_id_map_.count(segment_name)) {
-        handle = name_to_id_map_.at(segment_name);
-    } else {
-        handle = next_id_.fetch_add(1, std::memory_order_relaxed);
-        name_to_id_map_[segment_name] = handle;
-        id_to_name_map_[handle] = segment_name;
-        LOG(INFO) << "Opened segment #" << handle << ": " << segment_name;
-        version_.fetch_add(1, std::memory_order_relaxed);
+    {
+        auto &table = currentTable();
+        auto it = table.name_to_id_map.find(segment_name);
+        if (it != table.name_to_id_map.end()) {
+            handle = it->second;
+            return Status::OK();
+        }
+    }
+    std::lock_guard<std::mutex> lk(table_mutex_);
+    auto it = table_->name_to_id_map.find(segment_name);
+    if (it != table_->name_to_id_map.end()) {
+        handle = it->second;
+        return Status::OK();
     }
+    auto table = std::make_shared<SegmentTable>(*table_);
+    handle = next_id_.fetch_add(1, std::memory_order_relaxed);
+    table->name_to_id_map[segment_name] = handle;
+    table->id_to_name_map[handle] = segment_name;
+    table_ = std::move(table);
+    table_epoch_.fetch_add(1, std::memory_order_release);
+    // IDs are never reused, so the thread caches need not be dropped
+    LOG(INFO) << "Opened segment #" << handle << ": " << segment_name;
     return Status::OK();
 }
 
 Status SegmentManager::closeRemote(SegmentID handle) {
-    RWSpinlock::WriteGuard guard(lock_);
-    if (!id_to_name_map_.count(handle))
+    std::lock_guard<std::mutex> lk(table_mutex_);
+    auto it = table_->id_to_name_map.find(handle);
+    if (it == table_->id_to_name_map.end())
         return Status::InvalidArgument("Invalid segment handle" LOC_MARK);
-    auto segment_name = id_to_name_map_[handle];
-    name_to_id_map_.erase(segment_name);
-    id_to_name_map_.erase(handle);
+    auto table = std::make_shared<SegmentTable>(*table_);
+    table->name_to_id_map.erase(it->second);
+    table->id_to_name_map.erase(handle);
+    table_ = std::move(table);
+    table_epoch_.fetch_add(1, std::memory_order_release);
+    {
+        RWSpinlock::WriteGuard cache_guard(shared_cache_lock_);
+        shared_cache_.erase(handle);
+    }
     version_.fetch_add(1, std::memory_order_relaxed);
     return Status::OK();
 }
@@ -70,7 +121,7 @@ Status SegmentManager::getRemoteCached(SegmentDesc *&desc, SegmentID handle) {
     }
     if (!cache.id_to_desc_map.count(handle)) {
         SegmentDescRef desc_ref;
-        auto status = getRemote(desc_ref, handle);
+        auto status = getRemoteShared(desc_ref, handle);
         if (!status.ok()) return status;
         cache.id_to_desc_map[handle] = std::move(desc_ref);
     }
@@ -79,12 +130,93 @@ Status SegmentManager::getRemoteCached(SegmentDesc *&desc, SegmentID handle) {
     return Status::OK();
 }
 
+Status SegmentManager::getRemoteShared(SegmentDescRef &desc,
+                                       SegmentID handle) {
+    auto current_ts = getCurrentTimeInNano();
+    auto fresh = [&](const SharedSegmentEntry &entry) {
+        uint64_t ttl_ms = entry.version ? subscribed_ttl_ms_ : ttl_ms_;
+        return entry.last_refresh >= (uint64_t)current_ts ||
+               current_ts - entry.last_refresh <= ttl_ms * 1000000;
+    };
+    {
+        RWSpinlock::ReadGuard guard(shared_cache_lock_);
+        auto it = shared_cache_.find(handle);
+        if (it != shared_cache_.end() &&
+            (fresh(it->second) || it->second.refreshing)) {
+            desc = it->second.desc;
+            return Status::OK();
+        }
+    }
+    {
+        // Only one thread refreshes an expired entry, the others keep using
+        // the previous descriptor meanwhile
+        RWSpinlock::WriteGuard guard(shared_cache_lock_);
+        auto it = shared_cache_.find(handle);
+        if (it != shared_cache_.end()) {
+            if (fresh(it->second) || it->second.refreshing) {
+                desc = it->second.desc;
+                return Status::OK();
+            }
+            it->second.refreshing = true;
+        }
+    }
+
+    SharedSegmentEntry entry;
+    auto status = fetchRemote(entry, handle);
+    RWSpinlock::WriteGuard guard(shared_cache_lock_);
+    auto it = shared_cache_.find(handle);
+    if (!status.ok()) {
+        if (it != shared_cache_.end()) it->second.refreshing = false;
+        return status;
+    }
+    if (it == shared_cache_.end() || !entry.version ||
+        entry.version >= it->second.version) {
+        shared_cache_[handle] = entry;
+        version_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        // An update pushed during the fetch is newer than the fetched copy
+        it->second.last_refresh = entry.last_refresh;
+        it->second.refreshing = false;
+    }
+    desc = shared_cache_[handle].desc;
+    return Status::OK();
+}
+
+Status SegmentManager::fetchRemote(SharedSegmentEntry &entry,
+                                   SegmentID handle) {
+    CHECK_STATUS(getRemote(entry.desc, handle));
+    entry.version = 0;
+    entry.last_refresh = getCurrentTimeInNano();
+
+    auto local_detail = std::get_if<MemorySegmentDesc>(&local_desc_->detail);
+    auto remote_detail = std::get_if<MemorySegmentDesc>(&entry.desc->detail);
+    if (!local_detail || !remote_detail ||
+        entry.desc->type != SegmentType::Memory)
+        return Status::OK();
+    auto local_addr = local_detail->rpc_server_addr;
+    auto server_addr = remote_detail->rpc_server_addr;
+    if (local_addr.empty() || server_addr.empty()) return Status::OK();
+
+    std::string alias;
+    if (!lookupName(handle, alias)) return Status::OK();
+    std::string response;
+    auto status = ControlClient::subscribeSegment(server_addr, local_addr,
+                                                  alias, response);
+    // Peers without push support are refreshed on TTL expiry only
+    if (!status.ok() || response.empty()) return Status::OK();
+    auto j = json::parse(response);
+    auto desc = std::make_shared<SegmentDesc>();
+    *desc = j.at("desc").get<SegmentDesc>();
+    entry.desc = desc;
+    entry.version = j.at("version").get<uint64_t>();
+    return Status::OK();
+}
+
 Status SegmentManager::getRemote(SegmentDescRef &desc, SegmentID handle) {
-    RWSpinlock::WriteGuard guard(lock_);
-    if (!id_to_name_map_.count(handle)) {
+    std::string segment_name;
+    if (!lookupName(handle, segment_name)) {
         return Status::InvalidArgument("Invalid segment handle" LOC_MARK);
     }
-    auto segment_name = id_to_name_map_[handle];
     if (segment_name.starts_with(kLocalFileSegmentPrefix)) {
         CHECK_STATUS(makeFileRemote(desc, segment_name));
     } else {
@@ -100,11 +232,188 @@ Status SegmentManager::getRemote(SegmentDescRef &desc,
 
 Status SegmentManager::invalidateRemote(SegmentID handle) {
     if (handle == LOCAL_SEGMENT_ID) return Status::OK();
+    std::string segment_name;
+    if (lookupName(handle, segment_name))
+        registry_->invalidateSegmentDesc(segment_name);
     auto &cache = tl_remote_cache_.get();
     if (cache.id_to_desc_map.count(handle)) cache.id_to_desc_map.erase(handle);
+    RWSpinlock::WriteGuard guard(shared_cache_lock_);
+    shared_cache_.erase(handle);
+    version_.fetch_add(1, std::memory_order_relaxed);
     return Status::OK();
 }
 
+Status SegmentManager::prefetchRemote(const std::vector<SegmentID> &handles) {
+    std::vector<SegmentID> missing;
+    std::vector<std::string> names;
+    for (auto handle : handles) {
+        std::string segment_name;
+        if (handle == LOCAL_SEGMENT_ID || !lookupName(handle, segment_name) ||
+            segment_name.starts_with(kLocalFileSegmentPrefix))
+            continue;
+        RWSpinlock::ReadGuard guard(shared_cache_lock_);
+        if (shared_cache_.count(handle)) continue;
+        missing.push_back(handle);
+        names.push_back(segment_name);
+    }
+    if (names.empty()) return Status::OK();
+    std::vector<SegmentDescRef> descs;
+    CHECK_STATUS(registry_->getSegmentDescBatch(names, descs));
+    auto current_ts = getCurrentTimeInNano();
+    RWSpinlock::WriteGuard guard(shared_cache_lock_);
+    for (size_t i = 0; i < missing.size(); ++i) {
+        // Entries added meanwhile are at least as recent
+        if (!descs[i] || shared_cache_.count(missing[i])) continue;
+        SharedSegmentEntry entry;
+        entry.desc = descs[i];
+        entry.last_refresh = current_ts;
+        shared_cache_[missing[i]] = std::move(entry);
+    }
+    version_.fetch_add(1, std::memory_order_relaxed);
+    return Status::OK();
+}
+
+Status SegmentManager::addSubscriber(const std::string &subscriber_addr,
+                                     const std::string &alias,
+                                     std::string &response) {
+    std::lock_guard<std::mutex> lk(publish_mutex_);
+    if (published_desc_.is_null())
+        return Status::InvalidEntry("Local segment not published" LOC_MARK);
+    subscribers_[subscriber_addr] = alias;
+    json j{{"version", published_version_}, {"desc", published_desc_}};
+    response = j.dump();
+    return Status::OK();
+}
+
+Status SegmentManager::applyRemoteUpdate(const std::string_view &update) {
+    auto j = json::parse(update);
+    auto alias = j.at("segment").get<std::string>();
+    auto version = j.at("version").get<uint64_t>();
+    SegmentID handle;
+    {
+        auto &table = currentTable();
+        auto it = table.name_to_id_map.find(alias);
+        if (it == table.name_to_id_map.end()) return Status::OK();
+        handle = it->second;
+    }
+    SegmentDescRef full_desc;
+    if (j.contains("desc")) {
+        full_desc = std::make_shared<SegmentDesc>();
+        *full_desc = j.at("desc").get<SegmentDesc>();
+    }
+
+    RWSpinlock::WriteGuard guard(shared_cache_lock_);
+    auto it = shared_cache_.find(handle);
+    if (it == shared_cache_.end()) return Status::OK();
+    auto &entry = it->second;
+    if (full_desc) {
+        if (version <= entry.version) return Status::OK();
+        entry.desc = full_desc;
+    } else if (!version || !entry.version ||
+               entry.version != j.at("base_version").get<uint64_t>() ||
+               entry.desc->type != SegmentType::Memory) {
+        // Segment deleted or an update was missed, fetch it again on use
+        shared_cache_.erase(it);
+        version_.fetch_add(1, std::memory_order_relaxed);
+        return Status::OK();
+    } else {
+        auto desc = std::make_shared<SegmentDesc>(*entry.desc);
+        auto &buffers = std::get<MemorySegmentDesc>(desc->detail).buffers;
+        auto removed_list = j.at("removed").get<std::vector<uint64_t>>();
+        std::unordered_set<uint64_t> removed(removed_list.begin(),
+                                             removed_list.end());
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                     [&](const BufferDesc &buffer) {
+                                         return removed.count(buffer.addr);
+                                     }),
+                      buffers.end());
+        for (auto &buffer : j.at("added"))
+            buffers.push_back(buffer.get<BufferDesc>());
+        std::sort(buffers.begin(), buffers.end(), compareBufferDesc);
+        entry.desc = desc;
+    }
+    entry.version = version;
+    entry.last_refresh = getCurrentTimeInNano();
+    version_.fetch_add(1, std::memory_order_relaxed);
+    return Status::OK();
+}
+
+void SegmentManager::publishLocal() {
+    json current = *local_desc_;
+    std::lock_guard<std::mutex> lk(publish_mutex_);
+    if (current == published_desc_) return;
+    json update;
+    json previous_rest = published_desc_, current_rest = current;
+    bool as_delta = local_desc_->type == SegmentType::Memory &&
+                    !published_desc_.is_null();
+    if (as_delta) {
+        previous_rest["detail"].erase("buffers");
+        current_rest["detail"].erase("buffers");
+        as_delta = previous_rest == current_rest;
+    }
+    if (as_delta) {
+        // Buffers are keyed by address, a modified one is removed and added
+        std::unordered_map<uint64_t, const json *> previous_buffers;
+        for (auto &buffer : published_desc_["detail"]["buffers"])
+            previous_buffers[buffer.at("addr").get<uint64_t>()] = &buffer;
+        json added = json::array(), removed = json::array();
+        for (auto &buffer : current["detail"]["buffers"]) {
+            auto addr = buffer.at("addr").get<uint64_t>();
+            auto it = previous_buffers.find(addr);
+            if (it != previous_buffers.end()) {
+                bool unchanged = *it->second == buffer;
+                previous_buffers.erase(it);
+                if (unchanged) continue;
+                removed.push_back(addr);
+            }
+            added.push_back(buffer);
+        }
+        for (auto &entry : previous_buffers) removed.push_back(entry.first);
+        update["base_version"] = published_version_;
+        update["added"] = std::move(added);
+        update["removed"] = std::move(removed);
+    } else {
+        update["desc"] = current;
+    }
+    published_desc_ = std::move(current);
+    update["version"] = ++published_version_;
+    for (auto &entry : subscribers_) {
+        update["segment"] = entry.second;
+        enqueuePush(entry.first, update.dump());
+    }
+}
+
+void SegmentManager::enqueuePush(const std::string &server_addr,
+                                 std::string payload) {
+    {
+        std::lock_guard<std::mutex> lk(push_mutex_);
+        push_queue_.emplace_back(server_addr, std::move(payload));
+    }
+    push_cv_.notify_one();
+}
+
+void SegmentManager::pushWorker() {
+    std::unique_lock<std::mutex> lk(push_mutex_);
+    while (true) {
+        push_cv_.wait(lk,
+                      [&] { return !push_running_ || !push_queue_.empty(); });
+        // Pending updates, e.g. the deletion notices, are sent before exit
+        if (push_queue_.empty()) break;
+        auto item = std::move(push_queue_.front());
+        push_queue_.pop_front();
+        lk.unlock();
+        auto status = ControlClient::updateSegment(item.first, item.second);
+        if (!status.ok()) {
+            // The peer falls back to its TTL once it stops hearing from us
+            LOG(WARNING) << "Unable to push segment update to " << item.first
+                         << ": " << status.ToString();
+            std::lock_guard<std::mutex> publish_lk(publish_mutex_);
+            subscribers_.erase(item.first);
+        }
+        lk.lock();
+    }
+}
+
 Status SegmentManager::makeFileRemote(SegmentDescRef &desc,
                                       const std::string &segment_name) {
     std::string path = segment_name.substr(kLocalFileSegmentPrefix.length());
@@ -134,10 +443,21 @@ Status SegmentManager::makeFileRemote(SegmentDescRef &desc,
 }
 
 Status SegmentManager::synchronizeLocal() {
-    return registry_->putSegmentDesc(local_desc_);
+    auto status = registry_->putSegmentDesc(local_desc_);
+    publishLocal();
+    return status;
 }
 
 Status SegmentManager::deleteLocal() {
+    {
+        std::lock_guard<std::mutex> lk(publish_mutex_);
+        for (auto &entry : subscribers_) {
+            json update{{"segment", entry.second}, {"version", 0}};
+            enqueuePush(entry.first, update.dump());
+        }
+        subscribers_.clear();
+        published_desc_ = json();
+    }
     return registry_->deleteSegmentDesc(local_desc_->name);
 }
 
@@ -15,23 +15,39 @@
 #include "tent/runtime/segment_registry.h"
 
 #include <cassert>
+#include <chrono>
 #include <set>
+#include <thread>
 
 #include "tent/common/status.h"
 #include "tent/common/utils/os.h"
+#include "tent/common/utils/random.h"
 #include "tent/runtime/control_plane.h"
 
 namespace mooncake {
 namespace tent {
 
+const static std::string kCommonKeyPrefix = "mooncake/tent/";
+
 static inline std::string getFullMetadataKey(const std::string &segment_name) {
-    const static std::string kCommonKeyPrefix = "mooncake/tent/";
     return kCommonKeyPrefix + segment_name;
 }
 
+Status SegmentRegistry::getSegmentDescBatch(
+    const std::vector<std::string> &segment_names,
+    std::vector<SegmentDescRef> &descs) {
+    descs.assign(segment_names.size(), nullptr);
+    for (size_t i = 0; i < segment_names.size(); ++i) {
+        if (!getSegmentDesc(descs[i], segment_names[i]).ok())
+            descs[i] = nullptr;
+    }
+    return Status::OK();
+}
+
 CentralSegmentRegistry::CentralSegmentRegistry(const std::string &type,
                                                const std::string &servers) {
     plugin_ = MetaStore::Create(type, servers);
+    startWatch();
 }
 
 CentralSegmentRegistry::CentralSegmentRegistry(const std::string &type,
@@ -39,6 +55,75 @@ CentralSegmentRegistry::CentralSegmentRegistry(const std::string &type,
                                                const std::string &password,
                                                uint8_t db_index) {
     plugin_ = MetaStore::Create(type, servers, password, db_index);
+    startWatch();
+}
+
+CentralSegmentRegistry::~CentralSegmentRegistry() {
+    // Stops the change notifications before the cache goes away
+    plugin_.reset();
+}
+
+void CentralSegmentRegistry::startWatch() {
+    if (!plugin_) return;
+    auto status = plugin_->watchPrefix(
+        kCommonKeyPrefix, [this](const std::string &key, bool /* deleted */) {
+            onKeyChanged(key);
+        });
+    if (!status.ok()) {
+        LOG(INFO) << "Segment descriptors are not cached: "
+                  << status.ToString();
+        return;
+    }
+    std::lock_guard<std::mutex> lk(cache_mutex_);
+    watching_ = true;
+}
+
+void CentralSegmentRegistry::onKeyChanged(const std::string &key) {
+    std::lock_guard<std::mutex> lk(cache_mutex_);
+    generation_++;
+    if (key.empty()) {
+        // Changes may have been missed
+        cache_.clear();
+    } else if (key.starts_with(kCommonKeyPrefix)) {
+        cache_.erase(key.substr(kCommonKeyPrefix.size()));
+    }
+}
+
+bool CentralSegmentRegistry::lookupCache(const std::string &segment_name,
+                                         SegmentDescRef &desc) {
+    std::lock_guard<std::mutex> lk(cache_mutex_);
+    auto it = cache_.find(segment_name);
+    if (it == cache_.end()) return false;
+    if (getCurrentTimeInNano() > it->second.expire_ts) {
+        cache_.erase(it);
+        return false;
+    }
+    desc = it->second.desc;
+    return true;
+}
+
+void CentralSegmentRegistry::insertCache(const std::string &segment_name,
+                                         const SegmentDescRef &desc,
+                                         uint64_t generation) {
+    std::lock_guard<std::mutex> lk(cache_mutex_);
+    if (!watching_ || generation != generation_) return;
+    cache_[segment_name] = {desc,
+                            getCurrentTimeInNano() + kCacheLeaseMs * 1000000};
+}
+
+Status CentralSegmentRegistry::withBackoff(const std::function<Status()> &op) {
+    Status status;
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+        if (attempt) {
+            uint64_t cap_ms = kBaseBackoffMs << attempt;
+            std::this_thread::sleep_for(std::chrono::milliseconds(
+                SimpleRandom::Get().next(cap_ms) + 1));
+        }
+        status = op();
+        // Missing keys and malformed values are not transient
+        if (!status.IsMetadataError()) break;
+    }
+    return status;
 }
 
 Status CentralSegmentRegistry::getSegmentDesc(SegmentDescRef &desc,
@@ -48,11 +133,58 @@ Status CentralSegmentRegistry::getSegmentDesc(SegmentDescRef &desc,
             "Central metadata store not started" LOC_MARK);
     std::string jstr;
     desc = nullptr;
+    if (lookupCache(segment_name, desc)) return Status::OK();
 
-    auto status = plugin_->get(getFullMetadataKey(segment_name), jstr);
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lk(cache_mutex_);
+        generation = generation_;
+    }
+    auto status = withBackoff(
+        [&] { return plugin_->get(getFullMetadataKey(segment_name), jstr); });
     if (!status.ok()) return status;
     desc = std::make_shared<SegmentDesc>();
     *desc = json::parse(jstr).get<SegmentDesc>();
+    insertCache(segment_name, desc, generation);
+    return Status::OK();
+}
+
+Status CentralSegmentRegistry::getSegmentDescBatch(
+    const std::vector<std::string> &segment_names,
+    std::vector<SegmentDescRef> &descs) {
+    if (!plugin_)
+        return Status::MetadataError(
+            "Central metadata store not started" LOC_MARK);
+    descs.assign(segment_names.size(), nullptr);
+    std::vector<size_t> missing;
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < segment_names.size(); ++i) {
+        if (lookupCache(segment_names[i], descs[i])) continue;
+        missing.push_back(i);
+        keys.push_back(getFullMetadataKey(segment_names[i]));
+    }
+    if (keys.empty()) return Status::OK();
+
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lk(cache_mutex_);
+        generation = generation_;
+    }
+    std::vector<std::string> values;
+    CHECK_STATUS(withBackoff([&] { return plugin_->getBatch(keys, values); }));
+    for (size_t j = 0; j < missing.size(); ++j) {
+        if (values[j].empty()) continue;
+        auto i = missing[j];
+        auto j_desc = json::parse(values[j], nullptr, false);
+        if (j_desc.is_discarded()) {
+            LOG(WARNING) << "Malformed descriptor of segment "
+                         << segment_names[i];
+            continue;
+        }
+        descs[i] = std::make_shared<SegmentDesc>();
+        *descs[i] = j_desc.get<SegmentDesc>();
+        insertCache(segment_names[i], descs[i], generation);
+    }
     return Status::OK();
 }
 
@@ -61,7 +193,9 @@ Status CentralSegmentRegistry::putSegmentDesc(SegmentDescRef &desc) {
         return Status::MetadataError(
             "Central metadata store not started" LOC_MARK);
     json j = *desc;
-    return plugin_->set(getFullMetadataKey(desc->name), j.dump());
+    auto value = j.dump();
+    return withBackoff(
+        [&] { return plugin_->set(getFullMetadataKey(desc->name), value); });
 }
 
 Status CentralSegmentRegistry::deleteSegmentDesc(
@@ -69,7 +203,8 @@ Status CentralSegmentRegistry::deleteSegmentDesc(
     if (!plugin_)
         return Status::MetadataError(
             "Central metadata store not started" LOC_MARK);
-    return plugin_->remove(getFullMetadataKey(segment_name));
+    return withBackoff(
+        [&] { return plugin_->remove(getFullMetadataKey(segment_name)); });
 }
 
 Status PeerSegmentRegistry::getSegmentDesc(SegmentDescRef &desc,
@@ -77,7 +212,17 @@ Status PeerSegmentRegistry::getSegmentDesc(SegmentDescRef &desc,
     std::string response;
     if (segment_name.empty())
         return Status::InvalidArgument("Empty segment name" LOC_MARK);
-    CHECK_STATUS(ControlClient::getSegmentDesc(segment_name, response));
+    auto gossip = getGossip();
+    bool bypass = false;
+    if (gossip) {
+        std::lock_guard<std::mutex> lock(gossip_mutex_);
+        bypass = bypass_.erase(segment_name) > 0;
+    }
+    if (!gossip || bypass || !gossip->lookup(segment_name, response)) {
+        CHECK_STATUS(ControlClient::getSegmentDesc(segment_name, response));
+        // In P2P mode the segment name is the address of its owner
+        if (gossip) gossip->addPeer(segment_name);
+    }
     if (response.empty()) {
         return Status::InvalidEntry(std::string("Segment ") + segment_name +
                                     "not found" + LOC_MARK);
@@ -87,5 +232,42 @@ Status PeerSegmentRegistry::getSegmentDesc(SegmentDescRef &desc,
     return Status::OK();
 }
 
+Status PeerSegmentRegistry::putSegmentDesc(SegmentDescRef &desc) {
+    auto gossip = getGossip();
+    if (gossip) {
+        json j = *desc;
+        gossip->updateLocal(j.dump());
+    }
+    return Status::OK();
+}
+
+Status PeerSegmentRegistry::deleteSegmentDesc(
+    const std::string &segment_name) {
+    auto gossip = getGossip();
+    if (gossip) {
+        gossip->updateLocal("");
+        // Tell a few peers before the process goes away
+        gossip->runRound();
+    }
+    return Status::OK();
+}
+
+void PeerSegmentRegistry::invalidateSegmentDesc(
+    const std::string &segment_name) {
+    std::lock_guard<std::mutex> lock(gossip_mutex_);
+    if (gossip_) bypass_.insert(segment_name);
+}
+
+void PeerSegmentRegistry::setGossip(std::shared_ptr<SegmentGossip> gossip) {
+    std::lock_guard<std::mutex> lock(gossip_mutex_);
+    gossip_ = std::move(gossip);
+    bypass_.clear();
+}
+
+std::shared_ptr<SegmentGossip> PeerSegmentRegistry::getGossip() {
+    std::lock_guard<std::mutex> lock(gossip_mutex_);
+    return gossip_;
+}
+
 }  // namespace tent
 }  // namespace mooncake
@@ -62,6 +62,7 @@ Status SegmentTracker::add(uint64_t base, size_t length,
     BufferDesc new_desc;
     new_desc.addr = base;
     new_desc.length = length;
+    Platform::getLoader().addKnownRange((void*)base, length);
     auto entries = Platform::getLoader().getLocation((void*)base, length);
     if (entries.size() == 1)
         new_desc.location = entries[0].location;
@@ -76,11 +77,7 @@ Status SegmentTracker::add(uint64_t base, size_t length,
     mutex_.lock();
     detail.buffers.push_back(new_desc);
     std::sort(detail.buffers.begin(), detail.buffers.end(),
-              [](const BufferDesc& lhs, BufferDesc& rhs) -> bool {
-                  if (lhs.addr < rhs.addr) return true;
-                  if (lhs.addr > rhs.addr) return false;
-                  return lhs.length > rhs.length;  // prefer large interval
-              });
+              compareBufferDesc);
     mutex_.unlock();
     return Status::OK();
 }
@@ -110,6 +107,7 @@ Status SegmentTracker::addInBatch(
         BufferDesc new_desc;
         new_desc.addr = base;
         new_desc.length = length;
+        Platform::getLoader().addKnownRange((void*)base, length);
         auto entries = Platform::getLoader().getLocation((void*)base, length);
         if (entries.size() == 1)
             new_desc.location = entries[0].location;
@@ -134,11 +132,7 @@ Status SegmentTracker::addInBatch(
             detail.buffers.push_back(new_desc);
         }
         std::sort(detail.buffers.begin(), detail.buffers.end(),
-                  [](const BufferDesc& lhs, BufferDesc& rhs) -> bool {
-                      if (lhs.addr < rhs.addr) return true;
-                      if (lhs.addr > rhs.addr) return false;
-                      return lhs.length > rhs.length;  // prefer large interval
-                  });
+                  compareBufferDesc);
     }
     return Status::OK();
 }
@@ -156,6 +150,7 @@ Status SegmentTracker::remove(uint64_t base, size_t length,
                 BufferDesc clone = *it;
                 detail.buffers.erase(it);
                 mutex_.unlock();
+                Platform::getLoader().removeKnownRange((void*)base);
                 status = callback(clone);
             } else {
                 mutex_.unlock();
@@ -167,6 +162,15 @@ Status SegmentTracker::remove(uint64_t base, size_t length,
     return Status::OK();
 }
 
+Status SegmentTracker::getMemoryHandle(uint64_t base, size_t length,
+                                       MemoryHandle& handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!local_desc_->getMemoryHandle(base, length, handle))
+        return Status::AddressNotRegistered(
+            "No matched buffer in given address range" LOC_MARK);
+    return Status::OK();
+}
+
 Status SegmentTracker::forEach(std::function<Status(BufferDesc&)> callback) {
     std::lock_guard<std::mutex> lock(mutex_);
     assert(local_desc_->type == SegmentType::Memory);
@@ -14,8 +14,13 @@
 
 #include "tent/runtime/slab.h"
 
-#include <atomic>
+#include <glog/logging.h>
+#include <numa.h>
+#include <sched.h>
+
+#include <algorithm>
 #include <unordered_map>
+#include <utility>
 
 namespace mooncake {
 namespace tent {
@@ -23,45 +28,141 @@ namespace tent {
 static std::atomic<int> g_next_slab_index(0);
 thread_local std::unordered_map<int, SlabBase::ThreadLocal> tl_slice_set;
 
+// The stack head packs a magazine pointer into the low 48 bits, which user
+// space addresses fit in, and a tag into the high 16 bits
+static const int kTagShift = 48;
+static const uint64_t kPointerMask = (uint64_t(1) << kTagShift) - 1;
+
+static inline SlabBase::Magazine *headPointer(uint64_t head) {
+    return reinterpret_cast<SlabBase::Magazine *>(head & kPointerMask);
+}
+
+static inline uint64_t makeHead(SlabBase::Magazine *magazine,
+                                uint64_t old_head) {
+    const uint64_t tag = (old_head >> kTagShift) + 1;
+    return (tag << kTagShift) | reinterpret_cast<uint64_t>(magazine);
+}
+
+// Found once per thread; threads are bound to a socket when they start
+static int currentNumaNode() {
+    thread_local int node = [] {
+        if (numa_available() < 0) return 0;
+        int cpu = sched_getcpu();
+        if (cpu < 0) return 0;
+        return std::max(numa_node_of_cpu(cpu), 0);
+    }();
+    return node;
+}
+
+void SlabBase::MagazineStack::push(Magazine *magazine) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    do {
+        magazine->next.store(headPointer(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, makeHead(magazine, head),
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+}
+
+SlabBase::Magazine *SlabBase::MagazineStack::pop() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (headPointer(head)) {
+        // May be popped and pushed again in the meantime, then the tag
+        // fails the exchange
+        Magazine *next =
+            headPointer(head)->next.load(std::memory_order_relaxed);
+        if (head_.compare_exchange_weak(head, makeHead(next, head),
+                                        std::memory_order_acquire,
+                                        std::memory_order_acquire))
+            return headPointer(head);
+    }
+    return nullptr;
+}
+
 SlabBase::SlabBase(size_t block_size) : block_size_(block_size) {
     slab_index_ = g_next_slab_index.fetch_add(1);
+    num_depots_ = numa_available() < 0 ? 1 : numa_max_node() + 1;
+    depots_ = std::make_unique<Depot[]>(num_depots_);
 }
 
-void *SlabBase::allocate() {
-    auto &tl_slice = tl_slice_set[slab_index_];
-    void *object = nullptr;
-    if (tl_slice.dequeue(object)) return object;
+SlabBase::~SlabBase() {
+    for (auto entry : alloc_list_) free(entry);
+    alloc_list_.clear();
+    for (auto magazine : magazine_list_) delete magazine;
+    magazine_list_.clear();
+}
 
-    std::lock_guard<std::mutex> global_lock(mutex_);
-    while (!tl_slice.full() && !free_list_.empty()) {
-        tl_slice.enqueue(free_list_.front());
-        free_list_.pop_front();
+SlabBase::Depot &SlabBase::localDepot() {
+    return depots_[currentNumaNode() % num_depots_];
+}
+
+SlabBase::Magazine *SlabBase::popFull() {
+    const size_t local = currentNumaNode() % num_depots_;
+    for (size_t i = 0; i < num_depots_; ++i) {
+        auto magazine = depots_[(local + i) % num_depots_].full.pop();
+        if (magazine) return magazine;
     }
+    return nullptr;
+}
 
-    if (tl_slice.empty()) {
-        void *slab = malloc(kAllocateBatchSize * block_size_);
-        if (!slab) return nullptr;
+SlabBase::Magazine *SlabBase::newMagazine() {
+    auto magazine = new Magazine();
+    CHECK_EQ(reinterpret_cast<uint64_t>(magazine) & ~kPointerMask, 0u)
+        << "Magazine address does not fit in 48 bits";
+    std::lock_guard<std::mutex> lock(mutex_);
+    magazine_list_.push_back(magazine);
+    return magazine;
+}
+
+SlabBase::Magazine *SlabBase::newFullMagazine() {
+    void *slab = malloc(kAllocateBatchSize * block_size_);
+    if (!slab) return nullptr;
+    auto magazine = localDepot().empty.pop();
+    if (!magazine) magazine = newMagazine();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
         alloc_list_.push_back(slab);
-        for (size_t i = 0; i < kAllocateBatchSize; ++i)
-            tl_slice.enqueue((char *)slab + i * block_size_);
     }
+    for (size_t i = 0; i < kAllocateBatchSize; ++i)
+        magazine->objects[i] = (char *)slab + i * block_size_;
+    magazine->count = kAllocateBatchSize;
+    return magazine;
+}
 
-    tl_slice.dequeue(object);
-    return object;
+void *SlabBase::allocate() {
+    auto &tl_slice = tl_slice_set[slab_index_];
+    if (!tl_slice.loaded || tl_slice.loaded->empty()) {
+        if (tl_slice.previous && !tl_slice.previous->empty()) {
+            std::swap(tl_slice.loaded, tl_slice.previous);
+        } else {
+            auto magazine = popFull();
+            if (!magazine) magazine = newFullMagazine();
+            if (!magazine) return nullptr;
+            if (tl_slice.previous) localDepot().empty.push(tl_slice.previous);
+            tl_slice.previous = tl_slice.loaded;
+            tl_slice.loaded = magazine;
+        }
+    }
+    auto magazine = tl_slice.loaded;
+    return magazine->objects[--magazine->count];
 }
 
 void SlabBase::deallocate(void *object) {
     auto &tl_slice = tl_slice_set[slab_index_];
-    if (tl_slice.full()) {
-        std::lock_guard<std::mutex> global_lock(mutex_);
-        while (!tl_slice.empty()) {
-            void *object = nullptr;
-            tl_slice.dequeue(object);
-            free_list_.push_back(object);
+    if (!tl_slice.loaded || tl_slice.loaded->full()) {
+        if (tl_slice.previous && !tl_slice.previous->full()) {
+            std::swap(tl_slice.loaded, tl_slice.previous);
+        } else {
+            auto &depot = localDepot();
+            auto magazine = depot.empty.pop();
+            if (!magazine) magazine = newMagazine();
+            if (tl_slice.previous) depot.full.push(tl_slice.previous);
+            tl_slice.previous = tl_slice.loaded;
+            tl_slice.loaded = magazine;
         }
     }
-    tl_slice.enqueue(object);
+    auto magazine = tl_slice.loaded;
+    magazine->objects[magazine->count++] = object;
 }
 
 }  // namespace tent
-}  // namespace mooncake
\ No newline at end of file
+}  // namespace mooncake
@@ -185,6 +185,17 @@ Status TransferEngineImpl::construct() {
     else if (local_segment_name_.empty())
         local_segment_name_ = randomSegmentName();
 
+    if (metadata_type == "p2p" && conf_->get("gossip/enable", false)) {
+        SegmentGossip::Config gossip_config;
+        gossip_config.interval_ms =
+            conf_->get("gossip/interval_ms", gossip_config.interval_ms);
+        gossip_config.fanout =
+            conf_->get("gossip/fanout", gossip_config.fanout);
+        auto seeds = conf_->getArray<std::string>("gossip/seeds");
+        CHECK_STATUS(metadata_->enableGossip(local_segment_name_,
+                                             gossip_config, seeds));
+    }
+
     CHECK_STATUS(setupLocalSegment());
     CHECK_STATUS(loadTransports());
 
@@ -310,6 +321,20 @@ Status TransferEngineImpl::closeSegment(SegmentID handle) {
     return metadata_->segmentManager().closeRemote(handle);
 }
 
+Status TransferEngineImpl::warmupSegments(
+    const std::vector<SegmentID>& handles) {
+    // One round trip to the metadata store instead of one per segment
+    auto result = metadata_->segmentManager().prefetchRemote(handles);
+    if (!result.ok())
+        LOG(WARNING) << "Unable to prefetch segments: " << result.ToString();
+    for (auto& transport : transport_list_) {
+        if (!transport) continue;
+        auto status = transport->warmupSegments(handles);
+        if (!status.ok()) result = status;
+    }
+    return result;
+}
+
 Status TransferEngineImpl::getSegmentInfo(SegmentID handle, SegmentInfo& info) {
     SegmentDesc* desc = nullptr;
     if (handle == LOCAL_SEGMENT_ID) {
@@ -459,6 +484,7 @@ Status TransferEngineImpl::registerLocalMemory(std::vector<void*> addr_list,
             }
             return Status::OK();
         });
+    local_epoch_.fetch_add(1, std::memory_order_release);
     if (!status.ok()) return status;
     // Synchronize local segment to metadata server so remote peers can see the
     // new buffers
@@ -478,11 +504,18 @@ Status TransferEngineImpl::unregisterLocalMemory(void* addr, size_t size) {
             }
             return Status::OK();
         });
+    local_epoch_.fetch_add(1, std::memory_order_release);
     if (!status.ok()) return status;
     if (!removed) return Status::OK();
     return metadata_->segmentManager().synchronizeLocal();
 }
 
+Status TransferEngineImpl::getMemoryHandle(void* addr, size_t size,
+                                           MemoryHandle& handle) {
+    return local_segment_tracker_->getMemoryHandle((uint64_t)addr, size,
+                                                   handle);
+}
+
 Status TransferEngineImpl::unregisterLocalMemory(
     std::vector<void*> addr_list, std::vector<size_t> size_list) {
     if (!size_list.empty() && addr_list.size() != size_list.size()) {
@@ -502,6 +535,7 @@ Status TransferEngineImpl::unregisterLocalMemory(
                 }
                 return Status::OK();
             });
+        local_epoch_.fetch_add(1, std::memory_order_release);
         if (!status.ok()) return status;
         if (removed) removed_any = true;
     }
@@ -740,14 +774,57 @@ void TransferEngineImpl::findStagingPolicy(const Request& request,
     }
 }
 
+bool TransferEngineImpl::makeTransportCacheKey(const Request& req,
+                                               TransportCacheKey& key) {
+    auto& manager = metadata_->segmentManager();
+    auto local = manager.getLocal();
+    auto source = local->findBuffer((uint64_t)req.source, req.length,
+                                    req.source_handle);
+    if (!source) return false;
+    SegmentDesc* desc = local.get();
+    if (req.target_id != LOCAL_SEGMENT_ID &&
+        !manager.getRemoteCached(desc, req.target_id).ok())
+        return false;
+    key.source_base = source->addr;
+    key.target_id = req.target_id;
+    key.target_base = 0;  // files are served alike at any offset
+    if (desc->type == SegmentType::Memory) {
+        auto target = desc->findBuffer(req.target_offset, req.length);
+        if (!target) return false;
+        key.target_base = target->addr;
+    }
+    return true;
+}
+
 TransportType TransferEngineImpl::resolveTransport(const Request& req,
                                                    int priority,
                                                    bool invalidate_on_fail) {
+    const static size_t kMaxCachedTransports = 4096;
+    TransportCacheKey key;
+    TransportCache* cache = nullptr;
+    // Fallbacks to lower priority transports are rare, left uncached
+    if (priority == 0 && makeTransportCacheKey(req, key)) {
+        cache = &transport_cache_.get();
+        auto local_epoch = local_epoch_.load(std::memory_order_acquire);
+        auto remote_version = metadata_->segmentManager().remoteVersion();
+        if (cache->owner != this || cache->local_epoch != local_epoch ||
+            cache->remote_version != remote_version ||
+            cache->entries.size() >= kMaxCachedTransports) {
+            cache->entries.clear();
+            cache->owner = this;
+            cache->local_epoch = local_epoch;
+            cache->remote_version = remote_version;
+        }
+        auto it = cache->entries.find(key);
+        if (it != cache->entries.end()) return it->second;
+    }
     auto type = getTransportType(req, priority);
     if (type == UNSPEC && invalidate_on_fail) {
         metadata_->segmentManager().invalidateRemote(req.target_id);
         type = getTransportType(req, priority);
     }
+    // Stamped with the versions read before, so a change meanwhile drops it
+    if (cache && type != UNSPEC) cache->entries[key] = type;
     return type;
 }
 
@@ -1115,6 +1192,7 @@ void TransferEngineImpl::recordTaskCompletionMetrics(
                     TentMetrics::instance().recordWriteCompleted(
                         task.request.length, latency_seconds);
                 }
+                recordTaskLatencyBreakdown(task, latency_seconds);
             } else if (new_status == FAILED) {
                 if (task.request.opcode == Request::READ) {
                     TentMetrics::instance().recordReadFailed(
@@ -1130,5 +1208,27 @@ void TransferEngineImpl::recordTaskCompletionMetrics(
     }
 }
 
+void TransferEngineImpl::recordTaskLatencyBreakdown(const TaskInfo& task,
+                                                    double latency_seconds) {
+    if (!TentMetrics::isEnabled()) return;
+    const char* transport = "unspec";
+    if (task.staging)
+        transport = "staging";
+    else if (task.type < kSupportedTransportTypes && transport_list_[task.type])
+        transport = transport_list_[task.type]->getName();
+    SegmentID target_id = task.request.target_id;
+    if (target_id == LOCAL_SEGMENT_ID) {
+        TentMetrics::instance().recordTaskLatency(
+            transport, local_segment_name_, task.request.length,
+            latency_seconds);
+        return;
+    }
+    SegmentDesc* desc = nullptr;
+    auto status = metadata_->segmentManager().getRemoteCached(desc, target_id);
+    if (!status.ok() || !desc) return;
+    TentMetrics::instance().recordTaskLatency(
+        transport, desc->name, task.request.length, latency_seconds);
+}
+
 }  // namespace tent
 }  // namespace mooncake
@@ -73,6 +73,10 @@ Status TransferEngine::getSegmentInfo(SegmentID handle, SegmentInfo& info) {
     return impl_->getSegmentInfo(handle, info);
 }
 
+Status TransferEngine::warmupSegments(const std::vector<SegmentID>& handles) {
+    return impl_->warmupSegments(handles);
+}
+
 Status TransferEngine::allocateLocalMemory(void** addr, size_t size,
                                            Location location) {
     return impl_->allocateLocalMemory(addr, size, location);
@@ -121,6 +125,11 @@ Status TransferEngine::unregisterLocalMemory(std::vector<void*> addr_list,
     return impl_->unregisterLocalMemory(addr_list, size_list);
 }
 
+Status TransferEngine::getMemoryHandle(void* addr, size_t size,
+                                       MemoryHandle& handle) {
+    return impl_->getMemoryHandle(addr, size, handle);
+}
+
 BatchID TransferEngine::allocateBatch(size_t batch_size) {
     return impl_->allocateBatch(batch_size);
 }
@@ -473,3 +473,48 @@ int tent_task_status_list(tent_engine_t engine, tent_batch_id_t batch_id,
     *count = status_list.size();
     return 0;
 }
+
+int tent_register_memory_handle(tent_engine_t engine, void* addr, size_t size,
+                                tent_memory_handle_t* handle) {
+    CHECK_POINTER(engine);
+    CHECK_POINTER(addr);
+    CHECK_POINTER(handle);
+    auto status = CAST(engine)->registerLocalMemory(addr, size);
+    mooncake::tent::MemoryHandle result;
+    if (status.ok())
+        status = CAST(engine)->getMemoryHandle(addr, size, result);
+    if (!status.ok()) {
+        LOG(ERROR) << "tent_register_memory_handle: " << status.ToString();
+        return -1;
+    }
+    handle->addr = result.addr;
+    handle->index = result.index;
+    return 0;
+}
+
+int tent_submit_with_handles(tent_engine_t engine, tent_batch_id_t batch_id,
+                             tent_request_t* entries,
+                             tent_memory_handle_t* handles, size_t count) {
+    CHECK_POINTER(engine);
+    CHECK_POINTER(entries);
+    std::vector<mooncake::tent::Request> req_list;
+    req_list.resize(count);
+    for (size_t index = 0; index < count; index++) {
+        req_list[index].opcode =
+            (mooncake::tent::Request::OpCode)entries[index].opcode;
+        req_list[index].source = entries[index].source;
+        req_list[index].target_id = entries[index].target_id;
+        req_list[index].target_offset = entries[index].target_offset;
+        req_list[index].length = entries[index].length;
+        if (handles) {
+            req_list[index].source_handle.addr = handles[index].addr;
+            req_list[index].source_handle.index = handles[index].index;
+        }
+    }
+    auto status = CAST(engine)->submitTransfer(batch_id, req_list);
+    if (!status.ok()) {
+        LOG(ERROR) << "tent_submit_with_handles: " << status.ToString();
+        return -1;
+    }
+    return 0;
+}
@@ -31,15 +31,19 @@
 namespace mooncake {
 namespace tent {
 
+static constexpr size_t kDirectIoAlignment = 4096;
+
 class BufIoFileContext {
    public:
     explicit BufIoFileContext(const std::string& path)
-        : fd_(-1), ready_(false) {
+        : fd_(-1), direct_fd_(-1), ready_(false) {
         fd_ = ::open(path.c_str(), O_RDWR);
         if (fd_ < 0) {
             PLOG(ERROR) << "BufIoTransport: failed to open file " << path;
             return;
         }
+        // Not every file system supports O_DIRECT, reads stay buffered then
+        direct_fd_ = ::open(path.c_str(), O_RDWR | O_DIRECT);
         ready_ = true;
     }
 
@@ -50,14 +54,29 @@ class BufIoFileContext {
         if (fd_ >= 0) {
             ::close(fd_);
         }
+        if (direct_fd_ >= 0) {
+            ::close(direct_fd_);
+        }
     }
 
     int getHandle() const { return fd_; }
+    int getDirectHandle() const { return direct_fd_; }
     bool ready() const { return ready_; }
 
+    // Whether the read continues the previous one of the file
+    bool continuesStream(uint64_t offset, size_t length) {
+        return next_offset_.exchange(offset + length,
+                                     std::memory_order_relaxed) == offset;
+    }
+
+    std::atomic<uint64_t>& readaheadEnd() { return readahead_end_; }
+
    private:
     int fd_;
+    int direct_fd_;
     bool ready_;
+    std::atomic<uint64_t> next_offset_{UINT64_MAX};
+    std::atomic<uint64_t> readahead_end_{0};
 };
 
 BufIoTransport::BufIoTransport() : installed_(false) {}
@@ -78,6 +97,20 @@ Status BufIoTransport::install(std::string& local_segment_name,
     local_topology_ = local_topology;
     conf_ = conf;
 
+    direct_io_threshold_ =
+        conf_->get("transports/bufio/direct_io_threshold", 8ull << 20);
+    bounce_buffer_size_ =
+        conf_->get("transports/bufio/bounce_buffer_size", 4ull << 20);
+    bounce_buffer_size_ = std::max(
+        bounce_buffer_size_ / kDirectIoAlignment * kDirectIoAlignment,
+        kDirectIoAlignment);
+    readahead_bytes_ =
+        conf_->get("transports/bufio/readahead_bytes", 16ull << 20);
+    parallel_threshold_ =
+        conf_->get("transports/bufio/parallel_threshold", 1ull << 20);
+    size_t io_threads = conf_->get("transports/bufio/io_threads", 4);
+    if (io_threads) io_pool_ = std::make_unique<ThreadPool>(io_threads);
+
     installed_ = true;
     caps.dram_to_file = true;
     if (Platform::getLoader().type() == "cuda") {
@@ -89,6 +122,7 @@ Status BufIoTransport::install(std::string& local_segment_name,
 
 Status BufIoTransport::uninstall() {
     if (installed_) {
+        io_pool_.reset();  // finishes the queued tasks
         RWSpinlock::WriteGuard guard(file_context_lock_);
         file_context_map_.clear();
         metadata_.reset();
@@ -121,6 +155,8 @@ Status BufIoTransport::freeSubBatch(SubBatchRef& batch) {
     if (!buf_batch) {
         return Status::InvalidArgument("Invalid BufIo sub-batch" LOC_MARK);
     }
+    while (buf_batch->inflight_tasks.load(std::memory_order_acquire))
+        std::this_thread::yield();
     delete buf_batch;
     batch = nullptr;
     return Status::OK();
@@ -173,8 +209,7 @@ Status BufIoTransport::submitTransferTasks(
         return Status::TooManyRequests("Exceed batch capacity" LOC_MARK);
     }
 
-    auto& platform = Platform::getLoader();
-
+    bool parallel = io_pool_ && request_list.size() > 1;
     for (const auto& req : request_list) {
         buf_batch->task_list.emplace_back();
         auto& task = buf_batch->task_list.back();
@@ -190,83 +225,171 @@ Status BufIoTransport::submitTransferTasks(
             continue;
         }
 
-        int fd = ctx->getHandle();
-        if (fd < 0) {
-            task.status_word = TransferStatusEnum::FAILED;
-            LOG(WARNING) << "BufIoTransport: invalid file descriptor";
-            continue;
+        // Small reads stay inline, they mostly hit the page cache
+        if (parallel && req.length >= parallel_threshold_) {
+            buf_batch->inflight_tasks.fetch_add(1, std::memory_order_relaxed);
+            io_pool_->enqueue([this, buf_batch, &task, ctx] {
+                runTask(task, ctx);
+                buf_batch->inflight_tasks.fetch_sub(1,
+                                                    std::memory_order_release);
+            });
+        } else {
+            runTask(task, ctx);
         }
+    }
+
+    return Status::OK();
+}
+
+void BufIoTransport::readAhead(BufIoFileContext* ctx, uint64_t offset,
+                               size_t length) {
+    if (!readahead_bytes_ || !ctx->continuesStream(offset, length)) return;
+    // Keep a window of the stream ahead in the page cache, advising it again
+    // once half of it has been consumed
+    uint64_t end = offset + length;
+    auto& readahead_end = ctx->readaheadEnd();
+    uint64_t advised = readahead_end.load(std::memory_order_relaxed);
+    if (advised > end + readahead_bytes_ / 2) return;
+    uint64_t start = std::max(advised, end);
+    if (!readahead_end.compare_exchange_strong(advised, end + readahead_bytes_,
+                                               std::memory_order_relaxed))
+        return;
+    posix_fadvise(ctx->getHandle(), static_cast<off_t>(start),
+                  static_cast<off_t>(end + readahead_bytes_ - start),
+                  POSIX_FADV_WILLNEED);
+}
+
+ssize_t BufIoTransport::readDirect(int fd, void* dst, uint64_t offset,
+                                   size_t length, bool host_memory) {
+    const uint64_t kMask = kDirectIoAlignment - 1;
+    if (host_memory && !((uint64_t)dst & kMask) && !(offset & kMask) &&
+        !(length & kMask))
+        return ::pread(fd, dst, length, static_cast<off_t>(offset));
+
+    struct FreeDeleter {
+        void operator()(void* ptr) const { free(ptr); }
+    };
+    thread_local std::unique_ptr<void, FreeDeleter> tl_bounce_buffer;
+    thread_local size_t tl_bounce_size = 0;
+    if (tl_bounce_size != bounce_buffer_size_) {
+        void* ptr = nullptr;
+        if (posix_memalign(&ptr, kDirectIoAlignment, bounce_buffer_size_))
+            return -1;
+        tl_bounce_buffer.reset(ptr);
+        tl_bounce_size = bounce_buffer_size_;
+    }
+    auto bounce = (char*)tl_bounce_buffer.get();
+    auto& platform = Platform::getLoader();
+    size_t done = 0;
+    while (done < length) {
+        uint64_t aligned_offset = (offset + done) & ~kMask;
+        size_t skip = offset + done - aligned_offset;
+        size_t chunk = std::min(bounce_buffer_size_,
+                                (skip + length - done + kMask) & ~kMask);
+        ssize_t ret =
+            ::pread(fd, bounce, chunk, static_cast<off_t>(aligned_offset));
+        if (ret < 0) return -1;
+        if ((size_t)ret <= skip) break;  // end of file
+        size_t usable = std::min((size_t)ret - skip, length - done);
+        if (host_memory)
+            memcpy((char*)dst + done, bounce + skip, usable);
+        else
+            platform.copy((char*)dst + done, bounce + skip, usable);
+        done += usable;
+        if ((size_t)ret < chunk) break;
+    }
+    return done;
+}
+
+void BufIoTransport::runTask(BufIoTask& task, BufIoFileContext* ctx) {
+    auto& platform = Platform::getLoader();
+    const auto& req = task.request;
+    int fd = ctx->getHandle();
+    if (fd < 0) {
+        task.status_word = TransferStatusEnum::FAILED;
+        LOG(WARNING) << "BufIoTransport: invalid file descriptor";
+        return;
+    }
 
-        MemoryType mtype = platform.getMemoryType(req.source);
-        ssize_t io_ret = 0;
-
-        if (req.opcode == Request::READ) {
-            if (mtype == MTYPE_CUDA) {
-                std::unique_ptr<uint8_t[]> host_buf(new (std::nothrow)
-                                                        uint8_t[req.length]);
-                if (!host_buf) {
-                    task.status_word = TransferStatusEnum::FAILED;
-                    continue;
-                }
-
-                io_ret = ::pread(fd, host_buf.get(), req.length,
-                                 static_cast<off_t>(req.target_offset));
-                if (io_ret < 0) {
-                    PLOG(WARNING) << "BufIoTransport: pread failed";
-                    task.status_word = TransferStatusEnum::FAILED;
-                    continue;
-                }
-
-                platform.copy(req.source, host_buf.get(),
-                              static_cast<size_t>(io_ret));
-            } else {
-                io_ret = ::pread(fd, req.source, req.length,
-                                 static_cast<off_t>(req.target_offset));
-                if (io_ret < 0) {
-                    PLOG(WARNING) << "BufIoTransport: pread failed";
-                    task.status_word = TransferStatusEnum::FAILED;
-                    continue;
-                }
+    MemoryType mtype = platform.getMemoryType(req.source);
+    ssize_t io_ret = 0;
+
+    if (req.opcode == Request::READ && ctx->getDirectHandle() >= 0 &&
+        direct_io_threshold_ && req.length >= direct_io_threshold_) {
+        // Large reads bypass the page cache, they would only evict it
+        io_ret = readDirect(ctx->getDirectHandle(), req.source,
+                            req.target_offset, req.length,
+                            mtype != MTYPE_CUDA);
+        if (io_ret < 0) {
+            PLOG(WARNING) << "BufIoTransport: direct pread failed";
+            task.status_word = TransferStatusEnum::FAILED;
+            return;
+        }
+    } else if (req.opcode == Request::READ) {
+        readAhead(ctx, req.target_offset, req.length);
+        if (mtype == MTYPE_CUDA) {
+            std::unique_ptr<uint8_t[]> host_buf(new (std::nothrow)
+                                                    uint8_t[req.length]);
+            if (!host_buf) {
+                task.status_word = TransferStatusEnum::FAILED;
+                return;
             }
-        } else if (req.opcode == Request::WRITE) {
-            if (mtype == MTYPE_CUDA) {
-                std::unique_ptr<uint8_t[]> host_buf(new (std::nothrow)
-                                                        uint8_t[req.length]);
-                if (!host_buf) {
-                    task.status_word = TransferStatusEnum::FAILED;
-                    continue;
-                }
-
-                platform.copy(host_buf.get(), req.source, req.length);
-
-                io_ret = ::pwrite(fd, host_buf.get(), req.length,
-                                  static_cast<off_t>(req.target_offset));
-                if (io_ret < 0) {
-                    PLOG(WARNING) << "BufIoTransport: pwrite failed";
-                    task.status_word = TransferStatusEnum::FAILED;
-                    continue;
-                }
-            } else {
-                io_ret = ::pwrite(fd, req.source, req.length,
-                                  static_cast<off_t>(req.target_offset));
-                if (io_ret < 0) {
-                    PLOG(WARNING) << "BufIoTransport: pwrite failed";
-                    task.status_word = TransferStatusEnum::FAILED;
-                    continue;
-                }
+
+            io_ret = ::pread(fd, host_buf.get(), req.length,
+                             static_cast<off_t>(req.target_offset));
+            if (io_ret < 0) {
+                PLOG(WARNING) << "BufIoTransport: pread failed";
+                task.status_word = TransferStatusEnum::FAILED;
+                return;
             }
+
+            platform.copy(req.source, host_buf.get(),
+                          static_cast<size_t>(io_ret));
         } else {
-            task.status_word = TransferStatusEnum::FAILED;
-            LOG(WARNING) << "BufIoTransport: unknown opcode " << req.opcode;
-            continue;
+            io_ret = ::pread(fd, req.source, req.length,
+                             static_cast<off_t>(req.target_offset));
+            if (io_ret < 0) {
+                PLOG(WARNING) << "BufIoTransport: pread failed";
+                task.status_word = TransferStatusEnum::FAILED;
+                return;
+            }
         }
+    } else if (req.opcode == Request::WRITE) {
+        if (mtype == MTYPE_CUDA) {
+            std::unique_ptr<uint8_t[]> host_buf(new (std::nothrow)
+                                                    uint8_t[req.length]);
+            if (!host_buf) {
+                task.status_word = TransferStatusEnum::FAILED;
+                return;
+            }
+
+            platform.copy(host_buf.get(), req.source, req.length);
 
-        task.transferred_bytes = static_cast<size_t>(io_ret < 0 ? 0 : io_ret);
-        task.status_word = (io_ret < 0) ? TransferStatusEnum::FAILED
-                                        : TransferStatusEnum::COMPLETED;
+            io_ret = ::pwrite(fd, host_buf.get(), req.length,
+                              static_cast<off_t>(req.target_offset));
+            if (io_ret < 0) {
+                PLOG(WARNING) << "BufIoTransport: pwrite failed";
+                task.status_word = TransferStatusEnum::FAILED;
+                return;
+            }
+        } else {
+            io_ret = ::pwrite(fd, req.source, req.length,
+                              static_cast<off_t>(req.target_offset));
+            if (io_ret < 0) {
+                PLOG(WARNING) << "BufIoTransport: pwrite failed";
+                task.status_word = TransferStatusEnum::FAILED;
+                return;
+            }
+        }
+    } else {
+        task.status_word = TransferStatusEnum::FAILED;
+        LOG(WARNING) << "BufIoTransport: unknown opcode " << req.opcode;
+        return;
     }
 
-    return Status::OK();
+    task.transferred_bytes = static_cast<size_t>(io_ret < 0 ? 0 : io_ret);
+    task.status_word = (io_ret < 0) ? TransferStatusEnum::FAILED
+                                    : TransferStatusEnum::COMPLETED;
 }
 
 Status BufIoTransport::getTransferStatus(SubBatchRef batch, int task_id,
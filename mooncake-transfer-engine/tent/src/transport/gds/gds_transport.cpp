@@ -110,11 +110,39 @@ Status GdsTransport::install(std::string& local_segment_name,
     conf_ = conf;
     installed_ = true;
     io_batch_depth_ = conf_->get("transports/gds/io_batch_depth", 32);
+    handle_pool_size_ = conf_->get("transports/gds/handle_pool_size", 4);
+    coalesce_max_bytes_ =
+        conf_->get("transports/gds/coalesce_max_bytes", 16ull << 20);
+
+    // Set up the batch handles ahead, so that the first transfers do not pay
+    // for cuFileBatchIOSetUp
+    {
+        std::lock_guard<std::mutex> lock(handle_pool_lock_);
+        while (handle_pool_.size() < handle_pool_size_) {
+            auto batch_handle = createBatchHandle();
+            if (!batch_handle) break;
+            handle_pool_.push_back(batch_handle);
+        }
+    }
+
     caps.dram_to_file = true;
     caps.gpu_to_file = true;
     return Status::OK();
 }
 
+BatchHandle* GdsTransport::createBatchHandle() {
+    auto batch_handle = new BatchHandle();
+    batch_handle->max_nr = io_batch_depth_;
+    // cuFileBatchIOSetUp is time-costly, so we reuse handles
+    auto result = cuFileBatchIOSetUp(&batch_handle->handle, io_batch_depth_);
+    if (result.err != CU_FILE_SUCCESS) {
+        LOG(ERROR) << "Failed to setup GDS batch IO: Code " << result.err;
+        delete batch_handle;
+        return nullptr;
+    }
+    return batch_handle;
+}
+
 Status GdsTransport::uninstall() {
     if (installed_) {
         // Clean up all allocated sub-batches (if user forgot to free them)
@@ -169,17 +197,11 @@ Status GdsTransport::allocateSubBatch(SubBatchRef& batch, size_t max_size) {
             delete batch_handle;
         }
 
-        batch_handle = new BatchHandle();
-        batch_handle->max_nr = io_batch_depth_;
-        // cuFileBatchIOSetUp is time-costly, so we reuse handles
-        auto result =
-            cuFileBatchIOSetUp(&batch_handle->handle, io_batch_depth_);
-        if (result.err != CU_FILE_SUCCESS) {
-            delete batch_handle;
+        batch_handle = createBatchHandle();
+        if (!batch_handle) {
             Slab<GdsSubBatch>::Get().deallocate(gds_batch);
             return Status::InternalError(
-                std::string("Failed to setup GDS batch IO: Code ") +
-                std::to_string(result.err) + LOC_MARK);
+                "Failed to setup GDS batch IO" LOC_MARK);
         }
     }
 
@@ -221,7 +243,13 @@ Status GdsTransport::freeSubBatch(SubBatchRef& batch) {
     // access io_params otherwise
     {
         std::lock_guard<std::mutex> lock(handle_pool_lock_);
-        handle_pool_.push_back(gds_batch->batch_handle);
+        // Keep the pool bounded after bursts of concurrent sub-batches
+        if (handle_pool_.size() < std::max(handle_pool_size_, size_t(16))) {
+            handle_pool_.push_back(gds_batch->batch_handle);
+        } else {
+            cuFileBatchIODestroy(gds_batch->batch_handle->handle);
+            delete gds_batch->batch_handle;
+        }
     }
 
     // Deallocate the GdsSubBatch (each allocation gets a fresh one)
@@ -248,33 +276,71 @@ GdsFileContext* GdsTransport::findFileContext(SegmentID target_id) {
     if (!file_context_map_.count(target_id)) {
         std::string path = getGdsFilePath(target_id);
         if (path.empty()) return nullptr;
-        file_context_map_[target_id] = std::make_shared<GdsFileContext>(path);
+        auto& context = file_path_map_[path];
+        if (!context || !context->ready())
+            context = std::make_shared<GdsFileContext>(path);
+        file_context_map_[target_id] = context;
     }
 
     tl_file_context_map = file_context_map_;
     return tl_file_context_map[target_id].get();
 }
 
+bool GdsTransport::sameLocalBuffer(const Request& prev, const Request& next) {
+    auto local = metadata_->segmentManager().getLocal();
+    auto buffer = local->findBuffer((uint64_t)prev.source, prev.length);
+    return buffer && buffer->addr + buffer->length >=
+                         (uint64_t)next.source + next.length;
+}
+
 Status GdsTransport::submitTransferTasks(
     SubBatchRef batch, const std::vector<Request>& request_list) {
     const static size_t kMaxSliceSize = 16ull << 20;
     auto gds_batch = dynamic_cast<GdsSubBatch*>(batch);
     if (!gds_batch)
         return Status::InvalidArgument("Invalid GDS sub-batch" LOC_MARK);
+
+    // Requests following each other both in memory and in the same file are
+    // coalesced into one IO, so that small chunks still saturate the NVMe
+    struct IOGroup {
+        size_t first, last;  // request indices, inclusive
+        size_t length;
+        GdsFileContext* context;
+    };
+    std::vector<IOGroup> groups;
     size_t num_params = 0;
     size_t first_param_index = gds_batch->io_params.size();
-    for (auto& request : request_list)
-        num_params += (request.length + kMaxSliceSize - 1) / kMaxSliceSize;
-    if (first_param_index + num_params > io_batch_depth_)
-        return Status::TooManyRequests("Exceed batch capacity" LOC_MARK);
-    for (auto& request : request_list) {
+    for (size_t i = 0; i < request_list.size(); ++i) {
+        auto& request = request_list[i];
         GdsFileContext* context = findFileContext(request.target_id);
         if (!context || !context->ready())
             return Status::InvalidArgument("Invalid remote segment" LOC_MARK);
-        IOParamRange range{gds_batch->io_params.size(), 0};
-        for (size_t offset = 0; offset < request.length;
+        if (!groups.empty()) {
+            auto& group = groups.back();
+            auto& prev = request_list[group.last];
+            if (context == group.context && request.opcode == prev.opcode &&
+                (char*)prev.source + prev.length == request.source &&
+                prev.target_offset + prev.length == request.target_offset &&
+                group.length + request.length <= coalesce_max_bytes_ &&
+                sameLocalBuffer(prev, request)) {
+                group.last = i;
+                group.length += request.length;
+                continue;
+            }
+        }
+        groups.push_back(IOGroup{i, i, request.length, context});
+    }
+    for (auto& group : groups)
+        num_params += (group.length + kMaxSliceSize - 1) / kMaxSliceSize;
+    if (first_param_index + num_params > io_batch_depth_)
+        return Status::TooManyRequests("Exceed batch capacity" LOC_MARK);
+
+    for (auto& group : groups) {
+        auto& request = request_list[group.first];
+        size_t base = gds_batch->io_params.size();
+        for (size_t offset = 0; offset < group.length;
              offset += kMaxSliceSize) {
-            size_t length = std::min(kMaxSliceSize, request.length - offset);
+            size_t length = std::min(kMaxSliceSize, group.length - offset);
             CUfileIOParams_t params;
             params.mode = CUFILE_BATCH;
             params.opcode =
@@ -284,11 +350,15 @@ Status GdsTransport::submitTransferTasks(
             params.u.batch.devPtr_offset = offset;
             params.u.batch.file_offset = request.target_offset + offset;
             params.u.batch.size = length;
-            params.fh = context->getHandle();
+            params.fh = group.context->getHandle();
             gds_batch->io_params.push_back(params);
-            range.count++;
         }
-        gds_batch->io_param_ranges.push_back(range);
+        size_t count = gds_batch->io_params.size() - base;
+        for (size_t i = group.first; i <= group.last; ++i) {
+            gds_batch->io_param_ranges.push_back(
+                IOParamRange{base, count, request_list[i].length,
+                             group.first != group.last});
+        }
     }
 
     auto result =
@@ -317,6 +387,7 @@ Status GdsTransport::getTransferStatus(SubBatchRef batch, int task_id,
             std::to_string(result.err) + LOC_MARK);
     status.s = PENDING;
     size_t complete_count = 0;
+    size_t transferred_bytes = 0;
     for (size_t index = range.base; index < range.base + range.count; ++index) {
         auto& event = gds_batch->io_events[index];
         auto s = parseTransferStatus(event.status);
@@ -324,9 +395,13 @@ Status GdsTransport::getTransferStatus(SubBatchRef batch, int task_id,
             complete_count++;
         else if (s != PENDING)
             status.s = s;
-        status.transferred_bytes += event.ret;
+        transferred_bytes += event.ret;
     }
     if (complete_count == range.count) status.s = COMPLETED;
+    // The IOs of a coalesced task also carry its neighbors
+    if (range.coalesced)
+        transferred_bytes = (status.s == COMPLETED) ? range.length : 0;
+    status.transferred_bytes += transferred_bytes;
     return Status::OK();
 }
 
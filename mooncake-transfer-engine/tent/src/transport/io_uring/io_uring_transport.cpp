@@ -30,9 +30,28 @@
 
 namespace mooncake {
 namespace tent {
+// Kernel limits of a registered buffer table
+static const size_t kMaxFixedBufferLength = 1ull << 30;
+static const size_t kMaxFixedBuffers = 1024;
+
+// Returns the index of the registered buffer holding [addr, addr + length)
+static int findFixedBuffer(const std::vector<struct iovec>& buffers,
+                           const void* addr, size_t length) {
+    auto it = std::upper_bound(
+        buffers.begin(), buffers.end(), (uintptr_t)addr,
+        [](uintptr_t value, const struct iovec& iov) {
+            return value < (uintptr_t)iov.iov_base;
+        });
+    if (it == buffers.begin()) return -1;
+    --it;
+    uintptr_t base = (uintptr_t)it->iov_base;
+    if ((uintptr_t)addr + length > base + it->iov_len) return -1;
+    return it - buffers.begin();
+}
 class IOUringFileContext {
    public:
-    explicit IOUringFileContext(const std::string& path) : ready_(false) {
+    IOUringFileContext(const std::string& path, int slot)
+        : slot_(slot), ready_(false) {
         fd_ = open(path.c_str(), O_RDWR | O_DIRECT);
         if (fd_ >= 0) {
             ready_ = true;
@@ -58,10 +77,14 @@ class IOUringFileContext {
 
     int getHandle() const { return fd_; }
 
+    // Index of the file in the registered file tables of the rings, or -1
+    int getSlot() const { return slot_; }
+
     bool ready() const { return ready_; }
 
    private:
     int fd_;
+    int slot_;
     bool ready_;
 };
 
@@ -86,6 +109,13 @@ Status IOUringTransport::install(std::string& local_segment_name,
     installed_ = true;
     async_memcpy_threshold_ =
         conf_->get("transports/nvlink/async_memcpy_threshold", 1024) * 1024;
+    ring_pool_size_ = conf_->get("transports/io_uring/ring_pool_size", 16);
+    queue_depth_ = conf_->get("transports/io_uring/queue_depth", 128);
+    sqpoll_ = conf_->get("transports/io_uring/sqpoll", false);
+    sqpoll_idle_ms_ = conf_->get("transports/io_uring/sqpoll_idle_ms", 10);
+    max_fixed_files_ = conf_->get("transports/io_uring/max_fixed_files", 64);
+    register_buffers_ =
+        conf_->get("transports/io_uring/register_buffers", true);
     caps.dram_to_file = true;
     if (Platform::getLoader().type() == "cuda") {
         caps.gpu_to_file = true;
@@ -110,9 +140,106 @@ Status IOUringTransport::uninstall() {
         metadata_.reset();
         installed_ = false;
     }
+    RWSpinlock::WriteGuard guard(ring_pool_lock_);
+    for (auto ring : ring_pool_) destroyRing(ring);
+    ring_pool_.clear();
     return Status::OK();
 }
 
+IOUringRing* IOUringTransport::createRing(size_t entries) {
+    auto ring = new IOUringRing();
+    ring->entries = std::max(entries, queue_depth_);
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (sqpoll_) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = sqpoll_idle_ms_;
+    }
+    int rc = io_uring_queue_init_params(ring->entries, &ring->ring, &params);
+    if (rc < 0 && (params.flags & IORING_SETUP_SQPOLL)) {
+        // Unprivileged SQPOLL needs kernel 5.11 or later
+        LOG(WARNING) << "IOUringTransport: SQPOLL unavailable ("
+                     << strerror(-rc) << "), using interrupt driven rings";
+        sqpoll_ = false;
+        memset(&params, 0, sizeof(params));
+        rc = io_uring_queue_init_params(ring->entries, &ring->ring, &params);
+    }
+    if (rc < 0) {
+        LOG(ERROR) << "IOUringTransport: io_uring_queue_init failed: "
+                   << strerror(-rc);
+        delete ring;
+        return nullptr;
+    }
+
+    if (max_fixed_files_ > 0) {
+        // Sparse table, slots are filled as files are first used
+        std::vector<int> fds(max_fixed_files_, -1);
+        if (io_uring_register_files(&ring->ring, fds.data(), fds.size()) == 0)
+            ring->fixed_files = std::move(fds);
+    }
+    return ring;
+}
+
+void IOUringTransport::destroyRing(IOUringRing* ring) {
+    io_uring_queue_exit(&ring->ring);
+    delete ring;
+}
+
+void IOUringTransport::syncFixedBuffers(IOUringRing* ring) {
+    std::vector<struct iovec> buffers;
+    uint64_t version;
+    {
+        RWSpinlock::ReadGuard guard(buffer_lock_);
+        if (ring->buffer_version == buffer_version_) return;
+        buffers = fixed_buffers_;
+        version = buffer_version_;
+    }
+    // The ring is idle, so its buffer table can be replaced as a whole
+    if (!ring->fixed_buffers.empty()) io_uring_unregister_buffers(&ring->ring);
+    ring->fixed_buffers.clear();
+    ring->buffer_version = version;
+    if (buffers.empty()) return;
+    int rc = io_uring_register_buffers(&ring->ring, buffers.data(),
+                                       buffers.size());
+    if (rc < 0) {
+        LOG_FIRST_N(WARNING, 1)
+            << "IOUringTransport: unable to register " << buffers.size()
+            << " fixed buffers: " << strerror(-rc);
+        return;
+    }
+    ring->fixed_buffers = std::move(buffers);
+}
+
+IOUringRing* IOUringTransport::acquireRing(size_t entries) {
+    IOUringRing* ring = nullptr;
+    {
+        RWSpinlock::WriteGuard guard(ring_pool_lock_);
+        for (auto it = ring_pool_.begin(); it != ring_pool_.end(); ++it) {
+            if ((*it)->entries >= entries) {
+                ring = *it;
+                ring_pool_.erase(it);
+                break;
+            }
+        }
+    }
+    if (!ring) ring = createRing(entries);
+    if (ring && register_buffers_) syncFixedBuffers(ring);
+    return ring;
+}
+
+void IOUringTransport::releaseRing(IOUringRing* ring, bool idle) {
+    // Late completions of a ring given to another batch would refer to
+    // tasks freed with this one
+    if (idle) {
+        RWSpinlock::WriteGuard guard(ring_pool_lock_);
+        if (ring_pool_.size() < ring_pool_size_) {
+            ring_pool_.push_back(ring);
+            return;
+        }
+    }
+    destroyRing(ring);
+}
+
 Status IOUringTransport::allocateSubBatch(SubBatchRef& batch, size_t max_size) {
     auto io_uring_batch = Slab<IOUringSubBatch>::Get().allocate();
     if (!io_uring_batch)
@@ -120,11 +247,10 @@ Status IOUringTransport::allocateSubBatch(SubBatchRef& batch, size_t max_size) {
     batch = io_uring_batch;
     io_uring_batch->max_size = max_size;
     io_uring_batch->task_list.reserve(max_size);
-    int rc = io_uring_queue_init(max_size, &io_uring_batch->ring, 0);
-    if (rc)
+    io_uring_batch->ring = acquireRing(max_size);
+    if (!io_uring_batch->ring)
         return Status::InternalError(
-            std::string("io_uring_queue_init failed: ") + strerror(-rc) +
-            LOC_MARK);
+            "Unable to set up io_uring for sub-batch" LOC_MARK);
     return Status::OK();
 }
 
@@ -132,7 +258,8 @@ Status IOUringTransport::freeSubBatch(SubBatchRef& batch) {
     auto io_uring_batch = dynamic_cast<IOUringSubBatch*>(batch);
     if (!io_uring_batch)
         return Status::InvalidArgument("Invalid IO Uring sub-batch" LOC_MARK);
-    io_uring_queue_exit(&io_uring_batch->ring);
+    if (io_uring_batch->ring)
+        releaseRing(io_uring_batch->ring, io_uring_batch->inflight == 0);
     Slab<IOUringSubBatch>::Get().deallocate(io_uring_batch);
     batch = nullptr;
     return Status::OK();
@@ -156,8 +283,10 @@ IOUringFileContext* IOUringTransport::findFileContext(SegmentID target_id) {
     if (!file_context_map_.count(target_id)) {
         std::string path = getIOUringFilePath(target_id);
         if (path.empty()) return nullptr;
+        // Contexts are never closed, so a slot keeps naming the same file
+        int slot = next_file_slot_ < max_fixed_files_ ? next_file_slot_++ : -1;
         file_context_map_[target_id] =
-            std::make_shared<IOUringFileContext>(path);
+            std::make_shared<IOUringFileContext>(path, slot);
     }
 
     tl_file_context_map = file_context_map_;
@@ -183,10 +312,23 @@ Status IOUringTransport::submitTransferTasks(
         if (!context || !context->ready())
             return Status::InvalidArgument("Invalid remote segment" LOC_MARK);
 
-        struct io_uring_sqe* sqe = io_uring_get_sqe(&io_uring_batch->ring);
+        auto ring = io_uring_batch->ring;
+        struct io_uring_sqe* sqe = io_uring_get_sqe(&ring->ring);
         if (!sqe)
             return Status::InternalError("io_uring_get_sqe failed" LOC_MARK);
 
+        int fd = context->getHandle();
+        int slot = context->getSlot();
+        bool fixed_file = false;
+        if (slot >= 0 && slot < (int)ring->fixed_files.size()) {
+            if (ring->fixed_files[slot] != fd &&
+                io_uring_register_files_update(&ring->ring, slot, &fd, 1) == 1)
+                ring->fixed_files[slot] = fd;
+            fixed_file = ring->fixed_files[slot] == fd;
+        }
+        // A fixed file is named by its slot in the registered table
+        int handle = fixed_file ? slot : fd;
+
         const size_t kPageSize = 4096;
         if (Platform::getLoader().getMemoryType(request.source) == MTYPE_CUDA ||
             (uint64_t)request.source % kPageSize) {
@@ -195,26 +337,38 @@ Status IOUringTransport::submitTransferTasks(
                 return Status::InternalError("posix_memalign failed" LOC_MARK);
 
             if (request.opcode == Request::READ)
-                io_uring_prep_read(sqe, context->getHandle(), task.buffer,
-                                   request.length, request.target_offset);
+                io_uring_prep_read(sqe, handle, task.buffer, request.length,
+                                   request.target_offset);
             else if (request.opcode == Request::WRITE) {
                 Platform::getLoader().copy(task.buffer, request.source,
                                            request.length);
-                io_uring_prep_write(sqe, context->getHandle(), task.buffer,
-                                    request.length, request.target_offset);
+                io_uring_prep_write(sqe, handle, task.buffer, request.length,
+                                    request.target_offset);
             }
         } else {
-            if (request.opcode == Request::READ)
-                io_uring_prep_read(sqe, context->getHandle(), request.source,
+            int index = findFixedBuffer(ring->fixed_buffers, request.source,
+                                        request.length);
+            if (request.opcode == Request::READ && index >= 0)
+                io_uring_prep_read_fixed(sqe, handle, request.source,
+                                         request.length,
+                                         request.target_offset, index);
+            else if (request.opcode == Request::READ)
+                io_uring_prep_read(sqe, handle, request.source,
                                    request.length, request.target_offset);
+            else if (request.opcode == Request::WRITE && index >= 0)
+                io_uring_prep_write_fixed(sqe, handle, request.source,
+                                          request.length,
+                                          request.target_offset, index);
             else if (request.opcode == Request::WRITE)
-                io_uring_prep_write(sqe, context->getHandle(), request.source,
+                io_uring_prep_write(sqe, handle, request.source,
                                     request.length, request.target_offset);
         }
+        if (fixed_file) sqe->flags |= IOSQE_FIXED_FILE;
         sqe->user_data = (uintptr_t)&task;
     }
 
-    int rc = io_uring_submit(&io_uring_batch->ring);
+    int rc = io_uring_submit(&io_uring_batch->ring->ring);
+    if (rc > 0) io_uring_batch->inflight += rc;
     if (rc != (int32_t)request_list.size())
         return Status::InternalError(std::string("io_uring_submit failed: ") +
                                      strerror(-rc) + LOC_MARK);
@@ -231,7 +385,7 @@ Status IOUringTransport::getTransferStatus(SubBatchRef batch, int task_id,
     status = TransferStatus{task.status_word, task.transferred_bytes};
     if (task.status_word == TransferStatusEnum::PENDING) {
         struct io_uring_cqe* cqe = nullptr;
-        int err = io_uring_peek_cqe(&io_uring_batch->ring, &cqe);
+        int err = io_uring_peek_cqe(&io_uring_batch->ring->ring, &cqe);
         if (err == -EAGAIN) return Status::OK();
         if (err || !cqe) {
             return Status::InternalError(
@@ -256,17 +410,58 @@ Status IOUringTransport::getTransferStatus(SubBatchRef batch, int task_id,
                 task->transferred_bytes = task->request.length;
             }
         }
-        io_uring_cqe_seen(&io_uring_batch->ring, cqe);
+        io_uring_cqe_seen(&io_uring_batch->ring->ring, cqe);
+        if (io_uring_batch->inflight) io_uring_batch->inflight--;
     }
     return Status::OK();
 }
 
 Status IOUringTransport::addMemoryBuffer(BufferDesc& desc,
                                          const MemoryOptions& options) {
+    if (!register_buffers_ || !desc.addr || !desc.length) return Status::OK();
+    // Device memory always goes through a bounce buffer
+    if (Platform::getLoader().getMemoryType((void*)desc.addr) == MTYPE_CUDA)
+        return Status::OK();
+    std::vector<struct iovec> pieces;
+    for (uint64_t offset = 0; offset < desc.length;
+         offset += kMaxFixedBufferLength) {
+        struct iovec iov;
+        iov.iov_base = (void*)(desc.addr + offset);
+        iov.iov_len = std::min<uint64_t>(kMaxFixedBufferLength,
+                                         desc.length - offset);
+        pieces.push_back(iov);
+    }
+    RWSpinlock::WriteGuard guard(buffer_lock_);
+    if (fixed_buffers_.size() + pieces.size() > kMaxFixedBuffers) {
+        LOG_FIRST_N(WARNING, 1) << "IOUringTransport: registered buffer "
+                                   "table is full, using plain reads and "
+                                   "writes for the remaining buffers";
+        return Status::OK();
+    }
+    for (auto& iov : pieces) {
+        auto it = std::lower_bound(
+            fixed_buffers_.begin(), fixed_buffers_.end(), iov,
+            [](const struct iovec& lhs, const struct iovec& rhs) {
+                return lhs.iov_base < rhs.iov_base;
+            });
+        fixed_buffers_.insert(it, iov);
+    }
+    buffer_version_++;
     return Status::OK();
 }
 
 Status IOUringTransport::removeMemoryBuffer(BufferDesc& desc) {
+    RWSpinlock::WriteGuard guard(buffer_lock_);
+    uintptr_t begin = desc.addr, end = desc.addr + desc.length;
+    auto removed = std::remove_if(
+        fixed_buffers_.begin(), fixed_buffers_.end(),
+        [&](const struct iovec& iov) {
+            return (uintptr_t)iov.iov_base >= begin &&
+                   (uintptr_t)iov.iov_base < end;
+        });
+    if (removed == fixed_buffers_.end()) return Status::OK();
+    fixed_buffers_.erase(removed, fixed_buffers_.end());
+    buffer_version_++;
     return Status::OK();
 }
 
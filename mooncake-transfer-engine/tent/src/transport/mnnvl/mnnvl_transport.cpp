@@ -83,6 +83,14 @@ static bool supportFabricMem() {
     return true;
 }
 
+MnnvlImport::~MnnvlImport() {
+    if (addr) {
+        cuMemUnmap((CUdeviceptr)addr, length);
+        cuMemAddressFree((CUdeviceptr)addr, length);
+    }
+    if (handle) cuMemRelease(handle);
+}
+
 MnnvlTransport::MnnvlTransport() : installed_(false) {}
 
 MnnvlTransport::~MnnvlTransport() { uninstall(); }
@@ -124,14 +132,19 @@ Status MnnvlTransport::install(std::string &local_segment_name,
     else
         handle_type_ = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
     host_register_ = conf_->get("transports/nvlink/host_register", true);
+    max_imported_bytes_ = conf_->get("transports/mnnvl/max_imported_gb", 0);
+    max_imported_bytes_ <<= 30;
     return setPeerAccess();
 }
 
 Status MnnvlTransport::uninstall() {
     if (installed_) {
         metadata_.reset();
-        // TODO close all opened entries
-        relocate_map_.clear();
+        RWSpinlock::WriteGuard guard(relocate_lock_);
+        import_cache_.clear();
+        import_lru_.clear();
+        imported_bytes_ = 0;
+        import_epoch_.fetch_add(1, std::memory_order_release);
         installed_ = false;
     }
     return Status::OK();
@@ -184,7 +197,7 @@ Status MnnvlTransport::submitTransferTasks(
         uint64_t target_addr = request.target_offset;
         if (request.target_id != LOCAL_SEGMENT_ID) {
             auto status = relocateSharedMemoryAddress(
-                target_addr, request.length, request.target_id);
+                target_addr, request.length, request.target_id, task.import);
             if (!status.ok()) {
                 LOG(FATAL) << status;
                 task.status_word = TransferStatusEnum::FAILED;
@@ -214,28 +227,9 @@ void MnnvlTransport::startTransfer(MnnvlTask *task, MnnvlSubBatch *batch) {
 
     bool is_async = (task->request.length >= async_memcpy_threshold_);
 
-    cudaPointerAttributes src_attr_info, dst_attr_info;
-    cudaMemoryType src_type = cudaMemoryTypeHost, dst_type = cudaMemoryTypeHost;
-    if (cudaPointerGetAttributes(&src_attr_info, src) == cudaSuccess) {
-        src_type = src_attr_info.type;
-    }
-    if (cudaPointerGetAttributes(&dst_attr_info, dst) == cudaSuccess) {
-        dst_type = dst_attr_info.type;
-    }
-
+    // Imports and local buffers live in the unified address space, so the
+    // driver infers the direction without querying both pointers per task
     cudaMemcpyKind kind = cudaMemcpyDefault;
-    if (src_type == cudaMemoryTypeDevice && dst_type == cudaMemoryTypeHost) {
-        kind = cudaMemcpyDeviceToHost;
-    } else if (src_type == cudaMemoryTypeHost &&
-               dst_type == cudaMemoryTypeDevice) {
-        kind = cudaMemcpyHostToDevice;
-    } else if (src_type == cudaMemoryTypeDevice &&
-               dst_type == cudaMemoryTypeDevice) {
-        kind = cudaMemcpyDeviceToDevice;
-    } else if (src_type == cudaMemoryTypeHost &&
-               dst_type == cudaMemoryTypeHost) {
-        kind = cudaMemcpyHostToHost;
-    }
 
     if (!is_async) {
         err = cudaMemcpy(dst, src, task->request.length, kind);
@@ -260,17 +254,22 @@ Status MnnvlTransport::getTransferStatus(SubBatchRef batch, int task_id,
         return Status::InvalidArgument("Invalid task id" LOC_MARK);
     }
     auto &task = mnnvl_batch->task_list[task_id];
-    status = TransferStatus{task.status_word, task.transferred_bytes};
     if (task.status_word == TransferStatusEnum::PENDING) {
         auto err = cudaStreamQuery(mnnvl_batch->stream);
         if (err == cudaSuccess) {
             cudaStreamSynchronize(mnnvl_batch->stream);
-            task.transferred_bytes = task.request.length;
-            task.status_word = TransferStatusEnum::COMPLETED;
+            // The asynchronous copies of the batch share the stream, so one
+            // query completes all of them
+            for (auto &entry : mnnvl_batch->task_list) {
+                if (entry.status_word != TransferStatusEnum::PENDING) continue;
+                entry.transferred_bytes = entry.request.length;
+                entry.status_word = TransferStatusEnum::COMPLETED;
+            }
         } else if (err != cudaErrorNotReady) {
             task.status_word = TransferStatusEnum::FAILED;
         }
     }
+    status = TransferStatus{task.status_word, task.transferred_bytes};
     return Status::OK();
 }
 
@@ -439,69 +438,50 @@ static int importFdFromProcess(pid_t pid, int remote_fd) {
     return newfd;
 }
 
-Status MnnvlTransport::relocateSharedMemoryAddress(uint64_t &dest_addr,
-                                                   uint64_t length,
-                                                   uint64_t target_id) {
-    thread_local HashMap tl_relocate_map;
-    if (tl_relocate_map.empty()) {
-        RWSpinlock::ReadGuard guard(relocate_lock_);
-        tl_relocate_map = relocate_map_;
-    }
-
-    for (auto &entry : tl_relocate_map[target_id]) {
-        if (entry.first <= dest_addr &&
-            dest_addr + length <= entry.first + entry.second.length) {
-            auto mnnvl_addr = entry.second.mnnvl_addr;
-            dest_addr = dest_addr - entry.first + ((uint64_t)mnnvl_addr);
-            return Status::OK();
-        }
-    }
-
-    RWSpinlock::WriteGuard guard(relocate_lock_);
-    SegmentDesc *desc = nullptr;
-    CHECK_STATUS(metadata_->segmentManager().getRemoteCached(desc, target_id));
-
-    auto buffer = desc->findBuffer(dest_addr, length);
-    if (!buffer || buffer->mnnvl_handle.empty())
+Status MnnvlTransport::importBuffer(const BufferDesc &buffer,
+                                    MnnvlImportRef &import) {
+    LocationParser location(buffer.location);
+    if (location.type() != "cuda") {
         return Status::InvalidArgument(
-            "Requested address is not in registered buffer" LOC_MARK);
-
-    if (!relocate_map_[target_id].count(buffer->addr)) {
-        CUmemGenericAllocationHandle handle;
-        void *mnnvl_addr = nullptr;
-        LocationParser location(buffer->location);
-        if (location.type() != "cuda") {
-            return Status::InvalidArgument(
-                "Requested address is not in registered CUDA buffer" LOC_MARK);
-        }
+            "Requested address is not in registered CUDA buffer" LOC_MARK);
+    }
 
-        int cuda_dev = 0;
-        CHECK_CUDA(cudaGetDevice(&cuda_dev));
-        cudaSetDevice(location.index());
+    auto result = std::make_shared<MnnvlImport>();
+    result->length = buffer.length;
+    result->cuda_id = location.index();
+    int cuda_dev = 0;
+    CHECK_CUDA(cudaGetDevice(&cuda_dev));
+    cudaSetDevice(location.index());
+    // Partially imported state is released by the destructor of |result|
+    auto status = [&]() -> Status {
         if (handle_type_ == CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR) {
-            auto [pid, remote_fd] = parsePidFd(buffer->mnnvl_handle);
+            auto [pid, remote_fd] = parsePidFd(buffer.mnnvl_handle);
             int local_fd = importFdFromProcess(pid, remote_fd);
             if (local_fd < 0)
                 return Status::InternalError(
                     "Unable to import fd from remote process");
-            CHECK_CU(cuMemImportFromShareableHandle(&handle, &local_fd,
-                                                    handle_type_));
+            auto ret = cuMemImportFromShareableHandle(
+                &result->handle, &local_fd, handle_type_);
+            close(local_fd);
+            CHECK_CU(ret);
         } else {
             std::vector<unsigned char> output_buffer;
-            deserializeBinaryData(buffer->mnnvl_handle, output_buffer);
+            deserializeBinaryData(buffer.mnnvl_handle, output_buffer);
             if (output_buffer.size() != sizeof(CUmemFabricHandle)) {
                 return Status::InternalError(
                     "Received MNNVL handle length incorrect");
             }
             CUmemFabricHandle export_handle;
             memcpy(&export_handle, output_buffer.data(), sizeof(export_handle));
-            CHECK_CU(cuMemImportFromShareableHandle(&handle, &export_handle,
-                                                    handle_type_));
+            CHECK_CU(cuMemImportFromShareableHandle(
+                &result->handle, &export_handle, handle_type_));
         }
-        CHECK_CU(cuMemAddressReserve((CUdeviceptr *)&mnnvl_addr, buffer->length,
-                                     0, 0, 0));
-        CHECK_CU(
-            cuMemMap((CUdeviceptr)mnnvl_addr, buffer->length, 0, handle, 0));
+        void *mnnvl_addr = nullptr;
+        CHECK_CU(cuMemAddressReserve((CUdeviceptr *)&mnnvl_addr,
+                                     buffer.length, 0, 0, 0));
+        result->addr = mnnvl_addr;
+        CHECK_CU(cuMemMap((CUdeviceptr)mnnvl_addr, buffer.length, 0,
+                          result->handle, 0));
         int device_count;
         cudaGetDeviceCount(&device_count);
         CUmemAccessDesc accessDesc[device_count];
@@ -510,19 +490,131 @@ Status MnnvlTransport::relocateSharedMemoryAddress(uint64_t &dest_addr,
             accessDesc[device_id].location.id = device_id;
             accessDesc[device_id].flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
         }
-        CHECK_CU(cuMemSetAccess((CUdeviceptr)mnnvl_addr, buffer->length,
+        CHECK_CU(cuMemSetAccess((CUdeviceptr)mnnvl_addr, buffer.length,
                                 accessDesc, device_count));
-        OpenedMnnvlEntry mnnvl_entry;
-        mnnvl_entry.mnnvl_addr = mnnvl_addr;
-        mnnvl_entry.length = buffer->length;
-        mnnvl_entry.cuda_id = location.index();
-        relocate_map_[target_id][buffer->addr] = mnnvl_entry;
-        cudaSetDevice(cuda_dev);
+        return Status::OK();
+    }();
+    cudaSetDevice(cuda_dev);
+    if (!status.ok()) return status;
+    import = std::move(result);
+    return Status::OK();
+}
+
+Status MnnvlTransport::getImportLocked(const BufferDesc &buffer,
+                                       MnnvlImportRef &import) {
+    auto it = import_cache_.find(buffer.mnnvl_handle);
+    if (it != import_cache_.end() &&
+        it->second.import->length >= buffer.length) {
+        import_lru_.splice(import_lru_.end(), import_lru_,
+                           it->second.lru_iter);
+        import = it->second.import;
+        return Status::OK();
+    }
+    if (it != import_cache_.end()) {
+        // The peer reused the handle for a larger buffer
+        imported_bytes_ -= it->second.import->length;
+        import_lru_.erase(it->second.lru_iter);
+        import_cache_.erase(it);
+        import_epoch_.fetch_add(1, std::memory_order_release);
+    }
+    CHECK_STATUS(importBuffer(buffer, import));
+    imported_bytes_ += import->length;
+    auto lru_iter = import_lru_.insert(import_lru_.end(), buffer.mnnvl_handle);
+    import_cache_[buffer.mnnvl_handle] = ImportCacheEntry{import, lru_iter};
+    // In-flight tasks and thread caches keep evicted imports mapped until
+    // they are done with them
+    while (max_imported_bytes_ && imported_bytes_ > max_imported_bytes_ &&
+           import_lru_.size() > 1) {
+        auto victim = import_cache_.find(import_lru_.front());
+        imported_bytes_ -= victim->second.import->length;
+        import_cache_.erase(victim);
+        import_lru_.pop_front();
+        import_epoch_.fetch_add(1, std::memory_order_release);
+    }
+    return Status::OK();
+}
+
+Status MnnvlTransport::relocateSharedMemoryAddress(uint64_t &dest_addr,
+                                                   uint64_t length,
+                                                   uint64_t target_id,
+                                                   MnnvlImportRef &import) {
+    struct CachedBuffer {
+        uint64_t addr;
+        uint64_t length;
+        MnnvlImportRef import;
+    };
+    struct ThreadCache {
+        const MnnvlTransport *owner = nullptr;
+        uint64_t epoch = 0;
+        std::unordered_map<SegmentID, std::vector<CachedBuffer>> buffers;
+    };
+    thread_local ThreadCache tl_cache;
+    auto epoch = import_epoch_.load(std::memory_order_acquire);
+    if (tl_cache.owner != this || tl_cache.epoch != epoch) {
+        tl_cache.buffers.clear();
+        tl_cache.owner = this;
+        tl_cache.epoch = epoch;
+    }
+
+    auto &cached_buffers = tl_cache.buffers[target_id];
+    for (auto &entry : cached_buffers) {
+        if (entry.addr <= dest_addr &&
+            dest_addr + length <= entry.addr + entry.length) {
+            import = entry.import;
+            dest_addr = dest_addr - entry.addr + (uint64_t)import->addr;
+            return Status::OK();
+        }
+    }
+
+    SegmentDesc *desc = nullptr;
+    CHECK_STATUS(metadata_->segmentManager().getRemoteCached(desc, target_id));
+
+    auto buffer = desc->findBuffer(dest_addr, length);
+    if (!buffer || buffer->mnnvl_handle.empty())
+        return Status::InvalidArgument(
+            "Requested address is not in registered buffer" LOC_MARK);
+
+    {
+        RWSpinlock::WriteGuard guard(relocate_lock_);
+        CHECK_STATUS(getImportLocked(*buffer, import));
     }
+    cached_buffers.push_back(
+        CachedBuffer{buffer->addr, buffer->length, import});
+    dest_addr = dest_addr - buffer->addr + (uint64_t)import->addr;
+    return Status::OK();
+}
 
-    auto mnnvl_addr = relocate_map_[target_id][buffer->addr].mnnvl_addr;
-    dest_addr = dest_addr - buffer->addr + ((uint64_t)mnnvl_addr);
-    tl_relocate_map = relocate_map_;
+Status MnnvlTransport::warmupSegments(
+    const std::vector<SegmentID> &target_ids) {
+    auto &manager = metadata_->segmentManager();
+    for (auto target_id : target_ids) {
+        if (target_id == LOCAL_SEGMENT_ID) continue;
+        SegmentDesc *cached_desc = nullptr;
+        auto status = manager.getRemoteCached(cached_desc, target_id);
+        if (!status.ok()) {
+            LOG(WARNING) << "Skip warming up segment " << target_id << ": "
+                         << status.ToString();
+            continue;
+        }
+        if (cached_desc->type != SegmentType::Memory) continue;
+        // A copy stays valid while the cache is refreshed
+        auto buffers = cached_desc->getMemory().buffers;
+        RWSpinlock::WriteGuard guard(relocate_lock_);
+        for (auto &buffer : buffers) {
+            if (buffer.mnnvl_handle.empty()) continue;
+            if (LocationParser(buffer.location).type() != "cuda") continue;
+            if (import_cache_.count(buffer.mnnvl_handle)) continue;
+            // Imports ahead of time only take free room, never evict
+            if (max_imported_bytes_ &&
+                imported_bytes_ + buffer.length > max_imported_bytes_)
+                return Status::OK();
+            MnnvlImportRef import;
+            status = getImportLocked(buffer, import);
+            if (!status.ok())
+                LOG(WARNING) << "Unable to import buffer of segment "
+                             << target_id << ": " << status.ToString();
+        }
+    }
     return Status::OK();
 }
 
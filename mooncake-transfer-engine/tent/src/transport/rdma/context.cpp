@@ -21,8 +21,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <thread>
@@ -380,6 +382,10 @@ int RdmaContext::enable() {
         disable();
         return notify_ret;
     }
+    if (createNotifySrq()) {
+        LOG(WARNING) << "No shared receive queue on " << device_name_
+                     << ", RDMA notifications are disabled on it";
+    }
 
     ibv_port_attr port_attr;
     int ret = verbs_.ibv_query_port_default(native_context_,
@@ -428,6 +434,7 @@ int RdmaContext::disable() {
         delete notify_cq_;
         notify_cq_ = nullptr;
     }
+    destroyNotifySrq();
 
     if (event_fd_ >= 0) {
         if (close(event_fd_)) PLOG(ERROR) << "close";
@@ -455,6 +462,112 @@ int RdmaContext::disable() {
     return 0;
 }
 
+// Deserialize: [name_len(4)][name][msg_len(4)][msg]
+static bool parseNotification(const char* data, size_t len, std::string& name,
+                              std::string& msg) {
+    if (len < 8) {
+        LOG(ERROR) << "Invalid notification message size: " << len;
+        return false;
+    }
+    uint32_t name_len, msg_len;
+    memcpy(&name_len, data, sizeof(name_len));
+    if (name_len > len - 8) {
+        LOG(ERROR) << "Invalid notification message format (name too long)";
+        return false;
+    }
+    memcpy(&msg_len, data + 4 + name_len, sizeof(msg_len));
+    if (msg_len > len - 8 - name_len) {
+        LOG(ERROR) << "Invalid notification message format (msg too long)";
+        return false;
+    }
+    name.assign(data + 4, name_len);
+    msg.assign(data + 8 + name_len, msg_len);
+    return true;
+}
+
+int RdmaContext::createNotifySrq() {
+    ibv_device_attr device_attr;
+    if (verbs_.ibv_query_device(native_context_, &device_attr)) {
+        PLOG(ERROR) << "ibv_query_device";
+        return -1;
+    }
+    if (device_attr.max_srq_wr <= 0) return -1;
+    size_t num_slots =
+        std::min(kNotifyRecvSlots, (size_t)device_attr.max_srq_wr);
+
+    ibv_srq_init_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.attr.max_wr = num_slots;
+    attr.attr.max_sge = 1;
+    notify_srq_ = verbs_.ibv_create_srq(native_pd_, &attr);
+    if (!notify_srq_) {
+        PLOG(ERROR) << "ibv_create_srq";
+        return -1;
+    }
+
+    notify_recv_ring_.resize(num_slots * kNotifyMessageSize);
+    notify_recv_mr_ = verbs_.ibv_reg_mr_default(
+        native_pd_, notify_recv_ring_.data(), notify_recv_ring_.size(),
+        IBV_ACCESS_LOCAL_WRITE);
+    if (!notify_recv_mr_) {
+        PLOG(ERROR) << "Failed to register notification recv buffers";
+        destroyNotifySrq();
+        return -1;
+    }
+    for (size_t slot = 0; slot < num_slots; ++slot) postNotifyRecv(slot);
+    return 0;
+}
+
+void RdmaContext::destroyNotifySrq() {
+    if (notify_srq_) {
+        if (verbs_.ibv_destroy_srq(notify_srq_))
+            PLOG(ERROR) << "ibv_destroy_srq";
+        notify_srq_ = nullptr;
+    }
+    if (notify_recv_mr_) {
+        if (verbs_.ibv_dereg_mr(notify_recv_mr_))
+            PLOG(ERROR) << "Failed to deregister notification recv MR";
+        notify_recv_mr_ = nullptr;
+    }
+    notify_recv_ring_.clear();
+    notify_recv_ring_.shrink_to_fit();
+}
+
+void RdmaContext::postNotifyRecv(size_t slot) {
+    ibv_sge sge = {};
+    sge.addr = reinterpret_cast<uint64_t>(notify_recv_ring_.data() +
+                                          slot * kNotifyMessageSize);
+    sge.length = kNotifyMessageSize;
+    sge.lkey = notify_recv_mr_->lkey;
+
+    ibv_recv_wr wr = {};
+    wr.wr_id = kNotifyRecvTag | slot;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+
+    ibv_recv_wr* bad_wr = nullptr;
+    if (ibv_post_srq_recv(notify_srq_, &wr, &bad_wr)) {
+        PLOG(ERROR) << "Failed to post notification recv";
+    }
+}
+
+void RdmaContext::handleNotifyRecv(uint64_t wr_id, size_t byte_len) {
+    size_t slot = wr_id & ~kNotifyRecvTag;
+    if (!notify_srq_ ||
+        (slot + 1) * kNotifyMessageSize > notify_recv_ring_.size()) {
+        LOG(ERROR) << "Invalid notification recv buffer: " << slot;
+        return;
+    }
+
+    // Nothing was received into flushed buffers
+    std::string name, msg;
+    const char* data = notify_recv_ring_.data() + slot * kNotifyMessageSize;
+    if (byte_len && parseNotification(data, byte_len, name, msg))
+        transport_.addNotificationToQueue(name, msg);
+    // Only now that the message is copied out
+    postNotifyRecv(slot);
+}
+
 int RdmaContext::pause() {
     DeviceStatus expected = DEVICE_ENABLED;
     status_.compare_exchange_strong(expected, DEVICE_PAUSED);
@@ -94,73 +94,11 @@ int RdmaEndPoint::construct(RdmaContext* context, EndPointParams* params,
         slice_queue_.emplace_back(params_->max_qp_wr);
     }
 
-    auto notify_cq = context_->notifyCq()->cq();
-    ibv_qp_init_attr notify_attr;
-    memset(&notify_attr, 0, sizeof(notify_attr));
-    notify_attr.send_cq = notify_cq;
-    notify_attr.recv_cq = notify_cq;
-    notify_attr.sq_sig_all = true;  // Always signal for notifications
-    notify_attr.qp_type = IBV_QPT_RC;
-    notify_attr.cap.max_send_wr = kNotifyMaxPendingSends;
-    notify_attr.cap.max_recv_wr = kNotifyMaxPendingSends;
-    notify_attr.cap.max_send_sge = 1;
-    notify_attr.cap.max_recv_sge = 1;
-
-    notify_qp_ =
-        context_->verbs_.ibv_create_qp(context_->nativePD(), &notify_attr);
-    if (!notify_qp_) {
-        PLOG(ERROR) << "Failed to create notification QP";
-        deconstruct();
-        return -1;
-    }
-
-    // Modify notification QP to INIT
-    ibv_qp_attr qp_attr;
-    memset(&qp_attr, 0, sizeof(qp_attr));
-    qp_attr.qp_state = IBV_QPS_INIT;
-    qp_attr.pkey_index = 0;
-    qp_attr.port_num = context_->portNum();
-    qp_attr.qp_access_flags = IBV_ACCESS_REMOTE_WRITE;
-
-    if (context_->verbs_.ibv_modify_qp(notify_qp_, &qp_attr,
-                                       IBV_QP_STATE | IBV_QP_PKEY_INDEX |
-                                           IBV_QP_PORT | IBV_QP_ACCESS_FLAGS)) {
-        PLOG(ERROR) << "Failed to modify notification QP to INIT";
-        deconstruct();
-        return -1;
-    }
-
-    // Pre-post recv buffers for notification
-    notify_recv_buffers_.resize(kNotifyMaxPendingSends);
-    notify_recv_mrs_.resize(kNotifyMaxPendingSends);
-
-    // Allocate and register send buffer
-    notify_send_buffer_.resize(kNotifyBufferSize);
-    notify_send_mr_ = context_->verbs_.ibv_reg_mr_default(
-        context_->nativePD(), notify_send_buffer_.data(), kNotifyBufferSize,
-        IBV_ACCESS_LOCAL_WRITE);
-    if (!notify_send_mr_) {
-        PLOG(ERROR) << "Failed to register notification send buffer";
+    if (context_->notifySrq() && createNotifyQp()) {
         deconstruct();
         return -1;
     }
 
-    for (size_t i = 0; i < kNotifyMaxPendingSends; ++i) {
-        notify_recv_buffers_[i].resize(kNotifyBufferSize);
-
-        // Register memory for recv buffer
-        notify_recv_mrs_[i] = context_->verbs_.ibv_reg_mr_default(
-            context_->nativePD(), notify_recv_buffers_[i].data(),
-            kNotifyBufferSize, IBV_ACCESS_LOCAL_WRITE);
-        if (!notify_recv_mrs_[i]) {
-            PLOG(ERROR) << "Failed to register notification recv buffer";
-            deconstruct();
-            return -1;
-        }
-
-        postNotifyRecv(i);
-    }
-
     status_ = EP_HANDSHAKING;
     return 0;
 }
@@ -181,21 +119,20 @@ int RdmaEndPoint::deconstruct() {
     }
 
     // Deregister and free notification memory
-    for (auto& mr : notify_recv_mrs_) {
-        if (mr) {
-            if (context_->verbs_.ibv_dereg_mr(mr))
-                PLOG(ERROR) << "Failed to deregister notification recv MR";
-            mr = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(notify_send_mutex_);
+        if (notify_send_mr_) {
+            if (context_->verbs_.ibv_dereg_mr(notify_send_mr_))
+                PLOG(ERROR) << "Failed to deregister notification send MR";
+            notify_send_mr_ = nullptr;
         }
+        notify_send_ring_.clear();
+        notify_send_ring_.shrink_to_fit();
+        // Sends of the destroyed QP will not complete
+        notify_send_ends_.clear();
+        notify_send_head_ = notify_send_tail_ = 0;
+        notify_send_cv_.notify_all();
     }
-    notify_recv_mrs_.clear();
-    if (notify_send_mr_) {
-        if (context_->verbs_.ibv_dereg_mr(notify_send_mr_))
-            PLOG(ERROR) << "Failed to deregister notification send MR";
-        notify_send_mr_ = nullptr;
-    }
-
-    notify_recv_buffers_.clear();
 
     for (size_t i = 0; i < qp_list_.size(); ++i) {
         if (context_->verbs_.ibv_destroy_qp(qp_list_[i]))
@@ -219,36 +156,78 @@ Status RdmaEndPoint::connect(const std::string& peer_server_name,
     if (status_ != EP_HANDSHAKING)
         return Status::InvalidArgument(
             "Endpoint not in handshaking state" LOC_MARK);
-    auto& transport = context_->transport_;
-    auto& manager = transport.metadata_->segmentManager();
-    auto qp_num = qpNum();
+    auto& manager = context_->transport_.metadata_->segmentManager();
     BootstrapDesc local_desc, peer_desc;
-    local_desc.local_nic_path =
-        MakeNicPath(transport.local_segment_name_, context_->name());
-    local_desc.peer_nic_path = MakeNicPath(peer_server_name, peer_nic_name);
-    local_desc.qp_num = qp_num;
-    local_desc.notify_qp_num = notifyQpNum();  // Pass notification QP number
+    fillBootstrapDesc(peer_server_name, peer_nic_name, local_desc);
     std::shared_ptr<SegmentDesc> segment_desc;
     if (local_desc.local_nic_path == local_desc.peer_nic_path) {
         segment_desc = manager.getLocal();
+        peer_desc.qp_num = local_desc.qp_num;
     } else {
         CHECK_STATUS(manager.getRemote(segment_desc, peer_server_name));
         auto rpc_server_addr = segment_desc->getMemory().rpc_server_addr;
         assert(!rpc_server_addr.empty());
         CHECK_STATUS(
             ControlClient::bootstrap(rpc_server_addr, local_desc, peer_desc));
-        qp_num = peer_desc.qp_num;
     }
-    assert(qp_num.size() && segment_desc);
-    auto dev_desc = segment_desc->findDevice(peer_nic_name);
+    assert(segment_desc);
+    return completeConnect(peer_server_name, peer_nic_name, *segment_desc,
+                           peer_desc);
+}
+
+bool RdmaEndPoint::beginConnect(const std::string& peer_server_name,
+                                const std::string& peer_nic_name,
+                                BootstrapDesc& local_desc) {
+    if (peer_server_name.empty() || peer_nic_name.empty()) return false;
+    if (!lock_.tryLock()) return false;
+    if (status_ != EP_HANDSHAKING) {
+        lock_.unlock();
+        return false;
+    }
+    fillBootstrapDesc(peer_server_name, peer_nic_name, local_desc);
+    return true;
+}
+
+Status RdmaEndPoint::finishConnect(const std::string& peer_server_name,
+                                   const std::string& peer_nic_name,
+                                   SegmentDesc& segment_desc,
+                                   const BootstrapDesc& peer_desc) {
+    Status status;
+    if (peer_desc.qp_num.empty()) {
+        status = Status::RpcServiceError(
+            "Bootstrap rejected by peer: " + peer_desc.reply_msg + LOC_MARK);
+    } else {
+        status = completeConnect(peer_server_name, peer_nic_name,
+                                 segment_desc, peer_desc);
+    }
+    lock_.unlock();
+    return status;
+}
+
+void RdmaEndPoint::fillBootstrapDesc(const std::string& peer_server_name,
+                                     const std::string& peer_nic_name,
+                                     BootstrapDesc& local_desc) {
+    local_desc.local_nic_path = MakeNicPath(
+        context_->transport_.local_segment_name_, context_->name());
+    local_desc.peer_nic_path = MakeNicPath(peer_server_name, peer_nic_name);
+    local_desc.qp_num = qpNum();
+    local_desc.notify_qp_num = notifyQpNum();  // Pass notification QP number
+}
+
+Status RdmaEndPoint::completeConnect(const std::string& peer_server_name,
+                                     const std::string& peer_nic_name,
+                                     SegmentDesc& segment_desc,
+                                     const BootstrapDesc& peer_desc) {
+    assert(peer_desc.qp_num.size());
+    auto dev_desc = segment_desc.findDevice(peer_nic_name);
     if (!dev_desc) {
         LOG(ERROR) << "Unable to find RDMA device: " << peer_nic_name
-                   << " in segment " << segment_desc->name;
+                   << " in segment " << segment_desc.name;
         return Status::DeviceNotFound("Unable to find RDMA device" LOC_MARK);
     }
     peer_server_name_ = peer_server_name;
     peer_nic_name_ = peer_nic_name;
-    int rc = setupAllQPs(dev_desc->gid, dev_desc->lid, qp_num);
+    int rc = setupAllQPs(dev_desc->gid, dev_desc->lid, peer_desc.qp_num);
     if (rc) {
         return Status::InternalError(
             "Failed to configure RDMA endpoint" LOC_MARK);
@@ -272,8 +251,27 @@ Status RdmaEndPoint::connect(const std::string& peer_server_name,
 }
 
 Status RdmaEndPoint::accept(const BootstrapDesc& peer_desc,
-                            BootstrapDesc& local_desc) {
-    RWSpinlock::WriteGuard guard(lock_);
+                            BootstrapDesc& local_desc, bool wait) {
+    if (wait) {
+        lock_.lock();
+    } else {
+        // Readers only hold the lock briefly, a handshake holds it for a
+        // round trip
+        const uint64_t deadline = getCurrentTimeInNano() + kAcceptSpinNs;
+        while (!lock_.tryLock()) {
+            if (getCurrentTimeInNano() > deadline)
+                return Status::TooManyRequests(
+                    "Endpoint is busy with another handshake" LOC_MARK);
+            std::this_thread::yield();
+        }
+    }
+    auto status = acceptUnlocked(peer_desc, local_desc);
+    lock_.unlock();
+    return status;
+}
+
+Status RdmaEndPoint::acceptUnlocked(const BootstrapDesc& peer_desc,
+                                    BootstrapDesc& local_desc) {
     if (status_ == EP_READY) {
         LOG(WARNING) << "Endpoint is established with " << peer_nic_name_
                      << " of " << peer_server_name_ << ", resetting first";
@@ -331,15 +329,15 @@ Status RdmaEndPoint::accept(const BootstrapDesc& peer_desc,
     return Status::OK();
 }
 
-int RdmaEndPoint::reset() {
+int RdmaEndPoint::reset(std::vector<RdmaSlice*>* evicted) {
     RWSpinlock::WriteGuard guard(lock_);
-    return resetUnlocked();
+    return resetUnlocked(evicted);
 }
 
-int RdmaEndPoint::resetUnlocked() {
+int RdmaEndPoint::resetUnlocked(std::vector<RdmaSlice*>* evicted) {
     if (status_ != EP_READY) return 0;
     status_ = EP_RESET;
-    resetInflightSlices();
+    resetInflightSlices(evicted);
     ibv_qp_attr attr;
     memset(&attr, 0, sizeof(attr));
     attr.qp_state = IBV_QPS_RESET;
@@ -484,17 +482,23 @@ int RdmaEndPoint::submitRecvImmDataRequest(int qp_index, uint64_t id) {
     return 1;
 }
 
-void RdmaEndPoint::resetInflightSlices() {
+void RdmaEndPoint::resetInflightSlices(std::vector<RdmaSlice*>* evicted) {
     for (int qp_index = 0; qp_index < (int)qp_list_.size(); ++qp_index) {
         auto& queue = slice_queue_[qp_index];
         while (!queue.empty()) {
             auto current = queue.pop();
-            updateSliceStatus(current, TransferStatusEnum::CANCELED);
+            if (evicted) {
+                current->ep_weak_ptr = nullptr;
+                evicted->push_back(current);
+            } else {
+                updateSliceStatus(current, TransferStatusEnum::CANCELED);
+            }
         }
     }
 }
 
-size_t RdmaEndPoint::acknowledge(RdmaSlice* slice, TransferStatusEnum status) {
+size_t RdmaEndPoint::acknowledge(RdmaSlice* slice, TransferStatusEnum status,
+                                 SliceCompletionBatch* batch) {
     auto qp_index = slice->qp_index;
     auto& queue = slice_queue_[qp_index];
     if (!queue.contains(slice)) return 0;
@@ -504,9 +508,12 @@ size_t RdmaEndPoint::acknowledge(RdmaSlice* slice, TransferStatusEnum status) {
         current = queue.pop();
         if (!current) break;
         num_entries++;
-        updateSliceStatus(current, status);
+        updateSliceStatus(current, status, batch);
     } while (current != slice);
     cancelQuota(qp_index, num_entries);
+    if (num_entries)
+        last_progress_ts_.store(getCurrentTimeInNano(),
+                                std::memory_order_relaxed);
     return num_entries;
 }
 
@@ -638,24 +645,42 @@ int RdmaEndPoint::setupOneQP(int qp_index, const std::string& peer_gid,
     return 0;
 }
 
-void RdmaEndPoint::postNotifyRecv(size_t idx) {
-    if (idx >= notify_recv_buffers_.size() || idx >= notify_recv_mrs_.size())
-        return;
+int RdmaEndPoint::createNotifyQp() {
+    auto notify_cq = context_->notifyCq()->cq();
+    ibv_qp_init_attr notify_attr;
+    memset(&notify_attr, 0, sizeof(notify_attr));
+    notify_attr.send_cq = notify_cq;
+    notify_attr.recv_cq = notify_cq;
+    notify_attr.srq = context_->notifySrq();
+    notify_attr.sq_sig_all = true;  // Always signal for notifications
+    notify_attr.qp_type = IBV_QPT_RC;
+    notify_attr.cap.max_send_wr = kNotifyMaxPendingSends;
+    notify_attr.cap.max_send_sge = kNotifySendSge;
+    notify_attr.cap.max_inline_data = params_->max_inline_bytes;
 
-    ibv_sge sge = {};
-    sge.addr = reinterpret_cast<uint64_t>(notify_recv_buffers_[idx].data());
-    sge.length = notify_recv_buffers_[idx].size();
-    sge.lkey = notify_recv_mrs_[idx]->lkey;
+    notify_qp_ =
+        context_->verbs_.ibv_create_qp(context_->nativePD(), &notify_attr);
+    if (!notify_qp_) {
+        PLOG(ERROR) << "Failed to create notification QP";
+        return -1;
+    }
+    notify_max_inline_ = notify_attr.cap.max_inline_data;
 
-    ibv_recv_wr wr = {};
-    wr.wr_id = idx;
-    wr.sg_list = &sge;
-    wr.num_sge = 1;
+    // Modify notification QP to INIT
+    ibv_qp_attr qp_attr;
+    memset(&qp_attr, 0, sizeof(qp_attr));
+    qp_attr.qp_state = IBV_QPS_INIT;
+    qp_attr.pkey_index = 0;
+    qp_attr.port_num = context_->portNum();
+    qp_attr.qp_access_flags = IBV_ACCESS_REMOTE_WRITE;
 
-    ibv_recv_wr* bad_wr = nullptr;
-    if (ibv_post_recv(notify_qp_, &wr, &bad_wr)) {
-        PLOG(ERROR) << "Failed to post notification recv";
+    if (context_->verbs_.ibv_modify_qp(notify_qp_, &qp_attr,
+                                       IBV_QP_STATE | IBV_QP_PKEY_INDEX |
+                                           IBV_QP_PORT | IBV_QP_ACCESS_FLAGS)) {
+        PLOG(ERROR) << "Failed to modify notification QP to INIT";
+        return -1;
     }
+    return 0;
 }
 
 static int setupNotifyQpConnection(ibv_qp* qp, RdmaContext* ctx,
@@ -727,39 +752,64 @@ bool RdmaEndPoint::sendNotification(const std::string& name,
         return false;
     }
 
-    // Flow control: wait for pending sends to complete
-    std::unique_lock<std::mutex> lock(notify_send_mutex_);
-    notify_send_cv_.wait(lock, [this] {
-        return notify_pending_count_ < kNotifyMaxPendingSends;
-    });
-
     // Serialize: [name_len(4)][name][msg_len(4)][msg]
     uint32_t name_len = name.size();
     uint32_t msg_len = msg.size();
     size_t total_size = sizeof(name_len) + name_len + sizeof(msg_len) + msg_len;
-    if (total_size > notify_send_buffer_.size()) {
+    if (total_size > RdmaContext::kNotifyMessageSize) {
         LOG(ERROR) << "Notification message too large: " << total_size;
         return false;
     }
-
-    std::memcpy(notify_send_buffer_.data(), &name_len, 4);
-    std::memcpy(notify_send_buffer_.data() + 4, name.data(), name.size());
-    std::memcpy(notify_send_buffer_.data() + 4 + name.size(), &msg_len, 4);
-    std::memcpy(notify_send_buffer_.data() + 4 + name.size() + 4, msg.data(),
-                msg.size());
-
-    // Post send
-    ibv_sge sge = {};
-    sge.addr = reinterpret_cast<uint64_t>(notify_send_buffer_.data());
-    sge.length = total_size;
-    sge.lkey = notify_send_mr_->lkey;
+    ibv_sge sge_list[kNotifySendSge] = {};
+    sge_list[0].addr = reinterpret_cast<uint64_t>(&name_len);
+    sge_list[0].length = sizeof(name_len);
+    sge_list[1].addr = reinterpret_cast<uint64_t>(name.data());
+    sge_list[1].length = name_len;
+    sge_list[2].addr = reinterpret_cast<uint64_t>(&msg_len);
+    sge_list[2].length = sizeof(msg_len);
+    sge_list[3].addr = reinterpret_cast<uint64_t>(msg.data());
+    sge_list[3].length = msg_len;
+
+    const bool inline_send = total_size <= notify_max_inline_;
+    // Bytes taken in the send ring; a message never wraps around it
+    uint64_t offset = 0, reserved = 0;
+    auto reserve = [&] {
+        offset = notify_send_head_ % kNotifySendRingSize;
+        reserved = inline_send ? 0 : total_size;
+        if (!inline_send && offset + total_size > kNotifySendRingSize)
+            reserved += kNotifySendRingSize - offset;
+        return notify_send_ends_.size() < kNotifyMaxPendingSends &&
+               notify_send_head_ + reserved - notify_send_tail_ <=
+                   kNotifySendRingSize;
+    };
+    // Flow control: wait for pending sends to complete
+    std::unique_lock<std::mutex> lock(notify_send_mutex_);
+    notify_send_cv_.wait(lock, reserve);
+    if (!notify_qp_ || !notify_connected_) return false;
 
     ibv_send_wr wr = {};
     wr.wr_id = notify_send_wr_id_++;
-    wr.sg_list = &sge;
-    wr.num_sge = 1;
     wr.opcode = IBV_WR_SEND;
     wr.send_flags = IBV_SEND_SIGNALED;
+    wr.sg_list = sge_list;
+    if (inline_send) {
+        // The post copies the message from the caller's strings
+        wr.send_flags |= IBV_SEND_INLINE;
+        wr.num_sge = kNotifySendSge;
+    } else {
+        if (!notify_send_mr_ && !allocateNotifySendRing()) return false;
+        if (reserved != total_size) offset = 0;
+        char* buffer = notify_send_ring_.data() + offset;
+        for (auto& sge : sge_list) {
+            memcpy(buffer, reinterpret_cast<void*>(sge.addr), sge.length);
+            buffer += sge.length;
+        }
+        sge_list[0].addr =
+            reinterpret_cast<uint64_t>(notify_send_ring_.data() + offset);
+        sge_list[0].length = total_size;
+        sge_list[0].lkey = notify_send_mr_->lkey;
+        wr.num_sge = 1;
+    }
 
     ibv_send_wr* bad_wr = nullptr;
     int ret = ibv_post_send(notify_qp_, &wr, &bad_wr);
@@ -771,62 +821,31 @@ bool RdmaEndPoint::sendNotification(const std::string& name,
         return false;
     }
 
-    notify_pending_count_++;
+    notify_send_head_ += reserved;
+    notify_send_ends_.push_back(notify_send_head_);
     return true;
 }
 
-bool RdmaEndPoint::handleNotifyRecv(size_t buffer_idx, size_t byte_len) {
-    if (buffer_idx >= notify_recv_buffers_.size()) {
-        LOG(ERROR) << "Invalid recv buffer index: " << buffer_idx;
-        return false;
-    }
-
-    // Silent retry for byte_len == 0
-    if (byte_len == 0) {
-        postNotifyRecv(buffer_idx);
-        return false;
-    }
-
-    char* data = notify_recv_buffers_[buffer_idx].data();
-    size_t len = byte_len;
-
-    // Deserialize: [name_len(4)][name][msg_len(4)][msg]
-    if (len < 8) {
-        LOG(ERROR) << "Invalid notification message size: " << len;
-        postNotifyRecv(buffer_idx);
-        return false;
-    }
-
-    uint32_t name_len = *reinterpret_cast<uint32_t*>(data);
-    if (name_len > len - 8) {
-        LOG(ERROR) << "Invalid notification message format (name too long)";
-        postNotifyRecv(buffer_idx);
-        return false;
-    }
-
-    std::string name(data + 4, name_len);
-    uint32_t msg_len = *reinterpret_cast<uint32_t*>(data + 4 + name_len);
-    if (msg_len > len - 8 - name_len) {
-        LOG(ERROR) << "Invalid notification message format (msg too long)";
-        postNotifyRecv(buffer_idx);
+bool RdmaEndPoint::allocateNotifySendRing() {
+    notify_send_ring_.resize(kNotifySendRingSize);
+    notify_send_mr_ = context_->verbs_.ibv_reg_mr_default(
+        context_->nativePD(), notify_send_ring_.data(), kNotifySendRingSize,
+        IBV_ACCESS_LOCAL_WRITE);
+    if (!notify_send_mr_) {
+        PLOG(ERROR) << "Failed to register notification send buffer";
+        notify_send_ring_.clear();
         return false;
     }
-
-    std::string msg(data + 4 + name_len + 4, msg_len);
-
-    // Add directly to transport queue (skip endpoint queue for lower latency)
-    context_->transport_.addNotificationToQueue(name, msg);
-
-    // Repost recv buffer
-    postNotifyRecv(buffer_idx);
     return true;
 }
 
 void RdmaEndPoint::handleNotifySendComplete(uint64_t wr_id) {
+    // Sends of the QP complete in posting order, failed ones included
     std::lock_guard<std::mutex> lock(notify_send_mutex_);
-    if (notify_pending_count_ > 0) {
-        notify_pending_count_--;
-        notify_send_cv_.notify_one();
+    if (!notify_send_ends_.empty()) {
+        notify_send_tail_ = notify_send_ends_.front();
+        notify_send_ends_.pop_front();
+        notify_send_cv_.notify_all();
     }
 }
 }  // namespace tent
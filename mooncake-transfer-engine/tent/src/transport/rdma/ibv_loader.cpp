@@ -73,6 +73,9 @@ IbvLoader::IbvLoader() {
     ok &= LoadSymbol(handle_, "ibv_destroy_qp", symbols_.ibv_destroy_qp);
     ok &= LoadSymbol(handle_, "ibv_modify_qp", symbols_.ibv_modify_qp);
 
+    ok &= LoadSymbol(handle_, "ibv_create_srq", symbols_.ibv_create_srq);
+    ok &= LoadSymbol(handle_, "ibv_destroy_srq", symbols_.ibv_destroy_srq);
+
     ok &= LoadSymbol(handle_, "ibv_get_cq_event", symbols_.ibv_get_cq_event);
     ok &= LoadSymbol(handle_, "ibv_ack_cq_events", symbols_.ibv_ack_cq_events);
 
@@ -15,6 +15,7 @@
 #include "tent/transport/rdma/quota.h"
 #include "tent/transport/rdma/shared_quota.h"
 #include "tent/common/utils/random.h"
+#include "tent/metrics/tent_metrics.h"
 
 #include <assert.h>
 #include <unordered_set>
@@ -52,6 +53,26 @@ struct TlsDeviceInfo {
 
 thread_local std::unordered_map<int, TlsDeviceInfo> tl_device_info;
 
+// Threads start from the model of the process rather than the defaults
+static TlsDeviceInfo& getTlsDeviceInfo(int dev_id,
+                                       const DeviceQuota::DeviceInfo& dev) {
+    auto it = tl_device_info.find(dev_id);
+    if (it != tl_device_info.end()) return it->second;
+    auto& tl_dev = tl_device_info[dev_id];
+    tl_dev.beta0 = dev.beta0.load(std::memory_order_relaxed);
+    tl_dev.beta1 = dev.beta1.load(std::memory_order_relaxed);
+    return tl_dev;
+}
+
+void DeviceQuota::warmStart(int dev_id, double beta0, double beta1) {
+    auto it = devices_.find(dev_id);
+    if (it == devices_.end()) return;
+    it->second.beta0.store(std::clamp(beta0, 0.0, 5e-4),
+                           std::memory_order_relaxed);
+    it->second.beta1.store(std::clamp(beta1, 0.5, 20.0),
+                           std::memory_order_relaxed);
+}
+
 Status DeviceQuota::allocate(uint64_t length, const std::string& location,
                              int& chosen_dev_id) {
     auto entry = local_topology_->getMemEntry(location);
@@ -81,7 +102,7 @@ Status DeviceQuota::allocate(uint64_t length, const std::string& location,
         for (int dev_id : entry->device_list[rank]) {
             if (!devices_.count(dev_id)) continue;
             auto& dev = devices_[dev_id];
-            auto& tl_dev = tl_device_info[dev_id];
+            auto& tl_dev = getTlsDeviceInfo(dev_id, dev);
             uint64_t overall_active_bytes =
                 dev.diffusion_active_bytes.load(std::memory_order_relaxed) +
                 dev.active_bytes.load(std::memory_order_relaxed);
@@ -132,7 +153,7 @@ Status DeviceQuota::release(int dev_id, uint64_t length, double latency) {
         return Status::InvalidArgument("device not found");
 
     auto& dev = it->second;
-    auto& tl_dev = tl_device_info[dev_id];
+    auto& tl_dev = getTlsDeviceInfo(dev_id, dev);
 
     if (local_weight_ < 1 - 1e-6)
         dev.active_bytes.fetch_sub(length, std::memory_order_relaxed);
@@ -154,6 +175,10 @@ Status DeviceQuota::release(int dev_id, uint64_t length, double latency) {
     double err = obs_time - pred_time;
     double rel_err = (pred_time > 1e-9) ? (err / pred_time) : 0.0;
 
+    double error_g = dev.prediction_error.load(std::memory_order_relaxed);
+    dev.prediction_error.store(error_g + alpha_ * (std::abs(rel_err) - error_g),
+                               std::memory_order_relaxed);
+
     double adapt_alpha = alpha_;
     if (std::abs(err) > 0.05 * pred_time)
         adapt_alpha = std::min(1.0, alpha_ * 5.0);
@@ -173,13 +198,30 @@ Status DeviceQuota::release(int dev_id, uint64_t length, double latency) {
                         std::memory_order_relaxed);
         dev.beta1.store(std::clamp(new_beta1_g, 0.5, 20.0),
                         std::memory_order_relaxed);
-        if (shared_quota_) {
-            thread_local uint64_t tl_last_ts = 0;
-            uint64_t now = getCurrentTimeInNano();
-            if (now - tl_last_ts > diffusion_interval_) {
-                tl_last_ts = now;
-                return shared_quota_->diffusion();
-            }
+        dev.samples.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (TentMetrics::isEnabled()) {
+        const static uint64_t kReportInterval = 1000000000ull;
+        thread_local uint64_t tl_last_report_ts = 0;
+        uint64_t now = getCurrentTimeInNano();
+        if (now - tl_last_report_ts > kReportInterval) {
+            tl_last_report_ts = now;
+            // The model as seen by the predictions of this thread
+            TentMetrics::instance().recordDeviceModel(
+                local_topology_->getNicName(dev_id),
+                w * tl_dev.beta0 + (1.0 - w) * dev.beta0.load(),
+                w * tl_dev.beta1 + (1.0 - w) * dev.beta1.load(),
+                dev.prediction_error.load(std::memory_order_relaxed));
+        }
+    }
+
+    if (local_weight_ < 1 - 1e-6 && shared_quota_) {
+        thread_local uint64_t tl_last_ts = 0;
+        uint64_t now = getCurrentTimeInNano();
+        if (now - tl_last_ts > diffusion_interval_) {
+            tl_last_ts = now;
+            return shared_quota_->diffusion();
         }
     }
     return Status::OK();
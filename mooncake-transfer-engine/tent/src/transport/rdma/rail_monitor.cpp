@@ -14,6 +14,8 @@
 
 #include "tent/transport/rdma/rail_monitor.h"
 
+#include "tent/common/utils/random.h"
+
 namespace mooncake {
 namespace tent {
 
@@ -33,42 +35,63 @@ bool RailMonitor::available(int local_nic, int remote_nic) {
     auto it = rail_states_.find(std::make_pair(local_nic, remote_nic));
     if (it == rail_states_.end()) return false;
     auto &st = it->second;
+    auto now = std::chrono::steady_clock::now();
     if (st.paused) {
-        auto now = std::chrono::steady_clock::now();
-        if (now >= st.resume_time) {
-            st.paused = false;
-            st.error_count = 0;
-            updateBestMapping();
+        if (now < st.resume_time) return false;
+        resume(st, now);
+    }
+    if (st.probation) {
+        auto elapsed = now - st.probation_start;
+        if (elapsed >= policy_.probation) {
+            // A clean probation forgives the earlier pauses
+            st.probation = false;
+            st.cooldown = std::chrono::milliseconds(0);
             return true;
         }
-        return false;
+        // Admit a linearly growing share of the traffic, at least 1/16
+        double ratio = std::chrono::duration<double>(elapsed).count() /
+                       std::chrono::duration<double>(policy_.probation).count();
+        uint32_t admitted = std::max(uint32_t(ratio * 1024), 64u);
+        return SimpleRandom::Get().next(1024) < admitted;
     }
     return true;
 }
 
+bool RailMonitor::paused(int local_nic, int remote_nic) {
+    auto it = rail_states_.find(std::make_pair(local_nic, remote_nic));
+    return it != rail_states_.end() && it->second.paused;
+}
+
+bool RailMonitor::admissible(int local_nic, int remote_nic) const {
+    auto it = rail_states_.find(std::make_pair(local_nic, remote_nic));
+    return it != rail_states_.end() && !it->second.paused;
+}
+
 void RailMonitor::markFailed(int local_nic, int remote_nic) {
     auto it = rail_states_.find(std::make_pair(local_nic, remote_nic));
     if (it == rail_states_.end()) return;
     auto &st = it->second;
+    if (st.paused) return;
     auto now = std::chrono::steady_clock::now();
-    if (st.error_count == 0 || now - st.last_error > error_window_) {
+    if (st.error_count == 0 || now - st.last_error > policy_.error_window) {
         st.error_count = 1;
     } else {
         st.error_count++;
     }
     st.last_error = now;
-    if (st.cooldown.count() == 0) {
-        st.cooldown = cooldown_;
-    } else {
-        st.cooldown *= 2;
-        if (st.cooldown > std::chrono::seconds(300))
-            st.cooldown = std::chrono::seconds(300);
-    }
-    if (st.error_count >= error_threshold_) {
-        st.paused = true;
-        st.resume_time = now + st.cooldown;
-        updateBestMapping();
-    }
+    // A rail failing again during probation is likely flapping
+    if (st.error_count >= policy_.error_threshold || st.probation)
+        pause(st, now);
+}
+
+void RailMonitor::markDegraded(int local_nic, int remote_nic) {
+    auto it = rail_states_.find(std::make_pair(local_nic, remote_nic));
+    if (it == rail_states_.end()) return;
+    auto &st = it->second;
+    if (st.paused) return;
+    auto now = std::chrono::steady_clock::now();
+    st.last_error = now;
+    pause(st, now);
 }
 
 void RailMonitor::markRecovered(int local_nic, int remote_nic) {
@@ -77,10 +100,65 @@ void RailMonitor::markRecovered(int local_nic, int remote_nic) {
     auto &st = it->second;
     st.error_count = 0;
     st.paused = false;
+    st.probation = false;
     st.resume_time = {};
     updateBestMapping();
 }
 
+bool RailMonitor::probeDue(int local_nic, int remote_nic) {
+    if (policy_.probe_interval.count() == 0) return false;
+    auto it = rail_states_.find(std::make_pair(local_nic, remote_nic));
+    if (it == rail_states_.end() || !it->second.paused) return false;
+    return std::chrono::steady_clock::now() >= it->second.next_probe;
+}
+
+void RailMonitor::onProbeResult(int local_nic, int remote_nic, bool success) {
+    auto it = rail_states_.find(std::make_pair(local_nic, remote_nic));
+    if (it == rail_states_.end()) return;
+    auto &st = it->second;
+    if (!st.paused) return;
+    auto now = std::chrono::steady_clock::now();
+    if (!success) {
+        st.probe_successes = 0;
+    } else if (++st.probe_successes >= policy_.probe_successes) {
+        resume(st, now);
+        return;
+    }
+    st.next_probe = now + probeInterval(st);
+}
+
+void RailMonitor::pause(RailState &st,
+                        std::chrono::steady_clock::time_point now) {
+    if (st.cooldown.count() == 0) {
+        st.cooldown = policy_.cooldown;
+    } else {
+        st.cooldown = std::min(st.cooldown * 2, policy_.max_cooldown);
+    }
+    st.paused = true;
+    st.probation = false;
+    st.resume_time = now + st.cooldown;
+    st.probe_successes = 0;
+    st.next_probe = now + probeInterval(st);
+    updateBestMapping();
+}
+
+void RailMonitor::resume(RailState &st,
+                         std::chrono::steady_clock::time_point now) {
+    st.paused = false;
+    st.error_count = 0;
+    st.probation = policy_.probation.count() > 0;
+    st.probation_start = now;
+    updateBestMapping();
+}
+
+std::chrono::milliseconds RailMonitor::probeInterval(
+    const RailState &st) const {
+    // Back off probing of a flapping rail along with its cooldown
+    auto base = std::max(policy_.cooldown.count(), int64_t(1));
+    auto scale = std::max(st.cooldown.count() / base, int64_t(1));
+    return policy_.probe_interval * scale;
+}
+
 int RailMonitor::findBestRemoteDevice(int local_nic, int remote_numa) {
     if (remote_numa >= 0 && remote_numa < (int)kMaxNuma) {
         if (best_mapping_[remote_numa].count(local_nic))
@@ -276,10 +354,10 @@ void RailMonitor::updateBestMapping() {
                     remote_nic = direct_rails_[local_nic];
                 else
                     remote_nic = remote_devices[remote_numa][i % remote_cnt];
-                if (!available(local_nic, remote_nic)) {
+                if (!admissible(local_nic, remote_nic)) {
                     bool found = false;
                     for (int cand : remote_devices[remote_numa]) {
-                        if (available(local_nic, cand)) {
+                        if (admissible(local_nic, cand)) {
                             remote_nic = cand;
                             found = true;
                             break;
@@ -287,7 +365,7 @@ void RailMonitor::updateBestMapping() {
                     }
                     if (!found) {
                         for (int cand = 0; cand < remote_nic_count; ++cand) {
-                            if (available(local_nic, cand)) {
+                            if (admissible(local_nic, cand)) {
                                 remote_nic = cand;
                                 break;
                             }
@@ -19,6 +19,7 @@
 #include <sys/mman.h>
 #include <sys/time.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <future>
@@ -88,6 +89,9 @@ static void convertConfToRdmaParams(std::shared_ptr<Config> conf,
     SET_WORKERS(block_size, params->workers.block_size);
     SET_WORKERS(grace_period_ns, params->workers.grace_period_ns);
     SET_WORKERS(rail_topo_path, params->workers.rail_topo_path);
+    SET_WORKERS(affinity, params->workers.affinity);
+    params->workers.cpu_list =
+        conf->getArray<std::string>("transports/rdma/workers/cpu_list");
 
     params->verbose = conf->get("verbose", false);
 }
@@ -175,6 +179,8 @@ Status RdmaTransport::install(std::string& local_segment_name,
     workers_->start();
 
     // Start notification worker thread
+    notify_spin_us_ = conf_->get("transports/rdma/notify_spin_us", 1000);
+    notify_poll_interval_us_ = kNotifyMinPollUs;
     notify_worker_running_ = true;
     notify_worker_ = std::thread(&RdmaTransport::notifyWorkerThread, this);
 
@@ -408,7 +414,13 @@ int RdmaTransport::onSetupRdmaConnections(const BootstrapDesc& peer_desc,
         local_desc.reply_msg = ss.str();
         return -1;
     }
-    auto status = endpoint->accept(peer_desc, local_desc);
+    // Two processes may connect to each other at the same time, each holding
+    // its own endpoint while waiting for the other to accept. The one with
+    // the smaller name gives up instead of waiting, so that the other's
+    // connect completes and accepts it in turn.
+    auto peer_server_name = getServerNameFromNicPath(peer_desc.local_nic_path);
+    bool wait = !(local_segment_name_ < peer_server_name);
+    auto status = endpoint->accept(peer_desc, local_desc, wait);
     if (!status.ok()) {
         LOG(ERROR) << status.ToString();
         local_desc.reply_msg = status.ToString();
@@ -418,6 +430,93 @@ int RdmaTransport::onSetupRdmaConnections(const BootstrapDesc& peer_desc,
     return 0;
 }
 
+Status RdmaTransport::warmupSegments(const std::vector<SegmentID>& target_ids) {
+    struct PendingEndpoint {
+        std::shared_ptr<RdmaEndPoint> endpoint;
+        std::string nic_name;
+    };
+    struct PendingPeer {
+        SegmentDescRef segment_desc;
+        std::vector<PendingEndpoint> endpoints;
+    };
+    auto& manager = metadata_->segmentManager();
+    std::vector<PendingPeer> peers;
+    std::vector<std::string> server_addrs;
+    std::vector<std::vector<BootstrapDesc>> requests;
+    for (auto target_id : target_ids) {
+        // Loopback endpoints connect without RPC
+        if (target_id == LOCAL_SEGMENT_ID) continue;
+        // A copy stays valid while the cache is refreshed
+        SegmentDesc* cached_desc = nullptr;
+        auto status = manager.getRemoteCached(cached_desc, target_id);
+        if (!status.ok()) {
+            LOG(WARNING) << "Skip warming up segment " << target_id << ": "
+                         << status.ToString();
+            continue;
+        }
+        if (cached_desc->type != SegmentType::Memory) continue;
+        auto segment_desc = std::make_shared<SegmentDesc>(*cached_desc);
+        PendingPeer peer;
+        std::vector<BootstrapDesc> peer_requests;
+        for (auto& context : context_set_) {
+            if (context->status() != RdmaContext::DEVICE_ENABLED) continue;
+            for (auto& device : segment_desc->getMemory().devices) {
+                auto peer_name = MakeNicPath(segment_desc->name, device.name);
+                auto store = context->endpointStore();
+                auto endpoint = store->getOrInsert(peer_name);
+                if (endpoint &&
+                    endpoint->status() == RdmaEndPoint::EP_RESET) {
+                    store->remove(endpoint.get());
+                    endpoint = store->getOrInsert(peer_name);
+                }
+                BootstrapDesc request;
+                if (!endpoint || !endpoint->beginConnect(segment_desc->name,
+                                                         device.name, request))
+                    continue;
+                peer.endpoints.push_back({endpoint, device.name});
+                peer_requests.push_back(std::move(request));
+            }
+        }
+        if (peer.endpoints.empty()) continue;
+        server_addrs.push_back(segment_desc->getMemory().rpc_server_addr);
+        requests.push_back(std::move(peer_requests));
+        peer.segment_desc = segment_desc;
+        peers.push_back(std::move(peer));
+    }
+    if (peers.empty()) return Status::OK();
+
+    std::vector<std::vector<BootstrapDesc>> responses;
+    auto status_list =
+        ControlClient::bootstrapBatch(server_addrs, requests, responses);
+    size_t failed = 0;
+    for (size_t i = 0; i < peers.size(); ++i) {
+        auto& peer = peers[i];
+        for (size_t j = 0; j < peer.endpoints.size(); ++j) {
+            BootstrapDesc peer_desc;
+            if (status_list[i].ok())
+                peer_desc = responses[i][j];
+            else
+                peer_desc.reply_msg = status_list[i].ToString();
+            // Endpoints that fail stay in handshaking state and connect on
+            // first use
+            auto& pending = peer.endpoints[j];
+            auto status = pending.endpoint->finishConnect(
+                peer.segment_desc->name, pending.nic_name, *peer.segment_desc,
+                peer_desc);
+            if (!status.ok()) {
+                LOG(WARNING) << "Unable to warm up endpoint "
+                             << pending.endpoint->name() << ": "
+                             << status.ToString();
+                failed++;
+            }
+        }
+    }
+    if (failed)
+        return Status::RdmaError("Failed to warm up " + std::to_string(failed) +
+                                 " endpoints" LOC_MARK);
+    return Status::OK();
+}
+
 std::shared_ptr<RdmaEndPoint> RdmaTransport::getEndpoint(SegmentID target_id,
                                                          int device_id) {
     SegmentDesc* segment_desc = nullptr;
@@ -512,12 +611,22 @@ int RdmaTransport::processNotifyCompletions() {
         }
 
         if (completed == 0) continue;
+        total_completions += completed;
 
         // Process each completion
         for (int i = 0; i < completed; ++i) {
-            if (wc[i].status != IBV_WC_SUCCESS) {
+            if (wc[i].status != IBV_WC_SUCCESS &&
+                wc[i].status != IBV_WC_WR_FLUSH_ERR) {
                 LOG(ERROR) << "Notification completion failed: " << wc[i].status
                            << ", qp_num=" << wc[i].qp_num;
+            }
+
+            // RECV completions come from the shared receive queue: parse
+            // and add to transport queue, then repost the buffer
+            if (wc[i].wr_id & RdmaContext::kNotifyRecvTag) {
+                context->handleNotifyRecv(
+                    wc[i].wr_id,
+                    wc[i].status == IBV_WC_SUCCESS ? wc[i].byte_len : 0);
                 continue;
             }
 
@@ -537,13 +646,9 @@ int RdmaTransport::processNotifyCompletions() {
                 continue;
             }
 
-            // Handle RECV completions: parse and add to transport queue
-            if (wc[i].opcode == IBV_WC_RECV) {
-                endpoint->handleNotifyRecv(wc[i].wr_id, wc[i].byte_len);
-            } else if (wc[i].opcode == IBV_WC_SEND) {
-                // Handle SEND completions: cleanup pending sends
-                endpoint->handleNotifySendComplete(wc[i].wr_id);
-            }
+            // Handle SEND completions, failed ones too: cleanup pending
+            // sends
+            endpoint->handleNotifySendComplete(wc[i].wr_id);
         }
     }
 
@@ -561,9 +666,21 @@ void RdmaTransport::unregisterNotifyQp(uint32_t qp_num) {
 }
 
 void RdmaTransport::notifyWorkerThread() {
+    // Busy polls for notify_spin_us_ after the last completion, so that the
+    // messages of an exchange are picked up within microseconds, then
+    // backs off towards kNotifyMaxPollUs while idle
+    uint64_t last_active_ts = 0;
     while (notify_worker_running_) {
-        processNotifyCompletions();
+        uint64_t current_ts = getCurrentTimeInNano();
+        if (processNotifyCompletions()) {
+            last_active_ts = current_ts;
+            notify_poll_interval_us_ = kNotifyMinPollUs;
+            continue;
+        }
+        if (current_ts - last_active_ts < notify_spin_us_ * 1000ull) continue;
         usleep(notify_poll_interval_us_);
+        notify_poll_interval_us_ =
+            std::min(notify_poll_interval_us_ * 2, kNotifyMaxPollUs);
     }
 }
 }  // namespace tent
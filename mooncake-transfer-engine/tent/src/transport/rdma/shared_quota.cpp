@@ -245,11 +245,55 @@ Status SharedQuotaManager::attachProcess() {
         if (hdr_->devices[i].dev_name[0] != '\0') ++count;
     hdr_->num_devices = count;
 
+    // Start from what the processes before us have learned
+    for (int d = 0; d < hdr_->num_devices; ++d) {
+        auto& entry = hdr_->devices[d];
+        if (!entry.model_samples) continue;
+        auto dev_id = topo->getNicId(entry.dev_name);
+        if (dev_id < 0) continue;
+        local_quota_->warmStart(dev_id, entry.beta0, entry.beta1);
+        VLOG(1) << "Warm started quota model of " << entry.dev_name
+                << ": beta0 " << entry.beta0 << ", beta1 " << entry.beta1;
+    }
+
     unlock();
     return Status::OK();
 }
 
-Status SharedQuotaManager::detachProcess() { return Status::OK(); }
+Status SharedQuotaManager::detachProcess() {
+    if (!hdr_) return Status::OK();
+    if (lock() != 0) return Status::OK();
+    // Leave the final model behind for the next processes
+    for (int d = 0; d < hdr_->num_devices; ++d) {
+        auto dev_id = local_quota_->getTopology()->getNicId(
+            hdr_->devices[d].dev_name);
+        if (dev_id >= 0) publishModelLocked(d, dev_id);
+    }
+    unlock();
+    return Status::OK();
+}
+
+void SharedQuotaManager::publishModelLocked(int shared_id, int dev_id) {
+    auto info = local_quota_->getDeviceInfo(dev_id);
+    if (!info) return;
+    uint64_t samples = info->samples.load(std::memory_order_relaxed);
+    uint64_t fresh = samples - published_samples_[dev_id];
+    if (!fresh) return;
+    published_samples_[dev_id] = samples;
+    double beta0 = info->beta0.load(std::memory_order_relaxed);
+    double beta1 = info->beta1.load(std::memory_order_relaxed);
+    auto& entry = hdr_->devices[shared_id];
+    if (entry.model_samples) {
+        // Average the processes, weighting this one by its fresh samples
+        double weight = double(fresh) / double(entry.model_samples + fresh);
+        weight = std::max(weight, 0.1);
+        beta0 = entry.beta0 + weight * (beta0 - entry.beta0);
+        beta1 = entry.beta1 + weight * (beta1 - entry.beta1);
+    }
+    entry.beta0 = beta0;
+    entry.beta1 = beta1;
+    entry.model_samples = entry.model_samples + fresh;
+}
 
 Status SharedQuotaManager::diffusion() {
     if (!hdr_) return Status::InvalidArgument("not attached");
@@ -262,7 +306,7 @@ Status SharedQuotaManager::diffusion() {
         std::string dev_name = hdr_->devices[d].dev_name;
         auto dev_id = local_quota_->getTopology()->getNicId(dev_name);
         if (dev_name.empty() || dev_id < 0) continue;
-        PidUsage* slot = findOrCreatePidSlotLocked(dev_id, pid);
+        PidUsage* slot = findOrCreatePidSlotLocked(d, pid);
         if (!slot) {
             unlock();
             return Status::InternalError("no free pid slot for device");
@@ -276,6 +320,7 @@ Status SharedQuotaManager::diffusion() {
             sum < used_bytes ? 0 : sum - used_bytes;
         hdr_->devices[d].active_bytes = sum;
         local_quota_->setDiffusionActiveBytes(dev_id, diffusion_active_bytes);
+        publishModelLocked(d, dev_id);
     }
     unlock();
     return Status::OK();
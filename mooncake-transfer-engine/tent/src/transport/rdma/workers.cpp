@@ -16,13 +16,18 @@
 
 #include <sys/epoll.h>
 
+#include <algorithm>
 #include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <set>
 
 #include "tent/transport/rdma/endpoint_store.h"
 #include "tent/common/utils/ip.h"
 #include "tent/common/utils/string_builder.h"
 #include "tent/common/utils/os.h"
 #include "tent/common/utils/random.h"
+#include "tent/metrics/tent_metrics.h"
 
 namespace mooncake {
 namespace tent {
@@ -46,6 +51,25 @@ Workers::Workers(RdmaTransport* transport)
     auto diffusion_interval =
         conf->get("transports/rdma/diffusion_interval", 10);
     device_quota_->setDiffusionInterval(diffusion_interval);
+
+    using std::chrono::milliseconds;
+    rail_policy_.error_threshold = conf->get(
+        "transports/rdma/rail_error_threshold", rail_policy_.error_threshold);
+    rail_policy_.cooldown = milliseconds(
+        conf->get("transports/rdma/rail_cooldown_ms", 30000));
+    rail_policy_.max_cooldown = milliseconds(
+        conf->get("transports/rdma/rail_max_cooldown_ms", 300000));
+    rail_policy_.probe_interval = milliseconds(
+        conf->get("transports/rdma/rail_probe_interval_ms", 10));
+    rail_policy_.probe_successes =
+        conf->get("transports/rdma/rail_probe_successes", 3);
+    rail_policy_.probation = milliseconds(
+        conf->get("transports/rdma/rail_probation_ms", 2000));
+    rail_probe_timeout_ns_ =
+        conf->get("transports/rdma/rail_probe_timeout_ns", 5000000ull);
+    rail_stall_timeout_ns_ =
+        conf->get("transports/rdma/rail_stall_timeout_ns", 100000000ull);
+    priority_weight_ = conf->get("transports/rdma/priority_weight", 0);
 }
 
 Workers::~Workers() {
@@ -60,6 +84,13 @@ Status Workers::start() {
         num_workers_ = transport_->params_->workers.num_workers;
         slice_timeout_ns_ = transport_->conf_->get(
             "transports/rdma/max_timeout_ns", kDefaultMaxTimeoutNs);
+        // Urgent slices get QPs of their own when the endpoints have a
+        // spare one per worker that completes on the CQ the worker polls
+        auto& params = *transport_->params_;
+        if (params.endpoint.qp_mul_factor >= 2 * (int)num_workers_ &&
+            num_workers_ % params.device.num_cq_list == 0)
+            urgent_qp_offset_ = num_workers_;
+        planAffinity();
         worker_context_ = new WorkerContext[num_workers_];
         for (size_t id = 0; id < num_workers_; ++id) {
             worker_context_[id].thread =
@@ -173,7 +204,7 @@ std::shared_ptr<RdmaEndPoint> Workers::getEndpoint(Workers::PostPath path) {
     return endpoint;
 }
 
-void Workers::disableEndpoint(RdmaSlice* slice) {
+void Workers::disableEndpoint(RdmaSlice* slice, bool degraded) {
     SegmentDesc* desc = nullptr;
     auto& segment_manager = transport_->metadata_->segmentManager();
     auto target_id = slice->task->request.target_id;
@@ -186,14 +217,149 @@ void Workers::disableEndpoint(RdmaSlice* slice) {
     if (desc) {
         auto& worker = worker_context_[tl_wid];
         auto& rail = worker.rails[desc->machine_id];
-        rail.markFailed(slice->source_dev_id, slice->target_dev_id);
+        if (degraded)
+            rail.markDegraded(slice->source_dev_id, slice->target_dev_id);
+        else
+            rail.markFailed(slice->source_dev_id, slice->target_dev_id);
+        if (rail.paused(slice->source_dev_id, slice->target_dev_id))
+            addRailProbe(desc->machine_id, slice);
     }
     if (slice->ep_weak_ptr) {
-        slice->ep_weak_ptr->acknowledge(slice, FAILED);
-        slice->ep_weak_ptr->reset();
+        // A degraded rail keeps the slice queued so that it is rerouted
+        if (!degraded) slice->ep_weak_ptr->acknowledge(slice, FAILED);
+        std::vector<RdmaSlice*> evicted;
+        slice->ep_weak_ptr->reset(&evicted);
+        resubmitEvicted(evicted);
+    }
+}
+
+void Workers::resubmitEvicted(std::vector<RdmaSlice*>& slices) {
+    for (auto slice : slices) {
+        if (slice->is_probe) {
+            updateSliceStatus(slice, CANCELED);
+            continue;
+        }
+        if (slice->word != PENDING) continue;
+        int owner = slice->worker_id >= 0 ? slice->worker_id : tl_wid;
+        // submit() counts the slice again in the owner worker
+        worker_context_[owner].inflight_slices.fetch_sub(1);
+        slice->retry_count++;
+        if (slice->retry_count >=
+            transport_->params_->workers.max_retry_count) {
+            LOG(WARNING) << "Slice " << slice
+                         << " failed: retry count exceeded";
+            updateSliceStatus(slice, FAILED);
+            continue;
+        }
+        RdmaSliceList slice_list;
+        slice_list.first = slice;
+        slice_list.num_slices = 1;
+        submit(slice_list, owner);
     }
 }
 
+void Workers::addRailProbe(const std::string& machine_id, RdmaSlice* slice) {
+    if (rail_policy_.probe_interval.count() == 0 || slice->is_probe) return;
+    auto& worker = worker_context_[tl_wid];
+    PostPath path{.local_device_id = slice->source_dev_id,
+                  .remote_segment_id = slice->task->request.target_id,
+                  .remote_device_id = slice->target_dev_id};
+    auto& probe = worker.probes[path];
+    if (probe.busy) return;
+    probe.machine_id = machine_id;
+    probe.task.request = slice->task->request;
+    probe.task.request.opcode = Request::READ;
+    probe.task.request.length = 0;
+    // Zero-byte reads touch no memory, any registered address pair will do
+    probe.slice.source_addr = slice->source_addr;
+    probe.slice.target_addr = slice->target_addr;
+    probe.slice.length = 0;
+    probe.slice.task = &probe.task;
+    probe.slice.source_lkey = slice->source_lkey;
+    probe.slice.target_rkey = slice->target_rkey;
+    probe.slice.source_dev_id = slice->source_dev_id;
+    probe.slice.target_dev_id = slice->target_dev_id;
+    probe.slice.is_probe = true;
+}
+
+void Workers::probeRails() {
+    auto& worker = worker_context_[tl_wid];
+    auto current_ts = getCurrentTimeInNano();
+    for (auto it = worker.probes.begin(); it != worker.probes.end();) {
+        auto& path = it->first;
+        auto& probe = it->second;
+        auto& rail = worker.rails[probe.machine_id];
+        int local_nic = path.local_device_id;
+        int remote_nic = path.remote_device_id;
+        if (probe.busy) {
+            if (probe.slice.word != PENDING) {
+                // Canceled by an endpoint reset, no completion will come
+                probe.busy = false;
+                worker.inflight_slices.fetch_sub(1);
+                if (!probe.timed_out)
+                    rail.onProbeResult(local_nic, remote_nic, false);
+            } else if (!probe.timed_out && current_ts > probe.deadline_ts) {
+                probe.timed_out = true;
+                rail.onProbeResult(local_nic, remote_nic, false);
+            }
+            ++it;
+            continue;
+        }
+        if (!rail.paused(local_nic, remote_nic)) {
+            it = worker.probes.erase(it);
+            continue;
+        }
+        if (rail.probeDue(local_nic, remote_nic)) postRailProbe(path, probe);
+        ++it;
+    }
+}
+
+void Workers::postRailProbe(const PostPath& path, RailProbe& probe) {
+    auto& worker = worker_context_[tl_wid];
+    auto& rail = worker.rails[probe.machine_id];
+    auto endpoint = getEndpoint(path);
+    if (!endpoint) {
+        rail.onProbeResult(path.local_device_id, path.remote_device_id, false);
+        return;
+    }
+    auto& task = probe.task;
+    task.num_slices = 1;
+    task.status_word = PENDING;
+    task.transferred_bytes = 0;
+    task.success_slices = 0;
+    task.resolved_slices = 0;
+    task.first_error = PENDING;
+    probe.slice.word = PENDING;
+    probe.slice.retry_count = 0;
+    probe.slice.worker_id = tl_wid;
+    std::vector<RdmaSlice*> slices{&probe.slice};
+    if (endpoint->submitSlices(slices, tl_wid) != 1) return;  // QP is full
+    if (probe.slice.failed) {
+        rail.onProbeResult(path.local_device_id, path.remote_device_id, false);
+        return;
+    }
+    probe.busy = true;
+    probe.timed_out = false;
+    probe.slice.submit_ts = getCurrentTimeInNano();
+    probe.deadline_ts = probe.slice.submit_ts + rail_probe_timeout_ns_;
+    worker.inflight_slices.fetch_add(1);
+}
+
+void Workers::handleProbeCompletion(RdmaSlice* slice, bool success) {
+    auto& worker = worker_context_[tl_wid];
+    PostPath path{.local_device_id = slice->source_dev_id,
+                  .remote_segment_id = slice->task->request.target_id,
+                  .remote_device_id = slice->target_dev_id};
+    auto it = worker.probes.find(path);
+    if (it == worker.probes.end() || &it->second.slice != slice) return;
+    auto& probe = it->second;
+    probe.busy = false;
+    // A late success still shows that the rail works
+    if (success || !probe.timed_out)
+        worker.rails[probe.machine_id].onProbeResult(
+            path.local_device_id, path.remote_device_id, success);
+}
+
 void Workers::asyncPostSend() {
     auto& worker = worker_context_[tl_wid];
     std::vector<RdmaSliceList> result;
@@ -212,13 +378,31 @@ void Workers::asyncPostSend() {
                     .local_device_id = slice->source_dev_id,
                     .remote_segment_id = slice->task->request.target_id,
                     .remote_device_id = slice->target_dev_id};
-                worker.requests[path].push_back(slice);
+                auto& requests =
+                    slice->task->request.priority == Request::HIGH
+                        ? worker.urgent_requests
+                        : worker.requests;
+                requests[path].push_back(slice);
             }
             slice = slice->next;
         }
     }
 
-    for (auto& entry : worker.requests) {
+    bool urgent_waiting =
+        postRequests(worker.urgent_requests, tl_wid + urgent_qp_offset_);
+    // Strict priority holds the others back while urgent slices wait for
+    // room in the QPs; with a weight they still get every few rounds
+    if (urgent_waiting &&
+        (!priority_weight_ || ++worker.urgent_rounds < priority_weight_))
+        return;
+    worker.urgent_rounds = 0;
+    postRequests(worker.requests, tl_wid);
+}
+
+bool Workers::postRequests(GroupedRequests& requests, int qp_index) {
+    auto& worker = worker_context_[tl_wid];
+    bool waiting = false;
+    for (auto& entry : requests) {
         auto& path = entry.first;
         auto& slices = entry.second;
         if (slices.empty()) continue;
@@ -241,7 +425,7 @@ void Workers::asyncPostSend() {
             continue;
         }
 
-        int num_submitted = endpoint->submitSlices(slices, tl_wid);
+        int num_submitted = endpoint->submitSlices(slices, qp_index);
         for (int id = 0; id < num_submitted; ++id) {
             auto slice = slices[id];
             if (slice->failed) {
@@ -261,11 +445,15 @@ void Workers::asyncPostSend() {
         }
 
         if (num_submitted) {
+            for (int id = 0; id < num_submitted; ++id)
+                slices[id]->worker_id = tl_wid;
             worker.inflight_slice_set.insert(slices.begin(),
                                              slices.begin() + num_submitted);
             slices.erase(slices.begin(), slices.begin() + num_submitted);
         }
+        if (!slices.empty()) waiting = true;
     }
+    return waiting;
 }
 
 void Workers::asyncPollCq() {
@@ -277,31 +465,62 @@ void Workers::asyncPollCq() {
 
     uint64_t current_ts = getCurrentTimeInNano();
     std::vector<RdmaSlice*> slice_to_remove;
+    std::unordered_map<RdmaEndPoint*, RdmaSlice*> stalled_endpoints;
     for (auto& slice : worker.inflight_slice_set) {
         if (slice->word != PENDING) continue;
+        auto ep = slice->ep_weak_ptr;
+        if (!ep) continue;  // evicted, waiting to be posted again
         if (current_ts - slice->enqueue_ts > slice_timeout_ns_) {
-            auto ep = slice->ep_weak_ptr;
             LOG(WARNING) << "Slice " << slice
                          << " failed: transfer timeout (software)";
             auto num_slices = ep->acknowledge(slice, TIMEOUT);
             disableEndpoint(slice);
             worker.inflight_slices.fetch_sub(num_slices);
             slice_to_remove.push_back(slice);
+        } else if (rail_stall_timeout_ns_ &&
+                   current_ts - slice->submit_ts > rail_stall_timeout_ns_ &&
+                   current_ts - ep->lastProgressTs() > rail_stall_timeout_ns_) {
+            // Nothing completed on the endpoint for a while: likely a link
+            // down, so reroute its slices rather than wait for the timeout
+            stalled_endpoints.emplace(ep, slice);
         }
     }
     for (auto& slice : slice_to_remove) worker.inflight_slice_set.erase(slice);
+    for (auto& entry : stalled_endpoints) {
+        LOG(WARNING) << "Endpoint " << entry.first->name()
+                     << " stalled, rerouting its slices";
+        disableEndpoint(entry.second, true);
+    }
 
+    SliceCompletionBatch completions;
     for (int index = 0; index < num_contexts; index++) {
         auto& context = transport_->context_set_[index];
         auto cq = context->cq(tl_wid % num_cq_list);
         ibv_wc wc[kPollCount];
         int nr_poll = cq->poll(kPollCount, wc);
-        if (nr_poll < 0) continue;
+        if (nr_poll <= 0) continue;
         auto poll_ts = getCurrentTimeInNano();
+        // The slices are cold after the round trip on the wire
+        for (int i = 0; i < nr_poll; ++i)
+            __builtin_prefetch((const void*)wc[i].wr_id);
         for (int i = 0; i < nr_poll; ++i) {
             auto slice = (RdmaSlice*)wc[i].wr_id;
             worker.inflight_slice_set.erase(slice);
             auto ep = slice->ep_weak_ptr;
+            if (!ep) continue;  // evicted by an endpoint reset
+            if (slice->is_probe) {
+                bool success = wc[i].status == IBV_WC_SUCCESS;
+                num_slices +=
+                    ep->acknowledge(slice, success ? COMPLETED : FAILED);
+                handleProbeCompletion(slice, success);
+                if (!success) {
+                    // The QP is in error state now
+                    std::vector<RdmaSlice*> evicted;
+                    ep->reset(&evicted);
+                    resubmitEvicted(evicted);
+                }
+                continue;
+            }
             double enqueue_lat =
                 (slice->submit_ts - slice->enqueue_ts) / 1000.0;
             double inflight_lat = (poll_ts - slice->submit_ts) / 1000.0;
@@ -322,25 +541,33 @@ void Workers::asyncPollCq() {
                               << ", local_nic: " << context->name()
                               << "): " << ibv_wc_status_str(wc[i].status);
                 }
+                // Transport retries exhausted: the link is most likely down
+                bool degraded = wc[i].status == IBV_WC_RETRY_EXC_ERR;
                 slice->retry_count++;
                 if (slice->retry_count >=
                     transport_->params_->workers.max_retry_count) {
                     LOG(WARNING)
                         << "Slice " << slice << " failed: retry count exceeded";
                     num_slices += ep->acknowledge(slice, FAILED);
-                    disableEndpoint(slice);
+                    disableEndpoint(slice, degraded);
                 } else {
                     num_slices += ep->acknowledge(slice, PENDING);
-                    disableEndpoint(slice);
+                    disableEndpoint(slice, degraded);
                     submit(slice);
                 }
             } else {
-                num_slices += ep->acknowledge(slice, COMPLETED);
+                num_slices += ep->acknowledge(slice, COMPLETED, &completions);
                 worker.perf.inflight_lat.add(inflight_lat);
                 worker.perf.enqueue_lat.add(enqueue_lat);
+                if (slice->task->request.priority == Request::HIGH)
+                    worker.perf.urgent_lat.add(enqueue_lat + inflight_lat);
+                if (TentMetrics::isEnabled())
+                    TentMetrics::instance().recordDeviceLatency(
+                        context->name(), slice->length, overall_lat_sec);
             }
         }
     }
+    completions.flush();
     if (num_slices) {
         worker.inflight_slices.fetch_sub(num_slices);
     }
@@ -358,12 +585,81 @@ void Workers::showLatencyInfo() {
               << worker.perf.inflight_lat.avg() << " p99 "
               << worker.perf.inflight_lat.p99() << " p999 "
               << worker.perf.inflight_lat.p999();
+    if (worker.perf.urgent_lat.count())
+        LOG(INFO) << "[W" << tl_wid << "] urgent count "
+                  << worker.perf.urgent_lat.count() << " avg "
+                  << worker.perf.urgent_lat.avg() << " p99 "
+                  << worker.perf.urgent_lat.p99() << " p999 "
+                  << worker.perf.urgent_lat.p999();
     worker.perf.enqueue_lat.clear();
     worker.perf.inflight_lat.clear();
+    worker.perf.urgent_lat.clear();
+}
+
+// CPUs the interrupts of an RDMA device are delivered to
+static std::set<int> getIrqCpus(const std::string& device_name) {
+    namespace fs = std::filesystem;
+    std::set<int> cpus;
+    std::error_code ec;
+    fs::path irq_dir =
+        fs::path("/sys/class/infiniband") / device_name / "device/msi_irqs";
+    for (auto& entry : fs::directory_iterator(irq_dir, ec)) {
+        auto irq = entry.path().filename().string();
+        std::ifstream file("/proc/irq/" + irq + "/effective_affinity_list");
+        if (!file) file.open("/proc/irq/" + irq + "/smp_affinity_list");
+        std::string cpu_list;
+        if (!file || !std::getline(file, cpu_list)) continue;
+        for (int cpu : parseCpuList(cpu_list)) cpus.insert(cpu);
+    }
+    return cpus;
+}
+
+void Workers::planAffinity() {
+    auto& params = transport_->params_->workers;
+    worker_cpus_.assign(num_workers_, {});
+    if (!params.cpu_list.empty()) {
+        for (size_t id = 0; id < num_workers_; ++id)
+            worker_cpus_[id] =
+                parseCpuList(params.cpu_list[id % params.cpu_list.size()]);
+        return;
+    }
+    if (params.affinity == "none" || numa_available() < 0) return;
+
+    // One entry per NIC, so that a node gets workers as it has NICs
+    std::vector<int> nic_nodes;
+    std::unordered_map<int, std::set<int>> irq_cpus;
+    auto& topology = transport_->local_topology_;
+    if (params.affinity == "auto" && topology) {
+        for (size_t id = 0; id < topology->getNicCount(); ++id) {
+            auto nic = topology->getNicEntry(id);
+            if (!nic || nic->type != Topology::NIC_RDMA || nic->numa_node < 0)
+                continue;
+            nic_nodes.push_back(nic->numa_node);
+            auto cpus = getIrqCpus(nic->name);
+            irq_cpus[nic->numa_node].insert(cpus.begin(), cpus.end());
+        }
+    }
+    for (size_t id = 0; id < num_workers_; ++id) {
+        if (nic_nodes.empty()) {
+            worker_cpus_[id] =
+                getNumaNodeCpus(id % numa_num_configured_nodes());
+            continue;
+        }
+        int node = nic_nodes[id % nic_nodes.size()];
+        auto node_cpus = getNumaNodeCpus(node);
+        auto& busy = irq_cpus[node];
+        std::vector<int> cpus;
+        for (int cpu : node_cpus) {
+            if (!busy.count(cpu)) cpus.push_back(cpu);
+        }
+        // Interrupts spread over the whole node leave nothing to avoid
+        worker_cpus_[id] = cpus.empty() ? node_cpus : cpus;
+    }
 }
 
 void Workers::workerThread(int thread_id) {
-    bindToSocket(thread_id % numa_num_configured_nodes());
+    if (thread_id < (int)worker_cpus_.size())
+        bindToCpus(worker_cpus_[thread_id]);
     tl_wid = thread_id;
     auto& worker = worker_context_[thread_id];
 
@@ -379,6 +675,12 @@ void Workers::workerThread(int thread_id) {
             asyncPostSend();
             asyncPollCq();
             if (inflight_slices) grace_ts = current_ts;
+            const static uint64_t ONE_MILLISECOND = 1000000;
+            if (!worker.probes.empty() &&
+                current_ts - worker.last_probe_ts > ONE_MILLISECOND) {
+                probeRails();
+                worker.last_probe_ts = current_ts;
+            }
             const static uint64_t ONE_SECOND = 1000000000;
             if (transport_->params_->workers.show_latency_info &&
                 current_ts - last_perf_logging_ts > ONE_SECOND) {
@@ -442,14 +744,15 @@ void Workers::monitorThread() {
 }
 
 Status Workers::getRouteHint(RouteHint& hint, SegmentID segment_id,
-                             uint64_t addr, uint64_t length) {
+                             uint64_t addr, uint64_t length,
+                             const MemoryHandle& handle) {
     auto& segment_manager = transport_->metadata_->segmentManager();
     if (segment_id == LOCAL_SEGMENT_ID) {
         hint.segment = segment_manager.getLocal().get();
     } else {
         CHECK_STATUS(segment_manager.getRemoteCached(hint.segment, segment_id));
     }
-    hint.buffer = hint.segment->findBuffer(addr, length);
+    hint.buffer = hint.segment->findBuffer(addr, length, handle);
     if (!hint.buffer) {
         return Status::AddressNotRegistered(
             "No matched buffer in given address range" LOC_MARK);
@@ -506,8 +809,10 @@ Status Workers::selectOptimalDevice(RouteHint& source, RouteHint& target,
             "No device could access the slice memory region" LOC_MARK);
 
     auto& rail = worker.rails[target.segment->machine_id];
-    if (!rail.ready() || target.topo != rail.remote())
+    if (!rail.ready() || target.topo != rail.remote()) {
+        rail.setPolicy(rail_policy_);
         rail.load(source.topo, target.topo);
+    }
     if (slice->target_dev_id < 0) {
         int mapped_dev_id = rail.findBestRemoteDevice(
             slice->source_dev_id, target.topo_entry->numa_node);
@@ -624,7 +929,8 @@ Status Workers::selectFallbackDevice(RouteHint& source, RouteHint& target,
 Status Workers::generatePostPath(RdmaSlice* slice) {
     RouteHint source, target;
     CHECK_STATUS(getRouteHint(source, LOCAL_SEGMENT_ID,
-                              (uint64_t)slice->source_addr, slice->length));
+                              (uint64_t)slice->source_addr, slice->length,
+                              slice->task->request.source_handle));
 
     auto target_id = slice->task->request.target_id;
     CHECK_STATUS(getRouteHint(target, target_id, (uint64_t)slice->target_addr,
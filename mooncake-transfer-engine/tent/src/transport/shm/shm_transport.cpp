@@ -15,8 +15,14 @@
 #include "tent/transport/shm/shm_transport.h"
 
 #include <bits/stdint-uintn.h>
+#include <fcntl.h>
 #include <glog/logging.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #include <algorithm>
 #include <cassert>
@@ -34,6 +40,10 @@
 namespace mooncake {
 namespace tent {
 
+ShmMapping::~ShmMapping() {
+    if (addr) munmap(addr, length);
+}
+
 ShmTransport::ShmTransport() : installed_(false) {}
 
 ShmTransport::~ShmTransport() { uninstall(); }
@@ -54,6 +64,19 @@ Status ShmTransport::install(std::string &local_segment_name,
     machine_id_ = metadata->segmentManager().getLocal()->machine_id;
     installed_ = true;
     cxl_mount_path_ = conf_->get("transports/shm/cxl_mount_path", "");
+    hugepage_mount_path_ =
+        conf_->get("transports/shm/hugepage_mount_path", "");
+    max_mapped_bytes_ = conf_->get("transports/shm/max_mapped_gb", 256);
+    max_mapped_bytes_ <<= 30;
+    size_t copy_threads = conf_->get("transports/shm/copy_threads", 0);
+    if (copy_threads) copy_pool_ = std::make_unique<ThreadPool>(copy_threads);
+    parallel_copy_threshold_ =
+        conf_->get("transports/shm/parallel_copy_threshold", 8192) * 1024;
+    copy_chunk_size_ =
+        std::max(conf_->get("transports/shm/copy_chunk_size", 2048), 64) *
+        1024;
+    nt_copy_threshold_ =
+        conf_->get("transports/shm/nt_copy_threshold", 0) * 1024;
     caps.dram_to_dram = true;
     return Status::OK();
 }
@@ -61,13 +84,12 @@ Status ShmTransport::install(std::string &local_segment_name,
 Status ShmTransport::uninstall() {
     if (installed_) {
         metadata_.reset();
-        for (auto &relocate_map : relocate_map_) {
-            for (auto &entry : relocate_map.second) {
-                munmap(entry.second.shm_addr, entry.second.length);
-                close(entry.second.shm_fd);
-            }
-        }
-        relocate_map_.clear();
+        copy_pool_.reset();
+        RWSpinlock::WriteGuard guard(relocate_lock_);
+        mapping_cache_.clear();
+        mapping_lru_.clear();
+        mapped_bytes_ = 0;
+        mapping_epoch_.fetch_add(1, std::memory_order_release);
         installed_ = false;
     }
     return Status::OK();
@@ -87,6 +109,10 @@ Status ShmTransport::freeSubBatch(SubBatchRef &batch) {
     auto shm_batch = dynamic_cast<ShmSubBatch *>(batch);
     if (!shm_batch)
         return Status::InvalidArgument("Invalid SHM sub-batch" LOC_MARK);
+    // Copy threads may still be writing into the tasks
+    for (auto &task : shm_batch->task_list)
+        while (__atomic_load_n(&task.pending_chunks, __ATOMIC_ACQUIRE))
+            std::this_thread::yield();
     Slab<ShmSubBatch>::Get().deallocate(shm_batch);
     batch = nullptr;
     return Status::OK();
@@ -105,7 +131,7 @@ Status ShmTransport::submitTransferTasks(
         uint64_t target_addr = request.target_offset;
         if (request.target_id != LOCAL_SEGMENT_ID) {
             auto status = relocateSharedMemoryAddress(
-                target_addr, request.length, request.target_id);
+                target_addr, request.length, request.target_id, task.mapping);
             if (!status.ok()) return status;
         }
         task.target_addr = target_addr;
@@ -116,16 +142,78 @@ Status ShmTransport::submitTransferTasks(
     return Status::OK();
 }
 
+// Copies with streaming stores, leaving the caches to the consumers of the
+// data instead of filling them with the destination
+static void copyNonTemporal(void *dst, const void *src, size_t length) {
+#if defined(__x86_64__)
+    auto d = (char *)dst;
+    auto s = (const char *)src;
+    size_t head = (16 - ((uintptr_t)d & 15)) & 15;
+    if (head > length) head = length;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    length -= head;
+    for (; length >= 64; length -= 64, d += 64, s += 64) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)s);
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i *)(s + 32));
+        __m128i v3 = _mm_loadu_si128((const __m128i *)(s + 48));
+        _mm_stream_si128((__m128i *)d, v0);
+        _mm_stream_si128((__m128i *)(d + 16), v1);
+        _mm_stream_si128((__m128i *)(d + 32), v2);
+        _mm_stream_si128((__m128i *)(d + 48), v3);
+    }
+    _mm_sfence();
+    memcpy(d, s, length);
+#else
+    memcpy(dst, src, length);
+#endif
+}
+
+void ShmTransport::copyHostMemory(void *dst, const void *src, size_t length) {
+    if (nt_copy_threshold_ && length >= nt_copy_threshold_)
+        copyNonTemporal(dst, src, length);
+    else
+        memcpy(dst, src, length);
+}
+
 void ShmTransport::startTransfer(ShmTask *task, ShmSubBatch *batch) {
+    void *dst = (void *)task->target_addr;
+    void *src = task->request.source;
+    if (task->request.opcode == Request::READ) std::swap(dst, src);
+    auto length = task->request.length;
+    bool host_memory = Platform::getLoader().getMemoryType(
+                           task->request.source) != MTYPE_CUDA;
+
+    if (copy_pool_ && host_memory && length >= parallel_copy_threshold_) {
+        uint32_t chunks = (length + copy_chunk_size_ - 1) / copy_chunk_size_;
+        // One extra count is held until the last chunk has set the status,
+        // the task may be freed as soon as the count drops to zero
+        __atomic_store_n(&task->pending_chunks, chunks + 1, __ATOMIC_RELEASE);
+        for (uint32_t i = 0; i < chunks; ++i) {
+            size_t offset = i * copy_chunk_size_;
+            size_t chunk_length = std::min(copy_chunk_size_, length - offset);
+            copy_pool_->enqueue([this, task, dst, src, offset, chunk_length] {
+                copyHostMemory((char *)dst + offset, (char *)src + offset,
+                               chunk_length);
+                if (__atomic_sub_fetch(&task->pending_chunks, 1,
+                                       __ATOMIC_ACQ_REL) == 1) {
+                    task->transferred_bytes = task->request.length;
+                    task->status_word = TransferStatusEnum::COMPLETED;
+                    __atomic_store_n(&task->pending_chunks, 0,
+                                     __ATOMIC_RELEASE);
+                }
+            });
+        }
+        return;
+    }
+
     Status status;
-    if (task->request.opcode == Request::READ)
-        status = Platform::getLoader().copy(task->request.source,
-                                            (void *)task->target_addr,
-                                            task->request.length);
+    if (host_memory)
+        copyHostMemory(dst, src, length);
     else
-        status = Platform::getLoader().copy((void *)task->target_addr,
-                                            task->request.source,
-                                            task->request.length);
+        status = Platform::getLoader().copy(dst, src, length);
     if (status.ok()) {
         task->transferred_bytes = task->request.length;
         task->status_word = TransferStatusEnum::COMPLETED;
@@ -182,9 +270,21 @@ Status ShmTransport::allocateLocalMemory(void **addr, size_t size,
     if (location.type() != "cpu") {
         return Status::InvalidArgument("ShmTransport allocates DRAM only");
     }
-    options.shm_path = randomFileName();
     options.shm_offset = 0;
-    *addr = createSharedMemory(options.shm_path, size);
+    *addr = nullptr;
+    if (!hugepage_mount_path_.empty()) {
+        // Absolute paths are opened as is by the peers
+        options.shm_path = joinPath(hugepage_mount_path_, randomFileName());
+        *addr = createSharedMemory(options.shm_path, size);
+        if (!(*addr))
+            LOG(WARNING) << "Unable to allocate huge pages in "
+                         << hugepage_mount_path_
+                         << ", using regular shared memory";
+    }
+    if (!(*addr)) {
+        options.shm_path = randomFileName();
+        *addr = createSharedMemory(options.shm_path, size);
+    }
     if (!(*addr)) {
         return Status::InternalError("Failed to allocate shared memory");
     }
@@ -196,70 +296,125 @@ Status ShmTransport::freeLocalMemory(void *addr, size_t size) {
     if (!shm_path_map_.count(addr)) {
         return Status::InvalidArgument("Memory not allocated by ShmTransport");
     }
-    munmap(addr, size);
-    if (cxl_mount_path_.empty())
-        shm_unlink(shm_path_map_[addr].c_str());
+    auto &entry = shm_path_map_[addr];
+    munmap(addr, entry.length);
+    if (entry.path.starts_with("/"))
+        unlink(entry.path.c_str());
+    else if (cxl_mount_path_.empty())
+        shm_unlink(entry.path.c_str());
     else {
-        auto full_path = joinPath(cxl_mount_path_, shm_path_map_[addr]);
+        auto full_path = joinPath(cxl_mount_path_, entry.path);
         unlink(full_path.c_str());
     }
     shm_path_map_.erase(addr);
     return Status::OK();
 }
 
-void *ShmTransport::createSharedMemory(const std::string &path, size_t size) {
-    int shm_fd = -1;
+int ShmTransport::openSharedMemory(const std::string &path, bool create) {
+    if (path.starts_with("/"))
+        return open(path.c_str(), create ? O_CREAT | O_RDWR : O_RDWR, 0644);
     if (cxl_mount_path_.empty())
-        shm_fd = shm_open(path.c_str(), O_CREAT | O_RDWR, 0644);
-    else {
-        auto full_path = joinPath(cxl_mount_path_, path);
-        shm_fd = open(full_path.c_str(), O_CREAT | O_RDWR, 0644);
-    }
+        return shm_open(path.c_str(), create ? O_CREAT | O_RDWR : O_RDWR,
+                        0644);
+    auto full_path = joinPath(cxl_mount_path_, path);
+    return open(full_path.c_str(), O_CREAT | O_RDWR, 0644);
+}
+
+void *ShmTransport::createSharedMemory(const std::string &path,
+                                       size_t &size) {
+    int shm_fd = openSharedMemory(path, true);
     if (shm_fd == -1) {
         PLOG(ERROR) << "Failed to open shared memory file";
         return nullptr;
     }
 
-    if (ftruncate64(shm_fd, size) == -1) {
+    // Files on hugetlbfs must span whole huge pages
+    struct statfs fs;
+    size_t length = size;
+    if (fstatfs(shm_fd, &fs) == 0 && fs.f_bsize > 0)
+        length = (size + fs.f_bsize - 1) / fs.f_bsize * fs.f_bsize;
+
+    if (ftruncate64(shm_fd, length) == -1) {
         PLOG(ERROR) << "Failed to truncate shared memory file";
         close(shm_fd);
+        if (path.starts_with("/")) unlink(path.c_str());
         return nullptr;
     }
 
     void *mapped_addr =
-        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
     if (mapped_addr == MAP_FAILED) {
         PLOG(ERROR) << "Failed to map shared memory file";
         close(shm_fd);
+        if (path.starts_with("/")) unlink(path.c_str());
         return nullptr;
     }
 
     close(shm_fd);
     std::lock_guard<std::mutex> lock(shm_path_mutex_);
-    shm_path_map_[mapped_addr] = path;
+    shm_path_map_[mapped_addr] = AllocatedShmEntry{path, length};
     return mapped_addr;
 }
 
+Status ShmTransport::mapSharedMemory(ShmMappingRef &mapping,
+                                     const std::string &path,
+                                     uint64_t length) {
+    int shm_fd = openSharedMemory(path, false);
+    if (shm_fd < 0) {
+        return Status::InternalError(
+            std::string("Failed to open shared memory file ") + path +
+            LOC_MARK);
+    }
+    // Map the whole file, which is rounded up to huge pages on hugetlbfs
+    struct stat st;
+    if (fstat(shm_fd, &st) == 0 && (uint64_t)st.st_size > length)
+        length = st.st_size;
+    void *shm_addr =
+        mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (shm_addr == MAP_FAILED) {
+        return Status::InternalError("Failed to map shared memory " LOC_MARK);
+    }
+    mapping = std::make_shared<ShmMapping>();
+    mapping->addr = shm_addr;
+    mapping->length = length;
+    LOG(INFO) << "Mapped shared memory " << path << ": " << shm_addr << "--"
+              << (void *)((uintptr_t)shm_addr + length);
+    return Status::OK();
+}
+
 Status ShmTransport::relocateSharedMemoryAddress(uint64_t &dest_addr,
                                                  uint64_t length,
-                                                 uint64_t target_id) {
-    thread_local HashMap tl_relocate_map;
-    if (tl_relocate_map.empty()) {
-        RWSpinlock::ReadGuard guard(relocate_lock_);
-        tl_relocate_map = relocate_map_;
+                                                 uint64_t target_id,
+                                                 ShmMappingRef &mapping) {
+    struct CachedBuffer {
+        uint64_t addr;
+        uint64_t length;
+        ShmMappingRef mapping;
+    };
+    struct ThreadCache {
+        const ShmTransport *owner = nullptr;
+        uint64_t epoch = 0;
+        std::unordered_map<SegmentID, std::vector<CachedBuffer>> buffers;
+    };
+    thread_local ThreadCache tl_cache;
+    auto epoch = mapping_epoch_.load(std::memory_order_acquire);
+    if (tl_cache.owner != this || tl_cache.epoch != epoch) {
+        tl_cache.buffers.clear();
+        tl_cache.owner = this;
+        tl_cache.epoch = epoch;
     }
 
-    auto &relocate_map = tl_relocate_map[target_id];
-    for (auto &entry : relocate_map) {
-        if (entry.first <= dest_addr &&
-            dest_addr + length <= entry.first + entry.second.length) {
-            auto shm_addr = entry.second.shm_addr;
-            dest_addr = dest_addr - entry.first + ((uint64_t)shm_addr);
+    auto &cached_buffers = tl_cache.buffers[target_id];
+    for (auto &entry : cached_buffers) {
+        if (entry.addr <= dest_addr &&
+            dest_addr + length <= entry.addr + entry.length) {
+            mapping = entry.mapping;
+            dest_addr = dest_addr - entry.addr + (uint64_t)mapping->addr;
             return Status::OK();
         }
     }
 
-    RWSpinlock::WriteGuard guard(relocate_lock_);
     SegmentDesc *desc = nullptr;
     auto status = metadata_->segmentManager().getRemoteCached(desc, target_id);
     if (!status.ok()) return status;
@@ -268,47 +423,48 @@ Status ShmTransport::relocateSharedMemoryAddress(uint64_t &dest_addr,
     if (!buffer || buffer->shm_path.empty())
         return Status::InvalidArgument(
             "Requested address is not in registered buffer" LOC_MARK);
+    LocationParser location(buffer->location);
+    if (location.type() == "cuda") {
+        return Status::NotImplemented(
+            "CUDA supported not enabled in this package " LOC_MARK);
+    }
 
-    if (!relocate_map.count(buffer->addr)) {
-        void *shm_addr = nullptr;
-        LocationParser location(buffer->location);
-        if (location.type() == "cuda") {
-            return Status::NotImplemented(
-                "CUDA supported not enabled in this package " LOC_MARK);
-        } else {
-            int shm_fd = -1;
-            if (cxl_mount_path_.empty())
-                shm_fd = shm_open(buffer->shm_path.c_str(), O_RDWR, 0644);
-            else {
-                auto full_path = joinPath(cxl_mount_path_, buffer->shm_path);
-                shm_fd = open(full_path.c_str(), O_CREAT | O_RDWR, 0644);
-            }
-            if (shm_fd < 0) {
-                return Status::InternalError(
-                    std::string("Failed to open shared memory file ") +
-                    buffer->shm_path + LOC_MARK);
-            }
-            shm_addr = mmap(nullptr, buffer->length, PROT_READ | PROT_WRITE,
-                            MAP_SHARED, shm_fd, 0);
-            if (shm_addr == MAP_FAILED) {
-                close(shm_fd);
-                return Status::InternalError(
-                    "Failed to map shared memory " LOC_MARK);
-            }
-            LOG(INFO) << "Original shared memory: " << (void *)buffer->addr
-                      << "--" << (void *)(buffer->addr + buffer->length);
-            LOG(INFO) << "Remapped shared memory: " << (void *)shm_addr << "--"
-                      << (void *)((uintptr_t)shm_addr + buffer->length);
-            OpenedShmEntry shm_entry;
-            shm_entry.shm_fd = shm_fd;
-            shm_entry.shm_addr = shm_addr;
-            shm_entry.length = buffer->length;
-            relocate_map[buffer->addr] = shm_entry;
+    RWSpinlock::WriteGuard guard(relocate_lock_);
+    auto it = mapping_cache_.find(buffer->shm_path);
+    if (it != mapping_cache_.end() &&
+        it->second.mapping->length >= buffer->length) {
+        mapping_lru_.splice(mapping_lru_.end(), mapping_lru_,
+                            it->second.lru_iter);
+        mapping = it->second.mapping;
+    } else {
+        if (it != mapping_cache_.end()) {
+            // The peer reallocated the file with a larger size
+            mapped_bytes_ -= it->second.mapping->length;
+            mapping_lru_.erase(it->second.lru_iter);
+            mapping_cache_.erase(it);
+            mapping_epoch_.fetch_add(1, std::memory_order_release);
+        }
+        CHECK_STATUS(
+            mapSharedMemory(mapping, buffer->shm_path, buffer->length));
+        mapped_bytes_ += mapping->length;
+        auto lru_iter =
+            mapping_lru_.insert(mapping_lru_.end(), buffer->shm_path);
+        mapping_cache_[buffer->shm_path] = MappingCacheEntry{mapping, lru_iter};
+        // In-flight tasks and thread caches keep evicted mappings alive
+        // until they are done with them
+        while (max_mapped_bytes_ && mapped_bytes_ > max_mapped_bytes_ &&
+               mapping_lru_.size() > 1) {
+            auto victim = mapping_cache_.find(mapping_lru_.front());
+            mapped_bytes_ -= victim->second.mapping->length;
+            mapping_cache_.erase(victim);
+            mapping_lru_.pop_front();
+            mapping_epoch_.fetch_add(1, std::memory_order_release);
         }
     }
 
-    auto shm_addr = relocate_map[buffer->addr].shm_addr;
-    dest_addr = dest_addr - buffer->addr + ((uint64_t)shm_addr);
+    cached_buffers.push_back(
+        CachedBuffer{buffer->addr, buffer->length, mapping});
+    dest_addr = dest_addr - buffer->addr + (uint64_t)mapping->addr;
     return Status::OK();
 }
 
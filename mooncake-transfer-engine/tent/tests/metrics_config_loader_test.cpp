@@ -68,6 +68,7 @@ TEST(MetricsConfigLoaderTest, GetDefaultConfigReturnsExpectedDefaults) {
     EXPECT_TRUE(config.enable_json);
     EXPECT_TRUE(config.latency_buckets.empty());
     EXPECT_TRUE(config.size_buckets.empty());
+    EXPECT_EQ(config.peer_top_n, 16);
 }
 
 //------------------------------------------------------------------------------
@@ -193,6 +194,14 @@ TEST(MetricsConfigLoaderTest, LoadFromEnvironmentWithSizeBuckets) {
     EXPECT_DOUBLE_EQ(config.size_buckets[2], 4096);
 }
 
+TEST(MetricsConfigLoaderTest, LoadFromEnvironmentWithPeerTopN) {
+    EnvVarGuard g1(config_keys::ENV_METRICS_PEER_TOP_N, "4");
+
+    MetricsConfig config = MetricsConfigLoader::loadFromEnvironment();
+
+    EXPECT_EQ(config.peer_top_n, 4);
+}
+
 //------------------------------------------------------------------------------
 // MetricsConfigLoader::loadWithDefaults Tests
 //------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "tent/common/concurrent/range_cache.h"
+
+namespace mooncake {
+namespace tent {
+namespace {
+
+TEST(RangeCacheTest, FindsTheRangeHoldingAnAddress) {
+    RangeCache<int> cache;
+    cache.insert(0x2000, 0x1000, 2);
+    cache.insert(0x1000, 0x1000, 1);
+    cache.insert(0x8000, 0x100, 8);
+    ASSERT_EQ(cache.size(), 3u);
+
+    EXPECT_EQ(cache.find(0xfff), nullptr);
+    ASSERT_NE(cache.find(0x1000), nullptr);
+    EXPECT_EQ(cache.find(0x1000)->value, 1);
+    EXPECT_EQ(cache.find(0x1fff)->value, 1);
+    EXPECT_EQ(cache.find(0x2000)->value, 2);
+    EXPECT_EQ(cache.find(0x3000), nullptr);
+    EXPECT_EQ(cache.find(0x80ff)->value, 8);
+    EXPECT_EQ(cache.find(0x8100), nullptr);
+}
+
+TEST(RangeCacheTest, InsertReplacesOverlappingRanges) {
+    RangeCache<int> cache;
+    cache.insert(0x1000, 0x1000, 1);
+    cache.insert(0x3000, 0x1000, 3);
+    cache.insert(0x1800, 0x2000, 5);
+    ASSERT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.find(0x1000), nullptr);
+    EXPECT_EQ(cache.find(0x3000)->value, 5);
+
+    cache.erase(0x1000);
+    EXPECT_EQ(cache.size(), 1u);
+    cache.erase(0x1800);
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.find(0x2000), nullptr);
+}
+
+TEST(RangeCacheTest, ReadersSeeConsistentEntriesWhileWritersChangeThem) {
+    RangeCache<uint64_t> cache;
+    cache.insert(0, 0x100, 0);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> mismatches{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (uint64_t start = 0; start < 0x10000; start += 0x1000) {
+                    auto entry = cache.find(start + 0x10);
+                    // Every range is tagged with its own start
+                    if (entry && entry->value != entry->start) ++mismatches;
+                }
+            }
+        });
+    }
+    for (int round = 0; round < 200; ++round) {
+        const uint64_t start = (round % 16) * 0x1000;
+        cache.insert(start, 0x100, start);
+        if (round % 3 == 0) cache.erase(start);
+    }
+    stop = true;
+    for (auto& reader : readers) reader.join();
+    EXPECT_EQ(mismatches.load(), 0u);
+}
+
+}  // namespace
+}  // namespace tent
+}  // namespace mooncake
@@ -0,0 +1,156 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "tent/runtime/segment_gossip.h"
+
+namespace mooncake {
+namespace tent {
+namespace {
+
+// Nodes wired in process, |down| ones fail every exchange
+class Cluster {
+   public:
+    Cluster(size_t count, const SegmentGossip::Config& config = {}) {
+        for (size_t i = 0; i < count; ++i) {
+            auto name = "node" + std::to_string(i);
+            names.push_back(name);
+            nodes[name] = std::make_unique<SegmentGossip>(
+                name, config,
+                [this](const std::string& peer, const std::string& request,
+                       std::string& response) {
+                    messages++;
+                    if (down.count(peer))
+                        return Status::RpcServiceError("down");
+                    nodes[peer]->onGossip(request, response);
+                    return Status::OK();
+                });
+        }
+        // Everyone only knows the first node
+        for (auto& name : names) nodes[name]->addPeer(names[0]);
+    }
+
+    void runRound() {
+        for (auto& name : names) {
+            if (!down.count(name)) nodes[name]->runRound();
+        }
+    }
+
+    // Rounds until every live node knows |expected| segments
+    int converge(size_t expected, int max_rounds) {
+        for (int round = 1; round <= max_rounds; ++round) {
+            runRound();
+            bool done = true;
+            for (auto& name : names) {
+                if (!down.count(name) && nodes[name]->numKnown() != expected)
+                    done = false;
+            }
+            if (done) return round;
+        }
+        return -1;
+    }
+
+    std::vector<std::string> names;
+    std::map<std::string, std::unique_ptr<SegmentGossip>> nodes;
+    std::set<std::string> down;
+    size_t messages = 0;
+};
+
+TEST(SegmentGossipTest, LearnsWholeClusterInLogarithmicRounds) {
+    const size_t kNodes = 128;
+    Cluster cluster(kNodes);
+    for (auto& name : cluster.names)
+        cluster.nodes[name]->updateLocal("desc of " + name);
+    int rounds = cluster.converge(kNodes, 100);
+    ASSERT_GT(rounds, 0);
+    // Joining through a single seed, plus log2(128) = 7 to spread
+    EXPECT_LE(rounds, 30);
+    // Constant number of messages per node and round
+    EXPECT_LE(cluster.messages, kNodes * rounds * 2);
+
+    std::string desc;
+    ASSERT_TRUE(cluster.nodes["node5"]->lookup("node77", desc));
+    EXPECT_EQ(desc, "desc of node77");
+    EXPECT_FALSE(cluster.nodes["node5"]->lookup("node1000", desc));
+}
+
+TEST(SegmentGossipTest, PropagatesUpdatesAndRemovals) {
+    const size_t kNodes = 32;
+    Cluster cluster(kNodes);
+    for (auto& name : cluster.names) cluster.nodes[name]->updateLocal("v1");
+    ASSERT_GT(cluster.converge(kNodes, 100), 0);
+
+    cluster.nodes["node3"]->updateLocal("v2");
+    cluster.nodes["node4"]->updateLocal("");
+    bool spread = false;
+    for (int round = 0; round < 30 && !spread; ++round) {
+        cluster.runRound();
+        spread = true;
+        for (auto& name : cluster.names) {
+            std::string desc;
+            if (!cluster.nodes[name]->lookup("node3", desc) || desc != "v2" ||
+                cluster.nodes[name]->lookup("node4", desc))
+                spread = false;
+        }
+    }
+    EXPECT_TRUE(spread);
+}
+
+TEST(SegmentGossipTest, SupersedesPreviousLifeAndSkipsDeadPeers) {
+    const size_t kNodes = 16;
+    Cluster cluster(kNodes);
+    for (auto& name : cluster.names) cluster.nodes[name]->updateLocal("old");
+    ASSERT_GT(cluster.converge(kNodes, 100), 0);
+
+    // node2 restarts with an empty view and a lower version counter
+    auto& restarted = cluster.nodes["node2"];
+    restarted = std::make_unique<SegmentGossip>(
+        "node2", SegmentGossip::Config{},
+        [&cluster](const std::string& peer, const std::string& request,
+                   std::string& response) {
+            cluster.nodes[peer]->onGossip(request, response);
+            return Status::OK();
+        });
+    restarted->addPeer("node0");
+    restarted->updateLocal("new");
+    cluster.down.insert("node9");
+    bool spread = false;
+    for (int round = 0; round < 40 && !spread; ++round) {
+        cluster.runRound();
+        spread = true;
+        for (auto& name : cluster.names) {
+            std::string desc;
+            if (cluster.down.count(name)) continue;
+            if (!cluster.nodes[name]->lookup("node2", desc) || desc != "new")
+                spread = false;
+        }
+    }
+    EXPECT_TRUE(spread);
+
+    // Failing peers are retried less and less often
+    size_t before = cluster.messages;
+    for (int round = 0; round < 20; ++round) cluster.runRound();
+    EXPECT_LT(cluster.messages - before, (kNodes - 1) * 20 * 2);
+}
+
+}  // namespace
+}  // namespace tent
+}  // namespace mooncake
@@ -0,0 +1,116 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "tent/runtime/segment.h"
+
+namespace mooncake {
+namespace tent {
+namespace {
+
+BufferDesc makeBuffer(uint64_t addr, uint64_t length) {
+    BufferDesc buffer;
+    buffer.addr = addr;
+    buffer.length = length;
+    return buffer;
+}
+
+SegmentDesc makeSegment(std::vector<BufferDesc> buffers) {
+    SegmentDesc desc;
+    desc.type = SegmentType::Memory;
+    MemorySegmentDesc detail;
+    detail.buffers = std::move(buffers);
+    desc.detail = detail;
+    return desc;
+}
+
+std::vector<BufferDesc>& buffersOf(SegmentDesc& desc) {
+    return std::get<MemorySegmentDesc>(desc.detail).buffers;
+}
+
+TEST(SegmentTest, FindsBufferInSortedList) {
+    std::vector<BufferDesc> buffers;
+    for (uint64_t i = 0; i < 1000; ++i)
+        buffers.push_back(makeBuffer(0x100000 + i * 0x2000, 0x1000));
+    auto desc = makeSegment(buffers);
+
+    auto entry = desc.findBuffer(0x100000 + 500 * 0x2000 + 0x10, 0x100);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->addr, 0x100000 + 500 * 0x2000);
+    // Same buffer again, served by the hit cache
+    EXPECT_EQ(desc.findBuffer(0x100000 + 500 * 0x2000, 0x1000), entry);
+    // Gaps, ranges crossing a buffer end and overflows are not found
+    EXPECT_EQ(desc.findBuffer(0x100000 + 0x1800, 0x10), nullptr);
+    EXPECT_EQ(desc.findBuffer(0x100000 + 0xf00, 0x200), nullptr);
+    EXPECT_EQ(desc.findBuffer(0x10, 0x10), nullptr);
+    EXPECT_EQ(desc.findBuffer(UINT64_MAX - 4, 0x10), nullptr);
+}
+
+TEST(SegmentTest, FindsNestedAndUnsortedBuffers) {
+    // A large buffer holding smaller ones
+    std::vector<BufferDesc> buffers{makeBuffer(0x1000, 0x10000),
+                                    makeBuffer(0x2000, 0x100),
+                                    makeBuffer(0x4000, 0x100)};
+    std::sort(buffers.begin(), buffers.end(), compareBufferDesc);
+    auto desc = makeSegment(buffers);
+    auto entry = desc.findBuffer(0x3000, 0x100);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->addr, 0x1000u);
+    entry = desc.findBuffer(0x2010, 0x10);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_TRUE(entry->addr == 0x2000 || entry->addr == 0x1000);
+
+    // As received from a peer that does not sort its buffers
+    auto unsorted = makeSegment(
+        {makeBuffer(0x9000, 0x100), makeBuffer(0x1000, 0x100)});
+    entry = unsorted.findBuffer(0x9010, 0x10);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->addr, 0x9000u);
+}
+
+TEST(SegmentTest, MemoryHandleSkipsLookupAndFallsBackWhenStale) {
+    auto desc = makeSegment({makeBuffer(0x1000, 0x1000),
+                             makeBuffer(0x4000, 0x1000),
+                             makeBuffer(0x8000, 0x1000)});
+    MemoryHandle handle;
+    ASSERT_TRUE(desc.getMemoryHandle(0x4000, 0x1000, handle));
+    EXPECT_EQ(handle.addr, 0x4000u);
+    EXPECT_EQ(handle.index, 1u);
+    EXPECT_FALSE(desc.getMemoryHandle(0x3000, 0x10, handle));
+
+    auto entry = desc.findBuffer(0x4100, 0x10, handle);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->addr, 0x4000u);
+
+    // A buffer registered below shifts the others
+    auto& buffers = buffersOf(desc);
+    buffers.insert(buffers.begin(), makeBuffer(0x100, 0x100));
+    entry = desc.findBuffer(0x4100, 0x10, handle);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->addr, 0x4000u);
+    // A handle never resolves outside the buffer it names
+    EXPECT_EQ(desc.findBuffer(0x8100, 0x10, handle)->addr, 0x8000u);
+
+    // The hit cache follows the list when buffers are removed
+    ASSERT_NE(desc.findBuffer(0x8100, 0x10), nullptr);
+    buffers.pop_back();
+    EXPECT_EQ(desc.findBuffer(0x8100, 0x10), nullptr);
+}
+
+}  // namespace
+}  // namespace tent
+}  // namespace mooncake
@@ -0,0 +1,111 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "tent/runtime/slab.h"
+
+namespace mooncake {
+namespace tent {
+namespace {
+
+TEST(SlabTest, ReusesFreedObjects) {
+    SlabBase slab(64);
+    std::set<void*> objects;
+    const size_t count = SlabBase::kMagazineSize * 3 + 7;
+    for (size_t i = 0; i < count; ++i) {
+        void* object = slab.allocate();
+        ASSERT_NE(object, nullptr);
+        EXPECT_TRUE(objects.insert(object).second);
+    }
+    for (auto object : objects) slab.deallocate(object);
+
+    std::set<void*> reused;
+    for (size_t i = 0; i < count; ++i) reused.insert(slab.allocate());
+    EXPECT_EQ(objects, reused);
+}
+
+// Allocated on one thread and freed on another, as batches are between a
+// submitting thread and a completion poller
+TEST(SlabTest, CrossThreadAllocAndFree) {
+    SlabBase slab(32);
+    const size_t kRounds = 20000;
+    std::mutex mutex;
+    std::vector<void*> handoff;
+    std::atomic<bool> done{false};
+    std::set<void*> seen;
+
+    std::thread consumer([&] {
+        std::vector<void*> batch;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                batch.swap(handoff);
+            }
+            for (auto object : batch) slab.deallocate(object);
+            if (batch.empty() && done) break;
+            batch.clear();
+        }
+    });
+    for (size_t i = 0; i < kRounds; ++i) {
+        void* object = slab.allocate();
+        ASSERT_NE(object, nullptr);
+        seen.insert(object);
+        std::lock_guard<std::mutex> lock(mutex);
+        handoff.push_back(object);
+    }
+    done = true;
+    consumer.join();
+    // Objects freed by the consumer come back to the producer in
+    // magazines, instead of each round taking new memory
+    EXPECT_LT(seen.size(), kRounds / 4);
+}
+
+TEST(SlabTest, ConcurrentThreadsNeverShareObjects) {
+    SlabBase slab(sizeof(uint64_t));
+    const int kThreads = 8;
+    const int kIterations = 20000;
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<uint64_t*> held;
+            for (int i = 0; i < kIterations; ++i) {
+                auto object = static_cast<uint64_t*>(slab.allocate());
+                *object = t;
+                held.push_back(object);
+                if (held.size() == 300) {
+                    for (auto entry : held) {
+                        if (*entry != uint64_t(t)) failed = true;
+                        slab.deallocate(entry);
+                    }
+                    held.clear();
+                }
+            }
+            for (auto entry : held) slab.deallocate(entry);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_FALSE(failed);
+}
+
+}  // namespace
+}  // namespace tent
+}  // namespace mooncake
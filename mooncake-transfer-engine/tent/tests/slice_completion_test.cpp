@@ -0,0 +1,85 @@
+// Copyright 2025 KVCache.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "tent/transport/rdma/slice.h"
+
+namespace mooncake {
+namespace tent {
+namespace {
+
+struct TaskWithSlices {
+    explicit TaskWithSlices(int num_slices, size_t slice_length = 4096)
+        : slices(num_slices) {
+        task.num_slices = num_slices;
+        task.status_word = PENDING;
+        task.transferred_bytes = 0;
+        task.success_slices = 0;
+        task.resolved_slices = 0;
+        for (auto& slice : slices) {
+            slice.task = &task;
+            slice.length = slice_length;
+            slice.word = PENDING;
+        }
+    }
+
+    RdmaTask task;
+    std::vector<RdmaSlice> slices;
+};
+
+TEST(SliceCompletionTest, ReportsTaskOnlyOnFlush) {
+    TaskWithSlices a(3), b(2, 100);
+    SliceCompletionBatch batch;
+    for (auto& slice : a.slices) updateSliceStatus(&slice, COMPLETED, &batch);
+    updateSliceStatus(&b.slices[0], COMPLETED, &batch);
+    EXPECT_EQ(a.task.status_word, PENDING);
+    EXPECT_EQ(a.task.resolved_slices, 0);
+
+    batch.flush();
+    EXPECT_EQ(a.task.status_word, COMPLETED);
+    EXPECT_EQ(a.task.transferred_bytes, 3 * 4096u);
+    EXPECT_EQ(b.task.status_word, PENDING);
+    EXPECT_EQ(b.task.transferred_bytes, 100u);
+
+    // A slice resolved twice only counts once
+    updateSliceStatus(&b.slices[0], COMPLETED, &batch);
+    updateSliceStatus(&b.slices[1], FAILED, &batch);
+    batch.flush();
+    EXPECT_EQ(b.task.status_word, FAILED);
+    EXPECT_EQ(b.task.success_slices, 1);
+}
+
+TEST(SliceCompletionTest, FlushesWhenManyTasksComplete) {
+    std::vector<TaskWithSlices> tasks;
+    tasks.reserve(40);
+    for (int i = 0; i < 40; ++i) tasks.emplace_back(2);
+    {
+        SliceCompletionBatch batch;
+        for (auto& task : tasks)
+            for (auto& slice : task.slices)
+                updateSliceStatus(&slice, COMPLETED, &batch);
+    }
+    for (auto& task : tasks) {
+        EXPECT_EQ(task.task.status_word, COMPLETED);
+        EXPECT_EQ(task.task.resolved_slices, 2);
+        EXPECT_EQ(task.task.transferred_bytes, 2 * 4096u);
+    }
+}
+
+}  // namespace
+}  // namespace tent
+}  // namespace mooncake
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "transport/local_memcpy_transport.h"
+
+namespace {
+
+using namespace mooncake;
+using TransferRequest = Transport::TransferRequest;
+
+// Polls the batch like the callers of the engine do
+Transport::TransferStatusEnum waitTask(Transport &transport,
+                                       Transport::BatchID batch_id,
+                                       size_t task_id) {
+    Transport::TransferStatus status;
+    do {
+        EXPECT_TRUE(
+            transport.getTransferStatus(batch_id, task_id, status).ok());
+    } while (status.s == Transport::TransferStatusEnum::WAITING);
+    return status.s;
+}
+
+TEST(LocalMemcpyTransport, WritesAndReadsAcrossChunks) {
+    // Larger than a chunk, so that it is copied by several workers
+    const size_t kLength = 5 * 1024 * 1024 + 123;
+    std::vector<char> local(kLength), target(kLength, 0), back(kLength, 0);
+    for (size_t i = 0; i < kLength; ++i) local[i] = 'a' + i % 26;
+
+    LocalMemcpyTransport transport(4);
+    auto batch_id = transport.allocateBatchID(2);
+    TransferRequest write_request{};
+    write_request.opcode = TransferRequest::WRITE;
+    write_request.source = local.data();
+    write_request.target_offset = reinterpret_cast<uint64_t>(target.data());
+    write_request.length = kLength;
+    ASSERT_TRUE(transport.submitTransfer(batch_id, {write_request}).ok());
+    EXPECT_EQ(waitTask(transport, batch_id, 0),
+              Transport::TransferStatusEnum::COMPLETED);
+    EXPECT_EQ(target, local);
+
+    TransferRequest read_request = write_request;
+    read_request.opcode = TransferRequest::READ;
+    read_request.source = back.data();
+    ASSERT_TRUE(transport.submitTransfer(batch_id, {read_request}).ok());
+    EXPECT_EQ(waitTask(transport, batch_id, 1),
+              Transport::TransferStatusEnum::COMPLETED);
+    EXPECT_EQ(back, local);
+    EXPECT_TRUE(transport.freeBatchID(batch_id).ok());
+}
+
+TEST(LocalMemcpyTransport, CopiesStridedBlocks) {
+    std::vector<char> local(0x4000), target(0x4000, 0);
+    for (size_t i = 0; i < local.size(); ++i) local[i] = 'a' + i % 26;
+
+    LocalMemcpyTransport transport(2);
+    auto batch_id = transport.allocateBatchID(1);
+    TransferRequest request{};
+    request.opcode = TransferRequest::WRITE;
+    request.source = local.data();
+    request.target_offset = reinterpret_cast<uint64_t>(target.data());
+    request.block_count = 4;
+    request.block_length = 0x100;
+    request.source_stride = 0x1000;
+    request.target_stride = 0x200;
+    request.length = 4 * 0x100;
+    ASSERT_TRUE(transport.submitTransfer(batch_id, {request}).ok());
+    EXPECT_EQ(waitTask(transport, batch_id, 0),
+              Transport::TransferStatusEnum::COMPLETED);
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(memcmp(&target[i * 0x200], &local[i * 0x1000], 0x100), 0);
+    }
+    EXPECT_EQ(target[0x100], 0);
+    EXPECT_TRUE(transport.freeBatchID(batch_id).ok());
+}
+
+}  // namespace
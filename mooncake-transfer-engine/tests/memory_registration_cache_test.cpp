@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "memory_registration_cache.h"
+
+namespace {
+
+using namespace mooncake;
+using Allocation = MemoryRegistrationCache::Allocation;
+
+constexpr size_t kBlockSize = 1 << 20;
+
+// Fake device allocations by base address, and the registrations made
+struct FakeDevice {
+    std::map<uintptr_t, Allocation> allocations;
+    std::vector<std::pair<uintptr_t, size_t>> registered;
+    std::vector<uintptr_t> unregistered;
+
+    void allocate(uintptr_t base, size_t length, uint64_t buffer_id) {
+        allocations[base] = {base, length, buffer_id};
+    }
+
+    bool resolve(void *addr, Allocation &allocation) {
+        auto iter = allocations.upper_bound((uintptr_t)addr);
+        if (iter == allocations.begin()) return false;
+        --iter;
+        if ((uintptr_t)addr >= iter->first + iter->second.length) return false;
+        allocation = iter->second;
+        return true;
+    }
+
+    MemoryRegistrationCache::RegisterFunc registerFunc() {
+        return [this](void *addr, size_t length) {
+            registered.emplace_back((uintptr_t)addr, length);
+            return 0;
+        };
+    }
+};
+
+std::unique_ptr<MemoryRegistrationCache> makeCache(FakeDevice &device,
+                                                   size_t idle_limit) {
+    return std::make_unique<MemoryRegistrationCache>(
+        [&device](void *addr, Allocation &allocation) {
+            return device.resolve(addr, allocation);
+        },
+        [&device](void *addr) {
+            device.unregistered.push_back((uintptr_t)addr);
+            return 0;
+        },
+        idle_limit);
+}
+
+void *ptr(uintptr_t addr) { return reinterpret_cast<void *>(addr); }
+
+TEST(MemoryRegistrationCache, HostMemoryIsLeftToTheCaller) {
+    FakeDevice device;
+    auto cache = makeCache(device, kBlockSize);
+    EXPECT_EQ(cache->acquire(ptr(0x1000), 4096, device.registerFunc()), 1);
+    EXPECT_EQ(cache->release(ptr(0x1000)), 1);
+    EXPECT_TRUE(device.registered.empty());
+}
+
+TEST(MemoryRegistrationCache, SubRangesShareTheirBlock) {
+    FakeDevice device;
+    device.allocate(0x100000, kBlockSize, 1);
+    auto cache = makeCache(device, kBlockSize);
+    EXPECT_EQ(cache->acquire(ptr(0x110000), 4096, device.registerFunc()), 0);
+    EXPECT_EQ(cache->acquire(ptr(0x180000), 65536, device.registerFunc()), 0);
+    ASSERT_EQ(device.registered.size(), 1u);
+    EXPECT_EQ(device.registered[0].first, 0x100000u);
+    EXPECT_EQ(device.registered[0].second, kBlockSize);
+
+    // Released blocks stay registered within the idle limit
+    EXPECT_EQ(cache->release(ptr(0x110000)), 0);
+    EXPECT_EQ(cache->release(ptr(0x180000)), 0);
+    EXPECT_TRUE(device.unregistered.empty());
+    EXPECT_EQ(cache->idleBytes(), kBlockSize);
+    EXPECT_EQ(cache->acquire(ptr(0x120000), 4096, device.registerFunc()), 0);
+    EXPECT_EQ(device.registered.size(), 1u);
+    EXPECT_EQ(cache->idleBytes(), 0u);
+}
+
+TEST(MemoryRegistrationCache, RejectsRangesBeyondTheAllocation) {
+    FakeDevice device;
+    device.allocate(0x100000, kBlockSize, 1);
+    auto cache = makeCache(device, kBlockSize);
+    EXPECT_LT(cache->acquire(ptr(0x1f0000), kBlockSize, device.registerFunc()),
+              0);
+    EXPECT_TRUE(device.registered.empty());
+}
+
+TEST(MemoryRegistrationCache, EvictsOldestIdleBlocks) {
+    FakeDevice device;
+    device.allocate(0x100000, kBlockSize, 1);
+    device.allocate(0x200000, kBlockSize, 2);
+    auto cache = makeCache(device, kBlockSize);
+    cache->acquire(ptr(0x100000), 4096, device.registerFunc());
+    cache->acquire(ptr(0x200000), 4096, device.registerFunc());
+    cache->release(ptr(0x100000));
+    cache->release(ptr(0x200000));
+    ASSERT_EQ(device.unregistered.size(), 1u);
+    EXPECT_EQ(device.unregistered[0], 0x100000u);
+    EXPECT_EQ(cache->idleBytes(), kBlockSize);
+}
+
+TEST(MemoryRegistrationCache, FreedAndReallocatedBlocks) {
+    FakeDevice device;
+    device.allocate(0x100000, kBlockSize, 1);
+    auto cache = makeCache(device, 4 * kBlockSize);
+    cache->acquire(ptr(0x100000), 4096, device.registerFunc());
+    cache->release(ptr(0x100000));
+
+    // Reported free
+    EXPECT_EQ(cache->invalidate(ptr(0x100000)), 0);
+    ASSERT_EQ(device.unregistered.size(), 1u);
+    EXPECT_EQ(cache->idleBytes(), 0u);
+
+    // Silently reallocated at the same address
+    cache->acquire(ptr(0x100000), 4096, device.registerFunc());
+    cache->release(ptr(0x100000));
+    device.allocate(0x100000, kBlockSize, 3);
+    cache->acquire(ptr(0x100000), 4096, device.registerFunc());
+    EXPECT_EQ(device.registered.size(), 3u);
+    EXPECT_EQ(device.unregistered.size(), 2u);
+}
+
+}  // namespace
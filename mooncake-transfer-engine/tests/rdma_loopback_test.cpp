@@ -94,6 +94,8 @@ TEST_F(RDMALoopbackTest, MultiWrite) {
 
 int main(int argc, char **argv) {
     gflags::ParseCommandLineFlags(&argc, &argv, false);
+    // Otherwise the local segment is copied without the NIC
+    setenv("MC_DISABLE_LOCAL_MEMCPY", "1", 0);
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
\ No newline at end of file
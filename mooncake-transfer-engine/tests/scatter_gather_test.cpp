@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "transport/rdma_transport/rdma_transport.h"
+
+namespace {
+
+using namespace mooncake;
+using Block = RdmaTransport::Block;
+using SliceSpec = RdmaTransport::SliceSpec;
+
+char *at(uint64_t addr) { return reinterpret_cast<char *>(addr); }
+
+TEST(ScatterGather, EnumeratesStridedAndIovecBlocks) {
+    TransferRequest request{};
+    request.source = at(0x10000);
+    request.target_offset = 0x90000;
+    request.length = 3 * 0x1000;
+    request.block_count = 3;
+    request.block_length = 0x1000;
+    request.source_stride = 0x4000;
+    request.target_stride = 0x2000;
+    ASSERT_TRUE(request.validLayout());
+    EXPECT_FALSE(request.isContiguous());
+    EXPECT_EQ(request.targetSpan(), 0x5000u);
+    std::vector<Block> blocks;
+    request.forEachBlock([&](char *source, uint64_t target, size_t length) {
+        blocks.push_back(Block{source, target, length});
+    });
+    ASSERT_EQ(blocks.size(), 3u);
+    EXPECT_EQ(blocks[2].source, at(0x18000));
+    EXPECT_EQ(blocks[2].target, 0x94000u);
+
+    iovec iov[2] = {{at(0x30000), 0x100}, {at(0x10000), 0x200}};
+    TransferRequest gather{};
+    gather.target_offset = 0x1000;
+    gather.length = 0x300;
+    gather.source_iov = iov;
+    gather.source_iov_count = 2;
+    ASSERT_TRUE(gather.validLayout());
+    blocks.clear();
+    gather.forEachBlock([&](char *source, uint64_t target, size_t length) {
+        blocks.push_back(Block{source, target, length});
+    });
+    ASSERT_EQ(blocks.size(), 2u);
+    EXPECT_EQ(blocks[1].target, 0x1100u);
+    gather.length = 0x400;
+    EXPECT_FALSE(gather.validLayout());
+}
+
+TEST(ScatterGather, GathersAdjacentBlocksIntoOneSlice) {
+    // Eight 16 KiB pages, scattered locally, adjacent on the target
+    std::vector<Block> blocks;
+    for (uint64_t i = 0; i < 8; ++i)
+        blocks.push_back(Block{at(0x100000 + (7 - i) * 0x8000),
+                               0x900000 + i * 0x4000, 0x4000});
+    std::vector<SliceSpec> specs;
+    RdmaTransport::buildSliceSpecs(blocks, 0x10000, 0x1000, 4, specs);
+    ASSERT_EQ(specs.size(), 2u);
+    EXPECT_EQ(specs[0].block_count, 4u);
+    EXPECT_EQ(specs[0].length, 0x10000u);
+    EXPECT_EQ(specs[1].first_block, 4u);
+    EXPECT_EQ(specs[1].target, 0x910000u);
+
+    // Without SGEs to spare, one slice per page
+    RdmaTransport::buildSliceSpecs(blocks, 0x10000, 0x1000, 1, specs);
+    EXPECT_EQ(specs.size(), 8u);
+}
+
+TEST(ScatterGather, CutsLargeBlocksLikeContiguousRequests) {
+    // Not adjacent on the target, so each block is cut on its own, the
+    // tail fragment merged into the last slice
+    std::vector<Block> blocks{{at(0x100000), 0x900000, 0x10800},
+                              {at(0x200000), 0xa00000, 0x100}};
+    std::vector<SliceSpec> specs;
+    RdmaTransport::buildSliceSpecs(blocks, 0x4000, 0x1000, 4, specs);
+    ASSERT_EQ(specs.size(), 5u);
+    EXPECT_EQ(specs[3].length, 0x4800u);
+    EXPECT_EQ(specs[3].target, 0x90c000u);
+    EXPECT_EQ(specs[4].block_count, 1u);
+    EXPECT_EQ(specs[4].length, 0x100u);
+}
+
+}  // namespace
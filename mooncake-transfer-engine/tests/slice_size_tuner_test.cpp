@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "transport/rdma_transport/slice_size_tuner.h"
+
+namespace {
+
+using namespace mooncake;
+
+constexpr size_t kMinSize = 16384;
+constexpr size_t kMaxSize = 1048576;
+constexpr size_t kDefaultSize = 65536;
+
+// Completes bytes every interval_ns for duration_ns, each taking latency_ns
+void feed(SliceSizeTuner &tuner, uint64_t target_id, uint64_t bytes,
+          uint64_t latency_ns, uint64_t interval_ns, uint64_t duration_ns) {
+    const uint64_t kStart = 1000000000;
+    for (uint64_t ts = kStart; ts < kStart + duration_ns; ts += interval_ns)
+        tuner.record(target_id, bytes, ts, ts + latency_ns);
+}
+
+TEST(SliceSizeTuner, DefaultWithoutSamples) {
+    SliceSizeTuner tuner(kMinSize, kMaxSize, kDefaultSize);
+    EXPECT_EQ(tuner.peerSliceSize(1), kDefaultSize);
+    EXPECT_EQ(tuner.sliceSize(1, 1 << 30, 1), kDefaultSize);
+    feed(tuner, 1, 65536, 10000, 1000, 8000);
+    // Fewer than kWarmupSamples completions
+    EXPECT_EQ(tuner.peerSliceSize(1), kDefaultSize);
+}
+
+TEST(SliceSizeTuner, FollowsBandwidthDelayProduct) {
+    SliceSizeTuner tuner(kMinSize, kMaxSize, kDefaultSize);
+    // 64 KiB every 1 us is 65536 bytes/us; with a 4 us round trip the
+    // bandwidth-delay product is 256 KiB
+    feed(tuner, 1, 65536, 4000, 1000, 10000000);
+    EXPECT_EQ(tuner.peerSliceSize(1), 262144u);
+    // Another peer keeps its own estimate
+    EXPECT_EQ(tuner.peerSliceSize(2), kDefaultSize);
+}
+
+TEST(SliceSizeTuner, StaysWithinBounds) {
+    SliceSizeTuner tuner(kMinSize, kMaxSize, kDefaultSize);
+    // A lightly used peer: 4 KiB every 100 us
+    feed(tuner, 1, 4096, 2000, 100000, 100000000);
+    EXPECT_EQ(tuner.peerSliceSize(1), kMinSize);
+    // A fast and distant one
+    feed(tuner, 2, 1048576, 100000, 1000, 10000000);
+    EXPECT_EQ(tuner.peerSliceSize(2), kMaxSize);
+}
+
+TEST(SliceSizeTuner, SmallRequestsUseEveryRail) {
+    SliceSizeTuner tuner(kMinSize, kMaxSize, kDefaultSize);
+    EXPECT_EQ(tuner.sliceSize(1, 65536, 4), kMinSize);
+    EXPECT_EQ(tuner.sliceSize(1, 131072, 4), 32768u);
+    // Large enough to give every rail a slice of the peer size
+    EXPECT_EQ(tuner.sliceSize(1, 1 << 20, 4), kDefaultSize);
+    EXPECT_EQ(tuner.sliceSize(1, 8192, 4), kMinSize);
+}
+
+}  // namespace
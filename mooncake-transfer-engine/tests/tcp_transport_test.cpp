@@ -40,7 +40,10 @@ static void checkCudaError(cudaError_t result, const char *message) {
 }
 #endif
 
+#include <async_simple/coro/SyncAwait.h>
+
 #include "transfer_engine.h"
+#include "transfer_engine_coro.h"
 #include "transport/transport.h"
 
 #if defined(USE_CUDA) || defined(USE_MUSA) || defined(USE_HIP)
@@ -216,6 +219,53 @@ TEST_F(TCPTransportTest, WriteAndReadtest) {
                            kDataLength));
 }
 
+TEST_F(TCPTransportTest, CoroutineWriteAndReadtest) {
+    const size_t kDataLength = 4096000;
+    const size_t kNumTasks = 4;
+    void *addr = nullptr;
+    const size_t ram_buffer_size = 1ull << 30;
+    // disable topology auto discovery for testing.
+    auto engine = std::make_unique<TransferEngine>(false);
+    auto hostname_port = parseHostNameWithPort(local_server_name);
+    engine->init(metadata_server, local_server_name,
+                 hostname_port.first.c_str(), hostname_port.second);
+    Transport *xport = nullptr;
+    xport = engine->installTransport("tcp", nullptr);
+    LOG_ASSERT(xport != nullptr);
+
+    addr = allocateMemoryPool(ram_buffer_size, 0, false);
+    int rc = engine->registerLocalMemory(addr, ram_buffer_size, "cpu:0");
+    LOG_ASSERT(!rc);
+    for (size_t offset = 0; offset < kDataLength; ++offset)
+        *((char *)(addr) + offset) = 'a' + lrand48() % 26;
+
+    auto segment_id = engine->openSegment(local_server_name);
+    auto segment_desc = engine->getMetadata()->getSegmentDescByID(segment_id);
+    uint64_t remote_base = (uint64_t)segment_desc->buffers[0].addr;
+    const size_t kTaskLength = kDataLength / kNumTasks;
+    auto makeRequests = [&](TransferRequest::OpCode opcode, size_t offset) {
+        std::vector<TransferRequest> requests(kNumTasks);
+        for (size_t i = 0; i < kNumTasks; ++i) {
+            requests[i].opcode = opcode;
+            requests[i].length = kTaskLength;
+            requests[i].source = (uint8_t *)(addr) + offset + i * kTaskLength;
+            requests[i].target_id = segment_id;
+            requests[i].target_offset = remote_base + 2 * kDataLength +
+                                        i * kTaskLength;
+        }
+        return requests;
+    };
+
+    Status s = async_simple::coro::syncAwait(
+        transferAsync(*engine, makeRequests(TransferRequest::WRITE, 0)));
+    ASSERT_EQ(s, Status::OK());
+    s = async_simple::coro::syncAwait(transferAsync(
+        *engine, makeRequests(TransferRequest::READ, kDataLength)));
+    ASSERT_EQ(s, Status::OK());
+    LOG_ASSERT(0 == memcmp((uint8_t *)(addr), (uint8_t *)(addr) + kDataLength,
+                           kDataLength));
+}
+
 TEST_F(TCPTransportTest, WriteAndRead2test) {
     const size_t kDataLength = 4096000;
     void *addr = nullptr;
@@ -341,6 +391,8 @@ TEST_F(TCPTransportTest, WriteAndRead2test) {
 }  // namespace mooncake
 
 int main(int argc, char **argv) {
+    // Otherwise the local segment is copied without TCP
+    setenv("MC_DISABLE_LOCAL_MEMCPY", "1", 0);
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
\ No newline at end of file
@@ -16,6 +16,24 @@ TEST(ToplogyTest, GetTopologyMatrix) {
     ASSERT_EQ(topology.toString(), json_str);
 }
 
+TEST(ToplogyTest, CachedDiscoveryMatchesProbing) {
+    mooncake::Topology probed;
+    probed.discover();
+
+    char dir[] = "/tmp/topology_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    setenv("MC_TOPOLOGY_CACHE_DIR", dir, 1);
+    mooncake::Topology first, second;
+    first.discover();
+    second.discover();
+    unsetenv("MC_TOPOLOGY_CACHE_DIR");
+    EXPECT_EQ(first.toString(), probed.toString());
+    EXPECT_EQ(second.toString(), probed.toString());
+    EXPECT_EQ(second.getHcaList(), probed.getHcaList());
+    std::string cleanup = std::string("rm -rf ") + dir;
+    ASSERT_EQ(system(cleanup.c_str()), 0);
+}
+
 TEST(ToplogyTest, TestEmpty) {
     mooncake::Topology topology;
     std::string json_str =
@@ -106,6 +124,20 @@ TEST(ToplogyTest, TestSelectDeviceAny) {
     ASSERT_TRUE(items.empty());
 }
 
+TEST(ToplogyTest, TestFirstChoiceDevices) {
+    mooncake::Topology topology;
+    std::string json_str =
+        "{\"cpu:0\" : [[\"erdma_0\"],[\"erdma_1\"]], "
+        "\"cpu:1\" : [[],[\"erdma_0\", \"erdma_1\"]]}";
+    topology.clear();
+    topology.parse(json_str);
+    auto devices = topology.firstChoiceDevices("cpu:0");
+    ASSERT_EQ(devices.size(), 1UL);
+    ASSERT_EQ(topology.getHcaList()[devices[0]], "erdma_0");
+    ASSERT_EQ(topology.firstChoiceDevices("cpu:1").size(), 2UL);
+    ASSERT_TRUE(topology.firstChoiceDevices("cpu:2").empty());
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -20,7 +20,10 @@
 #include <sys/time.h>
 
 #include <cstdlib>
+#include <thread>
+#include <vector>
 
+#include "config.h"
 #include "transport/transport.h"
 
 using namespace mooncake;
@@ -123,6 +126,95 @@ TEST_F(TransferMetadataTest, RpcMetaEntryTest) {
     ASSERT_EQ(re, 0);
 }
 
+// publish segment descriptors, then fetch them in a batch and concurrently
+TEST_F(TransferMetadataTest, PrefetchSegmentDescTest) {
+    std::vector<std::string> segment_names;
+    for (int i = 0; i < 4; ++i) {
+        TransferMetadata::SegmentDesc desc;
+        desc.name = "test_prefetch_segment_" + std::to_string(i);
+        desc.protocol = "tcp";
+        desc.tcp_data_port = 12000 + i;
+        int re = metadata_client->updateSegmentDesc(desc.name, desc);
+        ASSERT_EQ(re, 0);
+        segment_names.push_back(desc.name);
+    }
+    // duplicated and unknown names are tolerated
+    auto names = segment_names;
+    names.push_back(segment_names[0]);
+    names.push_back("test_prefetch_segment_missing");
+    int re = metadata_client->prefetchSegmentDescs(names);
+    ASSERT_EQ(re, 0);
+    for (int i = 0; i < 4; ++i) {
+        auto id = metadata_client->getSegmentID(segment_names[i]);
+        ASSERT_NE(id, (TransferMetadata::SegmentID)-1);
+        auto des = metadata_client->getSegmentDescByID(id);
+        ASSERT_TRUE(des);
+        ASSERT_EQ(des->tcp_data_port, 12000 + i);
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<std::shared_ptr<TransferMetadata::SegmentDesc>> results(8);
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&, i] {
+            results[i] =
+                metadata_client->getSegmentDescByName(segment_names[0], true);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (auto& des : results) {
+        ASSERT_TRUE(des);
+        ASSERT_EQ(des->tcp_data_port, 12000);
+    }
+
+    for (auto& name : segment_names) {
+        re = metadata_client->removeSegmentDesc(name);
+        ASSERT_EQ(re, 0);
+    }
+}
+
+// publish the local segment in binary form, then its buffers as deltas
+TEST_F(TransferMetadataTest, BinarySegmentDescTest) {
+    globalConfig().metadata_binary = true;
+    const std::string segment_name = "test_binary_segment";
+    auto segment_des = std::make_shared<TransferMetadata::SegmentDesc>();
+    segment_des->name = segment_name;
+    segment_des->protocol = "tcp";
+    segment_des->tcp_data_port = 12100;
+    int re = metadata_client->addLocalSegment(LOCAL_SEGMENT_ID, segment_name,
+                                              std::move(segment_des));
+    ASSERT_EQ(re, 0);
+    re = metadata_client->updateLocalSegmentDesc();
+    ASSERT_EQ(re, 0);
+
+    // Enough buffers for the descriptor to be published in full again
+    auto reader = std::make_unique<TransferMetadata>(metadata_server);
+    const uint64_t addr = 0x100000;
+    for (int i = 0; i < 40; ++i) {
+        TransferMetadata::BufferDesc buffer_des{};
+        buffer_des.name = "cpu:0";
+        buffer_des.addr = addr + i * 4096;
+        buffer_des.length = 4096;
+        re = metadata_client->addLocalMemoryBuffer(buffer_des, true);
+        ASSERT_EQ(re, 0);
+        auto des = reader->getSegmentDescByName(segment_name, true);
+        ASSERT_TRUE(des);
+        ASSERT_EQ(des->tcp_data_port, 12100);
+        ASSERT_EQ(des->buffers.size(), size_t(i + 1));
+    }
+    re = metadata_client->removeLocalMemoryBuffer((void*)addr, true);
+    ASSERT_EQ(re, 0);
+    auto des = reader->getSegmentDescByName(segment_name, true);
+    ASSERT_TRUE(des);
+    ASSERT_EQ(des->buffers.size(), 39u);
+    for (auto& buffer : des->buffers) ASSERT_NE(buffer.addr, addr);
+
+    re = metadata_client->removeSegmentDesc(segment_name);
+    ASSERT_EQ(re, 0);
+    re = metadata_client->removeLocalSegment(segment_name);
+    ASSERT_EQ(re, 0);
+    globalConfig().metadata_binary = false;
+}
+
 }  // namespace mooncake
 
 int main(int argc, char** argv) {
@@ -180,7 +180,11 @@ class MooncakeConnector(KVConnectorBase_V1):
 
     def save_kv_layer(self, layer_name: str, kv_layer: torch.Tensor,
                       attn_metadata: "AttentionMetadata", **kwargs) -> None:
-        """MooncakeConnector does not save explicitly."""
+        """
+        MooncakeConnector does not save explicitly: the destination of the
+        KV is only known once the decoder asks for it, then the prefiller
+        streams it layer by layer, see send_kv_to_decode().
+        """
         pass
 
     def wait_for_save(self):
@@ -551,101 +555,104 @@ class MooncakeConnectorWorker:
             send_meta.expire_time = float("inf")
             send_reqs.append((req_id, send_meta))
 
-        src_ptrs, dst_ptrs, lengths = await self._build_transfer_params(send_reqs, meta)
+        # The layers of a request are queued as soon as it is ready, so they
+        # are transferred while the next requests are still being prefilled.
         remote_session = f"{meta.remote_hostname}:{meta.remote_port}"
-        ret_value = await self.sender_loop.run_in_executor(
-            self._sender_executor,
-            self._send_blocks,
-            remote_session,
-            src_ptrs,
-            dst_ptrs,
-            lengths,
-        )
+        start_time = time.perf_counter()
+        submitted = []
+        assert len(send_reqs) == len(meta.block_ids)
+        try:
+            for (req_id, send_meta), remote_block_ids in zip(
+                send_reqs, meta.block_ids
+            ):
+                await send_meta.ready.wait()
+                submitted.append(req_id)
+                for src_ptrs, dst_ptrs, lengths in self._build_transfer_params(
+                    send_meta, remote_block_ids, meta
+                ):
+                    ret_value = self.engine.submit_layer_write(
+                        req_id, remote_session, src_ptrs, dst_ptrs, lengths
+                    )
+                    if ret_value != 0:
+                        raise RuntimeError(
+                            f"Error in submit_layer_write: {ret_value}")
+                logger.debug(
+                    "Sending kv_caches for request %s (%d blocks) to %s",
+                    req_id,
+                    len(remote_block_ids),
+                    remote_session,
+                )
+        finally:
+            ret_value = await self.sender_loop.run_in_executor(
+                self._sender_executor,
+                self._wait_layer_writes,
+                submitted,
+            )
 
         if ret_value != 0:
-            raise RuntimeError(f"Error in batch_transfer_sync_write: {ret_value}")
+            raise RuntimeError(f"Error in layer writes: {ret_value}")
+        logger.debug(
+            "Sending to %s done, took %s",
+            remote_session,
+            time.perf_counter() - start_time,
+        )
 
         for req_id in meta.request_ids:
             del self.reqs_need_send[req_id]
 
         self.finished_sending_reqs.update(meta.request_ids)
 
-    async def _build_transfer_params(
+    def _build_transfer_params(
         self,
-        send_reqs: list[tuple[ReqId, SendBlockMeta]],
+        send_meta: SendBlockMeta,
+        remote_block_ids: list[int],
         agent_meta: MooncakeAgentMetadata,
-    ) -> tuple[list[int], list[int], list[int]]:
-        src_ptrs = []
-        dst_ptrs = []
-        lengths = []
-        local_base_addr = self.kv_caches_base_addr
-        remote_base_addr = agent_meta.kv_caches_base_addr
-        block_len = self.block_len
-        remote_session = f"{agent_meta.remote_hostname}:{agent_meta.remote_port}"
+    ) -> list[tuple[list[int], list[int], list[int]]]:
+        """The writes of one request, one batch per kv cache tensor."""
+        num_remote_blocks = len(remote_block_ids)
+        if num_remote_blocks == 0:
+            return []
+
+        local_block_ids = send_meta.local_block_ids
+        # Partial prefix cache hit: just read uncomputed blocks.
+        num_local_blocks = len(local_block_ids)
+        assert num_local_blocks >= num_remote_blocks
+        if num_local_blocks > num_remote_blocks:
+            local_block_ids = local_block_ids[-num_remote_blocks:]
+
+        # Group by indices
+        group_local_block_ids, group_remote_block_ids = group_concurrent_contiguous(
+            local_block_ids, remote_block_ids
+        )
 
-        assert len(send_reqs) == len(agent_meta.block_ids)
-        for (req_id, send_meta), remote_block_ids in zip(
-            send_reqs, agent_meta.block_ids
+        block_len = self.block_len
+        layers = []
+        for local_layer_addr, remote_layer_addr in zip(
+            self.kv_caches_base_addr, agent_meta.kv_caches_base_addr
         ):
-            await send_meta.ready.wait()
-
-            num_remote_blocks = len(remote_block_ids)
-            if num_remote_blocks == 0:
-                continue
-
-            local_block_ids = send_meta.local_block_ids
-            # Partial prefix cache hit: just read uncomputed blocks.
-            num_local_blocks = len(local_block_ids)
-            assert num_local_blocks >= num_remote_blocks
-            if num_local_blocks > num_remote_blocks:
-                local_block_ids = local_block_ids[-num_remote_blocks:]
-
-            # Group by indices
-            group_local_block_ids, group_remote_block_ids = group_concurrent_contiguous(
-                local_block_ids, remote_block_ids
-            )
-
-            for local_layer_addr, remote_layer_addr in zip(
-                local_base_addr, remote_base_addr
+            src_ptrs = []
+            dst_ptrs = []
+            lengths = []
+            for group_local_block_id, group_remote_block_id in zip(
+                group_local_block_ids, group_remote_block_ids
             ):
-                for group_local_block_id, group_remote_block_id in zip(
-                    group_local_block_ids, group_remote_block_ids
-                ):
-                    src_ptrs.append(
-                        local_layer_addr + group_local_block_id[0] * block_len
-                    )
-                    dst_ptrs.append(
-                        remote_layer_addr + group_remote_block_id[0] * block_len
-                    )
-                    lengths.append(block_len * len(group_local_block_id))
-
-            logger.debug(
-                "Sending kv_caches for request %s (%d blocks) to %s",
-                req_id,
-                num_remote_blocks,
-                remote_session,
-            )
-
-        return src_ptrs, dst_ptrs, lengths
-
-    def _send_blocks(
-        self,
-        remote_session: str,
-        src_ptrs: list[int],
-        dst_ptrs: list[int],
-        lengths: list[int],
-    ) -> int:
-        start_time = time.perf_counter()
-        ret_value = self.engine.batch_transfer_sync_write(
-            remote_session, src_ptrs, dst_ptrs, lengths
-        )
-        if ret_value == 0:
-            logger.debug(
-                "Sending to %s done, took %s",
-                remote_session,
-                time.perf_counter() - start_time,
-            )
-        return ret_value
+                src_ptrs.append(
+                    local_layer_addr + group_local_block_id[0] * block_len
+                )
+                dst_ptrs.append(
+                    remote_layer_addr + group_remote_block_id[0] * block_len
+                )
+                lengths.append(block_len * len(group_local_block_id))
+            layers.append((src_ptrs, dst_ptrs, lengths))
+        return layers
+
+    def _wait_layer_writes(self, req_ids: list[ReqId]) -> int:
+        result = 0
+        for req_id in req_ids:
+            ret_value = self.engine.wait_layer_writes(req_id)
+            if ret_value != 0:
+                result = ret_value
+        return result
 
     def register_kv_caches(self, kv_caches: dict[str, torch.Tensor]):
         """Register the KV Cache data in mooncake."""
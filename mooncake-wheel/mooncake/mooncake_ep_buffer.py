@@ -58,7 +58,8 @@ class EventOverlap:
 
 
 class Buffer:
-    def __init__(self, group: dist.ProcessGroup, num_ep_buffer_bytes: int = 0):
+    def __init__(self, group: dist.ProcessGroup, num_ep_buffer_bytes: int = 0, num_nics: int = 1,
+                 shared_recv: bool = False):
         from mooncake import ep, pg
         # Initialize the CPP runtime
         self.rank = group.rank()
@@ -66,10 +67,14 @@ class Buffer:
         self.group = group
         self.num_ep_buffer_bytes = num_ep_buffer_bytes
 
-        # Get the index of the closest NIC
+        # Get the closest NICs, the QPs are striped over up to `num_nics` of them
         self.backend = self.group._get_backend(torch.device('cuda'))
-        preferred_hca = pg.get_preferred_hca(self.backend, f'cuda:{torch.cuda.current_device()}')
-        self.runtime = ep.Buffer(self.rank, self.group_size, num_ep_buffer_bytes, preferred_hca)
+        location = f'cuda:{torch.cuda.current_device()}'
+        hcas = [pg.get_preferred_hca(self.backend, location)]
+        if num_nics > 1:
+            hcas += [hca for hca in pg.get_preferred_hcas(self.backend, location) if hca not in hcas]
+        self.runtime = ep.Buffer(self.rank, self.group_size, num_ep_buffer_bytes, ','.join(hcas[:max(num_nics, 1)]),
+                                 shared_recv)
         # Fallback flag and buffers.
         # Note: `sync_nvlink_ipc_handles()` can mutate C++ `ibgda_disabled_` (True->False when
         # P2P+IPC succeeds for all ranks). We re-evaluate after IPC sync below.
@@ -77,47 +82,34 @@ class Buffer:
         self._fallback_next_combine_buffer: Optional[torch.Tensor] = None
 
         if not self._use_fallback:
-            (raddr, rkey) = self.runtime.get_mr_info()
+            (raddr, _) = self.runtime.get_mr_info()
 
             raddr = torch.tensor([raddr], dtype=torch.int64, device='cuda')
             raddrs = [torch.empty(1, dtype=torch.int64, device='cuda') for _ in range(self.group_size)]
             dist.all_gather(raddrs, raddr, group)
             raddrs = torch.cat(raddrs).tolist()
 
-            rkey = torch.tensor([rkey], dtype=torch.int32, device='cuda')
-            rkeys = [torch.empty(1, dtype=torch.int32, device='cuda') for _ in range(self.group_size)]
-            dist.all_gather(rkeys, rkey, group)
-            rkeys = torch.cat(rkeys).tolist()
-
             all_to_all_size = ep.MAX_QP_COUNT // self.group_size
 
-            local_qpns = self.runtime.get_local_qpns()
-            local_qpns = list(torch.unbind(torch.tensor(local_qpns, dtype=torch.int32, device='cuda').view(-1, all_to_all_size)))
-            remote_qpns = [torch.empty(all_to_all_size, dtype=torch.int32, device='cuda') for _ in range(self.group_size)]
-            dist.all_to_all(remote_qpns, local_qpns, group)
-            remote_qpns = torch.cat(remote_qpns).tolist()
-
-            if self.runtime.is_roce():
-                (subnet_prefix, interface_id) = self.runtime.get_gid()
+            # QPs may be on different NICs, so everything a peer needs to reach
+            # one of them is exchanged per QP, with the peer that owns the other end
+            def exchange_per_qp(values, dtype):
+                local = list(torch.unbind(torch.tensor(values, dtype=dtype, device='cuda').view(-1, all_to_all_size)))
+                remote = [torch.empty(all_to_all_size, dtype=dtype, device='cuda') for _ in range(self.group_size)]
+                dist.all_to_all(remote, local, group)
+                return torch.cat(remote).tolist()
 
-                subnet_prefix = torch.tensor([subnet_prefix], dtype=torch.int64, device='cuda')
-                subnet_prefixes = [torch.empty(1, dtype=torch.int64, device='cuda') for _ in range(self.group_size)]
-                dist.all_gather(subnet_prefixes, subnet_prefix, group)
-                subnet_prefixes = torch.cat(subnet_prefixes).tolist()
+            rkeys = exchange_per_qp(self.runtime.get_local_rkeys(), torch.int32)
+            remote_qpns = exchange_per_qp(self.runtime.get_local_qpns(), torch.int32)
 
-                interface_id = torch.tensor([interface_id], dtype=torch.int64, device='cuda')
-                interface_ids = [torch.empty(1, dtype=torch.int64, device='cuda') for _ in range(self.group_size)]
-                dist.all_gather(interface_ids, interface_id, group)
-                interface_ids = torch.cat(interface_ids).tolist()
+            if self.runtime.is_roce():
+                (subnet_prefixes, interface_ids) = self.runtime.get_local_gids()
+                subnet_prefixes = exchange_per_qp(subnet_prefixes, torch.int64)
+                interface_ids = exchange_per_qp(interface_ids, torch.int64)
 
                 self.runtime.sync_roce(raddrs, rkeys, remote_qpns, subnet_prefixes, interface_ids)
             else:
-
-                local_lids = self.runtime.get_local_lids()
-                local_lids = list(torch.unbind(torch.tensor(local_lids, dtype=torch.int32, device='cuda').view(-1, all_to_all_size)))
-                remote_lids = [torch.empty(all_to_all_size, dtype=torch.int32, device='cuda') for _ in range(self.group_size)]
-                dist.all_to_all(remote_lids, local_lids, group)
-                remote_lids = torch.cat(remote_lids).tolist()
+                remote_lids = exchange_per_qp(self.runtime.get_local_lids(), torch.int32)
 
                 self.runtime.sync_ib(raddrs, rkeys, remote_qpns, remote_lids)
 
@@ -163,9 +155,10 @@ class Buffer:
         self._use_fallback = not use_fast_path
 
     @staticmethod
-    def get_ep_buffer_size_hint(num_max_dispatch_tokens_per_rank: int, hidden: int, num_ranks: int, num_experts: int) -> int:
+    def get_ep_buffer_size_hint(num_max_dispatch_tokens_per_rank: int, hidden: int, num_ranks: int, num_experts: int,
+                                shared_recv: bool = False) -> int:
         from mooncake.ep import get_ep_buffer_size_hint
-        return get_ep_buffer_size_hint(num_max_dispatch_tokens_per_rank, hidden, num_ranks, num_experts)
+        return get_ep_buffer_size_hint(num_max_dispatch_tokens_per_rank, hidden, num_ranks, num_experts, shared_recv)
 
     # noinspection PyTypeChecker
     def dispatch(self, x: torch.Tensor, topk_idx: torch.Tensor, active_ranks: torch.Tensor,
@@ -195,14 +188,17 @@ class Buffer:
     def combine(self, x: torch.Tensor, topk_idx: torch.Tensor, topk_weights: torch.Tensor,
                 active_ranks: torch.Tensor, timeout_us: int,
                 handle: tuple, zero_copy: bool = False, async_finish: bool = False,
-                return_recv_hook: bool = False, out: Optional[torch.Tensor] = None) -> \
+                return_recv_hook: bool = False, out: Optional[torch.Tensor] = None,
+                use_fp8: bool = False) -> \
             Tuple[torch.Tensor, EventOverlap, Callable]:
+        # NOTES: with `use_fp8`, the expert outputs are sent as FP8 with one scale per 128 channels
+        # and reduced in float, which halves the combine traffic; all ranks must pass the same value
         src_info, layout_range, num_max_dispatch_tokens_per_rank, hidden, num_experts = handle
         if self._use_fallback:
             from mooncake.ep import get_active_ranks
             combined_x, event, hook = self._fallback_combine(x, topk_idx, topk_weights, src_info, layout_range,
                                                              num_max_dispatch_tokens_per_rank, num_experts,
-                                                             zero_copy, return_recv_hook, out)
+                                                             zero_copy, return_recv_hook, out, use_fp8)
             backend_active_ranks = get_active_ranks(self.backend).to(device=active_ranks.device, dtype=active_ranks.dtype)
             if active_ranks.numel() == backend_active_ranks.numel():
                 active_ranks.copy_(backend_active_ranks)
@@ -210,7 +206,7 @@ class Buffer:
             combined_x, event, hook = self.runtime.combine(x, topk_idx, topk_weights, src_info, layout_range,
                                                            active_ranks,
                                                            num_max_dispatch_tokens_per_rank, num_experts, timeout_us,
-                                                           zero_copy, async_finish, return_recv_hook, out)
+                                                           zero_copy, async_finish, return_recv_hook, out, use_fp8)
         tensors_to_record = (x, topk_idx, topk_weights, src_info, layout_range, combined_x)
         return combined_x, EventOverlap(event, tensors_to_record if async_finish else None), hook
 
@@ -369,7 +365,8 @@ class Buffer:
     def _fallback_combine(self, x: torch.Tensor, topk_idx: torch.Tensor, topk_weights: torch.Tensor,
                           src_info: torch.Tensor, layout_range: torch.Tensor,
                           num_max_dispatch_tokens_per_rank: int, num_experts: int,
-                          zero_copy: bool, return_recv_hook: bool, out: Optional[torch.Tensor]):
+                          zero_copy: bool, return_recv_hook: bool, out: Optional[torch.Tensor],
+                          use_fp8: bool = False):
         from mooncake.ep import get_active_ranks
         with torch.profiler.record_function('combine'):
             num_tokens = topk_idx.size(0)
@@ -409,6 +406,11 @@ class Buffer:
             if expert_buffers.dtype != torch.bfloat16:
                 # FP8 path should already have been cast back by caller before combine in tests
                 expert_buffers = expert_buffers.to(torch.bfloat16)
+            if use_fp8:
+                # Match the precision of the FP8 kernel
+                x_fp8, x_scales = Buffer._fp8_cast(expert_buffers.reshape(-1, hidden))
+                expert_buffers = (x_fp8.float().view(-1, hidden // 128, 128) * x_scales.unsqueeze(2)) \
+                    .to(torch.bfloat16).view(expert_buffers.shape)
 
             # Build send buffer [num_ranks, max_num_tokens, hidden]
             send_buf = torch.zeros((num_ranks, max_num_tokens, hidden), dtype=torch.bfloat16, device=expert_buffers.device)
@@ -0,0 +1,385 @@
+"""
+Weight synchronization from a trainer to rollout workers over the Transfer
+Engine.
+
+The trainer packs its parameters into large registered buckets and writes
+them straight into registered weight buffers of the rollout workers, which
+forward every bucket to the next workers of a tree as soon as it landed.
+Packing, sending and forwarding of consecutive buckets overlap, so a
+version takes about one pass of the weights over the slowest link.
+
+Each worker keeps ``num_slots`` copies of the weights. A version is written
+into a slot no worker serves, and a worker only switches to it with
+``update()`` once every bucket of the version landed, so rollouts never see
+a partial update. The sender does not overwrite a slot before every worker
+moved past the version it holds.
+
+The sender and the workers exchange their ``info()`` out of band, e.g. via
+Ray or torch.distributed, and all of them must be built from the same
+tensor names, shapes and dtypes in the same order.
+"""
+
+import contextlib
+import math
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from typing import Dict, List, Optional, Sequence, Tuple
+
+import torch
+
+# Alignment of every tensor in the weight buffers
+ALIGNMENT = 256
+DEFAULT_BUCKET_SIZE = 512 * 1024 * 1024
+
+TensorSpec = Tuple[str, Sequence[int], torch.dtype]
+
+
+def _align(offset: int) -> int:
+    return (offset + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+
+
+def _flat_bytes(tensor: torch.Tensor) -> torch.Tensor:
+    return tensor.detach().contiguous().reshape(-1).view(torch.uint8)
+
+
+def tree_children(index: int, num_receivers: int, fanout: int) -> List[int]:
+    """Receivers fed by receiver ``index``, the sender being index -1."""
+    first = (index + 1) * fanout
+    return list(range(first, min(first + fanout, num_receivers)))
+
+
+class WeightLayout:
+    """Where every tensor lives in the flat weight buffer, and how the
+    buffer is cut into buckets of ``bucket_size`` bytes."""
+
+    def __init__(self, specs: Sequence[TensorSpec],
+                 bucket_size: int = DEFAULT_BUCKET_SIZE):
+        if bucket_size <= 0:
+            raise ValueError("bucket_size must be positive")
+        self.entries: Dict[str, Tuple[int, int, Tuple[int, ...],
+                                      torch.dtype]] = {}
+        offset = 0
+        for name, shape, dtype in specs:
+            element_size = torch.empty((), dtype=dtype).element_size()
+            nbytes = math.prod(shape) * element_size
+            self.entries[name] = (offset, nbytes, tuple(shape), dtype)
+            offset = _align(offset + nbytes)
+        self.total_bytes = max(offset, ALIGNMENT)
+        self.bucket_size = bucket_size
+        self.num_buckets = math.ceil(self.total_bytes / bucket_size)
+
+        # Pieces of the tensors in every bucket, as (name, first byte in the
+        # tensor, end byte in the tensor, first byte in the bucket)
+        self.pieces: List[List[Tuple[str, int, int, int]]] = [
+            [] for _ in range(self.num_buckets)
+        ]
+        for name, (offset, nbytes, _, _) in self.entries.items():
+            pos = 0
+            while pos < nbytes:
+                bucket = (offset + pos) // bucket_size
+                bucket_end = (bucket + 1) * bucket_size
+                length = min(nbytes - pos, bucket_end - offset - pos)
+                self.pieces[bucket].append(
+                    (name, pos, pos + length,
+                     offset + pos - bucket * bucket_size))
+                pos += length
+
+    @classmethod
+    def from_tensors(cls, named_tensors: Dict[str, torch.Tensor],
+                     bucket_size: int = DEFAULT_BUCKET_SIZE):
+        return cls([(name, tuple(t.shape), t.dtype)
+                    for name, t in named_tensors.items()], bucket_size)
+
+    def bucket_range(self, bucket: int) -> Tuple[int, int]:
+        start = bucket * self.bucket_size
+        return start, min(start + self.bucket_size, self.total_bytes)
+
+    def views(self, flat: torch.Tensor) -> Dict[str, torch.Tensor]:
+        """The tensors inside the flat uint8 buffer ``flat``."""
+        return {
+            name: flat[offset:offset + nbytes].view(dtype).view(shape)
+            for name, (offset, nbytes, shape, dtype) in self.entries.items()
+        }
+
+
+class _Node:
+    """What the sender and the receivers share: registered memory and the
+    forwarding of buckets to the children in the tree."""
+
+    def __init__(self, engine, session_id: str, layout: WeightLayout,
+                 num_slots: int, fanout: int, max_workers: int):
+        if num_slots < 2:
+            raise ValueError("num_slots must be at least 2")
+        self.engine = engine
+        self.session_id = session_id
+        self.layout = layout
+        self.num_slots = num_slots
+        self.fanout = fanout
+        self._registered: List[int] = []
+        self._pool = ThreadPoolExecutor(max_workers=max_workers)
+        self._children: List[dict] = []
+        # Source of the bucket flags written to the children
+        self._tag = self._register(torch.zeros(1, dtype=torch.int64))
+
+    def _register(self, tensor: torch.Tensor) -> torch.Tensor:
+        ret = self.engine.register_memory(tensor.data_ptr(),
+                                          tensor.numel() *
+                                          tensor.element_size())
+        if ret != 0:
+            raise RuntimeError(f"Failed to register weight sync buffer: "
+                               f"{ret}")
+        self._registered.append(tensor.data_ptr())
+        return tensor
+
+    def _write(self, target: str, local_addr: int, remote_addr: int,
+               length: int) -> None:
+        ret = self.engine.transfer_sync_write(target, local_addr,
+                                              remote_addr, length)
+        if ret != 0:
+            raise RuntimeError(f"Weight sync write to {target} failed: "
+                               f"{ret}")
+
+    def _forward(self, child: dict, source_addr: int, bucket: int,
+                 version: int) -> None:
+        # The flag of a bucket is written once its data landed
+        start, end = self.layout.bucket_range(bucket)
+        slot = version % self.num_slots
+        self._write(child["session_id"], source_addr,
+                    child["slots"][slot] + start, end - start)
+        self._write(child["session_id"], self._tag.data_ptr(),
+                    child["flags"] + bucket * 8, 8)
+
+    def close(self) -> None:
+        self._pool.shutdown(wait=True)
+        for addr in self._registered:
+            self.engine.unregister_memory(addr)
+        self._registered.clear()
+
+
+class WeightSender(_Node):
+    """The root of the tree, usually rank 0 of the trainer.
+
+    ``engine`` is an initialized ``mooncake.engine.TransferEngine`` and
+    ``session_id`` the name the receivers reach it by, e.g.
+    ``f"{ip}:{engine.get_rpc_port()}"`` with P2PHANDSHAKE metadata.
+    ``num_stages`` buckets are packed on ``device`` ahead of the sends.
+    """
+
+    def __init__(self, engine, session_id: str, specs: Sequence[TensorSpec],
+                 num_receivers: int, bucket_size: int = DEFAULT_BUCKET_SIZE,
+                 num_slots: int = 2, fanout: int = 2, num_stages: int = 2,
+                 device: Optional[str] = None):
+        layout = WeightLayout(specs, bucket_size)
+        super().__init__(engine, session_id, layout, num_slots, fanout,
+                         max_workers=max(1, fanout * num_stages))
+        if device is None:
+            device = "cuda" if torch.cuda.is_available() else "cpu"
+        self.device = torch.device(device)
+        self.num_receivers = num_receivers
+        self.version = 0
+        stage_bytes = min(bucket_size, layout.total_bytes)
+        self._stages = [
+            self._register(
+                torch.empty(stage_bytes, dtype=torch.uint8,
+                            device=self.device)) for _ in range(num_stages)
+        ]
+        # Version every receiver moved past, written by the receivers
+        self._acks = self._register(
+            torch.zeros(max(num_receivers, 1), dtype=torch.int64))
+        self._stream = (torch.cuda.Stream(device=self.device)
+                        if self.device.type == "cuda" else None)
+
+    def info(self) -> dict:
+        return {"session_id": self.session_id,
+                "acks": self._acks.data_ptr()}
+
+    def connect(self, receiver_infos: List[dict]) -> None:
+        """``receiver_infos[i]`` is ``info()`` of receiver i."""
+        if len(receiver_infos) != self.num_receivers:
+            raise ValueError("Expecting the info of every receiver")
+        self._children = [
+            receiver_infos[i]
+            for i in tree_children(-1, self.num_receivers, self.fanout)
+        ]
+
+    def _wait_acks(self, version: int, timeout: Optional[float]) -> None:
+        if self.num_receivers == 0:
+            return
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while int(self._acks[:self.num_receivers].min()) < version:
+            if deadline is not None and time.monotonic() > deadline:
+                raise TimeoutError(
+                    f"Receivers still use version {version - 1}")
+            time.sleep(0.001)
+
+    def push(self, named_tensors: Dict[str, torch.Tensor],
+             timeout: Optional[float] = None) -> int:
+        """Send the tensors as the next version, and return it once the
+        children of the sender received all of it. Blocks first while a
+        receiver still serves or forwards the version its slot holds."""
+        version = self.version + 1
+        self._wait_acks(version - self.num_slots + 1, timeout)
+        self._tag[0] = version
+        pending = [[] for _ in self._stages]
+        for bucket in range(self.layout.num_buckets):
+            stage = bucket % len(self._stages)
+            # The stage is reused once its previous bucket was sent
+            for future in pending[stage]:
+                future.result()
+            buffer = self._stages[stage]
+            with (torch.cuda.stream(self._stream) if self._stream else
+                  contextlib.nullcontext()):
+                for name, lo, hi, dst in self.layout.pieces[bucket]:
+                    src = _flat_bytes(named_tensors[name])[lo:hi]
+                    buffer[dst:dst + hi - lo].copy_(src, non_blocking=True)
+            if self._stream:
+                self._stream.synchronize()
+            pending[stage] = [
+                self._pool.submit(self._forward, child, buffer.data_ptr(),
+                                  bucket, version)
+                for child in self._children
+            ]
+        for futures in pending:
+            for future in futures:
+                future.result()
+        self.version = version
+        return version
+
+
+class WeightReceiver(_Node):
+    """Rollout worker ``index`` of ``num_receivers``. The weights live on
+    ``device`` in ``num_slots`` flat buffers, see ``tensors()``."""
+
+    def __init__(self, engine, session_id: str, specs: Sequence[TensorSpec],
+                 index: int, num_receivers: int,
+                 bucket_size: int = DEFAULT_BUCKET_SIZE, num_slots: int = 2,
+                 fanout: int = 2, device: Optional[str] = None):
+        layout = WeightLayout(specs, bucket_size)
+        super().__init__(engine, session_id, layout, num_slots, fanout,
+                         max_workers=max(1, fanout * 2))
+        if device is None:
+            device = "cuda" if torch.cuda.is_available() else "cpu"
+        self.index = index
+        self.num_receivers = num_receivers
+        self._slots = [
+            self._register(
+                torch.empty(layout.total_bytes, dtype=torch.uint8,
+                            device=device)) for _ in range(num_slots)
+        ]
+        # Version of the last landed write of every bucket
+        self._flags = self._register(
+            torch.zeros(layout.num_buckets, dtype=torch.int64))
+        self._ack = self._register(torch.zeros(1, dtype=torch.int64))
+        self._lock = threading.Lock()
+        self._complete = 0   # Last version all buckets of which landed
+        self._forwarded = 0  # Last version forwarded to all children
+        self._serving = 0    # Version tensors() return
+        self._sender = None
+        self._running = False
+        self._thread = None
+
+    def info(self) -> dict:
+        return {"session_id": self.session_id,
+                "slots": [slot.data_ptr() for slot in self._slots],
+                "flags": self._flags.data_ptr()}
+
+    def connect(self, sender_info: dict, receiver_infos: List[dict]) -> None:
+        """Start receiving, from the ``info()`` of the sender and of every
+        receiver."""
+        self._sender = sender_info
+        self._children = [
+            receiver_infos[i]
+            for i in tree_children(self.index, self.num_receivers,
+                                   self.fanout)
+        ]
+        self._running = True
+        self._thread = threading.Thread(target=self._receive_loop,
+                                        daemon=True)
+        self._thread.start()
+
+    def _receive_loop(self) -> None:
+        num_buckets = self.layout.num_buckets
+        while self._running:
+            version = self._complete + 1
+            landed = [False] * num_buckets
+            futures = []
+            # The forwarding of the previous version completed
+            self._tag[0] = version
+            while self._running and not all(landed):
+                flags = self._flags.tolist()
+                for bucket in range(num_buckets):
+                    if landed[bucket] or flags[bucket] != version:
+                        continue
+                    landed[bucket] = True
+                    source = (self._slots[version % self.num_slots]
+                              .data_ptr() +
+                              self.layout.bucket_range(bucket)[0])
+                    futures += [
+                        self._pool.submit(self._forward, child, source,
+                                          bucket, version)
+                        for child in self._children
+                    ]
+                if not all(landed):
+                    time.sleep(0.0005)
+            if not self._running:
+                return
+            with self._lock:
+                self._complete = version
+            for future in futures:
+                future.result()
+            with self._lock:
+                self._forwarded = version
+                self._send_ack()
+
+    def _send_ack(self) -> None:
+        # Called with the lock held. The sender reuses the slot of a version
+        # once no receiver serves or forwards it.
+        ack = min(self._serving, self._forwarded)
+        if ack <= int(self._ack[0]):
+            return
+        self._ack[0] = ack
+        self._write(self._sender["session_id"], self._ack.data_ptr(),
+                    self._sender["acks"] + self.index * 8, 8)
+
+    @property
+    def latest_version(self) -> int:
+        """The last version received in full."""
+        return self._complete
+
+    def wait(self, version: int, timeout: Optional[float] = None) -> bool:
+        """Wait until ``version`` was received in full."""
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while self._complete < version:
+            if deadline is not None and time.monotonic() > deadline:
+                return False
+            time.sleep(0.001)
+        return True
+
+    def update(self) -> Optional[int]:
+        """Switch ``tensors()`` to the latest version received in full and
+        return it, or None when there is no newer one."""
+        with self._lock:
+            if self._complete <= self._serving:
+                return None
+            self._serving = self._complete
+            self._send_ack()
+            return self._serving
+
+    @property
+    def version(self) -> int:
+        return self._serving
+
+    def tensors(self) -> Dict[str, torch.Tensor]:
+        """Views of the served version, valid until the next ``update()``.
+        Empty before the first one."""
+        if self._serving == 0:
+            return {}
+        return self.layout.views(self._slots[self._serving % self.num_slots])
+
+    def close(self) -> None:
+        self._running = False
+        if self._thread is not None:
+            self._thread.join()
+        super().close()
+
@@ -635,6 +635,50 @@ class TestDistributedObjectStoreSingleStore(unittest.TestCase):
             self.assertEqual(self.store.remove(key), 0)
 
 
+    def test_get_view_operations(self):
+        """Test get_view/get_batch_view and get_batch alongside another thread."""
+        test_data = [os.urandom(1024 * 1024), os.urandom(4 * 1024 * 1024)]
+        keys = ["test_get_view_key1", "test_get_view_key2"]
+        for key, data in zip(keys, test_data):
+            self.assertEqual(self.store.put(key, data), 0)
+
+        view = self.store.get_view(keys[0])
+        self.assertIsInstance(view, memoryview)
+        self.assertEqual(bytes(view), test_data[0])
+        self.assertIsNone(self.store.get_view("non_existent_view_key"))
+
+        views = self.store.get_batch_view([keys[1], "non_existent_view_key", keys[0]])
+        self.assertEqual(len(views), 3)
+        self.assertEqual(bytes(views[0]), test_data[1])
+        self.assertIsNone(views[1])
+        self.assertEqual(bytes(views[2]), test_data[0])
+        del view, views
+
+        # Another Python thread keeps making progress during large fetches
+        ticks = 0
+        stop = threading.Event()
+
+        def spin():
+            nonlocal ticks
+            while not stop.is_set():
+                ticks += 1
+
+        spinner = threading.Thread(target=spin)
+        spinner.start()
+        try:
+            for _ in range(8):
+                values = self.store.get_batch(keys)
+                self.assertEqual(values, test_data)
+        finally:
+            stop.set()
+            spinner.join()
+        self.assertGreater(ticks, 0)
+
+        time.sleep(default_kv_lease_ttl / 1000)
+        for key in keys:
+            self.assertEqual(self.store.remove(key), 0)
+
+
 if __name__ == '__main__':
     # Show which test is running; stop on first failure
     unittest.main(verbosity=2, failfast=True)
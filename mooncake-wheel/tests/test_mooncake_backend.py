@@ -21,6 +21,13 @@ def worker(rank, world_size, results, collective):
         dist.all_reduce(tensor, op=dist.ReduceOp.SUM)
         results[rank] = tensor.item()
     
+    elif collective == "all_reduce_sum_large":
+        # Large enough for the reduce-scatter + allgather allreduce, spans
+        # several chunks and does not split evenly between the ranks
+        tensor = torch.full((3_000_001,), rank + 1, dtype=torch.int32, device="cuda")
+        dist.all_reduce(tensor, op=dist.ReduceOp.SUM)
+        results[rank] = (tensor.min().item(), tensor.max().item())
+
     elif collective == "all_reduce_product":
         tensor = torch.tensor([2], dtype=torch.int32, device="cuda")
         dist.all_reduce(tensor, op=dist.ReduceOp.PRODUCT)
@@ -105,6 +112,10 @@ class TestMooncakeBackend(unittest.TestCase):
         # Expected sum = 1 + 2 + 3 + 4 = 10
         self._spawn_and_check("all_reduce_sum", lambda size: sum(range(1, size + 1)))
     
+    def test_allreduce_sum_large(self):
+        expected_fn = lambda size: (sum(range(1, size + 1)),) * 2
+        self._spawn_and_check("all_reduce_sum_large", expected_fn)
+
     def test_allreduce_product(self):
         # Expected product(2, 2, 2, ……, 2) = 2 ^ N
         self._spawn_and_check("all_reduce_product", lambda size: 2 ** size)
@@ -57,6 +57,18 @@ def worker(rank, world_size, results, collective):
         else:
             results[rank] = None
 
+    elif collective == "all_to_all_single_uneven":
+        # Rank r sends j + 1 elements of value 100 * r + j to rank j
+        input_splits = [j + 1 for j in range(world_size)]
+        output_splits = [rank + 1] * world_size
+        tensor = torch.cat([
+            torch.full((j + 1,), 100 * rank + j, dtype=torch.int32)
+            for j in range(world_size)
+        ])
+        output = torch.zeros(sum(output_splits), dtype=torch.int32)
+        dist.all_to_all_single(output, tensor, output_splits, input_splits)
+        results[rank] = output.tolist()
+
     else:
         raise ValueError(f"Unsupported collective: {collective}")
 
@@ -100,6 +112,20 @@ class TestMooncakeBackend(unittest.TestCase):
     def test_barrier(self):
         self._spawn_and_check("barrier", lambda size: "ok")
 
+    def test_all_to_all_single_uneven(self):
+        mp_manager = mp.Manager()
+        results = mp_manager.dict()
+        mp.spawn(
+            worker,
+            args=(self.world_size, results, "all_to_all_single_uneven"),
+            nprocs=self.world_size,
+            join=True
+        )
+        for r in range(self.world_size):
+            expected = [100 * i + r for i in range(self.world_size)
+                        for _ in range(r + 1)]
+            self.assertEqual(results[r], expected)
+
     def test_gather(self):
         # Expected gather (Root) = [0, 1, 2, ..., size-1]
         # Expected gather (Others) = None
@@ -152,6 +152,38 @@ def _worker_multiple_senders(rank: int, world_size: int, results):
     dist.destroy_process_group()
 
 
+def _worker_large_tensor(rank: int, results):
+    world_size = 2
+    os.environ.setdefault("MASTER_ADDR", "127.0.0.1")
+    os.environ.setdefault("MASTER_PORT", "29503")
+
+    dist.init_process_group(
+        backend="mooncake-cpu",
+        rank=rank,
+        world_size=world_size,
+        pg_options=pg.MooncakeBackendOptions(
+            torch.zeros((world_size,), dtype=torch.int32, device="cpu")
+        ),
+    )
+
+    # 40 MiB, more than two transfer buffers, and not a multiple of them
+    numel = 10 * 2**20 + 3
+    if rank == 0:
+        send_tensor = torch.arange(numel, dtype=torch.int32, device="cpu")
+        dist.send(send_tensor, dst=1)
+        results[rank] = "ok"
+    else:
+        recv_tensor = torch.empty(numel, dtype=torch.int32, device="cpu")
+        dist.recv(recv_tensor, src=0)
+        expected = torch.arange(numel, dtype=torch.int32, device="cpu")
+        results[rank] = bool(torch.equal(recv_tensor, expected))
+
+    while len(results) < world_size:
+        time.sleep(0.1)
+
+    dist.destroy_process_group()
+
+
 class TestMooncakeBackendP2PCPU(unittest.TestCase):
     def test_ring_send_recv(self):
         world_size = 4
@@ -205,6 +237,20 @@ class TestMooncakeBackendP2PCPU(unittest.TestCase):
         # Rank 2 should complete successfully
         self.assertEqual(results[2], "ok")
 
+    def test_tensor_larger_than_buffer(self):
+        world_size = 2
+        mp_manager = mp.Manager()
+        results = mp_manager.dict()
+        mp.spawn(
+            _worker_large_tensor,
+            args=(results,),
+            nprocs=world_size,
+            join=True,
+        )
+
+        self.assertEqual(results[0], "ok")
+        self.assertTrue(results[1])
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -1,4 +1,5 @@
 import random
+import sys
 import torch
 import torch.distributed as dist
 from functools import partial
@@ -74,18 +75,23 @@ def test_main(num_tokens: int, hidden: int, num_experts: int, num_topk: int,
                     hash_value ^= hash_tensor(packed_recv_x[i, :num_valid_tokens])
 
             # Check combine correctness
-            for zero_copy in (False, True):
+            # NOTES: the async hook mode issues the sends on the communication stream
+            combine_modes = [(False, not return_recv_hook, False), (True, not return_recv_hook, False),
+                             (False, not return_recv_hook, True)]
+            combine_modes += [(False, True, False)] if return_recv_hook else []
+            for zero_copy, async_finish, combine_use_fp8 in combine_modes:
                 if zero_copy:
                     buffer.get_next_combine_buffer(handle)[:, :, :] = simulated_gemm_x
                 out = torch.empty((num_tokens, hidden), dtype=torch.bfloat16, device='cuda')
                 combined_x, event, hook = buffer.combine(simulated_gemm_x, topk_idx, topk_weights, active_ranks, -1, handle,
-                                                         async_finish=not return_recv_hook, zero_copy=zero_copy,
-                                                         return_recv_hook=return_recv_hook, out=out)
+                                                         async_finish=async_finish, zero_copy=zero_copy,
+                                                         return_recv_hook=return_recv_hook, out=out,
+                                                         use_fp8=combine_use_fp8)
                 hook() if return_recv_hook else event.current_stream_wait()
                 if do_check:
                     diff = calc_diff(x * topk_weights.masked_fill(topk_idx == -1, 0).sum(dim=1).view(-1, 1), combined_x)
                     assert torch.isnan(combined_x).sum().item() == 0
-                    assert diff < 1e-5, f'Error: {diff=}, {zero_copy=}'
+                    assert diff < (5e-3 if combine_use_fp8 else 1e-5), f'Error: {diff=}, {zero_copy=}, {combine_use_fp8=}'
                     hash_value ^= hash_tensor(combined_x)
 
     def create_test_cast_with_outliers(num_outliers):
@@ -106,7 +112,7 @@ def test_main(num_tokens: int, hidden: int, num_experts: int, num_topk: int,
         hook()
 
     # noinspection PyShadowingNames
-    def test_func(zero_copy: bool, return_recv_hook: bool):
+    def test_func(zero_copy: bool, return_recv_hook: bool, combine_use_fp8: bool = False):
         recv_x, recv_count, handle, event, hook = \
             buffer.dispatch(x, topk_idx, active_ranks, num_tokens, num_experts, -1,
                             async_finish=False, return_recv_hook=return_recv_hook)
@@ -114,16 +120,18 @@ def test_main(num_tokens: int, hidden: int, num_experts: int, num_topk: int,
         if zero_copy:
             buffer.get_next_combine_buffer(handle)[:, :, :] = simulated_gemm_x
         combined_x, event, hook = buffer.combine(simulated_gemm_x, topk_idx, topk_weights, active_ranks, -1, handle,
-                                                 zero_copy=zero_copy, return_recv_hook=return_recv_hook)
+                                                 zero_copy=zero_copy, return_recv_hook=return_recv_hook,
+                                                 use_fp8=combine_use_fp8)
         large_gemm_with_hook(hook) if return_recv_hook else None
 
     # Calculate bandwidth
     num_fp8_bytes, num_bf16_bytes = (hidden + hidden / 128 * 4 + 16), hidden * 2
-    num_dispatch_comm_bytes, num_combine_comm_bytes = 0, 0
+    num_dispatch_comm_bytes, num_combine_comm_bytes, num_fp8_combine_comm_bytes = 0, 0, 0
     for i in range(num_tokens):
         num_selections = (topk_idx[i] != -1).sum().item()
         num_dispatch_comm_bytes += num_fp8_bytes * num_selections
         num_combine_comm_bytes += num_bf16_bytes * num_selections
+        num_fp8_combine_comm_bytes += (num_fp8_bytes - 16) * num_selections
 
     # Dispatch + combine testing
     avg_t, min_t, max_t = bench(partial(test_func, zero_copy=False, return_recv_hook=False))
@@ -146,6 +154,13 @@ def test_main(num_tokens: int, hidden: int, num_experts: int, num_topk: int,
                           f'Combine bandwidth: {num_combine_comm_bytes / 1e9 / combine_t:.2f} GB/s, avg_t={combine_t * 1e6:.2f} us', flush=True)
                 else:
                     print(f'[rank {rank}] Profiling skipped (kernels not found in CUDA profiler)', flush=True)
+                cpu_group.barrier()
+                _, combine_t = bench_kineto(partial(test_func, zero_copy=True, return_recv_hook=False, combine_use_fp8=True),
+                                            kernel_names=('dispatch', 'combine'), barrier_comm_profiling=True,
+                                            suppress_kineto_output=True)
+                if combine_t > 0:
+                    print(f'[rank {rank}] FP8 combine bandwidth: {num_fp8_combine_comm_bytes / 1e9 / combine_t:.2f} GB/s, '
+                          f'avg_t={combine_t * 1e6:.2f} us', flush=True)
             else:
                 if dispatch_t > 0 and combine_t > 0:
                     print(f'[rank {rank}] Dispatch send/recv time: {dispatch_t * 2 * 1e6:.2f} us | '
@@ -160,14 +175,14 @@ def test_main(num_tokens: int, hidden: int, num_experts: int, num_topk: int,
 
 
 # noinspection PyUnboundLocalVariable
-def test_loop(local_rank: int, num_local_ranks: int):
+def test_loop(local_rank: int, num_local_ranks: int, shared_recv: bool = False):
     rank, num_ranks, group, cpu_group = init_dist(local_rank, num_local_ranks)
     num_tokens, hidden, num_topk, num_experts = 128, 7168, 8, 288
 
-    num_ep_buffer_bytes = Buffer.get_ep_buffer_size_hint(num_tokens, hidden, num_ranks, num_experts)
+    num_ep_buffer_bytes = Buffer.get_ep_buffer_size_hint(num_tokens, hidden, num_ranks, num_experts, shared_recv)
     if local_rank == 0:
         print(f'Allocating buffer size: {num_ep_buffer_bytes / 1e6} MB ...', flush=True)
-    buffer = Buffer(group, num_ep_buffer_bytes=num_ep_buffer_bytes)
+    buffer = Buffer(group, num_ep_buffer_bytes=num_ep_buffer_bytes, shared_recv=shared_recv)
 
     test_main(num_tokens, hidden, num_experts, num_topk, rank, num_ranks, group, cpu_group, buffer, seed=1)
 
@@ -190,4 +205,6 @@ def test_loop(local_rank: int, num_local_ranks: int):
 if __name__ == '__main__':
     # TODO: you may modify NUMA binding for less CPU overhead
     num_processes = 2
-    torch.multiprocessing.spawn(test_loop, args=(num_processes,), nprocs=num_processes)
+    # `--shared-recv` runs the same checks with one receive region for dispatch and combine
+    shared_recv = '--shared-recv' in sys.argv
+    torch.multiprocessing.spawn(test_loop, args=(num_processes, shared_recv), nprocs=num_processes)
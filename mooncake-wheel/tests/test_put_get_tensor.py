@@ -119,6 +119,40 @@ class TestDistributedObjectStore(unittest.TestCase):
         self.store.remove(key_bool)
         self.store.remove(key_rand)
 
+    def test_get_tensor_holds_client_buffer(self):
+        """Test that tensors from get_tensor keep their client buffer until freed."""
+        import gc
+        import torch
+
+        keys = [f"test_tensor_hold_{i}" for i in range(8)]
+        tensors = [torch.full((256 * 1024,), i, dtype=torch.float32) for i in range(len(keys))]
+        for key, tensor in zip(keys, tensors):
+            self.assertEqual(self.store.put_tensor(key, tensor), 0)
+
+        held = self.store.batch_get_tensor(keys)
+        for tensor, retrieved in zip(tensors, held):
+            self.assertIsNotNone(retrieved)
+            self.assertTrue(torch.equal(tensor, retrieved))
+
+        # Later gets must not reuse the buffers the held tensors still point to
+        for _ in range(4):
+            for key in reversed(keys):
+                self.assertIsNotNone(self.store.get_tensor(key))
+            gc.collect()
+            for tensor, retrieved in zip(tensors, held):
+                self.assertTrue(torch.equal(tensor, retrieved))
+
+        # A view outlives the tensor it was taken from
+        view = self.store.get_tensor(keys[3])[1:5]
+        gc.collect()
+        self.store.get_tensor(keys[4])
+        self.assertTrue(torch.equal(view, torch.full((4,), 3, dtype=torch.float32)))
+
+        del held, view
+        time.sleep(default_kv_lease_ttl / 1000)
+        for key in keys:
+            self.store.remove(key)
+
     def test_put_get_tensor_with_metadata(self):
         """Test storing and retrieving PyTorch tensors with metadata using put_tensor_with_metadata/get_tensor_with_metadata."""
         import torch
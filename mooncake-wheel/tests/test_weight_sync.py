@@ -0,0 +1,87 @@
+import unittest
+
+import torch
+
+from mooncake.weight_sync import (WeightLayout, WeightReceiver,
+                                  WeightSender, tree_children)
+
+
+class TestWeightLayout(unittest.TestCase):
+    def test_pieces_cover_every_tensor(self):
+        specs = [("a", (1000,), torch.float32), ("b", (3, 7), torch.int8),
+                 ("c", (), torch.float64), ("d", (0,), torch.float16)]
+        layout = WeightLayout(specs, bucket_size=1024)
+        covered = {name: 0 for name, _, _ in specs}
+        for bucket, pieces in enumerate(layout.pieces):
+            start, end = layout.bucket_range(bucket)
+            for name, lo, hi, dst in pieces:
+                offset = layout.entries[name][0]
+                self.assertEqual(lo, covered[name])
+                self.assertEqual(start + dst, offset + lo)
+                self.assertLessEqual(start + dst + hi - lo, end)
+                covered[name] = hi
+        for name, (offset, nbytes, _, _) in layout.entries.items():
+            self.assertEqual(offset % 256, 0)
+            self.assertEqual(covered[name], nbytes)
+
+        views = layout.views(torch.zeros(layout.total_bytes,
+                                         dtype=torch.uint8))
+        self.assertEqual(views["b"].shape, (3, 7))
+        self.assertEqual(views["c"].dtype, torch.float64)
+
+    def test_tree_reaches_every_receiver_once(self):
+        for fanout in (1, 2, 3):
+            reached = tree_children(-1, 10, fanout)
+            for index in range(10):
+                reached += tree_children(index, 10, fanout)
+            self.assertEqual(sorted(reached), list(range(10)))
+
+
+class TestWeightSyncLoopback(unittest.TestCase):
+    def setUp(self):
+        try:
+            from mooncake.engine import TransferEngine
+        except ImportError as e:
+            raise unittest.SkipTest(f"Transfer engine not available: {e}")
+        self.engines = []
+        for _ in range(4):
+            engine = TransferEngine()
+            if engine.initialize("127.0.0.1", "P2PHANDSHAKE", "tcp", ""):
+                raise unittest.SkipTest("Failed to initialize engine")
+            self.engines.append(engine)
+
+    def test_versions_reach_every_receiver(self):
+        weights = {"w": torch.arange(5000, dtype=torch.float32),
+                   "b": torch.ones(17, dtype=torch.int64)}
+        specs = [(name, tuple(t.shape), t.dtype)
+                 for name, t in weights.items()]
+        session = [f"127.0.0.1:{e.get_rpc_port()}" for e in self.engines]
+        sender = WeightSender(self.engines[0], session[0], specs,
+                              num_receivers=3, bucket_size=4096, fanout=1,
+                              device="cpu")
+        receivers = [
+            WeightReceiver(self.engines[i + 1], session[i + 1], specs, i, 3,
+                           bucket_size=4096, fanout=1, device="cpu")
+            for i in range(3)
+        ]
+        infos = [r.info() for r in receivers]
+        sender.connect(infos)
+        for receiver in receivers:
+            receiver.connect(sender.info(), infos)
+        try:
+            for step in range(3):
+                scaled = {name: t * (step + 1) for name, t in weights.items()}
+                version = sender.push(scaled, timeout=30)
+                for receiver in receivers:
+                    self.assertTrue(receiver.wait(version, timeout=30))
+                    self.assertEqual(receiver.update(), version)
+                    for name, t in receiver.tensors().items():
+                        self.assertTrue(torch.equal(t, scaled[name]))
+        finally:
+            for receiver in receivers:
+                receiver.close()
+            sender.close()
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -299,6 +299,39 @@ class TestMooncakeBasicFunctional(MooncakeAsyncTestBase):
         self.assertEqual(len(retrieved), size)
         self.assertEqual(retrieved, data)
 
+    async def test_08_native_buffer_io(self):
+        """Test that many get_into/put_from calls stay in flight on one thread."""
+        count = 256
+        item_size = 64 * 1024
+        keys = [f"test_native_async_{i}" for i in range(count)]
+        src = np.random.randint(0, 256, size=count * item_size, dtype=np.uint8)
+        dst = np.zeros_like(src)
+        src_ptr, dst_ptr = src.ctypes.data, dst.ctypes.data
+        self.assertEqual(self.store.register_buffer(src_ptr, src.nbytes), 0)
+        self.assertEqual(self.store.register_buffer(dst_ptr, dst.nbytes), 0)
+        try:
+            rcs = await asyncio.gather(*[
+                self.store.async_put_from(key, src_ptr + i * item_size, item_size)
+                for i, key in enumerate(keys)
+            ])
+            self.assertTrue(all(rc == 0 for rc in rcs), f"put_from failed: {rcs}")
+
+            half = count // 2
+            lengths = await asyncio.gather(*[
+                self.store.async_get_into(keys[i], dst_ptr + i * item_size, item_size)
+                for i in range(half)
+            ])
+            self.assertEqual(lengths, [item_size] * half)
+            batch_lengths = await self.store.async_batch_get_into(
+                keys[half:],
+                [dst_ptr + i * item_size for i in range(half, count)],
+                [item_size] * (count - half))
+            self.assertEqual(batch_lengths, [item_size] * (count - half))
+            self.assertTrue(np.array_equal(src, dst), "Retrieved buffers mismatch")
+        finally:
+            self.store.unregister_buffer(src_ptr)
+            self.store.unregister_buffer(dst_ptr)
+
 # ==========================================
 #  Tensor Functional Tests
 # ==========================================
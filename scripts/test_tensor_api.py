@@ -569,6 +569,22 @@ class TestMooncakeFunctional(MooncakeTestBase):
 
             recon = torch.cat(reconstruction_parts, dim=split_dim)
             self.assertTrue(torch.equal(recon, original), f"Tensor {i} final reconstruction mismatch")
+
+    def test_12_tensor_shard_any_tp_size(self):
+        """Verify readers of different TP sizes read their shards of one whole tensor."""
+        key = "func_test_tensor_shard"
+        tensor = torch.randn(6, 64, 32, dtype=torch.bfloat16)
+        rc = self.store.put_tensor(key, tensor)
+        self.assertEqual(rc, 0, "put_tensor failed")
+
+        for split_dim in range(tensor.dim()):
+            for tp_size in (2, 4):
+                expected_chunks = tensor.chunk(tp_size, split_dim)
+                for rank, expected in enumerate(expected_chunks):
+                    shard = self.store.get_tensor_shard(key, tp_rank=rank, tp_size=tp_size, split_dim=split_dim)
+                    self.assertIsNotNone(shard, f"Shard {rank}/{tp_size} of dim {split_dim} is None")
+                    self.assertTrue(torch.equal(shard, expected),
+                                    f"Shard {rank}/{tp_size} of dim {split_dim} mismatch")
 # ==========================================
 #  Performance/Benchmark Tests
 # ==========================================